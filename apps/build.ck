@@ -52,6 +52,7 @@ function build() {
         "apps/ck:chalk",
         "apps/debug:debug",
         "apps/efiboot:efiboot",
+        "apps/ktrace:ktrace",
         "apps/lib/lzma/util:lzma",
         "apps/lib/lzma/util:build_lzma",
         "apps/mingen:bootstrap_stamp",
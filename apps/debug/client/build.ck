@@ -78,6 +78,9 @@ function build() {
         "dwread.c",
         "elf.c",
         "exts.c",
+        "profexp.c",
+        "proflock.c",
+        "profoff.c",
         "profthrd.c",
         "remsrv.c",
         "stabs.c",
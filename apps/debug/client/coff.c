@@ -112,6 +112,7 @@ DEBUG_SYMBOL_INTERFACE DbgCoffSymbolInterface = {
     NULL,
     NULL,
     NULL,
+    NULL,
     NULL
 };
 
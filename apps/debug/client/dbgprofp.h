@@ -30,6 +30,20 @@ Module Name:
 // ---------------------------------------------------------------- Definitions
 //
 
+//
+// Define flags for profiler data entries.
+//
+
+#define PROFILER_DATA_FLAGS_MEMORY_SENTINEL 0x1
+#define PROFILER_DATA_FLAGS_LOCK_SENTINEL 0x2
+#define PROFILER_DATA_FLAGS_OFF_CPU_SENTINEL 0x4
+
+//
+// Define the number of buckets in the hash table of recorded stack samples.
+//
+
+#define PROFILER_STACK_SAMPLE_HASH_SIZE 1024
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -68,6 +82,41 @@ typedef struct _PROFILER_DATA_ENTRY {
     BYTE *Data;
 } PROFILER_DATA_ENTRY, *PPROFILER_DATA_ENTRY;
 
+/*++
+
+Structure Description:
+
+    This structure defines a unique call stack seen by the stack sampler,
+    along with the thread it was seen on.
+
+Members:
+
+    Next - Stores a pointer to the next sample in the same hash bucket.
+
+    Hash - Stores the hash of the process ID, thread ID, and call stack.
+
+    ProcessId - Stores the ID of the process the sample was taken in.
+
+    ThreadId - Stores the ID of the thread the sample was taken in.
+
+    Count - Stores the number of times this call stack was sampled.
+
+    FrameCount - Stores the number of elements in the frames array.
+
+    Frames - Stores the call stack addresses, innermost frame first.
+
+--*/
+
+typedef struct _PROFILER_STACK_SAMPLE {
+    struct _PROFILER_STACK_SAMPLE *Next;
+    ULONG Hash;
+    ULONG ProcessId;
+    ULONG ThreadId;
+    ULONG Count;
+    ULONG FrameCount;
+    ULONGLONG Frames[ANYSIZE_ARRAY];
+} PROFILER_STACK_SAMPLE, *PPROFILER_STACK_SAMPLE;
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -103,6 +152,74 @@ Return Value:
 
 --*/
 
+BOOL
+DbgrpGetProfilerSnapshot (
+    PLIST_ENTRY ListHead,
+    HANDLE ListLock,
+    ULONG SentinelFlag,
+    PBYTE *Buffer,
+    PULONG BufferSize
+    );
+
+/*++
+
+Routine Description:
+
+    This routine copies the most recent complete snapshot of periodically sent
+    statistics into a single buffer. Older snapshots are released. The most
+    recent one is kept so that it can be displayed again until a newer one
+    arrives.
+
+Arguments:
+
+    ListHead - Supplies a pointer to the head of the list of profiler data
+        entries holding the statistics.
+
+    ListLock - Supplies a handle to the lock serializing access to the list.
+
+    SentinelFlag - Supplies the profiler data flag that marks the last entry
+        of a complete snapshot. See PROFILER_DATA_FLAGS_*_SENTINEL.
+
+    Buffer - Supplies a pointer where a pointer to the snapshot data will be
+        returned on success. The caller is responsible for freeing this
+        buffer.
+
+    BufferSize - Supplies a pointer where the size of the snapshot will be
+        returned on success.
+
+Return Value:
+
+    TRUE if a snapshot was returned.
+
+    FALSE if no complete snapshot is available or on allocation failure.
+
+--*/
+
+ULONGLONG
+DbgrpConvertProfilerTicks (
+    ULONGLONG Ticks,
+    ULONGLONG Frequency
+    );
+
+/*++
+
+Routine Description:
+
+    This routine converts a duration in time counter ticks to microseconds.
+
+Arguments:
+
+    Ticks - Supplies the duration in time counter ticks.
+
+    Frequency - Supplies the frequency of the time counter in ticks per second.
+
+Return Value:
+
+    Returns the duration in microseconds, or the raw tick count if the
+    frequency is unknown.
+
+--*/
+
 //
 // Thread profiling functions
 //
@@ -207,3 +324,479 @@ Return Value:
 
 --*/
 
+VOID
+DbgrpFullyProcessThreadProfilingData (
+    PDEBUGGER_CONTEXT Context
+    );
+
+/*++
+
+Routine Description:
+
+    This routine processes unhandled thread profiling data, sorting its
+    events into the proper pointer arrays.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+Return Value:
+
+    None.
+
+--*/
+
+PSTR
+DbgpGetProcessName (
+    PDEBUGGER_CONTEXT Context,
+    ULONG ProcessId,
+    PSTR NumericBuffer,
+    ULONG NumericBufferSize
+    );
+
+/*++
+
+Routine Description:
+
+    This routine gets the name of a given process. If the name cannot be found,
+    the number will be converted to a string.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    ProcessId - Supplies the process ID to convert to a name.
+
+    NumericBuffer - Supplies a pointer to a buffer to use to create the string
+        if a name could not be found.
+
+    NumericBufferSize - Supplies the size of the numeric buffer in bytes.
+
+Return Value:
+
+    Returns the name of the process, returning either a found name or the
+    numeric buffer. Either way, the caller does not need to free this buffer.
+
+--*/
+
+PSTR
+DbgrpGetThreadName (
+    PDEBUGGER_CONTEXT Context,
+    ULONG ThreadId,
+    PSTR NumericBuffer,
+    ULONG NumericBufferSize
+    );
+
+/*++
+
+Routine Description:
+
+    This routine gets the name of a given thread. If the name cannot be found,
+    the number will be converted to a string.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    ThreadId - Supplies the thread ID to convert to a name.
+
+    NumericBuffer - Supplies a pointer to a buffer to use to create the string
+        if a name could not be found.
+
+    NumericBufferSize - Supplies the size of the numeric buffer in bytes.
+
+Return Value:
+
+    Returns the name of the thread, returning either a found name or the
+    numeric buffer. Either way, the caller does not need to free this buffer.
+
+--*/
+
+
+//
+// Lock profiling functions
+//
+
+INT
+DbgrpInitializeLockProfiling (
+    PDEBUGGER_CONTEXT Context
+    );
+
+/*++
+
+Routine Description:
+
+    This routine initializes support for lock profiling.
+
+Arguments:
+
+    Context - Supplies a pointer to the debugger context.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error code on failure.
+
+--*/
+
+VOID
+DbgrpDestroyLockProfiling (
+    PDEBUGGER_CONTEXT Context
+    );
+
+/*++
+
+Routine Description:
+
+    This routine destroys any structures used for lock profiling.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+DbgrpProcessLockProfilingData (
+    PDEBUGGER_CONTEXT Context,
+    PPROFILER_DATA_ENTRY ProfilerData
+    );
+
+/*++
+
+Routine Description:
+
+    This routine collects a lock statistics notification that the debuggee
+    sent to the debugger.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    ProfilerData - Supplies a pointer to the newly allocated data. This routine
+        will take ownership of that allocation.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+DbgrpCompleteLockProfilingRound (
+    PDEBUGGER_CONTEXT Context
+    );
+
+/*++
+
+Routine Description:
+
+    This routine marks the end of a round of profiler data. If lock statistics
+    arrived during the round, the last packet is marked as the end of a
+    complete snapshot.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+Return Value:
+
+    None.
+
+--*/
+
+INT
+DbgrpDispatchLockProfilerCommand (
+    PDEBUGGER_CONTEXT Context,
+    PSTR *Arguments,
+    ULONG ArgumentCount
+    );
+
+/*++
+
+Routine Description:
+
+    This routine handles a lock profiler command.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Arguments - Supplies an array of strings containing the arguments.
+
+    ArgumentCount - Supplies the number of arguments in the Arguments array.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error code on failure.
+
+--*/
+
+//
+// Stack sample export functions
+//
+
+INT
+DbgrpInitializeStackSamples (
+    PDEBUGGER_CONTEXT Context
+    );
+
+/*++
+
+Routine Description:
+
+    This routine initializes support for recording and exporting stack
+    samples.
+
+Arguments:
+
+    Context - Supplies a pointer to the debugger context.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error code on failure.
+
+--*/
+
+VOID
+DbgrpDestroyStackSamples (
+    PDEBUGGER_CONTEXT Context
+    );
+
+/*++
+
+Routine Description:
+
+    This routine destroys any structures used to record stack samples.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+Return Value:
+
+    None.
+
+--*/
+
+INT
+DbgrpRecordStackSample (
+    PDEBUGGER_CONTEXT Context,
+    ULONG ProcessId,
+    ULONG ThreadId,
+    PULONGLONG Frames,
+    ULONG FrameCount
+    );
+
+/*++
+
+Routine Description:
+
+    This routine records a single stack sample for later export.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    ProcessId - Supplies the ID of the process the sample was taken in.
+
+    ThreadId - Supplies the ID of the thread the sample was taken in.
+
+    Frames - Supplies the call stack addresses, innermost frame first.
+
+    FrameCount - Supplies the number of elements in the frames array.
+
+Return Value:
+
+    0 on success.
+
+    ENOMEM on allocation failure.
+
+--*/
+
+VOID
+DbgrpClearStackSamples (
+    PDEBUGGER_CONTEXT Context
+    );
+
+/*++
+
+Routine Description:
+
+    This routine deletes all recorded stack samples.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+Return Value:
+
+    None.
+
+--*/
+
+INT
+DbgrpExportStackSamples (
+    PDEBUGGER_CONTEXT Context,
+    PROFILER_EXPORT_FORMAT Format,
+    PSTR Path
+    );
+
+/*++
+
+Routine Description:
+
+    This routine writes all recorded stack samples out to a file, symbolized
+    and attributed to their process and thread.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Format - Supplies the format to write the samples in.
+
+    Path - Supplies the path of the file to create.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error code on failure.
+
+--*/
+
+//
+// Off-CPU profiling functions
+//
+
+INT
+DbgrpInitializeOffCpuProfiling (
+    PDEBUGGER_CONTEXT Context
+    );
+
+/*++
+
+Routine Description:
+
+    This routine initializes support for off-CPU profiling.
+
+Arguments:
+
+    Context - Supplies a pointer to the debugger context.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error code on failure.
+
+--*/
+
+VOID
+DbgrpDestroyOffCpuProfiling (
+    PDEBUGGER_CONTEXT Context
+    );
+
+/*++
+
+Routine Description:
+
+    This routine destroys any structures used for off-CPU profiling.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+DbgrpProcessOffCpuProfilingData (
+    PDEBUGGER_CONTEXT Context,
+    PPROFILER_DATA_ENTRY ProfilerData
+    );
+
+/*++
+
+Routine Description:
+
+    This routine collects an off-CPU statistics notification that the debuggee
+    sent to the debugger.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    ProfilerData - Supplies a pointer to the newly allocated data. This routine
+        will take ownership of that allocation.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+DbgrpCompleteOffCpuProfilingRound (
+    PDEBUGGER_CONTEXT Context
+    );
+
+/*++
+
+Routine Description:
+
+    This routine marks the end of a round of profiler data. If off-CPU
+    statistics arrived during the round, the last packet is marked as the end
+    of a complete snapshot.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+Return Value:
+
+    None.
+
+--*/
+
+INT
+DbgrpDispatchOffCpuProfilerCommand (
+    PDEBUGGER_CONTEXT Context,
+    PSTR *Arguments,
+    ULONG ArgumentCount
+    );
+
+/*++
+
+Routine Description:
+
+    This routine handles an off-CPU profiler command.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Arguments - Supplies an array of strings containing the arguments.
+
+    ArgumentCount - Supplies the number of arguments in the Arguments array.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error code on failure.
+
+--*/
+
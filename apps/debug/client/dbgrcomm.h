@@ -328,6 +328,22 @@ Structure Description:
     MemoryCollectionActive - Stores a boolean indicating if memory data is
         being collected.
 
+    LockListHead - Stores the head of the list of lock statistics data.
+
+    LockListLock - Stores a handle to the lock serializing access to the lock
+        statistics list.
+
+    LockCollectionActive - Stores a boolean indicating if lock statistics are
+        being collected.
+
+    OffCpuListHead - Stores the head of the list of off-CPU statistics data.
+
+    OffCpuListLock - Stores a handle to the lock serializing access to the
+        off-CPU statistics list.
+
+    OffCpuCollectionActive - Stores a boolean indicating if off-CPU statistics
+        are being collected.
+
     CommandLineStackRoot - Stores the stack profiling root node when running
         from the command line.
 
@@ -337,6 +353,14 @@ Structure Description:
     CommandLineBaseListHead - Stores a pointer to the base line memory list
         list when running command line commands.
 
+    SampleLock - Stores a handle to the lock serializing access to the
+        recorded stack samples.
+
+    SampleTable - Stores a pointer to the hash table of unique stack samples
+        recorded for export.
+
+    SampleCount - Stores the number of unique stack samples in the table.
+
 --*/
 
 typedef struct _DEBUGGER_PROFILING_DATA {
@@ -345,9 +369,18 @@ typedef struct _DEBUGGER_PROFILING_DATA {
     LIST_ENTRY MemoryListHead;
     HANDLE MemoryListLock;
     BOOL MemoryCollectionActive;
+    LIST_ENTRY LockListHead;
+    HANDLE LockListLock;
+    BOOL LockCollectionActive;
+    LIST_ENTRY OffCpuListHead;
+    HANDLE OffCpuListLock;
+    BOOL OffCpuCollectionActive;
     PSTACK_DATA_ENTRY CommandLineStackRoot;
     PLIST_ENTRY CommandLinePoolListHead;
     PLIST_ENTRY CommandLineBaseListHead;
+    HANDLE SampleLock;
+    struct _PROFILER_STACK_SAMPLE **SampleTable;
+    ULONG SampleCount;
 } DEBUGGER_PROFILING_DATA, *PDEBUGGER_PROFILING_DATA;
 
 /*++
@@ -894,6 +927,40 @@ Return Value:
 
 --*/
 
+INT
+DbgrProfilerCapture (
+    PDEBUGGER_CONTEXT Context,
+    ULONG Seconds,
+    PROFILER_EXPORT_FORMAT Format,
+    PSTR Path
+    );
+
+/*++
+
+Routine Description:
+
+    This routine collects profiling data from a running target for the given
+    amount of time without user interaction, and then exports the stack
+    samples to a file.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Seconds - Supplies the number of seconds to collect data for.
+
+    Format - Supplies the format to export the stack samples in.
+
+    Path - Supplies the path of the file to write the samples to.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error code on failure.
+
+--*/
+
 //
 // General debugger functions
 //
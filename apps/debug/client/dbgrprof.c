@@ -59,10 +59,12 @@ Module Name:
 #define PROFILER_STACK_INDENT_LENGTH 2
 
 //
-// Define flags for profiler data entries.
+// Defines the maximum number of frames in a single stack sample, which is
+// bounded by the size field of the sample's sentinel.
 //
 
-#define PROFILER_DATA_FLAGS_MEMORY_SENTINEL 0x1
+#define PROFILER_MAX_STACK_FRAMES \
+    ((~PROFILER_DATA_SENTINEL_MASK + 1) / sizeof(ULONG))
 
 #define PROFILER_USAGE                                                         \
     "Usage: profiler <type> [options...]\n"                                    \
@@ -70,6 +72,8 @@ Module Name:
     "  stack  - Samples the execution call stack at a regular interval.\n"     \
     "  memory - Displays kernel memory pool data.\n"                           \
     "  thread - Displays kernel thread information.\n"                         \
+    "  lock   - Displays kernel lock contention statistics.\n"                 \
+    "  offcpu - Displays where kernel threads spend time blocked.\n"           \
     "  help   - Display this help.\n"                                          \
     "Try 'profiler <type> help' for help with a specific profiling type.\n"    \
     "Note that profiling must be activated on the target for data to be \n"    \
@@ -91,6 +95,10 @@ Module Name:
     "          hits that a stack entry must achieve to be printed out in \n"   \
     "          the dump. This is useful for limiting results to only those \n" \
     "          that dominate the sampling.\n"                                  \
+    "  export <folded|pprof> <file> - Write every stack sample received \n"    \
+    "          so far to the given file, symbolized and attributed to its \n"  \
+    "          process and thread. The folded format is consumed by flame \n"  \
+    "          graph tools, and the pprof format by the pprof tool.\n"         \
     "  help  - Display this help.\n\n"
 
 #define MEMORY_PROFILER_USAGE                                                  \
@@ -225,6 +233,21 @@ Return Value:
         return Result;
     }
 
+    Result = DbgrpInitializeLockProfiling(Context);
+    if (Result != 0) {
+        return Result;
+    }
+
+    Result = DbgrpInitializeOffCpuProfiling(Context);
+    if (Result != 0) {
+        return Result;
+    }
+
+    Result = DbgrpInitializeStackSamples(Context);
+    if (Result != 0) {
+        return Result;
+    }
+
     INITIALIZE_LIST_HEAD(&(Context->ProfilingData.StackListHead));
     INITIALIZE_LIST_HEAD(&(Context->ProfilingData.MemoryListHead));
     Context->ProfilingData.MemoryCollectionActive = FALSE;
@@ -269,6 +292,9 @@ Return Value:
     }
 
     DbgrpDestroyThreadProfiling(Context);
+    DbgrpDestroyLockProfiling(Context);
+    DbgrpDestroyOffCpuProfiling(Context);
+    DbgrpDestroyStackSamples(Context);
     DbgrDestroyProfilerStackData(Context->ProfilingData.CommandLineStackRoot);
     DbgrDestroyProfilerMemoryData(
                                Context->ProfilingData.CommandLinePoolListHead);
@@ -343,6 +369,8 @@ Return Value:
         }
 
         ReleaseDebuggerLock(Context->ProfilingData.MemoryListLock);
+        DbgrpCompleteLockProfilingRound(Context);
+        DbgrpCompleteOffCpuProfilingRound(Context);
         Result = TRUE;
         goto ProcessProfilerNotificationEnd;
     }
@@ -411,6 +439,16 @@ Return Value:
         Result = TRUE;
         break;
 
+    case ProfilerDataTypeLock:
+        DbgrpProcessLockProfilingData(Context, ProfilerData);
+        Result = TRUE;
+        break;
+
+    case ProfilerDataTypeOffCpu:
+        DbgrpProcessOffCpuProfilingData(Context, ProfilerData);
+        Result = TRUE;
+        break;
+
     default:
         DbgOut("Error: Unknown profiler notification type %d.\n",
                ProfilerNotification->Header.Type);
@@ -488,6 +526,16 @@ Return Value:
                                                     Arguments,
                                                     ArgumentCount);
 
+    } else if (strcasecmp(Arguments[0], "lock") == 0) {
+        Result = DbgrpDispatchLockProfilerCommand(Context,
+                                                  Arguments,
+                                                  ArgumentCount);
+
+    } else if (strcasecmp(Arguments[0], "offcpu") == 0) {
+        Result = DbgrpDispatchOffCpuProfilerCommand(Context,
+                                                    Arguments,
+                                                    ArgumentCount);
+
     } else if (strcasecmp(Arguments[0], "help") == 0) {
         DbgOut(PROFILER_USAGE);
         Result = 0;
@@ -634,6 +682,7 @@ Return Value:
         case ProfilerDataTypeStack:
             DbgrDestroyProfilerStackData(ProfilingData->CommandLineStackRoot);
             Context->ProfilingData.CommandLineStackRoot = NULL;
+            DbgrpClearStackSamples(Context);
             break;
 
         default:
@@ -766,20 +815,23 @@ Return Value:
     PSTACK_DATA_ENTRY AllocatedRoot;
     PDEBUGGER_CONTEXT Context;
     PSTACK_DATA_ENTRY CurrentEntry;
-    ULONG CurrentStackLength;
     PLIST_ENTRY DataEntry;
+    ULONG FrameCount;
+    ULONGLONG Frames[PROFILER_MAX_STACK_FRAMES];
     ULONG Index;
-    ULONGLONG Offset;
+    ULONG Offset;
     PSTACK_DATA_ENTRY Parent;
     ULONG PointerSize;
+    ULONG ProcessId;
     PPROFILER_DATA_ENTRY ProfilerData;
     BOOL Result;
     PSTACK_DATA_ENTRY Root;
-    ULONG RoutineCount;
+    ULONG SampleSize;
     PSTACK_DATA_ENTRY StackData;
     PLIST_ENTRY StackEntry;
-    ULONG StackLength;
     LIST_ENTRY StackListHead;
+    ULONG ThreadId;
+    ULONGLONG Value;
 
     assert(StackTreeRoot != NULL);
 
@@ -838,7 +890,6 @@ Return Value:
     DataEntry = StackListHead.Next;
     while (DataEntry != &StackListHead) {
         ProfilerData = LIST_VALUE(DataEntry, PROFILER_DATA_ENTRY, ListEntry);
-        RoutineCount = ProfilerData->DataSize / PointerSize;
         if ((ProfilerData->DataSize % PointerSize) != 0) {
             DbgOut("Bad profiler data size %d.\n", ProfilerData->DataSize);
             Result = FALSE;
@@ -846,96 +897,117 @@ Return Value:
         }
 
         //
-        // Run through the data array backwards to parse each stack from the
-        // root routine.
+        // Each sample starts with a sentinel containing its size, followed by
+        // the process and thread IDs and then the call stack.
         //
 
-        Parent = Root;
-        CurrentStackLength = 0;
-        for (Index = RoutineCount; Index > 0; Index -= 1) {
-            Address = 0;
-            Offset = (Index - 1) * PointerSize;
-            RtlCopyMemory(&Address, &(ProfilerData->Data[Offset]), PointerSize);
+        Offset = 0;
+        while (Offset < ProfilerData->DataSize) {
+            Value = 0;
+            RtlCopyMemory(&Value, &(ProfilerData->Data[Offset]), PointerSize);
+            SampleSize = GET_PROFILER_DATA_SIZE(Value);
+            if ((IS_PROFILER_DATA_SENTINEL(Value) == FALSE) ||
+                ((SampleSize % PointerSize) != 0) ||
+                (SampleSize <=
+                 (PROFILER_STACK_SAMPLE_HEADER_COUNT * PointerSize)) ||
+                (Offset + SampleSize > ProfilerData->DataSize)) {
 
-            //
-            // Every sentinel encountered means that a call stack was
-            // completely processed.
-            //
+                DbgOut("Error: Profiler collected incomplete call stack.\n");
+                Result = FALSE;
+                goto GetProfilerStackDataEnd;
+            }
 
-            if (IS_PROFILER_DATA_SENTINEL(Address) != FALSE) {
+            ProcessId = 0;
+            ThreadId = 0;
+            RtlCopyMemory(&ProcessId,
+                          &(ProfilerData->Data[Offset + PointerSize]),
+                          sizeof(ULONG));
 
-                //
-                // Validate that this was a complete stack. The stack size
-                // stored in the sentinel marker includes the size of the
-                // sentinel.
-                //
+            RtlCopyMemory(&ThreadId,
+                          &(ProfilerData->Data[Offset + (PointerSize * 2)]),
+                          sizeof(ULONG));
 
-                StackLength = GET_PROFILER_DATA_SIZE(Address) / PointerSize;
-                if (CurrentStackLength != (StackLength - 1)) {
-                    DbgOut("Error: Profiler collected incomplete call "
-                           "stack.\n");
+            FrameCount = (SampleSize / PointerSize) -
+                         PROFILER_STACK_SAMPLE_HEADER_COUNT;
 
-                    Result = FALSE;
-                    goto GetProfilerStackDataEnd;
-                }
+            Offset += PROFILER_STACK_SAMPLE_HEADER_COUNT * PointerSize;
+            for (Index = 0; Index < FrameCount; Index += 1) {
+                Frames[Index] = 0;
+                RtlCopyMemory(&(Frames[Index]),
+                              &(ProfilerData->Data[Offset]),
+                              PointerSize);
 
-                CurrentStackLength = 0;
-                Root->Count += 1;
-                Parent = Root;
-                continue;
+                Offset += PointerSize;
             }
 
+            DbgrpRecordStackSample(Context,
+                                   ProcessId,
+                                   ThreadId,
+                                   Frames,
+                                   FrameCount);
+
             //
-            // Look up the call site in the parent's list of children.
+            // Run through the call stack backwards to add it to the tree
+            // starting from the root routine.
             //
 
-            CurrentEntry = NULL;
-            StackEntry = Parent->Children.Next;
-            while (StackEntry != &(Parent->Children)) {
-                StackData = LIST_VALUE(StackEntry,
-                                       STACK_DATA_ENTRY,
-                                       SiblingEntry);
+            Root->Count += 1;
+            Parent = Root;
+            for (Index = FrameCount; Index > 0; Index -= 1) {
+                Address = Frames[Index - 1];
 
-                if (StackData->Address == Address) {
-                    CurrentEntry = StackData;
-                    break;
-                }
+                //
+                // Look up the call site in the parent's list of children.
+                //
 
-                StackEntry = StackEntry->Next;
-            }
+                CurrentEntry = NULL;
+                StackEntry = Parent->Children.Next;
+                while (StackEntry != &(Parent->Children)) {
+                    StackData = LIST_VALUE(StackEntry,
+                                           STACK_DATA_ENTRY,
+                                           SiblingEntry);
 
-            //
-            // If there was no match, create a new entry. If this fails,
-            // just exit returning failure.
-            //
+                    if (StackData->Address == Address) {
+                        CurrentEntry = StackData;
+                        break;
+                    }
+
+                    StackEntry = StackEntry->Next;
+                }
+
+                //
+                // If there was no match, create a new entry. If this fails,
+                // just exit returning failure.
+                //
 
-            if (CurrentEntry == NULL) {
-                CurrentEntry = DbgrpCreateStackEntry(DbgrProfilerGlobalContext,
+                if (CurrentEntry == NULL) {
+                    CurrentEntry = DbgrpCreateStackEntry(
+                                                     DbgrProfilerGlobalContext,
                                                      Parent,
                                                      Address);
 
-                if (CurrentEntry == NULL) {
-                    DbgOut("Error: Failed to create stack entry.\n");
-                    Result = FALSE;
-                    goto GetProfilerStackDataEnd;
+                    if (CurrentEntry == NULL) {
+                        DbgOut("Error: Failed to create stack entry.\n");
+                        Result = FALSE;
+                        goto GetProfilerStackDataEnd;
+                    }
                 }
-            }
 
-            //
-            // Account for this match on the current entry, remove it, and
-            // then insert it back into the stack in order.
-            //
+                //
+                // Account for this match on the current entry, remove it, and
+                // then insert it back into the stack in order.
+                //
 
-            CurrentEntry->Count += 1;
-            LIST_REMOVE(&(CurrentEntry->SiblingEntry));
-            DbgrpInsertStackData(Parent, CurrentEntry);
+                CurrentEntry->Count += 1;
+                LIST_REMOVE(&(CurrentEntry->SiblingEntry));
+                DbgrpInsertStackData(Parent, CurrentEntry);
 
-            //
-            // Move down the stack.
-            //
+                //
+                // Move down the stack.
+                //
 
-            Parent = CurrentEntry;
-            CurrentStackLength += 1;
+                Parent = CurrentEntry;
+            }
         }
 
         //
@@ -1939,6 +2011,184 @@ Return Value:
     return;
 }
 
+BOOL
+DbgrpGetProfilerSnapshot (
+    PLIST_ENTRY ListHead,
+    HANDLE ListLock,
+    ULONG SentinelFlag,
+    PBYTE *Buffer,
+    PULONG BufferSize
+    )
+
+/*++
+
+Routine Description:
+
+    This routine copies the most recent complete snapshot of periodically sent
+    statistics into a single buffer. Older snapshots are released. The most
+    recent one is kept so that it can be displayed again until a newer one
+    arrives.
+
+Arguments:
+
+    ListHead - Supplies a pointer to the head of the list of profiler data
+        entries holding the statistics.
+
+    ListLock - Supplies a handle to the lock serializing access to the list.
+
+    SentinelFlag - Supplies the profiler data flag that marks the last entry
+        of a complete snapshot. See PROFILER_DATA_FLAGS_*_SENTINEL.
+
+    Buffer - Supplies a pointer where a pointer to the snapshot data will be
+        returned on success. The caller is responsible for freeing this
+        buffer.
+
+    BufferSize - Supplies a pointer where the size of the snapshot will be
+        returned on success.
+
+Return Value:
+
+    TRUE if a snapshot was returned.
+
+    FALSE if no complete snapshot is available or on allocation failure.
+
+--*/
+
+{
+
+    PBYTE Data;
+    ULONG DataSize;
+    PLIST_ENTRY CurrentEntry;
+    PLIST_ENTRY LastSentinel;
+    ULONG Offset;
+    PPROFILER_DATA_ENTRY ProfilerData;
+    BOOL Result;
+    PLIST_ENTRY SnapshotStart;
+
+    Data = NULL;
+    AcquireDebuggerLock(ListLock);
+
+    //
+    // Find the end of the most recent complete snapshot, and the start of it,
+    // which is just after the sentinel before it.
+    //
+
+    LastSentinel = NULL;
+    SnapshotStart = ListHead->Next;
+    CurrentEntry = ListHead->Next;
+    while (CurrentEntry != ListHead) {
+        ProfilerData = LIST_VALUE(CurrentEntry, PROFILER_DATA_ENTRY, ListEntry);
+        if ((ProfilerData->Flags & SentinelFlag) != 0) {
+            if (LastSentinel != NULL) {
+                SnapshotStart = LastSentinel->Next;
+            }
+
+            LastSentinel = CurrentEntry;
+        }
+
+        CurrentEntry = CurrentEntry->Next;
+    }
+
+    if (LastSentinel == NULL) {
+        Result = FALSE;
+        goto GetProfilerSnapshotEnd;
+    }
+
+    //
+    // Release any stale snapshots.
+    //
+
+    while (ListHead->Next != SnapshotStart) {
+        ProfilerData = LIST_VALUE(ListHead->Next,
+                                  PROFILER_DATA_ENTRY,
+                                  ListEntry);
+
+        LIST_REMOVE(&(ProfilerData->ListEntry));
+        free(ProfilerData->Data);
+        free(ProfilerData);
+    }
+
+    //
+    // Gather the snapshot, which may have been split across several packets,
+    // into one buffer.
+    //
+
+    DataSize = 0;
+    CurrentEntry = SnapshotStart;
+    while (CurrentEntry != LastSentinel->Next) {
+        ProfilerData = LIST_VALUE(CurrentEntry, PROFILER_DATA_ENTRY, ListEntry);
+        DataSize += ProfilerData->DataSize;
+        CurrentEntry = CurrentEntry->Next;
+    }
+
+    Data = malloc(DataSize);
+    if (Data == NULL) {
+        DbgOut("Error: Failed to allocate %d bytes for statistics.\n",
+               DataSize);
+
+        Result = FALSE;
+        goto GetProfilerSnapshotEnd;
+    }
+
+    Offset = 0;
+    CurrentEntry = SnapshotStart;
+    while (CurrentEntry != LastSentinel->Next) {
+        ProfilerData = LIST_VALUE(CurrentEntry, PROFILER_DATA_ENTRY, ListEntry);
+        RtlCopyMemory(Data + Offset,
+                      ProfilerData->Data,
+                      ProfilerData->DataSize);
+
+        Offset += ProfilerData->DataSize;
+        CurrentEntry = CurrentEntry->Next;
+    }
+
+    *Buffer = Data;
+    *BufferSize = DataSize;
+    Result = TRUE;
+
+GetProfilerSnapshotEnd:
+    ReleaseDebuggerLock(ListLock);
+    return Result;
+}
+
+ULONGLONG
+DbgrpConvertProfilerTicks (
+    ULONGLONG Ticks,
+    ULONGLONG Frequency
+    )
+
+/*++
+
+Routine Description:
+
+    This routine converts a duration in time counter ticks to microseconds.
+
+Arguments:
+
+    Ticks - Supplies the duration in time counter ticks.
+
+    Frequency - Supplies the frequency of the time counter in ticks per second.
+
+Return Value:
+
+    Returns the duration in microseconds, or the raw tick count if the
+    frequency is unknown.
+
+--*/
+
+{
+
+    if (Frequency == 0) {
+        return Ticks;
+    }
+
+    if (Ticks < (MAX_ULONGLONG / 1000000ULL)) {
+        return (Ticks * 1000000ULL) / Frequency;
+    }
+
+    return (Ticks / Frequency) * 1000000ULL;
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
@@ -2440,6 +2690,7 @@ Return Value:
 
     PSTR AdvancedString;
     PROFILER_DISPLAY_REQUEST DisplayRequest;
+    PROFILER_EXPORT_FORMAT Format;
     LONG Threshold;
 
     assert(strcasecmp(Arguments[0], "stack") == 0);
@@ -2490,6 +2741,25 @@ Return Value:
             return EINVAL;
         }
 
+    } else if (strcasecmp(Arguments[1], "export") == 0) {
+        if (ArgumentCount < 4) {
+            DbgOut("Error: Format and file arguments expected.\n");
+            return EINVAL;
+        }
+
+        if (strcasecmp(Arguments[2], "folded") == 0) {
+            Format = ProfilerExportFolded;
+
+        } else if (strcasecmp(Arguments[2], "pprof") == 0) {
+            Format = ProfilerExportPprof;
+
+        } else {
+            DbgOut("Error: Unknown export format '%s'.\n", Arguments[2]);
+            return EINVAL;
+        }
+
+        return DbgrpExportStackSamples(Context, Format, Arguments[3]);
+
     } else if (strcasecmp(Arguments[1], "help") == 0) {
         DbgOut(STACK_PROFILER_USAGE);
         return 0;
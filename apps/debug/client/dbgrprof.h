@@ -80,6 +80,30 @@ typedef enum _PROFILER_DISPLAY_REQUEST {
 
 /*++
 
+Enumeration Description:
+
+    This enumeration describes the file formats that stack samples can be
+    exported in.
+
+Values:
+
+    ProfilerExportInvalid - Indicates an invalid choice.
+
+    ProfilerExportFolded - Indicates the folded stack text format consumed by
+        flame graph tools, one line per unique stack with its sample count.
+
+    ProfilerExportPprof - Indicates the pprof profile protocol buffer format.
+
+--*/
+
+typedef enum _PROFILER_EXPORT_FORMAT {
+    ProfilerExportInvalid,
+    ProfilerExportFolded,
+    ProfilerExportPprof
+} PROFILER_EXPORT_FORMAT, *PPROFILER_EXPORT_FORMAT;
+
+/*++
+
 Structure Description:
 
     This structure defines call stack data used for profiler tracing.
@@ -73,12 +73,16 @@ Module Name:
 #define DEBUGGER_USAGE                                                         \
     "Usage: debug [-i] [-s <path>...] [-e <path>...] "                         \
     "[-k <connection>] [-b <baud_rate>] [-r remote:port] \n"                   \
+    "[-p <seconds> [-f <format>] [-o <path>]] "                                \
     "[-- <child_parameters...>]\n\n"        \
     "The Minoca debugger facilitates debugging, tracing, and profiling of \n"  \
     "user mode programs and remote kernels. Options are:\n"                    \
     "  -b, --baud-rate=<baud_rate> -- Specify the baud rate for kernel \n"     \
     "      serial port connections. If not specified, the default is \n"       \
     "      115200bps.\n"                                                       \
+    "  -f, --profile-format=<format> -- Set the format the -p option \n"       \
+    "      writes stack samples in: either folded, for flame graph tools, \n"  \
+    "      or pprof. The default is folded.\n"                                 \
     "  -i, --initial-break -- Request an initial breakpoint upon connection.\n"\
     "  -e, --extension=<path> -- Load the debugger extension at the given \n"  \
     "      path. This can also be done at runtime using the load command.\n"   \
@@ -86,6 +90,13 @@ Module Name:
     "      using the given connection string. Connections can be named \n"     \
     "      pipes like '\\\\.\\pipe\\mypipe' or can be serial ports like \n"    \
     "      'COM1'.\n"                                                          \
+    "  -o, --profile-output=<path> -- Set the file the -p option writes \n"    \
+    "      stack samples to. The default is profile.folded, or profile.pb \n"  \
+    "      for the pprof format.\n"                                            \
+    "  -p, --profile=<seconds> -- Collect profiling data from a kernel \n"     \
+    "      connection for the given number of seconds without the \n"          \
+    "      interactive UI, export the stack samples, and exit. Profiling \n"   \
+    "      must already be enabled on the target.\n"                           \
     "  -r, --remote=<address:port> -- Connect to a remote debug server \n"     \
     "      using the given form. IPv6 addresses should be enclosed in \n"      \
     "      [square] brackets to disambiguate the colon separating the \n"      \
@@ -107,7 +118,7 @@ Module Name:
     "      arguments of the child process to launch and attach to. \n"         \
     "      Debugging a child process is incompatible with the -k option.\n\n"
 
-#define DEBUG_SHORT_OPTIONS "b:e:ik:r:R:s:S:"
+#define DEBUG_SHORT_OPTIONS "b:e:f:ik:o:p:r:R:s:S:"
 
 //
 // -------------------------------------------------------------------- Globals
@@ -116,8 +127,11 @@ Module Name:
 struct option DbgrLongOptions[] = {
     {"baud-rate", required_argument, 0, 'b'},
     {"extension", required_argument, 0, 'e'},
+    {"profile-format", required_argument, 0, 'f'},
     {"initial-break", no_argument, 0, 'i'},
     {"kernel", required_argument, 0, 'k'},
+    {"profile-output", required_argument, 0, 'o'},
+    {"profile", required_argument, 0, 'p'},
     {"remote", required_argument, 0, 'r'},
     {"reverse-remote", required_argument, 0, 'R'},
     {"symbol-path", required_argument, 0, 's'},
@@ -191,6 +205,9 @@ Return Value:
     ULONG HistoryIndex;
     INT Option;
     ULONG PathIndex;
+    PROFILER_EXPORT_FORMAT ProfileFormat;
+    PSTR ProfileOutput;
+    ULONG ProfileSeconds;
     PSTR RemoteAddress;
     INT Result;
     INT ReturnValue;
@@ -202,6 +219,9 @@ Return Value:
     ConnectionType = DebugConnectionInvalid;
     Channel = NULL;
     ExtensionsInitialized = FALSE;
+    ProfileFormat = ProfilerExportFolded;
+    ProfileOutput = NULL;
+    ProfileSeconds = 0;
     RemoteAddress = NULL;
     ReverseRemote = FALSE;
     TargetArguments = NULL;
@@ -301,6 +321,21 @@ Return Value:
 
             break;
 
+        case 'f':
+            if (strcasecmp(optarg, "folded") == 0) {
+                ProfileFormat = ProfilerExportFolded;
+
+            } else if (strcasecmp(optarg, "pprof") == 0) {
+                ProfileFormat = ProfilerExportPprof;
+
+            } else {
+                DbgOut("Error: Invalid profile format '%s'.\n", optarg);
+                Result = EINVAL;
+                goto MainEnd;
+            }
+
+            break;
+
         case 'i':
             Context.Flags |= DEBUGGER_FLAG_INITIAL_BREAK;
             break;
@@ -318,6 +353,20 @@ Return Value:
             ConnectionType = DebugConnectionKernel;
             break;
 
+        case 'o':
+            ProfileOutput = optarg;
+            break;
+
+        case 'p':
+            ProfileSeconds = strtoul(optarg, &AfterScan, 0);
+            if ((AfterScan == optarg) || (ProfileSeconds == 0)) {
+                DbgOut("Error: Invalid profile duration '%s'.\n", optarg);
+                Result = EINVAL;
+                goto MainEnd;
+            }
+
+            break;
+
         case 'R':
             ReverseRemote = TRUE;
 
@@ -412,6 +461,12 @@ Return Value:
         goto MainEnd;
     }
 
+    if ((ProfileSeconds != 0) && (ConnectionType != DebugConnectionKernel)) {
+        DbgOut("Error: Profile capture requires a kernel connection.\n");
+        Result = EINVAL;
+        goto MainEnd;
+    }
+
     Result = DbgrInitialize(&Context, ConnectionType);
     if (Result != 0) {
         goto MainEnd;
@@ -439,6 +494,26 @@ Return Value:
             goto MainEnd;
         }
 
+        //
+        // In headless profiling mode, just collect and export data.
+        //
+
+        if (ProfileSeconds != 0) {
+            if (ProfileOutput == NULL) {
+                ProfileOutput = "profile.folded";
+                if (ProfileFormat == ProfilerExportPprof) {
+                    ProfileOutput = "profile.pb";
+                }
+            }
+
+            Result = DbgrProfilerCapture(&Context,
+                                         ProfileSeconds,
+                                         ProfileFormat,
+                                         ProfileOutput);
+
+            goto MainEnd;
+        }
+
     //
     // For user mode debugging, set up the child process.
     //
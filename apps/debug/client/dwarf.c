@@ -41,6 +41,14 @@ Module Name:
 #include <string.h>
 #include <sys/stat.h>
 
+#ifndef _WIN32
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#endif
+
 //
 // --------------------------------------------------------------------- Macros
 //
@@ -49,6 +57,12 @@ Module Name:
 // ---------------------------------------------------------------- Definitions
 //
 
+//
+// Define the initial number of elements in the address index.
+//
+
+#define DWARF_INITIAL_ADDRESS_INDEX_CAPACITY 64
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -89,11 +103,53 @@ DwarfpCheckRange (
     PVOID Ranges
     );
 
+INT
+DwarfLoadDeferredSymbols (
+    PDEBUG_SYMBOLS Symbols,
+    ULONGLONG Address
+    );
+
+PVOID
+DwarfpMapFile (
+    PSTR Filename,
+    UINTN Size
+    );
+
+VOID
+DwarfpUnmapFile (
+    PVOID Data,
+    UINTN Size
+    );
+
 INT
 DwarfpProcessDebugInfo (
     PDWARF_CONTEXT Context
     );
 
+INT
+DwarfpBuildAddressIndex (
+    PDWARF_CONTEXT Context
+    );
+
+PDWARF_COMPILATION_UNIT
+DwarfpFindUnitAtOffset (
+    PDWARF_CONTEXT Context,
+    PLIST_ENTRY *Hint,
+    ULONGLONG Offset
+    );
+
+int
+DwarfpCompareAddressRanges (
+    const void *LeftPointer,
+    const void *RightPointer
+    );
+
+INT
+DwarfpProcessUnitSymbols (
+    PDWARF_CONTEXT Context,
+    PDWARF_COMPILATION_UNIT Unit
+    );
+
 INT
 DwarfpProcessCompilationUnit (
     PDWARF_CONTEXT Context,
@@ -194,7 +250,8 @@ DEBUG_SYMBOL_INTERFACE DwarfSymbolInterface = {
     DwarfStackUnwind,
     DwarfReadDataSymbol,
     DwarfGetAddressOfDataSymbol,
-    DwarfpCheckRange
+    DwarfpCheckRange,
+    DwarfLoadDeferredSymbols
 };
 
 //
@@ -283,30 +340,37 @@ Return Value:
     Context->SourcesHead = &(DwarfSymbols->SourcesHead);
     Context->Flags = Flags;
     INITIALIZE_LIST_HEAD(&(Context->UnitList));
-    Context->FileData = malloc(Stat.st_size);
-    if (Context->FileData == NULL) {
-        Status = errno;
-        goto LoadSymbolsEnd;
-    }
-
     Context->FileSize = Stat.st_size;
 
     //
-    // Read in the file.
+    // Map the file if possible so that only the parts of it actually used get
+    // paged in. Otherwise read the whole thing in.
     //
 
-    File = fopen(Filename, "rb");
-    if (File == NULL) {
-        Status = errno;
-        goto LoadSymbolsEnd;
-    }
+    Context->FileData = DwarfpMapFile(Filename, Stat.st_size);
+    if (Context->FileData != NULL) {
+        Context->Flags |= DWARF_CONTEXT_FILE_MAPPED;
 
-    Read = fread(Context->FileData, 1, Stat.st_size, File);
-    fclose(File);
-    if (Read != Stat.st_size) {
-        DWARF_ERROR("Read only %d of %d bytes.\n", Read, Stat.st_size);
-        Status = errno;
-        goto LoadSymbolsEnd;
+    } else {
+        Context->FileData = malloc(Stat.st_size);
+        if (Context->FileData == NULL) {
+            Status = errno;
+            goto LoadSymbolsEnd;
+        }
+
+        File = fopen(Filename, "rb");
+        if (File == NULL) {
+            Status = errno;
+            goto LoadSymbolsEnd;
+        }
+
+        Read = fread(Context->FileData, 1, Stat.st_size, File);
+        fclose(File);
+        if (Read != Stat.st_size) {
+            DWARF_ERROR("Read only %d of %d bytes.\n", Read, Stat.st_size);
+            Status = errno;
+            goto LoadSymbolsEnd;
+        }
     }
 
     //
@@ -443,6 +507,8 @@ Return Value:
 
     //
     // Parse the .debug_info section, which contains most of the good bits.
+    // Unless asked to load everything, most compilation units are left to be
+    // processed when something inside them is looked up.
     //
 
     Status = DwarfpProcessDebugInfo(Context);
@@ -582,8 +648,21 @@ Return Value:
         }
     }
 
+    if (Context->AddressIndex != NULL) {
+        free(Context->AddressIndex);
+        Context->AddressIndex = NULL;
+    }
+
+    Context->AddressIndexSize = 0;
     if (Context->FileData != NULL) {
-        free(Context->FileData);
+        if ((Context->Flags & DWARF_CONTEXT_FILE_MAPPED) != 0) {
+            DwarfpUnmapFile(Context->FileData, Context->FileSize);
+            Context->Flags &= ~DWARF_CONTEXT_FILE_MAPPED;
+
+        } else {
+            free(Context->FileData);
+        }
+
         Context->FileData = NULL;
     }
 
@@ -991,6 +1070,117 @@ Return Value:
     return FALSE;
 }
 
+INT
+DwarfLoadDeferredSymbols (
+    PDEBUG_SYMBOLS Symbols,
+    ULONGLONG Address
+    )
+
+/*++
+
+Routine Description:
+
+    This routine processes compilation units that were skipped when the
+    symbols were loaded. If an address is given and it falls in the address
+    index, only the units covering it are processed. Otherwise every
+    remaining unit is processed, since the index only describes code and the
+    address may belong to data.
+
+Arguments:
+
+    Symbols - Supplies a pointer to the debug symbols.
+
+    Address - Supplies the address being searched for, or 0 to process every
+        remaining compilation unit.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error number on failure.
+
+--*/
+
+{
+
+    PDWARF_CONTEXT Context;
+    PLIST_ENTRY CurrentEntry;
+    BOOL Found;
+    ULONG Index;
+    ULONG Maximum;
+    ULONG Middle;
+    ULONG Minimum;
+    PDWARF_ADDRESS_RANGE Range;
+    INT Result;
+    INT Status;
+    PDWARF_COMPILATION_UNIT Unit;
+
+    Context = Symbols->SymbolContext;
+    if (Context->DeferredUnits == 0) {
+        return 0;
+    }
+
+    Status = 0;
+    if (Address != 0) {
+
+        //
+        // Find the number of ranges that start at or before the address.
+        //
+
+        Minimum = 0;
+        Maximum = Context->AddressIndexSize;
+        while (Minimum < Maximum) {
+            Middle = Minimum + ((Maximum - Minimum) / 2);
+            if (Context->AddressIndex[Middle].Start <= Address) {
+                Minimum = Middle + 1;
+
+            } else {
+                Maximum = Middle;
+            }
+        }
+
+        //
+        // Walk backwards through those ranges until none before the current
+        // one could reach the address.
+        //
+
+        Found = FALSE;
+        Index = Minimum;
+        while (Index != 0) {
+            Range = &(Context->AddressIndex[Index - 1]);
+            if (Range->MaxEnd <= Address) {
+                break;
+            }
+
+            if (Address < Range->End) {
+                Found = TRUE;
+                Result = DwarfpProcessUnitSymbols(Context, Range->Unit);
+                if (Result != 0) {
+                    Status = Result;
+                }
+            }
+
+            Index -= 1;
+        }
+
+        if (Found != FALSE) {
+            return Status;
+        }
+    }
+
+    CurrentEntry = Context->UnitList.Next;
+    while (CurrentEntry != &(Context->UnitList)) {
+        Unit = LIST_VALUE(CurrentEntry, DWARF_COMPILATION_UNIT, ListEntry);
+        CurrentEntry = CurrentEntry->Next;
+        Result = DwarfpProcessUnitSymbols(Context, Unit);
+        if (Result != 0) {
+            Status = Result;
+        }
+    }
+
+    return Status;
+}
+
 PSOURCE_FILE_SYMBOL
 DwarfpFindSource (
     PDWARF_CONTEXT Context,
@@ -1116,7 +1306,10 @@ DwarfpProcessDebugInfo (
 
 Routine Description:
 
-    This routine processes the .debug_info section of DWARF symbols.
+    This routine processes the .debug_info section of DWARF symbols. The
+    compilation unit headers are all read, but the units themselves are only
+    processed here if they can't be found through the address index or the
+    context asks for everything to be loaded.
 
 Arguments:
 
@@ -1133,9 +1326,8 @@ Return Value:
 {
 
     PUCHAR Bytes;
-    PDWARF_DIE Die;
+    PLIST_ENTRY CurrentEntry;
     PUCHAR InfoStart;
-    DWARF_LOADING_CONTEXT LoadState;
     ULONGLONG Size;
     INT Status;
     PDWARF_COMPILATION_UNIT Unit;
@@ -1144,12 +1336,10 @@ Return Value:
     InfoStart = Bytes;
     Size = Context->Sections.Info.Size;
     Status = 0;
-    Unit = NULL;
-    memset(&LoadState, 0, sizeof(DWARF_LOADING_CONTEXT));
-    Context->LoadingContext = &LoadState;
 
     //
-    // Load up and visit all the compilation units.
+    // Read the headers of all the compilation units. This skips right over
+    // the DIEs, so it's cheap.
     //
 
     while (Size != 0) {
@@ -1174,43 +1364,484 @@ Return Value:
                         Unit->Dies - InfoStart);
         }
 
-        Status = DwarfpLoadCompilationUnit(Context, Unit);
+        INSERT_BEFORE(&(Unit->ListEntry), &(Context->UnitList));
+        Context->DeferredUnits += 1;
+    }
+
+    if ((Context->Flags & DWARF_CONTEXT_LOAD_ALL) == 0) {
+        Status = DwarfpBuildAddressIndex(Context);
         if (Status != 0) {
             goto ProcessDebugInfoEnd;
         }
+    }
+
+    //
+    // Process any units that won't be found through the index now, as there's
+    // no telling when they'll be needed.
+    //
+
+    CurrentEntry = Context->UnitList.Next;
+    while (CurrentEntry != &(Context->UnitList)) {
+        Unit = LIST_VALUE(CurrentEntry, DWARF_COMPILATION_UNIT, ListEntry);
+        CurrentEntry = CurrentEntry->Next;
+        if ((Unit->Flags & DWARF_UNIT_INDEXED) == 0) {
+            Status = DwarfpProcessUnitSymbols(Context, Unit);
+            if (Status != 0) {
+                goto ProcessDebugInfoEnd;
+            }
+        }
+    }
+
+    Status = 0;
+
+ProcessDebugInfoEnd:
+    return Status;
+}
+
+INT
+DwarfpBuildAddressIndex (
+    PDWARF_CONTEXT Context
+    )
+
+/*++
+
+Routine Description:
+
+    This routine builds the sorted index of address ranges to compilation
+    units out of the .debug_aranges section. Each compilation unit described
+    by the section is marked as indexed.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+Return Value:
+
+    0 on success. A missing or malformed .debug_aranges section is not an
+    error, it just leaves units out of the index.
+
+    ENOMEM on allocation failure.
+
+--*/
+
+{
+
+    UCHAR AddressSize;
+    PUCHAR Bytes;
+    ULONG Capacity;
+    PUCHAR End;
+    PLIST_ENTRY Hint;
+    ULONG Index;
+    ULONGLONG InfoOffset;
+    BOOL Is64Bit;
+    BOOL Is64BitAddress;
+    ULONGLONG Length;
+    ULONGLONG MaxEnd;
+    PDWARF_ADDRESS_RANGE NewIndex;
+    ULONG Padding;
+    PDWARF_ADDRESS_RANGE Range;
+    UCHAR SegmentSize;
+    PUCHAR SetEnd;
+    PUCHAR SetStart;
+    ULONGLONG Start;
+    PDWARF_COMPILATION_UNIT Unit;
+    USHORT Version;
+
+    Bytes = Context->Sections.Aranges.Data;
+    if (Bytes == NULL) {
+        return 0;
+    }
+
+    End = Bytes + Context->Sections.Aranges.Size;
+    Capacity = 0;
+    Hint = Context->UnitList.Next;
+    while (Bytes < End) {
+        SetStart = Bytes;
+        DwarfpReadInitialLength(&Bytes, &Is64Bit, &Length);
+        SetEnd = Bytes + Length;
+        if ((Length == 0) || (SetEnd > End)) {
+            break;
+        }
+
+        Version = DwarfpRead2(&Bytes);
+        InfoOffset = DWARF_READN(&Bytes, Is64Bit);
+        AddressSize = DwarfpRead1(&Bytes);
+        SegmentSize = DwarfpRead1(&Bytes);
+        if ((Version != 2) || (SegmentSize != 0) ||
+            ((AddressSize != 4) && (AddressSize != 8))) {
+
+            Bytes = SetEnd;
+            continue;
+        }
+
+        Unit = DwarfpFindUnitAtOffset(Context, &Hint, InfoOffset);
+        if (Unit == NULL) {
+            Bytes = SetEnd;
+            continue;
+        }
 
         //
-        // Now visit the compilation unit now that the DIE tree has been formed.
+        // The tuples are aligned to twice the address size from the start of
+        // the set.
         //
 
-        Status = DwarfpProcessCompilationUnit(Context, Unit);
-        if (Status != 0) {
-            DWARF_ERROR("DWARF: Failed to process compilation unit.\n");
-            goto ProcessDebugInfoEnd;
+        Padding = (Bytes - SetStart) % (AddressSize * 2);
+        if (Padding != 0) {
+            Bytes += (AddressSize * 2) - Padding;
         }
 
-        while (!LIST_EMPTY(&(Unit->DieList))) {
-            Die = LIST_VALUE(Unit->DieList.Next, DWARF_DIE, ListEntry);
-            LIST_REMOVE(&(Die->ListEntry));
-            Die->ListEntry.Next = NULL;
-            DwarfpDestroyDie(Context, Die);
+        Is64BitAddress = FALSE;
+        if (AddressSize == 8) {
+            Is64BitAddress = TRUE;
         }
 
-        INSERT_BEFORE(&(Unit->ListEntry), &(Context->UnitList));
-        Unit = NULL;
+        while (Bytes + (AddressSize * 2) <= SetEnd) {
+            Start = DWARF_READN(&Bytes, Is64BitAddress);
+            Length = DWARF_READN(&Bytes, Is64BitAddress);
+            if ((Start == 0) && (Length == 0)) {
+                break;
+            }
+
+            if (Length == 0) {
+                continue;
+            }
+
+            if (Context->AddressIndexSize == Capacity) {
+                if (Capacity == 0) {
+                    Capacity = DWARF_INITIAL_ADDRESS_INDEX_CAPACITY;
+
+                } else {
+                    Capacity *= 2;
+                }
+
+                NewIndex = realloc(Context->AddressIndex,
+                                   Capacity * sizeof(DWARF_ADDRESS_RANGE));
+
+                if (NewIndex == NULL) {
+                    return ENOMEM;
+                }
+
+                Context->AddressIndex = NewIndex;
+            }
+
+            Range = &(Context->AddressIndex[Context->AddressIndexSize]);
+            Range->Start = Start;
+            Range->End = Start + Length;
+            Range->Unit = Unit;
+            Context->AddressIndexSize += 1;
+            Unit->Flags |= DWARF_UNIT_INDEXED;
+        }
+
+        Bytes = SetEnd;
     }
 
-    Status = 0;
+    if (Context->AddressIndexSize == 0) {
+        return 0;
+    }
 
-ProcessDebugInfoEnd:
-    Context->LoadingContext = NULL;
-    if (Unit != NULL) {
-        DwarfpDestroyCompilationUnit(Context, Unit);
+    qsort(Context->AddressIndex,
+          Context->AddressIndexSize,
+          sizeof(DWARF_ADDRESS_RANGE),
+          DwarfpCompareAddressRanges);
+
+    MaxEnd = 0;
+    for (Index = 0; Index < Context->AddressIndexSize; Index += 1) {
+        Range = &(Context->AddressIndex[Index]);
+        if (Range->End > MaxEnd) {
+            MaxEnd = Range->End;
+        }
+
+        Range->MaxEnd = MaxEnd;
+    }
+
+    return 0;
+}
+
+PDWARF_COMPILATION_UNIT
+DwarfpFindUnitAtOffset (
+    PDWARF_CONTEXT Context,
+    PLIST_ENTRY *Hint,
+    ULONGLONG Offset
+    )
+
+/*++
+
+Routine Description:
+
+    This routine finds the compilation unit whose header starts at the given
+    offset into the .debug_info section.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Hint - Supplies a pointer to the list entry to start searching from. On
+        output, this is set to the entry after the unit found. Lookups made in
+        unit order therefore each take a single step.
+
+    Offset - Supplies the .debug_info offset of the unit header.
+
+Return Value:
+
+    Returns a pointer to the compilation unit on success.
+
+    NULL if no unit starts at the given offset.
+
+--*/
+
+{
+
+    PLIST_ENTRY CurrentEntry;
+    PUCHAR InfoStart;
+    PLIST_ENTRY StartEntry;
+    PDWARF_COMPILATION_UNIT Unit;
+
+    InfoStart = Context->Sections.Info.Data;
+    StartEntry = *Hint;
+    CurrentEntry = StartEntry;
+    do {
+        if (CurrentEntry != &(Context->UnitList)) {
+            Unit = LIST_VALUE(CurrentEntry, DWARF_COMPILATION_UNIT, ListEntry);
+            if (Unit->Start - InfoStart == Offset) {
+                *Hint = CurrentEntry->Next;
+                return Unit;
+            }
+        }
+
+        CurrentEntry = CurrentEntry->Next;
+
+    } while (CurrentEntry != StartEntry);
+
+    return NULL;
+}
+
+int
+DwarfpCompareAddressRanges (
+    const void *LeftPointer,
+    const void *RightPointer
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compares two address ranges by their start address.
+
+Arguments:
+
+    LeftPointer - Supplies a pointer to the left address range.
+
+    RightPointer - Supplies a pointer to the right address range.
+
+Return Value:
+
+    -1 if Left < Right.
+
+    0 if Left == Right.
+
+    1 if Left > Right.
+
+--*/
+
+{
+
+    PDWARF_ADDRESS_RANGE Left;
+    PDWARF_ADDRESS_RANGE Right;
+
+    Left = (PDWARF_ADDRESS_RANGE)LeftPointer;
+    Right = (PDWARF_ADDRESS_RANGE)RightPointer;
+    if (Left->Start < Right->Start) {
+        return -1;
+    }
+
+    if (Left->Start > Right->Start) {
+        return 1;
     }
 
+    return 0;
+}
+
+INT
+DwarfpProcessUnitSymbols (
+    PDWARF_CONTEXT Context,
+    PDWARF_COMPILATION_UNIT Unit
+    )
+
+/*++
+
+Routine Description:
+
+    This routine turns a compilation unit into symbols if that hasn't been
+    done already.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Unit - Supplies a pointer to the compilation unit to process.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error number on failure.
+
+--*/
+
+{
+
+    PDWARF_DIE Die;
+    DWARF_LOADING_CONTEXT LoadState;
+    INT Status;
+
+    if ((Unit->Flags & DWARF_UNIT_PROCESSED) != 0) {
+        return 0;
+    }
+
+    //
+    // Mark the unit processed up front so that a unit that fails isn't tried
+    // again on every lookup.
+    //
+
+    Unit->Flags |= DWARF_UNIT_PROCESSED;
+
+    assert(Context->DeferredUnits != 0);
+
+    Context->DeferredUnits -= 1;
+    memset(&LoadState, 0, sizeof(DWARF_LOADING_CONTEXT));
+    Context->LoadingContext = &LoadState;
+    Status = DwarfpLoadCompilationUnit(Context, Unit);
+    if (Status != 0) {
+        goto ProcessUnitSymbolsEnd;
+    }
+
+    //
+    // Now visit the compilation unit now that the DIE tree has been formed.
+    //
+
+    Status = DwarfpProcessCompilationUnit(Context, Unit);
+    if (Status != 0) {
+        DWARF_ERROR("DWARF: Failed to process compilation unit.\n");
+        goto ProcessUnitSymbolsEnd;
+    }
+
+ProcessUnitSymbolsEnd:
+
+    //
+    // The DIE tree is only needed while the symbols are being created.
+    //
+
+    while (!LIST_EMPTY(&(Unit->DieList))) {
+        Die = LIST_VALUE(Unit->DieList.Next, DWARF_DIE, ListEntry);
+        LIST_REMOVE(&(Die->ListEntry));
+        Die->ListEntry.Next = NULL;
+        DwarfpDestroyDie(Context, Die);
+    }
+
+    Context->LoadingContext = NULL;
     return Status;
 }
 
+PVOID
+DwarfpMapFile (
+    PSTR Filename,
+    UINTN Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine maps a file into memory. The mapping is private and writable,
+    so it behaves just like a copy of the file read into memory.
+
+Arguments:
+
+    Filename - Supplies a pointer to the name of the file to map.
+
+    Size - Supplies the size of the file in bytes.
+
+Return Value:
+
+    Returns a pointer to the mapped file on success.
+
+    NULL if the file could not be mapped.
+
+--*/
+
+{
+
+#ifndef _WIN32
+
+    PVOID Data;
+    int Descriptor;
+
+    if (Size == 0) {
+        return NULL;
+    }
+
+    Descriptor = open(Filename, O_RDONLY);
+    if (Descriptor < 0) {
+        return NULL;
+    }
+
+    Data = mmap(NULL,
+                Size,
+                PROT_READ | PROT_WRITE,
+                MAP_PRIVATE,
+                Descriptor,
+                0);
+
+    close(Descriptor);
+    if (Data == MAP_FAILED) {
+        return NULL;
+    }
+
+    return Data;
+
+#else
+
+    return NULL;
+
+#endif
+
+}
+
+VOID
+DwarfpUnmapFile (
+    PVOID Data,
+    UINTN Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine unmaps a file mapped with DwarfpMapFile.
+
+Arguments:
+
+    Data - Supplies a pointer to the mapped file.
+
+    Size - Supplies the size of the mapping in bytes.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+#ifndef _WIN32
+
+    munmap(Data, Size);
+
+#endif
+
+    return;
+}
+
 INT
 DwarfpProcessCompilationUnit (
     PDWARF_CONTEXT Context,
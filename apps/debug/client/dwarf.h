@@ -63,6 +63,20 @@ Module Name:
 
 #define DWARF_CONTEXT_VERBOSE_UNWINDING 0x00000010
 
+//
+// Set this flag to process every compilation unit when the symbols are loaded
+// rather than waiting until something inside a unit is looked up.
+//
+
+#define DWARF_CONTEXT_LOAD_ALL 0x00000020
+
+//
+// This flag is set internally if the file data is mapped rather than
+// allocated.
+//
+
+#define DWARF_CONTEXT_FILE_MAPPED 0x80000000
+
 //
 // Define the maximum currently implemented depth of the stack. Bump this up if
 // applications seem to be heavily using the DWARF expression stack.
@@ -638,6 +652,33 @@ typedef struct _DWARF_DEBUG_SECTIONS {
 
 /*++
 
+Structure Description:
+
+    This structure describes a range of addresses covered by a compilation
+    unit, as gathered from the .debug_aranges section.
+
+Members:
+
+    Start - Stores the first address in the range.
+
+    End - Stores the first address after the range.
+
+    MaxEnd - Stores the largest end address of this range and every range
+        sorted before it, which bounds how far back a lookup has to search.
+
+    Unit - Stores a pointer to the compilation unit covering the range.
+
+--*/
+
+typedef struct _DWARF_ADDRESS_RANGE {
+    ULONGLONG Start;
+    ULONGLONG End;
+    ULONGLONG MaxEnd;
+    struct _DWARF_COMPILATION_UNIT *Unit;
+} DWARF_ADDRESS_RANGE, *PDWARF_ADDRESS_RANGE;
+
+/*++
+
 Structure Description:
 
     This structure contains the context for a DWARF symbol table.
@@ -660,6 +701,15 @@ Structure Description:
     LoadingContext - Stores a pointer to internal state used during the load of
         the module. This is of type DWARF_LOADING_CONTEXT.
 
+    AddressIndex - Stores an array of address ranges sorted by start address,
+        used to find the compilation unit covering an address without
+        processing every unit.
+
+    AddressIndexSize - Stores the number of elements in the address index.
+
+    DeferredUnits - Stores the number of compilation units that have not yet
+        been processed.
+
 --*/
 
 typedef struct _DWARF_CONTEXT {
@@ -670,6 +720,9 @@ typedef struct _DWARF_CONTEXT {
     LIST_ENTRY UnitList;
     PLIST_ENTRY SourcesHead;
     PVOID LoadingContext;
+    PDWARF_ADDRESS_RANGE AddressIndex;
+    ULONG AddressIndexSize;
+    ULONG DeferredUnits;
 } DWARF_CONTEXT, *PDWARF_CONTEXT;
 
 //
@@ -81,6 +81,19 @@ Module Name:
 
 #define DWARF_DIE_HAS_CHILDREN 0x00000001
 
+//
+// This flag is set once a compilation unit has been turned into symbols.
+//
+
+#define DWARF_UNIT_PROCESSED 0x00000001
+
+//
+// This flag is set if a compilation unit's addresses are in the address index,
+// allowing it to be processed on demand.
+//
+
+#define DWARF_UNIT_INDEXED 0x00000002
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -136,6 +149,8 @@ Structure Description:
     Ranges - Stores the ranges for the compilation unit if the compilation
         unit convers a non-contiguous region.
 
+    Flags - Stores a bitfield of flags. See DWARF_UNIT_* definitions.
+
 --*/
 
 struct _DWARF_COMPILATION_UNIT {
@@ -152,6 +167,7 @@ struct _DWARF_COMPILATION_UNIT {
     ULONGLONG LowPc;
     ULONGLONG HighPc;
     PVOID Ranges;
+    ULONG Flags;
 };
 
 /*++
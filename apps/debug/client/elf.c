@@ -97,6 +97,7 @@ DEBUG_SYMBOL_INTERFACE DbgElfSymbolInterface = {
     NULL,
     NULL,
     NULL,
+    NULL,
     NULL
 };
 
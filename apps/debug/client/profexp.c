@@ -0,0 +1,1857 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    profexp.c
+
+Abstract:
+
+    This module implements support for recording stack profiling samples and
+    exporting them to files that can be aggregated offline.
+
+Author:
+
+    agent 19-Oct-2026
+
+Environment:
+
+    Debug
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#define KERNEL_API
+
+#include "dbgrtl.h"
+#include <minoca/debug/spproto.h>
+#include <minoca/lib/im.h>
+#include <minoca/debug/dbgext.h>
+#include "symbols.h"
+#include "dbgapi.h"
+#include "dbgsym.h"
+#include "dbgrprof.h"
+#include "dbgprofp.h"
+#include "console.h"
+#include "dbgrcomm.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// Define the number of buckets in the string and location hash tables used
+// while exporting.
+//
+
+#define PROFILER_EXPORT_HASH_SIZE 4096
+
+//
+// Define the initial size of an export output buffer, in bytes.
+//
+
+#define PROFILER_EXPORT_INITIAL_BUFFER_SIZE 1024
+
+//
+// Define the maximum length of a symbolized frame name.
+//
+
+#define PROFILER_EXPORT_NAME_SIZE 1024
+
+//
+// Define the size of the buffer used to print process and thread IDs.
+//
+
+#define PROFILER_EXPORT_ID_SIZE 16
+
+//
+// Define protocol buffer wire types.
+//
+
+#define PROTOBUF_WIRE_VARINT 0
+#define PROTOBUF_WIRE_LENGTH_DELIMITED 2
+
+//
+// Define the field numbers of the pprof profile messages used by the export.
+//
+
+#define PPROF_PROFILE_SAMPLE_TYPE 1
+#define PPROF_PROFILE_SAMPLE 2
+#define PPROF_PROFILE_LOCATION 4
+#define PPROF_PROFILE_FUNCTION 5
+#define PPROF_PROFILE_STRING_TABLE 6
+#define PPROF_PROFILE_PERIOD_TYPE 11
+#define PPROF_PROFILE_PERIOD 12
+
+#define PPROF_VALUE_TYPE_TYPE 1
+#define PPROF_VALUE_TYPE_UNIT 2
+
+#define PPROF_SAMPLE_LOCATION_ID 1
+#define PPROF_SAMPLE_VALUE 2
+#define PPROF_SAMPLE_LABEL 3
+
+#define PPROF_LABEL_KEY 1
+#define PPROF_LABEL_STRING 2
+#define PPROF_LABEL_NUMBER 3
+
+#define PPROF_LOCATION_ID 1
+#define PPROF_LOCATION_ADDRESS 3
+#define PPROF_LOCATION_LINE 4
+
+#define PPROF_LINE_FUNCTION_ID 1
+#define PPROF_LINE_LINE 2
+
+#define PPROF_FUNCTION_ID 1
+#define PPROF_FUNCTION_NAME 2
+#define PPROF_FUNCTION_SYSTEM_NAME 3
+#define PPROF_FUNCTION_FILENAME 4
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+/*++
+
+Structure Description:
+
+    This structure defines a growable output buffer.
+
+Members:
+
+    Data - Stores a pointer to the buffer contents.
+
+    Size - Stores the number of valid bytes in the buffer.
+
+    Capacity - Stores the allocation size of the buffer, in bytes.
+
+    Failed - Stores a boolean indicating whether an allocation failed while
+        appending to the buffer, in which case its contents are incomplete.
+
+--*/
+
+typedef struct _PROFILER_EXPORT_BUFFER {
+    PBYTE Data;
+    ULONG Size;
+    ULONG Capacity;
+    BOOL Failed;
+} PROFILER_EXPORT_BUFFER, *PPROFILER_EXPORT_BUFFER;
+
+/*++
+
+Structure Description:
+
+    This structure defines a string in the export string table.
+
+Members:
+
+    Next - Stores a pointer to the next string in the same hash bucket.
+
+    Hash - Stores the hash of the string.
+
+    Index - Stores the index of the string in the pprof string table.
+
+    FunctionId - Stores the ID of the pprof function with this string as its
+        name, or 0 if no such function has been written yet.
+
+    String - Stores the null terminated string.
+
+--*/
+
+typedef struct _PROFILER_EXPORT_STRING {
+    struct _PROFILER_EXPORT_STRING *Next;
+    ULONG Hash;
+    ULONG Index;
+    ULONG FunctionId;
+    CHAR String[ANYSIZE_ARRAY];
+} PROFILER_EXPORT_STRING, *PPROFILER_EXPORT_STRING;
+
+/*++
+
+Structure Description:
+
+    This structure defines a symbolized call stack address.
+
+Members:
+
+    Next - Stores a pointer to the next location in the same hash bucket.
+
+    Address - Stores the call stack address.
+
+    Id - Stores the ID of the pprof location for this address.
+
+    Name - Stores a pointer to the symbolized name of the address, owned by
+        the string table.
+
+--*/
+
+typedef struct _PROFILER_EXPORT_LOCATION {
+    struct _PROFILER_EXPORT_LOCATION *Next;
+    ULONGLONG Address;
+    ULONG Id;
+    PSTR Name;
+} PROFILER_EXPORT_LOCATION, *PPROFILER_EXPORT_LOCATION;
+
+/*++
+
+Structure Description:
+
+    This structure defines the state of an export in progress.
+
+Members:
+
+    Context - Stores a pointer to the application context.
+
+    Format - Stores the format being written.
+
+    Strings - Stores the hash table of strings.
+
+    Locations - Stores the hash table of symbolized addresses.
+
+    StringCount - Stores the number of strings in the string table.
+
+    FunctionCount - Stores the number of pprof functions written.
+
+    LocationCount - Stores the number of locations created.
+
+    Samples - Stores the encoded pprof samples.
+
+    LocationBuffer - Stores the encoded pprof locations.
+
+    Functions - Stores the encoded pprof functions.
+
+    StringTable - Stores the encoded pprof string table.
+
+    Message - Stores a scratch buffer used to encode a single message.
+
+    Child - Stores a scratch buffer used to encode a message nested within
+        the scratch message.
+
+    Packed - Stores a scratch buffer used to encode packed repeated values.
+
+--*/
+
+typedef struct _PROFILER_EXPORT_STATE {
+    PDEBUGGER_CONTEXT Context;
+    PROFILER_EXPORT_FORMAT Format;
+    PPROFILER_EXPORT_STRING Strings[PROFILER_EXPORT_HASH_SIZE];
+    PPROFILER_EXPORT_LOCATION Locations[PROFILER_EXPORT_HASH_SIZE];
+    ULONG StringCount;
+    ULONG FunctionCount;
+    ULONG LocationCount;
+    PROFILER_EXPORT_BUFFER Samples;
+    PROFILER_EXPORT_BUFFER LocationBuffer;
+    PROFILER_EXPORT_BUFFER Functions;
+    PROFILER_EXPORT_BUFFER StringTable;
+    PROFILER_EXPORT_BUFFER Message;
+    PROFILER_EXPORT_BUFFER Child;
+    PROFILER_EXPORT_BUFFER Packed;
+} PROFILER_EXPORT_STATE, *PPROFILER_EXPORT_STATE;
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+INT
+DbgrpWriteFoldedSample (
+    PPROFILER_EXPORT_STATE State,
+    PPROFILER_STACK_SAMPLE Sample,
+    FILE *File
+    );
+
+VOID
+DbgrpWriteFoldedName (
+    FILE *File,
+    PSTR Name
+    );
+
+INT
+DbgrpWritePprofSample (
+    PPROFILER_EXPORT_STATE State,
+    PPROFILER_STACK_SAMPLE Sample
+    );
+
+VOID
+DbgrpWritePprofLabel (
+    PPROFILER_EXPORT_STATE State,
+    PPROFILER_EXPORT_STRING Key,
+    PPROFILER_EXPORT_STRING String,
+    ULONG Number
+    );
+
+INT
+DbgrpWritePprofProfile (
+    PPROFILER_EXPORT_STATE State,
+    FILE *File
+    );
+
+PPROFILER_EXPORT_LOCATION
+DbgrpGetExportLocation (
+    PPROFILER_EXPORT_STATE State,
+    ULONGLONG Address
+    );
+
+PPROFILER_EXPORT_STRING
+DbgrpGetExportString (
+    PPROFILER_EXPORT_STATE State,
+    PSTR String
+    );
+
+VOID
+DbgrpDestroyExportState (
+    PPROFILER_EXPORT_STATE State
+    );
+
+ULONG
+DbgrpHashStackSample (
+    ULONG ProcessId,
+    ULONG ThreadId,
+    PULONGLONG Frames,
+    ULONG FrameCount
+    );
+
+ULONG
+DbgrpHashExportData (
+    ULONG Hash,
+    PVOID Data,
+    ULONG Size
+    );
+
+VOID
+DbgrpExportBufferAppend (
+    PPROFILER_EXPORT_BUFFER Buffer,
+    PVOID Data,
+    ULONG Size
+    );
+
+VOID
+DbgrpExportBufferWriteVarint (
+    PPROFILER_EXPORT_BUFFER Buffer,
+    ULONGLONG Value
+    );
+
+VOID
+DbgrpExportBufferWriteInteger (
+    PPROFILER_EXPORT_BUFFER Buffer,
+    ULONG Field,
+    ULONGLONG Value
+    );
+
+VOID
+DbgrpExportBufferWriteBytes (
+    PPROFILER_EXPORT_BUFFER Buffer,
+    ULONG Field,
+    PVOID Data,
+    ULONG Size
+    );
+
+VOID
+DbgrpExportBufferWriteMessage (
+    PPROFILER_EXPORT_BUFFER Buffer,
+    ULONG Field,
+    PPROFILER_EXPORT_BUFFER Message
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+INT
+DbgrProfilerCapture (
+    PDEBUGGER_CONTEXT Context,
+    ULONG Seconds,
+    PROFILER_EXPORT_FORMAT Format,
+    PSTR Path
+    )
+
+/*++
+
+Routine Description:
+
+    This routine collects profiling data from a running target for the given
+    amount of time without user interaction, and then exports the stack
+    samples to a file.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Seconds - Supplies the number of seconds to collect data for.
+
+    Format - Supplies the format to export the stack samples in.
+
+    Path - Supplies the path of the file to write the samples to.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error code on failure.
+
+--*/
+
+{
+
+    BOOL Done;
+    INT Result;
+    time_t StartTime;
+
+    if ((Context->TargetFlags & DEBUGGER_TARGET_RUNNING) == 0) {
+        DbgOut("Error: The target must be running to capture profiling "
+               "data.\n");
+
+        return EINVAL;
+    }
+
+    //
+    // The time is only checked between events, but a target with profiling
+    // enabled sends data at least once a second.
+    //
+
+    DbgOut("Capturing profiling data for %d seconds.\n", Seconds);
+    Done = FALSE;
+    StartTime = time(NULL);
+    while ((Done == FALSE) && ((ULONG)(time(NULL) - StartTime) < Seconds)) {
+        Result = DbgWaitForEvent(Context);
+        if (Result != 0) {
+            DbgOut("Error: Failed to get next debugging event.\n");
+            return Result;
+        }
+
+        switch (Context->CurrentEvent.Type) {
+        case DebuggerEventProfiler:
+            DbgrProcessProfilerNotification(Context);
+            break;
+
+        case DebuggerEventBreak:
+            DbgOut("Target broke in, ending the capture early.\n");
+            Done = TRUE;
+            break;
+
+        case DebuggerEventShutdown:
+            DbgOut("Target shut down, ending the capture early.\n");
+            Done = TRUE;
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    return DbgrpExportStackSamples(Context, Format, Path);
+}
+
+INT
+DbgrpInitializeStackSamples (
+    PDEBUGGER_CONTEXT Context
+    )
+
+/*++
+
+Routine Description:
+
+    This routine initializes support for recording and exporting stack
+    samples.
+
+Arguments:
+
+    Context - Supplies a pointer to the debugger context.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error code on failure.
+
+--*/
+
+{
+
+    Context->ProfilingData.SampleLock = CreateDebuggerLock();
+    if (Context->ProfilingData.SampleLock == NULL) {
+        return ENOMEM;
+    }
+
+    Context->ProfilingData.SampleTable = NULL;
+    Context->ProfilingData.SampleCount = 0;
+    return 0;
+}
+
+VOID
+DbgrpDestroyStackSamples (
+    PDEBUGGER_CONTEXT Context
+    )
+
+/*++
+
+Routine Description:
+
+    This routine destroys any structures used to record stack samples.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if (Context->ProfilingData.SampleLock != NULL) {
+        DbgrpClearStackSamples(Context);
+        DestroyDebuggerLock(Context->ProfilingData.SampleLock);
+        Context->ProfilingData.SampleLock = NULL;
+    }
+
+    return;
+}
+
+INT
+DbgrpRecordStackSample (
+    PDEBUGGER_CONTEXT Context,
+    ULONG ProcessId,
+    ULONG ThreadId,
+    PULONGLONG Frames,
+    ULONG FrameCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine records a single stack sample for later export.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    ProcessId - Supplies the ID of the process the sample was taken in.
+
+    ThreadId - Supplies the ID of the thread the sample was taken in.
+
+    Frames - Supplies the call stack addresses, innermost frame first.
+
+    FrameCount - Supplies the number of elements in the frames array.
+
+Return Value:
+
+    0 on success.
+
+    ENOMEM on allocation failure.
+
+--*/
+
+{
+
+    ULONG AllocationSize;
+    ULONG Bucket;
+    ULONG Hash;
+    PDEBUGGER_PROFILING_DATA ProfilingData;
+    INT Result;
+    PPROFILER_STACK_SAMPLE Sample;
+
+    ProfilingData = &(Context->ProfilingData);
+    Hash = DbgrpHashStackSample(ProcessId, ThreadId, Frames, FrameCount);
+    Bucket = Hash % PROFILER_STACK_SAMPLE_HASH_SIZE;
+    AcquireDebuggerLock(ProfilingData->SampleLock);
+    if (ProfilingData->SampleTable == NULL) {
+        ProfilingData->SampleTable = calloc(PROFILER_STACK_SAMPLE_HASH_SIZE,
+                                            sizeof(PPROFILER_STACK_SAMPLE));
+
+        if (ProfilingData->SampleTable == NULL) {
+            Result = ENOMEM;
+            goto RecordStackSampleEnd;
+        }
+    }
+
+    //
+    // Count the sample against an identical stack from the same thread if
+    // one has been seen before.
+    //
+
+    Sample = ProfilingData->SampleTable[Bucket];
+    while (Sample != NULL) {
+        if ((Sample->Hash == Hash) &&
+            (Sample->ProcessId == ProcessId) &&
+            (Sample->ThreadId == ThreadId) &&
+            (Sample->FrameCount == FrameCount) &&
+            (memcmp(Sample->Frames,
+                    Frames,
+                    FrameCount * sizeof(ULONGLONG)) == 0)) {
+
+            Sample->Count += 1;
+            Result = 0;
+            goto RecordStackSampleEnd;
+        }
+
+        Sample = Sample->Next;
+    }
+
+    AllocationSize = FIELD_OFFSET(PROFILER_STACK_SAMPLE, Frames) +
+                     (FrameCount * sizeof(ULONGLONG));
+
+    Sample = malloc(AllocationSize);
+    if (Sample == NULL) {
+        Result = ENOMEM;
+        goto RecordStackSampleEnd;
+    }
+
+    Sample->Hash = Hash;
+    Sample->ProcessId = ProcessId;
+    Sample->ThreadId = ThreadId;
+    Sample->Count = 1;
+    Sample->FrameCount = FrameCount;
+    RtlCopyMemory(Sample->Frames, Frames, FrameCount * sizeof(ULONGLONG));
+    Sample->Next = ProfilingData->SampleTable[Bucket];
+    ProfilingData->SampleTable[Bucket] = Sample;
+    ProfilingData->SampleCount += 1;
+    Result = 0;
+
+RecordStackSampleEnd:
+    ReleaseDebuggerLock(ProfilingData->SampleLock);
+    return Result;
+}
+
+VOID
+DbgrpClearStackSamples (
+    PDEBUGGER_CONTEXT Context
+    )
+
+/*++
+
+Routine Description:
+
+    This routine deletes all recorded stack samples.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Bucket;
+    PDEBUGGER_PROFILING_DATA ProfilingData;
+    PPROFILER_STACK_SAMPLE Sample;
+
+    ProfilingData = &(Context->ProfilingData);
+    AcquireDebuggerLock(ProfilingData->SampleLock);
+    if (ProfilingData->SampleTable != NULL) {
+        for (Bucket = 0;
+             Bucket < PROFILER_STACK_SAMPLE_HASH_SIZE;
+             Bucket += 1) {
+
+            while (ProfilingData->SampleTable[Bucket] != NULL) {
+                Sample = ProfilingData->SampleTable[Bucket];
+                ProfilingData->SampleTable[Bucket] = Sample->Next;
+                free(Sample);
+            }
+        }
+
+        free(ProfilingData->SampleTable);
+        ProfilingData->SampleTable = NULL;
+    }
+
+    ProfilingData->SampleCount = 0;
+    ReleaseDebuggerLock(ProfilingData->SampleLock);
+    return;
+}
+
+INT
+DbgrpExportStackSamples (
+    PDEBUGGER_CONTEXT Context,
+    PROFILER_EXPORT_FORMAT Format,
+    PSTR Path
+    )
+
+/*++
+
+Routine Description:
+
+    This routine writes all recorded stack samples out to a file, symbolized
+    and attributed to their process and thread.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Format - Supplies the format to write the samples in.
+
+    Path - Supplies the path of the file to create.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error code on failure.
+
+--*/
+
+{
+
+    ULONG Bucket;
+    FILE *File;
+    PDEBUGGER_PROFILING_DATA ProfilingData;
+    INT Result;
+    PPROFILER_STACK_SAMPLE Sample;
+    ULONGLONG SampleTotal;
+    PPROFILER_EXPORT_STATE State;
+
+    assert((Format == ProfilerExportFolded) || (Format == ProfilerExportPprof));
+
+    File = NULL;
+    ProfilingData = &(Context->ProfilingData);
+    SampleTotal = 0;
+
+    //
+    // Pull in any stack data that has arrived but not yet been parsed, and
+    // any thread names that go with it.
+    //
+
+    DbgrGetProfilerStackData(&(ProfilingData->CommandLineStackRoot));
+    DbgrpFullyProcessThreadProfilingData(Context);
+    State = malloc(sizeof(PROFILER_EXPORT_STATE));
+    if (State == NULL) {
+        return ENOMEM;
+    }
+
+    memset(State, 0, sizeof(PROFILER_EXPORT_STATE));
+    State->Context = Context;
+    State->Format = Format;
+    if (Format == ProfilerExportFolded) {
+        File = fopen(Path, "w");
+
+    } else {
+        File = fopen(Path, "wb");
+    }
+
+    if (File == NULL) {
+        Result = errno;
+        DbgOut("Error: Failed to open %s: %s.\n", Path, strerror(Result));
+        DbgrpDestroyExportState(State);
+        return Result;
+    }
+
+    //
+    // The first entry in a pprof string table is always the empty string.
+    //
+
+    if (Format == ProfilerExportPprof) {
+        if (DbgrpGetExportString(State, "") == NULL) {
+            Result = ENOMEM;
+            goto ExportStackSamplesEnd;
+        }
+    }
+
+    AcquireDebuggerLock(ProfilingData->SampleLock);
+    Result = 0;
+    if (ProfilingData->SampleTable != NULL) {
+        for (Bucket = 0;
+             Bucket < PROFILER_STACK_SAMPLE_HASH_SIZE;
+             Bucket += 1) {
+
+            Sample = ProfilingData->SampleTable[Bucket];
+            while (Sample != NULL) {
+                if (Format == ProfilerExportFolded) {
+                    Result = DbgrpWriteFoldedSample(State, Sample, File);
+
+                } else {
+                    Result = DbgrpWritePprofSample(State, Sample);
+                }
+
+                if (Result != 0) {
+                    break;
+                }
+
+                SampleTotal += Sample->Count;
+                Sample = Sample->Next;
+            }
+
+            if (Result != 0) {
+                break;
+            }
+        }
+    }
+
+    ReleaseDebuggerLock(ProfilingData->SampleLock);
+    if (Result != 0) {
+        goto ExportStackSamplesEnd;
+    }
+
+    if (Format == ProfilerExportPprof) {
+        Result = DbgrpWritePprofProfile(State, File);
+        if (Result != 0) {
+            goto ExportStackSamplesEnd;
+        }
+    }
+
+    DbgOut("Wrote %I64d samples of %d unique stacks to %s.\n",
+           SampleTotal,
+           ProfilingData->SampleCount,
+           Path);
+
+ExportStackSamplesEnd:
+    if (File != NULL) {
+        if ((fclose(File) != 0) && (Result == 0)) {
+            Result = errno;
+        }
+    }
+
+    if (Result != 0) {
+        DbgOut("Error: Failed to export stack samples: %s.\n",
+               strerror(Result));
+    }
+
+    DbgrpDestroyExportState(State);
+    return Result;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+INT
+DbgrpWriteFoldedSample (
+    PPROFILER_EXPORT_STATE State,
+    PPROFILER_STACK_SAMPLE Sample,
+    FILE *File
+    )
+
+/*++
+
+Routine Description:
+
+    This routine writes a stack sample as a single line of folded stack output.
+    The line lists the process, thread, and then each frame from the outermost
+    inward, separated by semicolons, followed by the sample count.
+
+Arguments:
+
+    State - Supplies a pointer to the export state.
+
+    Sample - Supplies a pointer to the sample to write.
+
+    File - Supplies the file to write to.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error code on failure.
+
+--*/
+
+{
+
+    ULONG Index;
+    PPROFILER_EXPORT_LOCATION Location;
+    PSTR Name;
+    CHAR NumericBuffer[PROFILER_EXPORT_ID_SIZE];
+
+    Name = DbgpGetProcessName(State->Context,
+                              Sample->ProcessId,
+                              NumericBuffer,
+                              sizeof(NumericBuffer));
+
+    DbgrpWriteFoldedName(File, Name);
+    if (Name != NumericBuffer) {
+        fprintf(File, " (%d)", Sample->ProcessId);
+    }
+
+    Name = DbgrpGetThreadName(State->Context,
+                              Sample->ThreadId,
+                              NumericBuffer,
+                              sizeof(NumericBuffer));
+
+    fputc(';', File);
+    DbgrpWriteFoldedName(File, Name);
+    if (Name != NumericBuffer) {
+        fprintf(File, " (%d)", Sample->ThreadId);
+    }
+
+    for (Index = Sample->FrameCount; Index > 0; Index -= 1) {
+        Location = DbgrpGetExportLocation(State, Sample->Frames[Index - 1]);
+        if (Location == NULL) {
+            return ENOMEM;
+        }
+
+        fputc(';', File);
+        DbgrpWriteFoldedName(File, Location->Name);
+    }
+
+    if (fprintf(File, " %d\n", Sample->Count) < 0) {
+        return errno;
+    }
+
+    return 0;
+}
+
+VOID
+DbgrpWriteFoldedName (
+    FILE *File,
+    PSTR Name
+    )
+
+/*++
+
+Routine Description:
+
+    This routine writes a single name into folded stack output, replacing any
+    characters that would be mistaken for separators.
+
+Arguments:
+
+    File - Supplies the file to write to.
+
+    Name - Supplies a pointer to the name to write.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    CHAR Character;
+
+    while (*Name != '\0') {
+        Character = *Name;
+        if (Character == ';') {
+            Character = ':';
+
+        } else if ((Character == '\n') || (Character == '\r')) {
+            Character = ' ';
+        }
+
+        fputc(Character, File);
+        Name += 1;
+    }
+
+    return;
+}
+
+INT
+DbgrpWritePprofSample (
+    PPROFILER_EXPORT_STATE State,
+    PPROFILER_STACK_SAMPLE Sample
+    )
+
+/*++
+
+Routine Description:
+
+    This routine encodes a stack sample as a pprof sample message, labeled with
+    its process and thread.
+
+Arguments:
+
+    State - Supplies a pointer to the export state.
+
+    Sample - Supplies a pointer to the sample to write.
+
+Return Value:
+
+    0 on success.
+
+    ENOMEM on allocation failure.
+
+--*/
+
+{
+
+    ULONG Index;
+    PPROFILER_EXPORT_LOCATION Location;
+    PSTR Name;
+    CHAR NumericBuffer[PROFILER_EXPORT_ID_SIZE];
+    PPROFILER_EXPORT_STRING ProcessId;
+    PPROFILER_EXPORT_STRING ProcessKey;
+    PPROFILER_EXPORT_STRING ProcessName;
+    PPROFILER_EXPORT_STRING ThreadId;
+    PPROFILER_EXPORT_STRING ThreadKey;
+    PPROFILER_EXPORT_STRING ThreadName;
+
+    //
+    // Resolve everything the sample refers to first, as doing so may write
+    // new locations, functions, and strings using the scratch buffers.
+    //
+
+    State->Packed.Size = 0;
+    for (Index = 0; Index < Sample->FrameCount; Index += 1) {
+        Location = DbgrpGetExportLocation(State, Sample->Frames[Index]);
+        if (Location == NULL) {
+            return ENOMEM;
+        }
+
+        DbgrpExportBufferWriteVarint(&(State->Packed), Location->Id);
+    }
+
+    Name = DbgpGetProcessName(State->Context,
+                              Sample->ProcessId,
+                              NumericBuffer,
+                              sizeof(NumericBuffer));
+
+    ProcessName = DbgrpGetExportString(State, Name);
+    Name = DbgrpGetThreadName(State->Context,
+                              Sample->ThreadId,
+                              NumericBuffer,
+                              sizeof(NumericBuffer));
+
+    ThreadName = DbgrpGetExportString(State, Name);
+    ProcessId = DbgrpGetExportString(State, "pid");
+    ProcessKey = DbgrpGetExportString(State, "process");
+    ThreadId = DbgrpGetExportString(State, "tid");
+    ThreadKey = DbgrpGetExportString(State, "thread");
+    if ((ProcessName == NULL) || (ThreadName == NULL) ||
+        (ProcessId == NULL) || (ProcessKey == NULL) ||
+        (ThreadId == NULL) || (ThreadKey == NULL)) {
+
+        return ENOMEM;
+    }
+
+    State->Message.Size = 0;
+    DbgrpExportBufferWriteMessage(&(State->Message),
+                                  PPROF_SAMPLE_LOCATION_ID,
+                                  &(State->Packed));
+
+    State->Packed.Size = 0;
+    DbgrpExportBufferWriteVarint(&(State->Packed), Sample->Count);
+    DbgrpExportBufferWriteMessage(&(State->Message),
+                                  PPROF_SAMPLE_VALUE,
+                                  &(State->Packed));
+
+    DbgrpWritePprofLabel(State, ProcessId, NULL, Sample->ProcessId);
+    DbgrpWritePprofLabel(State, ProcessKey, ProcessName, 0);
+    DbgrpWritePprofLabel(State, ThreadId, NULL, Sample->ThreadId);
+    DbgrpWritePprofLabel(State, ThreadKey, ThreadName, 0);
+    DbgrpExportBufferWriteMessage(&(State->Samples),
+                                  PPROF_PROFILE_SAMPLE,
+                                  &(State->Message));
+
+    if ((State->Message.Failed != FALSE) || (State->Samples.Failed != FALSE)) {
+        return ENOMEM;
+    }
+
+    return 0;
+}
+
+VOID
+DbgrpWritePprofLabel (
+    PPROFILER_EXPORT_STATE State,
+    PPROFILER_EXPORT_STRING Key,
+    PPROFILER_EXPORT_STRING String,
+    ULONG Number
+    )
+
+/*++
+
+Routine Description:
+
+    This routine encodes a pprof label into the sample message being built.
+
+Arguments:
+
+    State - Supplies a pointer to the export state.
+
+    Key - Supplies a pointer to the label name.
+
+    String - Supplies an optional pointer to the label's string value. If
+        this is NULL, the label has a numeric value.
+
+    Number - Supplies the label's numeric value if no string is supplied.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    State->Child.Size = 0;
+    DbgrpExportBufferWriteInteger(&(State->Child), PPROF_LABEL_KEY, Key->Index);
+    if (String != NULL) {
+        DbgrpExportBufferWriteInteger(&(State->Child),
+                                      PPROF_LABEL_STRING,
+                                      String->Index);
+
+    } else {
+        DbgrpExportBufferWriteInteger(&(State->Child),
+                                      PPROF_LABEL_NUMBER,
+                                      Number);
+    }
+
+    DbgrpExportBufferWriteMessage(&(State->Message),
+                                  PPROF_SAMPLE_LABEL,
+                                  &(State->Child));
+
+    return;
+}
+
+INT
+DbgrpWritePprofProfile (
+    PPROFILER_EXPORT_STATE State,
+    FILE *File
+    )
+
+/*++
+
+Routine Description:
+
+    This routine completes a pprof profile and writes it out to a file. The
+    profile is written uncompressed, which the pprof tool accepts.
+
+Arguments:
+
+    State - Supplies a pointer to the export state, whose samples have all
+        been encoded.
+
+    File - Supplies the file to write to.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error code on failure.
+
+--*/
+
+{
+
+    PPROFILER_EXPORT_BUFFER Buffers[5];
+    PPROFILER_EXPORT_STRING Count;
+    PROFILER_EXPORT_BUFFER Header;
+    ULONG Index;
+    INT Result;
+    PPROFILER_EXPORT_STRING Samples;
+
+    memset(&Header, 0, sizeof(PROFILER_EXPORT_BUFFER));
+    Samples = DbgrpGetExportString(State, "samples");
+    Count = DbgrpGetExportString(State, "count");
+    if ((Samples == NULL) || (Count == NULL)) {
+        return ENOMEM;
+    }
+
+    //
+    // Each sample has a single value, the number of times it was seen. The
+    // period is one sample.
+    //
+
+    State->Child.Size = 0;
+    DbgrpExportBufferWriteInteger(&(State->Child),
+                                  PPROF_VALUE_TYPE_TYPE,
+                                  Samples->Index);
+
+    DbgrpExportBufferWriteInteger(&(State->Child),
+                                  PPROF_VALUE_TYPE_UNIT,
+                                  Count->Index);
+
+    DbgrpExportBufferWriteMessage(&Header,
+                                  PPROF_PROFILE_SAMPLE_TYPE,
+                                  &(State->Child));
+
+    DbgrpExportBufferWriteMessage(&Header,
+                                  PPROF_PROFILE_PERIOD_TYPE,
+                                  &(State->Child));
+
+    DbgrpExportBufferWriteInteger(&Header, PPROF_PROFILE_PERIOD, 1);
+
+    //
+    // Repeated fields may appear in any order in the encoded message, so each
+    // kind was collected in its own buffer and is just concatenated here.
+    //
+
+    Buffers[0] = &Header;
+    Buffers[1] = &(State->Samples);
+    Buffers[2] = &(State->LocationBuffer);
+    Buffers[3] = &(State->Functions);
+    Buffers[4] = &(State->StringTable);
+    Result = 0;
+    for (Index = 0; Index < sizeof(Buffers) / sizeof(Buffers[0]); Index += 1) {
+        if ((Buffers[Index]->Failed != FALSE) ||
+            (State->Child.Failed != FALSE)) {
+
+            Result = ENOMEM;
+            break;
+        }
+
+        if (Buffers[Index]->Size == 0) {
+            continue;
+        }
+
+        if (fwrite(Buffers[Index]->Data, 1, Buffers[Index]->Size, File) !=
+            Buffers[Index]->Size) {
+
+            Result = errno;
+            break;
+        }
+    }
+
+    if (Header.Data != NULL) {
+        free(Header.Data);
+    }
+
+    return Result;
+}
+
+PPROFILER_EXPORT_LOCATION
+DbgrpGetExportLocation (
+    PPROFILER_EXPORT_STATE State,
+    ULONGLONG Address
+    )
+
+/*++
+
+Routine Description:
+
+    This routine finds or creates the symbolized location for a call stack
+    address. When writing pprof output, newly created locations and functions
+    are encoded as well.
+
+Arguments:
+
+    State - Supplies a pointer to the export state.
+
+    Address - Supplies the call stack address.
+
+Return Value:
+
+    Returns a pointer to the location on success.
+
+    NULL on allocation failure.
+
+--*/
+
+{
+
+    ULONG Bucket;
+    ULONGLONG DebasedAddress;
+    PSTR FileName;
+    PPROFILER_EXPORT_STRING FileString;
+    PFUNCTION_SYMBOL Function;
+    PSOURCE_LINE_SYMBOL Line;
+    PPROFILER_EXPORT_LOCATION Location;
+    PDEBUGGER_MODULE Module;
+    CHAR Name[PROFILER_EXPORT_NAME_SIZE];
+    PPROFILER_EXPORT_STRING NameString;
+    PSYMBOL_SEARCH_RESULT ResultValid;
+    SYMBOL_SEARCH_RESULT SearchResult;
+
+    Bucket = DbgrpHashExportData(0, &Address, sizeof(ULONGLONG)) %
+             PROFILER_EXPORT_HASH_SIZE;
+
+    Location = State->Locations[Bucket];
+    while (Location != NULL) {
+        if (Location->Address == Address) {
+            return Location;
+        }
+
+        Location = Location->Next;
+    }
+
+    //
+    // Symbolize the address as the function containing it, leaving off the
+    // offset so that all samples within a function aggregate together.
+    //
+
+    Line = NULL;
+    Module = DbgpFindModuleFromAddress(State->Context,
+                                       Address,
+                                       &DebasedAddress);
+
+    if (Module == NULL) {
+        snprintf(Name, sizeof(Name), "0x%llx", Address);
+
+    } else {
+        ResultValid = NULL;
+        SearchResult.Variety = SymbolResultInvalid;
+        if (Module->Symbols != NULL) {
+            ResultValid = DbgLookupSymbol(Module->Symbols,
+                                          DebasedAddress,
+                                          &SearchResult);
+        }
+
+        if ((ResultValid != NULL) &&
+            (SearchResult.Variety == SymbolResultFunction) &&
+            (SearchResult.U.FunctionResult->Name != NULL)) {
+
+            Function = SearchResult.U.FunctionResult;
+            snprintf(Name,
+                     sizeof(Name),
+                     "%s!%s",
+                     Module->ModuleName,
+                     Function->Name);
+
+            if (State->Format == ProfilerExportPprof) {
+                Line = DbgLookupSourceLine(Module->Symbols, DebasedAddress);
+            }
+
+        } else {
+            snprintf(Name,
+                     sizeof(Name),
+                     "%s!0x%llx",
+                     Module->ModuleName,
+                     DebasedAddress);
+        }
+    }
+
+    NameString = DbgrpGetExportString(State, Name);
+    if (NameString == NULL) {
+        return NULL;
+    }
+
+    Location = malloc(sizeof(PROFILER_EXPORT_LOCATION));
+    if (Location == NULL) {
+        return NULL;
+    }
+
+    State->LocationCount += 1;
+    Location->Address = Address;
+    Location->Id = State->LocationCount;
+    Location->Name = NameString->String;
+    Location->Next = State->Locations[Bucket];
+    State->Locations[Bucket] = Location;
+    if (State->Format != ProfilerExportPprof) {
+        return Location;
+    }
+
+    //
+    // Write out the function the first time its name is seen.
+    //
+
+    if (NameString->FunctionId == 0) {
+        FileString = NULL;
+        if (Line != NULL) {
+            FileName = Line->ParentSource->SourceFile;
+            if (FileName != NULL) {
+                FileString = DbgrpGetExportString(State, FileName);
+                if (FileString == NULL) {
+                    return NULL;
+                }
+            }
+        }
+
+        State->FunctionCount += 1;
+        NameString->FunctionId = State->FunctionCount;
+        State->Child.Size = 0;
+        DbgrpExportBufferWriteInteger(&(State->Child),
+                                      PPROF_FUNCTION_ID,
+                                      NameString->FunctionId);
+
+        DbgrpExportBufferWriteInteger(&(State->Child),
+                                      PPROF_FUNCTION_NAME,
+                                      NameString->Index);
+
+        DbgrpExportBufferWriteInteger(&(State->Child),
+                                      PPROF_FUNCTION_SYSTEM_NAME,
+                                      NameString->Index);
+
+        if (FileString != NULL) {
+            DbgrpExportBufferWriteInteger(&(State->Child),
+                                          PPROF_FUNCTION_FILENAME,
+                                          FileString->Index);
+        }
+
+        DbgrpExportBufferWriteMessage(&(State->Functions),
+                                      PPROF_PROFILE_FUNCTION,
+                                      &(State->Child));
+    }
+
+    State->Child.Size = 0;
+    DbgrpExportBufferWriteInteger(&(State->Child),
+                                  PPROF_LINE_FUNCTION_ID,
+                                  NameString->FunctionId);
+
+    if (Line != NULL) {
+        DbgrpExportBufferWriteInteger(&(State->Child),
+                                      PPROF_LINE_LINE,
+                                      Line->LineNumber);
+    }
+
+    State->Message.Size = 0;
+    DbgrpExportBufferWriteInteger(&(State->Message),
+                                  PPROF_LOCATION_ID,
+                                  Location->Id);
+
+    DbgrpExportBufferWriteInteger(&(State->Message),
+                                  PPROF_LOCATION_ADDRESS,
+                                  Address);
+
+    DbgrpExportBufferWriteMessage(&(State->Message),
+                                  PPROF_LOCATION_LINE,
+                                  &(State->Child));
+
+    DbgrpExportBufferWriteMessage(&(State->LocationBuffer),
+                                  PPROF_PROFILE_LOCATION,
+                                  &(State->Message));
+
+    return Location;
+}
+
+PPROFILER_EXPORT_STRING
+DbgrpGetExportString (
+    PPROFILER_EXPORT_STATE State,
+    PSTR String
+    )
+
+/*++
+
+Routine Description:
+
+    This routine finds or adds a string in the export string table. When
+    writing pprof output, new strings are encoded into the string table.
+
+Arguments:
+
+    State - Supplies a pointer to the export state.
+
+    String - Supplies a pointer to the string to look up.
+
+Return Value:
+
+    Returns a pointer to the string table entry on success.
+
+    NULL on allocation failure.
+
+--*/
+
+{
+
+    ULONG Bucket;
+    PPROFILER_EXPORT_STRING Entry;
+    ULONG Hash;
+    ULONG Length;
+
+    Length = strlen(String);
+    Hash = DbgrpHashExportData(0, String, Length);
+    Bucket = Hash % PROFILER_EXPORT_HASH_SIZE;
+    Entry = State->Strings[Bucket];
+    while (Entry != NULL) {
+        if ((Entry->Hash == Hash) && (strcmp(Entry->String, String) == 0)) {
+            return Entry;
+        }
+
+        Entry = Entry->Next;
+    }
+
+    Entry = malloc(sizeof(PROFILER_EXPORT_STRING) + Length);
+    if (Entry == NULL) {
+        return NULL;
+    }
+
+    Entry->Hash = Hash;
+    Entry->Index = State->StringCount;
+    Entry->FunctionId = 0;
+    RtlCopyMemory(Entry->String, String, Length + 1);
+    Entry->Next = State->Strings[Bucket];
+    State->Strings[Bucket] = Entry;
+    State->StringCount += 1;
+    if (State->Format == ProfilerExportPprof) {
+        DbgrpExportBufferWriteBytes(&(State->StringTable),
+                                    PPROF_PROFILE_STRING_TABLE,
+                                    String,
+                                    Length);
+    }
+
+    return Entry;
+}
+
+VOID
+DbgrpDestroyExportState (
+    PPROFILER_EXPORT_STATE State
+    )
+
+/*++
+
+Routine Description:
+
+    This routine destroys an export state structure.
+
+Arguments:
+
+    State - Supplies a pointer to the export state to destroy.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PPROFILER_EXPORT_BUFFER Buffers[7];
+    ULONG Index;
+    PPROFILER_EXPORT_LOCATION Location;
+    PPROFILER_EXPORT_STRING String;
+
+    for (Index = 0; Index < PROFILER_EXPORT_HASH_SIZE; Index += 1) {
+        while (State->Strings[Index] != NULL) {
+            String = State->Strings[Index];
+            State->Strings[Index] = String->Next;
+            free(String);
+        }
+
+        while (State->Locations[Index] != NULL) {
+            Location = State->Locations[Index];
+            State->Locations[Index] = Location->Next;
+            free(Location);
+        }
+    }
+
+    Buffers[0] = &(State->Samples);
+    Buffers[1] = &(State->LocationBuffer);
+    Buffers[2] = &(State->Functions);
+    Buffers[3] = &(State->StringTable);
+    Buffers[4] = &(State->Message);
+    Buffers[5] = &(State->Child);
+    Buffers[6] = &(State->Packed);
+    for (Index = 0; Index < sizeof(Buffers) / sizeof(Buffers[0]); Index += 1) {
+        if (Buffers[Index]->Data != NULL) {
+            free(Buffers[Index]->Data);
+        }
+    }
+
+    free(State);
+    return;
+}
+
+ULONG
+DbgrpHashStackSample (
+    ULONG ProcessId,
+    ULONG ThreadId,
+    PULONGLONG Frames,
+    ULONG FrameCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine computes the hash of a stack sample.
+
+Arguments:
+
+    ProcessId - Supplies the ID of the process the sample was taken in.
+
+    ThreadId - Supplies the ID of the thread the sample was taken in.
+
+    Frames - Supplies the call stack addresses.
+
+    FrameCount - Supplies the number of elements in the frames array.
+
+Return Value:
+
+    Returns the hash of the sample.
+
+--*/
+
+{
+
+    ULONG Hash;
+
+    Hash = DbgrpHashExportData(0, &ProcessId, sizeof(ULONG));
+    Hash = DbgrpHashExportData(Hash, &ThreadId, sizeof(ULONG));
+    Hash = DbgrpHashExportData(Hash,
+                               Frames,
+                               FrameCount * sizeof(ULONGLONG));
+
+    return Hash;
+}
+
+ULONG
+DbgrpHashExportData (
+    ULONG Hash,
+    PVOID Data,
+    ULONG Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine adds a region of data to an FNV-1a hash.
+
+Arguments:
+
+    Hash - Supplies the hash so far, or 0 to start a new hash.
+
+    Data - Supplies a pointer to the data to hash.
+
+    Size - Supplies the size of the data in bytes.
+
+Return Value:
+
+    Returns the updated hash.
+
+--*/
+
+{
+
+    PBYTE Bytes;
+    ULONG Index;
+
+    if (Hash == 0) {
+        Hash = 2166136261U;
+    }
+
+    Bytes = Data;
+    for (Index = 0; Index < Size; Index += 1) {
+        Hash ^= Bytes[Index];
+        Hash *= 16777619U;
+    }
+
+    return Hash;
+}
+
+VOID
+DbgrpExportBufferAppend (
+    PPROFILER_EXPORT_BUFFER Buffer,
+    PVOID Data,
+    ULONG Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine appends data to an export buffer, growing it as needed. On
+    allocation failure, the buffer is marked as failed.
+
+Arguments:
+
+    Buffer - Supplies a pointer to the buffer to append to.
+
+    Data - Supplies a pointer to the data to append.
+
+    Size - Supplies the number of bytes to append.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG NewCapacity;
+    PBYTE NewData;
+
+    if (Buffer->Failed != FALSE) {
+        return;
+    }
+
+    if (Buffer->Size + Size > Buffer->Capacity) {
+        NewCapacity = Buffer->Capacity;
+        if (NewCapacity == 0) {
+            NewCapacity = PROFILER_EXPORT_INITIAL_BUFFER_SIZE;
+        }
+
+        while (Buffer->Size + Size > NewCapacity) {
+            NewCapacity *= 2;
+        }
+
+        NewData = realloc(Buffer->Data, NewCapacity);
+        if (NewData == NULL) {
+            Buffer->Failed = TRUE;
+            return;
+        }
+
+        Buffer->Data = NewData;
+        Buffer->Capacity = NewCapacity;
+    }
+
+    RtlCopyMemory(Buffer->Data + Buffer->Size, Data, Size);
+    Buffer->Size += Size;
+    return;
+}
+
+VOID
+DbgrpExportBufferWriteVarint (
+    PPROFILER_EXPORT_BUFFER Buffer,
+    ULONGLONG Value
+    )
+
+/*++
+
+Routine Description:
+
+    This routine appends a protocol buffer variable length integer to an
+    export buffer.
+
+Arguments:
+
+    Buffer - Supplies a pointer to the buffer to append to.
+
+    Value - Supplies the value to encode.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    BYTE Bytes[10];
+    ULONG Size;
+
+    Size = 0;
+    do {
+        Bytes[Size] = Value & 0x7F;
+        Value >>= 7;
+        if (Value != 0) {
+            Bytes[Size] |= 0x80;
+        }
+
+        Size += 1;
+
+    } while (Value != 0);
+
+    DbgrpExportBufferAppend(Buffer, Bytes, Size);
+    return;
+}
+
+VOID
+DbgrpExportBufferWriteInteger (
+    PPROFILER_EXPORT_BUFFER Buffer,
+    ULONG Field,
+    ULONGLONG Value
+    )
+
+/*++
+
+Routine Description:
+
+    This routine appends an integer protocol buffer field to an export buffer.
+
+Arguments:
+
+    Buffer - Supplies a pointer to the buffer to append to.
+
+    Field - Supplies the field number.
+
+    Value - Supplies the value of the field.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    DbgrpExportBufferWriteVarint(Buffer, (Field << 3) | PROTOBUF_WIRE_VARINT);
+    DbgrpExportBufferWriteVarint(Buffer, Value);
+    return;
+}
+
+VOID
+DbgrpExportBufferWriteBytes (
+    PPROFILER_EXPORT_BUFFER Buffer,
+    ULONG Field,
+    PVOID Data,
+    ULONG Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine appends a length delimited protocol buffer field to an export
+    buffer.
+
+Arguments:
+
+    Buffer - Supplies a pointer to the buffer to append to.
+
+    Field - Supplies the field number.
+
+    Data - Supplies a pointer to the contents of the field.
+
+    Size - Supplies the size of the contents in bytes.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    DbgrpExportBufferWriteVarint(Buffer,
+                                 (Field << 3) | PROTOBUF_WIRE_LENGTH_DELIMITED);
+
+    DbgrpExportBufferWriteVarint(Buffer, Size);
+    if (Size != 0) {
+        DbgrpExportBufferAppend(Buffer, Data, Size);
+    }
+
+    return;
+}
+
+VOID
+DbgrpExportBufferWriteMessage (
+    PPROFILER_EXPORT_BUFFER Buffer,
+    ULONG Field,
+    PPROFILER_EXPORT_BUFFER Message
+    )
+
+/*++
+
+Routine Description:
+
+    This routine appends an encoded message as a field of another message.
+
+Arguments:
+
+    Buffer - Supplies a pointer to the buffer to append to.
+
+    Field - Supplies the field number.
+
+    Message - Supplies a pointer to the buffer containing the encoded message.
+        If this buffer failed, the destination is marked as failed too.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if (Message->Failed != FALSE) {
+        Buffer->Failed = TRUE;
+        return;
+    }
+
+    DbgrpExportBufferWriteBytes(Buffer, Field, Message->Data, Message->Size);
+    return;
+}
+
@@ -0,0 +1,549 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    proflock.c
+
+Abstract:
+
+    This module implements support for lock contention profiling in the
+    debugger.
+
+Author:
+
+    agent 19-Oct-2026
+
+Environment:
+
+    Debug
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#define KERNEL_API
+
+#include "dbgrtl.h"
+#include <minoca/debug/spproto.h>
+#include <minoca/lib/im.h>
+#include <minoca/debug/dbgext.h>
+#include "symbols.h"
+#include "dbgapi.h"
+#include "dbgsym.h"
+#include "dbgrprof.h"
+#include "dbgprofp.h"
+#include "console.h"
+#include "dbgrcomm.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+#define LOCK_PROFILER_USAGE                                                    \
+    "Usage: profiler lock <command> [options...]\n"                            \
+    "This command works with lock contention statistics sent periodically \n"  \
+    "from the target. Valid commands are:\n"                                   \
+    "  clear - Delete all historical data stored in the debugger.\n"           \
+    "  dump [count] - Write the most recent lock statistics out to the \n"     \
+    "          debugger command console, sorted in descending order by \n"     \
+    "          total time spent waiting. If a count is supplied, only that \n" \
+    "          many of the most contended locks are printed. Locks without \n" \
+    "          a name are identified by the code that created them, and \n"    \
+    "          spin locks by their address. Times are in microseconds.\n"      \
+    "  help  - Display this help.\n\n"
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+VOID
+DbgrpDisplayLockStatistics (
+    PDEBUGGER_CONTEXT Context,
+    ULONG MaxCount
+    );
+
+int
+DbgrpCompareLockStatisticsByWaitTimeDescending (
+    const void *LeftPointer,
+    const void *RightPointer
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+PSTR DbgrLockTypeNames[ProfilerLockTypeMax] = {
+    "invalid",
+    "queued",
+    "sharedex",
+    "spin"
+};
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+INT
+DbgrpInitializeLockProfiling (
+    PDEBUGGER_CONTEXT Context
+    )
+
+/*++
+
+Routine Description:
+
+    This routine initializes support for lock profiling.
+
+Arguments:
+
+    Context - Supplies a pointer to the debugger context.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error code on failure.
+
+--*/
+
+{
+
+    Context->ProfilingData.LockListLock = CreateDebuggerLock();
+    if (Context->ProfilingData.LockListLock == NULL) {
+        return ENOMEM;
+    }
+
+    INITIALIZE_LIST_HEAD(&(Context->ProfilingData.LockListHead));
+    Context->ProfilingData.LockCollectionActive = FALSE;
+    return 0;
+}
+
+VOID
+DbgrpDestroyLockProfiling (
+    PDEBUGGER_CONTEXT Context
+    )
+
+/*++
+
+Routine Description:
+
+    This routine destroys any structures used for lock profiling.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if (Context->ProfilingData.LockListLock != NULL) {
+        AcquireDebuggerLock(Context->ProfilingData.LockListLock);
+        DbgrpDestroyProfilerDataList(&(Context->ProfilingData.LockListHead));
+        ReleaseDebuggerLock(Context->ProfilingData.LockListLock);
+        DestroyDebuggerLock(Context->ProfilingData.LockListLock);
+        Context->ProfilingData.LockListLock = NULL;
+    }
+
+    return;
+}
+
+VOID
+DbgrpProcessLockProfilingData (
+    PDEBUGGER_CONTEXT Context,
+    PPROFILER_DATA_ENTRY ProfilerData
+    )
+
+/*++
+
+Routine Description:
+
+    This routine collects a lock statistics notification that the debuggee
+    sent to the debugger.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    ProfilerData - Supplies a pointer to the newly allocated data. This routine
+        will take ownership of that allocation.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    AcquireDebuggerLock(Context->ProfilingData.LockListLock);
+    Context->ProfilingData.LockCollectionActive = TRUE;
+    INSERT_BEFORE(&(ProfilerData->ListEntry),
+                  &(Context->ProfilingData.LockListHead));
+
+    ReleaseDebuggerLock(Context->ProfilingData.LockListLock);
+    return;
+}
+
+VOID
+DbgrpCompleteLockProfilingRound (
+    PDEBUGGER_CONTEXT Context
+    )
+
+/*++
+
+Routine Description:
+
+    This routine marks the end of a round of profiler data. If lock statistics
+    arrived during the round, the last packet is marked as the end of a
+    complete snapshot.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PPROFILER_DATA_ENTRY ProfilerData;
+
+    AcquireDebuggerLock(Context->ProfilingData.LockListLock);
+    if (Context->ProfilingData.LockCollectionActive != FALSE) {
+
+        assert(LIST_EMPTY(&(Context->ProfilingData.LockListHead)) == FALSE);
+
+        ProfilerData = LIST_VALUE(Context->ProfilingData.LockListHead.Previous,
+                                  PROFILER_DATA_ENTRY,
+                                  ListEntry);
+
+        ProfilerData->Flags |= PROFILER_DATA_FLAGS_LOCK_SENTINEL;
+        Context->ProfilingData.LockCollectionActive = FALSE;
+    }
+
+    ReleaseDebuggerLock(Context->ProfilingData.LockListLock);
+    return;
+}
+
+INT
+DbgrpDispatchLockProfilerCommand (
+    PDEBUGGER_CONTEXT Context,
+    PSTR *Arguments,
+    ULONG ArgumentCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine handles a lock profiler command.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Arguments - Supplies an array of strings containing the arguments.
+
+    ArgumentCount - Supplies the number of arguments in the Arguments array.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error code on failure.
+
+--*/
+
+{
+
+    PSTR AdvancedString;
+    LONG MaxCount;
+
+    assert(strcasecmp(Arguments[0], "lock") == 0);
+
+    if (ArgumentCount < 2) {
+        DbgOut(LOCK_PROFILER_USAGE);
+        return EINVAL;
+    }
+
+    if (strcasecmp(Arguments[1], "clear") == 0) {
+        AcquireDebuggerLock(Context->ProfilingData.LockListLock);
+        DbgrpDestroyProfilerDataList(&(Context->ProfilingData.LockListHead));
+        Context->ProfilingData.LockCollectionActive = FALSE;
+        ReleaseDebuggerLock(Context->ProfilingData.LockListLock);
+
+    } else if (strcasecmp(Arguments[1], "dump") == 0) {
+        MaxCount = 0;
+        if (ArgumentCount > 2) {
+            MaxCount = strtol(Arguments[2], &AdvancedString, 0);
+            if ((Arguments[2] == AdvancedString) || (MaxCount < 0)) {
+                DbgOut("Error: Invalid argument %s. Unable to convert to a "
+                       "valid count.\n",
+                       Arguments[2]);
+
+                return EINVAL;
+            }
+        }
+
+        DbgrpDisplayLockStatistics(Context, (ULONG)MaxCount);
+
+    } else if (strcasecmp(Arguments[1], "help") == 0) {
+        DbgOut(LOCK_PROFILER_USAGE);
+
+    } else {
+        DbgOut("Error: Unknown lock profiler command '%s'.\n\n", Arguments[1]);
+        DbgOut(LOCK_PROFILER_USAGE);
+        return EINVAL;
+    }
+
+    return 0;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+VOID
+DbgrpDisplayLockStatistics (
+    PDEBUGGER_CONTEXT Context,
+    ULONG MaxCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine prints the most recent snapshot of lock statistics.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    MaxCount - Supplies the maximum number of locks to print, or 0 to print
+        all of them.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PPROFILER_LOCK_STATISTIC *Array;
+    PBYTE Buffer;
+    ULONG BufferSize;
+    ULONG Count;
+    ULONGLONG Frequency;
+    PPROFILER_LOCK_HEADER Header;
+    ULONG Index;
+    PSTR Name;
+    ULONG Offset;
+    BOOL Result;
+    PPROFILER_LOCK_STATISTIC Statistic;
+    PSTR Symbol;
+    PSTR TypeName;
+
+    Array = NULL;
+    Buffer = NULL;
+    Result = DbgrpGetProfilerSnapshot(&(Context->ProfilingData.LockListHead),
+                                      Context->ProfilingData.LockListLock,
+                                      PROFILER_DATA_FLAGS_LOCK_SENTINEL,
+                                      &Buffer,
+                                      &BufferSize);
+
+    if (Result == FALSE) {
+        DbgOut("No lock statistics have been received. Make sure lock "
+               "profiling is enabled in the target.\n");
+
+        goto DisplayLockStatisticsEnd;
+    }
+
+    Header = (PPROFILER_LOCK_HEADER)Buffer;
+    if ((BufferSize < sizeof(PROFILER_LOCK_HEADER)) ||
+        (Header->Magic != PROFILER_LOCK_MAGIC)) {
+
+        DbgOut("Error: Invalid lock statistics data.\n");
+        goto DisplayLockStatisticsEnd;
+    }
+
+    Frequency = Header->TimeCounterFrequency;
+    if (Header->ClassCount == 0) {
+        DbgOut("No lock activity was recorded.\n");
+        goto DisplayLockStatisticsEnd;
+    }
+
+    Array = malloc(Header->ClassCount * sizeof(PPROFILER_LOCK_STATISTIC));
+    if (Array == NULL) {
+        goto DisplayLockStatisticsEnd;
+    }
+
+    //
+    // Collect pointers to each variably sized entry so they can be sorted.
+    //
+
+    Count = 0;
+    Offset = sizeof(PROFILER_LOCK_HEADER);
+    while (Count < Header->ClassCount) {
+        Statistic = (PPROFILER_LOCK_STATISTIC)(Buffer + Offset);
+        if ((Offset + FIELD_OFFSET(PROFILER_LOCK_STATISTIC, Name) >
+             BufferSize) ||
+            (Statistic->StructureSize <=
+             FIELD_OFFSET(PROFILER_LOCK_STATISTIC, Name)) ||
+            (Offset + Statistic->StructureSize > BufferSize)) {
+
+            DbgOut("Error: Invalid lock statistics entry at offset 0x%x.\n",
+                   Offset);
+
+            goto DisplayLockStatisticsEnd;
+        }
+
+        Statistic->Name[Statistic->StructureSize -
+                        FIELD_OFFSET(PROFILER_LOCK_STATISTIC, Name) - 1] = '\0';
+
+        Array[Count] = Statistic;
+        Count += 1;
+        Offset += Statistic->StructureSize;
+    }
+
+    qsort(Array,
+          Count,
+          sizeof(PPROFILER_LOCK_STATISTIC),
+          DbgrpCompareLockStatisticsByWaitTimeDescending);
+
+    if ((MaxCount != 0) && (MaxCount < Count)) {
+        Count = MaxCount;
+    }
+
+    DbgOut("Type     Acquires Contended  TotalWait    MaxWait  TotalHold "
+           "   MaxHold Lock\n");
+
+    for (Index = 0; Index < Count; Index += 1) {
+        Statistic = Array[Index];
+        TypeName = DbgrLockTypeNames[ProfilerLockTypeInvalid];
+        if (Statistic->LockType < ProfilerLockTypeMax) {
+            TypeName = DbgrLockTypeNames[Statistic->LockType];
+        }
+
+        Symbol = NULL;
+        Name = Statistic->Name;
+        if (*Name == '\0') {
+            Symbol = DbgGetAddressSymbol(Context, Statistic->Address, NULL);
+            Name = Symbol;
+        }
+
+        DbgOut("%-8s %8I64d %9I64d %10I64d %10I64d %10I64d %10I64d ",
+               TypeName,
+               Statistic->AcquireCount,
+               Statistic->ContentionCount,
+               DbgrpConvertProfilerTicks(Statistic->TotalWaitTime, Frequency),
+               DbgrpConvertProfilerTicks(Statistic->MaxWaitTime, Frequency),
+               DbgrpConvertProfilerTicks(Statistic->TotalHoldTime, Frequency),
+               DbgrpConvertProfilerTicks(Statistic->MaxHoldTime, Frequency));
+
+        if (Name != NULL) {
+            DbgOut("%s\n", Name);
+
+        } else {
+            DbgOut("0x%08I64x\n", Statistic->Address);
+        }
+
+        if (Symbol != NULL) {
+            free(Symbol);
+        }
+    }
+
+DisplayLockStatisticsEnd:
+    if (Array != NULL) {
+        free(Array);
+    }
+
+    if (Buffer != NULL) {
+        free(Buffer);
+    }
+
+    return;
+}
+
+int
+DbgrpCompareLockStatisticsByWaitTimeDescending (
+    const void *LeftPointer,
+    const void *RightPointer
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compares two lock statistics by total wait time, ordering the
+    most waited on first.
+
+Arguments:
+
+    LeftPointer - Supplies a pointer to the left lock statistic pointer.
+
+    RightPointer - Supplies a pointer to the right lock statistic pointer.
+
+Return Value:
+
+    -1 if Left < Right.
+
+    0 if Left == Right.
+
+    1 if Left > Right.
+
+--*/
+
+{
+
+    PPROFILER_LOCK_STATISTIC Left;
+    PPROFILER_LOCK_STATISTIC Right;
+
+    Left = *((PPROFILER_LOCK_STATISTIC *)LeftPointer);
+    Right = *((PPROFILER_LOCK_STATISTIC *)RightPointer);
+    if (Left->TotalWaitTime > Right->TotalWaitTime) {
+        return -1;
+    }
+
+    if (Left->TotalWaitTime < Right->TotalWaitTime) {
+        return 1;
+    }
+
+    if (Left->ContentionCount > Right->ContentionCount) {
+        return -1;
+    }
+
+    if (Left->ContentionCount < Right->ContentionCount) {
+        return 1;
+    }
+
+    return 0;
+}
+
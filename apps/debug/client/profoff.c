@@ -0,0 +1,830 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    profoff.c
+
+Abstract:
+
+    This module implements support for off-CPU profiling in the debugger,
+    which shows where and why kernel threads spend time blocked.
+
+Author:
+
+    agent 19-Oct-2026
+
+Environment:
+
+    Debug
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#define KERNEL_API
+
+#include "dbgrtl.h"
+#include <minoca/debug/spproto.h>
+#include <minoca/lib/im.h>
+#include <minoca/debug/dbgext.h>
+#include "symbols.h"
+#include "dbgapi.h"
+#include "dbgsym.h"
+#include "dbgrprof.h"
+#include "dbgprofp.h"
+#include "console.h"
+#include "dbgrcomm.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+#define OFF_CPU_PROFILER_USAGE                                                 \
+    "Usage: profiler offcpu <command> [options...]\n"                          \
+    "This command works with off-CPU statistics sent periodically from the \n" \
+    "target, which record the call stack and wait reason every time a \n"      \
+    "kernel thread blocks and how long it stayed blocked. Valid commands \n"   \
+    "are:\n"                                                                   \
+    "  clear - Delete all historical data stored in the debugger.\n"           \
+    "  dump [count] - Write the most recent off-CPU statistics out to the \n"  \
+    "          debugger command console, sorted in descending order by \n"     \
+    "          total time spent blocked. If a count is supplied, only that \n" \
+    "          many call stacks are printed. Times are in microseconds.\n"     \
+    "  export <file> - Write the most recent off-CPU statistics to the \n"     \
+    "          given file as folded stacks weighted by microseconds spent \n"  \
+    "          blocked, for use with flame graph tools alongside the output \n"\
+    "          of 'profiler stack export folded'.\n"                           \
+    "  help  - Display this help.\n\n"
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+VOID
+DbgrpDisplayOffCpuStatistics (
+    PDEBUGGER_CONTEXT Context,
+    ULONG MaxCount
+    );
+
+INT
+DbgrpExportOffCpuStatistics (
+    PDEBUGGER_CONTEXT Context,
+    PSTR Path
+    );
+
+PPROFILER_OFF_CPU_STATISTIC *
+DbgrpGetOffCpuStatistics (
+    PDEBUGGER_CONTEXT Context,
+    PBYTE *Buffer,
+    PULONG Count,
+    PULONGLONG Frequency
+    );
+
+PSTR
+DbgrpGetOffCpuReasonName (
+    ULONG Reason
+    );
+
+VOID
+DbgrpSanitizeOffCpuFrameName (
+    PSTR Name
+    );
+
+int
+DbgrpCompareOffCpuStatisticsByTimeDescending (
+    const void *LeftPointer,
+    const void *RightPointer
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+PSTR DbgrOffCpuReasonNames[ProfilerOffCpuReasonMax] = {
+    "invalid",
+    "queue",
+    "queuedlock",
+    "event",
+    "timer",
+    "thread",
+    "io",
+    "object"
+};
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+INT
+DbgrpInitializeOffCpuProfiling (
+    PDEBUGGER_CONTEXT Context
+    )
+
+/*++
+
+Routine Description:
+
+    This routine initializes support for off-CPU profiling.
+
+Arguments:
+
+    Context - Supplies a pointer to the debugger context.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error code on failure.
+
+--*/
+
+{
+
+    Context->ProfilingData.OffCpuListLock = CreateDebuggerLock();
+    if (Context->ProfilingData.OffCpuListLock == NULL) {
+        return ENOMEM;
+    }
+
+    INITIALIZE_LIST_HEAD(&(Context->ProfilingData.OffCpuListHead));
+    Context->ProfilingData.OffCpuCollectionActive = FALSE;
+    return 0;
+}
+
+VOID
+DbgrpDestroyOffCpuProfiling (
+    PDEBUGGER_CONTEXT Context
+    )
+
+/*++
+
+Routine Description:
+
+    This routine destroys any structures used for off-CPU profiling.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if (Context->ProfilingData.OffCpuListLock != NULL) {
+        AcquireDebuggerLock(Context->ProfilingData.OffCpuListLock);
+        DbgrpDestroyProfilerDataList(&(Context->ProfilingData.OffCpuListHead));
+        ReleaseDebuggerLock(Context->ProfilingData.OffCpuListLock);
+        DestroyDebuggerLock(Context->ProfilingData.OffCpuListLock);
+        Context->ProfilingData.OffCpuListLock = NULL;
+    }
+
+    return;
+}
+
+VOID
+DbgrpProcessOffCpuProfilingData (
+    PDEBUGGER_CONTEXT Context,
+    PPROFILER_DATA_ENTRY ProfilerData
+    )
+
+/*++
+
+Routine Description:
+
+    This routine collects an off-CPU statistics notification that the debuggee
+    sent to the debugger.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    ProfilerData - Supplies a pointer to the newly allocated data. This routine
+        will take ownership of that allocation.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    AcquireDebuggerLock(Context->ProfilingData.OffCpuListLock);
+    Context->ProfilingData.OffCpuCollectionActive = TRUE;
+    INSERT_BEFORE(&(ProfilerData->ListEntry),
+                  &(Context->ProfilingData.OffCpuListHead));
+
+    ReleaseDebuggerLock(Context->ProfilingData.OffCpuListLock);
+    return;
+}
+
+VOID
+DbgrpCompleteOffCpuProfilingRound (
+    PDEBUGGER_CONTEXT Context
+    )
+
+/*++
+
+Routine Description:
+
+    This routine marks the end of a round of profiler data. If off-CPU
+    statistics arrived during the round, the last packet is marked as the end
+    of a complete snapshot.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PLIST_ENTRY ListHead;
+    PPROFILER_DATA_ENTRY ProfilerData;
+
+    ListHead = &(Context->ProfilingData.OffCpuListHead);
+    AcquireDebuggerLock(Context->ProfilingData.OffCpuListLock);
+    if (Context->ProfilingData.OffCpuCollectionActive != FALSE) {
+
+        assert(LIST_EMPTY(ListHead) == FALSE);
+
+        ProfilerData = LIST_VALUE(ListHead->Previous,
+                                  PROFILER_DATA_ENTRY,
+                                  ListEntry);
+
+        ProfilerData->Flags |= PROFILER_DATA_FLAGS_OFF_CPU_SENTINEL;
+        Context->ProfilingData.OffCpuCollectionActive = FALSE;
+    }
+
+    ReleaseDebuggerLock(Context->ProfilingData.OffCpuListLock);
+    return;
+}
+
+INT
+DbgrpDispatchOffCpuProfilerCommand (
+    PDEBUGGER_CONTEXT Context,
+    PSTR *Arguments,
+    ULONG ArgumentCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine handles an off-CPU profiler command.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Arguments - Supplies an array of strings containing the arguments.
+
+    ArgumentCount - Supplies the number of arguments in the Arguments array.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error code on failure.
+
+--*/
+
+{
+
+    PSTR AdvancedString;
+    LONG MaxCount;
+
+    assert(strcasecmp(Arguments[0], "offcpu") == 0);
+
+    if (ArgumentCount < 2) {
+        DbgOut(OFF_CPU_PROFILER_USAGE);
+        return EINVAL;
+    }
+
+    if (strcasecmp(Arguments[1], "clear") == 0) {
+        AcquireDebuggerLock(Context->ProfilingData.OffCpuListLock);
+        DbgrpDestroyProfilerDataList(&(Context->ProfilingData.OffCpuListHead));
+        Context->ProfilingData.OffCpuCollectionActive = FALSE;
+        ReleaseDebuggerLock(Context->ProfilingData.OffCpuListLock);
+
+    } else if (strcasecmp(Arguments[1], "dump") == 0) {
+        MaxCount = 0;
+        if (ArgumentCount > 2) {
+            MaxCount = strtol(Arguments[2], &AdvancedString, 0);
+            if ((Arguments[2] == AdvancedString) || (MaxCount < 0)) {
+                DbgOut("Error: Invalid argument %s. Unable to convert to a "
+                       "valid count.\n",
+                       Arguments[2]);
+
+                return EINVAL;
+            }
+        }
+
+        DbgrpDisplayOffCpuStatistics(Context, (ULONG)MaxCount);
+
+    } else if (strcasecmp(Arguments[1], "export") == 0) {
+        if (ArgumentCount != 3) {
+            DbgOut(OFF_CPU_PROFILER_USAGE);
+            return EINVAL;
+        }
+
+        return DbgrpExportOffCpuStatistics(Context, Arguments[2]);
+
+    } else if (strcasecmp(Arguments[1], "help") == 0) {
+        DbgOut(OFF_CPU_PROFILER_USAGE);
+
+    } else {
+        DbgOut("Error: Unknown off-CPU profiler command '%s'.\n\n",
+               Arguments[1]);
+
+        DbgOut(OFF_CPU_PROFILER_USAGE);
+        return EINVAL;
+    }
+
+    return 0;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+VOID
+DbgrpDisplayOffCpuStatistics (
+    PDEBUGGER_CONTEXT Context,
+    ULONG MaxCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine prints the most recent snapshot of off-CPU statistics, each
+    followed by the symbolized call stack that blocked.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    MaxCount - Supplies the maximum number of call stacks to print, or 0 to
+        print all of them.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PPROFILER_OFF_CPU_STATISTIC *Array;
+    PBYTE Buffer;
+    ULONG Count;
+    ULONG FrameIndex;
+    ULONGLONG Frequency;
+    ULONG Index;
+    PPROFILER_OFF_CPU_STATISTIC Statistic;
+    PSTR Symbol;
+
+    Buffer = NULL;
+    Array = DbgrpGetOffCpuStatistics(Context, &Buffer, &Count, &Frequency);
+    if (Array == NULL) {
+        goto DisplayOffCpuStatisticsEnd;
+    }
+
+    if ((MaxCount != 0) && (MaxCount < Count)) {
+        Count = MaxCount;
+    }
+
+    DbgOut("Reason        Waits  TotalTime    MaxTime Object\n");
+    for (Index = 0; Index < Count; Index += 1) {
+        Statistic = Array[Index];
+        DbgOut("%-10s %8I64d %10I64d %10I64d 0x%08I64x\n",
+               DbgrpGetOffCpuReasonName(Statistic->Reason),
+               Statistic->Count,
+               DbgrpConvertProfilerTicks(Statistic->TotalTime, Frequency),
+               DbgrpConvertProfilerTicks(Statistic->MaxTime, Frequency),
+               Statistic->WaitObject);
+
+        for (FrameIndex = 0;
+             FrameIndex < Statistic->FrameCount;
+             FrameIndex += 1) {
+
+            Symbol = DbgGetAddressSymbol(Context,
+                                         Statistic->Frames[FrameIndex],
+                                         NULL);
+
+            if (Symbol != NULL) {
+                DbgOut("    %s\n", Symbol);
+                free(Symbol);
+
+            } else {
+                DbgOut("    0x%08I64x\n", Statistic->Frames[FrameIndex]);
+            }
+        }
+    }
+
+DisplayOffCpuStatisticsEnd:
+    if (Array != NULL) {
+        free(Array);
+    }
+
+    if (Buffer != NULL) {
+        free(Buffer);
+    }
+
+    return;
+}
+
+INT
+DbgrpExportOffCpuStatistics (
+    PDEBUGGER_CONTEXT Context,
+    PSTR Path
+    )
+
+/*++
+
+Routine Description:
+
+    This routine writes the most recent snapshot of off-CPU statistics out to
+    a file as folded stacks. Each line names the wait reason and then the call
+    stack from the outermost frame in, weighted by the total microseconds
+    spent blocked there.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Path - Supplies the path of the file to create.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error code on failure.
+
+--*/
+
+{
+
+    PPROFILER_OFF_CPU_STATISTIC *Array;
+    PBYTE Buffer;
+    ULONG Count;
+    FILE *File;
+    ULONG FrameIndex;
+    ULONGLONG Frequency;
+    ULONG Index;
+    INT Result;
+    PPROFILER_OFF_CPU_STATISTIC Statistic;
+    PSTR Symbol;
+    ULONGLONG TotalTime;
+
+    Buffer = NULL;
+    File = NULL;
+    Array = DbgrpGetOffCpuStatistics(Context, &Buffer, &Count, &Frequency);
+    if (Array == NULL) {
+        Result = ENOENT;
+        goto ExportOffCpuStatisticsEnd;
+    }
+
+    File = fopen(Path, "w");
+    if (File == NULL) {
+        Result = errno;
+        DbgOut("Error: Failed to open %s: %s.\n", Path, strerror(Result));
+        goto ExportOffCpuStatisticsEnd;
+    }
+
+    Result = 0;
+    for (Index = 0; Index < Count; Index += 1) {
+        Statistic = Array[Index];
+        fprintf(File,
+                "offcpu;%s",
+                DbgrpGetOffCpuReasonName(Statistic->Reason));
+
+        for (FrameIndex = Statistic->FrameCount;
+             FrameIndex > 0;
+             FrameIndex -= 1) {
+
+            fputc(';', File);
+            Symbol = DbgGetAddressSymbol(Context,
+                                         Statistic->Frames[FrameIndex - 1],
+                                         NULL);
+
+            if (Symbol != NULL) {
+                DbgrpSanitizeOffCpuFrameName(Symbol);
+                fputs(Symbol, File);
+                free(Symbol);
+
+            } else {
+                fprintf(File,
+                        "0x%llx",
+                        (unsigned long long)Statistic->Frames[FrameIndex - 1]);
+            }
+        }
+
+        TotalTime = DbgrpConvertProfilerTicks(Statistic->TotalTime, Frequency);
+        if (fprintf(File, " %lld\n", (long long)TotalTime) < 0) {
+            Result = errno;
+            break;
+        }
+    }
+
+    if ((fclose(File) != 0) && (Result == 0)) {
+        Result = errno;
+    }
+
+    if (Result != 0) {
+        DbgOut("Error: Failed to write %s: %s.\n", Path, strerror(Result));
+
+    } else {
+        DbgOut("Wrote %d off-CPU stacks to %s.\n", Count, Path);
+    }
+
+ExportOffCpuStatisticsEnd:
+    if (Array != NULL) {
+        free(Array);
+    }
+
+    if (Buffer != NULL) {
+        free(Buffer);
+    }
+
+    return Result;
+}
+
+PPROFILER_OFF_CPU_STATISTIC *
+DbgrpGetOffCpuStatistics (
+    PDEBUGGER_CONTEXT Context,
+    PBYTE *Buffer,
+    PULONG Count,
+    PULONGLONG Frequency
+    )
+
+/*++
+
+Routine Description:
+
+    This routine gets the most recent snapshot of off-CPU statistics and
+    validates it, returning the statistics sorted by total time blocked.
+    Problems are reported to the debugger console.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Buffer - Supplies a pointer where the snapshot buffer is returned. The
+        caller is responsible for freeing it, even on failure.
+
+    Count - Supplies a pointer where the number of statistics in the returned
+        array is returned.
+
+    Frequency - Supplies a pointer where the frequency of the time counter the
+        statistics are measured in is returned.
+
+Return Value:
+
+    Returns an array of pointers to the statistics within the buffer. The
+    caller is responsible for freeing this array.
+
+    NULL if there are no statistics or on failure.
+
+--*/
+
+{
+
+    PPROFILER_OFF_CPU_STATISTIC *Array;
+    ULONG BufferSize;
+    ULONG EntryCount;
+    PPROFILER_OFF_CPU_HEADER Header;
+    ULONG MinimumSize;
+    ULONG Offset;
+    BOOL Result;
+    PPROFILER_OFF_CPU_STATISTIC Statistic;
+
+    Array = NULL;
+    *Buffer = NULL;
+    Result = DbgrpGetProfilerSnapshot(&(Context->ProfilingData.OffCpuListHead),
+                                      Context->ProfilingData.OffCpuListLock,
+                                      PROFILER_DATA_FLAGS_OFF_CPU_SENTINEL,
+                                      Buffer,
+                                      &BufferSize);
+
+    if (Result == FALSE) {
+        DbgOut("No off-CPU statistics have been received. Make sure off-CPU "
+               "profiling is enabled in the target.\n");
+
+        goto GetOffCpuStatisticsEnd;
+    }
+
+    Header = (PPROFILER_OFF_CPU_HEADER)*Buffer;
+    if ((BufferSize < sizeof(PROFILER_OFF_CPU_HEADER)) ||
+        (Header->Magic != PROFILER_OFF_CPU_MAGIC)) {
+
+        DbgOut("Error: Invalid off-CPU statistics data.\n");
+        goto GetOffCpuStatisticsEnd;
+    }
+
+    if (Header->DroppedCount != 0) {
+        DbgOut("Warning: %I64d waits were not recorded because the target's "
+               "table of call stacks was full.\n",
+               Header->DroppedCount);
+    }
+
+    if (Header->EntryCount == 0) {
+        DbgOut("No blocked threads were recorded.\n");
+        goto GetOffCpuStatisticsEnd;
+    }
+
+    Array = malloc(Header->EntryCount * sizeof(PPROFILER_OFF_CPU_STATISTIC));
+    if (Array == NULL) {
+        goto GetOffCpuStatisticsEnd;
+    }
+
+    //
+    // Collect pointers to each variably sized entry so they can be sorted.
+    //
+
+    EntryCount = 0;
+    Offset = sizeof(PROFILER_OFF_CPU_HEADER);
+    while (EntryCount < Header->EntryCount) {
+        Statistic = (PPROFILER_OFF_CPU_STATISTIC)(*Buffer + Offset);
+        MinimumSize = FIELD_OFFSET(PROFILER_OFF_CPU_STATISTIC, Frames);
+        if ((Offset + MinimumSize > BufferSize) ||
+            (Statistic->FrameCount > PROFILER_OFF_CPU_MAX_FRAMES) ||
+            (Statistic->StructureSize !=
+             MinimumSize + (Statistic->FrameCount * sizeof(ULONGLONG))) ||
+            (Offset + Statistic->StructureSize > BufferSize)) {
+
+            DbgOut("Error: Invalid off-CPU statistics entry at offset 0x%x.\n",
+                   Offset);
+
+            free(Array);
+            Array = NULL;
+            goto GetOffCpuStatisticsEnd;
+        }
+
+        Array[EntryCount] = Statistic;
+        EntryCount += 1;
+        Offset += Statistic->StructureSize;
+    }
+
+    qsort(Array,
+          EntryCount,
+          sizeof(PPROFILER_OFF_CPU_STATISTIC),
+          DbgrpCompareOffCpuStatisticsByTimeDescending);
+
+    *Count = EntryCount;
+    *Frequency = Header->TimeCounterFrequency;
+
+GetOffCpuStatisticsEnd:
+    return Array;
+}
+
+PSTR
+DbgrpGetOffCpuReasonName (
+    ULONG Reason
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the display name of an off-CPU wait reason.
+
+Arguments:
+
+    Reason - Supplies the reason. See PROFILER_OFF_CPU_REASON.
+
+Return Value:
+
+    Returns a pointer to a constant string naming the reason.
+
+--*/
+
+{
+
+    if (Reason >= ProfilerOffCpuReasonMax) {
+        Reason = ProfilerOffCpuReasonInvalid;
+    }
+
+    return DbgrOffCpuReasonNames[Reason];
+}
+
+VOID
+DbgrpSanitizeOffCpuFrameName (
+    PSTR Name
+    )
+
+/*++
+
+Routine Description:
+
+    This routine replaces any characters in a symbolized frame name that would
+    be mistaken for separators in folded stack output.
+
+Arguments:
+
+    Name - Supplies a pointer to the name to modify in place.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    while (*Name != '\0') {
+        if (*Name == ';') {
+            *Name = ':';
+
+        } else if ((*Name == '\n') || (*Name == '\r')) {
+            *Name = ' ';
+        }
+
+        Name += 1;
+    }
+
+    return;
+}
+
+int
+DbgrpCompareOffCpuStatisticsByTimeDescending (
+    const void *LeftPointer,
+    const void *RightPointer
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compares two off-CPU statistics by total time blocked,
+    ordering the longest blocked first.
+
+Arguments:
+
+    LeftPointer - Supplies a pointer to the left off-CPU statistic pointer.
+
+    RightPointer - Supplies a pointer to the right off-CPU statistic pointer.
+
+Return Value:
+
+    -1 if Left < Right.
+
+    0 if Left == Right.
+
+    1 if Left > Right.
+
+--*/
+
+{
+
+    PPROFILER_OFF_CPU_STATISTIC Left;
+    PPROFILER_OFF_CPU_STATISTIC Right;
+
+    Left = *((PPROFILER_OFF_CPU_STATISTIC *)LeftPointer);
+    Right = *((PPROFILER_OFF_CPU_STATISTIC *)RightPointer);
+    if (Left->TotalTime > Right->TotalTime) {
+        return -1;
+    }
+
+    if (Left->TotalTime < Right->TotalTime) {
+        return 1;
+    }
+
+    if (Left->Count > Right->Count) {
+        return -1;
+    }
+
+    if (Left->Count < Right->Count) {
+        return 1;
+    }
+
+    return 0;
+}
+
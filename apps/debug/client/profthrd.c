@@ -197,11 +197,6 @@ DbgrpDisplayBlockingQueues (
     ULONG ThreadListSize
     );
 
-VOID
-DbgrpFullyProcessThreadProfilingData (
-    PDEBUGGER_CONTEXT Context
-    );
-
 VOID
 DbgrpClearThreadProfilingData (
     PDEBUGGER_CONTEXT Context
@@ -213,22 +208,6 @@ DbgrpCreateThreadIdArray (
     ULONG ArgumentCount
     );
 
-PSTR
-DbgpGetProcessName (
-    PDEBUGGER_CONTEXT Context,
-    ULONG ProcessId,
-    PSTR NumericBuffer,
-    ULONG NumericBufferSize
-    );
-
-PSTR
-DbgrpGetThreadName (
-    PDEBUGGER_CONTEXT Context,
-    ULONG ThreadId,
-    PSTR NumericBuffer,
-    ULONG NumericBufferSize
-    );
-
 int
 DbgrpCompareContextSwapsByTimeAscending (
     const void *LeftPointer,
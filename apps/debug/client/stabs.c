@@ -221,6 +221,7 @@ DEBUG_SYMBOL_INTERFACE DbgStabsSymbolInterface = {
     NULL,
     NULL,
     NULL,
+    NULL,
     NULL
 };
 
@@ -69,6 +69,12 @@ DbgpStringMatch (
     PSTR PossibleMatch
     );
 
+VOID
+DbgpLoadDeferredSymbols (
+    PDEBUG_SYMBOLS Module,
+    ULONGLONG Address
+    );
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -1216,6 +1222,8 @@ Return Value:
         return NULL;
     }
 
+    DbgpLoadDeferredSymbols(Module, Address);
+
     //
     // Begin searching. Loop over all source files in the module.
     //
@@ -1450,6 +1458,8 @@ Return Value:
         return NULL;
     }
 
+    DbgpLoadDeferredSymbols(Module, 0);
+
     //
     // Initialize the search variables based on the input parameter.
     //
@@ -1570,6 +1580,8 @@ Return Value:
         return NULL;
     }
 
+    DbgpLoadDeferredSymbols(Module, Address);
+
     //
     // Initialize the search variables based on the input parameter.
     //
@@ -1713,6 +1725,8 @@ Return Value:
         return NULL;
     }
 
+    DbgpLoadDeferredSymbols(Module, Address);
+
     //
     // Initialize the search variables based on the input parameter.
     //
@@ -2112,3 +2126,40 @@ Return Value:
     return FALSE;
 }
 
+VOID
+DbgpLoadDeferredSymbols (
+    PDEBUG_SYMBOLS Module,
+    ULONGLONG Address
+    )
+
+/*++
+
+Routine Description:
+
+    This routine asks the symbol library to load any symbols it put off
+    loading that a search of the module might need.
+
+Arguments:
+
+    Module - Supplies a pointer to the module about to be searched.
+
+    Address - Supplies the address being searched for, or 0 if the search is
+        by name and so needs every symbol in the module.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if ((Module->Interface != NULL) &&
+        (Module->Interface->LoadDeferred != NULL)) {
+
+        Module->Interface->LoadDeferred(Module, Address);
+    }
+
+    return;
+}
+
@@ -515,6 +515,36 @@ Return Value:
 
 --*/
 
+typedef
+INT
+(*PSYMBOLS_LOAD_DEFERRED) (
+    PDEBUG_SYMBOLS Symbols,
+    ULONGLONG Address
+    );
+
+/*++
+
+Routine Description:
+
+    This routine loads symbol information that was put off at load time. It is
+    called before the symbol lists are searched.
+
+Arguments:
+
+    Symbols - Supplies a pointer to the debug symbols.
+
+    Address - Supplies the address being searched for. Only the symbols
+        covering this address need to be loaded. Supply 0 to load all deferred
+        symbols, as is needed for searches by name.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error number on failure.
+
+--*/
+
 /*++
 
 Structure Description:
@@ -541,6 +571,9 @@ Structure Description:
         an address is within a given discontiguous range for a function or
         module.
 
+    LoadDeferred - Stores an optional pointer to a function used to load
+        symbols that were not parsed when the module was first loaded.
+
 --*/
 
 typedef struct _DEBUG_SYMBOL_INTERFACE {
@@ -550,6 +583,7 @@ typedef struct _DEBUG_SYMBOL_INTERFACE {
     PSYMBOLS_READ_DATA_SYMBOL ReadDataSymbol;
     PSYMBOLS_GET_ADDRESS_OF_DATA_SYMBOL GetAddressOfDataSymbol;
     PSYMBOLS_CHECK_RANGE CheckRange;
+    PSYMBOLS_LOAD_DEFERRED LoadDeferred;
 } DEBUG_SYMBOL_INTERFACE, *PDEBUG_SYMBOL_INTERFACE;
 
 /*++
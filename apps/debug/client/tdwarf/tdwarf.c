@@ -397,10 +397,16 @@ Return Value:
     PLIST_ENTRY TypeEntry;
 
     Symbols = NULL;
-    DwarfFlags = 0;
+
+    //
+    // Process every compilation unit up front, since all the symbols get
+    // walked directly below.
+    //
+
+    DwarfFlags = DWARF_CONTEXT_LOAD_ALL;
     if ((Options & TDWARF_OPTION_DEBUG) != 0) {
-        DwarfFlags = DWARF_CONTEXT_DEBUG | DWARF_CONTEXT_DEBUG_LINE_NUMBERS |
-                     DWARF_CONTEXT_DEBUG_ABBREVIATIONS;
+        DwarfFlags |= DWARF_CONTEXT_DEBUG | DWARF_CONTEXT_DEBUG_LINE_NUMBERS |
+                      DWARF_CONTEXT_DEBUG_ABBREVIATIONS;
     }
 
     if ((Options & TDWARF_OPTION_PRINT_UNWIND) != 0) {
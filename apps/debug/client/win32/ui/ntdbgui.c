@@ -729,7 +729,8 @@ MEMORY_COLUMN MemoryStatisticsColumns[MEMORY_STATISTICS_COLUMN_COUNT] = {
 
 LPWSTR MemoryStatisticsPoolHeaders[ProfilerMemoryTypeMax] = {
     L"Non-Paged Pool",
-    L"Paged Pool"
+    L"Paged Pool",
+    L"Object Caches"
 };
 
 //
@@ -0,0 +1,59 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    ktrace
+
+Abstract:
+
+    This executable implements the kernel trace capture application.
+    It writes kernel trace events to a file for offline analysis.
+
+Author:
+
+    agent 19-Oct-2026
+
+Environment:
+
+    User
+
+--*/
+
+from menv import application;
+
+function build() {
+    var app;
+    var dynlibs;
+    var entries;
+    var includes;
+    var sources;
+
+    sources = [
+        "ktrace.c"
+    ];
+
+    dynlibs = [
+        "apps/osbase:libminocaos"
+    ];
+
+    includes = [
+        "$S/apps/libc/include"
+    ];
+
+    app = {
+        "label": "ktrace",
+        "inputs": sources + dynlibs,
+        "includes": includes
+    };
+
+    entries = application(app);
+    return entries;
+}
+
@@ -0,0 +1,702 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    ktrace.c
+
+Abstract:
+
+    This module implements the kernel event trace capture application. It
+    enables the kernel's static tracepoints, drains the per-processor trace
+    buffers, and writes the records to a file for offline analysis.
+
+Author:
+
+    agent 19-Oct-2026
+
+Environment:
+
+    User Mode
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <minoca/lib/minocaos.h>
+#include <minoca/kernel/sp.h>
+#include <minoca/lib/mlibc.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+//
+// --------------------------------------------------------------------- Macros
+//
+
+#define PRINT_ERROR(...) fprintf(stderr, "\nktrace: " __VA_ARGS__)
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+#define KTRACE_VERSION_MAJOR 1
+#define KTRACE_VERSION_MINOR 0
+
+#define KTRACE_USAGE                                                           \
+    "usage: ktrace [-e <events>] [-o <file>] [-s <records>] [-t <seconds>]\n\n"\
+    "The ktrace utility captures kernel trace events to a file. Capture \n"    \
+    "runs until the time limit expires or the utility is interrupted.\n\n"    \
+    "Options:\n"                                                               \
+    "  -e, --events <events> -- Set the comma separated list of events to \n" \
+    "      capture. Valid values are sched, irp, fault, cache, net, and \n"    \
+    "      all. The default is all.\n"                                         \
+    "  -o, --output <file> -- Set the file to write. The default is \n"        \
+    "      ktrace.dat.\n"                                                      \
+    "  -s, --size <records> -- Set the number of records in each \n"           \
+    "      processor's trace buffer. This only takes effect the first time \n" \
+    "      tracing is enabled.\n"                                              \
+    "  -t, --time <seconds> -- Stop capturing after the given time.\n"         \
+    "  --help -- Display this help text.\n"                                    \
+    "  --version -- Display the application version and exit.\n\n"
+
+#define KTRACE_OPTIONS_STRING "e:o:s:t:Vh"
+
+#define KTRACE_DEFAULT_OUTPUT "ktrace.dat"
+
+//
+// Define how often the trace buffers are drained, in milliseconds.
+//
+
+#define KTRACE_DRAIN_INTERVAL 100
+
+//
+// Define the maximum number of records read at once.
+//
+
+#define KTRACE_MAX_READ_RECORDS 0x4000
+
+#define KTRACE_EVENT_GROUP_COUNT 6
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+/*++
+
+Structure Description:
+
+    This structure defines a named group of trace events.
+
+Members:
+
+    Name - Stores the command line name for the group.
+
+    EventMask - Stores the mask of trace events in the group.
+
+--*/
+
+typedef struct _KTRACE_EVENT_GROUP {
+    PSTR Name;
+    ULONG EventMask;
+} KTRACE_EVENT_GROUP, *PKTRACE_EVENT_GROUP;
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+INT
+KtraceParseEvents (
+    PSTR Argument,
+    PULONG EventMask
+    );
+
+INT
+KtraceGetSetState (
+    PSP_TRACE_STATE_INFORMATION State,
+    BOOL Set
+    );
+
+INT
+KtraceDrain (
+    FILE *File,
+    PSP_TRACE_RECORD Buffer,
+    ULONG BufferCount,
+    PULONGLONG RecordCount
+    );
+
+void
+KtraceSignalHandler (
+    int Signal
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+struct option KtraceLongOptions[] = {
+    {"events", required_argument, 0, 'e'},
+    {"output", required_argument, 0, 'o'},
+    {"size", required_argument, 0, 's'},
+    {"time", required_argument, 0, 't'},
+    {"help", no_argument, 0, 'h'},
+    {"version", no_argument, 0, 'V'},
+    {NULL, 0, 0, 0},
+};
+
+KTRACE_EVENT_GROUP KtraceEventGroups[KTRACE_EVENT_GROUP_COUNT] = {
+    {"all", SP_TRACE_EVENT_MASK_ALL},
+    {
+        "sched",
+        SP_TRACE_EVENT_MASK(SpTraceEventContextSwitch) |
+        SP_TRACE_EVENT_MASK(SpTraceEventThreadWake)
+    },
+
+    {
+        "irp",
+        SP_TRACE_EVENT_MASK(SpTraceEventIrpDispatch) |
+        SP_TRACE_EVENT_MASK(SpTraceEventIrpComplete)
+    },
+
+    {"fault", SP_TRACE_EVENT_MASK(SpTraceEventPageFault)},
+    {
+        "cache",
+        SP_TRACE_EVENT_MASK(SpTraceEventPageCacheHit) |
+        SP_TRACE_EVENT_MASK(SpTraceEventPageCacheMiss)
+    },
+
+    {
+        "net",
+        SP_TRACE_EVENT_MASK(SpTraceEventNetTransmit) |
+        SP_TRACE_EVENT_MASK(SpTraceEventNetReceive)
+    },
+};
+
+//
+// Set when the user interrupts the capture.
+//
+
+volatile sig_atomic_t KtraceInterrupted;
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+int
+main (
+    int ArgumentCount,
+    char **Arguments
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements the kernel trace capture program.
+
+Arguments:
+
+    ArgumentCount - Supplies the number of elements in the arguments array.
+
+    Arguments - Supplies an array of strings. The array count is bounded by the
+        previous parameter, and the strings are null-terminated.
+
+Return Value:
+
+    0 on success.
+
+    Non-zero on failure.
+
+--*/
+
+{
+
+    PSP_TRACE_RECORD Buffer;
+    ULONG BufferCount;
+    ULONG Elapsed;
+    ULONG EventMask;
+    FILE *File;
+    SP_TRACE_FILE_HEADER Header;
+    ULONGLONG InitialLost;
+    INT Option;
+    PSTR OutputPath;
+    ULONG Records;
+    ULONGLONG RecordCount;
+    INT ReturnValue;
+    struct timespec Sleep;
+    SP_TRACE_STATE_INFORMATION State;
+    ULONG TimeLimit;
+    BOOL TraceEnabled;
+
+    Buffer = NULL;
+    EventMask = SP_TRACE_EVENT_MASK_ALL;
+    File = NULL;
+    OutputPath = KTRACE_DEFAULT_OUTPUT;
+    Records = 0;
+    RecordCount = 0;
+    ReturnValue = 0;
+    TimeLimit = 0;
+    TraceEnabled = FALSE;
+
+    //
+    // Process the control arguments.
+    //
+
+    while (TRUE) {
+        Option = getopt_long(ArgumentCount,
+                             Arguments,
+                             KTRACE_OPTIONS_STRING,
+                             KtraceLongOptions,
+                             NULL);
+
+        if (Option == -1) {
+            break;
+        }
+
+        if ((Option == '?') || (Option == ':')) {
+            ReturnValue = 1;
+            goto MainEnd;
+        }
+
+        switch (Option) {
+        case 'e':
+            ReturnValue = KtraceParseEvents(optarg, &EventMask);
+            if (ReturnValue != 0) {
+                goto MainEnd;
+            }
+
+            break;
+
+        case 'o':
+            OutputPath = optarg;
+            break;
+
+        case 's':
+            Records = strtoul(optarg, NULL, 0);
+            if (Records == 0) {
+                PRINT_ERROR("Invalid buffer size: %s\n", optarg);
+                ReturnValue = 1;
+                goto MainEnd;
+            }
+
+            break;
+
+        case 't':
+            TimeLimit = strtoul(optarg, NULL, 0);
+            if (TimeLimit == 0) {
+                PRINT_ERROR("Invalid time: %s\n", optarg);
+                ReturnValue = 1;
+                goto MainEnd;
+            }
+
+            break;
+
+        case 'V':
+            printf("ktrace version %d.%02d\n",
+                   KTRACE_VERSION_MAJOR,
+                   KTRACE_VERSION_MINOR);
+
+            ReturnValue = 1;
+            goto MainEnd;
+
+        case 'h':
+            printf(KTRACE_USAGE);
+            return 1;
+
+        default:
+
+            assert(FALSE);
+
+            ReturnValue = 1;
+            goto MainEnd;
+        }
+    }
+
+    File = fopen(OutputPath, "wb");
+    if (File == NULL) {
+        ReturnValue = errno;
+        PRINT_ERROR("Failed to open %s: %s.\n",
+                    OutputPath,
+                    strerror(ReturnValue));
+
+        goto MainEnd;
+    }
+
+    //
+    // Write a placeholder header, which is filled in once the capture is
+    // complete.
+    //
+
+    memset(&Header, 0, sizeof(SP_TRACE_FILE_HEADER));
+    if (fwrite(&Header, sizeof(SP_TRACE_FILE_HEADER), 1, File) != 1) {
+        ReturnValue = errno;
+        PRINT_ERROR("Failed to write %s: %s.\n",
+                    OutputPath,
+                    strerror(ReturnValue));
+
+        goto MainEnd;
+    }
+
+    //
+    // Enable the requested events, then throw away anything left in the
+    // buffers from an earlier capture.
+    //
+
+    memset(&State, 0, sizeof(SP_TRACE_STATE_INFORMATION));
+    State.EnabledEvents = EventMask;
+    State.RecordsPerProcessor = Records;
+    ReturnValue = KtraceGetSetState(&State, TRUE);
+    if (ReturnValue != 0) {
+        goto MainEnd;
+    }
+
+    TraceEnabled = TRUE;
+    BufferCount = State.RecordsPerProcessor * State.ProcessorCount;
+    if (BufferCount > KTRACE_MAX_READ_RECORDS) {
+        BufferCount = KTRACE_MAX_READ_RECORDS;
+    }
+
+    Buffer = malloc(BufferCount * sizeof(SP_TRACE_RECORD));
+    if (Buffer == NULL) {
+        ReturnValue = ENOMEM;
+        PRINT_ERROR("Failed to allocate buffer.\n");
+        goto MainEnd;
+    }
+
+    ReturnValue = KtraceDrain(NULL, Buffer, BufferCount, NULL);
+    if (ReturnValue != 0) {
+        goto MainEnd;
+    }
+
+    ReturnValue = KtraceGetSetState(&State, FALSE);
+    if (ReturnValue != 0) {
+        goto MainEnd;
+    }
+
+    InitialLost = State.LostRecords;
+    signal(SIGINT, KtraceSignalHandler);
+    printf("Capturing trace events to %s. Press Ctrl+C to stop.\n",
+           OutputPath);
+
+    //
+    // Drain the buffers periodically until the time runs out or the user
+    // interrupts the capture.
+    //
+
+    Elapsed = 0;
+    Sleep.tv_sec = 0;
+    Sleep.tv_nsec = KTRACE_DRAIN_INTERVAL * 1000000;
+    while (KtraceInterrupted == 0) {
+        if ((TimeLimit != 0) && (Elapsed >= TimeLimit * 1000)) {
+            break;
+        }
+
+        nanosleep(&Sleep, NULL);
+        Elapsed += KTRACE_DRAIN_INTERVAL;
+        ReturnValue = KtraceDrain(File, Buffer, BufferCount, &RecordCount);
+        if (ReturnValue != 0) {
+            goto MainEnd;
+        }
+    }
+
+    //
+    // Stop tracing and collect whatever is left.
+    //
+
+    State.EnabledEvents = 0;
+    State.RecordsPerProcessor = 0;
+    ReturnValue = KtraceGetSetState(&State, TRUE);
+    if (ReturnValue != 0) {
+        goto MainEnd;
+    }
+
+    TraceEnabled = FALSE;
+    ReturnValue = KtraceDrain(File, Buffer, BufferCount, &RecordCount);
+    if (ReturnValue != 0) {
+        goto MainEnd;
+    }
+
+    ReturnValue = KtraceGetSetState(&State, FALSE);
+    if (ReturnValue != 0) {
+        goto MainEnd;
+    }
+
+    Header.Magic = SP_TRACE_FILE_MAGIC;
+    Header.Version = SP_TRACE_FILE_VERSION;
+    Header.HeaderSize = sizeof(SP_TRACE_FILE_HEADER);
+    Header.RecordSize = sizeof(SP_TRACE_RECORD);
+    Header.ProcessorCount = State.ProcessorCount;
+    Header.EnabledEvents = EventMask;
+    Header.TimeCounterFrequency = State.TimeCounterFrequency;
+    Header.RecordCount = RecordCount;
+    Header.LostRecords = State.LostRecords - InitialLost;
+    if ((fseek(File, 0, SEEK_SET) != 0) ||
+        (fwrite(&Header, sizeof(SP_TRACE_FILE_HEADER), 1, File) != 1)) {
+
+        ReturnValue = errno;
+        PRINT_ERROR("Failed to write %s: %s.\n",
+                    OutputPath,
+                    strerror(ReturnValue));
+
+        goto MainEnd;
+    }
+
+    printf("Captured %llu records, %llu lost.\n",
+           Header.RecordCount,
+           Header.LostRecords);
+
+MainEnd:
+    if (TraceEnabled != FALSE) {
+        State.EnabledEvents = 0;
+        State.RecordsPerProcessor = 0;
+        KtraceGetSetState(&State, TRUE);
+    }
+
+    if (Buffer != NULL) {
+        free(Buffer);
+    }
+
+    if (File != NULL) {
+        fclose(File);
+    }
+
+    return ReturnValue;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+INT
+KtraceParseEvents (
+    PSTR Argument,
+    PULONG EventMask
+    )
+
+/*++
+
+Routine Description:
+
+    This routine parses a comma separated list of event group names.
+
+Arguments:
+
+    Argument - Supplies the list of event group names. This string is
+        modified.
+
+    EventMask - Supplies a pointer where the mask of events is returned.
+
+Return Value:
+
+    0 on success.
+
+    Non-zero on failure.
+
+--*/
+
+{
+
+    ULONG Index;
+    ULONG Mask;
+    PSTR Name;
+
+    Mask = 0;
+    Name = strtok(Argument, ",");
+    while (Name != NULL) {
+        for (Index = 0; Index < KTRACE_EVENT_GROUP_COUNT; Index += 1) {
+            if (strcasecmp(Name, KtraceEventGroups[Index].Name) == 0) {
+                Mask |= KtraceEventGroups[Index].EventMask;
+                break;
+            }
+        }
+
+        if (Index == KTRACE_EVENT_GROUP_COUNT) {
+            PRINT_ERROR("Invalid event type: %s\n", Name);
+            return 1;
+        }
+
+        Name = strtok(NULL, ",");
+    }
+
+    if (Mask == 0) {
+        PRINT_ERROR("No events specified.\n");
+        return 1;
+    }
+
+    *EventMask = Mask;
+    return 0;
+}
+
+INT
+KtraceGetSetState (
+    PSP_TRACE_STATE_INFORMATION State,
+    BOOL Set
+    )
+
+/*++
+
+Routine Description:
+
+    This routine gets or sets the kernel's event tracing state.
+
+Arguments:
+
+    State - Supplies a pointer to the state to set. On return, contains the
+        current state.
+
+    Set - Supplies a boolean indicating whether to set the state (TRUE) or
+        just get it (FALSE).
+
+Return Value:
+
+    0 on success.
+
+    Returns an error number on failure.
+
+--*/
+
+{
+
+    INT ReturnValue;
+    UINTN Size;
+    KSTATUS Status;
+
+    Size = sizeof(SP_TRACE_STATE_INFORMATION);
+    Status = OsGetSetSystemInformation(SystemInformationSp,
+                                       SpInformationTraceState,
+                                       State,
+                                       &Size,
+                                       Set);
+
+    if (!KSUCCESS(Status)) {
+        ReturnValue = ClConvertKstatusToErrorNumber(Status);
+        PRINT_ERROR("Failed to %s trace state: %s.\n",
+                    (Set != FALSE) ? "set" : "get",
+                    strerror(ReturnValue));
+
+        return ReturnValue;
+    }
+
+    return 0;
+}
+
+INT
+KtraceDrain (
+    FILE *File,
+    PSP_TRACE_RECORD Buffer,
+    ULONG BufferCount,
+    PULONGLONG RecordCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine reads trace records from the kernel until its buffers are
+    empty.
+
+Arguments:
+
+    File - Supplies an optional pointer to the file to write the records to.
+        If NULL, the records are discarded.
+
+    Buffer - Supplies a pointer to the buffer to read records into.
+
+    BufferCount - Supplies the number of records the buffer holds.
+
+    RecordCount - Supplies an optional pointer to a count that is incremented
+        by the number of records written.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error number on failure.
+
+--*/
+
+{
+
+    ULONG Count;
+    INT ReturnValue;
+    UINTN Size;
+    KSTATUS Status;
+
+    do {
+        Size = BufferCount * sizeof(SP_TRACE_RECORD);
+        Status = OsGetSetSystemInformation(SystemInformationSp,
+                                           SpInformationTraceRead,
+                                           Buffer,
+                                           &Size,
+                                           FALSE);
+
+        if (!KSUCCESS(Status)) {
+            ReturnValue = ClConvertKstatusToErrorNumber(Status);
+            PRINT_ERROR("Failed to read trace records: %s.\n",
+                        strerror(ReturnValue));
+
+            return ReturnValue;
+        }
+
+        Count = Size / sizeof(SP_TRACE_RECORD);
+        if ((File != NULL) && (Count != 0)) {
+            if (fwrite(Buffer, sizeof(SP_TRACE_RECORD), Count, File) != Count) {
+                ReturnValue = errno;
+                PRINT_ERROR("Failed to write trace records: %s.\n",
+                            strerror(ReturnValue));
+
+                return ReturnValue;
+            }
+
+            if (RecordCount != NULL) {
+                *RecordCount += Count;
+            }
+        }
+
+    } while (Count == BufferCount);
+
+    return 0;
+}
+
+void
+KtraceSignalHandler (
+    int Signal
+    )
+
+/*++
+
+Routine Description:
+
+    This routine handles the interrupt signal by stopping the capture.
+
+Arguments:
+
+    Signal - Supplies the signal number.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    KtraceInterrupted = 1;
+    return;
+}
+
@@ -0,0 +1,1396 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU Lesser General Public
+    License version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details.
+
+Module Name:
+
+    aio.c
+
+Abstract:
+
+    This module implements POSIX asynchronous I/O on top of a kernel I/O ring.
+    Requests are queued into the ring's submission queue and handed to the
+    kernel in batches. Results are reaped from the completion queue without a
+    system call whenever the kernel has already posted them. While requests
+    are outstanding, a service thread keeps entering the ring so that they
+    complete and signal without the application calling back in.
+
+Author:
+
+    agent 19-Oct-2026
+
+Environment:
+
+    User Mode C Library
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include "libcp.h"
+#include <aio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// Define the sizes of the process-wide ring's queues. The completion queue is
+// larger so that a full submission queue never stalls on unreaped results.
+//
+
+#define CL_AIO_SUBMISSION_COUNT 64
+#define CL_AIO_COMPLETION_COUNT 128
+
+//
+// Define the longest time a waiter blocks in the kernel at once, so that it
+// periodically comes back to notice newly queued requests.
+//
+
+#define CL_AIO_WAIT_SLICE 20
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+INT
+ClpAioQueueSingle (
+    struct aiocb *Control,
+    IO_RING_OPERATION Operation
+    );
+
+INT
+ClpAioQueue (
+    struct aiocb *Control,
+    IO_RING_OPERATION Operation
+    );
+
+INT
+ClpAioWait (
+    const struct aiocb *const List[],
+    int Count,
+    BOOL WaitAll,
+    ULONG TimeoutInMilliseconds
+    );
+
+BOOL
+ClpAioIsDone (
+    const struct aiocb *const List[],
+    int Count,
+    BOOL WaitAll
+    );
+
+KSTATUS
+ClpAioEnter (
+    ULONG MinimumCompletions,
+    ULONG TimeoutInMilliseconds
+    );
+
+ULONG
+ClpAioReap (
+    VOID
+    );
+
+VOID
+ClpAioNotify (
+    VOID
+    );
+
+VOID
+ClpAioStartService (
+    VOID
+    );
+
+void *
+ClpAioServiceThread (
+    void *Parameter
+    );
+
+VOID
+ClpAioInitialize (
+    VOID
+    );
+
+VOID
+ClpAioForkChild (
+    VOID
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// Store the lock that protects the user mode side of the ring and the lists
+// of requests.
+//
+
+pthread_mutex_t ClAioLock = PTHREAD_MUTEX_INITIALIZER;
+
+//
+// Store the lock held by the thread inside the kernel. The kernel requires
+// that only one thread enter a ring at a time. If both locks are needed, this
+// one is acquired first.
+//
+
+pthread_mutex_t ClAioEnterLock = PTHREAD_MUTEX_INITIALIZER;
+
+//
+// Store the process-wide I/O ring and its queues.
+//
+
+IO_RING ClAioRing;
+IO_RING_SUBMISSION ClAioSubmissions[CL_AIO_SUBMISSION_COUNT];
+IO_RING_SUBMISSION ClAioPending[CL_AIO_SUBMISSION_COUNT];
+IO_RING_COMPLETION ClAioCompletions[CL_AIO_COMPLETION_COUNT];
+
+//
+// Store the list of requests handed to the ring that have not completed.
+//
+
+struct aiocb *ClAioOutstanding;
+
+//
+// Store the list of completed requests whose signal has not yet been sent.
+// These still report EINPROGRESS until their notification goes out, so that
+// the application cannot free them while they are being looked at.
+//
+
+struct aiocb *ClAioNotifyList;
+
+//
+// Store whether the service thread is running. It exits once nothing is
+// outstanding, and is started again by the next request that does not
+// complete right away.
+//
+
+BOOL ClAioServiceRunning;
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+LIBC_API
+int
+aio_read (
+    struct aiocb *Control
+    )
+
+/*++
+
+Routine Description:
+
+    This routine queues an asynchronous read of aio_nbytes from the file
+    descriptor into the buffer, starting at the given file offset.
+
+Arguments:
+
+    Control - Supplies a pointer to the control block describing the read.
+        This must remain valid until the operation completes.
+
+Return Value:
+
+    0 if the request was queued.
+
+    -1 on failure, and errno will be set to contain more information.
+
+--*/
+
+{
+
+    return ClpAioQueueSingle(Control, IoRingOperationRead);
+}
+
+LIBC_API
+int
+aio_write (
+    struct aiocb *Control
+    )
+
+/*++
+
+Routine Description:
+
+    This routine queues an asynchronous write of aio_nbytes from the buffer to
+    the file descriptor, starting at the given file offset.
+
+Arguments:
+
+    Control - Supplies a pointer to the control block describing the write.
+        This must remain valid until the operation completes.
+
+Return Value:
+
+    0 if the request was queued.
+
+    -1 on failure, and errno will be set to contain more information.
+
+--*/
+
+{
+
+    return ClpAioQueueSingle(Control, IoRingOperationWrite);
+}
+
+LIBC_API
+int
+aio_fsync (
+    int Operation,
+    struct aiocb *Control
+    )
+
+/*++
+
+Routine Description:
+
+    This routine queues an asynchronous flush of the file descriptor's data
+    to its backing device.
+
+Arguments:
+
+    Operation - Supplies the type of synchronization, either O_SYNC or
+        O_DSYNC. Both are treated the same.
+
+    Control - Supplies a pointer to the control block. Only the file
+        descriptor and signal event are used.
+
+Return Value:
+
+    0 if the request was queued.
+
+    -1 on failure, and errno will be set to contain more information.
+
+--*/
+
+{
+
+    if ((Operation != O_SYNC) && (Operation != O_DSYNC)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return ClpAioQueueSingle(Control, IoRingOperationFlush);
+}
+
+LIBC_API
+int
+aio_error (
+    const struct aiocb *Control
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the error status of an asynchronous I/O operation.
+
+Arguments:
+
+    Control - Supplies a pointer to the control block of the operation.
+
+Return Value:
+
+    0 if the operation completed successfully.
+
+    EINPROGRESS if the operation has not yet completed.
+
+    Returns the error number the operation failed with otherwise.
+
+--*/
+
+{
+
+    if (Control->__aio_error != EINPROGRESS) {
+        return Control->__aio_error;
+    }
+
+    //
+    // Pick up anything the kernel has already posted. The service thread
+    // normally drives outstanding operations, but if it could not be started
+    // then give the kernel a chance to retry them here.
+    //
+
+    pthread_mutex_lock(&ClAioLock);
+    ClpAioReap();
+    if ((Control->__aio_error == EINPROGRESS) &&
+        (ClAioServiceRunning == FALSE)) {
+
+        ClpAioEnter(0, 0);
+    }
+
+    pthread_mutex_unlock(&ClAioLock);
+    ClpAioNotify();
+    return Control->__aio_error;
+}
+
+LIBC_API
+ssize_t
+aio_return (
+    struct aiocb *Control
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the final return value of a completed asynchronous
+    I/O operation. It should be called exactly once per operation, after
+    aio_error no longer returns EINPROGRESS.
+
+Arguments:
+
+    Control - Supplies a pointer to the control block of the operation.
+
+Return Value:
+
+    Returns the value the equivalent read, write, or fsync call would have
+    returned.
+
+    -1 if the operation is still in progress, and errno will be set to EINVAL.
+
+--*/
+
+{
+
+    if (Control->__aio_error == EINPROGRESS) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return Control->__aio_return;
+}
+
+LIBC_API
+int
+aio_suspend (
+    const struct aiocb *const List[],
+    int Count,
+    const struct timespec *Timeout
+    )
+
+/*++
+
+Routine Description:
+
+    This routine waits until at least one of the given asynchronous I/O
+    operations has completed.
+
+Arguments:
+
+    List - Supplies an array of control block pointers. Null entries are
+        ignored.
+
+    Count - Supplies the number of elements in the array.
+
+    Timeout - Supplies an optional pointer to the relative time to wait. Supply
+        NULL to wait indefinitely.
+
+Return Value:
+
+    0 if at least one operation has completed.
+
+    -1 on failure, and errno will be set to contain more information. EAGAIN
+    means the timeout expired, and EINTR means a signal arrived.
+
+--*/
+
+{
+
+    INT Result;
+    ULONG TimeoutInMilliseconds;
+
+    if (Count < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    Result = ClpConvertSpecificTimeoutToSystemTimeout(Timeout,
+                                                      &TimeoutInMilliseconds);
+
+    if (Result != 0) {
+        errno = Result;
+        return -1;
+    }
+
+    Result = ClpAioWait(List, Count, FALSE, TimeoutInMilliseconds);
+    if (Result != 0) {
+        errno = Result;
+        return -1;
+    }
+
+    return 0;
+}
+
+LIBC_API
+int
+aio_cancel (
+    int FileDescriptor,
+    struct aiocb *Control
+    )
+
+/*++
+
+Routine Description:
+
+    This routine attempts to cancel outstanding asynchronous I/O operations.
+    Operations are handed to the kernel as soon as they are queued, so this
+    routine can only report whether they have completed.
+
+Arguments:
+
+    FileDescriptor - Supplies the file descriptor whose operations should be
+        canceled.
+
+    Control - Supplies an optional pointer to a specific operation to cancel.
+        If NULL, all operations on the file descriptor are considered.
+
+Return Value:
+
+    AIO_ALLDONE if all operations have already completed.
+
+    AIO_NOTCANCELED if at least one operation is still in progress.
+
+    -1 on failure, and errno will be set to contain more information.
+
+--*/
+
+{
+
+    struct aiocb *Current;
+    int Result;
+
+    if (fcntl(FileDescriptor, F_GETFD) < 0) {
+        return -1;
+    }
+
+    if ((Control != NULL) && (Control->aio_fildes != FileDescriptor)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    Result = AIO_ALLDONE;
+    pthread_mutex_lock(&ClAioLock);
+    ClpAioReap();
+    ClpAioEnter(0, 0);
+    if (Control != NULL) {
+        if (Control->__aio_error == EINPROGRESS) {
+            Result = AIO_NOTCANCELED;
+        }
+
+    } else {
+        Current = ClAioOutstanding;
+        while (Current != NULL) {
+            if (Current->aio_fildes == FileDescriptor) {
+                Result = AIO_NOTCANCELED;
+                break;
+            }
+
+            Current = Current->__aio_next;
+        }
+    }
+
+    pthread_mutex_unlock(&ClAioLock);
+    ClpAioNotify();
+    return Result;
+}
+
+LIBC_API
+int
+lio_listio (
+    int Mode,
+    struct aiocb *const List[],
+    int Count,
+    struct sigevent *Event
+    )
+
+/*++
+
+Routine Description:
+
+    This routine queues a list of asynchronous I/O operations with a single
+    call into the kernel.
+
+Arguments:
+
+    Mode - Supplies whether to wait for all the operations to complete
+        (LIO_WAIT) or to return as soon as they are queued (LIO_NOWAIT).
+
+    List - Supplies an array of control block pointers. The aio_lio_opcode
+        member of each determines the operation. Null entries are ignored.
+
+    Count - Supplies the number of elements in the array.
+
+    Event - Supplies an optional signal event to deliver when all operations
+        complete. Only NULL or SIGEV_NONE are supported.
+
+Return Value:
+
+    0 on success.
+
+    -1 on failure, and errno will be set to contain more information. Check
+    each operation with aio_error to determine which ones failed.
+
+--*/
+
+{
+
+    struct aiocb *Control;
+    INT Error;
+    INT Failure;
+    int Index;
+    IO_RING_OPERATION Operation;
+
+    if (((Mode != LIO_WAIT) && (Mode != LIO_NOWAIT)) || (Count < 0) ||
+        ((Event != NULL) && (Event->sigev_notify != SIGEV_NONE))) {
+
+        errno = EINVAL;
+        return -1;
+    }
+
+    Failure = 0;
+    pthread_mutex_lock(&ClAioLock);
+    for (Index = 0; Index < Count; Index += 1) {
+        Control = List[Index];
+        if ((Control == NULL) || (Control->aio_lio_opcode == LIO_NOP)) {
+            continue;
+        }
+
+        if (Control->aio_lio_opcode == LIO_READ) {
+            Operation = IoRingOperationRead;
+
+        } else if (Control->aio_lio_opcode == LIO_WRITE) {
+            Operation = IoRingOperationWrite;
+
+        } else {
+            Control->__aio_return = -1;
+            Control->__aio_error = EINVAL;
+            Failure = EIO;
+            continue;
+        }
+
+        Error = ClpAioQueue(Control, Operation);
+        if (Error != 0) {
+            Control->__aio_return = -1;
+            Control->__aio_error = Error;
+            if (Error == EAGAIN) {
+                Failure = EAGAIN;
+
+            } else if (Failure == 0) {
+                Failure = EIO;
+            }
+        }
+    }
+
+    //
+    // Hand the whole batch to the kernel at once.
+    //
+
+    ClpAioEnter(0, 0);
+    ClpAioStartService();
+    pthread_mutex_unlock(&ClAioLock);
+    ClpAioNotify();
+    if (Mode == LIO_WAIT) {
+        Error = ClpAioWait((const struct aiocb *const *)List,
+                           Count,
+                           TRUE,
+                           SYS_WAIT_TIME_INDEFINITE);
+
+        if (Error != 0) {
+            errno = Error;
+            return -1;
+        }
+
+        //
+        // In wait mode, report failure if any individual operation failed.
+        //
+
+        for (Index = 0; Index < Count; Index += 1) {
+            Control = List[Index];
+            if ((Control != NULL) && (Control->aio_lio_opcode != LIO_NOP) &&
+                (Control->__aio_error != 0)) {
+
+                Failure = EIO;
+                break;
+            }
+        }
+    }
+
+    if (Failure != 0) {
+        errno = Failure;
+        return -1;
+    }
+
+    return 0;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+INT
+ClpAioQueueSingle (
+    struct aiocb *Control,
+    IO_RING_OPERATION Operation
+    )
+
+/*++
+
+Routine Description:
+
+    This routine queues a single asynchronous I/O request and hands it to the
+    kernel.
+
+Arguments:
+
+    Control - Supplies a pointer to the control block.
+
+    Operation - Supplies the ring operation to perform.
+
+Return Value:
+
+    0 on success.
+
+    -1 on failure, and errno will be set to contain more information.
+
+--*/
+
+{
+
+    INT Error;
+
+    pthread_mutex_lock(&ClAioLock);
+    Error = ClpAioQueue(Control, Operation);
+    if (Error == 0) {
+        ClpAioEnter(0, 0);
+        ClpAioStartService();
+    }
+
+    pthread_mutex_unlock(&ClAioLock);
+    ClpAioNotify();
+    if (Error != 0) {
+        errno = Error;
+        return -1;
+    }
+
+    return 0;
+}
+
+INT
+ClpAioQueue (
+    struct aiocb *Control,
+    IO_RING_OPERATION Operation
+    )
+
+/*++
+
+Routine Description:
+
+    This routine validates a control block and adds it to the submission
+    queue. The caller must hold the ring lock, and is responsible for
+    entering the ring to actually submit it.
+
+Arguments:
+
+    Control - Supplies a pointer to the control block.
+
+    Operation - Supplies the ring operation to perform.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error number on failure.
+
+--*/
+
+{
+
+    ULONG Index;
+    struct sigevent *Event;
+    PIO_RING_SUBMISSION Submission;
+
+    if (Control == NULL) {
+        return EINVAL;
+    }
+
+    if (Operation != IoRingOperationFlush) {
+        if ((Control->aio_offset < 0) ||
+            (Control->aio_nbytes > (size_t)SSIZE_MAX)) {
+
+            return EINVAL;
+        }
+    }
+
+    Event = &(Control->aio_sigevent);
+    if ((Event->sigev_notify != SIGEV_NONE) &&
+        ((Event->sigev_notify != SIGEV_SIGNAL) ||
+         (Event->sigev_signo < 0) || (Event->sigev_signo >= NSIG))) {
+
+        return EINVAL;
+    }
+
+    if (Control->aio_fildes < 0) {
+        return EBADF;
+    }
+
+    ClpAioInitialize();
+
+    //
+    // If the submission queue is full, let the kernel drain it first.
+    //
+
+    if (ClAioRing.SubmissionTail - ClAioRing.SubmissionHead >=
+        ClAioRing.SubmissionCount) {
+
+        ClpAioEnter(0, 0);
+        if (ClAioRing.SubmissionTail - ClAioRing.SubmissionHead >=
+            ClAioRing.SubmissionCount) {
+
+            return EAGAIN;
+        }
+    }
+
+    Index = ClAioRing.SubmissionTail & (ClAioRing.SubmissionCount - 1);
+    Submission = &(ClAioRing.Submissions[Index]);
+    Submission->UserData = (UINTN)Control;
+    Submission->Offset = Control->aio_offset;
+    Submission->Buffer = (PVOID)(Control->aio_buf);
+    Submission->Size = Control->aio_nbytes;
+    Submission->Handle = (HANDLE)(UINTN)(Control->aio_fildes);
+    Submission->Operation = Operation;
+    Control->__aio_return = 0;
+    Control->__aio_error = EINPROGRESS;
+    Control->__aio_next = ClAioOutstanding;
+    ClAioOutstanding = Control;
+
+    //
+    // Another thread may be in the kernel reading the ring, so make sure the
+    // entry is filled in before it is published.
+    //
+
+    RtlMemoryBarrier();
+    ClAioRing.SubmissionTail += 1;
+    return 0;
+}
+
+INT
+ClpAioWait (
+    const struct aiocb *const List[],
+    int Count,
+    BOOL WaitAll,
+    ULONG TimeoutInMilliseconds
+    )
+
+/*++
+
+Routine Description:
+
+    This routine waits for operations in a list to complete.
+
+Arguments:
+
+    List - Supplies an array of control block pointers. Null entries are
+        ignored.
+
+    Count - Supplies the number of elements in the array.
+
+    WaitAll - Supplies a boolean indicating whether to wait for all of the
+        operations (TRUE) or any one of them (FALSE).
+
+    TimeoutInMilliseconds - Supplies the number of milliseconds to wait, or
+        SYS_WAIT_TIME_INDEFINITE to wait forever.
+
+Return Value:
+
+    0 once the wait is satisfied.
+
+    EAGAIN if the timeout expired.
+
+    EINTR if a signal arrived.
+
+--*/
+
+{
+
+    ULONGLONG CurrentTime;
+    ULONGLONG EndTime;
+    ULONGLONG Frequency;
+    KSTATUS Status;
+    ULONG WaitTime;
+
+    EndTime = 0;
+    Frequency = 0;
+    if ((TimeoutInMilliseconds != 0) &&
+        (TimeoutInMilliseconds != SYS_WAIT_TIME_INDEFINITE)) {
+
+        Frequency = OsGetTimeCounterFrequency();
+        EndTime = OsQueryTimeCounter() +
+                  ((TimeoutInMilliseconds * Frequency) /
+                   MILLISECONDS_PER_SECOND);
+    }
+
+    while (TRUE) {
+        if (ClpAioIsDone(List, Count, WaitAll) != FALSE) {
+            return 0;
+        }
+
+        WaitTime = TimeoutInMilliseconds;
+        if ((TimeoutInMilliseconds != 0) &&
+            (TimeoutInMilliseconds != SYS_WAIT_TIME_INDEFINITE)) {
+
+            CurrentTime = OsQueryTimeCounter();
+            WaitTime = 0;
+            if (CurrentTime < EndTime) {
+                WaitTime = ((EndTime - CurrentTime) *
+                            MILLISECONDS_PER_SECOND) / Frequency;
+            }
+        }
+
+        if (WaitTime > CL_AIO_WAIT_SLICE) {
+            WaitTime = CL_AIO_WAIT_SLICE;
+        }
+
+        pthread_mutex_lock(&ClAioLock);
+        ClpAioReap();
+        Status = STATUS_SUCCESS;
+        if (ClpAioIsDone(List, Count, WaitAll) == FALSE) {
+            Status = ClpAioEnter(1, WaitTime);
+        }
+
+        pthread_mutex_unlock(&ClAioLock);
+        ClpAioNotify();
+        if (Status == STATUS_INTERRUPTED) {
+            return EINTR;
+        }
+
+        if ((WaitTime == 0) && (ClpAioIsDone(List, Count, WaitAll) == FALSE)) {
+            return EAGAIN;
+        }
+    }
+
+    return 0;
+}
+
+BOOL
+ClpAioIsDone (
+    const struct aiocb *const List[],
+    int Count,
+    BOOL WaitAll
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines whether the operations in a list have completed.
+
+Arguments:
+
+    List - Supplies an array of control block pointers. Null entries are
+        ignored.
+
+    Count - Supplies the number of elements in the array.
+
+    WaitAll - Supplies a boolean indicating whether all of the operations
+        (TRUE) or any one of them (FALSE) must be complete.
+
+Return Value:
+
+    TRUE if the condition is satisfied.
+
+    FALSE if the caller needs to keep waiting.
+
+--*/
+
+{
+
+    int Index;
+
+    for (Index = 0; Index < Count; Index += 1) {
+        if (List[Index] == NULL) {
+            continue;
+        }
+
+        if (List[Index]->__aio_error == EINPROGRESS) {
+            if (WaitAll != FALSE) {
+                return FALSE;
+            }
+
+        } else if (WaitAll == FALSE) {
+            return TRUE;
+        }
+    }
+
+    return WaitAll;
+}
+
+KSTATUS
+ClpAioEnter (
+    ULONG MinimumCompletions,
+    ULONG TimeoutInMilliseconds
+    )
+
+/*++
+
+Routine Description:
+
+    This routine enters the ring, handing the kernel any queued submissions,
+    and reaps the completions it posts. The caller must hold the ring lock.
+    The ring lock is dropped while the kernel waits, so other threads can
+    keep queuing and reaping requests. If another thread is already in the
+    ring, no wait was requested, and the submission queue has room, this
+    routine returns immediately; that thread will pick up the new submissions
+    when it comes around.
+
+Arguments:
+
+    MinimumCompletions - Supplies the number of completions to wait for.
+
+    TimeoutInMilliseconds - Supplies the number of milliseconds to wait for
+        them.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    ULONG Queued;
+    ULONG Reaped;
+    KSTATUS Status;
+    BOOL Wait;
+
+    if (ClAioRing.SubmissionCount == 0) {
+        return STATUS_SUCCESS;
+    }
+
+    Wait = FALSE;
+    if ((MinimumCompletions != 0) && (TimeoutInMilliseconds != 0)) {
+        Wait = TRUE;
+    }
+
+    if (pthread_mutex_trylock(&ClAioEnterLock) != 0) {
+        Queued = ClAioRing.SubmissionTail - ClAioRing.SubmissionHead;
+        if ((Wait == FALSE) && (Queued < ClAioRing.SubmissionCount)) {
+            return STATUS_SUCCESS;
+        }
+
+        //
+        // Respect the lock order, and don't bother waiting if whoever was in
+        // the ring already brought back some completions.
+        //
+
+        pthread_mutex_unlock(&ClAioLock);
+        pthread_mutex_lock(&ClAioEnterLock);
+        pthread_mutex_lock(&ClAioLock);
+        if ((Wait != FALSE) && (ClpAioReap() != 0)) {
+            pthread_mutex_unlock(&ClAioEnterLock);
+            return STATUS_SUCCESS;
+        }
+    }
+
+    while (TRUE) {
+        if (Wait != FALSE) {
+            pthread_mutex_unlock(&ClAioLock);
+        }
+
+        Status = OsIoRingEnter(&ClAioRing,
+                               MinimumCompletions,
+                               TimeoutInMilliseconds,
+                               NULL);
+
+        if (Wait != FALSE) {
+            pthread_mutex_lock(&ClAioLock);
+        }
+
+        Reaped = ClpAioReap();
+
+        //
+        // The kernel stops consuming submissions when the completion queue
+        // fills up. Go around again if reaping made room for more.
+        //
+
+        if ((!KSUCCESS(Status)) || (Reaped == 0) ||
+            (ClAioRing.SubmissionHead == ClAioRing.SubmissionTail)) {
+
+            break;
+        }
+
+        MinimumCompletions = 0;
+        TimeoutInMilliseconds = 0;
+        Wait = FALSE;
+    }
+
+    pthread_mutex_unlock(&ClAioEnterLock);
+    return Status;
+}
+
+ULONG
+ClpAioReap (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine consumes the completion queue, recording each result in its
+    control block. The caller must hold the ring lock.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the number of completions reaped.
+
+--*/
+
+{
+
+    PIO_RING_COMPLETION Completion;
+    struct aiocb *Control;
+    ULONG Count;
+    INT Error;
+    ULONG Index;
+    struct aiocb **Previous;
+    ssize_t Result;
+
+    Count = 0;
+    while (ClAioRing.CompletionHead != ClAioRing.CompletionTail) {
+        Index = ClAioRing.CompletionHead & (ClAioRing.CompletionCount - 1);
+        Completion = &(ClAioRing.Completions[Index]);
+        Control = (struct aiocb *)(UINTN)(Completion->UserData);
+        Result = Completion->Result;
+        ClAioRing.CompletionHead += 1;
+        Count += 1;
+        if (Control == NULL) {
+            continue;
+        }
+
+        Previous = &ClAioOutstanding;
+        while ((*Previous != NULL) && (*Previous != Control)) {
+            Previous = &((*Previous)->__aio_next);
+        }
+
+        if (*Previous == NULL) {
+            continue;
+        }
+
+        *Previous = Control->__aio_next;
+        Control->__aio_next = NULL;
+        Error = 0;
+        if (Result < 0) {
+            Error = ClConvertKstatusToErrorNumber((KSTATUS)Result);
+            Result = -1;
+        }
+
+        //
+        // Requests that want a signal stay in progress until the signal is
+        // sent. Stash a negative error number in the return value until then.
+        //
+
+        if ((Control->aio_sigevent.sigev_notify == SIGEV_SIGNAL) &&
+            (Control->aio_sigevent.sigev_signo != 0)) {
+
+            if (Error != 0) {
+                Result = -Error;
+            }
+
+            Control->__aio_return = Result;
+            Control->__aio_next = ClAioNotifyList;
+            ClAioNotifyList = Control;
+
+        } else {
+            Control->__aio_return = Result;
+            RtlMemoryBarrier();
+            Control->__aio_error = Error;
+        }
+    }
+
+    return Count;
+}
+
+VOID
+ClpAioNotify (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine completes requests that asked for a signal, and sends the
+    signal. It must be called without the ring lock held, since the signal
+    handler may call back into the asynchronous I/O routines.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    struct aiocb *Control;
+    struct aiocb *Next;
+    ssize_t Result;
+    int Signal;
+    union sigval Value;
+
+    if (ClAioNotifyList == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&ClAioLock);
+    Control = ClAioNotifyList;
+    ClAioNotifyList = NULL;
+    pthread_mutex_unlock(&ClAioLock);
+
+    //
+    // Read everything needed out of the control block before marking it
+    // complete, as the application may reuse it right away.
+    //
+
+    while (Control != NULL) {
+        Next = Control->__aio_next;
+        Signal = Control->aio_sigevent.sigev_signo;
+        Value = Control->aio_sigevent.sigev_value;
+        Result = Control->__aio_return;
+        Control->__aio_next = NULL;
+        if (Result < 0) {
+            Control->__aio_return = -1;
+            RtlMemoryBarrier();
+            Control->__aio_error = -Result;
+
+        } else {
+            RtlMemoryBarrier();
+            Control->__aio_error = 0;
+        }
+
+        sigqueue(getpid(), Signal, Value);
+        Control = Next;
+    }
+
+    return;
+}
+
+VOID
+ClpAioStartService (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine starts the service thread if there are outstanding requests
+    and it is not already running. The caller must hold the ring lock.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    pthread_attr_t Attributes;
+    sigset_t BlockAll;
+    sigset_t OriginalMask;
+    int Result;
+    pthread_t Thread;
+
+    if ((ClAioServiceRunning != FALSE) || (ClAioOutstanding == NULL)) {
+        return;
+    }
+
+    //
+    // Create the thread with every signal blocked so that the application's
+    // handlers never run on it. It inherits the mask from this thread.
+    //
+
+    sigfillset(&BlockAll);
+    pthread_sigmask(SIG_SETMASK, &BlockAll, &OriginalMask);
+    pthread_attr_init(&Attributes);
+    pthread_attr_setdetachstate(&Attributes, PTHREAD_CREATE_DETACHED);
+    Result = pthread_create(&Thread,
+                            &Attributes,
+                            ClpAioServiceThread,
+                            NULL);
+
+    pthread_attr_destroy(&Attributes);
+    pthread_sigmask(SIG_SETMASK, &OriginalMask, NULL);
+    if (Result == 0) {
+        ClAioServiceRunning = TRUE;
+    }
+
+    return;
+}
+
+void *
+ClpAioServiceThread (
+    void *Parameter
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements the service thread, which waits in the ring for
+    outstanding requests to complete, and sends the signals of those that
+    asked for one. It exits when nothing is left outstanding.
+
+Arguments:
+
+    Parameter - Supplies an unused parameter.
+
+Return Value:
+
+    NULL always.
+
+--*/
+
+{
+
+    pthread_mutex_lock(&ClAioLock);
+    while (ClAioOutstanding != NULL) {
+        ClpAioReap();
+        if (ClAioOutstanding != NULL) {
+            ClpAioEnter(1, CL_AIO_WAIT_SLICE);
+        }
+
+        pthread_mutex_unlock(&ClAioLock);
+        ClpAioNotify();
+        pthread_mutex_lock(&ClAioLock);
+    }
+
+    ClAioServiceRunning = FALSE;
+    pthread_mutex_unlock(&ClAioLock);
+    ClpAioNotify();
+    return NULL;
+}
+
+VOID
+ClpAioInitialize (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sets up the process-wide I/O ring on first use. The caller
+    must hold the ring lock.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if (ClAioRing.SubmissionCount != 0) {
+        return;
+    }
+
+    ClAioRing.SubmissionCount = CL_AIO_SUBMISSION_COUNT;
+    ClAioRing.CompletionCount = CL_AIO_COMPLETION_COUNT;
+    ClAioRing.Submissions = ClAioSubmissions;
+    ClAioRing.Completions = ClAioCompletions;
+    ClAioRing.Pending = ClAioPending;
+    pthread_atfork(NULL, NULL, ClpAioForkChild);
+    return;
+}
+
+VOID
+ClpAioForkChild (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine resets the I/O ring in a newly forked child. Asynchronous
+    operations are not inherited, so any the parent had outstanding are
+    marked canceled in the child's copy of memory.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    struct aiocb *Control;
+    struct aiocb *Next;
+    ULONG Pass;
+
+    pthread_mutex_init(&ClAioLock, NULL);
+    pthread_mutex_init(&ClAioEnterLock, NULL);
+    ClAioServiceRunning = FALSE;
+    for (Pass = 0; Pass < 2; Pass += 1) {
+        if (Pass == 0) {
+            Control = ClAioOutstanding;
+            ClAioOutstanding = NULL;
+
+        } else {
+            Control = ClAioNotifyList;
+            ClAioNotifyList = NULL;
+        }
+
+        while (Control != NULL) {
+            Next = Control->__aio_next;
+            Control->__aio_next = NULL;
+            Control->__aio_return = -1;
+            Control->__aio_error = ECANCELED;
+            Control = Next;
+        }
+    }
+
+    ClAioRing.SubmissionHead = 0;
+    ClAioRing.SubmissionTail = 0;
+    ClAioRing.CompletionHead = 0;
+    ClAioRing.CompletionTail = 0;
+    ClAioRing.PendingCount = 0;
+    return;
+}
+
@@ -100,6 +100,7 @@ function build() {
     ];
 
     sources = [
+        "aio.c",
         "assert.c",
         "brk.c",
         "bsearch.c",
@@ -149,6 +150,7 @@ function build() {
         "random.c",
         "realpath.c",
         "regexcmp.c",
+        "regexdfa.c",
         "regexexe.c",
         "resolv.c",
         "resource.c",
@@ -189,11 +191,13 @@ function build() {
         "getopt.c",
         "qsort.c",
         "regexcmp.c",
+        "regexdfa.c",
         "regexexe.c"
     ];
 
     wincsupSources = [
         "regexcmp.c",
+        "regexdfa.c",
         "regexexe.c",
         "wincsup/strftime.c"
     ];
@@ -205,7 +209,8 @@ function build() {
             "armv7/fenva.S",
             "armv7/fenvc.c",
             "armv7/setjmpa.S",
-            "armv7/tlsaddr.S"
+            "armv7/tlsaddr.S",
+            "armv7/vforka.S"
         ];
 
     } else if (arch == "x86") {
@@ -215,7 +220,8 @@ function build() {
             "x86/fenv.S",
             "x86/fenvc.c",
             "x86/setjmpa.S",
-            "x86/tlsaddr.S"
+            "x86/tlsaddr.S",
+            "x86/vforka.S"
         ];
 
     } else if (arch == "x64") {
@@ -225,6 +231,7 @@ function build() {
             "x64/fenv.S",
             "x64/setjmpa.S",
             "x64/tlsaddr.S",
+            "x64/vforka.S",
             "x86/fenvc.c",
         ];
     }
@@ -55,7 +55,7 @@ Module Name:
 // ---------------------------------------------------------------- Definitions
 //
 
-#define CL_NETWORK_NAME_FORMAT_COUNT 3
+#define CL_NETWORK_NAME_FORMAT_COUNT 4
 #define CL_NETWORK_NAME_LINK_LAYER_INDEX 0
 #define CL_NETWORK_NAME_DOMAIN_OFFSET 1
 
@@ -119,7 +119,8 @@ ClpDestroyNetworkInterfaceAddress (
 PCSTR ClNetworkNameFormats[CL_NETWORK_NAME_FORMAT_COUNT] = {
     "il%d",
     "eth%d",
-    "wlan%d"
+    "wlan%d",
+    "lo%d"
 };
 
 //
@@ -879,6 +880,7 @@ Return Value:
     ULONG Index;
     NETWORK_DEVICE_INFORMATION Information;
     struct sockaddr_dl *LinkAddress;
+    size_t LinkAddressLength;
     size_t MaxDataLength;
     size_t NameLength;
     struct ifaddrs *NewInterface;
@@ -936,6 +938,10 @@ Return Value:
         NewInterface->ifa_flags |= IFF_RUNNING;
     }
 
+    if (Domain == NetDomainLoopback) {
+        NewInterface->ifa_flags |= IFF_LOOPBACK;
+    }
+
     if (Information.Address.Domain != NetDomainInvalid) {
         NewInterface->ifa_addr = malloc(sizeof(struct sockaddr));
         if (NewInterface->ifa_addr == NULL) {
@@ -1031,13 +1037,26 @@ Return Value:
         NewLinkInterface->ifa_flags |= IFF_RUNNING;
     }
 
+    if (Domain == NetDomainLoopback) {
+        NewLinkInterface->ifa_flags |= IFF_LOOPBACK;
+    }
+
     if (Information.PhysicalAddress.Domain != NetDomainInvalid) {
         AllocationSize = sizeof(struct sockaddr_dl);
         MaxDataLength = AllocationSize -
                         FIELD_OFFSET(struct sockaddr_dl, sdl_data);
 
+        //
+        // The loopback link has no hardware address at all.
+        //
+
+        LinkAddressLength = ETHERNET_ADDRESS_SIZE;
+        if (Domain == NetDomainLoopback) {
+            LinkAddressLength = 0;
+        }
+
         NameLength = strlen(NewLinkInterface->ifa_name);
-        DataLength = NameLength + ETHERNET_ADDRESS_SIZE;
+        DataLength = NameLength + LinkAddressLength;
         if (DataLength > MaxDataLength) {
             AllocationSize += DataLength - MaxDataLength;
         }
@@ -1064,17 +1083,20 @@ Return Value:
         LinkAddress->sdl_type = IFT_ETHER;
         if (Information.PhysicalAddress.Domain == NetDomain80211) {
             LinkAddress->sdl_type = IFT_IEEE80211;
+
+        } else if (Information.PhysicalAddress.Domain == NetDomainLoopback) {
+            LinkAddress->sdl_type = IFT_LOOP;
         }
 
         LinkAddress->sdl_nlen = NameLength;
-        LinkAddress->sdl_alen = ETHERNET_ADDRESS_SIZE;
+        LinkAddress->sdl_alen = LinkAddressLength;
         RtlCopyMemory(LinkAddress->sdl_data,
                       NewLinkInterface->ifa_name,
                       NameLength);
 
         RtlCopyMemory(LLADDR(LinkAddress),
                       Information.PhysicalAddress.Address,
-                      ETHERNET_ADDRESS_SIZE);
+                      LinkAddressLength);
 
         NewLinkInterface->ifa_addr = (struct sockaddr *)LinkAddress;
     }
@@ -416,6 +416,48 @@ Return Value:
     return -1;
 }
 
+pid_t
+ClpVfork (
+    PVOID FrameRestoreBase
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements vfork once the architecture specific entry point
+    has captured its caller's stack pointer. At-fork handlers are not run.
+
+Arguments:
+
+    FrameRestoreBase - Supplies the stack pointer of the function that called
+        vfork. The kernel saves the stack below this point before the child
+        borrows it and puts it back before the parent returns.
+
+Return Value:
+
+    Returns 0 to the child process.
+
+    Returns the process ID of the child process to the parent process.
+
+    Returns -1 to the parent process on error, and the errno variable will be
+    set to provide more information about the error.
+
+--*/
+
+{
+
+    INTN Result;
+
+    Result = OsForkProcess(FORK_FLAG_VFORK, FrameRestoreBase);
+    if (Result >= 0) {
+        return Result;
+    }
+
+    errno = ClConvertKstatusToErrorNumber(Result);
+    return -1;
+}
+
 LIBC_API
 uid_t
 getuid (
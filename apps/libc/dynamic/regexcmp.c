@@ -531,6 +531,8 @@ Return Value:
         goto CompileRegularExpressionEnd;
     }
 
+    ClpCompileRegularExpressionProgram(Result);
+
 CompileRegularExpressionEnd:
     if (Status != RegexStatusSuccess) {
         if (Result != NULL) {
@@ -582,6 +584,7 @@ Return Value:
         ClpDestroyRegularExpressionEntry(Entry);
     }
 
+    ClpDestroyRegularExpressionProgram(Expression);
     free(Expression);
     return;
 }
@@ -612,6 +615,7 @@ Return Value:
 
 {
 
+    PREGULAR_EXPRESSION_ENTRY Entry;
     ULONG EntryFlags;
     REGULAR_EXPRESSION_STATUS Status;
 
@@ -642,11 +646,20 @@ Return Value:
     }
 
     //
-    // Parse an optional right anchor.
+    // Parse an optional right anchor. Unlike the left anchor, this goes in as
+    // a real end of string entry so that the matcher backtracks into earlier
+    // choices if the first match found doesn't end at the end of a line.
     //
 
     if (Lexer->Token == '$') {
-        EntryFlags |= REGULAR_EXPRESSION_ANCHORED_RIGHT;
+        Entry = ClpCreateRegularExpressionEntry(RegexEntryStringEnd);
+        if (Entry == NULL) {
+            Status = RegexStatusNoMemory;
+            goto ParseBasicRegularExpressionEnd;
+        }
+
+        Entry->Parent = &(Expression->BaseEntry);
+        INSERT_BEFORE(&(Entry->ListEntry), &(Expression->BaseEntry.ChildList));
         Status = ClpGetRegularExpressionToken(Lexer, Expression);
         if (Status != RegexStatusSuccess) {
             goto ParseBasicRegularExpressionEnd;
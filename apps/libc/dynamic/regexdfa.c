@@ -0,0 +1,2007 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    regexdfa.c
+
+Abstract:
+
+    This module implements the linear time search paths for regular
+    expressions: a required literal prefilter and a lazily built DFA. Both
+    only determine whether or not an expression matches, the backtracking
+    matcher is still used to find submatch locations and to handle back
+    references.
+
+Author:
+
+    agent 19-Oct-2026
+
+Environment:
+
+    User Mode C Library
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <minoca/lib/types.h>
+#include <minoca/lib/status.h>
+#include <minoca/lib/rtl.h>
+
+#include <assert.h>
+#include <ctype.h>
+#include <regex.h>
+#include <stdlib.h>
+#include <string.h>
+#include "regexp.h"
+
+//
+// --------------------------------------------------------------------- Macros
+//
+
+//
+// This macro determines whether or not a byte is in a character set.
+//
+
+#define REGEX_SET_CONTAINS(_Set, _Byte) \
+    (((_Set)->Bits[(_Byte) / 32] & (1UL << ((_Byte) % 32))) != 0)
+
+//
+// This macro adds a byte to a character set.
+//
+
+#define REGEX_SET_ADD(_Set, _Byte) \
+    ((_Set)->Bits[(_Byte) / 32] |= (1UL << ((_Byte) % 32)))
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// Define the value used to terminate lists of instructions waiting to be
+// patched.
+//
+
+#define REGEX_INVALID_INSTRUCTION ((ULONG)-1)
+
+//
+// Define the initial number of instructions and sets allocated.
+//
+
+#define REGEX_INITIAL_PROGRAM_SIZE 32
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+VOID
+ClpRegexFindLiteral (
+    PREGULAR_EXPRESSION_ENTRY Parent,
+    PREGULAR_EXPRESSION_STRING *Literal
+    );
+
+VOID
+ClpRegexPrepareLiteral (
+    PREGULAR_EXPRESSION Expression,
+    PREGULAR_EXPRESSION_STRING Literal
+    );
+
+BOOL
+ClpRegexSearchLiteral (
+    PREGULAR_EXPRESSION Expression,
+    PSTR String,
+    ULONG StringSize
+    );
+
+BOOL
+ClpRegexEmitEntry (
+    PREGULAR_EXPRESSION Expression,
+    PREGEX_PROGRAM Program,
+    PREGULAR_EXPRESSION_ENTRY Entry
+    );
+
+BOOL
+ClpRegexEmitSingle (
+    PREGULAR_EXPRESSION Expression,
+    PREGEX_PROGRAM Program,
+    PREGULAR_EXPRESSION_ENTRY Entry
+    );
+
+BOOL
+ClpRegexEmitSequence (
+    PREGULAR_EXPRESSION Expression,
+    PREGEX_PROGRAM Program,
+    PREGULAR_EXPRESSION_ENTRY Parent
+    );
+
+BOOL
+ClpRegexEmitBranch (
+    PREGULAR_EXPRESSION Expression,
+    PREGEX_PROGRAM Program,
+    PREGULAR_EXPRESSION_ENTRY Branch
+    );
+
+BOOL
+ClpRegexEmitCharacterSet (
+    PREGEX_PROGRAM Program,
+    PREGEX_CHARACTER_SET Set
+    );
+
+ULONG
+ClpRegexAddInstruction (
+    PREGEX_PROGRAM Program,
+    REGEX_OPCODE Opcode
+    );
+
+VOID
+ClpRegexComputeByteClasses (
+    PREGULAR_EXPRESSION Expression,
+    PREGEX_PROGRAM Program
+    );
+
+PREGEX_DFA
+ClpRegexCreateDfa (
+    PREGEX_PROGRAM Program
+    );
+
+VOID
+ClpRegexDestroyDfa (
+    PREGEX_DFA Dfa
+    );
+
+VOID
+ClpRegexFlushDfa (
+    PREGEX_DFA Dfa
+    );
+
+REGEX_SEARCH_RESULT
+ClpRegexRunDfa (
+    PREGULAR_EXPRESSION Expression,
+    PREGEX_DFA Dfa,
+    PSTR String,
+    ULONG StringSize,
+    int Flags
+    );
+
+PREGEX_DFA_STATE
+ClpRegexComputeTransition (
+    PREGULAR_EXPRESSION Expression,
+    PREGEX_DFA Dfa,
+    PREGEX_DFA_STATE State,
+    ULONG Class
+    );
+
+PREGEX_DFA_STATE
+ClpRegexFindState (
+    PREGULAR_EXPRESSION Expression,
+    PREGEX_DFA Dfa,
+    ULONG Context,
+    PULONG Instructions,
+    ULONG Count,
+    PBOOL Flushed
+    );
+
+VOID
+ClpRegexFollow (
+    PREGEX_PROGRAM Program,
+    PREGEX_DFA Dfa,
+    ULONG Instruction,
+    ULONG Context,
+    BOOL NextKnown,
+    PULONG List,
+    PULONG ListSize
+    );
+
+VOID
+ClpRegexStartGeneration (
+    PREGEX_PROGRAM Program,
+    PREGEX_DFA Dfa
+    );
+
+int
+ClpRegexCompareIndices (
+    const void *Left,
+    const void *Right
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+VOID
+ClpCompileRegularExpressionProgram (
+    PREGULAR_EXPRESSION Expression
+    )
+
+/*++
+
+Routine Description:
+
+    This routine builds the automaton form and required literal of a parsed
+    regular expression. Failure is not fatal, the expression simply runs
+    without the faster paths.
+
+Arguments:
+
+    Expression - Supplies a pointer to the parsed regular expression.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PREGULAR_EXPRESSION_STRING Literal;
+    PREGEX_PROGRAM Program;
+    BOOL Result;
+
+    Literal = NULL;
+    ClpRegexFindLiteral(&(Expression->BaseEntry), &Literal);
+    if (Literal != NULL) {
+        ClpRegexPrepareLiteral(Expression, Literal);
+    }
+
+    Program = malloc(sizeof(REGEX_PROGRAM));
+    if (Program == NULL) {
+        return;
+    }
+
+    memset(Program, 0, sizeof(REGEX_PROGRAM));
+    Result = FALSE;
+    if ((Expression->BaseEntry.Flags & REGULAR_EXPRESSION_ANCHORED_LEFT) != 0) {
+        if (ClpRegexAddInstruction(Program, RegexOpLineBegin) ==
+            REGEX_INVALID_INSTRUCTION) {
+
+            goto CompileRegularExpressionProgramEnd;
+        }
+    }
+
+    if (ClpRegexEmitSequence(Expression,
+                             Program,
+                             &(Expression->BaseEntry)) == FALSE) {
+
+        goto CompileRegularExpressionProgramEnd;
+    }
+
+    if (ClpRegexAddInstruction(Program, RegexOpMatch) ==
+        REGEX_INVALID_INSTRUCTION) {
+
+        goto CompileRegularExpressionProgramEnd;
+    }
+
+    ClpRegexComputeByteClasses(Expression, Program);
+    Result = TRUE;
+
+CompileRegularExpressionProgramEnd:
+    if (Result == FALSE) {
+        if (Program->Instructions != NULL) {
+            free(Program->Instructions);
+        }
+
+        if (Program->Sets != NULL) {
+            free(Program->Sets);
+        }
+
+        free(Program);
+        Program = NULL;
+    }
+
+    Expression->Program = Program;
+    return;
+}
+
+VOID
+ClpDestroyRegularExpressionProgram (
+    PREGULAR_EXPRESSION Expression
+    )
+
+/*++
+
+Routine Description:
+
+    This routine destroys the automaton form, DFA cache, and required literal
+    of a regular expression.
+
+Arguments:
+
+    Expression - Supplies a pointer to the regular expression.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PREGEX_PROGRAM Program;
+
+    if (Expression->Literal != NULL) {
+        free(Expression->Literal);
+        Expression->Literal = NULL;
+    }
+
+    Program = Expression->Program;
+    if (Program == NULL) {
+        return;
+    }
+
+    if (Program->Dfa != NULL) {
+        ClpRegexDestroyDfa(Program->Dfa);
+    }
+
+    free(Program->Instructions);
+    free(Program->Sets);
+    free(Program);
+    Expression->Program = NULL;
+    return;
+}
+
+REGEX_SEARCH_RESULT
+ClpSearchRegularExpression (
+    PREGULAR_EXPRESSION Expression,
+    PSTR String,
+    ULONG StringSize,
+    int Flags
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines whether or not a regular expression matches
+    anywhere in the given string without computing where. It runs in time
+    linear in the size of the input.
+
+Arguments:
+
+    Expression - Supplies a pointer to the compiled regular expression.
+
+    String - Supplies a pointer to the input string.
+
+    StringSize - Supplies the size of the input string in bytes, not
+        including the null terminator.
+
+    Flags - Supplies the REG_NOTBOL and REG_NOTEOL execution flags.
+
+Return Value:
+
+    Returns a search result. Unknown is returned if the expression cannot be
+    run as an automaton and the required literal was found, or if memory
+    could not be allocated.
+
+--*/
+
+{
+
+    PREGEX_DFA Dfa;
+    ULONG OriginalBusy;
+    PREGEX_PROGRAM Program;
+    REGEX_SEARCH_RESULT Result;
+
+    //
+    // Any match has to contain the required literal, so if it's not there
+    // there's no point in running anything else.
+    //
+
+    if (Expression->Literal != NULL) {
+        if (ClpRegexSearchLiteral(Expression, String, StringSize) == FALSE) {
+            return RegexSearchNoMatch;
+        }
+    }
+
+    Program = Expression->Program;
+    if (Program == NULL) {
+        return RegexSearchUnknown;
+    }
+
+    //
+    // Try to take ownership of the cached DFA. If another thread is using it,
+    // build a private one rather than waiting around.
+    //
+
+    OriginalBusy = RtlAtomicCompareExchange32(&(Program->DfaBusy), TRUE, FALSE);
+    if (OriginalBusy == FALSE) {
+        Dfa = Program->Dfa;
+        if (Dfa == NULL) {
+            Dfa = ClpRegexCreateDfa(Program);
+            Program->Dfa = Dfa;
+        }
+
+    } else {
+        Dfa = ClpRegexCreateDfa(Program);
+    }
+
+    Result = RegexSearchUnknown;
+    if (Dfa != NULL) {
+        Result = ClpRegexRunDfa(Expression, Dfa, String, StringSize, Flags);
+    }
+
+    if (OriginalBusy == FALSE) {
+        RtlAtomicExchange32(&(Program->DfaBusy), FALSE);
+
+    } else if (Dfa != NULL) {
+        ClpRegexDestroyDfa(Dfa);
+    }
+
+    return Result;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+VOID
+ClpRegexFindLiteral (
+    PREGULAR_EXPRESSION_ENTRY Parent,
+    PREGULAR_EXPRESSION_STRING *Literal
+    )
+
+/*++
+
+Routine Description:
+
+    This routine finds the longest run of ordinary characters that every
+    match of the given sequence of entries must contain.
+
+Arguments:
+
+    Parent - Supplies a pointer to the subexpression whose children form the
+        sequence.
+
+    Literal - Supplies a pointer that on input contains the longest literal
+        found so far, and on output may be updated with a longer one.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PLIST_ENTRY CurrentEntry;
+    PREGULAR_EXPRESSION_ENTRY Entry;
+
+    CurrentEntry = Parent->ChildList.Next;
+    while (CurrentEntry != &(Parent->ChildList)) {
+        Entry = LIST_VALUE(CurrentEntry, REGULAR_EXPRESSION_ENTRY, ListEntry);
+        CurrentEntry = CurrentEntry->Next;
+
+        //
+        // Optional entries don't have to show up in the input. Branches are
+        // also skipped since any one option might be the one that matches.
+        //
+
+        if (Entry->DuplicateMin == 0) {
+            continue;
+        }
+
+        if (Entry->Type == RegexEntryOrdinaryCharacters) {
+            if ((*Literal == NULL) ||
+                (Entry->U.String.Size > (*Literal)->Size)) {
+
+                *Literal = &(Entry->U.String);
+            }
+
+        } else if (Entry->Type == RegexEntrySubexpression) {
+            ClpRegexFindLiteral(Entry, Literal);
+        }
+    }
+
+    return;
+}
+
+VOID
+ClpRegexPrepareLiteral (
+    PREGULAR_EXPRESSION Expression,
+    PREGULAR_EXPRESSION_STRING Literal
+    )
+
+/*++
+
+Routine Description:
+
+    This routine saves the required literal for an expression and builds its
+    Boyer-Moore-Horspool shift table.
+
+Arguments:
+
+    Expression - Supplies a pointer to the regular expression.
+
+    Literal - Supplies a pointer to the required literal.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UCHAR Character;
+    ULONG Index;
+    ULONG Last;
+
+    if (Literal->Size == 0) {
+        return;
+    }
+
+    Expression->Literal = malloc(Literal->Size);
+    if (Expression->Literal == NULL) {
+        return;
+    }
+
+    Expression->LiteralSize = Literal->Size;
+    for (Index = 0; Index < REGEX_CHARACTER_SET_SIZE; Index += 1) {
+        Expression->LiteralSkip[Index] = Literal->Size;
+    }
+
+    //
+    // With case folding on, the literal is stored in lowercase and both cases
+    // of each character get the same shift.
+    //
+
+    Last = Literal->Size - 1;
+    for (Index = 0; Index < Literal->Size; Index += 1) {
+        Character = Literal->Data[Index];
+        if ((Expression->Flags & REG_ICASE) != 0) {
+            Character = tolower(Character);
+        }
+
+        Expression->Literal[Index] = Character;
+        if (Index != Last) {
+            Expression->LiteralSkip[Character] = Last - Index;
+            if ((Expression->Flags & REG_ICASE) != 0) {
+                Expression->LiteralSkip[(UCHAR)toupper(Character)] =
+                                                                 Last - Index;
+            }
+        }
+    }
+
+    return;
+}
+
+BOOL
+ClpRegexSearchLiteral (
+    PREGULAR_EXPRESSION Expression,
+    PSTR String,
+    ULONG StringSize
+    )
+
+/*++
+
+Routine Description:
+
+    This routine uses the Boyer-Moore-Horspool algorithm to determine whether
+    or not the required literal of an expression appears in the input.
+
+Arguments:
+
+    Expression - Supplies a pointer to the regular expression.
+
+    String - Supplies a pointer to the input string.
+
+    StringSize - Supplies the size of the input in bytes, not including the
+        null terminator.
+
+Return Value:
+
+    TRUE if the literal appears in the input.
+
+    FALSE if it does not.
+
+--*/
+
+{
+
+    UCHAR Character;
+    BOOL IgnoreCase;
+    ULONG Index;
+    ULONG Last;
+    PSTR Literal;
+    ULONG Position;
+
+    Literal = Expression->Literal;
+    Last = Expression->LiteralSize - 1;
+    if (StringSize < Expression->LiteralSize) {
+        return FALSE;
+    }
+
+    IgnoreCase = FALSE;
+    if ((Expression->Flags & REG_ICASE) != 0) {
+        IgnoreCase = TRUE;
+    }
+
+    Position = 0;
+    while (Position <= StringSize - Expression->LiteralSize) {
+        Index = Last;
+        while (TRUE) {
+            Character = String[Position + Index];
+            if (IgnoreCase != FALSE) {
+                Character = tolower(Character);
+            }
+
+            if (Character != (UCHAR)(Literal[Index])) {
+                break;
+            }
+
+            if (Index == 0) {
+                return TRUE;
+            }
+
+            Index -= 1;
+        }
+
+        Character = String[Position + Last];
+        Position += Expression->LiteralSkip[Character];
+    }
+
+    return FALSE;
+}
+
+BOOL
+ClpRegexEmitEntry (
+    PREGULAR_EXPRESSION Expression,
+    PREGEX_PROGRAM Program,
+    PREGULAR_EXPRESSION_ENTRY Entry
+    )
+
+/*++
+
+Routine Description:
+
+    This routine emits the instructions for an entry, including its
+    duplication count.
+
+Arguments:
+
+    Expression - Supplies a pointer to the regular expression.
+
+    Program - Supplies a pointer to the program being built.
+
+    Entry - Supplies a pointer to the entry to emit.
+
+Return Value:
+
+    TRUE on success.
+
+    FALSE if the entry cannot be expressed as an automaton or the program got
+    too big.
+
+--*/
+
+{
+
+    ULONG End;
+    ULONG Iteration;
+    ULONG Jump;
+    ULONG PatchList;
+    ULONG Split;
+
+    for (Iteration = 0; Iteration < Entry->DuplicateMin; Iteration += 1) {
+        if (ClpRegexEmitSingle(Expression, Program, Entry) == FALSE) {
+            return FALSE;
+        }
+    }
+
+    //
+    // An unbounded repeat loops back to a split that either runs the entry
+    // again or moves on.
+    //
+
+    if (Entry->DuplicateMax == -1) {
+        Split = ClpRegexAddInstruction(Program, RegexOpSplit);
+        if (Split == REGEX_INVALID_INSTRUCTION) {
+            return FALSE;
+        }
+
+        if (ClpRegexEmitSingle(Expression, Program, Entry) == FALSE) {
+            return FALSE;
+        }
+
+        Jump = ClpRegexAddInstruction(Program, RegexOpJump);
+        if (Jump == REGEX_INVALID_INSTRUCTION) {
+            return FALSE;
+        }
+
+        Program->Instructions[Jump].Next = Split;
+        Program->Instructions[Split].Alternate = Program->InstructionCount;
+        return TRUE;
+    }
+
+    //
+    // A bounded repeat has a number of optional copies, each of which can
+    // skip to the end. The skips are chained through their alternate fields
+    // until the end is known.
+    //
+
+    PatchList = REGEX_INVALID_INSTRUCTION;
+    while (Iteration < Entry->DuplicateMax) {
+        Split = ClpRegexAddInstruction(Program, RegexOpSplit);
+        if (Split == REGEX_INVALID_INSTRUCTION) {
+            return FALSE;
+        }
+
+        Program->Instructions[Split].Alternate = PatchList;
+        PatchList = Split;
+        if (ClpRegexEmitSingle(Expression, Program, Entry) == FALSE) {
+            return FALSE;
+        }
+
+        Iteration += 1;
+    }
+
+    End = Program->InstructionCount;
+    while (PatchList != REGEX_INVALID_INSTRUCTION) {
+        Split = PatchList;
+        PatchList = Program->Instructions[Split].Alternate;
+        Program->Instructions[Split].Alternate = End;
+    }
+
+    return TRUE;
+}
+
+BOOL
+ClpRegexEmitSingle (
+    PREGULAR_EXPRESSION Expression,
+    PREGEX_PROGRAM Program,
+    PREGULAR_EXPRESSION_ENTRY Entry
+    )
+
+/*++
+
+Routine Description:
+
+    This routine emits the instructions for one occurrence of an entry.
+
+Arguments:
+
+    Expression - Supplies a pointer to the regular expression.
+
+    Program - Supplies a pointer to the program being built.
+
+    Entry - Supplies a pointer to the entry to emit.
+
+Return Value:
+
+    TRUE on success.
+
+    FALSE if the entry cannot be expressed as an automaton or the program got
+    too big.
+
+--*/
+
+{
+
+    ULONG Byte;
+    CHAR Character;
+    ULONG Index;
+    REGEX_OPCODE Opcode;
+    REGEX_CHARACTER_SET Set;
+
+    Opcode = RegexOpInvalid;
+    switch (Entry->Type) {
+    case RegexEntryOrdinaryCharacters:
+        for (Index = 0; Index < Entry->U.String.Size; Index += 1) {
+            memset(&Set, 0, sizeof(REGEX_CHARACTER_SET));
+            Character = Entry->U.String.Data[Index];
+            for (Byte = 1; Byte < REGEX_CHARACTER_SET_SIZE; Byte += 1) {
+                if (((CHAR)Byte == Character) ||
+                    (((Expression->Flags & REG_ICASE) != 0) &&
+                     (tolower((CHAR)Byte) == tolower(Character)))) {
+
+                    REGEX_SET_ADD(&Set, Byte);
+                }
+            }
+
+            if (ClpRegexEmitCharacterSet(Program, &Set) == FALSE) {
+                return FALSE;
+            }
+        }
+
+        return TRUE;
+
+    case RegexEntryAnyCharacter:
+        memset(&Set, 0, sizeof(REGEX_CHARACTER_SET));
+        for (Byte = 1; Byte < REGEX_CHARACTER_SET_SIZE; Byte += 1) {
+            if ((Byte != '\n') || ((Expression->Flags & REG_NEWLINE) == 0)) {
+                REGEX_SET_ADD(&Set, Byte);
+            }
+        }
+
+        return ClpRegexEmitCharacterSet(Program, &Set);
+
+    case RegexEntryBracketExpression:
+        memset(&Set, 0, sizeof(REGEX_CHARACTER_SET));
+        for (Byte = 1; Byte < REGEX_CHARACTER_SET_SIZE; Byte += 1) {
+            if (ClpRegularExpressionBracketMatches(Expression,
+                                                   Entry,
+                                                   (CHAR)Byte) != FALSE) {
+
+                REGEX_SET_ADD(&Set, Byte);
+            }
+        }
+
+        return ClpRegexEmitCharacterSet(Program, &Set);
+
+    case RegexEntrySubexpression:
+    case RegexEntryBranchOption:
+        return ClpRegexEmitSequence(Expression, Program, Entry);
+
+    case RegexEntryBranch:
+        return ClpRegexEmitBranch(Expression, Program, Entry);
+
+    case RegexEntryStringBegin:
+        Opcode = RegexOpLineBegin;
+        break;
+
+    case RegexEntryStringEnd:
+        Opcode = RegexOpLineEnd;
+        break;
+
+    case RegexEntryStartOfWord:
+        Opcode = RegexOpWordBegin;
+        break;
+
+    case RegexEntryEndOfWord:
+        Opcode = RegexOpWordEnd;
+        break;
+
+    //
+    // Back references depend on what was matched earlier, which a finite
+    // automaton can't remember.
+    //
+
+    case RegexEntryBackReference:
+    default:
+        return FALSE;
+    }
+
+    if (ClpRegexAddInstruction(Program, Opcode) == REGEX_INVALID_INSTRUCTION) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+BOOL
+ClpRegexEmitSequence (
+    PREGULAR_EXPRESSION Expression,
+    PREGEX_PROGRAM Program,
+    PREGULAR_EXPRESSION_ENTRY Parent
+    )
+
+/*++
+
+Routine Description:
+
+    This routine emits the instructions for each child of an entry in order.
+
+Arguments:
+
+    Expression - Supplies a pointer to the regular expression.
+
+    Program - Supplies a pointer to the program being built.
+
+    Parent - Supplies a pointer to the entry whose children should be
+        emitted.
+
+Return Value:
+
+    TRUE on success.
+
+    FALSE if an entry cannot be expressed as an automaton or the program got
+    too big.
+
+--*/
+
+{
+
+    PLIST_ENTRY CurrentEntry;
+    PREGULAR_EXPRESSION_ENTRY Entry;
+
+    CurrentEntry = Parent->ChildList.Next;
+    while (CurrentEntry != &(Parent->ChildList)) {
+        Entry = LIST_VALUE(CurrentEntry, REGULAR_EXPRESSION_ENTRY, ListEntry);
+        CurrentEntry = CurrentEntry->Next;
+        if (ClpRegexEmitEntry(Expression, Program, Entry) == FALSE) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+BOOL
+ClpRegexEmitBranch (
+    PREGULAR_EXPRESSION Expression,
+    PREGEX_PROGRAM Program,
+    PREGULAR_EXPRESSION_ENTRY Branch
+    )
+
+/*++
+
+Routine Description:
+
+    This routine emits the instructions for a set of alternatives.
+
+Arguments:
+
+    Expression - Supplies a pointer to the regular expression.
+
+    Program - Supplies a pointer to the program being built.
+
+    Branch - Supplies a pointer to the branch entry.
+
+Return Value:
+
+    TRUE on success.
+
+    FALSE if an option cannot be expressed as an automaton or the program got
+    too big.
+
+--*/
+
+{
+
+    PLIST_ENTRY CurrentEntry;
+    ULONG End;
+    ULONG Jump;
+    PREGULAR_EXPRESSION_ENTRY Option;
+    ULONG PatchList;
+    ULONG Split;
+
+    //
+    // Each option but the last is preceded by a split that can skip to the
+    // next option, and followed by a jump to the end. The jumps are chained
+    // through their next fields until the end is known.
+    //
+
+    PatchList = REGEX_INVALID_INSTRUCTION;
+    CurrentEntry = Branch->ChildList.Next;
+    while (CurrentEntry != &(Branch->ChildList)) {
+        Option = LIST_VALUE(CurrentEntry, REGULAR_EXPRESSION_ENTRY, ListEntry);
+        CurrentEntry = CurrentEntry->Next;
+        if (CurrentEntry == &(Branch->ChildList)) {
+            if (ClpRegexEmitEntry(Expression, Program, Option) == FALSE) {
+                return FALSE;
+            }
+
+            break;
+        }
+
+        Split = ClpRegexAddInstruction(Program, RegexOpSplit);
+        if (Split == REGEX_INVALID_INSTRUCTION) {
+            return FALSE;
+        }
+
+        if (ClpRegexEmitEntry(Expression, Program, Option) == FALSE) {
+            return FALSE;
+        }
+
+        Jump = ClpRegexAddInstruction(Program, RegexOpJump);
+        if (Jump == REGEX_INVALID_INSTRUCTION) {
+            return FALSE;
+        }
+
+        Program->Instructions[Jump].Next = PatchList;
+        PatchList = Jump;
+        Program->Instructions[Split].Alternate = Program->InstructionCount;
+    }
+
+    End = Program->InstructionCount;
+    while (PatchList != REGEX_INVALID_INSTRUCTION) {
+        Jump = PatchList;
+        PatchList = Program->Instructions[Jump].Next;
+        Program->Instructions[Jump].Next = End;
+    }
+
+    return TRUE;
+}
+
+BOOL
+ClpRegexEmitCharacterSet (
+    PREGEX_PROGRAM Program,
+    PREGEX_CHARACTER_SET Set
+    )
+
+/*++
+
+Routine Description:
+
+    This routine emits an instruction that matches one character from the
+    given set, sharing the set with any identical one already in the program.
+
+Arguments:
+
+    Program - Supplies a pointer to the program being built.
+
+    Set - Supplies a pointer to the character set.
+
+Return Value:
+
+    TRUE on success.
+
+    FALSE on allocation failure or if the program got too big.
+
+--*/
+
+{
+
+    ULONG Instruction;
+    PVOID NewBuffer;
+    ULONG NewCapacity;
+    ULONG SetIndex;
+
+    for (SetIndex = 0; SetIndex < Program->SetCount; SetIndex += 1) {
+        if (memcmp(&(Program->Sets[SetIndex]),
+                   Set,
+                   sizeof(REGEX_CHARACTER_SET)) == 0) {
+
+            break;
+        }
+    }
+
+    if (SetIndex == Program->SetCount) {
+        if (Program->SetCount == Program->SetCapacity) {
+            NewCapacity = Program->SetCapacity * 2;
+            if (NewCapacity == 0) {
+                NewCapacity = REGEX_INITIAL_PROGRAM_SIZE;
+            }
+
+            NewBuffer = realloc(Program->Sets,
+                                NewCapacity * sizeof(REGEX_CHARACTER_SET));
+
+            if (NewBuffer == NULL) {
+                return FALSE;
+            }
+
+            Program->Sets = NewBuffer;
+            Program->SetCapacity = NewCapacity;
+        }
+
+        memcpy(&(Program->Sets[SetIndex]), Set, sizeof(REGEX_CHARACTER_SET));
+        Program->SetCount += 1;
+    }
+
+    Instruction = ClpRegexAddInstruction(Program, RegexOpCharacterSet);
+    if (Instruction == REGEX_INVALID_INSTRUCTION) {
+        return FALSE;
+    }
+
+    Program->Instructions[Instruction].Set = SetIndex;
+    return TRUE;
+}
+
+ULONG
+ClpRegexAddInstruction (
+    PREGEX_PROGRAM Program,
+    REGEX_OPCODE Opcode
+    )
+
+/*++
+
+Routine Description:
+
+    This routine appends an instruction to a program. The instruction's next
+    field is initialized to point at whatever instruction is added after it.
+
+Arguments:
+
+    Program - Supplies a pointer to the program being built.
+
+    Opcode - Supplies the operation of the new instruction.
+
+Return Value:
+
+    Returns the index of the new instruction.
+
+    REGEX_INVALID_INSTRUCTION on allocation failure or if the program would
+    exceed the maximum size.
+
+--*/
+
+{
+
+    ULONG Index;
+    PREGEX_INSTRUCTION Instruction;
+    PVOID NewBuffer;
+    ULONG NewCapacity;
+
+    if (Program->InstructionCount >= REGEX_PROGRAM_MAX_SIZE) {
+        return REGEX_INVALID_INSTRUCTION;
+    }
+
+    if (Program->InstructionCount == Program->InstructionCapacity) {
+        NewCapacity = Program->InstructionCapacity * 2;
+        if (NewCapacity == 0) {
+            NewCapacity = REGEX_INITIAL_PROGRAM_SIZE;
+        }
+
+        NewBuffer = realloc(Program->Instructions,
+                            NewCapacity * sizeof(REGEX_INSTRUCTION));
+
+        if (NewBuffer == NULL) {
+            return REGEX_INVALID_INSTRUCTION;
+        }
+
+        Program->Instructions = NewBuffer;
+        Program->InstructionCapacity = NewCapacity;
+    }
+
+    Index = Program->InstructionCount;
+    Instruction = &(Program->Instructions[Index]);
+    Instruction->Opcode = Opcode;
+    Instruction->Next = Index + 1;
+    Instruction->Alternate = Index + 1;
+    Instruction->Set = 0;
+    Program->InstructionCount += 1;
+    return Index;
+}
+
+VOID
+ClpRegexComputeByteClasses (
+    PREGULAR_EXPRESSION Expression,
+    PREGEX_PROGRAM Program
+    )
+
+/*++
+
+Routine Description:
+
+    This routine partitions the possible input bytes into classes that no
+    instruction or assertion can tell apart, so that DFA states only need one
+    transition per class rather than one per byte.
+
+Arguments:
+
+    Expression - Supplies a pointer to the regular expression.
+
+    Program - Supplies a pointer to the completed program.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Byte;
+    UCHAR Class;
+    USHORT ClassMap[REGEX_CHARACTER_SET_SIZE * 2];
+    ULONG Context;
+    ULONG Key;
+    BOOL Member;
+    UCHAR NewClass[REGEX_CHARACTER_SET_SIZE];
+    ULONG NewCount;
+    ULONG Split;
+
+    //
+    // Start with every byte in one class, and split the classes by each set
+    // in turn, then by whether or not the byte is a newline or a word
+    // character, which the assertions care about.
+    //
+
+    memset(Program->ByteClass, 0, sizeof(Program->ByteClass));
+    Program->ClassCount = 1;
+    for (Split = 0; Split < Program->SetCount + 2; Split += 1) {
+        memset(ClassMap, 0xFF, sizeof(ClassMap));
+        NewCount = 0;
+        for (Byte = 0; Byte < REGEX_CHARACTER_SET_SIZE; Byte += 1) {
+            if (Split < Program->SetCount) {
+                Member = REGEX_SET_CONTAINS(&(Program->Sets[Split]), Byte);
+
+            } else if (Split == Program->SetCount) {
+                Member = (Byte == '\n');
+
+            } else {
+                Member = REGULAR_EXPRESSION_IS_NAME((CHAR)Byte);
+            }
+
+            Key = (Program->ByteClass[Byte] * 2) + (Member != FALSE);
+            if (ClassMap[Key] == 0xFFFF) {
+                ClassMap[Key] = NewCount;
+                NewCount += 1;
+            }
+
+            NewClass[Byte] = ClassMap[Key];
+        }
+
+        memcpy(Program->ByteClass, NewClass, sizeof(NewClass));
+        Program->ClassCount = NewCount;
+    }
+
+    for (Byte = 0; Byte < REGEX_CHARACTER_SET_SIZE; Byte += 1) {
+        Class = Program->ByteClass[Byte];
+        Program->ClassByte[Class] = Byte;
+        Context = 0;
+        if ((Byte == '\n') && ((Expression->Flags & REG_NEWLINE) != 0)) {
+            Context |= REGEX_CONTEXT_LINE_END;
+        }
+
+        if (REGULAR_EXPRESSION_IS_NAME((CHAR)Byte)) {
+            Context |= REGEX_CONTEXT_NEXT_WORD;
+        }
+
+        Program->ClassContext[Class] = Context;
+    }
+
+    return;
+}
+
+PREGEX_DFA
+ClpRegexCreateDfa (
+    PREGEX_PROGRAM Program
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates an empty DFA cache for a program.
+
+Arguments:
+
+    Program - Supplies a pointer to the program.
+
+Return Value:
+
+    Returns a pointer to the new DFA on success.
+
+    NULL on allocation failure.
+
+--*/
+
+{
+
+    PREGEX_DFA Dfa;
+    ULONG Size;
+
+    Dfa = malloc(sizeof(REGEX_DFA));
+    if (Dfa == NULL) {
+        return NULL;
+    }
+
+    memset(Dfa, 0, sizeof(REGEX_DFA));
+    Size = Program->InstructionCount * sizeof(ULONG);
+    Dfa->Stack = malloc((Program->InstructionCount * 2 + 2) * sizeof(ULONG));
+    Dfa->Mark = malloc(Size);
+    Dfa->Current = malloc(Size);
+    Dfa->Following = malloc(Size);
+    if ((Dfa->Stack == NULL) || (Dfa->Mark == NULL) ||
+        (Dfa->Current == NULL) || (Dfa->Following == NULL)) {
+
+        ClpRegexDestroyDfa(Dfa);
+        return NULL;
+    }
+
+    memset(Dfa->Mark, 0, Size);
+    return Dfa;
+}
+
+VOID
+ClpRegexDestroyDfa (
+    PREGEX_DFA Dfa
+    )
+
+/*++
+
+Routine Description:
+
+    This routine destroys a DFA cache and all of its states.
+
+Arguments:
+
+    Dfa - Supplies a pointer to the DFA to destroy.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ClpRegexFlushDfa(Dfa);
+    if (Dfa->Stack != NULL) {
+        free(Dfa->Stack);
+    }
+
+    if (Dfa->Mark != NULL) {
+        free(Dfa->Mark);
+    }
+
+    if (Dfa->Current != NULL) {
+        free(Dfa->Current);
+    }
+
+    if (Dfa->Following != NULL) {
+        free(Dfa->Following);
+    }
+
+    free(Dfa);
+    return;
+}
+
+VOID
+ClpRegexFlushDfa (
+    PREGEX_DFA Dfa
+    )
+
+/*++
+
+Routine Description:
+
+    This routine destroys all the states in a DFA cache.
+
+Arguments:
+
+    Dfa - Supplies a pointer to the DFA.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Bucket;
+    PREGEX_DFA_STATE NextState;
+    PREGEX_DFA_STATE State;
+
+    for (Bucket = 0; Bucket < REGEX_DFA_HASH_SIZE; Bucket += 1) {
+        State = Dfa->Hash[Bucket];
+        while (State != NULL) {
+            NextState = State->HashNext;
+            free(State);
+            State = NextState;
+        }
+
+        Dfa->Hash[Bucket] = NULL;
+    }
+
+    Dfa->Start[0] = NULL;
+    Dfa->Start[1] = NULL;
+    Dfa->MemoryUsed = 0;
+    return;
+}
+
+REGEX_SEARCH_RESULT
+ClpRegexRunDfa (
+    PREGULAR_EXPRESSION Expression,
+    PREGEX_DFA Dfa,
+    PSTR String,
+    ULONG StringSize,
+    int Flags
+    )
+
+/*++
+
+Routine Description:
+
+    This routine runs the DFA over an input string, building states as they
+    are needed.
+
+Arguments:
+
+    Expression - Supplies a pointer to the regular expression.
+
+    Dfa - Supplies a pointer to the DFA, which the caller owns exclusively.
+
+    String - Supplies a pointer to the input string.
+
+    StringSize - Supplies the size of the input in bytes, not including the
+        null terminator.
+
+    Flags - Supplies the REG_NOTBOL and REG_NOTEOL execution flags.
+
+Return Value:
+
+    Returns the search result.
+
+--*/
+
+{
+
+    PUCHAR ByteClass;
+    ULONG Class;
+    ULONG Context;
+    ULONG Count;
+    BOOL Flushed;
+    ULONG Index;
+    ULONG Instruction;
+    PREGEX_DFA_STATE NextState;
+    ULONG NotBeginning;
+    PREGEX_PROGRAM Program;
+    PREGEX_DFA_STATE State;
+
+    Program = Expression->Program;
+    NotBeginning = 0;
+    if ((Flags & REG_NOTBOL) != 0) {
+        NotBeginning = 1;
+    }
+
+    //
+    // Find or build the start state, which is everything reachable from the
+    // first instruction before any input is consumed.
+    //
+
+    State = Dfa->Start[NotBeginning];
+    if (State == NULL) {
+        Context = 0;
+        if (NotBeginning == 0) {
+            Context = REGEX_CONTEXT_LINE_BEGIN;
+        }
+
+        ClpRegexStartGeneration(Program, Dfa);
+        Count = 0;
+        ClpRegexFollow(Program,
+                       Dfa,
+                       0,
+                       Context,
+                       FALSE,
+                       Dfa->Following,
+                       &Count);
+
+        State = ClpRegexFindState(Expression,
+                                  Dfa,
+                                  Context,
+                                  Dfa->Following,
+                                  Count,
+                                  &Flushed);
+
+        if (State == NULL) {
+            return RegexSearchUnknown;
+        }
+
+        Dfa->Start[NotBeginning] = State;
+    }
+
+    //
+    // Walk the input one byte at a time. This is the hot loop.
+    //
+
+    ByteClass = Program->ByteClass;
+    for (Index = 0; Index < StringSize; Index += 1) {
+        if ((State->Flags & REGEX_DFA_STATE_DEAD) != 0) {
+            return RegexSearchNoMatch;
+        }
+
+        Class = ByteClass[(UCHAR)(String[Index])];
+        NextState = State->Next[Class];
+        if (NextState == NULL) {
+            NextState = ClpRegexComputeTransition(Expression,
+                                                  Dfa,
+                                                  State,
+                                                  Class);
+
+            if (NextState == NULL) {
+                return RegexSearchUnknown;
+            }
+        }
+
+        if (NextState == &(Dfa->Match)) {
+            return RegexSearchMatch;
+        }
+
+        State = NextState;
+    }
+
+    //
+    // Resolve any assertions waiting on the next character now that it's
+    // known to be the end, and see if that completes a match.
+    //
+
+    Context = State->Context;
+    if ((Flags & REG_NOTEOL) == 0) {
+        Context |= REGEX_CONTEXT_LINE_END;
+    }
+
+    ClpRegexStartGeneration(Program, Dfa);
+    Count = 0;
+    for (Index = 0; Index < State->Count; Index += 1) {
+        ClpRegexFollow(Program,
+                       Dfa,
+                       State->Instructions[Index],
+                       Context,
+                       TRUE,
+                       Dfa->Current,
+                       &Count);
+    }
+
+    for (Index = 0; Index < Count; Index += 1) {
+        Instruction = Dfa->Current[Index];
+        if (Program->Instructions[Instruction].Opcode == RegexOpMatch) {
+            return RegexSearchMatch;
+        }
+    }
+
+    return RegexSearchNoMatch;
+}
+
+PREGEX_DFA_STATE
+ClpRegexComputeTransition (
+    PREGULAR_EXPRESSION Expression,
+    PREGEX_DFA Dfa,
+    PREGEX_DFA_STATE State,
+    ULONG Class
+    )
+
+/*++
+
+Routine Description:
+
+    This routine computes and caches the state the DFA moves to when it sees
+    a byte of the given class.
+
+Arguments:
+
+    Expression - Supplies a pointer to the regular expression.
+
+    Dfa - Supplies a pointer to the DFA.
+
+    State - Supplies a pointer to the current state. This may be freed if the
+        cache fills up.
+
+    Class - Supplies the class of the next input byte.
+
+Return Value:
+
+    Returns a pointer to the next state, which is the DFA's match state if a
+    match was found.
+
+    NULL on allocation failure.
+
+--*/
+
+{
+
+    UCHAR Byte;
+    ULONG Context;
+    ULONG CurrentCount;
+    BOOL Flushed;
+    ULONG FollowingCount;
+    ULONG Index;
+    PREGEX_INSTRUCTION Instruction;
+    ULONG NextContext;
+    PREGEX_DFA_STATE NextState;
+    PREGEX_PROGRAM Program;
+
+    Program = Expression->Program;
+    Byte = Program->ClassByte[Class];
+    Context = State->Context | Program->ClassContext[Class];
+
+    //
+    // Now that the next character is known, resolve the assertions that
+    // were waiting on it.
+    //
+
+    ClpRegexStartGeneration(Program, Dfa);
+    CurrentCount = 0;
+    for (Index = 0; Index < State->Count; Index += 1) {
+        ClpRegexFollow(Program,
+                       Dfa,
+                       State->Instructions[Index],
+                       Context,
+                       TRUE,
+                       Dfa->Current,
+                       &CurrentCount);
+    }
+
+    //
+    // The context for the next state comes from the byte being consumed.
+    //
+
+    NextContext = 0;
+    if ((Program->ClassContext[Class] & REGEX_CONTEXT_LINE_END) != 0) {
+        NextContext |= REGEX_CONTEXT_LINE_BEGIN;
+    }
+
+    if ((Program->ClassContext[Class] & REGEX_CONTEXT_NEXT_WORD) != 0) {
+        NextContext |= REGEX_CONTEXT_WORD;
+    }
+
+    //
+    // Step every live character set over the byte. A match anywhere means
+    // the search is done. The start is added back in at every position since
+    // a match can begin anywhere.
+    //
+
+    ClpRegexStartGeneration(Program, Dfa);
+    FollowingCount = 0;
+    for (Index = 0; Index < CurrentCount; Index += 1) {
+        Instruction = &(Program->Instructions[Dfa->Current[Index]]);
+        if (Instruction->Opcode == RegexOpMatch) {
+            State->Next[Class] = &(Dfa->Match);
+            return &(Dfa->Match);
+        }
+
+        if ((Instruction->Opcode == RegexOpCharacterSet) &&
+            (REGEX_SET_CONTAINS(&(Program->Sets[Instruction->Set]), Byte))) {
+
+            ClpRegexFollow(Program,
+                           Dfa,
+                           Instruction->Next,
+                           NextContext,
+                           FALSE,
+                           Dfa->Following,
+                           &FollowingCount);
+        }
+    }
+
+    ClpRegexFollow(Program,
+                   Dfa,
+                   0,
+                   NextContext,
+                   FALSE,
+                   Dfa->Following,
+                   &FollowingCount);
+
+    NextState = ClpRegexFindState(Expression,
+                                  Dfa,
+                                  NextContext,
+                                  Dfa->Following,
+                                  FollowingCount,
+                                  &Flushed);
+
+    if ((NextState != NULL) && (Flushed == FALSE)) {
+        State->Next[Class] = NextState;
+    }
+
+    return NextState;
+}
+
+PREGEX_DFA_STATE
+ClpRegexFindState (
+    PREGULAR_EXPRESSION Expression,
+    PREGEX_DFA Dfa,
+    ULONG Context,
+    PULONG Instructions,
+    ULONG Count,
+    PBOOL Flushed
+    )
+
+/*++
+
+Routine Description:
+
+    This routine finds the cached DFA state for a set of instructions, or
+    creates one if there isn't one yet.
+
+Arguments:
+
+    Expression - Supplies a pointer to the regular expression.
+
+    Dfa - Supplies a pointer to the DFA.
+
+    Context - Supplies the context bits describing the previous character.
+
+    Instructions - Supplies the array of instructions in the state. This
+        array will be sorted.
+
+    Count - Supplies the number of instructions in the array.
+
+    Flushed - Supplies a pointer where a boolean will be returned indicating
+        whether the cache was flushed to make room, which frees every
+        previously returned state.
+
+Return Value:
+
+    Returns a pointer to the state.
+
+    NULL on allocation failure.
+
+--*/
+
+{
+
+    ULONG Bucket;
+    ULONG Hash;
+    ULONG Index;
+    PREGEX_PROGRAM Program;
+    UINTN Size;
+    PREGEX_DFA_STATE State;
+
+    *Flushed = FALSE;
+    Program = Expression->Program;
+    qsort(Instructions, Count, sizeof(ULONG), ClpRegexCompareIndices);
+    Hash = 2166136261UL ^ Context;
+    for (Index = 0; Index < Count; Index += 1) {
+        Hash = (Hash ^ Instructions[Index]) * 16777619UL;
+    }
+
+    Bucket = Hash % REGEX_DFA_HASH_SIZE;
+    State = Dfa->Hash[Bucket];
+    while (State != NULL) {
+        if ((State->Hash == Hash) &&
+            (State->Context == Context) &&
+            (State->Count == Count) &&
+            (memcmp(State->Instructions,
+                    Instructions,
+                    Count * sizeof(ULONG)) == 0)) {
+
+            return State;
+        }
+
+        State = State->HashNext;
+    }
+
+    //
+    // Throw the whole cache out if it's gotten too big. This keeps memory
+    // bounded for expressions whose DFA would be enormous, at the cost of
+    // rebuilding states.
+    //
+
+    Size = sizeof(REGEX_DFA_STATE) +
+           (Program->ClassCount * sizeof(PREGEX_DFA_STATE)) +
+           (Count * sizeof(ULONG));
+
+    if (Dfa->MemoryUsed + Size > REGEX_DFA_MEMORY_LIMIT) {
+        ClpRegexFlushDfa(Dfa);
+        *Flushed = TRUE;
+    }
+
+    State = malloc(Size);
+    if (State == NULL) {
+        return NULL;
+    }
+
+    memset(State, 0, Size);
+    State->Hash = Hash;
+    State->Context = Context;
+    State->Count = Count;
+    State->Next = (PREGEX_DFA_STATE *)(State + 1);
+    State->Instructions = (PULONG)(State->Next + Program->ClassCount);
+    memcpy(State->Instructions, Instructions, Count * sizeof(ULONG));
+
+    //
+    // With nothing live, only a new line beginning could bring the start back
+    // to life, so without REG_NEWLINE there's no hope of a match.
+    //
+
+    if ((Count == 0) && ((Expression->Flags & REG_NEWLINE) == 0)) {
+        State->Flags |= REGEX_DFA_STATE_DEAD;
+    }
+
+    State->HashNext = Dfa->Hash[Bucket];
+    Dfa->Hash[Bucket] = State;
+    Dfa->MemoryUsed += Size;
+    return State;
+}
+
+VOID
+ClpRegexFollow (
+    PREGEX_PROGRAM Program,
+    PREGEX_DFA Dfa,
+    ULONG Instruction,
+    ULONG Context,
+    BOOL NextKnown,
+    PULONG List,
+    PULONG ListSize
+    )
+
+/*++
+
+Routine Description:
+
+    This routine adds an instruction and everything reachable from it without
+    consuming input to a list. Assertions that need the next character are
+    added to the list unresolved if the next character isn't known yet.
+
+Arguments:
+
+    Program - Supplies a pointer to the program.
+
+    Dfa - Supplies a pointer to the DFA, whose stack and marks are used.
+
+    Instruction - Supplies the index of the instruction to add.
+
+    Context - Supplies the context bits describing the previous character,
+        and the next character if it's known.
+
+    NextKnown - Supplies a boolean indicating whether or not the next
+        character bits of the context are valid.
+
+    List - Supplies a pointer to the list to add to.
+
+    ListSize - Supplies a pointer to the number of elements in the list,
+        which is updated.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PREGEX_INSTRUCTION Current;
+    ULONG Depth;
+    ULONG Index;
+    BOOL Pass;
+
+    Depth = 0;
+    Dfa->Stack[Depth] = Instruction;
+    Depth += 1;
+    while (Depth != 0) {
+        Depth -= 1;
+        Index = Dfa->Stack[Depth];
+        if (Dfa->Mark[Index] == Dfa->Generation) {
+            continue;
+        }
+
+        Dfa->Mark[Index] = Dfa->Generation;
+        Current = &(Program->Instructions[Index]);
+        Pass = FALSE;
+        switch (Current->Opcode) {
+        case RegexOpJump:
+            Pass = TRUE;
+            break;
+
+        case RegexOpSplit:
+            Dfa->Stack[Depth] = Current->Alternate;
+            Depth += 1;
+            Pass = TRUE;
+            break;
+
+        case RegexOpLineBegin:
+            if ((Context & REGEX_CONTEXT_LINE_BEGIN) != 0) {
+                Pass = TRUE;
+            }
+
+            break;
+
+        case RegexOpLineEnd:
+        case RegexOpWordBegin:
+        case RegexOpWordEnd:
+            if (NextKnown == FALSE) {
+                List[*ListSize] = Index;
+                *ListSize += 1;
+                break;
+            }
+
+            if (Current->Opcode == RegexOpLineEnd) {
+                if ((Context & REGEX_CONTEXT_LINE_END) != 0) {
+                    Pass = TRUE;
+                }
+
+            } else if (Current->Opcode == RegexOpWordBegin) {
+                if (((Context & REGEX_CONTEXT_NEXT_WORD) != 0) &&
+                    ((Context & REGEX_CONTEXT_WORD) == 0)) {
+
+                    Pass = TRUE;
+                }
+
+            } else {
+                if (((Context & REGEX_CONTEXT_WORD) != 0) &&
+                    ((Context & REGEX_CONTEXT_NEXT_WORD) == 0)) {
+
+                    Pass = TRUE;
+                }
+            }
+
+            break;
+
+        case RegexOpCharacterSet:
+        case RegexOpMatch:
+            List[*ListSize] = Index;
+            *ListSize += 1;
+            break;
+
+        default:
+
+            assert(FALSE);
+
+            break;
+        }
+
+        if (Pass != FALSE) {
+            Dfa->Stack[Depth] = Current->Next;
+            Depth += 1;
+        }
+    }
+
+    return;
+}
+
+VOID
+ClpRegexStartGeneration (
+    PREGEX_PROGRAM Program,
+    PREGEX_DFA Dfa
+    )
+
+/*++
+
+Routine Description:
+
+    This routine invalidates all the instruction marks in the DFA so that a
+    new list can be built.
+
+Arguments:
+
+    Program - Supplies a pointer to the program.
+
+    Dfa - Supplies a pointer to the DFA.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    Dfa->Generation += 1;
+    if (Dfa->Generation == 0) {
+        memset(Dfa->Mark, 0, Program->InstructionCount * sizeof(ULONG));
+        Dfa->Generation = 1;
+    }
+
+    return;
+}
+
+int
+ClpRegexCompareIndices (
+    const void *Left,
+    const void *Right
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compares two instruction indices for qsort.
+
+Arguments:
+
+    Left - Supplies a pointer to the left index.
+
+    Right - Supplies a pointer to the right index.
+
+Return Value:
+
+    Returns less than zero, zero, or greater than zero if the left index is
+    less than, equal to, or greater than the right index.
+
+--*/
+
+{
+
+    ULONG LeftIndex;
+    ULONG RightIndex;
+
+    LeftIndex = *((PULONG)Left);
+    RightIndex = *((PULONG)Right);
+    if (LeftIndex < RightIndex) {
+        return -1;
+    }
+
+    if (LeftIndex > RightIndex) {
+        return 1;
+    }
+
+    return 0;
+}
+
@@ -289,6 +289,218 @@ Return Value:
     return Status;
 }
 
+BOOL
+ClpRegularExpressionBracketMatches (
+    PREGULAR_EXPRESSION Expression,
+    PREGULAR_EXPRESSION_ENTRY Entry,
+    CHAR Character
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines if a bracket expression matches a character.
+
+Arguments:
+
+    Expression - Supplies a pointer to the regular expression.
+
+    Entry - Supplies a pointer to the bracket expression entry.
+
+    Character - Supplies the non-null character to test.
+
+Return Value:
+
+    TRUE if the character is matched by the bracket expression, taking
+    negation into account.
+
+    FALSE if the character is not matched.
+
+--*/
+
+{
+
+    PREGULAR_BRACKET_ENTRY BracketEntry;
+    PREGULAR_BRACKET_EXPRESSION BracketExpression;
+    ULONG CharacterCount;
+    ULONG CharacterIndex;
+    PLIST_ENTRY CurrentEntry;
+    PSTR RegularCharacters;
+    REGULAR_EXPRESSION_STATUS Status;
+
+    assert(Entry->Type == RegexEntryBracketExpression);
+
+    Status = RegexStatusNoMatch;
+    BracketExpression = &(Entry->U.BracketExpression);
+    CharacterCount = BracketExpression->RegularCharacters.Size;
+    RegularCharacters = BracketExpression->RegularCharacters.Data;
+
+    //
+    // First match against any of the regular characters.
+    //
+
+    for (CharacterIndex = 0;
+         CharacterIndex < CharacterCount;
+         CharacterIndex += 1) {
+
+        if ((Character == RegularCharacters[CharacterIndex]) ||
+            (((Expression->Flags & REG_ICASE) != 0) &&
+              (tolower(Character) ==
+               tolower(RegularCharacters[CharacterIndex])))) {
+
+            Status = RegexStatusSuccess;
+            goto RegularExpressionBracketMatchesEnd;
+        }
+    }
+
+    //
+    // Go through the list of other stuff and see if any of that matches.
+    //
+
+    CurrentEntry = BracketExpression->EntryList.Next;
+    while (CurrentEntry != &(BracketExpression->EntryList)) {
+        BracketEntry = LIST_VALUE(CurrentEntry,
+                                  REGULAR_BRACKET_ENTRY,
+                                  ListEntry);
+
+        CurrentEntry = CurrentEntry->Next;
+        switch (BracketEntry->Type) {
+        case BracketExpressionRange:
+            if ((Character >= BracketEntry->U.Range.Minimum) &&
+                (Character <= BracketEntry->U.Range.Maximum)) {
+
+                Status = RegexStatusSuccess;
+            }
+
+            break;
+
+        case BracketExpressionCharacterClassAlphanumeric:
+            if (isalnum(Character)) {
+                Status = RegexStatusSuccess;
+            }
+
+            break;
+
+        case BracketExpressionCharacterClassAlphabetic:
+            if (isalpha(Character)) {
+                Status = RegexStatusSuccess;
+            }
+
+            break;
+
+        case BracketExpressionCharacterClassBlank:
+            if (isblank(Character)) {
+                Status = RegexStatusSuccess;
+            }
+
+            break;
+
+        case BracketExpressionCharacterClassControl:
+            if (iscntrl(Character)) {
+                Status = RegexStatusSuccess;
+            }
+
+            break;
+
+        case BracketExpressionCharacterClassDigit:
+            if (isdigit(Character)) {
+                Status = RegexStatusSuccess;
+            }
+
+            break;
+
+        case BracketExpressionCharacterClassGraph:
+            if (isgraph(Character)) {
+                Status = RegexStatusSuccess;
+            }
+
+            break;
+
+        case BracketExpressionCharacterClassLowercase:
+            if ((islower(Character)) ||
+                (((Expression->Flags & REG_ICASE) != 0) &&
+                 (isupper(Character)))) {
+
+                Status = RegexStatusSuccess;
+            }
+
+            break;
+
+        case BracketExpressionCharacterClassPrintable:
+            if (isprint(Character)) {
+                Status = RegexStatusSuccess;
+            }
+
+            break;
+
+        case BracketExpressionCharacterClassPunctuation:
+            if (ispunct(Character)) {
+                Status = RegexStatusSuccess;
+            }
+
+            break;
+
+        case BracketExpressionCharacterClassSpace:
+            if (isspace(Character)) {
+                Status = RegexStatusSuccess;
+            }
+
+            break;
+
+        case BracketExpressionCharacterClassUppercase:
+            if ((isupper(Character)) ||
+                (((Expression->Flags & REG_ICASE) != 0) &&
+                 (islower(Character)))) {
+
+                Status = RegexStatusSuccess;
+            }
+
+            break;
+
+        case BracketExpressionCharacterClassHexDigit:
+            if (isxdigit(Character)) {
+                Status = RegexStatusSuccess;
+            }
+
+            break;
+
+        case BracketExpressionCharacterClassName:
+            if (REGULAR_EXPRESSION_IS_NAME(Character)) {
+                Status = RegexStatusSuccess;
+            }
+
+            break;
+
+        default:
+
+            assert(FALSE);
+
+            goto RegularExpressionBracketMatchesEnd;
+        }
+
+        if (Status == RegexStatusSuccess) {
+            break;
+        }
+    }
+
+RegularExpressionBracketMatchesEnd:
+    if ((Entry->Flags & REGULAR_EXPRESSION_NEGATED) != 0) {
+        if (Status == RegexStatusNoMatch) {
+            Status = RegexStatusSuccess;
+
+        } else if (Status == RegexStatusSuccess) {
+            Status = RegexStatusNoMatch;
+        }
+    }
+
+    if (Status == RegexStatusSuccess) {
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
@@ -337,6 +549,7 @@ Return Value:
     REGULAR_EXPRESSION_EXECUTION Context;
     PLIST_ENTRY FreeEntry;
     size_t MatchIndex;
+    REGEX_SEARCH_RESULT SearchResult;
     ULONG StartIndex;
     REGULAR_EXPRESSION_STATUS Status;
 
@@ -364,6 +577,30 @@ Return Value:
         Context.InternalMatch[MatchIndex].rm_eo = -1;
     }
 
+    //
+    // Run the linear time search first. It can rule out a match entirely,
+    // and if the caller doesn't care where the match is, it can also rule one
+    // in without ever running the backtracking matcher.
+    //
+
+    SearchResult = ClpSearchRegularExpression(RegularExpression,
+                                              String,
+                                              Context.InputSize - 1,
+                                              Flags);
+
+    if (SearchResult == RegexSearchNoMatch) {
+        Status = RegexStatusNoMatch;
+        goto ExecuteRegularExpressionEnd;
+    }
+
+    if ((SearchResult == RegexSearchMatch) &&
+        (((RegularExpression->Flags & REG_NOSUB) != 0) ||
+         (MatchArraySize == 0))) {
+
+        Status = RegexStatusSuccess;
+        goto ExecuteRegularExpressionEnd;
+    }
+
     //
     // Try to match the expression starting at each index.
     //
@@ -394,27 +631,6 @@ Return Value:
                                            &(RegularExpression->BaseEntry));
 
         if (Status == RegexStatusSuccess) {
-
-            //
-            // If the expression is anchored to the right then either:
-            // 1) The index had better be the end and REG_NOTEOL is clear or
-            // 2) REG_NEWLINE is set and it's right before a newline.
-            // If this condition isn't met then it's not a real match.
-            //
-
-            if ((RegularExpression->BaseEntry.Flags &
-                 REGULAR_EXPRESSION_ANCHORED_RIGHT) != 0) {
-
-                if (!(((Context.NextInput == Context.InputSize - 1) &&
-                      ((Flags & REG_NOTEOL) == 0)) ||
-                      (((RegularExpression->Flags & REG_NEWLINE) != 0) &&
-                       (String[Context.NextInput] == '\n')))) {
-
-                    Status = RegexStatusNoMatch;
-                    continue;
-                }
-            }
-
             break;
         }
     }
@@ -430,12 +646,17 @@ Return Value:
             Match[0].rm_so = StartIndex;
             Match[0].rm_eo = Context.NextInput;
         }
+    }
+
+ExecuteRegularExpressionEnd:
 
     //
     // On failure, blank out the matches again.
     //
 
-    } else if ((RegularExpression->Flags & REG_NOSUB) == 0) {
+    if ((Status != RegexStatusSuccess) &&
+        ((RegularExpression->Flags & REG_NOSUB) == 0)) {
+
         for (MatchIndex = 0; MatchIndex < MatchArraySize; MatchIndex += 1) {
             Match[MatchIndex].rm_so = -1;
             Match[MatchIndex].rm_eo = -1;
@@ -490,6 +711,7 @@ Return Value:
     PREGULAR_EXPRESSION_CHOICE CurrentChoice;
     ULONG DuplicateMax;
     ULONG DuplicateMin;
+    BOOL EndEntry;
     ULONG Iteration;
     regmatch_t *Match;
     PREGULAR_EXPRESSION_CHOICE NextChoice;
@@ -499,6 +721,7 @@ Return Value:
     BOOL UseThisEntry;
 
     CurrentChoice = NULL;
+    EndEntry = FALSE;
     Iteration = 0;
     Status = RegexStatusSuccess;
     UseThisEntry = FALSE;
@@ -513,6 +736,15 @@ Return Value:
         DuplicateMin = Entry->DuplicateMin;
         DuplicateMax = Entry->DuplicateMax;
 
+        //
+        // If backtracking just gave up on an iteration of this entry, finish
+        // the entry with the iterations it already has.
+        //
+
+        if (EndEntry != FALSE) {
+            DuplicateMax = Iteration;
+        }
+
         //
         // Try to match this entry if it needs more iterations.
         //
@@ -698,7 +930,8 @@ Return Value:
                 // empty expression. Prevent that from happening infinitely.
                 //
 
-                if ((Context->NextInput == CurrentChoice->SavedNextIndex) &&
+                if ((EndEntry == FALSE) &&
+                    (Context->NextInput == CurrentChoice->SavedNextIndex) &&
                     (DuplicateMax != 1)) {
 
                     assert(CurrentChoice->Node == Entry);
@@ -717,10 +950,16 @@ Return Value:
 
                 //
                 // Splendid, it's time to move forward. If this was a
-                // subexpression, mark its ending.
+                // subexpression, mark its ending. If backtracking left the
+                // entry with no iterations at all, it keeps the match it had
+                // before.
                 //
 
-                ClpRegularExpressionMarkEnd(Context, Entry);
+                if ((EndEntry == FALSE) || (Iteration > 1)) {
+                    ClpRegularExpressionMarkEnd(Context, Entry);
+                }
+
+                EndEntry = FALSE;
 
                 //
                 // Whether the next entry is the sibling or the parent, move the
@@ -852,57 +1091,26 @@ Return Value:
                     }
 
                 //
-                // Try to pop the last repeat off and keep going.
+                // Try to pop the last repeat off and keep going. The entry
+                // then finishes just as if its last iteration had matched, so
+                // enclosing repeats still get to try another iteration
+                // before moving on.
                 //
 
                 } else {
                     if (CurrentChoice->U.Iteration + 1 > Entry->DuplicateMin) {
                         Context->NextInput = CurrentChoice->SavedNextIndex;
-                        NextChoice = CurrentChoice;
-
-                        //
-                        // Move to the next entry.
-                        //
-
-                        while ((Entry->Parent != NULL) &&
-                               ((Entry->Type == RegexEntryBranchOption) ||
-                                (Entry->ListEntry.Next ==
-                                 &(Entry->Parent->ChildList)))) {
+                        Iteration = CurrentChoice->U.Iteration;
+                        NextChoice = CurrentChoice->Parent;
 
-                            if (Entry->Type == RegexEntryBranchOption) {
-                                Entry = Entry->Parent;
-                                continue;
-                            }
+                        assert(NextChoice != NULL);
 
-                            ClpRegularExpressionMarkEnd(Context, Entry);
-                            Entry = Entry->Parent;
-                            NextChoice = NextChoice->Parent;
-                        }
-
-                        ClpRegularExpressionMarkEnd(Context, Entry);
-
-                        //
-                        // If this was the last element, then popping this
-                        // failing iteration causes the expression to pass.
-                        //
-
-                        if (Entry->Parent == NULL) {
-                            Entry = NULL;
-                            Status = RegexStatusSuccess;
-
-                        } else {
-                            Entry = LIST_VALUE(Entry->ListEntry.Next,
-                                               REGULAR_EXPRESSION_ENTRY,
-                                               ListEntry);
-                        }
-
-                        NextChoice = NextChoice->Parent;
                         LIST_REMOVE(&(CurrentChoice->ListEntry));
                         ClpRegularExpressionDestroyChoice(Context,
                                                           CurrentChoice);
 
                         CurrentChoice = NextChoice;
-                        Iteration = 0;
+                        EndEntry = TRUE;
                         break;
                     }
                 }
@@ -1333,14 +1541,8 @@ Return Value:
 
 {
 
-    PREGULAR_BRACKET_ENTRY BracketEntry;
-    PREGULAR_BRACKET_EXPRESSION BracketExpression;
     CHAR Character;
-    ULONG CharacterCount;
-    ULONG CharacterIndex;
-    PLIST_ENTRY CurrentEntry;
-    PSTR RegularCharacters;
-    REGULAR_EXPRESSION_STATUS Status;
+    BOOL Match;
 
     assert(Entry->Type == RegexEntryBracketExpression);
 
@@ -1353,174 +1555,16 @@ Return Value:
         return RegexStatusNoMatch;
     }
 
-    Status = RegexStatusNoMatch;
-    BracketExpression = &(Entry->U.BracketExpression);
-    CharacterCount = BracketExpression->RegularCharacters.Size;
-    RegularCharacters = BracketExpression->RegularCharacters.Data;
-
-    //
-    // First match against any of the regular characters.
-    //
-
-    for (CharacterIndex = 0;
-         CharacterIndex < CharacterCount;
-         CharacterIndex += 1) {
-
-        if ((Character == RegularCharacters[CharacterIndex]) ||
-            (((Context->Expression->Flags & REG_ICASE) != 0) &&
-              (tolower(Character) ==
-               tolower(RegularCharacters[CharacterIndex])))) {
-
-            Status = RegexStatusSuccess;
-            goto RegularExpressionMatchBracketExpressionEnd;
-        }
-    }
-
-    //
-    // Go through the list of other stuff and see if any of that matches.
-    //
-
-    CurrentEntry = BracketExpression->EntryList.Next;
-    while (CurrentEntry != &(BracketExpression->EntryList)) {
-        BracketEntry = LIST_VALUE(CurrentEntry,
-                                  REGULAR_BRACKET_ENTRY,
-                                  ListEntry);
-
-        CurrentEntry = CurrentEntry->Next;
-        switch (BracketEntry->Type) {
-        case BracketExpressionRange:
-            if ((Character >= BracketEntry->U.Range.Minimum) &&
-                (Character <= BracketEntry->U.Range.Maximum)) {
-
-                Status = RegexStatusSuccess;
-            }
+    Match = ClpRegularExpressionBracketMatches(Context->Expression,
+                                               Entry,
+                                               Character);
 
-            break;
-
-        case BracketExpressionCharacterClassAlphanumeric:
-            if (isalnum(Character)) {
-                Status = RegexStatusSuccess;
-            }
-
-            break;
-
-        case BracketExpressionCharacterClassAlphabetic:
-            if (isalpha(Character)) {
-                Status = RegexStatusSuccess;
-            }
-
-            break;
-
-        case BracketExpressionCharacterClassBlank:
-            if (isblank(Character)) {
-                Status = RegexStatusSuccess;
-            }
-
-            break;
-
-        case BracketExpressionCharacterClassControl:
-            if (iscntrl(Character)) {
-                Status = RegexStatusSuccess;
-            }
-
-            break;
-
-        case BracketExpressionCharacterClassDigit:
-            if (isdigit(Character)) {
-                Status = RegexStatusSuccess;
-            }
-
-            break;
-
-        case BracketExpressionCharacterClassGraph:
-            if (isgraph(Character)) {
-                Status = RegexStatusSuccess;
-            }
-
-            break;
-
-        case BracketExpressionCharacterClassLowercase:
-            if ((islower(Character)) ||
-                (((Context->Expression->Flags & REG_ICASE) != 0) &&
-                 (isupper(Character)))) {
-
-                Status = RegexStatusSuccess;
-            }
-
-            break;
-
-        case BracketExpressionCharacterClassPrintable:
-            if (isprint(Character)) {
-                Status = RegexStatusSuccess;
-            }
-
-            break;
-
-        case BracketExpressionCharacterClassPunctuation:
-            if (ispunct(Character)) {
-                Status = RegexStatusSuccess;
-            }
-
-            break;
-
-        case BracketExpressionCharacterClassSpace:
-            if (isspace(Character)) {
-                Status = RegexStatusSuccess;
-            }
-
-            break;
-
-        case BracketExpressionCharacterClassUppercase:
-            if ((isupper(Character)) ||
-                (((Context->Expression->Flags & REG_ICASE) != 0) &&
-                 (islower(Character)))) {
-
-                Status = RegexStatusSuccess;
-            }
-
-            break;
-
-        case BracketExpressionCharacterClassHexDigit:
-            if (isxdigit(Character)) {
-                Status = RegexStatusSuccess;
-            }
-
-            break;
-
-        case BracketExpressionCharacterClassName:
-            if (REGULAR_EXPRESSION_IS_NAME(Character)) {
-                Status = RegexStatusSuccess;
-            }
-
-            break;
-
-        default:
-
-            assert(FALSE);
-
-            goto RegularExpressionMatchBracketExpressionEnd;
-        }
-
-        if (Status == RegexStatusSuccess) {
-            break;
-        }
-    }
-
-RegularExpressionMatchBracketExpressionEnd:
-    if ((Entry->Flags & REGULAR_EXPRESSION_NEGATED) != 0) {
-        if (Status == RegexStatusNoMatch) {
-            Status = RegexStatusSuccess;
-
-        } else if (Status == RegexStatusSuccess) {
-            Status = RegexStatusNoMatch;
-        }
-    }
-
-    if (Status == RegexStatusSuccess) {
-        Context->NextInput += 1;
+    if (Match == FALSE) {
+        return RegexStatusNoMatch;
     }
 
-    return Status;
+    Context->NextInput += 1;
+    return RegexStatusSuccess;
 }
 
 VOID
@@ -48,9 +48,53 @@ Module Name:
 //
 
 #define REGULAR_EXPRESSION_ANCHORED_LEFT 0x00000001
-#define REGULAR_EXPRESSION_ANCHORED_RIGHT 0x00000002
 #define REGULAR_EXPRESSION_NEGATED 0x00000004
 
+//
+// Define the maximum number of instructions in a compiled program. Expressions
+// that need more than this (usually because of large repeat counts) are left
+// to the backtracking matcher.
+//
+
+#define REGEX_PROGRAM_MAX_SIZE 2048
+
+//
+// Define the number of bytes of DFA states that are cached before the cache
+// is thrown out and rebuilt.
+//
+
+#define REGEX_DFA_MEMORY_LIMIT (256 * 1024)
+
+//
+// Define the number of buckets in the DFA state hash table.
+//
+
+#define REGEX_DFA_HASH_SIZE 256
+
+//
+// Define DFA state flags.
+//
+
+#define REGEX_DFA_STATE_DEAD 0x00000001
+
+//
+// Define the context bits that describe the characters surrounding a position
+// in the input. The first two describe the previous character and are part of
+// each DFA state; the last two describe the next character.
+//
+
+#define REGEX_CONTEXT_LINE_BEGIN 0x00000001
+#define REGEX_CONTEXT_WORD 0x00000002
+#define REGEX_CONTEXT_LINE_END 0x00000004
+#define REGEX_CONTEXT_NEXT_WORD 0x00000008
+
+//
+// Define the number of bits in a character set.
+//
+
+#define REGEX_CHARACTER_SET_SIZE 256
+#define REGEX_CHARACTER_SET_WORDS (REGEX_CHARACTER_SET_SIZE / 32)
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -105,6 +149,24 @@ typedef enum _BRACKET_EXPRESSION_TYPE {
     BracketExpressionCharacterClassName
 } BRACKET_EXPRESSION_TYPE, *PBRACKET_EXPRESSION_TYPE;
 
+typedef enum _REGEX_OPCODE {
+    RegexOpInvalid,
+    RegexOpCharacterSet,
+    RegexOpSplit,
+    RegexOpJump,
+    RegexOpLineBegin,
+    RegexOpLineEnd,
+    RegexOpWordBegin,
+    RegexOpWordEnd,
+    RegexOpMatch
+} REGEX_OPCODE, *PREGEX_OPCODE;
+
+typedef enum _REGEX_SEARCH_RESULT {
+    RegexSearchUnknown,
+    RegexSearchNoMatch,
+    RegexSearchMatch
+} REGEX_SEARCH_RESULT, *PREGEX_SEARCH_RESULT;
+
 /*++
 
 Structure Description:
@@ -257,6 +319,192 @@ struct _REGULAR_EXPRESSION_ENTRY {
 
 /*++
 
+Structure Description:
+
+    This structure defines a set of bytes matched by a single program
+    instruction.
+
+Members:
+
+    Bits - Stores the bitmap of member bytes.
+
+--*/
+
+typedef struct _REGEX_CHARACTER_SET {
+    ULONG Bits[REGEX_CHARACTER_SET_WORDS];
+} REGEX_CHARACTER_SET, *PREGEX_CHARACTER_SET;
+
+/*++
+
+Structure Description:
+
+    This structure defines a single instruction in the compiled automaton form
+    of a regular expression.
+
+Members:
+
+    Opcode - Stores the operation this instruction performs.
+
+    Next - Stores the index of the instruction that follows this one. For
+        splits this is the first of the two targets.
+
+    Alternate - Stores the second target for split instructions.
+
+    Set - Stores the index of the character set for character set
+        instructions.
+
+--*/
+
+typedef struct _REGEX_INSTRUCTION {
+    REGEX_OPCODE Opcode;
+    ULONG Next;
+    ULONG Alternate;
+    ULONG Set;
+} REGEX_INSTRUCTION, *PREGEX_INSTRUCTION;
+
+typedef struct _REGEX_DFA_STATE REGEX_DFA_STATE, *PREGEX_DFA_STATE;
+
+/*++
+
+Structure Description:
+
+    This structure defines a lazily built DFA state, which is a set of program
+    instructions that are live at some point in the input.
+
+Members:
+
+    HashNext - Stores a pointer to the next state in the same hash bucket.
+
+    Hash - Stores the hash of the context and instruction set.
+
+    Context - Stores the REGEX_CONTEXT_* bits describing the previous
+        character.
+
+    Flags - Stores REGEX_DFA_STATE_* flags.
+
+    Count - Stores the number of instructions in the set.
+
+    Next - Stores a pointer to the array of transitions, indexed by byte
+        class. NULL entries have not been computed yet.
+
+    Instructions - Stores a pointer to the sorted array of instruction
+        indices in the set. Only character sets, matches, and assertions that
+        depend on the next character appear here.
+
+--*/
+
+struct _REGEX_DFA_STATE {
+    PREGEX_DFA_STATE HashNext;
+    ULONG Hash;
+    ULONG Context;
+    ULONG Flags;
+    ULONG Count;
+    PREGEX_DFA_STATE *Next;
+    PULONG Instructions;
+};
+
+/*++
+
+Structure Description:
+
+    This structure defines the lazily built DFA cache and the scratch space
+    needed to extend it.
+
+Members:
+
+    Hash - Stores the hash table of states.
+
+    MemoryUsed - Stores the number of bytes of states currently allocated.
+
+    Start - Stores the start states, indexed by whether or not REG_NOTBOL was
+        supplied.
+
+    Match - Stores a dummy state that transitions point at when a match has
+        been found.
+
+    Stack - Stores the scratch stack used when following empty transitions.
+
+    Mark - Stores the array of per-instruction generation marks used to avoid
+        visiting an instruction twice.
+
+    Generation - Stores the current mark generation.
+
+    Current - Stores the scratch instruction list being resolved.
+
+    Following - Stores the scratch instruction list being built.
+
+--*/
+
+typedef struct _REGEX_DFA {
+    PREGEX_DFA_STATE Hash[REGEX_DFA_HASH_SIZE];
+    UINTN MemoryUsed;
+    PREGEX_DFA_STATE Start[2];
+    REGEX_DFA_STATE Match;
+    PULONG Stack;
+    PULONG Mark;
+    ULONG Generation;
+    PULONG Current;
+    PULONG Following;
+} REGEX_DFA, *PREGEX_DFA;
+
+/*++
+
+Structure Description:
+
+    This structure defines the automaton form of a regular expression, which
+    can be run in time linear in the input for expressions that do not
+    contain back references.
+
+Members:
+
+    Instructions - Stores the array of instructions. Execution starts at
+        index zero.
+
+    InstructionCount - Stores the number of valid instructions.
+
+    InstructionCapacity - Stores the allocated size of the instruction array
+        in elements.
+
+    Sets - Stores the array of character sets.
+
+    SetCount - Stores the number of valid character sets.
+
+    SetCapacity - Stores the allocated size of the set array in elements.
+
+    ClassCount - Stores the number of byte equivalence classes. Bytes in the
+        same class are indistinguishable to the program.
+
+    ByteClass - Stores the class of each byte.
+
+    ClassByte - Stores a representative byte for each class.
+
+    ClassContext - Stores the REGEX_CONTEXT_LINE_END and
+        REGEX_CONTEXT_NEXT_WORD bits for a character of each class.
+
+    Dfa - Stores a pointer to the cached DFA.
+
+    DfaBusy - Stores a boolean indicating whether a thread is currently using
+        the cached DFA. Other threads build a private DFA instead of waiting.
+
+--*/
+
+typedef struct _REGEX_PROGRAM {
+    PREGEX_INSTRUCTION Instructions;
+    ULONG InstructionCount;
+    ULONG InstructionCapacity;
+    PREGEX_CHARACTER_SET Sets;
+    ULONG SetCount;
+    ULONG SetCapacity;
+    ULONG ClassCount;
+    UCHAR ByteClass[REGEX_CHARACTER_SET_SIZE];
+    UCHAR ClassByte[REGEX_CHARACTER_SET_SIZE];
+    UCHAR ClassContext[REGEX_CHARACTER_SET_SIZE];
+    PREGEX_DFA Dfa;
+    volatile ULONG DfaBusy;
+} REGEX_PROGRAM, *PREGEX_PROGRAM;
+
+/*++
+
 Structure Description:
 
     This structure defines the internal regular expression representation.
@@ -270,12 +518,29 @@ Structure Description:
     BaseEntry - Stores the initial subexpression entry, a slightly modified
         subexpression.
 
+    Program - Stores an optional pointer to the automaton form of the
+        expression. This is NULL if the expression has back references or is
+        too large.
+
+    Literal - Stores an optional pointer to the longest string that must
+        appear in any input the expression matches. This is not null
+        terminated.
+
+    LiteralSize - Stores the size of the required literal in bytes.
+
+    LiteralSkip - Stores the Boyer-Moore-Horspool shift table for the required
+        literal.
+
 --*/
 
 typedef struct _REGULAR_EXPRESSION {
     ULONG SubexpressionCount;
     ULONG Flags;
     REGULAR_EXPRESSION_ENTRY BaseEntry;
+    PREGEX_PROGRAM Program;
+    PSTR Literal;
+    ULONG LiteralSize;
+    ULONG LiteralSkip[REGEX_CHARACTER_SET_SIZE];
 } REGULAR_EXPRESSION, *PREGULAR_EXPRESSION;
 
 //
@@ -285,3 +550,114 @@ typedef struct _REGULAR_EXPRESSION {
 //
 // -------------------------------------------------------- Function Prototypes
 //
+
+VOID
+ClpCompileRegularExpressionProgram (
+    PREGULAR_EXPRESSION Expression
+    );
+
+/*++
+
+Routine Description:
+
+    This routine builds the automaton form and required literal of a parsed
+    regular expression. Failure is not fatal, the expression simply runs
+    without the faster paths.
+
+Arguments:
+
+    Expression - Supplies a pointer to the parsed regular expression.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+ClpDestroyRegularExpressionProgram (
+    PREGULAR_EXPRESSION Expression
+    );
+
+/*++
+
+Routine Description:
+
+    This routine destroys the automaton form, DFA cache, and required literal
+    of a regular expression.
+
+Arguments:
+
+    Expression - Supplies a pointer to the regular expression.
+
+Return Value:
+
+    None.
+
+--*/
+
+REGEX_SEARCH_RESULT
+ClpSearchRegularExpression (
+    PREGULAR_EXPRESSION Expression,
+    PSTR String,
+    ULONG StringSize,
+    int Flags
+    );
+
+/*++
+
+Routine Description:
+
+    This routine determines whether or not a regular expression matches
+    anywhere in the given string without computing where. It runs in time
+    linear in the size of the input.
+
+Arguments:
+
+    Expression - Supplies a pointer to the compiled regular expression.
+
+    String - Supplies a pointer to the input string.
+
+    StringSize - Supplies the size of the input string in bytes, not
+        including the null terminator.
+
+    Flags - Supplies the REG_NOTBOL and REG_NOTEOL execution flags.
+
+Return Value:
+
+    Returns a search result. Unknown is returned if the expression cannot be
+    run as an automaton and the required literal was found, or if memory
+    could not be allocated.
+
+--*/
+
+BOOL
+ClpRegularExpressionBracketMatches (
+    PREGULAR_EXPRESSION Expression,
+    PREGULAR_EXPRESSION_ENTRY Entry,
+    CHAR Character
+    );
+
+/*++
+
+Routine Description:
+
+    This routine determines if a bracket expression matches a character.
+
+Arguments:
+
+    Expression - Supplies a pointer to the regular expression.
+
+    Entry - Supplies a pointer to the bracket expression entry.
+
+    Character - Supplies the non-null character to test.
+
+Return Value:
+
+    TRUE if the character is matched by the bracket expression, taking
+    negation into account.
+
+    FALSE if the character is not matched.
+
+--*/
+
@@ -36,6 +36,7 @@ Module Name:
 #include <fcntl.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/socket.h>
 #include <sys/time.h>
@@ -154,6 +155,16 @@ ClpGetPathFromSocketAddress (
     PUINTN PathSize
     );
 
+int
+ClpSocketPerformBatchIo (
+    int Socket,
+    struct mmsghdr *Messages,
+    unsigned int Count,
+    int Flags,
+    BOOL Write,
+    ULONG TimeoutInMilliseconds
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -587,6 +598,137 @@ Return Value:
     return (int)(UINTN)NewSocket;
 }
 
+LIBC_API
+int
+acceptmany (
+    int Socket,
+    struct acceptent *Entries,
+    unsigned int Count,
+    int Flags
+    )
+
+/*++
+
+Routine Description:
+
+    This routine accepts several pending incoming connections on the given
+    listening socket with a single system call. It blocks (unless the socket
+    is non-blocking) until the first connection arrives, and then also accepts
+    any other connections that are already pending. This is a Minoca extension.
+
+Arguments:
+
+    Socket - Supplies the file descriptor of the listening socket to accept
+        connections on.
+
+    Entries - Supplies an array of entries where the new file descriptors and
+        connecting addresses will be returned.
+
+    Count - Supplies the number of elements in the entry array.
+
+    Flags - Supplies an optional bitfield of flags governing the newly created
+        file descriptors. See accept4.
+
+Return Value:
+
+    Returns the number of connections accepted on success.
+
+    -1 on error, and the errno variable will be set to contain more information.
+
+--*/
+
+{
+
+    UINTN Accepted;
+    struct acceptent *Entry;
+    UINTN Index;
+    PSOCKET_ACCEPT_ENTRY KernelEntries;
+    PSOCKET_ACCEPT_ENTRY KernelEntry;
+    ULONG OpenFlags;
+    KSTATUS Status;
+
+    if ((Entries == NULL) && (Count != 0)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (Count == 0) {
+        return 0;
+    }
+
+    if (Count > SOCKET_BATCH_MAX_COUNT) {
+        Count = SOCKET_BATCH_MAX_COUNT;
+    }
+
+    OpenFlags = 0;
+    if ((Flags & SOCK_CLOEXEC) != 0) {
+        OpenFlags |= SYS_OPEN_FLAG_CLOSE_ON_EXECUTE;
+    }
+
+    if ((Flags & SOCK_NONBLOCK) != 0) {
+        OpenFlags |= SYS_OPEN_FLAG_NON_BLOCKING;
+    }
+
+    KernelEntries = malloc(Count * sizeof(SOCKET_ACCEPT_ENTRY));
+    if (KernelEntries == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    for (Index = 0; Index < Count; Index += 1) {
+        Entry = &(Entries[Index]);
+        KernelEntry = &(KernelEntries[Index]);
+        KernelEntry->NewSocket = INVALID_HANDLE;
+        ClpGetPathFromSocketAddress(Entry->ae_addr,
+                                    &(Entry->ae_addrlen),
+                                    &(KernelEntry->RemotePath),
+                                    &(KernelEntry->RemotePathSize));
+    }
+
+    Status = OsSocketAcceptMultiple((HANDLE)(UINTN)Socket,
+                                    KernelEntries,
+                                    Count,
+                                    OpenFlags,
+                                    &Accepted);
+
+    if (!KSUCCESS(Status)) {
+        free(KernelEntries);
+        if (Status == STATUS_NOT_SUPPORTED) {
+            errno = EOPNOTSUPP;
+
+        } else {
+            errno = ClConvertKstatusToErrorNumber(Status);
+        }
+
+        return -1;
+    }
+
+    //
+    // The new descriptors already exist, so an address that cannot be
+    // converted just comes back empty rather than failing the whole call.
+    //
+
+    for (Index = 0; Index < Accepted; Index += 1) {
+        Entry = &(Entries[Index]);
+        KernelEntry = &(KernelEntries[Index]);
+        Entry->ae_fd = (int)(UINTN)(KernelEntry->NewSocket);
+        if (Entry->ae_addr != NULL) {
+            Status = ClConvertFromNetworkAddress(&(KernelEntry->Address),
+                                                 Entry->ae_addr,
+                                                 &(Entry->ae_addrlen),
+                                                 KernelEntry->RemotePath,
+                                                 KernelEntry->RemotePathSize);
+
+            if (!KSUCCESS(Status)) {
+                Entry->ae_addrlen = 0;
+            }
+        }
+    }
+
+    free(KernelEntries);
+    return (int)Accepted;
+}
+
 LIBC_API
 int
 connect (
@@ -921,6 +1063,53 @@ Return Value:
     return (ssize_t)(Parameters.BytesCompleted);
 }
 
+LIBC_API
+int
+sendmmsg (
+    int Socket,
+    struct mmsghdr *Messages,
+    unsigned int Count,
+    int Flags
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sends several messages out of a socket with a single system
+    call.
+
+Arguments:
+
+    Socket - Supplies the file descriptor of the socket to send data out of.
+
+    Messages - Supplies an array of messages to send. On return, the msg_len
+        member of each message sent contains the number of bytes sent.
+
+    Count - Supplies the number of elements in the message array.
+
+    Flags - Supplies a bitfield of flags governing the transmission of the data.
+        See MSG_* definitions.
+
+Return Value:
+
+    Returns the number of messages sent on success. This may be less than the
+    count if an error occurred partway through.
+
+    -1 on error, and the errno variable will be set to contain more information.
+
+--*/
+
+{
+
+    return ClpSocketPerformBatchIo(Socket,
+                                   Messages,
+                                   Count,
+                                   Flags,
+                                   TRUE,
+                                   SYS_WAIT_TIME_INDEFINITE);
+}
+
 LIBC_API
 ssize_t
 recv (
@@ -1198,6 +1387,68 @@ Return Value:
     return (ssize_t)(Parameters.BytesCompleted);
 }
 
+LIBC_API
+int
+recvmmsg (
+    int Socket,
+    struct mmsghdr *Messages,
+    unsigned int Count,
+    int Flags,
+    struct timespec *Timeout
+    )
+
+/*++
+
+Routine Description:
+
+    This routine receives several messages from a socket with a single system
+    call.
+
+Arguments:
+
+    Socket - Supplies the file descriptor of the socket to receive data from.
+
+    Messages - Supplies an array of initialized messages where the received
+        data will be returned. On return, the msg_len member of each message
+        received contains the number of bytes received.
+
+    Count - Supplies the number of elements in the message array.
+
+    Flags - Supplies a bitfield of flags governing the reception of the data.
+        See MSG_* definitions. MSG_WAITFORONE is also accepted.
+
+    Timeout - Supplies an optional pointer to the maximum amount of time the
+        entire call may take. Supply NULL to wait indefinitely.
+
+Return Value:
+
+    Returns the number of messages received on success.
+
+    -1 on error, and the errno variable will be set to contain more information.
+
+--*/
+
+{
+
+    INT Result;
+    ULONG TimeoutInMilliseconds;
+
+    Result = ClpConvertSpecificTimeoutToSystemTimeout(Timeout,
+                                                      &TimeoutInMilliseconds);
+
+    if (Result != 0) {
+        errno = Result;
+        return -1;
+    }
+
+    return ClpSocketPerformBatchIo(Socket,
+                                   Messages,
+                                   Count,
+                                   Flags,
+                                   FALSE,
+                                   TimeoutInMilliseconds);
+}
+
 LIBC_API
 int
 shutdown (
@@ -2035,3 +2286,217 @@ Return Value:
     return;
 }
 
+int
+ClpSocketPerformBatchIo (
+    int Socket,
+    struct mmsghdr *Messages,
+    unsigned int Count,
+    int Flags,
+    BOOL Write,
+    ULONG TimeoutInMilliseconds
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sends or receives several messages on a socket with a single
+    system call.
+
+Arguments:
+
+    Socket - Supplies the file descriptor of the socket.
+
+    Messages - Supplies the array of messages.
+
+    Count - Supplies the number of elements in the message array.
+
+    Flags - Supplies a bitfield of flags governing the I/O. See MSG_*
+        definitions.
+
+    Write - Supplies a boolean indicating whether to send (TRUE) or receive
+        (FALSE) the messages.
+
+    TimeoutInMilliseconds - Supplies the amount of time the whole call may
+        take, or SYS_WAIT_TIME_INDEFINITE.
+
+Return Value:
+
+    Returns the number of messages processed on success.
+
+    -1 on error, and the errno variable will be set to contain more information.
+
+--*/
+
+{
+
+    PNETWORK_ADDRESS Addresses;
+    UINTN Completed;
+    UINTN Index;
+    PSOCKET_IO_MESSAGE KernelMessage;
+    PSOCKET_IO_MESSAGE KernelMessages;
+    struct msghdr *Message;
+    PSOCKET_IO_PARAMETERS Parameters;
+    KSTATUS Status;
+    UINTN VectorIndex;
+    BOOL WaitForOne;
+
+    if ((Messages == NULL) && (Count != 0)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (Count == 0) {
+        return 0;
+    }
+
+    if (Count > SOCKET_BATCH_MAX_COUNT) {
+        Count = SOCKET_BATCH_MAX_COUNT;
+    }
+
+    ASSERT_SOCKET_IO_FLAGS_ARE_EQUIVALENT();
+
+    WaitForOne = FALSE;
+    if ((Flags & MSG_WAITFORONE) != 0) {
+        if (Write == FALSE) {
+            WaitForOne = TRUE;
+        }
+
+        Flags &= ~MSG_WAITFORONE;
+    }
+
+    //
+    // Allocate the kernel messages and their network addresses together.
+    //
+
+    KernelMessages = malloc(Count *
+                            (sizeof(SOCKET_IO_MESSAGE) +
+                             sizeof(NETWORK_ADDRESS)));
+
+    if (KernelMessages == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    Addresses = (PNETWORK_ADDRESS)(KernelMessages + Count);
+    for (Index = 0; Index < Count; Index += 1) {
+        Message = &(Messages[Index].msg_hdr);
+        KernelMessage = &(KernelMessages[Index]);
+        Parameters = &(KernelMessage->Parameters);
+        Parameters->Size = 0;
+        for (VectorIndex = 0;
+             VectorIndex < Message->msg_iovlen;
+             VectorIndex += 1) {
+
+            Parameters->Size += Message->msg_iov[VectorIndex].iov_len;
+        }
+
+        //
+        // Truncate the byte count, so that it does not exceed the maximum
+        // number of bytes that can be returned.
+        //
+
+        if (Parameters->Size > (UINTN)SSIZE_MAX) {
+            Parameters->Size = (UINTN)SSIZE_MAX;
+        }
+
+        Parameters->BytesCompleted = 0;
+        Parameters->IoFlags = 0;
+        if (Write != FALSE) {
+            Parameters->IoFlags = SYS_IO_FLAG_WRITE;
+        }
+
+        Parameters->SocketIoFlags = Flags;
+        Parameters->TimeoutInMilliseconds = SYS_WAIT_TIME_INDEFINITE;
+        if ((WaitForOne != FALSE) && (Index != 0)) {
+            Parameters->TimeoutInMilliseconds = 0;
+        }
+
+        Parameters->NetworkAddress = NULL;
+        Parameters->RemotePath = NULL;
+        Parameters->RemotePathSize = 0;
+        if ((Message->msg_name != NULL) && (Message->msg_namelen != 0)) {
+            if (Write != FALSE) {
+                Status = ClConvertToNetworkAddress(
+                                            Message->msg_name,
+                                            Message->msg_namelen,
+                                            &(Addresses[Index]),
+                                            &(Parameters->RemotePath),
+                                            &(Parameters->RemotePathSize));
+
+                if (!KSUCCESS(Status)) {
+                    free(KernelMessages);
+                    errno = EINVAL;
+                    return -1;
+                }
+
+            } else {
+                Addresses[Index].Domain = NetDomainInvalid;
+                ClpGetPathFromSocketAddress(Message->msg_name,
+                                            &(Message->msg_namelen),
+                                            &(Parameters->RemotePath),
+                                            &(Parameters->RemotePathSize));
+            }
+
+            Parameters->NetworkAddress = &(Addresses[Index]);
+        }
+
+        Parameters->ControlData = Message->msg_control;
+        Parameters->ControlDataSize = Message->msg_controllen;
+        KernelMessage->VectorArray = (PIO_VECTOR)(Message->msg_iov);
+        KernelMessage->VectorCount = Message->msg_iovlen;
+    }
+
+    Status = OsSocketPerformBatchIo((HANDLE)(UINTN)Socket,
+                                    KernelMessages,
+                                    Count,
+                                    TimeoutInMilliseconds,
+                                    &Completed);
+
+    if (!KSUCCESS(Status)) {
+        free(KernelMessages);
+        if (Status == STATUS_NOT_SUPPORTED) {
+            errno = EOPNOTSUPP;
+
+        } else {
+            errno = ClConvertKstatusToErrorNumber(Status);
+        }
+
+        return -1;
+    }
+
+    for (Index = 0; Index < Completed; Index += 1) {
+        Message = &(Messages[Index].msg_hdr);
+        Parameters = &(KernelMessages[Index].Parameters);
+        Messages[Index].msg_len = Parameters->BytesCompleted;
+        if (Write != FALSE) {
+            continue;
+        }
+
+        Message->msg_flags = Parameters->SocketIoFlags;
+        Message->msg_controllen = Parameters->ControlDataSize;
+
+        //
+        // If requested, attempt to translate the network address provided by
+        // the kernel to a C library socket address.
+        //
+
+        if (Parameters->NetworkAddress != NULL) {
+            Status = ClConvertFromNetworkAddress(Parameters->NetworkAddress,
+                                                 Message->msg_name,
+                                                 &(Message->msg_namelen),
+                                                 Parameters->RemotePath,
+                                                 Parameters->RemotePathSize);
+
+            if (!KSUCCESS(Status)) {
+                free(KernelMessages);
+                errno = EINVAL;
+                return -1;
+            }
+        }
+    }
+
+    free(KernelMessages);
+    return (int)Completed;
+}
+
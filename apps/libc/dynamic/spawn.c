@@ -210,6 +210,35 @@ ClpPosixSpawn (
     BOOL UsePath
     );
 
+BOOL
+ClpPosixSpawnVfork (
+    pid_t *ChildPid,
+    const char *Path,
+    PPOSIX_SPAWN_FILE_ACTION *FileActions,
+    PPOSIX_SPAWN_ATTRIBUTES *Attributes,
+    char *const Arguments[],
+    char *const Environment[],
+    BOOL UsePath,
+    PINT Error
+    );
+
+PSTR
+ClpSpawnSearchPath (
+    const char *File
+    );
+
+BOOL
+ClpSpawnIsScript (
+    const char *Path
+    );
+
+PPROCESS_ENVIRONMENT
+ClpSpawnCreateEnvironment (
+    const char *Path,
+    char *const Arguments[],
+    char *const Environment[]
+    );
+
 INT
 ClpProcessSpawnAttributes (
     PPOSIX_SPAWN_ATTRIBUTES Attributes
@@ -1188,18 +1217,30 @@ Return Value:
     pid_t Pid;
 
     //
-    // TODO: Use vfork when it is implemented.
+    // Most spawns can borrow the parent's address space rather than copying
+    // it. Fall back to a full fork for the cases vfork cannot handle.
     //
 
+    if (ClpPosixSpawnVfork(ChildPid,
+                           Path,
+                           FileActions,
+                           Attributes,
+                           Arguments,
+                           Environment,
+                           UsePath,
+                           (PINT)&Error) != FALSE) {
+
+        return Error;
+    }
+
     Error = 0;
     Pid = fork();
     if (Pid == -1) {
         return errno;
 
     //
-    // In the child, process the attributes and execute the image. With vfork,
-    // the values set in error here will be accessible by the parent, since
-    // vfork temporarily shares the memory of the parent.
+    // In the child, process the attributes and execute the image. Errors here
+    // are only visible to the parent through the exit status.
     //
 
     } else if (Pid == 0) {
@@ -1241,23 +1282,429 @@ Return Value:
 
     } else {
 
+        if (ChildPid != NULL) {
+            *ChildPid = Pid;
+        }
+    }
+
+    return 0;
+}
+
+BOOL
+ClpPosixSpawnVfork (
+    pid_t *ChildPid,
+    const char *Path,
+    PPOSIX_SPAWN_FILE_ACTION *FileActions,
+    PPOSIX_SPAWN_ATTRIBUTES *Attributes,
+    char *const Arguments[],
+    char *const Environment[],
+    BOOL UsePath,
+    PINT Error
+    )
+
+/*++
+
+Routine Description:
+
+    This routine attempts to execute the posix spawn function using vfork.
+    The child runs on the parent's memory until it executes the new image, so
+    everything that would allocate memory (the path search and the process
+    environment) is done in the parent beforehand, and the child only makes
+    system calls.
+
+Arguments:
+
+    ChildPid - Supplies an optional pointer where the child process ID will be
+        returned on success.
+
+    Path - Supplies a pointer to the file path to execute.
+
+    FileActions - Supplies an optional pointer to the file actions to execute
+        in the child.
+
+    Attributes - Supplies an optional pointer to the spawn attributes.
+
+    Arguments - Supplies the arguments to pass to the new child.
+
+    Environment - Supplies the environment to pass to the new child.
+
+    UsePath - Supplies a boolean indicating whether to search the PATH
+        environment variable for the executable.
+
+    Error - Supplies a pointer where the error number of the spawn will be
+        returned if this routine handled it.
+
+Return Value:
+
+    TRUE if the spawn was handled here, successfully or not.
+
+    FALSE if the caller should fall back to spawning with fork.
+
+--*/
+
+{
+
+    SIGNAL_SET AllSignals;
+    volatile INT ChildError;
+    PSTR FullPath;
+    BOOL Handled;
+    SIGNAL_SET OriginalMask;
+    pid_t Pid;
+    PPROCESS_ENVIRONMENT ProcessEnvironment;
+    KSTATUS Status;
+
+    //
+    // Resetting the effective IDs goes through the thread list in the C
+    // library, which the child cannot safely touch.
+    //
+
+    if ((Attributes != NULL) &&
+        (((*Attributes)->Flags & POSIX_SPAWN_RESETIDS) != 0)) {
+
+        return FALSE;
+    }
+
+    FullPath = (PSTR)Path;
+    if (UsePath != FALSE) {
+        FullPath = ClpSpawnSearchPath(Path);
+        if (FullPath == NULL) {
+            return FALSE;
+        }
+    }
+
+    Handled = FALSE;
+    ProcessEnvironment = NULL;
+
+    //
+    // Interpreter scripts need the argument shuffling done by execve, which
+    // allocates. Let the fork path handle those.
+    //
+
+    if (ClpSpawnIsScript(FullPath) != FALSE) {
+        goto PosixSpawnVforkEnd;
+    }
+
+    if (Environment == NULL) {
+        Environment = environ;
+    }
+
+    ProcessEnvironment = ClpSpawnCreateEnvironment(FullPath,
+                                                   Arguments,
+                                                   Environment);
+
+    if (ProcessEnvironment == NULL) {
+        goto PosixSpawnVforkEnd;
+    }
+
+    Handled = TRUE;
+    ChildError = 0;
+
+    //
+    // Block every signal, including the C library's internal ones, across the
+    // vfork. Otherwise a handler installed by the parent could run in the
+    // child on the parent's stack and memory. This goes straight to the
+    // kernel because sigprocmask refuses to block the internal signals.
+    //
+
+    FILL_SIGNAL_SET(AllSignals);
+    OriginalMask = OsSetSignalBehavior(SignalMaskBlocked,
+                                       SignalMaskOperationOverwrite,
+                                       &AllSignals);
+
+    Pid = vfork();
+    if (Pid == -1) {
+        *Error = errno;
+        OsSetSignalBehavior(SignalMaskBlocked,
+                            SignalMaskOperationOverwrite,
+                            &OriginalMask);
+
+        goto PosixSpawnVforkEnd;
+
+    //
+    // In the child, process the attributes and execute the image. Any error
+    // set here is visible to the parent, since the memory is shared until
+    // the child executes or exits.
+    //
+
+    } else if (Pid == 0) {
+
         //
-        // If the child had a problem, then with vfork the error variable will
-        // be set, and this routine can return a more detailed status. Reap the
-        // child here.
+        // Put every caught signal back to its default disposition before
+        // unblocking anything, so that no parent handler can run here.
+        // Ignored signals stay ignored, as they would across an exec. The
+        // spawn attributes may then replace the restored mask.
         //
 
-        if (Error != 0) {
-            waitpid(Pid, NULL, 0);
+        OsSetSignalBehavior(SignalMaskHandled,
+                            SignalMaskOperationClear,
+                            &AllSignals);
+
+        OsSetSignalBehavior(SignalMaskBlocked,
+                            SignalMaskOperationOverwrite,
+                            &OriginalMask);
+
+        if (Attributes != NULL) {
+            ChildError = ClpProcessSpawnAttributes(*Attributes);
+            if (ChildError != 0) {
+                _exit(127);
+            }
+        }
+
+        if (FileActions != NULL) {
+            ChildError = ClpProcessSpawnFileActions(*FileActions);
+            if (ChildError != 0) {
+                _exit(127);
+            }
+        }
+
+        Status = OsExecuteImage(ProcessEnvironment);
+        if (Status == STATUS_UNKNOWN_IMAGE_FORMAT) {
+            ChildError = ENOEXEC;
+
+        } else {
+            ChildError = ClConvertKstatusToErrorNumber(Status);
+        }
+
+        _exit(127);
+    }
+
+    //
+    // In the parent, restore the signal mask, and reap the child if it failed
+    // so that the more detailed error can be returned instead of a process ID.
+    //
+
+    OsSetSignalBehavior(SignalMaskBlocked,
+                        SignalMaskOperationOverwrite,
+                        &OriginalMask);
+
+    *Error = ChildError;
+    if (ChildError != 0) {
+        waitpid(Pid, NULL, 0);
+
+    } else if (ChildPid != NULL) {
+        *ChildPid = Pid;
+    }
+
+PosixSpawnVforkEnd:
+    if (ProcessEnvironment != NULL) {
+        OsDestroyEnvironment(ProcessEnvironment);
+    }
+
+    if (FullPath != Path) {
+        free(FullPath);
+    }
+
+    return Handled;
+}
+
+PSTR
+ClpSpawnSearchPath (
+    const char *File
+    )
+
+/*++
+
+Routine Description:
+
+    This routine finds the executable that execvpe would run for the given
+    file name.
+
+Arguments:
+
+    File - Supplies a pointer to the file name to look up.
+
+Return Value:
+
+    Returns a pointer to the path of the executable on success. The caller is
+    responsible for freeing this memory.
+
+    NULL if no executable was found or an allocation failed.
+
+--*/
+
+{
+
+    PSTR CombinedPath;
+    PSTR Current;
+    int Error;
+    size_t FileLength;
+    PSTR PathVariable;
+    size_t PathEntryLength;
+    PSTR Separator;
+
+    PathVariable = getenv("PATH");
+    if ((strchr(File, '/') != NULL) || (PathVariable == NULL) ||
+        (*PathVariable == '\0')) {
+
+        return strdup(File);
+    }
+
+    Error = errno;
+    FileLength = strlen(File);
+    Current = PathVariable;
+    while (TRUE) {
+        Separator = strchr(Current, ':');
+        if (Separator != NULL) {
+            PathEntryLength = Separator - Current;
 
         } else {
-            if (ChildPid != NULL) {
-                *ChildPid = Pid;
+            PathEntryLength = strlen(Current);
+        }
+
+        //
+        // Skip empty entries, which execvpe also skips, and trim a trailing
+        // slash from the others.
+        //
+
+        if (PathEntryLength != 0) {
+            if (Current[PathEntryLength - 1] == '/') {
+                PathEntryLength -= 1;
             }
+
+            CombinedPath = malloc(PathEntryLength + FileLength + 2);
+            if (CombinedPath == NULL) {
+                break;
+            }
+
+            memcpy(CombinedPath, Current, PathEntryLength);
+            CombinedPath[PathEntryLength] = '/';
+            strcpy(CombinedPath + PathEntryLength + 1, File);
+            if (access(CombinedPath, X_OK) == 0) {
+                errno = Error;
+                return CombinedPath;
+            }
+
+            free(CombinedPath);
+        }
+
+        if (Separator == NULL) {
+            break;
+        }
+
+        Current = Separator + 1;
+    }
+
+    errno = Error;
+    return NULL;
+}
+
+BOOL
+ClpSpawnIsScript (
+    const char *Path
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines whether or not the given file begins with an
+    interpreter line.
+
+Arguments:
+
+    Path - Supplies a pointer to the path of the file to check.
+
+Return Value:
+
+    TRUE if the file begins with #!.
+
+    FALSE if the file does not begin with #! or could not be read.
+
+--*/
+
+{
+
+    char Buffer[2];
+    int Descriptor;
+    int Error;
+    ssize_t Size;
+
+    Error = errno;
+    Descriptor = open(Path, O_RDONLY);
+    if (Descriptor < 0) {
+        errno = Error;
+        return FALSE;
+    }
+
+    do {
+        Size = read(Descriptor, Buffer, sizeof(Buffer));
+
+    } while ((Size < 0) && (errno == EINTR));
+
+    close(Descriptor);
+    errno = Error;
+    if ((Size == sizeof(Buffer)) && (Buffer[0] == '#') && (Buffer[1] == '!')) {
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+PPROCESS_ENVIRONMENT
+ClpSpawnCreateEnvironment (
+    const char *Path,
+    char *const Arguments[],
+    char *const Environment[]
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates the process environment that execve would build for
+    the given image.
+
+Arguments:
+
+    Path - Supplies a pointer to the path of the image to execute.
+
+    Arguments - Supplies the null terminated array of arguments.
+
+    Environment - Supplies the null terminated array of environment
+        variables.
+
+Return Value:
+
+    Returns a pointer to the process environment on success. The caller is
+    responsible for destroying it.
+
+    NULL on allocation failure.
+
+--*/
+
+{
+
+    UINTN ArgumentCount;
+    UINTN ArgumentValuesTotalLength;
+    UINTN EnvironmentCount;
+    UINTN EnvironmentValuesTotalLength;
+
+    ArgumentCount = 0;
+    ArgumentValuesTotalLength = 0;
+    while (Arguments[ArgumentCount] != NULL) {
+        ArgumentValuesTotalLength += strlen(Arguments[ArgumentCount]) + 1;
+        ArgumentCount += 1;
+    }
+
+    EnvironmentCount = 0;
+    EnvironmentValuesTotalLength = 0;
+    if (Environment != NULL) {
+        while (Environment[EnvironmentCount] != NULL) {
+            EnvironmentValuesTotalLength +=
+                                     strlen(Environment[EnvironmentCount]) + 1;
+
+            EnvironmentCount += 1;
         }
     }
 
-    return Error;
+    return OsCreateEnvironment((PSTR)Path,
+                               strlen(Path) + 1,
+                               (PSTR *)Arguments,
+                               ArgumentValuesTotalLength,
+                               ArgumentCount,
+                               (PSTR *)Environment,
+                               EnvironmentValuesTotalLength,
+                               EnvironmentCount);
 }
 
 INT
@@ -1286,9 +1733,6 @@ Return Value:
 
 {
 
-    struct sigaction Action;
-    int Signal;
-
     if ((Attributes->Flags & POSIX_SPAWN_SETPGROUP) != 0) {
         if (setpgid(0, Attributes->ProcessGroup) != 0) {
             return errno;
@@ -1317,19 +1761,19 @@ Return Value:
 
     //
     // If desired, reset any signals mentioned in the default mask back to
-    // the default disposition.
+    // the default disposition. This goes straight to the kernel rather than
+    // through sigaction, since a vfork child shares the C library's handler
+    // table with its parent. The new image starts with a fresh table anyway.
     //
 
     if ((Attributes->Flags & POSIX_SPAWN_SETSIGDEF) != 0) {
-        memset(&Action, 0, sizeof(Action));
-        Action.sa_handler = SIG_DFL;
-        for (Signal = 1; Signal < NSIG; Signal += 1) {
-            if (sigismember(&(Attributes->DefaultMask), Signal) != 0) {
-                if (sigaction(Signal, &Action, NULL) != 0) {
-                    return errno;
-                }
-            }
-        }
+        OsSetSignalBehavior(SignalMaskHandled,
+                            SignalMaskOperationClear,
+                            &(Attributes->DefaultMask));
+
+        OsSetSignalBehavior(SignalMaskIgnored,
+                            SignalMaskOperationClear,
+                            &(Attributes->DefaultMask));
     }
 
     return 0;
@@ -36,6 +36,7 @@ Module Name:
 #include <fcntl.h>
 #include <paths.h>
 #include <signal.h>
+#include <spawn.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/wait.h>
@@ -110,6 +111,9 @@ Return Value:
 
     struct sigaction Action;
     char *Arguments[4];
+    posix_spawnattr_t Attributes;
+    sigset_t DefaultSignals;
+    int Error;
     pid_t Pid;
     sigset_t SaveBlock;
     struct sigaction SavedInterrupt;
@@ -132,31 +136,55 @@ Return Value:
     sigprocmask(SIG_BLOCK, &(Action.sa_mask), &SaveBlock);
 
     //
-    // Fork off the child process.
+    // Spawn the child with the original signal mask, and with interrupt and
+    // quit back at their defaults unless the caller was already ignoring
+    // them. Any installed handlers revert to the default across the exec
+    // anyway.
     //
 
-    Pid = fork();
-    if (Pid < 0) {
-        return -1;
+    Error = posix_spawnattr_init(&Attributes);
+    if (Error != 0) {
+        Status = -1;
+        goto SystemEnd;
+    }
+
+    sigemptyset(&DefaultSignals);
+    if (SavedInterrupt.sa_handler != SIG_IGN) {
+        sigaddset(&DefaultSignals, SIGINT);
     }
 
+    if (SavedQuit.sa_handler != SIG_IGN) {
+        sigaddset(&DefaultSignals, SIGQUIT);
+    }
+
+    posix_spawnattr_setsigdefault(&Attributes, &DefaultSignals);
+    posix_spawnattr_setsigmask(&Attributes, &SaveBlock);
+    posix_spawnattr_setflags(&Attributes,
+                             POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK);
+
+    Arguments[0] = SHELL_ARGUMENT0;
+    Arguments[1] = SHELL_ARGUMENT1;
+    Arguments[2] = (char *)Command;
+    Arguments[3] = NULL;
+    Error = posix_spawn(&Pid,
+                        _PATH_BSHELL,
+                        NULL,
+                        &Attributes,
+                        Arguments,
+                        environ);
+
+    posix_spawnattr_destroy(&Attributes);
+
     //
-    // If this is the child, run the command.
+    // If the shell could not be run, report it the same way a child that
+    // failed to execute it would have.
     //
 
-    if (Pid == 0) {
-        sigaction(SIGINT, &SavedInterrupt, NULL);
-        sigaction(SIGQUIT, &SavedQuit, NULL);
-        sigprocmask(SIG_SETMASK, &SaveBlock, NULL);
-        Arguments[0] = SHELL_ARGUMENT0;
-        Arguments[1] = SHELL_ARGUMENT1;
-        Arguments[2] = (char *)Command;
-        Arguments[3] = NULL;
-        execvp(_PATH_BSHELL, Arguments);
-        exit(SHELL_NOT_FOUND_STATUS);
+    if (Error != 0) {
+        Status = SHELL_NOT_FOUND_STATUS << 8;
 
     //
-    // This is the parent, wait for the command to finish.
+    // Wait for the command to finish.
     //
 
     } else {
@@ -168,12 +196,14 @@ Return Value:
         }
     }
 
+SystemEnd:
+
     //
     // Restore the signal mask and dispositions.
     //
 
     sigaction(SIGINT, &SavedInterrupt, NULL);
-    sigaction(SIGQUIT, &SavedInterrupt, NULL);
+    sigaction(SIGQUIT, &SavedQuit, NULL);
     sigprocmask(SIG_SETMASK, &SaveBlock, NULL);
     return Status;
 }
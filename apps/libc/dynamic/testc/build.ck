@@ -47,6 +47,8 @@ function build() {
 
     buildLibs = [
         "apps/libc/dynamic:build_libc",
+        "lib/rtl/base:build_basertl",
+        "lib/rtl/urtl:build_rtlc"
     ];
 
     includes = [
@@ -257,6 +257,84 @@ REGEX_EXECUTION_TEST_CASE RegexExecutionTestCases[] = {
         {{5, 8}, {-1, -1}, {-1, -1}, {-1, -1}, {-1, -1}},
     },
 
+    //
+    // Make sure a right anchor that fails on the first match attempt goes
+    // back and tries other choices before giving up on that starting point.
+    //
+
+    {
+        "b*[^a][^a]$", REG_NEWLINE,
+        " b \nAax\n", REG_NOTEOL,
+        0,
+        {{1, 3}, {-1, -1}, {-1, -1}, {-1, -1}, {-1, -1}},
+    },
+    {
+        "x*[^a]$", REG_NEWLINE,
+        "bx\nx", REG_NOTEOL,
+        0,
+        {{1, 2}, {-1, -1}, {-1, -1}, {-1, -1}, {-1, -1}},
+    },
+    {
+        "b*.[^a]$", REG_NEWLINE,
+        "bbx\nb", 0,
+        0,
+        {{0, 3}, {-1, -1}, {-1, -1}, {-1, -1}, {-1, -1}},
+    },
+    {
+        "\\(b*\\)[^a]$", REG_NEWLINE,
+        "bbb\nc", REG_NOTEOL,
+        0,
+        {{0, 3}, {0, 2}, {-1, -1}, {-1, -1}, {-1, -1}},
+    },
+    {
+        "(a|ab)$", REG_EXTENDED | REG_NEWLINE,
+        "ab\nc", REG_NOTEOL,
+        0,
+        {{0, 2}, {0, 2}, {-1, -1}, {-1, -1}, {-1, -1}},
+    },
+    {
+        "^b*.$", REG_NEWLINE,
+        "a\nbbc\n", REG_NOTBOL,
+        0,
+        {{2, 5}, {-1, -1}, {-1, -1}, {-1, -1}, {-1, -1}},
+    },
+    {
+        "x*[^a]$", 0,
+        "bx\nx", REG_NOTEOL,
+        REG_NOMATCH,
+        {{-1, -1}, {-1, -1}, {-1, -1}, {-1, -1}, {-1, -1}},
+    },
+
+    //
+    // Make sure a failed iteration inside a repeated subexpression lets the
+    // subexpression go around again before giving up on that starting point.
+    //
+
+    {
+        "b\\(ab*\\)*bb", 0,
+        "baabb", 0,
+        0,
+        {{0, 5}, {2, 3}, {-1, -1}, {-1, -1}, {-1, -1}},
+    },
+    {
+        "^\\(ab*\\)*b", REG_ICASE,
+        "aAb", 0,
+        0,
+        {{0, 3}, {1, 2}, {-1, -1}, {-1, -1}, {-1, -1}},
+    },
+    {
+        "x\\(ab*\\)*xax*", 0,
+        "xaabbxaxx", 0,
+        0,
+        {{0, 9}, {2, 5}, {-1, -1}, {-1, -1}, {-1, -1}},
+    },
+    {
+        "\\(ab*\\)*b", 0,
+        "aab", 0,
+        0,
+        {{0, 3}, {1, 2}, {-1, -1}, {-1, -1}, {-1, -1}},
+    },
+
     //
     // Try out the no-sub flag.
     //
@@ -907,6 +985,21 @@ Return Value:
         }
     }
 
+    //
+    // Run it again without asking for any matches, which lets the search skip
+    // figuring out where the match is. The answer had better be the same.
+    //
+
+    Result = regexec(&Expression, Case->Input, 0, NULL, Case->InputFlags);
+    if (Result != Case->ExecutionResult) {
+        printf("Error: regexec with no matches returned %d instead of "
+               "expected result %d.\n",
+               Result,
+               Case->ExecutionResult);
+
+        Status = FALSE;
+    }
+
 TestRegularExpressionCaseEnd:
     if (Status == FALSE) {
         printf("Regex test %d failed.\n"
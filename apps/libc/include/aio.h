@@ -0,0 +1,401 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU Lesser General Public
+    License version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details.
+
+Module Name:
+
+    aio.h
+
+Abstract:
+
+    This header contains definitions for POSIX asynchronous I/O.
+
+Author:
+
+    agent 19-Oct-2026
+
+--*/
+
+#ifndef _AIO_H
+#define _AIO_H
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <libcbase.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <time.h>
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+#ifdef __cplusplus
+
+extern "C" {
+
+#endif
+
+//
+// Define the values returned by aio_cancel.
+//
+
+//
+// This value indicates that all requested operations were canceled.
+//
+
+#define AIO_CANCELED 0
+
+//
+// This value indicates that at least one of the requested operations could
+// not be canceled because it was in progress.
+//
+
+#define AIO_NOTCANCELED 1
+
+//
+// This value indicates that all requested operations had already completed.
+//
+
+#define AIO_ALLDONE 2
+
+//
+// Define the operation codes for lio_listio.
+//
+
+#define LIO_READ 0
+#define LIO_WRITE 1
+#define LIO_NOP 2
+
+//
+// Define the modes for lio_listio.
+//
+
+//
+// This value indicates that lio_listio should wait for every operation to
+// complete before returning.
+//
+
+#define LIO_WAIT 0
+
+//
+// This value indicates that lio_listio should return as soon as the
+// operations are queued.
+//
+
+#define LIO_NOWAIT 1
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+/*++
+
+Structure Description:
+
+    This structure defines an asynchronous I/O control block.
+
+Members:
+
+    aio_fildes - Stores the file descriptor to perform I/O on.
+
+    aio_offset - Stores the file offset to perform I/O at.
+
+    aio_buf - Stores a pointer to the buffer to read into or write from.
+
+    aio_nbytes - Stores the number of bytes to transfer.
+
+    aio_reqprio - Stores the request priority offset. This is currently
+        ignored.
+
+    aio_sigevent - Stores the notification to deliver when the operation
+        completes. Only SIGEV_NONE and SIGEV_SIGNAL are supported.
+
+    aio_lio_opcode - Stores the operation to perform when this block is
+        passed to lio_listio. See LIO_* definitions.
+
+    __aio_error - Stores the error number of the operation, or EINPROGRESS.
+        Applications should use aio_error to read this.
+
+    __aio_return - Stores the return value of the operation. Applications
+        should use aio_return to read this.
+
+    __aio_next - Stores a pointer used internally by the C library to track
+        outstanding operations.
+
+--*/
+
+struct aiocb {
+    int aio_fildes;
+    off_t aio_offset;
+    volatile void *aio_buf;
+    size_t aio_nbytes;
+    int aio_reqprio;
+    struct sigevent aio_sigevent;
+    int aio_lio_opcode;
+    int __aio_error;
+    ssize_t __aio_return;
+    struct aiocb *__aio_next;
+};
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// -------------------------------------------------------- Function Prototypes
+//
+
+LIBC_API
+int
+aio_read (
+    struct aiocb *Control
+    );
+
+/*++
+
+Routine Description:
+
+    This routine queues an asynchronous read of aio_nbytes from the file
+    descriptor into the buffer, starting at the given file offset.
+
+Arguments:
+
+    Control - Supplies a pointer to the control block describing the read.
+        This must remain valid until the operation completes.
+
+Return Value:
+
+    0 if the request was queued.
+
+    -1 on failure, and errno will be set to contain more information.
+
+--*/
+
+LIBC_API
+int
+aio_write (
+    struct aiocb *Control
+    );
+
+/*++
+
+Routine Description:
+
+    This routine queues an asynchronous write of aio_nbytes from the buffer to
+    the file descriptor, starting at the given file offset.
+
+Arguments:
+
+    Control - Supplies a pointer to the control block describing the write.
+        This must remain valid until the operation completes.
+
+Return Value:
+
+    0 if the request was queued.
+
+    -1 on failure, and errno will be set to contain more information.
+
+--*/
+
+LIBC_API
+int
+aio_fsync (
+    int Operation,
+    struct aiocb *Control
+    );
+
+/*++
+
+Routine Description:
+
+    This routine queues an asynchronous flush of the file descriptor's data
+    to its backing device.
+
+Arguments:
+
+    Operation - Supplies the type of synchronization, either O_SYNC or
+        O_DSYNC. Both are treated the same.
+
+    Control - Supplies a pointer to the control block. Only the file
+        descriptor and signal event are used.
+
+Return Value:
+
+    0 if the request was queued.
+
+    -1 on failure, and errno will be set to contain more information.
+
+--*/
+
+LIBC_API
+int
+aio_error (
+    const struct aiocb *Control
+    );
+
+/*++
+
+Routine Description:
+
+    This routine returns the error status of an asynchronous I/O operation.
+
+Arguments:
+
+    Control - Supplies a pointer to the control block of the operation.
+
+Return Value:
+
+    0 if the operation completed successfully.
+
+    EINPROGRESS if the operation has not yet completed.
+
+    Returns the error number the operation failed with otherwise.
+
+--*/
+
+LIBC_API
+ssize_t
+aio_return (
+    struct aiocb *Control
+    );
+
+/*++
+
+Routine Description:
+
+    This routine returns the final return value of a completed asynchronous
+    I/O operation. It should be called exactly once per operation, after
+    aio_error no longer returns EINPROGRESS.
+
+Arguments:
+
+    Control - Supplies a pointer to the control block of the operation.
+
+Return Value:
+
+    Returns the value the equivalent read, write, or fsync call would have
+    returned.
+
+    -1 if the operation is still in progress, and errno will be set to EINVAL.
+
+--*/
+
+LIBC_API
+int
+aio_suspend (
+    const struct aiocb *const List[],
+    int Count,
+    const struct timespec *Timeout
+    );
+
+/*++
+
+Routine Description:
+
+    This routine waits until at least one of the given asynchronous I/O
+    operations has completed.
+
+Arguments:
+
+    List - Supplies an array of control block pointers. Null entries are
+        ignored.
+
+    Count - Supplies the number of elements in the array.
+
+    Timeout - Supplies an optional pointer to the relative time to wait. Supply
+        NULL to wait indefinitely.
+
+Return Value:
+
+    0 if at least one operation has completed.
+
+    -1 on failure, and errno will be set to contain more information. EAGAIN
+    means the timeout expired, and EINTR means a signal arrived.
+
+--*/
+
+LIBC_API
+int
+aio_cancel (
+    int FileDescriptor,
+    struct aiocb *Control
+    );
+
+/*++
+
+Routine Description:
+
+    This routine attempts to cancel outstanding asynchronous I/O operations.
+    Operations are handed to the kernel as soon as they are queued, so this
+    routine can only report whether they have completed.
+
+Arguments:
+
+    FileDescriptor - Supplies the file descriptor whose operations should be
+        canceled.
+
+    Control - Supplies an optional pointer to a specific operation to cancel.
+        If NULL, all operations on the file descriptor are considered.
+
+Return Value:
+
+    AIO_ALLDONE if all operations have already completed.
+
+    AIO_NOTCANCELED if at least one operation is still in progress.
+
+    -1 on failure, and errno will be set to contain more information.
+
+--*/
+
+LIBC_API
+int
+lio_listio (
+    int Mode,
+    struct aiocb *const List[],
+    int Count,
+    struct sigevent *Event
+    );
+
+/*++
+
+Routine Description:
+
+    This routine queues a list of asynchronous I/O operations with a single
+    call into the kernel.
+
+Arguments:
+
+    Mode - Supplies whether to wait for all the operations to complete
+        (LIO_WAIT) or to return as soon as they are queued (LIO_NOWAIT).
+
+    List - Supplies an array of control block pointers. The aio_lio_opcode
+        member of each determines the operation. Null entries are ignored.
+
+    Count - Supplies the number of elements in the array.
+
+    Event - Supplies an optional signal event to deliver when all operations
+        complete. Only NULL or SIGEV_NONE are supported.
+
+Return Value:
+
+    0 on success.
+
+    -1 on failure, and errno will be set to contain more information. Check
+    each operation with aio_error to determine which ones failed.
+
+--*/
+
+#ifdef __cplusplus
+
+}
+
+#endif
+#endif
+
@@ -240,6 +240,14 @@ extern "C" {
 
 #define MSG_DONTROUTE 0x00000100
 
+//
+// This flag is only valid for recvmmsg. It requests that the call block until
+// the first message arrives, and then collect only those messages that are
+// already waiting.
+//
+
+#define MSG_WAITFORONE 0x00010000
+
 //
 // Define the shutdown types. Read closes the socket for further reading, write
 // closes the socket for further writing, and rdwr closes the socket for both
@@ -581,6 +589,55 @@ struct msghdr {
     int msg_flags;
 };
 
+//
+// This definition is needed by the recvmmsg function.
+//
+
+struct timespec;
+
+/*++
+
+Structure Description:
+
+    This structure defines one message of a sendmmsg or recvmmsg call.
+
+Members:
+
+    msg_hdr - Stores the message itself.
+
+    msg_len - Stores the number of bytes sent or received for this message.
+
+--*/
+
+struct mmsghdr {
+    struct msghdr msg_hdr;
+    unsigned int msg_len;
+};
+
+/*++
+
+Structure Description:
+
+    This structure defines one connection returned by the acceptmany function.
+
+Members:
+
+    ae_fd - Stores the file descriptor of the new connection.
+
+    ae_addr - Stores an optional pointer where the address of the connecting
+        socket will be returned.
+
+    ae_addrlen - Stores on input the size of the address buffer. On output,
+        this contains the length of the returned address.
+
+--*/
+
+struct acceptent {
+    int ae_fd;
+    struct sockaddr *ae_addr;
+    socklen_t ae_addrlen;
+};
+
 /*++
 
 Structure Description:
@@ -858,6 +915,45 @@ Return Value:
 
 --*/
 
+LIBC_API
+int
+acceptmany (
+    int Socket,
+    struct acceptent *Entries,
+    unsigned int Count,
+    int Flags
+    );
+
+/*++
+
+Routine Description:
+
+    This routine accepts several pending incoming connections on the given
+    listening socket with a single system call. It blocks (unless the socket
+    is non-blocking) until the first connection arrives, and then also accepts
+    any other connections that are already pending. This is a Minoca extension.
+
+Arguments:
+
+    Socket - Supplies the file descriptor of the listening socket to accept
+        connections on.
+
+    Entries - Supplies an array of entries where the new file descriptors and
+        connecting addresses will be returned.
+
+    Count - Supplies the number of elements in the entry array.
+
+    Flags - Supplies an optional bitfield of flags governing the newly created
+        file descriptors. See accept4.
+
+Return Value:
+
+    Returns the number of connections accepted on success.
+
+    -1 on error, and the errno variable will be set to contain more information.
+
+--*/
+
 LIBC_API
 int
 connect (
@@ -1001,6 +1097,43 @@ Return Value:
 
 --*/
 
+LIBC_API
+int
+sendmmsg (
+    int Socket,
+    struct mmsghdr *Messages,
+    unsigned int Count,
+    int Flags
+    );
+
+/*++
+
+Routine Description:
+
+    This routine sends several messages out of a socket with a single system
+    call.
+
+Arguments:
+
+    Socket - Supplies the file descriptor of the socket to send data out of.
+
+    Messages - Supplies an array of messages to send. On return, the msg_len
+        member of each message sent contains the number of bytes sent.
+
+    Count - Supplies the number of elements in the message array.
+
+    Flags - Supplies a bitfield of flags governing the transmission of the data.
+        See MSG_* definitions.
+
+Return Value:
+
+    Returns the number of messages sent on success. This may be less than the
+    count if an error occurred partway through.
+
+    -1 on error, and the errno variable will be set to contain more information.
+
+--*/
+
 LIBC_API
 ssize_t
 recv (
@@ -1116,6 +1249,47 @@ Return Value:
 
 --*/
 
+LIBC_API
+int
+recvmmsg (
+    int Socket,
+    struct mmsghdr *Messages,
+    unsigned int Count,
+    int Flags,
+    struct timespec *Timeout
+    );
+
+/*++
+
+Routine Description:
+
+    This routine receives several messages from a socket with a single system
+    call.
+
+Arguments:
+
+    Socket - Supplies the file descriptor of the socket to receive data from.
+
+    Messages - Supplies an array of initialized messages where the received
+        data will be returned. On return, the msg_len member of each message
+        received contains the number of bytes received.
+
+    Count - Supplies the number of elements in the message array.
+
+    Flags - Supplies a bitfield of flags governing the reception of the data.
+        See MSG_* definitions. MSG_WAITFORONE is also accepted.
+
+    Timeout - Supplies an optional pointer to the maximum amount of time the
+        entire call may take. Supply NULL to wait indefinitely.
+
+Return Value:
+
+    Returns the number of messages received on success.
+
+    -1 on error, and the errno variable will be set to contain more information.
+
+--*/
+
 LIBC_API
 int
 shutdown (
@@ -2799,6 +2799,37 @@ Return Value:
 
 --*/
 
+LIBC_API
+pid_t
+vfork (
+    void
+    );
+
+/*++
+
+Routine Description:
+
+    This routine creates a new process that shares the memory of the calling
+    process until it calls one of the exec functions or _exit. The calling
+    thread is suspended until then. The child must not return from the
+    function that called vfork, and should not modify any data other than the
+    variable holding the return value.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns 0 to the child process.
+
+    Returns the process ID of the child process to the parent process.
+
+    Returns -1 to the parent process on error, and the errno variable will be
+    set to provide more information about the error.
+
+--*/
+
 LIBC_API
 uid_t
 getuid (
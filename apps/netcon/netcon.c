@@ -2266,6 +2266,10 @@ Return Value:
 
         break;
 
+    case NetDomainLoopback:
+        printf("loopback");
+        break;
+
     default:
         break;
     }
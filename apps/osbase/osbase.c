@@ -526,6 +526,70 @@ Return Value:
     return OsSystemCall(SystemCallFlush, &Parameters);
 }
 
+OS_API
+KSTATUS
+OsIoRingEnter (
+    PIO_RING Ring,
+    ULONG MinimumCompletions,
+    ULONG TimeoutInMilliseconds,
+    PULONG SubmittedCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine enters an I/O ring. The kernel consumes the new submissions,
+    retries any that previously would have blocked, and posts completions for
+    everything that finishes. Completions already in the ring can be reaped
+    without calling this routine.
+
+Arguments:
+
+    Ring - Supplies a pointer to the I/O ring. The ring may only be entered by
+        one thread at a time.
+
+    MinimumCompletions - Supplies the number of unreaped completions that
+        should be in the completion queue before returning. Supply 0 to submit
+        without waiting.
+
+    TimeoutInMilliseconds - Supplies the number of milliseconds to wait for the
+        minimum completions. Use SYS_WAIT_TIME_INDEFINITE to wait forever.
+
+    SubmittedCount - Supplies an optional pointer where the number of new
+        submissions consumed by the kernel will be returned.
+
+Return Value:
+
+    Status code. Timing out waiting for completions is not a failure; check
+    the completion queue.
+
+--*/
+
+{
+
+    SYSTEM_CALL_IO_RING_ENTER Parameters;
+    INTN Result;
+
+    Parameters.Ring = Ring;
+    Parameters.MinimumCompletions = MinimumCompletions;
+    Parameters.TimeoutInMilliseconds = TimeoutInMilliseconds;
+    Result = OsSystemCall(SystemCallIoRingEnter, &Parameters);
+    if (Result < 0) {
+        if (SubmittedCount != NULL) {
+            *SubmittedCount = 0;
+        }
+
+        return Result;
+    }
+
+    if (SubmittedCount != NULL) {
+        *SubmittedCount = (ULONG)Result;
+    }
+
+    return STATUS_SUCCESS;
+}
+
 OS_API
 KSTATUS
 OsCreatePipe (
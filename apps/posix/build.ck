@@ -47,6 +47,7 @@ function build() {
         ["apps/banner:banner", "banner"],
         ["apps/debug/client:debug", "debug"],
         ["apps/efiboot:efiboot", "efiboot"],
+        ["apps/ktrace:ktrace", "ktrace"],
         ["apps/mount:mount", "mount"],
         ["apps/setup:msetup", "msetup"],
         ["apps/netcon:netcon", "netcon"],
@@ -59,15 +59,15 @@ Module Name:
     "The profile utility enables, disables or gets system profiling state.\n\n"\
     "Options:\n"                                                               \
     "  -d, --disable <type> -- Disable a system profiler. Valid values are \n" \
-    "      stack, memory, thread, and all.\n"                                  \
+    "      stack, memory, thread, lock, offcpu, and all.\n"                    \
     "  -e, --enable <type> -- Enable a system profiler. Valid values are \n"   \
-    "      stack, memory, thread, all.\n"                                      \
+    "      stack, memory, thread, lock, offcpu, all.\n"                        \
     "  --help -- Display this help text.\n"                                    \
     "  --version -- Display the application version and exit.\n\n"
 
 #define PROFILE_OPTIONS_STRING "e:d:Vh"
 
-#define PROFILE_TYPE_COUNT 4
+#define PROFILE_TYPE_COUNT 6
 
 //
 // ------------------------------------------------------ Data Type Definitions
@@ -114,7 +114,9 @@ PROFILE_TYPE_DATA ProfileTypeData[PROFILE_TYPE_COUNT] = {
         "all",
         PROFILER_TYPE_FLAG_STACK_SAMPLING |
         PROFILER_TYPE_FLAG_MEMORY_STATISTICS |
-        PROFILER_TYPE_FLAG_THREAD_STATISTICS
+        PROFILER_TYPE_FLAG_THREAD_STATISTICS |
+        PROFILER_TYPE_FLAG_LOCK_STATISTICS |
+        PROFILER_TYPE_FLAG_OFF_CPU_STATISTICS
     },
 
     {
@@ -131,6 +133,16 @@ PROFILE_TYPE_DATA ProfileTypeData[PROFILE_TYPE_COUNT] = {
         "thread",
         PROFILER_TYPE_FLAG_THREAD_STATISTICS
     },
+
+    {
+        "lock",
+        PROFILER_TYPE_FLAG_LOCK_STATISTICS
+    },
+
+    {
+        "offcpu",
+        PROFILER_TYPE_FLAG_OFF_CPU_STATISTICS
+    },
 };
 
 //
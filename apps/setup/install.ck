@@ -97,6 +97,7 @@ var DriverFiles = [
     "acpi.drv",
     "ehci.drv",
     "fat.drv",
+    "loopback.drv",
     "net80211.drv",
     "netcore.drv",
     "null.drv",
@@ -112,6 +113,7 @@ var DriverFiles = [
     "smsc95xx.drv",
     "sound.drv",
     "special.drv",
+    "tmpfs.drv",
     "usbcomp.drv",
     "usbcore.drv",
     "usbhid.drv",
@@ -486,6 +488,7 @@ if (plat == "install-armv6") {
         "libcrypt.so.1",
         "libminocaos.so.1",
         "loadefi",
+        "loopback.drv",
         "net80211.drv",
         "netcore.drv",
         "null.drv",
@@ -512,6 +515,7 @@ if (plat == "install-armv6") {
         "sound.drv",
         "spb.drv",
         "special.drv",
+        "tmpfs.drv",
         "tps65217.drv",
         "usbcomp.drv",
         "usbcore.drv",
@@ -612,6 +616,7 @@ if (plat == "install-armv7") {
         "libcrypt.so.1",
         "libminocaos.so.1",
         "loadefi",
+        "loopback.drv",
         "net80211.drv",
         "netcore.drv",
         "null.drv",
@@ -642,6 +647,7 @@ if (plat == "install-armv7") {
         "sound.drv",
         "spb.drv",
         "special.drv",
+        "tmpfs.drv",
         "tps65217.drv",
         "usbcomp.drv",
         "usbcore.drv",
@@ -737,6 +743,7 @@ if ((plat == "install-x86") || (plat == "install-x64")) {
         "libminocaos.so.1",
         "loader",
         "loadefi",
+        "loopback.drv",
         "mbr.bin",
         "net80211.drv",
         "netcore.drv",
@@ -756,6 +763,7 @@ if ((plat == "install-x86") || (plat == "install-x64")) {
         "smsc95xx.drv",
         "sound.drv",
         "special.drv",
+        "tmpfs.drv",
         "uhci.drv",
         "usbcomp.drv",
         "usbcore.drv",
@@ -1021,11 +1029,13 @@ if ((plat == "pc32-tiny") || (plat == "pc64-tiny")) {
     DriversCopy["Files"] = [
         "acpi.drv",
         "fat.drv",
+        "loopback.drv",
         "netcore.drv",
         "null.drv",
         "part.drv",
         "pci.drv",
         "special.drv",
+        "tmpfs.drv",
         "usrinput.drv",
         "videocon.drv",
         "ata.drv",
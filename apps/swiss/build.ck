@@ -226,6 +226,8 @@ function build() {
             buildConfig["DYNLIBS"] += ["-ldl", "-lutil"];
         }
 
+        buildConfig["DYNLIBS"] += ["-lpthread"];
+
         if (buildOs != "Darwin") {
             buildSources += loginSources;
         }
@@ -172,6 +172,13 @@ Module Name:
 
 #define GREP_MAX_RECURSION_DEPTH 300
 
+//
+// Define the number of entries in a fixed string shift table, one for each
+// possible character value.
+//
+
+#define GREP_SKIP_TABLE_SIZE 256
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -216,12 +223,21 @@ Structure Description:
 
     Expression - Stores the regular expression structure.
 
+    PatternLength - Stores the length of the pattern string for fixed string
+        patterns.
+
+    Skip - Stores the Boyer-Moore-Horspool shift table for fixed string
+        patterns, indexed by the input character aligned with the last
+        pattern character.
+
 --*/
 
 typedef struct _GREP_PATTERN {
     LIST_ENTRY ListEntry;
     PSTR Pattern;
     regex_t Expression;
+    ULONG PatternLength;
+    ULONG Skip[GREP_SKIP_TABLE_SIZE];
 } GREP_PATTERN, *PGREP_PATTERN;
 
 /*++
@@ -268,6 +284,12 @@ GrepCompileRegularExpressions (
     PGREP_CONTEXT Context
     );
 
+VOID
+GrepPrepareFixedString (
+    PGREP_CONTEXT Context,
+    PGREP_PATTERN Pattern
+    );
+
 INT
 GrepAddInputFile (
     PGREP_CONTEXT Context,
@@ -1038,18 +1060,32 @@ Return Value:
     INT Status;
 
     //
-    // Skip this if they're just fixed strings and not regular expressions.
+    // Fixed strings aren't regular expressions, but they do get a shift table
+    // so the search can skip through lines quickly.
     //
 
     if ((Context->Options & GREP_OPTION_FIXED_STRINGS) != 0) {
+        CurrentEntry = Context->PatternList.Next;
+        while (CurrentEntry != &(Context->PatternList)) {
+            Pattern = LIST_VALUE(CurrentEntry, GREP_PATTERN, ListEntry);
+            CurrentEntry = CurrentEntry->Next;
+            GrepPrepareFixedString(Context, Pattern);
+        }
+
         return 0;
     }
 
     //
-    // Figure out the compile flags.
+    // Figure out the compile flags. The match location is only needed to
+    // check full line matches. Without it, the C library can answer without
+    // ever running its backtracking matcher.
     //
 
-    CompileFlags = REG_NOSUB;
+    CompileFlags = 0;
+    if ((Context->Options & GREP_OPTION_FULL_LINE_ONLY) == 0) {
+        CompileFlags |= REG_NOSUB;
+    }
+
     if ((Context->Options & GREP_OPTION_EXTENDED_EXPRESSIONS) != 0) {
         CompileFlags |= REG_EXTENDED;
     }
@@ -1101,6 +1137,66 @@ Return Value:
     return Status;
 }
 
+VOID
+GrepPrepareFixedString (
+    PGREP_CONTEXT Context,
+    PGREP_PATTERN Pattern
+    )
+
+/*++
+
+Routine Description:
+
+    This routine builds the Boyer-Moore-Horspool shift table for a fixed
+    string pattern. If case is being ignored, the pattern is converted to
+    lowercase and both cases of each character get the same shift.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Pattern - Supplies a pointer to the fixed string pattern.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UCHAR Character;
+    ULONG Index;
+    ULONG Last;
+
+    Pattern->PatternLength = strlen(Pattern->Pattern);
+    for (Index = 0; Index < GREP_SKIP_TABLE_SIZE; Index += 1) {
+        Pattern->Skip[Index] = Pattern->PatternLength;
+    }
+
+    if (Pattern->PatternLength == 0) {
+        return;
+    }
+
+    Last = Pattern->PatternLength - 1;
+    for (Index = 0; Index < Pattern->PatternLength; Index += 1) {
+        Character = Pattern->Pattern[Index];
+        if ((Context->Options & GREP_OPTION_IGNORE_CASE) != 0) {
+            Character = tolower(Character);
+            Pattern->Pattern[Index] = Character;
+        }
+
+        if (Index != Last) {
+            Pattern->Skip[Character] = Last - Index;
+            if ((Context->Options & GREP_OPTION_IGNORE_CASE) != 0) {
+                Pattern->Skip[(UCHAR)toupper(Character)] = Last - Index;
+            }
+        }
+    }
+
+    return;
+}
+
 INT
 GrepAddInputFile (
     PGREP_CONTEXT Context,
@@ -1685,17 +1781,19 @@ Return Value:
     if ((Context->Options & GREP_OPTION_FIXED_STRINGS) != 0) {
         Match = GrepMatchFixedString(Context, Input, Pattern);
 
-    } else {
+    } else if ((Context->Options & GREP_OPTION_FULL_LINE_ONLY) != 0) {
         Status = regexec(&(Pattern->Expression), Input, 1, &ExpressionMatch, 0);
-        if (Status == 0) {
+        if ((Status == 0) &&
+            (ExpressionMatch.rm_so == 0) &&
+            (Input[ExpressionMatch.rm_eo] == '\0')) {
+
             Match = TRUE;
-            if ((Context->Options & GREP_OPTION_FULL_LINE_ONLY) != 0) {
-                if ((ExpressionMatch.rm_so != 0) ||
-                    (Input[ExpressionMatch.rm_eo - 1] != '\0')) {
+        }
 
-                    Match = FALSE;
-                }
-            }
+    } else {
+        Status = regexec(&(Pattern->Expression), Input, 0, NULL, 0);
+        if (Status == 0) {
+            Match = TRUE;
         }
     }
 
@@ -1737,11 +1835,14 @@ Return Value:
 
 {
 
-    ULONG BeginIndex;
+    UCHAR Character;
     BOOL IgnoreCase;
+    ULONG InputLength;
+    ULONG Last;
     BOOL Match;
     PSTR PatternString;
     ULONG SearchIndex;
+    ULONG Start;
 
     IgnoreCase = FALSE;
     if ((Context->Options & GREP_OPTION_IGNORE_CASE) != 0) {
@@ -1750,52 +1851,75 @@ Return Value:
 
     Match = FALSE;
     PatternString = Pattern->Pattern;
-    SearchIndex = 0;
-    BeginIndex = 0;
-    while (Input[BeginIndex] != '\0') {
-        SearchIndex = 0;
+    InputLength = strlen(Input);
 
-        //
-        // This seems like a mess, but isn't so bad. Loop as long as:
-        // 1. The pattern hasn't ended, AND
-        // 2. Either:
-        //    a. The pattern matches the input, OR
-        //    b. "Ignore case" is on and the lowercase versions of the pattern
-        //       and inputs match.
-        //
-        // See, not so bad.
-        //
+    //
+    // A full line match only needs one comparison, at the start of the line.
+    //
+
+    if ((Context->Options & GREP_OPTION_FULL_LINE_ONLY) != 0) {
+        if (InputLength != Pattern->PatternLength) {
+            return FALSE;
+        }
+
+        Start = 0;
 
-        while ((PatternString[SearchIndex] != '\0') &&
-               ((Input[BeginIndex + SearchIndex] ==
-                 PatternString[SearchIndex]) ||
-                ((IgnoreCase != FALSE) &&
-                 (tolower(Input[BeginIndex + SearchIndex]) ==
-                  tolower(PatternString[SearchIndex]))))) {
+    //
+    // Otherwise slide the pattern across the input. The shift table is
+    // indexed by the input character lined up with the end of the pattern,
+    // so most mismatches skip ahead by nearly the whole pattern length.
+    // Pattern strings were already lowercased if case is being ignored.
+    //
 
-            SearchIndex += 1;
+    } else {
+        if (Pattern->PatternLength == 0) {
+            return TRUE;
         }
 
-        if (PatternString[SearchIndex] == '\0') {
-            Match = TRUE;
-            break;
+        if (InputLength < Pattern->PatternLength) {
+            return FALSE;
+        }
+
+        Last = Pattern->PatternLength - 1;
+        Start = 0;
+        while (Start <= InputLength - Pattern->PatternLength) {
+            SearchIndex = Last;
+            while (TRUE) {
+                Character = Input[Start + SearchIndex];
+                if (IgnoreCase != FALSE) {
+                    Character = tolower(Character);
+                }
+
+                if (Character != (UCHAR)(PatternString[SearchIndex])) {
+                    break;
+                }
+
+                if (SearchIndex == 0) {
+                    return TRUE;
+                }
+
+                SearchIndex -= 1;
+            }
+
+            Start += Pattern->Skip[(UCHAR)(Input[Start + Last])];
         }
 
-        BeginIndex += 1;
+        return FALSE;
     }
 
-    //
-    // If there's a match and it's required to use up the whole line, see that
-    // it does. That case could have been optimized by stopping the loop above
-    // early, but it's expected to be an uncommonly used flag, so adding the
-    // extra compare in every loop iteration seemed worse.
-    //
+    Match = TRUE;
+    for (SearchIndex = 0;
+         SearchIndex < Pattern->PatternLength;
+         SearchIndex += 1) {
 
-    if ((Match != FALSE) &&
-        ((Context->Options & GREP_OPTION_FULL_LINE_ONLY) != 0)) {
+        Character = Input[Start + SearchIndex];
+        if (IgnoreCase != FALSE) {
+            Character = tolower(Character);
+        }
 
-        if ((BeginIndex != 0) || (Input[BeginIndex + SearchIndex] != '\0')) {
+        if (Character != (UCHAR)(PatternString[SearchIndex])) {
             Match = FALSE;
+            break;
         }
     }
 
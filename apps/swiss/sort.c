@@ -34,9 +34,12 @@ Module Name:
 #include <assert.h>
 #include <ctype.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <getopt.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "swlib.h"
@@ -49,7 +52,8 @@ Module Name:
 #define SORT_VERSION_MINOR 0
 
 #define SORT_USAGE                                                             \
-    "usage: sort [-m][-o output][-bdfinru][-t char][-k keydef]... [file...]\n" \
+    "usage: sort [-m][-o output][-bdfinru][-t char][-k keydef]... [-S size]\n" \
+    "            [-T dir][--parallel=count] [file...]\n"                       \
     "       sort -c [-bdfinru][-t char][-k keydef][file]\n\n"                  \
     "The sort utility either sorts all lines in a file, merges line of all \n" \
     "the named (presorted) files together, or checks to see if a single \n"    \
@@ -84,10 +88,17 @@ Module Name:
     "        flag meaning to that specific field.\n"                           \
     "  -t, --field-separator <character> -- Use the given character as a \n"   \
     "        field separator.\n"                                               \
+    "  -S, --buffer-size <size> -- Hold at most roughly the given amount \n"   \
+    "        of input in memory. Larger inputs are sorted in chunks that \n"   \
+    "        are written to temporary files and then merged. The size is \n"   \
+    "        in kilobytes unless followed by b, K, M, or G.\n"                 \
+    "  -T, --temporary-directory <dir> -- Create temporary files in the \n"    \
+    "        given directory rather than $TMPDIR or /tmp.\n"                   \
+    "  --parallel=<count> -- Sort using up to the given number of threads.\n"  \
     "  file -- Supplies the input file to sort. If no file is supplied or \n"  \
     "        the file is -, then use stdin.\n\n"
 
-#define SORT_OPTIONS_STRING "cmo:udfinrbk:t:"
+#define SORT_OPTIONS_STRING "cmo:udfinrbk:t:S:T:"
 
 //
 // Set this option to ignore leading blanks in comparisons.
@@ -148,6 +159,52 @@ Module Name:
 #define SORT_INITIAL_ELEMENT_COUNT 32
 #define SORT_INITIAL_STRING_SIZE 32
 
+//
+// Define the default and minimum amount of input held in memory before it is
+// sorted and spilled out to a temporary file.
+//
+
+#define SORT_DEFAULT_BUFFER_SIZE (64 * 1024 * 1024)
+#define SORT_MINIMUM_BUFFER_SIZE (64 * 1024)
+
+//
+// Define the estimated bookkeeping cost of each line held in memory, beyond
+// the line contents and its keys. This includes a guess at heap overhead.
+//
+
+#define SORT_LINE_OVERHEAD (sizeof(SORT_STRING) + sizeof(PVOID) + 32)
+
+//
+// Define the maximum number of temporary files merged at once. If there are
+// more than this, they are merged in several passes.
+//
+
+#define SORT_MAXIMUM_MERGE_INPUTS 16
+
+//
+// Define the maximum number of threads used to sort, and the minimum number
+// of lines worth handing to each thread.
+//
+
+#define SORT_MAXIMUM_THREADS 8
+#define SORT_MINIMUM_THREAD_LINES 4096
+
+//
+// Define temporary file parameters.
+//
+
+#define SORT_TEMPORARY_DIRECTORY_VARIABLE "TMPDIR"
+#define SORT_DEFAULT_TEMPORARY_DIRECTORY "/tmp"
+#define SORT_TEMPORARY_FILE_TEMPLATE "sortXXXXXX"
+#define SORT_TEMPORARY_FILE_PERMISSIONS (S_IRUSR | S_IWUSR)
+#define SORT_TEMPORARY_TRY_COUNT 100
+
+//
+// Define the value returned by getopt for the long-only parallel option.
+//
+
+#define SORT_PARALLEL_OPTION 'P'
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -199,6 +256,32 @@ typedef struct _SORT_ARRAY {
 
 /*++
 
+Structure Description:
+
+    This structure defines the region of a line covered by one sort key. It is
+    computed once when the line is read so that comparisons do not need to
+    find the fields again.
+
+Members:
+
+    Start - Stores the offset of the first character of the key, after
+        leading blanks are skipped if requested.
+
+    End - Stores the offset just beyond the key.
+
+    Value - Stores the numeric value of the key if it is compared
+        numerically.
+
+--*/
+
+typedef struct _SORT_KEY_RANGE {
+    ULONG Start;
+    ULONG End;
+    LONG Value;
+} SORT_KEY_RANGE, *PSORT_KEY_RANGE;
+
+/*++
+
 Structure Description:
 
     This structure defines a mutable string in the sort utility.
@@ -212,12 +295,16 @@ Structure Description:
 
     Capacity - Supplies the size of the buffer allocation.
 
+    Keys - Supplies an optional pointer to the array of precomputed key
+        regions for the line, one for each sort key.
+
 --*/
 
 typedef struct _SORT_STRING {
     PSTR Data;
     UINTN Size;
     UINTN Capacity;
+    PSORT_KEY_RANGE Keys;
 } SORT_STRING, *PSORT_STRING;
 
 /*++
@@ -233,11 +320,16 @@ Structure Description:
 
     Line - Stores a pointer to the string containing the most recent line.
 
+    TemporaryPath - Stores the path of the temporary file backing this input
+        if it is a sorted run created by the utility itself. The file is
+        deleted when the input is destroyed.
+
 --*/
 
 typedef struct _SORT_INPUT {
     FILE *File;
     PSORT_STRING Line;
+    PSTR TemporaryPath;
 } SORT_INPUT, *PSORT_INPUT;
 
 /*++
@@ -294,6 +386,16 @@ Structure Description:
     Separator - Stores the field separator character, or -1 if none was
         supplied.
 
+    Runs - Stores the array of pointers to sorted temporary files waiting to
+        be merged.
+
+    BufferSize - Stores the approximate number of bytes of input to hold in
+        memory before spilling sorted lines out to a temporary file.
+
+    TemporaryDirectory - Stores the directory temporary files are created in.
+
+    ThreadCount - Stores the maximum number of threads to sort with.
+
 --*/
 
 typedef struct _SORT_CONTEXT {
@@ -302,8 +404,63 @@ typedef struct _SORT_CONTEXT {
     ULONG Options;
     PSTR Output;
     INT Separator;
+    SORT_ARRAY Runs;
+    UINTN BufferSize;
+    PSTR TemporaryDirectory;
+    ULONG ThreadCount;
 } SORT_CONTEXT, *PSORT_CONTEXT;
 
+/*++
+
+Structure Description:
+
+    This structure defines one source of lines during a merge, either an input
+    file or a sorted range of lines in memory.
+
+Members:
+
+    Line - Stores a pointer to the current line from this source, or NULL if
+        the source is drained.
+
+    Input - Stores a pointer to the input file to read lines from, or NULL if
+        this source is in memory.
+
+    Next - Stores a pointer to the next line of an in-memory source.
+
+    End - Stores a pointer just beyond the last line of an in-memory source.
+
+--*/
+
+typedef struct _SORT_MERGE_SOURCE {
+    PSORT_STRING Line;
+    PSORT_INPUT Input;
+    PVOID *Next;
+    PVOID *End;
+} SORT_MERGE_SOURCE, *PSORT_MERGE_SOURCE;
+
+/*++
+
+Structure Description:
+
+    This structure defines a range of lines sorted by a single thread.
+
+Members:
+
+    Data - Stores a pointer to the first line pointer in the range.
+
+    Size - Stores the number of lines in the range.
+
+    Thread - Stores the handle of the thread sorting the range, or NULL if the
+        range is sorted by the main thread.
+
+--*/
+
+typedef struct _SORT_SLICE {
+    PVOID *Data;
+    UINTN Size;
+    PVOID Thread;
+} SORT_SLICE, *PSORT_SLICE;
+
 //
 // ----------------------------------------------- Internal Function Prototypes
 //
@@ -314,12 +471,82 @@ SortCheckFile (
     PSORT_INPUT Input
     );
 
+INT
+SortSortInputs (
+    PSORT_CONTEXT Context,
+    FILE *Output
+    );
+
+INT
+SortSortLines (
+    PSORT_CONTEXT Context,
+    PSORT_ARRAY Lines,
+    FILE *Output
+    );
+
+PVOID
+SortSortSlice (
+    PVOID Parameter
+    );
+
+INT
+SortWriteRun (
+    PSORT_CONTEXT Context,
+    PSORT_ARRAY Lines
+    );
+
+INT
+SortMergeRuns (
+    PSORT_CONTEXT Context,
+    FILE *Output
+    );
+
+INT
+SortCreateRun (
+    PSORT_CONTEXT Context,
+    PSORT_INPUT *Run
+    );
+
+INT
+SortFinishRun (
+    PSORT_INPUT Run
+    );
+
 INT
 SortMergeSortedFiles (
     PSORT_CONTEXT Context,
+    PSORT_ARRAY Inputs,
+    FILE *Output
+    );
+
+INT
+SortMergeSources (
+    PSORT_CONTEXT Context,
+    PSORT_MERGE_SOURCE Sources,
+    UINTN SourceCount,
     FILE *Output
     );
 
+INT
+SortAdvanceSource (
+    PSORT_CONTEXT Context,
+    PSORT_MERGE_SOURCE Source,
+    PSORT_STRING Holding
+    );
+
+VOID
+SortSiftDown (
+    PSORT_MERGE_SOURCE *Heap,
+    UINTN HeapSize,
+    UINTN Index
+    );
+
+INT
+SortCompareSources (
+    PSORT_MERGE_SOURCE Left,
+    PSORT_MERGE_SOURCE Right
+    );
+
 INT
 SortCompareLines (
     const VOID *LeftPointer,
@@ -346,6 +573,18 @@ SortAddKey (
     PSTR Argument
     );
 
+INT
+SortParseSize (
+    PSTR Argument,
+    PUINTN Size
+    );
+
+INT
+SortComputeKeys (
+    PSORT_CONTEXT Context,
+    PSORT_STRING String
+    );
+
 VOID
 SortScanKeyFlags (
     PSTR *Argument,
@@ -426,6 +665,9 @@ struct option SortLongOptions[] = {
     {"ignore-leading-blanks", no_argument, 0, 'b'},
     {"key", required_argument, 0, 'k'},
     {"field-separator", required_argument, 0, 't'},
+    {"buffer-size", required_argument, 0, 'S'},
+    {"temporary-directory", required_argument, 0, 'T'},
+    {"parallel", required_argument, 0, SORT_PARALLEL_OPTION},
     {"help", no_argument, 0, 'h'},
     {"version", no_argument, 0, 'V'},
     {NULL, 0, 0, 0}
@@ -462,28 +704,30 @@ Return Value:
 
 {
 
+    PSTR AfterScan;
     PSTR Argument;
     ULONG ArgumentIndex;
     SORT_CONTEXT Context;
-    PSORT_INPUT Input;
-    ULONG InputIndex;
-    PSORT_STRING InputLine;
-    SORT_ARRAY InputLines;
-    SORT_STRING InputString;
     PSORT_KEY Key;
     UINTN KeyIndex;
-    UINTN LineIndex;
     INT Option;
     FILE *Output;
-    PSORT_STRING PreviousLine;
+    INT ProcessorCount;
     INT Status;
+    LONG Value;
 
-    Input = NULL;
-    InputLine = NULL;
     memset(&Context, 0, sizeof(SORT_CONTEXT));
-    memset(&InputString, 0, sizeof(SORT_STRING));
-    memset(&InputLines, 0, sizeof(SORT_ARRAY));
     Context.Separator = -1;
+    Context.BufferSize = SORT_DEFAULT_BUFFER_SIZE;
+    Context.ThreadCount = 1;
+    ProcessorCount = SwGetProcessorCount(TRUE);
+    if (ProcessorCount > 1) {
+        Context.ThreadCount = ProcessorCount;
+        if (Context.ThreadCount > SORT_MAXIMUM_THREADS) {
+            Context.ThreadCount = SORT_MAXIMUM_THREADS;
+        }
+    }
+
     Output = NULL;
 
     //
@@ -629,6 +873,44 @@ Return Value:
 
             break;
 
+        case 'S':
+            Argument = optarg;
+
+            assert(Argument != NULL);
+
+            Status = SortParseSize(Argument, &(Context.BufferSize));
+            if (Status != 0) {
+                SwPrintError(0, Argument, "Invalid buffer size");
+                return 2;
+            }
+
+            break;
+
+        case 'T':
+            Context.TemporaryDirectory = optarg;
+
+            assert(Context.TemporaryDirectory != NULL);
+
+            break;
+
+        case SORT_PARALLEL_OPTION:
+            Argument = optarg;
+
+            assert(Argument != NULL);
+
+            Value = strtol(Argument, &AfterScan, 10);
+            if ((Value <= 0) || (*AfterScan != '\0')) {
+                SwPrintError(0, Argument, "Invalid thread count");
+                return 2;
+            }
+
+            if (Value > SORT_MAXIMUM_THREADS) {
+                Value = SORT_MAXIMUM_THREADS;
+            }
+
+            Context.ThreadCount = Value;
+            break;
+
         case 'V':
             SwPrintVersion(SORT_VERSION_MAJOR, SORT_VERSION_MINOR);
             return 1;
@@ -697,6 +979,20 @@ Return Value:
         Key->EndOptions |= Context.Options;
     }
 
+    //
+    // Figure out where temporary files go in case the input doesn't fit in
+    // memory.
+    //
+
+    if (Context.TemporaryDirectory == NULL) {
+        Context.TemporaryDirectory = getenv(SORT_TEMPORARY_DIRECTORY_VARIABLE);
+        if ((Context.TemporaryDirectory == NULL) ||
+            (*(Context.TemporaryDirectory) == '\0')) {
+
+            Context.TemporaryDirectory = SORT_DEFAULT_TEMPORARY_DIRECTORY;
+        }
+    }
+
     //
     // Open up the output if needed.
     //
@@ -729,76 +1025,15 @@ Return Value:
         goto MainEnd;
 
     } else if ((Context.Options & SORT_OPTION_MERGE_ONLY) != 0) {
-        Status = SortMergeSortedFiles(&Context, Output);
-        goto MainEnd;
-    }
-
-    //
-    // This is the real sort, not merge or check. Read in all inputs.
-    //
-
-    for (InputIndex = 0; InputIndex < Context.Input.Size; InputIndex += 1) {
-        Input = Context.Input.Data[InputIndex];
-        while (TRUE) {
-            Status = SortReadLine(&Context,
-                                  Input,
-                                  &InputString,
-                                  &InputLine);
-
-            if (Status != 0) {
-                SwPrintError(Status, NULL, "Failed to read line");
-                goto MainEnd;
-            }
-
-            if (InputLine == NULL) {
-                break;
-            }
-
-            Status = SortArrayAddElement(&InputLines, InputLine);
-            if (Status != 0) {
-                SortDestroyString(InputLine);
-                goto MainEnd;
-            }
-
-            InputLine = NULL;
-        }
-    }
-
-    if (InputLines.Size == 0) {
-        Status = 0;
+        Status = SortMergeSortedFiles(&Context, &(Context.Input), Output);
         goto MainEnd;
     }
 
     //
-    // Do it, sort the arrays.
-    //
-
-    qsort(InputLines.Data, InputLines.Size, sizeof(PVOID), SortCompareLines);
-
-    //
-    // Write all the lines to the output.
+    // This is the real sort, not merge or check.
     //
 
-    PreviousLine = NULL;
-    for (LineIndex = 0; LineIndex < InputLines.Size; LineIndex += 1) {
-        InputLine = InputLines.Data[LineIndex];
-
-        //
-        // If the unique flag is off, this is the first line, or the lines
-        // aren't equal then print the line.
-        //
-
-        if (((Context.Options & SORT_OPTION_UNIQUE) == 0) ||
-            (PreviousLine == NULL) ||
-            (SortCompareLines(&PreviousLine, &InputLine) != 0)) {
-
-            fprintf(Output, "%s\n", InputLine->Data);
-        }
-
-        PreviousLine = InputLine;
-    }
-
-    Status = 0;
+    Status = SortSortInputs(&Context, Output);
 
 MainEnd:
     SortContext = NULL;
@@ -809,13 +1044,10 @@ Return Value:
     SortDestroyArray(&(Context.Input),
                      (PSORT_DESTROY_ARRAY_ELEMENT_ROUTINE)SortDestroyInput);
 
-    SortDestroyArray(&(Context.Key), free);
-    if (InputString.Data != NULL) {
-        free(InputString.Data);
-    }
+    SortDestroyArray(&(Context.Runs),
+                     (PSORT_DESTROY_ARRAY_ELEMENT_ROUTINE)SortDestroyInput);
 
-    SortDestroyArray(&InputLines,
-                     (PSORT_DESTROY_ARRAY_ELEMENT_ROUTINE)SortDestroyString);
+    SortDestroyArray(&(Context.Key), free);
 
     if ((Status != 0) && (Status != 1)) {
         SwPrintError(Status, NULL, "Sort exiting abnormally");
@@ -892,52 +1124,791 @@ Return Value:
             if (((Context->Options & SORT_OPTION_UNIQUE) != 0) &&
                 (Comparison == 0)) {
 
-                Status = 1;
-                goto CheckFileEnd;
-            }
+                Status = 1;
+                goto CheckFileEnd;
+            }
+
+            SortDestroyString(PreviousLine);
+        }
+
+        PreviousLine = Line;
+        Line = NULL;
+    }
+
+    Status = 0;
+
+CheckFileEnd:
+    if (WorkingBuffer.Data != NULL) {
+        free(WorkingBuffer.Data);
+    }
+
+    if (Line != NULL) {
+        SortDestroyString(Line);
+    }
+
+    if (PreviousLine != NULL) {
+        SortDestroyString(PreviousLine);
+    }
+
+    return Status;
+}
+
+INT
+SortSortInputs (
+    PSORT_CONTEXT Context,
+    FILE *Output
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sorts all the input files. Lines are gathered in memory until
+    the buffer size is reached, at which point they are sorted and written
+    out to a temporary file. If everything fits in memory, the lines are
+    sorted and written straight to the output. Otherwise the temporary files
+    are merged together into the output.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Output - Supplies a pointer to the output file to write to.
+
+Return Value:
+
+    0 on success.
+
+    Non-zero on failure.
+
+--*/
+
+{
+
+    UINTN BatchSize;
+    SORT_STRING Holding;
+    PSORT_INPUT Input;
+    UINTN InputIndex;
+    PSORT_STRING Line;
+    SORT_ARRAY Lines;
+    INT Status;
+
+    BatchSize = 0;
+    memset(&Holding, 0, sizeof(SORT_STRING));
+    memset(&Lines, 0, sizeof(SORT_ARRAY));
+    for (InputIndex = 0; InputIndex < Context->Input.Size; InputIndex += 1) {
+        Input = Context->Input.Data[InputIndex];
+        while (TRUE) {
+            Status = SortReadLine(Context, Input, &Holding, &Line);
+            if (Status != 0) {
+                SwPrintError(Status, NULL, "Failed to read line");
+                goto SortInputsEnd;
+            }
+
+            if (Line == NULL) {
+                break;
+            }
+
+            Status = SortArrayAddElement(&Lines, Line);
+            if (Status != 0) {
+                SortDestroyString(Line);
+                goto SortInputsEnd;
+            }
+
+            //
+            // Once enough input has piled up, sort it and get it out of
+            // memory.
+            //
+
+            BatchSize += SORT_LINE_OVERHEAD + Line->Size +
+                         (Context->Key.Size * sizeof(SORT_KEY_RANGE));
+
+            if (BatchSize >= Context->BufferSize) {
+                Status = SortWriteRun(Context, &Lines);
+                if (Status != 0) {
+                    goto SortInputsEnd;
+                }
+
+                BatchSize = 0;
+            }
+        }
+    }
+
+    //
+    // If it all fit in memory, just sort it and write it out.
+    //
+
+    if (Context->Runs.Size == 0) {
+        Status = SortSortLines(Context, &Lines, Output);
+        goto SortInputsEnd;
+    }
+
+    if (Lines.Size != 0) {
+        Status = SortWriteRun(Context, &Lines);
+        if (Status != 0) {
+            goto SortInputsEnd;
+        }
+    }
+
+    Status = SortMergeRuns(Context, Output);
+
+SortInputsEnd:
+    if (Holding.Data != NULL) {
+        free(Holding.Data);
+    }
+
+    SortDestroyArray(&Lines,
+                     (PSORT_DESTROY_ARRAY_ELEMENT_ROUTINE)SortDestroyString);
+
+    return Status;
+}
+
+INT
+SortSortLines (
+    PSORT_CONTEXT Context,
+    PSORT_ARRAY Lines,
+    FILE *Output
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sorts an array of lines and writes them out. If there are
+    enough lines, the array is split into slices that are sorted in parallel
+    and then merged on the way out.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Lines - Supplies a pointer to the array of lines to sort. The lines are
+        reordered but remain owned by the array.
+
+    Output - Supplies a pointer to the file to write the sorted lines to.
+
+Return Value:
+
+    0 on success.
+
+    Non-zero on failure.
+
+--*/
+
+{
+
+    UINTN Index;
+    PSORT_SLICE Slice;
+    UINTN SliceCount;
+    SORT_SLICE Slices[SORT_MAXIMUM_THREADS];
+    SORT_MERGE_SOURCE Sources[SORT_MAXIMUM_THREADS];
+    UINTN Start;
+    INT Status;
+
+    SliceCount = Lines->Size / SORT_MINIMUM_THREAD_LINES;
+    if (SliceCount > Context->ThreadCount) {
+        SliceCount = Context->ThreadCount;
+    }
+
+    if (SliceCount == 0) {
+        SliceCount = 1;
+    }
+
+    //
+    // Hand every slice but the first off to a new thread, and sort the first
+    // one on this thread. If a thread can't be created, just sort that slice
+    // here.
+    //
+
+    Start = 0;
+    for (Index = 0; Index < SliceCount; Index += 1) {
+        Slice = &(Slices[Index]);
+        Slice->Data = Lines->Data + Start;
+        Slice->Size = (Lines->Size - Start) / (SliceCount - Index);
+        Slice->Thread = NULL;
+        Start += Slice->Size;
+        if (Index != 0) {
+            Status = SwCreateThread(SortSortSlice, Slice, &(Slice->Thread));
+            if (Status != 0) {
+                Slice->Thread = NULL;
+                SortSortSlice(Slice);
+            }
+        }
+    }
+
+    SortSortSlice(&(Slices[0]));
+    for (Index = 0; Index < SliceCount; Index += 1) {
+        Slice = &(Slices[Index]);
+        if (Slice->Thread != NULL) {
+            SwJoinThread(Slice->Thread);
+            Slice->Thread = NULL;
+        }
+
+        Sources[Index].Line = NULL;
+        Sources[Index].Input = NULL;
+        Sources[Index].Next = Slice->Data;
+        Sources[Index].End = Slice->Data + Slice->Size;
+    }
+
+    Status = SortMergeSources(Context, Sources, SliceCount, Output);
+    return Status;
+}
+
+PVOID
+SortSortSlice (
+    PVOID Parameter
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sorts a slice of lines. It may be run on its own thread.
+
+Arguments:
+
+    Parameter - Supplies a pointer to the slice to sort.
+
+Return Value:
+
+    NULL always.
+
+--*/
+
+{
+
+    PSORT_SLICE Slice;
+
+    Slice = Parameter;
+    if (Slice->Size > 1) {
+        qsort(Slice->Data, Slice->Size, sizeof(PVOID), SortCompareLines);
+    }
+
+    return NULL;
+}
+
+INT
+SortWriteRun (
+    PSORT_CONTEXT Context,
+    PSORT_ARRAY Lines
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sorts the given lines, writes them out to a new temporary
+    file, and then frees them.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Lines - Supplies a pointer to the array of lines. On success, the array
+        is emptied.
+
+Return Value:
+
+    0 on success.
+
+    Non-zero on failure.
+
+--*/
+
+{
+
+    UINTN Index;
+    PSORT_INPUT Run;
+    INT Status;
+
+    Status = SortCreateRun(Context, &Run);
+    if (Status != 0) {
+        return Status;
+    }
+
+    Status = SortSortLines(Context, Lines, Run->File);
+    if (Status != 0) {
+        return Status;
+    }
+
+    Status = SortFinishRun(Run);
+    if (Status != 0) {
+        return Status;
+    }
+
+    //
+    // Free the lines, but keep the array buffer around for the next batch.
+    //
+
+    for (Index = 0; Index < Lines->Size; Index += 1) {
+        SortDestroyString(Lines->Data[Index]);
+    }
+
+    Lines->Size = 0;
+    return 0;
+}
+
+INT
+SortMergeRuns (
+    PSORT_CONTEXT Context,
+    FILE *Output
+    )
+
+/*++
+
+Routine Description:
+
+    This routine merges all the temporary files into the output. If there are
+    too many to have open at once, they are first merged in groups into
+    larger temporary files.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Output - Supplies a pointer to the output file to write to.
+
+Return Value:
+
+    0 on success.
+
+    Non-zero on failure.
+
+--*/
+
+{
+
+    SORT_ARRAY Group;
+    UINTN Index;
+    PSORT_INPUT Run;
+    PSORT_ARRAY Runs;
+    INT Status;
+
+    Runs = &(Context->Runs);
+    while (Runs->Size > SORT_MAXIMUM_MERGE_INPUTS) {
+        Status = SortCreateRun(Context, &Run);
+        if (Status != 0) {
+            return Status;
+        }
+
+        //
+        // The new run goes at the end of the array, so the oldest runs get
+        // merged first.
+        //
+
+        Group.Data = Runs->Data;
+        Group.Size = SORT_MAXIMUM_MERGE_INPUTS;
+        Group.Capacity = SORT_MAXIMUM_MERGE_INPUTS;
+        Status = SortMergeSortedFiles(Context, &Group, Run->File);
+        if (Status != 0) {
+            return Status;
+        }
+
+        Status = SortFinishRun(Run);
+        if (Status != 0) {
+            return Status;
+        }
+
+        for (Index = 0; Index < SORT_MAXIMUM_MERGE_INPUTS; Index += 1) {
+            SortDestroyInput(Runs->Data[Index]);
+        }
+
+        Runs->Size -= SORT_MAXIMUM_MERGE_INPUTS;
+        memmove(Runs->Data,
+                Runs->Data + SORT_MAXIMUM_MERGE_INPUTS,
+                Runs->Size * sizeof(PVOID));
+    }
+
+    Status = SortMergeSortedFiles(Context, Runs, Output);
+    return Status;
+}
+
+INT
+SortCreateRun (
+    PSORT_CONTEXT Context,
+    PSORT_INPUT *Run
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates a new temporary file to hold a sorted run, and adds
+    it to the end of the run array.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Run - Supplies a pointer where a pointer to the new run will be returned.
+        The run is owned by the run array.
+
+Return Value:
+
+    0 on success.
+
+    Non-zero on failure.
+
+--*/
+
+{
+
+    INT Descriptor;
+    UINTN DirectorySize;
+    UINTN Index;
+    PSORT_INPUT Input;
+    CHAR Name[sizeof(SORT_TEMPORARY_FILE_TEMPLATE)];
+    PSTR Path;
+    ULONG PathSize;
+    BOOL Result;
+    INT Status;
+    ULONG Try;
+
+    *Run = NULL;
+    Descriptor = -1;
+    Path = NULL;
+    Input = malloc(sizeof(SORT_INPUT));
+    if (Input == NULL) {
+        Status = ENOMEM;
+        goto CreateRunEnd;
+    }
+
+    memset(Input, 0, sizeof(SORT_INPUT));
+    DirectorySize = strlen(Context->TemporaryDirectory) + 1;
+    Status = EEXIST;
+    for (Try = 0; Try < SORT_TEMPORARY_TRY_COUNT; Try += 1) {
+        strcpy(Name, SORT_TEMPORARY_FILE_TEMPLATE);
+        for (Index = 0; Index < sizeof(Name) - 1; Index += 1) {
+            if (Name[Index] == 'X') {
+                Name[Index] = 'A' + (rand() % 26);
+            }
+        }
+
+        Result = SwAppendPath(Context->TemporaryDirectory,
+                              DirectorySize,
+                              Name,
+                              sizeof(Name),
+                              &Path,
+                              &PathSize);
+
+        if (Result == FALSE) {
+            Status = ENOMEM;
+            goto CreateRunEnd;
+        }
+
+        Descriptor = SwOpen(Path,
+                            O_RDWR | O_CREAT | O_EXCL | O_BINARY,
+                            SORT_TEMPORARY_FILE_PERMISSIONS);
+
+        if (Descriptor >= 0) {
+            Status = 0;
+            break;
+        }
+
+        Status = errno;
+        if (Status != EEXIST) {
+            SwPrintError(Status, Path, "Failed to create temporary file");
+            goto CreateRunEnd;
+        }
+
+        free(Path);
+        Path = NULL;
+    }
+
+    if (Status != 0) {
+        SwPrintError(Status, NULL, "Failed to create temporary file");
+        goto CreateRunEnd;
+    }
+
+    Input->File = fdopen(Descriptor, "w+b");
+    if (Input->File == NULL) {
+        Status = errno;
+        goto CreateRunEnd;
+    }
+
+    Descriptor = -1;
+    Input->TemporaryPath = Path;
+    Path = NULL;
+    Status = SortArrayAddElement(&(Context->Runs), Input);
+    if (Status != 0) {
+        goto CreateRunEnd;
+    }
+
+    *Run = Input;
+    Input = NULL;
+
+CreateRunEnd:
+    if (Descriptor >= 0) {
+        close(Descriptor);
+    }
+
+    if (Path != NULL) {
+        unlink(Path);
+        free(Path);
+    }
+
+    if (Input != NULL) {
+        SortDestroyInput(Input);
+    }
+
+    return Status;
+}
+
+INT
+SortFinishRun (
+    PSORT_INPUT Run
+    )
+
+/*++
+
+Routine Description:
+
+    This routine finishes writing a temporary file and rewinds it so that it
+    can be read back in.
+
+Arguments:
+
+    Run - Supplies a pointer to the run.
+
+Return Value:
+
+    0 on success.
+
+    Non-zero on failure.
+
+--*/
+
+{
+
+    INT Status;
+
+    if ((fflush(Run->File) != 0) || (ferror(Run->File) != 0)) {
+        Status = errno;
+        if (Status == 0) {
+            Status = EIO;
+        }
+
+        SwPrintError(Status,
+                     Run->TemporaryPath,
+                     "Failed to write temporary file");
+
+        return Status;
+    }
+
+    rewind(Run->File);
+    return 0;
+}
+
+INT
+SortMergeSortedFiles (
+    PSORT_CONTEXT Context,
+    PSORT_ARRAY Inputs,
+    FILE *Output
+    )
+
+/*++
+
+Routine Description:
+
+    This routine merges several files that are already in order.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Inputs - Supplies a pointer to the array of inputs to merge.
+
+    Output - Supplies a pointer to the output file to write to.
+
+Return Value:
+
+    0 on success.
+
+    Non-zero on failure.
+
+--*/
+
+{
+
+    UINTN InputIndex;
+    PSORT_MERGE_SOURCE Sources;
+    INT Status;
+
+    if (Inputs->Size == 0) {
+        return 0;
+    }
+
+    Sources = malloc(Inputs->Size * sizeof(SORT_MERGE_SOURCE));
+    if (Sources == NULL) {
+        return ENOMEM;
+    }
+
+    memset(Sources, 0, Inputs->Size * sizeof(SORT_MERGE_SOURCE));
+    for (InputIndex = 0; InputIndex < Inputs->Size; InputIndex += 1) {
+        Sources[InputIndex].Input = Inputs->Data[InputIndex];
+    }
+
+    Status = SortMergeSources(Context, Sources, Inputs->Size, Output);
+    free(Sources);
+    return Status;
+}
+
+INT
+SortMergeSources (
+    PSORT_CONTEXT Context,
+    PSORT_MERGE_SOURCE Sources,
+    UINTN SourceCount,
+    FILE *Output
+    )
+
+/*++
+
+Routine Description:
+
+    This routine merges several sorted sources of lines into the output. The
+    sources are kept in a heap ordered by their current lines, so each line
+    costs a logarithmic number of comparisons in the number of sources.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    Sources - Supplies an array of sources to merge.
+
+    SourceCount - Supplies the number of elements in the source array.
+
+    Output - Supplies a pointer to the output file to write to.
+
+Return Value:
+
+    0 on success.
+
+    Non-zero on failure.
+
+--*/
+
+{
+
+    PSORT_MERGE_SOURCE *Heap;
+    UINTN HeapSize;
+    UINTN Index;
+    PSORT_STRING PreviousWinner;
+    BOOL PreviousWinnerOwned;
+    INT Status;
+    PSORT_MERGE_SOURCE Winner;
+    SORT_STRING WorkingBuffer;
+
+    HeapSize = 0;
+    PreviousWinner = NULL;
+    PreviousWinnerOwned = FALSE;
+    memset(&WorkingBuffer, 0, sizeof(SORT_STRING));
+    Heap = malloc(SourceCount * sizeof(PSORT_MERGE_SOURCE));
+    if (Heap == NULL) {
+        Status = ENOMEM;
+        goto MergeSourcesEnd;
+    }
+
+    //
+    // Prime all the sources by getting their first lines.
+    //
+
+    for (Index = 0; Index < SourceCount; Index += 1) {
+        Status = SortAdvanceSource(Context, &(Sources[Index]), &WorkingBuffer);
+        if (Status != 0) {
+            goto MergeSourcesEnd;
+        }
+
+        if (Sources[Index].Line != NULL) {
+            Heap[HeapSize] = &(Sources[Index]);
+            HeapSize += 1;
+        }
+    }
+
+    for (Index = HeapSize / 2; Index > 0; Index -= 1) {
+        SortSiftDown(Heap, HeapSize, Index - 1);
+    }
+
+    //
+    // Loop writing the winning line until all sources are drained.
+    //
+
+    while (HeapSize != 0) {
+        Winner = Heap[0];
+        if (((Context->Options & SORT_OPTION_UNIQUE) == 0) ||
+            (PreviousWinner == NULL) ||
+            (SortCompareLines(&(Winner->Line), &PreviousWinner) != 0)) {
+
+            fputs(Winner->Line->Data, Output);
+            fputc('\n', Output);
+        }
+
+        //
+        // Lines read from files belong to the merge once they've won, but
+        // lines in memory belong to the caller's array.
+        //
+
+        if ((PreviousWinner != NULL) && (PreviousWinnerOwned != FALSE)) {
+            SortDestroyString(PreviousWinner);
+        }
+
+        PreviousWinner = Winner->Line;
+        PreviousWinnerOwned = FALSE;
+        if (Winner->Input != NULL) {
+            Winner->Input->Line = NULL;
+            PreviousWinnerOwned = TRUE;
+        }
+
+        Status = SortAdvanceSource(Context, Winner, &WorkingBuffer);
+        if (Status != 0) {
+            goto MergeSourcesEnd;
+        }
 
-            SortDestroyString(PreviousLine);
+        if (Winner->Line == NULL) {
+            HeapSize -= 1;
+            Heap[0] = Heap[HeapSize];
         }
 
-        PreviousLine = Line;
-        Line = NULL;
+        SortSiftDown(Heap, HeapSize, 0);
     }
 
     Status = 0;
 
-CheckFileEnd:
-    if (WorkingBuffer.Data != NULL) {
-        free(WorkingBuffer.Data);
+MergeSourcesEnd:
+    if ((PreviousWinner != NULL) && (PreviousWinnerOwned != FALSE)) {
+        SortDestroyString(PreviousWinner);
     }
 
-    if (Line != NULL) {
-        SortDestroyString(Line);
+    if (WorkingBuffer.Data != NULL) {
+        free(WorkingBuffer.Data);
     }
 
-    if (PreviousLine != NULL) {
-        SortDestroyString(PreviousLine);
+    if (Heap != NULL) {
+        free(Heap);
     }
 
     return Status;
 }
 
 INT
-SortMergeSortedFiles (
+SortAdvanceSource (
     PSORT_CONTEXT Context,
-    FILE *Output
+    PSORT_MERGE_SOURCE Source,
+    PSORT_STRING Holding
     )
 
 /*++
 
 Routine Description:
 
-    This routine merges several files that are already in order.
+    This routine moves a merge source on to its next line.
 
 Arguments:
 
     Context - Supplies a pointer to the application context.
 
-    Output - Supplies a pointer to the output file to write to.
+    Source - Supplies a pointer to the source to advance.
+
+    Holding - Supplies a pointer to a transitory buffer to read lines into.
 
 Return Value:
 
@@ -949,120 +1920,133 @@ Return Value:
 
 {
 
-    INT Comparison;
-    PSORT_INPUT Input;
-    UINTN InputIndex;
-    PSORT_STRING PreviousWinner;
     INT Status;
-    PSORT_INPUT Winner;
-    SORT_STRING WorkingBuffer;
 
-    PreviousWinner = NULL;
-    memset(&WorkingBuffer, 0, sizeof(SORT_STRING));
+    if (Source->Input != NULL) {
 
-    //
-    // Prime all the inputs by reading their first lines.
-    //
+        assert(Source->Input->Line == NULL);
 
-    for (InputIndex = 0; InputIndex < Context->Input.Size; InputIndex += 1) {
-        Input = Context->Input.Data[InputIndex];
         Status = SortReadLine(Context,
-                              Input,
-                              &WorkingBuffer,
-                              &(Input->Line));
+                              Source->Input,
+                              Holding,
+                              &(Source->Input->Line));
 
+        Source->Line = Source->Input->Line;
         if (Status != 0) {
             SwPrintError(Status, NULL, "Failed to read file");
-            goto MergeSortedFilesEnd;
         }
+
+        return Status;
     }
 
-    //
-    // Loop getting the winning line until all files are drained.
-    //
+    Source->Line = NULL;
+    if (Source->Next < Source->End) {
+        Source->Line = *(Source->Next);
+        Source->Next += 1;
+    }
 
-    while (TRUE) {
-        Winner = NULL;
-        for (InputIndex = 0;
-             InputIndex < Context->Input.Size;
-             InputIndex += 1) {
-
-            Input = Context->Input.Data[InputIndex];
-            if (Input->Line == NULL) {
-                continue;
-            }
+    return 0;
+}
 
-            if (Winner == NULL) {
-                Winner = Input;
+VOID
+SortSiftDown (
+    PSORT_MERGE_SOURCE *Heap,
+    UINTN HeapSize,
+    UINTN Index
+    )
 
-            } else {
+/*++
 
-                //
-                // If this input's line is less than the current winner, set it
-                // to the new winner.
-                //
+Routine Description:
 
-                Comparison = SortCompareLines(&(Input->Line), &(Winner->Line));
-                if (Comparison < 0) {
-                    Winner = Input;
-                }
-            }
-        }
+    This routine moves an element of the merge heap down until it is no
+    greater than its children.
 
-        //
-        // If there is no winner, then all files must be drained. Stop.
-        //
+Arguments:
 
-        if (Winner == NULL) {
-            break;
-        }
+    Heap - Supplies the heap array.
 
-        //
-        // Print the line.
-        //
+    HeapSize - Supplies the number of elements in the heap.
 
-        if (((Context->Options & SORT_OPTION_UNIQUE) == 0) ||
-            (PreviousWinner == NULL) ||
-            (SortCompareLines(&(Winner->Line), &PreviousWinner) != 0)) {
+    Index - Supplies the index of the element to move down.
 
-            fprintf(Output, "%s\n", Winner->Line->Data);
-        }
+Return Value:
 
-        //
-        // Set the new previous winner, and read a new line from that winning
-        // file.
-        //
+    None.
 
-        if (PreviousWinner != NULL) {
-            SortDestroyString(PreviousWinner);
+--*/
+
+{
+
+    UINTN Child;
+    PSORT_MERGE_SOURCE Swap;
+
+    while (TRUE) {
+        Child = (Index * 2) + 1;
+        if (Child >= HeapSize) {
+            break;
         }
 
-        PreviousWinner = Winner->Line;
-        if (Winner->Line != NULL) {
-            Status = SortReadLine(Context,
-                                  Winner,
-                                  &WorkingBuffer,
-                                  &(Winner->Line));
+        if ((Child + 1 < HeapSize) &&
+            (SortCompareSources(Heap[Child + 1], Heap[Child]) < 0)) {
 
-            if (Status != 0) {
-                SwPrintError(Status, NULL, "Failed to read file");
-                goto MergeSortedFilesEnd;
-            }
+            Child += 1;
         }
-    }
 
-    Status = 0;
+        if (SortCompareSources(Heap[Child], Heap[Index]) >= 0) {
+            break;
+        }
 
-MergeSortedFilesEnd:
-    if (PreviousWinner != NULL) {
-        SortDestroyString(PreviousWinner);
+        Swap = Heap[Index];
+        Heap[Index] = Heap[Child];
+        Heap[Child] = Swap;
+        Index = Child;
     }
 
-    if (WorkingBuffer.Data != NULL) {
-        free(WorkingBuffer.Data);
+    return;
+}
+
+INT
+SortCompareSources (
+    PSORT_MERGE_SOURCE Left,
+    PSORT_MERGE_SOURCE Right
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compares the current lines of two merge sources. Equal lines
+    are ordered by source so that earlier sources win ties.
+
+Arguments:
+
+    Left - Supplies a pointer to the left source.
+
+    Right - Supplies a pointer to the right source.
+
+Return Value:
+
+    Returns a negative value if the left source goes first, or a positive
+    value if the right source goes first.
+
+--*/
+
+{
+
+    INT Result;
+
+    Result = SortCompareLines(&(Left->Line), &(Right->Line));
+    if (Result == 0) {
+        if (Left < Right) {
+            Result = -1;
+
+        } else {
+            Result = 1;
+        }
     }
 
-    return Status;
+    return Result;
 }
 
 INT
@@ -1116,58 +2100,24 @@ Return Value:
     Context = SortContext;
     Left = *(PSORT_STRING *)LeftPointer;
     Right = *(PSORT_STRING *)RightPointer;
+
+    assert((Left->Keys != NULL) && (Right->Keys != NULL));
+
     for (KeyIndex = 0; KeyIndex < Context->Key.Size; KeyIndex += 1) {
         Key = Context->Key.Data[KeyIndex];
         Options = Key->StartOptions | Key->EndOptions;
-        SortGetFieldOffset(Left,
-                           Context->Separator,
-                           Key->StartField,
-                           Key->StartCharacter,
-                           &LeftStartIndex);
-
-        SortGetFieldOffset(Left,
-                           Context->Separator,
-                           Key->EndField,
-                           Key->EndCharacter,
-                           &LeftEndIndex);
-
-        SortGetFieldOffset(Right,
-                           Context->Separator,
-                           Key->StartField,
-                           Key->StartCharacter,
-                           &RightStartIndex);
-
-        SortGetFieldOffset(Right,
-                           Context->Separator,
-                           Key->EndField,
-                           Key->EndCharacter,
-                           &RightEndIndex);
-
-        //
-        // Strip leading blanks if requested.
-        //
-
-        if ((Options & SORT_OPTION_IGNORE_LEADING_BLANKS) != 0) {
-            while ((LeftStartIndex < LeftEndIndex) &&
-                   (isblank(Left->Data[LeftStartIndex]))) {
-
-                LeftStartIndex += 1;
-            }
-
-            while ((RightStartIndex < RightEndIndex) &&
-                   (isblank(Right->Data[RightStartIndex]))) {
-
-                RightStartIndex += 1;
-            }
-        }
+        LeftStartIndex = Left->Keys[KeyIndex].Start;
+        LeftEndIndex = Left->Keys[KeyIndex].End;
+        RightStartIndex = Right->Keys[KeyIndex].Start;
+        RightEndIndex = Right->Keys[KeyIndex].End;
 
         //
-        // Scan and compare the numbers if sorting numerically.
+        // Compare the numbers if sorting numerically.
         //
 
         if ((Options & SORT_OPTION_COMPARE_NUMERICALLY) != 0) {
-            LeftValue = SortStringToLong(Left, Options, LeftStartIndex);
-            RightValue = SortStringToLong(Right, Options, RightStartIndex);
+            LeftValue = Left->Keys[KeyIndex].Value;
+            RightValue = Right->Keys[KeyIndex].Value;
             if (LeftValue < RightValue) {
                 Result = -1;
                 if ((Options & SORT_OPTION_REVERSE) != 0) {
@@ -1378,7 +2328,17 @@ Return Value:
         goto ReadLineEnd;
     }
 
-    Result = 0;
+    //
+    // Find the keys now so comparisons don't have to parse the line every
+    // time.
+    //
+
+    Result = SortComputeKeys(Context, NewString);
+    if (Result != 0) {
+        SortDestroyString(NewString);
+        NewString = NULL;
+        goto ReadLineEnd;
+    }
 
 ReadLineEnd:
     *String = NewString;
@@ -1592,6 +2552,94 @@ Return Value:
     return Status;
 }
 
+INT
+SortParseSize (
+    PSTR Argument,
+    PUINTN Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine parses a buffer size argument, which is a number of
+    kilobytes, or a number followed by a suffix of b, K, M, or G.
+
+Arguments:
+
+    Argument - Supplies a pointer to the argument string.
+
+    Size - Supplies a pointer where the size in bytes will be returned.
+
+Return Value:
+
+    0 on success.
+
+    EINVAL if the argument is not valid.
+
+--*/
+
+{
+
+    PSTR AfterScan;
+    ULONGLONG Multiplier;
+    ULONGLONG Value;
+
+    Value = strtoull(Argument, &AfterScan, 10);
+    if (AfterScan == Argument) {
+        return EINVAL;
+    }
+
+    Multiplier = 1024ULL;
+    switch (*AfterScan) {
+    case '\0':
+        break;
+
+    case 'b':
+        Multiplier = 1;
+        AfterScan += 1;
+        break;
+
+    case 'k':
+    case 'K':
+        AfterScan += 1;
+        break;
+
+    case 'm':
+    case 'M':
+        Multiplier = 1024ULL * 1024ULL;
+        AfterScan += 1;
+        break;
+
+    case 'g':
+    case 'G':
+        Multiplier = 1024ULL * 1024ULL * 1024ULL;
+        AfterScan += 1;
+        break;
+
+    default:
+        return EINVAL;
+    }
+
+    if (*AfterScan != '\0') {
+        return EINVAL;
+    }
+
+    if (Value > MAX_UINTN / Multiplier) {
+        Value = MAX_UINTN;
+
+    } else {
+        Value *= Multiplier;
+    }
+
+    if (Value < SORT_MINIMUM_BUFFER_SIZE) {
+        Value = SORT_MINIMUM_BUFFER_SIZE;
+    }
+
+    *Size = (UINTN)Value;
+    return 0;
+}
+
 VOID
 SortScanKeyFlags (
     PSTR *Argument,
@@ -1866,6 +2914,10 @@ Return Value:
         free(String->Data);
     }
 
+    if (String->Keys != NULL) {
+        free(String->Keys);
+    }
+
     free(String);
     return;
 }
@@ -1946,6 +2998,11 @@ Return Value:
         SortDestroyString(Input->Line);
     }
 
+    if (Input->TemporaryPath != NULL) {
+        unlink(Input->TemporaryPath);
+        free(Input->TemporaryPath);
+    }
+
     free(Input);
     return;
 }
@@ -2079,6 +3136,85 @@ Return Value:
     return;
 }
 
+INT
+SortComputeKeys (
+    PSORT_CONTEXT Context,
+    PSORT_STRING String
+    )
+
+/*++
+
+Routine Description:
+
+    This routine finds the region of a line covered by each sort key, and
+    scans the numeric value of any numeric keys.
+
+Arguments:
+
+    Context - Supplies a pointer to the application context.
+
+    String - Supplies a pointer to the line. The key array is allocated and
+        attached to the string.
+
+Return Value:
+
+    0 on success.
+
+    ENOMEM on allocation failure.
+
+--*/
+
+{
+
+    PSORT_KEY Key;
+    UINTN KeyIndex;
+    PSORT_KEY_RANGE Keys;
+    ULONG Options;
+
+    Keys = malloc(Context->Key.Size * sizeof(SORT_KEY_RANGE));
+    if (Keys == NULL) {
+        return ENOMEM;
+    }
+
+    for (KeyIndex = 0; KeyIndex < Context->Key.Size; KeyIndex += 1) {
+        Key = Context->Key.Data[KeyIndex];
+        Options = Key->StartOptions | Key->EndOptions;
+        SortGetFieldOffset(String,
+                           Context->Separator,
+                           Key->StartField,
+                           Key->StartCharacter,
+                           &(Keys[KeyIndex].Start));
+
+        SortGetFieldOffset(String,
+                           Context->Separator,
+                           Key->EndField,
+                           Key->EndCharacter,
+                           &(Keys[KeyIndex].End));
+
+        //
+        // Strip leading blanks if requested.
+        //
+
+        if ((Options & SORT_OPTION_IGNORE_LEADING_BLANKS) != 0) {
+            while ((Keys[KeyIndex].Start < Keys[KeyIndex].End) &&
+                   (isblank(String->Data[Keys[KeyIndex].Start]))) {
+
+                Keys[KeyIndex].Start += 1;
+            }
+        }
+
+        Keys[KeyIndex].Value = 0;
+        if ((Options & SORT_OPTION_COMPARE_NUMERICALLY) != 0) {
+            Keys[KeyIndex].Value = SortStringToLong(String,
+                                                    Options,
+                                                    Keys[KeyIndex].Start);
+        }
+    }
+
+    String->Keys = Keys;
+    return 0;
+}
+
 LONG
 SortStringToLong (
     PSORT_STRING String,
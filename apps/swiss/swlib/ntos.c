@@ -34,6 +34,7 @@ Module Name:
 
 #include <windows.h>
 #include <psapi.h>
+#include <process.h>
 #include <assert.h>
 #include <ctype.h>
 #include <errno.h>
@@ -81,10 +82,38 @@ Module Name:
 // ------------------------------------------------------ Data Type Definitions
 //
 
+/*++
+
+Structure Description:
+
+    This structure stores the state of a thread created by the Swiss library.
+
+Members:
+
+    Handle - Stores the Win32 handle to the thread.
+
+    Routine - Stores the routine the thread runs.
+
+    Context - Stores the context pointer passed to the routine.
+
+--*/
+
+typedef struct _SWP_THREAD {
+    HANDLE Handle;
+    PSW_THREAD_ROUTINE Routine;
+    void *Context;
+} SWP_THREAD, *PSWP_THREAD;
+
 //
 // ----------------------------------------------- Internal Function Prototypes
 //
 
+unsigned
+__stdcall
+SwpThreadStart (
+    void *Parameter
+    );
+
 int
 SwpEscapeArguments (
     char **Arguments,
@@ -3988,10 +4017,140 @@ Return Value:
     return FileDescriptor;
 }
 
+int
+SwCreateThread (
+    PSW_THREAD_ROUTINE ThreadRoutine,
+    void *Context,
+    void **Thread
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates a new thread in the current process.
+
+Arguments:
+
+    ThreadRoutine - Supplies a pointer to the routine the thread runs.
+
+    Context - Supplies a context pointer passed to the thread routine.
+
+    Thread - Supplies a pointer where a handle to the thread will be returned
+        on success. The caller must pass this to SwJoinThread to release it.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error number on failure.
+
+--*/
+
+{
+
+    PSWP_THREAD NewThread;
+
+    *Thread = NULL;
+    NewThread = malloc(sizeof(SWP_THREAD));
+    if (NewThread == NULL) {
+        return ENOMEM;
+    }
+
+    NewThread->Routine = ThreadRoutine;
+    NewThread->Context = Context;
+    NewThread->Handle = (HANDLE)_beginthreadex(NULL,
+                                               0,
+                                               SwpThreadStart,
+                                               NewThread,
+                                               0,
+                                               NULL);
+
+    if (NewThread->Handle == NULL) {
+        free(NewThread);
+        return EAGAIN;
+    }
+
+    *Thread = NewThread;
+    return 0;
+}
+
+int
+SwJoinThread (
+    void *Thread
+    )
+
+/*++
+
+Routine Description:
+
+    This routine waits for a thread created with SwCreateThread to exit, and
+    releases the thread handle.
+
+Arguments:
+
+    Thread - Supplies the thread handle returned when the thread was created.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error number on failure.
+
+--*/
+
+{
+
+    PSWP_THREAD NtThread;
+    int Status;
+
+    NtThread = Thread;
+    Status = 0;
+    if (WaitForSingleObject(NtThread->Handle, INFINITE) != WAIT_OBJECT_0) {
+        Status = EINVAL;
+    }
+
+    CloseHandle(NtThread->Handle);
+    free(NtThread);
+    return Status;
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
 
+unsigned
+__stdcall
+SwpThreadStart (
+    void *Parameter
+    )
+
+/*++
+
+Routine Description:
+
+    This routine is the Win32 entry point for threads created by the Swiss
+    library. It calls the real thread routine.
+
+Arguments:
+
+    Parameter - Supplies a pointer to the thread structure.
+
+Return Value:
+
+    0 always.
+
+--*/
+
+{
+
+    PSWP_THREAD Thread;
+
+    Thread = Parameter;
+    Thread->Routine(Thread->Context);
+    return 0;
+}
+
 int
 SwpEscapeArguments (
     char **Arguments,
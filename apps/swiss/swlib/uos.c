@@ -3377,6 +3377,90 @@ Return Value:
     return open(Path, OpenFlags, Mode);
 }
 
+int
+SwCreateThread (
+    PSW_THREAD_ROUTINE ThreadRoutine,
+    void *Context,
+    void **Thread
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates a new thread in the current process.
+
+Arguments:
+
+    ThreadRoutine - Supplies a pointer to the routine the thread runs.
+
+    Context - Supplies a context pointer passed to the thread routine.
+
+    Thread - Supplies a pointer where a handle to the thread will be returned
+        on success. The caller must pass this to SwJoinThread to release it.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error number on failure.
+
+--*/
+
+{
+
+    pthread_t *NewThread;
+    int Status;
+
+    *Thread = NULL;
+    NewThread = malloc(sizeof(pthread_t));
+    if (NewThread == NULL) {
+        return ENOMEM;
+    }
+
+    Status = pthread_create(NewThread, NULL, ThreadRoutine, Context);
+    if (Status != 0) {
+        free(NewThread);
+        return Status;
+    }
+
+    *Thread = NewThread;
+    return 0;
+}
+
+int
+SwJoinThread (
+    void *Thread
+    )
+
+/*++
+
+Routine Description:
+
+    This routine waits for a thread created with SwCreateThread to exit, and
+    releases the thread handle.
+
+Arguments:
+
+    Thread - Supplies the thread handle returned when the thread was created.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error number on failure.
+
+--*/
+
+{
+
+    int Status;
+
+    Status = pthread_join(*((pthread_t *)Thread), NULL);
+    free(Thread);
+    return Status;
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
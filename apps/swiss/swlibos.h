@@ -674,6 +674,28 @@ typedef struct _SWISS_SIGNAL_NAME {
     char *SignalName;
 } SWISS_SIGNAL_NAME, *PSWISS_SIGNAL_NAME;
 
+typedef
+void *
+(*PSW_THREAD_ROUTINE) (
+    void *Context
+    );
+
+/*++
+
+Routine Description:
+
+    This routine is the entry point for a thread created by the Swiss library.
+
+Arguments:
+
+    Context - Supplies the context pointer passed when the thread was created.
+
+Return Value:
+
+    Returns a pointer sized value, which is ignored.
+
+--*/
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -2662,3 +2684,57 @@ Return Value:
 
 --*/
 
+int
+SwCreateThread (
+    PSW_THREAD_ROUTINE ThreadRoutine,
+    void *Context,
+    void **Thread
+    );
+
+/*++
+
+Routine Description:
+
+    This routine creates a new thread in the current process.
+
+Arguments:
+
+    ThreadRoutine - Supplies a pointer to the routine the thread runs.
+
+    Context - Supplies a context pointer passed to the thread routine.
+
+    Thread - Supplies a pointer where a handle to the thread will be returned
+        on success. The caller must pass this to SwJoinThread to release it.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error number on failure.
+
+--*/
+
+int
+SwJoinThread (
+    void *Thread
+    );
+
+/*++
+
+Routine Description:
+
+    This routine waits for a thread created with SwCreateThread to exit, and
+    releases the thread handle.
+
+Arguments:
+
+    Thread - Supplies the thread handle returned when the thread was created.
+
+Return Value:
+
+    0 on success.
+
+    Returns an error number on failure.
+
+--*/
+
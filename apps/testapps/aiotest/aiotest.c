@@ -29,6 +29,7 @@ Module Name:
 // ------------------------------------------------------------------- Includes
 //
 
+#include <aio.h>
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
@@ -36,9 +37,11 @@ Module Name:
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 #include <minoca/lib/types.h>
 
@@ -52,6 +55,18 @@ Module Name:
 // ---------------------------------------------------------------- Definitions
 //
 
+#define TEST_AIO_FILE_NAME "aiotest.tmp"
+#define TEST_AIO_CHUNK_COUNT 8
+#define TEST_AIO_CHUNK_SIZE 1024
+
+//
+// Define the number of reads to leave blocked at once. This is more than the
+// C library's ring can hold in its submission queue.
+//
+
+#define TEST_AIO_PENDING_COUNT 96
+#define TEST_AIO_PENDING_TIMEOUT 5
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -77,11 +92,34 @@ TestAioSigioHandler (
     void *Context
     );
 
+ULONG
+TestAioPosixFile (
+    VOID
+    );
+
+ULONG
+TestAioPosixPipe (
+    VOID
+    );
+
+ULONG
+TestAioPosixManyPending (
+    VOID
+    );
+
+void
+TestAioCompletionHandler (
+    int Signal,
+    siginfo_t *Information,
+    void *Context
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
 
 ULONG TestAioSignalCount;
+ULONG TestAioCompletionSignalCount;
 
 //
 // ------------------------------------------------------------------ Functions
@@ -119,6 +157,9 @@ Return Value:
     ULONG Failures;
 
     Failures = TestAioRun();
+    Failures += TestAioPosixFile();
+    Failures += TestAioPosixPipe();
+    Failures += TestAioPosixManyPending();
     if (Failures == 0) {
         return 0;
     }
@@ -436,3 +477,487 @@ Return Value:
     return;
 }
 
+ULONG
+TestAioPosixFile (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine tests POSIX asynchronous I/O against a regular file, batching
+    writes with lio_listio and reading them back with individual requests.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    0 on success.
+
+    Returns the number of errors on failure.
+
+--*/
+
+{
+
+    char *Buffer;
+    int Byte;
+    struct aiocb Controls[TEST_AIO_CHUNK_COUNT];
+    int Descriptor;
+    ULONG Failures;
+    int Index;
+    struct aiocb *List[TEST_AIO_CHUNK_COUNT];
+    char *ReadBuffer;
+    ssize_t Result;
+    struct aiocb Sync;
+
+    Failures = 0;
+    Buffer = malloc(TEST_AIO_CHUNK_COUNT * TEST_AIO_CHUNK_SIZE);
+    ReadBuffer = malloc(TEST_AIO_CHUNK_COUNT * TEST_AIO_CHUNK_SIZE);
+    if ((Buffer == NULL) || (ReadBuffer == NULL)) {
+        ERROR("Allocation failure.\n");
+        Failures += 1;
+        goto TestAioPosixFileEnd;
+    }
+
+    Descriptor = open(TEST_AIO_FILE_NAME, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (Descriptor < 0) {
+        ERROR("Failed to open %s: %s.\n", TEST_AIO_FILE_NAME, strerror(errno));
+        Failures += 1;
+        goto TestAioPosixFileEnd;
+    }
+
+    for (Byte = 0;
+         Byte < TEST_AIO_CHUNK_COUNT * TEST_AIO_CHUNK_SIZE;
+         Byte += 1) {
+
+        Buffer[Byte] = (char)(Byte * 7);
+    }
+
+    //
+    // Write all the chunks out in a single batch, in reverse order.
+    //
+
+    memset(Controls, 0, sizeof(Controls));
+    for (Index = 0; Index < TEST_AIO_CHUNK_COUNT; Index += 1) {
+        Byte = (TEST_AIO_CHUNK_COUNT - 1 - Index) * TEST_AIO_CHUNK_SIZE;
+        Controls[Index].aio_fildes = Descriptor;
+        Controls[Index].aio_offset = Byte;
+        Controls[Index].aio_buf = Buffer + Byte;
+        Controls[Index].aio_nbytes = TEST_AIO_CHUNK_SIZE;
+        Controls[Index].aio_sigevent.sigev_notify = SIGEV_NONE;
+        Controls[Index].aio_lio_opcode = LIO_WRITE;
+        List[Index] = &(Controls[Index]);
+    }
+
+    if (lio_listio(LIO_WAIT, List, TEST_AIO_CHUNK_COUNT, NULL) != 0) {
+        ERROR("lio_listio failed: %s.\n", strerror(errno));
+        Failures += 1;
+    }
+
+    for (Index = 0; Index < TEST_AIO_CHUNK_COUNT; Index += 1) {
+        if ((aio_error(&(Controls[Index])) != 0) ||
+            (aio_return(&(Controls[Index])) != TEST_AIO_CHUNK_SIZE)) {
+
+            ERROR("Batched write %d failed.\n", Index);
+            Failures += 1;
+        }
+    }
+
+    memset(&Sync, 0, sizeof(Sync));
+    Sync.aio_fildes = Descriptor;
+    Sync.aio_sigevent.sigev_notify = SIGEV_NONE;
+    List[0] = &Sync;
+    if ((aio_fsync(O_SYNC, &Sync) != 0) ||
+        (aio_suspend((const struct aiocb *const *)List, 1, NULL) != 0) ||
+        (aio_error(&Sync) != 0) ||
+        (aio_return(&Sync) != 0)) {
+
+        ERROR("aio_fsync failed.\n");
+        Failures += 1;
+    }
+
+    //
+    // Read the chunks back with individual requests, and wait for all of
+    // them to finish.
+    //
+
+    memset(ReadBuffer, 0, TEST_AIO_CHUNK_COUNT * TEST_AIO_CHUNK_SIZE);
+    for (Index = 0; Index < TEST_AIO_CHUNK_COUNT; Index += 1) {
+        Controls[Index].aio_buf = ReadBuffer + Controls[Index].aio_offset;
+        if (aio_read(&(Controls[Index])) != 0) {
+            ERROR("aio_read %d failed: %s.\n", Index, strerror(errno));
+            Failures += 1;
+        }
+    }
+
+    for (Index = 0; Index < TEST_AIO_CHUNK_COUNT; Index += 1) {
+        List[0] = &(Controls[Index]);
+        while (aio_error(&(Controls[Index])) == EINPROGRESS) {
+            aio_suspend((const struct aiocb *const *)List, 1, NULL);
+        }
+
+        Result = aio_return(&(Controls[Index]));
+        if (Result != TEST_AIO_CHUNK_SIZE) {
+            ERROR("aio_read %d returned %ld.\n", Index, (long)Result);
+            Failures += 1;
+        }
+    }
+
+    if (memcmp(Buffer,
+               ReadBuffer,
+               TEST_AIO_CHUNK_COUNT * TEST_AIO_CHUNK_SIZE) != 0) {
+
+        ERROR("Asynchronous read back did not match.\n");
+        Failures += 1;
+    }
+
+    if (aio_cancel(Descriptor, NULL) != AIO_ALLDONE) {
+        ERROR("aio_cancel did not report all done.\n");
+        Failures += 1;
+    }
+
+    close(Descriptor);
+    unlink(TEST_AIO_FILE_NAME);
+
+TestAioPosixFileEnd:
+    if (Buffer != NULL) {
+        free(Buffer);
+    }
+
+    if (ReadBuffer != NULL) {
+        free(ReadBuffer);
+    }
+
+    return Failures;
+}
+
+ULONG
+TestAioPosixPipe (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine tests POSIX asynchronous I/O against a pipe, where a read has
+    to stay pending in the kernel until data shows up.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    0 on success.
+
+    Returns the number of errors on failure.
+
+--*/
+
+{
+
+    struct sigaction Action;
+    char Buffer[16];
+    ULONG Failures;
+    struct aiocb *List[1];
+    struct sigaction OldAction;
+    int Pipe[2];
+    struct aiocb Read;
+    struct timespec Timeout;
+    struct aiocb Write;
+
+    Failures = 0;
+    if (pipe(Pipe) != 0) {
+        ERROR("Failed to create pipe.\n");
+        return 1;
+    }
+
+    memset(&Action, 0, sizeof(Action));
+    Action.sa_sigaction = TestAioCompletionHandler;
+    Action.sa_flags = SA_SIGINFO;
+    sigaction(SIGUSR1, &Action, &OldAction);
+    TestAioCompletionSignalCount = 0;
+
+    //
+    // A read on an empty pipe should stay in progress.
+    //
+
+    memset(&Read, 0, sizeof(Read));
+    memset(Buffer, 0, sizeof(Buffer));
+    Read.aio_fildes = Pipe[0];
+    Read.aio_offset = 0;
+    Read.aio_buf = Buffer;
+    Read.aio_nbytes = sizeof(Buffer);
+    Read.aio_sigevent.sigev_notify = SIGEV_NONE;
+    if (aio_read(&Read) != 0) {
+        ERROR("aio_read on pipe failed: %s.\n", strerror(errno));
+        Failures += 1;
+        goto TestAioPosixPipeEnd;
+    }
+
+    if (aio_error(&Read) != EINPROGRESS) {
+        ERROR("Pipe read did not stay in progress.\n");
+        Failures += 1;
+    }
+
+    Timeout.tv_sec = 0;
+    Timeout.tv_nsec = 10000000;
+    List[0] = &Read;
+    if ((aio_suspend((const struct aiocb *const *)List, 1, &Timeout) != -1) ||
+        (errno != EAGAIN)) {
+
+        ERROR("aio_suspend on an empty pipe did not time out.\n");
+        Failures += 1;
+    }
+
+    //
+    // Complete it with an asynchronous write that asks for a signal.
+    //
+
+    memset(&Write, 0, sizeof(Write));
+    Write.aio_fildes = Pipe[1];
+    Write.aio_offset = 0;
+    Write.aio_buf = "ring";
+    Write.aio_nbytes = 4;
+    Write.aio_sigevent.sigev_notify = SIGEV_SIGNAL;
+    Write.aio_sigevent.sigev_signo = SIGUSR1;
+    if (aio_write(&Write) != 0) {
+        ERROR("aio_write on pipe failed: %s.\n", strerror(errno));
+        Failures += 1;
+        goto TestAioPosixPipeEnd;
+    }
+
+    while (aio_error(&Read) == EINPROGRESS) {
+        if ((aio_suspend((const struct aiocb *const *)List, 1, NULL) != 0) &&
+            (errno != EINTR)) {
+
+            ERROR("aio_suspend failed: %s.\n", strerror(errno));
+            Failures += 1;
+            break;
+        }
+    }
+
+    if ((aio_return(&Read) != 4) || (memcmp(Buffer, "ring", 4) != 0)) {
+        ERROR("Pipe read got the wrong data.\n");
+        Failures += 1;
+    }
+
+    List[0] = &Write;
+    while (aio_error(&Write) == EINPROGRESS) {
+        aio_suspend((const struct aiocb *const *)List, 1, NULL);
+    }
+
+    if (aio_return(&Write) != 4) {
+        ERROR("Pipe write returned the wrong count.\n");
+        Failures += 1;
+    }
+
+    if (TestAioCompletionSignalCount != 1) {
+        ERROR("Got %u completion signals, expected 1.\n",
+              TestAioCompletionSignalCount);
+
+        Failures += 1;
+    }
+
+TestAioPosixPipeEnd:
+    sigaction(SIGUSR1, &OldAction, NULL);
+    close(Pipe[0]);
+    close(Pipe[1]);
+    return Failures;
+}
+
+ULONG
+TestAioPosixManyPending (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine tests having more asynchronous reads blocked in the kernel
+    at once than the ring's submission queue holds, and makes sure they all
+    complete once data arrives and that the ring still works afterwards.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    0 on success.
+
+    Returns the number of errors on failure.
+
+--*/
+
+{
+
+    char Buffers[TEST_AIO_PENDING_COUNT + 1];
+    ULONG Count;
+    char Data[TEST_AIO_PENDING_COUNT + 1];
+    ULONG Failures;
+    ULONG Index;
+    struct aiocb *List[1];
+    int Pipe[2];
+    struct aiocb Reads[TEST_AIO_PENDING_COUNT + 1];
+    struct timespec Timeout;
+
+    Count = 0;
+    Failures = 0;
+    if (pipe(Pipe) != 0) {
+        ERROR("Failed to create pipe.\n");
+        return 1;
+    }
+
+    memset(Reads, 0, sizeof(Reads));
+    memset(Buffers, 0, sizeof(Buffers));
+    memset(Data, 'p', sizeof(Data));
+    for (Index = 0; Index < TEST_AIO_PENDING_COUNT; Index += 1) {
+        Reads[Index].aio_fildes = Pipe[0];
+        Reads[Index].aio_buf = &(Buffers[Index]);
+        Reads[Index].aio_nbytes = 1;
+        Reads[Index].aio_sigevent.sigev_notify = SIGEV_NONE;
+        if (aio_read(&(Reads[Index])) != 0) {
+            ERROR("aio_read %u of %u failed: %s.\n",
+                  Index,
+                  TEST_AIO_PENDING_COUNT,
+                  strerror(errno));
+
+            Failures += 1;
+            break;
+        }
+
+        Count += 1;
+    }
+
+    for (Index = 0; Index < Count; Index += 1) {
+        if (aio_error(&(Reads[Index])) != EINPROGRESS) {
+            ERROR("Read %u on an empty pipe did not stay in progress.\n",
+                  Index);
+
+            Failures += 1;
+        }
+    }
+
+    //
+    // Feed the pipe one byte for each read and make sure every one of them
+    // completes.
+    //
+
+    if (write(Pipe[1], Data, Count) != Count) {
+        ERROR("Failed to write to pipe: %s.\n", strerror(errno));
+        Failures += 1;
+        goto TestAioPosixManyPendingEnd;
+    }
+
+    Timeout.tv_sec = TEST_AIO_PENDING_TIMEOUT;
+    Timeout.tv_nsec = 0;
+    for (Index = 0; Index < Count; Index += 1) {
+        List[0] = &(Reads[Index]);
+        while (aio_error(&(Reads[Index])) == EINPROGRESS) {
+            if ((aio_suspend((const struct aiocb *const *)List,
+                             1,
+                             &Timeout) != 0) &&
+                (errno == EAGAIN)) {
+
+                break;
+            }
+        }
+
+        if (aio_error(&(Reads[Index])) == EINPROGRESS) {
+            ERROR("Read %u of %u never completed.\n", Index, Count);
+            Failures += 1;
+            goto TestAioPosixManyPendingEnd;
+        }
+
+        if ((aio_return(&(Reads[Index])) != 1) || (Buffers[Index] != 'p')) {
+            ERROR("Read %u got the wrong data.\n", Index);
+            Failures += 1;
+        }
+    }
+
+    //
+    // Make sure the ring still takes new requests.
+    //
+
+    Index = TEST_AIO_PENDING_COUNT;
+    Reads[Index].aio_fildes = Pipe[0];
+    Reads[Index].aio_buf = &(Buffers[Index]);
+    Reads[Index].aio_nbytes = 1;
+    Reads[Index].aio_sigevent.sigev_notify = SIGEV_NONE;
+    if ((aio_read(&(Reads[Index])) != 0) ||
+        (write(Pipe[1], Data, 1) != 1)) {
+
+        ERROR("Ring failed after many pending reads: %s.\n",
+              strerror(errno));
+
+        Failures += 1;
+        goto TestAioPosixManyPendingEnd;
+    }
+
+    List[0] = &(Reads[Index]);
+    while (aio_error(&(Reads[Index])) == EINPROGRESS) {
+        if ((aio_suspend((const struct aiocb *const *)List,
+                         1,
+                         &Timeout) != 0) &&
+            (errno == EAGAIN)) {
+
+            ERROR("Read after many pending reads never completed.\n");
+            Failures += 1;
+            break;
+        }
+    }
+
+    if (aio_return(&(Reads[Index])) != 1) {
+        ERROR("Read after many pending reads failed.\n");
+        Failures += 1;
+    }
+
+TestAioPosixManyPendingEnd:
+    close(Pipe[0]);
+    close(Pipe[1]);
+    return Failures;
+}
+
+void
+TestAioCompletionHandler (
+    int Signal,
+    siginfo_t *Information,
+    void *Context
+    )
+
+/*++
+
+Routine Description:
+
+    This routine is called when an asynchronous I/O completion signal comes
+    in.
+
+Arguments:
+
+    Signal - Supplies the signal that occurred. This should always be SIGUSR1.
+
+    Information - Supplies a pointer to the signal information.
+
+    Context - Supplies an unused context pointer.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    assert(Signal == SIGUSR1);
+
+    TestAioCompletionSignalCount += 1;
+    return;
+}
+
@@ -41,6 +41,15 @@ Module Name:
 #define KTEST_WORK_DEFAULT_THREAD_COUNT 20
 #define KTEST_WORK_DEFAULT_ALLOCATION_SIZE 512
 
+//
+// Define how often the stress threads check that a blocked work item on a
+// per-processor queue does not stall the work items behind it, and how long
+// the blocked work item waits before calling it a failure.
+//
+
+#define KTEST_WORK_BLOCKING_INTERVAL 8
+#define KTEST_WORK_BLOCKING_TIMEOUT 10000
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -48,6 +57,8 @@ Module Name:
 typedef struct _KTEST_WORK_ITEM_CONTEXT {
     PKTEST_PARAMETERS Parameters;
     PKEVENT Event;
+    PKEVENT Gate;
+    KSTATUS GateStatus;
 } KTEST_WORK_ITEM_CONTEXT, *PKTEST_WORK_ITEM_CONTEXT;
 
 //
@@ -64,6 +75,16 @@ KTestWorkStressWorkRoutine (
     PVOID Parameter
     );
 
+VOID
+KTestWorkBlockingWorkRoutine (
+    PVOID Parameter
+    );
+
+VOID
+KTestWorkOpenGateWorkRoutine (
+    PVOID Parameter
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -151,7 +172,10 @@ KTestWorkStressRoutine (
 
 Routine Description:
 
-    This routine implements the work item stress test.
+    This routine implements the work item stress test. Every so often it
+    also queues a work item that blocks to a private per-processor work
+    queue, followed by a work item that unblocks it, to make sure that a
+    blocked worker does not hold up the rest of its processor's work items.
 
 Arguments:
 
@@ -166,13 +190,16 @@ Return Value:
 
 {
 
+    PWORK_ITEM BlockingWorkItem;
     ULONG Failures;
     PKTEST_ACTIVE_TEST Information;
     ULONG Iteration;
+    PWORK_ITEM OpenGateWorkItem;
     PKTEST_PARAMETERS Parameters;
     KSTATUS Status;
     ULONG ThreadNumber;
     KTEST_WORK_ITEM_CONTEXT WorkContext;
+    PWORK_QUEUE WorkQueue;
 
     Failures = 0;
     Information = Parameter;
@@ -180,7 +207,29 @@ Return Value:
     RtlZeroMemory(&WorkContext, sizeof(KTEST_WORK_ITEM_CONTEXT));
     WorkContext.Parameters = Parameters;
     WorkContext.Event = KeCreateEvent(NULL);
-    if (WorkContext.Event == NULL) {
+    WorkContext.Gate = KeCreateEvent(NULL);
+    BlockingWorkItem = NULL;
+    OpenGateWorkItem = NULL;
+    WorkQueue = KeCreateWorkQueue(WORK_QUEUE_FLAG_PER_PROCESSOR, "KTestWorker");
+    if (WorkQueue != NULL) {
+        BlockingWorkItem = KeCreateWorkItem(WorkQueue,
+                                            WorkPriorityNormal,
+                                            KTestWorkBlockingWorkRoutine,
+                                            &WorkContext,
+                                            KTEST_ALLOCATION_TAG);
+
+        OpenGateWorkItem = KeCreateWorkItem(WorkQueue,
+                                            WorkPriorityNormal,
+                                            KTestWorkOpenGateWorkRoutine,
+                                            &WorkContext,
+                                            KTEST_ALLOCATION_TAG);
+    }
+
+    if ((WorkContext.Event == NULL) ||
+        (WorkContext.Gate == NULL) ||
+        (BlockingWorkItem == NULL) ||
+        (OpenGateWorkItem == NULL)) {
+
         Failures += 1;
         Status = STATUS_INSUFFICIENT_RESOURCES;
         goto TestWorkStressRoutineEnd;
@@ -212,6 +261,34 @@ Return Value:
             goto TestWorkStressRoutineEnd;
         }
 
+        //
+        // Periodically queue a work item that blocks until a second work item
+        // queued behind it on the same processor runs.
+        //
+
+        if ((Iteration % KTEST_WORK_BLOCKING_INTERVAL) == 0) {
+            KeSignalEvent(WorkContext.Gate, SignalOptionUnsignal);
+            WorkContext.GateStatus = STATUS_NOT_STARTED;
+            Status = KeQueueWorkItem(BlockingWorkItem);
+            if (!KSUCCESS(Status)) {
+                Failures += 1;
+                goto TestWorkStressRoutineEnd;
+            }
+
+            Status = KeQueueWorkItem(OpenGateWorkItem);
+            if (!KSUCCESS(Status)) {
+                Failures += 1;
+                KeSignalEvent(WorkContext.Gate, SignalOptionSignalAll);
+                goto TestWorkStressRoutineEnd;
+            }
+
+            KeFlushWorkItem(BlockingWorkItem);
+            KeFlushWorkItem(OpenGateWorkItem);
+            if (!KSUCCESS(WorkContext.GateStatus)) {
+                Failures += 1;
+            }
+        }
+
         if (ThreadNumber == 0) {
             Information->Progress += 1;
         }
@@ -220,8 +297,29 @@ Return Value:
     Status = STATUS_SUCCESS;
 
 TestWorkStressRoutineEnd:
-    KeDestroyEvent(WorkContext.Event);
-    WorkContext.Event = NULL;
+    if (BlockingWorkItem != NULL) {
+        KeFlushWorkItem(BlockingWorkItem);
+        KeDestroyWorkItem(BlockingWorkItem);
+    }
+
+    if (OpenGateWorkItem != NULL) {
+        KeFlushWorkItem(OpenGateWorkItem);
+        KeDestroyWorkItem(OpenGateWorkItem);
+    }
+
+    if (WorkQueue != NULL) {
+        KeDestroyWorkQueue(WorkQueue);
+    }
+
+    if (WorkContext.Gate != NULL) {
+        KeDestroyEvent(WorkContext.Gate);
+        WorkContext.Gate = NULL;
+    }
+
+    if (WorkContext.Event != NULL) {
+        KeDestroyEvent(WorkContext.Event);
+        WorkContext.Event = NULL;
+    }
 
     //
     // Save the results.
@@ -294,3 +392,70 @@ Return Value:
     return;
 }
 
+VOID
+KTestWorkBlockingWorkRoutine (
+    PVOID Parameter
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements a work item that blocks until the work item
+    queued behind it opens the gate.
+
+Arguments:
+
+    Parameter - Supplies a pointer to the parameter, which in this
+        case is a pointer to the work item context.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PKTEST_WORK_ITEM_CONTEXT WorkContext;
+
+    WorkContext = Parameter;
+    WorkContext->GateStatus = KeWaitForEvent(WorkContext->Gate,
+                                             FALSE,
+                                             KTEST_WORK_BLOCKING_TIMEOUT);
+
+    return;
+}
+
+VOID
+KTestWorkOpenGateWorkRoutine (
+    PVOID Parameter
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements a work item that releases the blocking work item
+    queued ahead of it.
+
+Arguments:
+
+    Parameter - Supplies a pointer to the parameter, which in this
+        case is a pointer to the work item context.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PKTEST_WORK_ITEM_CONTEXT WorkContext;
+
+    WorkContext = Parameter;
+    KeSignalEvent(WorkContext->Gate, SignalOptionSignalAll);
+    return;
+}
+
@@ -36,6 +36,7 @@ function build() {
     var sources;
 
     sources = [
+        "compare.c",
         "copy.c",
         "create.c",
         "dlopen.c",
@@ -47,13 +48,18 @@ function build() {
         "mmap.c",
         "mutex.c",
         "open.c",
+        "pathwalk.c",
         "perfsup.c",
         "perftest.c",
         "pipeio.c",
+        "poll.c",
         "pthread.c",
         "read.c",
         "rename.c",
+        "seqio.c",
         "signal.c",
+        "socket.c",
+        "spawn.c",
         "stat.c",
         "write.c"
     ];
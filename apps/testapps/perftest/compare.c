@@ -0,0 +1,860 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    compare.c
+
+Abstract:
+
+    This module implements comparison of two sets of performance benchmark
+    results, flagging the tests whose results changed by a statistically
+    significant amount.
+
+Author:
+
+    agent 19-Oct-2026
+
+Environment:
+
+    User
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+
+#include "perftest.h"
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+#define PT_COMPARE_LINE_SIZE 1024
+
+//
+// Define the CSV columns used by the comparison. These must match the order
+// in which perftest writes its CSV results.
+//
+
+#define PT_CSV_COLUMN_TEST 0
+#define PT_CSV_COLUMN_PROCESSES 1
+#define PT_CSV_COLUMN_RATE 5
+#define PT_CSV_COLUMN_LATENCY_COUNT 8
+#define PT_CSV_COLUMN_LATENCY_P99 11
+#define PT_CSV_COLUMN_COUNT 14
+
+//
+// Define the number of degrees of freedom covered by the critical value
+// table before falling back to the coarser large sample values.
+//
+
+#define PT_T_TABLE_SIZE 30
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+typedef enum _PT_COMPARE_VERDICT {
+    PtCompareInsufficientData,
+    PtCompareNoChange,
+    PtCompareImprovement,
+    PtCompareRegression
+} PT_COMPARE_VERDICT, *PPT_COMPARE_VERDICT;
+
+/*++
+
+Structure Description:
+
+    This structure defines the trials of one test read from a result file.
+
+Members:
+
+    Name - Stores a pointer to the name of the test.
+
+    ProcessCount - Stores the number of processes the test ran with.
+
+    TrialCount - Stores the number of trials read for the test.
+
+    Capacity - Stores the number of elements allocated in each sample array.
+
+    Rates - Stores the per-second result of each trial.
+
+    P99Latencies - Stores the 99th percentile operation latency of each trial,
+        in nanoseconds.
+
+    LatencyCount - Stores the number of trials that reported latencies.
+
+--*/
+
+typedef struct _PT_COMPARE_SERIES {
+    char *Name;
+    long ProcessCount;
+    long TrialCount;
+    long Capacity;
+    double *Rates;
+    double *P99Latencies;
+    long LatencyCount;
+} PT_COMPARE_SERIES, *PPT_COMPARE_SERIES;
+
+/*++
+
+Structure Description:
+
+    This structure defines the contents of a result file.
+
+Members:
+
+    Series - Stores an array of the tests found in the file.
+
+    Count - Stores the number of elements in the series array.
+
+--*/
+
+typedef struct _PT_COMPARE_FILE {
+    PPT_COMPARE_SERIES Series;
+    long Count;
+} PT_COMPARE_FILE, *PPT_COMPARE_FILE;
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+int
+PtpCompareReadFile (
+    char *Path,
+    PPT_COMPARE_FILE File
+    );
+
+int
+PtpCompareAddTrial (
+    PPT_COMPARE_FILE File,
+    char *Name,
+    long ProcessCount,
+    double Rate,
+    int LatencyValid,
+    double P99Latency
+    );
+
+void
+PtpCompareDestroyFile (
+    PPT_COMPARE_FILE File
+    );
+
+PT_COMPARE_VERDICT
+PtpCompareSamples (
+    double *Base,
+    long BaseCount,
+    double *New,
+    long NewCount,
+    int HigherIsBetter,
+    double *BaseMean,
+    double *NewMean,
+    double *T
+    );
+
+void
+PtpCompareGetStatistics (
+    double *Samples,
+    long Count,
+    double *Mean,
+    double *Variance
+    );
+
+double
+PtpCompareGetCriticalValue (
+    double DegreesOfFreedom
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// Store the two-tailed critical values of Student's t distribution at the 95%
+// confidence level, indexed by degrees of freedom minus one.
+//
+
+const double PtTCriticalValues[PT_T_TABLE_SIZE] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+
+//
+// Store the strings for each comparison verdict.
+//
+
+const char *PtCompareVerdictStrings[] = {
+    "not enough trials",
+    "no significant change",
+    "improvement",
+    "REGRESSION"
+};
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+int
+PtCompareResults (
+    char *BasePath,
+    char *NewPath,
+    FILE *Output
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compares two result files written in the CSV format and
+    reports, for each test present in both, whether the change between them
+    is statistically significant.
+
+Arguments:
+
+    BasePath - Supplies a pointer to the path of the baseline result file.
+
+    NewPath - Supplies a pointer to the path of the result file to compare
+        against the baseline.
+
+    Output - Supplies the stream the comparison report is written to.
+
+Return Value:
+
+    Returns the number of tests that regressed significantly.
+
+    -1 if a result file could not be read, and errno will be set.
+
+--*/
+
+{
+
+    PT_COMPARE_FILE Base;
+    double BaseMean;
+    PPT_COMPARE_SERIES BaseSeries;
+    long Index;
+    PT_COMPARE_FILE New;
+    double NewMean;
+    PPT_COMPARE_SERIES NewSeries;
+    long Regressions;
+    long SearchIndex;
+    int Status;
+    double T;
+    PT_COMPARE_VERDICT Verdict;
+
+    memset(&Base, 0, sizeof(PT_COMPARE_FILE));
+    memset(&New, 0, sizeof(PT_COMPARE_FILE));
+    Regressions = -1;
+    Status = PtpCompareReadFile(BasePath, &Base);
+    if (Status != 0) {
+        goto CompareResultsEnd;
+    }
+
+    Status = PtpCompareReadFile(NewPath, &New);
+    if (Status != 0) {
+        goto CompareResultsEnd;
+    }
+
+    Regressions = 0;
+    for (Index = 0; Index < Base.Count; Index += 1) {
+        BaseSeries = &(Base.Series[Index]);
+        NewSeries = NULL;
+        for (SearchIndex = 0; SearchIndex < New.Count; SearchIndex += 1) {
+            if ((New.Series[SearchIndex].ProcessCount ==
+                 BaseSeries->ProcessCount) &&
+                (strcmp(New.Series[SearchIndex].Name, BaseSeries->Name) == 0)) {
+
+                NewSeries = &(New.Series[SearchIndex]);
+                break;
+            }
+        }
+
+        if (NewSeries == NULL) {
+            fprintf(Output,
+                    "%s (%ldp): missing from %s\n",
+                    BaseSeries->Name,
+                    BaseSeries->ProcessCount,
+                    NewPath);
+
+            continue;
+        }
+
+        //
+        // Compare the throughput, where a higher rate is better.
+        //
+
+        Verdict = PtpCompareSamples(BaseSeries->Rates,
+                                    BaseSeries->TrialCount,
+                                    NewSeries->Rates,
+                                    NewSeries->TrialCount,
+                                    1,
+                                    &BaseMean,
+                                    &NewMean,
+                                    &T);
+
+        fprintf(Output,
+                "%s (%ldp): %.3f -> %.3f per second",
+                BaseSeries->Name,
+                BaseSeries->ProcessCount,
+                BaseMean,
+                NewMean);
+
+        if (BaseMean != 0) {
+            fprintf(Output,
+                    " (%+.2f%%)",
+                    (NewMean - BaseMean) * 100 / BaseMean);
+
+        }
+
+        fprintf(Output, ", t %.2f: %s\n", T, PtCompareVerdictStrings[Verdict]);
+        if (Verdict == PtCompareRegression) {
+            Regressions += 1;
+        }
+
+        //
+        // Compare the tail latency if both sides collected it on every trial.
+        // Here lower is better.
+        //
+
+        if ((BaseSeries->LatencyCount != BaseSeries->TrialCount) ||
+            (NewSeries->LatencyCount != NewSeries->TrialCount) ||
+            (BaseSeries->LatencyCount == 0) ||
+            (NewSeries->LatencyCount == 0)) {
+
+            continue;
+        }
+
+        Verdict = PtpCompareSamples(BaseSeries->P99Latencies,
+                                    BaseSeries->LatencyCount,
+                                    NewSeries->P99Latencies,
+                                    NewSeries->LatencyCount,
+                                    0,
+                                    &BaseMean,
+                                    &NewMean,
+                                    &T);
+
+        fprintf(Output,
+                "%s (%ldp): p99 latency %.0f -> %.0f ns",
+                BaseSeries->Name,
+                BaseSeries->ProcessCount,
+                BaseMean,
+                NewMean);
+
+        if (BaseMean != 0) {
+            fprintf(Output,
+                    " (%+.2f%%)",
+                    (NewMean - BaseMean) * 100 / BaseMean);
+
+        }
+
+        fprintf(Output, ", t %.2f: %s\n", T, PtCompareVerdictStrings[Verdict]);
+        if (Verdict == PtCompareRegression) {
+            Regressions += 1;
+        }
+    }
+
+    fprintf(Output, "%ld significant regression(s).\n", Regressions);
+
+CompareResultsEnd:
+    PtpCompareDestroyFile(&Base);
+    PtpCompareDestroyFile(&New);
+    return Regressions;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+int
+PtpCompareReadFile (
+    char *Path,
+    PPT_COMPARE_FILE File
+    )
+
+/*++
+
+Routine Description:
+
+    This routine reads the trials out of a CSV result file.
+
+Arguments:
+
+    Path - Supplies a pointer to the path of the file to read.
+
+    File - Supplies a pointer where the file contents will be returned. The
+        caller must destroy this even on failure.
+
+Return Value:
+
+    0 on success.
+
+    -1 on failure, and errno will be set.
+
+--*/
+
+{
+
+    char *Column;
+    int ColumnCount;
+    char *Columns[PT_CSV_COLUMN_COUNT];
+    char *Current;
+    FILE *Input;
+    unsigned long long LatencyCount;
+    char Line[PT_COMPARE_LINE_SIZE];
+    double P99Latency;
+    long ProcessCount;
+    double Rate;
+    int Status;
+
+    Input = fopen(Path, "r");
+    if (Input == NULL) {
+        fprintf(stderr,
+                "perftest: cannot open %s: %s\n",
+                Path,
+                strerror(errno));
+
+        return -1;
+    }
+
+    Status = 0;
+    while (fgets(Line, sizeof(Line), Input) != NULL) {
+
+        //
+        // Split the line into its columns, chopping off the newline.
+        //
+
+        Current = Line;
+        Current[strcspn(Current, "\r\n")] = '\0';
+        ColumnCount = 0;
+        while ((Current != NULL) && (ColumnCount < PT_CSV_COLUMN_COUNT)) {
+            Column = Current;
+            Current = strchr(Current, ',');
+            if (Current != NULL) {
+                *Current = '\0';
+                Current += 1;
+            }
+
+            Columns[ColumnCount] = Column;
+            ColumnCount += 1;
+        }
+
+        //
+        // Skip the header and anything that is not a complete row.
+        //
+
+        if ((ColumnCount != PT_CSV_COLUMN_COUNT) ||
+            (strcmp(Columns[PT_CSV_COLUMN_TEST], "test") == 0)) {
+
+            continue;
+        }
+
+        LatencyCount = strtoull(Columns[PT_CSV_COLUMN_LATENCY_COUNT], NULL, 10);
+        ProcessCount = strtol(Columns[PT_CSV_COLUMN_PROCESSES], NULL, 10);
+        Rate = strtod(Columns[PT_CSV_COLUMN_RATE], NULL);
+        P99Latency = strtod(Columns[PT_CSV_COLUMN_LATENCY_P99], NULL);
+        Status = PtpCompareAddTrial(File,
+                                    Columns[PT_CSV_COLUMN_TEST],
+                                    ProcessCount,
+                                    Rate,
+                                    LatencyCount != 0,
+                                    P99Latency);
+
+        if (Status != 0) {
+            break;
+        }
+    }
+
+    if ((Status == 0) && (ferror(Input) != 0)) {
+        Status = -1;
+    }
+
+    fclose(Input);
+    return Status;
+}
+
+int
+PtpCompareAddTrial (
+    PPT_COMPARE_FILE File,
+    char *Name,
+    long ProcessCount,
+    double Rate,
+    int LatencyValid,
+    double P99Latency
+    )
+
+/*++
+
+Routine Description:
+
+    This routine adds one trial to the series for its test, creating the
+    series if this is the first trial seen for the test.
+
+Arguments:
+
+    File - Supplies a pointer to the file contents to add to.
+
+    Name - Supplies a pointer to the name of the test.
+
+    ProcessCount - Supplies the number of processes the trial ran with.
+
+    Rate - Supplies the per-second result of the trial.
+
+    LatencyValid - Supplies a boolean indicating whether the trial reported
+        operation latencies.
+
+    P99Latency - Supplies the trial's 99th percentile latency in nanoseconds.
+
+Return Value:
+
+    0 on success.
+
+    -1 on allocation failure.
+
+--*/
+
+{
+
+    long Capacity;
+    long Index;
+    void *NewBuffer;
+    PPT_COMPARE_SERIES Series;
+
+    Series = NULL;
+    for (Index = 0; Index < File->Count; Index += 1) {
+        if ((File->Series[Index].ProcessCount == ProcessCount) &&
+            (strcmp(File->Series[Index].Name, Name) == 0)) {
+
+            Series = &(File->Series[Index]);
+            break;
+        }
+    }
+
+    if (Series == NULL) {
+        NewBuffer = realloc(File->Series,
+                            (File->Count + 1) * sizeof(PT_COMPARE_SERIES));
+
+        if (NewBuffer == NULL) {
+            errno = ENOMEM;
+            return -1;
+        }
+
+        File->Series = NewBuffer;
+        Series = &(File->Series[File->Count]);
+        memset(Series, 0, sizeof(PT_COMPARE_SERIES));
+        Series->Name = strdup(Name);
+        if (Series->Name == NULL) {
+            errno = ENOMEM;
+            return -1;
+        }
+
+        Series->ProcessCount = ProcessCount;
+        File->Count += 1;
+    }
+
+    if (Series->TrialCount == Series->Capacity) {
+        Capacity = Series->Capacity * 2;
+        if (Capacity == 0) {
+            Capacity = 8;
+        }
+
+        NewBuffer = realloc(Series->Rates, Capacity * sizeof(double));
+        if (NewBuffer == NULL) {
+            errno = ENOMEM;
+            return -1;
+        }
+
+        Series->Rates = NewBuffer;
+        NewBuffer = realloc(Series->P99Latencies, Capacity * sizeof(double));
+        if (NewBuffer == NULL) {
+            errno = ENOMEM;
+            return -1;
+        }
+
+        Series->P99Latencies = NewBuffer;
+        Series->Capacity = Capacity;
+    }
+
+    Series->Rates[Series->TrialCount] = Rate;
+    Series->TrialCount += 1;
+    if (LatencyValid != 0) {
+        Series->P99Latencies[Series->LatencyCount] = P99Latency;
+        Series->LatencyCount += 1;
+    }
+
+    return 0;
+}
+
+void
+PtpCompareDestroyFile (
+    PPT_COMPARE_FILE File
+    )
+
+/*++
+
+Routine Description:
+
+    This routine frees the contents of a result file read for comparison.
+
+Arguments:
+
+    File - Supplies a pointer to the file contents to destroy.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    long Index;
+    PPT_COMPARE_SERIES Series;
+
+    for (Index = 0; Index < File->Count; Index += 1) {
+        Series = &(File->Series[Index]);
+        if (Series->Name != NULL) {
+            free(Series->Name);
+        }
+
+        if (Series->Rates != NULL) {
+            free(Series->Rates);
+        }
+
+        if (Series->P99Latencies != NULL) {
+            free(Series->P99Latencies);
+        }
+    }
+
+    if (File->Series != NULL) {
+        free(File->Series);
+    }
+
+    File->Series = NULL;
+    File->Count = 0;
+    return;
+}
+
+PT_COMPARE_VERDICT
+PtpCompareSamples (
+    double *Base,
+    long BaseCount,
+    double *New,
+    long NewCount,
+    int HigherIsBetter,
+    double *BaseMean,
+    double *NewMean,
+    double *T
+    )
+
+/*++
+
+Routine Description:
+
+    This routine runs Welch's t-test on two sets of trial samples to decide
+    whether their means differ at the 95% confidence level. Welch's variant is
+    used since the two runs may not have the same variance.
+
+Arguments:
+
+    Base - Supplies a pointer to the baseline samples.
+
+    BaseCount - Supplies the number of baseline samples.
+
+    New - Supplies a pointer to the new samples.
+
+    NewCount - Supplies the number of new samples.
+
+    HigherIsBetter - Supplies a boolean indicating whether an increase in the
+        mean is an improvement (non-zero) or a regression (zero).
+
+    BaseMean - Supplies a pointer where the baseline mean is returned.
+
+    NewMean - Supplies a pointer where the new mean is returned.
+
+    T - Supplies a pointer where the t statistic is returned.
+
+Return Value:
+
+    Returns the verdict of the comparison.
+
+--*/
+
+{
+
+    double BaseVariance;
+    double BaseWeight;
+    double DegreesOfFreedom;
+    double NewVariance;
+    double NewWeight;
+    double StandardError;
+
+    *T = 0;
+    PtpCompareGetStatistics(Base, BaseCount, BaseMean, &BaseVariance);
+    PtpCompareGetStatistics(New, NewCount, NewMean, &NewVariance);
+    if ((BaseCount < 2) || (NewCount < 2)) {
+        return PtCompareInsufficientData;
+    }
+
+    BaseWeight = BaseVariance / BaseCount;
+    NewWeight = NewVariance / NewCount;
+    StandardError = sqrt(BaseWeight + NewWeight);
+
+    //
+    // With no variance at all on either side, any difference is real.
+    //
+
+    if (StandardError == 0) {
+        if (*NewMean == *BaseMean) {
+            return PtCompareNoChange;
+        }
+
+    } else {
+        *T = (*NewMean - *BaseMean) / StandardError;
+
+        //
+        // Use the Welch-Satterthwaite approximation for the degrees of
+        // freedom.
+        //
+
+        DegreesOfFreedom = (BaseWeight + NewWeight) * (BaseWeight + NewWeight);
+        DegreesOfFreedom /= ((BaseWeight * BaseWeight) / (BaseCount - 1)) +
+                            ((NewWeight * NewWeight) / (NewCount - 1));
+
+        if (fabs(*T) < PtpCompareGetCriticalValue(DegreesOfFreedom)) {
+            return PtCompareNoChange;
+        }
+    }
+
+    if ((*NewMean > *BaseMean) == (HigherIsBetter != 0)) {
+        return PtCompareImprovement;
+    }
+
+    return PtCompareRegression;
+}
+
+void
+PtpCompareGetStatistics (
+    double *Samples,
+    long Count,
+    double *Mean,
+    double *Variance
+    )
+
+/*++
+
+Routine Description:
+
+    This routine computes the mean and sample variance of a set of samples.
+
+Arguments:
+
+    Samples - Supplies a pointer to the samples.
+
+    Count - Supplies the number of samples.
+
+    Mean - Supplies a pointer where the mean is returned.
+
+    Variance - Supplies a pointer where the unbiased sample variance is
+        returned. This is zero if there are fewer than two samples.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    double Difference;
+    long Index;
+    double Sum;
+
+    *Mean = 0;
+    *Variance = 0;
+    if (Count == 0) {
+        return;
+    }
+
+    Sum = 0;
+    for (Index = 0; Index < Count; Index += 1) {
+        Sum += Samples[Index];
+    }
+
+    *Mean = Sum / Count;
+    if (Count < 2) {
+        return;
+    }
+
+    Sum = 0;
+    for (Index = 0; Index < Count; Index += 1) {
+        Difference = Samples[Index] - *Mean;
+        Sum += Difference * Difference;
+    }
+
+    *Variance = Sum / (Count - 1);
+    return;
+}
+
+double
+PtpCompareGetCriticalValue (
+    double DegreesOfFreedom
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the two-tailed 95% critical value of Student's t
+    distribution for the given degrees of freedom. Fractional degrees of
+    freedom are rounded down, which errs on the side of not flagging a change.
+
+Arguments:
+
+    DegreesOfFreedom - Supplies the degrees of freedom.
+
+Return Value:
+
+    Returns the critical value.
+
+--*/
+
+{
+
+    long Index;
+
+    if (DegreesOfFreedom < 1) {
+        DegreesOfFreedom = 1;
+    }
+
+    Index = (long)DegreesOfFreedom;
+    if (Index <= PT_T_TABLE_SIZE) {
+        return PtTCriticalValues[Index - 1];
+    }
+
+    if (Index < 40) {
+        return PtTCriticalValues[PT_T_TABLE_SIZE - 1];
+
+    } else if (Index < 60) {
+        return 2.021;
+
+    } else if (Index < 120) {
+        return 2.000;
+    }
+
+    return 1.980;
+}
+
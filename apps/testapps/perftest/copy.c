@@ -256,7 +256,7 @@ Return Value:
     // number of bytes that can be written.
     //
 
-    while (PtIsTimedTestRunning() != 0) {
+    while (PtContinueTimedTest() != 0) {
         do {
             BytesCompleted = read(SourceDescriptor,
                                   Buffer,
@@ -128,7 +128,7 @@ Return Value:
     // by counting the number of times a file can be created and removed.
     //
 
-    while (PtIsTimedTestRunning() != 0) {
+    while (PtContinueTimedTest() != 0) {
         FileDescriptor = creat(FileName, S_IRUSR | S_IWUSR);
         if (FileDescriptor < 0) {
             Result->Status = errno;
@@ -192,7 +192,7 @@ Return Value:
     // called, and closed.
     //
 
-    while (PtIsTimedTestRunning() != 0) {
+    while (PtContinueTimedTest() != 0) {
         Handle = dlopen(LibraryName, RTLD_NOW | RTLD_GLOBAL);
         if (Handle == NULL) {
             fprintf(stderr,
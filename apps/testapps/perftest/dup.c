@@ -105,7 +105,7 @@ Return Value:
     // number of times standard out can be duplicated and closed.
     //
 
-    while (PtIsTimedTestRunning() != 0) {
+    while (PtContinueTimedTest() != 0) {
         FileDescriptor = dup(STDOUT_FILENO);
         if (FileDescriptor < 0) {
             Result->Status = errno;
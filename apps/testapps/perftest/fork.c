@@ -108,7 +108,7 @@ Return Value:
     // duration. The child, in this case, exits immediately.
     //
 
-    while (PtIsTimedTestRunning() != 0) {
+    while (PtContinueTimedTest() != 0) {
         Child = fork();
         if (Child < 0) {
             Result->Status = errno;
@@ -106,7 +106,7 @@ Return Value:
     // re-parenting. getpid(), for instance, can be cached.
     //
 
-    while (PtIsTimedTestRunning() != 0) {
+    while (PtContinueTimedTest() != 0) {
         getppid();
         Iterations += 1;
     }
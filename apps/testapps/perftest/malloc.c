@@ -213,7 +213,7 @@ Return Value:
     // around some allocations to make this somewhat realistic.
     //
 
-    while (PtIsTimedTestRunning() != 0) {
+    while (PtContinueTimedTest() != 0) {
         if (RandomSize != 0) {
             AllocationSize = rand_r(&Seed) % PT_MALLOC_TEST_ALLOCATION_LIMIT;
         }
@@ -250,7 +250,7 @@ Return Value:
     // and, for some tests, the speed of page faulting mapped regions.
     //
 
-    while (PtIsTimedTestRunning() != 0) {
+    while (PtContinueTimedTest() != 0) {
         Address = mmap(NULL,
                        PT_MMAP_TEST_REGION_SIZE,
                        ProtectionFlags,
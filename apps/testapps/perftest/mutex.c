@@ -183,7 +183,7 @@ Return Value:
     // times it can be acquired and released.
     //
 
-    while (PtIsTimedTestRunning() != 0) {
+    while (PtContinueTimedTest() != 0) {
         pthread_mutex_lock(&Mutex);
         pthread_mutex_unlock(&Mutex);
         Iterations += 1;
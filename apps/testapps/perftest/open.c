@@ -139,7 +139,7 @@ Return Value:
     // counting the number of times a file can be opened and closed.
     //
 
-    while (PtIsTimedTestRunning() != 0) {
+    while (PtContinueTimedTest() != 0) {
         FileDescriptor = open(FileName, O_RDWR);
         if (FileDescriptor < 0) {
             Result->Status = errno;
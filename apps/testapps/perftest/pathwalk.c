@@ -0,0 +1,307 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    pathwalk.c
+
+Abstract:
+
+    This module implements the performance benchmark tests that open and stat
+    a file at the bottom of a deep directory tree, stressing path traversal.
+
+Author:
+
+    agent 19-Oct-2026
+
+Environment:
+
+    User
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "perftest.h"
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// Define the number of directories between the test's root directory and the
+// file being looked up.
+//
+
+#define PT_PATH_WALK_DEPTH 8
+
+//
+// Define the maximum length of any path used by the test.
+//
+
+#define PT_PATH_WALK_PATH_LENGTH 128
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+int
+PtpPathWalkBuildPath (
+    char *Path,
+    pid_t ProcessId,
+    int Depth,
+    int IncludeFile
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+void
+PathWalkMain (
+    PPT_TEST_INFORMATION Test,
+    PPT_TEST_RESULT Result
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs the path walk performance benchmark tests.
+
+Arguments:
+
+    Test - Supplies a pointer to the performance test being executed.
+
+    Result - Supplies a pointer to a performance test result structure that
+        receives the tests results.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    int CreatedDepth;
+    int FileCreated;
+    int FileDescriptor;
+    char FilePath[PT_PATH_WALK_PATH_LENGTH];
+    unsigned long long Iterations;
+    char Path[PT_PATH_WALK_PATH_LENGTH];
+    pid_t ProcessId;
+    struct stat Stat;
+    int Status;
+
+    CreatedDepth = -1;
+    FileCreated = 0;
+    Iterations = 0;
+    Result->Type = PtResultIterations;
+    Result->Status = 0;
+    if ((Test->TestType != PtTestPathWalkOpen) &&
+        (Test->TestType != PtTestPathWalkStat)) {
+
+        assert(0);
+
+        Result->Status = EINVAL;
+        return;
+    }
+
+    //
+    // Create a process safe directory tree with a file at the bottom.
+    //
+
+    ProcessId = getpid();
+    while (CreatedDepth < PT_PATH_WALK_DEPTH) {
+        Status = PtpPathWalkBuildPath(Path, ProcessId, CreatedDepth + 1, 0);
+        if (Status < 0) {
+            Result->Status = errno;
+            goto MainEnd;
+        }
+
+        if (mkdir(Path, S_IRWXU) != 0) {
+            Result->Status = errno;
+            goto MainEnd;
+        }
+
+        CreatedDepth += 1;
+    }
+
+    Status = PtpPathWalkBuildPath(FilePath, ProcessId, PT_PATH_WALK_DEPTH, 1);
+    if (Status < 0) {
+        Result->Status = errno;
+        goto MainEnd;
+    }
+
+    FileDescriptor = creat(FilePath, S_IRUSR | S_IWUSR);
+    if (FileDescriptor < 0) {
+        Result->Status = errno;
+        goto MainEnd;
+    }
+
+    close(FileDescriptor);
+    FileCreated = 1;
+
+    //
+    // Start the test. This snaps resource usage and starts the clock ticking.
+    //
+
+    Status = PtStartTimedTest(Test->Duration);
+    if (Status != 0) {
+        Result->Status = errno;
+        goto MainEnd;
+    }
+
+    //
+    // Count the number of times the file can be looked up through the whole
+    // directory tree during the given duration.
+    //
+
+    while (PtContinueTimedTest() != 0) {
+        if (Test->TestType == PtTestPathWalkOpen) {
+            FileDescriptor = open(FilePath, O_RDONLY);
+            if (FileDescriptor < 0) {
+                Result->Status = errno;
+                break;
+            }
+
+            close(FileDescriptor);
+
+        } else {
+            Status = stat(FilePath, &Stat);
+            if (Status != 0) {
+                Result->Status = errno;
+                break;
+            }
+        }
+
+        Iterations += 1;
+    }
+
+    Status = PtFinishTimedTest(Result);
+    if ((Status != 0) && (Result->Status == 0)) {
+        Result->Status = errno;
+    }
+
+MainEnd:
+    if (FileCreated != 0) {
+        remove(FilePath);
+    }
+
+    while (CreatedDepth >= 0) {
+        if (PtpPathWalkBuildPath(Path, ProcessId, CreatedDepth, 0) >= 0) {
+            rmdir(Path);
+        }
+
+        CreatedDepth -= 1;
+    }
+
+    Result->Data.Iterations = Iterations;
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+int
+PtpPathWalkBuildPath (
+    char *Path,
+    pid_t ProcessId,
+    int Depth,
+    int IncludeFile
+    )
+
+/*++
+
+Routine Description:
+
+    This routine builds the path to a directory or file in the path walk test
+    tree.
+
+Arguments:
+
+    Path - Supplies a pointer to a buffer of PT_PATH_WALK_PATH_LENGTH bytes
+        where the path will be returned.
+
+    ProcessId - Supplies the ID of the process running the test.
+
+    Depth - Supplies the number of directories below the test's root
+        directory to include in the path.
+
+    IncludeFile - Supplies a boolean indicating whether or not to append the
+        name of the test file to the path.
+
+Return Value:
+
+    Returns the length of the path on success.
+
+    -1 on failure, and errno will be set.
+
+--*/
+
+{
+
+    int Index;
+    int Length;
+    int Status;
+
+    Length = snprintf(Path, PT_PATH_WALK_PATH_LENGTH, "pathwalk_%d", ProcessId);
+    if (Length < 0) {
+        return -1;
+    }
+
+    for (Index = 0; Index < Depth; Index += 1) {
+        Status = snprintf(Path + Length,
+                          PT_PATH_WALK_PATH_LENGTH - Length,
+                          "/dir%d",
+                          Index);
+
+        if ((Status < 0) || (Length + Status >= PT_PATH_WALK_PATH_LENGTH)) {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+
+        Length += Status;
+    }
+
+    if (IncludeFile != 0) {
+        Status = snprintf(Path + Length,
+                          PT_PATH_WALK_PATH_LENGTH - Length,
+                          "/file.txt");
+
+        if ((Status < 0) || (Length + Status >= PT_PATH_WALK_PATH_LENGTH)) {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+
+        Length += Status;
+    }
+
+    return Length;
+}
+
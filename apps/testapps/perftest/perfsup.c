@@ -33,6 +33,7 @@ Module Name:
 #include <errno.h>
 #include <signal.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <sys/resource.h>
 
@@ -55,6 +56,16 @@ PtAlarmSignalHandler (
     int Signal
     );
 
+int
+PtpGetLatencyBucket (
+    unsigned long long Nanoseconds
+    );
+
+unsigned long long
+PtpGetLatencyBucketLimit (
+    int Bucket
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -83,6 +94,14 @@ int PtResourceUsageBusy;
 
 PT_TEST_RESOURCE_USAGE PtStartResourceUsage;
 
+//
+// Store the latency histogram for the running test and the time at which the
+// current operation began.
+//
+
+PT_LATENCY_HISTOGRAM PtLatency;
+struct timespec PtOperationStartTime;
+
 //
 // ------------------------------------------------------------------ Functions
 //
@@ -138,6 +157,18 @@ Return Value:
         return Status;
     }
 
+    //
+    // Reset the latency histogram. The first operation is timed from here.
+    //
+
+    if (PtCollectLatency != 0) {
+        memset(&PtLatency, 0, sizeof(PT_LATENCY_HISTOGRAM));
+        Status = clock_gettime(CLOCK_MONOTONIC, &PtOperationStartTime);
+        if (Status != 0) {
+            goto StartTimedTestEnd;
+        }
+    }
+
     //
     // Start collecting the resource usage before the alarm is set.
     //
@@ -187,8 +218,9 @@ PtFinishTimedTest (
 Routine Description:
 
     This routine finalizes a running test that has stopped. It will collect the
-    final usage statistics and set them in the given result. It makes sure that
-    the alarm is disabled and stops the test.
+    final usage statistics and set them in the given result, along with the
+    latency histogram if latencies were collected. It makes sure that the alarm
+    is disabled and stops the test.
 
 Arguments:
 
@@ -212,6 +244,9 @@ Return Value:
     //
 
     Status = PtCollectResourceUsageStop(Result);
+    if (PtCollectLatency != 0) {
+        memcpy(&(Result->Latency), &PtLatency, sizeof(PT_LATENCY_HISTOGRAM));
+    }
 
     //
     // Always disable the timer and restore the original action.
@@ -249,6 +284,214 @@ Return Value:
     return PtTestRunning;
 }
 
+int
+PtContinueTimedTest (
+    void
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines whether or not a timed test should run another
+    operation. Tests call this once at the top of each operation. If latency
+    collection is enabled, the time since the previous call is recorded as the
+    latency of the operation that just completed.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    1 if the test is still running, or 0 if the test has finished.
+
+--*/
+
+{
+
+    unsigned long long Nanoseconds;
+    struct timespec Now;
+
+    if (PtCollectLatency != 0) {
+        if (clock_gettime(CLOCK_MONOTONIC, &Now) == 0) {
+            Nanoseconds = (Now.tv_sec - PtOperationStartTime.tv_sec) *
+                          1000000000ULL;
+
+            Nanoseconds += Now.tv_nsec;
+            Nanoseconds -= PtOperationStartTime.tv_nsec;
+            PtRecordLatency(&PtLatency, Nanoseconds);
+            PtOperationStartTime = Now;
+        }
+    }
+
+    return PtTestRunning;
+}
+
+void
+PtRecordLatency (
+    PPT_LATENCY_HISTOGRAM Histogram,
+    unsigned long long Nanoseconds
+    )
+
+/*++
+
+Routine Description:
+
+    This routine adds a single latency sample to a histogram.
+
+Arguments:
+
+    Histogram - Supplies a pointer to the histogram to update.
+
+    Nanoseconds - Supplies the latency to record, in nanoseconds.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if ((Histogram->Count == 0) || (Nanoseconds < Histogram->Minimum)) {
+        Histogram->Minimum = Nanoseconds;
+    }
+
+    if (Nanoseconds > Histogram->Maximum) {
+        Histogram->Maximum = Nanoseconds;
+    }
+
+    Histogram->Count += 1;
+    Histogram->Total += Nanoseconds;
+    Histogram->Buckets[PtpGetLatencyBucket(Nanoseconds)] += 1;
+    return;
+}
+
+void
+PtMergeLatencyHistogram (
+    PPT_LATENCY_HISTOGRAM Destination,
+    PPT_LATENCY_HISTOGRAM Source
+    )
+
+/*++
+
+Routine Description:
+
+    This routine adds the samples of one latency histogram into another.
+
+Arguments:
+
+    Destination - Supplies a pointer to the histogram to add into.
+
+    Source - Supplies a pointer to the histogram whose samples are added.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    int Bucket;
+
+    if (Source->Count == 0) {
+        return;
+    }
+
+    if ((Destination->Count == 0) ||
+        (Source->Minimum < Destination->Minimum)) {
+
+        Destination->Minimum = Source->Minimum;
+    }
+
+    if (Source->Maximum > Destination->Maximum) {
+        Destination->Maximum = Source->Maximum;
+    }
+
+    Destination->Count += Source->Count;
+    Destination->Total += Source->Total;
+    for (Bucket = 0; Bucket < PT_LATENCY_BUCKET_COUNT; Bucket += 1) {
+        Destination->Buckets[Bucket] += Source->Buckets[Bucket];
+    }
+
+    return;
+}
+
+unsigned long long
+PtGetLatencyPercentile (
+    PPT_LATENCY_HISTOGRAM Histogram,
+    double Percentile
+    )
+
+/*++
+
+Routine Description:
+
+    This routine estimates a percentile of the latencies recorded in the given
+    histogram.
+
+Arguments:
+
+    Histogram - Supplies a pointer to the histogram to query.
+
+    Percentile - Supplies the desired percentile, between 0 and 100.
+
+Return Value:
+
+    Returns the upper bound, in nanoseconds, of the bucket containing the
+    requested percentile, clipped to the largest recorded value.
+
+    0 if the histogram is empty.
+
+--*/
+
+{
+
+    int Bucket;
+    unsigned long long Limit;
+    unsigned long long Seen;
+    unsigned long long Target;
+
+    if (Histogram->Count == 0) {
+        return 0;
+    }
+
+    //
+    // Find the rank of the requested sample, rounding up so that the 100th
+    // percentile is the last sample and anything above zero is at least the
+    // first.
+    //
+
+    Target = (unsigned long long)((Percentile * Histogram->Count) / 100.0);
+    if ((double)Target < (Percentile * Histogram->Count) / 100.0) {
+        Target += 1;
+    }
+
+    if (Target == 0) {
+        Target = 1;
+
+    } else if (Target > Histogram->Count) {
+        Target = Histogram->Count;
+    }
+
+    Seen = 0;
+    for (Bucket = 0; Bucket < PT_LATENCY_BUCKET_COUNT; Bucket += 1) {
+        Seen += Histogram->Buckets[Bucket];
+        if (Seen >= Target) {
+            break;
+        }
+    }
+
+    Limit = PtpGetLatencyBucketLimit(Bucket);
+    if (Limit > Histogram->Maximum) {
+        Limit = Histogram->Maximum;
+    }
+
+    return Limit;
+}
+
 int
 PtCollectResourceUsageStart (
     void
@@ -439,3 +682,93 @@ Return Value:
     return;
 }
 
+int
+PtpGetLatencyBucket (
+    unsigned long long Nanoseconds
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines which latency histogram bucket a value falls in.
+
+Arguments:
+
+    Nanoseconds - Supplies the latency value, in nanoseconds.
+
+Return Value:
+
+    Returns the index of the bucket.
+
+--*/
+
+{
+
+    int Bucket;
+    int Power;
+
+    if (Nanoseconds < PT_LATENCY_SUB_BUCKET_COUNT) {
+        return (int)Nanoseconds;
+    }
+
+    //
+    // Find the highest set bit. The sub-bucket is taken from the bits just
+    // below it.
+    //
+
+    Power = 0;
+    while ((Nanoseconds >> Power) > 1) {
+        Power += 1;
+    }
+
+    if (Power > PT_LATENCY_MAX_POWER) {
+        return PT_LATENCY_BUCKET_COUNT - 1;
+    }
+
+    Bucket = (Power - PT_LATENCY_SUB_BUCKET_BITS + 1) <<
+             PT_LATENCY_SUB_BUCKET_BITS;
+
+    Bucket += (Nanoseconds >> (Power - PT_LATENCY_SUB_BUCKET_BITS)) &
+              (PT_LATENCY_SUB_BUCKET_COUNT - 1);
+
+    return Bucket;
+}
+
+unsigned long long
+PtpGetLatencyBucketLimit (
+    int Bucket
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the largest latency value that falls in the given
+    histogram bucket.
+
+Arguments:
+
+    Bucket - Supplies the index of the bucket.
+
+Return Value:
+
+    Returns the inclusive upper bound of the bucket, in nanoseconds.
+
+--*/
+
+{
+
+    unsigned long long Base;
+    int Shift;
+
+    if (Bucket < PT_LATENCY_SUB_BUCKET_COUNT) {
+        return Bucket;
+    }
+
+    Shift = (Bucket >> PT_LATENCY_SUB_BUCKET_BITS) - 1;
+    Base = PT_LATENCY_SUB_BUCKET_COUNT +
+           (Bucket & (PT_LATENCY_SUB_BUCKET_COUNT - 1));
+
+    return ((Base + 1) << Shift) - 1;
+}
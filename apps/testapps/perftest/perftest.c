@@ -29,11 +29,15 @@ Module Name:
 // ------------------------------------------------------------------- Includes
 //
 
+#define _GNU_SOURCE 1
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <assert.h>
 #include <errno.h>
 #include <getopt.h>
+#include <math.h>
+#include <sched.h>
 #include <unistd.h>
 #include <sys/wait.h>
 #include <string.h>
@@ -63,7 +67,7 @@ Module Name:
 //
 
 #define PT_VERSION_MAJOR 1
-#define PT_VERSION_MINOR 0
+#define PT_VERSION_MINOR 1
 
 #define PT_USAGE                                                               \
     "Usage: perf [options] \n"                                                 \
@@ -73,16 +77,29 @@ Module Name:
     "  -p, --processes <count> -- Set the number of processes to spin up.\n"   \
     "  -d, --duration <seconds> -- Set the duration, in seconds, to run each\n"\
     "      test.\n"                                                            \
+    "  -w, --warmup <seconds> -- Run each test for the given number of\n"      \
+    "      seconds before measuring, and discard the results.\n"               \
+    "  -n, --trials <count> -- Set the number of times each test is run.\n"    \
+    "      The mean and standard deviation are reported across trials.\n"      \
+    "  -L, --latency -- Record the latency of each operation and report\n"     \
+    "      the 50th, 99th, and 99.9th percentiles.\n"                          \
+    "  -c, --cpu <index> -- Pin the first process to the given processor,\n"   \
+    "      and each additional process to the processor after it.\n"           \
     "  -r, --results <file> -- Set the file where results will be written.\n"  \
     "      The default will print to standard out.\n"                          \
     "  -l, --list -- List the set of available tests.\n"                       \
     "  -s, --summary -- Print the results in the summary format.\n"            \
+    "  -f, --format <format> -- Set the result format. Valid values are\n"     \
+    "      default, summary, json, and csv.\n"                                 \
+    "  -C, --compare <base> <new> -- Compare two result files written with\n"  \
+    "      --format=csv and flag statistically significant changes. The\n"     \
+    "      exit status is the number of significant regressions.\n"            \
     "  --verbose -- Print lots of information about what's happening.\n"       \
     "  --quiet -- Print only errors.\n"                                        \
     "  --help -- Print this help text and exit.\n"                             \
     "  --version -- Print the test version and exit.\n"                        \
 
-#define PT_OPTION_STRING "t:p:d:r:slnvqhV"
+#define PT_OPTION_STRING "t:p:d:w:n:Lc:r:slf:C:vqhV"
 
 //
 // Define the default values for each argument.
@@ -90,6 +107,7 @@ Module Name:
 
 #define PT_DEFAULT_TEST PtTestAll
 #define PT_DEFAULT_PROCESS_COUNT 1
+#define PT_DEFAULT_TRIAL_COUNT 1
 
 //
 // ------------------------------------------------------ Data Type Definitions
@@ -104,6 +122,8 @@ typedef enum _PT_TEST_VERBOSITY {
 typedef enum _PT_RESULT_FORMAT {
     PtResultFormatDefault,
     PtResultFormatSummary,
+    PtResultFormatJson,
+    PtResultFormatCsv,
     PtResultFormatCount,
 } PT_RESULT_FORMAT, *PPT_RESULT_FORMAT;
 
@@ -130,6 +150,40 @@ typedef struct _PT_PROCESS {
     PT_TEST_RESULT Result;
 } PT_PROCESS, *PPT_PROCESS;
 
+/*++
+
+Structure Description:
+
+    This structure defines the combined result of all processes for one trial
+    of a test.
+
+Members:
+
+    Status - Stores 0 if every process succeeded, or an error value.
+
+    PerSecond - Stores the average result per process per second.
+
+    ResourceUsageValid - Stores 0 if the resource usage percentages are invalid
+        and 1 if they are valid.
+
+    UserPercent - Stores the average user time as a percentage of real time.
+
+    SystemPercent - Stores the average system time as a percentage of real
+        time.
+
+    Latency - Stores the operation latencies of all processes.
+
+--*/
+
+typedef struct _PT_TRIAL_RESULT {
+    int Status;
+    double PerSecond;
+    int ResourceUsageValid;
+    double UserPercent;
+    double SystemPercent;
+    PT_LATENCY_HISTOGRAM Latency;
+} PT_TRIAL_RESULT, *PPT_TRIAL_RESULT;
+
 //
 // ----------------------------------------------- Internal Function Prototypes
 //
@@ -138,9 +192,19 @@ void
 PtpRunPerformanceTest (
     PPT_TEST_INFORMATION Test,
     long ProcessCount,
+    long Trial,
+    PPT_TRIAL_RESULT TrialResult,
     int *TotalFailures
     );
 
+void
+PtpCollectTrialResult (
+    PPT_TEST_INFORMATION Test,
+    PPT_PROCESS Processes,
+    long ProcessCount,
+    PPT_TRIAL_RESULT TrialResult
+    );
+
 void
 PtpPrintTestResults (
     PPT_TEST_INFORMATION Test,
@@ -148,6 +212,31 @@ PtpPrintTestResults (
     long ProcessCount
     );
 
+void
+PtpPrintTrialResults (
+    PPT_TEST_INFORMATION Test,
+    long ProcessCount,
+    PPT_TRIAL_RESULT Trials
+    );
+
+void
+PtpPrintLatency (
+    PPT_LATENCY_HISTOGRAM Latency
+    );
+
+void
+PtpGetTrialStatistics (
+    PPT_TRIAL_RESULT Trials,
+    long *ValidCount,
+    double *Mean,
+    double *StandardDeviation
+    );
+
+int
+PtpPinProcess (
+    long ProcessIndex
+    );
+
 void
 PtpPrintTestResult (
     PPT_TEST_RESULT Result
@@ -181,9 +270,15 @@ struct option PtLongOptions[] = {
     {"test", required_argument, 0, 't'},
     {"processes", required_argument, 0, 'p'},
     {"duration", required_argument, 0, 'd'},
+    {"warmup", required_argument, 0, 'w'},
+    {"trials", required_argument, 0, 'n'},
+    {"latency", no_argument, 0, 'L'},
+    {"cpu", required_argument, 0, 'c'},
     {"results", required_argument, 0, 'r'},
     {"list", no_argument, 0, 'l'},
     {"summary", no_argument, 0, 's'},
+    {"format", required_argument, 0, 'f'},
+    {"compare", required_argument, 0, 'C'},
     {"verbose", no_argument, 0, 'v'},
     {"quiet", no_argument, 0, 'q'},
     {"help", no_argument, 0, 'h'},
@@ -413,6 +508,62 @@ PT_TEST_INFORMATION PerformanceTests[PtTestTypeCount] = {
      PtTestSignalRestart,
      PtResultIterations,
      SIGNAL_RESTART_DEFAULT_DURATION},
+
+    {VFORK_TEST_NAME,
+     VFORK_TEST_DESCRIPTION,
+     SpawnMain,
+     PtTestVfork,
+     PtResultIterations,
+     VFORK_TEST_DEFAULT_DURATION},
+
+    {SPAWN_TEST_NAME,
+     SPAWN_TEST_DESCRIPTION,
+     SpawnMain,
+     PtTestSpawn,
+     PtResultIterations,
+     SPAWN_TEST_DEFAULT_DURATION},
+
+    {PATH_WALK_OPEN_TEST_NAME,
+     PATH_WALK_OPEN_TEST_DESCRIPTION,
+     PathWalkMain,
+     PtTestPathWalkOpen,
+     PtResultIterations,
+     PATH_WALK_OPEN_TEST_DEFAULT_DURATION},
+
+    {PATH_WALK_STAT_TEST_NAME,
+     PATH_WALK_STAT_TEST_DESCRIPTION,
+     PathWalkMain,
+     PtTestPathWalkStat,
+     PtResultIterations,
+     PATH_WALK_STAT_TEST_DEFAULT_DURATION},
+
+    {SOCKET_LOOPBACK_TEST_NAME,
+     SOCKET_LOOPBACK_TEST_DESCRIPTION,
+     SocketLoopbackMain,
+     PtTestSocketLoopback,
+     PtResultIterations,
+     SOCKET_LOOPBACK_TEST_DEFAULT_DURATION},
+
+    {POLL_TEST_NAME,
+     POLL_TEST_DESCRIPTION,
+     PollMain,
+     PtTestPoll,
+     PtResultIterations,
+     POLL_TEST_DEFAULT_DURATION},
+
+    {SEQUENTIAL_WRITE_TEST_NAME,
+     SEQUENTIAL_WRITE_TEST_DESCRIPTION,
+     SequentialIoMain,
+     PtTestSequentialWrite,
+     PtResultBytes,
+     SEQUENTIAL_WRITE_TEST_DEFAULT_DURATION},
+
+    {SEQUENTIAL_READ_TEST_NAME,
+     SEQUENTIAL_READ_TEST_DESCRIPTION,
+     SequentialIoMain,
+     PtTestSequentialRead,
+     PtResultBytes,
+     SEQUENTIAL_READ_TEST_DEFAULT_DURATION},
 };
 
 //
@@ -425,6 +576,17 @@ char *PtResultTypeStrings[PtResultTypeCount] = {
     "Bytes",
 };
 
+//
+// Store the names of the result formats, as accepted by the format option.
+//
+
+char *PtResultFormatStrings[PtResultFormatCount] = {
+    "default",
+    "summary",
+    "json",
+    "csv",
+};
+
 //
 // Store the handle for the file to which the test results will be written.
 //
@@ -443,6 +605,38 @@ char *PtProgramPath;
 
 PT_RESULT_FORMAT PtResultFormat = PtResultFormatDefault;
 
+//
+// Store the number of seconds each test runs for before it is measured.
+//
+
+time_t PtWarmUpDuration;
+
+//
+// Store the number of measured trials of each test.
+//
+
+long PtTrialCount = PT_DEFAULT_TRIAL_COUNT;
+
+//
+// Store whether or not per-operation latencies are recorded.
+//
+
+int PtCollectLatency;
+
+//
+// Store the processor to pin the first test process to, or -1 if processes
+// are not pinned.
+//
+
+long PtFirstProcessor = -1;
+
+//
+// Store the number of tests whose results have been written, used to
+// separate the entries of the JSON output.
+//
+
+long PtResultsWritten;
+
 //
 // ------------------------------------------------------------------ Functions
 //
@@ -477,6 +671,7 @@ Return Value:
 {
 
     char *AfterScan;
+    char *CompareBasePath;
     time_t Duration;
     int Failures;
     int Index;
@@ -484,7 +679,10 @@ Return Value:
     long ProcessCount;
     PT_TEST_TYPE RequestedTest;
     char *ResultFilePath;
+    time_t SavedDuration;
     int Status;
+    long Trial;
+    PPT_TRIAL_RESULT Trials;
 
     PtProgramPath = Arguments[0];
 
@@ -498,12 +696,24 @@ Return Value:
         return ExecLoop(ArgumentCount, Arguments);
     }
 
+    //
+    // Children of the spawn test exit immediately.
+    //
+
+    if ((ArgumentCount == SPAWN_CHILD_ARGUMENT_COUNT) &&
+        (strcasecmp(Arguments[1], SPAWN_TEST_NAME) == 0)) {
+
+        return 0;
+    }
+
+    CompareBasePath = NULL;
     Duration = 0;
     Failures = 0;
     ProcessCount = PT_DEFAULT_PROCESS_COUNT;
     RequestedTest = PT_DEFAULT_TEST;
     ResultFilePath = NULL;
     Status = 0;
+    Trials = NULL;
     setvbuf(stdout, NULL, _IONBF, 0);
     setvbuf(stderr, NULL, _IONBF, 0);
 
@@ -548,6 +758,40 @@ Return Value:
 
             break;
 
+        case 'w':
+            PtWarmUpDuration = (time_t)strtoll(optarg, &AfterScan, 0);
+            if ((PtWarmUpDuration < 0) || (AfterScan == optarg)) {
+                PT_PRINT_ERROR("Invalid number of seconds: %s.\n", optarg);
+                Status = EINVAL;
+                goto MainEnd;
+            }
+
+            break;
+
+        case 'n':
+            PtTrialCount = strtol(optarg, &AfterScan, 0);
+            if ((PtTrialCount <= 0) || (AfterScan == optarg)) {
+                PT_PRINT_ERROR("Invalid trial count: %s.\n", optarg);
+                Status = EINVAL;
+                goto MainEnd;
+            }
+
+            break;
+
+        case 'L':
+            PtCollectLatency = 1;
+            break;
+
+        case 'c':
+            PtFirstProcessor = strtol(optarg, &AfterScan, 0);
+            if ((PtFirstProcessor < 0) || (AfterScan == optarg)) {
+                PT_PRINT_ERROR("Invalid processor: %s.\n", optarg);
+                Status = EINVAL;
+                goto MainEnd;
+            }
+
+            break;
+
         case 't':
             for (Index = 0; Index < PtTestTypeCount; Index += 1) {
                 if (strcasecmp(optarg, PerformanceTests[Index].Name) == 0) {
@@ -577,6 +821,26 @@ Return Value:
             PtResultFormat = PtResultFormatSummary;
             break;
 
+        case 'f':
+            for (Index = 0; Index < PtResultFormatCount; Index += 1) {
+                if (strcasecmp(optarg, PtResultFormatStrings[Index]) == 0) {
+                    PtResultFormat = Index;
+                    break;
+                }
+            }
+
+            if (Index == PtResultFormatCount) {
+                PT_PRINT_ERROR("Invalid result format: %s.\n", optarg);
+                Status = EINVAL;
+                goto MainEnd;
+            }
+
+            break;
+
+        case 'C':
+            CompareBasePath = optarg;
+            break;
+
         case 'r':
             ResultFilePath = optarg;
             break;
@@ -609,6 +873,56 @@ Return Value:
         }
     }
 
+    //
+    // Comparing two result files takes the place of running any tests.
+    //
+
+    if (CompareBasePath != NULL) {
+        if (optind != ArgumentCount - 1) {
+            PT_PRINT_ERROR("Expected a single result file to compare "
+                           "against %s.\n",
+                           CompareBasePath);
+
+            Status = EINVAL;
+            goto MainEnd;
+        }
+
+        //
+        // The exit status is the number of significant regressions, so that
+        // scripts can act on the comparison.
+        //
+
+        Status = PtCompareResults(CompareBasePath, Arguments[optind], stdout);
+        if (Status >= 0) {
+            return Status;
+        }
+
+        Status = errno;
+        Failures = 1;
+        goto MainEnd;
+    }
+
+    //
+    // Pin the parent process now. Children pin themselves after they are
+    // forked.
+    //
+
+    if (PtFirstProcessor >= 0) {
+        if (PtpPinProcess(0) != 0) {
+            Status = errno;
+            PT_PRINT_ERROR("Failed to pin to processor %ld.\n",
+                           PtFirstProcessor);
+
+            goto MainEnd;
+        }
+    }
+
+    Trials = malloc(sizeof(PT_TRIAL_RESULT) * PtTrialCount);
+    if (Trials == NULL) {
+        Status = ENOMEM;
+        goto MainEnd;
+    }
+
     //
     // Attempt to open the result file.
     //
@@ -624,8 +938,27 @@ Return Value:
         PtResultFile = stdout;
     }
 
+    switch (PtResultFormat) {
+    case PtResultFormatJson:
+        PT_PRINT_RESULT("[");
+        break;
+
+    case PtResultFormatCsv:
+        PT_PRINT_RESULT("test,processes,trial,duration,result_type,per_second,"
+                        "user_percent,system_percent,latency_count,"
+                        "latency_mean_ns,latency_p50_ns,latency_p99_ns,"
+                        "latency_p999_ns,latency_max_ns\n");
+
+        break;
+
+    default:
+        break;
+    }
+
     //
     // Run each of the requested tests with the requested number of threads.
+    // Each test gets an unmeasured warm-up run if requested, followed by the
+    // measured trials.
     //
 
     for (Index = 0; Index < PtTestTypeCount; Index += 1) {
@@ -641,12 +974,37 @@ Return Value:
                 PerformanceTests[Index].Duration = Duration;
             }
 
-            PtpRunPerformanceTest(&(PerformanceTests[Index]),
-                                  ProcessCount,
-                                  &Failures);
+            if (PtWarmUpDuration != 0) {
+                SavedDuration = PerformanceTests[Index].Duration;
+                PerformanceTests[Index].Duration = PtWarmUpDuration;
+                PtpRunPerformanceTest(&(PerformanceTests[Index]),
+                                      ProcessCount,
+                                      -1,
+                                      NULL,
+                                      &Failures);
+
+                PerformanceTests[Index].Duration = SavedDuration;
+            }
+
+            memset(Trials, 0, sizeof(PT_TRIAL_RESULT) * PtTrialCount);
+            for (Trial = 0; Trial < PtTrialCount; Trial += 1) {
+                PtpRunPerformanceTest(&(PerformanceTests[Index]),
+                                      ProcessCount,
+                                      Trial,
+                                      &(Trials[Trial]),
+                                      &Failures);
+            }
+
+            PtpPrintTrialResults(&(PerformanceTests[Index]),
+                                 ProcessCount,
+                                 Trials);
         }
     }
 
+    if (PtResultFormat == PtResultFormatJson) {
+        PT_PRINT_RESULT("\n]\n");
+    }
+
 MainEnd:
     if (Status != 0) {
         PT_PRINT_ERROR("Error: %d, %s.\n", Status, strerror(Status));
@@ -660,6 +1018,10 @@ Return Value:
         fclose(PtResultFile);
     }
 
+    if (Trials != NULL) {
+        free(Trials);
+    }
+
     return Failures;
 }
 
@@ -671,6 +1033,8 @@ void
 PtpRunPerformanceTest (
     PPT_TEST_INFORMATION Test,
     long ProcessCount,
+    long Trial,
+    PPT_TRIAL_RESULT TrialResult,
     int *TotalFailures
     )
 
@@ -688,6 +1052,13 @@ Routine Description:
     ProcessCount - Supplies the number of processes to spin up when executing
         the test.
 
+    Trial - Supplies the zero-based index of this trial, or -1 if this is a
+        warm-up run.
+
+    TrialResult - Supplies an optional pointer that receives the combined
+        results of this trial. Supply NULL for a warm-up run, whose results
+        are discarded.
+
     TotalFailures - Supplies a pointer to the total numbers encountered so far
         during all tests. This specific test adds its failure count.
 
@@ -717,10 +1088,32 @@ Return Value:
     Process = NULL;
     Status = 0;
     TestFailures = 0;
-    PT_PRINT("Running %s test with %ld process(es) for %lld second(s).\n",
-             Test->Name,
-             ProcessCount,
-             (signed long long)Test->Duration);
+    if (Trial < 0) {
+        PT_PRINT("Warming up %s test with %ld process(es) for %lld "
+                 "second(s).\n",
+                 Test->Name,
+                 ProcessCount,
+                 (signed long long)Test->Duration);
+
+    } else if (PtTrialCount > 1) {
+        PT_PRINT("Running %s test trial %ld of %ld with %ld process(es) for "
+                 "%lld second(s).\n",
+                 Test->Name,
+                 Trial + 1,
+                 PtTrialCount,
+                 ProcessCount,
+                 (signed long long)Test->Duration);
+
+    } else {
+        PT_PRINT("Running %s test with %ld process(es) for %lld second(s).\n",
+                 Test->Name,
+                 ProcessCount,
+                 (signed long long)Test->Duration);
+    }
+
+    if (TrialResult != NULL) {
+        TrialResult->Status = -1;
+    }
 
     //
     // Fork off the desired number of processes to run the test in parallel.
@@ -781,6 +1174,14 @@ Return Value:
                 Process = &(Children[ChildIndex]);
                 Result = &(Process->Result);
                 close(Process->PipeDescriptors[0]);
+                if ((PtFirstProcessor >= 0) &&
+                    (PtpPinProcess(ChildIndex + 1) != 0)) {
+
+                    PT_PRINT_ERROR("Failed to pin child %d: %s.\n",
+                                   getpid(),
+                                   strerror(errno));
+                }
+
                 break;
             }
 
@@ -859,7 +1260,18 @@ Return Value:
             TestFailures += 1;
         }
 
-        PtpPrintTestResults(Test, Processes, ProcessCount);
+        //
+        // Warm-up results are thrown away. Otherwise combine the processes'
+        // results for this trial, printing each process's results if using
+        // the detailed format.
+        //
+
+        if (TrialResult != NULL) {
+            PtpCollectTrialResult(Test, Processes, ProcessCount, TrialResult);
+            if (PtResultFormat == PtResultFormatDefault) {
+                PtpPrintTestResults(Test, Processes, ProcessCount);
+            }
+        }
 
     //
     // If this is a child, write the results to the parent and report any
@@ -881,35 +1293,46 @@ Return Value:
         free(Processes);
     }
 
-    PT_PRINT("Completed %s test with %d failure(s).\n",
-             Test->Name,
-             TestFailures);
+    if (Trial < 0) {
+        PT_PRINT("Completed %s warm-up with %d failure(s).\n",
+                 Test->Name,
+                 TestFailures);
+
+    } else {
+        PT_PRINT("Completed %s test with %d failure(s).\n",
+                 Test->Name,
+                 TestFailures);
+    }
 
     *TotalFailures += TestFailures;
     return;
 }
 
 void
-PtpPrintTestResults (
+PtpCollectTrialResult (
     PPT_TEST_INFORMATION Test,
     PPT_PROCESS Processes,
-    long ProcessCount
+    long ProcessCount,
+    PPT_TRIAL_RESULT TrialResult
     )
 
 /*++
 
 Routine Description:
 
-    This routine prints the test results to the results file.
+    This routine combines the results of each process that ran a trial of a
+    test into a single trial result.
 
 Arguments:
 
-    Test - Supplies a pointer to the test whose results are to be printed.
+    Test - Supplies a pointer to the test that was run.
 
     Processes - Supplies a pointer to an array of processes that ran the test.
 
     ProcessCount - Supplies the number of processes that ran the test.
 
+    TrialResult - Supplies a pointer that receives the combined result.
+
 Return Value:
 
     None.
@@ -920,7 +1343,6 @@ Return Value:
 
     double Average;
     double AverageDurationMicroseconds;
-    double Frequency;
     int Index;
     unsigned long long Microseconds;
     PPT_PROCESS Process;
@@ -929,212 +1351,594 @@ Return Value:
 
     assert(ProcessCount > 0);
 
+    memset(TrialResult, 0, sizeof(PT_TRIAL_RESULT));
+    TrialResult->Status = -1;
+
     //
-    // Print the results based on the desired output format.
+    // Collect the average value across the processes.
     //
 
-    switch (PtResultFormat) {
+    ValidProcessCount = 0;
+    memset(&TotalResult, 0, sizeof(PT_TEST_RESULT));
+    for (Index = 0; Index < ProcessCount; Index += 1) {
+        Process = &(Processes[Index]);
+
+        assert(Process->Result.Type == Test->ResultType);
+
+        if (Process->Result.Status != 0) {
+            PT_PRINT_ERROR("%s test: failed: %s\n",
+                           Test->Name,
+                           strerror(Process->Result.Status));
+
+            TrialResult->Status = Process->Result.Status;
+            continue;
+        }
+
+        switch (Test->ResultType) {
+        case PtResultIterations:
+            TotalResult.Data.Iterations += Process->Result.Data.Iterations;
+            break;
+
+        case PtResultBytes:
+            TotalResult.Data.Bytes += Process->Result.Data.Iterations;
+            break;
+
+        default:
+
+            assert(0);
+
+            return;
+        }
+
+        PtMergeLatencyHistogram(&(TrialResult->Latency),
+                                &(Process->Result.Latency));
+
+        ValidProcessCount += 1;
+    }
 
     //
-    // The summary prints one line for the test. This format is what the Minoca
-    // build system expects during test automation. It includes the test name,
-    // the type of the result (e.g. integer, decimal, string, duration, etc.),
-    // and the raw value in string format.
+    // If not all of the processes succeeded, don't count the result. The
+    // trial is only valid if all of the processes succeed.
     //
 
-    case PtResultFormatSummary:
+    if (ValidProcessCount != ProcessCount) {
+        PT_PRINT_ERROR("%s test: %ld out of %ld processes failed.\n",
+                       Test->Name,
+                       ProcessCount - ValidProcessCount,
+                       ProcessCount);
 
-        //
-        // Collect the average value and print the result based on the type.
-        //
+        return;
+    }
 
-        ValidProcessCount = 0;
-        memset(&TotalResult, 0, sizeof(PT_TEST_RESULT));
-        for (Index = 0; Index < ProcessCount; Index += 1) {
-            Process = &(Processes[Index]);
+    //
+    // If all of the process had a valid result, report the trial result as
+    // the average result value over the duration of the tests.
+    //
 
-            assert(Process->Result.Type == Test->ResultType);
+    switch (Test->ResultType) {
+    case PtResultIterations:
+        Average = (double)TotalResult.Data.Iterations / ProcessCount;
+        break;
 
-            if (Process->Result.Status != 0) {
-                PT_PRINT_ERROR("%s test: failed: %s\n",
-                               Test->Name,
-                               strerror(Process->Result.Status));
+    case PtResultBytes:
+        Average = (double)TotalResult.Data.Bytes / ProcessCount;
+        break;
 
-                continue;
-            }
+    default:
 
-            switch (Test->ResultType) {
-            case PtResultIterations:
-                TotalResult.Data.Iterations += Process->Result.Data.Iterations;
-                break;
+        assert(0);
 
-            case PtResultBytes:
-                TotalResult.Data.Bytes += Process->Result.Data.Iterations;
-                break;
+        return;
+    }
 
-            default:
+    assert(Test->Duration > 0);
 
-                assert(0);
+    TrialResult->Status = 0;
+    TrialResult->PerSecond = (double)Average / (double)(Test->Duration);
 
-                return;
-            }
+    //
+    // Not every test reports resource usage data. But, knowning that all
+    // processes succeeded, if the first process reports it, then all
+    // processes should have successfully reported it.
+    //
 
-            ValidProcessCount += 1;
-        }
+    if (Processes[0].Result.ResourceUsageValid == 0) {
+        return;
+    }
 
-        //
-        // If not all of the processes succeeded, don't count the result. The
-        // summary is only valid if all of the processes succeed.
-        //
+    //
+    // Collect the total resource usage in order to take an average.
+    //
 
-        if (ValidProcessCount != ProcessCount) {
-            PT_PRINT_ERROR("%s test: %ld out of %ld processes failed.\n",
-                           Test->Name,
-                           ProcessCount - ValidProcessCount,
-                           ProcessCount);
+    for (Index = 0; Index < ProcessCount; Index += 1) {
+        Process = &(Processes[Index]);
 
-            break;
-        }
+        assert(Process->Result.ResourceUsageValid != 0);
+        assert(Process->Result.Status == 0);
 
-        //
-        // If all of the process had a valid result, report the summary as the
-        // average result value over the duration of the tests.
-        //
+        timeradd(&(TotalResult.ResourceUsage.RealTime),
+                 &(Process->Result.ResourceUsage.RealTime),
+                 &(TotalResult.ResourceUsage.RealTime));
 
-        switch (Test->ResultType) {
-        case PtResultIterations:
-            Average = (double)TotalResult.Data.Iterations / ProcessCount;
-            break;
+        timeradd(&(TotalResult.ResourceUsage.UserTime),
+                 &(Process->Result.ResourceUsage.UserTime),
+                 &(TotalResult.ResourceUsage.UserTime));
 
-        case PtResultBytes:
-            Average = (double)TotalResult.Data.Bytes / ProcessCount;
-            break;
+        timeradd(&(TotalResult.ResourceUsage.SystemTime),
+                 &(Process->Result.ResourceUsage.SystemTime),
+                 &(TotalResult.ResourceUsage.SystemTime));
+    }
 
-        default:
+    assert((TotalResult.ResourceUsage.RealTime.tv_sec >= 0) &&
+           (TotalResult.ResourceUsage.RealTime.tv_usec >= 0));
 
-            assert(0);
+    assert((TotalResult.ResourceUsage.UserTime.tv_sec >= 0) &&
+           (TotalResult.ResourceUsage.UserTime.tv_usec >= 0));
 
-            return;
-        }
+    assert((TotalResult.ResourceUsage.SystemTime.tv_sec >= 0) &&
+           (TotalResult.ResourceUsage.SystemTime.tv_usec >= 0));
 
-        assert(Test->Duration > 0);
+    //
+    // Record the average user and system time as a percentage of the average
+    // real time. The real time is taken from the results and not the test
+    // duration as there may have been some time between test completion and
+    // usage collection.
+    //
 
-        Frequency = (double)Average / (double)(Test->Duration);
-        PT_PRINT_RESULT("%s (%ldp):decimal:%.3f\n",
-                        Test->Name,
-                        ProcessCount,
-                        Frequency);
+    Microseconds = (TotalResult.ResourceUsage.RealTime.tv_sec * 1000000) +
+                   TotalResult.ResourceUsage.RealTime.tv_usec;
 
-        //
-        // Not every test reports resource usage data. But, knowning that all
-        // processes succeeded, if the first process reports it, then all
-        // processes should have successfully reported it.
-        //
+    AverageDurationMicroseconds = (double)Microseconds /ProcessCount;
+    Microseconds = (TotalResult.ResourceUsage.UserTime.tv_sec * 1000000) +
+                   TotalResult.ResourceUsage.UserTime.tv_usec;
 
-        if (Processes[0].Result.ResourceUsageValid == 0) {
-            break;
-        }
+    Average = (double)Microseconds / ProcessCount;
+    Average /= AverageDurationMicroseconds;
+    TrialResult->UserPercent = Average * 100;
+    Microseconds = (TotalResult.ResourceUsage.SystemTime.tv_sec * 1000000) +
+                   TotalResult.ResourceUsage.SystemTime.tv_usec;
 
-        //
-        // Collect the total resource usage in order to take an average.
-        //
+    Average = (double)Microseconds / ProcessCount;
+    Average /= AverageDurationMicroseconds;
+    TrialResult->SystemPercent = Average * 100;
+    TrialResult->ResourceUsageValid = 1;
+    return;
+}
+
+void
+PtpPrintTestResults (
+    PPT_TEST_INFORMATION Test,
+    PPT_PROCESS Processes,
+    long ProcessCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine prints the detailed results of each process that ran a trial
+    of a test to the results file.
+
+Arguments:
+
+    Test - Supplies a pointer to the test whose results are to be printed.
+
+    Processes - Supplies a pointer to an array of processes that ran the test.
+
+    ProcessCount - Supplies the number of processes that ran the test.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    int Index;
+
+    assert(ProcessCount > 0);
+
+    //
+    // Mark the start of the test in the results file.
+    //
+
+    PT_PRINT_RESULT("Test Name: %s\n"
+                    "Process Count: %ld\n"
+                    "Seconds: %lld\n"
+                    "Result Type: %s\n"
+                    "Results:\n",
+                    Test->Name,
+                    ProcessCount,
+                    (signed long long)Test->Duration,
+                    PtResultTypeStrings[Test->ResultType]);
+
+    //
+    // Print all the processes' results.
+    //
+
+    for (Index = 0; Index < ProcessCount; Index += 1) {
+        PtpPrintTestResult(&(Processes[Index].Result));
+    }
+
+    PT_PRINT_RESULT("\n");
+    return;
+}
+
+void
+PtpPrintTrialResults (
+    PPT_TEST_INFORMATION Test,
+    long ProcessCount,
+    PPT_TRIAL_RESULT Trials
+    )
 
-        for (Index = 0; Index < ProcessCount; Index += 1) {
-            Process = &(Processes[Index]);
+/*++
+
+Routine Description:
+
+    This routine prints the results of every trial of a test to the results
+    file, along with the statistics across the trials.
+
+Arguments:
+
+    Test - Supplies a pointer to the test whose results are to be printed.
+
+    ProcessCount - Supplies the number of processes that ran the test.
+
+    Trials - Supplies a pointer to the array of trial results. There are
+        PtTrialCount elements.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    double Mean;
+    char *Separator;
+    double StandardDeviation;
+    double SystemPercent;
+    PT_LATENCY_HISTOGRAM TotalLatency;
+    long Trial;
+    PPT_LATENCY_HISTOGRAM TrialLatency;
+    double UserPercent;
+    long ValidCount;
+
+    PtpGetTrialStatistics(Trials, &ValidCount, &Mean, &StandardDeviation);
+    memset(&TotalLatency, 0, sizeof(PT_LATENCY_HISTOGRAM));
+    for (Trial = 0; Trial < PtTrialCount; Trial += 1) {
+        if (Trials[Trial].Status == 0) {
+            PtMergeLatencyHistogram(&TotalLatency, &(Trials[Trial].Latency));
+        }
+    }
 
-            assert(Process->Result.ResourceUsageValid != 0);
-            assert(Process->Result.Status == 0);
+    switch (PtResultFormat) {
 
-            timeradd(&(TotalResult.ResourceUsage.RealTime),
-                     &(Process->Result.ResourceUsage.RealTime),
-                     &(TotalResult.ResourceUsage.RealTime));
+    //
+    // The summary prints one line for the test. This format is what the Minoca
+    // build system expects during test automation. It includes the test name,
+    // the type of the result (e.g. integer, decimal, string, duration, etc.),
+    // and the raw value in string format. With multiple trials, the value is
+    // the mean across the trials. The summary is only valid if every trial
+    // succeeded.
+    //
 
-            timeradd(&(TotalResult.ResourceUsage.UserTime),
-                     &(Process->Result.ResourceUsage.UserTime),
-                     &(TotalResult.ResourceUsage.UserTime));
+    case PtResultFormatSummary:
+        if (ValidCount != PtTrialCount) {
+            PT_PRINT_ERROR("%s test: %ld out of %ld trials failed.\n",
+                           Test->Name,
+                           PtTrialCount - ValidCount,
+                           PtTrialCount);
 
-            timeradd(&(TotalResult.ResourceUsage.SystemTime),
-                     &(Process->Result.ResourceUsage.SystemTime),
-                     &(TotalResult.ResourceUsage.SystemTime));
+            break;
         }
 
-        assert((TotalResult.ResourceUsage.RealTime.tv_sec >= 0) &&
-               (TotalResult.ResourceUsage.RealTime.tv_usec >= 0));
+        PT_PRINT_RESULT("%s (%ldp):decimal:%.3f\n",
+                        Test->Name,
+                        ProcessCount,
+                        Mean);
 
-        assert((TotalResult.ResourceUsage.UserTime.tv_sec >= 0) &&
-               (TotalResult.ResourceUsage.UserTime.tv_usec >= 0));
+        if (PtTrialCount > 1) {
+            PT_PRINT_RESULT("%s (%ldp) Std Dev:decimal:%.3f\n",
+                            Test->Name,
+                            ProcessCount,
+                            StandardDeviation);
+        }
 
-        assert((TotalResult.ResourceUsage.SystemTime.tv_sec >= 0) &&
-               (TotalResult.ResourceUsage.SystemTime.tv_usec >= 0));
+        if (TotalLatency.Count != 0) {
+            PT_PRINT_RESULT("%s (%ldp) p50 ns:integer:%llu\n"
+                            "%s (%ldp) p99 ns:integer:%llu\n"
+                            "%s (%ldp) p999 ns:integer:%llu\n",
+                            Test->Name,
+                            ProcessCount,
+                            PtGetLatencyPercentile(&TotalLatency, 50.0),
+                            Test->Name,
+                            ProcessCount,
+                            PtGetLatencyPercentile(&TotalLatency, 99.0),
+                            Test->Name,
+                            ProcessCount,
+                            PtGetLatencyPercentile(&TotalLatency, 99.9));
+        }
 
         //
-        // Report the average user and system time as a percentage of the
-        // average real time. The real time is taken from the results and not
-        // the test duration as there may have been some time between test
-        // completion and usage collection.
+        // Every trial ran the same test, so either they all reported resource
+        // usage or none did.
         //
 
-        Microseconds = (TotalResult.ResourceUsage.RealTime.tv_sec * 1000000) +
-                       TotalResult.ResourceUsage.RealTime.tv_usec;
+        if (Trials[0].ResourceUsageValid == 0) {
+            break;
+        }
 
-        AverageDurationMicroseconds = (double)Microseconds /ProcessCount;
-        Microseconds = (TotalResult.ResourceUsage.UserTime.tv_sec * 1000000) +
-                       TotalResult.ResourceUsage.UserTime.tv_usec;
+        UserPercent = 0;
+        SystemPercent = 0;
+        for (Trial = 0; Trial < PtTrialCount; Trial += 1) {
+            UserPercent += Trials[Trial].UserPercent;
+            SystemPercent += Trials[Trial].SystemPercent;
+        }
 
-        Average = (double)Microseconds / ProcessCount;
-        Average /= AverageDurationMicroseconds;
-        Average *= 100;
         PT_PRINT_RESULT("%s (%ldp) User Time %%:decimal:%.02f\n",
                         Test->Name,
                         ProcessCount,
-                        Average);
-
-        Microseconds = (TotalResult.ResourceUsage.SystemTime.tv_sec * 1000000) +
-                       TotalResult.ResourceUsage.SystemTime.tv_usec;
+                        UserPercent / PtTrialCount);
 
-        Average = (double)Microseconds / ProcessCount;
-        Average /= AverageDurationMicroseconds;
-        Average *= 100;
         PT_PRINT_RESULT("%s (%ldp) Kernel Time %%:decimal:%.02f\n",
                         Test->Name,
                         ProcessCount,
-                        Average);
+                        SystemPercent / PtTrialCount);
 
         break;
 
     //
-    // The default result format prints detailed information for each process.
+    // The JSON format writes one object per test into an array, containing
+    // each trial and the statistics across them.
     //
 
-    case PtResultFormatDefault:
-    default:
-
-        //
-        // Mark the start of the test in the results file.
-        //
+    case PtResultFormatJson:
+        if (PtResultsWritten != 0) {
+            PT_PRINT_RESULT(",");
+        }
 
-        PT_PRINT_RESULT("Test Name: %s\n"
-                        "Process Count: %ld\n"
-                        "Seconds: %lld\n"
-                        "Result Type: %s\n"
-                        "Results:\n",
+        PT_PRINT_RESULT("\n  {\"test\": \"%s\", \"processes\": %ld, "
+                        "\"duration\": %lld, \"warmup\": %lld, "
+                        "\"result_type\": \"%s\",\n   \"trials\": [",
                         Test->Name,
                         ProcessCount,
                         (signed long long)Test->Duration,
+                        (signed long long)PtWarmUpDuration,
                         PtResultTypeStrings[Test->ResultType]);
 
-        //
-        // Print all the processes' results.
-        //
+        Separator = "";
+        for (Trial = 0; Trial < PtTrialCount; Trial += 1) {
+            PT_PRINT_RESULT("%s\n    {", Separator);
+            Separator = ",";
+            if (Trials[Trial].Status != 0) {
+                PT_PRINT_RESULT("\"error\": \"%s\"}",
+                                strerror(Trials[Trial].Status));
 
-        for (Index = 0; Index < ProcessCount; Index += 1) {
-            PtpPrintTestResult(&(Processes[Index].Result));
+                continue;
+            }
+
+            PT_PRINT_RESULT("\"per_second\": %.3f", Trials[Trial].PerSecond);
+            if (Trials[Trial].ResourceUsageValid != 0) {
+                PT_PRINT_RESULT(", \"user_percent\": %.2f, "
+                                "\"system_percent\": %.2f",
+                                Trials[Trial].UserPercent,
+                                Trials[Trial].SystemPercent);
+            }
+
+            if (Trials[Trial].Latency.Count != 0) {
+                PT_PRINT_RESULT(", \"latency_ns\": ");
+                PtpPrintLatency(&(Trials[Trial].Latency));
+            }
+
+            PT_PRINT_RESULT("}");
+        }
+
+        PT_PRINT_RESULT("],\n   \"valid_trials\": %ld", ValidCount);
+        if (ValidCount != 0) {
+            PT_PRINT_RESULT(", \"mean\": %.3f, \"stddev\": %.3f",
+                            Mean,
+                            StandardDeviation);
+        }
+
+        if (TotalLatency.Count != 0) {
+            PT_PRINT_RESULT(",\n   \"latency_ns\": ");
+            PtpPrintLatency(&TotalLatency);
+        }
+
+        PT_PRINT_RESULT("}");
+        break;
+
+    //
+    // The CSV format writes a row for each successful trial. This is the
+    // format read back in when comparing results.
+    //
+
+    case PtResultFormatCsv:
+        for (Trial = 0; Trial < PtTrialCount; Trial += 1) {
+            if (Trials[Trial].Status != 0) {
+                continue;
+            }
+
+            TrialLatency = &(Trials[Trial].Latency);
+            PT_PRINT_RESULT("%s,%ld,%ld,%lld,%s,%.3f,%.2f,%.2f,%llu,%.0f,"
+                            "%llu,%llu,%llu,%llu\n",
+                            Test->Name,
+                            ProcessCount,
+                            Trial,
+                            (signed long long)Test->Duration,
+                            PtResultTypeStrings[Test->ResultType],
+                            Trials[Trial].PerSecond,
+                            Trials[Trial].UserPercent,
+                            Trials[Trial].SystemPercent,
+                            TrialLatency->Count,
+                            (TrialLatency->Count == 0) ? 0.0 :
+                            (double)TrialLatency->Total / TrialLatency->Count,
+                            PtGetLatencyPercentile(TrialLatency, 50.0),
+                            PtGetLatencyPercentile(TrialLatency, 99.0),
+                            PtGetLatencyPercentile(TrialLatency, 99.9),
+                            TrialLatency->Maximum);
+        }
+
+        break;
+
+    //
+    // The default format already printed each process's results as the trials
+    // ran. Add the statistics across trials and the latencies if there is
+    // anything beyond the single result.
+    //
+
+    case PtResultFormatDefault:
+    default:
+        if ((PtTrialCount > 1) && (ValidCount != 0)) {
+            PT_PRINT_RESULT("Test Name: %s\n"
+                            "Process Count: %ld\n"
+                            "Valid Trials: %ld of %ld\n"
+                            "Mean Per Second: %.3f\n"
+                            "Standard Deviation: %.3f\n",
+                            Test->Name,
+                            ProcessCount,
+                            ValidCount,
+                            PtTrialCount,
+                            Mean,
+                            StandardDeviation);
+        }
+
+        if (TotalLatency.Count != 0) {
+            PT_PRINT_RESULT("Latency (ns): %llu operations, mean %.0f, "
+                            "p50 %llu, p99 %llu, p999 %llu, max %llu\n",
+                            TotalLatency.Count,
+                            (double)TotalLatency.Total / TotalLatency.Count,
+                            PtGetLatencyPercentile(&TotalLatency, 50.0),
+                            PtGetLatencyPercentile(&TotalLatency, 99.0),
+                            PtGetLatencyPercentile(&TotalLatency, 99.9),
+                            TotalLatency.Maximum);
+        }
+
+        if (((PtTrialCount > 1) && (ValidCount != 0)) ||
+            (TotalLatency.Count != 0)) {
+
+            PT_PRINT_RESULT("\n");
         }
 
-        PT_PRINT_RESULT("\n");
         break;
     }
 
+    PtResultsWritten += 1;
+    return;
+}
+
+void
+PtpPrintLatency (
+    PPT_LATENCY_HISTOGRAM Latency
+    )
+
+/*++
+
+Routine Description:
+
+    This routine prints a summary of a latency histogram to the results file
+    as a JSON object.
+
+Arguments:
+
+    Latency - Supplies a pointer to the histogram to print.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PT_PRINT_RESULT("{\"count\": %llu, \"mean\": %.0f, \"min\": %llu, "
+                    "\"p50\": %llu, \"p99\": %llu, \"p999\": %llu, "
+                    "\"max\": %llu}",
+                    Latency->Count,
+                    (double)Latency->Total / Latency->Count,
+                    Latency->Minimum,
+                    PtGetLatencyPercentile(Latency, 50.0),
+                    PtGetLatencyPercentile(Latency, 99.0),
+                    PtGetLatencyPercentile(Latency, 99.9),
+                    Latency->Maximum);
+
+    return;
+}
+
+void
+PtpGetTrialStatistics (
+    PPT_TRIAL_RESULT Trials,
+    long *ValidCount,
+    double *Mean,
+    double *StandardDeviation
+    )
+
+/*++
+
+Routine Description:
+
+    This routine computes the mean and sample standard deviation of the
+    per-second results of the successful trials of a test.
+
+Arguments:
+
+    Trials - Supplies a pointer to the array of trial results. There are
+        PtTrialCount elements.
+
+    ValidCount - Supplies a pointer where the number of successful trials is
+        returned.
+
+    Mean - Supplies a pointer where the mean is returned.
+
+    StandardDeviation - Supplies a pointer where the standard deviation is
+        returned. This is zero with fewer than two successful trials.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    long Count;
+    double Difference;
+    double Sum;
+    long Trial;
+
+    Count = 0;
+    Sum = 0;
+    *Mean = 0;
+    *StandardDeviation = 0;
+    for (Trial = 0; Trial < PtTrialCount; Trial += 1) {
+        if (Trials[Trial].Status == 0) {
+            Sum += Trials[Trial].PerSecond;
+            Count += 1;
+        }
+    }
+
+    *ValidCount = Count;
+    if (Count == 0) {
+        return;
+    }
+
+    *Mean = Sum / Count;
+    if (Count < 2) {
+        return;
+    }
+
+    Sum = 0;
+    for (Trial = 0; Trial < PtTrialCount; Trial += 1) {
+        if (Trials[Trial].Status == 0) {
+            Difference = Trials[Trial].PerSecond - *Mean;
+            Sum += Difference * Difference;
+        }
+    }
+
+    *StandardDeviation = sqrt(Sum / (Count - 1));
     return;
 }
 
@@ -1203,6 +2007,15 @@ Return Value:
         PT_PRINT_RESULT("\n");
     }
 
+    if (Result->Latency.Count != 0) {
+        PT_PRINT_RESULT("    latency ns: p50 %llu, p99 %llu, p999 %llu, "
+                        "max %llu\n",
+                        PtGetLatencyPercentile(&(Result->Latency), 50.0),
+                        PtGetLatencyPercentile(&(Result->Latency), 99.0),
+                        PtGetLatencyPercentile(&(Result->Latency), 99.9),
+                        Result->Latency.Maximum);
+    }
+
     return;
 }
 
@@ -1232,22 +2045,35 @@ Return Value:
 
 {
 
+    char *Buffer;
     ssize_t BytesRead;
+    size_t TotalBytes;
+
+    //
+    // The result is larger than the pipe's atomic write size, so it may
+    // arrive in pieces.
+    //
 
-    do {
-        BytesRead = read(Child->PipeDescriptors[0],
-                         &(Child->Result),
-                         sizeof(PT_TEST_RESULT));
+    Buffer = (char *)&(Child->Result);
+    TotalBytes = 0;
+    while (TotalBytes != sizeof(PT_TEST_RESULT)) {
+        do {
+            BytesRead = read(Child->PipeDescriptors[0],
+                             Buffer + TotalBytes,
+                             sizeof(PT_TEST_RESULT) - TotalBytes);
 
-    } while ((BytesRead < 0) && (errno == EINTR));
+        } while ((BytesRead < 0) && (errno == EINTR));
 
-    if (BytesRead < 0) {
-        return -1;
-    }
+        if (BytesRead < 0) {
+            return -1;
+        }
+
+        if (BytesRead == 0) {
+            errno = EIO;
+            return -1;
+        }
 
-    if (BytesRead != sizeof(PT_TEST_RESULT)) {
-        errno = EIO;
-        return -1;
+        TotalBytes += BytesRead;
     }
 
     return 0;
@@ -1279,24 +2105,89 @@ Return Value:
 
 {
 
+    char *Buffer;
     ssize_t BytesWritten;
+    size_t TotalBytes;
 
-    do {
-        BytesWritten = write(Process->PipeDescriptors[1],
-                             &(Process->Result),
-                             sizeof(PT_TEST_RESULT));
+    Buffer = (char *)&(Process->Result);
+    TotalBytes = 0;
+    while (TotalBytes != sizeof(PT_TEST_RESULT)) {
+        do {
+            BytesWritten = write(Process->PipeDescriptors[1],
+                                 Buffer + TotalBytes,
+                                 sizeof(PT_TEST_RESULT) - TotalBytes);
 
-    } while ((BytesWritten < 0) && (errno == EINTR));
+        } while ((BytesWritten < 0) && (errno == EINTR));
 
-    if (BytesWritten < 0) {
-        return -1;
-    }
+        if (BytesWritten < 0) {
+            return -1;
+        }
+
+        if (BytesWritten == 0) {
+            errno = EIO;
+            return -1;
+        }
 
-    if (BytesWritten != sizeof(PT_TEST_RESULT)) {
-        errno = EIO;
-        return -1;
+        TotalBytes += BytesWritten;
     }
 
     return 0;
 }
 
+int
+PtpPinProcess (
+    long ProcessIndex
+    )
+
+/*++
+
+Routine Description:
+
+    This routine pins the current process to a single processor. The first
+    process goes on the processor requested on the command line, and each
+    subsequent process on the one after it, wrapping around at the number of
+    online processors.
+
+Arguments:
+
+    ProcessIndex - Supplies the index of the current process among the test
+        processes.
+
+Return Value:
+
+    0 on success.
+
+    -1 on failure and errno will be set.
+
+--*/
+
+{
+
+#ifdef CPU_SET
+
+    cpu_set_t Processors;
+    long ProcessorCount;
+
+    ProcessorCount = sysconf(_SC_NPROCESSORS_ONLN);
+    if (ProcessorCount <= 0) {
+        ProcessorCount = 1;
+    }
+
+    CPU_ZERO(&Processors);
+    CPU_SET((PtFirstProcessor + ProcessIndex) % ProcessorCount, &Processors);
+    return sched_setaffinity(0, sizeof(cpu_set_t), &Processors);
+
+#else
+
+    //
+    // Without an affinity interface in the C library there is no way to pin
+    // the process.
+    //
+
+    errno = ENOSYS;
+    return -1;
+
+#endif
+
+}
+
@@ -25,6 +25,7 @@ Module Name:
 // ------------------------------------------------------------------- Includes
 //
 
+#include <stdio.h>
 #include <sys/time.h>
 
 //
@@ -145,6 +146,34 @@ Module Name:
 #define SIGNAL_RESTART_DESCRIPTION \
     "Benchmarks how many system call restarts can be made."
 
+#define VFORK_TEST_NAME "vfork"
+#define VFORK_TEST_DESCRIPTION "Benchmarks the vfork() C library routine."
+#define SPAWN_TEST_NAME "spawn"
+#define SPAWN_TEST_DESCRIPTION \
+    "Benchmarks the posix_spawn() C library routine."
+
+#define PATH_WALK_OPEN_TEST_NAME "path_open"
+#define PATH_WALK_OPEN_TEST_DESCRIPTION \
+    "Benchmarks open() and close() on a deeply nested path."
+
+#define PATH_WALK_STAT_TEST_NAME "path_stat"
+#define PATH_WALK_STAT_TEST_DESCRIPTION \
+    "Benchmarks stat() on a deeply nested path."
+
+#define SOCKET_LOOPBACK_TEST_NAME "socket_loopback"
+#define SOCKET_LOOPBACK_TEST_DESCRIPTION \
+    "Benchmarks TCP send() and recv() round trips over the loopback address."
+
+#define POLL_TEST_NAME "poll"
+#define POLL_TEST_DESCRIPTION "Benchmarks the poll() C library routine."
+#define SEQUENTIAL_WRITE_TEST_NAME "seq_write"
+#define SEQUENTIAL_WRITE_TEST_DESCRIPTION \
+    "Benchmarks large sequential write() throughput to a file."
+
+#define SEQUENTIAL_READ_TEST_NAME "seq_read"
+#define SEQUENTIAL_READ_TEST_DESCRIPTION \
+    "Benchmarks large sequential read() throughput from a file."
+
 //
 // Default test durations, in seconds.
 //
@@ -180,6 +209,14 @@ Module Name:
 #define SIGNAL_IGNORED_DEFAULT_DURATION 30
 #define SIGNAL_HANDLED_DEFAULT_DURATION 30
 #define SIGNAL_RESTART_DEFAULT_DURATION 30
+#define VFORK_TEST_DEFAULT_DURATION 60
+#define SPAWN_TEST_DEFAULT_DURATION 60
+#define PATH_WALK_OPEN_TEST_DEFAULT_DURATION 30
+#define PATH_WALK_STAT_TEST_DEFAULT_DURATION 30
+#define SOCKET_LOOPBACK_TEST_DEFAULT_DURATION 30
+#define POLL_TEST_DEFAULT_DURATION 30
+#define SEQUENTIAL_WRITE_TEST_DEFAULT_DURATION 60
+#define SEQUENTIAL_READ_TEST_DEFAULT_DURATION 60
 
 //
 // Define the number of variables supplied to an iteration of the execute test
@@ -188,6 +225,27 @@ Module Name:
 
 #define EXEC_LOOP_ARGUMENT_COUNT 5
 
+//
+// Define the number of arguments supplied to a child of the spawn test.
+//
+
+#define SPAWN_CHILD_ARGUMENT_COUNT 2
+
+//
+// Define the shape of the latency histogram. Values below the sub-bucket
+// count get a bucket each. Above that, each power of two is split into
+// 2^PT_LATENCY_SUB_BUCKET_BITS linear sub-buckets, which bounds the relative
+// error of a reported percentile to 1/8th. Latencies at or beyond the maximum
+// power of two (about 18 minutes in nanoseconds) land in the last bucket.
+//
+
+#define PT_LATENCY_SUB_BUCKET_BITS 3
+#define PT_LATENCY_SUB_BUCKET_COUNT (1 << PT_LATENCY_SUB_BUCKET_BITS)
+#define PT_LATENCY_MAX_POWER 40
+#define PT_LATENCY_BUCKET_COUNT \
+    ((PT_LATENCY_MAX_POWER - PT_LATENCY_SUB_BUCKET_BITS + 2) * \
+     PT_LATENCY_SUB_BUCKET_COUNT)
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -225,6 +283,14 @@ typedef enum _PT_TEST_TYPE {
     PtTestSignalIgnored,
     PtTestSignalHandled,
     PtTestSignalRestart,
+    PtTestVfork,
+    PtTestSpawn,
+    PtTestPathWalkOpen,
+    PtTestPathWalkStat,
+    PtTestSocketLoopback,
+    PtTestPoll,
+    PtTestSequentialWrite,
+    PtTestSequentialRead,
     PtTestTypeCount
 } PT_TEST_TYPE, *PPT_TEST_TYPE;
 
@@ -280,6 +346,36 @@ typedef struct _PT_TEST_RESOURCE_USAGE {
 
 /*++
 
+Structure Description:
+
+    This structure defines a histogram of per-operation latencies collected
+    during a timed test.
+
+Members:
+
+    Count - Stores the total number of operations recorded.
+
+    Minimum - Stores the smallest latency recorded, in nanoseconds.
+
+    Maximum - Stores the largest latency recorded, in nanoseconds.
+
+    Total - Stores the sum of all recorded latencies, in nanoseconds.
+
+    Buckets - Stores the number of operations that fell into each bucket. See
+        the PT_LATENCY_* definitions for the bucket layout.
+
+--*/
+
+typedef struct _PT_LATENCY_HISTOGRAM {
+    unsigned long long Count;
+    unsigned long long Minimum;
+    unsigned long long Maximum;
+    unsigned long long Total;
+    unsigned long long Buckets[PT_LATENCY_BUCKET_COUNT];
+} PT_LATENCY_HISTOGRAM, *PPT_LATENCY_HISTOGRAM;
+
+/*++
+
 Structure Description:
 
     This structure defines a performance test result.
@@ -299,6 +395,9 @@ Structure Description:
 
     Bytes - Stores the number of bytes the test processed.
 
+    Latency - Stores the per-operation latency histogram. The count is zero if
+        latencies were not collected.
+
 --*/
 
 typedef struct _PT_TEST_RESULT {
@@ -311,6 +410,8 @@ typedef struct _PT_TEST_RESULT {
         unsigned long long Bytes;
     } Data;
 
+    PT_LATENCY_HISTOGRAM Latency;
+
 } PT_TEST_RESULT, *PPT_TEST_RESULT;
 
 typedef struct _PT_TEST_INFORMATION PT_TEST_INFORMATION, *PPT_TEST_INFORMATION;
@@ -386,6 +487,13 @@ struct _PT_TEST_INFORMATION {
 
 extern char *PtProgramPath;
 
+//
+// Store a boolean indicating whether or not timed tests should record the
+// latency of each operation.
+//
+
+extern int PtCollectLatency;
+
 //
 // -------------------------------------------------------- Function Prototypes
 //
@@ -466,6 +574,106 @@ Return Value:
 
 --*/
 
+int
+PtContinueTimedTest (
+    void
+    );
+
+/*++
+
+Routine Description:
+
+    This routine determines whether or not a timed test should run another
+    operation. Tests call this once at the top of each operation. If latency
+    collection is enabled, the time since the previous call is recorded as the
+    latency of the operation that just completed.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    1 if the test is still running, or 0 if the test has finished.
+
+--*/
+
+void
+PtRecordLatency (
+    PPT_LATENCY_HISTOGRAM Histogram,
+    unsigned long long Nanoseconds
+    );
+
+/*++
+
+Routine Description:
+
+    This routine adds a single latency sample to a histogram.
+
+Arguments:
+
+    Histogram - Supplies a pointer to the histogram to update.
+
+    Nanoseconds - Supplies the latency to record, in nanoseconds.
+
+Return Value:
+
+    None.
+
+--*/
+
+void
+PtMergeLatencyHistogram (
+    PPT_LATENCY_HISTOGRAM Destination,
+    PPT_LATENCY_HISTOGRAM Source
+    );
+
+/*++
+
+Routine Description:
+
+    This routine adds the samples of one latency histogram into another.
+
+Arguments:
+
+    Destination - Supplies a pointer to the histogram to add into.
+
+    Source - Supplies a pointer to the histogram whose samples are added.
+
+Return Value:
+
+    None.
+
+--*/
+
+unsigned long long
+PtGetLatencyPercentile (
+    PPT_LATENCY_HISTOGRAM Histogram,
+    double Percentile
+    );
+
+/*++
+
+Routine Description:
+
+    This routine estimates a percentile of the latencies recorded in the given
+    histogram.
+
+Arguments:
+
+    Histogram - Supplies a pointer to the histogram to query.
+
+    Percentile - Supplies the desired percentile, between 0 and 100.
+
+Return Value:
+
+    Returns the upper bound, in nanoseconds, of the bucket containing the
+    requested percentile, clipped to the largest recorded value.
+
+    0 if the histogram is empty.
+
+--*/
+
 int
 PtCollectResourceUsageStart (
     void
@@ -1021,3 +1229,165 @@ Return Value:
 
 --*/
 
+void
+SpawnMain (
+    PPT_TEST_INFORMATION Test,
+    PPT_TEST_RESULT Result
+    );
+
+/*++
+
+Routine Description:
+
+    This routine performs the vfork and spawn performance benchmark tests.
+
+Arguments:
+
+    Test - Supplies a pointer to the performance test being executed.
+
+    Result - Supplies a pointer to a performance test result structure that
+        receives the tests results.
+
+Return Value:
+
+    None.
+
+--*/
+
+void
+PathWalkMain (
+    PPT_TEST_INFORMATION Test,
+    PPT_TEST_RESULT Result
+    );
+
+/*++
+
+Routine Description:
+
+    This routine performs the path walk performance benchmark tests.
+
+Arguments:
+
+    Test - Supplies a pointer to the performance test being executed.
+
+    Result - Supplies a pointer to a performance test result structure that
+        receives the tests results.
+
+Return Value:
+
+    None.
+
+--*/
+
+void
+SocketLoopbackMain (
+    PPT_TEST_INFORMATION Test,
+    PPT_TEST_RESULT Result
+    );
+
+/*++
+
+Routine Description:
+
+    This routine performs the socket loopback performance benchmark test.
+
+Arguments:
+
+    Test - Supplies a pointer to the performance test being executed.
+
+    Result - Supplies a pointer to a performance test result structure that
+        receives the tests results.
+
+Return Value:
+
+    None.
+
+--*/
+
+void
+PollMain (
+    PPT_TEST_INFORMATION Test,
+    PPT_TEST_RESULT Result
+    );
+
+/*++
+
+Routine Description:
+
+    This routine performs the poll performance benchmark test.
+
+Arguments:
+
+    Test - Supplies a pointer to the performance test being executed.
+
+    Result - Supplies a pointer to a performance test result structure that
+        receives the tests results.
+
+Return Value:
+
+    None.
+
+--*/
+
+void
+SequentialIoMain (
+    PPT_TEST_INFORMATION Test,
+    PPT_TEST_RESULT Result
+    );
+
+/*++
+
+Routine Description:
+
+    This routine performs the large sequential file I/O performance benchmark
+    tests.
+
+Arguments:
+
+    Test - Supplies a pointer to the performance test being executed.
+
+    Result - Supplies a pointer to a performance test result structure that
+        receives the tests results.
+
+Return Value:
+
+    None.
+
+--*/
+
+//
+// Result comparison routines.
+//
+
+int
+PtCompareResults (
+    char *BasePath,
+    char *NewPath,
+    FILE *Output
+    );
+
+/*++
+
+Routine Description:
+
+    This routine compares two result files written in the CSV format and
+    reports, for each test present in both, whether the change between them
+    is statistically significant.
+
+Arguments:
+
+    BasePath - Supplies a pointer to the path of the baseline result file.
+
+    NewPath - Supplies a pointer to the path of the result file to compare
+        against the baseline.
+
+    Output - Supplies the stream the comparison report is written to.
+
+Return Value:
+
+    Returns the number of tests that regressed significantly.
+
+    -1 if a result file could not be read, and errno will be set.
+
+--*/
+
@@ -134,7 +134,7 @@ Return Value:
     // writing to and reading from a pipe.
     //
 
-    while (PtIsTimedTestRunning() != 0) {
+    while (PtContinueTimedTest() != 0) {
         do {
             BytesCompleted = write(PipeDescriptors[1],
                                    Buffer,
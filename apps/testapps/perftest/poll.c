@@ -0,0 +1,198 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    poll.c
+
+Abstract:
+
+    This module implements the performance benchmark test for the poll() C
+    library routine.
+
+Author:
+
+    agent 19-Oct-2026
+
+Environment:
+
+    User
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "perftest.h"
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// Define the number of pipes polled on each iteration. Only the last one
+// ever has data ready, so poll() has to look at every descriptor.
+//
+
+#define PT_POLL_PIPE_COUNT 16
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+void
+PollMain (
+    PPT_TEST_INFORMATION Test,
+    PPT_TEST_RESULT Result
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs the poll performance benchmark test.
+
+Arguments:
+
+    Test - Supplies a pointer to the performance test being executed.
+
+    Result - Supplies a pointer to a performance test result structure that
+        receives the tests results.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ssize_t BytesWritten;
+    char Character;
+    int Index;
+    unsigned long long Iterations;
+    int PipeCount;
+    int Pipes[PT_POLL_PIPE_COUNT][2];
+    struct pollfd PollDescriptors[PT_POLL_PIPE_COUNT];
+    int Status;
+
+    Character = 0;
+    Iterations = 0;
+    PipeCount = 0;
+    Result->Type = PtResultIterations;
+    Result->Status = 0;
+
+    //
+    // Create the pipes and set up the poll descriptors to wait on their read
+    // ends.
+    //
+
+    memset(PollDescriptors, 0, sizeof(PollDescriptors));
+    for (Index = 0; Index < PT_POLL_PIPE_COUNT; Index += 1) {
+        Status = pipe(Pipes[Index]);
+        if (Status != 0) {
+            Result->Status = errno;
+            goto MainEnd;
+        }
+
+        PipeCount += 1;
+        PollDescriptors[Index].fd = Pipes[Index][0];
+        PollDescriptors[Index].events = POLLIN;
+    }
+
+    //
+    // Make the last pipe readable. The byte is never consumed, so every poll
+    // returns immediately with one descriptor ready.
+    //
+
+    do {
+        BytesWritten = write(Pipes[PT_POLL_PIPE_COUNT - 1][1], &Character, 1);
+
+    } while ((BytesWritten < 0) && (errno == EINTR));
+
+    if (BytesWritten != 1) {
+        Result->Status = errno;
+        if (Result->Status == 0) {
+            Result->Status = EIO;
+        }
+
+        goto MainEnd;
+    }
+
+    //
+    // Start the test. This snaps resource usage and starts the clock ticking.
+    //
+
+    Status = PtStartTimedTest(Test->Duration);
+    if (Status != 0) {
+        Result->Status = errno;
+        goto MainEnd;
+    }
+
+    //
+    // Measure the performance of the poll() C library routine by counting the
+    // number of times the set of pipes can be polled.
+    //
+
+    while (PtContinueTimedTest() != 0) {
+        Status = poll(PollDescriptors, PT_POLL_PIPE_COUNT, 0);
+        if (Status < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            Result->Status = errno;
+            break;
+        }
+
+        if (Status != 1) {
+            Result->Status = EIO;
+            break;
+        }
+
+        Iterations += 1;
+    }
+
+    Status = PtFinishTimedTest(Result);
+    if ((Status != 0) && (Result->Status == 0)) {
+        Result->Status = errno;
+    }
+
+MainEnd:
+    for (Index = 0; Index < PipeCount; Index += 1) {
+        close(Pipes[Index][0]);
+        close(Pipes[Index][1]);
+    }
+
+    Result->Data.Iterations = Iterations;
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
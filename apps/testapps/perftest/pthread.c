@@ -135,7 +135,7 @@ Return Value:
     // counting the number of times a thread can be created and destroyed.
     //
 
-    while (PtIsTimedTestRunning() != 0) {
+    while (PtContinueTimedTest() != 0) {
         Argument = Iterations;
         Status = pthread_create(&NewThread,
                                 NULL,
@@ -201,7 +201,7 @@ Return Value:
     // number of bytes that can be read in.
     //
 
-    while (PtIsTimedTestRunning() != 0) {
+    while (PtContinueTimedTest() != 0) {
         do {
             BytesRead = read(FileDescriptor, Buffer, PT_READ_TEST_BUFFER_SIZE);
 
@@ -156,7 +156,7 @@ Return Value:
     // the number of times a file can be renamed.
     //
 
-    while (PtIsTimedTestRunning() != 0) {
+    while (PtContinueTimedTest() != 0) {
         Status = rename(SourceFile, DestinationFile);
         if (Status != 0) {
             Result->Status = errno;
@@ -0,0 +1,336 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    seqio.c
+
+Abstract:
+
+    This module implements the performance benchmark tests for large
+    sequential file reads and writes.
+
+Author:
+
+    agent 19-Oct-2026
+
+Environment:
+
+    User
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "perftest.h"
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// The file is made large enough that it does not fit in the caches of most
+// storage devices, and is transferred in large chunks so that the per-call
+// overhead is small compared to the cost of moving the data.
+//
+
+#define PT_SEQUENTIAL_TEST_FILE_NAME_LENGTH 48
+#define PT_SEQUENTIAL_TEST_FILE_SIZE (64 * 1024 * 1024)
+#define PT_SEQUENTIAL_TEST_BUFFER_SIZE (1024 * 1024)
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+int
+PtpSequentialWriteChunk (
+    int FileDescriptor,
+    char *Buffer,
+    off_t *Offset
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+void
+SequentialIoMain (
+    PPT_TEST_INFORMATION Test,
+    PPT_TEST_RESULT Result
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs the large sequential file I/O performance benchmark
+    tests.
+
+Arguments:
+
+    Test - Supplies a pointer to the performance test being executed.
+
+    Result - Supplies a pointer to a performance test result structure that
+        receives the tests results.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    char *Buffer;
+    ssize_t BytesRead;
+    int FileCreated;
+    int FileDescriptor;
+    char FileName[PT_SEQUENTIAL_TEST_FILE_NAME_LENGTH];
+    off_t Offset;
+    pid_t ProcessId;
+    int Status;
+    unsigned long long TotalBytes;
+
+    FileCreated = 0;
+    FileDescriptor = -1;
+    Offset = 0;
+    Result->Type = PtResultBytes;
+    Result->Status = 0;
+    TotalBytes = 0;
+
+    //
+    // Allocate a buffer and fill it with a pattern so that the data written
+    // is not all zeros.
+    //
+
+    Buffer = malloc(PT_SEQUENTIAL_TEST_BUFFER_SIZE);
+    if (Buffer == NULL) {
+        Result->Status = ENOMEM;
+        goto MainEnd;
+    }
+
+    memset(Buffer, 'S', PT_SEQUENTIAL_TEST_BUFFER_SIZE);
+
+    //
+    // Get the process ID and create a process safe file path.
+    //
+
+    ProcessId = getpid();
+    Status = snprintf(FileName,
+                      PT_SEQUENTIAL_TEST_FILE_NAME_LENGTH,
+                      "seqio_%d.txt",
+                      ProcessId);
+
+    if (Status < 0) {
+        Result->Status = errno;
+        goto MainEnd;
+    }
+
+    FileDescriptor = open(FileName,
+                          O_RDWR | O_CREAT | O_TRUNC,
+                          S_IRUSR | S_IWUSR);
+
+    if (FileDescriptor < 0) {
+        Result->Status = errno;
+        goto MainEnd;
+    }
+
+    FileCreated = 1;
+
+    //
+    // The read test needs the whole file to exist up front. Write it out and
+    // flush it before the clock starts.
+    //
+
+    if (Test->TestType == PtTestSequentialRead) {
+        do {
+            Status = PtpSequentialWriteChunk(FileDescriptor, Buffer, &Offset);
+            if (Status != 0) {
+                Result->Status = errno;
+                goto MainEnd;
+            }
+
+        } while (Offset != 0);
+
+        Status = fsync(FileDescriptor);
+        if (Status != 0) {
+            Result->Status = errno;
+            goto MainEnd;
+        }
+    }
+
+    //
+    // Start the test. This snaps resource usage and starts the clock ticking.
+    //
+
+    Status = PtStartTimedTest(Test->Duration);
+    if (Status != 0) {
+        Result->Status = errno;
+        goto MainEnd;
+    }
+
+    //
+    // Measure sequential throughput by streaming through the file one large
+    // chunk at a time, starting over from the beginning at the end.
+    //
+
+    switch (Test->TestType) {
+    case PtTestSequentialWrite:
+        while (PtContinueTimedTest() != 0) {
+            Status = PtpSequentialWriteChunk(FileDescriptor, Buffer, &Offset);
+            if (Status != 0) {
+                Result->Status = errno;
+                break;
+            }
+
+            TotalBytes += PT_SEQUENTIAL_TEST_BUFFER_SIZE;
+        }
+
+        break;
+
+    case PtTestSequentialRead:
+        while (PtContinueTimedTest() != 0) {
+            do {
+                BytesRead = read(FileDescriptor,
+                                 Buffer,
+                                 PT_SEQUENTIAL_TEST_BUFFER_SIZE);
+
+            } while ((BytesRead < 0) && (errno == EINTR));
+
+            if (BytesRead < 0) {
+                Result->Status = errno;
+                break;
+            }
+
+            if (BytesRead != PT_SEQUENTIAL_TEST_BUFFER_SIZE) {
+                if (lseek(FileDescriptor, 0, SEEK_SET) != 0) {
+                    Result->Status = errno;
+                    break;
+                }
+            }
+
+            TotalBytes += (unsigned long long)BytesRead;
+        }
+
+        break;
+
+    default:
+        Result->Status = EINVAL;
+        break;
+    }
+
+    Status = PtFinishTimedTest(Result);
+    if ((Status != 0) && (Result->Status == 0)) {
+        Result->Status = errno;
+    }
+
+MainEnd:
+    if (FileCreated != 0) {
+        close(FileDescriptor);
+        remove(FileName);
+    }
+
+    if (Buffer != NULL) {
+        free(Buffer);
+    }
+
+    Result->Data.Bytes = TotalBytes;
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+int
+PtpSequentialWriteChunk (
+    int FileDescriptor,
+    char *Buffer,
+    off_t *Offset
+    )
+
+/*++
+
+Routine Description:
+
+    This routine writes one buffer's worth of data to the test file. Once the
+    file reaches its full size, the file pointer is moved back to the start so
+    that the file is overwritten rather than grown.
+
+Arguments:
+
+    FileDescriptor - Supplies the open file to write to.
+
+    Buffer - Supplies a pointer to the data to write.
+
+    Offset - Supplies a pointer to the current file offset. This is updated
+        to the offset of the next write.
+
+Return Value:
+
+    0 on success.
+
+    -1 on error, and the errno variable will contain more information.
+
+--*/
+
+{
+
+    ssize_t BytesWritten;
+    size_t TotalBytes;
+
+    TotalBytes = 0;
+    while (TotalBytes != PT_SEQUENTIAL_TEST_BUFFER_SIZE) {
+        do {
+            BytesWritten = write(FileDescriptor,
+                                 Buffer + TotalBytes,
+                                 PT_SEQUENTIAL_TEST_BUFFER_SIZE - TotalBytes);
+
+        } while ((BytesWritten < 0) && (errno == EINTR));
+
+        if (BytesWritten <= 0) {
+            if (BytesWritten == 0) {
+                errno = EIO;
+            }
+
+            return -1;
+        }
+
+        TotalBytes += BytesWritten;
+    }
+
+    *Offset += PT_SEQUENTIAL_TEST_BUFFER_SIZE;
+    if (*Offset >= PT_SEQUENTIAL_TEST_FILE_SIZE) {
+        if (lseek(FileDescriptor, 0, SEEK_SET) != 0) {
+            return -1;
+        }
+
+        *Offset = 0;
+    }
+
+    return 0;
+}
+
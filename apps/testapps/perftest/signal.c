@@ -175,7 +175,7 @@ Return Value:
     switch (Test->TestType) {
     case PtTestSignalIgnored:
     case PtTestSignalHandled:
-        while (PtIsTimedTestRunning() != 0) {
+        while (PtContinueTimedTest() != 0) {
             if (raise(SIGUSR1) != 0) {
                 Result->Status = errno;
                 break;
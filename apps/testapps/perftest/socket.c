@@ -0,0 +1,389 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    socket.c
+
+Abstract:
+
+    This module implements the performance benchmark test for TCP round trips
+    over the loopback address.
+
+Author:
+
+    agent 19-Oct-2026
+
+Environment:
+
+    User
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "perftest.h"
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+#define PT_SOCKET_MESSAGE_SIZE 64
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+int
+PtpSocketConnectLoopback (
+    int *Client,
+    int *Server
+    );
+
+int
+PtpSocketTransfer (
+    int Source,
+    int Destination,
+    char *Buffer,
+    size_t Size
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+void
+SocketLoopbackMain (
+    PPT_TEST_INFORMATION Test,
+    PPT_TEST_RESULT Result
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs the socket loopback performance benchmark test.
+
+Arguments:
+
+    Test - Supplies a pointer to the performance test being executed.
+
+    Result - Supplies a pointer to a performance test result structure that
+        receives the tests results.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    char Buffer[PT_SOCKET_MESSAGE_SIZE];
+    int Client;
+    unsigned long long Iterations;
+    int Server;
+    int Status;
+
+    Client = -1;
+    Iterations = 0;
+    Server = -1;
+    Result->Type = PtResultIterations;
+    Result->Status = 0;
+    memset(Buffer, 0, sizeof(Buffer));
+
+    //
+    // Create a connected pair of TCP sockets over the loopback address.
+    //
+
+    Status = PtpSocketConnectLoopback(&Client, &Server);
+    if (Status != 0) {
+        Result->Status = errno;
+        goto MainEnd;
+    }
+
+    //
+    // Start the test. This snaps resource usage and starts the clock ticking.
+    //
+
+    Status = PtStartTimedTest(Test->Duration);
+    if (Status != 0) {
+        Result->Status = errno;
+        goto MainEnd;
+    }
+
+    //
+    // Measure the round trip cost of the network stack by bouncing a small
+    // message from the client to the server and back again.
+    //
+
+    while (PtContinueTimedTest() != 0) {
+        Status = PtpSocketTransfer(Client, Server, Buffer, sizeof(Buffer));
+        if (Status != 0) {
+            Result->Status = errno;
+            break;
+        }
+
+        Status = PtpSocketTransfer(Server, Client, Buffer, sizeof(Buffer));
+        if (Status != 0) {
+            Result->Status = errno;
+            break;
+        }
+
+        Iterations += 1;
+    }
+
+    Status = PtFinishTimedTest(Result);
+    if ((Status != 0) && (Result->Status == 0)) {
+        Result->Status = errno;
+    }
+
+MainEnd:
+    if (Client >= 0) {
+        close(Client);
+    }
+
+    if (Server >= 0) {
+        close(Server);
+    }
+
+    Result->Data.Iterations = Iterations;
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+int
+PtpSocketConnectLoopback (
+    int *Client,
+    int *Server
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates a pair of TCP sockets connected to each other over
+    the loopback address. Nagle's algorithm is disabled on both so that small
+    messages are sent immediately.
+
+Arguments:
+
+    Client - Supplies a pointer where the connecting socket is returned.
+
+    Server - Supplies a pointer where the accepted socket is returned.
+
+Return Value:
+
+    0 on success.
+
+    -1 on error, and the errno variable will contain more information.
+
+--*/
+
+{
+
+    struct sockaddr_in Address;
+    socklen_t AddressLength;
+    int Listener;
+    int Option;
+    int Status;
+
+    *Client = -1;
+    *Server = -1;
+    Status = -1;
+    Listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (Listener < 0) {
+        goto SocketConnectLoopbackEnd;
+    }
+
+    //
+    // Bind to an ephemeral port on the loopback address and find out which
+    // port was chosen.
+    //
+
+    memset(&Address, 0, sizeof(Address));
+    Address.sin_family = AF_INET;
+    Address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    Address.sin_port = 0;
+    if (bind(Listener, (struct sockaddr *)&Address, sizeof(Address)) != 0) {
+        goto SocketConnectLoopbackEnd;
+    }
+
+    if (listen(Listener, 1) != 0) {
+        goto SocketConnectLoopbackEnd;
+    }
+
+    AddressLength = sizeof(Address);
+    if (getsockname(Listener,
+                    (struct sockaddr *)&Address,
+                    &AddressLength) != 0) {
+
+        goto SocketConnectLoopbackEnd;
+    }
+
+    //
+    // The connection completes against the listen backlog, so it can be
+    // accepted afterwards from the same thread.
+    //
+
+    *Client = socket(AF_INET, SOCK_STREAM, 0);
+    if (*Client < 0) {
+        goto SocketConnectLoopbackEnd;
+    }
+
+    if (connect(*Client, (struct sockaddr *)&Address, sizeof(Address)) != 0) {
+        goto SocketConnectLoopbackEnd;
+    }
+
+    do {
+        *Server = accept(Listener, NULL, NULL);
+
+    } while ((*Server < 0) && (errno == EINTR));
+
+    if (*Server < 0) {
+        goto SocketConnectLoopbackEnd;
+    }
+
+    Option = 1;
+    if ((setsockopt(*Client,
+                    IPPROTO_TCP,
+                    TCP_NODELAY,
+                    &Option,
+                    sizeof(Option)) != 0) ||
+        (setsockopt(*Server,
+                    IPPROTO_TCP,
+                    TCP_NODELAY,
+                    &Option,
+                    sizeof(Option)) != 0)) {
+
+        goto SocketConnectLoopbackEnd;
+    }
+
+    Status = 0;
+
+SocketConnectLoopbackEnd:
+    if (Listener >= 0) {
+        close(Listener);
+    }
+
+    if (Status != 0) {
+        if (*Client >= 0) {
+            close(*Client);
+            *Client = -1;
+        }
+
+        if (*Server >= 0) {
+            close(*Server);
+            *Server = -1;
+        }
+    }
+
+    return Status;
+}
+
+int
+PtpSocketTransfer (
+    int Source,
+    int Destination,
+    char *Buffer,
+    size_t Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sends a message out of one socket and reads all of it back
+    in from the other.
+
+Arguments:
+
+    Source - Supplies the socket to send the message on.
+
+    Destination - Supplies the socket to receive the message from.
+
+    Buffer - Supplies a pointer to the message buffer.
+
+    Size - Supplies the size of the message, in bytes.
+
+Return Value:
+
+    0 on success.
+
+    -1 on error, and the errno variable will contain more information.
+
+--*/
+
+{
+
+    ssize_t BytesCompleted;
+    size_t TotalBytes;
+
+    do {
+        BytesCompleted = send(Source, Buffer, Size, 0);
+
+    } while ((BytesCompleted < 0) && (errno == EINTR));
+
+    if (BytesCompleted != Size) {
+        if (BytesCompleted >= 0) {
+            errno = EIO;
+        }
+
+        return -1;
+    }
+
+    //
+    // Stream sockets can hand back the message in pieces.
+    //
+
+    TotalBytes = 0;
+    while (TotalBytes != Size) {
+        do {
+            BytesCompleted = recv(Destination,
+                                  Buffer + TotalBytes,
+                                  Size - TotalBytes,
+                                  0);
+
+        } while ((BytesCompleted < 0) && (errno == EINTR));
+
+        if (BytesCompleted <= 0) {
+            if (BytesCompleted == 0) {
+                errno = EPIPE;
+            }
+
+            return -1;
+        }
+
+        TotalBytes += BytesCompleted;
+    }
+
+    return 0;
+}
+
@@ -0,0 +1,186 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    spawn.c
+
+Abstract:
+
+    This module implements the performance benchmark tests for the vfork()
+    and posix_spawn() C library calls.
+
+Author:
+
+    agent 19-Oct-2026
+
+Environment:
+
+    User
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <assert.h>
+#include <errno.h>
+#include <spawn.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "perftest.h"
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+void
+SpawnMain (
+    PPT_TEST_INFORMATION Test,
+    PPT_TEST_RESULT Result
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs the vfork and spawn performance benchmark tests.
+
+Arguments:
+
+    Test - Supplies a pointer to the performance test being executed.
+
+    Result - Supplies a pointer to a performance test result structure that
+        receives the tests results.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    char *Arguments[SPAWN_CHILD_ARGUMENT_COUNT + 1];
+    pid_t Child;
+    unsigned long long Iterations;
+    int Status;
+
+    Iterations = 0;
+    Result->Type = PtResultIterations;
+    Result->Status = 0;
+    if ((Test->TestType != PtTestVfork) && (Test->TestType != PtTestSpawn)) {
+
+        assert(0);
+
+        Result->Status = EINVAL;
+        return;
+    }
+
+    //
+    // The spawned child is this application, which exits as soon as it sees
+    // the spawn test name as its only argument.
+    //
+
+    Arguments[0] = PtProgramPath;
+    Arguments[1] = SPAWN_TEST_NAME;
+    Arguments[SPAWN_CHILD_ARGUMENT_COUNT] = NULL;
+
+    //
+    // Start the test. This snaps resource usage and starts the clock ticking.
+    //
+
+    Status = PtStartTimedTest(Test->Duration);
+    if (Status != 0) {
+        Result->Status = errno;
+        goto MainEnd;
+    }
+
+    //
+    // Count the number of children that can be created and waited on during
+    // the given duration. The vfork children exit immediately, and the
+    // spawned children execute a new image that exits immediately.
+    //
+
+    while (PtContinueTimedTest() != 0) {
+        if (Test->TestType == PtTestVfork) {
+            Child = vfork();
+            if (Child < 0) {
+                Result->Status = errno;
+                break;
+
+            } else if (Child == 0) {
+                _exit(0);
+            }
+
+        } else {
+            Status = posix_spawn(&Child,
+                                 PtProgramPath,
+                                 NULL,
+                                 NULL,
+                                 Arguments,
+                                 environ);
+
+            if (Status != 0) {
+                Result->Status = Status;
+                break;
+            }
+        }
+
+        Child = waitpid(Child, &Status, 0);
+        if (Child == -1) {
+            if (PtIsTimedTestRunning() == 0) {
+                break;
+            }
+
+            Result->Status = errno;
+            break;
+        }
+
+        if (Status != 0) {
+            Result->Status = WEXITSTATUS(Status);
+            break;
+        }
+
+        Iterations += 1;
+    }
+
+    Status = PtFinishTimedTest(Result);
+    if ((Status != 0) && (Result->Status == 0)) {
+        Result->Status = errno;
+    }
+
+MainEnd:
+    Result->Data.Iterations = Iterations;
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
@@ -140,7 +140,7 @@ Return Value:
     // number of times the stats for the created file can be queried.
     //
 
-    while (PtIsTimedTestRunning() != 0) {
+    while (PtContinueTimedTest() != 0) {
         Status = stat(FileName, &Stat);
         if (Status != 0) {
             Result->Status = errno;
@@ -242,7 +242,7 @@ Return Value:
     // number of times stats can be retrieved for a file descriptor.
     //
 
-    while (PtIsTimedTestRunning() != 0) {
+    while (PtContinueTimedTest() != 0) {
         Status = fstat(FileDescriptor, &Stat);
         if (Status != 0) {
             Result->Status = errno;
@@ -197,7 +197,7 @@ Return Value:
     //
 
     Index = 0;
-    while (PtIsTimedTestRunning() != 0) {
+    while (PtContinueTimedTest() != 0) {
         do {
             BytesWritten = write(FileDescriptor,
                                  Buffer,
@@ -35,15 +35,25 @@ Module Name:
 #include <arpa/inet.h>
 #include <errno.h>
 #include <netinet/in.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
 #include <unistd.h>
 
 //
 // ---------------------------------------------------------------- Definitions
 //
 
+#define SOCKTEST_BATCH_COUNT 4
+#define SOCKTEST_BATCH_MESSAGE_SIZE 32
+#define SOCKTEST_DRAIN_ROUND_COUNT 100
+#define SOCKTEST_DRAIN_TIMEOUT 30
+#define SOCKTEST_LISTEN_PATH "socktest.sock"
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -58,6 +68,26 @@ TestTransmitThroughput (
     ULONG ChunkCount
     );
 
+ULONG
+TestBatchedMessages (
+    VOID
+    );
+
+ULONG
+TestBatchedAccept (
+    VOID
+    );
+
+ULONG
+TestBatchedAcceptDrain (
+    VOID
+    );
+
+PVOID
+TestAcceptThread (
+    PVOID Parameter
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -95,7 +125,13 @@ Return Value:
 
 {
 
-    return TestTransmitThroughput(64 * 1024, 16);
+    ULONG Failures;
+
+    Failures = TestBatchedMessages();
+    Failures += TestBatchedAccept();
+    Failures += TestBatchedAcceptDrain();
+    Failures += TestTransmitThroughput(64 * 1024, 16);
+    return Failures;
 }
 
 //
@@ -233,3 +269,464 @@ Return Value:
     return Errors;
 }
 
+ULONG
+TestBatchedMessages (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine tests sending and receiving several datagrams at once with
+    sendmmsg and recvmmsg.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the number of failures that occurred in the test.
+
+--*/
+
+{
+
+    CHAR Buffers[SOCKTEST_BATCH_COUNT][SOCKTEST_BATCH_MESSAGE_SIZE];
+    ULONG Errors;
+    ULONG Index;
+    struct mmsghdr Messages[SOCKTEST_BATCH_COUNT];
+    int Result;
+    int Sockets[2];
+    struct timespec Timeout;
+    struct iovec Vectors[SOCKTEST_BATCH_COUNT];
+
+    Errors = 0;
+    Sockets[0] = -1;
+    Sockets[1] = -1;
+    if (socketpair(AF_UNIX, SOCK_DGRAM, 0, Sockets) != 0) {
+        printf("socketpair() failed. Errno = %d.\n", errno);
+        Errors += 1;
+        goto TestBatchedMessagesEnd;
+    }
+
+    //
+    // Send a handful of differently sized datagrams in one call.
+    //
+
+    memset(Messages, 0, sizeof(Messages));
+    for (Index = 0; Index < SOCKTEST_BATCH_COUNT; Index += 1) {
+        memset(Buffers[Index], 'a' + Index, SOCKTEST_BATCH_MESSAGE_SIZE);
+        Vectors[Index].iov_base = Buffers[Index];
+        Vectors[Index].iov_len = Index + 1;
+        Messages[Index].msg_hdr.msg_iov = &(Vectors[Index]);
+        Messages[Index].msg_hdr.msg_iovlen = 1;
+    }
+
+    Result = sendmmsg(Sockets[0], Messages, SOCKTEST_BATCH_COUNT, 0);
+    if (Result != SOCKTEST_BATCH_COUNT) {
+        printf("sendmmsg returned %d, errno %d.\n", Result, errno);
+        Errors += 1;
+        goto TestBatchedMessagesEnd;
+    }
+
+    for (Index = 0; Index < SOCKTEST_BATCH_COUNT; Index += 1) {
+        if (Messages[Index].msg_len != Index + 1) {
+            printf("sendmmsg message %d sent %d bytes.\n",
+                   Index,
+                   Messages[Index].msg_len);
+
+            Errors += 1;
+        }
+    }
+
+    //
+    // Receive them all back, asking for one more than was sent. With
+    // MSG_WAITFORONE the call should return with the four available.
+    //
+
+    memset(Buffers, 0, sizeof(Buffers));
+    for (Index = 0; Index < SOCKTEST_BATCH_COUNT; Index += 1) {
+        Vectors[Index].iov_len = SOCKTEST_BATCH_MESSAGE_SIZE;
+        Messages[Index].msg_len = 0;
+    }
+
+    Result = recvmmsg(Sockets[1],
+                      Messages,
+                      SOCKTEST_BATCH_COUNT,
+                      MSG_WAITFORONE,
+                      NULL);
+
+    if (Result != SOCKTEST_BATCH_COUNT) {
+        printf("recvmmsg returned %d, errno %d.\n", Result, errno);
+        Errors += 1;
+        goto TestBatchedMessagesEnd;
+    }
+
+    for (Index = 0; Index < SOCKTEST_BATCH_COUNT; Index += 1) {
+        if ((Messages[Index].msg_len != Index + 1) ||
+            (Buffers[Index][0] != 'a' + Index) ||
+            (Buffers[Index][Index + 1] != 0)) {
+
+            printf("recvmmsg message %d got %d bytes, '%c'.\n",
+                   Index,
+                   Messages[Index].msg_len,
+                   Buffers[Index][0]);
+
+            Errors += 1;
+        }
+    }
+
+    //
+    // With nothing queued, a timed receive should give up.
+    //
+
+    Timeout.tv_sec = 0;
+    Timeout.tv_nsec = 50 * 1000 * 1000;
+    Result = recvmmsg(Sockets[1], Messages, 2, 0, &Timeout);
+    if ((Result != -1) || ((errno != EAGAIN) && (errno != ETIMEDOUT))) {
+        printf("Timed recvmmsg returned %d, errno %d.\n", Result, errno);
+        Errors += 1;
+    }
+
+TestBatchedMessagesEnd:
+    if (Sockets[0] >= 0) {
+        close(Sockets[0]);
+    }
+
+    if (Sockets[1] >= 0) {
+        close(Sockets[1]);
+    }
+
+    printf("TestBatchedMessages done. %d errors found.\n", Errors);
+    return Errors;
+}
+
+ULONG
+TestBatchedAccept (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine tests accepting several pending connections at once.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the number of failures that occurred in the test.
+
+--*/
+
+{
+
+    struct sockaddr_un Address;
+    int Clients[SOCKTEST_BATCH_COUNT];
+    struct acceptent Entries[SOCKTEST_BATCH_COUNT + 1];
+    ULONG Errors;
+    ULONG Index;
+    int Listener;
+    int Result;
+
+    Errors = 0;
+    for (Index = 0; Index < SOCKTEST_BATCH_COUNT; Index += 1) {
+        Clients[Index] = -1;
+    }
+
+    memset(Entries, 0, sizeof(Entries));
+    unlink(SOCKTEST_LISTEN_PATH);
+    memset(&Address, 0, sizeof(Address));
+    Address.sun_family = AF_UNIX;
+    strcpy(Address.sun_path, SOCKTEST_LISTEN_PATH);
+    Listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (Listener < 0) {
+        printf("socket() failed. Errno = %d.\n", errno);
+        Errors += 1;
+        goto TestBatchedAcceptEnd;
+    }
+
+    if ((bind(Listener, (struct sockaddr *)&Address, sizeof(Address)) != 0) ||
+        (listen(Listener, SOCKTEST_BATCH_COUNT) != 0)) {
+
+        printf("Failed to set up listener. Errno = %d.\n", errno);
+        Errors += 1;
+        goto TestBatchedAcceptEnd;
+    }
+
+    for (Index = 0; Index < SOCKTEST_BATCH_COUNT; Index += 1) {
+        Clients[Index] = socket(AF_UNIX, SOCK_STREAM, 0);
+        if ((Clients[Index] < 0) ||
+            (connect(Clients[Index],
+                     (struct sockaddr *)&Address,
+                     sizeof(Address)) != 0)) {
+
+            printf("Failed to connect client %d. Errno = %d.\n", Index, errno);
+            Errors += 1;
+            goto TestBatchedAcceptEnd;
+        }
+    }
+
+    //
+    // Ask for more connections than are pending. The call should not block
+    // waiting for the extra one.
+    //
+
+    Result = acceptmany(Listener,
+                        Entries,
+                        SOCKTEST_BATCH_COUNT + 1,
+                        SOCK_CLOEXEC);
+
+    if (Result != SOCKTEST_BATCH_COUNT) {
+        printf("acceptmany returned %d, errno %d.\n", Result, errno);
+        Errors += 1;
+    }
+
+    while (Result > 0) {
+        Result -= 1;
+        if (Entries[Result].ae_fd < 0) {
+            printf("acceptmany entry %d has fd %d.\n",
+                   Result,
+                   Entries[Result].ae_fd);
+
+            Errors += 1;
+
+        } else {
+            close(Entries[Result].ae_fd);
+        }
+    }
+
+TestBatchedAcceptEnd:
+    for (Index = 0; Index < SOCKTEST_BATCH_COUNT; Index += 1) {
+        if (Clients[Index] >= 0) {
+            close(Clients[Index]);
+        }
+    }
+
+    if (Listener >= 0) {
+        close(Listener);
+    }
+
+    unlink(SOCKTEST_LISTEN_PATH);
+    printf("TestBatchedAccept done. %d errors found.\n", Errors);
+    return Errors;
+}
+
+ULONG
+TestBatchedAcceptDrain (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine tests accepting several connections at once while another
+    thread drains the same backlog. Only the first accept of a batch may
+    wait, so the batch has to come back with what it has once the backlog
+    runs dry rather than blocking. A hang here is caught by the alarm.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the number of failures that occurred in the test.
+
+--*/
+
+{
+
+    struct sockaddr_un Address;
+    int BatchCount;
+    ULONG ClientCount;
+    int Clients[SOCKTEST_BATCH_COUNT + 1];
+    struct acceptent Entries[SOCKTEST_BATCH_COUNT + 1];
+    ULONG Errors;
+    ULONG Index;
+    int Listener;
+    int Result;
+    ULONG Round;
+    pthread_t Thread;
+    int ThreadResult;
+    PVOID ThreadReturn;
+
+    Errors = 0;
+    ClientCount = 0;
+    unlink(SOCKTEST_LISTEN_PATH);
+    memset(&Address, 0, sizeof(Address));
+    Address.sun_family = AF_UNIX;
+    strcpy(Address.sun_path, SOCKTEST_LISTEN_PATH);
+    Listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (Listener < 0) {
+        printf("socket() failed. Errno = %d.\n", errno);
+        Errors += 1;
+        goto TestBatchedAcceptDrainEnd;
+    }
+
+    if ((bind(Listener, (struct sockaddr *)&Address, sizeof(Address)) != 0) ||
+        (listen(Listener, SOCKTEST_BATCH_COUNT + 1) != 0)) {
+
+        printf("Failed to set up listener. Errno = %d.\n", errno);
+        Errors += 1;
+        goto TestBatchedAcceptDrainEnd;
+    }
+
+    alarm(SOCKTEST_DRAIN_TIMEOUT);
+    for (Round = 0; Round < SOCKTEST_DRAIN_ROUND_COUNT; Round += 1) {
+        memset(Entries, 0, sizeof(Entries));
+        for (Index = 0; Index < SOCKTEST_BATCH_COUNT; Index += 1) {
+            Clients[ClientCount] = socket(AF_UNIX, SOCK_STREAM, 0);
+            if ((Clients[ClientCount] < 0) ||
+                (connect(Clients[ClientCount],
+                         (struct sockaddr *)&Address,
+                         sizeof(Address)) != 0)) {
+
+                printf("Failed to connect client %d. Errno = %d.\n",
+                       Index,
+                       errno);
+
+                Errors += 1;
+                goto TestBatchedAcceptDrainEnd;
+            }
+
+            ClientCount += 1;
+        }
+
+        //
+        // Race another thread for the backlog. It takes exactly one
+        // connection, possibly in the middle of the batch.
+        //
+
+        Result = pthread_create(&Thread,
+                                NULL,
+                                TestAcceptThread,
+                                (PVOID)(UINTN)Listener);
+
+        if (Result != 0) {
+            printf("pthread_create failed: %d.\n", Result);
+            Errors += 1;
+            goto TestBatchedAcceptDrainEnd;
+        }
+
+        BatchCount = acceptmany(Listener,
+                                Entries,
+                                SOCKTEST_BATCH_COUNT + 1,
+                                SOCK_CLOEXEC);
+
+        if (BatchCount <= 0) {
+            printf("acceptmany returned %d, errno %d.\n", BatchCount, errno);
+            Errors += 1;
+            BatchCount = 0;
+        }
+
+        //
+        // If the batch got everything, the other thread is still waiting.
+        // Give it a connection of its own.
+        //
+
+        if (BatchCount == ClientCount) {
+            Clients[ClientCount] = socket(AF_UNIX, SOCK_STREAM, 0);
+            if ((Clients[ClientCount] < 0) ||
+                (connect(Clients[ClientCount],
+                         (struct sockaddr *)&Address,
+                         sizeof(Address)) != 0)) {
+
+                printf("Failed to connect extra client. Errno = %d.\n",
+                       errno);
+
+                Errors += 1;
+                goto TestBatchedAcceptDrainEnd;
+            }
+
+            ClientCount += 1;
+        }
+
+        pthread_join(Thread, &ThreadReturn);
+        Result = BatchCount;
+        ThreadResult = (int)(UINTN)ThreadReturn;
+        if (ThreadResult < 0) {
+            printf("Accept thread failed.\n");
+            Errors += 1;
+
+        } else {
+            close(ThreadResult);
+            Result += 1;
+        }
+
+        if (Result != ClientCount) {
+            printf("Round %d: accepted %d of %d connections.\n",
+                   Round,
+                   Result,
+                   ClientCount);
+
+            Errors += 1;
+        }
+
+        while (BatchCount > 0) {
+            BatchCount -= 1;
+            close(Entries[BatchCount].ae_fd);
+        }
+
+        while (ClientCount != 0) {
+            ClientCount -= 1;
+            close(Clients[ClientCount]);
+        }
+
+        if (Errors != 0) {
+            break;
+        }
+    }
+
+TestBatchedAcceptDrainEnd:
+    alarm(0);
+    while (ClientCount != 0) {
+        ClientCount -= 1;
+        if (Clients[ClientCount] >= 0) {
+            close(Clients[ClientCount]);
+        }
+    }
+
+    if (Listener >= 0) {
+        close(Listener);
+    }
+
+    unlink(SOCKTEST_LISTEN_PATH);
+    printf("TestBatchedAcceptDrain done. %d errors found.\n", Errors);
+    return Errors;
+}
+
+PVOID
+TestAcceptThread (
+    PVOID Parameter
+    )
+
+/*++
+
+Routine Description:
+
+    This routine accepts a single connection on the given listening socket.
+
+Arguments:
+
+    Parameter - Supplies the listening socket file descriptor.
+
+Return Value:
+
+    Returns the accepted file descriptor, or -1 on failure.
+
+--*/
+
+{
+
+    int Listener;
+
+    Listener = (int)(UINTN)Parameter;
+    return (PVOID)(INTN)accept(Listener, NULL, NULL);
+}
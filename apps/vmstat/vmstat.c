@@ -218,6 +218,7 @@ Return Value:
     IO_CACHE_STATISTICS IoCache;
     ULONGLONG Megabytes;
     MM_STATISTICS MmStatistics;
+    ULONGLONG Ratio;
     INT ReturnValue;
     UINTN Size;
     KSTATUS Status;
@@ -280,6 +281,22 @@ Return Value:
     printf("    Failed Allocations: %ld\n",
            MmStatistics.PagedPool.FailedAllocations);
 
+    printf("Compressed Swap:\n");
+    printf("    Pages: %ld\n", MmStatistics.CompressedSwapPages);
+    printf("    Used: %ldKB (limit %ldKB)\n",
+           MmStatistics.CompressedSwapUsed / _1KB,
+           MmStatistics.CompressedSwapLimit / _1KB);
+
+    if (MmStatistics.CompressedSwapSize != 0) {
+        Ratio = (ULONGLONG)MmStatistics.CompressedSwapPages *
+                MmStatistics.PageSize * 100 /
+                MmStatistics.CompressedSwapSize;
+
+        printf("    Compression Ratio: %I64d.%02I64d\n",
+               Ratio / 100,
+               Ratio % 100);
+    }
+
     Size = sizeof(IO_CACHE_STATISTICS);
     IoCache.Version = IO_CACHE_STATISTICS_VERSION;
     Status = OsGetSetSystemInformation(SystemInformationIo,
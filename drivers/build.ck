@@ -50,6 +50,7 @@ function build() {
         "drivers/sound:sound_drivers",
         "drivers/special:special",
         "drivers/term/ser16550:ser16550",
+        "drivers/tmpfs:tmpfs",
         "drivers/usb:usb_drivers",
         "drivers/videocon:videocon"
     ];
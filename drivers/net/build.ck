@@ -61,6 +61,10 @@ function build() {
     }
 
     netDrivers = ethernetDrivers + wirelessDrivers;
+    netDrivers += [
+        "drivers/net/loopback:loopback"
+    ];
+
     entries = group("net_drivers", netDrivers);
     return entries;
 }
@@ -0,0 +1,54 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    Loopback
+
+Abstract:
+
+    This module implements the loopback network device, which hands every
+    packet sent on it straight back to the networking core.
+
+Author:
+
+    agent 19-Oct-2026
+
+Environment:
+
+    Kernel
+
+--*/
+
+from menv import driver;
+
+function build() {
+    var drv;
+    var dynlibs;
+    var entries;
+    var name = "loopback";
+    var sources;
+
+    sources = [
+        "loopback.c"
+    ];
+
+    dynlibs = [
+        "drivers/net/netcore:netcore"
+    ];
+
+    drv = {
+        "label": name,
+        "inputs": sources + dynlibs,
+    };
+
+    entries = driver(drv);
+    return entries;
+}
+
@@ -0,0 +1,965 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    loopback.c
+
+Abstract:
+
+    This module implements the loopback network device. Packets sent down the
+    loopback link are handed straight back to the networking core as received
+    packets. The packet buffers themselves are passed back up, so no data is
+    ever copied.
+
+Author:
+
+    agent 19-Oct-2026
+
+Environment:
+
+    Kernel
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <minoca/kernel/driver.h>
+#include <minoca/net/netdrv.h>
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+#define LOOPBACK_ALLOCATION_TAG 0x706F6F4C // 'pooL'
+
+//
+// Define the maximum number of packets that can be waiting to be handed back
+// up the stack before the loopback device starts dropping them.
+//
+
+#define LOOPBACK_MAX_PENDING_PACKET_COUNT 1024
+
+//
+// Define the capabilities of the loopback link. Checksums are never computed
+// on the way down nor checked on the way up, since the data never leaves
+// memory.
+//
+
+#define LOOPBACK_CAPABILITIES                  \
+    (NET_LINK_CAPABILITY_CHECKSUM_MASK |       \
+     NET_LINK_CAPABILITY_PROMISCUOUS_MODE |    \
+     NET_LINK_CAPABILITY_MULTICAST_ALL)
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+/*++
+
+Structure Description:
+
+    This structure defines a loopback device.
+
+Members:
+
+    OsDevice - Stores a pointer to the OS device object.
+
+    NetworkLink - Stores a pointer to the core networking link.
+
+    Lock - Stores a pointer to the lock protecting the pending packet list and
+        the link state.
+
+    PendingPacketList - Stores the list of packets that have been sent but not
+        yet handed back up the stack.
+
+    WorkItem - Stores a pointer to the work item that hands pending packets
+        back up the stack.
+
+    LinkActive - Stores a boolean indicating whether the link is up.
+
+    EnabledCapabilities - Stores the bitmask of capabilities currently
+        enabled. See NET_LINK_CAPABILITY_* for definitions.
+
+--*/
+
+typedef struct _LOOPBACK_DEVICE {
+    PDEVICE OsDevice;
+    PNET_LINK NetworkLink;
+    PQUEUED_LOCK Lock;
+    NET_PACKET_LIST PendingPacketList;
+    PWORK_ITEM WorkItem;
+    BOOL LinkActive;
+    ULONG EnabledCapabilities;
+} LOOPBACK_DEVICE, *PLOOPBACK_DEVICE;
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+KSTATUS
+LoopbackAddDevice (
+    PVOID Driver,
+    PCSTR DeviceId,
+    PCSTR ClassId,
+    PCSTR CompatibleIds,
+    PVOID DeviceToken
+    );
+
+VOID
+LoopbackDispatchStateChange (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    );
+
+VOID
+LoopbackDispatchOpen (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    );
+
+VOID
+LoopbackDispatchClose (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    );
+
+VOID
+LoopbackDispatchIo (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    );
+
+VOID
+LoopbackDispatchSystemControl (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    );
+
+KSTATUS
+LoopbackSend (
+    PVOID DeviceContext,
+    PNET_PACKET_LIST PacketList
+    );
+
+KSTATUS
+LoopbackGetSetInformation (
+    PVOID DeviceContext,
+    NET_LINK_INFORMATION_TYPE InformationType,
+    PVOID Data,
+    PUINTN DataSize,
+    BOOL Set
+    );
+
+VOID
+LoopbackDestroyLink (
+    PVOID DeviceContext
+    );
+
+KSTATUS
+LoopbackpStartDevice (
+    PLOOPBACK_DEVICE Device
+    );
+
+VOID
+LoopbackpStopDevice (
+    PLOOPBACK_DEVICE Device
+    );
+
+VOID
+LoopbackpReceivePackets (
+    PVOID Parameter
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+PDRIVER LoopbackDriver = NULL;
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+__USED
+KSTATUS
+DriverEntry (
+    PDRIVER Driver
+    )
+
+/*++
+
+Routine Description:
+
+    This routine is the entry point for the loopback driver. It registers its
+    other dispatch functions, and performs driver-wide initialization.
+
+Arguments:
+
+    Driver - Supplies a pointer to the driver object.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    Failure code on error.
+
+--*/
+
+{
+
+    DRIVER_FUNCTION_TABLE FunctionTable;
+    KSTATUS Status;
+
+    LoopbackDriver = Driver;
+    RtlZeroMemory(&FunctionTable, sizeof(DRIVER_FUNCTION_TABLE));
+    FunctionTable.Version = DRIVER_FUNCTION_TABLE_VERSION;
+    FunctionTable.AddDevice = LoopbackAddDevice;
+    FunctionTable.DispatchStateChange = LoopbackDispatchStateChange;
+    FunctionTable.DispatchOpen = LoopbackDispatchOpen;
+    FunctionTable.DispatchClose = LoopbackDispatchClose;
+    FunctionTable.DispatchIo = LoopbackDispatchIo;
+    FunctionTable.DispatchSystemControl = LoopbackDispatchSystemControl;
+    Status = IoRegisterDriverFunctions(Driver, &FunctionTable);
+    return Status;
+}
+
+KSTATUS
+LoopbackAddDevice (
+    PVOID Driver,
+    PCSTR DeviceId,
+    PCSTR ClassId,
+    PCSTR CompatibleIds,
+    PVOID DeviceToken
+    )
+
+/*++
+
+Routine Description:
+
+    This routine is called when a device is detected for which the loopback
+    driver acts as the function driver. The driver will attach itself to the
+    stack.
+
+Arguments:
+
+    Driver - Supplies a pointer to the driver being called.
+
+    DeviceId - Supplies a pointer to a string with the device ID.
+
+    ClassId - Supplies a pointer to a string containing the device's class ID.
+
+    CompatibleIds - Supplies a pointer to a string containing device IDs
+        that would be compatible with this device.
+
+    DeviceToken - Supplies an opaque token that the driver can use to identify
+        the device in the system. This token should be used when attaching to
+        the stack.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    Failure code if the driver was unsuccessful in attaching itself.
+
+--*/
+
+{
+
+    PLOOPBACK_DEVICE Device;
+    KSTATUS Status;
+
+    Device = MmAllocateNonPagedPool(sizeof(LOOPBACK_DEVICE),
+                                    LOOPBACK_ALLOCATION_TAG);
+
+    if (Device == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto AddDeviceEnd;
+    }
+
+    RtlZeroMemory(Device, sizeof(LOOPBACK_DEVICE));
+    Device->OsDevice = DeviceToken;
+    NET_INITIALIZE_PACKET_LIST(&(Device->PendingPacketList));
+    Device->Lock = KeCreateQueuedLock();
+    if (Device->Lock == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto AddDeviceEnd;
+    }
+
+    Device->WorkItem = KeCreateWorkItem(NULL,
+                                        WorkPriorityNormal,
+                                        LoopbackpReceivePackets,
+                                        Device,
+                                        LOOPBACK_ALLOCATION_TAG);
+
+    if (Device->WorkItem == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto AddDeviceEnd;
+    }
+
+    Status = IoAttachDriverToDevice(Driver, DeviceToken, Device);
+    if (!KSUCCESS(Status)) {
+        goto AddDeviceEnd;
+    }
+
+AddDeviceEnd:
+    if (!KSUCCESS(Status)) {
+        if (Device != NULL) {
+            LoopbackDestroyLink(Device);
+            Device = NULL;
+        }
+    }
+
+    return Status;
+}
+
+VOID
+LoopbackDispatchStateChange (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    )
+
+/*++
+
+Routine Description:
+
+    This routine handles State Change IRPs.
+
+Arguments:
+
+    Irp - Supplies a pointer to the I/O request packet.
+
+    DeviceContext - Supplies the context pointer supplied by the driver when it
+        attached itself to the driver stack. Presumably this pointer contains
+        driver-specific device context.
+
+    IrpContext - Supplies the context pointer supplied by the driver when
+        the IRP was created.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    KSTATUS Status;
+
+    ASSERT(Irp->MajorCode == IrpMajorStateChange);
+
+    //
+    // The loopback device is unenumerable and has no bus driver below it, so
+    // it completes every state change IRP itself.
+    //
+
+    if (Irp->Direction == IrpUp) {
+        switch (Irp->MinorCode) {
+        case IrpMinorQueryResources:
+        case IrpMinorQueryChildren:
+            IoCompleteIrp(LoopbackDriver, Irp, STATUS_SUCCESS);
+            break;
+
+        case IrpMinorStartDevice:
+            Status = LoopbackpStartDevice(DeviceContext);
+            IoCompleteIrp(LoopbackDriver, Irp, Status);
+            break;
+
+        case IrpMinorRemoveDevice:
+            LoopbackpStopDevice(DeviceContext);
+            IoCompleteIrp(LoopbackDriver, Irp, STATUS_SUCCESS);
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    return;
+}
+
+VOID
+LoopbackDispatchOpen (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    )
+
+/*++
+
+Routine Description:
+
+    This routine handles Open IRPs.
+
+Arguments:
+
+    Irp - Supplies a pointer to the I/O request packet.
+
+    DeviceContext - Supplies the context pointer supplied by the driver when it
+        attached itself to the driver stack. Presumably this pointer contains
+        driver-specific device context.
+
+    IrpContext - Supplies the context pointer supplied by the driver when
+        the IRP was created.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    return;
+}
+
+VOID
+LoopbackDispatchClose (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    )
+
+/*++
+
+Routine Description:
+
+    This routine handles Close IRPs.
+
+Arguments:
+
+    Irp - Supplies a pointer to the I/O request packet.
+
+    DeviceContext - Supplies the context pointer supplied by the driver when it
+        attached itself to the driver stack. Presumably this pointer contains
+        driver-specific device context.
+
+    IrpContext - Supplies the context pointer supplied by the driver when
+        the IRP was created.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    return;
+}
+
+VOID
+LoopbackDispatchIo (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    )
+
+/*++
+
+Routine Description:
+
+    This routine handles I/O IRPs.
+
+Arguments:
+
+    Irp - Supplies a pointer to the I/O request packet.
+
+    DeviceContext - Supplies the context pointer supplied by the driver when it
+        attached itself to the driver stack. Presumably this pointer contains
+        driver-specific device context.
+
+    IrpContext - Supplies the context pointer supplied by the driver when
+        the IRP was created.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    return;
+}
+
+VOID
+LoopbackDispatchSystemControl (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    )
+
+/*++
+
+Routine Description:
+
+    This routine handles System Control IRPs.
+
+Arguments:
+
+    Irp - Supplies a pointer to the I/O request packet.
+
+    DeviceContext - Supplies the context pointer supplied by the driver when it
+        attached itself to the driver stack. Presumably this pointer contains
+        driver-specific device context.
+
+    IrpContext - Supplies the context pointer supplied by the driver when
+        the IRP was created.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PLOOPBACK_DEVICE Device;
+    PSYSTEM_CONTROL_DEVICE_INFORMATION DeviceInformationRequest;
+    KSTATUS Status;
+
+    ASSERT(Irp->MajorCode == IrpMajorSystemControl);
+
+    Device = DeviceContext;
+    if (Irp->Direction == IrpDown) {
+        switch (Irp->MinorCode) {
+        case IrpMinorSystemControlDeviceInformation:
+            DeviceInformationRequest = Irp->U.SystemControl.SystemContext;
+            Status = NetGetSetLinkDeviceInformation(
+                                         Device->NetworkLink,
+                                         &(DeviceInformationRequest->Uuid),
+                                         DeviceInformationRequest->Data,
+                                         &(DeviceInformationRequest->DataSize),
+                                         DeviceInformationRequest->Set);
+
+            IoCompleteIrp(LoopbackDriver, Irp, Status);
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    return;
+}
+
+KSTATUS
+LoopbackSend (
+    PVOID DeviceContext,
+    PNET_PACKET_LIST PacketList
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sends data through the network. For the loopback device,
+    this queues the packets to be handed back up the stack.
+
+Arguments:
+
+    DeviceContext - Supplies a pointer to the device context associated with
+        the link down which this data is to be sent.
+
+    PacketList - Supplies a pointer to a list of network packets to send. Data
+        in these packets may be modified by this routine, but must not be used
+        once this routine returns.
+
+Return Value:
+
+    STATUS_SUCCESS if all packets were sent.
+
+    STATUS_RESOURCE_IN_USE if some or all of the packets were dropped due to
+    too many packets already waiting to be received.
+
+    Other failure codes indicate that none of the packets were sent.
+
+--*/
+
+{
+
+    PLOOPBACK_DEVICE Device;
+    KSTATUS Status;
+
+    ASSERT(KeGetRunLevel() == RunLevelLow);
+
+    Device = (PLOOPBACK_DEVICE)DeviceContext;
+    KeAcquireQueuedLock(Device->Lock);
+    if (Device->LinkActive == FALSE) {
+        Status = STATUS_NO_NETWORK_CONNECTION;
+        goto SendEnd;
+    }
+
+    if (Device->PendingPacketList.Count >= LOOPBACK_MAX_PENDING_PACKET_COUNT) {
+        Status = STATUS_RESOURCE_IN_USE;
+        goto SendEnd;
+    }
+
+    NET_APPEND_PACKET_LIST(PacketList, &(Device->PendingPacketList));
+    Status = STATUS_SUCCESS;
+
+SendEnd:
+    KeReleaseQueuedLock(Device->Lock);
+
+    //
+    // The packets are handed back up from a work item rather than right here.
+    // The sender is often deep inside a protocol with its socket locked, and
+    // receiving on the same stack could turn right around and try to send on
+    // (or lock) that very socket.
+    //
+
+    if (KSUCCESS(Status)) {
+        KeQueueWorkItem(Device->WorkItem);
+    }
+
+    return Status;
+}
+
+KSTATUS
+LoopbackGetSetInformation (
+    PVOID DeviceContext,
+    NET_LINK_INFORMATION_TYPE InformationType,
+    PVOID Data,
+    PUINTN DataSize,
+    BOOL Set
+    )
+
+/*++
+
+Routine Description:
+
+    This routine gets or sets the network device layer's link information.
+
+Arguments:
+
+    DeviceContext - Supplies a pointer to the device context associated with
+        the link for which information is being set or queried.
+
+    InformationType - Supplies the type of information being queried or set.
+
+    Data - Supplies a pointer to the data buffer where the data is either
+        returned for a get operation or given for a set operation.
+
+    DataSize - Supplies a pointer that on input contains the size of the data
+        buffer. On output, contains the required size of the data buffer.
+
+    Set - Supplies a boolean indicating if this is a get operation (FALSE) or a
+        set operation (TRUE).
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    PULONG BooleanOption;
+    ULONG Capability;
+    PLOOPBACK_DEVICE Device;
+    PULONG Flags;
+    KSTATUS Status;
+
+    Status = STATUS_SUCCESS;
+    Device = (PLOOPBACK_DEVICE)DeviceContext;
+    switch (InformationType) {
+    case NetLinkInformationChecksumOffload:
+        if (*DataSize != sizeof(ULONG)) {
+            Status = STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        if (Set != FALSE) {
+            Status = STATUS_NOT_SUPPORTED;
+            break;
+        }
+
+        Flags = (PULONG)Data;
+        *Flags = Device->EnabledCapabilities &
+                 NET_LINK_CAPABILITY_CHECKSUM_MASK;
+
+        break;
+
+    //
+    // Every packet on the loopback link is destined for this machine anyway,
+    // so these are just recorded.
+    //
+
+    case NetLinkInformationMulticastAll:
+    case NetLinkInformationPromiscuousMode:
+        if (*DataSize != sizeof(ULONG)) {
+            Status = STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        Capability = NET_LINK_CAPABILITY_PROMISCUOUS_MODE;
+        if (InformationType == NetLinkInformationMulticastAll) {
+            Capability = NET_LINK_CAPABILITY_MULTICAST_ALL;
+        }
+
+        BooleanOption = (PULONG)Data;
+        KeAcquireQueuedLock(Device->Lock);
+        if (Set == FALSE) {
+            *BooleanOption = FALSE;
+            if ((Device->EnabledCapabilities & Capability) != 0) {
+                *BooleanOption = TRUE;
+            }
+
+        } else if (*BooleanOption != FALSE) {
+            Device->EnabledCapabilities |= Capability;
+
+        } else {
+            Device->EnabledCapabilities &= ~Capability;
+        }
+
+        KeReleaseQueuedLock(Device->Lock);
+        break;
+
+    default:
+        Status = STATUS_NOT_SUPPORTED;
+        break;
+    }
+
+    return Status;
+}
+
+VOID
+LoopbackDestroyLink (
+    PVOID DeviceContext
+    )
+
+/*++
+
+Routine Description:
+
+    This routine notifies the device layer that the networking core is in the
+    process of destroying the link and will no longer call into the device for
+    this link. This allows the device layer to release any context that was
+    supporting the device link interface.
+
+Arguments:
+
+    DeviceContext - Supplies a pointer to the device context associated with
+        the link being destroyed.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PLOOPBACK_DEVICE Device;
+
+    Device = (PLOOPBACK_DEVICE)DeviceContext;
+
+    ASSERT(NET_PACKET_LIST_EMPTY(&(Device->PendingPacketList)) != FALSE);
+
+    if (Device->WorkItem != NULL) {
+        KeDestroyWorkItem(Device->WorkItem);
+    }
+
+    if (Device->Lock != NULL) {
+        KeDestroyQueuedLock(Device->Lock);
+    }
+
+    MmFreeNonPagedPool(Device);
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+KSTATUS
+LoopbackpStartDevice (
+    PLOOPBACK_DEVICE Device
+    )
+
+/*++
+
+Routine Description:
+
+    This routine starts the loopback device, adding its link to the core
+    networking library and bringing it up.
+
+Arguments:
+
+    Device - Supplies a pointer to the loopback device.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    NET_LINK_PROPERTIES Properties;
+    KSTATUS Status;
+
+    if (Device->NetworkLink != NULL) {
+        return STATUS_SUCCESS;
+    }
+
+    //
+    // Loopback has no hardware limits, so allow packets as big as the network
+    // layers can make them. Without a wire to put them on, there is no reason
+    // to break them up any smaller.
+    //
+
+    RtlZeroMemory(&Properties, sizeof(NET_LINK_PROPERTIES));
+    Properties.Version = NET_LINK_PROPERTIES_VERSION;
+    Properties.TransmitAlignment = 1;
+    Properties.Device = Device->OsDevice;
+    Properties.DeviceContext = Device;
+    Properties.PacketSizeInformation.MaxPacketSize =
+                          LOOPBACK_HEADER_SIZE + LOOPBACK_MAXIMUM_PAYLOAD_SIZE;
+
+    Properties.Capabilities = LOOPBACK_CAPABILITIES;
+    Properties.DataLinkType = NetDomainLoopback;
+    Properties.MaxPhysicalAddress = MAX_ULONG;
+    Properties.PhysicalAddress.Domain = NetDomainLoopback;
+    Properties.Interface.Send = LoopbackSend;
+    Properties.Interface.GetSetInformation = LoopbackGetSetInformation;
+    Properties.Interface.DestroyLink = LoopbackDestroyLink;
+    Device->EnabledCapabilities = NET_LINK_CAPABILITY_CHECKSUM_MASK;
+    Status = NetAddLink(&Properties, &(Device->NetworkLink));
+    if (!KSUCCESS(Status)) {
+        Device->NetworkLink = NULL;
+        return Status;
+    }
+
+    KeAcquireQueuedLock(Device->Lock);
+    Device->LinkActive = TRUE;
+    KeReleaseQueuedLock(Device->Lock);
+    NetSetLinkState(Device->NetworkLink, TRUE, NET_SPEED_10000_MBPS);
+    return STATUS_SUCCESS;
+}
+
+VOID
+LoopbackpStopDevice (
+    PLOOPBACK_DEVICE Device
+    )
+
+/*++
+
+Routine Description:
+
+    This routine stops the loopback device, removing its link from the core
+    networking library. The device context is released when the networking
+    core destroys the link.
+
+Arguments:
+
+    Device - Supplies a pointer to the loopback device.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PNET_LINK Link;
+
+    Link = Device->NetworkLink;
+    if (Link == NULL) {
+        LoopbackDestroyLink(Device);
+        return;
+    }
+
+    KeAcquireQueuedLock(Device->Lock);
+    Device->LinkActive = FALSE;
+    KeReleaseQueuedLock(Device->Lock);
+
+    //
+    // Let any packets already sent drain out before the link goes away. The
+    // work item drops them now that the link is inactive.
+    //
+
+    KeFlushWorkItem(Device->WorkItem);
+    LoopbackpReceivePackets(Device);
+    NetRemoveLink(Link);
+    return;
+}
+
+VOID
+LoopbackpReceivePackets (
+    PVOID Parameter
+    )
+
+/*++
+
+Routine Description:
+
+    This routine hands the packets sent down the loopback link back up the
+    stack as received packets.
+
+Arguments:
+
+    Parameter - Supplies a pointer to the loopback device.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PLOOPBACK_DEVICE Device;
+    BOOL LinkActive;
+    PNET_PACKET_BUFFER Packet;
+    NET_PACKET_LIST PacketList;
+
+    Device = (PLOOPBACK_DEVICE)Parameter;
+    NET_INITIALIZE_PACKET_LIST(&PacketList);
+    while (TRUE) {
+        KeAcquireQueuedLock(Device->Lock);
+        LinkActive = Device->LinkActive;
+        NET_APPEND_PACKET_LIST(&(Device->PendingPacketList), &PacketList);
+        KeReleaseQueuedLock(Device->Lock);
+        if (NET_PACKET_LIST_EMPTY(&PacketList) != FALSE) {
+            break;
+        }
+
+        //
+        // Each packet goes back up in the same buffer it came down in, and is
+        // released once the stack is done with it.
+        //
+
+        while (NET_PACKET_LIST_EMPTY(&PacketList) == FALSE) {
+            Packet = LIST_VALUE(PacketList.Head.Next,
+                                NET_PACKET_BUFFER,
+                                ListEntry);
+
+            NET_REMOVE_PACKET_FROM_LIST(Packet, &PacketList);
+            if (LinkActive != FALSE) {
+                NetProcessReceivedPacket(Device->NetworkLink, Packet);
+            }
+
+            NetFreeBuffer(Packet);
+        }
+    }
+
+    return;
+}
+
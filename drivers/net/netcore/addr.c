@@ -165,6 +165,11 @@ NetpGetPacketSizeInformation (
     PNET_PACKET_SIZE_INFORMATION SizeInformation
     );
 
+BOOL
+NetpIsLoopbackDestination (
+    PNETWORK_ADDRESS RemoteAddress
+    );
+
 VOID
 NetpDebugPrintNetworkAddress (
     PNET_NETWORK_ENTRY Network,
@@ -1040,6 +1045,7 @@ Return Value:
     PNET_LINK Link;
     PNET_LINK_ADDRESS_ENTRY LinkAddress;
     PLIST_ENTRY LinkAddressList;
+    BOOL LoopbackDestination;
     KSTATUS Status;
 
     ASSERT(KeGetRunLevel() == RunLevelLow);
@@ -1054,6 +1060,7 @@ Return Value:
 
     Status = STATUS_NO_NETWORK_CONNECTION;
     FoundAddress = NULL;
+    LoopbackDestination = NetpIsLoopbackDestination(RemoteAddress);
     CurrentLinkEntry = NetLinkList.Next;
     while (CurrentLinkEntry != &NetLinkList) {
         Link = LIST_VALUE(CurrentLinkEntry, NET_LINK, ListEntry);
@@ -1067,6 +1074,20 @@ Return Value:
             continue;
         }
 
+        //
+        // Loopback destinations must go out a loopback link, and nothing else
+        // should.
+        //
+
+        if (NET_IS_LOOPBACK_LINK(Link) != FALSE) {
+            if (LoopbackDestination == FALSE) {
+                continue;
+            }
+
+        } else if (LoopbackDestination != FALSE) {
+            continue;
+        }
+
         //
         // If the domain's link address list is empty, try another link.
         //
@@ -4807,6 +4828,93 @@ Return Value:
     return;
 }
 
+BOOL
+NetpIsLoopbackDestination (
+    PNETWORK_ADDRESS RemoteAddress
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines whether the given remote address lies on the
+    subnet of a configured loopback link address. This routine assumes the
+    link list lock is held.
+
+Arguments:
+
+    RemoteAddress - Supplies a pointer to the remote address to test.
+
+Return Value:
+
+    TRUE if the address can only be reached through a loopback link.
+
+    FALSE otherwise.
+
+--*/
+
+{
+
+    PLIST_ENTRY CurrentAddressEntry;
+    PLIST_ENTRY CurrentLinkEntry;
+    BOOL Found;
+    ULONG Index;
+    PNET_LINK Link;
+    PNET_LINK_ADDRESS_ENTRY LinkAddress;
+    PLIST_ENTRY LinkAddressList;
+    UINTN Mismatch;
+
+    Found = FALSE;
+    CurrentLinkEntry = NetLinkList.Next;
+    while ((CurrentLinkEntry != &NetLinkList) && (Found == FALSE)) {
+        Link = LIST_VALUE(CurrentLinkEntry, NET_LINK, ListEntry);
+        CurrentLinkEntry = CurrentLinkEntry->Next;
+        if ((Link->LinkUp == FALSE) || (NET_IS_LOOPBACK_LINK(Link) == FALSE)) {
+            continue;
+        }
+
+        LinkAddressList = &(Link->LinkAddressArray[RemoteAddress->Domain]);
+        KeAcquireQueuedLock(Link->QueuedLock);
+        CurrentAddressEntry = LinkAddressList->Next;
+        while (CurrentAddressEntry != LinkAddressList) {
+            LinkAddress = LIST_VALUE(CurrentAddressEntry,
+                                     NET_LINK_ADDRESS_ENTRY,
+                                     ListEntry);
+
+            CurrentAddressEntry = CurrentAddressEntry->Next;
+            if ((LinkAddress->State < NetLinkAddressConfigured) ||
+                (LinkAddress->Subnet.Domain != RemoteAddress->Domain)) {
+
+                continue;
+            }
+
+            //
+            // The subnet mask is laid out just like the address, so this
+            // works for any network without knowing its address format.
+            //
+
+            Mismatch = 0;
+            for (Index = 0;
+                 Index < (MAX_NETWORK_ADDRESS_SIZE / sizeof(UINTN));
+                 Index += 1) {
+
+                Mismatch |= (RemoteAddress->Address[Index] ^
+                             LinkAddress->Address.Address[Index]) &
+                            LinkAddress->Subnet.Address[Index];
+            }
+
+            if (Mismatch == 0) {
+                Found = TRUE;
+                break;
+            }
+        }
+
+        KeReleaseQueuedLock(Link->QueuedLock);
+    }
+
+    return Found;
+}
+
 VOID
 NetpDebugPrintNetworkAddress (
     PNET_NETWORK_ENTRY Network,
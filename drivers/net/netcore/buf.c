@@ -413,7 +413,7 @@ Return Value:
 {
 
     INITIALIZE_LIST_HEAD(&NetFreeBufferList);
-    NetBufferListLock = KeCreateQueuedLock();
+    NetBufferListLock = KeCreateNamedQueuedLock("NetBufferListLock");
     if (NetBufferListLock == NULL) {
         return STATUS_INSUFFICIENT_RESOURCES;
     }
@@ -47,12 +47,14 @@ function build() {
         "ipv6/ip6.c",
         "ipv6/mld.c",
         "ipv6/ndp.c",
+        "loopback.c",
         "mcast.c",
         "netcore.c",
         "netlink/netlink.c",
         "netlink/genctrl.c",
         "netlink/generic.c",
         "raw.c",
+        "steer.c",
         "tcp.c",
         "tcpcong.c",
         "udp.c"
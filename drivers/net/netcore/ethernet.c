@@ -39,6 +39,7 @@ Module Name:
 #define NET_API __DLLEXPORT
 
 #include <minoca/kernel/driver.h>
+#include <minoca/kernel/sp.h>
 #include <minoca/net/netdrv.h>
 #include <minoca/net/ip4.h>
 #include <minoca/net/ip6.h>
@@ -507,6 +508,7 @@ Return Value:
         *((PUSHORT)CurrentElement) = CPU_TO_NETWORK16((USHORT)ProtocolNumber);
     }
 
+    SpTrace(SpTraceEventNetTransmit, Link, PacketList->Count);
     DeviceContext = Link->Properties.DeviceContext;
     Status = Link->Properties.Interface.Send(DeviceContext, PacketList);
 
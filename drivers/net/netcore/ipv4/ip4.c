@@ -457,25 +457,48 @@ Return Value:
 {
 
     PNET_LINK_ADDRESS_ENTRY AddressEntry;
+    IP4_ADDRESS Gateway;
     IP4_ADDRESS InitialAddress;
     IP4_ADDRESS MulticastAddress;
     KSTATUS Status;
+    IP4_ADDRESS Subnet;
 
     //
-    // A dummy address with only the network filled in is required, otherwise
-    // this link entry cannot be bound to in order to establish the real
-    // address.
+    // Loopback links get the loopback address statically. There is no
+    // gateway off of the loopback network.
     //
 
     RtlZeroMemory((PNETWORK_ADDRESS)&InitialAddress, sizeof(NETWORK_ADDRESS));
     InitialAddress.Domain = NetDomainIp4;
-    InitialAddress.Address = 0;
-    Status = NetCreateLinkAddressEntry(Link,
-                                       (PNETWORK_ADDRESS)&InitialAddress,
-                                       NULL,
-                                       NULL,
-                                       FALSE,
-                                       &AddressEntry);
+    if (NET_IS_LOOPBACK_LINK(Link) != FALSE) {
+        InitialAddress.Address = IP4_LOOPBACK_ADDRESS;
+        RtlZeroMemory((PNETWORK_ADDRESS)&Subnet, sizeof(NETWORK_ADDRESS));
+        Subnet.Domain = NetDomainIp4;
+        Subnet.Address = IP4_LOOPBACK_SUBNET_MASK;
+        RtlZeroMemory((PNETWORK_ADDRESS)&Gateway, sizeof(NETWORK_ADDRESS));
+        Gateway.Domain = NetDomainIp4;
+        Status = NetCreateLinkAddressEntry(Link,
+                                           (PNETWORK_ADDRESS)&InitialAddress,
+                                           (PNETWORK_ADDRESS)&Subnet,
+                                           (PNETWORK_ADDRESS)&Gateway,
+                                           TRUE,
+                                           &AddressEntry);
+
+    //
+    // Other links need a dummy address with only the network filled in,
+    // otherwise the link entry cannot be bound to in order to establish the
+    // real address.
+    //
+
+    } else {
+        InitialAddress.Address = 0;
+        Status = NetCreateLinkAddressEntry(Link,
+                                           (PNETWORK_ADDRESS)&InitialAddress,
+                                           NULL,
+                                           NULL,
+                                           FALSE,
+                                           &AddressEntry);
+    }
 
     if (!KSUCCESS(Status)) {
         goto Ip4InitializeLinkEnd;
@@ -2347,6 +2370,20 @@ Return Value:
 
     KSTATUS Status;
 
+    //
+    // Loopback links always carry the same static address. There is no one
+    // on the other end to hand out a lease.
+    //
+
+    if (NET_IS_LOOPBACK_LINK(Link) != FALSE) {
+        if (Configure != FALSE) {
+            RtlAtomicExchange32(&(LinkAddress->State),
+                                NetLinkAddressConfiguredStatic);
+        }
+
+        return STATUS_SUCCESS;
+    }
+
     if (Configure != FALSE) {
         Status = NetpDhcpBeginAssignment(Link, LinkAddress);
 
@@ -2506,6 +2543,21 @@ Return Value:
         goto Ip4TranslateNetworkAddressEnd;
     }
 
+    //
+    // Everything sent on a loopback link comes right back, so there is no
+    // neighbor to look up.
+    //
+
+    if (NET_IS_LOOPBACK_LINK(Link) != FALSE) {
+        AddressType = NetAddressUnicast;
+        Status = Link->DataLinkEntry->Interface.ConvertToPhysicalAddress(
+                                                               NetworkAddress,
+                                                               PhysicalAddress,
+                                                               AddressType);
+
+        goto Ip4TranslateNetworkAddressEnd;
+    }
+
     //
     // Make sure the link address is still configured when using it.
     //
@@ -92,7 +92,8 @@ KSTATUS
 NetpIcmp6Accept (
     PNET_SOCKET Socket,
     PIO_HANDLE *NewConnectionSocket,
-    PNETWORK_ADDRESS RemoteAddress
+    PNETWORK_ADDRESS RemoteAddress,
+    ULONG TimeoutInMilliseconds
     );
 
 KSTATUS
@@ -384,7 +385,8 @@ KSTATUS
 NetpIcmp6Accept (
     PNET_SOCKET Socket,
     PIO_HANDLE *NewConnectionSocket,
-    PNETWORK_ADDRESS RemoteAddress
+    PNETWORK_ADDRESS RemoteAddress,
+    ULONG TimeoutInMilliseconds
     )
 
 /*++
@@ -405,6 +407,10 @@ Routine Description:
     RemoteAddress - Supplies a pointer where the address of the connected
         remote host will be returned.
 
+    TimeoutInMilliseconds - Supplies the number of milliseconds to wait for
+        a connection to come in. Use WAIT_TIME_INDEFINITE to wait forever.
+        A non-blocking socket never waits, regardless of this value.
+
 Return Value:
 
     Status code.
@@ -324,11 +324,39 @@ Return Value:
 
     PNET_LINK_ADDRESS_ENTRY AddressEntry;
     PUCHAR BytePointer;
+    IP6_ADDRESS Gateway;
     IP6_ADDRESS InitialAddress;
     PUCHAR MacAddress;
     IP6_ADDRESS MulticastAddress;
     PNETWORK_ADDRESS PhysicalAddress;
     KSTATUS Status;
+    IP6_ADDRESS Subnet;
+
+    //
+    // Loopback links have no hardware address to build an interface
+    // identifier from. They just get the loopback address statically.
+    //
+
+    if (NET_IS_LOOPBACK_LINK(Link) != FALSE) {
+        RtlZeroMemory((PNETWORK_ADDRESS)&InitialAddress,
+                      sizeof(NETWORK_ADDRESS));
+
+        InitialAddress.Domain = NetDomainIp6;
+        InitialAddress.Address[3] = CPU_TO_NETWORK32(0x00000001);
+        RtlZeroMemory((PNETWORK_ADDRESS)&Subnet, sizeof(NETWORK_ADDRESS));
+        Subnet.Domain = NetDomainIp6;
+        RtlSetMemory(Subnet.Address, 0xFF, IP6_ADDRESS_SIZE);
+        RtlZeroMemory((PNETWORK_ADDRESS)&Gateway, sizeof(NETWORK_ADDRESS));
+        Gateway.Domain = NetDomainIp6;
+        Status = NetCreateLinkAddressEntry(Link,
+                                           (PNETWORK_ADDRESS)&InitialAddress,
+                                           (PNETWORK_ADDRESS)&Subnet,
+                                           (PNETWORK_ADDRESS)&Gateway,
+                                           TRUE,
+                                           &AddressEntry);
+
+        goto Ip6InitializeLinkEnd;
+    }
 
     //
     // Initizlie a link address entry with an EUI-64 formatted link-local
@@ -2016,6 +2044,20 @@ Return Value:
     UINTN RequestSize;
     KSTATUS Status;
 
+    //
+    // The loopback address is static and unique by definition, so there is
+    // no duplicate address detection or autoconfiguration to do.
+    //
+
+    if (NET_IS_LOOPBACK_LINK(Link) != FALSE) {
+        if (Configure != FALSE) {
+            RtlAtomicExchange32(&(LinkAddress->State),
+                                NetLinkAddressConfiguredStatic);
+        }
+
+        return STATUS_SUCCESS;
+    }
+
     //
     // ICMPv6 handles address configuration, hand off to the protocol.
     //
@@ -2173,6 +2215,21 @@ Return Value:
         goto Ip6TranslateNetworkAddressEnd;
     }
 
+    //
+    // Everything sent on a loopback link comes right back, so there is no
+    // neighbor to discover.
+    //
+
+    if (NET_IS_LOOPBACK_LINK(Link) != FALSE) {
+        AddressType = NetAddressUnicast;
+        Status = Link->DataLinkEntry->Interface.ConvertToPhysicalAddress(
+                                                               NetworkAddress,
+                                                               PhysicalAddress,
+                                                               AddressType);
+
+        goto Ip6TranslateNetworkAddressEnd;
+    }
+
     //
     // Well, it looks like a run-of-the-mill IP address, translate it.
     //
@@ -0,0 +1,525 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    loopback.c
+
+Abstract:
+
+    This module implements the data link layer for loopback links. Loopback
+    frames never leave the machine, so the only header is the network protocol
+    number needed to hand the packet back up to the right network layer.
+
+Author:
+
+    agent 19-Oct-2026
+
+Environment:
+
+    Kernel
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+//
+// Data link layer drivers are supposed to be able to stand on their own (ie be
+// able to be implemented outside the core net library). For the builtin ones,
+// avoid including netcore.h, but still redefine those functions that would
+// otherwise generate imports.
+//
+
+#define NET_API __DLLEXPORT
+
+#include <minoca/kernel/driver.h>
+#include <minoca/kernel/sp.h>
+#include <minoca/net/netdrv.h>
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// Loopback links have no physical address. Print them as a fixed string,
+// including the null terminator.
+//
+
+#define LOOPBACK_ADDRESS_STRING "loopback"
+#define LOOPBACK_STRING_LENGTH sizeof(LOOPBACK_ADDRESS_STRING)
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+KSTATUS
+NetpLoopbackInitializeLink (
+    PNET_LINK Link
+    );
+
+VOID
+NetpLoopbackDestroyLink (
+    PNET_LINK Link
+    );
+
+KSTATUS
+NetpLoopbackSend (
+    PVOID DataLinkContext,
+    PNET_PACKET_LIST PacketList,
+    PNETWORK_ADDRESS SourcePhysicalAddress,
+    PNETWORK_ADDRESS DestinationPhysicalAddress,
+    ULONG ProtocolNumber
+    );
+
+VOID
+NetpLoopbackProcessReceivedPacket (
+    PVOID DataLinkContext,
+    PNET_PACKET_BUFFER Packet
+    );
+
+KSTATUS
+NetpLoopbackConvertToPhysicalAddress (
+    PNETWORK_ADDRESS NetworkAddress,
+    PNETWORK_ADDRESS PhysicalAddress,
+    NET_ADDRESS_TYPE NetworkAddressType
+    );
+
+ULONG
+NetpLoopbackPrintAddress (
+    PNETWORK_ADDRESS Address,
+    PSTR Buffer,
+    ULONG BufferLength
+    );
+
+VOID
+NetpLoopbackGetPacketSizeInformation (
+    PVOID DataLinkContext,
+    PNET_PACKET_SIZE_INFORMATION PacketSizeInformation,
+    ULONG Flags
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+VOID
+NetpLoopbackInitialize (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine initializes support for loopback links.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    NET_DATA_LINK_ENTRY DataLinkEntry;
+    HANDLE DataLinkHandle;
+    PNET_DATA_LINK_INTERFACE Interface;
+    KSTATUS Status;
+
+    DataLinkEntry.Domain = NetDomainLoopback;
+    Interface = &(DataLinkEntry.Interface);
+    Interface->InitializeLink = NetpLoopbackInitializeLink;
+    Interface->DestroyLink = NetpLoopbackDestroyLink;
+    Interface->Send = NetpLoopbackSend;
+    Interface->ProcessReceivedPacket = NetpLoopbackProcessReceivedPacket;
+    Interface->ConvertToPhysicalAddress = NetpLoopbackConvertToPhysicalAddress;
+    Interface->PrintAddress = NetpLoopbackPrintAddress;
+    Interface->GetPacketSizeInformation = NetpLoopbackGetPacketSizeInformation;
+    Status = NetRegisterDataLinkLayer(&DataLinkEntry, &DataLinkHandle);
+    if (!KSUCCESS(Status)) {
+
+        ASSERT(FALSE);
+
+    }
+
+    return;
+}
+
+KSTATUS
+NetpLoopbackInitializeLink (
+    PNET_LINK Link
+    )
+
+/*++
+
+Routine Description:
+
+    This routine initializes any pieces of information needed by the data link
+    layer for a new link.
+
+Arguments:
+
+    Link - Supplies a pointer to the new link.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    //
+    // Like Ethernet, loopback only needs the network link back as its
+    // context.
+    //
+
+    Link->DataLinkContext = Link;
+    return STATUS_SUCCESS;
+}
+
+VOID
+NetpLoopbackDestroyLink (
+    PNET_LINK Link
+    )
+
+/*++
+
+Routine Description:
+
+    This routine allows the data link layer to tear down any state before a
+    link is destroyed.
+
+Arguments:
+
+    Link - Supplies a pointer to the dying link.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    Link->DataLinkContext = NULL;
+    return;
+}
+
+KSTATUS
+NetpLoopbackSend (
+    PVOID DataLinkContext,
+    PNET_PACKET_LIST PacketList,
+    PNETWORK_ADDRESS SourcePhysicalAddress,
+    PNETWORK_ADDRESS DestinationPhysicalAddress,
+    ULONG ProtocolNumber
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sends data through the data link layer and out the link.
+
+Arguments:
+
+    DataLinkContext - Supplies a pointer to the data link context for the
+        link on which to send the data.
+
+    PacketList - Supplies a pointer to a list of network packets to send. Data
+        in these packets may be modified by this routine, but must not be used
+        once this routine returns.
+
+    SourcePhysicalAddress - Supplies a pointer to the source (local) physical
+        network address. This is ignored by loopback links.
+
+    DestinationPhysicalAddress - Supplies the optional physical address of the
+        destination. This is ignored by loopback links.
+
+    ProtocolNumber - Supplies the protocol number of the data inside the data
+        link header.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    PLIST_ENTRY CurrentEntry;
+    PVOID DeviceContext;
+    PNET_LINK Link;
+    PNET_PACKET_BUFFER Packet;
+    KSTATUS Status;
+
+    Link = (PNET_LINK)DataLinkContext;
+    CurrentEntry = PacketList->Head.Next;
+    while (CurrentEntry != &(PacketList->Head)) {
+        Packet = LIST_VALUE(CurrentEntry, NET_PACKET_BUFFER, ListEntry);
+        CurrentEntry = CurrentEntry->Next;
+
+        ASSERT(Packet->DataOffset >= LOOPBACK_HEADER_SIZE);
+        ASSERT((Packet->FooterOffset - Packet->DataOffset) <=
+               LOOPBACK_MAXIMUM_PAYLOAD_SIZE);
+
+        //
+        // The header is consumed on this same machine, so it is kept in
+        // processor byte order.
+        //
+
+        Packet->DataOffset -= LOOPBACK_HEADER_SIZE;
+        RtlCopyMemory(Packet->Buffer + Packet->DataOffset,
+                      &ProtocolNumber,
+                      LOOPBACK_HEADER_SIZE);
+    }
+
+    SpTrace(SpTraceEventNetTransmit, Link, PacketList->Count);
+    DeviceContext = Link->Properties.DeviceContext;
+    Status = Link->Properties.Interface.Send(DeviceContext, PacketList);
+
+    //
+    // If the loopback device is too backed up to take the packets, drop them
+    // just as a busy NIC would.
+    //
+
+    if (Status == STATUS_RESOURCE_IN_USE) {
+        NetDestroyBufferList(PacketList);
+        Status = STATUS_SUCCESS;
+    }
+
+    return Status;
+}
+
+VOID
+NetpLoopbackProcessReceivedPacket (
+    PVOID DataLinkContext,
+    PNET_PACKET_BUFFER Packet
+    )
+
+/*++
+
+Routine Description:
+
+    This routine is called to process a received loopback packet.
+
+Arguments:
+
+    DataLinkContext - Supplies a pointer to the data link context for the link
+        that received the packet.
+
+    Packet - Supplies a pointer to a structure describing the incoming packet.
+        This structure may be used as a scratch space while this routine
+        executes and the packet travels up the stack, but will not be accessed
+        after this routine returns.
+
+Return Value:
+
+    None. When the function returns, the memory associated with the packet may
+    be reclaimed and reused.
+
+--*/
+
+{
+
+    PNET_LINK Link;
+    PNET_NETWORK_ENTRY NetworkEntry;
+    ULONG NetworkProtocol;
+    NET_RECEIVE_CONTEXT ReceiveContext;
+
+    Link = (PNET_LINK)DataLinkContext;
+    if ((Packet->FooterOffset - Packet->DataOffset) < LOOPBACK_HEADER_SIZE) {
+        return;
+    }
+
+    RtlCopyMemory(&NetworkProtocol,
+                  Packet->Buffer + Packet->DataOffset,
+                  LOOPBACK_HEADER_SIZE);
+
+    NetworkEntry = NetGetNetworkEntry(NetworkProtocol);
+    if (NetworkEntry == NULL) {
+        RtlDebugPrint("Unknown protocol number 0x%x found in loopback "
+                      "header.\n",
+                      NetworkProtocol);
+
+        return;
+    }
+
+    //
+    // The packet never left memory, so there is nothing for checksums to
+    // catch. Report them as already verified, the same way a NIC with receive
+    // offload would, and drop any flags left over from the transmit path.
+    //
+
+    Packet->Flags = NET_PACKET_FLAG_CHECKSUM_OFFLOAD_MASK;
+    Packet->DataOffset += LOOPBACK_HEADER_SIZE;
+    RtlZeroMemory(&ReceiveContext, sizeof(NET_RECEIVE_CONTEXT));
+    ReceiveContext.Packet = Packet;
+    ReceiveContext.Link = Link;
+    ReceiveContext.Network = NetworkEntry;
+    NetworkEntry->Interface.ProcessReceivedData(&ReceiveContext);
+    return;
+}
+
+KSTATUS
+NetpLoopbackConvertToPhysicalAddress (
+    PNETWORK_ADDRESS NetworkAddress,
+    PNETWORK_ADDRESS PhysicalAddress,
+    NET_ADDRESS_TYPE NetworkAddressType
+    )
+
+/*++
+
+Routine Description:
+
+    This routine converts the given network address to a physical layer address
+    based on the provided network address type.
+
+Arguments:
+
+    NetworkAddress - Supplies a pointer to the network layer address to convert.
+
+    PhysicalAddress - Supplies a pointer to an address that receives the
+        converted physical layer address.
+
+    NetworkAddressType - Supplies the classified type of the given network
+        address, which aids in conversion.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    //
+    // Every destination on a loopback link is the link itself, so all
+    // addresses convert to the same empty physical address.
+    //
+
+    RtlZeroMemory(PhysicalAddress, sizeof(NETWORK_ADDRESS));
+    PhysicalAddress->Domain = NetDomainLoopback;
+    return STATUS_SUCCESS;
+}
+
+ULONG
+NetpLoopbackPrintAddress (
+    PNETWORK_ADDRESS Address,
+    PSTR Buffer,
+    ULONG BufferLength
+    )
+
+/*++
+
+Routine Description:
+
+    This routine is called to convert a network address into a string, or
+    determine the length of the buffer needed to convert an address into a
+    string.
+
+Arguments:
+
+    Address - Supplies an optional pointer to a network address to convert to
+        a string.
+
+    Buffer - Supplies an optional pointer where the string representation of
+        the address will be returned.
+
+    BufferLength - Supplies the length of the supplied buffer, in bytes.
+
+Return Value:
+
+    Returns the maximum length of any address if no network address is
+    supplied.
+
+    Returns the actual length of the network address string if a network address
+    was supplied, including the null terminator.
+
+--*/
+
+{
+
+    ULONG Length;
+
+    if (Address == NULL) {
+        return LOOPBACK_STRING_LENGTH;
+    }
+
+    ASSERT(Address->Domain == NetDomainLoopback);
+
+    Length = RtlPrintToString(Buffer,
+                              BufferLength,
+                              CharacterEncodingAscii,
+                              LOOPBACK_ADDRESS_STRING);
+
+    return Length;
+}
+
+VOID
+NetpLoopbackGetPacketSizeInformation (
+    PVOID DataLinkContext,
+    PNET_PACKET_SIZE_INFORMATION PacketSizeInformation,
+    ULONG Flags
+    )
+
+/*++
+
+Routine Description:
+
+    This routine gets the current packet size information for the given link.
+    As the number of required headers can be different for each link, the
+    packet size information is not a constant for an entire data link layer.
+
+Arguments:
+
+    DataLinkContext - Supplies a pointer to the data link context of the link
+        whose packet size information is being queried.
+
+    PacketSizeInformation - Supplies a pointer to a structure that receives the
+        link's data link layer packet size information.
+
+    Flags - Supplies a bitmask of flags indicating which packet size
+        information is desired. See NET_PACKET_SIZE_FLAG_* for definitions.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PacketSizeInformation->HeaderSize = LOOPBACK_HEADER_SIZE;
+    PacketSizeInformation->FooterSize = 0;
+    PacketSizeInformation->MaxPacketSize = LOOPBACK_HEADER_SIZE +
+                                           LOOPBACK_MAXIMUM_PAYLOAD_SIZE;
+
+    PacketSizeInformation->MinPacketSize = LOOPBACK_HEADER_SIZE;
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
@@ -30,6 +30,7 @@ Module Name:
 //
 
 #include <minoca/kernel/driver.h>
+#include <minoca/kernel/sp.h>
 #include "netcore.h"
 
 //
@@ -106,7 +107,8 @@ KSTATUS
 NetAccept (
     PSOCKET Socket,
     PIO_HANDLE *NewConnectionSocket,
-    PNETWORK_ADDRESS RemoteAddress
+    PNETWORK_ADDRESS RemoteAddress,
+    ULONG TimeoutInMilliseconds
     );
 
 KSTATUS
@@ -357,12 +359,15 @@ Return Value:
         goto DriverEntryEnd;
     }
 
+    NetpInitializeReceiveSteering();
+
     //
     // Set up the built in protocols, networks, data links and miscellaneous
     // components.
     //
 
     NetpEthernetInitialize();
+    NetpLoopbackInitialize();
     NetpArpInitialize();
     NetpIp4Initialize();
     NetpUdpInitialize();
@@ -486,7 +491,8 @@ Return Value:
     }
 
     RtlCopyMemory(NewProtocolCopy, NewProtocol, sizeof(NET_PROTOCOL_ENTRY));
-    NewProtocolCopy->SocketLock = KeCreateSharedExclusiveLock();
+    NewProtocolCopy->SocketLock =
+                          KeCreateNamedSharedExclusiveLock("NetSocketLock");
     if (NewProtocolCopy->SocketLock == NULL) {
         Status = STATUS_INSUFFICIENT_RESOURCES;
         goto RegisterProtocolEnd;
@@ -1205,6 +1211,21 @@ Return Value:
 
 {
 
+    BOOL Steered;
+
+    SpTrace(SpTraceEventNetReceive,
+            Link,
+            Packet->FooterOffset - Packet->DataOffset);
+
+    //
+    // Try to hand the packet to the processor that owns its flow.
+    //
+
+    Steered = NetpSteerReceivedPacket(Link, Packet);
+    if (Steered != FALSE) {
+        return;
+    }
+
     //
     // Call the data link layer to process the packet.
     //
@@ -1742,7 +1763,8 @@ KSTATUS
 NetAccept (
     PSOCKET Socket,
     PIO_HANDLE *NewConnectionSocket,
-    PNETWORK_ADDRESS RemoteAddress
+    PNETWORK_ADDRESS RemoteAddress,
+    ULONG TimeoutInMilliseconds
     )
 
 /*++
@@ -1763,6 +1785,10 @@ Routine Description:
     RemoteAddress - Supplies a pointer where the address of the connected
         remote host will be returned.
 
+    TimeoutInMilliseconds - Supplies the number of milliseconds to wait for
+        a connection to come in. Use WAIT_TIME_INDEFINITE to wait forever.
+        A non-blocking socket never waits, regardless of this value.
+
 Return Value:
 
     Status code.
@@ -1781,7 +1807,8 @@ Return Value:
 
     Status = NetSocket->Protocol->Interface.Accept(NetSocket,
                                                    NewConnectionSocket,
-                                                   RemoteAddress);
+                                                   RemoteAddress,
+                                                   TimeoutInMilliseconds);
 
     if (NetGlobalDebug != FALSE) {
         RtlDebugPrint("Net: Socket 0x%x accepted ", NetSocket);
@@ -2000,6 +2027,13 @@ Return Value:
                                                     Parameters,
                                                     IoBuffer);
 
+    //
+    // Steer future packets for this socket to wherever its reader is running
+    // now.
+    //
+
+    NetpRecordSocketFlow(NetSocket);
+
     if (NetGlobalDebug != FALSE) {
         RtlDebugPrint("Net: Received %ld on socket 0x%x: %d.\n",
                       Parameters->BytesCompleted,
@@ -493,6 +493,82 @@ Return Value:
 // Prototypes to entry points for built in data link layers.
 //
 
+VOID
+NetpInitializeReceiveSteering (
+    VOID
+    );
+
+/*++
+
+Routine Description:
+
+    This routine initializes receive packet steering, creating a receive
+    queue and a bound worker thread for each processor. If anything fails,
+    received packets are simply processed on the processor that received them.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
+BOOL
+NetpSteerReceivedPacket (
+    PNET_LINK Link,
+    PNET_PACKET_BUFFER Packet
+    );
+
+/*++
+
+Routine Description:
+
+    This routine attempts to hand a received packet off to the processor
+    that should process its flow.
+
+Arguments:
+
+    Link - Supplies a pointer to the link that received the packet.
+
+    Packet - Supplies a pointer to the received packet. This is owned by the
+        caller and is not touched after this routine returns.
+
+Return Value:
+
+    TRUE if the packet was consumed, either by processing it directly, by
+    queuing it to another processor, or by dropping it.
+
+    FALSE if the packet does not belong to a flow and should be processed
+    immediately on the current processor.
+
+--*/
+
+VOID
+NetpRecordSocketFlow (
+    PNET_SOCKET Socket
+    );
+
+/*++
+
+Routine Description:
+
+    This routine notes that the given socket's reader is running on the
+    current processor, so that future packets for the socket's flow are
+    steered here.
+
+Arguments:
+
+    Socket - Supplies a pointer to the socket being read.
+
+Return Value:
+
+    None.
+
+--*/
+
 VOID
 NetpEthernetInitialize (
     VOID
@@ -514,6 +590,27 @@ Return Value:
 
 --*/
 
+VOID
+NetpLoopbackInitialize (
+    VOID
+    );
+
+/*++
+
+Routine Description:
+
+    This routine initializes support for loopback links.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
 //
 // Prototypes to entry points for built in components.
 //
@@ -237,7 +237,8 @@ KSTATUS
 NetpRawAccept (
     PNET_SOCKET Socket,
     PIO_HANDLE *NewConnectionSocket,
-    PNETWORK_ADDRESS RemoteAddress
+    PNETWORK_ADDRESS RemoteAddress,
+    ULONG TimeoutInMilliseconds
     );
 
 KSTATUS
@@ -783,7 +784,8 @@ KSTATUS
 NetpRawAccept (
     PNET_SOCKET Socket,
     PIO_HANDLE *NewConnectionSocket,
-    PNETWORK_ADDRESS RemoteAddress
+    PNETWORK_ADDRESS RemoteAddress,
+    ULONG TimeoutInMilliseconds
     )
 
 /*++
@@ -804,6 +806,10 @@ Routine Description:
     RemoteAddress - Supplies a pointer where the address of the connected
         remote host will be returned.
 
+    TimeoutInMilliseconds - Supplies the number of milliseconds to wait for
+        a connection to come in. Use WAIT_TIME_INDEFINITE to wait forever.
+        A non-blocking socket never waits, regardless of this value.
+
 Return Value:
 
     Status code.
@@ -0,0 +1,863 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    steer.c
+
+Abstract:
+
+    This module implements receive packet steering for the core networking
+    library. Received packets are hashed by flow and handed to a worker thread
+    bound to one processor per flow, so that protocol processing for different
+    flows spreads across the system. Flows with a socket reader are sent to the
+    processor the reader last ran on.
+
+Author:
+
+    agent 19-Oct-2026
+
+Environment:
+
+    Kernel
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <minoca/kernel/driver.h>
+#include "netcore.h"
+#include "ethernet.h"
+#include <minoca/net/ip4.h>
+#include <minoca/net/ip6.h>
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// Define the number of entries in the flow table. This must be a power of
+// two.
+//
+
+#define NET_RECEIVE_FLOW_TABLE_SIZE 4096
+
+//
+// Define the maximum number of packets that can be waiting on a processor's
+// receive queue before new packets for that processor are dropped.
+//
+
+#define NET_RECEIVE_QUEUE_MAX_PACKET_COUNT 1024
+
+//
+// Define the multiplier used to mix flow hashes.
+//
+
+#define NET_FLOW_HASH_MULTIPLIER 0x9E3779B1
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+/*++
+
+Structure Description:
+
+    This structure defines a received packet that has been handed off to
+    another processor. The packet data immediately follows this structure.
+
+Members:
+
+    Link - Stores a pointer to the link the packet was received on. A reference
+        is held on the link while the packet is queued.
+
+    Packet - Stores the packet itself.
+
+--*/
+
+typedef struct _NET_STEERED_PACKET {
+    PNET_LINK Link;
+    NET_PACKET_BUFFER Packet;
+} NET_STEERED_PACKET, *PNET_STEERED_PACKET;
+
+/*++
+
+Structure Description:
+
+    This structure defines a per-processor receive queue.
+
+Members:
+
+    Lock - Stores a pointer to the lock protecting the packet list.
+
+    ProcessLock - Stores a pointer to the lock held while packets accepted
+        for this processor are being processed, so that a packet processed
+        directly cannot overlap with queued packets that arrived after it.
+
+    PacketList - Stores the list of packets waiting to be processed on this
+        processor. The packets are embedded in NET_STEERED_PACKET structures.
+
+    Event - Stores a pointer to the event the worker thread waits on. It is
+        signaled whenever the packet list is not empty.
+
+    Processor - Stores the number of the processor this queue belongs to.
+
+    DroppedPacketCount - Stores the number of packets dropped because the
+        queue was full.
+
+    QueueTail - Stores the number of packets ever accepted for this processor,
+        including those processed directly without being queued. This is
+        protected by the lock.
+
+    QueueHead - Stores the number of accepted packets that have finished
+        processing. Packets for this processor are still in flight whenever
+        this differs from the tail, even if the packet list is empty.
+
+--*/
+
+typedef struct _NET_RECEIVE_QUEUE {
+    PQUEUED_LOCK Lock;
+    PQUEUED_LOCK ProcessLock;
+    NET_PACKET_LIST PacketList;
+    PKEVENT Event;
+    ULONG Processor;
+    volatile ULONG DroppedPacketCount;
+    volatile ULONG QueueTail;
+    volatile ULONG QueueHead;
+} NET_RECEIVE_QUEUE, *PNET_RECEIVE_QUEUE;
+
+/*++
+
+Structure Description:
+
+    This structure defines the processor a flow is currently being steered to.
+
+Members:
+
+    Processor - Stores the number of the processor the flow's packets are
+        currently handed to, plus one. Zero means no packet has been seen for
+        the flow.
+
+    QueueTail - Stores the value of that processor's queue tail after the
+        flow's most recent packet was accepted. Once the queue head passes
+        this, none of the flow's packets are left in flight and the flow can
+        safely move to another processor.
+
+--*/
+
+typedef struct _NET_RECEIVE_FLOW {
+    volatile ULONG Processor;
+    volatile ULONG QueueTail;
+} NET_RECEIVE_FLOW, *PNET_RECEIVE_FLOW;
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+VOID
+NetpReceiveQueueWorker (
+    PVOID Parameter
+    );
+
+BOOL
+NetpHashReceivedPacket (
+    PNET_LINK Link,
+    PNET_PACKET_BUFFER Packet,
+    PULONG Hash
+    );
+
+ULONG
+NetpComputeFlowHash (
+    ULONG Protocol,
+    PULONG SourceAddress,
+    PULONG DestinationAddress,
+    ULONG AddressWords,
+    ULONG SourcePort,
+    ULONG DestinationPort
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// Store the array of per-processor receive queues. This is NULL if receive
+// steering is not enabled, which is always the case on uniprocessor systems.
+//
+
+PNET_RECEIVE_QUEUE NetReceiveQueues;
+ULONG NetReceiveQueueCount;
+
+//
+// Store the flow table, which maps flow hashes to the processor the socket
+// reader for that flow last ran on, plus one. Zero means no reader has been
+// seen for the flow.
+//
+
+volatile ULONG NetReceiveFlowTable[NET_RECEIVE_FLOW_TABLE_SIZE];
+
+//
+// Store the processor each flow is actually being steered to right now. A
+// flow only follows its reader to a new processor once it has no packets in
+// flight on the old one, so that it is never reordered.
+//
+
+NET_RECEIVE_FLOW NetReceiveFlows[NET_RECEIVE_FLOW_TABLE_SIZE];
+
+//
+// Store the seed mixed into every flow hash.
+//
+
+ULONG NetReceiveFlowHashSeed;
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+VOID
+NetpInitializeReceiveSteering (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine initializes receive packet steering, creating a receive
+    queue and a bound worker thread for each processor. If anything fails,
+    received packets are simply processed on the processor that received them.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG AllocationSize;
+    ULONG Count;
+    ULONG Index;
+    THREAD_CREATION_PARAMETERS Parameters;
+    PNET_RECEIVE_QUEUE Queue;
+    PNET_RECEIVE_QUEUE Queues;
+    KSTATUS Status;
+
+    Count = KeGetActiveProcessorCount();
+    if (Count <= 1) {
+        return;
+    }
+
+    AllocationSize = Count * sizeof(NET_RECEIVE_QUEUE);
+    Queues = MmAllocateNonPagedPool(AllocationSize, NET_CORE_ALLOCATION_TAG);
+    if (Queues == NULL) {
+        return;
+    }
+
+    RtlZeroMemory(Queues, AllocationSize);
+    for (Index = 0; Index < Count; Index += 1) {
+        Queue = &(Queues[Index]);
+        Queue->Processor = Index;
+        NET_INITIALIZE_PACKET_LIST(&(Queue->PacketList));
+        Queue->Lock = KeCreateQueuedLock();
+        Queue->ProcessLock = KeCreateQueuedLock();
+        Queue->Event = KeCreateEvent(NULL);
+        if ((Queue->Lock == NULL) || (Queue->ProcessLock == NULL) ||
+            (Queue->Event == NULL)) {
+
+            goto InitializeReceiveSteeringEnd;
+        }
+    }
+
+    //
+    // Once the first thread is created the queues can never be torn down, so
+    // a failure past this point just leaves some processors without steered
+    // packets.
+    //
+
+    NetReceiveFlowHashSeed = (ULONG)HlQueryTimeCounter();
+    for (Index = 0; Index < Count; Index += 1) {
+        RtlZeroMemory(&Parameters, sizeof(THREAD_CREATION_PARAMETERS));
+        Parameters.Name = "NetReceiveWorker";
+        Parameters.NameSize = sizeof("NetReceiveWorker");
+        Parameters.ThreadRoutine = NetpReceiveQueueWorker;
+        Parameters.Parameter = &(Queues[Index]);
+        Parameters.Flags = THREAD_FLAG_BOUND;
+        Parameters.Processor = Index;
+        Status = PsCreateThread(&Parameters);
+        if (!KSUCCESS(Status)) {
+            if (Index == 0) {
+                goto InitializeReceiveSteeringEnd;
+            }
+
+            Count = Index;
+            break;
+        }
+    }
+
+    NetReceiveQueueCount = Count;
+    NetReceiveQueues = Queues;
+    Queues = NULL;
+
+InitializeReceiveSteeringEnd:
+    if (Queues != NULL) {
+        for (Index = 0; Index < Count; Index += 1) {
+            Queue = &(Queues[Index]);
+            if (Queue->Lock != NULL) {
+                KeDestroyQueuedLock(Queue->Lock);
+            }
+
+            if (Queue->ProcessLock != NULL) {
+                KeDestroyQueuedLock(Queue->ProcessLock);
+            }
+
+            if (Queue->Event != NULL) {
+                KeDestroyEvent(Queue->Event);
+            }
+        }
+
+        MmFreeNonPagedPool(Queues);
+    }
+
+    return;
+}
+
+BOOL
+NetpSteerReceivedPacket (
+    PNET_LINK Link,
+    PNET_PACKET_BUFFER Packet
+    )
+
+/*++
+
+Routine Description:
+
+    This routine attempts to hand a received packet off to the processor
+    that should process its flow.
+
+Arguments:
+
+    Link - Supplies a pointer to the link that received the packet.
+
+    Packet - Supplies a pointer to the received packet. This is owned by the
+        caller and is not touched after this routine returns.
+
+Return Value:
+
+    TRUE if the packet was consumed, either by processing it directly, by
+    queuing it to another processor, or by dropping it.
+
+    FALSE if the packet does not belong to a flow and should be processed
+    immediately on the current processor.
+
+--*/
+
+{
+
+    ULONG AllocationSize;
+    ULONG Current;
+    ULONG CurrentProcessor;
+    ULONG DataSize;
+    ULONG Desired;
+    PNET_RECEIVE_FLOW Flow;
+    ULONG Hash;
+    BOOL Hashed;
+    ULONG Index;
+    PNET_PACKET_BUFFER NewPacket;
+    ULONG Processor;
+    PNET_RECEIVE_QUEUE Queue;
+    PNET_STEERED_PACKET Steered;
+
+    if ((NetReceiveQueues == NULL) || (KeGetRunLevel() != RunLevelLow)) {
+        return FALSE;
+    }
+
+    Hashed = NetpHashReceivedPacket(Link, Packet, &Hash);
+    if (Hashed == FALSE) {
+        return FALSE;
+    }
+
+    //
+    // Prefer the processor the flow's reader last ran on. Otherwise spread
+    // flows evenly by hash. A flow already on its way to one processor only
+    // moves once all of its packets there have been processed.
+    //
+
+    Index = Hash & (NET_RECEIVE_FLOW_TABLE_SIZE - 1);
+    Flow = &(NetReceiveFlows[Index]);
+    Current = Flow->Processor;
+    if ((Current == 0) || (Current > NetReceiveQueueCount)) {
+        Current = (Hash % NetReceiveQueueCount) + 1;
+        Flow->Processor = Current;
+    }
+
+    Desired = NetReceiveFlowTable[Index];
+    if ((Desired != Current) &&
+        (Desired != 0) &&
+        (Desired <= NetReceiveQueueCount)) {
+
+        Queue = &(NetReceiveQueues[Current - 1]);
+        if ((LONG)(Queue->QueueHead - Flow->QueueTail) >= 0) {
+            Current = Desired;
+            Flow->Processor = Current;
+            Flow->QueueTail = NetReceiveQueues[Current - 1].QueueTail;
+        }
+    }
+
+    Processor = Current - 1;
+
+    //
+    // If the packet is already on the right processor, process it directly
+    // unless earlier packets for that processor are still queued or being
+    // processed, as jumping ahead of them would reorder the flow. Take the
+    // processing lock before letting go of the queue lock so the worker
+    // cannot start on packets queued behind this one in the meantime.
+    //
+
+    Queue = &(NetReceiveQueues[Processor]);
+    CurrentProcessor = KeGetCurrentProcessorNumber();
+    if (Processor == CurrentProcessor) {
+        KeAcquireQueuedLock(Queue->Lock);
+        if (Queue->QueueHead == Queue->QueueTail) {
+            Queue->QueueTail += 1;
+            Flow->QueueTail = Queue->QueueTail;
+            KeAcquireQueuedLock(Queue->ProcessLock);
+            KeReleaseQueuedLock(Queue->Lock);
+            Link->DataLinkEntry->Interface.ProcessReceivedPacket(
+                                                        Link->DataLinkContext,
+                                                        Packet);
+
+            KeReleaseQueuedLock(Queue->ProcessLock);
+            RtlAtomicAdd32(&(Queue->QueueHead), 1);
+            return TRUE;
+        }
+
+        KeReleaseQueuedLock(Queue->Lock);
+    }
+
+    if (Queue->PacketList.Count >= NET_RECEIVE_QUEUE_MAX_PACKET_COUNT) {
+        RtlAtomicAdd32(&(Queue->DroppedPacketCount), 1);
+        return TRUE;
+    }
+
+    //
+    // The caller's packet usually lives in a hardware receive ring that gets
+    // reused as soon as this returns, so copy the frame out.
+    //
+
+    DataSize = Packet->DataSize - Packet->DataOffset;
+    AllocationSize = sizeof(NET_STEERED_PACKET) + DataSize;
+    Steered = MmAllocateNonPagedPool(AllocationSize, NET_CORE_ALLOCATION_TAG);
+    if (Steered == NULL) {
+        RtlAtomicAdd32(&(Queue->DroppedPacketCount), 1);
+        return TRUE;
+    }
+
+    NewPacket = &(Steered->Packet);
+    RtlZeroMemory(NewPacket, sizeof(NET_PACKET_BUFFER));
+    NewPacket->Buffer = Steered + 1;
+    NewPacket->Flags = Packet->Flags;
+    NewPacket->BufferSize = DataSize;
+    NewPacket->DataSize = DataSize;
+    NewPacket->DataOffset = 0;
+    NewPacket->FooterOffset = Packet->FooterOffset - Packet->DataOffset;
+    RtlCopyMemory(NewPacket->Buffer,
+                  Packet->Buffer + Packet->DataOffset,
+                  DataSize);
+
+    NetLinkAddReference(Link);
+    Steered->Link = Link;
+    KeAcquireQueuedLock(Queue->Lock);
+    NET_ADD_PACKET_TO_LIST(NewPacket, &(Queue->PacketList));
+    Queue->QueueTail += 1;
+    Flow->QueueTail = Queue->QueueTail;
+    if (Queue->PacketList.Count == 1) {
+        KeSignalEvent(Queue->Event, SignalOptionSignalAll);
+    }
+
+    KeReleaseQueuedLock(Queue->Lock);
+    return TRUE;
+}
+
+VOID
+NetpRecordSocketFlow (
+    PNET_SOCKET Socket
+    )
+
+/*++
+
+Routine Description:
+
+    This routine notes that the given socket's reader is running on the
+    current processor, so that future packets for the socket's flow are
+    steered here.
+
+Arguments:
+
+    Socket - Supplies a pointer to the socket being read.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG AddressWords;
+    ULONG Hash;
+    ULONG Index;
+    PNETWORK_ADDRESS LocalAddress;
+    ULONG Processor;
+    PNETWORK_ADDRESS RemoteAddress;
+
+    if ((NetReceiveQueues == NULL) ||
+        (Socket->BindingType != SocketFullyBound)) {
+
+        return;
+    }
+
+    if ((Socket->KernelSocket.Protocol != SOCKET_INTERNET_PROTOCOL_TCP) &&
+        (Socket->KernelSocket.Protocol != SOCKET_INTERNET_PROTOCOL_UDP)) {
+
+        return;
+    }
+
+    LocalAddress = &(Socket->LocalReceiveAddress);
+    RemoteAddress = &(Socket->RemoteAddress);
+    if (RemoteAddress->Domain == NetDomainIp4) {
+        AddressWords = 1;
+
+    } else if (RemoteAddress->Domain == NetDomainIp6) {
+        AddressWords = IP6_ADDRESS_SIZE / sizeof(ULONG);
+
+    } else {
+        return;
+    }
+
+    //
+    // Incoming packets for this socket come from the remote address to the
+    // local one.
+    //
+
+    Hash = NetpComputeFlowHash(Socket->KernelSocket.Protocol,
+                               (PULONG)(RemoteAddress->Address),
+                               (PULONG)(LocalAddress->Address),
+                               AddressWords,
+                               RemoteAddress->Port,
+                               LocalAddress->Port);
+
+    //
+    // Avoid dirtying the cache line if nothing changed.
+    //
+
+    Processor = KeGetCurrentProcessorNumber() + 1;
+    Index = Hash & (NET_RECEIVE_FLOW_TABLE_SIZE - 1);
+    if (NetReceiveFlowTable[Index] != Processor) {
+        NetReceiveFlowTable[Index] = Processor;
+    }
+
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+VOID
+NetpReceiveQueueWorker (
+    PVOID Parameter
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements the worker thread for a processor's receive queue.
+    It runs bound to that processor and processes packets steered there.
+
+Arguments:
+
+    Parameter - Supplies a pointer to the receive queue.
+
+Return Value:
+
+    None. This routine never returns.
+
+--*/
+
+{
+
+    PNET_LINK Link;
+    PNET_PACKET_BUFFER Packet;
+    NET_PACKET_LIST PacketList;
+    PNET_RECEIVE_QUEUE Queue;
+    PNET_STEERED_PACKET Steered;
+
+    Queue = (PNET_RECEIVE_QUEUE)Parameter;
+
+    ASSERT(KeGetCurrentProcessorNumber() == Queue->Processor);
+
+    NET_INITIALIZE_PACKET_LIST(&PacketList);
+    while (TRUE) {
+        KeWaitForEvent(Queue->Event, FALSE, WAIT_TIME_INDEFINITE);
+        KeAcquireQueuedLock(Queue->Lock);
+        NET_APPEND_PACKET_LIST(&(Queue->PacketList), &PacketList);
+        KeSignalEvent(Queue->Event, SignalOptionUnsignal);
+        KeReleaseQueuedLock(Queue->Lock);
+        KeAcquireQueuedLock(Queue->ProcessLock);
+        while (NET_PACKET_LIST_EMPTY(&PacketList) == FALSE) {
+            Packet = LIST_VALUE(PacketList.Head.Next,
+                                NET_PACKET_BUFFER,
+                                ListEntry);
+
+            NET_REMOVE_PACKET_FROM_LIST(Packet, &PacketList);
+            Steered = PARENT_STRUCTURE(Packet, NET_STEERED_PACKET, Packet);
+            Link = Steered->Link;
+            Link->DataLinkEntry->Interface.ProcessReceivedPacket(
+                                                        Link->DataLinkContext,
+                                                        Packet);
+
+            NetLinkReleaseReference(Link);
+            MmFreeNonPagedPool(Steered);
+
+            //
+            // Only count the packet as done once it has been fully processed,
+            // so that the queue looks busy until the local list drains.
+            //
+
+            RtlAtomicAdd32(&(Queue->QueueHead), 1);
+        }
+
+        KeReleaseQueuedLock(Queue->ProcessLock);
+    }
+
+    return;
+}
+
+BOOL
+NetpHashReceivedPacket (
+    PNET_LINK Link,
+    PNET_PACKET_BUFFER Packet,
+    PULONG Hash
+    )
+
+/*++
+
+Routine Description:
+
+    This routine computes the flow hash of a received frame by peeking at its
+    network and transport headers.
+
+Arguments:
+
+    Link - Supplies a pointer to the link that received the packet.
+
+    Packet - Supplies a pointer to the received packet.
+
+    Hash - Supplies a pointer where the flow hash will be returned on success.
+
+Return Value:
+
+    TRUE if the packet belongs to an IP flow and was hashed.
+
+    FALSE if the packet is not one that can be steered.
+
+--*/
+
+{
+
+    ULONG AddressWords;
+    PUCHAR Data;
+    ULONG DataSize;
+    ULONG DestinationAddress[IP6_ADDRESS_SIZE / sizeof(ULONG)];
+    ULONG DestinationPort;
+    USHORT EthernetType;
+    ULONG FragmentFlags;
+    ULONG FragmentOffset;
+    ULONG HeaderSize;
+    PIP4_HEADER Ip4Header;
+    PIP6_HEADER Ip6Header;
+    PUSHORT Ports;
+    ULONG Protocol;
+    ULONG SourceAddress[IP6_ADDRESS_SIZE / sizeof(ULONG)];
+    ULONG SourcePort;
+    BOOL UsePorts;
+
+    //
+    // Only ethernet framing is understood here. Everything else is processed
+    // where it arrives.
+    //
+
+    if (Link->Properties.DataLinkType != NetDomainEthernet) {
+        return FALSE;
+    }
+
+    Data = Packet->Buffer + Packet->DataOffset;
+    DataSize = Packet->FooterOffset - Packet->DataOffset;
+    if (DataSize < ETHERNET_HEADER_SIZE) {
+        return FALSE;
+    }
+
+    EthernetType = NETWORK_TO_CPU16(
+                            *((PUSHORT)(Data + (2 * ETHERNET_ADDRESS_SIZE))));
+
+    Data += ETHERNET_HEADER_SIZE;
+    DataSize -= ETHERNET_HEADER_SIZE;
+    UsePorts = FALSE;
+    if (EthernetType == IP4_PROTOCOL_NUMBER) {
+        if (DataSize < sizeof(IP4_HEADER)) {
+            return FALSE;
+        }
+
+        Ip4Header = (PIP4_HEADER)Data;
+        if ((Ip4Header->VersionAndHeaderLength & IP4_VERSION_MASK) !=
+            IP4_VERSION) {
+
+            return FALSE;
+        }
+
+        HeaderSize = (Ip4Header->VersionAndHeaderLength &
+                      IP4_HEADER_LENGTH_MASK) * sizeof(ULONG);
+
+        if ((HeaderSize < sizeof(IP4_HEADER)) || (HeaderSize > DataSize)) {
+            return FALSE;
+        }
+
+        AddressWords = 1;
+        Protocol = Ip4Header->Protocol;
+        SourceAddress[0] = Ip4Header->SourceAddress;
+        DestinationAddress[0] = Ip4Header->DestinationAddress;
+
+        //
+        // Fragments don't all carry the transport header, so hash every
+        // fragment on addresses alone to keep a datagram's fragments together.
+        //
+
+        FragmentOffset = NETWORK_TO_CPU16(Ip4Header->FragmentOffset);
+        FragmentFlags = (FragmentOffset >> IP4_FRAGMENT_FLAGS_SHIFT) &
+                        IP4_FRAGMENT_FLAGS_MASK;
+
+        FragmentOffset &= IP4_FRAGMENT_OFFSET_MASK;
+        if (((FragmentFlags & IP4_FLAG_MORE_FRAGMENTS) == 0) &&
+            (FragmentOffset == 0)) {
+
+            UsePorts = TRUE;
+        }
+
+    } else if (EthernetType == IP6_PROTOCOL_NUMBER) {
+        if (DataSize < sizeof(IP6_HEADER)) {
+            return FALSE;
+        }
+
+        Ip6Header = (PIP6_HEADER)Data;
+        HeaderSize = sizeof(IP6_HEADER);
+        AddressWords = IP6_ADDRESS_SIZE / sizeof(ULONG);
+        Protocol = Ip6Header->NextHeader;
+        RtlCopyMemory(SourceAddress,
+                      Ip6Header->SourceAddress,
+                      IP6_ADDRESS_SIZE);
+
+        RtlCopyMemory(DestinationAddress,
+                      Ip6Header->DestinationAddress,
+                      IP6_ADDRESS_SIZE);
+
+        UsePorts = TRUE;
+
+    } else {
+        return FALSE;
+    }
+
+    SourcePort = 0;
+    DestinationPort = 0;
+    if ((UsePorts != FALSE) &&
+        ((Protocol == SOCKET_INTERNET_PROTOCOL_TCP) ||
+         (Protocol == SOCKET_INTERNET_PROTOCOL_UDP)) &&
+        (DataSize - HeaderSize >= (2 * sizeof(USHORT)))) {
+
+        Ports = (PUSHORT)(Data + HeaderSize);
+        SourcePort = NETWORK_TO_CPU16(Ports[0]);
+        DestinationPort = NETWORK_TO_CPU16(Ports[1]);
+    }
+
+    *Hash = NetpComputeFlowHash(Protocol,
+                                SourceAddress,
+                                DestinationAddress,
+                                AddressWords,
+                                SourcePort,
+                                DestinationPort);
+
+    return TRUE;
+}
+
+ULONG
+NetpComputeFlowHash (
+    ULONG Protocol,
+    PULONG SourceAddress,
+    PULONG DestinationAddress,
+    ULONG AddressWords,
+    ULONG SourcePort,
+    ULONG DestinationPort
+    )
+
+/*++
+
+Routine Description:
+
+    This routine hashes a flow's addressing tuple. Received packets and the
+    sockets that read them must hash the same tuple the same way.
+
+Arguments:
+
+    Protocol - Supplies the IP protocol number of the flow.
+
+    SourceAddress - Supplies a pointer to the source address, in network
+        order.
+
+    DestinationAddress - Supplies a pointer to the destination address, in
+        network order.
+
+    AddressWords - Supplies the number of 32-bit words in each address.
+
+    SourcePort - Supplies the source port, in host order.
+
+    DestinationPort - Supplies the destination port, in host order.
+
+Return Value:
+
+    Returns the flow hash.
+
+--*/
+
+{
+
+    ULONG Hash;
+    ULONG Index;
+
+    Hash = NetReceiveFlowHashSeed ^ Protocol;
+    for (Index = 0; Index < AddressWords; Index += 1) {
+        Hash = (Hash ^ SourceAddress[Index]) * NET_FLOW_HASH_MULTIPLIER;
+        Hash ^= Hash >> 16;
+        Hash = (Hash ^ DestinationAddress[Index]) * NET_FLOW_HASH_MULTIPLIER;
+        Hash ^= Hash >> 16;
+    }
+
+    Hash = (Hash ^ ((SourcePort << 16) | (DestinationPort & 0xFFFF))) *
+           NET_FLOW_HASH_MULTIPLIER;
+
+    Hash ^= Hash >> 16;
+    return Hash;
+}
+
@@ -127,7 +127,8 @@ KSTATUS
 NetpTcpAccept (
     PNET_SOCKET Socket,
     PIO_HANDLE *NewConnectionSocket,
-    PNETWORK_ADDRESS RemoteAddress
+    PNETWORK_ADDRESS RemoteAddress,
+    ULONG TimeoutInMilliseconds
     );
 
 KSTATUS
@@ -1014,7 +1015,8 @@ KSTATUS
 NetpTcpAccept (
     PNET_SOCKET Socket,
     PIO_HANDLE *NewConnectionSocket,
-    PNETWORK_ADDRESS RemoteAddress
+    PNETWORK_ADDRESS RemoteAddress,
+    ULONG TimeoutInMilliseconds
     )
 
 /*++
@@ -1035,6 +1037,10 @@ Routine Description:
     RemoteAddress - Supplies a pointer where the address of the connected
         remote host will be returned.
 
+    TimeoutInMilliseconds - Supplies the number of milliseconds to wait for
+        a connection to come in. Use WAIT_TIME_INDEFINITE to wait forever.
+        A non-blocking socket never waits, regardless of this value.
+
 Return Value:
 
     Status code.
@@ -1065,7 +1071,7 @@ Return Value:
         goto TcpAcceptEnd;
     }
 
-    Timeout = WAIT_TIME_INDEFINITE;
+    Timeout = TimeoutInMilliseconds;
     OpenFlags = IoGetIoHandleOpenFlags(Socket->KernelSocket.IoHandle);
     if ((OpenFlags & OPEN_FLAG_NON_BLOCKING) != 0) {
         Timeout = 0;
@@ -0,0 +1,48 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    tmpfs
+
+Abstract:
+
+    This module implements the in-memory temporary file system.
+
+Author:
+
+    agent 19-Oct-2026
+
+Environment:
+
+    Kernel
+
+--*/
+
+from menv import driver;
+
+function build() {
+    var drv;
+    var entries;
+    var name = "tmpfs";
+    var sources;
+
+    sources = [
+        "tmpfs.c"
+    ];
+
+    drv = {
+        "label": name,
+        "inputs": sources,
+    };
+
+    entries = driver(drv);
+    return entries;
+}
+
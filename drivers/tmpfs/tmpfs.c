@@ -0,0 +1,2830 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    tmpfs.c
+
+Abstract:
+
+    This module implements the in-memory temporary file system. File data is
+    kept in pageable page-sized chunks that are only allocated when written,
+    so files may be sparse. Metadata lives in pool. Nothing survives a reboot.
+
+Author:
+
+    agent 19-Oct-2026
+
+Environment:
+
+    Kernel
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <minoca/kernel/driver.h>
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+#define TMPFS_ALLOCATION_TAG 0x73666D54 // 'sfmT'
+
+//
+// Define the device ID of the root enumerated device that tmpfs volumes are
+// created on.
+//
+
+#define TMPFS_DEVICE_ID "tmpfs"
+
+//
+// Define the file ID of the root directory. File IDs are never reused.
+//
+
+#define TMPFS_ROOT_FILE_ID 1
+
+//
+// Define the maximum length of a single file name, not including the null
+// terminator.
+//
+
+#define TMPFS_MAX_NAME_LENGTH 255
+
+//
+// Define the percentage of physical memory a volume can fill with file data.
+//
+
+#define TMPFS_MAX_MEMORY_PERCENT 50
+
+//
+// Define the percentage of kernel virtual address space a volume can fill
+// with file data. Data pages live in paged pool, so on systems with a small
+// kernel address space this is usually the tighter limit.
+//
+
+#define TMPFS_MAX_VIRTUAL_MEMORY_PERCENT 10
+
+//
+// Define the permissions of the root directory, which are the same as a
+// typical /tmp.
+//
+
+#define TMPFS_ROOT_PERMISSIONS \
+    (FILE_PERMISSION_ALL | FILE_PERMISSION_RESTRICTED)
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+typedef enum _TMPFS_OBJECT_TYPE {
+    TmpfsObjectInvalid,
+    TmpfsObjectDevice,
+    TmpfsObjectVolume
+} TMPFS_OBJECT_TYPE, *PTMPFS_OBJECT_TYPE;
+
+/*++
+
+Structure Description:
+
+    This structure stores information about the raw tmpfs device that volumes
+    are created on.
+
+Members:
+
+    Type - Stores the type of object, TmpfsObjectDevice.
+
+--*/
+
+typedef struct _TMPFS_DEVICE {
+    TMPFS_OBJECT_TYPE Type;
+} TMPFS_DEVICE, *PTMPFS_DEVICE;
+
+/*++
+
+Structure Description:
+
+    This structure stores information about a tmpfs volume.
+
+Members:
+
+    Type - Stores the type of object, TmpfsObjectVolume.
+
+    Lock - Stores a pointer to the lock that protects every node, directory
+        entry, and page on the volume.
+
+    NodeTree - Stores the tree of nodes on the volume, keyed by file ID.
+
+    Root - Stores a pointer to the root directory node.
+
+    NextFileId - Stores the file ID to hand out to the next created node.
+
+    PageCount - Stores the number of data pages allocated on the volume.
+
+    MaxPageCount - Stores the number of data pages the volume is allowed to
+        allocate. This is the smaller of the physical memory and kernel
+        virtual address space limits.
+
+    ReferenceCount - Stores the reference count of the volume.
+
+--*/
+
+typedef struct _TMPFS_VOLUME {
+    TMPFS_OBJECT_TYPE Type;
+    PSHARED_EXCLUSIVE_LOCK Lock;
+    RED_BLACK_TREE NodeTree;
+    struct _TMPFS_NODE *Root;
+    FILE_ID NextFileId;
+    UINTN PageCount;
+    UINTN MaxPageCount;
+    volatile ULONG ReferenceCount;
+} TMPFS_VOLUME, *PTMPFS_VOLUME;
+
+/*++
+
+Structure Description:
+
+    This structure stores a file, directory, or other object on a tmpfs volume.
+
+Members:
+
+    TreeNode - Stores the node's entry in the volume's node tree.
+
+    Properties - Stores the file properties of the node. The hard link count
+        is the number of directory entries that refer to this node.
+
+    EntryTree - Stores the tree of directory entries, keyed by directory
+        offset, if this node is a directory.
+
+    NextEntryOffset - Stores the directory offset to assign to the next entry
+        added to this directory.
+
+    PageTree - Stores the tree of allocated data pages, keyed by page index.
+        Pages missing from the tree are holes and read as zero.
+
+    PageCount - Stores the number of data pages allocated for this node.
+
+--*/
+
+typedef struct _TMPFS_NODE {
+    RED_BLACK_TREE_NODE TreeNode;
+    FILE_PROPERTIES Properties;
+    RED_BLACK_TREE EntryTree;
+    ULONGLONG NextEntryOffset;
+    RED_BLACK_TREE PageTree;
+    UINTN PageCount;
+} TMPFS_NODE, *PTMPFS_NODE;
+
+/*++
+
+Structure Description:
+
+    This structure stores a directory entry on a tmpfs volume. The null
+    terminated name immediately follows this structure.
+
+Members:
+
+    TreeNode - Stores the entry's node in the directory's entry tree.
+
+    Offset - Stores the directory offset of the entry. Offsets are never
+        reused within a directory, so enumeration can resume after entries are
+        added or removed.
+
+    Node - Stores a pointer to the node this entry names.
+
+    NameLength - Stores the length of the name, not including the null
+        terminator.
+
+--*/
+
+typedef struct _TMPFS_DIRECTORY_ENTRY {
+    RED_BLACK_TREE_NODE TreeNode;
+    ULONGLONG Offset;
+    PTMPFS_NODE Node;
+    ULONG NameLength;
+} TMPFS_DIRECTORY_ENTRY, *PTMPFS_DIRECTORY_ENTRY;
+
+/*++
+
+Structure Description:
+
+    This structure stores one page of file data on a tmpfs volume.
+
+Members:
+
+    TreeNode - Stores the page's node in the file's page tree.
+
+    Index - Stores the page index within the file.
+
+    Data - Stores a pointer to the page of data, allocated from paged pool.
+        The page cache keeps its own copy of recently used pages. Holding the
+        page cache entries here instead would pin the file object through
+        their references, and would keep the data from ever being paged out.
+
+--*/
+
+typedef struct _TMPFS_PAGE {
+    RED_BLACK_TREE_NODE TreeNode;
+    ULONGLONG Index;
+    PVOID Data;
+} TMPFS_PAGE, *PTMPFS_PAGE;
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+KSTATUS
+TmpfsAddDevice (
+    PVOID Driver,
+    PCSTR DeviceId,
+    PCSTR ClassId,
+    PCSTR CompatibleIds,
+    PVOID DeviceToken
+    );
+
+VOID
+TmpfsDispatchStateChange (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    );
+
+VOID
+TmpfsDispatchOpen (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    );
+
+VOID
+TmpfsDispatchClose (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    );
+
+VOID
+TmpfsDispatchIo (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    );
+
+VOID
+TmpfsDispatchSystemControl (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    );
+
+VOID
+TmpfspDispatchDeviceSystemControl (
+    PIRP Irp,
+    PTMPFS_DEVICE Device
+    );
+
+KSTATUS
+TmpfspCreateVolume (
+    PTMPFS_VOLUME *Volume
+    );
+
+VOID
+TmpfspVolumeAddReference (
+    PTMPFS_VOLUME Volume
+    );
+
+VOID
+TmpfspVolumeReleaseReference (
+    PTMPFS_VOLUME Volume
+    );
+
+VOID
+TmpfspDestroyVolume (
+    PTMPFS_VOLUME Volume
+    );
+
+PTMPFS_NODE
+TmpfspCreateNode (
+    PTMPFS_VOLUME Volume,
+    PFILE_PROPERTIES Properties
+    );
+
+VOID
+TmpfspDestroyNode (
+    PTMPFS_VOLUME Volume,
+    PTMPFS_NODE Node
+    );
+
+PTMPFS_NODE
+TmpfspLookupNode (
+    PTMPFS_VOLUME Volume,
+    FILE_ID FileId
+    );
+
+VOID
+TmpfspGetNodeProperties (
+    PTMPFS_VOLUME Volume,
+    PTMPFS_NODE Node,
+    PFILE_PROPERTIES Properties
+    );
+
+KSTATUS
+TmpfspLookup (
+    PTMPFS_VOLUME Volume,
+    PSYSTEM_CONTROL_LOOKUP Lookup
+    );
+
+KSTATUS
+TmpfspCreate (
+    PTMPFS_VOLUME Volume,
+    PSYSTEM_CONTROL_CREATE Create
+    );
+
+KSTATUS
+TmpfspLink (
+    PTMPFS_VOLUME Volume,
+    PSYSTEM_CONTROL_LINK Link
+    );
+
+KSTATUS
+TmpfspUnlink (
+    PTMPFS_VOLUME Volume,
+    PSYSTEM_CONTROL_UNLINK Unlink
+    );
+
+KSTATUS
+TmpfspRename (
+    PTMPFS_VOLUME Volume,
+    PSYSTEM_CONTROL_RENAME Rename
+    );
+
+KSTATUS
+TmpfspValidateName (
+    PCSTR Name,
+    ULONG NameSize,
+    PULONG NameLength
+    );
+
+PTMPFS_DIRECTORY_ENTRY
+TmpfspFindEntry (
+    PTMPFS_NODE Directory,
+    PCSTR Name,
+    ULONG NameSize
+    );
+
+KSTATUS
+TmpfspAddEntry (
+    PTMPFS_NODE Directory,
+    PCSTR Name,
+    ULONG NameLength,
+    PTMPFS_NODE Node
+    );
+
+VOID
+TmpfspRemoveEntry (
+    PTMPFS_NODE Directory,
+    PTMPFS_DIRECTORY_ENTRY Entry
+    );
+
+BOOL
+TmpfspIsDirectoryEmpty (
+    PTMPFS_NODE Node
+    );
+
+KSTATUS
+TmpfspEnumerateDirectory (
+    PTMPFS_NODE Directory,
+    PIRP_READ_WRITE ReadWrite
+    );
+
+KSTATUS
+TmpfspPerformIo (
+    PTMPFS_VOLUME Volume,
+    PTMPFS_NODE Node,
+    PIRP_READ_WRITE ReadWrite,
+    BOOL Write
+    );
+
+PTMPFS_PAGE
+TmpfspLookupPage (
+    PTMPFS_NODE Node,
+    ULONGLONG Index
+    );
+
+KSTATUS
+TmpfspAllocatePage (
+    PTMPFS_VOLUME Volume,
+    PTMPFS_NODE Node,
+    ULONGLONG Index,
+    PTMPFS_PAGE *NewPage
+    );
+
+VOID
+TmpfspFreePage (
+    PTMPFS_VOLUME Volume,
+    PTMPFS_NODE Node,
+    PTMPFS_PAGE Page
+    );
+
+VOID
+TmpfspTruncate (
+    PTMPFS_VOLUME Volume,
+    PTMPFS_NODE Node,
+    ULONGLONG NewSize
+    );
+
+COMPARISON_RESULT
+TmpfspCompareNodes (
+    PRED_BLACK_TREE Tree,
+    PRED_BLACK_TREE_NODE FirstNode,
+    PRED_BLACK_TREE_NODE SecondNode
+    );
+
+COMPARISON_RESULT
+TmpfspCompareEntries (
+    PRED_BLACK_TREE Tree,
+    PRED_BLACK_TREE_NODE FirstNode,
+    PRED_BLACK_TREE_NODE SecondNode
+    );
+
+COMPARISON_RESULT
+TmpfspComparePages (
+    PRED_BLACK_TREE Tree,
+    PRED_BLACK_TREE_NODE FirstNode,
+    PRED_BLACK_TREE_NODE SecondNode
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+PDRIVER TmpfsDriver = NULL;
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+__USED
+KSTATUS
+DriverEntry (
+    PDRIVER Driver
+    )
+
+/*++
+
+Routine Description:
+
+    This routine is the entry point for the tmpfs driver. It registers its
+    other dispatch functions, and registers itself as a file system.
+
+Arguments:
+
+    Driver - Supplies a pointer to the driver object.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    Failure code on error.
+
+--*/
+
+{
+
+    DRIVER_FUNCTION_TABLE FunctionTable;
+    KSTATUS Status;
+
+    TmpfsDriver = Driver;
+    RtlZeroMemory(&FunctionTable, sizeof(DRIVER_FUNCTION_TABLE));
+    FunctionTable.Version = DRIVER_FUNCTION_TABLE_VERSION;
+    FunctionTable.AddDevice = TmpfsAddDevice;
+    FunctionTable.DispatchStateChange = TmpfsDispatchStateChange;
+    FunctionTable.DispatchOpen = TmpfsDispatchOpen;
+    FunctionTable.DispatchClose = TmpfsDispatchClose;
+    FunctionTable.DispatchIo = TmpfsDispatchIo;
+    FunctionTable.DispatchSystemControl = TmpfsDispatchSystemControl;
+    Status = IoRegisterDriverFunctions(Driver, &FunctionTable);
+    if (!KSUCCESS(Status)) {
+        goto DriverEntryEnd;
+    }
+
+    Status = IoRegisterFileSystem(Driver);
+    if (!KSUCCESS(Status)) {
+        goto DriverEntryEnd;
+    }
+
+DriverEntryEnd:
+    return Status;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+KSTATUS
+TmpfsAddDevice (
+    PVOID Driver,
+    PCSTR DeviceId,
+    PCSTR ClassId,
+    PCSTR CompatibleIds,
+    PVOID DeviceToken
+    )
+
+/*++
+
+Routine Description:
+
+    This routine is called both when the root enumerated tmpfs device is
+    detected and when any volume is detected. The driver attaches as the
+    function driver of the tmpfs device, which it marks mountable, and as the
+    file system of volumes created on top of that device.
+
+Arguments:
+
+    Driver - Supplies a pointer to the driver being called.
+
+    DeviceId - Supplies a pointer to a string with the device ID.
+
+    ClassId - Supplies a pointer to a string containing the device's class ID.
+
+    CompatibleIds - Supplies a pointer to a string containing device IDs
+        that would be compatible with this device.
+
+    DeviceToken - Supplies an opaque token that the driver can use to identify
+        the device in the system. This token should be used when attaching to
+        the stack.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    Failure code if the driver was unsuccessful in attaching itself.
+
+--*/
+
+{
+
+    PTMPFS_DEVICE Device;
+    KSTATUS Status;
+    PDEVICE TargetDevice;
+    PTMPFS_VOLUME Volume;
+
+    Device = NULL;
+    Volume = NULL;
+
+    //
+    // Attach to the raw tmpfs device and make it mountable so the system
+    // creates a volume for it.
+    //
+
+    if (IoAreDeviceIdsEqual(DeviceId, TMPFS_DEVICE_ID) != FALSE) {
+        Device = MmAllocateNonPagedPool(sizeof(TMPFS_DEVICE),
+                                        TMPFS_ALLOCATION_TAG);
+
+        if (Device == NULL) {
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+            goto AddDeviceEnd;
+        }
+
+        Device->Type = TmpfsObjectDevice;
+        Status = IoAttachDriverToDevice(Driver, DeviceToken, Device);
+        if (!KSUCCESS(Status)) {
+            goto AddDeviceEnd;
+        }
+
+        IoSetDeviceMountable(DeviceToken);
+        goto AddDeviceEnd;
+    }
+
+    //
+    // Otherwise this is a volume. Only claim volumes on the tmpfs device.
+    //
+
+    TargetDevice = IoGetTargetDevice(DeviceToken);
+    if ((TargetDevice == NULL) ||
+        (IoAreDeviceIdsEqual(IoGetDeviceId(TargetDevice), TMPFS_DEVICE_ID) ==
+         FALSE)) {
+
+        Status = STATUS_NOT_SUPPORTED;
+        goto AddDeviceEnd;
+    }
+
+    Status = TmpfspCreateVolume(&Volume);
+    if (!KSUCCESS(Status)) {
+        goto AddDeviceEnd;
+    }
+
+    Status = IoAttachDriverToDevice(Driver, DeviceToken, Volume);
+    if (!KSUCCESS(Status)) {
+        goto AddDeviceEnd;
+    }
+
+AddDeviceEnd:
+    if (!KSUCCESS(Status)) {
+        if (Device != NULL) {
+            MmFreeNonPagedPool(Device);
+        }
+
+        if (Volume != NULL) {
+            TmpfspVolumeReleaseReference(Volume);
+        }
+    }
+
+    return Status;
+}
+
+VOID
+TmpfsDispatchStateChange (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    )
+
+/*++
+
+Routine Description:
+
+    This routine handles State Change IRPs.
+
+Arguments:
+
+    Irp - Supplies a pointer to the I/O request packet.
+
+    DeviceContext - Supplies the context pointer supplied by the driver when it
+        attached itself to the driver stack. Presumably this pointer contains
+        driver-specific device context.
+
+    IrpContext - Supplies the context pointer supplied by the driver when
+        the IRP was created.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PTMPFS_OBJECT_TYPE Type;
+
+    ASSERT(Irp->MajorCode == IrpMajorStateChange);
+
+    //
+    // The tmpfs device has no bus driver below it, so it completes every state
+    // change IRP itself on the way back up.
+    //
+
+    Type = DeviceContext;
+    if (*Type == TmpfsObjectDevice) {
+        if (Irp->Direction == IrpUp) {
+            switch (Irp->MinorCode) {
+            case IrpMinorQueryResources:
+            case IrpMinorStartDevice:
+            case IrpMinorQueryChildren:
+                IoCompleteIrp(TmpfsDriver, Irp, STATUS_SUCCESS);
+                break;
+
+            case IrpMinorRemoveDevice:
+                MmFreeNonPagedPool(DeviceContext);
+                IoCompleteIrp(TmpfsDriver, Irp, STATUS_SUCCESS);
+                break;
+
+            default:
+                break;
+            }
+        }
+
+        return;
+    }
+
+    ASSERT(*Type == TmpfsObjectVolume);
+
+    if (Irp->Direction == IrpDown) {
+        switch (Irp->MinorCode) {
+        case IrpMinorQueryResources:
+        case IrpMinorStartDevice:
+            IoCompleteIrp(TmpfsDriver, Irp, STATUS_SUCCESS);
+            break;
+
+        case IrpMinorQueryChildren:
+            Irp->U.QueryChildren.ChildCount = 0;
+            Irp->U.QueryChildren.Children = NULL;
+            IoCompleteIrp(TmpfsDriver, Irp, STATUS_SUCCESS);
+            break;
+
+        //
+        // Drop the initial reference on the volume. Everything on it is
+        // destroyed once the last open file is closed.
+        //
+
+        case IrpMinorRemoveDevice:
+            TmpfspVolumeReleaseReference(DeviceContext);
+            IoCompleteIrp(TmpfsDriver, Irp, STATUS_SUCCESS);
+            break;
+
+        default:
+
+            ASSERT(FALSE);
+
+            IoCompleteIrp(TmpfsDriver, Irp, STATUS_NOT_SUPPORTED);
+            break;
+        }
+    }
+
+    return;
+}
+
+VOID
+TmpfsDispatchOpen (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    )
+
+/*++
+
+Routine Description:
+
+    This routine handles Open IRPs.
+
+Arguments:
+
+    Irp - Supplies a pointer to the I/O request packet.
+
+    DeviceContext - Supplies the context pointer supplied by the driver when it
+        attached itself to the driver stack. Presumably this pointer contains
+        driver-specific device context.
+
+    IrpContext - Supplies the context pointer supplied by the driver when
+        the IRP was created.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PTMPFS_NODE Node;
+    KSTATUS Status;
+    PTMPFS_VOLUME Volume;
+
+    ASSERT(Irp->MajorCode == IrpMajorOpen);
+
+    //
+    // The raw device holds no data of its own. Failing the open also keeps
+    // other file systems from trying to mount it.
+    //
+
+    Volume = DeviceContext;
+    if (Volume->Type != TmpfsObjectVolume) {
+        IoCompleteIrp(TmpfsDriver, Irp, STATUS_NOT_SUPPORTED);
+        return;
+    }
+
+    //
+    // Everything here is already in memory, so there is no page file support.
+    //
+
+    if ((Irp->U.Open.OpenFlags & OPEN_FLAG_PAGE_FILE) != 0) {
+        IoCompleteIrp(TmpfsDriver, Irp, STATUS_NO_ELIGIBLE_DEVICES);
+        return;
+    }
+
+    KeAcquireSharedExclusiveLockShared(Volume->Lock);
+    Node = TmpfspLookupNode(Volume, Irp->U.Open.FileProperties->FileId);
+    KeReleaseSharedExclusiveLockShared(Volume->Lock);
+    if (Node == NULL) {
+        Status = STATUS_PATH_NOT_FOUND;
+
+    } else {
+        TmpfspVolumeAddReference(Volume);
+        Irp->U.Open.DeviceContext = NULL;
+        Status = STATUS_SUCCESS;
+    }
+
+    IoCompleteIrp(TmpfsDriver, Irp, Status);
+    return;
+}
+
+VOID
+TmpfsDispatchClose (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    )
+
+/*++
+
+Routine Description:
+
+    This routine handles Close IRPs.
+
+Arguments:
+
+    Irp - Supplies a pointer to the I/O request packet.
+
+    DeviceContext - Supplies the context pointer supplied by the driver when it
+        attached itself to the driver stack. Presumably this pointer contains
+        driver-specific device context.
+
+    IrpContext - Supplies the context pointer supplied by the driver when
+        the IRP was created.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PTMPFS_VOLUME Volume;
+
+    ASSERT(Irp->MajorCode == IrpMajorClose);
+
+    Volume = DeviceContext;
+
+    ASSERT(Volume->Type == TmpfsObjectVolume);
+
+    TmpfspVolumeReleaseReference(Volume);
+    IoCompleteIrp(TmpfsDriver, Irp, STATUS_SUCCESS);
+    return;
+}
+
+VOID
+TmpfsDispatchIo (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    )
+
+/*++
+
+Routine Description:
+
+    This routine handles I/O IRPs.
+
+Arguments:
+
+    Irp - Supplies a pointer to the I/O request packet.
+
+    DeviceContext - Supplies the context pointer supplied by the driver when it
+        attached itself to the driver stack. Presumably this pointer contains
+        driver-specific device context.
+
+    IrpContext - Supplies the context pointer supplied by the driver when
+        the IRP was created.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PTMPFS_NODE Node;
+    PIRP_READ_WRITE ReadWrite;
+    KSTATUS Status;
+    PTMPFS_VOLUME Volume;
+    BOOL Write;
+
+    ASSERT(Irp->Direction == IrpDown);
+    ASSERT(Irp->MajorCode == IrpMajorIo);
+
+    Volume = DeviceContext;
+    if (Volume->Type != TmpfsObjectVolume) {
+        IoCompleteIrp(TmpfsDriver, Irp, STATUS_NOT_SUPPORTED);
+        return;
+    }
+
+    ReadWrite = &(Irp->U.ReadWrite);
+
+    ASSERT(ReadWrite->IoBuffer != NULL);
+    ASSERT(ReadWrite->FileProperties != NULL);
+
+    Write = FALSE;
+    if (Irp->MinorCode == IrpMinorIoWrite) {
+        Write = TRUE;
+    }
+
+    //
+    // Reads share the volume lock. Writes may allocate pages, which changes
+    // the page trees and the volume's page count.
+    //
+
+    if (Write != FALSE) {
+        KeAcquireSharedExclusiveLockExclusive(Volume->Lock);
+
+    } else {
+        KeAcquireSharedExclusiveLockShared(Volume->Lock);
+    }
+
+    Node = TmpfspLookupNode(Volume, ReadWrite->FileProperties->FileId);
+    if (Node == NULL) {
+        Status = STATUS_PATH_NOT_FOUND;
+        goto DispatchIoEnd;
+    }
+
+    //
+    // Directories cannot be written to directly, and reading them enumerates
+    // their entries.
+    //
+
+    if (Node->Properties.Type == IoObjectRegularDirectory) {
+        if (Write != FALSE) {
+            Status = STATUS_ACCESS_DENIED;
+
+        } else {
+            Status = TmpfspEnumerateDirectory(Node, ReadWrite);
+        }
+
+        goto DispatchIoEnd;
+    }
+
+    Status = TmpfspPerformIo(Volume, Node, ReadWrite, Write);
+
+DispatchIoEnd:
+    if (Write != FALSE) {
+        KeReleaseSharedExclusiveLockExclusive(Volume->Lock);
+
+    } else {
+        KeReleaseSharedExclusiveLockShared(Volume->Lock);
+    }
+
+    IoCompleteIrp(TmpfsDriver, Irp, Status);
+    return;
+}
+
+VOID
+TmpfsDispatchSystemControl (
+    PIRP Irp,
+    PVOID DeviceContext,
+    PVOID IrpContext
+    )
+
+/*++
+
+Routine Description:
+
+    This routine handles System Control IRPs.
+
+Arguments:
+
+    Irp - Supplies a pointer to the I/O request packet.
+
+    DeviceContext - Supplies the context pointer supplied by the driver when it
+        attached itself to the driver stack. Presumably this pointer contains
+        driver-specific device context.
+
+    IrpContext - Supplies the context pointer supplied by the driver when
+        the IRP was created.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PVOID Context;
+    PSYSTEM_CONTROL_FILE_OPERATION FileOperation;
+    PTMPFS_NODE Node;
+    PFILE_PROPERTIES Properties;
+    KSTATUS Status;
+    PSYSTEM_CONTROL_TRUNCATE Truncate;
+    PTMPFS_VOLUME Volume;
+
+    ASSERT(Irp->MajorCode == IrpMajorSystemControl);
+
+    Volume = DeviceContext;
+    if (Volume->Type != TmpfsObjectVolume) {
+        TmpfspDispatchDeviceSystemControl(Irp, DeviceContext);
+        return;
+    }
+
+    Context = Irp->U.SystemControl.SystemContext;
+    switch (Irp->MinorCode) {
+    case IrpMinorSystemControlLookup:
+        KeAcquireSharedExclusiveLockShared(Volume->Lock);
+        Status = TmpfspLookup(Volume, Context);
+        KeReleaseSharedExclusiveLockShared(Volume->Lock);
+        IoCompleteIrp(TmpfsDriver, Irp, Status);
+        break;
+
+    case IrpMinorSystemControlCreate:
+        KeAcquireSharedExclusiveLockExclusive(Volume->Lock);
+        Status = TmpfspCreate(Volume, Context);
+        KeReleaseSharedExclusiveLockExclusive(Volume->Lock);
+        IoCompleteIrp(TmpfsDriver, Irp, Status);
+        break;
+
+    case IrpMinorSystemControlLink:
+        KeAcquireSharedExclusiveLockExclusive(Volume->Lock);
+        Status = TmpfspLink(Volume, Context);
+        KeReleaseSharedExclusiveLockExclusive(Volume->Lock);
+        IoCompleteIrp(TmpfsDriver, Irp, Status);
+        break;
+
+    case IrpMinorSystemControlUnlink:
+        KeAcquireSharedExclusiveLockExclusive(Volume->Lock);
+        Status = TmpfspUnlink(Volume, Context);
+        KeReleaseSharedExclusiveLockExclusive(Volume->Lock);
+        IoCompleteIrp(TmpfsDriver, Irp, Status);
+        break;
+
+    case IrpMinorSystemControlRename:
+        KeAcquireSharedExclusiveLockExclusive(Volume->Lock);
+        Status = TmpfspRename(Volume, Context);
+        KeReleaseSharedExclusiveLockExclusive(Volume->Lock);
+        IoCompleteIrp(TmpfsDriver, Irp, Status);
+        break;
+
+    //
+    // The system is done with a node that has no more directory entries.
+    // Release its data and let the file ID go.
+    //
+
+    case IrpMinorSystemControlDelete:
+        FileOperation = (PSYSTEM_CONTROL_FILE_OPERATION)Context;
+
+        ASSERT(FileOperation->FileProperties->HardLinkCount == 0);
+        ASSERT(FileOperation->FileProperties->FileId != TMPFS_ROOT_FILE_ID);
+
+        KeAcquireSharedExclusiveLockExclusive(Volume->Lock);
+        Node = TmpfspLookupNode(Volume, FileOperation->FileProperties->FileId);
+        if ((Node != NULL) && (Node->Properties.HardLinkCount == 0)) {
+            TmpfspDestroyNode(Volume, Node);
+        }
+
+        KeReleaseSharedExclusiveLockExclusive(Volume->Lock);
+        IoCompleteIrp(TmpfsDriver, Irp, STATUS_SUCCESS);
+        break;
+
+    //
+    // Save the properties the system has changed. The size of directories and
+    // the hard link count are owned by the file system.
+    //
+
+    case IrpMinorSystemControlWriteFileProperties:
+        FileOperation = (PSYSTEM_CONTROL_FILE_OPERATION)Context;
+        Properties = FileOperation->FileProperties;
+        KeAcquireSharedExclusiveLockExclusive(Volume->Lock);
+        Node = TmpfspLookupNode(Volume, Properties->FileId);
+        if (Node != NULL) {
+            Node->Properties.Permissions = Properties->Permissions;
+            Node->Properties.UserId = Properties->UserId;
+            Node->Properties.GroupId = Properties->GroupId;
+            Node->Properties.RelatedDevice = Properties->RelatedDevice;
+            Node->Properties.AccessTime = Properties->AccessTime;
+            Node->Properties.ModifiedTime = Properties->ModifiedTime;
+            Node->Properties.StatusChangeTime = Properties->StatusChangeTime;
+            Node->Properties.CreationTime = Properties->CreationTime;
+            Node->Properties.Flags = Properties->Flags;
+            Node->Properties.Generation = Properties->Generation;
+            if (Node->Properties.Type != IoObjectRegularDirectory) {
+                Node->Properties.Size = Properties->Size;
+            }
+        }
+
+        KeReleaseSharedExclusiveLockExclusive(Volume->Lock);
+        IoCompleteIrp(TmpfsDriver, Irp, STATUS_SUCCESS);
+        break;
+
+    case IrpMinorSystemControlTruncate:
+        Truncate = (PSYSTEM_CONTROL_TRUNCATE)Context;
+        Properties = Truncate->FileProperties;
+        KeAcquireSharedExclusiveLockExclusive(Volume->Lock);
+        Node = TmpfspLookupNode(Volume, Properties->FileId);
+        if (Node == NULL) {
+            Status = STATUS_PATH_NOT_FOUND;
+
+        } else if (Node->Properties.Type == IoObjectRegularDirectory) {
+            Status = STATUS_FILE_IS_DIRECTORY;
+
+        } else {
+            TmpfspTruncate(Volume, Node, Truncate->NewSize);
+            Properties->Size = Truncate->NewSize;
+            Status = STATUS_SUCCESS;
+        }
+
+        KeReleaseSharedExclusiveLockExclusive(Volume->Lock);
+        IoCompleteIrp(TmpfsDriver, Irp, Status);
+        break;
+
+    //
+    // There are no disk blocks behind a tmpfs file.
+    //
+
+    case IrpMinorSystemControlGetBlockInformation:
+    case IrpMinorSystemControlDeviceInformation:
+        IoCompleteIrp(TmpfsDriver, Irp, STATUS_NOT_SUPPORTED);
+        break;
+
+    case IrpMinorSystemControlSynchronize:
+        IoCompleteIrp(TmpfsDriver, Irp, STATUS_SUCCESS);
+        break;
+
+    //
+    // Ignore everything unrecognized.
+    //
+
+    default:
+        break;
+    }
+
+    return;
+}
+
+VOID
+TmpfspDispatchDeviceSystemControl (
+    PIRP Irp,
+    PTMPFS_DEVICE Device
+    )
+
+/*++
+
+Routine Description:
+
+    This routine handles System Control IRPs sent to the raw tmpfs device.
+
+Arguments:
+
+    Irp - Supplies a pointer to the I/O request packet.
+
+    Device - Supplies a pointer to the raw tmpfs device.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PVOID Context;
+    PSYSTEM_CONTROL_LOOKUP Lookup;
+    PFILE_PROPERTIES Properties;
+    KSTATUS Status;
+
+    Context = Irp->U.SystemControl.SystemContext;
+    switch (Irp->MinorCode) {
+
+    //
+    // Present the device as an empty block device, which is what the system
+    // expects to find underneath a mount.
+    //
+
+    case IrpMinorSystemControlLookup:
+        Lookup = (PSYSTEM_CONTROL_LOOKUP)Context;
+        Status = STATUS_PATH_NOT_FOUND;
+        if (Lookup->Root != FALSE) {
+            Properties = Lookup->Properties;
+            Properties->FileId = 0;
+            Properties->Type = IoObjectBlockDevice;
+            Properties->HardLinkCount = 1;
+            Properties->BlockSize = MmPageSize();
+            Properties->BlockCount = 0;
+            Properties->Size = 0;
+            Lookup->Flags = LOOKUP_FLAG_NO_PAGE_CACHE;
+            Status = STATUS_SUCCESS;
+        }
+
+        IoCompleteIrp(TmpfsDriver, Irp, Status);
+        break;
+
+    case IrpMinorSystemControlWriteFileProperties:
+    case IrpMinorSystemControlSynchronize:
+        IoCompleteIrp(TmpfsDriver, Irp, STATUS_SUCCESS);
+        break;
+
+    case IrpMinorSystemControlTruncate:
+    case IrpMinorSystemControlDeviceInformation:
+        IoCompleteIrp(TmpfsDriver, Irp, STATUS_NOT_SUPPORTED);
+        break;
+
+    default:
+        break;
+    }
+
+    return;
+}
+
+KSTATUS
+TmpfspCreateVolume (
+    PTMPFS_VOLUME *Volume
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates a new, empty tmpfs volume with a reference count of
+    one.
+
+Arguments:
+
+    Volume - Supplies a pointer where a pointer to the new volume will be
+        returned.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    UINTN MaxPageCount;
+    PTMPFS_VOLUME NewVolume;
+    FILE_PROPERTIES Properties;
+    KSTATUS Status;
+
+    NewVolume = MmAllocateNonPagedPool(sizeof(TMPFS_VOLUME),
+                                       TMPFS_ALLOCATION_TAG);
+
+    if (NewVolume == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto CreateVolumeEnd;
+    }
+
+    RtlZeroMemory(NewVolume, sizeof(TMPFS_VOLUME));
+    NewVolume->Type = TmpfsObjectVolume;
+    NewVolume->ReferenceCount = 1;
+    NewVolume->NextFileId = TMPFS_ROOT_FILE_ID;
+    NewVolume->MaxPageCount =
+              (MmGetTotalPhysicalPages() * TMPFS_MAX_MEMORY_PERCENT) / 100;
+
+    MaxPageCount = ((MmGetTotalVirtualMemory() >> MmPageShift()) *
+                    TMPFS_MAX_VIRTUAL_MEMORY_PERCENT) / 100;
+
+    if (NewVolume->MaxPageCount > MaxPageCount) {
+        NewVolume->MaxPageCount = MaxPageCount;
+    }
+
+    RtlRedBlackTreeInitialize(&(NewVolume->NodeTree), 0, TmpfspCompareNodes);
+    NewVolume->Lock = KeCreateSharedExclusiveLock();
+    if (NewVolume->Lock == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto CreateVolumeEnd;
+    }
+
+    RtlZeroMemory(&Properties, sizeof(FILE_PROPERTIES));
+    Properties.Type = IoObjectRegularDirectory;
+    Properties.Permissions = TMPFS_ROOT_PERMISSIONS;
+    KeGetSystemTime(&(Properties.CreationTime));
+    Properties.AccessTime = Properties.CreationTime;
+    Properties.ModifiedTime = Properties.CreationTime;
+    Properties.StatusChangeTime = Properties.CreationTime;
+    NewVolume->Root = TmpfspCreateNode(NewVolume, &Properties);
+    if (NewVolume->Root == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto CreateVolumeEnd;
+    }
+
+    //
+    // The root directory has no directory entry, but is always linked.
+    //
+
+    ASSERT(NewVolume->Root->Properties.FileId == TMPFS_ROOT_FILE_ID);
+
+    NewVolume->Root->Properties.HardLinkCount = 1;
+    Status = STATUS_SUCCESS;
+
+CreateVolumeEnd:
+    if (!KSUCCESS(Status)) {
+        if (NewVolume != NULL) {
+            TmpfspDestroyVolume(NewVolume);
+            NewVolume = NULL;
+        }
+    }
+
+    *Volume = NewVolume;
+    return Status;
+}
+
+VOID
+TmpfspVolumeAddReference (
+    PTMPFS_VOLUME Volume
+    )
+
+/*++
+
+Routine Description:
+
+    This routine increments the reference count on a tmpfs volume.
+
+Arguments:
+
+    Volume - Supplies a pointer to a tmpfs volume.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG OldReferenceCount;
+
+    OldReferenceCount = RtlAtomicAdd32(&(Volume->ReferenceCount), 1);
+
+    ASSERT((OldReferenceCount != 0) && (OldReferenceCount < 0x10000000));
+
+    return;
+}
+
+VOID
+TmpfspVolumeReleaseReference (
+    PTMPFS_VOLUME Volume
+    )
+
+/*++
+
+Routine Description:
+
+    This routine decrements the reference count on a tmpfs volume, destroying
+    it and all of its contents if the count reaches zero.
+
+Arguments:
+
+    Volume - Supplies a pointer to a tmpfs volume.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG OldReferenceCount;
+
+    OldReferenceCount = RtlAtomicAdd32(&(Volume->ReferenceCount), (ULONG)-1);
+
+    ASSERT((OldReferenceCount != 0) && (OldReferenceCount < 0x10000000));
+
+    if (OldReferenceCount == 1) {
+        TmpfspDestroyVolume(Volume);
+    }
+
+    return;
+}
+
+VOID
+TmpfspDestroyVolume (
+    PTMPFS_VOLUME Volume
+    )
+
+/*++
+
+Routine Description:
+
+    This routine destroys a tmpfs volume, freeing every node on it.
+
+Arguments:
+
+    Volume - Supplies a pointer to the volume to destroy.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PTMPFS_DIRECTORY_ENTRY Entry;
+    PRED_BLACK_TREE_NODE EntryTreeNode;
+    PTMPFS_NODE Node;
+    PRED_BLACK_TREE_NODE TreeNode;
+
+    //
+    // Remove all the directory entries first so every node can be destroyed
+    // without regard to order.
+    //
+
+    TreeNode = RtlRedBlackTreeGetLowestNode(&(Volume->NodeTree));
+    while (TreeNode != NULL) {
+        Node = RED_BLACK_TREE_VALUE(TreeNode, TMPFS_NODE, TreeNode);
+        EntryTreeNode = RtlRedBlackTreeGetLowestNode(&(Node->EntryTree));
+        while (EntryTreeNode != NULL) {
+            Entry = RED_BLACK_TREE_VALUE(EntryTreeNode,
+                                         TMPFS_DIRECTORY_ENTRY,
+                                         TreeNode);
+
+            TmpfspRemoveEntry(Node, Entry);
+            EntryTreeNode = RtlRedBlackTreeGetLowestNode(&(Node->EntryTree));
+        }
+
+        TreeNode = RtlRedBlackTreeGetNextNode(&(Volume->NodeTree),
+                                              FALSE,
+                                              TreeNode);
+    }
+
+    TreeNode = RtlRedBlackTreeGetLowestNode(&(Volume->NodeTree));
+    while (TreeNode != NULL) {
+        Node = RED_BLACK_TREE_VALUE(TreeNode, TMPFS_NODE, TreeNode);
+        TmpfspDestroyNode(Volume, Node);
+        TreeNode = RtlRedBlackTreeGetLowestNode(&(Volume->NodeTree));
+    }
+
+    ASSERT(Volume->PageCount == 0);
+
+    if (Volume->Lock != NULL) {
+        KeDestroySharedExclusiveLock(Volume->Lock);
+    }
+
+    MmFreeNonPagedPool(Volume);
+    return;
+}
+
+PTMPFS_NODE
+TmpfspCreateNode (
+    PTMPFS_VOLUME Volume,
+    PFILE_PROPERTIES Properties
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates a new node with no directory entries and inserts it
+    into the volume. This routine assumes the volume lock is held exclusively.
+
+Arguments:
+
+    Volume - Supplies a pointer to the volume.
+
+    Properties - Supplies a pointer to the initial properties of the node. The
+        file ID, size, block information, and hard link count are filled in
+        by this routine.
+
+Return Value:
+
+    Returns a pointer to the new node on success.
+
+    NULL on allocation failure.
+
+--*/
+
+{
+
+    PTMPFS_NODE Node;
+
+    Node = MmAllocatePagedPool(sizeof(TMPFS_NODE), TMPFS_ALLOCATION_TAG);
+    if (Node == NULL) {
+        return NULL;
+    }
+
+    RtlZeroMemory(Node, sizeof(TMPFS_NODE));
+    RtlCopyMemory(&(Node->Properties), Properties, sizeof(FILE_PROPERTIES));
+    Node->Properties.FileId = Volume->NextFileId;
+    Volume->NextFileId += 1;
+    Node->Properties.HardLinkCount = 0;
+    Node->Properties.Size = 0;
+    Node->Properties.BlockSize = MmPageSize();
+    Node->Properties.BlockCount = 0;
+    RtlRedBlackTreeInitialize(&(Node->EntryTree), 0, TmpfspCompareEntries);
+    Node->NextEntryOffset = DIRECTORY_CONTENTS_OFFSET;
+    RtlRedBlackTreeInitialize(&(Node->PageTree), 0, TmpfspComparePages);
+    RtlRedBlackTreeInsert(&(Volume->NodeTree), &(Node->TreeNode));
+    return Node;
+}
+
+VOID
+TmpfspDestroyNode (
+    PTMPFS_VOLUME Volume,
+    PTMPFS_NODE Node
+    )
+
+/*++
+
+Routine Description:
+
+    This routine removes a node from its volume and frees it along with all
+    of its data. The node must not have any directory entries. This routine
+    assumes the volume lock is held exclusively.
+
+Arguments:
+
+    Volume - Supplies a pointer to the volume.
+
+    Node - Supplies a pointer to the node to destroy.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ASSERT(TmpfspIsDirectoryEmpty(Node) != FALSE);
+
+    TmpfspTruncate(Volume, Node, 0);
+
+    ASSERT(Node->PageCount == 0);
+
+    RtlRedBlackTreeRemove(&(Volume->NodeTree), &(Node->TreeNode));
+    MmFreePagedPool(Node);
+    return;
+}
+
+PTMPFS_NODE
+TmpfspLookupNode (
+    PTMPFS_VOLUME Volume,
+    FILE_ID FileId
+    )
+
+/*++
+
+Routine Description:
+
+    This routine finds the node with the given file ID. This routine assumes
+    the volume lock is held.
+
+Arguments:
+
+    Volume - Supplies a pointer to the volume.
+
+    FileId - Supplies the file ID to look up.
+
+Return Value:
+
+    Returns a pointer to the node on success.
+
+    NULL if no node has the given file ID.
+
+--*/
+
+{
+
+    TMPFS_NODE SearchNode;
+    PRED_BLACK_TREE_NODE TreeNode;
+
+    SearchNode.Properties.FileId = FileId;
+    TreeNode = RtlRedBlackTreeSearch(&(Volume->NodeTree),
+                                     &(SearchNode.TreeNode));
+
+    if (TreeNode == NULL) {
+        return NULL;
+    }
+
+    return RED_BLACK_TREE_VALUE(TreeNode, TMPFS_NODE, TreeNode);
+}
+
+VOID
+TmpfspGetNodeProperties (
+    PTMPFS_VOLUME Volume,
+    PTMPFS_NODE Node,
+    PFILE_PROPERTIES Properties
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the current file properties of a node.
+
+Arguments:
+
+    Volume - Supplies a pointer to the volume.
+
+    Node - Supplies a pointer to the node.
+
+    Properties - Supplies a pointer where the properties will be returned.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    RtlCopyMemory(Properties, &(Node->Properties), sizeof(FILE_PROPERTIES));
+    Properties->BlockCount = Node->PageCount;
+    return;
+}
+
+KSTATUS
+TmpfspLookup (
+    PTMPFS_VOLUME Volume,
+    PSYSTEM_CONTROL_LOOKUP Lookup
+    )
+
+/*++
+
+Routine Description:
+
+    This routine looks up a name within a directory, or the root directory.
+    This routine assumes the volume lock is held.
+
+Arguments:
+
+    Volume - Supplies a pointer to the volume.
+
+    Lookup - Supplies a pointer to the lookup request.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    PTMPFS_NODE Directory;
+    PTMPFS_DIRECTORY_ENTRY Entry;
+
+    if (Lookup->Root != FALSE) {
+        TmpfspGetNodeProperties(Volume, Volume->Root, Lookup->Properties);
+        return STATUS_SUCCESS;
+    }
+
+    Directory = TmpfspLookupNode(Volume, Lookup->DirectoryProperties->FileId);
+    if ((Directory == NULL) ||
+        (Directory->Properties.Type != IoObjectRegularDirectory)) {
+
+        return STATUS_PATH_NOT_FOUND;
+    }
+
+    Entry = TmpfspFindEntry(Directory, Lookup->FileName, Lookup->FileNameSize);
+    if (Entry == NULL) {
+        return STATUS_PATH_NOT_FOUND;
+    }
+
+    TmpfspGetNodeProperties(Volume, Entry->Node, Lookup->Properties);
+    return STATUS_SUCCESS;
+}
+
+KSTATUS
+TmpfspCreate (
+    PTMPFS_VOLUME Volume,
+    PSYSTEM_CONTROL_CREATE Create
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates a new node and links it into a directory. This
+    routine assumes the volume lock is held exclusively.
+
+Arguments:
+
+    Volume - Supplies a pointer to the volume.
+
+    Create - Supplies a pointer to the create request.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    PTMPFS_NODE Directory;
+    ULONG NameLength;
+    PTMPFS_NODE Node;
+    KSTATUS Status;
+
+    Status = TmpfspValidateName(Create->Name, Create->NameSize, &NameLength);
+    if (!KSUCCESS(Status)) {
+        return Status;
+    }
+
+    Directory = TmpfspLookupNode(Volume, Create->DirectoryProperties->FileId);
+    if ((Directory == NULL) ||
+        (Directory->Properties.Type != IoObjectRegularDirectory)) {
+
+        return STATUS_PATH_NOT_FOUND;
+    }
+
+    if (TmpfspFindEntry(Directory, Create->Name, Create->NameSize) != NULL) {
+        return STATUS_FILE_EXISTS;
+    }
+
+    Node = TmpfspCreateNode(Volume, &(Create->FileProperties));
+    if (Node == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    Status = TmpfspAddEntry(Directory, Create->Name, NameLength, Node);
+    if (!KSUCCESS(Status)) {
+        TmpfspDestroyNode(Volume, Node);
+        return Status;
+    }
+
+    TmpfspGetNodeProperties(Volume, Node, &(Create->FileProperties));
+    Create->DirectorySize = Directory->Properties.Size;
+    return STATUS_SUCCESS;
+}
+
+KSTATUS
+TmpfspLink (
+    PTMPFS_VOLUME Volume,
+    PSYSTEM_CONTROL_LINK Link
+    )
+
+/*++
+
+Routine Description:
+
+    This routine adds a new directory entry for an existing node. This
+    routine assumes the volume lock is held exclusively.
+
+Arguments:
+
+    Volume - Supplies a pointer to the volume.
+
+    Link - Supplies a pointer to the link request.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    PTMPFS_NODE Directory;
+    ULONG NameLength;
+    PTMPFS_NODE Node;
+    KSTATUS Status;
+
+    Status = TmpfspValidateName(Link->Name, Link->NameSize, &NameLength);
+    if (!KSUCCESS(Status)) {
+        return Status;
+    }
+
+    Directory = TmpfspLookupNode(Volume, Link->DirectoryProperties->FileId);
+    Node = TmpfspLookupNode(Volume, Link->FileProperties->FileId);
+    if ((Directory == NULL) || (Node == NULL) ||
+        (Directory->Properties.Type != IoObjectRegularDirectory)) {
+
+        return STATUS_PATH_NOT_FOUND;
+    }
+
+    if (Node->Properties.Type == IoObjectRegularDirectory) {
+        return STATUS_FILE_IS_DIRECTORY;
+    }
+
+    if (TmpfspFindEntry(Directory, Link->Name, Link->NameSize) != NULL) {
+        return STATUS_FILE_EXISTS;
+    }
+
+    Status = TmpfspAddEntry(Directory, Link->Name, NameLength, Node);
+    if (!KSUCCESS(Status)) {
+        return Status;
+    }
+
+    Link->DirectorySize = Directory->Properties.Size;
+    return STATUS_SUCCESS;
+}
+
+KSTATUS
+TmpfspUnlink (
+    PTMPFS_VOLUME Volume,
+    PSYSTEM_CONTROL_UNLINK Unlink
+    )
+
+/*++
+
+Routine Description:
+
+    This routine removes a directory entry. The node it named stays around
+    until the system sends a delete request for it. This routine assumes the
+    volume lock is held exclusively.
+
+Arguments:
+
+    Volume - Supplies a pointer to the volume.
+
+    Unlink - Supplies a pointer to the unlink request.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    PTMPFS_NODE Directory;
+    PTMPFS_DIRECTORY_ENTRY Entry;
+
+    Directory = TmpfspLookupNode(Volume, Unlink->DirectoryProperties->FileId);
+    if (Directory == NULL) {
+        return STATUS_PATH_NOT_FOUND;
+    }
+
+    Entry = TmpfspFindEntry(Directory, Unlink->Name, Unlink->NameSize);
+    if ((Entry == NULL) ||
+        (Entry->Node->Properties.FileId != Unlink->FileProperties->FileId)) {
+
+        return STATUS_PATH_NOT_FOUND;
+    }
+
+    if (TmpfspIsDirectoryEmpty(Entry->Node) == FALSE) {
+        return STATUS_DIRECTORY_NOT_EMPTY;
+    }
+
+    TmpfspRemoveEntry(Directory, Entry);
+    Unlink->Unlinked = TRUE;
+    return STATUS_SUCCESS;
+}
+
+KSTATUS
+TmpfspRename (
+    PTMPFS_VOLUME Volume,
+    PSYSTEM_CONTROL_RENAME Rename
+    )
+
+/*++
+
+Routine Description:
+
+    This routine moves a directory entry, replacing any entry already at the
+    destination. This routine assumes the volume lock is held exclusively.
+
+Arguments:
+
+    Volume - Supplies a pointer to the volume.
+
+    Rename - Supplies a pointer to the rename request.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    PTMPFS_DIRECTORY_ENTRY DestinationEntry;
+    PTMPFS_NODE DestinationDirectory;
+    ULONG NameLength;
+    PTMPFS_NODE Node;
+    PTMPFS_NODE SourceDirectory;
+    PTMPFS_DIRECTORY_ENTRY SourceEntry;
+    KSTATUS Status;
+
+    Rename->SourceFileHardLinkDelta = 0;
+    Status = TmpfspValidateName(Rename->Name, Rename->NameSize, &NameLength);
+    if (!KSUCCESS(Status)) {
+        return Status;
+    }
+
+    SourceDirectory = TmpfspLookupNode(
+                                    Volume,
+                                    Rename->SourceDirectoryProperties->FileId);
+
+    DestinationDirectory = TmpfspLookupNode(
+                               Volume,
+                               Rename->DestinationDirectoryProperties->FileId);
+
+    Node = TmpfspLookupNode(Volume, Rename->SourceFileProperties->FileId);
+    if ((SourceDirectory == NULL) || (DestinationDirectory == NULL) ||
+        (Node == NULL)) {
+
+        return STATUS_PATH_NOT_FOUND;
+    }
+
+    //
+    // Find the source entry by name, since a file with several hard links
+    // may have more than one entry in the same directory.
+    //
+
+    SourceEntry = TmpfspFindEntry(SourceDirectory,
+                                  Rename->SourceName,
+                                  Rename->SourceNameSize);
+
+    if ((SourceEntry == NULL) || (SourceEntry->Node != Node)) {
+        return STATUS_PATH_NOT_FOUND;
+    }
+
+    //
+    // Unlink whatever is at the destination. A directory there must be empty.
+    //
+
+    DestinationEntry = TmpfspFindEntry(DestinationDirectory,
+                                       Rename->Name,
+                                       Rename->NameSize);
+
+    if (DestinationEntry != NULL) {
+        if ((Rename->DestinationFileProperties == NULL) ||
+            (DestinationEntry->Node->Properties.FileId !=
+             Rename->DestinationFileProperties->FileId)) {
+
+            return STATUS_FILE_EXISTS;
+        }
+
+        if (TmpfspIsDirectoryEmpty(DestinationEntry->Node) == FALSE) {
+            return STATUS_DIRECTORY_NOT_EMPTY;
+        }
+    }
+
+    //
+    // Add the new entry before removing anything, so that a failed allocation
+    // leaves the tree untouched.
+    //
+
+    Status = TmpfspAddEntry(DestinationDirectory,
+                            Rename->Name,
+                            NameLength,
+                            Node);
+
+    if (!KSUCCESS(Status)) {
+        return Status;
+    }
+
+    if (DestinationEntry != NULL) {
+        TmpfspRemoveEntry(DestinationDirectory, DestinationEntry);
+        Rename->DestinationFileUnlinked = TRUE;
+    }
+
+    TmpfspRemoveEntry(SourceDirectory, SourceEntry);
+    Rename->DestinationDirectorySize = DestinationDirectory->Properties.Size;
+    return STATUS_SUCCESS;
+}
+
+KSTATUS
+TmpfspValidateName (
+    PCSTR Name,
+    ULONG NameSize,
+    PULONG NameLength
+    )
+
+/*++
+
+Routine Description:
+
+    This routine validates a name for a new directory entry.
+
+Arguments:
+
+    Name - Supplies a pointer to the name, which may not be null terminated.
+
+    NameSize - Supplies the size of the name buffer including space for a
+        null terminator.
+
+    NameLength - Supplies a pointer where the length of the name, not
+        including a null terminator, will be returned.
+
+Return Value:
+
+    STATUS_SUCCESS if the name can be used.
+
+    STATUS_NAME_TOO_LONG if the name is too long.
+
+    STATUS_INVALID_PARAMETER if the name is empty, or is dot or dot-dot.
+
+--*/
+
+{
+
+    ULONG Length;
+
+    Length = 0;
+    while ((Length + 1 < NameSize) && (Name[Length] != '\0')) {
+        Length += 1;
+    }
+
+    if (Length > TMPFS_MAX_NAME_LENGTH) {
+        return STATUS_NAME_TOO_LONG;
+    }
+
+    if ((Length == 0) ||
+        ((Length == 1) && (Name[0] == '.')) ||
+        ((Length == 2) && (Name[0] == '.') && (Name[1] == '.'))) {
+
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    *NameLength = Length;
+    return STATUS_SUCCESS;
+}
+
+PTMPFS_DIRECTORY_ENTRY
+TmpfspFindEntry (
+    PTMPFS_NODE Directory,
+    PCSTR Name,
+    ULONG NameSize
+    )
+
+/*++
+
+Routine Description:
+
+    This routine finds the entry with the given name in a directory. This
+    routine assumes the volume lock is held.
+
+Arguments:
+
+    Directory - Supplies a pointer to the directory to search.
+
+    Name - Supplies a pointer to the name, which may not be null terminated.
+
+    NameSize - Supplies the size of the name buffer including space for a
+        null terminator.
+
+Return Value:
+
+    Returns a pointer to the directory entry on success.
+
+    NULL if no entry has the given name.
+
+--*/
+
+{
+
+    PTMPFS_DIRECTORY_ENTRY Entry;
+    ULONG Length;
+    PRED_BLACK_TREE_NODE TreeNode;
+
+    if ((Name == NULL) || (NameSize == 0)) {
+        return NULL;
+    }
+
+    Length = 0;
+    while ((Length + 1 < NameSize) && (Name[Length] != '\0')) {
+        Length += 1;
+    }
+
+    TreeNode = RtlRedBlackTreeGetLowestNode(&(Directory->EntryTree));
+    while (TreeNode != NULL) {
+        Entry = RED_BLACK_TREE_VALUE(TreeNode, TMPFS_DIRECTORY_ENTRY, TreeNode);
+        if ((Entry->NameLength == Length) &&
+            (RtlCompareMemory(Entry + 1, Name, Length) != FALSE)) {
+
+            return Entry;
+        }
+
+        TreeNode = RtlRedBlackTreeGetNextNode(&(Directory->EntryTree),
+                                              FALSE,
+                                              TreeNode);
+    }
+
+    return NULL;
+}
+
+KSTATUS
+TmpfspAddEntry (
+    PTMPFS_NODE Directory,
+    PCSTR Name,
+    ULONG NameLength,
+    PTMPFS_NODE Node
+    )
+
+/*++
+
+Routine Description:
+
+    This routine adds a new entry to a directory and increments the hard link
+    count of the node it names. This routine assumes the volume lock is held
+    exclusively.
+
+Arguments:
+
+    Directory - Supplies a pointer to the directory.
+
+    Name - Supplies a pointer to the validated name of the entry.
+
+    NameLength - Supplies the length of the name, not including a null
+        terminator.
+
+    Node - Supplies a pointer to the node the entry names.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    UINTN AllocationSize;
+    PTMPFS_DIRECTORY_ENTRY Entry;
+    PSTR EntryName;
+
+    ASSERT(Directory->Properties.Type == IoObjectRegularDirectory);
+
+    AllocationSize = sizeof(TMPFS_DIRECTORY_ENTRY) + NameLength + 1;
+    Entry = MmAllocatePagedPool(AllocationSize, TMPFS_ALLOCATION_TAG);
+    if (Entry == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    Entry->Offset = Directory->NextEntryOffset;
+    Directory->NextEntryOffset += 1;
+    Entry->Node = Node;
+    Entry->NameLength = NameLength;
+    EntryName = (PSTR)(Entry + 1);
+    RtlCopyMemory(EntryName, Name, NameLength);
+    EntryName[NameLength] = '\0';
+    RtlRedBlackTreeInsert(&(Directory->EntryTree), &(Entry->TreeNode));
+    Directory->Properties.Size +=
+                ALIGN_RANGE_UP(sizeof(DIRECTORY_ENTRY) + NameLength + 1, 8);
+
+    Node->Properties.HardLinkCount += 1;
+    return STATUS_SUCCESS;
+}
+
+VOID
+TmpfspRemoveEntry (
+    PTMPFS_NODE Directory,
+    PTMPFS_DIRECTORY_ENTRY Entry
+    )
+
+/*++
+
+Routine Description:
+
+    This routine removes an entry from a directory and decrements the hard
+    link count of the node it named. This routine assumes the volume lock is
+    held exclusively.
+
+Arguments:
+
+    Directory - Supplies a pointer to the directory.
+
+    Entry - Supplies a pointer to the entry to remove.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ASSERT(Entry->Node->Properties.HardLinkCount != 0);
+
+    RtlRedBlackTreeRemove(&(Directory->EntryTree), &(Entry->TreeNode));
+    Directory->Properties.Size -=
+          ALIGN_RANGE_UP(sizeof(DIRECTORY_ENTRY) + Entry->NameLength + 1, 8);
+
+    Entry->Node->Properties.HardLinkCount -= 1;
+    MmFreePagedPool(Entry);
+    return;
+}
+
+BOOL
+TmpfspIsDirectoryEmpty (
+    PTMPFS_NODE Node
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines whether a node has no directory entries. Nodes
+    that are not directories are always empty.
+
+Arguments:
+
+    Node - Supplies a pointer to the node.
+
+Return Value:
+
+    TRUE if the node has no entries.
+
+    FALSE if the node is a directory with at least one entry.
+
+--*/
+
+{
+
+    if (RtlRedBlackTreeGetLowestNode(&(Node->EntryTree)) == NULL) {
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+KSTATUS
+TmpfspEnumerateDirectory (
+    PTMPFS_NODE Directory,
+    PIRP_READ_WRITE ReadWrite
+    )
+
+/*++
+
+Routine Description:
+
+    This routine fills an I/O buffer with directory entries, starting at the
+    offset in the request. This routine assumes the volume lock is held.
+
+Arguments:
+
+    Directory - Supplies a pointer to the directory to enumerate.
+
+    ReadWrite - Supplies a pointer to the read request.
+
+Return Value:
+
+    STATUS_SUCCESS if at least one entry was returned.
+
+    STATUS_END_OF_FILE if there are no more entries.
+
+    STATUS_MORE_PROCESSING_REQUIRED if the buffer is too small for the next
+    entry.
+
+    Other error codes on failure to copy into the I/O buffer.
+
+--*/
+
+{
+
+    UINTN BytesWritten;
+    PTMPFS_DIRECTORY_ENTRY Entry;
+    UINTN EntrySize;
+    PTMPFS_DIRECTORY_ENTRY NextEntry;
+    PRED_BLACK_TREE_NODE NextTreeNode;
+    TMPFS_DIRECTORY_ENTRY SearchEntry;
+    KSTATUS Status;
+    PRED_BLACK_TREE_NODE TreeNode;
+    DIRECTORY_ENTRY UserEntry;
+
+    ASSERT(ReadWrite->IoOffset >= DIRECTORY_CONTENTS_OFFSET);
+
+    BytesWritten = 0;
+    ReadWrite->NewIoOffset = ReadWrite->IoOffset;
+    Status = STATUS_END_OF_FILE;
+    SearchEntry.Offset = ReadWrite->IoOffset;
+    TreeNode = RtlRedBlackTreeSearchClosest(&(Directory->EntryTree),
+                                            &(SearchEntry.TreeNode),
+                                            TRUE);
+
+    while (TreeNode != NULL) {
+        Entry = RED_BLACK_TREE_VALUE(TreeNode, TMPFS_DIRECTORY_ENTRY, TreeNode);
+        EntrySize = ALIGN_RANGE_UP(sizeof(DIRECTORY_ENTRY) +
+                                   Entry->NameLength + 1,
+                                   8);
+
+        if (BytesWritten + EntrySize > ReadWrite->IoSizeInBytes) {
+            if (BytesWritten == 0) {
+                Status = STATUS_MORE_PROCESSING_REQUIRED;
+            }
+
+            break;
+        }
+
+        NextTreeNode = RtlRedBlackTreeGetNextNode(&(Directory->EntryTree),
+                                                  FALSE,
+                                                  TreeNode);
+
+        UserEntry.FileId = Entry->Node->Properties.FileId;
+        UserEntry.Size = EntrySize;
+        UserEntry.Type = Entry->Node->Properties.Type;
+        UserEntry.NextOffset = Directory->NextEntryOffset;
+        if (NextTreeNode != NULL) {
+            NextEntry = RED_BLACK_TREE_VALUE(NextTreeNode,
+                                             TMPFS_DIRECTORY_ENTRY,
+                                             TreeNode);
+
+            UserEntry.NextOffset = NextEntry->Offset;
+        }
+
+        Status = MmCopyIoBufferData(ReadWrite->IoBuffer,
+                                    &UserEntry,
+                                    BytesWritten,
+                                    sizeof(DIRECTORY_ENTRY),
+                                    TRUE);
+
+        if (!KSUCCESS(Status)) {
+            break;
+        }
+
+        Status = MmCopyIoBufferData(ReadWrite->IoBuffer,
+                                    Entry + 1,
+                                    BytesWritten + sizeof(DIRECTORY_ENTRY),
+                                    Entry->NameLength + 1,
+                                    TRUE);
+
+        if (!KSUCCESS(Status)) {
+            break;
+        }
+
+        BytesWritten += EntrySize;
+        ReadWrite->NewIoOffset = UserEntry.NextOffset;
+        TreeNode = NextTreeNode;
+    }
+
+    ReadWrite->IoBytesCompleted = BytesWritten;
+    return Status;
+}
+
+KSTATUS
+TmpfspPerformIo (
+    PTMPFS_VOLUME Volume,
+    PTMPFS_NODE Node,
+    PIRP_READ_WRITE ReadWrite,
+    BOOL Write
+    )
+
+/*++
+
+Routine Description:
+
+    This routine reads from or writes to the data of a node. Holes read as
+    zeros, and pages are allocated as they are first written. This routine
+    assumes the volume lock is held, exclusively for writes.
+
+Arguments:
+
+    Volume - Supplies a pointer to the volume.
+
+    Node - Supplies a pointer to the node.
+
+    ReadWrite - Supplies a pointer to the I/O request.
+
+    Write - Supplies a boolean indicating whether this is a write (TRUE) or a
+        read (FALSE).
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    UINTN BytesCompleted;
+    UINTN ChunkSize;
+    ULONGLONG FileSize;
+    ULONGLONG Offset;
+    PTMPFS_PAGE Page;
+    ULONG PageOffset;
+    ULONG PageShift;
+    ULONG PageSize;
+    UINTN Size;
+    KSTATUS Status;
+
+    BytesCompleted = 0;
+    Offset = ReadWrite->IoOffset;
+    PageShift = MmPageShift();
+    PageSize = MmPageSize();
+    Size = ReadWrite->IoSizeInBytes;
+    Status = STATUS_SUCCESS;
+
+    //
+    // Reads stop at the end of the file as the system sees it.
+    //
+
+    if (Write == FALSE) {
+        FileSize = ReadWrite->FileProperties->Size;
+        if (Offset >= FileSize) {
+            Status = STATUS_END_OF_FILE;
+            goto PerformIoEnd;
+        }
+
+        if (Size > FileSize - Offset) {
+            Size = FileSize - Offset;
+        }
+    }
+
+    while (BytesCompleted < Size) {
+        PageOffset = REMAINDER(Offset, PageSize);
+        ChunkSize = PageSize - PageOffset;
+        if (ChunkSize > Size - BytesCompleted) {
+            ChunkSize = Size - BytesCompleted;
+        }
+
+        Page = TmpfspLookupPage(Node, Offset >> PageShift);
+        if (Write != FALSE) {
+            if (Page == NULL) {
+                Status = TmpfspAllocatePage(Volume,
+                                            Node,
+                                            Offset >> PageShift,
+                                            &Page);
+
+                if (!KSUCCESS(Status)) {
+                    break;
+                }
+            }
+
+            Status = MmCopyIoBufferData(ReadWrite->IoBuffer,
+                                        (PUCHAR)Page->Data + PageOffset,
+                                        BytesCompleted,
+                                        ChunkSize,
+                                        FALSE);
+
+        } else if (Page == NULL) {
+            Status = MmZeroIoBuffer(ReadWrite->IoBuffer,
+                                    BytesCompleted,
+                                    ChunkSize);
+
+        } else {
+            Status = MmCopyIoBufferData(ReadWrite->IoBuffer,
+                                        (PUCHAR)Page->Data + PageOffset,
+                                        BytesCompleted,
+                                        ChunkSize,
+                                        TRUE);
+        }
+
+        if (!KSUCCESS(Status)) {
+            break;
+        }
+
+        BytesCompleted += ChunkSize;
+        Offset += ChunkSize;
+    }
+
+    if ((Write != FALSE) && (Offset > Node->Properties.Size)) {
+        Node->Properties.Size = Offset;
+    }
+
+PerformIoEnd:
+    ReadWrite->IoBytesCompleted = BytesCompleted;
+    ReadWrite->NewIoOffset = ReadWrite->IoOffset + BytesCompleted;
+    return Status;
+}
+
+PTMPFS_PAGE
+TmpfspLookupPage (
+    PTMPFS_NODE Node,
+    ULONGLONG Index
+    )
+
+/*++
+
+Routine Description:
+
+    This routine finds an allocated page of a node's data. This routine
+    assumes the volume lock is held.
+
+Arguments:
+
+    Node - Supplies a pointer to the node.
+
+    Index - Supplies the page index within the node's data.
+
+Return Value:
+
+    Returns a pointer to the page on success.
+
+    NULL if the page is a hole.
+
+--*/
+
+{
+
+    TMPFS_PAGE SearchPage;
+    PRED_BLACK_TREE_NODE TreeNode;
+
+    SearchPage.Index = Index;
+    TreeNode = RtlRedBlackTreeSearch(&(Node->PageTree),
+                                     &(SearchPage.TreeNode));
+
+    if (TreeNode == NULL) {
+        return NULL;
+    }
+
+    return RED_BLACK_TREE_VALUE(TreeNode, TMPFS_PAGE, TreeNode);
+}
+
+KSTATUS
+TmpfspAllocatePage (
+    PTMPFS_VOLUME Volume,
+    PTMPFS_NODE Node,
+    ULONGLONG Index,
+    PTMPFS_PAGE *NewPage
+    )
+
+/*++
+
+Routine Description:
+
+    This routine allocates a zeroed page of data for a node. The volume is
+    considered full once it reaches its page limit, or while the system is at
+    the most severe physical or virtual memory warning level. This routine
+    assumes the volume lock is held exclusively.
+
+Arguments:
+
+    Volume - Supplies a pointer to the volume.
+
+    Node - Supplies a pointer to the node.
+
+    Index - Supplies the page index within the node's data.
+
+    NewPage - Supplies a pointer where a pointer to the new page will be
+        returned.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_VOLUME_FULL if the volume cannot grow right now.
+
+    STATUS_INSUFFICIENT_RESOURCES on allocation failure.
+
+--*/
+
+{
+
+    PTMPFS_PAGE Page;
+    ULONG PageSize;
+
+    if ((Volume->PageCount >= Volume->MaxPageCount) ||
+        (MmGetPhysicalMemoryWarningLevel() == MemoryWarningLevel1) ||
+        (MmGetVirtualMemoryWarningLevel() == MemoryWarningLevel1)) {
+
+        return STATUS_VOLUME_FULL;
+    }
+
+    Page = MmAllocatePagedPool(sizeof(TMPFS_PAGE), TMPFS_ALLOCATION_TAG);
+    if (Page == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    PageSize = MmPageSize();
+    Page->Data = MmAllocatePagedPool(PageSize, TMPFS_ALLOCATION_TAG);
+    if (Page->Data == NULL) {
+        MmFreePagedPool(Page);
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    RtlZeroMemory(Page->Data, PageSize);
+    Page->Index = Index;
+    RtlRedBlackTreeInsert(&(Node->PageTree), &(Page->TreeNode));
+    Node->PageCount += 1;
+    Volume->PageCount += 1;
+    *NewPage = Page;
+    return STATUS_SUCCESS;
+}
+
+VOID
+TmpfspFreePage (
+    PTMPFS_VOLUME Volume,
+    PTMPFS_NODE Node,
+    PTMPFS_PAGE Page
+    )
+
+/*++
+
+Routine Description:
+
+    This routine removes a page from a node and frees it. This routine assumes
+    the volume lock is held exclusively.
+
+Arguments:
+
+    Volume - Supplies a pointer to the volume.
+
+    Node - Supplies a pointer to the node.
+
+    Page - Supplies a pointer to the page to free.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ASSERT((Node->PageCount != 0) && (Volume->PageCount != 0));
+
+    RtlRedBlackTreeRemove(&(Node->PageTree), &(Page->TreeNode));
+    Node->PageCount -= 1;
+    Volume->PageCount -= 1;
+    MmFreePagedPool(Page->Data);
+    MmFreePagedPool(Page);
+    return;
+}
+
+VOID
+TmpfspTruncate (
+    PTMPFS_VOLUME Volume,
+    PTMPFS_NODE Node,
+    ULONGLONG NewSize
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sets the size of a node's data. Pages wholly beyond the new
+    size are freed, and the tail of a partial last page is zeroed so that a
+    later extension reads zeros. Growing a file just creates a hole. This
+    routine assumes the volume lock is held exclusively.
+
+Arguments:
+
+    Volume - Supplies a pointer to the volume.
+
+    Node - Supplies a pointer to the node.
+
+    NewSize - Supplies the new size of the node's data.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONGLONG FirstFreeIndex;
+    PTMPFS_PAGE Page;
+    ULONG PageOffset;
+    ULONG PageSize;
+    TMPFS_PAGE SearchPage;
+    PRED_BLACK_TREE_NODE TreeNode;
+
+    PageSize = MmPageSize();
+    FirstFreeIndex = ALIGN_RANGE_UP(NewSize, PageSize) >> MmPageShift();
+    SearchPage.Index = FirstFreeIndex;
+    while (TRUE) {
+        TreeNode = RtlRedBlackTreeSearchClosest(&(Node->PageTree),
+                                                &(SearchPage.TreeNode),
+                                                TRUE);
+
+        if (TreeNode == NULL) {
+            break;
+        }
+
+        Page = RED_BLACK_TREE_VALUE(TreeNode, TMPFS_PAGE, TreeNode);
+        TmpfspFreePage(Volume, Node, Page);
+    }
+
+    PageOffset = REMAINDER(NewSize, PageSize);
+    if (PageOffset != 0) {
+        Page = TmpfspLookupPage(Node, NewSize >> MmPageShift());
+        if (Page != NULL) {
+            RtlZeroMemory((PUCHAR)Page->Data + PageOffset,
+                          PageSize - PageOffset);
+        }
+    }
+
+    if (Node->Properties.Type != IoObjectRegularDirectory) {
+        Node->Properties.Size = NewSize;
+    }
+
+    return;
+}
+
+COMPARISON_RESULT
+TmpfspCompareNodes (
+    PRED_BLACK_TREE Tree,
+    PRED_BLACK_TREE_NODE FirstNode,
+    PRED_BLACK_TREE_NODE SecondNode
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compares two tmpfs nodes by file ID.
+
+Arguments:
+
+    Tree - Supplies a pointer to the red black tree that owns both nodes.
+
+    FirstNode - Supplies a pointer to the left side of the comparison.
+
+    SecondNode - Supplies a pointer to the second side of the comparison.
+
+Return Value:
+
+    Same if the two nodes have the same value.
+
+    Ascending if the first node is less than the second node.
+
+    Descending if the second node is less than the first node.
+
+--*/
+
+{
+
+    PTMPFS_NODE First;
+    PTMPFS_NODE Second;
+
+    First = RED_BLACK_TREE_VALUE(FirstNode, TMPFS_NODE, TreeNode);
+    Second = RED_BLACK_TREE_VALUE(SecondNode, TMPFS_NODE, TreeNode);
+    if (First->Properties.FileId > Second->Properties.FileId) {
+        return ComparisonResultDescending;
+    }
+
+    if (First->Properties.FileId < Second->Properties.FileId) {
+        return ComparisonResultAscending;
+    }
+
+    return ComparisonResultSame;
+}
+
+COMPARISON_RESULT
+TmpfspCompareEntries (
+    PRED_BLACK_TREE Tree,
+    PRED_BLACK_TREE_NODE FirstNode,
+    PRED_BLACK_TREE_NODE SecondNode
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compares two tmpfs directory entries by directory offset.
+
+Arguments:
+
+    Tree - Supplies a pointer to the red black tree that owns both nodes.
+
+    FirstNode - Supplies a pointer to the left side of the comparison.
+
+    SecondNode - Supplies a pointer to the second side of the comparison.
+
+Return Value:
+
+    Same if the two nodes have the same value.
+
+    Ascending if the first node is less than the second node.
+
+    Descending if the second node is less than the first node.
+
+--*/
+
+{
+
+    PTMPFS_DIRECTORY_ENTRY First;
+    PTMPFS_DIRECTORY_ENTRY Second;
+
+    First = RED_BLACK_TREE_VALUE(FirstNode, TMPFS_DIRECTORY_ENTRY, TreeNode);
+    Second = RED_BLACK_TREE_VALUE(SecondNode, TMPFS_DIRECTORY_ENTRY, TreeNode);
+    if (First->Offset > Second->Offset) {
+        return ComparisonResultDescending;
+    }
+
+    if (First->Offset < Second->Offset) {
+        return ComparisonResultAscending;
+    }
+
+    return ComparisonResultSame;
+}
+
+COMPARISON_RESULT
+TmpfspComparePages (
+    PRED_BLACK_TREE Tree,
+    PRED_BLACK_TREE_NODE FirstNode,
+    PRED_BLACK_TREE_NODE SecondNode
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compares two tmpfs data pages by page index.
+
+Arguments:
+
+    Tree - Supplies a pointer to the red black tree that owns both nodes.
+
+    FirstNode - Supplies a pointer to the left side of the comparison.
+
+    SecondNode - Supplies a pointer to the second side of the comparison.
+
+Return Value:
+
+    Same if the two nodes have the same value.
+
+    Ascending if the first node is less than the second node.
+
+    Descending if the second node is less than the first node.
+
+--*/
+
+{
+
+    PTMPFS_PAGE First;
+    PTMPFS_PAGE Second;
+
+    First = RED_BLACK_TREE_VALUE(FirstNode, TMPFS_PAGE, TreeNode);
+    Second = RED_BLACK_TREE_VALUE(SecondNode, TMPFS_PAGE, TreeNode);
+    if (First->Index > Second->Index) {
+        return ComparisonResultDescending;
+    }
+
+    if (First->Index < Second->Index) {
+        return ComparisonResultAscending;
+    }
+
+    return ComparisonResultSame;
+}
+
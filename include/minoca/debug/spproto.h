@@ -52,13 +52,23 @@ Module Name:
 #define GET_PROFILER_DATA_SIZE(_Value) \
     (_Value & ~PROFILER_DATA_SENTINEL_MASK)
 
+//
+// Define the number of pointer-sized values that start each stack sample: the
+// sentinel, the ID of the interrupted thread's process, and the ID of the
+// interrupted thread. The call stack follows, innermost frame first.
+//
+
+#define PROFILER_STACK_SAMPLE_HEADER_COUNT 3
+
 //
 // Define the various types of profiling data available for collection.
 //
 
-#define PROFILER_TYPE_FLAG_STACK_SAMPLING    0x00000001
-#define PROFILER_TYPE_FLAG_MEMORY_STATISTICS 0x00000002
-#define PROFILER_TYPE_FLAG_THREAD_STATISTICS 0x00000004
+#define PROFILER_TYPE_FLAG_STACK_SAMPLING     0x00000001
+#define PROFILER_TYPE_FLAG_MEMORY_STATISTICS  0x00000002
+#define PROFILER_TYPE_FLAG_THREAD_STATISTICS  0x00000004
+#define PROFILER_TYPE_FLAG_LOCK_STATISTICS    0x00000008
+#define PROFILER_TYPE_FLAG_OFF_CPU_STATISTICS 0x00000010
 
 //
 // Define the minimum length of the profiler notification data buffer.
@@ -72,6 +82,25 @@ Module Name:
 
 #define PROFILER_POOL_MAGIC 0x6C6F6F50 // 'looP'
 
+//
+// Defines a value that marks the head of a profiler lock statistics buffer.
+//
+
+#define PROFILER_LOCK_MAGIC 0x6B636F4C // 'kcoL'
+
+//
+// Defines a value that marks the head of a profiler off-CPU statistics buffer.
+//
+
+#define PROFILER_OFF_CPU_MAGIC 0x4366664F // 'CffO'
+
+//
+// Define the maximum number of call stack frames recorded for a blocked
+// thread.
+//
+
+#define PROFILER_OFF_CPU_MAX_FRAMES 16
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -112,6 +141,12 @@ Enumeration Descriptoin:
     ProfilerDataTypeThread - Indicates that the profiler data is from the
         thread profiler.
 
+    ProfilerDataTypeLock - Indicates that the profiler data is from lock
+        statistics.
+
+    ProfilerDataTypeOffCpu - Indicates that the profiler data is from off-CPU
+        statistics on blocked threads.
+
     ProfilerDataTypeMax - Indicates an invalid profiler data type and the total
         number of profiler types.
 
@@ -122,6 +157,8 @@ typedef enum _PROFILER_DATA_TYPE {
     ProfilerDataTypeStack,
     ProfilerDataTypeMemory,
     ProfilerDataTypeThread,
+    ProfilerDataTypeLock,
+    ProfilerDataTypeOffCpu,
     ProfilerDataTypeMax
 } PROFILER_DATA_TYPE, *PPROFILER_DATA_TYPE;
 
@@ -187,6 +224,9 @@ Enumeration Descriptoin:
     ProfilerMemoryTypePagedPool - Indicates that the profiler memory is of
         paged pool type.
 
+    ProfilerMemoryTypeObjectCache - Indicates that the profiler memory
+        describes the kernel object caches, with one tag per cache.
+
     ProfilerMEmoryTypeMax - Indicates the maximum number of profiler memory
         types.
 
@@ -195,11 +235,87 @@ Enumeration Descriptoin:
 typedef enum _PROFILER_MEMORY_TYPE {
     ProfilerMemoryTypeNonPagedPool,
     ProfilerMemoryTypePagedPool,
+    ProfilerMemoryTypeObjectCache,
     ProfilerMemoryTypeMax
 } PROFILER_MEMORY_TYPE, *PPROFILER_MEMORY_TYPE;
 
 /*++
 
+Enumeration Description:
+
+    This enumeration describes the kinds of locks reported by the lock
+    statistics profiler.
+
+Values:
+
+    ProfilerLockTypeQueued - Indicates a queued lock class.
+
+    ProfilerLockTypeSharedExclusive - Indicates a shared-exclusive lock class.
+
+    ProfilerLockTypeSpin - Indicates a single spin lock. Spin locks are not
+        created through a routine that could name them, so each contended spin
+        lock is reported individually by address.
+
+    ProfilerLockTypeMax - Indicates the number of lock types.
+
+--*/
+
+typedef enum _PROFILER_LOCK_TYPE {
+    ProfilerLockTypeInvalid,
+    ProfilerLockTypeQueued,
+    ProfilerLockTypeSharedExclusive,
+    ProfilerLockTypeSpin,
+    ProfilerLockTypeMax
+} PROFILER_LOCK_TYPE, *PPROFILER_LOCK_TYPE;
+
+/*++
+
+Enumeration Description:
+
+    This enumeration describes why a thread was blocked, as reported by the
+    off-CPU statistics profiler. The reason is taken from the type of the
+    first object the thread waited on.
+
+Values:
+
+    ProfilerOffCpuReasonQueue - Indicates the thread waited on a bare wait
+        queue that is not part of an object, such as a user mode lock.
+
+    ProfilerOffCpuReasonQueuedLock - Indicates the thread waited to acquire a
+        queued lock.
+
+    ProfilerOffCpuReasonEvent - Indicates the thread waited on an event.
+
+    ProfilerOffCpuReasonTimer - Indicates the thread waited on a timer, which
+        includes sleeping.
+
+    ProfilerOffCpuReasonThread - Indicates the thread waited on another thread
+        or process to exit.
+
+    ProfilerOffCpuReasonIo - Indicates the thread waited on an I/O object,
+        such as a device, IRP, pipe or terminal.
+
+    ProfilerOffCpuReasonObject - Indicates the thread waited on some other
+        kind of object.
+
+    ProfilerOffCpuReasonMax - Indicates the number of off-CPU reasons.
+
+--*/
+
+typedef enum _PROFILER_OFF_CPU_REASON {
+    ProfilerOffCpuReasonInvalid,
+    ProfilerOffCpuReasonQueue,
+    ProfilerOffCpuReasonQueuedLock,
+    ProfilerOffCpuReasonEvent,
+    ProfilerOffCpuReasonTimer,
+    ProfilerOffCpuReasonThread,
+    ProfilerOffCpuReasonIo,
+    ProfilerOffCpuReasonObject,
+    ProfilerOffCpuReasonMax
+} PROFILER_OFF_CPU_REASON, *PPROFILER_OFF_CPU_REASON;
+
+/*++
+
 Structure Description:
 
     This structure defines a pool of memory for the profiler.
@@ -287,6 +403,150 @@ typedef struct _PROFILER_MEMORY_POOL_TAG_STATISTIC {
 
 /*++
 
+Structure Description:
+
+    This structure defines the header of a lock statistics snapshot. It is
+    followed immediately by the lock class statistics.
+
+Members:
+
+    Magic - Stores PROFILER_LOCK_MAGIC.
+
+    ClassCount - Stores the number of lock class statistics that follow.
+
+    TimeCounterFrequency - Stores the frequency of the time counter that all
+        wait and hold times are measured in.
+
+--*/
+
+typedef struct _PROFILER_LOCK_HEADER {
+    ULONG Magic;
+    ULONG ClassCount;
+    ULONGLONG TimeCounterFrequency;
+} PACKED PROFILER_LOCK_HEADER, *PPROFILER_LOCK_HEADER;
+
+/*++
+
+Structure Description:
+
+    This structure defines profiler statistics for one lock class.
+
+Members:
+
+    StructureSize - Stores the size of the structure including the null
+        terminated name.
+
+    LockType - Stores the kind of lock. See PROFILER_LOCK_TYPE.
+
+    Address - Stores the address of the code that created the locks in this
+        class, or the address of the lock itself for spin locks.
+
+    AcquireCount - Stores the number of times a lock in this class was
+        acquired. This is not collected for spin locks.
+
+    ContentionCount - Stores the number of acquisitions that had to wait.
+
+    TotalWaitTime - Stores the total time spent waiting for contended
+        acquisitions, in time counter ticks.
+
+    MaxWaitTime - Stores the longest single wait, in time counter ticks.
+
+    TotalHoldTime - Stores the total time locks in this class were held
+        exclusively, in time counter ticks.
+
+    MaxHoldTime - Stores the longest time a lock in this class was held
+        exclusively, in time counter ticks.
+
+    Name - Stores the null terminated name of the class, which is empty if
+        the locks were created without a name.
+
+--*/
+
+typedef struct _PROFILER_LOCK_STATISTIC {
+    ULONG StructureSize;
+    ULONG LockType;
+    ULONGLONG Address;
+    ULONGLONG AcquireCount;
+    ULONGLONG ContentionCount;
+    ULONGLONG TotalWaitTime;
+    ULONGLONG MaxWaitTime;
+    ULONGLONG TotalHoldTime;
+    ULONGLONG MaxHoldTime;
+    CHAR Name[ANYSIZE_ARRAY];
+} PACKED PROFILER_LOCK_STATISTIC, *PPROFILER_LOCK_STATISTIC;
+
+/*++
+
+Structure Description:
+
+    This structure defines the header of an off-CPU statistics snapshot. It is
+    followed immediately by the off-CPU statistics.
+
+Members:
+
+    Magic - Stores PROFILER_OFF_CPU_MAGIC.
+
+    EntryCount - Stores the number of off-CPU statistics that follow.
+
+    TimeCounterFrequency - Stores the frequency of the time counter that all
+        blocked times are measured in.
+
+    DroppedCount - Stores the number of waits that were not recorded because
+        the table of unique stacks was full.
+
+--*/
+
+typedef struct _PROFILER_OFF_CPU_HEADER {
+    ULONG Magic;
+    ULONG EntryCount;
+    ULONGLONG TimeCounterFrequency;
+    ULONGLONG DroppedCount;
+} PACKED PROFILER_OFF_CPU_HEADER, *PPROFILER_OFF_CPU_HEADER;
+
+/*++
+
+Structure Description:
+
+    This structure defines profiler statistics for all the waits that blocked
+    with the same call stack for the same reason.
+
+Members:
+
+    StructureSize - Stores the size of the structure including the frames.
+
+    Reason - Stores the reason the thread blocked. See
+        PROFILER_OFF_CPU_REASON.
+
+    FrameCount - Stores the number of call stack frames that follow.
+
+    WaitObject - Stores the address of the object or queue most recently
+        waited on from this call stack.
+
+    Count - Stores the number of waits that completed.
+
+    TotalTime - Stores the total time threads spent blocked, in time counter
+        ticks.
+
+    MaxTime - Stores the longest single wait, in time counter ticks.
+
+    Frames - Stores the call stack of the blocking thread, innermost frame
+        first.
+
+--*/
+
+typedef struct _PROFILER_OFF_CPU_STATISTIC {
+    ULONG StructureSize;
+    ULONG Reason;
+    ULONG FrameCount;
+    ULONGLONG WaitObject;
+    ULONGLONG Count;
+    ULONGLONG TotalTime;
+    ULONGLONG MaxTime;
+    ULONGLONG Frames[ANYSIZE_ARRAY];
+} PACKED PROFILER_OFF_CPU_STATISTIC, *PPROFILER_OFF_CPU_STATISTIC;
+
+/*++
+
 Structure Description:
 
     This structure defines a context swap event in the profiler.
@@ -1791,6 +1791,7 @@ typedef enum _IRP_MINOR_CODE {
     IrpMinorSystemControlDeviceInformation,
     IrpMinorSystemControlGetBlockInformation,
     IrpMinorSystemControlSynchronize,
+    IrpMinorSystemControlLink,
 } IRP_MINOR_CODE, *PIRP_MINOR_CODE;
 
 typedef enum _IRP_DIRECTION {
@@ -2385,6 +2386,13 @@ Structure Description:
         terminator (which may be a null terminator or may be a garbage
         character).
 
+    SourceName - Stores a pointer to the name of the source file within its
+        directory. File systems that support hard links need this to tell
+        which of the file's directory entries is being renamed.
+
+    SourceNameSize - Stores the size of the source name buffer including
+        space for a null terminator.
+
 --*/
 
 typedef struct _SYSTEM_CONTROL_RENAME {
@@ -2397,10 +2405,50 @@ typedef struct _SYSTEM_CONTROL_RENAME {
     BOOL DestinationFileUnlinked;
     PSTR Name;
     ULONG NameSize;
+    PCSTR SourceName;
+    ULONG SourceNameSize;
 } SYSTEM_CONTROL_RENAME, *PSYSTEM_CONTROL_RENAME;
 
 /*++
 
+Structure Description:
+
+    This structure defines the information sent to a file system when the
+    system requests that the file system add a new directory entry (a hard
+    link) for an existing file.
+
+Members:
+
+    DirectoryProperties - Stores a pointer to the file properties of the
+        directory where the new entry will reside.
+
+    FileProperties - Stores a pointer to the file properties of the existing
+        file being linked to.
+
+    DirectorySize - Stores the extent of the directory written to create the
+        new entry. This may be less than the actual directory size but the
+        system will only update the directory size if it is larger than the
+        currently recorded size.
+
+    Name - Stores a pointer to the name of the new entry, which may not be
+        null terminated.
+
+    NameSize - Stores the size of the name buffer including space for a null
+        terminator (which may be a null terminator or may be a garbage
+        character).
+
+--*/
+
+typedef struct _SYSTEM_CONTROL_LINK {
+    PFILE_PROPERTIES DirectoryProperties;
+    PFILE_PROPERTIES FileProperties;
+    ULONGLONG DirectorySize;
+    PCSTR Name;
+    ULONG NameSize;
+} SYSTEM_CONTROL_LINK, *PSYSTEM_CONTROL_LINK;
+
+/*++
+
 Structure Description:
 
     This structure defines the information sent to a file system for a truncate
@@ -4633,6 +4681,64 @@ Return Value:
 
 --*/
 
+KERNEL_API
+KSTATUS
+IoCreateHardLink (
+    BOOL FromKernelMode,
+    PIO_HANDLE ExistingFileDirectory,
+    PCSTR ExistingFilePath,
+    ULONG ExistingFilePathSize,
+    PIO_HANDLE LinkDirectory,
+    PCSTR LinkPath,
+    ULONG LinkPathSize,
+    BOOL FollowLinks
+    );
+
+/*++
+
+Routine Description:
+
+    This routine creates a new directory entry for an existing file. The
+    existing file must not be a directory, and the new entry must live on the
+    same volume as the file and must not already exist. The caller must have
+    write access to the directory receiving the new entry.
+
+Arguments:
+
+    FromKernelMode - Supplies a boolean indicating the request is coming from
+        kernel mode.
+
+    ExistingFileDirectory - Supplies an optional pointer to a handle to the
+        directory to start at for a relative existing file path. If this is
+        not supplied, then the current working directory of the process is
+        used.
+
+    ExistingFilePath - Supplies a pointer to the path of the existing file.
+
+    ExistingFilePathSize - Supplies the size of the existing file path buffer
+        in bytes, including the null terminator.
+
+    LinkDirectory - Supplies an optional pointer to a handle to the directory
+        to start at for a relative link path. If this is not supplied, then the
+        current working directory of the process is used.
+
+    LinkPath - Supplies a pointer to the path of the new link to create.
+
+    LinkPathSize - Supplies the size of the link path buffer in bytes,
+        including the null terminator.
+
+    FollowLinks - Supplies a boolean indicating whether to link to the target
+        of the existing file path if it is a symbolic link (TRUE) or to the
+        symbolic link itself (FALSE).
+
+Return Value:
+
+    STATUS_NOT_SUPPORTED if the file system does not support hard links.
+
+    Other status codes.
+
+--*/
+
 KERNEL_API
 KSTATUS
 IoCreateSymbolicLink (
@@ -5677,6 +5783,34 @@ Return Value:
 
 --*/
 
+INTN
+IoSysIoRingEnter (
+    PVOID SystemCallParameter
+    );
+
+/*++
+
+Routine Description:
+
+    This routine implements the system call for entering an I/O ring. It
+    consumes new submissions, retries any pending ones, and waits for the
+    requested number of completions.
+
+Arguments:
+
+    SystemCallParameter - Supplies a pointer to the parameters supplied with
+        the system call. This structure will be a stack-local copy of the
+        actual parameters passed from user-mode.
+
+Return Value:
+
+    Returns the number of new submissions consumed (a non-negative integer)
+    on success.
+
+    Error status code (a negative integer) on failure.
+
+--*/
+
 INTN
 IoSysCreatePipe (
     PVOID SystemCallParameter
@@ -6236,6 +6370,33 @@ Return Value:
 
 --*/
 
+INTN
+IoSysSocketAcceptMultiple (
+    PVOID SystemCallParameter
+    );
+
+/*++
+
+Routine Description:
+
+    This routine handles the system call that accepts several pending
+    connections on a listening socket at once. Only the first accept may
+    block.
+
+Arguments:
+
+    SystemCallParameter - Supplies a pointer to the parameters supplied with
+        the system call. This structure will be a stack-local copy of the
+        actual parameters passed from user-mode.
+
+Return Value:
+
+    Returns the number of connections accepted on success.
+
+    Error status code if no connection could be accepted.
+
+--*/
+
 INTN
 IoSysSocketConnect (
     PVOID SystemCallParameter
@@ -6316,6 +6477,32 @@ Return Value:
 
 --*/
 
+INTN
+IoSysSocketPerformBatchIo (
+    PVOID SystemCallParameter
+    );
+
+/*++
+
+Routine Description:
+
+    This routine handles the system call that sends or receives several
+    messages on a socket at once.
+
+Arguments:
+
+    SystemCallParameter - Supplies a pointer to the parameters supplied with
+        the system call. This structure will be a stack-local copy of the
+        actual parameters passed from user-mode.
+
+Return Value:
+
+    Returns the number of messages processed on success.
+
+    Error status code if the first message failed.
+
+--*/
+
 INTN
 IoSysSocketGetSetInformation (
     PVOID SystemCallParameter
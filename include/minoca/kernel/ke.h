@@ -105,6 +105,17 @@ Module Name:
 
 #define WORK_QUEUE_FLAG_SUPPORT_DISPATCH_LEVEL 0x00000001
 
+//
+// Set this bit to give the work queue a worker pool per processor. Work items
+// run on the processor that queued them, and more than one work item may run
+// concurrently, so callers must not depend on ordering between work items.
+// A work item queued again while it is running may also run concurrently with
+// itself. Without this flag, work items are executed one at a time in queue
+// order.
+//
+
+#define WORK_QUEUE_FLAG_PER_PROCESSOR 0x00000002
+
 //
 // Define the mask of publicly accessible timer flags.
 //
@@ -288,6 +299,7 @@ typedef struct _SCHEDULER_GROUP_ENTRY
 
 typedef struct _SCHEDULER_GROUP SCHEDULER_GROUP, *PSCHEDULER_GROUP;
 typedef struct _DPC DPC, *PDPC;
+typedef struct _KE_LOCK_CLASS KE_LOCK_CLASS, *PKE_LOCK_CLASS;
 typedef struct _PROCESSOR_START_BLOCK
     PROCESSOR_START_BLOCK, *PPROCESSOR_START_BLOCK;
 
@@ -368,6 +380,49 @@ typedef struct _PROCESSOR_CYCLE_ACCOUNTING {
 
 /*++
 
+Structure Description:
+
+    This structure describes the statistics of a work queue, summed across all
+    of its worker pools.
+
+Members:
+
+    ItemsQueued - Stores the total number of work items queued.
+
+    ItemsStarted - Stores the total number of work items that have been
+        picked up by a worker thread.
+
+    TotalLatency - Stores the total time, in time counter ticks, that started
+        work items spent waiting in the queue.
+
+    MaxLatency - Stores the longest time, in time counter ticks, that a single
+        work item spent waiting in the queue.
+
+    PoolCount - Stores the number of worker pools in the queue.
+
+    ThreadCount - Stores the current number of worker threads.
+
+    IdleThreadCount - Stores the number of worker threads currently waiting
+        for work.
+
+    CreatedThreadCount - Stores the total number of worker threads ever
+        created for the queue.
+
+--*/
+
+typedef struct _WORK_QUEUE_STATISTICS {
+    ULONGLONG ItemsQueued;
+    ULONGLONG ItemsStarted;
+    ULONGLONG TotalLatency;
+    ULONGLONG MaxLatency;
+    ULONG PoolCount;
+    ULONG ThreadCount;
+    ULONG IdleThreadCount;
+    ULONG CreatedThreadCount;
+} WORK_QUEUE_STATISTICS, *PWORK_QUEUE_STATISTICS;
+
+/*++
+
 Structure Description:
 
     This structure contains the context for a scheduling group.
@@ -743,11 +798,19 @@ Structure Description:
 
     OwningThread - Stores a pointer to the thread that is holding the lock.
 
+    Class - Stores a pointer to the lock class this lock's statistics are
+        accumulated in.
+
+    AcquireTime - Stores the time counter value when the lock was acquired,
+        or 0 if lock statistics were not enabled at the time.
+
 --*/
 
 typedef struct _QUEUED_LOCK {
     OBJECT_HEADER Header;
     PKTHREAD OwningThread;
+    PKE_LOCK_CLASS Class;
+    ULONGLONG AcquireTime;
 } QUEUED_LOCK, *PQUEUED_LOCK;
 
 /*++
@@ -785,6 +848,13 @@ Structure Description:
     SharedWaiters - Stores the number of threads trying to acquire the lock
         shared.
 
+    Class - Stores a pointer to the lock class this lock's statistics are
+        accumulated in.
+
+    ExclusiveAcquireTime - Stores the time counter value when the lock was
+        acquired exclusively, or 0 if lock statistics were not enabled at the
+        time.
+
 --*/
 
 typedef struct _SHARED_EXCLUSIVE_LOCK {
@@ -792,6 +862,8 @@ typedef struct _SHARED_EXCLUSIVE_LOCK {
     PKEVENT Event;
     volatile ULONG ExclusiveWaiters;
     volatile ULONG SharedWaiters;
+    PKE_LOCK_CLASS Class;
+    ULONGLONG ExclusiveAcquireTime;
 } SHARED_EXCLUSIVE_LOCK, *PSHARED_EXCLUSIVE_LOCK;
 
 /*++
@@ -1059,6 +1131,33 @@ Return Value:
 
 --*/
 
+KERNEL_API
+PQUEUED_LOCK
+KeCreateNamedQueuedLock (
+    PCSTR ClassName
+    );
+
+/*++
+
+Routine Description:
+
+    This routine creates a new queued lock whose statistics are accumulated
+    under the given lock class name.
+
+Arguments:
+
+    ClassName - Supplies a pointer to the name of the lock class. All locks
+        created with the same name share statistics. This string must remain
+        valid for the lifetime of the system.
+
+Return Value:
+
+    Returns a pointer to the new lock on success.
+
+    NULL on failure.
+
+--*/
+
 KERNEL_API
 VOID
 KeDestroyQueuedLock (
@@ -1341,6 +1440,31 @@ Return Value:
 
 --*/
 
+KERNEL_API
+PSHARED_EXCLUSIVE_LOCK
+KeCreateNamedSharedExclusiveLock (
+    PCSTR ClassName
+    );
+
+/*++
+
+Routine Description:
+
+    This routine creates a shared-exclusive lock whose statistics are
+    accumulated under the given lock class name.
+
+Arguments:
+
+    ClassName - Supplies a pointer to the name of the lock class. All locks
+        created with the same name share statistics. This string must remain
+        valid for the lifetime of the system.
+
+Return Value:
+
+    Returns a pointer to a shared-exclusive lock on success, or NULL on failure.
+
+--*/
+
 KERNEL_API
 VOID
 KeDestroySharedExclusiveLock (
@@ -2261,6 +2385,7 @@ Return Value:
 
 --*/
 
+KERNEL_API
 ULONG
 KeGetCurrentProcessorNumber (
     VOID
@@ -2283,6 +2408,7 @@ Return Value:
 
 --*/
 
+KERNEL_API
 ULONG
 KeGetActiveProcessorCount (
     VOID
@@ -2744,6 +2870,35 @@ Return Value:
 
 --*/
 
+KERNEL_API
+KSTATUS
+KeGetWorkQueueStatistics (
+    PWORK_QUEUE WorkQueue,
+    PWORK_QUEUE_STATISTICS Statistics
+    );
+
+/*++
+
+Routine Description:
+
+    This routine returns a snapshot of the statistics for the given work queue.
+
+Arguments:
+
+    WorkQueue - Supplies a pointer to the work queue to query. Supply NULL to
+        query the system work queue.
+
+    Statistics - Supplies a pointer where the statistics will be returned.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_INVALID_PARAMETER if no work queue was supplied and the system work
+    queue does not exist yet.
+
+--*/
+
 KERNEL_API
 KSTATUS
 KeCreateAndQueueWorkItem (
@@ -2926,6 +3081,60 @@ Return Value:
 
 --*/
 
+VOID
+KeSetLockStatistics (
+    BOOL Enable
+    );
+
+/*++
+
+Routine Description:
+
+    This routine enables or disables lock statistics collection. Enabling
+    statistics resets the counts accumulated in every lock class.
+
+Arguments:
+
+    Enable - Supplies a boolean indicating whether lock statistics should be
+        collected (TRUE) or not (FALSE).
+
+Return Value:
+
+    None.
+
+--*/
+
+KSTATUS
+KeGetLockProfilerStatistics (
+    PVOID *Buffer,
+    PULONG BufferSize,
+    ULONG Tag
+    );
+
+/*++
+
+Routine Description:
+
+    This routine allocates a buffer and fills it with the statistics of every
+    lock class, in the format described by the system profiler protocol.
+
+Arguments:
+
+    Buffer - Supplies a pointer that receives a non-paged pool buffer full of
+        lock statistics. The caller is responsible for freeing it.
+
+    BufferSize - Supplies a pointer that receives the size of the buffer, in
+        bytes.
+
+    Tag - Supplies an identifier to associate with the allocation, useful for
+        debugging and leak detection.
+
+Return Value:
+
+    Status code.
+
+--*/
+
 VOID
 KeDispatchSoftwareInterrupt (
     RUNLEVEL RunLevel,
@@ -3278,6 +3487,37 @@ Return Value:
 
 --*/
 
+KSTATUS
+KeBindThreadToProcessor (
+    PKTHREAD Thread,
+    ULONG ProcessorNumber
+    );
+
+/*++
+
+Routine Description:
+
+    This routine binds a newly created thread to the given processor. The
+    thread will only ever run on that processor: it is neither stolen by other
+    processors when it becomes ready nor pulled away by idle balancing. This
+    routine must be called before the thread is made ready for the first time.
+
+Arguments:
+
+    Thread - Supplies a pointer to the thread to bind. The thread must have
+        been created with the bound thread flag.
+
+    ProcessorNumber - Supplies the zero-based number of the processor to bind
+        the thread to.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_INVALID_PARAMETER if the processor number is not valid.
+
+--*/
+
 VOID
 KeIdleLoop (
     VOID
@@ -311,7 +311,8 @@ typedef enum _NET_DOMAIN_TYPE {
     NetDomainArp = NET_DOMAIN_LOW_LEVEL_NETWORK_BASE,
     NetDomainEapol,
     NetDomainEthernet = NET_DOMAIN_PHYSICAL_BASE,
-    NetDomain80211
+    NetDomain80211,
+    NetDomainLoopback
 } NET_DOMAIN_TYPE, *PNET_DOMAIN_TYPE;
 
 typedef enum _NET_SOCKET_TYPE {
@@ -974,7 +975,8 @@ KSTATUS
 (*PNET_ACCEPT) (
     PSOCKET Socket,
     PIO_HANDLE *NewConnectionSocket,
-    PNETWORK_ADDRESS RemoteAddress
+    PNETWORK_ADDRESS RemoteAddress,
+    ULONG TimeoutInMilliseconds
     );
 
 /*++
@@ -995,6 +997,10 @@ Routine Description:
     RemoteAddress - Supplies a pointer where the address of the connected
         remote host will be returned.
 
+    TimeoutInMilliseconds - Supplies the number of milliseconds to wait for
+        a connection to come in. Use WAIT_TIME_INDEFINITE to wait forever.
+        A non-blocking socket never waits, regardless of this value.
+
 Return Value:
 
     Status code.
@@ -1522,7 +1528,8 @@ IoSocketAccept (
     PIO_HANDLE *NewConnectionSocket,
     PNETWORK_ADDRESS RemoteAddress,
     PCSTR *RemotePath,
-    PUINTN RemotePathSize
+    PUINTN RemotePathSize,
+    ULONG TimeoutInMilliseconds
     );
 
 /*++
@@ -1551,6 +1558,10 @@ Routine Description:
     RemotePathSize - Supplies a pointer where the size of the remote path in
         bytes will be returned on success.
 
+    TimeoutInMilliseconds - Supplies the number of milliseconds to wait for
+        a connection to come in. Use WAIT_TIME_INDEFINITE to wait forever.
+        A non-blocking socket never waits, regardless of this value.
+
 Return Value:
 
     Status code.
@@ -91,7 +91,7 @@ Module Name:
 
 #define USER_STACK_HEADROOM (128 * _1MB)
 #define USER_STACK_MAX (((UINTN)MAX_USER_ADDRESS + 1) * 3 / 4)
-#define MM_STATISTICS_VERSION 1
+#define MM_STATISTICS_VERSION 2
 #define MM_STATISTICS_MAX_VERSION 0x10000000
 
 //
@@ -228,6 +228,12 @@ Module Name:
 #define BLOCK_ALLOCATOR_FLAG_TRIM                  0x00000008
 #define BLOCK_ALLOCATOR_FLAG_NO_EXPANSION          0x00000010
 
+//
+// Define flags used for creating object caches.
+//
+
+#define OBJECT_CACHE_FLAG_NON_PAGED 0x00000001
+
 //
 // Define user mode virtual address for the user shared data page.
 //
@@ -377,6 +383,7 @@ typedef enum _MEMORY_WARNING_LEVEL {
 typedef enum _MM_INFORMATION_TYPE {
     MmInformationInvalid,
     MmInformationSystemMemory,
+    MmInformationCompressedSwapLimit,
 } MM_INFORMATION_TYPE, *PMM_INFORMATION_TYPE;
 
 /*++
@@ -651,6 +658,89 @@ typedef struct _IO_BUFFER {
 } IO_BUFFER, *PIO_BUFFER;
 
 typedef struct _BLOCK_ALLOCATOR BLOCK_ALLOCATOR, *PBLOCK_ALLOCATOR;
+typedef struct _OBJECT_CACHE OBJECT_CACHE, *POBJECT_CACHE;
+
+typedef
+KSTATUS
+(*POBJECT_CACHE_CONSTRUCTOR) (
+    PVOID Object,
+    PVOID Context
+    );
+
+/*++
+
+Routine Description:
+
+    This routine is called to construct an object when the object cache
+    carves it out of a new slab. Objects are handed back to the cache in their
+    constructed state, so the constructor only runs again if the object's slab
+    is released and the memory is reused.
+
+Arguments:
+
+    Object - Supplies a pointer to the object to construct.
+
+    Context - Supplies the context pointer passed when the cache was created.
+
+Return Value:
+
+    Status code. On failure, the slab being created is released and the
+    allocation that needed it fails.
+
+--*/
+
+typedef
+VOID
+(*POBJECT_CACHE_DESTRUCTOR) (
+    PVOID Object,
+    PVOID Context
+    );
+
+/*++
+
+Routine Description:
+
+    This routine is called to tear down a constructed object immediately
+    before the memory for the slab holding it is released.
+
+Arguments:
+
+    Object - Supplies a pointer to the object to destroy.
+
+    Context - Supplies the context pointer passed when the cache was created.
+
+Return Value:
+
+    None.
+
+--*/
+
+typedef
+VOID
+(*POBJECT_CACHE_RECLAIM) (
+    POBJECT_CACHE Cache,
+    PVOID Context
+    );
+
+/*++
+
+Routine Description:
+
+    This routine is called when physical memory is tight to ask the owner of
+    an object cache to free any objects it is holding on to but does not need.
+    It is called at low level, before the cache releases its own spare slabs.
+
+Arguments:
+
+    Cache - Supplies a pointer to the object cache.
+
+    Context - Supplies the context pointer passed when the cache was created.
+
+Return Value:
+
+    None.
+
+--*/
 
 /*++
 
@@ -677,6 +767,18 @@ Structure Description:
     NonPagedPhysicalPages - Stores the number of physical pages that are
         pinned in memory and cannot be paged out to disk.
 
+    CompressedSwapPages - Stores the number of pages held in the compressed
+        swap store rather than the page file.
+
+    CompressedSwapSize - Stores the total size of the compressed data for
+        those pages, in bytes.
+
+    CompressedSwapUsed - Stores the number of bytes of the compressed swap
+        store in use, including per-page overhead.
+
+    CompressedSwapLimit - Stores the maximum number of bytes the compressed
+        swap store may use.
+
 --*/
 
 typedef struct _MM_STATISTICS {
@@ -687,6 +789,10 @@ typedef struct _MM_STATISTICS {
     UINTN PhysicalPages;
     UINTN AllocatedPhysicalPages;
     UINTN NonPagedPhysicalPages;
+    UINTN CompressedSwapPages;
+    UINTN CompressedSwapSize;
+    UINTN CompressedSwapUsed;
+    UINTN CompressedSwapLimit;
 } MM_STATISTICS, *PMM_STATISTICS;
 
 /*++
@@ -1816,6 +1922,7 @@ Return Value:
 
 --*/
 
+KERNEL_API
 UINTN
 MmGetTotalVirtualMemory (
     VOID
@@ -2094,6 +2201,162 @@ Return Value:
 
 --*/
 
+KERNEL_API
+POBJECT_CACHE
+MmCreateObjectCache (
+    ULONG ObjectSize,
+    ULONG Alignment,
+    ULONG Flags,
+    ULONG Tag,
+    POBJECT_CACHE_CONSTRUCTOR Constructor,
+    POBJECT_CACHE_DESTRUCTOR Destructor,
+    POBJECT_CACHE_RECLAIM Reclaim,
+    PVOID Context
+    );
+
+/*++
+
+Routine Description:
+
+    This routine creates an object cache, which hands out fixed size objects
+    from slabs of pool memory. Each processor keeps a small magazine of free
+    objects so that most allocations and frees do not touch a shared lock.
+    This routine must be called at low level.
+
+Arguments:
+
+    ObjectSize - Supplies the size of each object, in bytes.
+
+    Alignment - Supplies the required address alignment, in bytes, for each
+        object. Valid values are powers of 2. Set to 0 to get pointer
+        alignment.
+
+    Flags - Supplies a bitfield of flags governing the cache. See
+        OBJECT_CACHE_FLAG_* definitions. Caches without the non-paged flag
+        allocate from paged pool and must only be used at low level. Non-paged
+        caches may be used at or below dispatch level.
+
+    Tag - Supplies an identifier to associate with the cache's memory, which
+        is also used to report the cache's statistics.
+
+    Constructor - Supplies an optional pointer to a routine called to
+        construct each object when its slab is created.
+
+    Destructor - Supplies an optional pointer to a routine called to destroy
+        each object when its slab is released.
+
+    Reclaim - Supplies an optional pointer to a routine called when memory is
+        tight to ask the owner to free unneeded objects.
+
+    Context - Supplies an optional context pointer passed to the callbacks.
+
+Return Value:
+
+    Returns a pointer to the object cache on success.
+
+    NULL on allocation failure.
+
+--*/
+
+KERNEL_API
+VOID
+MmDestroyObjectCache (
+    POBJECT_CACHE Cache
+    );
+
+/*++
+
+Routine Description:
+
+    This routine destroys an object cache. Every object allocated from the
+    cache must have already been freed back to it, and no other thread may be
+    using the cache. This routine must be called at low level.
+
+Arguments:
+
+    Cache - Supplies a pointer to the object cache to destroy.
+
+Return Value:
+
+    None.
+
+--*/
+
+KERNEL_API
+PVOID
+MmAllocateObject (
+    POBJECT_CACHE Cache
+    );
+
+/*++
+
+Routine Description:
+
+    This routine allocates a constructed object from an object cache.
+
+Arguments:
+
+    Cache - Supplies a pointer to the object cache.
+
+Return Value:
+
+    Returns a pointer to the object on success.
+
+    NULL on allocation failure.
+
+--*/
+
+KERNEL_API
+VOID
+MmFreeObject (
+    POBJECT_CACHE Cache,
+    PVOID Object
+    );
+
+/*++
+
+Routine Description:
+
+    This routine frees an object back to the object cache it was allocated
+    from. The object must be in its constructed state.
+
+Arguments:
+
+    Cache - Supplies a pointer to the object cache.
+
+    Object - Supplies a pointer to the object to free.
+
+Return Value:
+
+    None.
+
+--*/
+
+KERNEL_API
+UINTN
+MmReclaimObjectCaches (
+    VOID
+    );
+
+/*++
+
+Routine Description:
+
+    This routine asks every object cache owner to free unneeded objects, and
+    then releases the spare magazines and completely free slabs of every
+    cache. Objects sitting in per-processor magazines are left alone. This
+    routine must be called at low level.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the number of bytes of pool released.
+
+--*/
+
 VOID
 MmHandleFault (
     ULONG FaultFlags,
@@ -4037,6 +4300,7 @@ Return Value:
 
 --*/
 
+KERNEL_API
 UINTN
 MmGetTotalPhysicalPages (
     VOID
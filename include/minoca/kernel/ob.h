@@ -46,7 +46,7 @@ Module Name:
 
 #define ObWaitOnObject(_Object, _Flags, _TimeoutInMilliseconds) \
     ObWaitOnQueue(&(((POBJECT_HEADER)(_Object))->WaitQueue),    \
-                  (_Flags),                                     \
+                  (_Flags) | WAIT_FLAG_OBJECT,                  \
                   (_TimeoutInMilliseconds))
 
 //
@@ -81,6 +81,13 @@ Module Name:
 
 #define WAIT_FLAG_INTERRUPTIBLE 0x00000002
 
+//
+// This flag is set if the queues being waited on are all embedded in object
+// headers. The object wait routines set it automatically.
+//
+
+#define WAIT_FLAG_OBJECT 0x00000004
+
 //
 // Define the number of built in wait block entries.
 //
@@ -943,6 +950,32 @@ Return Value:
 
 --*/
 
+PVOID
+ObGetBlockingObject (
+    PVOID Thread
+    );
+
+/*++
+
+Routine Description:
+
+    This routine returns the first object the given thread is blocking on. Like
+    the blocking queue, the object is not referenced on behalf of the caller,
+    so this is generally only used by the scheduler for profiling.
+
+Arguments:
+
+    Thread - Supplies a pointer to the thread.
+
+Return Value:
+
+    Returns a pointer to the object header of the first object the thread is
+    blocking on.
+
+    NULL if the thread is waiting on bare wait queues rather than objects.
+
+--*/
+
 //
 // Handle Table routines.
 //
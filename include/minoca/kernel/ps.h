@@ -436,6 +436,7 @@ Module Name:
 #define THREAD_FLAG_FREE_USER_STACK 0x0004
 #define THREAD_FLAG_EXITING         0x0008
 #define THREAD_FLAG_RESTORE_SIGNALS 0x0010
+#define THREAD_FLAG_BOUND           0x0020
 
 //
 // Define thread FPU flags.
@@ -449,7 +450,7 @@ Module Name:
 // also the set of flags that will propagate when a thread is copied.
 //
 
-#define THREAD_FLAG_CREATION_MASK (THREAD_FLAG_USER_MODE)
+#define THREAD_FLAG_CREATION_MASK (THREAD_FLAG_USER_MODE | THREAD_FLAG_BOUND)
 
 #define DEFAULT_USER_STACK_SIZE (8 * _1MB)
 #define DEFAULT_KERNEL_STACK_SIZE 0x3000
@@ -531,6 +532,14 @@ Module Name:
 
 #define FORK_FLAG_REALM_UTS 0x00000001
 
+//
+// Set this flag to have the child process borrow the parent's address space
+// rather than copy it. The calling thread is suspended until the child
+// executes a new image or exits.
+//
+
+#define FORK_FLAG_VFORK 0x00000002
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -1439,6 +1448,14 @@ Structure Description:
 
     Realm - Stores the set of realms the process belongs to.
 
+    VforkAddressSpace - Stores the process' own address space while it is
+        running in its parent's address space after a vfork. This is NULL at
+        all other times.
+
+    VforkEvent - Stores a pointer to the event the vforking parent thread is
+        waiting on. It is signaled and cleared once the child executes an
+        image or exits.
+
 --*/
 
 struct _KPROCESS {
@@ -1485,6 +1502,8 @@ struct _KPROCESS {
     ULONG Umask;
     PVOID ControllingTerminal;
     PROCESS_REALMS Realm;
+    PADDRESS_SPACE VforkAddressSpace;
+    PVOID VforkEvent;
 };
 
 /*++
@@ -1702,6 +1721,16 @@ Structure Description:
 
     Limits - Stores the resource limits associated with the thread.
 
+    OffCpuRecord - Stores an opaque pointer to the off-CPU profiler record the
+        current wait is charged to, or NULL if the wait is not being profiled.
+
+    BlockTime - Stores the time counter value when the thread last blocked
+        while off-CPU profiling was enabled.
+
+    WorkQueueWorker - Stores an opaque pointer to the work queue worker state
+        if this thread services a work queue, or NULL otherwise. The scheduler
+        uses it to tell the work queue when a busy worker blocks.
+
 --*/
 
 struct _KTHREAD {
@@ -1740,6 +1769,9 @@ struct _KTHREAD {
     RUNTIME_TIMER UserTimer;
     RUNTIME_TIMER ProfileTimer;
     RESOURCE_LIMIT Limits[ResourceLimitCount];
+    PVOID OffCpuRecord;
+    ULONGLONG BlockTime;
+    PVOID WorkQueueWorker;
 };
 
 /*++
@@ -1944,6 +1976,9 @@ Structure Description:
         copy over to the stack of the created thread. This is only used when
         creating a process directly from kernel mode.
 
+    Processor - Stores the zero-based number of the processor the thread is
+        bound to. This is only used if the bound thread flag is set.
+
 --*/
 
 typedef struct _THREAD_CREATION_PARAMETERS {
@@ -1958,6 +1993,7 @@ typedef struct _THREAD_CREATION_PARAMETERS {
     PVOID ThreadPointer;
     PTHREAD_ID ThreadIdPointer;
     PPROCESS_ENVIRONMENT Environment;
+    ULONG Processor;
 } THREAD_CREATION_PARAMETERS, *PTHREAD_CREATION_PARAMETERS;
 
 //
@@ -43,6 +43,21 @@ Module Name:
                                         (_ScheduleOutReason));              \
     }
 
+//
+// These macros record a thread blocking and later being woken for off-CPU
+// profiling. They call the function pointers only if they are enabled.
+//
+
+#define SpRecordThreadBlock(_Thread)            \
+    if (SpRecordThreadBlockRoutine != NULL) {   \
+        SpRecordThreadBlockRoutine(_Thread);    \
+    }
+
+#define SpRecordThreadWake(_Thread)             \
+    if (SpRecordThreadWakeRoutine != NULL) {    \
+        SpRecordThreadWakeRoutine(_Thread);     \
+    }
+
 #define SpProcessNewProcess(_ProcessId)         \
     if (SpProcessNewProcessRoutine != NULL) {   \
         SpProcessNewProcessRoutine(_ProcessId); \
@@ -53,10 +68,42 @@ Module Name:
         SpProcessNewThreadRoutine(_ProcessId, _ThreadId);  \
     }
 
+//
+// This macro fires a static tracepoint. A disabled tracepoint costs only a
+// test of the enabled event mask.
+//
+
+#define SpTrace(_Event, _Argument1, _Argument2)                         \
+    if ((SpTraceEnabledEvents & SP_TRACE_EVENT_MASK(_Event)) != 0) {    \
+        SpTraceRecord((_Event),                                         \
+                      (ULONGLONG)(UINTN)(_Argument1),                   \
+                      (ULONGLONG)(UINTN)(_Argument2));                  \
+    }
+
+//
+// This macro returns the enabled event mask bit for a given trace event.
+//
+
+#define SP_TRACE_EVENT_MASK(_Event) (1UL << (_Event))
+
 //
 // ---------------------------------------------------------------- Definitions
 //
 
+//
+// Define the mask of every trace event.
+//
+
+#define SP_TRACE_EVENT_MASK_ALL \
+    (SP_TRACE_EVENT_MASK(SpTraceEventCount) - SP_TRACE_EVENT_MASK(1))
+
+//
+// Define the magic number and version at the start of a trace capture file.
+//
+
+#define SP_TRACE_FILE_MAGIC 0x72547053 // 'rTpS'
+#define SP_TRACE_FILE_VERSION 1
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -64,10 +111,69 @@ Module Name:
 typedef enum _SP_INFORMATION_TYPE {
     SpInformationInvalid,
     SpInformationGetSetState,
+    SpInformationTraceState,
+    SpInformationTraceRead,
 } SP_INFORMATION_TYPE, *PSP_INFORMATION_TYPE;
 
 /*++
 
+Enumeration Description:
+
+    This enumeration describes the static tracepoints in the kernel.
+
+Values:
+
+    SpTraceEventContextSwitch - Indicates the current thread is being switched
+        out. Argument one is the ID of the incoming thread, and argument two is
+        the scheduler reason.
+
+    SpTraceEventThreadWake - Indicates a thread was made ready to run.
+        Argument one is the thread ID, and argument two is the process ID.
+
+    SpTraceEventIrpDispatch - Indicates an IRP is being sent down its device
+        stack. Argument one is the IRP, and argument two holds the major code
+        in bits 8 and up and the minor code in the low 8 bits.
+
+    SpTraceEventIrpComplete - Indicates a driver completed an IRP. Argument one
+        is the IRP, and argument two is the completion status.
+
+    SpTraceEventPageFault - Indicates a page fault. Argument one is the
+        faulting address, and argument two is the fault flags.
+
+    SpTraceEventPageCacheHit - Indicates a page cache lookup found its entry.
+        Argument one is the file object, and argument two is the offset.
+
+    SpTraceEventPageCacheMiss - Indicates a page cache lookup did not find its
+        entry. Argument one is the file object, and argument two is the
+        offset.
+
+    SpTraceEventNetTransmit - Indicates packets are being handed to a network
+        device. Argument one is the link, and argument two is the number of
+        packets.
+
+    SpTraceEventNetReceive - Indicates a network device received a packet.
+        Argument one is the link, and argument two is the packet size.
+
+    SpTraceEventCount - Indicates the number of trace events.
+
+--*/
+
+typedef enum _SP_TRACE_EVENT {
+    SpTraceEventInvalid,
+    SpTraceEventContextSwitch,
+    SpTraceEventThreadWake,
+    SpTraceEventIrpDispatch,
+    SpTraceEventIrpComplete,
+    SpTraceEventPageFault,
+    SpTraceEventPageCacheHit,
+    SpTraceEventPageCacheMiss,
+    SpTraceEventNetTransmit,
+    SpTraceEventNetReceive,
+    SpTraceEventCount
+} SP_TRACE_EVENT, *PSP_TRACE_EVENT;
+
+/*++
+
 Enumeration Descriptoin:
 
     This enumeration describes the various operations for getting or setting
@@ -121,6 +227,113 @@ typedef struct _SP_GET_SET_STATE_INFORMATION {
     ULONG ProfilerTypeFlags;
 } SP_GET_SET_STATE_INFORMATION, *PSP_GET_SET_STATE_INFORMATION;
 
+/*++
+
+Structure Description:
+
+    This structure defines the event tracing state to get or set.
+
+Members:
+
+    EnabledEvents - Stores the mask of enabled trace events. See
+        SP_TRACE_EVENT_MASK.
+
+    RecordsPerProcessor - Stores the number of records in each processor's
+        ring buffer. On set, supply zero to use the default size. The size
+        cannot be changed once the ring buffers are allocated.
+
+    ProcessorCount - Stores the number of processors with ring buffers. This
+        is ignored on set.
+
+    LostRecords - Stores the number of records that were overwritten before
+        they could be read. This is ignored on set.
+
+    TimeCounterFrequency - Stores the frequency of the time counter used to
+        timestamp records. This is ignored on set.
+
+--*/
+
+typedef struct _SP_TRACE_STATE_INFORMATION {
+    ULONG EnabledEvents;
+    ULONG RecordsPerProcessor;
+    ULONG ProcessorCount;
+    ULONGLONG LostRecords;
+    ULONGLONG TimeCounterFrequency;
+} SP_TRACE_STATE_INFORMATION, *PSP_TRACE_STATE_INFORMATION;
+
+/*++
+
+Structure Description:
+
+    This structure defines a single trace event record.
+
+Members:
+
+    TimeCounter - Stores the time counter value when the event fired.
+
+    Argument1 - Stores the first event-specific argument.
+
+    Argument2 - Stores the second event-specific argument.
+
+    ThreadId - Stores the ID of the thread running when the event fired.
+
+    Event - Stores the trace event. See SP_TRACE_EVENT.
+
+    Processor - Stores the number of the processor the event fired on.
+
+--*/
+
+typedef struct _SP_TRACE_RECORD {
+    ULONGLONG TimeCounter;
+    ULONGLONG Argument1;
+    ULONGLONG Argument2;
+    ULONG ThreadId;
+    USHORT Event;
+    USHORT Processor;
+} SP_TRACE_RECORD, *PSP_TRACE_RECORD;
+
+/*++
+
+Structure Description:
+
+    This structure defines the header of a trace capture file. It is followed
+    by an array of trace records.
+
+Members:
+
+    Magic - Stores SP_TRACE_FILE_MAGIC.
+
+    Version - Stores SP_TRACE_FILE_VERSION.
+
+    HeaderSize - Stores the size of this header, in bytes. Records begin at
+        this offset in the file.
+
+    RecordSize - Stores the size of each record in the file, in bytes.
+
+    ProcessorCount - Stores the number of processors that were traced.
+
+    EnabledEvents - Stores the mask of events that were traced.
+
+    TimeCounterFrequency - Stores the frequency of the record timestamps.
+
+    RecordCount - Stores the number of records in the file.
+
+    LostRecords - Stores the number of records dropped during the capture.
+
+--*/
+
+typedef struct _SP_TRACE_FILE_HEADER {
+    ULONG Magic;
+    ULONG Version;
+    ULONG HeaderSize;
+    ULONG RecordSize;
+    ULONG ProcessorCount;
+    ULONG EnabledEvents;
+    ULONGLONG TimeCounterFrequency;
+    ULONGLONG RecordCount;
+    ULONGLONG LostRecords;
+} SP_TRACE_FILE_HEADER, *PSP_TRACE_FILE_HEADER;
+
 typedef
 VOID
 (*PSP_COLLECT_THREAD_STATISTIC) (
@@ -197,6 +410,53 @@ Return Value:
 
 --*/
 
+typedef
+VOID
+(*PSP_RECORD_THREAD_BLOCK) (
+    PKTHREAD Thread
+    );
+
+/*++
+
+Routine Description:
+
+    This routine records the stack and wait object of a thread that is
+    blocking. This routine must be called at dispatch level inside the
+    scheduler, on the stack of the blocking thread.
+
+Arguments:
+
+    Thread - Supplies a pointer to the thread being scheduled out.
+
+Return Value:
+
+    None.
+
+--*/
+
+typedef
+VOID
+(*PSP_RECORD_THREAD_WAKE) (
+    PKTHREAD Thread
+    );
+
+/*++
+
+Routine Description:
+
+    This routine records how long a blocked thread was off the processor. It
+    is called just before the thread is made ready.
+
+Arguments:
+
+    Thread - Supplies a pointer to the thread being woken.
+
+Return Value:
+
+    None.
+
+--*/
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -211,6 +471,22 @@ extern PSP_COLLECT_THREAD_STATISTIC SpCollectThreadStatisticRoutine;
 extern PSP_PROCESS_NEW_PROCESS SpProcessNewProcessRoutine;
 extern PSP_PROCESS_NEW_THREAD SpProcessNewThreadRoutine;
 
+//
+// Store pointers to the functions that record blocked threads for off-CPU
+// profiling. These are only set when off-CPU profiling is active.
+//
+
+extern PSP_RECORD_THREAD_BLOCK SpRecordThreadBlockRoutine;
+extern PSP_RECORD_THREAD_WAKE SpRecordThreadWakeRoutine;
+
+//
+// Store the mask of enabled trace events. Tracepoints test this before doing
+// any work, so callers should use the SpTrace macro rather than calling the
+// record routine directly.
+//
+
+extern KERNEL_API volatile ULONG SpTraceEnabledEvents;
+
 //
 // -------------------------------------------------------- Function Prototypes
 //
@@ -372,3 +648,33 @@ Return Value:
 
 --*/
 
+KERNEL_API
+VOID
+SpTraceRecord (
+    SP_TRACE_EVENT Event,
+    ULONGLONG Argument1,
+    ULONGLONG Argument2
+    );
+
+/*++
+
+Routine Description:
+
+    This routine writes a trace event record into the current processor's ring
+    buffer. Callers should use the SpTrace macro, which skips this call when
+    the event is disabled. This routine can be called at any run level.
+
+Arguments:
+
+    Event - Supplies the event that fired.
+
+    Argument1 - Supplies the first event-specific argument.
+
+    Argument2 - Supplies the second event-specific argument.
+
+Return Value:
+
+    None.
+
+--*/
+
@@ -162,6 +162,19 @@ Module Name:
 #define SYS_FLUSH_FLAG_WRITE        0x00000004
 #define SYS_FLUSH_FLAG_DISCARD      0x00000008
 
+//
+// Define the maximum number of entries in either queue of an I/O ring.
+//
+
+#define IO_RING_MAX_ENTRIES 4096
+
+//
+// Define the maximum number of messages or connections that can be handled
+// by a single batched socket system call.
+//
+
+#define SOCKET_BATCH_MAX_COUNT 1024
+
 //
 // Define memory mapping flags.
 //
@@ -357,9 +370,20 @@ typedef enum _SYSTEM_CALL_NUMBER {
     SystemCallSetITimer,
     SystemCallSetResourceLimit,
     SystemCallSetBreak,
+    SystemCallIoRingEnter,
+    SystemCallSocketPerformBatchIo,
+    SystemCallSocketAcceptMultiple,
     SystemCallCount
 } SYSTEM_CALL_NUMBER, *PSYSTEM_CALL_NUMBER;
 
+typedef enum _IO_RING_OPERATION {
+    IoRingOperationNop,
+    IoRingOperationRead,
+    IoRingOperationWrite,
+    IoRingOperationFlush,
+    IoRingOperationCount
+} IO_RING_OPERATION, *PIO_RING_OPERATION;
+
 typedef enum _SIGNAL_MASK_OPERATION {
     SignalMaskOperationNone,
     SignalMaskOperationOverwrite,
@@ -2512,6 +2536,266 @@ typedef struct _SYSTEM_CALL_SET_RESOURCE_LIMIT {
 
 /*++
 
+Structure Description:
+
+    This structure defines a single request in the submission queue of an I/O
+    ring.
+
+Members:
+
+    UserData - Stores an opaque value that is copied into the completion for
+        this request.
+
+    Offset - Stores the offset the I/O should occur at. Supply -1ULL to use the
+        current file pointer offset.
+
+    Buffer - Stores the buffer (in user mode) to read from or write to.
+
+    Size - Stores the number of bytes to read or write.
+
+    Handle - Stores the handle to perform the operation on.
+
+    Operation - Stores the operation to perform. See IO_RING_OPERATION.
+
+--*/
+
+typedef struct _IO_RING_SUBMISSION {
+    ULONGLONG UserData;
+    IO_OFFSET Offset;
+    PVOID Buffer;
+    UINTN Size;
+    HANDLE Handle;
+    ULONG Operation;
+} SYSCALL_STRUCT IO_RING_SUBMISSION, *PIO_RING_SUBMISSION;
+
+/*++
+
+Structure Description:
+
+    This structure defines a single entry in the completion queue of an I/O
+    ring.
+
+Members:
+
+    UserData - Stores the opaque value from the submission that completed.
+
+    Result - Stores the number of bytes completed (a non-negative integer) on
+        success, or the error status code (a negative integer) on failure.
+
+--*/
+
+typedef struct _IO_RING_COMPLETION {
+    ULONGLONG UserData;
+    INTN Result;
+} SYSCALL_STRUCT IO_RING_COMPLETION, *PIO_RING_COMPLETION;
+
+/*++
+
+Structure Description:
+
+    This structure defines an I/O ring, a pair of submission and completion
+    queues that live in user mode memory and are shared with the kernel. User
+    mode queues requests by filling in submissions and advancing the
+    submission tail, and reaps results by consuming completions and advancing
+    the completion head. The kernel owns the other two indices, which only
+    move during the enter I/O ring system call. All indices are free running
+    and are masked by the queue size. A ring may only be entered by one
+    thread at a time.
+
+Members:
+
+    SubmissionHead - Stores the index of the next submission the kernel will
+        consume. Owned by the kernel.
+
+    SubmissionTail - Stores the index one beyond the last valid submission.
+        Owned by user mode.
+
+    CompletionHead - Stores the index of the next completion user mode will
+        reap. Owned by user mode.
+
+    CompletionTail - Stores the index one beyond the last valid completion.
+        Owned by the kernel.
+
+    SubmissionCount - Stores the number of elements in the submission array.
+        This must be a power of two.
+
+    CompletionCount - Stores the number of elements in the completion array.
+        This must be a power of two.
+
+    PendingCount - Stores the number of consumed submissions in the pending
+        array that have not yet completed because they would have blocked.
+        Owned by the kernel, and must be zero when the ring is first entered.
+
+    Submissions - Stores a pointer to the submission queue array.
+
+    Completions - Stores a pointer to the completion queue array.
+
+    Pending - Stores a pointer to an array of submission count elements where
+        the kernel parks requests that would block.
+
+--*/
+
+typedef struct _IO_RING {
+    ULONG SubmissionHead;
+    ULONG SubmissionTail;
+    ULONG CompletionHead;
+    ULONG CompletionTail;
+    ULONG SubmissionCount;
+    ULONG CompletionCount;
+    ULONG PendingCount;
+    PIO_RING_SUBMISSION Submissions;
+    PIO_RING_COMPLETION Completions;
+    PIO_RING_SUBMISSION Pending;
+} SYSCALL_STRUCT IO_RING, *PIO_RING;
+
+/*++
+
+Structure Description:
+
+    This structure defines the system call parameters for entering an I/O
+    ring, which consumes new submissions, retries pending ones, and
+    optionally waits for completions.
+
+Members:
+
+    Ring - Stores a pointer to the I/O ring in user mode.
+
+    MinimumCompletions - Stores the number of unreaped completions that should
+        be in the completion queue before the call returns. Supply 0 to only
+        submit without waiting.
+
+    TimeoutInMilliseconds - Stores the number of milliseconds to wait for the
+        minimum completions. Use SYS_WAIT_TIME_INDEFINITE to wait forever.
+
+--*/
+
+typedef struct _SYSTEM_CALL_IO_RING_ENTER {
+    PIO_RING Ring;
+    ULONG MinimumCompletions;
+    ULONG TimeoutInMilliseconds;
+} SYSCALL_STRUCT SYSTEM_CALL_IO_RING_ENTER, *PSYSTEM_CALL_IO_RING_ENTER;
+
+/*++
+
+Structure Description:
+
+    This structure defines a single message of a batched socket I/O request.
+
+Members:
+
+    Parameters - Stores the socket I/O parameters for the message. On return,
+        the bytes completed, socket I/O flags, remote path size, and control
+        data size are updated just as they are for a single vectored I/O call.
+
+    VectorArray - Stores a pointer to an array of I/O vectors describing the
+        message data.
+
+    VectorCount - Stores the number of elements in the vector array.
+
+--*/
+
+typedef struct _SOCKET_IO_MESSAGE {
+    SOCKET_IO_PARAMETERS Parameters;
+    PIO_VECTOR VectorArray;
+    UINTN VectorCount;
+} SOCKET_IO_MESSAGE, *PSOCKET_IO_MESSAGE;
+
+/*++
+
+Structure Description:
+
+    This structure defines the system call parameters for sending or receiving
+    several messages on a socket at once.
+
+Members:
+
+    Socket - Stores the socket to use.
+
+    Messages - Stores a pointer to the array of messages. Messages are
+        processed in order, and processing stops at the first message that
+        fails.
+
+    MessageCount - Stores the number of elements in the message array. This
+        may be at most SOCKET_BATCH_MAX_COUNT.
+
+    TimeoutInMilliseconds - Stores the number of milliseconds the entire batch
+        may take, which limits the timeout of each message. Use
+        SYS_WAIT_TIME_INDEFINITE to rely only on the per-message timeouts.
+
+--*/
+
+typedef struct _SYSTEM_CALL_SOCKET_PERFORM_BATCH_IO {
+    HANDLE Socket;
+    PSOCKET_IO_MESSAGE Messages;
+    UINTN MessageCount;
+    ULONG TimeoutInMilliseconds;
+} SYSCALL_STRUCT SYSTEM_CALL_SOCKET_PERFORM_BATCH_IO,
+    *PSYSTEM_CALL_SOCKET_PERFORM_BATCH_IO;
+
+/*++
+
+Structure Description:
+
+    This structure defines a single connection returned by accepting multiple
+    connections at once.
+
+Members:
+
+    NewSocket - Stores the new socket file descriptor on success, which
+        represents the new connection.
+
+    Address - Stores the network address of the party that created the
+        connection.
+
+    RemotePath - Stores a pointer where the remote path of the client socket
+        will be copied on success. This only applies to local sockets.
+
+    RemotePathSize - Stores on input the size of the remote path buffer. On
+        output, contains the true size of the remote path, even if it was
+        bigger than the input.
+
+--*/
+
+typedef struct _SOCKET_ACCEPT_ENTRY {
+    HANDLE NewSocket;
+    NETWORK_ADDRESS Address;
+    PSTR RemotePath;
+    UINTN RemotePathSize;
+} SOCKET_ACCEPT_ENTRY, *PSOCKET_ACCEPT_ENTRY;
+
+/*++
+
+Structure Description:
+
+    This structure defines the system call parameters for accepting several
+    pending connections on a listening socket at once.
+
+Members:
+
+    Socket - Stores the socket to accept new connections from.
+
+    Entries - Stores a pointer to the array of entries where the accepted
+        connections are returned.
+
+    EntryCount - Stores the number of elements in the entry array. This may be
+        at most SOCKET_BATCH_MAX_COUNT.
+
+    OpenFlags - Stores an optional bitfield of open flags for the new sockets.
+        Only SYS_OPEN_FLAG_NON_BLOCKING and SYS_OPEN_FLAG_CLOSE_ON_EXECUTE
+        are accepted.
+
+--*/
+
+typedef struct _SYSTEM_CALL_SOCKET_ACCEPT_MULTIPLE {
+    HANDLE Socket;
+    PSOCKET_ACCEPT_ENTRY Entries;
+    UINTN EntryCount;
+    ULONG OpenFlags;
+} SYSCALL_STRUCT SYSTEM_CALL_SOCKET_ACCEPT_MULTIPLE,
+    *PSYSTEM_CALL_SOCKET_ACCEPT_MULTIPLE;
+
+/*++
+
 Structure Description:
 
     This structure defines a union of all possible system call parameter
@@ -2589,6 +2873,9 @@ typedef union _SYSTEM_CALL_PARAMETER_UNION {
     SYSTEM_CALL_SET_ITIMER SetITimer;
     SYSTEM_CALL_SET_RESOURCE_LIMIT SetResourceLimit;
     SYSTEM_CALL_SET_BREAK SetBreak;
+    SYSTEM_CALL_IO_RING_ENTER IoRingEnter;
+    SYSTEM_CALL_SOCKET_PERFORM_BATCH_IO SocketPerformBatchIo;
+    SYSTEM_CALL_SOCKET_ACCEPT_MULTIPLE SocketAcceptMultiple;
 } SYSCALL_STRUCT SYSTEM_CALL_PARAMETER_UNION, *PSYSTEM_CALL_PARAMETER_UNION;
 
 typedef
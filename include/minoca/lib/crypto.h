@@ -48,18 +48,30 @@ Module Name:
 #define AES_ECB256_KEY_SIZE AES_CBC256_KEY_SIZE
 #define AES_CTR128_KEY_SIZE AES_CBC128_KEY_SIZE
 #define AES_CTR256_KEY_SIZE AES_CBC256_KEY_SIZE
+#define AES_GCM128_KEY_SIZE AES_CBC128_KEY_SIZE
+#define AES_GCM256_KEY_SIZE AES_CBC256_KEY_SIZE
+#define AES_GCM_INITIALIZATION_VECTOR_SIZE 12
+#define AES_GCM_TAG_SIZE 16
+
+//
+// Define the number of bit planes in a bitsliced AES round key.
+//
+
+#define AES_BITSLICE_PLANES 8
 
 //
 // Define SHA-1 parameters.
 //
 
 #define SHA1_HASH_SIZE 20
+#define SHA1_BLOCK_SIZE 64
 
 //
 // Define SHA-256 parameters.
 //
 
 #define SHA256_HASH_SIZE 32
+#define SHA256_BLOCK_SIZE 64
 
 //
 // Define SHA-512 parameters.
@@ -101,7 +113,9 @@ typedef enum _AES_CIPHER_MODE {
     AesModeEcb128,
     AesModeEcb256,
     AesModeCtr128,
-    AesModeCtr256
+    AesModeCtr256,
+    AesModeGcm128,
+    AesModeGcm256
 } AES_CIPHER_MODE, *PAES_CIPHER_MODE;
 
 typedef enum _FORTUNA_INITIALIZATION_STATE {
@@ -148,6 +162,9 @@ Structure Description:
 
     Keys - Stores the initial key and each of the round keys.
 
+    BitslicedKeys - Stores the round keys converted to bit planes, where bit
+        (Row * 4) + Column of plane N holds bit N of that byte of the key.
+
     InitializationVector - Stores the initialization vector.
 
 --*/
@@ -156,11 +173,32 @@ typedef struct _AES_CONTEXT {
     USHORT Rounds;
     USHORT KeySize;
     ULONG Keys[(AES_MAX_ROUNDS + 1) * 8];
+    USHORT BitslicedKeys[AES_MAX_ROUNDS + 1][AES_BITSLICE_PLANES];
     UCHAR InitializationVector[AES_INITIALIZATION_VECTOR_SIZE];
 } AES_CONTEXT, *PAES_CONTEXT;
 
 /*++
 
+Structure Description:
+
+    This structure stores the context used during AES Galois/Counter Mode
+    authenticated encryption and decryption.
+
+Members:
+
+    AesContext - Stores the underlying AES context, used in counter mode.
+
+    HashKey - Stores the GHASH key, which is the encryption of the zero block.
+
+--*/
+
+typedef struct _AES_GCM_CONTEXT {
+    AES_CONTEXT AesContext;
+    UCHAR HashKey[AES_BLOCK_SIZE];
+} AES_GCM_CONTEXT, *PAES_GCM_CONTEXT;
+
+/*++
+
 Structure Description:
 
     This structure stores the context used during computation of a SHA-1 hash.
@@ -181,7 +219,7 @@ typedef struct _SHA1_CONTEXT {
     ULONG IntermediateHash[SHA1_HASH_SIZE / sizeof(ULONG)];
     ULONGLONG Length;
     USHORT BlockIndex;
-    UCHAR MessageBlock[64];
+    UCHAR MessageBlock[SHA1_BLOCK_SIZE];
 } SHA1_CONTEXT, *PSHA1_CONTEXT;
 
 /*++
@@ -206,7 +244,7 @@ typedef struct _SHA256_CONTEXT {
     ULONG IntermediateHash[SHA256_HASH_SIZE / sizeof(ULONG)];
     ULONGLONG Length;
     USHORT BlockIndex;
-    UCHAR MessageBlock[64];
+    UCHAR MessageBlock[SHA256_BLOCK_SIZE];
 } SHA256_CONTEXT, *PSHA256_CONTEXT;
 
 /*++
@@ -453,6 +491,11 @@ Structure Description:
 
     NormalizedMod - Stores the normalized modulo values.
 
+    RSquared - Stores R^2 modulo each modulus, where R is the radix raised
+        to the size of the modulus in whole machine words. This is used to
+        convert values into Montgomery form, and is NULL for even moduli,
+        which cannot use Montgomery multiplication.
+
     ExponentTable - Stores an array of pointers to integers representing
         pre-computed exponentiations of the working value.
 
@@ -464,6 +507,11 @@ Structure Description:
 
     ModOffset - Stores the modulo offset in use.
 
+    Scratch - Stores a pointer to scratch space used during Montgomery
+        exponentiation, so that the inner loops never allocate.
+
+    ScratchSize - Stores the size of the scratch space in bytes.
+
 --*/
 
 typedef struct _BIG_INTEGER_CONTEXT {
@@ -476,11 +524,14 @@ typedef struct _BIG_INTEGER_CONTEXT {
     PBIG_INTEGER Modulus[BIG_INTEGER_MODULO_COUNT];
     PBIG_INTEGER Mu[BIG_INTEGER_MODULO_COUNT];
     PBIG_INTEGER NormalizedMod[BIG_INTEGER_MODULO_COUNT];
+    PBIG_INTEGER RSquared[BIG_INTEGER_MODULO_COUNT];
     PBIG_INTEGER *ExponentTable;
     ULONG WindowSize;
     INTN ActiveCount;
     INTN FreeCount;
     UCHAR ModOffset;
+    PVOID Scratch;
+    UINTN ScratchSize;
 } BIG_INTEGER_CONTEXT, *PBIG_INTEGER_CONTEXT;
 
 typedef
@@ -898,6 +949,148 @@ Return Value:
 
 --*/
 
+CRYPTO_API
+VOID
+CyAesGcmInitialize (
+    PAES_GCM_CONTEXT Context,
+    AES_CIPHER_MODE Mode,
+    PUCHAR Key
+    );
+
+/*++
+
+Routine Description:
+
+    This routine initializes an AES Galois/Counter Mode context, expanding the
+    key and deriving the GHASH key.
+
+Arguments:
+
+    Context - Supplies a pointer to the GCM context.
+
+    Mode - Supplies the mode of AES to use. This must be either AesModeGcm128
+        or AesModeGcm256.
+
+    Key - Supplies the encryption/decryption key to use.
+
+Return Value:
+
+    None.
+
+--*/
+
+CRYPTO_API
+VOID
+CyAesGcmEncrypt (
+    PAES_GCM_CONTEXT Context,
+    PUCHAR InitializationVector,
+    UINTN InitializationVectorLength,
+    PUCHAR AdditionalData,
+    UINTN AdditionalDataLength,
+    PUCHAR Plaintext,
+    PUCHAR Ciphertext,
+    UINTN Length,
+    PUCHAR Tag,
+    UINTN TagLength
+    );
+
+/*++
+
+Routine Description:
+
+    This routine encrypts and authenticates a message using AES Galois/Counter
+    Mode.
+
+Arguments:
+
+    Context - Supplies a pointer to the GCM context.
+
+    InitializationVector - Supplies a pointer to the initialization vector,
+        which must never be reused with the same key.
+
+    InitializationVectorLength - Supplies the length of the initialization
+        vector in bytes. 12 bytes is the recommended (and fastest) size.
+
+    AdditionalData - Supplies an optional pointer to additional data that is
+        authenticated but not encrypted.
+
+    AdditionalDataLength - Supplies the length of the additional data in bytes.
+
+    Plaintext - Supplies a pointer to the plaintext buffer.
+
+    Ciphertext - Supplies a pointer where the ciphertext will be returned.
+        This may be the same as the plaintext buffer.
+
+    Length - Supplies the length of the plaintext and ciphertext buffers, in
+        bytes. This does not need to be a multiple of the block size.
+
+    Tag - Supplies a pointer where the authentication tag will be returned.
+
+    TagLength - Supplies the number of tag bytes to return, up to 16.
+
+Return Value:
+
+    None.
+
+--*/
+
+CRYPTO_API
+KSTATUS
+CyAesGcmDecrypt (
+    PAES_GCM_CONTEXT Context,
+    PUCHAR InitializationVector,
+    UINTN InitializationVectorLength,
+    PUCHAR AdditionalData,
+    UINTN AdditionalDataLength,
+    PUCHAR Ciphertext,
+    PUCHAR Plaintext,
+    UINTN Length,
+    PUCHAR Tag,
+    UINTN TagLength
+    );
+
+/*++
+
+Routine Description:
+
+    This routine verifies and decrypts a message using AES Galois/Counter Mode.
+
+Arguments:
+
+    Context - Supplies a pointer to the GCM context.
+
+    InitializationVector - Supplies a pointer to the initialization vector
+        used to encrypt the message.
+
+    InitializationVectorLength - Supplies the length of the initialization
+        vector in bytes.
+
+    AdditionalData - Supplies an optional pointer to the additional
+        authenticated data.
+
+    AdditionalDataLength - Supplies the length of the additional data in bytes.
+
+    Ciphertext - Supplies a pointer to the ciphertext buffer.
+
+    Plaintext - Supplies a pointer where the plaintext will be returned. This
+        may be the same as the ciphertext buffer.
+
+    Length - Supplies the length of the plaintext and ciphertext buffers, in
+        bytes.
+
+    Tag - Supplies a pointer to the authentication tag to verify.
+
+    TagLength - Supplies the length of the tag in bytes, up to 16.
+
+Return Value:
+
+    STATUS_SUCCESS if the tag is valid.
+
+    STATUS_CHECKSUM_MISMATCH if the message failed authentication. The
+    plaintext buffer is zeroed in this case.
+
+--*/
+
 CRYPTO_API
 VOID
 CySha1ComputeHmac (
@@ -1168,6 +1361,42 @@ Return Value:
 
 --*/
 
+CRYPTO_API
+VOID
+CySha256HashMultiple (
+    PVOID *Messages,
+    PUINTN Lengths,
+    UINTN Count,
+    PUCHAR Hashes
+    );
+
+/*++
+
+Routine Description:
+
+    This routine computes the SHA-256 hashes of several independent, complete
+    messages. On processors with wide vector units, several messages are
+    hashed at once, which is considerably faster than hashing them one at a
+    time when there is a large batch to verify.
+
+Arguments:
+
+    Messages - Supplies an array of pointers to the messages to hash.
+
+    Lengths - Supplies an array of the lengths of each message, in bytes.
+
+    Count - Supplies the number of messages.
+
+    Hashes - Supplies a pointer where the hashes will be returned. This buffer
+        must be Count * SHA256_HASH_SIZE bytes long, and receives the hash of
+        each message in order.
+
+Return Value:
+
+    None.
+
+--*/
+
 CRYPTO_API
 VOID
 CySha512Initialize (
@@ -522,6 +522,46 @@ Return Value:
 
 --*/
 
+OS_API
+KSTATUS
+OsIoRingEnter (
+    PIO_RING Ring,
+    ULONG MinimumCompletions,
+    ULONG TimeoutInMilliseconds,
+    PULONG SubmittedCount
+    );
+
+/*++
+
+Routine Description:
+
+    This routine enters an I/O ring. The kernel consumes the new submissions,
+    retries any that previously would have blocked, and posts completions for
+    everything that finishes. Completions already in the ring can be reaped
+    without calling this routine.
+
+Arguments:
+
+    Ring - Supplies a pointer to the I/O ring. The ring may only be entered by
+        one thread at a time.
+
+    MinimumCompletions - Supplies the number of unreaped completions that
+        should be in the completion queue before returning. Supply 0 to submit
+        without waiting.
+
+    TimeoutInMilliseconds - Supplies the number of milliseconds to wait for the
+        minimum completions. Use SYS_WAIT_TIME_INDEFINITE to wait forever.
+
+    SubmittedCount - Supplies an optional pointer where the number of new
+        submissions consumed by the kernel will be returned.
+
+Return Value:
+
+    Status code. Timing out waiting for completions is not a failure; check
+    the completion queue.
+
+--*/
+
 OS_API
 KSTATUS
 OsCreatePipe (
@@ -2904,6 +2944,48 @@ Return Value:
 
 --*/
 
+OS_API
+KSTATUS
+OsSocketAcceptMultiple (
+    HANDLE Socket,
+    PSOCKET_ACCEPT_ENTRY Entries,
+    UINTN EntryCount,
+    ULONG OpenFlags,
+    PUINTN AcceptedCount
+    );
+
+/*++
+
+Routine Description:
+
+    This routine accepts several pending connections on a listening socket
+    with a single system call. It blocks only until the first connection
+    arrives, and then accepts whatever else is already pending.
+
+Arguments:
+
+    Socket - Supplies the listening socket to accept new connections from.
+
+    Entries - Supplies an array of entries where the new sockets, remote
+        addresses, and remote paths will be returned. The remote path buffer
+        and size of each entry must be initialized by the caller.
+
+    EntryCount - Supplies the number of elements in the entry array. This may
+        be at most SOCKET_BATCH_MAX_COUNT.
+
+    OpenFlags - Supplies an optional bitfield of open flags for the new
+        sockets. Only SYS_OPEN_FLAG_NON_BLOCKING and
+        SYS_OPEN_FLAG_CLOSE_ON_EXECUTE are accepted.
+
+    AcceptedCount - Supplies a pointer where the number of connections
+        accepted will be returned.
+
+Return Value:
+
+    Status code. If at least one connection was accepted, success is returned.
+
+--*/
+
 OS_API
 KSTATUS
 OsSocketConnect (
@@ -2998,6 +3080,48 @@ Return Value:
 
 --*/
 
+OS_API
+KSTATUS
+OsSocketPerformBatchIo (
+    HANDLE Socket,
+    PSOCKET_IO_MESSAGE Messages,
+    UINTN MessageCount,
+    ULONG TimeoutInMilliseconds,
+    PUINTN CompletedCount
+    );
+
+/*++
+
+Routine Description:
+
+    This routine sends or receives several messages on a socket with a single
+    system call. Messages are processed in order, and processing stops at the
+    first one that fails.
+
+Arguments:
+
+    Socket - Supplies the socket handle.
+
+    Messages - Supplies an array of messages, each with its own socket I/O
+        parameters and I/O vector. The parameters of each processed message
+        are updated on return.
+
+    MessageCount - Supplies the number of elements in the message array. This
+        may be at most SOCKET_BATCH_MAX_COUNT.
+
+    TimeoutInMilliseconds - Supplies the number of milliseconds the whole
+        batch may take, which limits each message's own timeout. Supply
+        SYS_WAIT_TIME_INDEFINITE to rely only on the per-message timeouts.
+
+    CompletedCount - Supplies a pointer where the number of messages
+        processed will be returned.
+
+Return Value:
+
+    Status code. If at least one message was processed, success is returned.
+
+--*/
+
 OS_API
 KSTATUS
 OsSocketGetSetInformation (
@@ -37,6 +37,15 @@ Module Name:
 #define IP4_IS_MULTICAST_ADDRESS(_Ip4Address) \
     (((_Ip4Address) & 0x000000F0) == 0x000000E0)
 
+//
+// This macro determines whether or not the given IPv4 address is in the
+// loopback network, 127.0.0.0/8. The address is treated as being in network
+// byte order.
+//
+
+#define IP4_IS_LOOPBACK_ADDRESS(_Ip4Address) \
+    (((_Ip4Address) & IP4_LOOPBACK_SUBNET_MASK) == IP4_LOOPBACK_NETWORK)
+
 //
 // ---------------------------------------------------------------- Definitions
 //
@@ -73,6 +82,15 @@ Module Name:
 
 #define IP4_BROADCAST_ADDRESS    0xFFFFFFFF
 
+//
+// Define the loopback network and the address given to loopback links, all in
+// network byte order.
+//
+
+#define IP4_LOOPBACK_NETWORK     CPU_TO_NETWORK32(0x7F000000)
+#define IP4_LOOPBACK_SUBNET_MASK CPU_TO_NETWORK32(0xFF000000)
+#define IP4_LOOPBACK_ADDRESS     CPU_TO_NETWORK32(0x7F000001)
+
 #define IP4_ADDRESS_SIZE         4
 
 //
@@ -135,6 +135,13 @@ Module Name:
     (_ExistingList)->Count += (_AppendList)->Count;                \
     NET_INITIALIZE_PACKET_LIST(_AppendList);
 
+//
+// This macro determines if the given link is a loopback link.
+//
+
+#define NET_IS_LOOPBACK_LINK(_Link) \
+    ((_Link)->Properties.DataLinkType == NetDomainLoopback)
+
 //
 // ---------------------------------------------------------------- Definitions
 //
@@ -160,6 +167,7 @@ Module Name:
 #define NET_SPEED_100_MBPS 100000000ULL
 #define NET_SPEED_1000_MBPS 1000000000ULL
 #define NET_SPEED_2500_MBPS 2500000000ULL
+#define NET_SPEED_10000_MBPS 10000000000ULL
 
 //
 // Define well-known protocol numbers.
@@ -259,6 +267,16 @@ Module Name:
     (NET_LINK_CAPABILITY_CHECKSUM_TRANSMIT_MASK | \
      NET_LINK_CAPABILITY_CHECKSUM_RECEIVE_MASK)
 
+//
+// Define the size of the loopback data link header, which only carries the
+// network protocol number, and the largest payload a loopback link carries.
+// Loopback packets never touch a wire, so the payload is only limited by the
+// largest packet the network layers can describe.
+//
+
+#define LOOPBACK_HEADER_SIZE sizeof(ULONG)
+#define LOOPBACK_MAXIMUM_PAYLOAD_SIZE 0x10000
+
 //
 // Define the network packet size information flags.
 //
@@ -1434,7 +1452,8 @@ KSTATUS
 (*PNET_PROTOCOL_ACCEPT) (
     PNET_SOCKET Socket,
     PIO_HANDLE *NewConnectionSocket,
-    PNETWORK_ADDRESS RemoteAddress
+    PNETWORK_ADDRESS RemoteAddress,
+    ULONG TimeoutInMilliseconds
     );
 
 /*++
@@ -1455,6 +1474,10 @@ Routine Description:
     RemoteAddress - Supplies a pointer where the address of the connected
         remote host will be returned.
 
+    TimeoutInMilliseconds - Supplies the number of milliseconds to wait for
+        a connection to come in. Use WAIT_TIME_INDEFINITE to wait forever.
+        A non-blocking socket never waits, regardless of this value.
+
 Return Value:
 
     Status code.
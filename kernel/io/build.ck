@@ -55,6 +55,7 @@ function build() {
         "intrupt.c",
         "iobase.c",
         "iohandle.c",
+        "ioring.c",
         "irp.c",
         "mount.c",
         "obfs.c",
@@ -231,6 +231,11 @@ Return Value:
         goto InitializeEnd;
     }
 
+    Status = IopInitializeIrpStackCache();
+    if (!KSUCCESS(Status)) {
+        goto InitializeEnd;
+    }
+
     //
     // Create the pipe directory.
     //
@@ -427,7 +432,16 @@ Return Value:
     KSTATUS Status;
     ULONG WorkQueueFlags;
 
-    WorkQueueFlags = WORK_QUEUE_FLAG_SUPPORT_DISPATCH_LEVEL;
+    //
+    // Device work is serialized per device by the device's own queue, so
+    // different devices can be started, queried, and removed in parallel.
+    // Give the device work queue a pool per processor so that one device
+    // stuck waiting on slow hardware does not hold up all the others.
+    //
+
+    WorkQueueFlags = WORK_QUEUE_FLAG_SUPPORT_DISPATCH_LEVEL |
+                     WORK_QUEUE_FLAG_PER_PROCESSOR;
+
     IoDeviceWorkQueue = KeCreateWorkQueue(WorkQueueFlags, "IoDeviceWorker");
     if (IoDeviceWorkQueue == NULL) {
         Status = STATUS_INSUFFICIENT_RESOURCES;
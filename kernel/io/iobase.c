@@ -2043,6 +2043,8 @@ Return Value:
 
         RenameRequest.Name = DestinationFile;
         RenameRequest.NameSize = DestinationFileSize;
+        RenameRequest.SourceName = SourcePathPoint.PathEntry->Name;
+        RenameRequest.SourceNameSize = SourcePathPoint.PathEntry->NameSize;
         RenameRequest.DestinationFileUnlinked = FALSE;
         RenameRequest.DestinationDirectorySize = 0;
         RenameRequest.SourceFileProperties = &(SourceFileObject->Properties);
@@ -2329,9 +2331,8 @@ Return Value:
                                        SourceFileObject);
 
             if (NewPathEntry != NULL) {
-                INSERT_BEFORE(
-                        &(NewPathEntry->SiblingListEntry),
-                        &(DestinationDirectoryPathPoint.PathEntry->ChildList));
+                IopPathLink(DestinationDirectoryPathPoint.PathEntry,
+                            NewPathEntry);
 
                 IopFileObjectAddReference(SourceFileObject);
             }
@@ -2413,6 +2414,366 @@ Return Value:
     return Status;
 }
 
+KERNEL_API
+KSTATUS
+IoCreateHardLink (
+    BOOL FromKernelMode,
+    PIO_HANDLE ExistingFileDirectory,
+    PCSTR ExistingFilePath,
+    ULONG ExistingFilePathSize,
+    PIO_HANDLE LinkDirectory,
+    PCSTR LinkPath,
+    ULONG LinkPathSize,
+    BOOL FollowLinks
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates a new directory entry for an existing file. The
+    existing file must not be a directory, and the new entry must live on the
+    same volume as the file and must not already exist. The caller must have
+    write access to the directory receiving the new entry.
+
+Arguments:
+
+    FromKernelMode - Supplies a boolean indicating the request is coming from
+        kernel mode.
+
+    ExistingFileDirectory - Supplies an optional pointer to a handle to the
+        directory to start at for a relative existing file path. If this is
+        not supplied, then the current working directory of the process is
+        used.
+
+    ExistingFilePath - Supplies a pointer to the path of the existing file.
+
+    ExistingFilePathSize - Supplies the size of the existing file path buffer
+        in bytes, including the null terminator.
+
+    LinkDirectory - Supplies an optional pointer to a handle to the directory
+        to start at for a relative link path. If this is not supplied, then the
+        current working directory of the process is used.
+
+    LinkPath - Supplies a pointer to the path of the new link to create.
+
+    LinkPathSize - Supplies the size of the link path buffer in bytes,
+        including the null terminator.
+
+    FollowLinks - Supplies a boolean indicating whether to link to the target
+        of the existing file path if it is a symbolic link (TRUE) or to the
+        symbolic link itself (FALSE).
+
+Return Value:
+
+    STATUS_NOT_SUPPORTED if the file system does not support hard links.
+
+    Other status codes.
+
+--*/
+
+{
+
+    PDEVICE Device;
+    PFILE_OBJECT DirectoryFileObject;
+    PATH_POINT DirectoryPathPoint;
+    PCSTR DirectoryPath;
+    ULONG DirectoryPathSize;
+    PFILE_OBJECT FileObject;
+    PATH_POINT FilePathPoint;
+    PPATH_POINT FileStartPathPoint;
+    PATH_POINT FoundPathPoint;
+    SYSTEM_CONTROL_LINK LinkRequest;
+    PSTR LinkDirectoryPath;
+    ULONG LinkDirectoryPathSize;
+    PSTR LinkName;
+    ULONG LinkNameSize;
+    PPATH_POINT LinkStartPathPoint;
+    PCSTR LocalPath;
+    ULONG LocalPathSize;
+    BOOL LocksHeld;
+    ULONG NameHash;
+    PPATH_ENTRY NewPathEntry;
+    ULONG OpenFlags;
+    KSTATUS Status;
+
+    DirectoryFileObject = NULL;
+    DirectoryPathPoint.PathEntry = NULL;
+    FileObject = NULL;
+    FilePathPoint.PathEntry = NULL;
+    FileStartPathPoint = NULL;
+    FoundPathPoint.PathEntry = NULL;
+    LinkDirectoryPath = NULL;
+    LinkName = NULL;
+    LinkStartPathPoint = NULL;
+    LocksHeld = FALSE;
+    NewPathEntry = NULL;
+    if ((ExistingFilePathSize <= 1) || (LinkPathSize <= 1)) {
+        Status = STATUS_PATH_NOT_FOUND;
+        goto CreateHardLinkEnd;
+    }
+
+    if (ExistingFileDirectory != NULL) {
+        FileStartPathPoint = &(ExistingFileDirectory->PathPoint);
+        if (FileStartPathPoint->PathEntry->FileObject->Properties.Type !=
+            IoObjectRegularDirectory) {
+
+            Status = STATUS_NOT_A_DIRECTORY;
+            goto CreateHardLinkEnd;
+        }
+    }
+
+    if (LinkDirectory != NULL) {
+        LinkStartPathPoint = &(LinkDirectory->PathPoint);
+        if (LinkStartPathPoint->PathEntry->FileObject->Properties.Type !=
+            IoObjectRegularDirectory) {
+
+            Status = STATUS_NOT_A_DIRECTORY;
+            goto CreateHardLinkEnd;
+        }
+    }
+
+    //
+    // Get the existing file, which must not be a directory.
+    //
+
+    OpenFlags = OPEN_FLAG_NO_MOUNT_POINT;
+    if (FollowLinks == FALSE) {
+        OpenFlags |= OPEN_FLAG_SYMBOLIC_LINK;
+    }
+
+    LocalPath = ExistingFilePath;
+    LocalPathSize = ExistingFilePathSize;
+    Status = IopPathWalk(FromKernelMode,
+                         FileStartPathPoint,
+                         &LocalPath,
+                         &LocalPathSize,
+                         OpenFlags,
+                         NULL,
+                         &FilePathPoint);
+
+    if (!KSUCCESS(Status)) {
+        goto CreateHardLinkEnd;
+    }
+
+    FileObject = FilePathPoint.PathEntry->FileObject;
+    if (FileObject->Properties.Type == IoObjectRegularDirectory) {
+        Status = STATUS_FILE_IS_DIRECTORY;
+        goto CreateHardLinkEnd;
+    }
+
+    //
+    // Split the link path into a directory part and a name part, and find the
+    // directory.
+    //
+
+    Status = IopPathSplit(LinkPath,
+                          LinkPathSize,
+                          &LinkDirectoryPath,
+                          &LinkDirectoryPathSize,
+                          &LinkName,
+                          &LinkNameSize);
+
+    if (!KSUCCESS(Status)) {
+        goto CreateHardLinkEnd;
+    }
+
+    if ((LinkNameSize <= 1) ||
+        (RtlAreStringsEqual(LinkName, ".", LinkNameSize) != FALSE) ||
+        (RtlAreStringsEqual(LinkName, "..", LinkNameSize) != FALSE)) {
+
+        Status = STATUS_FILE_EXISTS;
+        goto CreateHardLinkEnd;
+    }
+
+    DirectoryPath = LinkDirectoryPath;
+    DirectoryPathSize = LinkDirectoryPathSize;
+    if ((DirectoryPathSize == 0) ||
+        ((DirectoryPathSize == 1) && (DirectoryPath[0] == '\0'))) {
+
+        DirectoryPath = ".";
+        DirectoryPathSize = sizeof(".");
+    }
+
+    Status = IopPathWalk(FromKernelMode,
+                         LinkStartPathPoint,
+                         &DirectoryPath,
+                         &DirectoryPathSize,
+                         0,
+                         NULL,
+                         &DirectoryPathPoint);
+
+    if (!KSUCCESS(Status)) {
+        goto CreateHardLinkEnd;
+    }
+
+    DirectoryFileObject = DirectoryPathPoint.PathEntry->FileObject;
+    if (DirectoryFileObject->Properties.Type != IoObjectRegularDirectory) {
+        Status = STATUS_NOT_A_DIRECTORY;
+        goto CreateHardLinkEnd;
+    }
+
+    Status = IopCheckPermissions(FromKernelMode,
+                                 &DirectoryPathPoint,
+                                 IO_ACCESS_WRITE);
+
+    if (!KSUCCESS(Status)) {
+        goto CreateHardLinkEnd;
+    }
+
+    //
+    // Links don't work across file systems, and only devices and volumes can
+    // handle them.
+    //
+
+    Device = FileObject->Device;
+    if (Device != DirectoryFileObject->Device) {
+        Status = STATUS_CROSS_DEVICE;
+        goto CreateHardLinkEnd;
+    }
+
+    if ((Device->Header.Type != ObjectDevice) &&
+        (Device->Header.Type != ObjectVolume)) {
+
+        Status = STATUS_ACCESS_DENIED;
+        goto CreateHardLinkEnd;
+    }
+
+    //
+    // Lock the directory and the file. The file is locked to synchronize the
+    // hard link count with unlink and file property writes.
+    //
+
+    IopAcquireFileObjectLocksExclusive(DirectoryFileObject, FileObject);
+    LocksHeld = TRUE;
+
+    //
+    // If the directory or the file have been unlinked, act like the paths were
+    // not found. It's okay if the directory has no siblings if it's a mount
+    // point, as some mounts are just floating path entries.
+    //
+
+    if ((FileObject->Properties.HardLinkCount == 0) ||
+        ((DirectoryPathPoint.PathEntry->SiblingListEntry.Next == NULL) &&
+         (!IO_IS_MOUNT_POINT(&DirectoryPathPoint)))) {
+
+        Status = STATUS_PATH_NOT_FOUND;
+        goto CreateHardLinkEnd;
+    }
+
+    //
+    // Now that the directory lock is held, make sure nothing sits at the
+    // destination.
+    //
+
+    Status = IopPathLookup(FromKernelMode,
+                           LinkStartPathPoint,
+                           &DirectoryPathPoint,
+                           TRUE,
+                           LinkName,
+                           LinkNameSize,
+                           OPEN_FLAG_NO_MOUNT_POINT,
+                           NULL,
+                           &FoundPathPoint);
+
+    if (KSUCCESS(Status)) {
+        Status = STATUS_FILE_EXISTS;
+        goto CreateHardLinkEnd;
+    }
+
+    if (Status != STATUS_PATH_NOT_FOUND) {
+        goto CreateHardLinkEnd;
+    }
+
+    //
+    // If there's a negative path entry there, unlink it. The reference will be
+    // released at the end.
+    //
+
+    if (FoundPathPoint.PathEntry != NULL) {
+
+        ASSERT(FoundPathPoint.PathEntry->Negative != FALSE);
+
+        IopPathUnlink(FoundPathPoint.PathEntry);
+    }
+
+    LinkRequest.DirectoryProperties = &(DirectoryFileObject->Properties);
+    LinkRequest.FileProperties = &(FileObject->Properties);
+    LinkRequest.DirectorySize = 0;
+    LinkRequest.Name = LinkName;
+    LinkRequest.NameSize = LinkNameSize;
+    Status = IopSendSystemControlIrp(Device,
+                                     IrpMinorSystemControlLink,
+                                     &LinkRequest);
+
+    if (!KSUCCESS(Status)) {
+        if (Status == STATUS_NOT_HANDLED) {
+            Status = STATUS_NOT_SUPPORTED;
+        }
+
+        goto CreateHardLinkEnd;
+    }
+
+    IopFileObjectIncrementHardLinkCount(FileObject);
+    IopUpdateFileObjectFileSize(DirectoryFileObject,
+                                LinkRequest.DirectorySize);
+
+    IopUpdateFileObjectTime(DirectoryFileObject, FileObjectModifiedTime);
+
+    //
+    // Create a path entry for the new link to avoid a file system lookup the
+    // next time it is opened.
+    //
+
+    if (FilePathPoint.PathEntry->DoNotCache == FALSE) {
+        NameHash = IopHashPathString(LinkName, LinkNameSize);
+        NewPathEntry = IopCreatePathEntry(LinkName,
+                                          LinkNameSize,
+                                          NameHash,
+                                          DirectoryPathPoint.PathEntry,
+                                          FileObject);
+
+        if (NewPathEntry != NULL) {
+            IopPathLink(DirectoryPathPoint.PathEntry, NewPathEntry);
+            IopFileObjectAddReference(FileObject);
+        }
+    }
+
+CreateHardLinkEnd:
+    if (LocksHeld != FALSE) {
+        KeReleaseSharedExclusiveLockExclusive(FileObject->Lock);
+        if (DirectoryFileObject != FileObject) {
+            KeReleaseSharedExclusiveLockExclusive(DirectoryFileObject->Lock);
+        }
+    }
+
+    if (FilePathPoint.PathEntry != NULL) {
+        IO_PATH_POINT_RELEASE_REFERENCE(&FilePathPoint);
+    }
+
+    if (DirectoryPathPoint.PathEntry != NULL) {
+        IO_PATH_POINT_RELEASE_REFERENCE(&DirectoryPathPoint);
+    }
+
+    if (FoundPathPoint.PathEntry != NULL) {
+        IO_PATH_POINT_RELEASE_REFERENCE(&FoundPathPoint);
+    }
+
+    if (NewPathEntry != NULL) {
+        IoPathEntryReleaseReference(NewPathEntry);
+    }
+
+    if (LinkDirectoryPath != NULL) {
+        MmFreePagedPool(LinkDirectoryPath);
+    }
+
+    if (LinkName != NULL) {
+        MmFreePagedPool(LinkName);
+    }
+
+    return Status;
+}
+
 KERNEL_API
 KSTATUS
 IoCreateSymbolicLink (
@@ -447,6 +447,10 @@ Structure Description:
     CacheListEntry - Stores pointers to the next and previous entries in the
         LRU list of the path entry cache.
 
+    HashListEntry - Stores pointers to the next and previous entries in the
+        path entry hash table bucket. Path walks search this list without
+        holding any locks.
+
     ReferenceCount - Stores the reference count of the entry.
 
     MountCount - Stores the number of mount points mounted on this path entry.
@@ -482,6 +486,7 @@ Structure Description:
 struct _PATH_ENTRY {
     LIST_ENTRY SiblingListEntry;
     LIST_ENTRY CacheListEntry;
+    LIST_ENTRY HashListEntry;
     volatile ULONG ReferenceCount;
     volatile ULONG MountCount;
     BOOL Negative;
@@ -4063,6 +4068,32 @@ Return Value:
 
 --*/
 
+VOID
+IopPathLink (
+    PPATH_ENTRY Parent,
+    PPATH_ENTRY Entry
+    );
+
+/*++
+
+Routine Description:
+
+    This routine links the given path entry into its parent's list of
+    children and into the path entry hash table. This assumes the caller holds
+    the parent path entry's file object lock exclusively.
+
+Arguments:
+
+    Parent - Supplies a pointer to the parent path entry.
+
+    Entry - Supplies a pointer to the path entry to link in.
+
+Return Value:
+
+    None.
+
+--*/
+
 VOID
 IopPathUnlink (
     PPATH_ENTRY Entry
@@ -4553,6 +4584,27 @@ Return Value:
 
 --*/
 
+KSTATUS
+IopInitializeIrpStackCache (
+    VOID
+    );
+
+/*++
+
+Routine Description:
+
+    This routine creates the object cache that IRP stacks are allocated from.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Status code.
+
+--*/
+
 KSTATUS
 IopSendSystemControlIrp (
     PDEVICE Device,
@@ -0,0 +1,772 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    ioring.c
+
+Abstract:
+
+    This module implements I/O rings, a pair of submission and completion
+    queues in user mode memory that let a process batch many I/O requests
+    into a single system call and reap their results without one.
+
+Author:
+
+    agent 19-Oct-2026
+
+Environment:
+
+    Kernel
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <minoca/kernel/kernel.h>
+#include "iop.h"
+
+//
+// --------------------------------------------------------------------- Macros
+//
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// Define the number of objects waited on for each pending request: the error
+// event and either the read or write event.
+//
+
+#define IO_RING_WAIT_OBJECTS_PER_REQUEST 2
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+KSTATUS
+IopIoRingValidate (
+    PIO_RING Ring,
+    ULONG MinimumCompletions
+    );
+
+BOOL
+IopIoRingPerformRequest (
+    PKPROCESS Process,
+    PIO_RING_SUBMISSION Submission,
+    PINTN Result
+    );
+
+KSTATUS
+IopIoRingPostCompletion (
+    PIO_RING Ring,
+    PIO_RING_SUBMISSION Submission,
+    INTN Result
+    );
+
+KSTATUS
+IopIoRingPublish (
+    PIO_RING UserRing,
+    PIO_RING Ring
+    );
+
+KSTATUS
+IopIoRingWait (
+    PKPROCESS Process,
+    PIO_RING Ring,
+    ULONG TimeoutInMilliseconds
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+INTN
+IoSysIoRingEnter (
+    PVOID SystemCallParameter
+    )
+
+/*++
+
+Routine Description:
+
+    This routine implements the system call for entering an I/O ring. It
+    consumes new submissions, retries any pending ones, and waits for the
+    requested number of completions.
+
+Arguments:
+
+    SystemCallParameter - Supplies a pointer to the parameters supplied with
+        the system call. This structure will be a stack-local copy of the
+        actual parameters passed from user-mode.
+
+Return Value:
+
+    Returns the number of new submissions consumed (a non-negative integer)
+    on success.
+
+    Error status code (a negative integer) on failure.
+
+--*/
+
+{
+
+    ULONG Available;
+    ULONGLONG CurrentTime;
+    ULONGLONG EndTime;
+    ULONG Index;
+    ULONG Kept;
+    PSYSTEM_CALL_IO_RING_ENTER Parameters;
+    PKPROCESS Process;
+    ULONG Queued;
+    INTN Result;
+    IO_RING Ring;
+    KSTATUS Status;
+    IO_RING_SUBMISSION Submission;
+    INTN Submitted;
+    ULONGLONG TimeCounterFrequency;
+    ULONG Timeout;
+    PIO_RING UserRing;
+    BOOL Validated;
+    ULONG WaitTime;
+
+    Parameters = (PSYSTEM_CALL_IO_RING_ENTER)SystemCallParameter;
+    Process = PsGetCurrentProcess();
+    Submitted = 0;
+    UserRing = Parameters->Ring;
+    Validated = FALSE;
+    Status = MmCopyFromUserMode(&Ring, UserRing, sizeof(IO_RING));
+    if (!KSUCCESS(Status)) {
+        goto SysIoRingEnterEnd;
+    }
+
+    Status = IopIoRingValidate(&Ring, Parameters->MinimumCompletions);
+    if (!KSUCCESS(Status)) {
+        goto SysIoRingEnterEnd;
+    }
+
+    Validated = TRUE;
+
+    ASSERT(SYS_WAIT_TIME_INDEFINITE == WAIT_TIME_INDEFINITE);
+
+    EndTime = 0;
+    TimeCounterFrequency = 0;
+    Timeout = Parameters->TimeoutInMilliseconds;
+    if ((Timeout != 0) && (Timeout != WAIT_TIME_INDEFINITE)) {
+        EndTime = KeGetRecentTimeCounter();
+        EndTime += KeConvertMicrosecondsToTimeTicks(
+                                       Timeout * MICROSECONDS_PER_MILLISECOND);
+
+        TimeCounterFrequency = HlQueryTimeCounterFrequency();
+    }
+
+    while (TRUE) {
+
+        //
+        // Retry the requests that would have blocked last time, compacting
+        // the ones that still would.
+        //
+
+        Kept = 0;
+        for (Index = 0; Index < Ring.PendingCount; Index += 1) {
+            Status = MmCopyFromUserMode(&Submission,
+                                        &(Ring.Pending[Index]),
+                                        sizeof(IO_RING_SUBMISSION));
+
+            if (!KSUCCESS(Status)) {
+                goto SysIoRingEnterEnd;
+            }
+
+            if (IopIoRingPerformRequest(Process, &Submission, &Result) !=
+                FALSE) {
+
+                Status = IopIoRingPostCompletion(&Ring, &Submission, Result);
+
+            } else if (Kept != Index) {
+                Status = MmCopyToUserMode(&(Ring.Pending[Kept]),
+                                          &Submission,
+                                          sizeof(IO_RING_SUBMISSION));
+
+                Kept += 1;
+
+            } else {
+                Kept += 1;
+            }
+
+            if (!KSUCCESS(Status)) {
+                goto SysIoRingEnterEnd;
+            }
+        }
+
+        Ring.PendingCount = Kept;
+
+        //
+        // Consume new submissions. Only take a submission if there is a
+        // completion slot for it, counting the pending requests that will
+        // eventually need one too. The pending array is only as big as the
+        // submission queue, so also stop once it is full. Anything left
+        // stays in the submission queue until a pending request finishes.
+        //
+
+        while (Ring.SubmissionHead != Ring.SubmissionTail) {
+            Queued = Ring.CompletionTail - Ring.CompletionHead +
+                     Ring.PendingCount;
+
+            if ((Queued >= Ring.CompletionCount) ||
+                (Ring.PendingCount >= Ring.SubmissionCount)) {
+
+                break;
+            }
+
+            Index = Ring.SubmissionHead & (Ring.SubmissionCount - 1);
+            Status = MmCopyFromUserMode(&Submission,
+                                        &(Ring.Submissions[Index]),
+                                        sizeof(IO_RING_SUBMISSION));
+
+            if (!KSUCCESS(Status)) {
+                goto SysIoRingEnterEnd;
+            }
+
+            Ring.SubmissionHead += 1;
+            Submitted += 1;
+            if (IopIoRingPerformRequest(Process, &Submission, &Result) !=
+                FALSE) {
+
+                Status = IopIoRingPostCompletion(&Ring, &Submission, Result);
+
+            } else {
+                Status = MmCopyToUserMode(&(Ring.Pending[Ring.PendingCount]),
+                                          &Submission,
+                                          sizeof(IO_RING_SUBMISSION));
+
+                Ring.PendingCount += 1;
+            }
+
+            if (!KSUCCESS(Status)) {
+                goto SysIoRingEnterEnd;
+            }
+        }
+
+        Status = IopIoRingPublish(UserRing, &Ring);
+        if (!KSUCCESS(Status)) {
+            goto SysIoRingEnterEnd;
+        }
+
+        Available = Ring.CompletionTail - Ring.CompletionHead;
+        if ((Available >= Parameters->MinimumCompletions) ||
+            (Available > Ring.CompletionCount) ||
+            (Ring.PendingCount == 0)) {
+
+            Status = STATUS_SUCCESS;
+            break;
+        }
+
+        if (Timeout == 0) {
+            WaitTime = 0;
+
+        } else if (Timeout != WAIT_TIME_INDEFINITE) {
+            CurrentTime = KeGetRecentTimeCounter();
+            WaitTime = 0;
+            if (CurrentTime < EndTime) {
+                WaitTime = (EndTime - CurrentTime) * MILLISECONDS_PER_SECOND /
+                           TimeCounterFrequency;
+            }
+
+        } else {
+            WaitTime = WAIT_TIME_INDEFINITE;
+        }
+
+        if (WaitTime == 0) {
+            Status = STATUS_SUCCESS;
+            break;
+        }
+
+        //
+        // Wait for one of the pending requests to become ready, then go
+        // around and retry them all.
+        //
+
+        Status = IopIoRingWait(Process, &Ring, WaitTime);
+        if (Status == STATUS_TIMEOUT) {
+            Timeout = 0;
+            continue;
+        }
+
+        if (!KSUCCESS(Status)) {
+            goto SysIoRingEnterEnd;
+        }
+    }
+
+SysIoRingEnterEnd:
+
+    //
+    // Consumed submissions cannot be put back, so if any made it in then
+    // publish what was done and report success. The caller will find the
+    // rest in the ring.
+    //
+
+    if ((Validated != FALSE) && (!KSUCCESS(Status))) {
+        IopIoRingPublish(UserRing, &Ring);
+    }
+
+    Result = Status;
+    if ((KSUCCESS(Status)) || (Submitted != 0)) {
+        Result = Submitted;
+    }
+
+    return Result;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+KSTATUS
+IopIoRingValidate (
+    PIO_RING Ring,
+    ULONG MinimumCompletions
+    )
+
+/*++
+
+Routine Description:
+
+    This routine validates a kernel mode copy of an I/O ring header.
+
+Arguments:
+
+    Ring - Supplies a pointer to the kernel mode copy of the ring.
+
+    MinimumCompletions - Supplies the number of completions the caller wants
+        to wait for.
+
+Return Value:
+
+    STATUS_SUCCESS if the ring is sane.
+
+    STATUS_INVALID_PARAMETER if the ring is malformed.
+
+--*/
+
+{
+
+    PVOID End;
+    UINTN Size;
+
+    if ((Ring->SubmissionCount == 0) ||
+        (Ring->SubmissionCount > IO_RING_MAX_ENTRIES) ||
+        (!POWER_OF_2(Ring->SubmissionCount)) ||
+        (Ring->CompletionCount == 0) ||
+        (Ring->CompletionCount > IO_RING_MAX_ENTRIES) ||
+        (!POWER_OF_2(Ring->CompletionCount)) ||
+        (MinimumCompletions > Ring->CompletionCount) ||
+        (Ring->PendingCount > Ring->SubmissionCount) ||
+        (Ring->SubmissionTail - Ring->SubmissionHead >
+         Ring->SubmissionCount) ||
+        (Ring->CompletionTail - Ring->CompletionHead >
+         Ring->CompletionCount)) {
+
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    //
+    // The arrays are touched with user mode copies, which fault gracefully,
+    // but make sure none of them wrap or reach into kernel space.
+    //
+
+    Size = Ring->SubmissionCount * sizeof(IO_RING_SUBMISSION);
+    End = (PVOID)Ring->Submissions + Size;
+    if ((End > USER_VA_END) || (End < (PVOID)Ring->Submissions)) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    End = (PVOID)Ring->Pending + Size;
+    if ((End > USER_VA_END) || (End < (PVOID)Ring->Pending)) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    Size = Ring->CompletionCount * sizeof(IO_RING_COMPLETION);
+    End = (PVOID)Ring->Completions + Size;
+    if ((End > USER_VA_END) || (End < (PVOID)Ring->Completions)) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+BOOL
+IopIoRingPerformRequest (
+    PKPROCESS Process,
+    PIO_RING_SUBMISSION Submission,
+    PINTN Result
+    )
+
+/*++
+
+Routine Description:
+
+    This routine attempts a single I/O ring request without blocking. Reads
+    and writes go down the same cached I/O path as the perform I/O system
+    call, but with a zero timeout.
+
+Arguments:
+
+    Process - Supplies a pointer to the current process.
+
+    Submission - Supplies a pointer to the kernel mode copy of the request.
+
+    Result - Supplies a pointer where the completion result will be returned:
+        the number of bytes completed, or a negative status code.
+
+Return Value:
+
+    TRUE if the request completed, successfully or not.
+
+    FALSE if the request would have blocked and should be retried later.
+
+--*/
+
+{
+
+    UINTN BytesCompleted;
+    PIO_HANDLE Handle;
+    IO_BUFFER IoBuffer;
+    INTN Size;
+    KSTATUS Status;
+
+    BytesCompleted = 0;
+    Handle = NULL;
+    if (Submission->Operation == IoRingOperationNop) {
+        Status = STATUS_SUCCESS;
+        goto IoRingPerformRequestEnd;
+    }
+
+    if (Submission->Operation >= IoRingOperationCount) {
+        Status = STATUS_INVALID_PARAMETER;
+        goto IoRingPerformRequestEnd;
+    }
+
+    Handle = ObGetHandleValue(Process->HandleTable, Submission->Handle, NULL);
+    if (Handle == NULL) {
+        Status = STATUS_INVALID_HANDLE;
+        goto IoRingPerformRequestEnd;
+    }
+
+    if (Submission->Operation == IoRingOperationFlush) {
+        Status = IoFlush(Handle, 0, -1, 0);
+        goto IoRingPerformRequestEnd;
+    }
+
+    Size = (INTN)(Submission->Size);
+    if (Size <= 0) {
+        Status = STATUS_SUCCESS;
+        goto IoRingPerformRequestEnd;
+    }
+
+    if ((Submission->Buffer + Size > USER_VA_END) ||
+        (Submission->Buffer + Size < Submission->Buffer)) {
+
+        Status = STATUS_INVALID_PARAMETER;
+        goto IoRingPerformRequestEnd;
+    }
+
+    Status = MmInitializeIoBuffer(&IoBuffer,
+                                  Submission->Buffer,
+                                  INVALID_PHYSICAL_ADDRESS,
+                                  Size,
+                                  0);
+
+    if (!KSUCCESS(Status)) {
+        goto IoRingPerformRequestEnd;
+    }
+
+    if (Submission->Operation == IoRingOperationWrite) {
+        Status = IoWriteAtOffset(Handle,
+                                 &IoBuffer,
+                                 Submission->Offset,
+                                 Size,
+                                 0,
+                                 0,
+                                 &BytesCompleted,
+                                 NULL);
+
+        if (Status == STATUS_BROKEN_PIPE) {
+            PsSignalProcess(Process, SIGNAL_BROKEN_PIPE, NULL);
+        }
+
+    } else {
+        Status = IoReadAtOffset(Handle,
+                                &IoBuffer,
+                                Submission->Offset,
+                                Size,
+                                0,
+                                0,
+                                &BytesCompleted,
+                                NULL);
+    }
+
+    //
+    // Requests on objects that can be waited on stay pending if they made no
+    // progress. Anything that transferred data completes with what it got.
+    //
+
+    if (((Status == STATUS_TIMEOUT) || (Status == STATUS_TRY_AGAIN)) &&
+        (BytesCompleted == 0) &&
+        (Handle->FileObject->IoState != NULL)) {
+
+        IoIoHandleReleaseReference(Handle);
+        return FALSE;
+    }
+
+IoRingPerformRequestEnd:
+    if (Handle != NULL) {
+        IoIoHandleReleaseReference(Handle);
+    }
+
+    if ((KSUCCESS(Status)) || (BytesCompleted != 0)) {
+
+        ASSERT(BytesCompleted <= (UINTN)MAX_INTN);
+
+        *Result = (INTN)BytesCompleted;
+
+    } else {
+        *Result = Status;
+    }
+
+    return TRUE;
+}
+
+KSTATUS
+IopIoRingPostCompletion (
+    PIO_RING Ring,
+    PIO_RING_SUBMISSION Submission,
+    INTN Result
+    )
+
+/*++
+
+Routine Description:
+
+    This routine writes a completion into the user mode completion queue and
+    advances the kernel copy of the completion tail. The caller is
+    responsible for publishing the new tail.
+
+Arguments:
+
+    Ring - Supplies a pointer to the kernel mode copy of the ring.
+
+    Submission - Supplies a pointer to the request that completed.
+
+    Result - Supplies the result of the request.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    IO_RING_COMPLETION Completion;
+    ULONG Index;
+    KSTATUS Status;
+
+    ASSERT(Ring->CompletionTail - Ring->CompletionHead <
+           Ring->CompletionCount);
+
+    Completion.UserData = Submission->UserData;
+    Completion.Result = Result;
+    Index = Ring->CompletionTail & (Ring->CompletionCount - 1);
+    Status = MmCopyToUserMode(&(Ring->Completions[Index]),
+                              &Completion,
+                              sizeof(IO_RING_COMPLETION));
+
+    if (!KSUCCESS(Status)) {
+        return Status;
+    }
+
+    Ring->CompletionTail += 1;
+    return STATUS_SUCCESS;
+}
+
+KSTATUS
+IopIoRingPublish (
+    PIO_RING UserRing,
+    PIO_RING Ring
+    )
+
+/*++
+
+Routine Description:
+
+    This routine writes the kernel owned indices of an I/O ring back out to
+    user mode, and picks up any completions user mode has reaped in the
+    meantime.
+
+Arguments:
+
+    UserRing - Supplies the user mode pointer to the ring.
+
+    Ring - Supplies a pointer to the kernel mode copy of the ring.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_ACCESS_VIOLATION if the ring could not be accessed.
+
+--*/
+
+{
+
+    if ((MmUserWrite32(&(UserRing->SubmissionHead),
+                       Ring->SubmissionHead) == FALSE) ||
+        (MmUserWrite32(&(UserRing->CompletionTail),
+                       Ring->CompletionTail) == FALSE) ||
+        (MmUserWrite32(&(UserRing->PendingCount),
+                       Ring->PendingCount) == FALSE) ||
+        (MmUserRead32(&(UserRing->CompletionHead),
+                      &(Ring->CompletionHead)) == FALSE)) {
+
+        return STATUS_ACCESS_VIOLATION;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+KSTATUS
+IopIoRingWait (
+    PKPROCESS Process,
+    PIO_RING Ring,
+    ULONG TimeoutInMilliseconds
+    )
+
+/*++
+
+Routine Description:
+
+    This routine waits until at least one of the pending requests in an I/O
+    ring might be able to make progress.
+
+Arguments:
+
+    Process - Supplies a pointer to the current process.
+
+    Ring - Supplies a pointer to the kernel mode copy of the ring.
+
+    TimeoutInMilliseconds - Supplies the number of milliseconds to wait.
+
+Return Value:
+
+    STATUS_SUCCESS if an object was signaled, or if a pending request can be
+    retried right away (for example because its handle was closed).
+
+    STATUS_TIMEOUT if nothing became ready in time.
+
+    STATUS_INTERRUPTED if a signal arrived.
+
+    Other error codes on failure.
+
+--*/
+
+{
+
+    UINTN AllocationSize;
+    PIO_HANDLE *Handles;
+    ULONG Index;
+    PIO_OBJECT_STATE IoState;
+    ULONG ObjectCount;
+    KSTATUS Status;
+    IO_RING_SUBMISSION Submission;
+    PVOID *WaitObjects;
+
+    ASSERT(Ring->PendingCount != 0);
+
+    AllocationSize = Ring->PendingCount *
+                     (sizeof(PIO_HANDLE) +
+                      (IO_RING_WAIT_OBJECTS_PER_REQUEST * sizeof(PVOID)));
+
+    Handles = MmAllocatePagedPool(AllocationSize, IO_ALLOCATION_TAG);
+    if (Handles == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    RtlZeroMemory(Handles, AllocationSize);
+    WaitObjects = (PVOID *)(Handles + Ring->PendingCount);
+    ObjectCount = 0;
+    for (Index = 0; Index < Ring->PendingCount; Index += 1) {
+        Status = MmCopyFromUserMode(&Submission,
+                                    &(Ring->Pending[Index]),
+                                    sizeof(IO_RING_SUBMISSION));
+
+        if (!KSUCCESS(Status)) {
+            goto IoRingWaitEnd;
+        }
+
+        //
+        // A pending request whose handle has gone away will complete with an
+        // error on the next retry, so there is no point in waiting.
+        //
+
+        Handles[Index] = ObGetHandleValue(Process->HandleTable,
+                                          Submission.Handle,
+                                          NULL);
+
+        if (Handles[Index] == NULL) {
+            Status = STATUS_SUCCESS;
+            goto IoRingWaitEnd;
+        }
+
+        IoState = Handles[Index]->FileObject->IoState;
+        if (IoState == NULL) {
+            Status = STATUS_SUCCESS;
+            goto IoRingWaitEnd;
+        }
+
+        WaitObjects[ObjectCount] = IoState->ErrorEvent;
+        ObjectCount += 1;
+        if (Submission.Operation == IoRingOperationWrite) {
+            WaitObjects[ObjectCount] = IoState->WriteEvent;
+
+        } else {
+            WaitObjects[ObjectCount] = IoState->ReadEvent;
+        }
+
+        ObjectCount += 1;
+    }
+
+    Status = ObWaitOnObjects(WaitObjects,
+                             ObjectCount,
+                             WAIT_FLAG_INTERRUPTIBLE,
+                             TimeoutInMilliseconds,
+                             NULL,
+                             NULL);
+
+IoRingWaitEnd:
+    for (Index = 0; Index < Ring->PendingCount; Index += 1) {
+        if (Handles[Index] != NULL) {
+            IoIoHandleReleaseReference(Handles[Index]);
+        }
+    }
+
+    MmFreePagedPool(Handles);
+    return Status;
+}
+
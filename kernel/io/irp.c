@@ -36,6 +36,13 @@ Module Name:
 // ---------------------------------------------------------------- Definitions
 //
 
+//
+// Define the largest IRP stack, in entries, that comes from the IRP stack
+// object cache. Deeper stacks are allocated from pool.
+//
+
+#define IRP_CACHED_STACK_SIZE 8
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -130,6 +137,11 @@ IopAdvanceIrpStackLocation (
     PIRP_INTERNAL Irp
     );
 
+VOID
+IopFreeIrpStack (
+    PIRP_INTERNAL Irp
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -140,6 +152,12 @@ IopAdvanceIrpStackLocation (
 
 POBJECT_HEADER IoIrpDirectory = NULL;
 
+//
+// Store a pointer to the object cache that most IRP stacks come from.
+//
+
+POBJECT_CACHE IoIrpStackCache = NULL;
+
 //
 // ------------------------------------------------------------------ Functions
 //
@@ -261,6 +279,7 @@ Return Value:
     ASSERT(DriverStackEntry->Driver == Driver);
 
     if (DriverStackEntry->Driver == Driver) {
+        SpTrace(SpTraceEventIrpComplete, Irp, StatusCode);
         InternalIrp->Flags |= IRP_COMPLETE;
         Irp->Direction = IrpUp;
         Irp->Status = StatusCode;
@@ -508,9 +527,19 @@ Return Value:
     //
 
     AllocationSize = sizeof(IRP_STACK_ENTRY) * Irp->StackSize;
-    Irp->Stack = MmAllocateNonPagedPool(AllocationSize, IRP_ALLOCATION_TAG);
+    if ((Irp->StackSize <= IRP_CACHED_STACK_SIZE) &&
+        (IoIrpStackCache != NULL)) {
+
+        Irp->Stack = MmAllocateObject(IoIrpStackCache);
+
+    } else {
+        Irp->Stack = MmAllocateNonPagedPool(AllocationSize,
+                                            IRP_ALLOCATION_TAG);
+    }
+
     if (Irp->Stack == NULL) {
         Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto CreateIrpEnd;
     }
 
     RtlZeroMemory(Irp->Stack, AllocationSize);
@@ -600,7 +629,7 @@ Return Value:
                     }
                 }
 
-                MmFreeNonPagedPool(Irp->Stack);
+                IopFreeIrpStack(Irp);
             }
 
             ASSERT(Irp->Public.Header.ReferenceCount == 1);
@@ -691,7 +720,7 @@ Return Value:
         }
     }
 
-    MmFreeNonPagedPool(InternalIrp->Stack);
+    IopFreeIrpStack(InternalIrp);
     ObReleaseReference(Irp);
     return;
 }
@@ -824,6 +853,10 @@ Return Value:
     // pumping it through the stack until it is done.
     //
 
+    SpTrace(SpTraceEventIrpDispatch,
+            Irp,
+            (Irp->MajorCode << 8) | Irp->MinorCode);
+
     Status = STATUS_SUCCESS;
     InternalIrp->Flags |= IRP_ACTIVE;
     while (TRUE) {
@@ -1525,6 +1558,46 @@ Return Value:
     return Status;
 }
 
+KSTATUS
+IopInitializeIrpStackCache (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates the object cache that IRP stacks are allocated from.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    IoIrpStackCache = MmCreateObjectCache(
+                            sizeof(IRP_STACK_ENTRY) * IRP_CACHED_STACK_SIZE,
+                            0,
+                            OBJECT_CACHE_FLAG_NON_PAGED,
+                            IRP_ALLOCATION_TAG,
+                            NULL,
+                            NULL,
+                            NULL,
+                            NULL);
+
+    if (IoIrpStackCache == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    return STATUS_SUCCESS;
+}
+
 KSTATUS
 IopSendSystemControlIrp (
     PDEVICE Device,
@@ -1942,3 +2015,39 @@ Return Value:
     return FALSE;
 }
 
+VOID
+IopFreeIrpStack (
+    PIRP_INTERNAL Irp
+    )
+
+/*++
+
+Routine Description:
+
+    This routine frees an IRP's stack back to wherever it came from.
+
+Arguments:
+
+    Irp - Supplies a pointer to the IRP whose stack should be freed.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if ((Irp->StackSize <= IRP_CACHED_STACK_SIZE) &&
+        (IoIrpStackCache != NULL)) {
+
+        MmFreeObject(IoIrpStackCache, Irp->Stack);
+
+    } else {
+        MmFreeNonPagedPool(Irp->Stack);
+    }
+
+    Irp->Stack = NULL;
+    return;
+}
+
@@ -157,12 +157,6 @@ Module Name:
 
 #define PAGE_CACHE_FLUSH_MAX_CLEAN_STREAK 4
 
-//
-// Define the block expansion count for the page cache entry block allocator.
-//
-
-#define PAGE_CACHE_BLOCK_ALLOCATOR_EXPANSION_COUNT 0x40
-
 //
 // Define the maximum number of pages that can be used as the minimum number of
 // free pages necessary to require page cache flushes to give up in favor of
@@ -552,10 +546,10 @@ INT64_SYNC IoPageCacheLastCleanTime;
 ULONG IoPageCacheDebugFlags = 0x0;
 
 //
-// Store the global page cache entry block allocator.
+// Store the global page cache entry object cache.
 //
 
-PBLOCK_ALLOCATOR IoPageCacheBlockAllocator;
+POBJECT_CACHE IoPageCacheEntryCache;
 
 //
 // Store a pointer to the page cache thread itself.
@@ -1049,7 +1043,6 @@ Return Value:
 
 {
 
-    PBLOCK_ALLOCATOR BlockAllocator;
     ULONGLONG CurrentTime;
     ULONG PageShift;
     UINTN PhysicalPages;
@@ -1060,7 +1053,7 @@ Return Value:
     INITIALIZE_LIST_HEAD(&IoPageCacheCleanList);
     INITIALIZE_LIST_HEAD(&IoPageCacheCleanUnmappedList);
     INITIALIZE_LIST_HEAD(&IoPageCacheRemovalList);
-    IoPageCacheListLock = KeCreateQueuedLock();
+    IoPageCacheListLock = KeCreateNamedQueuedLock("IoPageCacheListLock");
     if (IoPageCacheListLock == NULL) {
         Status = STATUS_INSUFFICIENT_RESOURCES;
         goto InitializePageCacheEnd;
@@ -1077,23 +1070,24 @@ Return Value:
     }
 
     //
-    // Create the block allocator for the page cache entry structures.
+    // Create the object cache for the page cache entry structures, which are
+    // created and destroyed constantly.
     //
 
-    BlockAllocator = MmCreateBlockAllocator(
-                                    sizeof(PAGE_CACHE_ENTRY),
-                                    0,
-                                    PAGE_CACHE_BLOCK_ALLOCATOR_EXPANSION_COUNT,
-                                    BLOCK_ALLOCATOR_FLAG_TRIM,
-                                    PAGE_CACHE_ALLOCATION_TAG);
+    IoPageCacheEntryCache = MmCreateObjectCache(sizeof(PAGE_CACHE_ENTRY),
+                                                0,
+                                                0,
+                                                PAGE_CACHE_ALLOCATION_TAG,
+                                                NULL,
+                                                NULL,
+                                                NULL,
+                                                NULL);
 
-    if (BlockAllocator == NULL) {
+    if (IoPageCacheEntryCache == NULL) {
         Status = STATUS_INSUFFICIENT_RESOURCES;
         goto InitializePageCacheEnd;
     }
 
-    IoPageCacheBlockAllocator = BlockAllocator;
-
     //
     // Determine an appropriate limit on the size of the page cache based on
     // the total number of physical pages.
@@ -1219,9 +1213,9 @@ Return Value:
             IoPageCacheWorkTimer = NULL;
         }
 
-        if (IoPageCacheBlockAllocator != NULL) {
-            MmDestroyBlockAllocator(IoPageCacheBlockAllocator);
-            IoPageCacheBlockAllocator = NULL;
+        if (IoPageCacheEntryCache != NULL) {
+            MmDestroyObjectCache(IoPageCacheEntryCache);
+            IoPageCacheEntryCache = NULL;
         }
     }
 
@@ -1262,7 +1256,11 @@ Return Value:
 
     FoundEntry = IopLookupPageCacheEntryHelper(FileObject, Offset);
     if (FoundEntry != NULL) {
+        SpTrace(SpTraceEventPageCacheHit, FileObject, Offset);
         IopUpdatePageCacheEntryList(FoundEntry, FALSE);
+
+    } else {
+        SpTrace(SpTraceEventPageCacheMiss, FileObject, Offset);
     }
 
     if ((IoPageCacheDebugFlags & PAGE_CACHE_DEBUG_LOOKUP) != 0) {
@@ -3452,7 +3450,7 @@ Return Value:
     // Allocate and initialize a new page cache entry.
     //
 
-    NewEntry = MmAllocateBlock(IoPageCacheBlockAllocator, NULL);
+    NewEntry = MmAllocateObject(IoPageCacheEntryCache);
     if (NewEntry == NULL) {
         goto CreatePageCacheEntryEnd;
     }
@@ -3638,7 +3636,7 @@ Return Value:
     // With the final reference gone, free the page cache entry.
     //
 
-    MmFreeBlock(IoPageCacheBlockAllocator, Entry);
+    MmFreeObject(IoPageCacheEntryCache, Entry);
     return;
 }
 
@@ -3898,6 +3896,17 @@ Return Value:
 
         ASSERT(KSUCCESS(Status));
 
+        //
+        // When physical memory gets critically low, have the object caches
+        // give back their spare slabs as well.
+        //
+
+        if ((SignalingObject == PhysicalMemoryWarningEvent) &&
+            (MmGetPhysicalMemoryWarningLevel() == MemoryWarningLevel1)) {
+
+            MmReclaimObjectCaches();
+        }
+
         //
         // The page cache cleaning is about to start. Mark down the current
         // time as the last time the cleaning ran. The leaves a record that an
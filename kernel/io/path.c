@@ -58,10 +58,77 @@ Module Name:
 
 #define PATH_UNREACHABLE_PATH_PREFIX "(unreachable)/"
 
+//
+// Define the number of buckets in the path entry hash table. This must be a
+// power of two.
+//
+
+#define PATH_ENTRY_HASH_TABLE_SIZE 1024
+
+//
+// This macro returns the hash table bucket for a child of the given parent
+// path entry with the given name hash.
+//
+
+#define PATH_ENTRY_HASH_BUCKET(_Parent, _Hash)                     \
+    (&(IoPathEntryHashTable[((_Hash) ^ ((UINTN)(_Parent) >> 4)) &   \
+                            (PATH_ENTRY_HASH_TABLE_SIZE - 1)]))
+
+//
+// Define the size each processor's lockless path walk counters are padded
+// out to, so that walks on different processors do not share a cache line.
+//
+
+#define PATH_WALK_COUNTER_SIZE 64
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
 
+/*++
+
+Structure Description:
+
+    This structure defines a bucket in the path entry hash table.
+
+Members:
+
+    Sequence - Stores the sequence number of the bucket. It is odd while the
+        bucket is being modified, and changes on every modification, allowing
+        lockless readers to detect that they raced with a writer.
+
+    ListHead - Stores the head of the list of path entries in this bucket.
+
+--*/
+
+typedef struct _PATH_ENTRY_HASH_BUCKET {
+    volatile ULONG Sequence;
+    LIST_ENTRY ListHead;
+} PATH_ENTRY_HASH_BUCKET, *PPATH_ENTRY_HASH_BUCKET;
+
+/*++
+
+Structure Description:
+
+    This structure defines one processor's counts of lockless path walks in
+    progress.
+
+Members:
+
+    Count - Stores the number of walks in progress that started on this
+        processor, indexed by the parity of the walk epoch when they started.
+        Walks can migrate, so these are updated atomically and only their sum
+        across all processors is meaningful.
+
+    Padding - Stores padding out to a cache line.
+
+--*/
+
+typedef struct _PATH_WALK_COUNTER {
+    volatile ULONG Count[2];
+    UCHAR Padding[PATH_WALK_COUNTER_SIZE - (2 * sizeof(ULONG))];
+} PATH_WALK_COUNTER, *PPATH_WALK_COUNTER;
+
 //
 // ----------------------------------------------- Internal Function Prototypes
 //
@@ -134,6 +201,48 @@ IopGetPathEntryCacheTargetSize (
     VOID
     );
 
+VOID
+IopPathWalkLockless (
+    BOOL FromKernelMode,
+    PPATH_POINT Entry,
+    PCSTR *Path,
+    PULONG PathSize,
+    PCREATE_PARAMETERS Create
+    );
+
+PPATH_ENTRY
+IopPathEntryHashLookup (
+    PPATH_ENTRY Parent,
+    PCSTR Name,
+    ULONG NameSize,
+    ULONG Hash
+    );
+
+VOID
+IopPathEntryHashRemove (
+    PPATH_ENTRY Entry
+    );
+
+VOID
+IopFreePathEntry (
+    PPATH_ENTRY Entry
+    );
+
+VOID
+IopFreeDeferredPathEntries (
+    VOID
+    );
+
+VOID
+IopCollectDeferredPathEntries (
+    PLIST_ENTRY FreeList
+    );
+
+BOOL
+IopArePathWalksDrained (
+    ULONG Parity
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -159,6 +268,30 @@ LIST_ENTRY IoPathEntryList;
 UINTN IoPathEntryListSize;
 UINTN IoPathEntryListMaxSize;
 
+//
+// Store the hash table of linked path entries, keyed by parent and name. The
+// lock serializes writers; readers rely on the bucket sequence numbers.
+//
+
+PPATH_ENTRY_HASH_BUCKET IoPathEntryHashTable;
+PQUEUED_LOCK IoPathEntryHashLock;
+
+//
+// Store the per-processor counts of lockless path walks in progress, and the
+// walk epoch. Destroyed path entries that a walk may still be looking at go
+// on the pending list. Advancing the epoch moves them to the retired list,
+// which is freed once every processor's count for the previous epoch has
+// drained to zero. The epoch and lists are protected by the hash table lock.
+//
+
+PPATH_WALK_COUNTER IoPathWalkCounters;
+ULONG IoPathWalkCounterCount;
+volatile ULONG IoPathWalkEpoch;
+LIST_ENTRY IoPathEntryPendingList;
+LIST_ENTRY IoPathEntryRetiredList;
+UINTN IoPathEntryRetiredCount;
+volatile UINTN IoPathEntryDeferredCount;
+
 //
 // ------------------------------------------------------------------ Functions
 //
@@ -443,6 +576,8 @@ Return Value:
 
 {
 
+    UINTN AllocationSize;
+    ULONG BucketIndex;
     BOOL Created;
     PFILE_OBJECT FileObject;
     ULONGLONG MaxMemory;
@@ -464,6 +599,44 @@ Return Value:
 
     INITIALIZE_LIST_HEAD(&IoPathEntryList);
     IoPathEntryListSize = 0;
+    IoPathEntryHashLock = KeCreateQueuedLock();
+    if (IoPathEntryHashLock == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto InitializePathSupportEnd;
+    }
+
+    AllocationSize = sizeof(PATH_ENTRY_HASH_BUCKET) *
+                     PATH_ENTRY_HASH_TABLE_SIZE;
+
+    IoPathEntryHashTable = MmAllocateNonPagedPool(AllocationSize,
+                                                  PATH_ALLOCATION_TAG);
+
+    if (IoPathEntryHashTable == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto InitializePathSupportEnd;
+    }
+
+    for (BucketIndex = 0;
+         BucketIndex < PATH_ENTRY_HASH_TABLE_SIZE;
+         BucketIndex += 1) {
+
+        IoPathEntryHashTable[BucketIndex].Sequence = 0;
+        INITIALIZE_LIST_HEAD(&(IoPathEntryHashTable[BucketIndex].ListHead));
+    }
+
+    IoPathWalkCounterCount = KeGetActiveProcessorCount();
+    AllocationSize = sizeof(PATH_WALK_COUNTER) * IoPathWalkCounterCount;
+    IoPathWalkCounters = MmAllocateNonPagedPool(AllocationSize,
+                                                PATH_ALLOCATION_TAG);
+
+    if (IoPathWalkCounters == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto InitializePathSupportEnd;
+    }
+
+    RtlZeroMemory(IoPathWalkCounters, AllocationSize);
+    INITIALIZE_LIST_HEAD(&IoPathEntryPendingList);
+    INITIALIZE_LIST_HEAD(&IoPathEntryRetiredList);
     MaxMemory = MmGetTotalPhysicalPages() * MmPageSize();
     if (MaxMemory > (MAX_UINTN - (UINTN)KERNEL_VA_START + 1)) {
         MaxMemory = MAX_UINTN - (UINTN)KERNEL_VA_START + 1;
@@ -504,6 +677,16 @@ Return Value:
             IoPathEntryListLock = NULL;
         }
 
+        if (IoPathEntryHashLock != NULL) {
+            KeDestroyQueuedLock(IoPathEntryHashLock);
+            IoPathEntryHashLock = NULL;
+        }
+
+        if (IoPathEntryHashTable != NULL) {
+            MmFreeNonPagedPool(IoPathEntryHashTable);
+            IoPathEntryHashTable = NULL;
+        }
+
         if (RootObject != NULL) {
             ObReleaseReference(RootObject);
         }
@@ -1025,6 +1208,63 @@ Return Value:
     return FALSE;
 }
 
+VOID
+IopPathLink (
+    PPATH_ENTRY Parent,
+    PPATH_ENTRY Entry
+    )
+
+/*++
+
+Routine Description:
+
+    This routine links the given path entry into its parent's list of
+    children and into the path entry hash table. This assumes the caller holds
+    the parent path entry's file object lock exclusively.
+
+Arguments:
+
+    Parent - Supplies a pointer to the parent path entry.
+
+    Entry - Supplies a pointer to the path entry to link in.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PPATH_ENTRY_HASH_BUCKET Bucket;
+    PLIST_ENTRY First;
+
+    ASSERT((Entry->Parent == Parent) && (Entry->Name != NULL));
+    ASSERT(Entry->HashListEntry.Next == NULL);
+
+    INSERT_BEFORE(&(Entry->SiblingListEntry), &(Parent->ChildList));
+
+    //
+    // Fully initialize the entry before publishing it at the head of the
+    // bucket, as lockless readers may follow the head's pointer at any time.
+    //
+
+    Bucket = PATH_ENTRY_HASH_BUCKET(Parent, Entry->Hash);
+    KeAcquireQueuedLock(IoPathEntryHashLock);
+    Bucket->Sequence += 1;
+    RtlMemoryBarrier();
+    First = Bucket->ListHead.Next;
+    Entry->HashListEntry.Next = First;
+    Entry->HashListEntry.Previous = &(Bucket->ListHead);
+    RtlMemoryBarrier();
+    First->Previous = &(Entry->HashListEntry);
+    Bucket->ListHead.Next = &(Entry->HashListEntry);
+    RtlMemoryBarrier();
+    Bucket->Sequence += 1;
+    KeReleaseQueuedLock(IoPathEntryHashLock);
+    return;
+}
+
 VOID
 IopPathUnlink (
     PPATH_ENTRY Entry
@@ -1064,6 +1304,7 @@ Return Value:
         Entry->SiblingListEntry.Next = NULL;
     }
 
+    IopPathEntryHashRemove(Entry);
     return;
 }
 
@@ -2257,6 +2498,17 @@ Return Value:
     IO_PATH_POINT_ADD_REFERENCE(&Entry);
     KeReleaseQueuedLock(Process->Paths.Lock);
 
+    //
+    // Resolve as much of the path as possible out of the path entry cache
+    // without taking any locks. The loop below picks up wherever that stops.
+    //
+
+    IopPathWalkLockless(FromKernelMode,
+                        &Entry,
+                        &CurrentPath,
+                        &CurrentPathSize,
+                        Create);
+
     //
     // Loop walking path components.
     //
@@ -3145,14 +3397,19 @@ Return Value:
                (FileObject->Device == PathRoot) &&
                (Result->MountPoint == Directory->MountPoint));
 
-        Result->PathEntry->Negative = FALSE;
-        Result->PathEntry->DoNotCache = DoNotCache;
-
         ASSERT(FileObject != NULL);
         ASSERT(FileObject->ReferenceCount >= 2);
 
+        //
+        // Set the file object before clearing the negative flag, as lockless
+        // path walks may be looking at this entry.
+        //
+
+        Result->PathEntry->DoNotCache = DoNotCache;
         Result->PathEntry->FileObject = FileObject;
         IopFileObjectAddPathEntryReference(Result->PathEntry->FileObject);
+        RtlMemoryBarrier();
+        Result->PathEntry->Negative = FALSE;
 
     //
     // Create and insert a new path entry.
@@ -3183,9 +3440,7 @@ Return Value:
         ASSERT((FileObject == NULL) ||
                (FileObject->Properties.HardLinkCount != 0));
 
-        INSERT_BEFORE(&(PathEntry->SiblingListEntry),
-                      &(DirectoryEntry->ChildList));
-
+        IopPathLink(DirectoryEntry, PathEntry);
         Result->PathEntry = PathEntry;
         IoMountPointAddReference(Directory->MountPoint);
         Result->MountPoint = Directory->MountPoint;
@@ -3781,6 +4036,8 @@ Return Value:
             Entry->SiblingListEntry.Next = NULL;
         }
 
+        IopPathEntryHashRemove(Entry);
+
         ASSERT(ParentFileObject != NULL);
 
         KeReleaseSharedExclusiveLockExclusive(ParentFileObject->Lock);
@@ -3792,23 +4049,25 @@ Return Value:
     //
 
     ASSERT(Entry->MountCount == 0);
-
-    //
-    // Release the file object and then the path root object. If they exist.
-    //
-
     ASSERT((Entry->Negative != FALSE) || (Entry->FileObject != NULL));
 
     //
-    // Decrement the count of path entries that own the file object.
+    // If the entry was ever in the hash table, a lockless path walk may still
+    // be looking at it. Hold off on freeing it until every walk that might
+    // have seen it has finished.
     //
 
-    if (Entry->Negative == FALSE) {
-        IopFileObjectReleasePathEntryReference(Entry->FileObject);
-        IopFileObjectReleaseReference(Entry->FileObject);
+    if (Entry->HashListEntry.Next != NULL) {
+        KeAcquireQueuedLock(IoPathEntryHashLock);
+        INSERT_BEFORE(&(Entry->CacheListEntry), &IoPathEntryPendingList);
+        IoPathEntryDeferredCount += 1;
+        KeReleaseQueuedLock(IoPathEntryHashLock);
+        IopFreeDeferredPathEntries();
+
+    } else {
+        IopFreePathEntry(Entry);
     }
 
-    MmFreePagedPool(Entry);
     return Parent;
 }
 
@@ -3866,3 +4125,541 @@ Return Value:
     return 0;
 }
 
+VOID
+IopPathWalkLockless (
+    BOOL FromKernelMode,
+    PPATH_POINT Entry,
+    PCSTR *Path,
+    PULONG PathSize,
+    PCREATE_PARAMETERS Create
+    )
+
+/*++
+
+Routine Description:
+
+    This routine walks as much of the given path as it can using only the path
+    entry hash table, without acquiring any directory locks or references on
+    the intermediate path entries. It stops at anything it cannot handle
+    trivially: uncached or negative entries, symbolic links, mount points,
+    "..", a component about to be created, or a race with a writer. Only the
+    final path entry reached is referenced.
+
+Arguments:
+
+    FromKernelMode - Supplies a boolean indicating whether or not this request
+        is coming directly from kernel mode.
+
+    Entry - Supplies a pointer to the referenced path point to start from. On
+        return, this will contain the referenced path point that was reached,
+        and the reference on the original path entry will have been released.
+
+    Path - Supplies a pointer that on input contains the remaining path to
+        walk. This will be advanced past the components that were resolved.
+
+    PathSize - Supplies a pointer that on input contains the size of the
+        remaining path, not including the null terminator. This will be
+        updated along with the path.
+
+    Create - Supplies an optional pointer to the creation parameters. If
+        supplied, the final component is left to the locked walk.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG ComponentSize;
+    PPATH_ENTRY Current;
+    PCSTR CurrentPath;
+    ULONG CurrentPathSize;
+    volatile ULONG *EpochCount;
+    PFILE_OBJECT FileObject;
+    PPATH_ENTRY Found;
+    ULONG Hash;
+    PCSTR NextSeparator;
+    ULONG Parity;
+    PSHARED_EXCLUSIVE_LOCK ParentLock;
+    PATH_POINT PathPoint;
+    BOOL Referenced;
+    ULONG RemainingSize;
+    KSTATUS Status;
+
+    Current = Entry->PathEntry;
+    CurrentPath = *Path;
+    CurrentPathSize = *PathSize;
+    PathPoint.MountPoint = Entry->MountPoint;
+
+    //
+    // Count this walk against the current epoch on this processor's counter.
+    // If the epoch advanced before the count landed, reclaim may not have
+    // seen it, so count against the new epoch instead.
+    //
+
+    EpochCount = IoPathWalkCounters[KeGetCurrentProcessorNumber() %
+                                    IoPathWalkCounterCount].Count;
+
+    while (TRUE) {
+        Parity = IoPathWalkEpoch & 0x1;
+        RtlAtomicAdd32(&(EpochCount[Parity]), 1);
+        if ((IoPathWalkEpoch & 0x1) == Parity) {
+            break;
+        }
+
+        RtlAtomicAdd32(&(EpochCount[Parity]), (ULONG)-1);
+    }
+
+    while (CurrentPathSize != 0) {
+        while ((CurrentPathSize != 0) && (*CurrentPath == PATH_SEPARATOR)) {
+            CurrentPath += 1;
+            CurrentPathSize -= 1;
+        }
+
+        if ((*CurrentPath == '\0') || (CurrentPathSize == 0)) {
+            break;
+        }
+
+        RemainingSize = CurrentPathSize;
+        NextSeparator = CurrentPath;
+        while ((*NextSeparator != PATH_SEPARATOR) && (*NextSeparator != '\0') &&
+               (RemainingSize != 0)) {
+
+            RemainingSize -= 1;
+            NextSeparator += 1;
+        }
+
+        if ((*NextSeparator == '\0') || (RemainingSize == 0)) {
+            NextSeparator = NULL;
+            if (Create != NULL) {
+                break;
+            }
+        }
+
+        ComponentSize = CurrentPathSize - RemainingSize;
+
+        //
+        // The current entry must be a directory the caller can search.
+        //
+
+        FileObject = Current->FileObject;
+        if ((FileObject->Properties.Type != IoObjectRegularDirectory) &&
+            (FileObject->Properties.Type != IoObjectObjectDirectory)) {
+
+            break;
+        }
+
+        if (FromKernelMode == FALSE) {
+            PathPoint.PathEntry = Current;
+            Status = IopCheckPermissions(FromKernelMode,
+                                         &PathPoint,
+                                         IO_ACCESS_EXECUTE);
+
+            if (!KSUCCESS(Status)) {
+                break;
+            }
+        }
+
+        if (IopArePathsEqual(".", CurrentPath, ComponentSize + 1) != FALSE) {
+            Found = Current;
+
+        } else {
+            if (IopArePathsEqual("..", CurrentPath, ComponentSize + 1) !=
+                FALSE) {
+
+                break;
+            }
+
+            Hash = IopHashPathString(CurrentPath, ComponentSize + 1);
+            Found = IopPathEntryHashLookup(Current,
+                                           CurrentPath,
+                                           ComponentSize + 1,
+                                           Hash);
+
+            if ((Found == NULL) || (Found->MountCount != 0)) {
+                break;
+            }
+
+            FileObject = Found->FileObject;
+            if (FileObject->Properties.Type == IoObjectSymbolicLink) {
+                break;
+            }
+
+            //
+            // Anything followed by a separator needs to be a directory. Let
+            // the locked walk fail that.
+            //
+
+            if ((NextSeparator != NULL) &&
+                (FileObject->Properties.Type != IoObjectRegularDirectory) &&
+                (FileObject->Properties.Type != IoObjectObjectDirectory)) {
+
+                break;
+            }
+        }
+
+        Current = Found;
+        CurrentPath += ComponentSize;
+        CurrentPathSize -= ComponentSize;
+        if (NextSeparator == NULL) {
+            break;
+        }
+    }
+
+    //
+    // Take a reference on the entry that was reached. The parent's lock
+    // prevents the entry from being unlinked or destroyed in the meantime. If
+    // it was already unlinked, start the walk over with locks.
+    //
+
+    Referenced = TRUE;
+    if (Current != Entry->PathEntry) {
+        ParentLock = Current->Parent->FileObject->Lock;
+        KeAcquireSharedExclusiveLockShared(ParentLock);
+        if (Current->HashListEntry.Previous != NULL) {
+            IoPathEntryAddReference(Current);
+
+        } else {
+            Referenced = FALSE;
+        }
+
+        KeReleaseSharedExclusiveLockShared(ParentLock);
+    }
+
+    RtlAtomicAdd32(&(EpochCount[Parity]), (ULONG)-1);
+    if (IoPathEntryDeferredCount != 0) {
+        IopFreeDeferredPathEntries();
+    }
+
+    if (Referenced == FALSE) {
+        return;
+    }
+
+    if (Current != Entry->PathEntry) {
+        IoMountPointAddReference(Entry->MountPoint);
+        IO_PATH_POINT_RELEASE_REFERENCE(Entry);
+        Entry->PathEntry = Current;
+    }
+
+    *Path = CurrentPath;
+    *PathSize = CurrentPathSize;
+    return;
+}
+
+PPATH_ENTRY
+IopPathEntryHashLookup (
+    PPATH_ENTRY Parent,
+    PCSTR Name,
+    ULONG NameSize,
+    ULONG Hash
+    )
+
+/*++
+
+Routine Description:
+
+    This routine searches the path entry hash table for a positive child of
+    the given parent without acquiring any locks. The caller must be counted
+    in the lockless walk counts so that the entries seen stay allocated.
+
+Arguments:
+
+    Parent - Supplies a pointer to the parent path entry.
+
+    Name - Supplies a pointer to the name to find, which may not be null
+        terminated.
+
+    NameSize - Supplies the size of the name including the assumed null
+        terminator.
+
+    Hash - Supplies the hash of the name.
+
+Return Value:
+
+    Returns a pointer to the matching path entry, without a reference.
+
+    NULL if no positive entry was found or the search raced with a change to
+    the bucket.
+
+--*/
+
+{
+
+    PPATH_ENTRY_HASH_BUCKET Bucket;
+    PLIST_ENTRY CurrentEntry;
+    PPATH_ENTRY Entry;
+    PPATH_ENTRY Found;
+    ULONG Sequence;
+
+    Bucket = PATH_ENTRY_HASH_BUCKET(Parent, Hash);
+    Sequence = Bucket->Sequence;
+    if ((Sequence & 0x1) != 0) {
+        return NULL;
+    }
+
+    RtlMemoryBarrier();
+    Found = NULL;
+    CurrentEntry = Bucket->ListHead.Next;
+    while ((CurrentEntry != &(Bucket->ListHead)) && (CurrentEntry != NULL)) {
+        Entry = LIST_VALUE(CurrentEntry, PATH_ENTRY, HashListEntry);
+        CurrentEntry = CurrentEntry->Next;
+        if ((Entry->Parent != Parent) || (Entry->Hash != Hash)) {
+            continue;
+        }
+
+        if (IopArePathsEqual(Entry->Name, Name, NameSize) == FALSE) {
+            continue;
+        }
+
+        //
+        // The file object is set before the negative flag is cleared.
+        //
+
+        if (Entry->Negative == FALSE) {
+            RtlMemoryBarrier();
+            if (Entry->FileObject != NULL) {
+                Found = Entry;
+            }
+        }
+
+        break;
+    }
+
+    RtlMemoryBarrier();
+    if (Bucket->Sequence != Sequence) {
+        return NULL;
+    }
+
+    return Found;
+}
+
+VOID
+IopPathEntryHashRemove (
+    PPATH_ENTRY Entry
+    )
+
+/*++
+
+Routine Description:
+
+    This routine removes the given path entry from the path entry hash table
+    if it is in it. The removed entry's next pointer is left pointing back at
+    the bucket so that lockless readers standing on it find their way out.
+
+Arguments:
+
+    Entry - Supplies a pointer to the path entry to remove.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PPATH_ENTRY_HASH_BUCKET Bucket;
+
+    if (Entry->HashListEntry.Previous == NULL) {
+        return;
+    }
+
+    Bucket = PATH_ENTRY_HASH_BUCKET(Entry->Parent, Entry->Hash);
+    KeAcquireQueuedLock(IoPathEntryHashLock);
+    Bucket->Sequence += 1;
+    RtlMemoryBarrier();
+    LIST_REMOVE(&(Entry->HashListEntry));
+    Entry->HashListEntry.Next = &(Bucket->ListHead);
+    Entry->HashListEntry.Previous = NULL;
+    RtlMemoryBarrier();
+    Bucket->Sequence += 1;
+    KeReleaseQueuedLock(IoPathEntryHashLock);
+    return;
+}
+
+VOID
+IopFreePathEntry (
+    PPATH_ENTRY Entry
+    )
+
+/*++
+
+Routine Description:
+
+    This routine releases the file object owned by a destroyed path entry and
+    frees the path entry's memory.
+
+Arguments:
+
+    Entry - Supplies a pointer to the destroyed path entry.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    //
+    // Decrement the count of path entries that own the file object.
+    //
+
+    if (Entry->Negative == FALSE) {
+        IopFileObjectReleasePathEntryReference(Entry->FileObject);
+        IopFileObjectReleaseReference(Entry->FileObject);
+    }
+
+    MmFreePagedPool(Entry);
+    return;
+}
+
+VOID
+IopFreeDeferredPathEntries (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine frees the destroyed path entries that no lockless path walk
+    can still be looking at. If the hash table lock is busy, this routine
+    does nothing and leaves the work to a later caller.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PPATH_ENTRY Entry;
+    LIST_ENTRY FreeList;
+
+    INITIALIZE_LIST_HEAD(&FreeList);
+    if (KeTryToAcquireQueuedLock(IoPathEntryHashLock) == FALSE) {
+        return;
+    }
+
+    IopCollectDeferredPathEntries(&FreeList);
+    KeReleaseQueuedLock(IoPathEntryHashLock);
+    while (LIST_EMPTY(&FreeList) == FALSE) {
+        Entry = LIST_VALUE(FreeList.Next, PATH_ENTRY, CacheListEntry);
+        LIST_REMOVE(&(Entry->CacheListEntry));
+        Entry->CacheListEntry.Next = NULL;
+        IopFreePathEntry(Entry);
+    }
+
+    return;
+}
+
+VOID
+IopCollectDeferredPathEntries (
+    PLIST_ENTRY FreeList
+    )
+
+/*++
+
+Routine Description:
+
+    This routine advances the lockless path walk epoch as far as it can,
+    moving retired path entries whose grace period has passed onto the given
+    list. The caller must hold the hash table lock.
+
+Arguments:
+
+    FreeList - Supplies a pointer to the head of a list where path entries
+        that are safe to free will be put.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Pass;
+
+    //
+    // The retired entries were all removed from the hash table before the
+    // epoch last advanced. Walks that started after that cannot find them,
+    // so they can be freed once the walks counted against the previous epoch
+    // have all finished. After retiring the pending entries and advancing the
+    // epoch, check once more, as there are often no walks in flight at all.
+    //
+
+    for (Pass = 0; Pass < 2; Pass += 1) {
+        if (LIST_EMPTY(&IoPathEntryRetiredList) == FALSE) {
+            RtlMemoryBarrier();
+            if (IopArePathWalksDrained((IoPathWalkEpoch & 0x1) ^ 0x1) ==
+                FALSE) {
+
+                break;
+            }
+
+            APPEND_LIST(&IoPathEntryRetiredList, FreeList);
+            INITIALIZE_LIST_HEAD(&IoPathEntryRetiredList);
+            IoPathEntryDeferredCount -= IoPathEntryRetiredCount;
+            IoPathEntryRetiredCount = 0;
+        }
+
+        if (LIST_EMPTY(&IoPathEntryPendingList) != FALSE) {
+            break;
+        }
+
+        MOVE_LIST(&IoPathEntryPendingList, &IoPathEntryRetiredList);
+        INITIALIZE_LIST_HEAD(&IoPathEntryPendingList);
+        IoPathEntryRetiredCount = IoPathEntryDeferredCount;
+        RtlMemoryBarrier();
+        IoPathWalkEpoch += 1;
+    }
+
+    return;
+}
+
+BOOL
+IopArePathWalksDrained (
+    ULONG Parity
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines whether all lockless path walks counted against
+    epochs of the given parity have finished.
+
+Arguments:
+
+    Parity - Supplies the parity of the epoch to check.
+
+Return Value:
+
+    TRUE if no walks counted against the given epoch parity are in progress.
+
+    FALSE if at least one is.
+
+--*/
+
+{
+
+    ULONG Index;
+
+    for (Index = 0; Index < IoPathWalkCounterCount; Index += 1) {
+        if (IoPathWalkCounters[Index].Count[Parity] != 0) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
@@ -57,6 +57,27 @@ IopConvertInterruptedSocketStatus (
     BOOL Output
     );
 
+KSTATUS
+IopAcceptUserSocket (
+    PKPROCESS Process,
+    PIO_HANDLE IoHandle,
+    ULONG OpenFlags,
+    PHANDLE NewSocket,
+    PNETWORK_ADDRESS Address,
+    PSTR RemotePath,
+    PUINTN RemotePathSize,
+    ULONG TimeoutInMilliseconds
+    );
+
+KSTATUS
+IopPerformUserSocketVectoredIo (
+    PKPROCESS Process,
+    PIO_HANDLE IoHandle,
+    PSOCKET_IO_PARAMETERS IoParameters,
+    PIO_VECTOR VectorArray,
+    UINTN VectorCount
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -459,7 +480,8 @@ IoSocketAccept (
     PIO_HANDLE *NewConnectionSocket,
     PNETWORK_ADDRESS RemoteAddress,
     PCSTR *RemotePath,
-    PUINTN RemotePathSize
+    PUINTN RemotePathSize,
+    ULONG TimeoutInMilliseconds
     )
 
 /*++
@@ -488,6 +510,10 @@ Routine Description:
     RemotePathSize - Supplies a pointer where the size of the remote path in
         bytes will be returned on success.
 
+    TimeoutInMilliseconds - Supplies the number of milliseconds to wait for
+        a connection to come in. Use WAIT_TIME_INDEFINITE to wait forever.
+        A non-blocking socket never waits, regardless of this value.
+
 Return Value:
 
     Status code.
@@ -511,7 +537,8 @@ Return Value:
                                      NewConnectionSocket,
                                      RemoteAddress,
                                      RemotePath,
-                                     RemotePathSize);
+                                     RemotePathSize,
+                                     TimeoutInMilliseconds);
 
     } else {
         if (IoNetInterfaceInitialized == FALSE) {
@@ -520,7 +547,8 @@ Return Value:
         } else {
             Status = IoNetInterface.Accept(Socket,
                                            NewConnectionSocket,
-                                           RemoteAddress);
+                                           RemoteAddress,
+                                           TimeoutInMilliseconds);
         }
     }
 
@@ -1379,17 +1407,11 @@ Return Value:
 
 {
 
-    UINTN CopySize;
-    ULONG HandleFlags;
     PIO_HANDLE IoHandle;
-    PIO_HANDLE NewHandle;
     PSYSTEM_CALL_SOCKET_ACCEPT Parameters;
     PKPROCESS Process;
-    PCSTR RemotePath;
-    UINTN RemotePathSize;
     KSTATUS Status;
 
-    NewHandle = NULL;
     Parameters = (PSYSTEM_CALL_SOCKET_ACCEPT)SystemCallParameter;
     Parameters->NewSocket = INVALID_HANDLE;
     Process = PsGetCurrentProcess();
@@ -1399,91 +1421,149 @@ Return Value:
         goto SysSocketAcceptEnd;
     }
 
+    Status = IopAcceptUserSocket(Process,
+                                 IoHandle,
+                                 Parameters->OpenFlags,
+                                 &(Parameters->NewSocket),
+                                 &(Parameters->Address),
+                                 Parameters->RemotePath,
+                                 &(Parameters->RemotePathSize),
+                                 WAIT_TIME_INDEFINITE);
+
+SysSocketAcceptEnd:
+
     //
-    // Run the actual accept function, which will pop out a new socket that is
-    // unconnected to an I/O handle.
+    // An interrupted socket accept cannot be restarted if a receive timeout
+    // has been set.
     //
 
-    RemotePath = NULL;
-    RemotePathSize = 0;
-    Status = IoSocketAccept(IoHandle,
-                            &NewHandle,
-                            &(Parameters->Address),
-                            &RemotePath,
-                            &RemotePathSize);
-
-    if (!KSUCCESS(Status)) {
-        goto SysSocketAcceptEnd;
+    if (Status == STATUS_INTERRUPTED) {
+        Status = IopConvertInterruptedSocketStatus(IoHandle, 0, FALSE);
     }
 
-    if ((Parameters->OpenFlags & SYS_OPEN_FLAG_NON_BLOCKING) != 0) {
-        NewHandle->OpenFlags |= OPEN_FLAG_NON_BLOCKING;
-    }
+    //
+    // Release the reference that was added when the handle was looked up.
+    //
 
-    HandleFlags = 0;
-    if ((Parameters->OpenFlags & SYS_OPEN_FLAG_CLOSE_ON_EXECUTE) != 0) {
-        HandleFlags |= FILE_DESCRIPTOR_CLOSE_ON_EXECUTE;
+    if (IoHandle != NULL) {
+        IoIoHandleReleaseReference(IoHandle);
     }
 
-    //
-    // Finally, create a user mode handle for this socket.
-    //
+    return Status;
+}
 
-    Status = ObCreateHandle(Process->HandleTable,
-                            NewHandle,
-                            HandleFlags,
-                            &(Parameters->NewSocket));
+INTN
+IoSysSocketAcceptMultiple (
+    PVOID SystemCallParameter
+    )
 
-    if (!KSUCCESS(Status)) {
-        goto SysSocketAcceptEnd;
+/*++
+
+Routine Description:
+
+    This routine handles the system call that accepts several pending
+    connections on a listening socket at once. Only the first accept may
+    block.
+
+Arguments:
+
+    SystemCallParameter - Supplies a pointer to the parameters supplied with
+        the system call. This structure will be a stack-local copy of the
+        actual parameters passed from user-mode.
+
+Return Value:
+
+    Returns the number of connections accepted on success.
+
+    Error status code if no connection could be accepted.
+
+--*/
+
+{
+
+    SOCKET_ACCEPT_ENTRY Entry;
+    UINTN EntryIndex;
+    PIO_HANDLE IoHandle;
+    PSYSTEM_CALL_SOCKET_ACCEPT_MULTIPLE Parameters;
+    PKPROCESS Process;
+    KSTATUS Status;
+    ULONG Timeout;
+
+    EntryIndex = 0;
+    Parameters = (PSYSTEM_CALL_SOCKET_ACCEPT_MULTIPLE)SystemCallParameter;
+    Process = PsGetCurrentProcess();
+    IoHandle = ObGetHandleValue(Process->HandleTable, Parameters->Socket, NULL);
+    if (IoHandle == NULL) {
+        Status = STATUS_INVALID_HANDLE;
+        goto SysSocketAcceptMultipleEnd;
     }
 
-    //
-    // Copy the remote path over.
-    //
+    if ((Parameters->EntryCount == 0) ||
+        (Parameters->EntryCount > SOCKET_BATCH_MAX_COUNT)) {
 
-    if (RemotePath != NULL) {
-        CopySize = RemotePathSize;
-        if (CopySize > Parameters->RemotePathSize) {
-            CopySize = Parameters->RemotePathSize;
-        }
+        Status = STATUS_INVALID_PARAMETER;
+        goto SysSocketAcceptMultipleEnd;
+    }
 
-        if (CopySize != 0) {
-            Status = MmCopyToUserMode(Parameters->RemotePath,
-                                      RemotePath,
-                                      CopySize);
-        }
+    Timeout = WAIT_TIME_INDEFINITE;
+    while (EntryIndex < Parameters->EntryCount) {
+        Status = MmCopyFromUserMode(&Entry,
+                                    &(Parameters->Entries[EntryIndex]),
+                                    sizeof(SOCKET_ACCEPT_ENTRY));
 
-        Parameters->RemotePathSize = RemotePathSize;
         if (!KSUCCESS(Status)) {
-            goto SysSocketAcceptEnd;
+            break;
         }
-    }
 
-SysSocketAcceptEnd:
-    if (!KSUCCESS(Status)) {
-        if (NewHandle != NULL) {
-            IoIoHandleReleaseReference(NewHandle);
+        Entry.NewSocket = INVALID_HANDLE;
+        Status = IopAcceptUserSocket(Process,
+                                     IoHandle,
+                                     Parameters->OpenFlags,
+                                     &(Entry.NewSocket),
+                                     &(Entry.Address),
+                                     Entry.RemotePath,
+                                     &(Entry.RemotePathSize),
+                                     Timeout);
+
+        if (Entry.NewSocket == INVALID_HANDLE) {
+            break;
         }
-    }
 
-    //
-    // An interrupted socket accept cannot be restarted if a receive timeout
-    // has been set.
-    //
+        //
+        // Only the first accept is allowed to wait. The rest just take what
+        // is already in the backlog, and stop once it runs dry.
+        //
+
+        Timeout = 0;
+
+        //
+        // The handle belongs to the process now, so count it even if the
+        // entry cannot be written back.
+        //
+
+        EntryIndex += 1;
+        Status = MmCopyToUserMode(&(Parameters->Entries[EntryIndex - 1]),
+                                  &Entry,
+                                  sizeof(SOCKET_ACCEPT_ENTRY));
 
+        if (!KSUCCESS(Status)) {
+            break;
+        }
+    }
+
+SysSocketAcceptMultipleEnd:
     if (Status == STATUS_INTERRUPTED) {
         Status = IopConvertInterruptedSocketStatus(IoHandle, 0, FALSE);
     }
 
-    //
-    // Release the reference that was added when the handle was looked up.
-    //
-
     if (IoHandle != NULL) {
         IoIoHandleReleaseReference(IoHandle);
     }
 
+    if (EntryIndex != 0) {
+        return EntryIndex;
+    }
+
     return Status;
 }
 
@@ -1740,7 +1820,6 @@ Return Value:
 
 {
 
-    PIO_BUFFER IoBuffer;
     PIO_HANDLE IoHandle;
     SOCKET_IO_PARAMETERS IoParameters;
     PSYSTEM_CALL_SOCKET_PERFORM_VECTORED_IO Parameters;
@@ -1749,7 +1828,6 @@ Return Value:
     KSTATUS Status;
     BOOL Write;
 
-    IoBuffer = NULL;
     Parameters = (PSYSTEM_CALL_SOCKET_PERFORM_VECTORED_IO)SystemCallParameter;
     ParametersCopied = FALSE;
     Process = PsGetCurrentProcess();
@@ -1773,61 +1851,180 @@ Return Value:
     ParametersCopied = TRUE;
     IoParameters.BytesCompleted = 0;
     IoParameters.IoFlags &= SYS_IO_FLAG_MASK;
-    Status = MmCreateIoBufferFromVector(Parameters->VectorArray,
-                                        FALSE,
-                                        Parameters->VectorCount,
-                                        &IoBuffer);
+    Status = IopPerformUserSocketVectoredIo(Process,
+                                            IoHandle,
+                                            &IoParameters,
+                                            Parameters->VectorArray,
+                                            Parameters->VectorCount);
 
-    if (!KSUCCESS(Status)) {
-        goto SysSocketPerformVectoredIoEnd;
+SysSocketPerformVectoredIoEnd:
+
+    //
+    // An interrupted socket cannot be restarted if a timeout has been set.
+    //
+
+    if (Status == STATUS_INTERRUPTED) {
+        Write = ((IoParameters.IoFlags & SYS_IO_FLAG_WRITE) != 0);
+        Status = IopConvertInterruptedSocketStatus(IoHandle,
+                                                   IoParameters.BytesCompleted,
+                                                   Write);
     }
 
     //
-    // Non-blocking handles always have a timeout of zero.
+    // Release the reference that was added when the handle was looked up.
     //
 
-    if ((IoHandle->OpenFlags & OPEN_FLAG_NON_BLOCKING) != 0) {
-        IoParameters.TimeoutInMilliseconds = 0;
+    if (IoHandle != NULL) {
+        IoIoHandleReleaseReference(IoHandle);
     }
 
-    if ((IoParameters.IoFlags & SYS_IO_FLAG_WRITE) != 0) {
-        Status = IoSocketSendData(FALSE, IoHandle, &IoParameters, IoBuffer);
+    //
+    // Only copy the parameters out if they were copied in.
+    //
 
-        //
-        // Send a pipe signal if the returning status was "broken pipe".
-        //
+    if (ParametersCopied != FALSE) {
+        MmCopyToUserMode(Parameters->Parameters,
+                         &IoParameters,
+                         sizeof(SOCKET_IO_PARAMETERS));
+    }
 
-        if (Status == STATUS_BROKEN_PIPE) {
+    return Status;
+}
 
-            ASSERT(Process != PsGetKernelProcess());
+INTN
+IoSysSocketPerformBatchIo (
+    PVOID SystemCallParameter
+    )
 
-            PsSignalProcess(Process, SIGNAL_BROKEN_PIPE, NULL);
-        }
+/*++
 
-    } else {
-        Status = IoSocketReceiveData(FALSE, IoHandle, &IoParameters, IoBuffer);
+Routine Description:
+
+    This routine handles the system call that sends or receives several
+    messages on a socket at once.
+
+Arguments:
+
+    SystemCallParameter - Supplies a pointer to the parameters supplied with
+        the system call. This structure will be a stack-local copy of the
+        actual parameters passed from user-mode.
+
+Return Value:
+
+    Returns the number of messages processed on success.
+
+    Error status code if the first message failed.
+
+--*/
+
+{
+
+    ULONGLONG CurrentTime;
+    ULONGLONG EndTime;
+    PIO_HANDLE IoHandle;
+    SOCKET_IO_MESSAGE Message;
+    UINTN MessageIndex;
+    PSYSTEM_CALL_SOCKET_PERFORM_BATCH_IO Parameters;
+    PKPROCESS Process;
+    ULONGLONG Remaining;
+    KSTATUS Status;
+    ULONGLONG TimeCounterFrequency;
+    ULONG Timeout;
+    BOOL Write;
+
+    MessageIndex = 0;
+    Parameters = (PSYSTEM_CALL_SOCKET_PERFORM_BATCH_IO)SystemCallParameter;
+    Process = PsGetCurrentProcess();
+    IoHandle = ObGetHandleValue(Process->HandleTable, Parameters->Socket, NULL);
+    if (IoHandle == NULL) {
+        Status = STATUS_INVALID_HANDLE;
+        goto SysSocketPerformBatchIoEnd;
     }
 
-    if (!KSUCCESS(Status)) {
-        goto SysSocketPerformVectoredIoEnd;
+    if ((Parameters->MessageCount == 0) ||
+        (Parameters->MessageCount > SOCKET_BATCH_MAX_COUNT)) {
+
+        Status = STATUS_INVALID_PARAMETER;
+        goto SysSocketPerformBatchIoEnd;
     }
 
-SysSocketPerformVectoredIoEnd:
-    if (IoBuffer != NULL) {
-        MmFreeIoBuffer(IoBuffer);
+    EndTime = 0;
+    TimeCounterFrequency = 0;
+    Timeout = Parameters->TimeoutInMilliseconds;
+    if (Timeout != SYS_WAIT_TIME_INDEFINITE) {
+        EndTime = KeGetRecentTimeCounter();
+        EndTime += KeConvertMicrosecondsToTimeTicks(
+                                       Timeout * MICROSECONDS_PER_MILLISECOND);
+
+        TimeCounterFrequency = HlQueryTimeCounterFrequency();
     }
 
-    //
-    // An interrupted socket cannot be restarted if a timeout has been set.
-    //
+    Status = STATUS_SUCCESS;
+    while (MessageIndex < Parameters->MessageCount) {
+        Status = MmCopyFromUserMode(&Message,
+                                    &(Parameters->Messages[MessageIndex]),
+                                    sizeof(SOCKET_IO_MESSAGE));
 
-    if (Status == STATUS_INTERRUPTED) {
-        Write = ((IoParameters.IoFlags & SYS_IO_FLAG_WRITE) != 0);
-        Status = IopConvertInterruptedSocketStatus(IoHandle,
-                                                   IoParameters.BytesCompleted,
-                                                   Write);
+        if (!KSUCCESS(Status)) {
+            break;
+        }
+
+        Message.Parameters.BytesCompleted = 0;
+        Message.Parameters.IoFlags &= SYS_IO_FLAG_MASK;
+
+        //
+        // Clip the message timeout to whatever is left of the batch timeout.
+        //
+
+        if (TimeCounterFrequency != 0) {
+            Remaining = 0;
+            CurrentTime = KeGetRecentTimeCounter();
+            if (CurrentTime < EndTime) {
+                Remaining = (EndTime - CurrentTime) * MILLISECONDS_PER_SECOND /
+                            TimeCounterFrequency;
+            }
+
+            if (Remaining < Message.Parameters.TimeoutInMilliseconds) {
+                Message.Parameters.TimeoutInMilliseconds = (ULONG)Remaining;
+            }
+        }
+
+        Status = IopPerformUserSocketVectoredIo(Process,
+                                                IoHandle,
+                                                &(Message.Parameters),
+                                                Message.VectorArray,
+                                                Message.VectorCount);
+
+        if (Status == STATUS_INTERRUPTED) {
+            Write = ((Message.Parameters.IoFlags & SYS_IO_FLAG_WRITE) != 0);
+            Status = IopConvertInterruptedSocketStatus(
+                                             IoHandle,
+                                             Message.Parameters.BytesCompleted,
+                                             Write);
+        }
+
+        MmCopyToUserMode(&(Parameters->Messages[MessageIndex].Parameters),
+                         &(Message.Parameters),
+                         sizeof(SOCKET_IO_PARAMETERS));
+
+        //
+        // A receive that hits the end of the stream still completes its
+        // message, but there is no point in asking for more.
+        //
+
+        if (!KSUCCESS(Status)) {
+            if (Status == STATUS_END_OF_FILE) {
+                MessageIndex += 1;
+            }
+
+            break;
+        }
+
+        MessageIndex += 1;
     }
 
+SysSocketPerformBatchIoEnd:
+
     //
     // Release the reference that was added when the handle was looked up.
     //
@@ -1837,13 +2034,12 @@ Return Value:
     }
 
     //
-    // Only copy the parameters out if they were copied in.
+    // Once any message has gone through, report the count. A failure on a
+    // later message will surface again on the next call.
     //
 
-    if (ParametersCopied != FALSE) {
-        MmCopyToUserMode(Parameters->Parameters,
-                         &IoParameters,
-                         sizeof(SOCKET_IO_PARAMETERS));
+    if (MessageIndex != 0) {
+        return MessageIndex;
     }
 
     return Status;
@@ -2471,3 +2667,213 @@ Return Value:
     return STATUS_INTERRUPTED;
 }
 
+KSTATUS
+IopAcceptUserSocket (
+    PKPROCESS Process,
+    PIO_HANDLE IoHandle,
+    ULONG OpenFlags,
+    PHANDLE NewSocket,
+    PNETWORK_ADDRESS Address,
+    PSTR RemotePath,
+    PUINTN RemotePathSize,
+    ULONG TimeoutInMilliseconds
+    )
+
+/*++
+
+Routine Description:
+
+    This routine accepts a new incoming connection on a socket and creates a
+    user mode handle for it.
+
+Arguments:
+
+    Process - Supplies a pointer to the process accepting the connection.
+
+    IoHandle - Supplies a pointer to the listening socket.
+
+    OpenFlags - Supplies the system call open flags for the new socket. Only
+        SYS_OPEN_FLAG_NON_BLOCKING and SYS_OPEN_FLAG_CLOSE_ON_EXECUTE are
+        honored.
+
+    NewSocket - Supplies a pointer where the new user mode handle will be
+        returned. This is set as soon as the handle is created, even if
+        copying the remote path fails afterwards.
+
+    Address - Supplies a pointer where the remote network address will be
+        returned.
+
+    RemotePath - Supplies the user mode buffer where the remote path will be
+        copied for local sockets.
+
+    RemotePathSize - Supplies a pointer that on input contains the size of the
+        remote path buffer, and on output contains the true size of the remote
+        path.
+
+    TimeoutInMilliseconds - Supplies the number of milliseconds to wait for
+        a connection to come in. Use WAIT_TIME_INDEFINITE to wait forever.
+        A non-blocking socket never waits, regardless of this value.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    UINTN CopySize;
+    ULONG HandleFlags;
+    PIO_HANDLE NewHandle;
+    PCSTR NewRemotePath;
+    UINTN NewRemotePathSize;
+    KSTATUS Status;
+
+    //
+    // Run the actual accept function, which will pop out a new socket that is
+    // unconnected to an I/O handle.
+    //
+
+    NewHandle = NULL;
+    NewRemotePath = NULL;
+    NewRemotePathSize = 0;
+    Status = IoSocketAccept(IoHandle,
+                            &NewHandle,
+                            Address,
+                            &NewRemotePath,
+                            &NewRemotePathSize,
+                            TimeoutInMilliseconds);
+
+    if (!KSUCCESS(Status)) {
+        goto AcceptUserSocketEnd;
+    }
+
+    if ((OpenFlags & SYS_OPEN_FLAG_NON_BLOCKING) != 0) {
+        NewHandle->OpenFlags |= OPEN_FLAG_NON_BLOCKING;
+    }
+
+    HandleFlags = 0;
+    if ((OpenFlags & SYS_OPEN_FLAG_CLOSE_ON_EXECUTE) != 0) {
+        HandleFlags |= FILE_DESCRIPTOR_CLOSE_ON_EXECUTE;
+    }
+
+    //
+    // Finally, create a user mode handle for this socket. The handle table
+    // owns the reference from here on.
+    //
+
+    Status = ObCreateHandle(Process->HandleTable,
+                            NewHandle,
+                            HandleFlags,
+                            NewSocket);
+
+    if (!KSUCCESS(Status)) {
+        goto AcceptUserSocketEnd;
+    }
+
+    NewHandle = NULL;
+
+    //
+    // Copy the remote path over.
+    //
+
+    if (NewRemotePath != NULL) {
+        CopySize = NewRemotePathSize;
+        if (CopySize > *RemotePathSize) {
+            CopySize = *RemotePathSize;
+        }
+
+        if (CopySize != 0) {
+            Status = MmCopyToUserMode(RemotePath, NewRemotePath, CopySize);
+        }
+
+        *RemotePathSize = NewRemotePathSize;
+    }
+
+AcceptUserSocketEnd:
+    if (NewHandle != NULL) {
+        IoIoHandleReleaseReference(NewHandle);
+    }
+
+    return Status;
+}
+
+KSTATUS
+IopPerformUserSocketVectoredIo (
+    PKPROCESS Process,
+    PIO_HANDLE IoHandle,
+    PSOCKET_IO_PARAMETERS IoParameters,
+    PIO_VECTOR VectorArray,
+    UINTN VectorCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sends or receives a single message described by a user mode
+    I/O vector on a socket.
+
+Arguments:
+
+    Process - Supplies a pointer to the process performing the I/O.
+
+    IoHandle - Supplies a pointer to the socket.
+
+    IoParameters - Supplies a pointer to the kernel copy of the socket I/O
+        parameters. The I/O flags must already be masked.
+
+    VectorArray - Supplies the user mode array of I/O vectors.
+
+    VectorCount - Supplies the number of elements in the vector array.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    PIO_BUFFER IoBuffer;
+    KSTATUS Status;
+
+    Status = MmCreateIoBufferFromVector(VectorArray,
+                                        FALSE,
+                                        VectorCount,
+                                        &IoBuffer);
+
+    if (!KSUCCESS(Status)) {
+        return Status;
+    }
+
+    //
+    // Non-blocking handles always have a timeout of zero.
+    //
+
+    if ((IoHandle->OpenFlags & OPEN_FLAG_NON_BLOCKING) != 0) {
+        IoParameters->TimeoutInMilliseconds = 0;
+    }
+
+    if ((IoParameters->IoFlags & SYS_IO_FLAG_WRITE) != 0) {
+        Status = IoSocketSendData(FALSE, IoHandle, IoParameters, IoBuffer);
+
+        //
+        // Send a pipe signal if the returning status was "broken pipe".
+        //
+
+        if (Status == STATUS_BROKEN_PIPE) {
+
+            ASSERT(Process != PsGetKernelProcess());
+
+            PsSignalProcess(Process, SIGNAL_BROKEN_PIPE, NULL);
+        }
+
+    } else {
+        Status = IoSocketReceiveData(FALSE, IoHandle, IoParameters, IoBuffer);
+    }
+
+    MmFreeIoBuffer(IoBuffer);
+    return Status;
+}
+
@@ -227,7 +227,8 @@ IopUnixSocketAccept (
     PIO_HANDLE *NewConnectionSocket,
     PNETWORK_ADDRESS RemoteAddress,
     PCSTR *RemotePath,
-    PUINTN RemotePathSize
+    PUINTN RemotePathSize,
+    ULONG TimeoutInMilliseconds
     );
 
 /*++
@@ -255,6 +256,10 @@ Routine Description:
     RemotePathSize - Supplies a pointer where the size of the remote path in
         bytes will be returned on success.
 
+    TimeoutInMilliseconds - Supplies the number of milliseconds to wait for
+        a connection to come in. Use WAIT_TIME_INDEFINITE to wait forever.
+        A non-blocking socket never waits, regardless of this value.
+
 Return Value:
 
     Status code.
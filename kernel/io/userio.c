@@ -2630,11 +2630,88 @@ Return Value:
 
 {
 
-    //
-    // TODO: Add support for creating a hard link.
-    //
+    PSTR ExistingFileCopy;
+    PIO_HANDLE ExistingFileDirectory;
+    PSTR LinkCopy;
+    PIO_HANDLE LinkDirectory;
+    PSYSTEM_CALL_CREATE_HARD_LINK Parameters;
+    PKPROCESS Process;
+    KSTATUS Status;
+
+    ExistingFileCopy = NULL;
+    ExistingFileDirectory = NULL;
+    LinkCopy = NULL;
+    LinkDirectory = NULL;
+    Parameters = (PSYSTEM_CALL_CREATE_HARD_LINK)SystemCallParameter;
+    Process = PsGetCurrentProcess();
+    if (Parameters->ExistingFileDirectory != INVALID_HANDLE) {
+        ExistingFileDirectory = ObGetHandleValue(
+                                             Process->HandleTable,
+                                             Parameters->ExistingFileDirectory,
+                                             NULL);
+
+        if (ExistingFileDirectory == NULL) {
+            Status = STATUS_INVALID_HANDLE;
+            goto SysCreateHardLinkEnd;
+        }
+    }
+
+    if (Parameters->NewLinkDirectory != INVALID_HANDLE) {
+        LinkDirectory = ObGetHandleValue(Process->HandleTable,
+                                         Parameters->NewLinkDirectory,
+                                         NULL);
 
-    return STATUS_NOT_SUPPORTED;
+        if (LinkDirectory == NULL) {
+            Status = STATUS_INVALID_HANDLE;
+            goto SysCreateHardLinkEnd;
+        }
+    }
+
+    Status = MmCreateCopyOfUserModeString(Parameters->ExistingFilePath,
+                                          Parameters->ExistingFilePathSize,
+                                          IO_ALLOCATION_TAG,
+                                          &ExistingFileCopy);
+
+    if (!KSUCCESS(Status)) {
+        goto SysCreateHardLinkEnd;
+    }
+
+    Status = MmCreateCopyOfUserModeString(Parameters->NewLinkPath,
+                                          Parameters->NewLinkPathSize,
+                                          IO_ALLOCATION_TAG,
+                                          &LinkCopy);
+
+    if (!KSUCCESS(Status)) {
+        goto SysCreateHardLinkEnd;
+    }
+
+    Status = IoCreateHardLink(FALSE,
+                              ExistingFileDirectory,
+                              ExistingFileCopy,
+                              Parameters->ExistingFilePathSize,
+                              LinkDirectory,
+                              LinkCopy,
+                              Parameters->NewLinkPathSize,
+                              Parameters->FollowLinks);
+
+SysCreateHardLinkEnd:
+    if (ExistingFileDirectory != NULL) {
+        IoIoHandleReleaseReference(ExistingFileDirectory);
+    }
+
+    if (LinkDirectory != NULL) {
+        IoIoHandleReleaseReference(LinkDirectory);
+    }
+
+    if (ExistingFileCopy != NULL) {
+        MmFreePagedPool(ExistingFileCopy);
+    }
+
+    if (LinkCopy != NULL) {
+        MmFreePagedPool(LinkCopy);
+    }
+
+    return Status;
 }
 
 INTN
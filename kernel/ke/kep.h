@@ -183,6 +183,53 @@ Return Value:
 
 --*/
 
+VOID
+KepWorkerThreadBlocking (
+    PKTHREAD Thread
+    );
+
+/*++
+
+Routine Description:
+
+    This routine is called by the scheduler when a work queue worker thread
+    blocks. If the worker was busy and was the last running worker in its
+    pool, an idle worker is woken to keep processing the pool's work items.
+    This routine is called at dispatch level.
+
+Arguments:
+
+    Thread - Supplies a pointer to the worker thread that is blocking.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+KepWorkerThreadRunning (
+    PKTHREAD Thread
+    );
+
+/*++
+
+Routine Description:
+
+    This routine is called by the scheduler when a work queue worker thread is
+    about to run. If the worker blocked while busy, it is counted as running
+    again. This routine is called at dispatch level.
+
+Arguments:
+
+    Thread - Supplies a pointer to the worker thread that is about to run.
+
+Return Value:
+
+    None.
+
+--*/
+
 VOID
 KepExecutePendingDpcs (
     VOID
@@ -46,14 +46,145 @@ Module Name:
 #define SHARED_EXCLUSIVE_LOCK_EXCLUSIVE ((ULONG)-1)
 #define SHARED_EXCLUSIVE_LOCK_MAX_WAITERS ((ULONG)-2)
 
+#define LOCK_CLASS_TAG 0x634C654B // 'cLeK'
+
 //
-// ----------------------------------------------- Internal Function Prototypes
+// Define the number of buckets in the lock class hash table.
+//
+
+#define LOCK_CLASS_HASH_SIZE 64
+
+//
+// Define the number of individual spin locks whose contention is tracked.
 //
 
+#define SPIN_LOCK_STATISTICS_COUNT 64
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
 
+/*++
+
+Structure Description:
+
+    This structure defines a lock class, the unit lock statistics are
+    accumulated in. Classes are never freed, so they can be walked without a
+    lock.
+
+Members:
+
+    Next - Stores a pointer to the next class in the same hash bucket.
+
+    Type - Stores the kind of lock in this class.
+
+    Name - Stores an optional pointer to the name of the class.
+
+    Creator - Stores the address of the code that created the first lock in
+        this class. Unnamed classes are identified by this address.
+
+    AcquireCount - Stores the number of acquisitions.
+
+    ContentionCount - Stores the number of acquisitions that had to wait.
+
+    TotalWaitTime - Stores the total time spent waiting, in time counter ticks.
+
+    MaxWaitTime - Stores the longest single wait, in time counter ticks.
+
+    TotalHoldTime - Stores the total time locks were held exclusively, in time
+        counter ticks.
+
+    MaxHoldTime - Stores the longest exclusive hold, in time counter ticks.
+
+--*/
+
+struct _KE_LOCK_CLASS {
+    PKE_LOCK_CLASS Next;
+    PROFILER_LOCK_TYPE Type;
+    PCSTR Name;
+    PVOID Creator;
+    volatile ULONGLONG AcquireCount;
+    volatile ULONGLONG ContentionCount;
+    volatile ULONGLONG TotalWaitTime;
+    volatile ULONGLONG MaxWaitTime;
+    volatile ULONGLONG TotalHoldTime;
+    volatile ULONGLONG MaxHoldTime;
+};
+
+/*++
+
+Structure Description:
+
+    This structure defines contention statistics for a single spin lock.
+
+Members:
+
+    Lock - Stores the address of the spin lock this entry tracks, or 0 if the
+        entry is free.
+
+    ContentionCount - Stores the number of acquisitions that had to spin.
+
+    TotalWaitTime - Stores the total time spent spinning, in time counter
+        ticks.
+
+    MaxWaitTime - Stores the longest single spin, in time counter ticks.
+
+--*/
+
+typedef struct _SPIN_LOCK_STATISTIC {
+    volatile UINTN Lock;
+    volatile ULONGLONG ContentionCount;
+    volatile ULONGLONG TotalWaitTime;
+    volatile ULONGLONG MaxWaitTime;
+} SPIN_LOCK_STATISTIC, *PSPIN_LOCK_STATISTIC;
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+PQUEUED_LOCK
+KepCreateQueuedLock (
+    PCSTR ClassName,
+    PVOID Creator
+    );
+
+PSHARED_EXCLUSIVE_LOCK
+KepCreateSharedExclusiveLock (
+    PCSTR ClassName,
+    PVOID Creator
+    );
+
+PKE_LOCK_CLASS
+KepGetLockClass (
+    PROFILER_LOCK_TYPE Type,
+    PCSTR Name,
+    PVOID Creator
+    );
+
+VOID
+KepRecordLockAcquire (
+    PKE_LOCK_CLASS Class,
+    ULONGLONG WaitStart
+    );
+
+VOID
+KepRecordLockRelease (
+    PKE_LOCK_CLASS Class,
+    ULONGLONG AcquireTime
+    );
+
+VOID
+KepRecordSpinLockContention (
+    PKSPIN_LOCK Lock,
+    ULONGLONG WaitStart
+    );
+
+VOID
+KepUpdateMaximum (
+    volatile ULONGLONG *Maximum,
+    ULONGLONG Value
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -65,6 +196,25 @@ Module Name:
 
 POBJECT_HEADER KeQueuedLockDirectory = NULL;
 
+//
+// Set this to TRUE to collect lock statistics. This is controlled by the
+// system profiler.
+//
+
+volatile BOOL KeLockStatisticsEnabled = FALSE;
+
+//
+// Store the hash table of lock classes.
+//
+
+PKE_LOCK_CLASS KeLockClasses[LOCK_CLASS_HASH_SIZE];
+
+//
+// Store the contention statistics for individual spin locks.
+//
+
+SPIN_LOCK_STATISTIC KeSpinLockStatistics[SPIN_LOCK_STATISTICS_COUNT];
+
 //
 // ------------------------------------------------------------------ Functions
 //
@@ -96,30 +246,39 @@ Return Value:
 
 {
 
-    PQUEUED_LOCK NewLock;
-    POBJECT_HEADER NewObject;
+    return KepCreateQueuedLock(NULL, __builtin_return_address(0));
+}
 
-    NewObject = ObCreateObject(ObjectQueuedLock,
-                               KeQueuedLockDirectory,
-                               NULL,
-                               0,
-                               sizeof(QUEUED_LOCK),
-                               NULL,
-                               0,
-                               QUEUED_LOCK_TAG);
+KERNEL_API
+PQUEUED_LOCK
+KeCreateNamedQueuedLock (
+    PCSTR ClassName
+    )
 
-    NewLock = (PQUEUED_LOCK)NewObject;
-    if (NewLock != NULL) {
+/*++
 
-        //
-        // Initialize the lock to signal one thread so the first wait acquires
-        // it.
-        //
+Routine Description:
 
-        ObSignalObject(NewObject, SignalOptionSignalOne);
-    }
+    This routine creates a new queued lock whose statistics are accumulated
+    under the given lock class name.
 
-    return NewLock;
+Arguments:
+
+    ClassName - Supplies a pointer to the name of the lock class. All locks
+        created with the same name share statistics. This string must remain
+        valid for the lifetime of the system.
+
+Return Value:
+
+    Returns a pointer to the new lock on success.
+
+    NULL on failure.
+
+--*/
+
+{
+
+    return KepCreateQueuedLock(ClassName, __builtin_return_address(0));
 }
 
 KERNEL_API
@@ -217,17 +376,41 @@ Return Value:
 
 {
 
+    PKE_LOCK_CLASS Class;
     KSTATUS Status;
     PKTHREAD Thread;
+    ULONGLONG WaitStart;
 
     Thread = KeGetCurrentThread();
 
     ASSERT(KeGetRunLevel() <= RunLevelDispatch);
     ASSERT((Lock->OwningThread != Thread) || (Thread == NULL));
 
-    Status = ObWaitOnObject(&(Lock->Header), 0, TimeoutInMilliseconds);
+    //
+    // When collecting statistics, make a single attempt first to find out
+    // whether or not the acquire is contended.
+    //
+
+    Class = NULL;
+    WaitStart = 0;
+    if ((KeLockStatisticsEnabled != FALSE) && (Lock->Class != NULL)) {
+        Class = Lock->Class;
+        Status = ObWaitOnObject(&(Lock->Header), 0, 0);
+        if ((!KSUCCESS(Status)) && (TimeoutInMilliseconds != 0)) {
+            WaitStart = HlQueryTimeCounter();
+            Status = ObWaitOnObject(&(Lock->Header), 0, TimeoutInMilliseconds);
+        }
+
+    } else {
+        Status = ObWaitOnObject(&(Lock->Header), 0, TimeoutInMilliseconds);
+    }
+
     if (KSUCCESS(Status)) {
         Lock->OwningThread = Thread;
+        if (Class != NULL) {
+            KepRecordLockAcquire(Class, WaitStart);
+            Lock->AcquireTime = HlQueryTimeCounter();
+        }
     }
 
     return Status;
@@ -257,8 +440,16 @@ Return Value:
 
 {
 
+    ULONGLONG AcquireTime;
+
     ASSERT(KeGetRunLevel() <= RunLevelDispatch);
 
+    AcquireTime = Lock->AcquireTime;
+    if (AcquireTime != 0) {
+        Lock->AcquireTime = 0;
+        KepRecordLockRelease(Lock->Class, AcquireTime);
+    }
+
     Lock->OwningThread = NULL;
     ObSignalObject(&(Lock->Header), SignalOptionSignalOne);
     return;
@@ -299,6 +490,11 @@ Return Value:
     }
 
     Lock->OwningThread = KeGetCurrentThread();
+    if ((KeLockStatisticsEnabled != FALSE) && (Lock->Class != NULL)) {
+        KepRecordLockAcquire(Lock->Class, 0);
+        Lock->AcquireTime = HlQueryTimeCounter();
+    }
+
     return TRUE;
 }
 
@@ -397,17 +593,27 @@ Return Value:
 {
 
     ULONG LockValue;
+    ULONGLONG WaitStart;
 
+    WaitStart = 0;
     while (TRUE) {
         LockValue = RtlAtomicCompareExchange32(&(Lock->LockHeld), 1, 0);
         if (LockValue == 0) {
             break;
         }
 
+        if ((WaitStart == 0) && (KeLockStatisticsEnabled != FALSE)) {
+            WaitStart = HlQueryTimeCounter();
+        }
+
         ArProcessorYield();
     }
 
     Lock->OwningThread = KeGetCurrentThread();
+    if (WaitStart != 0) {
+        KepRecordSpinLockContention(Lock, WaitStart);
+    }
+
     return;
 }
 
@@ -551,36 +757,38 @@ Return Value:
 
 {
 
-    PSHARED_EXCLUSIVE_LOCK SharedExclusiveLock;
-    KSTATUS Status;
+    return KepCreateSharedExclusiveLock(NULL, __builtin_return_address(0));
+}
 
-    SharedExclusiveLock = MmAllocateNonPagedPool(sizeof(SHARED_EXCLUSIVE_LOCK),
-                                                 SHARED_EXCLUSIVE_LOCK_TAG);
+KERNEL_API
+PSHARED_EXCLUSIVE_LOCK
+KeCreateNamedSharedExclusiveLock (
+    PCSTR ClassName
+    )
 
-    if (SharedExclusiveLock == NULL) {
-        Status = STATUS_INSUFFICIENT_RESOURCES;
-        goto CreateSharedExclusiveLockEnd;
-    }
+/*++
 
-    RtlZeroMemory(SharedExclusiveLock, sizeof(SHARED_EXCLUSIVE_LOCK));
-    SharedExclusiveLock->Event = KeCreateEvent(NULL);
-    if (SharedExclusiveLock->Event == NULL) {
-        Status = STATUS_INSUFFICIENT_RESOURCES;
-        goto CreateSharedExclusiveLockEnd;
-    }
+Routine Description:
 
-    KeSignalEvent(SharedExclusiveLock->Event, SignalOptionSignalOne);
-    Status = STATUS_SUCCESS;
+    This routine creates a shared-exclusive lock whose statistics are
+    accumulated under the given lock class name.
 
-CreateSharedExclusiveLockEnd:
-    if (!KSUCCESS(Status)) {
-        if (SharedExclusiveLock != NULL) {
-            KeDestroySharedExclusiveLock(SharedExclusiveLock);
-            SharedExclusiveLock = NULL;
-        }
-    }
+Arguments:
 
-    return SharedExclusiveLock;
+    ClassName - Supplies a pointer to the name of the lock class. All locks
+        created with the same name share statistics. This string must remain
+        valid for the lifetime of the system.
+
+Return Value:
+
+    Returns a pointer to a shared-exclusive lock on success, or NULL on failure.
+
+--*/
+
+{
+
+    return KepCreateSharedExclusiveLock(ClassName,
+                                        __builtin_return_address(0));
 }
 
 KERNEL_API
@@ -639,14 +847,22 @@ Return Value:
 
 {
 
+    PKE_LOCK_CLASS Class;
     ULONG ExclusiveWaiters;
     BOOL IsWaiter;
     ULONG PreviousState;
     ULONG PreviousWaiters;
     ULONG SharedWaiters;
     ULONG State;
+    ULONGLONG WaitStart;
+
+    Class = NULL;
+    if (KeLockStatisticsEnabled != FALSE) {
+        Class = SharedExclusiveLock->Class;
+    }
 
     IsWaiter = FALSE;
+    WaitStart = 0;
     while (TRUE) {
         State = SharedExclusiveLock->State;
         ExclusiveWaiters = SharedExclusiveLock->ExclusiveWaiters;
@@ -714,6 +930,9 @@ Return Value:
             }
 
             IsWaiter = TRUE;
+            if (Class != NULL) {
+                WaitStart = HlQueryTimeCounter();
+            }
         }
 
         //
@@ -742,6 +961,10 @@ Return Value:
         ASSERT(PreviousWaiters != 0);
     }
 
+    if (Class != NULL) {
+        KepRecordLockAcquire(Class, WaitStart);
+    }
+
     return;
 }
 
@@ -798,6 +1021,12 @@ Return Value:
                               SignalOptionPulse);
             }
 
+            if ((KeLockStatisticsEnabled != FALSE) &&
+                (SharedExclusiveLock->Class != NULL)) {
+
+                KepRecordLockAcquire(SharedExclusiveLock->Class, 0);
+            }
+
             return TRUE;
         }
     }
@@ -874,13 +1103,21 @@ Return Value:
 
 {
 
+    PKE_LOCK_CLASS Class;
     ULONG CurrentState;
     ULONG ExclusiveWaiters;
     BOOL IsWaiting;
     ULONG PreviousWaiters;
     ULONG State;
+    ULONGLONG WaitStart;
+
+    Class = NULL;
+    if (KeLockStatisticsEnabled != FALSE) {
+        Class = SharedExclusiveLock->Class;
+    }
 
     IsWaiting = FALSE;
+    WaitStart = 0;
     while (TRUE) {
         State = RtlAtomicCompareExchange32(&(SharedExclusiveLock->State),
                                            SHARED_EXCLUSIVE_LOCK_EXCLUSIVE,
@@ -912,6 +1149,9 @@ Return Value:
             }
 
             IsWaiting = TRUE;
+            if (Class != NULL) {
+                WaitStart = HlQueryTimeCounter();
+            }
         }
 
         //
@@ -939,6 +1179,11 @@ Return Value:
         ASSERT(PreviousWaiters != 0);
     }
 
+    if (Class != NULL) {
+        KepRecordLockAcquire(Class, WaitStart);
+        SharedExclusiveLock->ExclusiveAcquireTime = HlQueryTimeCounter();
+    }
+
     return;
 }
 
@@ -976,6 +1221,13 @@ Return Value:
                                        SHARED_EXCLUSIVE_LOCK_FREE);
 
     if (State == SHARED_EXCLUSIVE_LOCK_FREE) {
+        if ((KeLockStatisticsEnabled != FALSE) &&
+            (SharedExclusiveLock->Class != NULL)) {
+
+            KepRecordLockAcquire(SharedExclusiveLock->Class, 0);
+            SharedExclusiveLock->ExclusiveAcquireTime = HlQueryTimeCounter();
+        }
+
         return TRUE;
     }
 
@@ -1006,8 +1258,16 @@ Return Value:
 
 {
 
+    ULONGLONG AcquireTime;
+
     ASSERT(SharedExclusiveLock->State == SHARED_EXCLUSIVE_LOCK_EXCLUSIVE);
 
+    AcquireTime = SharedExclusiveLock->ExclusiveAcquireTime;
+    if (AcquireTime != 0) {
+        SharedExclusiveLock->ExclusiveAcquireTime = 0;
+        KepRecordLockRelease(SharedExclusiveLock->Class, AcquireTime);
+    }
+
     RtlAtomicExchange32(&(SharedExclusiveLock->State),
                         SHARED_EXCLUSIVE_LOCK_FREE);
 
@@ -1066,6 +1326,11 @@ Return Value:
     if (State != 1) {
         KeReleaseSharedExclusiveLockShared(SharedExclusiveLock);
         KeAcquireSharedExclusiveLockExclusive(SharedExclusiveLock);
+
+    } else if ((KeLockStatisticsEnabled != FALSE) &&
+               (SharedExclusiveLock->Class != NULL)) {
+
+        SharedExclusiveLock->ExclusiveAcquireTime = HlQueryTimeCounter();
     }
 
     return;
@@ -1205,7 +1470,642 @@ Return Value:
     return FALSE;
 }
 
-//
-// --------------------------------------------------------- Internal Functions
-//
+VOID
+KeSetLockStatistics (
+    BOOL Enable
+    )
+
+/*++
+
+Routine Description:
+
+    This routine enables or disables lock statistics collection. Enabling
+    statistics resets the counts accumulated in every lock class.
+
+Arguments:
+
+    Enable - Supplies a boolean indicating whether lock statistics should be
+        collected (TRUE) or not (FALSE).
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PKE_LOCK_CLASS Class;
+    ULONG Index;
+    PSPIN_LOCK_STATISTIC SpinStatistic;
+
+    if (Enable == FALSE) {
+        KeLockStatisticsEnabled = FALSE;
+        return;
+    }
+
+    for (Index = 0; Index < LOCK_CLASS_HASH_SIZE; Index += 1) {
+        Class = KeLockClasses[Index];
+        while (Class != NULL) {
+            Class->AcquireCount = 0;
+            Class->ContentionCount = 0;
+            Class->TotalWaitTime = 0;
+            Class->MaxWaitTime = 0;
+            Class->TotalHoldTime = 0;
+            Class->MaxHoldTime = 0;
+            Class = Class->Next;
+        }
+    }
+
+    for (Index = 0; Index < SPIN_LOCK_STATISTICS_COUNT; Index += 1) {
+        SpinStatistic = &(KeSpinLockStatistics[Index]);
+        SpinStatistic->ContentionCount = 0;
+        SpinStatistic->TotalWaitTime = 0;
+        SpinStatistic->MaxWaitTime = 0;
+        SpinStatistic->Lock = 0;
+    }
+
+    RtlMemoryBarrier();
+    KeLockStatisticsEnabled = TRUE;
+    return;
+}
+
+KSTATUS
+KeGetLockProfilerStatistics (
+    PVOID *Buffer,
+    PULONG BufferSize,
+    ULONG Tag
+    )
+
+/*++
+
+Routine Description:
+
+    This routine allocates a buffer and fills it with the statistics of every
+    lock class, in the format described by the system profiler protocol.
+
+Arguments:
+
+    Buffer - Supplies a pointer that receives a non-paged pool buffer full of
+        lock statistics. The caller is responsible for freeing it.
+
+    BufferSize - Supplies a pointer that receives the size of the buffer, in
+        bytes.
+
+    Tag - Supplies an identifier to associate with the allocation, useful for
+        debugging and leak detection.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    PKE_LOCK_CLASS Class;
+    ULONG ClassCount;
+    PBYTE Data;
+    ULONG EntrySize;
+    PPROFILER_LOCK_HEADER Header;
+    ULONG Index;
+    ULONG NameSize;
+    ULONG Offset;
+    ULONG Size;
+    PSPIN_LOCK_STATISTIC SpinStatistic;
+    PPROFILER_LOCK_STATISTIC Statistic;
+
+    ASSERT(KeGetRunLevel() == RunLevelLow);
+
+    //
+    // Size up the buffer. Only classes that have seen activity are reported.
+    // Classes are never removed, so any that show up after this pass are
+    // just left out of this snapshot.
+    //
+
+    Size = sizeof(PROFILER_LOCK_HEADER);
+    for (Index = 0; Index < LOCK_CLASS_HASH_SIZE; Index += 1) {
+        Class = KeLockClasses[Index];
+        while (Class != NULL) {
+            if (Class->AcquireCount != 0) {
+                Size += FIELD_OFFSET(PROFILER_LOCK_STATISTIC, Name) + 1;
+                if (Class->Name != NULL) {
+                    Size += RtlStringLength(Class->Name);
+                }
+            }
+
+            Class = Class->Next;
+        }
+    }
+
+    for (Index = 0; Index < SPIN_LOCK_STATISTICS_COUNT; Index += 1) {
+        if (KeSpinLockStatistics[Index].Lock != 0) {
+            Size += FIELD_OFFSET(PROFILER_LOCK_STATISTIC, Name) + 1;
+        }
+    }
+
+    Data = MmAllocateNonPagedPool(Size, Tag);
+    if (Data == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    ClassCount = 0;
+    Offset = sizeof(PROFILER_LOCK_HEADER);
+    for (Index = 0; Index < LOCK_CLASS_HASH_SIZE; Index += 1) {
+        Class = KeLockClasses[Index];
+        while (Class != NULL) {
+            if (Class->AcquireCount == 0) {
+                Class = Class->Next;
+                continue;
+            }
+
+            NameSize = 1;
+            if (Class->Name != NULL) {
+                NameSize += RtlStringLength(Class->Name);
+            }
+
+            EntrySize = FIELD_OFFSET(PROFILER_LOCK_STATISTIC, Name) + NameSize;
+            if (Offset + EntrySize > Size) {
+                break;
+            }
+
+            Statistic = (PPROFILER_LOCK_STATISTIC)(Data + Offset);
+            Statistic->StructureSize = EntrySize;
+            Statistic->LockType = Class->Type;
+            Statistic->Address = (UINTN)(Class->Creator);
+            Statistic->AcquireCount = Class->AcquireCount;
+            Statistic->ContentionCount = Class->ContentionCount;
+            Statistic->TotalWaitTime = Class->TotalWaitTime;
+            Statistic->MaxWaitTime = Class->MaxWaitTime;
+            Statistic->TotalHoldTime = Class->TotalHoldTime;
+            Statistic->MaxHoldTime = Class->MaxHoldTime;
+            Statistic->Name[0] = '\0';
+            if (Class->Name != NULL) {
+                RtlCopyMemory(Statistic->Name, Class->Name, NameSize);
+            }
+
+            Offset += EntrySize;
+            ClassCount += 1;
+            Class = Class->Next;
+        }
+    }
+
+    EntrySize = FIELD_OFFSET(PROFILER_LOCK_STATISTIC, Name) + 1;
+    for (Index = 0; Index < SPIN_LOCK_STATISTICS_COUNT; Index += 1) {
+        SpinStatistic = &(KeSpinLockStatistics[Index]);
+        if ((SpinStatistic->Lock == 0) || (Offset + EntrySize > Size)) {
+            continue;
+        }
+
+        Statistic = (PPROFILER_LOCK_STATISTIC)(Data + Offset);
+        Statistic->StructureSize = EntrySize;
+        Statistic->LockType = ProfilerLockTypeSpin;
+        Statistic->Address = SpinStatistic->Lock;
+        Statistic->AcquireCount = 0;
+        Statistic->ContentionCount = SpinStatistic->ContentionCount;
+        Statistic->TotalWaitTime = SpinStatistic->TotalWaitTime;
+        Statistic->MaxWaitTime = SpinStatistic->MaxWaitTime;
+        Statistic->TotalHoldTime = 0;
+        Statistic->MaxHoldTime = 0;
+        Statistic->Name[0] = '\0';
+        Offset += EntrySize;
+        ClassCount += 1;
+    }
+
+    Header = (PPROFILER_LOCK_HEADER)Data;
+    Header->Magic = PROFILER_LOCK_MAGIC;
+    Header->ClassCount = ClassCount;
+    Header->TimeCounterFrequency = HlQueryTimeCounterFrequency();
+    *Buffer = Data;
+    *BufferSize = Offset;
+    return STATUS_SUCCESS;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+PQUEUED_LOCK
+KepCreateQueuedLock (
+    PCSTR ClassName,
+    PVOID Creator
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates a new queued lock.
+
+Arguments:
+
+    ClassName - Supplies an optional pointer to the name of the lock class.
+
+    Creator - Supplies the address of the code creating the lock, which
+        identifies the lock class if no name is supplied.
+
+Return Value:
+
+    Returns a pointer to the new lock on success.
+
+    NULL on failure.
+
+--*/
+
+{
+
+    PQUEUED_LOCK NewLock;
+    POBJECT_HEADER NewObject;
+
+    NewObject = ObCreateObject(ObjectQueuedLock,
+                               KeQueuedLockDirectory,
+                               NULL,
+                               0,
+                               sizeof(QUEUED_LOCK),
+                               NULL,
+                               0,
+                               QUEUED_LOCK_TAG);
+
+    NewLock = (PQUEUED_LOCK)NewObject;
+    if (NewLock != NULL) {
+        NewLock->Class = KepGetLockClass(ProfilerLockTypeQueued,
+                                         ClassName,
+                                         Creator);
+
+        //
+        // Initialize the lock to signal one thread so the first wait acquires
+        // it.
+        //
+
+        ObSignalObject(NewObject, SignalOptionSignalOne);
+    }
+
+    return NewLock;
+}
+
+PSHARED_EXCLUSIVE_LOCK
+KepCreateSharedExclusiveLock (
+    PCSTR ClassName,
+    PVOID Creator
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates a shared-exclusive lock.
+
+Arguments:
+
+    ClassName - Supplies an optional pointer to the name of the lock class.
+
+    Creator - Supplies the address of the code creating the lock, which
+        identifies the lock class if no name is supplied.
+
+Return Value:
+
+    Returns a pointer to a shared-exclusive lock on success, or NULL on failure.
+
+--*/
+
+{
+
+    PSHARED_EXCLUSIVE_LOCK SharedExclusiveLock;
+    KSTATUS Status;
+
+    SharedExclusiveLock = MmAllocateNonPagedPool(sizeof(SHARED_EXCLUSIVE_LOCK),
+                                                 SHARED_EXCLUSIVE_LOCK_TAG);
+
+    if (SharedExclusiveLock == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto CreateSharedExclusiveLockEnd;
+    }
+
+    RtlZeroMemory(SharedExclusiveLock, sizeof(SHARED_EXCLUSIVE_LOCK));
+    SharedExclusiveLock->Event = KeCreateEvent(NULL);
+    if (SharedExclusiveLock->Event == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto CreateSharedExclusiveLockEnd;
+    }
+
+    SharedExclusiveLock->Class =
+                              KepGetLockClass(ProfilerLockTypeSharedExclusive,
+                                              ClassName,
+                                              Creator);
+
+    KeSignalEvent(SharedExclusiveLock->Event, SignalOptionSignalOne);
+    Status = STATUS_SUCCESS;
+
+CreateSharedExclusiveLockEnd:
+    if (!KSUCCESS(Status)) {
+        if (SharedExclusiveLock != NULL) {
+            KeDestroySharedExclusiveLock(SharedExclusiveLock);
+            SharedExclusiveLock = NULL;
+        }
+    }
+
+    return SharedExclusiveLock;
+}
+
+PKE_LOCK_CLASS
+KepGetLockClass (
+    PROFILER_LOCK_TYPE Type,
+    PCSTR Name,
+    PVOID Creator
+    )
+
+/*++
+
+Routine Description:
+
+    This routine finds or creates the lock class for a new lock. Named classes
+    are matched by name, and unnamed classes by the address that created them.
+
+Arguments:
+
+    Type - Supplies the kind of lock being created.
+
+    Name - Supplies an optional pointer to the name of the class.
+
+    Creator - Supplies the address of the code creating the lock.
+
+Return Value:
+
+    Returns a pointer to the lock class, or NULL if a new class could not be
+    allocated. Statistics are not collected for a lock without a class.
+
+--*/
+
+{
+
+    PCSTR Character;
+    PKE_LOCK_CLASS Class;
+    UINTN Hash;
+    PKE_LOCK_CLASS Head;
+    PKE_LOCK_CLASS NewClass;
+    UINTN OldHead;
+
+    if (Name != NULL) {
+        Hash = 0;
+        Character = Name;
+        while (*Character != '\0') {
+            Hash = (Hash * 31) + *Character;
+            Character += 1;
+        }
+
+    } else {
+        Hash = (UINTN)Creator >> 2;
+    }
+
+    Hash = (Hash ^ (Hash >> 6)) % LOCK_CLASS_HASH_SIZE;
+    NewClass = NULL;
+    while (TRUE) {
+
+        //
+        // Classes are only ever pushed onto the head of a bucket, so a walk
+        // from a snapped head sees every class that existed at that point.
+        //
+
+        Head = KeLockClasses[Hash];
+        Class = Head;
+        while (Class != NULL) {
+            if (Class->Type == Type) {
+                if (Name != NULL) {
+                    if ((Class->Name != NULL) &&
+                        (RtlAreStringsEqual(Class->Name, Name, MAX_ULONG) !=
+                         FALSE)) {
+
+                        break;
+                    }
+
+                } else if ((Class->Name == NULL) &&
+                           (Class->Creator == Creator)) {
+
+                    break;
+                }
+            }
+
+            Class = Class->Next;
+        }
+
+        if (Class != NULL) {
+            if (NewClass != NULL) {
+                MmFreeNonPagedPool(NewClass);
+            }
+
+            return Class;
+        }
+
+        if (NewClass == NULL) {
+            NewClass = MmAllocateNonPagedPool(sizeof(KE_LOCK_CLASS),
+                                              LOCK_CLASS_TAG);
+
+            if (NewClass == NULL) {
+                return NULL;
+            }
+
+            RtlZeroMemory(NewClass, sizeof(KE_LOCK_CLASS));
+            NewClass->Type = Type;
+            NewClass->Name = Name;
+            NewClass->Creator = Creator;
+        }
+
+        NewClass->Next = Head;
+        RtlMemoryBarrier();
+        OldHead = RtlAtomicCompareExchange((PUINTN)&(KeLockClasses[Hash]),
+                                           (UINTN)NewClass,
+                                           (UINTN)Head);
+
+        if (OldHead == (UINTN)Head) {
+            break;
+        }
+    }
+
+    return NewClass;
+}
+
+VOID
+KepRecordLockAcquire (
+    PKE_LOCK_CLASS Class,
+    ULONGLONG WaitStart
+    )
+
+/*++
+
+Routine Description:
+
+    This routine accumulates statistics for a lock acquisition.
+
+Arguments:
+
+    Class - Supplies a pointer to the class of the acquired lock.
+
+    WaitStart - Supplies the time counter value when the acquire started
+        waiting, or 0 if the acquisition was not contended.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONGLONG WaitTime;
+
+    RtlAtomicAdd64((PULONGLONG)&(Class->AcquireCount), 1);
+    if (WaitStart != 0) {
+        WaitTime = HlQueryTimeCounter() - WaitStart;
+        RtlAtomicAdd64((PULONGLONG)&(Class->ContentionCount), 1);
+        RtlAtomicAdd64((PULONGLONG)&(Class->TotalWaitTime), WaitTime);
+        KepUpdateMaximum(&(Class->MaxWaitTime), WaitTime);
+    }
+
+    return;
+}
+
+VOID
+KepRecordLockRelease (
+    PKE_LOCK_CLASS Class,
+    ULONGLONG AcquireTime
+    )
+
+/*++
+
+Routine Description:
+
+    This routine accumulates the hold time of an exclusively held lock that is
+    being released.
+
+Arguments:
+
+    Class - Supplies a pointer to the class of the released lock.
+
+    AcquireTime - Supplies the time counter value when the lock was acquired.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONGLONG HoldTime;
+
+    HoldTime = HlQueryTimeCounter() - AcquireTime;
+    RtlAtomicAdd64((PULONGLONG)&(Class->TotalHoldTime), HoldTime);
+    KepUpdateMaximum(&(Class->MaxHoldTime), HoldTime);
+    return;
+}
+
+VOID
+KepRecordSpinLockContention (
+    PKSPIN_LOCK Lock,
+    ULONGLONG WaitStart
+    )
+
+/*++
+
+Routine Description:
+
+    This routine accumulates statistics for a contended spin lock acquisition.
+    Contention is tracked for a fixed number of distinct spin locks. Once the
+    table is full, additional locks go unrecorded.
+
+Arguments:
+
+    Lock - Supplies a pointer to the acquired spin lock.
+
+    WaitStart - Supplies the time counter value when the acquire started
+        spinning.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Index;
+    UINTN LockAddress;
+    UINTN OldValue;
+    ULONG Probe;
+    PSPIN_LOCK_STATISTIC Statistic;
+    ULONGLONG WaitTime;
+
+    WaitTime = HlQueryTimeCounter() - WaitStart;
+    LockAddress = (UINTN)Lock;
+    Index = (LockAddress >> 3) % SPIN_LOCK_STATISTICS_COUNT;
+    for (Probe = 0; Probe < SPIN_LOCK_STATISTICS_COUNT; Probe += 1) {
+        Statistic = &(KeSpinLockStatistics[Index]);
+        if (Statistic->Lock != LockAddress) {
+            OldValue = Statistic->Lock;
+            if (OldValue == 0) {
+                OldValue = RtlAtomicCompareExchange((PUINTN)&(Statistic->Lock),
+                                                    LockAddress,
+                                                    0);
+            }
+
+            if ((OldValue != 0) && (OldValue != LockAddress)) {
+                Index = (Index + 1) % SPIN_LOCK_STATISTICS_COUNT;
+                continue;
+            }
+        }
+
+        RtlAtomicAdd64((PULONGLONG)&(Statistic->ContentionCount), 1);
+        RtlAtomicAdd64((PULONGLONG)&(Statistic->TotalWaitTime), WaitTime);
+        KepUpdateMaximum(&(Statistic->MaxWaitTime), WaitTime);
+        break;
+    }
+
+    return;
+}
+
+VOID
+KepUpdateMaximum (
+    volatile ULONGLONG *Maximum,
+    ULONGLONG Value
+    )
+
+/*++
+
+Routine Description:
+
+    This routine atomically raises a maximum to the given value if the value
+    is larger.
+
+Arguments:
+
+    Maximum - Supplies a pointer to the maximum to update.
+
+    Value - Supplies the new value.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONGLONG Current;
+    ULONGLONG Previous;
+
+    Current = *Maximum;
+    while (Value > Current) {
+        Previous = RtlAtomicCompareExchange64((PULONGLONG)Maximum,
+                                              Value,
+                                              Current);
+
+        if (Previous == Current) {
+            break;
+        }
+
+        Current = Previous;
+    }
+
+    return;
+}
 
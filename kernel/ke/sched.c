@@ -281,6 +281,26 @@ Return Value:
     //
 
     SpCollectThreadStatistic(OldThread, Processor, Reason);
+    SpTrace(SpTraceEventContextSwitch, NextThread->ThreadId, Reason);
+    if (Reason == SchedulerReasonThreadBlocking) {
+        SpRecordThreadBlock(OldThread);
+    }
+
+    //
+    // Let the work queue know if one of its busy workers is blocking, so it
+    // can wake another worker to keep the work items moving. This may signal
+    // an event, which is why it happens after the scheduler lock is released.
+    //
+
+    if ((Reason == SchedulerReasonThreadBlocking) &&
+        (OldThread->WorkQueueWorker != NULL)) {
+
+        KepWorkerThreadBlocking(OldThread);
+    }
+
+    if (NextThread->WorkQueueWorker != NULL) {
+        KepWorkerThreadRunning(NextThread);
+    }
 
     ASSERT((NextThreadState == ThreadStateReady) ||
            (NextThreadState == ThreadStateFirstTime));
@@ -459,6 +479,10 @@ Return Value:
     ASSERT((Thread->State == ThreadStateWaking) ||
            (Thread->State == ThreadStateFirstTime));
 
+    SpTrace(SpTraceEventThreadWake,
+            Thread->ThreadId,
+            Thread->OwningProcess->Identifiers.ProcessId);
+
     OldRunLevel = KeRaiseRunLevel(RunLevelDispatch);
     GroupEntry = PARENT_STRUCTURE(Thread->SchedulerEntry.Parent,
                                   SCHEDULER_GROUP_ENTRY,
@@ -477,7 +501,9 @@ Return Value:
     // IPI.
     //
 
-    if (KeSchedulerStealReadyThreads != FALSE) {
+    if ((KeSchedulerStealReadyThreads != FALSE) &&
+        ((Thread->Flags & THREAD_FLAG_BOUND) == 0)) {
+
         ProcessorBlock = KeGetCurrentProcessorBlock();
         Group = GroupEntry->Group;
         if (Group == &KeRootSchedulerGroup) {
@@ -633,6 +659,70 @@ Return Value:
     return;
 }
 
+KSTATUS
+KeBindThreadToProcessor (
+    PKTHREAD Thread,
+    ULONG ProcessorNumber
+    )
+
+/*++
+
+Routine Description:
+
+    This routine binds a newly created thread to the given processor. The
+    thread will only ever run on that processor: it is neither stolen by other
+    processors when it becomes ready nor pulled away by idle balancing. This
+    routine must be called before the thread is made ready for the first time.
+
+Arguments:
+
+    Thread - Supplies a pointer to the thread to bind. The thread must have
+        been created with the bound thread flag.
+
+    ProcessorNumber - Supplies the zero-based number of the processor to bind
+        the thread to.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_INVALID_PARAMETER if the processor number is not valid.
+
+--*/
+
+{
+
+    PSCHEDULER_GROUP Group;
+    PSCHEDULER_GROUP_ENTRY GroupEntry;
+    PSCHEDULER_GROUP_ENTRY NewGroupEntry;
+
+    ASSERT(Thread->State == ThreadStateFirstTime);
+    ASSERT((Thread->Flags & THREAD_FLAG_BOUND) != 0);
+
+    if (ProcessorNumber >= KeGetActiveProcessorCount()) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    GroupEntry = PARENT_STRUCTURE(Thread->SchedulerEntry.Parent,
+                                  SCHEDULER_GROUP_ENTRY,
+                                  Entry);
+
+    Group = GroupEntry->Group;
+    if (Group == &KeRootSchedulerGroup) {
+        NewGroupEntry = &(KeProcessorBlocks[ProcessorNumber]->Scheduler.Group);
+
+    } else {
+        if (ProcessorNumber >= Group->EntryCount) {
+            return STATUS_INVALID_PARAMETER;
+        }
+
+        NewGroupEntry = &(Group->Entries[ProcessorNumber]);
+    }
+
+    Thread->SchedulerEntry.Parent = &(NewGroupEntry->Entry);
+    return STATUS_SUCCESS;
+}
+
 VOID
 KeIdleLoop (
     VOID
@@ -1143,8 +1233,9 @@ Routine Description:
     Scheduler - Supplies a pointer to the scheduler to work on.
 
     SkipRunning - Supplies a boolean indicating whether to ignore the first
-        thread on the queue if it's marked as running. This is used when trying
-        to steal threads from another scheduler.
+        thread on the queue if it's marked as running, as well as any threads
+        bound to the processor. This is used when trying to steal threads from
+        another scheduler.
 
 Return Value:
 
@@ -1178,7 +1269,8 @@ Return Value:
         if (Entry->Type == SchedulerEntryThread) {
             Thread = PARENT_STRUCTURE(Entry, KTHREAD, SchedulerEntry);
             if ((SkipRunning == FALSE) ||
-                (Thread->State != ThreadStateRunning)) {
+                ((Thread->State != ThreadStateRunning) &&
+                 ((Thread->Flags & THREAD_FLAG_BOUND) == 0))) {
 
                 return Thread;
             }
@@ -221,6 +221,13 @@ SYSTEM_CALL_TABLE_ENTRY KeSystemCallTable[SystemCallCount] = {
     {MmSysSetBreak,
         sizeof(SYSTEM_CALL_SET_BREAK),
         sizeof(SYSTEM_CALL_SET_BREAK)},
+    {IoSysIoRingEnter, sizeof(SYSTEM_CALL_IO_RING_ENTER), 0},
+    {IoSysSocketPerformBatchIo,
+        sizeof(SYSTEM_CALL_SOCKET_PERFORM_BATCH_IO),
+        0},
+    {IoSysSocketAcceptMultiple,
+        sizeof(SYSTEM_CALL_SOCKET_ACCEPT_MULTIPLE),
+        0},
 };
 
 //
@@ -63,6 +63,19 @@ Module Name:
 
 #define WORK_ITEM_FLAG_SUPPORT_DISPATCH_LEVEL 0x00000002
 
+//
+// Define the maximum number of worker threads a per-processor pool will
+// create. Additional workers are only created when the running workers block.
+//
+
+#define WORK_POOL_MAX_THREAD_COUNT 16
+
+//
+// Define how long a surplus idle worker waits for work before exiting.
+//
+
+#define WORK_POOL_IDLE_TIMEOUT (60 * MILLISECONDS_PER_SECOND)
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -71,47 +84,112 @@ Module Name:
 
 Structure Description:
 
-    This structure defines a work queue.
+    This structure defines a pool of worker threads servicing a work queue.
+    A pool tries to keep exactly one worker running at a time: an idle worker
+    is only woken if none of the pool's workers are running, either because
+    they are all idle or because they are all blocked.
 
 Members:
 
-    State - Stoers a pointer to the current work queue state.
+    Queue - Stores a pointer to the work queue that owns this pool.
 
     Lock - Stores either a pointer to a queued lock or a spin lock protecting
-        the work item list, depending on whether the queue needs to accept
-        work items at dispatch level.
+        the work item list and thread counts, depending on whether the queue
+        needs to accept work items at dispatch level.
 
     WorkItemListHead - Stores the head of the list of work items to execute.
 
     WorkItemCount - Stores the number of work items currently queued.
 
-    Event - Stores a pointer to the event used to kick the work item threads
+    Event - Stores a pointer to the event used to kick an idle worker thread
         into action.
 
-    Flags - Stores a bitfield of flags governing the behavior of the work
-        queue. See WORK_QUEUE_FLAG_* definitions.
+    Processor - Stores the processor number the pool's workers are bound to,
+        if the queue is per-processor.
 
-    CurrentThreadCount - Stores the number of threads that are alive and
-        processing (or waiting on) the work queue.
+    MaxThreadCount - Stores the maximum number of worker threads the pool can
+        have.
 
-    Name - Stores a pointer to a string containing the name of the worker
-        threads.
+    ThreadCount - Stores the number of worker threads the pool has, including
+        any that are still being created.
+
+    IdleThreadCount - Stores the number of worker threads waiting on the event.
+
+    RunningThreadCount - Stores the number of worker threads that are busy with
+        work and not blocked. This is modified by the scheduler, and so is
+        updated atomically rather than under the lock.
+
+    CreatedThreadCount - Stores the total number of worker threads ever
+        created for this pool.
+
+    QueuedCount - Stores the total number of work items queued to this pool.
+
+    StartedCount - Stores the total number of work items pulled off the list
+        by a worker.
+
+    TotalLatency - Stores the total time, in time counter ticks, work items
+        spent waiting on the list.
+
+    MaxLatency - Stores the longest time, in time counter ticks, a single work
+        item spent waiting on the list.
 
 --*/
 
-struct _WORK_QUEUE {
-    volatile WORK_QUEUE_STATE State;
+typedef struct _WORK_POOL {
+    PWORK_QUEUE Queue;
     union {
         PQUEUED_LOCK QueuedLock;
         KSPIN_LOCK SpinLock;
     } Lock;
 
     LIST_ENTRY WorkItemListHead;
-    UINTN WorkItemCount;
+    volatile UINTN WorkItemCount;
     PKEVENT Event;
+    ULONG Processor;
+    ULONG MaxThreadCount;
+    ULONG ThreadCount;
+    volatile ULONG IdleThreadCount;
+    volatile ULONG RunningThreadCount;
+    volatile ULONG CreatedThreadCount;
+    ULONGLONG QueuedCount;
+    ULONGLONG StartedCount;
+    ULONGLONG TotalLatency;
+    ULONGLONG MaxLatency;
+} WORK_POOL, *PWORK_POOL;
+
+/*++
+
+Structure Description:
+
+    This structure defines a work queue.
+
+Members:
+
+    State - Stoers a pointer to the current work queue state.
+
+    Flags - Stores a bitfield of flags governing the behavior of the work
+        queue. See WORK_QUEUE_FLAG_* definitions.
+
+    CurrentThreadCount - Stores the number of threads that are alive and
+        processing (or waiting on) the work queue across all pools.
+
+    Name - Stores a pointer to a string containing the name of the worker
+        threads.
+
+    PoolCount - Stores the number of elements in the pools array.
+
+    Pools - Stores a pointer to the array of worker pools. Per-processor
+        queues have one pool per processor, all other queues have exactly one.
+
+--*/
+
+struct _WORK_QUEUE {
+    volatile WORK_QUEUE_STATE State;
     ULONG Flags;
     volatile ULONG CurrentThreadCount;
     PSTR Name;
+    ULONG PoolCount;
+    PWORK_POOL Pools;
 };
 
 /*++
@@ -131,6 +209,11 @@ Structure Description:
     Queue - Stores a pointer to the queue this work item was or will be
         put on.
 
+    Pool - Stores a pointer to the pool of the queue the work item is
+        currently on, or NULL if the work item is not queued. Queuing
+        claims the work item by atomically setting this from NULL, since
+        different pools are guarded by different locks.
+
     Event - Stores a pointer to an event that is signaled when the work item
         completes.
 
@@ -143,25 +226,62 @@ Structure Description:
     Flags - Stores a pointer to internal flags used by the operating system.
         Do not modify these directly. See WORK_ITEM_FLAG_* definitions.
 
+    QueueTime - Stores the time counter value when the work item was queued.
+
 --*/
 
 struct _WORK_ITEM {
     LIST_ENTRY ListEntry;
     UINTN ReferenceCount;
     PWORK_QUEUE Queue;
+    volatile PWORK_POOL Pool;
     PKEVENT Event;
     PWORK_ITEM_ROUTINE Routine;
     PVOID Parameter;
     WORK_PRIORITY Priority;
     ULONG Flags;
+    ULONGLONG QueueTime;
 };
 
+/*++
+
+Structure Description:
+
+    This structure defines the state of a single worker thread. It lives on
+    the worker's stack, and the thread structure points at it so that the
+    scheduler can tell the pool when a busy worker blocks.
+
+Members:
+
+    Pool - Stores a pointer to the pool the worker belongs to.
+
+    Busy - Stores a boolean indicating whether the worker is processing work
+        items (and is therefore counted in the pool's running thread count
+        unless blocked).
+
+    Blocked - Stores a boolean indicating whether the worker was busy when it
+        blocked, and has been removed from the pool's running thread count.
+
+--*/
+
+typedef struct _WORK_QUEUE_WORKER {
+    PWORK_POOL Pool;
+    BOOL Busy;
+    BOOL Blocked;
+} WORK_QUEUE_WORKER, *PWORK_QUEUE_WORKER;
+
 //
 // ----------------------------------------------- Internal Function Prototypes
 //
 
 VOID
 KepWorkerThread (
+    PVOID Parameter
+    );
+
+KSTATUS
+KepCreateWorkerThread (
+    PWORK_POOL Pool
     );
 
 VOID
@@ -169,6 +289,23 @@ KepDestroyWorkQueue (
     PWORK_QUEUE Queue
     );
 
+VOID
+KepDestroyWorkPool (
+    PWORK_QUEUE Queue,
+    PWORK_POOL Pool
+    );
+
+RUNLEVEL
+KepAcquireWorkPoolLock (
+    PWORK_POOL Pool
+    );
+
+VOID
+KepReleaseWorkPoolLock (
+    PWORK_POOL Pool,
+    RUNLEVEL OldRunLevel
+    );
+
 VOID
 KepWorkItemAddReference (
     PWORK_ITEM WorkItem
@@ -226,9 +363,14 @@ Return Value:
 
 {
 
+    UINTN AllocationSize;
+    ULONG Index;
     ULONG NameSize;
     BOOL NonPaged;
+    PWORK_POOL Pool;
+    ULONG PoolCount;
     PWORK_QUEUE Queue;
+    UINTN QueueSize;
     KSTATUS Status;
 
     //
@@ -240,23 +382,29 @@ Return Value:
         NonPaged = TRUE;
     }
 
+    PoolCount = 1;
+    if ((Flags & WORK_QUEUE_FLAG_PER_PROCESSOR) != 0) {
+        PoolCount = KeGetActiveProcessorCount();
+    }
+
     //
-    // Create and initialize the work queue structure.
+    // Create and initialize the work queue structure and its pools. These
+    // are always allocated from non-paged pool because the scheduler looks at
+    // the pools when a worker blocks.
     //
 
-    if (NonPaged != FALSE) {
-        Queue = MmAllocateNonPagedPool(sizeof(WORK_QUEUE), KE_ALLOCATION_TAG);
-
-    } else {
-        Queue = MmAllocatePagedPool(sizeof(WORK_QUEUE), KE_ALLOCATION_TAG);
-    }
-
+    QueueSize = ALIGN_RANGE_UP(sizeof(WORK_QUEUE), sizeof(ULONGLONG));
+    AllocationSize = QueueSize + (PoolCount * sizeof(WORK_POOL));
+    Queue = MmAllocateNonPagedPool(AllocationSize, KE_ALLOCATION_TAG);
     if (Queue == NULL) {
         Status = STATUS_INSUFFICIENT_RESOURCES;
         goto CreateWorkQueueEnd;
     }
 
-    RtlZeroMemory(Queue, sizeof(WORK_QUEUE));
+    RtlZeroMemory(Queue, AllocationSize);
+    Queue->Flags = Flags;
+    Queue->PoolCount = PoolCount;
+    Queue->Pools = (PWORK_POOL)((PUCHAR)Queue + QueueSize);
 
     //
     // Create a copy of the name, if supplied.
@@ -273,34 +421,61 @@ Return Value:
         RtlStringCopy(Queue->Name, Name, NameSize);
     }
 
-    if (NonPaged != FALSE) {
-        KeInitializeSpinLock(&(Queue->Lock.SpinLock));
+    for (Index = 0; Index < PoolCount; Index += 1) {
+        Pool = &(Queue->Pools[Index]);
+        Pool->Queue = Queue;
+        Pool->Processor = Index;
+        Pool->MaxThreadCount = 1;
+        if ((Flags & WORK_QUEUE_FLAG_PER_PROCESSOR) != 0) {
+            Pool->MaxThreadCount = WORK_POOL_MAX_THREAD_COUNT;
+        }
 
-    } else {
-        Queue->Lock.QueuedLock = KeCreateQueuedLock();
-        if (Queue->Lock.QueuedLock == NULL) {
+        if (NonPaged != FALSE) {
+            KeInitializeSpinLock(&(Pool->Lock.SpinLock));
+
+        } else {
+            Pool->Lock.QueuedLock = KeCreateQueuedLock();
+            if (Pool->Lock.QueuedLock == NULL) {
+                Status = STATUS_INSUFFICIENT_RESOURCES;
+                goto CreateWorkQueueEnd;
+            }
+        }
+
+        INITIALIZE_LIST_HEAD(&(Pool->WorkItemListHead));
+        Pool->Event = KeCreateEvent(NULL);
+        if (Pool->Event == NULL) {
             Status = STATUS_INSUFFICIENT_RESOURCES;
             goto CreateWorkQueueEnd;
         }
     }
 
-    INITIALIZE_LIST_HEAD(&(Queue->WorkItemListHead));
-    Queue->Event = KeCreateEvent(NULL);
-    if (Queue->Event == NULL) {
-        Status = STATUS_INSUFFICIENT_RESOURCES;
-        goto CreateWorkQueueEnd;
-    }
-
-    Queue->Flags = Flags;
     Queue->State = WorkQueueStateOpen;
 
     //
-    // Create a worker thread.
+    // Create the first worker thread for each pool. If some processors cannot
+    // get a worker, shrink the queue down to the pools that have one.
     //
 
-    Status = PsCreateKernelThread(KepWorkerThread, Queue, Name);
-    if (!KSUCCESS(Status)) {
-        goto CreateWorkQueueEnd;
+    for (Index = 0; Index < PoolCount; Index += 1) {
+        Pool = &(Queue->Pools[Index]);
+        Pool->ThreadCount = 1;
+        Pool->IdleThreadCount = 1;
+        Status = KepCreateWorkerThread(Pool);
+        if (!KSUCCESS(Status)) {
+            Pool->ThreadCount = 0;
+            Pool->IdleThreadCount = 0;
+            if (Index == 0) {
+                goto CreateWorkQueueEnd;
+            }
+
+            Queue->PoolCount = Index;
+            while (Index < PoolCount) {
+                KepDestroyWorkPool(Queue, &(Queue->Pools[Index]));
+                Index += 1;
+            }
+
+            break;
+        }
     }
 
     Status = STATUS_SUCCESS;
@@ -308,27 +483,7 @@ Return Value:
 CreateWorkQueueEnd:
     if (!KSUCCESS(Status)) {
         if (Queue != NULL) {
-            if (Queue->Name != NULL) {
-                MmFreePagedPool(Queue->Name);
-            }
-
-            if (NonPaged == FALSE) {
-                if (Queue->Lock.QueuedLock != NULL) {
-                    KeDestroyQueuedLock(Queue->Lock.QueuedLock);
-                }
-            }
-
-            if (Queue->Event != NULL) {
-                KeDestroyEvent(Queue->Event);
-            }
-
-            if (NonPaged != FALSE) {
-                MmFreeNonPagedPool(Queue);
-
-            } else {
-                MmFreePagedPool(Queue);
-            }
-
+            KepDestroyWorkQueue(Queue);
             Queue = NULL;
         }
     }
@@ -362,6 +517,7 @@ Return Value:
 {
 
     BOOL DispatchLevel;
+    ULONG Index;
     RUNLEVEL OldRunLevel;
 
     OldRunLevel = RunLevelCount;
@@ -387,11 +543,14 @@ Return Value:
     // memory. The signal event routine must be called because the queues might
     // be asleep from inactivity. So move to this transitory state where the
     // queues know to stay awake but spin waiting for the state to move to
-    // destroying.
+    // destroying. The events are left signaled so that workers still being
+    // created also see the destruction.
     //
 
     WorkQueue->State = WorkQueueStateWakingForDestroying;
-    KeSignalEvent(WorkQueue->Event, SignalOptionSignalAll);
+    for (Index = 0; Index < WorkQueue->PoolCount; Index += 1) {
+        KeSignalEvent(WorkQueue->Pools[Index].Event, SignalOptionSignalAll);
+    }
 
     //
     // Now that all workers are awake and spinning, let them destroy themselves.
@@ -417,7 +576,8 @@ KeFlushWorkQueue (
 Routine Description:
 
     This routine flushes a work queue. If there are items on the work queue,
-    they will be completed before this routine returns.
+    they will be completed before this routine returns. For per-processor
+    queues, this waits for the last item queued on each processor's pool.
 
 Arguments:
 
@@ -431,13 +591,13 @@ Return Value:
 
 {
 
-    BOOL DispatchLevel;
+    ULONG Index;
     RUNLEVEL OldRunLevel;
+    PWORK_POOL Pool;
     PWORK_ITEM Sentinal;
 
     ASSERT(KeGetRunLevel() <= RunLevelDispatch);
 
-    OldRunLevel = RunLevelCount;
     if (WorkQueue == NULL) {
         WorkQueue = KeSystemWorkQueue;
     }
@@ -447,64 +607,35 @@ Return Value:
            (WorkQueue->State != WorkQueueStateDestroying) &&
            (WorkQueue->State != WorkQueueStateDestroyed));
 
-    DispatchLevel = FALSE;
-    if ((WorkQueue->Flags & WORK_QUEUE_FLAG_SUPPORT_DISPATCH_LEVEL) != 0) {
-        DispatchLevel = TRUE;
-    }
+    for (Index = 0; Index < WorkQueue->PoolCount; Index += 1) {
+        Pool = &(WorkQueue->Pools[Index]);
+        OldRunLevel = KepAcquireWorkPoolLock(Pool);
 
-    //
-    // Acquire the queue's lock at the appropriate run level.
-    //
-
-    if (DispatchLevel != FALSE) {
-        OldRunLevel = KeRaiseRunLevel(RunLevelDispatch);
-        KeAcquireSpinLock(&(WorkQueue->Lock.SpinLock));
-
-    } else {
-        KeAcquireQueuedLock(WorkQueue->Lock.QueuedLock);
-    }
-
-    //
-    // If the queue is empty, then there is no sentinal to record and no work
-    // to do.
-    //
+        //
+        // If the pool is empty, then there is no sentinal to record and no
+        // work to do. Otherwise, record the last item in the pool and hold a
+        // reference on it so it cannot be freed before it is waited on.
+        //
 
-    if (LIST_EMPTY(&(WorkQueue->WorkItemListHead)) != FALSE) {
         Sentinal = NULL;
+        if (LIST_EMPTY(&(Pool->WorkItemListHead)) == FALSE) {
+            Sentinal = LIST_VALUE(Pool->WorkItemListHead.Previous,
+                                  WORK_ITEM,
+                                  ListEntry);
 
-    //
-    // Otherwise, record the last item in the work queue and signal the worker
-    // threads.
-    //
-
-    } else {
-        Sentinal = (PWORK_ITEM)LIST_VALUE(WorkQueue->WorkItemListHead.Previous,
-                                          WORK_ITEM,
-                                          ListEntry);
-
-        ASSERT(Sentinal != NULL);
-
-        KeSignalEvent(WorkQueue->Event, SignalOptionSignalAll);
-    }
-
-    //
-    // Unlock the list to let work proceed.
-    //
-
-    if (DispatchLevel != FALSE) {
-        KeReleaseSpinLock(&(WorkQueue->Lock.SpinLock));
-        KeLowerRunLevel(OldRunLevel);
+            KepWorkItemAddReference(Sentinal);
+        }
 
-    } else {
-        KeReleaseQueuedLock(WorkQueue->Lock.QueuedLock);
-    }
+        KepReleaseWorkPoolLock(Pool, OldRunLevel);
 
-    //
-    // If there is a sentinal, wait on it to complete.
-    //
+        //
+        // If there is a sentinal, wait on it to complete.
+        //
 
-    if (Sentinal != NULL) {
-        KeWaitForEvent(Sentinal->Event, FALSE, WAIT_TIME_INDEFINITE);
+        if (Sentinal != NULL) {
+            KeWaitForEvent(Sentinal->Event, FALSE, WAIT_TIME_INDEFINITE);
+            KepWorkItemReleaseReference(Sentinal);
+        }
     }
 
     return;
@@ -695,13 +826,11 @@ Return Value:
 
 {
 
-    BOOL DispatchLevel;
     RUNLEVEL OldRunLevel;
+    PWORK_POOL Pool;
     PWORK_QUEUE Queue;
     KSTATUS Status;
 
-    OldRunLevel = RunLevelCount;
-
     ASSERT(KeGetRunLevel() <= RunLevelDispatch);
 
     //
@@ -729,33 +858,25 @@ Return Value:
     }
 
     //
-    // Determine whether or not to raise to dispatch level before acquiring
-    // the lock.
+    // Acquire the lock of the pool the work item was put on.
     //
 
-    DispatchLevel = FALSE;
-    if ((Queue->Flags & WORK_QUEUE_FLAG_SUPPORT_DISPATCH_LEVEL) != 0) {
-        DispatchLevel = TRUE;
+    Pool = WorkItem->Pool;
+    if (Pool == NULL) {
+        return STATUS_TOO_LATE;
     }
 
-    //
-    // Acquire the work queue lock.
-    //
-
-    if (DispatchLevel != FALSE) {
-        OldRunLevel = KeRaiseRunLevel(RunLevelDispatch);
-        KeAcquireSpinLock(&(Queue->Lock.SpinLock));
-
-    } else {
-        KeAcquireQueuedLock(Queue->Lock.QueuedLock);
-    }
+    OldRunLevel = KepAcquireWorkPoolLock(Pool);
 
     //
     // Now that the lock is held, check again to see if the work item was
-    // selected to run and pulled off the list.
+    // selected to run and pulled off the list. If it has since been queued
+    // again on another processor's pool, it ran, so the cancel is too late.
     //
 
-    if ((WorkItem->Flags & WORK_ITEM_FLAG_QUEUED) == 0) {
+    if (((WorkItem->Flags & WORK_ITEM_FLAG_QUEUED) == 0) ||
+        (WorkItem->Pool != Pool)) {
+
         WorkItem = NULL;
         Status = STATUS_TOO_LATE;
         goto CancelWorkItemEnd;
@@ -770,20 +891,14 @@ Return Value:
 
     LIST_REMOVE(&(WorkItem->ListEntry));
     WorkItem->ListEntry.Next = NULL;
-    Queue->WorkItemCount -= 1;
+    Pool->WorkItemCount -= 1;
     WorkItem->Flags &= ~WORK_ITEM_FLAG_QUEUED;
+    RtlAtomicExchange(&(WorkItem->Pool), (UINTN)NULL);
     KeSignalEvent(WorkItem->Event, SignalOptionSignalAll);
     Status = STATUS_SUCCESS;
 
 CancelWorkItemEnd:
-    if (DispatchLevel != FALSE) {
-        KeReleaseSpinLock(&(Queue->Lock.SpinLock));
-        KeLowerRunLevel(OldRunLevel);
-
-    } else {
-        KeReleaseQueuedLock(Queue->Lock.QueuedLock);
-    }
-
+    KepReleaseWorkPoolLock(Pool, OldRunLevel);
     if (WorkItem != NULL) {
         KepWorkItemReleaseReference(WorkItem);
     }
@@ -896,12 +1011,11 @@ Return Value:
 
 {
 
-    BOOL DispatchLevel;
     RUNLEVEL OldRunLevel;
+    PWORK_POOL Pool;
+    ULONG PoolIndex;
     PWORK_QUEUE Queue;
-    KSTATUS Status;
-
-    OldRunLevel = RunLevelCount;
+    BOOL SignalWorker;
 
     ASSERT(KeGetRunLevel() <= RunLevelDispatch);
 
@@ -921,38 +1035,32 @@ Return Value:
     }
 
     //
-    // Determine whether or not to raise to dispatch level before acquiring
-    // the lock.
+    // Per-processor queues run the work item on the processor that queued it,
+    // where whatever data it touches is most likely to still be in the cache.
     //
 
-    DispatchLevel = FALSE;
-    if ((Queue->Flags & WORK_QUEUE_FLAG_SUPPORT_DISPATCH_LEVEL) != 0) {
-        DispatchLevel = TRUE;
+    PoolIndex = 0;
+    if (Queue->PoolCount > 1) {
+        PoolIndex = KeGetCurrentProcessorNumber() % Queue->PoolCount;
     }
 
-    KepWorkItemAddReference(WorkItem);
+    Pool = &(Queue->Pools[PoolIndex]);
 
     //
-    // Acquire the work queue lock.
+    // Claim the work item. This cannot be done under the pool lock, since
+    // another processor may be queuing the same work item to its own pool
+    // under a different lock.
     //
 
-    if (DispatchLevel != FALSE) {
-        OldRunLevel = KeRaiseRunLevel(RunLevelDispatch);
-        KeAcquireSpinLock(&(Queue->Lock.SpinLock));
+    if (RtlAtomicCompareExchange(&(WorkItem->Pool), (UINTN)Pool, (UINTN)NULL) !=
+        (UINTN)NULL) {
 
-    } else {
-        KeAcquireQueuedLock(Queue->Lock.QueuedLock);
+        return STATUS_RESOURCE_IN_USE;
     }
 
-    //
-    // Now that the lock is held, check again to see if someone else snuck in
-    // and queued this work item.
-    //
-
-    if ((WorkItem->Flags & WORK_ITEM_FLAG_QUEUED) != 0) {
-        Status = STATUS_RESOURCE_IN_USE;
-        goto QueueWorkItemEnd;
-    }
+    SignalWorker = FALSE;
+    KepWorkItemAddReference(WorkItem);
+    OldRunLevel = KepAcquireWorkPoolLock(Pool);
 
     //
     // Mark the work item as having been queued now that the lock is held.
@@ -967,39 +1075,99 @@ Return Value:
     //
 
     if (WorkItem->Priority == WorkPriorityHigh) {
-        INSERT_AFTER(&(WorkItem->ListEntry), &(Queue->WorkItemListHead));
+        INSERT_AFTER(&(WorkItem->ListEntry), &(Pool->WorkItemListHead));
 
     } else {
-        INSERT_BEFORE(&(WorkItem->ListEntry), &(Queue->WorkItemListHead));
+        INSERT_BEFORE(&(WorkItem->ListEntry), &(Pool->WorkItemListHead));
     }
 
-    Queue->WorkItemCount += 1;
-    WorkItem = NULL;
-    Status = STATUS_SUCCESS;
+    WorkItem->QueueTime = HlQueryTimeCounter();
+    Pool->WorkItemCount += 1;
+    Pool->QueuedCount += 1;
 
-QueueWorkItemEnd:
-    if (DispatchLevel != FALSE) {
-        KeReleaseSpinLock(&(Queue->Lock.SpinLock));
-        KeLowerRunLevel(OldRunLevel);
+    //
+    // Only kick a worker if none are currently running. A running worker
+    // will get to this item before going idle. The barrier orders the list
+    // update with the read of the running count, which the scheduler changes
+    // without holding the lock.
+    //
 
-    } else {
-        KeReleaseQueuedLock(Queue->Lock.QueuedLock);
+    RtlMemoryBarrier();
+    if (Pool->RunningThreadCount == 0) {
+        SignalWorker = TRUE;
     }
 
-    if (KSUCCESS(Status)) {
+    KepReleaseWorkPoolLock(Pool, OldRunLevel);
+    if (SignalWorker != FALSE) {
+        KeSignalEvent(Pool->Event, SignalOptionSignalOne);
+    }
 
-        //
-        // Signal the event to kick off the worker threads.
-        //
+    return STATUS_SUCCESS;
+}
 
-        KeSignalEvent(Queue->Event, SignalOptionSignalAll);
+KERNEL_API
+KSTATUS
+KeGetWorkQueueStatistics (
+    PWORK_QUEUE WorkQueue,
+    PWORK_QUEUE_STATISTICS Statistics
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns a snapshot of the statistics for the given work queue.
+
+Arguments:
+
+    WorkQueue - Supplies a pointer to the work queue to query. Supply NULL to
+        query the system work queue.
+
+    Statistics - Supplies a pointer where the statistics will be returned.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_INVALID_PARAMETER if no work queue was supplied and the system work
+    queue does not exist yet.
+
+--*/
+
+{
+
+    ULONG Index;
+    RUNLEVEL OldRunLevel;
+    PWORK_POOL Pool;
+
+    ASSERT(KeGetRunLevel() <= RunLevelDispatch);
+
+    if (WorkQueue == NULL) {
+        WorkQueue = KeSystemWorkQueue;
+        if (WorkQueue == NULL) {
+            return STATUS_INVALID_PARAMETER;
+        }
     }
 
-    if (WorkItem != NULL) {
-        KepWorkItemReleaseReference(WorkItem);
+    RtlZeroMemory(Statistics, sizeof(WORK_QUEUE_STATISTICS));
+    Statistics->PoolCount = WorkQueue->PoolCount;
+    for (Index = 0; Index < WorkQueue->PoolCount; Index += 1) {
+        Pool = &(WorkQueue->Pools[Index]);
+        OldRunLevel = KepAcquireWorkPoolLock(Pool);
+        Statistics->ItemsQueued += Pool->QueuedCount;
+        Statistics->ItemsStarted += Pool->StartedCount;
+        Statistics->TotalLatency += Pool->TotalLatency;
+        if (Pool->MaxLatency > Statistics->MaxLatency) {
+            Statistics->MaxLatency = Pool->MaxLatency;
+        }
+
+        Statistics->ThreadCount += Pool->ThreadCount;
+        Statistics->IdleThreadCount += Pool->IdleThreadCount;
+        Statistics->CreatedThreadCount += Pool->CreatedThreadCount;
+        KepReleaseWorkPoolLock(Pool, OldRunLevel);
     }
 
-    return Status;
+    return STATUS_SUCCESS;
 }
 
 KERNEL_API
@@ -1107,6 +1275,109 @@ Return Value:
     return STATUS_SUCCESS;
 }
 
+VOID
+KepWorkerThreadBlocking (
+    PKTHREAD Thread
+    )
+
+/*++
+
+Routine Description:
+
+    This routine is called by the scheduler when a work queue worker thread
+    blocks. If the worker was busy and was the last running worker in its
+    pool, an idle worker is woken to keep processing the pool's work items.
+    This routine is called at dispatch level, after the scheduler has
+    released its lock but before it has switched away from the blocking
+    thread.
+
+Arguments:
+
+    Thread - Supplies a pointer to the worker thread that is blocking.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG OldRunningCount;
+    PWORK_POOL Pool;
+    PWORK_QUEUE_WORKER Worker;
+
+    Worker = Thread->WorkQueueWorker;
+    if (Worker->Busy == FALSE) {
+        return;
+    }
+
+    ASSERT(Worker->Blocked == FALSE);
+
+    Worker->Blocked = TRUE;
+    Pool = Worker->Pool;
+    OldRunningCount = RtlAtomicAdd32(&(Pool->RunningThreadCount), -1);
+
+    //
+    // Signaling the event from within the scheduler is safe. The wait code
+    // drops the blocking thread's wait block and object locks before calling
+    // the scheduler, and the scheduler has dropped its own lock by now, so
+    // signaling takes only the event's locks and the scheduler lock of the
+    // processor the idle worker is readied on, none of which are held here.
+    // The event cannot be one the blocking thread is waiting on, since busy
+    // workers never wait on it. Readying a thread never calls back into the
+    // scheduler at dispatch level, so this cannot recurse. The pool lock is
+    // deliberately not taken, since a worker may block waiting for it. The
+    // counts are only a hint: if no idle worker is woken here, the blocked
+    // worker picks up the remaining work items itself once it runs again.
+    //
+
+    if ((OldRunningCount == 1) &&
+        (Pool->WorkItemCount != 0) &&
+        (Pool->IdleThreadCount != 0)) {
+
+        KeSignalEvent(Pool->Event, SignalOptionSignalOne);
+    }
+
+    return;
+}
+
+VOID
+KepWorkerThreadRunning (
+    PKTHREAD Thread
+    )
+
+/*++
+
+Routine Description:
+
+    This routine is called by the scheduler when a work queue worker thread is
+    about to run. If the worker blocked while busy, it is counted as running
+    again. This routine is called at dispatch level.
+
+Arguments:
+
+    Thread - Supplies a pointer to the worker thread that is about to run.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PWORK_QUEUE_WORKER Worker;
+
+    Worker = Thread->WorkQueueWorker;
+    if (Worker->Blocked != FALSE) {
+        Worker->Blocked = FALSE;
+        RtlAtomicAdd32(&(Worker->Pool->RunningThreadCount), 1);
+    }
+
+    return;
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
@@ -1120,98 +1391,145 @@ KepWorkerThread (
 
 Routine Description:
 
-    This routine processes work items off of a work queue.
+    This routine processes work items off of a work pool.
 
 Arguments:
 
     Parameter - Supplies a pointer to a parameter that in this case contains a
-        pointer to the work queue to service.
+        pointer to the work pool to service.
 
 Return Value:
 
-    None. Does not return.
+    None.
 
 --*/
 
 {
 
+    ULONGLONG Latency;
     RUNLEVEL OldRunLevel;
+    PWORK_POOL Pool;
     PWORK_QUEUE Queue;
-    BOOL RaiseToDispatch;
+    BOOL Reap;
     ULONG RemainingThreads;
+    BOOL SpawnWorker;
+    KSTATUS Status;
+    PKTHREAD Thread;
+    ULONG Timeout;
     PWORK_ITEM WorkItem;
+    WORK_QUEUE_WORKER Worker;
+
+    Pool = (PWORK_POOL)Parameter;
+    Queue = Pool->Queue;
+    Worker.Pool = Pool;
+    Worker.Busy = FALSE;
+    Worker.Blocked = FALSE;
+    Thread = KeGetCurrentThread();
+    Thread->WorkQueueWorker = &Worker;
+    while (TRUE) {
 
-    OldRunLevel = RunLevelCount;
-    Queue = (PWORK_QUEUE)Parameter;
-    RtlAtomicAdd32(&(Queue->CurrentThreadCount), 1);
-    RaiseToDispatch = FALSE;
-    if ((Queue->Flags & WORK_QUEUE_FLAG_SUPPORT_DISPATCH_LEVEL) != 0) {
-        RaiseToDispatch = TRUE;
-    }
+        //
+        // Wait to be kicked. Surplus workers exit if no work shows up for a
+        // while, but the pool always keeps at least one idle worker around.
+        //
 
-    while (TRUE) {
+        Timeout = WAIT_TIME_INDEFINITE;
+        if (Pool->ThreadCount > 1) {
+            Timeout = WORK_POOL_IDLE_TIMEOUT;
+        }
+
+        Status = KeWaitForEvent(Pool->Event, FALSE, Timeout);
+        Reap = FALSE;
+        SpawnWorker = FALSE;
+        OldRunLevel = KepAcquireWorkPoolLock(Pool);
+        Pool->IdleThreadCount -= 1;
+        if ((Status == STATUS_TIMEOUT) &&
+            (Queue->State == WorkQueueStateOpen) &&
+            (Pool->IdleThreadCount != 0) &&
+            (LIST_EMPTY(&(Pool->WorkItemListHead)) != FALSE)) {
+
+            Pool->ThreadCount -= 1;
+            Reap = TRUE;
 
         //
-        // Wait for the event, then process work items until none are left.
+        // Become busy. If that leaves the pool without an idle worker, create
+        // a reserve worker that can take over if this one blocks.
         //
 
-        KeWaitForEvent(Queue->Event, FALSE, WAIT_TIME_INDEFINITE);
-        while (TRUE) {
-            WorkItem = NULL;
-            if (RaiseToDispatch != FALSE) {
-                OldRunLevel = KeRaiseRunLevel(RunLevelDispatch);
-                KeAcquireSpinLock(&(Queue->Lock.SpinLock));
+        } else {
+            RtlAtomicAdd32(&(Pool->RunningThreadCount), 1);
+            Worker.Busy = TRUE;
+            if ((Pool->IdleThreadCount == 0) &&
+                (Pool->ThreadCount < Pool->MaxThreadCount) &&
+                (Queue->State == WorkQueueStateOpen)) {
+
+                Pool->ThreadCount += 1;
+                Pool->IdleThreadCount += 1;
+                SpawnWorker = TRUE;
+            }
+        }
 
-            } else {
-                KeAcquireQueuedLock(Queue->Lock.QueuedLock);
+        KepReleaseWorkPoolLock(Pool, OldRunLevel);
+        if (Reap != FALSE) {
+            break;
+        }
+
+        if (SpawnWorker != FALSE) {
+            Status = KepCreateWorkerThread(Pool);
+            if (!KSUCCESS(Status)) {
+                OldRunLevel = KepAcquireWorkPoolLock(Pool);
+                Pool->ThreadCount -= 1;
+                Pool->IdleThreadCount -= 1;
+                KepReleaseWorkPoolLock(Pool, OldRunLevel);
             }
+        }
+
+        //
+        // Process work items until none are left or the queue is paused, then
+        // go back to being idle.
+        //
+
+        while (TRUE) {
+            WorkItem = NULL;
+            OldRunLevel = KepAcquireWorkPoolLock(Pool);
+            if ((Queue->State != WorkQueueStatePaused) &&
+                (LIST_EMPTY(&(Pool->WorkItemListHead)) == FALSE)) {
 
-            if (LIST_EMPTY(&(Queue->WorkItemListHead)) == FALSE) {
-                WorkItem = LIST_VALUE(Queue->WorkItemListHead.Next,
+                WorkItem = LIST_VALUE(Pool->WorkItemListHead.Next,
                                       WORK_ITEM,
                                       ListEntry);
 
                 LIST_REMOVE(&(WorkItem->ListEntry));
                 WorkItem->ListEntry.Next = NULL;
-                Queue->WorkItemCount -= 1;
+                Pool->WorkItemCount -= 1;
                 WorkItem->Flags &= ~WORK_ITEM_FLAG_QUEUED;
+                RtlAtomicExchange(&(WorkItem->Pool), (UINTN)NULL);
+                Latency = HlQueryTimeCounter() - WorkItem->QueueTime;
+                Pool->StartedCount += 1;
+                Pool->TotalLatency += Latency;
+                if (Latency > Pool->MaxLatency) {
+                    Pool->MaxLatency = Latency;
+                }
 
             } else {
-                KeSignalEvent(Queue->Event, SignalOptionUnsignal);
-            }
-
-            if (RaiseToDispatch != FALSE) {
-                KeReleaseSpinLock(&(Queue->Lock.SpinLock));
-                KeLowerRunLevel(OldRunLevel);
-
-            } else {
-                KeReleaseQueuedLock(Queue->Lock.QueuedLock);
+                Worker.Busy = FALSE;
+                RtlAtomicAdd32(&(Pool->RunningThreadCount), -1);
+                Pool->IdleThreadCount += 1;
             }
 
-            //
-            // If there is a work item, execute it.
-            //
-
-            if (WorkItem != NULL) {
-                WorkItem->Routine(WorkItem->Parameter);
-                KeSignalEvent(WorkItem->Event, SignalOptionSignalAll);
-                KepWorkItemReleaseReference(WorkItem);
+            KepReleaseWorkPoolLock(Pool, OldRunLevel);
 
             //
             // If there was no work item, stop looking.
             //
 
-            } else {
+            if (WorkItem == NULL) {
                 break;
             }
 
-            //
-            // If the work queue became paused, stop processing events.
-            //
-
-            if (Queue->State == WorkQueueStatePaused) {
-                break;
-            }
+            WorkItem->Routine(WorkItem->Parameter);
+            KeSignalEvent(WorkItem->Event, SignalOptionSignalAll);
+            KepWorkItemReleaseReference(WorkItem);
         }
 
         //
@@ -1225,24 +1543,96 @@ Return Value:
         }
 
         if (Queue->State == WorkQueueStateDestroying) {
-            RemainingThreads = RtlAtomicAdd32(&(Queue->CurrentThreadCount), -1);
+            OldRunLevel = KepAcquireWorkPoolLock(Pool);
+            Pool->IdleThreadCount -= 1;
+            Pool->ThreadCount -= 1;
+            KepReleaseWorkPoolLock(Pool, OldRunLevel);
+            break;
+        }
+    }
 
-            //
-            // If this is the last thread standing, turn out the lights by
-            // destroying the work queue.
-            //
+    Thread->WorkQueueWorker = NULL;
+    RemainingThreads = RtlAtomicAdd32(&(Queue->CurrentThreadCount), -1);
 
-            if (RemainingThreads == 1) {
-                Queue->State = WorkQueueStateDestroyed;
-                KepDestroyWorkQueue(Queue);
-                break;
-            }
+    //
+    // If this is the last thread standing, turn out the lights by destroying
+    // the work queue. This only happens once the queue is being destroyed,
+    // since otherwise every pool keeps an idle worker around.
+    //
+
+    if (RemainingThreads == 1) {
+        while (Queue->State == WorkQueueStateWakingForDestroying) {
+            KeYield();
         }
+
+        ASSERT(Queue->State == WorkQueueStateDestroying);
+
+        Queue->State = WorkQueueStateDestroyed;
+        KepDestroyWorkQueue(Queue);
     }
 
     return;
 }
 
+KSTATUS
+KepCreateWorkerThread (
+    PWORK_POOL Pool
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates a new worker thread for the given pool. The caller
+    must have already accounted for the thread in the pool's thread and idle
+    thread counts.
+
+Arguments:
+
+    Pool - Supplies a pointer to the pool the worker thread will service.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    THREAD_CREATION_PARAMETERS Parameters;
+    PWORK_QUEUE Queue;
+    KSTATUS Status;
+
+    Queue = Pool->Queue;
+    RtlZeroMemory(&Parameters, sizeof(THREAD_CREATION_PARAMETERS));
+    if (Queue->Name != NULL) {
+        Parameters.Name = Queue->Name;
+        Parameters.NameSize = RtlStringLength(Queue->Name) + 1;
+    }
+
+    Parameters.ThreadRoutine = KepWorkerThread;
+    Parameters.Parameter = Pool;
+    if ((Queue->Flags & WORK_QUEUE_FLAG_PER_PROCESSOR) != 0) {
+        Parameters.Flags = THREAD_FLAG_BOUND;
+        Parameters.Processor = Pool->Processor;
+    }
+
+    //
+    // Count the thread before it exists so that the queue cannot be destroyed
+    // out from under it before it starts running.
+    //
+
+    RtlAtomicAdd32(&(Queue->CurrentThreadCount), 1);
+    Status = PsCreateThread(&Parameters);
+    if (!KSUCCESS(Status)) {
+        RtlAtomicAdd32(&(Queue->CurrentThreadCount), -1);
+        return Status;
+    }
+
+    RtlAtomicAdd32(&(Pool->CreatedThreadCount), 1);
+    return STATUS_SUCCESS;
+}
+
 VOID
 KepDestroyWorkQueue (
     PWORK_QUEUE Queue
@@ -1267,32 +1657,135 @@ Return Value:
 
 {
 
-    BOOL NonPaged;
+    ULONG Index;
 
     ASSERT(Queue->CurrentThreadCount == 0);
 
-    NonPaged = FALSE;
-    if ((Queue->Flags & WORK_QUEUE_FLAG_SUPPORT_DISPATCH_LEVEL) != 0) {
-        NonPaged = TRUE;
-    }
-
     if (Queue->Name != NULL) {
         MmFreePagedPool(Queue->Name);
     }
 
-    if ((NonPaged != FALSE) && (Queue->Lock.QueuedLock != NULL)) {
-        KeDestroyQueuedLock(Queue->Lock.QueuedLock);
+    for (Index = 0; Index < Queue->PoolCount; Index += 1) {
+        KepDestroyWorkPool(Queue, &(Queue->Pools[Index]));
     }
 
-    if (Queue->Event != NULL) {
-        KeDestroyEvent(Queue->Event);
+    MmFreeNonPagedPool(Queue);
+    return;
+}
+
+VOID
+KepDestroyWorkPool (
+    PWORK_QUEUE Queue,
+    PWORK_POOL Pool
+    )
+
+/*++
+
+Routine Description:
+
+    This routine destroys the resources of a work pool. The pool itself is
+    freed along with its queue.
+
+Arguments:
+
+    Queue - Supplies a pointer to the queue that owns the pool.
+
+    Pool - Supplies a pointer to the pool to destroy.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if (((Queue->Flags & WORK_QUEUE_FLAG_SUPPORT_DISPATCH_LEVEL) == 0) &&
+        (Pool->Lock.QueuedLock != NULL)) {
+
+        KeDestroyQueuedLock(Pool->Lock.QueuedLock);
+        Pool->Lock.QueuedLock = NULL;
     }
 
-    if (NonPaged != FALSE) {
-        MmFreeNonPagedPool(Queue);
+    if (Pool->Event != NULL) {
+        KeDestroyEvent(Pool->Event);
+        Pool->Event = NULL;
+    }
+
+    return;
+}
+
+RUNLEVEL
+KepAcquireWorkPoolLock (
+    PWORK_POOL Pool
+    )
+
+/*++
+
+Routine Description:
+
+    This routine acquires the lock of a work pool, raising to dispatch level
+    first if the queue supports dispatch level.
+
+Arguments:
+
+    Pool - Supplies a pointer to the pool to lock.
+
+Return Value:
+
+    Returns the original run level, which must be passed in when releasing the
+    lock.
+
+--*/
+
+{
+
+    RUNLEVEL OldRunLevel;
+
+    OldRunLevel = RunLevelCount;
+    if ((Pool->Queue->Flags & WORK_QUEUE_FLAG_SUPPORT_DISPATCH_LEVEL) != 0) {
+        OldRunLevel = KeRaiseRunLevel(RunLevelDispatch);
+        KeAcquireSpinLock(&(Pool->Lock.SpinLock));
+
+    } else {
+        KeAcquireQueuedLock(Pool->Lock.QueuedLock);
+    }
+
+    return OldRunLevel;
+}
+
+VOID
+KepReleaseWorkPoolLock (
+    PWORK_POOL Pool,
+    RUNLEVEL OldRunLevel
+    )
+
+/*++
+
+Routine Description:
+
+    This routine releases the lock of a work pool.
+
+Arguments:
+
+    Pool - Supplies a pointer to the pool to unlock.
+
+    OldRunLevel - Supplies the run level returned when the lock was acquired.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if ((Pool->Queue->Flags & WORK_QUEUE_FLAG_SUPPORT_DISPATCH_LEVEL) != 0) {
+        KeReleaseSpinLock(&(Pool->Lock.SpinLock));
+        KeLowerRunLevel(OldRunLevel);
 
     } else {
-        MmFreePagedPool(Queue);
+        KeReleaseQueuedLock(Pool->Lock.QueuedLock);
     }
 
     return;
@@ -1897,6 +1897,38 @@ Return Value:
     return PhysicalAddress;
 }
 
+BOOL
+MmpCheckAndClearPageAccessed (
+    PADDRESS_SPACE AddressSpace,
+    PVOID VirtualAddress
+    )
+
+/*++
+
+Routine Description:
+
+    This routine checks and clears the hardware accessed bit in the page table
+    entry for the given virtual address. The access flag is not enabled on
+    ARM, so pages age purely by their position on the page lists.
+
+Arguments:
+
+    AddressSpace - Supplies a pointer to the address space that owns the
+        virtual address.
+
+    VirtualAddress - Supplies the virtual address of the page to check.
+
+Return Value:
+
+    FALSE always, as accesses are not tracked.
+
+--*/
+
+{
+
+    return FALSE;
+}
+
 VOID
 MmpUnmapPageInOtherProcess (
     PADDRESS_SPACE AddressSpace,
@@ -51,6 +51,8 @@ function build() {
         "iobuf.c",
         "load.c",
         "mdl.c",
+        "objcache.c",
+        "compswap.c",
         "paging.c",
         "physical.c",
         "kpools.c",
@@ -0,0 +1,1376 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    compswap.c
+
+Abstract:
+
+    This module implements the compressed swap store, an in-memory tier that
+    sits in front of the page files. Pages headed for a page file are
+    compressed into a preallocated non-paged arena, and only the coldest
+    compressed pages are written out to the page file itself.
+
+Author:
+
+    agent 19-Oct-2026
+
+Environment:
+
+    Kernel
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <minoca/kernel/kernel.h>
+#include "mmp.h"
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+#define COMPRESSED_SWAP_ALLOCATION_TAG 0x77536D4D // 'wSmM'
+
+//
+// Define the size of each chunk of the compressed swap arena, and the
+// granularity at which compressed pages are carved out of a chunk.
+//
+
+#define COMPRESSED_SWAP_CHUNK_SIZE 0x10000
+#define COMPRESSED_SWAP_GRANULE_SHIFT 6
+#define COMPRESSED_SWAP_GRANULE_SIZE (1 << COMPRESSED_SWAP_GRANULE_SHIFT)
+#define COMPRESSED_SWAP_GRANULE_COUNT \
+    (COMPRESSED_SWAP_CHUNK_SIZE >> COMPRESSED_SWAP_GRANULE_SHIFT)
+
+#define COMPRESSED_SWAP_BITMAP_SIZE (COMPRESSED_SWAP_GRANULE_COUNT / 32)
+
+//
+// Define the default size of the compressed swap store as a percentage of
+// physical memory.
+//
+
+#define COMPRESSED_SWAP_DEFAULT_PERCENT 6
+
+//
+// Define the largest compressed page worth keeping, as a percentage of the
+// page size. Pages that do not compress at least this well go straight to the
+// page file.
+//
+
+#define COMPRESSED_SWAP_MAX_SIZE_PERCENT 75
+
+//
+// Define the parameters of the LZSS codec. A match is encoded in two bytes as
+// a 12-bit backwards distance and a 4-bit length.
+//
+
+#define LZSS_HASH_SHIFT 12
+#define LZSS_HASH_SIZE (1 << LZSS_HASH_SHIFT)
+#define LZSS_HASH_EMPTY 0xFFFF
+#define LZSS_MAX_DISTANCE 4096
+#define LZSS_MIN_MATCH 3
+#define LZSS_MAX_MATCH (LZSS_MIN_MATCH + 15)
+
+#define LZSS_HASH(_Bytes)                                       \
+    ((ULONG)(((ULONG)(_Bytes)[0] | ((ULONG)(_Bytes)[1] << 8) |  \
+              ((ULONG)(_Bytes)[2] << 16)) * 0x9E3779B1U) >>     \
+     (32 - LZSS_HASH_SHIFT))
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+/*++
+
+Structure Description:
+
+    This structure defines a chunk of the compressed swap arena.
+
+Members:
+
+    ListEntry - Stores pointers to the next and previous chunks in the arena.
+
+    FreeGranules - Stores the number of free granules in the chunk.
+
+    Data - Stores a pointer to the granules of the chunk.
+
+    Bitmap - Stores the bitmap of allocated granules.
+
+--*/
+
+typedef struct _COMPRESSED_SWAP_CHUNK {
+    LIST_ENTRY ListEntry;
+    ULONG FreeGranules;
+    PUCHAR Data;
+    ULONG Bitmap[COMPRESSED_SWAP_BITMAP_SIZE];
+} COMPRESSED_SWAP_CHUNK, *PCOMPRESSED_SWAP_CHUNK;
+
+/*++
+
+Structure Description:
+
+    This structure defines a compressed page. It sits at the start of its run
+    of granules, and the compressed data immediately follows it.
+
+Members:
+
+    TreeNode - Stores the node in the tree of compressed pages, keyed by page
+        file and page index.
+
+    ListEntry - Stores pointers to the next and previous compressed pages, in
+        the order they were stored.
+
+    PageFile - Stores the page file the page belongs to.
+
+    PageIndex - Stores the index of the page within the page file.
+
+    Chunk - Stores a pointer to the chunk holding the page.
+
+    GranuleIndex - Stores the index of the first granule of the page.
+
+    GranuleCount - Stores the number of granules the page occupies, including
+        this header.
+
+    CompressedSize - Stores the size of the compressed data, in bytes.
+
+--*/
+
+typedef struct _COMPRESSED_SWAP_ENTRY {
+    RED_BLACK_TREE_NODE TreeNode;
+    LIST_ENTRY ListEntry;
+    PVOID PageFile;
+    UINTN PageIndex;
+    PCOMPRESSED_SWAP_CHUNK Chunk;
+    ULONG GranuleIndex;
+    ULONG GranuleCount;
+    ULONG CompressedSize;
+} COMPRESSED_SWAP_ENTRY, *PCOMPRESSED_SWAP_ENTRY;
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+KSTATUS
+MmpReserveCompressedSwap (
+    VOID
+    );
+
+BOOL
+MmpSpillCompressedSwapEntry (
+    VOID
+    );
+
+PCOMPRESSED_SWAP_ENTRY
+MmpFindCompressedSwapEntry (
+    PVOID PageFile,
+    UINTN PageIndex
+    );
+
+PCOMPRESSED_SWAP_ENTRY
+MmpAllocateCompressedSwapEntry (
+    ULONG GranuleCount
+    );
+
+VOID
+MmpDestroyCompressedSwapEntry (
+    PCOMPRESSED_SWAP_ENTRY Entry
+    );
+
+COMPARISON_RESULT
+MmpCompareCompressedSwapEntries (
+    PRED_BLACK_TREE Tree,
+    PRED_BLACK_TREE_NODE FirstNode,
+    PRED_BLACK_TREE_NODE SecondNode
+    );
+
+ULONG
+MmpLzssCompress (
+    PUCHAR Input,
+    ULONG InputSize,
+    PUCHAR Output,
+    ULONG OutputSize,
+    PUSHORT HashTable
+    );
+
+BOOL
+MmpLzssDecompress (
+    PUCHAR Input,
+    ULONG InputSize,
+    PUCHAR Output,
+    ULONG OutputSize
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// Store the lock protecting the compressed swap store, the tree of stored
+// pages, and the list of stored pages from oldest to newest.
+//
+
+PQUEUED_LOCK MmCompressedSwapLock;
+RED_BLACK_TREE MmCompressedSwapTree;
+LIST_ENTRY MmCompressedSwapList;
+
+//
+// Store the list of arena chunks and the number of them.
+//
+
+LIST_ENTRY MmCompressedSwapChunkList;
+UINTN MmCompressedSwapChunkCount;
+
+//
+// Store the maximum number of arena bytes the store may use, the number of
+// arena bytes in use, the number of pages stored, and the total size of
+// their compressed data.
+//
+
+UINTN MmCompressedSwapLimit;
+UINTN MmCompressedSwapUsed;
+volatile UINTN MmCompressedSwapPages;
+UINTN MmCompressedSwapSize;
+
+//
+// Store the scratch buffers used to compress and decompress pages. These are
+// allocated up front since the paging thread cannot allocate memory.
+//
+
+PIO_BUFFER MmCompressedSwapPageBuffer;
+PUCHAR MmCompressedSwapPage;
+PUCHAR MmCompressedSwapOutput;
+PUSHORT MmCompressedSwapHashTable;
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+KSTATUS
+MmpInitializeCompressedSwap (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine initializes the compressed swap store. The store's arena is
+    not allocated until a page file arrives.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    ULONGLONG Limit;
+
+    MmCompressedSwapLock = KeCreateQueuedLock();
+    if (MmCompressedSwapLock == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    RtlRedBlackTreeInitialize(&MmCompressedSwapTree,
+                              0,
+                              MmpCompareCompressedSwapEntries);
+
+    INITIALIZE_LIST_HEAD(&MmCompressedSwapList);
+    INITIALIZE_LIST_HEAD(&MmCompressedSwapChunkList);
+    Limit = (ULONGLONG)MmTotalPhysicalPages << MmPageShift();
+    Limit = Limit * COMPRESSED_SWAP_DEFAULT_PERCENT / 100;
+    Limit = ALIGN_RANGE_DOWN(Limit, COMPRESSED_SWAP_CHUNK_SIZE);
+    if (Limit > MAX_UINTN) {
+        Limit = ALIGN_RANGE_DOWN(MAX_UINTN, COMPRESSED_SWAP_CHUNK_SIZE);
+    }
+
+    MmCompressedSwapLimit = (UINTN)Limit;
+    return STATUS_SUCCESS;
+}
+
+KSTATUS
+MmpActivateCompressedSwap (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine allocates the compressed swap store's scratch buffers and
+    arena. It is called when a page file arrives, and must not be called from
+    the paging thread.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    KSTATUS Status;
+
+    ASSERT(KeGetRunLevel() == RunLevelLow);
+    ASSERT(KeGetCurrentThread() != MmPagingThread);
+
+    KeAcquireQueuedLock(MmCompressedSwapLock);
+    Status = MmpReserveCompressedSwap();
+    KeReleaseQueuedLock(MmCompressedSwapLock);
+    return Status;
+}
+
+BOOL
+MmpIsCompressedSwapActive (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines whether the compressed swap store may hold pages.
+    This is checked without the store's lock, so it is only a hint.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    TRUE if pages may be stored in or loaded from the compressed swap store.
+
+    FALSE if the compressed swap store is not in use.
+
+--*/
+
+{
+
+    if (MmCompressedSwapPage == NULL) {
+        return FALSE;
+    }
+
+    if ((MmCompressedSwapLimit == 0) && (MmCompressedSwapPages == 0)) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+BOOL
+MmpCompressedSwapStore (
+    PVOID PageFile,
+    UINTN PageIndex,
+    PIO_BUFFER IoBuffer,
+    UINTN BufferOffset
+    )
+
+/*++
+
+Routine Description:
+
+    This routine attempts to store a page bound for the page file in the
+    compressed swap store. Any previously stored copy of the page is discarded
+    either way, and older pages may be written out to the page file to make
+    room.
+
+Arguments:
+
+    PageFile - Supplies a pointer to the page file the page is bound for.
+
+    PageIndex - Supplies the index of the page within the page file.
+
+    IoBuffer - Supplies a pointer to the mapped I/O buffer holding the page.
+
+    BufferOffset - Supplies the offset from the I/O buffer's current offset
+        where the page begins.
+
+Return Value:
+
+    TRUE if the page was stored and does not need to be written to the page
+    file.
+
+    FALSE if the page must be written to the page file.
+
+--*/
+
+{
+
+    ULONG CompressedSize;
+    PCOMPRESSED_SWAP_ENTRY Entry;
+    ULONG GranuleCount;
+    ULONG PageSize;
+    KSTATUS Status;
+    BOOL Stored;
+
+    Stored = FALSE;
+    PageSize = MmPageSize();
+    KeAcquireQueuedLock(MmCompressedSwapLock);
+    Entry = MmpFindCompressedSwapEntry(PageFile, PageIndex);
+    if (Entry != NULL) {
+        MmpDestroyCompressedSwapEntry(Entry);
+    }
+
+    if ((MmCompressedSwapPage == NULL) || (MmCompressedSwapLimit == 0)) {
+        goto CompressedSwapStoreEnd;
+    }
+
+    Status = MmCopyIoBufferData(IoBuffer,
+                                MmCompressedSwapPage,
+                                BufferOffset,
+                                PageSize,
+                                FALSE);
+
+    if (!KSUCCESS(Status)) {
+        goto CompressedSwapStoreEnd;
+    }
+
+    CompressedSize = MmpLzssCompress(
+                             MmCompressedSwapPage,
+                             PageSize,
+                             MmCompressedSwapOutput,
+                             PageSize * COMPRESSED_SWAP_MAX_SIZE_PERCENT / 100,
+                             MmCompressedSwapHashTable);
+
+    if (CompressedSize == 0) {
+        goto CompressedSwapStoreEnd;
+    }
+
+    GranuleCount = ALIGN_RANGE_UP(sizeof(COMPRESSED_SWAP_ENTRY) +
+                                  CompressedSize,
+                                  COMPRESSED_SWAP_GRANULE_SIZE) >>
+                   COMPRESSED_SWAP_GRANULE_SHIFT;
+
+    //
+    // Make room by writing the oldest pages out to the page file until the
+    // new page fits under the limit and in the arena.
+    //
+
+    while (TRUE) {
+        if (MmCompressedSwapUsed +
+            (GranuleCount << COMPRESSED_SWAP_GRANULE_SHIFT) <=
+            MmCompressedSwapLimit) {
+
+            Entry = MmpAllocateCompressedSwapEntry(GranuleCount);
+            if (Entry != NULL) {
+                break;
+            }
+        }
+
+        if (MmpSpillCompressedSwapEntry() == FALSE) {
+            goto CompressedSwapStoreEnd;
+        }
+    }
+
+    Entry->PageFile = PageFile;
+    Entry->PageIndex = PageIndex;
+    Entry->CompressedSize = CompressedSize;
+    RtlCopyMemory(Entry + 1, MmCompressedSwapOutput, CompressedSize);
+    RtlRedBlackTreeInsert(&MmCompressedSwapTree, &(Entry->TreeNode));
+    INSERT_BEFORE(&(Entry->ListEntry), &MmCompressedSwapList);
+    MmCompressedSwapPages += 1;
+    MmCompressedSwapSize += CompressedSize;
+    Stored = TRUE;
+
+CompressedSwapStoreEnd:
+    KeReleaseQueuedLock(MmCompressedSwapLock);
+    return Stored;
+}
+
+KSTATUS
+MmpCompressedSwapLoad (
+    PVOID PageFile,
+    UINTN PageIndex,
+    PIO_BUFFER IoBuffer,
+    UINTN BufferOffset
+    )
+
+/*++
+
+Routine Description:
+
+    This routine attempts to read a page of the page file out of the
+    compressed swap store. The compressed copy stays in the store, as the page
+    may be discarded later without being written back.
+
+Arguments:
+
+    PageFile - Supplies a pointer to the page file the page belongs to.
+
+    PageIndex - Supplies the index of the page within the page file.
+
+    IoBuffer - Supplies a pointer to the mapped I/O buffer that receives the
+        page.
+
+    BufferOffset - Supplies the offset from the I/O buffer's current offset
+        where the page should be written.
+
+Return Value:
+
+    STATUS_SUCCESS if the page was read from the store.
+
+    STATUS_NOT_FOUND if the page is not in the store and must be read from the
+    page file.
+
+    Other error codes on failure.
+
+--*/
+
+{
+
+    PCOMPRESSED_SWAP_ENTRY Entry;
+    ULONG PageSize;
+    KSTATUS Status;
+    BOOL Valid;
+
+    PageSize = MmPageSize();
+    KeAcquireQueuedLock(MmCompressedSwapLock);
+    Entry = MmpFindCompressedSwapEntry(PageFile, PageIndex);
+    if (Entry == NULL) {
+        Status = STATUS_NOT_FOUND;
+        goto CompressedSwapLoadEnd;
+    }
+
+    Valid = MmpLzssDecompress((PUCHAR)(Entry + 1),
+                              Entry->CompressedSize,
+                              MmCompressedSwapPage,
+                              PageSize);
+
+    if (Valid == FALSE) {
+
+        ASSERT(FALSE);
+
+        Status = STATUS_FILE_CORRUPT;
+        goto CompressedSwapLoadEnd;
+    }
+
+    Status = MmCopyIoBufferData(IoBuffer,
+                                MmCompressedSwapPage,
+                                BufferOffset,
+                                PageSize,
+                                TRUE);
+
+CompressedSwapLoadEnd:
+    KeReleaseQueuedLock(MmCompressedSwapLock);
+    return Status;
+}
+
+VOID
+MmpCompressedSwapInvalidate (
+    PVOID PageFile,
+    UINTN PageIndex,
+    UINTN PageCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine discards any compressed copies of the given range of page
+    file pages, as the page file space is being freed.
+
+Arguments:
+
+    PageFile - Supplies a pointer to the page file.
+
+    PageIndex - Supplies the index of the first page being freed.
+
+    PageCount - Supplies the number of pages being freed.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PCOMPRESSED_SWAP_ENTRY Entry;
+    UINTN Index;
+
+    if ((MmCompressedSwapPage == NULL) || (MmCompressedSwapPages == 0)) {
+        return;
+    }
+
+    KeAcquireQueuedLock(MmCompressedSwapLock);
+    for (Index = PageIndex; Index < PageIndex + PageCount; Index += 1) {
+        if (MmCompressedSwapPages == 0) {
+            break;
+        }
+
+        Entry = MmpFindCompressedSwapEntry(PageFile, Index);
+        if (Entry != NULL) {
+            MmpDestroyCompressedSwapEntry(Entry);
+        }
+    }
+
+    KeReleaseQueuedLock(MmCompressedSwapLock);
+    return;
+}
+
+KSTATUS
+MmpSetCompressedSwapLimit (
+    UINTN Limit
+    )
+
+/*++
+
+Routine Description:
+
+    This routine sets the maximum amount of memory the compressed swap store
+    may use. Raising the limit grows the arena. Lowering it writes the oldest
+    pages out to the page file until the store fits, though the arena itself
+    is kept.
+
+Arguments:
+
+    Limit - Supplies the new limit, in bytes. Zero disables the store.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    KSTATUS Status;
+
+    ASSERT(KeGetRunLevel() == RunLevelLow);
+
+    Limit = ALIGN_RANGE_DOWN(Limit, COMPRESSED_SWAP_CHUNK_SIZE);
+    Status = STATUS_SUCCESS;
+    KeAcquireQueuedLock(MmCompressedSwapLock);
+    MmCompressedSwapLimit = Limit;
+    while (MmCompressedSwapUsed > MmCompressedSwapLimit) {
+        if (MmpSpillCompressedSwapEntry() == FALSE) {
+            Status = STATUS_DEVICE_IO_ERROR;
+            goto SetCompressedSwapLimitEnd;
+        }
+    }
+
+    if (MmCompressedSwapPage != NULL) {
+        Status = MmpReserveCompressedSwap();
+    }
+
+SetCompressedSwapLimitEnd:
+    KeReleaseQueuedLock(MmCompressedSwapLock);
+    return Status;
+}
+
+VOID
+MmpGetCompressedSwapStatistics (
+    PMM_STATISTICS Statistics
+    )
+
+/*++
+
+Routine Description:
+
+    This routine fills in the compressed swap store members of the memory
+    statistics.
+
+Arguments:
+
+    Statistics - Supplies a pointer to the statistics to fill in.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if (MmCompressedSwapLock == NULL) {
+        return;
+    }
+
+    KeAcquireQueuedLock(MmCompressedSwapLock);
+    Statistics->CompressedSwapPages = MmCompressedSwapPages;
+    Statistics->CompressedSwapSize = MmCompressedSwapSize;
+    Statistics->CompressedSwapUsed = MmCompressedSwapUsed;
+    Statistics->CompressedSwapLimit = MmCompressedSwapLimit;
+    KeReleaseQueuedLock(MmCompressedSwapLock);
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+KSTATUS
+MmpReserveCompressedSwap (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine allocates the scratch buffers if needed, and grows the arena
+    to cover the current limit. This routine assumes the compressed swap lock
+    is held.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    UINTN AllocationSize;
+    PCOMPRESSED_SWAP_CHUNK Chunk;
+    PIO_BUFFER IoBuffer;
+    ULONG PageSize;
+    KSTATUS Status;
+
+    ASSERT(KeIsQueuedLockHeld(MmCompressedSwapLock) != FALSE);
+
+    PageSize = MmPageSize();
+
+    ASSERT(PageSize <= LZSS_HASH_EMPTY);
+
+    if (MmCompressedSwapPage == NULL) {
+        MmCompressedSwapOutput = MmAllocateNonPagedPool(
+                                               PageSize,
+                                               COMPRESSED_SWAP_ALLOCATION_TAG);
+
+        if (MmCompressedSwapOutput == NULL) {
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+            goto ReserveCompressedSwapEnd;
+        }
+
+        MmCompressedSwapHashTable = MmAllocateNonPagedPool(
+                                               LZSS_HASH_SIZE * sizeof(USHORT),
+                                               COMPRESSED_SWAP_ALLOCATION_TAG);
+
+        if (MmCompressedSwapHashTable == NULL) {
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+            goto ReserveCompressedSwapEnd;
+        }
+
+        IoBuffer = MmAllocateNonPagedIoBuffer(0,
+                                              MAX_ULONGLONG,
+                                              PageSize,
+                                              PageSize,
+                                              0);
+
+        if (IoBuffer == NULL) {
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+            goto ReserveCompressedSwapEnd;
+        }
+
+        ASSERT(IoBuffer->FragmentCount == 1);
+
+        MmCompressedSwapPageBuffer = IoBuffer;
+        MmCompressedSwapPage = IoBuffer->Fragment[0].VirtualAddress;
+    }
+
+    AllocationSize = sizeof(COMPRESSED_SWAP_CHUNK) + COMPRESSED_SWAP_CHUNK_SIZE;
+    while ((MmCompressedSwapChunkCount * COMPRESSED_SWAP_CHUNK_SIZE) <
+           MmCompressedSwapLimit) {
+
+        Chunk = MmAllocateNonPagedPool(AllocationSize,
+                                       COMPRESSED_SWAP_ALLOCATION_TAG);
+
+        if (Chunk == NULL) {
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+            goto ReserveCompressedSwapEnd;
+        }
+
+        RtlZeroMemory(Chunk, sizeof(COMPRESSED_SWAP_CHUNK));
+        Chunk->FreeGranules = COMPRESSED_SWAP_GRANULE_COUNT;
+        Chunk->Data = (PUCHAR)(Chunk + 1);
+        INSERT_BEFORE(&(Chunk->ListEntry), &MmCompressedSwapChunkList);
+        MmCompressedSwapChunkCount += 1;
+    }
+
+    Status = STATUS_SUCCESS;
+
+ReserveCompressedSwapEnd:
+    if ((!KSUCCESS(Status)) && (MmCompressedSwapPage == NULL)) {
+        if (MmCompressedSwapOutput != NULL) {
+            MmFreeNonPagedPool(MmCompressedSwapOutput);
+            MmCompressedSwapOutput = NULL;
+        }
+
+        if (MmCompressedSwapHashTable != NULL) {
+            MmFreeNonPagedPool(MmCompressedSwapHashTable);
+            MmCompressedSwapHashTable = NULL;
+        }
+    }
+
+    return Status;
+}
+
+BOOL
+MmpSpillCompressedSwapEntry (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine writes the oldest page in the compressed swap store out to
+    its page file and removes it from the store. The entry is only removed
+    once the write completes, so concurrent loads always find the data. This
+    routine assumes the compressed swap lock is held.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    TRUE if a page was written out.
+
+    FALSE if the store is empty or the write failed.
+
+--*/
+
+{
+
+    PCOMPRESSED_SWAP_ENTRY Entry;
+    KSTATUS Status;
+    BOOL Valid;
+
+    ASSERT(KeIsQueuedLockHeld(MmCompressedSwapLock) != FALSE);
+
+    if (LIST_EMPTY(&MmCompressedSwapList) != FALSE) {
+        return FALSE;
+    }
+
+    Entry = LIST_VALUE(MmCompressedSwapList.Next,
+                       COMPRESSED_SWAP_ENTRY,
+                       ListEntry);
+
+    Valid = MmpLzssDecompress((PUCHAR)(Entry + 1),
+                              Entry->CompressedSize,
+                              MmCompressedSwapPage,
+                              MmPageSize());
+
+    if (Valid == FALSE) {
+
+        ASSERT(FALSE);
+
+        return FALSE;
+    }
+
+    Status = MmpWritePageFilePage(Entry->PageFile,
+                                  Entry->PageIndex,
+                                  MmCompressedSwapPageBuffer);
+
+    if (!KSUCCESS(Status)) {
+        return FALSE;
+    }
+
+    MmpDestroyCompressedSwapEntry(Entry);
+    return TRUE;
+}
+
+PCOMPRESSED_SWAP_ENTRY
+MmpFindCompressedSwapEntry (
+    PVOID PageFile,
+    UINTN PageIndex
+    )
+
+/*++
+
+Routine Description:
+
+    This routine finds the compressed copy of a page file page. This routine
+    assumes the compressed swap lock is held.
+
+Arguments:
+
+    PageFile - Supplies a pointer to the page file.
+
+    PageIndex - Supplies the index of the page within the page file.
+
+Return Value:
+
+    Returns a pointer to the compressed page on success.
+
+    NULL if the page is not in the store.
+
+--*/
+
+{
+
+    PRED_BLACK_TREE_NODE FoundNode;
+    COMPRESSED_SWAP_ENTRY SearchEntry;
+
+    if (MmCompressedSwapPages == 0) {
+        return NULL;
+    }
+
+    SearchEntry.PageFile = PageFile;
+    SearchEntry.PageIndex = PageIndex;
+    FoundNode = RtlRedBlackTreeSearch(&MmCompressedSwapTree,
+                                      &(SearchEntry.TreeNode));
+
+    if (FoundNode == NULL) {
+        return NULL;
+    }
+
+    return RED_BLACK_TREE_VALUE(FoundNode, COMPRESSED_SWAP_ENTRY, TreeNode);
+}
+
+PCOMPRESSED_SWAP_ENTRY
+MmpAllocateCompressedSwapEntry (
+    ULONG GranuleCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine carves a run of granules out of the arena. This routine
+    assumes the compressed swap lock is held.
+
+Arguments:
+
+    GranuleCount - Supplies the number of granules needed.
+
+Return Value:
+
+    Returns a pointer to the new compressed page, whose header is filled in
+    with the chunk and granule information.
+
+    NULL if no chunk has a large enough run of free granules.
+
+--*/
+
+{
+
+    PCOMPRESSED_SWAP_CHUNK Chunk;
+    PLIST_ENTRY CurrentEntry;
+    PCOMPRESSED_SWAP_ENTRY Entry;
+    ULONG Index;
+    ULONG RunLength;
+    ULONG RunStart;
+
+    CurrentEntry = MmCompressedSwapChunkList.Next;
+    while (CurrentEntry != &MmCompressedSwapChunkList) {
+        Chunk = LIST_VALUE(CurrentEntry, COMPRESSED_SWAP_CHUNK, ListEntry);
+        CurrentEntry = CurrentEntry->Next;
+        if (Chunk->FreeGranules < GranuleCount) {
+            continue;
+        }
+
+        RunLength = 0;
+        RunStart = 0;
+        for (Index = 0; Index < COMPRESSED_SWAP_GRANULE_COUNT; Index += 1) {
+            if ((Chunk->Bitmap[Index / 32] & (1 << (Index % 32))) != 0) {
+                RunLength = 0;
+                RunStart = Index + 1;
+                continue;
+            }
+
+            RunLength += 1;
+            if (RunLength == GranuleCount) {
+                break;
+            }
+        }
+
+        if (RunLength != GranuleCount) {
+            continue;
+        }
+
+        for (Index = RunStart; Index < RunStart + GranuleCount; Index += 1) {
+            Chunk->Bitmap[Index / 32] |= 1 << (Index % 32);
+        }
+
+        Chunk->FreeGranules -= GranuleCount;
+        MmCompressedSwapUsed += GranuleCount << COMPRESSED_SWAP_GRANULE_SHIFT;
+        Entry = (PCOMPRESSED_SWAP_ENTRY)(Chunk->Data +
+                                 (RunStart << COMPRESSED_SWAP_GRANULE_SHIFT));
+
+        Entry->Chunk = Chunk;
+        Entry->GranuleIndex = RunStart;
+        Entry->GranuleCount = GranuleCount;
+        return Entry;
+    }
+
+    return NULL;
+}
+
+VOID
+MmpDestroyCompressedSwapEntry (
+    PCOMPRESSED_SWAP_ENTRY Entry
+    )
+
+/*++
+
+Routine Description:
+
+    This routine removes a compressed page from the store and releases its
+    granules. This routine assumes the compressed swap lock is held.
+
+Arguments:
+
+    Entry - Supplies a pointer to the compressed page.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PCOMPRESSED_SWAP_CHUNK Chunk;
+    ULONG Index;
+
+    ASSERT(MmCompressedSwapPages != 0);
+
+    RtlRedBlackTreeRemove(&MmCompressedSwapTree, &(Entry->TreeNode));
+    LIST_REMOVE(&(Entry->ListEntry));
+    MmCompressedSwapPages -= 1;
+    MmCompressedSwapSize -= Entry->CompressedSize;
+    MmCompressedSwapUsed -= Entry->GranuleCount <<
+                            COMPRESSED_SWAP_GRANULE_SHIFT;
+
+    Chunk = Entry->Chunk;
+    Chunk->FreeGranules += Entry->GranuleCount;
+    for (Index = Entry->GranuleIndex;
+         Index < Entry->GranuleIndex + Entry->GranuleCount;
+         Index += 1) {
+
+        ASSERT((Chunk->Bitmap[Index / 32] & (1 << (Index % 32))) != 0);
+
+        Chunk->Bitmap[Index / 32] &= ~(1 << (Index % 32));
+    }
+
+    return;
+}
+
+COMPARISON_RESULT
+MmpCompareCompressedSwapEntries (
+    PRED_BLACK_TREE Tree,
+    PRED_BLACK_TREE_NODE FirstNode,
+    PRED_BLACK_TREE_NODE SecondNode
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compares two compressed swap tree nodes by page file and
+    page index.
+
+Arguments:
+
+    Tree - Supplies a pointer to the Red-Black tree that owns both nodes.
+
+    FirstNode - Supplies a pointer to the left side of the comparison.
+
+    SecondNode - Supplies a pointer to the second side of the comparison.
+
+Return Value:
+
+    Same if the two nodes have the same value.
+
+    Ascending if the first node is less than the second node.
+
+    Descending if the second node is less than the first node.
+
+--*/
+
+{
+
+    PCOMPRESSED_SWAP_ENTRY First;
+    PCOMPRESSED_SWAP_ENTRY Second;
+
+    First = RED_BLACK_TREE_VALUE(FirstNode, COMPRESSED_SWAP_ENTRY, TreeNode);
+    Second = RED_BLACK_TREE_VALUE(SecondNode, COMPRESSED_SWAP_ENTRY, TreeNode);
+    if ((UINTN)First->PageFile < (UINTN)Second->PageFile) {
+        return ComparisonResultAscending;
+
+    } else if ((UINTN)First->PageFile > (UINTN)Second->PageFile) {
+        return ComparisonResultDescending;
+    }
+
+    if (First->PageIndex < Second->PageIndex) {
+        return ComparisonResultAscending;
+
+    } else if (First->PageIndex > Second->PageIndex) {
+        return ComparisonResultDescending;
+    }
+
+    return ComparisonResultSame;
+}
+
+ULONG
+MmpLzssCompress (
+    PUCHAR Input,
+    ULONG InputSize,
+    PUCHAR Output,
+    ULONG OutputSize,
+    PUSHORT HashTable
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compresses a buffer with LZSS. The output is a series of
+    groups, each a control byte followed by up to eight items. A clear control
+    bit denotes a literal byte, and a set bit denotes a two byte match holding
+    the distance minus one in the upper 12 bits and the length minus the
+    minimum match in the lower 4 bits.
+
+Arguments:
+
+    Input - Supplies a pointer to the data to compress.
+
+    InputSize - Supplies the size of the input, which must be less than
+        LZSS_HASH_EMPTY.
+
+    Output - Supplies a pointer where the compressed data will be returned.
+
+    OutputSize - Supplies the size of the output buffer. Compression gives up
+        if the data does not fit.
+
+    HashTable - Supplies a pointer to a table of LZSS_HASH_SIZE entries used
+        to find matches.
+
+Return Value:
+
+    Returns the size of the compressed data on success.
+
+    0 if the compressed data would not fit in the output buffer.
+
+--*/
+
+{
+
+    ULONG Candidate;
+    ULONG ControlBit;
+    ULONG ControlIndex;
+    ULONG Hash;
+    ULONG InputIndex;
+    ULONG MatchLength;
+    ULONG MaxLength;
+    ULONG OutputIndex;
+    ULONG Position;
+    USHORT Token;
+
+    ASSERT(InputSize < LZSS_HASH_EMPTY);
+
+    for (Hash = 0; Hash < LZSS_HASH_SIZE; Hash += 1) {
+        HashTable[Hash] = LZSS_HASH_EMPTY;
+    }
+
+    InputIndex = 0;
+    OutputIndex = 0;
+    while (InputIndex < InputSize) {
+        if (OutputIndex >= OutputSize) {
+            return 0;
+        }
+
+        ControlIndex = OutputIndex;
+        Output[ControlIndex] = 0;
+        OutputIndex += 1;
+        for (ControlBit = 0;
+             (ControlBit < BITS_PER_BYTE) && (InputIndex < InputSize);
+             ControlBit += 1) {
+
+            //
+            // Look up the most recent position with the same three leading
+            // bytes and see how far the match goes.
+            //
+
+            MatchLength = 0;
+            Candidate = LZSS_HASH_EMPTY;
+            if (InputIndex + LZSS_MIN_MATCH <= InputSize) {
+                Hash = LZSS_HASH(Input + InputIndex);
+                Candidate = HashTable[Hash];
+                HashTable[Hash] = InputIndex;
+            }
+
+            if ((Candidate != LZSS_HASH_EMPTY) &&
+                (InputIndex - Candidate <= LZSS_MAX_DISTANCE)) {
+
+                MaxLength = InputSize - InputIndex;
+                if (MaxLength > LZSS_MAX_MATCH) {
+                    MaxLength = LZSS_MAX_MATCH;
+                }
+
+                while ((MatchLength < MaxLength) &&
+                       (Input[Candidate + MatchLength] ==
+                        Input[InputIndex + MatchLength])) {
+
+                    MatchLength += 1;
+                }
+            }
+
+            if (MatchLength >= LZSS_MIN_MATCH) {
+                if (OutputIndex + sizeof(USHORT) > OutputSize) {
+                    return 0;
+                }
+
+                Token = ((InputIndex - Candidate - 1) << 4) |
+                        (MatchLength - LZSS_MIN_MATCH);
+
+                Output[OutputIndex] = (UCHAR)Token;
+                Output[OutputIndex + 1] = (UCHAR)(Token >> 8);
+                OutputIndex += sizeof(USHORT);
+                Output[ControlIndex] |= 1 << ControlBit;
+
+                //
+                // Hash the positions covered by the match so later data can
+                // refer back into it.
+                //
+
+                for (Position = InputIndex + 1;
+                     (Position < InputIndex + MatchLength) &&
+                     (Position + LZSS_MIN_MATCH <= InputSize);
+                     Position += 1) {
+
+                    HashTable[LZSS_HASH(Input + Position)] = Position;
+                }
+
+                InputIndex += MatchLength;
+
+            } else {
+                if (OutputIndex >= OutputSize) {
+                    return 0;
+                }
+
+                Output[OutputIndex] = Input[InputIndex];
+                OutputIndex += 1;
+                InputIndex += 1;
+            }
+        }
+    }
+
+    return OutputIndex;
+}
+
+BOOL
+MmpLzssDecompress (
+    PUCHAR Input,
+    ULONG InputSize,
+    PUCHAR Output,
+    ULONG OutputSize
+    )
+
+/*++
+
+Routine Description:
+
+    This routine decompresses a buffer compressed with LZSS.
+
+Arguments:
+
+    Input - Supplies a pointer to the compressed data.
+
+    InputSize - Supplies the size of the compressed data.
+
+    Output - Supplies a pointer where the decompressed data will be returned.
+
+    OutputSize - Supplies the exact size of the decompressed data.
+
+Return Value:
+
+    TRUE if the data decompressed to exactly the output size.
+
+    FALSE if the compressed data is malformed.
+
+--*/
+
+{
+
+    UCHAR Control;
+    ULONG ControlBit;
+    ULONG Distance;
+    ULONG InputIndex;
+    ULONG MatchLength;
+    ULONG OutputIndex;
+    USHORT Token;
+
+    InputIndex = 0;
+    OutputIndex = 0;
+    while (OutputIndex < OutputSize) {
+        if (InputIndex >= InputSize) {
+            return FALSE;
+        }
+
+        Control = Input[InputIndex];
+        InputIndex += 1;
+        for (ControlBit = 0;
+             (ControlBit < BITS_PER_BYTE) && (OutputIndex < OutputSize);
+             ControlBit += 1) {
+
+            if ((Control & (1 << ControlBit)) != 0) {
+                if (InputIndex + sizeof(USHORT) > InputSize) {
+                    return FALSE;
+                }
+
+                Token = Input[InputIndex] | (Input[InputIndex + 1] << 8);
+                InputIndex += sizeof(USHORT);
+                Distance = (Token >> 4) + 1;
+                MatchLength = (Token & 0xF) + LZSS_MIN_MATCH;
+                if ((Distance > OutputIndex) ||
+                    (MatchLength > OutputSize - OutputIndex)) {
+
+                    return FALSE;
+                }
+
+                //
+                // Copy byte by byte, as the match may overlap the bytes it is
+                // producing.
+                //
+
+                while (MatchLength != 0) {
+                    Output[OutputIndex] = Output[OutputIndex - Distance];
+                    OutputIndex += 1;
+                    MatchLength -= 1;
+                }
+
+            } else {
+                if (InputIndex >= InputSize) {
+                    return FALSE;
+                }
+
+                Output[OutputIndex] = Input[InputIndex];
+                OutputIndex += 1;
+                InputIndex += 1;
+            }
+        }
+    }
+
+    if (InputIndex != InputSize) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
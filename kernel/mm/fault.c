@@ -132,6 +132,8 @@ Return Value:
     ASSERT((MmPagingThread == NULL) ||
            (KeGetCurrentThread() != MmPagingThread));
 
+    SpTrace(SpTraceEventPageFault, FaultingAddress, FaultFlags);
+
     //
     // Page faults are not allowed at dispatch or above.
     //
@@ -31,6 +31,7 @@ Module Name:
 //
 
 #include <minoca/kernel/kernel.h>
+#include "mmp.h"
 
 //
 // ---------------------------------------------------------------- Definitions
@@ -51,6 +52,13 @@ MmpGetSetSystemMemoryInformation (
     BOOL Set
     );
 
+KSTATUS
+MmpGetSetCompressedSwapLimit (
+    PVOID Data,
+    PUINTN DataSize,
+    BOOL Set
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -106,6 +114,10 @@ Return Value:
         Status = MmpGetSetSystemMemoryInformation(Data, DataSize, Set);
         break;
 
+    case MmInformationCompressedSwapLimit:
+        Status = MmpGetSetCompressedSwapLimit(Data, DataSize, Set);
+        break;
+
     default:
         Status = STATUS_INVALID_PARAMETER;
         *DataSize = 0;
@@ -167,3 +179,60 @@ Return Value:
     return Status;
 }
 
+KSTATUS
+MmpGetSetCompressedSwapLimit (
+    PVOID Data,
+    PUINTN DataSize,
+    BOOL Set
+    )
+
+/*++
+
+Routine Description:
+
+    This routine gets or sets the maximum number of bytes of memory the
+    compressed swap store may use.
+
+Arguments:
+
+    Data - Supplies a pointer to the data buffer where the data is either
+        returned for a get operation or given for a set operation.
+
+    DataSize - Supplies a pointer that on input contains the size of the
+        data buffer. On output, contains the required size of the data buffer.
+
+    Set - Supplies a boolean indicating if this is a get operation (FALSE) or
+        a set operation (TRUE).
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    MM_STATISTICS Statistics;
+    KSTATUS Status;
+
+    if (*DataSize != sizeof(UINTN)) {
+        *DataSize = sizeof(UINTN);
+        return STATUS_DATA_LENGTH_MISMATCH;
+    }
+
+    if (Set != FALSE) {
+        Status = PsCheckPermission(PERMISSION_RESOURCES);
+        if (!KSUCCESS(Status)) {
+            *DataSize = 0;
+            return Status;
+        }
+
+        return MmpSetCompressedSwapLimit(*((PUINTN)Data));
+    }
+
+    RtlZeroMemory(&Statistics, sizeof(MM_STATISTICS));
+    MmpGetCompressedSwapStatistics(&Statistics);
+    *((PUINTN)Data) = Statistics.CompressedSwapLimit;
+    return STATUS_SUCCESS;
+}
+
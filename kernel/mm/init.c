@@ -274,6 +274,11 @@ Return Value:
             goto InitializeEnd;
         }
 
+        Status = MmpInitializeObjectCaches();
+        if (!KSUCCESS(Status)) {
+            goto InitializeEnd;
+        }
+
         //
         // Create the kernel's VA lock, which was deferred becaues the Object
         // Manager was not online.
@@ -299,12 +304,19 @@ Return Value:
         // Create the physical address lock.
         //
 
-        MmPhysicalPageLock = KeCreateSharedExclusiveLock();
+        MmPhysicalPageLock =
+                       KeCreateNamedSharedExclusiveLock("MmPhysicalPageLock");
         if (MmPhysicalPageLock == NULL) {
             Status = STATUS_INSUFFICIENT_RESOURCES;
             goto InitializeEnd;
         }
 
+        MmPageListLock = KeCreateQueuedLock();
+        if (MmPageListLock == NULL) {
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+            goto InitializeEnd;
+        }
+
         //
         // Create an event that signals whenever there is a change in the
         // physical memory warning level.
@@ -403,6 +403,8 @@ Return Value:
     PVOID NonPagedPoolBuffer;
     BOOL NonPagedPoolLockHeld;
     ULONG NonPagedPoolSize;
+    PVOID ObjectCacheBuffer;
+    ULONG ObjectCacheSize;
     RUNLEVEL OldRunLevel;
     PVOID PagedPoolBuffer;
     BOOL PagedPoolLockHeld;
@@ -416,6 +418,7 @@ Return Value:
     ASSERT(KeGetRunLevel() == RunLevelLow);
 
     NonPagedPoolBuffer = NULL;
+    ObjectCacheBuffer = NULL;
     PagedPoolBuffer = NULL;
     PagedPoolLockHeld = FALSE;
     TotalBuffer = NULL;
@@ -513,13 +516,25 @@ Return Value:
     ProfilerMemoryPool = PagedPoolBuffer;
     ProfilerMemoryPool->ProfilerMemoryType = ProfilerMemoryTypePagedPool;
 
+    //
+    // Collect the object cache statistics, which report each cache as a tag.
+    //
+
+    Status = MmpGetObjectCacheProfilerStatistics(&ObjectCacheBuffer,
+                                                 &ObjectCacheSize,
+                                                 Tag);
+
+    if (!KSUCCESS(Status)) {
+        goto GetPoolStatisticsEnd;
+    }
+
     //
     // Allocate a new buffer for the merged statistics. The buffers could be
     // allocated together, but this minimizes the amount of time the pool
     // locks are held to keep the profiler out of the way.
     //
 
-    TotalSize = NonPagedPoolSize + PagedPoolSize;
+    TotalSize = NonPagedPoolSize + PagedPoolSize + ObjectCacheSize;
     TotalBuffer = MmAllocateNonPagedPool(TotalSize, Tag);
     if (TotalBuffer == NULL) {
         Status = STATUS_INSUFFICIENT_RESOURCES;
@@ -531,12 +546,17 @@ Return Value:
                   PagedPoolBuffer,
                   PagedPoolSize);
 
+    RtlCopyMemory((PBYTE)TotalBuffer + NonPagedPoolSize + PagedPoolSize,
+                  ObjectCacheBuffer,
+                  ObjectCacheSize);
+
     //
     // Free the temporary per-pool buffers and return the combined buffer.
     //
 
     MmFreeNonPagedPool(NonPagedPoolBuffer);
     MmFreeNonPagedPool(PagedPoolBuffer);
+    MmFreeNonPagedPool(ObjectCacheBuffer);
     *Buffer = TotalBuffer;
     *BufferSize = TotalSize;
     Status = STATUS_SUCCESS;
@@ -563,6 +583,10 @@ Return Value:
             MmFreeNonPagedPool(PagedPoolBuffer);
         }
 
+        if (ObjectCacheBuffer != NULL) {
+            MmFreeNonPagedPool(ObjectCacheBuffer);
+        }
+
         if (TotalBuffer != NULL) {
             MmFreeNonPagedPool(TotalBuffer);
         }
@@ -671,6 +695,7 @@ Return Value:
 
     KeReleaseQueuedLock(MmPagedPoolLock);
     MmpGetPhysicalPageStatistics(Statistics);
+    MmpGetCompressedSwapStatistics(Statistics);
     return STATUS_SUCCESS;
 }
 
@@ -156,6 +156,12 @@ Module Name:
 // ------------------------------------------------------ Data Type Definitions
 //
 
+typedef enum _PAGE_LIST_TYPE {
+    PageListNone,
+    PageListActive,
+    PageListInactive
+} PAGE_LIST_TYPE, *PPAGE_LIST_TYPE;
+
 /*++
 
 Structure Description:
@@ -276,6 +282,15 @@ Structure Description:
     ListEntry - Stores a pointer to the next and previous paging entries in
         a list of paging entries ready for destruction.
 
+    PageListEntry - Stores pointers to the next and previous paging entries on
+        the active or inactive page list. This is protected by the page list
+        lock.
+
+    PhysicalAddress - Stores the physical address of the page this entry
+        describes, valid while the entry is on a page list.
+
+    PageList - Stores which page list the entry is currently on.
+
 --*/
 
 typedef struct _PAGING_ENTRY {
@@ -290,6 +305,9 @@ typedef struct _PAGING_ENTRY {
         LIST_ENTRY ListEntry;
     } U;
 
+    LIST_ENTRY PageListEntry;
+    PHYSICAL_ADDRESS PhysicalAddress;
+    PAGE_LIST_TYPE PageList;
 } PAGING_ENTRY, *PPAGING_ENTRY;
 
 //
@@ -328,6 +346,12 @@ extern PHYSICAL_ADDRESS MmMaximumPhysicalAddress;
 
 extern PSHARED_EXCLUSIVE_LOCK MmPhysicalPageLock;
 
+//
+// Stores the lock protecting the active and inactive page lists.
+//
+
+extern PQUEUED_LOCK MmPageListLock;
+
 //
 // Store a boolean indicating whether or not physical page zero is available.
 //
@@ -793,6 +817,29 @@ Return Value:
 
 --*/
 
+VOID
+MmpAgePhysicalPages (
+    UINTN ScanLimit
+    );
+
+/*++
+
+Routine Description:
+
+    This routine ages pageable pages by sampling their accessed bits, moving
+    pages that have not been touched recently from the active list to the
+    inactive list until the inactive list reaches its target size.
+
+Arguments:
+
+    ScanLimit - Supplies the maximum number of active pages to examine.
+
+Return Value:
+
+    None.
+
+--*/
+
 PADDRESS_SPACE
 MmpArchCreateAddressSpace (
     VOID
@@ -979,6 +1026,37 @@ Return Value:
 
 --*/
 
+BOOL
+MmpCheckAndClearPageAccessed (
+    PADDRESS_SPACE AddressSpace,
+    PVOID VirtualAddress
+    );
+
+/*++
+
+Routine Description:
+
+    This routine checks and clears the hardware accessed bit in the page table
+    entry for the given virtual address. The TLB is not flushed, so a processor
+    with the translation cached may not set the bit again until that entry is
+    evicted.
+
+Arguments:
+
+    AddressSpace - Supplies a pointer to the address space that owns the
+        virtual address.
+
+    VirtualAddress - Supplies the virtual address of the page to check.
+
+Return Value:
+
+    TRUE if the page was accessed since the last time the bit was cleared.
+
+    FALSE if the page was not accessed, is not mapped, or the architecture
+    does not track accesses.
+
+--*/
+
 VOID
 MmpUnmapPageInOtherProcess (
     PADDRESS_SPACE AddressSpace,
@@ -2137,6 +2215,277 @@ Return Value:
 
 --*/
 
+KSTATUS
+MmpInitializeObjectCaches (
+    VOID
+    );
+
+/*++
+
+Routine Description:
+
+    This routine initializes support for object caches. It must be called
+    after the object manager is online.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+KSTATUS
+MmpGetObjectCacheProfilerStatistics (
+    PVOID *Buffer,
+    PULONG BufferSize,
+    ULONG Tag
+    );
+
+/*++
+
+Routine Description:
+
+    This routine allocates a buffer from non-paged pool and fills it with a
+    profiler memory pool describing every object cache, with one tag
+    statistic per cache.
+
+Arguments:
+
+    Buffer - Supplies a pointer that receives the buffer of statistics.
+
+    BufferSize - Supplies a pointer that receives the size of the buffer, in
+        bytes.
+
+    Tag - Supplies the allocation tag to use for the buffer.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+KSTATUS
+MmpInitializeCompressedSwap (
+    VOID
+    );
+
+/*++
+
+Routine Description:
+
+    This routine initializes the compressed swap store. The store's arena is
+    not allocated until a page file arrives.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+KSTATUS
+MmpActivateCompressedSwap (
+    VOID
+    );
+
+/*++
+
+Routine Description:
+
+    This routine allocates the compressed swap store's scratch buffers and
+    arena. It is called when a page file arrives, and must not be called from
+    the paging thread.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+BOOL
+MmpIsCompressedSwapActive (
+    VOID
+    );
+
+/*++
+
+Routine Description:
+
+    This routine determines whether the compressed swap store may hold pages.
+    This is checked without the store's lock, so it is only a hint.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    TRUE if pages may be stored in or loaded from the compressed swap store.
+
+    FALSE if the compressed swap store is not in use.
+
+--*/
+
+BOOL
+MmpCompressedSwapStore (
+    PVOID PageFile,
+    UINTN PageIndex,
+    PIO_BUFFER IoBuffer,
+    UINTN BufferOffset
+    );
+
+/*++
+
+Routine Description:
+
+    This routine attempts to store a page bound for the page file in the
+    compressed swap store. Any previously stored copy of the page is discarded
+    either way, and older pages may be written out to the page file to make
+    room.
+
+Arguments:
+
+    PageFile - Supplies a pointer to the page file the page is bound for.
+
+    PageIndex - Supplies the index of the page within the page file.
+
+    IoBuffer - Supplies a pointer to the mapped I/O buffer holding the page.
+
+    BufferOffset - Supplies the offset from the I/O buffer's current offset
+        where the page begins.
+
+Return Value:
+
+    TRUE if the page was stored and does not need to be written to the page
+    file.
+
+    FALSE if the page must be written to the page file.
+
+--*/
+
+KSTATUS
+MmpCompressedSwapLoad (
+    PVOID PageFile,
+    UINTN PageIndex,
+    PIO_BUFFER IoBuffer,
+    UINTN BufferOffset
+    );
+
+/*++
+
+Routine Description:
+
+    This routine attempts to read a page of the page file out of the
+    compressed swap store. The compressed copy stays in the store, as the page
+    may be discarded later without being written back.
+
+Arguments:
+
+    PageFile - Supplies a pointer to the page file the page belongs to.
+
+    PageIndex - Supplies the index of the page within the page file.
+
+    IoBuffer - Supplies a pointer to the mapped I/O buffer that receives the
+        page.
+
+    BufferOffset - Supplies the offset from the I/O buffer's current offset
+        where the page should be written.
+
+Return Value:
+
+    STATUS_SUCCESS if the page was read from the store.
+
+    STATUS_NOT_FOUND if the page is not in the store and must be read from the
+    page file.
+
+    Other error codes on failure.
+
+--*/
+
+VOID
+MmpCompressedSwapInvalidate (
+    PVOID PageFile,
+    UINTN PageIndex,
+    UINTN PageCount
+    );
+
+/*++
+
+Routine Description:
+
+    This routine discards any compressed copies of the given range of page
+    file pages, as the page file space is being freed.
+
+Arguments:
+
+    PageFile - Supplies a pointer to the page file.
+
+    PageIndex - Supplies the index of the first page being freed.
+
+    PageCount - Supplies the number of pages being freed.
+
+Return Value:
+
+    None.
+
+--*/
+
+KSTATUS
+MmpSetCompressedSwapLimit (
+    UINTN Limit
+    );
+
+/*++
+
+Routine Description:
+
+    This routine sets the maximum amount of memory the compressed swap store
+    may use. Raising the limit grows the arena. Lowering it writes the oldest
+    pages out to the page file until the store fits, though the arena itself
+    is kept.
+
+Arguments:
+
+    Limit - Supplies the new limit, in bytes. Zero disables the store.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+VOID
+MmpGetCompressedSwapStatistics (
+    PMM_STATISTICS Statistics
+    );
+
+/*++
+
+Routine Description:
+
+    This routine fills in the compressed swap store members of the memory
+    statistics.
+
+Arguments:
+
+    Statistics - Supplies a pointer to the statistics to fill in.
+
+Return Value:
+
+    None.
+
+--*/
+
 VOID
 MmpSendTlbInvalidateIpi (
     PADDRESS_SPACE AddressSpace,
@@ -2186,6 +2535,34 @@ Return Value:
 
 --*/
 
+KSTATUS
+MmpWritePageFilePage (
+    PVOID PageFile,
+    UINTN PageIndex,
+    PIO_BUFFER IoBuffer
+    );
+
+/*++
+
+Routine Description:
+
+    This routine writes a single page directly to a page file, bypassing the
+    compressed swap store.
+
+Arguments:
+
+    PageFile - Supplies a pointer to the page file.
+
+    PageIndex - Supplies the index of the page within the page file.
+
+    IoBuffer - Supplies a pointer to the I/O buffer holding the page.
+
+Return Value:
+
+    Status code.
+
+--*/
+
 KSTATUS
 MmpPageIn (
     PIMAGE_SECTION ImageSection,
@@ -0,0 +1,1709 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    objcache.c
+
+Abstract:
+
+    This module implements object caches, which hand out constructed fixed
+    size objects carved from slabs of pool. Each processor keeps magazines of
+    free objects so that the common allocate and free paths only raise the
+    run level, and a per-cache depot of magazines sits between the processors
+    and the slab layer.
+
+Author:
+
+    agent 19-Oct-2026
+
+Environment:
+
+    Kernel
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <minoca/kernel/kernel.h>
+#include "mmp.h"
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+#define OBJECT_CACHE_ALLOCATION_TAG 0x634F6D4D // 'cOmM'
+
+//
+// Define the number of objects a magazine holds.
+//
+
+#define OBJECT_CACHE_MAGAZINE_SIZE 15
+
+//
+// Define the minimum number of objects that should fit in a slab. Slabs are
+// one page unless that would hold fewer objects than this.
+//
+
+#define OBJECT_CACHE_MINIMUM_SLAB_OBJECTS 8
+
+//
+// Define the number of completely free slabs a cache keeps before it starts
+// releasing them back to pool as objects are freed.
+//
+
+#define OBJECT_CACHE_FREE_SLAB_LIMIT 2
+
+//
+// This macro returns the buffer control structure that precedes an object.
+//
+
+#define OBJECT_CACHE_BUFFER(_Object) \
+    ((POBJECT_CACHE_BUFFER)(_Object) - 1)
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+/*++
+
+Structure Description:
+
+    This structure stores a magazine of free, constructed objects.
+
+Members:
+
+    ListEntry - Stores pointers to the next and previous magazines in the
+        cache depot.
+
+    Count - Stores the number of objects in the magazine.
+
+    Objects - Stores the objects in the magazine.
+
+--*/
+
+typedef struct _OBJECT_CACHE_MAGAZINE {
+    LIST_ENTRY ListEntry;
+    ULONG Count;
+    PVOID Objects[OBJECT_CACHE_MAGAZINE_SIZE];
+} OBJECT_CACHE_MAGAZINE, *POBJECT_CACHE_MAGAZINE;
+
+/*++
+
+Structure Description:
+
+    This structure stores the per-processor state of an object cache. It is
+    only touched by its own processor at dispatch level.
+
+Members:
+
+    Loaded - Stores a pointer to the magazine that objects are allocated from
+        and freed to.
+
+    Previous - Stores a pointer to the magazine that was loaded before the
+        current one, which is swapped in before going to the depot.
+
+    Allocations - Stores the number of objects allocated on this processor.
+
+    Frees - Stores the number of objects freed on this processor.
+
+--*/
+
+typedef struct _OBJECT_CACHE_PROCESSOR {
+    POBJECT_CACHE_MAGAZINE Loaded;
+    POBJECT_CACHE_MAGAZINE Previous;
+    ULONGLONG Allocations;
+    ULONGLONG Frees;
+} OBJECT_CACHE_PROCESSOR, *POBJECT_CACHE_PROCESSOR;
+
+/*++
+
+Structure Description:
+
+    This structure stores the header of a slab, which sits at the beginning
+    of the slab's pool allocation.
+
+Members:
+
+    ListEntry - Stores pointers to the next and previous slabs in whichever
+        slab list the slab is on.
+
+    FreeList - Stores a pointer to the first free object in the slab.
+
+    FreeCount - Stores the number of free objects in the slab.
+
+--*/
+
+typedef struct _OBJECT_CACHE_SLAB {
+    LIST_ENTRY ListEntry;
+    PVOID FreeList;
+    ULONG FreeCount;
+} OBJECT_CACHE_SLAB, *POBJECT_CACHE_SLAB;
+
+/*++
+
+Structure Description:
+
+    This structure stores the control information that immediately precedes
+    each object in a slab. It is kept outside the object so that free objects
+    stay constructed.
+
+Members:
+
+    Slab - Stores a pointer to the slab that owns the object.
+
+    NextFree - Stores a pointer to the next free object in the slab, if this
+        object is free in the slab layer.
+
+--*/
+
+typedef struct _OBJECT_CACHE_BUFFER {
+    POBJECT_CACHE_SLAB Slab;
+    PVOID NextFree;
+} OBJECT_CACHE_BUFFER, *POBJECT_CACHE_BUFFER;
+
+/*++
+
+Structure Description:
+
+    This structure stores an object cache.
+
+Members:
+
+    ListEntry - Stores pointers to the next and previous object caches in the
+        global list.
+
+    Flags - Stores a bitfield of flags. See OBJECT_CACHE_FLAG_* definitions.
+
+    ObjectSize - Stores the size of each object, in bytes.
+
+    Alignment - Stores the alignment of each object, in bytes.
+
+    Stride - Stores the distance between objects in a slab, in bytes.
+
+    SlabSize - Stores the size of each slab allocation, in bytes.
+
+    ObjectsPerSlab - Stores the number of objects in each slab.
+
+    Tag - Stores the cache's allocation tag.
+
+    PoolType - Stores the pool slabs are allocated from.
+
+    Constructor - Stores an optional pointer to the object constructor.
+
+    Destructor - Stores an optional pointer to the object destructor.
+
+    Reclaim - Stores an optional pointer to the reclaim routine.
+
+    Context - Stores the context pointer passed to the callbacks.
+
+    SpinLock - Stores the lock protecting the depot and slabs of non-paged
+        caches.
+
+    QueuedLock - Stores a pointer to the lock protecting the depot and slabs
+        of paged caches.
+
+    PartialSlabList - Stores the list of slabs with some free objects.
+
+    FullSlabList - Stores the list of slabs with no free objects.
+
+    FreeSlabList - Stores the list of slabs whose objects are all free.
+
+    FullMagazineList - Stores the depot's list of full magazines.
+
+    EmptyMagazineList - Stores the depot's list of empty magazines.
+
+    FreeSlabCount - Stores the number of slabs on the free slab list.
+
+    SlabCount - Stores the total number of slabs.
+
+    SlabActiveCount - Stores the number of objects handed out by the slab
+        layer, including those sitting in magazines.
+
+    LargestSlabActiveCount - Stores the high water mark of the slab active
+        count.
+
+    FailedAllocations - Stores the number of allocations that failed.
+
+    ProcessorCount - Stores the number of elements in the processor array.
+        Processors beyond this go straight to the depot.
+
+    Processors - Stores the per-processor state array.
+
+--*/
+
+struct _OBJECT_CACHE {
+    LIST_ENTRY ListEntry;
+    ULONG Flags;
+    ULONG ObjectSize;
+    ULONG Alignment;
+    ULONG Stride;
+    ULONG SlabSize;
+    ULONG ObjectsPerSlab;
+    ULONG Tag;
+    POOL_TYPE PoolType;
+    POBJECT_CACHE_CONSTRUCTOR Constructor;
+    POBJECT_CACHE_DESTRUCTOR Destructor;
+    POBJECT_CACHE_RECLAIM Reclaim;
+    PVOID Context;
+    KSPIN_LOCK SpinLock;
+    PQUEUED_LOCK QueuedLock;
+    LIST_ENTRY PartialSlabList;
+    LIST_ENTRY FullSlabList;
+    LIST_ENTRY FreeSlabList;
+    LIST_ENTRY FullMagazineList;
+    LIST_ENTRY EmptyMagazineList;
+    UINTN FreeSlabCount;
+    UINTN SlabCount;
+    UINTN SlabActiveCount;
+    UINTN LargestSlabActiveCount;
+    volatile ULONG FailedAllocations;
+    ULONG ProcessorCount;
+    POBJECT_CACHE_PROCESSOR Processors;
+};
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+PVOID
+MmpObjectCacheAllocateSlow (
+    POBJECT_CACHE Cache
+    );
+
+VOID
+MmpObjectCacheFreeSlow (
+    POBJECT_CACHE Cache,
+    PVOID Object
+    );
+
+POBJECT_CACHE_PROCESSOR
+MmpObjectCacheGetProcessor (
+    POBJECT_CACHE Cache
+    );
+
+VOID
+MmpObjectCacheReturnMagazine (
+    POBJECT_CACHE Cache,
+    POBJECT_CACHE_MAGAZINE Magazine
+    );
+
+PVOID
+MmpObjectCacheAllocateFromSlab (
+    POBJECT_CACHE Cache
+    );
+
+POBJECT_CACHE_SLAB
+MmpObjectCacheFreeToSlab (
+    POBJECT_CACHE Cache,
+    PVOID Object
+    );
+
+POBJECT_CACHE_SLAB
+MmpCreateObjectCacheSlab (
+    POBJECT_CACHE Cache
+    );
+
+VOID
+MmpDestroyObjectCacheSlab (
+    POBJECT_CACHE Cache,
+    POBJECT_CACHE_SLAB Slab,
+    ULONG ConstructedCount
+    );
+
+PVOID
+MmpObjectCacheSlabObject (
+    POBJECT_CACHE Cache,
+    POBJECT_CACHE_SLAB Slab,
+    ULONG Index
+    );
+
+UINTN
+MmpTrimObjectCache (
+    POBJECT_CACHE Cache
+    );
+
+VOID
+MmpObjectCacheAcquireLock (
+    POBJECT_CACHE Cache,
+    PRUNLEVEL OldRunLevel
+    );
+
+VOID
+MmpObjectCacheReleaseLock (
+    POBJECT_CACHE Cache,
+    RUNLEVEL OldRunLevel
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// Store the list of all object caches, protected by a queued lock.
+//
+
+LIST_ENTRY MmObjectCacheList;
+PQUEUED_LOCK MmObjectCacheListLock;
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+KERNEL_API
+POBJECT_CACHE
+MmCreateObjectCache (
+    ULONG ObjectSize,
+    ULONG Alignment,
+    ULONG Flags,
+    ULONG Tag,
+    POBJECT_CACHE_CONSTRUCTOR Constructor,
+    POBJECT_CACHE_DESTRUCTOR Destructor,
+    POBJECT_CACHE_RECLAIM Reclaim,
+    PVOID Context
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates an object cache, which hands out fixed size objects
+    from slabs of pool memory. Each processor keeps a small magazine of free
+    objects so that most allocations and frees do not touch a shared lock.
+    This routine must be called at low level.
+
+Arguments:
+
+    ObjectSize - Supplies the size of each object, in bytes.
+
+    Alignment - Supplies the required address alignment, in bytes, for each
+        object. Valid values are powers of 2. Set to 0 to get pointer
+        alignment.
+
+    Flags - Supplies a bitfield of flags governing the cache. See
+        OBJECT_CACHE_FLAG_* definitions. Caches without the non-paged flag
+        allocate from paged pool and must only be used at low level. Non-paged
+        caches may be used at or below dispatch level.
+
+    Tag - Supplies an identifier to associate with the cache's memory, which
+        is also used to report the cache's statistics.
+
+    Constructor - Supplies an optional pointer to a routine called to
+        construct each object when its slab is created.
+
+    Destructor - Supplies an optional pointer to a routine called to destroy
+        each object when its slab is released.
+
+    Reclaim - Supplies an optional pointer to a routine called when memory is
+        tight to ask the owner to free unneeded objects.
+
+    Context - Supplies an optional context pointer passed to the callbacks.
+
+Return Value:
+
+    Returns a pointer to the object cache on success.
+
+    NULL on allocation failure.
+
+--*/
+
+{
+
+    UINTN AllocationSize;
+    POBJECT_CACHE Cache;
+    UINTN Overhead;
+    ULONG PageSize;
+    ULONG ProcessorCount;
+    UINTN SlabSize;
+    UINTN Stride;
+
+    ASSERT(KeGetRunLevel() == RunLevelLow);
+    ASSERT(ObjectSize != 0);
+
+    if (Alignment < sizeof(PVOID)) {
+        Alignment = sizeof(PVOID);
+    }
+
+    if (POWER_OF_2(Alignment) == FALSE) {
+        return NULL;
+    }
+
+    ProcessorCount = KeGetActiveProcessorCount();
+    AllocationSize = sizeof(OBJECT_CACHE) +
+                     (ProcessorCount * sizeof(OBJECT_CACHE_PROCESSOR));
+
+    Cache = MmAllocateNonPagedPool(AllocationSize, OBJECT_CACHE_ALLOCATION_TAG);
+    if (Cache == NULL) {
+        return NULL;
+    }
+
+    RtlZeroMemory(Cache, AllocationSize);
+    Cache->Flags = Flags;
+    Cache->ObjectSize = ObjectSize;
+    Cache->Alignment = Alignment;
+    Cache->Tag = Tag;
+    Cache->PoolType = PoolTypePaged;
+    if ((Flags & OBJECT_CACHE_FLAG_NON_PAGED) != 0) {
+        Cache->PoolType = PoolTypeNonPaged;
+    }
+
+    Cache->Constructor = Constructor;
+    Cache->Destructor = Destructor;
+    Cache->Reclaim = Reclaim;
+    Cache->Context = Context;
+    INITIALIZE_LIST_HEAD(&(Cache->PartialSlabList));
+    INITIALIZE_LIST_HEAD(&(Cache->FullSlabList));
+    INITIALIZE_LIST_HEAD(&(Cache->FreeSlabList));
+    INITIALIZE_LIST_HEAD(&(Cache->FullMagazineList));
+    INITIALIZE_LIST_HEAD(&(Cache->EmptyMagazineList));
+    Cache->ProcessorCount = ProcessorCount;
+    Cache->Processors = (POBJECT_CACHE_PROCESSOR)(Cache + 1);
+
+    //
+    // Each object is preceded by its buffer control structure. The slab
+    // header and worst case alignment padding come off the top of the slab.
+    //
+
+    Stride = ALIGN_RANGE_UP(sizeof(OBJECT_CACHE_BUFFER) + ObjectSize,
+                            Alignment);
+
+    Overhead = sizeof(OBJECT_CACHE_SLAB) + sizeof(OBJECT_CACHE_BUFFER) +
+               Alignment;
+
+    PageSize = MmPageSize();
+    SlabSize = PageSize;
+    if (((SlabSize - Overhead) / Stride) < OBJECT_CACHE_MINIMUM_SLAB_OBJECTS) {
+        SlabSize = (OBJECT_CACHE_MINIMUM_SLAB_OBJECTS * Stride) + Overhead;
+        SlabSize = ALIGN_RANGE_UP(SlabSize, PageSize);
+    }
+
+    if ((Stride > MAX_ULONG) || (SlabSize > MAX_ULONG)) {
+        MmFreeNonPagedPool(Cache);
+        return NULL;
+    }
+
+    Cache->Stride = Stride;
+    Cache->SlabSize = SlabSize;
+    Cache->ObjectsPerSlab = (SlabSize - Overhead) / Stride;
+    if (Cache->PoolType == PoolTypeNonPaged) {
+        KeInitializeSpinLock(&(Cache->SpinLock));
+
+    } else {
+        Cache->QueuedLock = KeCreateQueuedLock();
+        if (Cache->QueuedLock == NULL) {
+            MmFreeNonPagedPool(Cache);
+            return NULL;
+        }
+    }
+
+    KeAcquireQueuedLock(MmObjectCacheListLock);
+    INSERT_BEFORE(&(Cache->ListEntry), &MmObjectCacheList);
+    KeReleaseQueuedLock(MmObjectCacheListLock);
+    return Cache;
+}
+
+KERNEL_API
+VOID
+MmDestroyObjectCache (
+    POBJECT_CACHE Cache
+    )
+
+/*++
+
+Routine Description:
+
+    This routine destroys an object cache. Every object allocated from the
+    cache must have already been freed back to it, and no other thread may be
+    using the cache. This routine must be called at low level.
+
+Arguments:
+
+    Cache - Supplies a pointer to the object cache to destroy.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Index;
+    POBJECT_CACHE_PROCESSOR Processor;
+
+    ASSERT(KeGetRunLevel() == RunLevelLow);
+
+    KeAcquireQueuedLock(MmObjectCacheListLock);
+    LIST_REMOVE(&(Cache->ListEntry));
+    KeReleaseQueuedLock(MmObjectCacheListLock);
+
+    //
+    // Push every processor's magazines into the depot so that the trim below
+    // releases everything.
+    //
+
+    for (Index = 0; Index < Cache->ProcessorCount; Index += 1) {
+        Processor = &(Cache->Processors[Index]);
+        if (Processor->Loaded != NULL) {
+            MmpObjectCacheReturnMagazine(Cache, Processor->Loaded);
+            Processor->Loaded = NULL;
+        }
+
+        if (Processor->Previous != NULL) {
+            MmpObjectCacheReturnMagazine(Cache, Processor->Previous);
+            Processor->Previous = NULL;
+        }
+    }
+
+    MmpTrimObjectCache(Cache);
+
+    ASSERT((Cache->SlabActiveCount == 0) && (Cache->SlabCount == 0));
+
+    if (Cache->QueuedLock != NULL) {
+        KeDestroyQueuedLock(Cache->QueuedLock);
+    }
+
+    MmFreeNonPagedPool(Cache);
+    return;
+}
+
+KERNEL_API
+PVOID
+MmAllocateObject (
+    POBJECT_CACHE Cache
+    )
+
+/*++
+
+Routine Description:
+
+    This routine allocates a constructed object from an object cache.
+
+Arguments:
+
+    Cache - Supplies a pointer to the object cache.
+
+Return Value:
+
+    Returns a pointer to the object on success.
+
+    NULL on allocation failure.
+
+--*/
+
+{
+
+    POBJECT_CACHE_MAGAZINE Magazine;
+    PVOID Object;
+    RUNLEVEL OldRunLevel;
+    POBJECT_CACHE_PROCESSOR Processor;
+
+    ASSERT((Cache->PoolType == PoolTypeNonPaged) ||
+           (KeGetRunLevel() == RunLevelLow));
+
+    ASSERT(KeGetRunLevel() <= RunLevelDispatch);
+
+    //
+    // Try the loaded magazine, then the previous one if it has anything.
+    //
+
+    Object = NULL;
+    OldRunLevel = KeRaiseRunLevel(RunLevelDispatch);
+    Processor = MmpObjectCacheGetProcessor(Cache);
+    if (Processor != NULL) {
+        Magazine = Processor->Loaded;
+        if (((Magazine == NULL) || (Magazine->Count == 0)) &&
+            (Processor->Previous != NULL) &&
+            (Processor->Previous->Count != 0)) {
+
+            Processor->Loaded = Processor->Previous;
+            Processor->Previous = Magazine;
+            Magazine = Processor->Loaded;
+        }
+
+        if ((Magazine != NULL) && (Magazine->Count != 0)) {
+            Magazine->Count -= 1;
+            Object = Magazine->Objects[Magazine->Count];
+            Processor->Allocations += 1;
+        }
+    }
+
+    KeLowerRunLevel(OldRunLevel);
+    if (Object == NULL) {
+        Object = MmpObjectCacheAllocateSlow(Cache);
+    }
+
+    return Object;
+}
+
+KERNEL_API
+VOID
+MmFreeObject (
+    POBJECT_CACHE Cache,
+    PVOID Object
+    )
+
+/*++
+
+Routine Description:
+
+    This routine frees an object back to the object cache it was allocated
+    from. The object must be in its constructed state.
+
+Arguments:
+
+    Cache - Supplies a pointer to the object cache.
+
+    Object - Supplies a pointer to the object to free.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    BOOL Freed;
+    POBJECT_CACHE_MAGAZINE Magazine;
+    RUNLEVEL OldRunLevel;
+    POBJECT_CACHE_PROCESSOR Processor;
+
+    ASSERT((Cache->PoolType == PoolTypeNonPaged) ||
+           (KeGetRunLevel() == RunLevelLow));
+
+    ASSERT(KeGetRunLevel() <= RunLevelDispatch);
+    ASSERT(Object != NULL);
+
+    //
+    // Put the object in the loaded magazine, or in the previous one if that
+    // one is empty.
+    //
+
+    Freed = FALSE;
+    OldRunLevel = KeRaiseRunLevel(RunLevelDispatch);
+    Processor = MmpObjectCacheGetProcessor(Cache);
+    if (Processor != NULL) {
+        Magazine = Processor->Loaded;
+        if (((Magazine == NULL) ||
+             (Magazine->Count == OBJECT_CACHE_MAGAZINE_SIZE)) &&
+            (Processor->Previous != NULL) &&
+            (Processor->Previous->Count == 0)) {
+
+            Processor->Loaded = Processor->Previous;
+            Processor->Previous = Magazine;
+            Magazine = Processor->Loaded;
+        }
+
+        if ((Magazine != NULL) &&
+            (Magazine->Count < OBJECT_CACHE_MAGAZINE_SIZE)) {
+
+            Magazine->Objects[Magazine->Count] = Object;
+            Magazine->Count += 1;
+            Processor->Frees += 1;
+            Freed = TRUE;
+        }
+    }
+
+    KeLowerRunLevel(OldRunLevel);
+    if (Freed == FALSE) {
+        MmpObjectCacheFreeSlow(Cache, Object);
+    }
+
+    return;
+}
+
+KERNEL_API
+UINTN
+MmReclaimObjectCaches (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine asks every object cache owner to free unneeded objects, and
+    then releases the spare magazines and completely free slabs of every
+    cache. Objects sitting in per-processor magazines are left alone. This
+    routine must be called at low level.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the number of bytes of pool released.
+
+--*/
+
+{
+
+    POBJECT_CACHE Cache;
+    PLIST_ENTRY CurrentEntry;
+    UINTN Released;
+
+    ASSERT(KeGetRunLevel() == RunLevelLow);
+
+    Released = 0;
+    KeAcquireQueuedLock(MmObjectCacheListLock);
+    CurrentEntry = MmObjectCacheList.Next;
+    while (CurrentEntry != &MmObjectCacheList) {
+        Cache = LIST_VALUE(CurrentEntry, OBJECT_CACHE, ListEntry);
+        CurrentEntry = CurrentEntry->Next;
+        if (Cache->Reclaim != NULL) {
+            Cache->Reclaim(Cache, Cache->Context);
+        }
+
+        Released += MmpTrimObjectCache(Cache);
+    }
+
+    KeReleaseQueuedLock(MmObjectCacheListLock);
+    return Released;
+}
+
+KSTATUS
+MmpInitializeObjectCaches (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine initializes support for object caches. It must be called
+    after the object manager is online.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    INITIALIZE_LIST_HEAD(&MmObjectCacheList);
+    MmObjectCacheListLock = KeCreateQueuedLock();
+    if (MmObjectCacheListLock == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+KSTATUS
+MmpGetObjectCacheProfilerStatistics (
+    PVOID *Buffer,
+    PULONG BufferSize,
+    ULONG Tag
+    )
+
+/*++
+
+Routine Description:
+
+    This routine allocates a buffer from non-paged pool and fills it with a
+    profiler memory pool describing every object cache, with one tag
+    statistic per cache.
+
+Arguments:
+
+    Buffer - Supplies a pointer that receives the buffer of statistics.
+
+    BufferSize - Supplies a pointer that receives the size of the buffer, in
+        bytes.
+
+    Tag - Supplies the allocation tag to use for the buffer.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    ULONGLONG Allocations;
+    POBJECT_CACHE Cache;
+    ULONG CacheCount;
+    PLIST_ENTRY CurrentEntry;
+    ULONGLONG Frees;
+    ULONG Index;
+    UINTN LargestActive;
+    RUNLEVEL OldRunLevel;
+    POBJECT_CACHE_PROCESSOR Processor;
+    PPROFILER_MEMORY_POOL ProfilerPool;
+    ULONGLONG SlabBytes;
+    PPROFILER_MEMORY_POOL_TAG_STATISTIC Statistic;
+    ULONG TotalSize;
+
+    ASSERT(KeGetRunLevel() == RunLevelLow);
+
+    KeAcquireQueuedLock(MmObjectCacheListLock);
+    CacheCount = 0;
+    CurrentEntry = MmObjectCacheList.Next;
+    while (CurrentEntry != &MmObjectCacheList) {
+        CacheCount += 1;
+        CurrentEntry = CurrentEntry->Next;
+    }
+
+    TotalSize = sizeof(PROFILER_MEMORY_POOL) +
+                (CacheCount * sizeof(PROFILER_MEMORY_POOL_TAG_STATISTIC));
+
+    ProfilerPool = MmAllocateNonPagedPool(TotalSize, Tag);
+    if (ProfilerPool == NULL) {
+        KeReleaseQueuedLock(MmObjectCacheListLock);
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    RtlZeroMemory(ProfilerPool, TotalSize);
+    ProfilerPool->Magic = PROFILER_POOL_MAGIC;
+    ProfilerPool->TagCount = CacheCount;
+    ProfilerPool->ProfilerMemoryType = ProfilerMemoryTypeObjectCache;
+    Statistic = (PPROFILER_MEMORY_POOL_TAG_STATISTIC)(ProfilerPool + 1);
+    CurrentEntry = MmObjectCacheList.Next;
+    while (CurrentEntry != &MmObjectCacheList) {
+        Cache = LIST_VALUE(CurrentEntry, OBJECT_CACHE, ListEntry);
+        CurrentEntry = CurrentEntry->Next;
+
+        //
+        // The per-processor counters are read without synchronization, so
+        // the totals are only a snapshot.
+        //
+
+        Allocations = 0;
+        Frees = 0;
+        for (Index = 0; Index < Cache->ProcessorCount; Index += 1) {
+            Processor = &(Cache->Processors[Index]);
+            Allocations += Processor->Allocations;
+            Frees += Processor->Frees;
+        }
+
+        MmpObjectCacheAcquireLock(Cache, &OldRunLevel);
+        SlabBytes = (ULONGLONG)Cache->SlabCount * Cache->SlabSize;
+        LargestActive = Cache->LargestSlabActiveCount;
+        MmpObjectCacheReleaseLock(Cache, OldRunLevel);
+        if (Frees > Allocations) {
+            Frees = Allocations;
+        }
+
+        Statistic->Tag = Cache->Tag;
+        Statistic->LargestAllocation = Cache->ObjectSize;
+        Statistic->ActiveAllocationCount = Allocations - Frees;
+        Statistic->ActiveSize = (Allocations - Frees) * Cache->ObjectSize;
+        Statistic->LargestActiveAllocationCount = LargestActive;
+        Statistic->LargestActiveSize = (ULONGLONG)LargestActive *
+                                       Cache->ObjectSize;
+
+        Statistic->LifetimeAllocationSize = Allocations * Cache->ObjectSize;
+        ProfilerPool->TotalPoolSize += SlabBytes;
+        if (SlabBytes > Statistic->ActiveSize) {
+            ProfilerPool->FreeListSize += SlabBytes - Statistic->ActiveSize;
+        }
+
+        ProfilerPool->TotalAllocationCalls += Allocations;
+        ProfilerPool->TotalFreeCalls += Frees;
+        ProfilerPool->FailedAllocations += Cache->FailedAllocations;
+        Statistic += 1;
+    }
+
+    KeReleaseQueuedLock(MmObjectCacheListLock);
+    *Buffer = ProfilerPool;
+    *BufferSize = TotalSize;
+    return STATUS_SUCCESS;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+PVOID
+MmpObjectCacheAllocateSlow (
+    POBJECT_CACHE Cache
+    )
+
+/*++
+
+Routine Description:
+
+    This routine allocates an object when the current processor's magazines
+    are empty. It reloads the processor from the depot if there is a full
+    magazine, and otherwise allocates straight from the slab layer, growing
+    the cache if needed.
+
+Arguments:
+
+    Cache - Supplies a pointer to the object cache.
+
+Return Value:
+
+    Returns a pointer to the object on success.
+
+    NULL on allocation failure.
+
+--*/
+
+{
+
+    POBJECT_CACHE_MAGAZINE Displaced;
+    POBJECT_CACHE_MAGAZINE Magazine;
+    PVOID Object;
+    RUNLEVEL OldRunLevel;
+    POBJECT_CACHE_PROCESSOR Processor;
+    POBJECT_CACHE_SLAB Slab;
+
+    Magazine = NULL;
+    MmpObjectCacheAcquireLock(Cache, &OldRunLevel);
+    if (!LIST_EMPTY(&(Cache->FullMagazineList))) {
+        Magazine = LIST_VALUE(Cache->FullMagazineList.Next,
+                              OBJECT_CACHE_MAGAZINE,
+                              ListEntry);
+
+        LIST_REMOVE(&(Magazine->ListEntry));
+    }
+
+    MmpObjectCacheReleaseLock(Cache, OldRunLevel);
+
+    //
+    // Load the full magazine, pushing out the previous magazine. The thread
+    // may have changed processors since the fast path, so whatever state the
+    // displaced magazine is in goes back to the depot.
+    //
+
+    if (Magazine != NULL) {
+
+        ASSERT(Magazine->Count != 0);
+
+        Displaced = Magazine;
+        OldRunLevel = KeRaiseRunLevel(RunLevelDispatch);
+        Magazine->Count -= 1;
+        Object = Magazine->Objects[Magazine->Count];
+        Processor = MmpObjectCacheGetProcessor(Cache);
+        if (Processor != NULL) {
+            Displaced = Processor->Previous;
+            Processor->Previous = Processor->Loaded;
+            Processor->Loaded = Magazine;
+            Processor->Allocations += 1;
+        }
+
+        KeLowerRunLevel(OldRunLevel);
+        if (Displaced != NULL) {
+            MmpObjectCacheReturnMagazine(Cache, Displaced);
+        }
+
+        if (Processor != NULL) {
+            return Object;
+        }
+
+    //
+    // The depot is dry, so go to the slabs.
+    //
+
+    } else {
+        MmpObjectCacheAcquireLock(Cache, &OldRunLevel);
+        Object = MmpObjectCacheAllocateFromSlab(Cache);
+        MmpObjectCacheReleaseLock(Cache, OldRunLevel);
+        if (Object == NULL) {
+            Slab = MmpCreateObjectCacheSlab(Cache);
+            if (Slab == NULL) {
+                RtlAtomicAdd32(&(Cache->FailedAllocations), 1);
+                return NULL;
+            }
+
+            MmpObjectCacheAcquireLock(Cache, &OldRunLevel);
+            INSERT_BEFORE(&(Slab->ListEntry), &(Cache->FreeSlabList));
+            Cache->FreeSlabCount += 1;
+            Cache->SlabCount += 1;
+            Object = MmpObjectCacheAllocateFromSlab(Cache);
+            MmpObjectCacheReleaseLock(Cache, OldRunLevel);
+
+            ASSERT(Object != NULL);
+        }
+    }
+
+    //
+    // Count the allocation against whichever processor is current, or the
+    // first one if this processor has no state of its own.
+    //
+
+    OldRunLevel = KeRaiseRunLevel(RunLevelDispatch);
+    Processor = MmpObjectCacheGetProcessor(Cache);
+    if (Processor == NULL) {
+        Processor = &(Cache->Processors[0]);
+        RtlAtomicAdd64(&(Processor->Allocations), 1);
+
+    } else {
+        Processor->Allocations += 1;
+    }
+
+    KeLowerRunLevel(OldRunLevel);
+    return Object;
+}
+
+VOID
+MmpObjectCacheFreeSlow (
+    POBJECT_CACHE Cache,
+    PVOID Object
+    )
+
+/*++
+
+Routine Description:
+
+    This routine frees an object when the current processor's magazines are
+    full. It loads an empty magazine from the depot (or a new one) and pushes
+    the previous magazine out to the depot. If no magazine can be had, the
+    object goes straight back to its slab.
+
+Arguments:
+
+    Cache - Supplies a pointer to the object cache.
+
+    Object - Supplies a pointer to the object to free.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    POBJECT_CACHE_MAGAZINE Displaced;
+    POBJECT_CACHE_MAGAZINE Magazine;
+    RUNLEVEL OldRunLevel;
+    POBJECT_CACHE_PROCESSOR Processor;
+    POBJECT_CACHE_SLAB Slab;
+
+    Magazine = NULL;
+    MmpObjectCacheAcquireLock(Cache, &OldRunLevel);
+    if (!LIST_EMPTY(&(Cache->EmptyMagazineList))) {
+        Magazine = LIST_VALUE(Cache->EmptyMagazineList.Next,
+                              OBJECT_CACHE_MAGAZINE,
+                              ListEntry);
+
+        LIST_REMOVE(&(Magazine->ListEntry));
+    }
+
+    MmpObjectCacheReleaseLock(Cache, OldRunLevel);
+    if (Magazine == NULL) {
+        Magazine = MmAllocateNonPagedPool(sizeof(OBJECT_CACHE_MAGAZINE),
+                                          OBJECT_CACHE_ALLOCATION_TAG);
+
+        if (Magazine != NULL) {
+            Magazine->Count = 0;
+        }
+    }
+
+    Displaced = NULL;
+    OldRunLevel = KeRaiseRunLevel(RunLevelDispatch);
+    Processor = MmpObjectCacheGetProcessor(Cache);
+    if ((Processor != NULL) && (Magazine != NULL)) {
+
+        ASSERT(Magazine->Count == 0);
+
+        Magazine->Objects[0] = Object;
+        Magazine->Count = 1;
+        Displaced = Processor->Previous;
+        Processor->Previous = Processor->Loaded;
+        Processor->Loaded = Magazine;
+        Processor->Frees += 1;
+        Magazine = NULL;
+        Object = NULL;
+    }
+
+    KeLowerRunLevel(OldRunLevel);
+    if (Displaced != NULL) {
+        MmpObjectCacheReturnMagazine(Cache, Displaced);
+    }
+
+    if (Magazine != NULL) {
+        MmpObjectCacheReturnMagazine(Cache, Magazine);
+    }
+
+    //
+    // Without a magazine to put it in, the object goes back to its slab.
+    //
+
+    if (Object != NULL) {
+        MmpObjectCacheAcquireLock(Cache, &OldRunLevel);
+        Slab = MmpObjectCacheFreeToSlab(Cache, Object);
+        MmpObjectCacheReleaseLock(Cache, OldRunLevel);
+        if (Slab != NULL) {
+            MmpDestroyObjectCacheSlab(Cache, Slab, Cache->ObjectsPerSlab);
+        }
+
+        OldRunLevel = KeRaiseRunLevel(RunLevelDispatch);
+        Processor = MmpObjectCacheGetProcessor(Cache);
+        if (Processor == NULL) {
+            Processor = &(Cache->Processors[0]);
+            RtlAtomicAdd64(&(Processor->Frees), 1);
+
+        } else {
+            Processor->Frees += 1;
+        }
+
+        KeLowerRunLevel(OldRunLevel);
+    }
+
+    return;
+}
+
+POBJECT_CACHE_PROCESSOR
+MmpObjectCacheGetProcessor (
+    POBJECT_CACHE Cache
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the current processor's state for an object cache.
+    This routine must be called at dispatch level.
+
+Arguments:
+
+    Cache - Supplies a pointer to the object cache.
+
+Return Value:
+
+    Returns a pointer to the current processor's cache state.
+
+    NULL if the processor came online after the cache was created.
+
+--*/
+
+{
+
+    ULONG Number;
+
+    ASSERT(KeGetRunLevel() == RunLevelDispatch);
+
+    Number = KeGetCurrentProcessorNumber();
+    if (Number >= Cache->ProcessorCount) {
+        return NULL;
+    }
+
+    return &(Cache->Processors[Number]);
+}
+
+VOID
+MmpObjectCacheReturnMagazine (
+    POBJECT_CACHE Cache,
+    POBJECT_CACHE_MAGAZINE Magazine
+    )
+
+/*++
+
+Routine Description:
+
+    This routine puts a magazine in the depot.
+
+Arguments:
+
+    Cache - Supplies a pointer to the object cache.
+
+    Magazine - Supplies a pointer to the magazine to return.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    RUNLEVEL OldRunLevel;
+
+    MmpObjectCacheAcquireLock(Cache, &OldRunLevel);
+    if (Magazine->Count == 0) {
+        INSERT_BEFORE(&(Magazine->ListEntry), &(Cache->EmptyMagazineList));
+
+    } else {
+        INSERT_BEFORE(&(Magazine->ListEntry), &(Cache->FullMagazineList));
+    }
+
+    MmpObjectCacheReleaseLock(Cache, OldRunLevel);
+    return;
+}
+
+PVOID
+MmpObjectCacheAllocateFromSlab (
+    POBJECT_CACHE Cache
+    )
+
+/*++
+
+Routine Description:
+
+    This routine allocates an object from a partially used or free slab. This
+    routine assumes the cache lock is held.
+
+Arguments:
+
+    Cache - Supplies a pointer to the object cache.
+
+Return Value:
+
+    Returns a pointer to an object on success.
+
+    NULL if there are no free objects in any slab.
+
+--*/
+
+{
+
+    POBJECT_CACHE_BUFFER Buffer;
+    PVOID Object;
+    POBJECT_CACHE_SLAB Slab;
+
+    if (!LIST_EMPTY(&(Cache->PartialSlabList))) {
+        Slab = LIST_VALUE(Cache->PartialSlabList.Next,
+                          OBJECT_CACHE_SLAB,
+                          ListEntry);
+
+    } else if (!LIST_EMPTY(&(Cache->FreeSlabList))) {
+        Slab = LIST_VALUE(Cache->FreeSlabList.Next,
+                          OBJECT_CACHE_SLAB,
+                          ListEntry);
+
+        LIST_REMOVE(&(Slab->ListEntry));
+        INSERT_AFTER(&(Slab->ListEntry), &(Cache->PartialSlabList));
+
+        ASSERT(Cache->FreeSlabCount != 0);
+
+        Cache->FreeSlabCount -= 1;
+
+    } else {
+        return NULL;
+    }
+
+    ASSERT((Slab->FreeCount != 0) && (Slab->FreeList != NULL));
+
+    Object = Slab->FreeList;
+    Buffer = OBJECT_CACHE_BUFFER(Object);
+
+    ASSERT(Buffer->Slab == Slab);
+
+    Slab->FreeList = Buffer->NextFree;
+    Buffer->NextFree = NULL;
+    Slab->FreeCount -= 1;
+    if (Slab->FreeCount == 0) {
+        LIST_REMOVE(&(Slab->ListEntry));
+        INSERT_BEFORE(&(Slab->ListEntry), &(Cache->FullSlabList));
+    }
+
+    Cache->SlabActiveCount += 1;
+    if (Cache->SlabActiveCount > Cache->LargestSlabActiveCount) {
+        Cache->LargestSlabActiveCount = Cache->SlabActiveCount;
+    }
+
+    return Object;
+}
+
+POBJECT_CACHE_SLAB
+MmpObjectCacheFreeToSlab (
+    POBJECT_CACHE Cache,
+    PVOID Object
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns an object to its slab. This routine assumes the cache
+    lock is held.
+
+Arguments:
+
+    Cache - Supplies a pointer to the object cache.
+
+    Object - Supplies a pointer to the object to free.
+
+Return Value:
+
+    Returns a pointer to a completely free slab that was removed from the
+    cache because the cache already has enough free slabs. The caller should
+    destroy it after releasing the lock.
+
+    NULL if no slab needs to be destroyed.
+
+--*/
+
+{
+
+    POBJECT_CACHE_BUFFER Buffer;
+    POBJECT_CACHE_SLAB Slab;
+
+    Buffer = OBJECT_CACHE_BUFFER(Object);
+    Slab = Buffer->Slab;
+
+    ASSERT((Slab->FreeCount < Cache->ObjectsPerSlab) &&
+           (Cache->SlabActiveCount != 0));
+
+    Buffer->NextFree = Slab->FreeList;
+    Slab->FreeList = Object;
+    Slab->FreeCount += 1;
+    Cache->SlabActiveCount -= 1;
+    if (Slab->FreeCount == 1) {
+        LIST_REMOVE(&(Slab->ListEntry));
+        INSERT_AFTER(&(Slab->ListEntry), &(Cache->PartialSlabList));
+    }
+
+    if (Slab->FreeCount == Cache->ObjectsPerSlab) {
+        LIST_REMOVE(&(Slab->ListEntry));
+        if (Cache->FreeSlabCount >= OBJECT_CACHE_FREE_SLAB_LIMIT) {
+            Cache->SlabCount -= 1;
+            return Slab;
+        }
+
+        INSERT_BEFORE(&(Slab->ListEntry), &(Cache->FreeSlabList));
+        Cache->FreeSlabCount += 1;
+    }
+
+    return NULL;
+}
+
+POBJECT_CACHE_SLAB
+MmpCreateObjectCacheSlab (
+    POBJECT_CACHE Cache
+    )
+
+/*++
+
+Routine Description:
+
+    This routine allocates a new slab and constructs all of its objects. The
+    slab is not yet inserted in the cache.
+
+Arguments:
+
+    Cache - Supplies a pointer to the object cache.
+
+Return Value:
+
+    Returns a pointer to the new slab on success.
+
+    NULL on allocation or construction failure.
+
+--*/
+
+{
+
+    POBJECT_CACHE_BUFFER Buffer;
+    ULONG Index;
+    PVOID Object;
+    POBJECT_CACHE_SLAB Slab;
+    KSTATUS Status;
+
+    Slab = MmAllocatePool(Cache->PoolType, Cache->SlabSize, Cache->Tag);
+    if (Slab == NULL) {
+        return NULL;
+    }
+
+    Slab->FreeList = NULL;
+    Slab->FreeCount = Cache->ObjectsPerSlab;
+
+    //
+    // Construct the objects and thread them onto the free list, highest
+    // address last so allocations march up through the slab.
+    //
+
+    Index = Cache->ObjectsPerSlab;
+    while (Index != 0) {
+        Index -= 1;
+        Object = MmpObjectCacheSlabObject(Cache, Slab, Index);
+        Buffer = OBJECT_CACHE_BUFFER(Object);
+        Buffer->Slab = Slab;
+        Buffer->NextFree = Slab->FreeList;
+        Slab->FreeList = Object;
+    }
+
+    if (Cache->Constructor != NULL) {
+        for (Index = 0; Index < Cache->ObjectsPerSlab; Index += 1) {
+            Object = MmpObjectCacheSlabObject(Cache, Slab, Index);
+            Status = Cache->Constructor(Object, Cache->Context);
+            if (!KSUCCESS(Status)) {
+                MmpDestroyObjectCacheSlab(Cache, Slab, Index);
+                return NULL;
+            }
+        }
+    }
+
+    return Slab;
+}
+
+VOID
+MmpDestroyObjectCacheSlab (
+    POBJECT_CACHE Cache,
+    POBJECT_CACHE_SLAB Slab,
+    ULONG ConstructedCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine destroys the objects in a slab and frees it. The slab must
+    not be in any of the cache's lists.
+
+Arguments:
+
+    Cache - Supplies a pointer to the object cache.
+
+    Slab - Supplies a pointer to the slab to destroy.
+
+    ConstructedCount - Supplies the number of objects in the slab, starting
+        at the beginning, that were constructed.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Index;
+    PVOID Object;
+
+    if (Cache->Destructor != NULL) {
+        for (Index = 0; Index < ConstructedCount; Index += 1) {
+            Object = MmpObjectCacheSlabObject(Cache, Slab, Index);
+            Cache->Destructor(Object, Cache->Context);
+        }
+    }
+
+    MmFreePool(Cache->PoolType, Slab);
+    return;
+}
+
+PVOID
+MmpObjectCacheSlabObject (
+    POBJECT_CACHE Cache,
+    POBJECT_CACHE_SLAB Slab,
+    ULONG Index
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the address of an object within a slab.
+
+Arguments:
+
+    Cache - Supplies a pointer to the object cache.
+
+    Slab - Supplies a pointer to the slab.
+
+    Index - Supplies the index of the object within the slab.
+
+Return Value:
+
+    Returns a pointer to the object.
+
+--*/
+
+{
+
+    UINTN First;
+
+    First = (UINTN)(Slab + 1) + sizeof(OBJECT_CACHE_BUFFER);
+    First = ALIGN_RANGE_UP(First, Cache->Alignment);
+    return (PVOID)(First + ((UINTN)Index * Cache->Stride));
+}
+
+UINTN
+MmpTrimObjectCache (
+    POBJECT_CACHE Cache
+    )
+
+/*++
+
+Routine Description:
+
+    This routine empties the depot of an object cache back into its slabs,
+    frees the depot's magazines, and releases every completely free slab.
+    This routine must be called at low level.
+
+Arguments:
+
+    Cache - Supplies a pointer to the object cache.
+
+Return Value:
+
+    Returns the number of bytes of pool released.
+
+--*/
+
+{
+
+    LIST_ENTRY FreeMagazines;
+    LIST_ENTRY FreeSlabs;
+    ULONG Index;
+    POBJECT_CACHE_MAGAZINE Magazine;
+    RUNLEVEL OldRunLevel;
+    UINTN Released;
+    POBJECT_CACHE_SLAB Slab;
+
+    ASSERT(KeGetRunLevel() == RunLevelLow);
+
+    INITIALIZE_LIST_HEAD(&FreeMagazines);
+    INITIALIZE_LIST_HEAD(&FreeSlabs);
+    Released = 0;
+    MmpObjectCacheAcquireLock(Cache, &OldRunLevel);
+    while (!LIST_EMPTY(&(Cache->FullMagazineList))) {
+        Magazine = LIST_VALUE(Cache->FullMagazineList.Next,
+                              OBJECT_CACHE_MAGAZINE,
+                              ListEntry);
+
+        LIST_REMOVE(&(Magazine->ListEntry));
+        for (Index = 0; Index < Magazine->Count; Index += 1) {
+            Slab = MmpObjectCacheFreeToSlab(Cache, Magazine->Objects[Index]);
+            if (Slab != NULL) {
+                INSERT_BEFORE(&(Slab->ListEntry), &FreeSlabs);
+            }
+        }
+
+        INSERT_BEFORE(&(Magazine->ListEntry), &FreeMagazines);
+    }
+
+    if (!LIST_EMPTY(&(Cache->EmptyMagazineList))) {
+        APPEND_LIST(&(Cache->EmptyMagazineList), &FreeMagazines);
+        INITIALIZE_LIST_HEAD(&(Cache->EmptyMagazineList));
+    }
+
+    while (!LIST_EMPTY(&(Cache->FreeSlabList))) {
+        Slab = LIST_VALUE(Cache->FreeSlabList.Next,
+                          OBJECT_CACHE_SLAB,
+                          ListEntry);
+
+        LIST_REMOVE(&(Slab->ListEntry));
+        INSERT_BEFORE(&(Slab->ListEntry), &FreeSlabs);
+        Cache->FreeSlabCount -= 1;
+        Cache->SlabCount -= 1;
+    }
+
+    MmpObjectCacheReleaseLock(Cache, OldRunLevel);
+
+    //
+    // Destroy everything now that the lock is released, since destructors
+    // may need to block.
+    //
+
+    while (!LIST_EMPTY(&FreeMagazines)) {
+        Magazine = LIST_VALUE(FreeMagazines.Next,
+                              OBJECT_CACHE_MAGAZINE,
+                              ListEntry);
+
+        LIST_REMOVE(&(Magazine->ListEntry));
+        MmFreeNonPagedPool(Magazine);
+        Released += sizeof(OBJECT_CACHE_MAGAZINE);
+    }
+
+    while (!LIST_EMPTY(&FreeSlabs)) {
+        Slab = LIST_VALUE(FreeSlabs.Next, OBJECT_CACHE_SLAB, ListEntry);
+        LIST_REMOVE(&(Slab->ListEntry));
+        MmpDestroyObjectCacheSlab(Cache, Slab, Cache->ObjectsPerSlab);
+        Released += Cache->SlabSize;
+    }
+
+    return Released;
+}
+
+VOID
+MmpObjectCacheAcquireLock (
+    POBJECT_CACHE Cache,
+    PRUNLEVEL OldRunLevel
+    )
+
+/*++
+
+Routine Description:
+
+    This routine acquires the lock protecting an object cache's depot and
+    slabs. Non-paged caches use a spin lock at dispatch level, and paged
+    caches use a queued lock.
+
+Arguments:
+
+    Cache - Supplies a pointer to the object cache.
+
+    OldRunLevel - Supplies a pointer where the previous run level is returned
+        for non-paged caches.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if (Cache->PoolType == PoolTypeNonPaged) {
+        *OldRunLevel = KeRaiseRunLevel(RunLevelDispatch);
+        KeAcquireSpinLock(&(Cache->SpinLock));
+
+    } else {
+
+        ASSERT(KeGetRunLevel() == RunLevelLow);
+
+        *OldRunLevel = RunLevelLow;
+        KeAcquireQueuedLock(Cache->QueuedLock);
+    }
+
+    return;
+}
+
+VOID
+MmpObjectCacheReleaseLock (
+    POBJECT_CACHE Cache,
+    RUNLEVEL OldRunLevel
+    )
+
+/*++
+
+Routine Description:
+
+    This routine releases the lock protecting an object cache's depot and
+    slabs.
+
+Arguments:
+
+    Cache - Supplies a pointer to the object cache.
+
+    OldRunLevel - Supplies the run level returned when the lock was acquired.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if (Cache->PoolType == PoolTypeNonPaged) {
+        KeReleaseSpinLock(&(Cache->SpinLock));
+        KeLowerRunLevel(OldRunLevel);
+
+    } else {
+        KeReleaseQueuedLock(Cache->QueuedLock);
+    }
+
+    return;
+}
+
@@ -59,6 +59,14 @@ Module Name:
 
 #define PAGE_OUT_MAX_CLEAN_STREAK 4
 
+//
+// Define how often, in milliseconds, the paging thread wakes up on its own to
+// age pageable pages, and the most pages it examines each time.
+//
+
+#define PAGE_AGING_INTERVAL 1000
+#define PAGE_AGING_SCAN_LIMIT 512
+
 //
 // Define the alignment and initial capacity for the paging entry block
 // allocator.
@@ -299,6 +307,12 @@ MmpPageFilePerformIo (
     PPAGE_FILE_IO_CONTEXT IoContext
     );
 
+KSTATUS
+MmpPageFileDeviceIo (
+    PPAGE_FILE PageFile,
+    PPAGE_FILE_IO_CONTEXT IoContext
+    );
+
 KSTATUS
 MmpReadBackingImage (
     PIMAGE_SECTION Section,
@@ -776,7 +790,10 @@ Return Value:
     }
 
     MmPagingEntryBlockAllocator = BlockAllocator;
-    Status = STATUS_SUCCESS;
+    Status = MmpInitializeCompressedSwap();
+    if (!KSUCCESS(Status)) {
+        goto InitializePagingEnd;
+    }
 
 InitializePagingEnd:
     if (!KSUCCESS(Status)) {
@@ -800,6 +817,49 @@ Return Value:
     return Status;
 }
 
+KSTATUS
+MmpWritePageFilePage (
+    PVOID PageFile,
+    UINTN PageIndex,
+    PIO_BUFFER IoBuffer
+    )
+
+/*++
+
+Routine Description:
+
+    This routine writes a single page directly to a page file, bypassing the
+    compressed swap store.
+
+Arguments:
+
+    PageFile - Supplies a pointer to the page file.
+
+    PageIndex - Supplies the index of the page within the page file.
+
+    IoBuffer - Supplies a pointer to the I/O buffer holding the page.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    PAGE_FILE_IO_CONTEXT IoContext;
+
+    IoContext.Offset = PageIndex << MmPageShift();
+    IoContext.IoBuffer = IoBuffer;
+    IoContext.Irp = NULL;
+    IoContext.SizeInBytes = MmPageSize();
+    IoContext.BytesCompleted = 0;
+    IoContext.Flags = 0;
+    IoContext.TimeoutInMilliseconds = WAIT_TIME_INDEFINITE;
+    IoContext.Write = TRUE;
+    return MmpPageFileDeviceIo(PageFile, &IoContext);
+}
+
 KSTATUS
 MmAllocatePageFileSpace (
     PIMAGE_BACKING ImageBacking,
@@ -2062,6 +2122,8 @@ Return Value:
 
 {
 
+    ASSERT(PagingEntry->PageList == PageListNone);
+
     if (PagingEntry->Section != NULL) {
         MmpImageSectionReleaseReference(PagingEntry->Section);
         PagingEntry->Section = NULL;
@@ -2183,6 +2245,13 @@ Return Value:
 
     KeRegisterCrashDumpFile(Handle, TRUE);
 
+    //
+    // Set up the compressed swap store that sits in front of the page files.
+    // This is also not fatal, pages just go straight to the page file.
+    //
+
+    MmpActivateCompressedSwap();
+
     //
     // Synchronize with the arrival of other page files. The first arriving
     // page file should create all necessary events if they aren't already
@@ -2516,6 +2585,7 @@ Return Value:
 
     ASSERT(KeGetRunLevel() == RunLevelLow);
 
+    MmpCompressedSwapInvalidate(PageFile, Allocation, PageCount);
     KeAcquireQueuedLock(PageFile->Lock);
     for (CurrentIndex = Allocation;
          CurrentIndex < Allocation + PageCount;
@@ -2549,8 +2619,10 @@ MmpPagingThread (
 Routine Description:
 
     This routine attempts to release physical page pressure by paging out
-    pages or removing them from the page cache if memory is tight. This runs
-    on its own thread, which cannot allocate memory or touch paged pool.
+    pages or removing them from the page cache if memory is tight. When idle,
+    it periodically ages pageable pages so that the inactive list is stocked
+    before memory gets tight. This runs on its own thread, which cannot
+    allocate memory or touch paged pool.
 
 Arguments:
 
@@ -2629,10 +2701,23 @@ Return Value:
         Status = ObWaitOnObjects(WaitObjectArray,
                                  2,
                                  0,
-                                 WAIT_TIME_INDEFINITE,
+                                 PAGE_AGING_INTERVAL,
                                  NULL,
                                  &SignalingObject);
 
+        //
+        // If nothing happened for a while, take the opportunity to age some
+        // pages.
+        //
+
+        if (Status == STATUS_TIMEOUT) {
+            if (MmPagingEnabled != FALSE) {
+                MmpAgePhysicalPages(PAGE_AGING_SCAN_LIMIT);
+            }
+
+            continue;
+        }
+
         ASSERT(KSUCCESS(Status));
 
         //
@@ -5018,10 +5103,18 @@ Return Value:
 
 {
 
-    PDEVICE Device;
-    PIRP Irp;
+    UINTN BufferOffset;
+    UINTN BytesCompleted;
+    PIO_BUFFER IoBuffer;
+    UINTN PageCount;
     PPAGE_FILE PageFile;
+    UINTN PageFileIndex;
+    UINTN PageIndex;
+    ULONG PageShift;
+    PAGE_FILE_IO_CONTEXT RunContext;
+    UINTN RunStart;
     KSTATUS Status;
+    BOOL Stored;
 
     PageFile = (PPAGE_FILE)ImageBacking->DeviceHandle;
     IoContext->Offset = ImageBacking->Offset + IoContext->Offset;
@@ -5029,6 +5122,120 @@ Return Value:
     ASSERT(IS_ALIGNED(IoContext->SizeInBytes, MmPageSize()) != FALSE);
     ASSERT(IS_ALIGNED(IoContext->Offset, MmPageSize()) != FALSE);
 
+    //
+    // Go straight to the device if the compressed swap store is not in use.
+    // The store needs the buffer mapped to get at the data, which should be
+    // free for the paging thread's buffers as they are always mapped.
+    //
+
+    IoBuffer = IoContext->IoBuffer;
+    if (MmpIsCompressedSwapActive() == FALSE) {
+        return MmpPageFileDeviceIo(PageFile, IoContext);
+    }
+
+    Status = MmMapIoBuffer(IoBuffer, FALSE, FALSE, FALSE);
+    if (!KSUCCESS(Status)) {
+        return MmpPageFileDeviceIo(PageFile, IoContext);
+    }
+
+    //
+    // Offer each page to the compressed swap store, and send the runs of
+    // pages the store did not take to the page file.
+    //
+
+    PageShift = MmPageShift();
+    PageCount = IoContext->SizeInBytes >> PageShift;
+    PageFileIndex = IoContext->Offset >> PageShift;
+    BytesCompleted = 0;
+    RunStart = 0;
+    for (PageIndex = 0; PageIndex <= PageCount; PageIndex += 1) {
+        if (PageIndex < PageCount) {
+            BufferOffset = PageIndex << PageShift;
+            if (IoContext->Write != FALSE) {
+                Stored = MmpCompressedSwapStore(PageFile,
+                                                PageFileIndex + PageIndex,
+                                                IoBuffer,
+                                                BufferOffset);
+
+            } else {
+                Status = MmpCompressedSwapLoad(PageFile,
+                                               PageFileIndex + PageIndex,
+                                               IoBuffer,
+                                               BufferOffset);
+
+                if ((!KSUCCESS(Status)) && (Status != STATUS_NOT_FOUND)) {
+                    goto PageFilePerformIoEnd;
+                }
+
+                Stored = KSUCCESS(Status);
+            }
+
+            if (Stored == FALSE) {
+                continue;
+            }
+        }
+
+        if (PageIndex != RunStart) {
+            BufferOffset = RunStart << PageShift;
+            RtlCopyMemory(&RunContext, IoContext, sizeof(PAGE_FILE_IO_CONTEXT));
+            RunContext.Offset = IoContext->Offset + BufferOffset;
+            RunContext.SizeInBytes = (PageIndex - RunStart) << PageShift;
+            RunContext.BytesCompleted = 0;
+            MmIoBufferIncrementOffset(IoBuffer, BufferOffset);
+            Status = MmpPageFileDeviceIo(PageFile, &RunContext);
+            MmIoBufferDecrementOffset(IoBuffer, BufferOffset);
+            BytesCompleted += RunContext.BytesCompleted;
+            if (!KSUCCESS(Status)) {
+                goto PageFilePerformIoEnd;
+            }
+        }
+
+        if (PageIndex < PageCount) {
+            BytesCompleted += 1 << PageShift;
+        }
+
+        RunStart = PageIndex + 1;
+    }
+
+    Status = STATUS_SUCCESS;
+
+PageFilePerformIoEnd:
+    IoContext->BytesCompleted = BytesCompleted;
+    return Status;
+}
+
+KSTATUS
+MmpPageFileDeviceIo (
+    PPAGE_FILE PageFile,
+    PPAGE_FILE_IO_CONTEXT IoContext
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs I/O directly against a page file's device, bypassing
+    the compressed swap store.
+
+Arguments:
+
+    PageFile - Supplies a pointer to the page file.
+
+    IoContext - Supplies a pointer to the page file I/O context. The offset is
+        relative to the start of the page file.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    PDEVICE Device;
+    PIRP Irp;
+    KSTATUS Status;
+
     //
     // All page file writes must be serialized. If the file system's block size
     // is greater than a page, it may perform a read-modify-write operation. If
@@ -5054,13 +5261,13 @@ Return Value:
         if (Irp == NULL) {
             Status = IoGetDevice(PageFile->Handle, &Device);
             if (!KSUCCESS(Status)) {
-                goto PageFilePerformIoEnd;
+                goto PageFileDeviceIoEnd;
             }
 
             Irp = IoCreateIrp(Device, IrpMajorIo, IRP_CREATE_FLAG_NO_ALLOCATE);
             if (Irp == NULL) {
                 Status = STATUS_INSUFFICIENT_RESOURCES;
-                goto PageFilePerformIoEnd;
+                goto PageFileDeviceIoEnd;
             }
         }
 
@@ -5078,7 +5285,7 @@ Return Value:
         }
     }
 
-PageFilePerformIoEnd:
+PageFileDeviceIoEnd:
     return Status;
 }
 
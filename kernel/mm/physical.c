@@ -101,6 +101,20 @@ Module Name:
 
 #define PAGING_EVENT_SIGNAL_PAGE_COUNT 0x10
 
+//
+// Define the number of page list entries examined per acquisition of the
+// physical page lock when aging or reclaiming pages.
+//
+
+#define PAGE_LIST_BATCH_SIZE 32
+
+//
+// Define the share of pageable pages that aging tries to keep on the inactive
+// list, as a percentage.
+//
+
+#define INACTIVE_PAGE_LIST_PERCENT 33
+
 //
 // --------------------------------------------------------------------- Macros
 //
@@ -127,7 +141,6 @@ Module Name:
 typedef enum _PHYSICAL_MEMORY_SEARCH_TYPE {
     PhysicalMemoryFindInvalid,
     PhysicalMemoryFindFree,
-    PhysicalMemoryFindPagable,
     PhysicalMemoryFindIdentityMappable
 } PHYSICAL_MEMORY_SEARCH_TYPE, *PPHYSICAL_MEMORY_SEARCH_TYPE;
 
@@ -255,6 +268,21 @@ MmpWaitForFreePhysicalPages (
     PULONGLONG Timeout
     );
 
+PPAGING_ENTRY
+MmpSelectPageOutCandidate (
+    PPHYSICAL_ADDRESS PhysicalAddress
+    );
+
+BOOL
+MmpIsPagingEntryAccessed (
+    PPAGING_ENTRY PagingEntry
+    );
+
+VOID
+MmpRemovePagingEntryFromPageList (
+    PPAGING_ENTRY PagingEntry
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -308,18 +336,25 @@ PPHYSICAL_MEMORY_SEGMENT MmLastAllocatedSegment;
 UINTN MmLastAllocatedSegmentOffset;
 
 //
-// Store the last pages paged out, so that in general selecting pages to be
-// paged out sweeps across memory instead of always picking the same pages.
+// Stores the lock protecting access to physical page data structures.
 //
 
-PPHYSICAL_MEMORY_SEGMENT MmLastPagedSegment;
-UINTN MmLastPagedSegmentOffset;
+PSHARED_EXCLUSIVE_LOCK MmPhysicalPageLock = NULL;
 
 //
-// Stores the lock protecting access to physical page data structures.
+// Store the lists of pageable pages. Pages start on the active list when they
+// become pageable, and aging moves those whose accessed bit stays clear to the
+// inactive list, where page out looks for victims. Both lists run from least
+// to most recently moved. They are only changed with the physical page lock
+// held, and the page list lock serializes changes made under the shared
+// physical page lock.
 //
 
-PSHARED_EXCLUSIVE_LOCK MmPhysicalPageLock = NULL;
+PQUEUED_LOCK MmPageListLock = NULL;
+LIST_ENTRY MmActivePageList;
+LIST_ENTRY MmInactivePageList;
+UINTN MmActivePageCount;
+UINTN MmInactivePageCount;
 
 //
 // Store the lowest physical page to use.
@@ -437,6 +472,7 @@ Return Value:
     return MmPhysicalMemoryWarningLevel;
 }
 
+KERNEL_API
 UINTN
 MmGetTotalPhysicalPages (
     VOID
@@ -599,6 +635,7 @@ Return Value:
                     if (PagingEntry->U.LockCount == 0) {
                         PhysicalPage->U.Free = PHYSICAL_PAGE_FREE;
                         ReleasedCount += 1;
+                        MmpRemovePagingEntryFromPageList(PagingEntry);
                         INSERT_BEFORE(&(PagingEntry->U.ListEntry),
                                       &PagingEntryList);
 
@@ -863,8 +900,8 @@ Return Value:
                                         ListEntry);
 
     MmLastAllocatedSegmentOffset = 0;
-    MmLastPagedSegment = MmLastAllocatedSegment;
-    MmLastPagedSegmentOffset = 0;
+    INITIALIZE_LIST_HEAD(&MmActivePageList);
+    INITIALIZE_LIST_HEAD(&MmInactivePageList);
     MmTotalPhysicalPages = Context.TotalMemoryPages;
     MmMinimumFreePhysicalPages =
                 (MmTotalPhysicalPages * MIN_FREE_PHYSICAL_PAGES_PERCENT) / 100;
@@ -1647,6 +1684,7 @@ Return Value:
     UINTN PageOffset;
     ULONG PageShift;
     ULONG PageSize;
+    PPAGING_ENTRY PagingEntry;
     PPHYSICAL_PAGE PhysicalPage;
     PPHYSICAL_MEMORY_SEGMENT Segment;
 
@@ -1659,6 +1697,10 @@ Return Value:
         KeAcquireSharedExclusiveLockShared(MmPhysicalPageLock);
     }
 
+    if (MmPageListLock != NULL) {
+        KeAcquireQueuedLock(MmPageListLock);
+    }
+
     CurrentEntry = MmPhysicalSegmentListHead.Next;
     while (CurrentEntry != &MmPhysicalSegmentListHead) {
         Segment = LIST_VALUE(CurrentEntry, PHYSICAL_MEMORY_SEGMENT, ListEntry);
@@ -1678,36 +1720,49 @@ Return Value:
 
         //
         // Mark each page in the segment as pagable by adding in the supplied
-        // paging entry.
+        // paging entry. The page was just brought in for use, so it starts
+        // out at the back of the active list.
         //
 
         PageOffset = (PhysicalAddress - Segment->StartAddress) >> PageShift;
         PhysicalPage = ((PPHYSICAL_PAGE)(Segment + 1)) + PageOffset;
         for (PageIndex = 0; PageIndex < PageCount; PageIndex += 1) {
+            PagingEntry = PagingEntries[PageIndex];
 
             ASSERT(PhysicalPage->U.Flags == PHYSICAL_PAGE_FLAG_NON_PAGED);
-            ASSERT(((UINTN)PagingEntries[PageIndex] &
-                    PHYSICAL_PAGE_FLAG_NON_PAGED) == 0);
+            ASSERT(((UINTN)PagingEntry & PHYSICAL_PAGE_FLAG_NON_PAGED) == 0);
 
-            PhysicalPage->U.PagingEntry = PagingEntries[PageIndex];
+            PhysicalPage->U.PagingEntry = PagingEntry;
 
-            ASSERT(PagingEntries[PageIndex]->Section != NULL);
-            ASSERT((PagingEntries[PageIndex]->Section->Flags &
+            ASSERT(PagingEntry->Section != NULL);
+            ASSERT((PagingEntry->Section->Flags &
                     IMAGE_SECTION_DESTROYED) == 0);
 
             if (LockPages != FALSE) {
-                RtlAtomicAdd32(&(PhysicalPage->U.PagingEntry->U.LockCount), 1);
+                RtlAtomicAdd32(&(PagingEntry->U.LockCount), 1);
 
             } else {
                 RtlAtomicAdd(&MmNonPagedPhysicalPages, -1);
             }
 
+            ASSERT(PagingEntry->PageList == PageListNone);
+
+            PagingEntry->PhysicalAddress = PhysicalAddress +
+                                           (PageIndex << PageShift);
+
+            PagingEntry->PageList = PageListActive;
+            INSERT_BEFORE(&(PagingEntry->PageListEntry), &MmActivePageList);
+            MmActivePageCount += 1;
             PhysicalPage += 1;
         }
 
         break;
     }
 
+    if (MmPageListLock != NULL) {
+        KeReleaseQueuedLock(MmPageListLock);
+    }
+
     if (MmPhysicalPageLock != NULL) {
         KeReleaseSharedExclusiveLockShared(MmPhysicalPageLock);
     }
@@ -1960,6 +2015,7 @@ Return Value:
                 if ((PagingEntry->U.Flags & PAGING_ENTRY_FLAG_FREED) != 0) {
                     PhysicalPage[PageIndex].U.Free = PHYSICAL_PAGE_FREE;
                     ReleasedCount += 1;
+                    MmpRemovePagingEntryFromPageList(PagingEntry);
                     INSERT_BEFORE(&(PagingEntry->U.ListEntry),
                                   &PagingEntryList);
                 }
@@ -2252,37 +2308,38 @@ Return Value:
 
 {
 
+    UINTN EmptyBatchCount;
     BOOL Failure;
     ULONG FailureCount;
     UINTN FreePages;
     BOOL LockHeld;
     UINTN PageCountSinceEvent;
-    UINTN PagesFound;
-    ULONG PageShift;
     UINTN PagesPaged;
     PPAGING_ENTRY PagingEntry;
     PHYSICAL_ADDRESS PhysicalAddress;
-    PPHYSICAL_PAGE PhysicalPage;
     PIMAGE_SECTION Section;
     UINTN SectionOffset;
-    PPHYSICAL_MEMORY_SEGMENT Segment;
-    UINTN SegmentOffset;
     KSTATUS Status;
     UINTN TotalPagesPaged;
 
     LockHeld = FALSE;
-    PageShift = MmPageShift();
 
     //
-    // Now attempt to swap pages out to the backing store. This algorithm can
-    // get more intelligent with time, but for now just round robin the
-    // evictions.
+    // Now attempt to swap pages out to the backing store, taking victims from
+    // the front of the inactive list.
     //
 
+    EmptyBatchCount = 0;
     FailureCount = 0;
     PageCountSinceEvent = 0;
     TotalPagesPaged = 0;
     while (TRUE) {
+
+        //
+        // Top up the inactive list if aging has not kept up with demand.
+        //
+
+        MmpAgePhysicalPages(PAGE_LIST_BATCH_SIZE);
         if (MmPhysicalPageLock != NULL) {
             KeAcquireSharedExclusiveLockExclusive(MmPhysicalPageLock);
             LockHeld = TRUE;
@@ -2313,30 +2370,32 @@ Return Value:
         }
 
         //
-        // Find a single physical page that can be paged out.
+        // Find a single physical page that can be paged out. Each attempt
+        // only looks at a batch of the inactive list, so give up once about
+        // a full pass over the lists has come up empty.
         //
 
-        Segment = MmpFindPhysicalPages(1,
-                                       1,
-                                       PhysicalMemoryFindPagable,
-                                       &SegmentOffset,
-                                       &PagesFound);
+        PagingEntry = MmpSelectPageOutCandidate(&PhysicalAddress);
+        if (PagingEntry == NULL) {
+            EmptyBatchCount += 1;
+            if (EmptyBatchCount >
+                (((MmActivePageCount + MmInactivePageCount) /
+                  PAGE_LIST_BATCH_SIZE) + 1)) {
 
-        if (Segment == NULL) {
-            break;
-        }
+                break;
+            }
 
-        ASSERT(PagesFound == 1);
+            if (LockHeld != FALSE) {
+                KeReleaseSharedExclusiveLockExclusive(MmPhysicalPageLock);
+                LockHeld = FALSE;
+            }
 
+            continue;
+        }
+
+        EmptyBatchCount = 0;
         Failure = FALSE;
         PagesPaged = 0;
-        PhysicalAddress = Segment->StartAddress + (SegmentOffset << PageShift);
-        PhysicalPage = (PPHYSICAL_PAGE)(Segment + 1);
-        PhysicalPage += SegmentOffset;
-        PagingEntry = PhysicalPage->U.PagingEntry;
-
-        ASSERT(PagingEntry != NULL);
-        ASSERT(((UINTN)PagingEntry & PHYSICAL_PAGE_FLAG_NON_PAGED) == 0);
 
         //
         // Snap the image section and offset while the lock is still held to
@@ -2409,6 +2468,112 @@ Return Value:
     return TotalPagesPaged;
 }
 
+VOID
+MmpAgePhysicalPages (
+    UINTN ScanLimit
+    )
+
+/*++
+
+Routine Description:
+
+    This routine ages pageable pages by sampling their accessed bits, moving
+    pages that have not been touched recently from the active list to the
+    inactive list until the inactive list reaches its target size.
+
+Arguments:
+
+    ScanLimit - Supplies the maximum number of active pages to examine.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UINTN BatchIndex;
+    BOOL Balanced;
+    PPAGING_ENTRY PagingEntry;
+    UINTN ScanCount;
+    UINTN TargetCount;
+
+    ASSERT(KeGetRunLevel() == RunLevelLow);
+
+    //
+    // Work through the front of the active list a batch at a time, dropping
+    // the physical page lock in between so allocations are not held up for
+    // the whole scan.
+    //
+
+    Balanced = FALSE;
+    ScanCount = 0;
+    while ((Balanced == FALSE) && (ScanCount < ScanLimit)) {
+        if (MmPhysicalPageLock != NULL) {
+            KeAcquireSharedExclusiveLockExclusive(MmPhysicalPageLock);
+        }
+
+        if (MmPageListLock != NULL) {
+            KeAcquireQueuedLock(MmPageListLock);
+        }
+
+        for (BatchIndex = 0;
+             BatchIndex < PAGE_LIST_BATCH_SIZE;
+             BatchIndex += 1) {
+
+            TargetCount = ((MmActivePageCount + MmInactivePageCount) *
+                           INACTIVE_PAGE_LIST_PERCENT) / 100;
+
+            if ((ScanCount >= ScanLimit) ||
+                (MmInactivePageCount >= TargetCount) ||
+                (LIST_EMPTY(&MmActivePageList) != FALSE)) {
+
+                Balanced = TRUE;
+                break;
+            }
+
+            PagingEntry = LIST_VALUE(MmActivePageList.Next,
+                                     PAGING_ENTRY,
+                                     PageListEntry);
+
+            ASSERT(PagingEntry->PageList == PageListActive);
+
+            LIST_REMOVE(&(PagingEntry->PageListEntry));
+            ScanCount += 1;
+
+            //
+            // Pages touched since the last look stay active. Everything else
+            // goes to the back of the inactive list, where it will get one
+            // more look at its accessed bit before being paged out.
+            //
+
+            if (MmpIsPagingEntryAccessed(PagingEntry) != FALSE) {
+                INSERT_BEFORE(&(PagingEntry->PageListEntry),
+                              &MmActivePageList);
+
+            } else {
+                PagingEntry->PageList = PageListInactive;
+                INSERT_BEFORE(&(PagingEntry->PageListEntry),
+                              &MmInactivePageList);
+
+                MmActivePageCount -= 1;
+                MmInactivePageCount += 1;
+            }
+        }
+
+        if (MmPageListLock != NULL) {
+            KeReleaseQueuedLock(MmPageListLock);
+        }
+
+        if (MmPhysicalPageLock != NULL) {
+            KeReleaseSharedExclusiveLockExclusive(MmPhysicalPageLock);
+        }
+    }
+
+    return;
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
@@ -2460,17 +2625,14 @@ Return Value:
     BOOL ExitCheck;
     BOOL FirstIteration;
     UINTN FirstOffset;
-    UINTN Flags;
     PPHYSICAL_MEMORY_SEGMENT LastSegment;
     UINTN LastSegmentOffset;
     UINTN Offset;
     ULONG PageShift;
-    PPAGING_ENTRY PagingEntry;
     PPHYSICAL_PAGE PhysicalPage;
     PPHYSICAL_MEMORY_SEGMENT Segment;
     UINTN SegmentPageCount;
     UINTN SpanCount;
-    UINTN SpanPageCount;
     PVOID VirtualAddress;
     BOOL VirtualAddressInUse;
 
@@ -2484,15 +2646,8 @@ Return Value:
            (KeIsSharedExclusiveLockHeldExclusive(MmPhysicalPageLock) != FALSE));
 
     PageShift = MmPageShift();
-    if (SearchType == PhysicalMemoryFindPagable) {
-        LastSegment = MmLastPagedSegment;
-        LastSegmentOffset = MmLastPagedSegmentOffset;
-
-    } else {
-        LastSegment = MmLastAllocatedSegment;
-        LastSegmentOffset = MmLastAllocatedSegmentOffset;
-    }
-
+    LastSegment = MmLastAllocatedSegment;
+    LastSegmentOffset = MmLastAllocatedSegmentOffset;
     Segment = LastSegment;
 
     //
@@ -2533,8 +2688,7 @@ Return Value:
         //
 
         if ((Offset >= SegmentPageCount) ||
-            ((SearchType != PhysicalMemoryFindPagable) &&
-             (Offset + PageCount > SegmentPageCount)) ||
+            (Offset + PageCount > SegmentPageCount) ||
             ((SearchType == PhysicalMemoryFindFree) &&
              (Segment->FreePages < PageCount))) {
 
@@ -2589,24 +2743,12 @@ Return Value:
 
         //
         // Try to collect the desired number of pages from the current segment.
-        // When searching for pagable pages, take as many as are available.
         //
 
-        if (SearchType == PhysicalMemoryFindPagable) {
-            SpanPageCount = SegmentPageCount - Offset;
-            if (PageCount < SpanPageCount) {
-                SpanPageCount = PageCount;
-            }
-
-        } else {
-
-            ASSERT(PageCount <= (SegmentPageCount - Offset));
-
-            SpanPageCount = PageCount;
-        }
+        ASSERT(PageCount <= (SegmentPageCount - Offset));
 
         ExitCheck = FALSE;
-        for (SpanCount = 0; SpanCount < SpanPageCount; SpanCount += 1) {
+        for (SpanCount = 0; SpanCount < PageCount; SpanCount += 1) {
             switch (SearchType) {
             case PhysicalMemoryFindFree:
 
@@ -2620,43 +2762,6 @@ Return Value:
 
                 break;
 
-            case PhysicalMemoryFindPagable:
-                Flags = PhysicalPage->U.Flags;
-
-                //
-                // Free or non-pagable pages cannot be paged out.
-                //
-
-                if ((PhysicalPage->U.Free == PHYSICAL_PAGE_FREE) ||
-                    ((Flags & PHYSICAL_PAGE_FLAG_NON_PAGED) != 0)) {
-
-                    ExitCheck = TRUE;
-
-                } else {
-                    PagingEntry = PhysicalPage->U.PagingEntry;
-
-                    ASSERT((PagingEntry->Section->Flags &
-                            IMAGE_SECTION_DESTROYED) == 0);
-
-                    //
-                    // If the paging entry is locked, it cannot be paged out.
-                    //
-
-                    if (PagingEntry->U.LockCount != 0) {
-                        ExitCheck = TRUE;
-
-                    //
-                    // Otherwise mark that the page is being paged out so that
-                    // it does not get released in the middle of use.
-                    //
-
-                    } else {
-                        PagingEntry->U.Flags |= PAGING_ENTRY_FLAG_PAGING_OUT;
-                    }
-                }
-
-                break;
-
             //
             // Search for a piece of physical memory that is both free and
             // free in the virtual space. This routine does not make sure that
@@ -2700,14 +2805,11 @@ Return Value:
         }
 
         //
-        // If the right number of pages are available, or this is a search for
-        // pagable pages and at least one was found, then get excited and
+        // If the right number of pages are available, then get excited and
         // return it. Update the globals for the next search too.
         //
 
-        if ((SpanCount == PageCount) ||
-            ((SpanCount != 0) &&
-             (SearchType == PhysicalMemoryFindPagable))) {
+        if (SpanCount == PageCount) {
 
             //
             // Update the global last segment trackers. It's okay if the offset
@@ -2717,14 +2819,8 @@ Return Value:
             // during alignment).
             //
 
-            if (SearchType == PhysicalMemoryFindPagable) {
-                MmLastPagedSegment = Segment;
-                MmLastPagedSegmentOffset = Offset + SpanCount;
-
-            } else {
-                MmLastAllocatedSegment = Segment;
-                MmLastAllocatedSegmentOffset = Offset + SpanCount;
-            }
+            MmLastAllocatedSegment = Segment;
+            MmLastAllocatedSegmentOffset = Offset + SpanCount;
 
             *SelectedPageOffset = Offset;
             if (PagesFound != NULL) {
@@ -2735,24 +2831,10 @@ Return Value:
         }
 
         //
-        // If this is a search for pagable memory, skip to the next page. The
-        // search above didn't find any free pages, so the span count should be
-        // at zero.
-        //
-
-        if (SearchType == PhysicalMemoryFindPagable) {
-
-            ASSERT(SpanCount == 0);
-
-            Offset += 1;
-
-        //
-        // Otherwise advance to the next (aligned) page in the segment.
+        // Advance to the next (aligned) page in the segment.
         //
 
-        } else {
-            Offset += PageAlignment;
-        }
+        Offset += PageAlignment;
 
     } while ((Segment != LastSegment) || (Offset != FirstOffset));
 
@@ -3291,3 +3373,194 @@ Return Value:
     return;
 }
 
+PPAGING_ENTRY
+MmpSelectPageOutCandidate (
+    PPHYSICAL_ADDRESS PhysicalAddress
+    )
+
+/*++
+
+Routine Description:
+
+    This routine looks at a batch of pages at the front of the inactive list
+    for one that can be paged out. Pages accessed since they were deactivated
+    go back to the active list, and pages that are locked or already being
+    paged out are rotated to the back of the inactive list. The caller must
+    hold the physical page lock exclusively.
+
+Arguments:
+
+    PhysicalAddress - Supplies a pointer where the physical address of the
+        selected page will be returned.
+
+Return Value:
+
+    Returns a pointer to the paging entry of the selected page, which has been
+    marked as paging out.
+
+    NULL if no page in this batch can be paged out.
+
+--*/
+
+{
+
+    UINTN BatchIndex;
+    PPAGING_ENTRY PagingEntry;
+    PPAGING_ENTRY Selected;
+
+    ASSERT((MmPhysicalPageLock == NULL) ||
+           (KeIsSharedExclusiveLockHeldExclusive(MmPhysicalPageLock) != FALSE));
+
+    Selected = NULL;
+    if (MmPageListLock != NULL) {
+        KeAcquireQueuedLock(MmPageListLock);
+    }
+
+    for (BatchIndex = 0; BatchIndex < PAGE_LIST_BATCH_SIZE; BatchIndex += 1) {
+        if (LIST_EMPTY(&MmInactivePageList) != FALSE) {
+            break;
+        }
+
+        PagingEntry = LIST_VALUE(MmInactivePageList.Next,
+                                 PAGING_ENTRY,
+                                 PageListEntry);
+
+        ASSERT(PagingEntry->PageList == PageListInactive);
+        ASSERT((PagingEntry->Section->Flags & IMAGE_SECTION_DESTROYED) == 0);
+
+        LIST_REMOVE(&(PagingEntry->PageListEntry));
+
+        //
+        // Locked pages cannot be paged out, and pages already being paged out
+        // are spoken for.
+        //
+
+        if ((PagingEntry->U.LockCount != 0) ||
+            ((PagingEntry->U.Flags & PAGING_ENTRY_FLAG_PAGING_OUT) != 0)) {
+
+            INSERT_BEFORE(&(PagingEntry->PageListEntry), &MmInactivePageList);
+            continue;
+        }
+
+        //
+        // Give pages that were used again since they were deactivated another
+        // trip through the active list.
+        //
+
+        if (MmpIsPagingEntryAccessed(PagingEntry) != FALSE) {
+            PagingEntry->PageList = PageListActive;
+            INSERT_BEFORE(&(PagingEntry->PageListEntry), &MmActivePageList);
+            MmInactivePageCount -= 1;
+            MmActivePageCount += 1;
+            continue;
+        }
+
+        //
+        // Mark that the page is being paged out so that it does not get
+        // released in the middle of use. It stays on the inactive list until
+        // it is actually freed.
+        //
+
+        PagingEntry->U.Flags |= PAGING_ENTRY_FLAG_PAGING_OUT;
+        INSERT_BEFORE(&(PagingEntry->PageListEntry), &MmInactivePageList);
+        *PhysicalAddress = PagingEntry->PhysicalAddress;
+        Selected = PagingEntry;
+        break;
+    }
+
+    if (MmPageListLock != NULL) {
+        KeReleaseQueuedLock(MmPageListLock);
+    }
+
+    return Selected;
+}
+
+BOOL
+MmpIsPagingEntryAccessed (
+    PPAGING_ENTRY PagingEntry
+    )
+
+/*++
+
+Routine Description:
+
+    This routine samples and clears the accessed bit of the page described by
+    the given paging entry. Only the owning section's mapping is checked, so
+    a page shared with a child section counts as accessed only if the owner
+    touched it. The caller must hold the physical page lock exclusively.
+
+Arguments:
+
+    PagingEntry - Supplies a pointer to the paging entry to check.
+
+Return Value:
+
+    TRUE if the page was accessed since it was last checked.
+
+    FALSE otherwise.
+
+--*/
+
+{
+
+    PIMAGE_SECTION Section;
+    PVOID VirtualAddress;
+
+    Section = PagingEntry->Section;
+    if ((Section->Flags & IMAGE_SECTION_DESTROYED) != 0) {
+        return FALSE;
+    }
+
+    VirtualAddress = Section->VirtualAddress +
+                     (PagingEntry->U.SectionOffset << MmPageShift());
+
+    return MmpCheckAndClearPageAccessed(Section->AddressSpace, VirtualAddress);
+}
+
+VOID
+MmpRemovePagingEntryFromPageList (
+    PPAGING_ENTRY PagingEntry
+    )
+
+/*++
+
+Routine Description:
+
+    This routine removes a paging entry from whichever page list it is on. The
+    caller must hold the physical page lock.
+
+Arguments:
+
+    PagingEntry - Supplies a pointer to the paging entry to remove.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if (MmPageListLock != NULL) {
+        KeAcquireQueuedLock(MmPageListLock);
+    }
+
+    if (PagingEntry->PageList == PageListActive) {
+        MmActivePageCount -= 1;
+
+    } else {
+
+        ASSERT(PagingEntry->PageList == PageListInactive);
+
+        MmInactivePageCount -= 1;
+    }
+
+    LIST_REMOVE(&(PagingEntry->PageListEntry));
+    PagingEntry->PageList = PageListNone;
+    if (MmPageListLock != NULL) {
+        KeReleaseQueuedLock(MmPageListLock);
+    }
+
+    return;
+}
+
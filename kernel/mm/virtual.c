@@ -231,6 +231,7 @@ Return Value:
     return MmVirtualMemoryWarningLevel;
 }
 
+KERNEL_API
 UINTN
 MmGetTotalVirtualMemory (
     VOID
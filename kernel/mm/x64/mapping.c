@@ -1483,6 +1483,111 @@ Return Value:
     return Physical;
 }
 
+BOOL
+MmpCheckAndClearPageAccessed (
+    PADDRESS_SPACE AddressSpace,
+    PVOID VirtualAddress
+    )
+
+/*++
+
+Routine Description:
+
+    This routine checks and clears the hardware accessed bit in the page table
+    entry for the given virtual address. The TLB is not flushed, so a processor
+    with the translation cached may not set the bit again until that entry is
+    evicted.
+
+Arguments:
+
+    AddressSpace - Supplies a pointer to the address space that owns the
+        virtual address.
+
+    VirtualAddress - Supplies the virtual address of the page to check.
+
+Return Value:
+
+    TRUE if the page was accessed since the last time the bit was cleared.
+
+    FALSE if the page was not accessed, is not mapped, or the architecture
+    does not track accesses.
+
+--*/
+
+{
+
+    BOOL Accessed;
+    PTE NewEntry;
+    RUNLEVEL OldRunLevel;
+    PTE OldEntry;
+    PPTE Pml4;
+    ULONG Pml4Index;
+    PPROCESSOR_BLOCK Processor;
+    volatile PTE *Pte;
+
+    Accessed = FALSE;
+    OldRunLevel = RunLevelCount;
+    if (VirtualAddress >= KERNEL_VA_START) {
+        Pml4 = X64_PML4T;
+        Pml4Index = X64_PML4_INDEX(VirtualAddress);
+        if ((Pml4[Pml4Index] & X86_PTE_PRESENT) == 0) {
+
+            ASSERT(Pml4Index != X64_SELF_MAP_INDEX);
+
+            Pml4[Pml4Index] = MmKernelPml4[Pml4Index];
+            if ((Pml4[Pml4Index] & X86_PTE_PRESENT) == 0) {
+                return FALSE;
+            }
+        }
+
+        if (((*X64_PDPE(VirtualAddress) & X86_PTE_PRESENT) == 0) ||
+            ((*X64_PDE(VirtualAddress) & X86_PTE_PRESENT) == 0)) {
+
+            return FALSE;
+        }
+
+        Pte = X64_PTE(VirtualAddress);
+
+    } else {
+        OldRunLevel = KeRaiseRunLevel(RunLevelDispatch);
+        Pte = MmpGetOtherProcessPte((PADDRESS_SPACE_X64)AddressSpace,
+                                    VirtualAddress,
+                                    FALSE);
+
+        if (Pte == NULL) {
+            goto CheckAndClearPageAccessedEnd;
+        }
+    }
+
+    //
+    // Clear the bit atomically, as the processor may be setting the dirty bit
+    // in the same entry.
+    //
+
+    while (TRUE) {
+        OldEntry = *Pte;
+        if ((OldEntry & X86_PTE_ACCESSED) == 0) {
+            break;
+        }
+
+        NewEntry = OldEntry & ~X86_PTE_ACCESSED;
+        if (RtlAtomicCompareExchange64(Pte, NewEntry, OldEntry) == OldEntry) {
+            Accessed = TRUE;
+            break;
+        }
+    }
+
+CheckAndClearPageAccessedEnd:
+    if (OldRunLevel != RunLevelCount) {
+        Processor = KeGetCurrentProcessorBlock();
+        *(X64_PTE(Processor->SwapPage)) = 0;
+        ArInvalidateTlbEntry(Processor->SwapPage);
+        KeLowerRunLevel(OldRunLevel);
+    }
+
+    return Accessed;
+}
+
 VOID
 MmpUnmapPageInOtherProcess (
     PADDRESS_SPACE AddressSpace,
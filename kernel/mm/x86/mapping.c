@@ -1520,6 +1520,112 @@ Return Value:
     return Physical;
 }
 
+BOOL
+MmpCheckAndClearPageAccessed (
+    PADDRESS_SPACE AddressSpace,
+    PVOID VirtualAddress
+    )
+
+/*++
+
+Routine Description:
+
+    This routine checks and clears the hardware accessed bit in the page table
+    entry for the given virtual address. The TLB is not flushed, so a processor
+    with the translation cached may not set the bit again until that entry is
+    evicted.
+
+Arguments:
+
+    AddressSpace - Supplies a pointer to the address space that owns the
+        virtual address.
+
+    VirtualAddress - Supplies the virtual address of the page to check.
+
+Return Value:
+
+    TRUE if the page was accessed since the last time the bit was cleared.
+
+    FALSE if the page was not accessed, is not mapped, or the architecture
+    does not track accesses.
+
+--*/
+
+{
+
+    BOOL Accessed;
+    PPTE Directory;
+    ULONG DirectoryIndex;
+    RUNLEVEL OldRunLevel;
+    PPTE PageTable;
+    ULONG Previous;
+    PPROCESSOR_BLOCK ProcessorBlock;
+    PPTE Pte;
+    PADDRESS_SPACE_X86 Space;
+    ULONG TableIndex;
+    PHYSICAL_ADDRESS TablePhysical;
+
+    Accessed = FALSE;
+    DirectoryIndex = (UINTN)VirtualAddress >> PAGE_DIRECTORY_SHIFT;
+    TableIndex = ((UINTN)VirtualAddress & PTE_INDEX_MASK) >> PAGE_SHIFT;
+
+    //
+    // Kernel addresses can be reached through the self map. The bit is
+    // cleared atomically since the processor may be setting the dirty bit in
+    // the same entry.
+    //
+
+    if (VirtualAddress >= KERNEL_VA_START) {
+        Directory = X86_PDT;
+        Directory[DirectoryIndex] = MmKernelPageDirectory[DirectoryIndex];
+        if (Directory[DirectoryIndex].Present == 0) {
+            return FALSE;
+        }
+
+        PageTable = GET_PAGE_TABLE(DirectoryIndex);
+        Previous = RtlAtomicAnd32((volatile ULONG *)&(PageTable[TableIndex]),
+                                  ~X86_PTE_ACCESSED);
+
+        if ((Previous & X86_PTE_ACCESSED) != 0) {
+            Accessed = TRUE;
+        }
+
+        return Accessed;
+    }
+
+    //
+    // User mode addresses may belong to another process, so go through the
+    // swap page to get at the page directory and page table.
+    //
+
+    Space = (PADDRESS_SPACE_X86)AddressSpace;
+    OldRunLevel = KeRaiseRunLevel(RunLevelDispatch);
+    ProcessorBlock = KeGetCurrentProcessorBlock();
+    Pte = ProcessorBlock->SwapPage;
+    MmpMapPage(Space->PageDirectoryPhysical,
+               Pte,
+               MAP_FLAG_PRESENT | MAP_FLAG_READ_ONLY);
+
+    if (Pte[DirectoryIndex].Present == 0) {
+        goto CheckAndClearPageAccessedEnd;
+    }
+
+    TablePhysical = Pte[DirectoryIndex].Entry << PAGE_SHIFT;
+    MmpUnmapPages(Pte, 1, 0, NULL);
+    MmpMapPage(TablePhysical, Pte, MAP_FLAG_PRESENT);
+    Previous = RtlAtomicAnd32((volatile ULONG *)&(Pte[TableIndex]),
+                              ~X86_PTE_ACCESSED);
+
+    if ((Previous & X86_PTE_ACCESSED) != 0) {
+        Accessed = TRUE;
+    }
+
+CheckAndClearPageAccessedEnd:
+    MmpUnmapPages(Pte, 1, 0, NULL);
+    KeLowerRunLevel(OldRunLevel);
+    return Accessed;
+}
+
 VOID
 MmpUnmapPageInOtherProcess (
     PADDRESS_SPACE AddressSpace,
@@ -1251,7 +1251,7 @@ Return Value:
     }
 
     WaitBlock->Count = ObjectCount + 1;
-    WaitBlock->Flags = Flags;
+    WaitBlock->Flags = Flags | WAIT_FLAG_OBJECT;
     Status = ObWait(WaitBlock, TimeoutInMilliseconds);
     LocalSignalingObject = WaitBlock->SignalingQueue;
     if (LocalSignalingObject != NULL) {
@@ -1701,6 +1701,7 @@ Return Value:
                                                            ThreadStateBlocked);
 
                     if (OldThreadState == ThreadStateBlocked) {
+                        SpRecordThreadWake(Thread);
                         KeSetThreadReady(Thread);
                         break;
                     }
@@ -1879,6 +1880,7 @@ Return Value:
     //
 
     if (WakeThread != FALSE) {
+        SpRecordThreadWake(Thread);
         KeSetThreadReady(Thread);
     }
 
@@ -1962,6 +1964,7 @@ Return Value:
 
     if (WakeThread != FALSE) {
         Thread->State = ThreadStateWaking;
+        SpRecordThreadWake(Thread);
         KeSetThreadReady(Thread);
     }
 
@@ -2370,6 +2373,48 @@ Return Value:
     return TypedThread->WaitBlock->Entry[1].Queue;
 }
 
+PVOID
+ObGetBlockingObject (
+    PVOID Thread
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the first object the given thread is blocking on. Like
+    the blocking queue, the object is not referenced on behalf of the caller,
+    so this is generally only used by the scheduler for profiling.
+
+Arguments:
+
+    Thread - Supplies a pointer to the thread.
+
+Return Value:
+
+    Returns a pointer to the object header of the first object the thread is
+    blocking on.
+
+    NULL if the thread is waiting on bare wait queues rather than objects.
+
+--*/
+
+{
+
+    PWAIT_QUEUE Queue;
+    PKTHREAD TypedThread;
+    PWAIT_BLOCK WaitBlock;
+
+    TypedThread = (PKTHREAD)Thread;
+    WaitBlock = TypedThread->WaitBlock;
+    if ((WaitBlock->Flags & WAIT_FLAG_OBJECT) == 0) {
+        return NULL;
+    }
+
+    Queue = WaitBlock->Entry[1].Queue;
+    return PARENT_STRUCTURE(Queue, OBJECT_HEADER, WaitQueue);
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
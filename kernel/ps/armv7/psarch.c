@@ -732,6 +732,33 @@ Return Value:
     return Status;
 }
 
+PVOID
+PspArchGetUserStackPointer (
+    PTRAP_FRAME TrapFrame
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the user mode stack pointer saved in the given trap
+    frame.
+
+Arguments:
+
+    TrapFrame - Supplies a pointer to the user mode trap frame.
+
+Return Value:
+
+    Returns the user mode stack pointer.
+
+--*/
+
+{
+
+    return (PVOID)(UINTN)(TrapFrame->UserSp);
+}
+
 KSTATUS
 PspArchGetDebugBreakInformation (
     PTRAP_FRAME TrapFrame
@@ -380,7 +380,9 @@ Routine Description:
 
     This routine duplicates the current process, including all allocated
     address space and open file handles. Only the current thread's execution
-    continues in the new process.
+    continues in the new process. For vfork requests, the child instead runs
+    in the parent's address space, and the calling thread waits until the
+    child executes a new image or exits.
 
 Arguments:
 
@@ -399,28 +401,96 @@ Return Value:
 {
 
     PKTHREAD CurrentThread;
+    PVOID Frame;
+    UINTN FrameSize;
     PKPROCESS NewProcess;
     INTN NewProcessId;
     PSYSTEM_CALL_FORK Parameters;
+    PVOID StackPointer;
     KSTATUS Status;
+    PKEVENT VforkEvent;
 
     CurrentThread = KeGetCurrentThread();
+    Frame = NULL;
+    FrameSize = 0;
     NewProcess = NULL;
+    NewProcessId = 0;
     Parameters = (PSYSTEM_CALL_FORK)SystemCallParameter;
+    StackPointer = NULL;
+    VforkEvent = NULL;
+
+    //
+    // A vfork child is about to scribble on the same stack this thread will
+    // return on. Save the region between the current stack pointer and the
+    // restore base the C library supplied so it can be put back afterwards.
+    //
+
+    if ((Parameters->Flags & FORK_FLAG_VFORK) != 0) {
+        VforkEvent = KeCreateEvent(NULL);
+        if (VforkEvent == NULL) {
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+            goto SysForkProcessEnd;
+        }
+
+        if (Parameters->FrameRestoreBase != NULL) {
+            StackPointer = PspArchGetUserStackPointer(CurrentThread->TrapFrame);
+            if ((Parameters->FrameRestoreBase < StackPointer) ||
+                (Parameters->FrameRestoreBase > USER_VA_END)) {
+
+                Status = STATUS_INVALID_PARAMETER;
+                goto SysForkProcessEnd;
+            }
+
+            FrameSize = (UINTN)(Parameters->FrameRestoreBase) -
+                        (UINTN)StackPointer;
+
+            if (FrameSize > PS_VFORK_MAX_FRAME_RESTORE_SIZE) {
+                Status = STATUS_INVALID_PARAMETER;
+                goto SysForkProcessEnd;
+            }
+
+            if (FrameSize != 0) {
+                Frame = MmAllocatePagedPool(FrameSize, PS_ALLOCATION_TAG);
+                if (Frame == NULL) {
+                    Status = STATUS_INSUFFICIENT_RESOURCES;
+                    goto SysForkProcessEnd;
+                }
+
+                Status = MmCopyFromUserMode(Frame, StackPointer, FrameSize);
+                if (!KSUCCESS(Status)) {
+                    goto SysForkProcessEnd;
+                }
+            }
+        }
+    }
+
     Status = PspCopyProcess(CurrentThread->OwningProcess,
                             CurrentThread,
                             CurrentThread->TrapFrame,
                             Parameters->Flags,
+                            VforkEvent,
                             &NewProcess);
 
     if (!KSUCCESS(Status)) {
         RtlDebugPrint("Failed to fork %d\n", Status);
-        return Status;
+        goto SysForkProcessEnd;
     }
 
     NewProcessId = NewProcess->Identifiers.ProcessId;
     ObReleaseReference(NewProcess);
 
+    //
+    // For vfork, wait for the child to get off of this address space, then
+    // put back the stack it trashed. The wait is not interruptible, as this
+    // thread must not exit while the child is still using its memory.
+    //
+
+    if (VforkEvent != NULL) {
+        KeWaitForEvent(VforkEvent, FALSE, WAIT_TIME_INDEFINITE);
+        if (Frame != NULL) {
+            MmCopyToUserMode(StackPointer, Frame, FrameSize);
+        }
+
     //
     // Yield to the child. This alleviates extra work during image section
     // isolation that the parent must do if it triggers copy-on-write before
@@ -428,7 +498,25 @@ Return Value:
     // going to wait on its new child.
     //
 
-    KeYield();
+    } else {
+        KeYield();
+    }
+
+    Status = STATUS_SUCCESS;
+
+SysForkProcessEnd:
+    if (Frame != NULL) {
+        MmFreePagedPool(Frame);
+    }
+
+    if (VforkEvent != NULL) {
+        KeDestroyEvent(VforkEvent);
+    }
+
+    if (!KSUCCESS(Status)) {
+        return Status;
+    }
+
     return NewProcessId;
 }
 
@@ -607,6 +695,13 @@ Return Value:
 
     PspDestroyProcessTimers(Process);
 
+    //
+    // A vfork child gets off of its parent's address space here, leaving the
+    // fresh one it was created with for the new image.
+    //
+
+    PspReleaseVforkParent(Thread);
+
     //
     // Unload all images and free all memory associated with this image.
     // Blocked and ignored signals are inherited across the exec. Handled
@@ -1753,6 +1848,7 @@ PspCopyProcess (
     PKTHREAD MainThread,
     PTRAP_FRAME TrapFrame,
     ULONG Flags,
+    PVOID VforkEvent,
     PKPROCESS *CreatedProcess
     )
 
@@ -1777,6 +1873,10 @@ Routine Description:
     Flags - Supplies a bitfield of flags governing the creation of the new
         process. See FORK_FLAG_* definitions.
 
+    VforkEvent - Supplies an optional pointer to the event to signal when a
+        vfork child stops using the parent's address space. This is required
+        if the vfork flag is set.
+
     CreatedProcess - Supplies an optional pointer that will receive a pointer to
         the created process on success.
 
@@ -1960,23 +2060,50 @@ Return Value:
     }
 
     //
-    // Copy the process address space.
+    // A vfork child runs in the parent's address space, so skip copying it
+    // and the image list entirely. Stash the child's own empty address space
+    // for when it executes an image or exits. The new kernel stack was
+    // allocated after the parent's page directory was created, so make sure
+    // the parent's top level table can reach it.
     //
 
-    Status = MmCloneAddressSpace(Process->AddressSpace,
-                                 NewProcess->AddressSpace);
+    if ((Flags & FORK_FLAG_VFORK) != 0) {
 
-    if (!KSUCCESS(Status)) {
-        goto CopyProcessEnd;
-    }
+        ASSERT(VforkEvent != NULL);
 
-    //
-    // Copy the image list.
-    //
+        MmUpdatePageDirectory(Process->AddressSpace,
+                              KernelStack,
+                              DEFAULT_KERNEL_STACK_SIZE);
 
-    Status = PspImCloneProcessImages(Process, NewProcess);
-    if (!KSUCCESS(Status)) {
-        goto CopyProcessEnd;
+        NewProcess->AddressSpace->MaxMemoryMap =
+                                           Process->AddressSpace->MaxMemoryMap;
+
+        ObAddReference(VforkEvent);
+        NewProcess->VforkEvent = VforkEvent;
+        NewProcess->VforkAddressSpace = NewProcess->AddressSpace;
+        NewProcess->AddressSpace = Process->AddressSpace;
+
+    } else {
+
+        //
+        // Copy the process address space.
+        //
+
+        Status = MmCloneAddressSpace(Process->AddressSpace,
+                                     NewProcess->AddressSpace);
+
+        if (!KSUCCESS(Status)) {
+            goto CopyProcessEnd;
+        }
+
+        //
+        // Copy the image list.
+        //
+
+        Status = PspImCloneProcessImages(Process, NewProcess);
+        if (!KSUCCESS(Status)) {
+            goto CopyProcessEnd;
+        }
     }
 
     //
@@ -2004,6 +2131,18 @@ Return Value:
     if (!KSUCCESS(Status)) {
         if (NewProcess != NULL) {
 
+            //
+            // Hand the parent's address space back before tearing down the
+            // child, since termination cleans up the process' memory.
+            //
+
+            if (NewProcess->VforkAddressSpace != NULL) {
+                NewProcess->AddressSpace = NewProcess->VforkAddressSpace;
+                NewProcess->VforkAddressSpace = NULL;
+                ObReleaseReference(NewProcess->VforkEvent);
+                NewProcess->VforkEvent = NULL;
+            }
+
             //
             // If the routine failed, then a thread was never launched. As such,
             // nothing will clean up the new process. "Terminate" it now.
@@ -2027,6 +2166,75 @@ Return Value:
     return Status;
 }
 
+VOID
+PspReleaseVforkParent (
+    PKTHREAD Thread
+    )
+
+/*++
+
+Routine Description:
+
+    This routine moves a vfork child off of its parent's address space and
+    onto its own, and then wakes the waiting parent. This routine does nothing
+    if the thread's process is not a vfork child. It must be called from the
+    context of the given thread.
+
+Arguments:
+
+    Thread - Supplies a pointer to the current thread.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PKEVENT Event;
+    RUNLEVEL OldRunLevel;
+    PKPROCESS Process;
+
+    Process = Thread->OwningProcess;
+    if (Process->VforkAddressSpace == NULL) {
+        return;
+    }
+
+    ASSERT(Thread == KeGetCurrentThread());
+    ASSERT(Process->ThreadCount == 1);
+
+    //
+    // The user stack belongs to the parent's thread, so forget about it
+    // rather than letting exec or thread exit unmap it.
+    //
+
+    Thread->UserStack = NULL;
+    Thread->UserStackSize = 0;
+
+    //
+    // Swap in the child's own address space. Do this at dispatch so that a
+    // context switch can't observe the process pointing at one address space
+    // while the processor is using the other.
+    //
+
+    OldRunLevel = KeRaiseRunLevel(RunLevelDispatch);
+    Process->AddressSpace = Process->VforkAddressSpace;
+    MmSwitchAddressSpace(KeGetCurrentProcessorBlock(), Process->AddressSpace);
+    KeLowerRunLevel(OldRunLevel);
+    Process->VforkAddressSpace = NULL;
+
+    //
+    // Now that nothing references the parent's memory, let it run again.
+    //
+
+    Event = Process->VforkEvent;
+    Process->VforkEvent = NULL;
+    KeSignalEvent(Event, SignalOptionSignalAll);
+    ObReleaseReference(Event);
+    return;
+}
+
 PKPROCESS
 PspCreateProcess (
     PCSTR CommandLine,
@@ -63,6 +63,13 @@ Module Name:
 
 #define OS_BASE_LIBRARY "libminocaos.so.1"
 
+//
+// Define the largest region of user stack that a vfork call can ask to have
+// preserved for the parent.
+//
+
+#define PS_VFORK_MAX_FRAME_RESTORE_SIZE 0x1000
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -414,6 +421,7 @@ PspCopyProcess (
     PKTHREAD MainThread,
     PTRAP_FRAME TrapFrame,
     ULONG Flags,
+    PVOID VforkEvent,
     PKPROCESS *CreatedProcess
     );
 
@@ -438,6 +446,10 @@ Routine Description:
     Flags - Supplies a bitfield of flags governing the creation of the new
         process. See FORK_FLAG_* definitions.
 
+    VforkEvent - Supplies an optional pointer to the event to signal when a
+        vfork child stops using the parent's address space. This is required
+        if the vfork flag is set.
+
     CreatedProcess - Supplies an optional pointer that will receive a pointer to
         the created process on success.
 
@@ -447,6 +459,30 @@ Return Value:
 
 --*/
 
+VOID
+PspReleaseVforkParent (
+    PKTHREAD Thread
+    );
+
+/*++
+
+Routine Description:
+
+    This routine moves a vfork child off of its parent's address space and
+    onto its own, and then wakes the waiting parent. This routine does nothing
+    if the thread's process is not a vfork child. It must be called from the
+    context of the given thread.
+
+Arguments:
+
+    Thread - Supplies a pointer to the current thread.
+
+Return Value:
+
+    None.
+
+--*/
+
 PKPROCESS
 PspCreateProcess (
     PCSTR CommandLine,
@@ -980,6 +1016,28 @@ Return Value:
 
 --*/
 
+PVOID
+PspArchGetUserStackPointer (
+    PTRAP_FRAME TrapFrame
+    );
+
+/*++
+
+Routine Description:
+
+    This routine returns the user mode stack pointer saved in the given trap
+    frame.
+
+Arguments:
+
+    TrapFrame - Supplies a pointer to the user mode trap frame.
+
+Return Value:
+
+    Returns the user mode stack pointer.
+
+--*/
+
 KSTATUS
 PspArchGetDebugBreakInformation (
     PTRAP_FRAME TrapFrame
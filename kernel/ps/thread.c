@@ -323,6 +323,17 @@ Return Value:
         }
     }
 
+    //
+    // Pin the thread to its processor before it ever becomes ready.
+    //
+
+    if ((Parameters->Flags & THREAD_FLAG_BOUND) != 0) {
+        Status = KeBindThreadToProcessor(NewThread, Parameters->Processor);
+        if (!KSUCCESS(Status)) {
+            goto CreateThreadEnd;
+        }
+    }
+
     PspPrepareThreadForFirstRun(NewThread, NULL, ParameterIsStack);
 
     //
@@ -1347,6 +1358,13 @@ Return Value:
 
     Thread->Flags |= THREAD_FLAG_EXITING;
 
+    //
+    // A vfork child that exits without executing an image must give the
+    // parent its address space back before anything below tears down memory.
+    //
+
+    PspReleaseVforkParent(Thread);
+
     //
     // Free the user mode stack before decrementing the thread count.
     //
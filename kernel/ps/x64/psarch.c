@@ -669,6 +669,33 @@ Return Value:
     return STATUS_SUCCESS;
 }
 
+PVOID
+PspArchGetUserStackPointer (
+    PTRAP_FRAME TrapFrame
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the user mode stack pointer saved in the given trap
+    frame.
+
+Arguments:
+
+    TrapFrame - Supplies a pointer to the user mode trap frame.
+
+Return Value:
+
+    Returns the user mode stack pointer.
+
+--*/
+
+{
+
+    return (PVOID)(UINTN)(TrapFrame->Rsp);
+}
+
 KSTATUS
 PspArchGetDebugBreakInformation (
     PTRAP_FRAME TrapFrame
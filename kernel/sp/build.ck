@@ -37,7 +37,9 @@ function build() {
 
     baseSources = [
         "info.c",
-        "profiler.c"
+        "offcpu.c",
+        "profiler.c",
+        "trace.c"
     ];
 
     if ((arch == "armv7") || (arch == "armv6")) {
@@ -106,6 +106,14 @@ Return Value:
         Status = SppGetSetState(Data, DataSize, Set);
         break;
 
+    case SpInformationTraceState:
+        Status = SppGetSetTraceState(Data, DataSize, Set);
+        break;
+
+    case SpInformationTraceRead:
+        Status = SppReadTrace(Data, DataSize, Set);
+        break;
+
     default:
         Status = STATUS_INVALID_PARAMETER;
         *DataSize = 0;
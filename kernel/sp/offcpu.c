@@ -0,0 +1,701 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    offcpu.c
+
+Abstract:
+
+    This module implements off-CPU profiling. When a thread blocks, its call
+    stack and wait object are recorded, and when it is woken the time it spent
+    blocked is charged to that call stack and wait reason.
+
+Author:
+
+    agent 19-Oct-2026
+
+Environment:
+
+    Kernel
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <minoca/kernel/kernel.h>
+#include "spp.h"
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+#define SP_OFF_CPU_ALLOCATION_TAG 0x664F7053 // 'fOpS'
+
+//
+// Define the number of slots in the table of unique blocking call stacks.
+// This must be a power of two. New call stacks stop being added once the
+// table is three quarters full so that lookups stay short.
+//
+
+#define SP_OFF_CPU_RECORD_COUNT 256
+#define SP_OFF_CPU_RECORD_LIMIT ((SP_OFF_CPU_RECORD_COUNT * 3) / 4)
+
+//
+// Define the number of innermost frames left off each call stack. This skips
+// the return address into the routine doing the recording, which is the same
+// for every wait.
+//
+
+#define SP_OFF_CPU_SKIPPED_FRAMES 1
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+/*++
+
+Structure Description:
+
+    This structure defines the accumulated statistics for every wait that
+    blocked with the same call stack for the same reason. Records are only
+    added while off-CPU profiling is collecting, and are all cleared when it
+    starts.
+
+Members:
+
+    Reason - Stores the reason the threads blocked, or
+        ProfilerOffCpuReasonInvalid if the record is free.
+
+    Hash - Stores the hash of the reason and call stack.
+
+    FrameCount - Stores the number of valid entries in the frames array.
+
+    WaitObject - Stores the address of the object or queue most recently
+        waited on with this call stack.
+
+    Count - Stores the number of waits that completed.
+
+    TotalTime - Stores the total time spent blocked, in time counter ticks.
+
+    MaxTime - Stores the longest single wait, in time counter ticks.
+
+    Frames - Stores the call stack, innermost frame first.
+
+--*/
+
+typedef struct _SP_OFF_CPU_RECORD {
+    PROFILER_OFF_CPU_REASON Reason;
+    ULONG Hash;
+    ULONG FrameCount;
+    PVOID WaitObject;
+    volatile ULONGLONG Count;
+    volatile ULONGLONG TotalTime;
+    volatile ULONGLONG MaxTime;
+    PVOID Frames[PROFILER_OFF_CPU_MAX_FRAMES];
+} SP_OFF_CPU_RECORD, *PSP_OFF_CPU_RECORD;
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+VOID
+SppRecordThreadBlock (
+    PKTHREAD Thread
+    );
+
+VOID
+SppRecordThreadWake (
+    PKTHREAD Thread
+    );
+
+PSP_OFF_CPU_RECORD
+SppFindOffCpuRecord (
+    PROFILER_OFF_CPU_REASON Reason,
+    PVOID *Frames,
+    ULONG FrameCount
+    );
+
+PROFILER_OFF_CPU_REASON
+SppGetOffCpuReason (
+    POBJECT_HEADER Object
+    );
+
+VOID
+SppUpdateOffCpuMaximum (
+    volatile ULONGLONG *Maximum,
+    ULONGLONG Value
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// Store pointers to the functions the scheduler and object manager call when
+// threads block and wake. These are only set while off-CPU profiling is
+// collecting.
+//
+
+PSP_RECORD_THREAD_BLOCK SpRecordThreadBlockRoutine;
+PSP_RECORD_THREAD_WAKE SpRecordThreadWakeRoutine;
+
+//
+// Store the table of off-CPU records. It is allocated the first time off-CPU
+// profiling is enabled and never freed, since threads that blocked while
+// profiling was enabled may still point into it.
+//
+
+PSP_OFF_CPU_RECORD SpOffCpuRecords;
+volatile ULONG SpOffCpuRecordsInUse;
+KSPIN_LOCK SpOffCpuLock;
+
+//
+// Store the number of waits that could not be recorded because the table was
+// full.
+//
+
+volatile ULONGLONG SpOffCpuDroppedCount;
+
+//
+// Store the time counter value when the current collection started. Waits
+// that began before this are not counted.
+//
+
+ULONGLONG SpOffCpuStartTime;
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+KSTATUS
+SppSetOffCpuStatistics (
+    BOOL Enable
+    )
+
+/*++
+
+Routine Description:
+
+    This routine enables or disables off-CPU statistics collection on blocked
+    threads. Enabling statistics discards anything collected previously.
+
+Arguments:
+
+    Enable - Supplies a boolean indicating whether off-CPU statistics should be
+        collected (TRUE) or not (FALSE).
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    ULONG AllocationSize;
+    RUNLEVEL OldRunLevel;
+    PSP_OFF_CPU_RECORD Records;
+
+    if (Enable == FALSE) {
+        SpRecordThreadBlockRoutine = NULL;
+        SpRecordThreadWakeRoutine = NULL;
+        RtlMemoryBarrier();
+        return STATUS_SUCCESS;
+    }
+
+    ASSERT(KeGetRunLevel() == RunLevelLow);
+    ASSERT(KeIsQueuedLockHeld(SpProfilingQueuedLock) != FALSE);
+
+    AllocationSize = sizeof(SP_OFF_CPU_RECORD) * SP_OFF_CPU_RECORD_COUNT;
+    if (SpOffCpuRecords == NULL) {
+        Records = MmAllocateNonPagedPool(AllocationSize,
+                                         SP_OFF_CPU_ALLOCATION_TAG);
+
+        if (Records == NULL) {
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+
+        KeInitializeSpinLock(&SpOffCpuLock);
+        SpOffCpuRecords = Records;
+    }
+
+    //
+    // Wipe out the previous collection. A straggling wake from the previous
+    // collection may still land on a record being cleared here, but it is
+    // ignored once the new start time is set below.
+    //
+
+    OldRunLevel = KeRaiseRunLevel(RunLevelDispatch);
+    KeAcquireSpinLock(&SpOffCpuLock);
+    RtlZeroMemory(SpOffCpuRecords, AllocationSize);
+    SpOffCpuRecordsInUse = 0;
+    SpOffCpuDroppedCount = 0;
+    SpOffCpuStartTime = HlQueryTimeCounter();
+    KeReleaseSpinLock(&SpOffCpuLock);
+    KeLowerRunLevel(OldRunLevel);
+
+    //
+    // Set the wake routine first so that no block is recorded without a way
+    // to close it out.
+    //
+
+    RtlMemoryBarrier();
+    SpRecordThreadWakeRoutine = SppRecordThreadWake;
+    SpRecordThreadBlockRoutine = SppRecordThreadBlock;
+    return STATUS_SUCCESS;
+}
+
+KSTATUS
+SppGetOffCpuStatistics (
+    PVOID *Buffer,
+    PULONG BufferSize,
+    ULONG Tag
+    )
+
+/*++
+
+Routine Description:
+
+    This routine allocates a buffer and fills it with the off-CPU statistics
+    collected so far, in the format described by the system profiler protocol.
+
+Arguments:
+
+    Buffer - Supplies a pointer that receives a non-paged pool buffer full of
+        off-CPU statistics. The caller is responsible for freeing it.
+
+    BufferSize - Supplies a pointer that receives the size of the buffer, in
+        bytes.
+
+    Tag - Supplies an identifier to associate with the allocation, useful for
+        debugging and leak detection.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    PBYTE Data;
+    ULONG EntryCount;
+    ULONG FrameIndex;
+    PPROFILER_OFF_CPU_HEADER Header;
+    ULONG Index;
+    ULONG MaxEntryCount;
+    ULONG Offset;
+    RUNLEVEL OldRunLevel;
+    PSP_OFF_CPU_RECORD Record;
+    ULONG Size;
+    PPROFILER_OFF_CPU_STATISTIC Statistic;
+
+    ASSERT(KeGetRunLevel() == RunLevelLow);
+    ASSERT(SpOffCpuRecords != NULL);
+
+    //
+    // Size the buffer for the records in use now, assuming every one has a
+    // full call stack. Records are never removed during a collection, so any
+    // added after this are just left out of this snapshot.
+    //
+
+    MaxEntryCount = SpOffCpuRecordsInUse;
+    Size = sizeof(PROFILER_OFF_CPU_HEADER) +
+           (MaxEntryCount *
+            (FIELD_OFFSET(PROFILER_OFF_CPU_STATISTIC, Frames) +
+             (PROFILER_OFF_CPU_MAX_FRAMES * sizeof(ULONGLONG))));
+
+    Data = MmAllocateNonPagedPool(Size, Tag);
+    if (Data == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    EntryCount = 0;
+    Offset = sizeof(PROFILER_OFF_CPU_HEADER);
+    Header = (PPROFILER_OFF_CPU_HEADER)Data;
+    Header->Magic = PROFILER_OFF_CPU_MAGIC;
+    Header->TimeCounterFrequency = HlQueryTimeCounterFrequency();
+
+    //
+    // Hold the lock so that records are not caught half initialized. Only
+    // waits that have completed are reported.
+    //
+
+    OldRunLevel = KeRaiseRunLevel(RunLevelDispatch);
+    KeAcquireSpinLock(&SpOffCpuLock);
+    for (Index = 0;
+         (Index < SP_OFF_CPU_RECORD_COUNT) && (EntryCount < MaxEntryCount);
+         Index += 1) {
+
+        Record = &(SpOffCpuRecords[Index]);
+        if ((Record->Reason == ProfilerOffCpuReasonInvalid) ||
+            (Record->Count == 0)) {
+
+            continue;
+        }
+
+        Statistic = (PPROFILER_OFF_CPU_STATISTIC)(Data + Offset);
+        Statistic->StructureSize =
+                          FIELD_OFFSET(PROFILER_OFF_CPU_STATISTIC, Frames) +
+                          (Record->FrameCount * sizeof(ULONGLONG));
+
+        Statistic->Reason = Record->Reason;
+        Statistic->FrameCount = Record->FrameCount;
+        Statistic->WaitObject = (UINTN)(Record->WaitObject);
+        Statistic->Count = Record->Count;
+        Statistic->TotalTime = Record->TotalTime;
+        Statistic->MaxTime = Record->MaxTime;
+        for (FrameIndex = 0;
+             FrameIndex < Record->FrameCount;
+             FrameIndex += 1) {
+
+            Statistic->Frames[FrameIndex] = (UINTN)(Record->Frames[FrameIndex]);
+        }
+
+        Offset += Statistic->StructureSize;
+        EntryCount += 1;
+    }
+
+    Header->DroppedCount = SpOffCpuDroppedCount;
+    KeReleaseSpinLock(&SpOffCpuLock);
+    KeLowerRunLevel(OldRunLevel);
+
+    ASSERT(Offset <= Size);
+
+    Header->EntryCount = EntryCount;
+    *Buffer = Data;
+    *BufferSize = Offset;
+    return STATUS_SUCCESS;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+VOID
+SppRecordThreadBlock (
+    PKTHREAD Thread
+    )
+
+/*++
+
+Routine Description:
+
+    This routine records the stack and wait object of a thread that is
+    blocking. This routine must be called at dispatch level inside the
+    scheduler, on the stack of the blocking thread.
+
+Arguments:
+
+    Thread - Supplies a pointer to the thread being scheduled out.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONGLONG BlockTime;
+    PVOID CallStack[PROFILER_OFF_CPU_MAX_FRAMES + SP_OFF_CPU_SKIPPED_FRAMES];
+    ULONG CallStackSize;
+    ULONG FrameCount;
+    POBJECT_HEADER Object;
+    PROFILER_OFF_CPU_REASON Reason;
+    PSP_OFF_CPU_RECORD Record;
+    KSTATUS Status;
+    PVOID WaitObject;
+
+    ASSERT(KeGetRunLevel() == RunLevelDispatch);
+    ASSERT(Thread == KeGetCurrentThread());
+    ASSERT(Thread->WaitBlock != NULL);
+
+    BlockTime = HlQueryTimeCounter();
+    Thread->OffCpuRecord = NULL;
+
+    //
+    // Figure out what the thread is waiting on. Waits on bare queues, such as
+    // user mode locks, have no object to classify them by.
+    //
+
+    Object = ObGetBlockingObject(Thread);
+    if (Object != NULL) {
+        Reason = SppGetOffCpuReason(Object);
+        WaitObject = Object;
+
+    } else {
+        Reason = ProfilerOffCpuReasonQueue;
+        WaitObject = ObGetBlockingQueue(Thread);
+    }
+
+    CallStackSize = sizeof(CallStack);
+    Status = SppArchGetCurrentKernelStackData(CallStack, &CallStackSize);
+    if (!KSUCCESS(Status)) {
+        return;
+    }
+
+    FrameCount = CallStackSize / sizeof(PVOID);
+    if (FrameCount <= SP_OFF_CPU_SKIPPED_FRAMES) {
+        return;
+    }
+
+    FrameCount -= SP_OFF_CPU_SKIPPED_FRAMES;
+    Record = SppFindOffCpuRecord(Reason,
+                                 &(CallStack[SP_OFF_CPU_SKIPPED_FRAMES]),
+                                 FrameCount);
+
+    if (Record == NULL) {
+        RtlAtomicAdd64((PULONGLONG)&SpOffCpuDroppedCount, 1);
+        return;
+    }
+
+    Record->WaitObject = WaitObject;
+    Thread->BlockTime = BlockTime;
+    Thread->OffCpuRecord = Record;
+    return;
+}
+
+VOID
+SppRecordThreadWake (
+    PKTHREAD Thread
+    )
+
+/*++
+
+Routine Description:
+
+    This routine records how long a blocked thread was off the processor. It
+    is called just before the thread is made ready.
+
+Arguments:
+
+    Thread - Supplies a pointer to the thread being woken.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONGLONG BlockedTime;
+    PSP_OFF_CPU_RECORD Record;
+
+    Record = Thread->OffCpuRecord;
+    if (Record == NULL) {
+        return;
+    }
+
+    Thread->OffCpuRecord = NULL;
+
+    //
+    // Skip waits that began before the current collection started. The record
+    // they point at has since been cleared and may have been reused.
+    //
+
+    if (Thread->BlockTime < SpOffCpuStartTime) {
+        return;
+    }
+
+    BlockedTime = HlQueryTimeCounter() - Thread->BlockTime;
+    RtlAtomicAdd64((PULONGLONG)&(Record->Count), 1);
+    RtlAtomicAdd64((PULONGLONG)&(Record->TotalTime), BlockedTime);
+    SppUpdateOffCpuMaximum(&(Record->MaxTime), BlockedTime);
+    return;
+}
+
+PSP_OFF_CPU_RECORD
+SppFindOffCpuRecord (
+    PROFILER_OFF_CPU_REASON Reason,
+    PVOID *Frames,
+    ULONG FrameCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine finds the record for the given wait reason and call stack,
+    creating one if this is the first time it has been seen. This routine must
+    be called at dispatch level.
+
+Arguments:
+
+    Reason - Supplies the reason the thread blocked.
+
+    Frames - Supplies the call stack of the blocking thread, innermost frame
+        first.
+
+    FrameCount - Supplies the number of frames in the call stack.
+
+Return Value:
+
+    Returns a pointer to the record on success.
+
+    NULL if the call stack has not been seen before and the table is full.
+
+--*/
+
+{
+
+    ULONG Hash;
+    ULONG Index;
+    PSP_OFF_CPU_RECORD Record;
+
+    ASSERT(FrameCount <= PROFILER_OFF_CPU_MAX_FRAMES);
+
+    Hash = Reason;
+    for (Index = 0; Index < FrameCount; Index += 1) {
+        Hash = (Hash * 31) + (ULONG)(UINTN)(Frames[Index]);
+    }
+
+    //
+    // Probe linearly from the hashed slot. The table is never allowed to
+    // fill completely, so this always stops at a free record if the call
+    // stack is not found.
+    //
+
+    Index = Hash & (SP_OFF_CPU_RECORD_COUNT - 1);
+    KeAcquireSpinLock(&SpOffCpuLock);
+    while (TRUE) {
+        Record = &(SpOffCpuRecords[Index]);
+        if (Record->Reason == ProfilerOffCpuReasonInvalid) {
+            if (SpOffCpuRecordsInUse >= SP_OFF_CPU_RECORD_LIMIT) {
+                Record = NULL;
+                break;
+            }
+
+            Record->Hash = Hash;
+            Record->FrameCount = FrameCount;
+            RtlCopyMemory(Record->Frames, Frames, FrameCount * sizeof(PVOID));
+            Record->Reason = Reason;
+            SpOffCpuRecordsInUse += 1;
+            break;
+        }
+
+        if ((Record->Hash == Hash) &&
+            (Record->Reason == Reason) &&
+            (Record->FrameCount == FrameCount) &&
+            (RtlCompareMemory(Record->Frames,
+                              Frames,
+                              FrameCount * sizeof(PVOID)) != FALSE)) {
+
+            break;
+        }
+
+        Index = (Index + 1) & (SP_OFF_CPU_RECORD_COUNT - 1);
+    }
+
+    KeReleaseSpinLock(&SpOffCpuLock);
+    return Record;
+}
+
+PROFILER_OFF_CPU_REASON
+SppGetOffCpuReason (
+    POBJECT_HEADER Object
+    )
+
+/*++
+
+Routine Description:
+
+    This routine classifies a wait by the type of object being waited on.
+
+Arguments:
+
+    Object - Supplies a pointer to the object the thread is blocking on.
+
+Return Value:
+
+    Returns the off-CPU reason for the wait.
+
+--*/
+
+{
+
+    switch (Object->Type) {
+    case ObjectQueuedLock:
+        return ProfilerOffCpuReasonQueuedLock;
+
+    case ObjectEvent:
+        return ProfilerOffCpuReasonEvent;
+
+    case ObjectTimer:
+        return ProfilerOffCpuReasonTimer;
+
+    case ObjectProcess:
+    case ObjectThread:
+        return ProfilerOffCpuReasonThread;
+
+    case ObjectDevice:
+    case ObjectIrp:
+    case ObjectVolume:
+    case ObjectPipe:
+    case ObjectTerminalMaster:
+    case ObjectTerminalSlave:
+        return ProfilerOffCpuReasonIo;
+
+    default:
+        break;
+    }
+
+    return ProfilerOffCpuReasonObject;
+}
+
+VOID
+SppUpdateOffCpuMaximum (
+    volatile ULONGLONG *Maximum,
+    ULONGLONG Value
+    )
+
+/*++
+
+Routine Description:
+
+    This routine atomically raises a maximum to the given value if the value
+    is larger.
+
+Arguments:
+
+    Maximum - Supplies a pointer to the maximum to update.
+
+    Value - Supplies the new value.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONGLONG Current;
+    ULONGLONG Previous;
+
+    Current = *Maximum;
+    while (Value > Current) {
+        Previous = RtlAtomicCompareExchange64((PULONGLONG)Maximum,
+                                              Value,
+                                              Current);
+
+        if (Previous == Current) {
+            break;
+        }
+
+        Current = Previous;
+    }
+
+    return;
+}
+
@@ -52,16 +52,17 @@ Module Name:
 #define PROFILER_BUFFER_LENGTH (128 * 1024)
 
 //
-// Define the period between memory statistics updates, in microseoncds.
+// Define the period between memory and lock statistics updates, in
+// microseoncds.
 //
 
-#define MEMORY_STATISTICS_TIMER_PERIOD (1000 * MICROSECONDS_PER_MILLISECOND)
+#define STATISTICS_TIMER_PERIOD (1000 * MICROSECONDS_PER_MILLISECOND)
 
 //
-// Define the number of buffers required to track memory profiling data.
+// Define the number of buffers required to track periodic statistics data.
 //
 
-#define MEMORY_BUFFER_COUNT 3
+#define STATISTICS_BUFFER_COUNT 3
 
 //
 // Define the buffer size for a new process or thread.
@@ -108,36 +109,69 @@ typedef struct _PROFILER_BUFFER {
     BYTE Scratch[SCRATCH_BUFFER_LENGTH];
 } PROFILER_BUFFER, *PPROFILER_BUFFER;
 
+typedef
+KSTATUS
+(*PSTATISTICS_COLLECTION_ROUTINE) (
+    PVOID *Buffer,
+    PULONG BufferSize,
+    ULONG Tag
+    );
+
+/*++
+
+Routine Description:
+
+    This routine allocates a buffer and fills it with a snap of statistics.
+
+Arguments:
+
+    Buffer - Supplies a pointer that receives a non-paged pool buffer full of
+        statistics.
+
+    BufferSize - Supplies a pointer that receives the size of the buffer, in
+        bytes.
+
+    Tag - Supplies an identifier to associate with the allocation.
+
+Return Value:
+
+    Status code.
+
+--*/
+
 /*++
 
 Structure Description:
 
-    This structure defines a memory statistics collection buffer for the
-    system profiler.
+    This structure defines a statistics collection buffer for the system
+    profiler.
 
 Members:
 
-    Buffer - Stores a byte array of memory statistics data.
+    Buffer - Stores a byte array of statistics data.
 
     BufferSize - Stores the size of the buffer, in bytes.
 
+    ConsumerIndex - Stores the offset of the next byte the consumer reads.
+
 --*/
 
-typedef struct _MEMORY_BUFFER {
+typedef struct _STATISTICS_BUFFER {
     BYTE *Buffer;
     ULONG BufferSize;
     ULONG ConsumerIndex;
-} MEMORY_BUFFER, *PMEMORY_BUFFER;
+} STATISTICS_BUFFER, *PSTATISTICS_BUFFER;
 
 /*++
 
 Structure Description:
 
-    This structure defines the system's memory profiling state.
+    This structure defines the state of a profiler type that periodically
+    snaps a buffer of statistics, such as memory or lock statistics.
 
 Members:
 
-    MemoryBuffers - Stores an array of points to memory buffers.
+    Buffers - Stores an array of statistics buffers.
 
     ConsumerActive - Stores a boolean indicating whether or not the consumer
         is active.
@@ -156,17 +190,27 @@ Structure Description:
     ThreadAlive - Stores a boolean indicating whether the thread is alive or
         not.
 
+    TypeFlag - Stores the PROFILER_TYPE_FLAG_* value for this profiler.
+
+    DataType - Stores the data type of the notifications this profiler sends.
+
+    CollectionRoutine - Stores a pointer to the routine that snaps the
+        statistics.
+
 --*/
 
-typedef struct _MEMORY_PROFILER {
-    MEMORY_BUFFER MemoryBuffers[MEMORY_BUFFER_COUNT];
+typedef struct _STATISTICS_PROFILER {
+    STATISTICS_BUFFER Buffers[STATISTICS_BUFFER_COUNT];
     BOOL ConsumerActive;
     ULONG ConsumerIndex;
     ULONG ReadyIndex;
     ULONG ProducerIndex;
     PKTIMER Timer;
     volatile BOOL ThreadAlive;
-} MEMORY_PROFILER, *PMEMORY_PROFILER;
+    ULONG TypeFlag;
+    PROFILER_DATA_TYPE DataType;
+    PSTATISTICS_COLLECTION_ROUTINE CollectionRoutine;
+} STATISTICS_PROFILER, *PSTATISTICS_PROFILER;
 
 //
 // ----------------------------------------------- Internal Function Prototypes
@@ -214,11 +258,51 @@ SppDestroyMemoryStatistics (
     ULONG Phase
     );
 
+KSTATUS
+SppInitializeLockStatistics (
+    VOID
+    );
+
+VOID
+SppDestroyLockStatistics (
+    ULONG Phase
+    );
+
+KSTATUS
+SppInitializeOffCpuStatistics (
+    VOID
+    );
+
+VOID
+SppDestroyOffCpuStatistics (
+    ULONG Phase
+    );
+
+KSTATUS
+SppInitializeStatisticsProfiler (
+    PSTATISTICS_PROFILER *Profiler,
+    ULONG TypeFlag,
+    PROFILER_DATA_TYPE DataType,
+    PSTATISTICS_COLLECTION_ROUTINE CollectionRoutine
+    );
+
 VOID
-SppMemoryStatisticsThread (
+SppDestroyStatisticsProfiler (
+    PSTATISTICS_PROFILER *Profiler,
+    ULONG Phase
+    );
+
+VOID
+SppStatisticsThread (
     PVOID Parameter
     );
 
+BOOL
+SppReadStatisticsProfiler (
+    PSTATISTICS_PROFILER Statistics,
+    PPROFILER_NOTIFICATION ProfilerNotification
+    );
+
 KSTATUS
 SppInitializeThreadStatistics (
     VOID
@@ -292,7 +376,19 @@ ULONG SpStackSamplingArraySize;
 // Stores a pointer to a structure that tracks memory statistics profiling.
 //
 
-PMEMORY_PROFILER SpMemory;
+PSTATISTICS_PROFILER SpMemory;
+
+//
+// Stores a pointer to a structure that tracks lock statistics profiling.
+//
+
+PSTATISTICS_PROFILER SpLock;
+
+//
+// Stores a pointer to a structure that tracks off-CPU statistics profiling.
+//
+
+PSTATISTICS_PROFILER SpOffCpu;
 
 //
 // Structures that store thread statistics.
@@ -334,9 +430,11 @@ Return Value:
 
     PVOID *CallStack;
     ULONG CallStackSize;
+    ULONG HeaderSize;
     ULONG Processor;
-    PVOID Scratch;
+    PUINTN Scratch;
     KSTATUS Status;
+    PKTHREAD Thread;
 
     ASSERT(KeGetRunLevel() == RunLevelHigh);
 
@@ -371,9 +469,10 @@ Return Value:
     // Collect the stack data from the trap frame.
     //
 
-    Scratch = SpStackSamplingArray[Processor]->Scratch;
-    CallStackSize = SCRATCH_BUFFER_LENGTH - sizeof(UINTN);
-    CallStack = (PVOID *)(Scratch + sizeof(UINTN));
+    Scratch = (PUINTN)(SpStackSamplingArray[Processor]->Scratch);
+    HeaderSize = PROFILER_STACK_SAMPLE_HEADER_COUNT * sizeof(UINTN);
+    CallStackSize = SCRATCH_BUFFER_LENGTH - HeaderSize;
+    CallStack = (PVOID *)(Scratch + PROFILER_STACK_SAMPLE_HEADER_COUNT);
     Status = SppArchGetKernelStackData(TrapFrame, CallStack, &CallStackSize);
     if (!KSUCCESS(Status)) {
         return;
@@ -381,8 +480,21 @@ Return Value:
 
     ASSERT(CallStackSize != 0);
 
-    CallStackSize += sizeof(UINTN);
-    *((PUINTN)Scratch) = PROFILER_DATA_SENTINEL | CallStackSize;
+    //
+    // Tag the sample with the interrupted thread so the consumer can
+    // attribute it to a process and thread.
+    //
+
+    Scratch[1] = 0;
+    Scratch[2] = 0;
+    Thread = KeGetCurrentThread();
+    if (Thread != NULL) {
+        Scratch[1] = Thread->OwningProcess->Identifiers.ProcessId;
+        Scratch[2] = Thread->ThreadId;
+    }
+
+    CallStackSize += HeaderSize;
+    Scratch[0] = PROFILER_DATA_SENTINEL | CallStackSize;
 
     //
     // Write the data to the sampling buffer.
@@ -461,11 +573,8 @@ Return Value:
 
 {
 
-    ULONG DataSize;
-    PMEMORY_BUFFER MemoryBuffer;
     ULONG Processor;
     BOOL ReadMore;
-    ULONG RemainingLength;
 
     ASSERT(Flags != NULL);
     ASSERT(*Flags != 0);
@@ -504,50 +613,8 @@ Return Value:
         }
 
     } else if ((*Flags & PROFILER_TYPE_FLAG_MEMORY_STATISTICS) != 0) {
-
-        //
-        // If the consumer is not currently active, then get the next buffer to
-        // consume, which is indicated by the ready index.
-        //
-
-        if (SpMemory->ConsumerActive == FALSE) {
-            SpMemory->ConsumerIndex = SpMemory->ReadyIndex;
-            SpMemory->ConsumerActive = TRUE;
-        }
-
-        //
-        // Copy as much data as possible from the consumer buffer to the
-        // profiler notification data buffer.
-        //
-
-        MemoryBuffer = &(SpMemory->MemoryBuffers[SpMemory->ConsumerIndex]);
-        RemainingLength = MemoryBuffer->BufferSize -
-                          MemoryBuffer->ConsumerIndex;
-
-        if (RemainingLength < ProfilerNotification->Header.DataSize) {
-            DataSize = RemainingLength;
-
-        } else {
-            DataSize = ProfilerNotification->Header.DataSize;
-        }
-
-        if (DataSize != 0) {
-            RtlCopyMemory(ProfilerNotification->Data,
-                          &(MemoryBuffer->Buffer[MemoryBuffer->ConsumerIndex]),
-                          DataSize);
-        }
-
-        MemoryBuffer->ConsumerIndex += DataSize;
-        ProfilerNotification->Header.Type = ProfilerDataTypeMemory;
-        ProfilerNotification->Header.Processor = KeGetCurrentProcessorNumber();
-        ProfilerNotification->Header.DataSize = DataSize;
-
-        //
-        // Mark the consumer inactive if all the data was consumed.
-        //
-
-        if (MemoryBuffer->ConsumerIndex == MemoryBuffer->BufferSize) {
-            SpMemory->ConsumerActive = FALSE;
+        ReadMore = SppReadStatisticsProfiler(SpMemory, ProfilerNotification);
+        if (ReadMore == FALSE) {
             *Flags &= ~PROFILER_TYPE_FLAG_MEMORY_STATISTICS;
         }
 
@@ -578,6 +645,18 @@ Return Value:
         if (ReadMore == FALSE) {
             *Flags &= ~PROFILER_TYPE_FLAG_THREAD_STATISTICS;
         }
+
+    } else if ((*Flags & PROFILER_TYPE_FLAG_LOCK_STATISTICS) != 0) {
+        ReadMore = SppReadStatisticsProfiler(SpLock, ProfilerNotification);
+        if (ReadMore == FALSE) {
+            *Flags &= ~PROFILER_TYPE_FLAG_LOCK_STATISTICS;
+        }
+
+    } else if ((*Flags & PROFILER_TYPE_FLAG_OFF_CPU_STATISTICS) != 0) {
+        ReadMore = SppReadStatisticsProfiler(SpOffCpu, ProfilerNotification);
+        if (ReadMore == FALSE) {
+            *Flags &= ~PROFILER_TYPE_FLAG_OFF_CPU_STATISTICS;
+        }
     }
 
     return STATUS_SUCCESS;
@@ -698,6 +777,27 @@ Return Value:
         }
     }
 
+    //
+    // Determine if there are lock statistics to send, the same way as memory
+    // statistics.
+    //
+
+    if ((Flags & PROFILER_TYPE_FLAG_LOCK_STATISTICS) != 0) {
+        if ((SpLock->ConsumerIndex == SpLock->ReadyIndex) ||
+            (SpLock->ConsumerIndex == SpLock->ProducerIndex)) {
+
+            Flags &= ~PROFILER_TYPE_FLAG_LOCK_STATISTICS;
+        }
+    }
+
+    if ((Flags & PROFILER_TYPE_FLAG_OFF_CPU_STATISTICS) != 0) {
+        if ((SpOffCpu->ConsumerIndex == SpOffCpu->ReadyIndex) ||
+            (SpOffCpu->ConsumerIndex == SpOffCpu->ProducerIndex)) {
+
+            Flags &= ~PROFILER_TYPE_FLAG_OFF_CPU_STATISTICS;
+        }
+    }
+
     return Flags;
 }
 
@@ -850,6 +950,24 @@ Return Value:
         InitializedFlags |= PROFILER_TYPE_FLAG_THREAD_STATISTICS;
     }
 
+    if ((NewFlags & PROFILER_TYPE_FLAG_LOCK_STATISTICS) != 0) {
+        Status = SppInitializeLockStatistics();
+        if (!KSUCCESS(Status)) {
+            goto StartSystemProfilerEnd;
+        }
+
+        InitializedFlags |= PROFILER_TYPE_FLAG_LOCK_STATISTICS;
+    }
+
+    if ((NewFlags & PROFILER_TYPE_FLAG_OFF_CPU_STATISTICS) != 0) {
+        Status = SppInitializeOffCpuStatistics();
+        if (!KSUCCESS(Status)) {
+            goto StartSystemProfilerEnd;
+        }
+
+        InitializedFlags |= PROFILER_TYPE_FLAG_OFF_CPU_STATISTICS;
+    }
+
     KeUpdateClockForProfiling(TRUE);
     Status = STATUS_SUCCESS;
 
@@ -942,6 +1060,14 @@ Return Value:
         SppDestroyThreadStatistics(0);
     }
 
+    if ((DisableFlags & PROFILER_TYPE_FLAG_LOCK_STATISTICS) != 0) {
+        SppDestroyLockStatistics(0);
+    }
+
+    if ((DisableFlags & PROFILER_TYPE_FLAG_OFF_CPU_STATISTICS) != 0) {
+        SppDestroyOffCpuStatistics(0);
+    }
+
     //
     // Once phase zero destruction is complete, each profiler has stopped
     // producing data immediately, but another core may be in the middle of
@@ -1020,6 +1146,14 @@ Return Value:
         SppDestroyThreadStatistics(1);
     }
 
+    if ((DisableFlags & PROFILER_TYPE_FLAG_LOCK_STATISTICS) != 0) {
+        SppDestroyLockStatistics(1);
+    }
+
+    if ((DisableFlags & PROFILER_TYPE_FLAG_OFF_CPU_STATISTICS) != 0) {
+        SppDestroyOffCpuStatistics(1);
+    }
+
     if (SpEnabledFlags == 0) {
         KeUpdateClockForProfiling(FALSE);
     }
@@ -1613,51 +1747,272 @@ Return Value:
 
 --*/
 
+{
+
+    return SppInitializeStatisticsProfiler(&SpMemory,
+                                           PROFILER_TYPE_FLAG_MEMORY_STATISTICS,
+                                           ProfilerDataTypeMemory,
+                                           MmGetPoolProfilerStatistics);
+}
+
+VOID
+SppDestroyMemoryStatistics (
+    ULONG Phase
+    )
+
+/*++
+
+Routine Description:
+
+    This routine destroys the structures and timers used to profile system
+    memory statistics. Phase 0 stops the memory profiler producers and
+    consumers. Phase 1 cleans up resources.
+
+Arguments:
+
+    Phase - Supplies the current phase of the destruction process.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    SppDestroyStatisticsProfiler(&SpMemory, Phase);
+    return;
+}
+
+KSTATUS
+SppInitializeLockStatistics (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine turns on lock statistics collection and starts periodically
+    sending them to the consumer.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    KSTATUS Status;
+
+    KeSetLockStatistics(TRUE);
+    Status = SppInitializeStatisticsProfiler(&SpLock,
+                                             PROFILER_TYPE_FLAG_LOCK_STATISTICS,
+                                             ProfilerDataTypeLock,
+                                             KeGetLockProfilerStatistics);
+
+    if (!KSUCCESS(Status)) {
+        KeSetLockStatistics(FALSE);
+    }
+
+    return Status;
+}
+
+VOID
+SppDestroyLockStatistics (
+    ULONG Phase
+    )
+
+/*++
+
+Routine Description:
+
+    This routine stops lock statistics collection. Phase 0 stops the lock
+    statistics producers and consumers. Phase 1 cleans up resources.
+
+Arguments:
+
+    Phase - Supplies the current phase of the destruction process.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if (Phase == 0) {
+        KeSetLockStatistics(FALSE);
+    }
+
+    SppDestroyStatisticsProfiler(&SpLock, Phase);
+    return;
+}
+
+KSTATUS
+SppInitializeOffCpuStatistics (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine turns on off-CPU statistics collection for blocked threads
+    and starts periodically sending them to the consumer.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    KSTATUS Status;
+
+    Status = SppSetOffCpuStatistics(TRUE);
+    if (!KSUCCESS(Status)) {
+        return Status;
+    }
+
+    Status = SppInitializeStatisticsProfiler(
+                                        &SpOffCpu,
+                                        PROFILER_TYPE_FLAG_OFF_CPU_STATISTICS,
+                                        ProfilerDataTypeOffCpu,
+                                        SppGetOffCpuStatistics);
+
+    if (!KSUCCESS(Status)) {
+        SppSetOffCpuStatistics(FALSE);
+    }
+
+    return Status;
+}
+
+VOID
+SppDestroyOffCpuStatistics (
+    ULONG Phase
+    )
+
+/*++
+
+Routine Description:
+
+    This routine stops off-CPU statistics collection. Phase 0 stops the
+    off-CPU statistics producers and consumers. Phase 1 cleans up resources.
+
+Arguments:
+
+    Phase - Supplies the current phase of the destruction process.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if (Phase == 0) {
+        SppSetOffCpuStatistics(FALSE);
+    }
+
+    SppDestroyStatisticsProfiler(&SpOffCpu, Phase);
+    return;
+}
+
+KSTATUS
+SppInitializeStatisticsProfiler (
+    PSTATISTICS_PROFILER *Profiler,
+    ULONG TypeFlag,
+    PROFILER_DATA_TYPE DataType,
+    PSTATISTICS_COLLECTION_ROUTINE CollectionRoutine
+    )
+
+/*++
+
+Routine Description:
+
+    This routine initializes the structures, timer, and worker thread for a
+    profiler type that periodically snaps a buffer of statistics.
+
+Arguments:
+
+    Profiler - Supplies a pointer to the global that receives the profiler.
+
+    TypeFlag - Supplies the PROFILER_TYPE_FLAG_* value for the profiler.
+
+    DataType - Supplies the data type to stamp on the notifications sent for
+        this profiler.
+
+    CollectionRoutine - Supplies a pointer to the routine that collects the
+        statistics.
+
+Return Value:
+
+    Status code.
+
+--*/
+
 {
 
     ULONGLONG Period;
+    PSTATISTICS_PROFILER Statistics;
     KSTATUS Status;
 
     ASSERT(KeGetRunLevel() == RunLevelLow);
     ASSERT(KeIsQueuedLockHeld(SpProfilingQueuedLock) != FALSE);
-    ASSERT(SpMemory == NULL);
+    ASSERT(*Profiler == NULL);
 
     //
-    // Allocate the memory profiler structure.
+    // Allocate the statistics profiler structure.
     //
 
-    SpMemory = MmAllocateNonPagedPool(sizeof(MEMORY_PROFILER),
-                                      SP_ALLOCATION_TAG);
+    Statistics = MmAllocateNonPagedPool(sizeof(STATISTICS_PROFILER),
+                                        SP_ALLOCATION_TAG);
 
-    if (SpMemory == NULL) {
+    if (Statistics == NULL) {
         Status = STATUS_INSUFFICIENT_RESOURCES;
-        goto InitializeMemoryStatisticsEnd;
+        goto InitializeStatisticsProfilerEnd;
     }
 
-    RtlZeroMemory(SpMemory, sizeof(MEMORY_PROFILER));
+    RtlZeroMemory(Statistics, sizeof(STATISTICS_PROFILER));
 
-    ASSERT(SpMemory->ConsumerActive == FALSE);
-    ASSERT(SpMemory->ReadyIndex == 0);
-    ASSERT(SpMemory->ProducerIndex == 0);
+    ASSERT(Statistics->ConsumerActive == FALSE);
+    ASSERT(Statistics->ReadyIndex == 0);
+    ASSERT(Statistics->ProducerIndex == 0);
 
-    SpMemory->ConsumerIndex = MEMORY_BUFFER_COUNT - 1;
+    Statistics->ConsumerIndex = STATISTICS_BUFFER_COUNT - 1;
+    Statistics->TypeFlag = TypeFlag;
+    Statistics->DataType = DataType;
+    Statistics->CollectionRoutine = CollectionRoutine;
 
     //
-    // Create the timer that will periodically trigger memory statistics.
+    // Create the timer that will periodically trigger statistics collection.
     //
 
-    SpMemory->Timer = KeCreateTimer(SP_ALLOCATION_TAG);
-    if (SpMemory->Timer == NULL) {
+    Statistics->Timer = KeCreateTimer(SP_ALLOCATION_TAG);
+    if (Statistics->Timer == NULL) {
         Status = STATUS_INSUFFICIENT_RESOURCES;
-        goto InitializeMemoryStatisticsEnd;
+        goto InitializeStatisticsProfilerEnd;
     }
 
     //
     // Queue the timer.
     //
 
-    Period = KeConvertMicrosecondsToTimeTicks(MEMORY_STATISTICS_TIMER_PERIOD);
-    Status = KeQueueTimer(SpMemory->Timer,
+    Period = KeConvertMicrosecondsToTimeTicks(STATISTICS_TIMER_PERIOD);
+    Status = KeQueueTimer(Statistics->Timer,
                           TimerQueueSoft,
                           0,
                           Period,
@@ -1665,7 +2020,7 @@ Return Value:
                           NULL);
 
     if (!KSUCCESS(Status)) {
-        goto InitializeMemoryStatisticsEnd;
+        goto InitializeStatisticsProfilerEnd;
     }
 
     //
@@ -1673,14 +2028,15 @@ Return Value:
     // reference because the destruction routine waits until this thread exits.
     //
 
-    SpMemory->ThreadAlive = TRUE;
-    Status = PsCreateKernelThread(SppMemoryStatisticsThread,
-                                  NULL,
-                                  "SppMemoryStatisticsThread");
+    *Profiler = Statistics;
+    Statistics->ThreadAlive = TRUE;
+    Status = PsCreateKernelThread(SppStatisticsThread,
+                                  Statistics,
+                                  "SppStatisticsThread");
 
     if (!KSUCCESS(Status)) {
-        SpMemory->ThreadAlive = FALSE;
-        goto InitializeMemoryStatisticsEnd;
+        Statistics->ThreadAlive = FALSE;
+        goto InitializeStatisticsProfilerEnd;
     }
 
     //
@@ -1688,23 +2044,23 @@ Return Value:
     //
 
     RtlMemoryBarrier();
-    SpEnabledFlags |= PROFILER_TYPE_FLAG_MEMORY_STATISTICS;
+    SpEnabledFlags |= TypeFlag;
 
-InitializeMemoryStatisticsEnd:
+InitializeStatisticsProfilerEnd:
     if (!KSUCCESS(Status)) {
-        if (SpMemory != NULL) {
-            if (SpMemory->Timer != NULL) {
-                KeDestroyTimer(SpMemory->Timer);
+        if (Statistics != NULL) {
+            if (Statistics->Timer != NULL) {
+                KeDestroyTimer(Statistics->Timer);
             }
 
             //
             // Thread creation should be the last point of failure.
             //
 
-            ASSERT(SpMemory->ThreadAlive == FALSE);
+            ASSERT(Statistics->ThreadAlive == FALSE);
 
-            MmFreeNonPagedPool(SpMemory);
-            SpMemory = NULL;
+            MmFreeNonPagedPool(Statistics);
+            *Profiler = NULL;
         }
     }
 
@@ -1712,7 +2068,8 @@ Return Value:
 }
 
 VOID
-SppDestroyMemoryStatistics (
+SppDestroyStatisticsProfiler (
+    PSTATISTICS_PROFILER *Profiler,
     ULONG Phase
     )
 
@@ -1720,12 +2077,15 @@ SppDestroyMemoryStatistics (
 
 Routine Description:
 
-    This routine destroys the structures and timers used to profile system
-    memory statistics. Phase 0 stops the memory profiler producers and
-    consumers. Phase 1 cleans up resources.
+    This routine destroys the structures and timers used by a periodic
+    statistics profiler. Phase 0 stops the producers and consumers. Phase 1
+    cleans up resources.
 
 Arguments:
 
+    Profiler - Supplies a pointer to the global holding the profiler. It is
+        cleared in phase 1.
+
     Phase - Supplies the current phase of the destruction process.
 
 Return Value:
@@ -1737,30 +2097,33 @@ Return Value:
 {
 
     ULONG Index;
+    PSTATISTICS_PROFILER Statistics;
     KSTATUS Status;
 
+    Statistics = *Profiler;
+
     ASSERT(KeGetRunLevel() == RunLevelLow);
     ASSERT(KeIsQueuedLockHeld(SpProfilingQueuedLock) != FALSE);
-    ASSERT(SpMemory != NULL);
-    ASSERT(SpMemory->Timer != NULL);
+    ASSERT(Statistics != NULL);
+    ASSERT(Statistics->Timer != NULL);
 
     if (Phase == 0) {
 
-        ASSERT(SpMemory->ThreadAlive != FALSE);
-        ASSERT((SpEnabledFlags & PROFILER_TYPE_FLAG_MEMORY_STATISTICS) != 0);
+        ASSERT(Statistics->ThreadAlive != FALSE);
+        ASSERT((SpEnabledFlags & Statistics->TypeFlag) != 0);
 
         //
-        // Disable the memory statistics profiler.
+        // Disable the statistics profiler.
         //
 
-        SpEnabledFlags &= ~PROFILER_TYPE_FLAG_MEMORY_STATISTICS;
+        SpEnabledFlags &= ~(Statistics->TypeFlag);
 
         //
         // Cancel the timer. This is a periodic timer, so cancel should always
         // succeed.
         //
 
-        Status = KeCancelTimer(SpMemory->Timer);
+        Status = KeCancelTimer(Statistics->Timer);
 
         ASSERT(KSUCCESS(Status));
 
@@ -1769,7 +2132,7 @@ Return Value:
         // act of waiting when the timer was cancelled or was processing data.
         //
 
-        Status = KeQueueTimer(SpMemory->Timer,
+        Status = KeQueueTimer(Statistics->Timer,
                               TimerQueueSoftWake,
                               0,
                               0,
@@ -1783,41 +2146,41 @@ Return Value:
         // registered that profiling has been cancelled.
         //
 
-        while (SpMemory->ThreadAlive != FALSE) {
+        while (Statistics->ThreadAlive != FALSE) {
             KeYield();
         }
 
     } else {
 
         ASSERT(Phase == 1);
-        ASSERT((SpEnabledFlags & PROFILER_TYPE_FLAG_MEMORY_STATISTICS) == 0);
-        ASSERT(SpMemory->ThreadAlive == FALSE);
+        ASSERT((SpEnabledFlags & Statistics->TypeFlag) == 0);
+        ASSERT(Statistics->ThreadAlive == FALSE);
 
         //
         // Destroy the timer.
         //
 
-        KeDestroyTimer(SpMemory->Timer);
+        KeDestroyTimer(Statistics->Timer);
 
         //
-        // Release any buffers that are holding pool statistics.
+        // Release any buffers that are holding statistics.
         //
 
-        for (Index = 0; Index < MEMORY_BUFFER_COUNT; Index += 1) {
-            if (SpMemory->MemoryBuffers[Index].Buffer != NULL) {
-                MmFreeNonPagedPool(SpMemory->MemoryBuffers[Index].Buffer);
+        for (Index = 0; Index < STATISTICS_BUFFER_COUNT; Index += 1) {
+            if (Statistics->Buffers[Index].Buffer != NULL) {
+                MmFreeNonPagedPool(Statistics->Buffers[Index].Buffer);
             }
         }
 
-        MmFreeNonPagedPool(SpMemory);
-        SpMemory = NULL;
+        MmFreeNonPagedPool(Statistics);
+        *Profiler = NULL;
     }
 
     return;
 }
 
 VOID
-SppMemoryStatisticsThread (
+SppStatisticsThread (
     PVOID Parameter
     )
 
@@ -1825,15 +2188,14 @@ SppMemoryStatisticsThread (
 
 Routine Description:
 
-    This routine is the workhorse for gathering memory statistics and writing
-    them to a buffer than can then be consumed on the clock interrupt. It waits
-    on the memory statistics timer before periodically collecting the
+    This routine is the workhorse for gathering periodic statistics and
+    writing them to a buffer than can then be consumed on the clock interrupt.
+    It waits on the profiler's timer before periodically collecting the
     statistics.
 
 Arguments:
 
-    Parameter - Supplies a pointer supplied by the creator of the thread. This
-        pointer is not used.
+    Parameter - Supplies a pointer to the statistics profiler.
 
 Return Value:
 
@@ -1846,97 +2208,184 @@ Return Value:
     PVOID Buffer;
     ULONG BufferSize;
     ULONG Index;
-    PMEMORY_BUFFER MemoryBuffer;
+    PSTATISTICS_BUFFER StatisticsBuffer;
+    PSTATISTICS_PROFILER Statistics;
     KSTATUS Status;
 
+    Statistics = Parameter;
+
     ASSERT(KeGetRunLevel() == RunLevelLow);
-    ASSERT(SpMemory->ThreadAlive != FALSE);
+    ASSERT(Statistics->ThreadAlive != FALSE);
 
     while (TRUE) {
 
         //
-        // Wait for the memory statistics timer to expire.
+        // Wait for the statistics timer to expire.
         //
 
-        ObWaitOnObject(SpMemory->Timer, 0, WAIT_TIME_INDEFINITE);
+        ObWaitOnObject(Statistics->Timer, 0, WAIT_TIME_INDEFINITE);
 
         //
-        // Check to make sure memory statistics profiling is still enabled.
+        // Check to make sure this profiler is still enabled.
         //
 
-        if ((SpEnabledFlags & PROFILER_TYPE_FLAG_MEMORY_STATISTICS) == 0) {
+        if ((SpEnabledFlags & Statistics->TypeFlag) == 0) {
             break;
         }
 
         //
-        // Call the memory manager to get the latest pool statistics. It will
+        // Call out to get the latest statistics. The collection routine will
         // pass back an appropriately sized buffer with all the statistics.
         //
 
-        Status = MmGetPoolProfilerStatistics(&Buffer,
-                                             &BufferSize,
-                                             SP_ALLOCATION_TAG);
+        Status = Statistics->CollectionRoutine(&Buffer,
+                                               &BufferSize,
+                                               SP_ALLOCATION_TAG);
 
         if (!KSUCCESS(Status)) {
             continue;
         }
 
         //
-        // Get the producer's memory buffer.
+        // Get the producer's statistics buffer.
         //
 
-        ASSERT(SpMemory->ProducerIndex < MEMORY_BUFFER_COUNT);
+        ASSERT(Statistics->ProducerIndex < STATISTICS_BUFFER_COUNT);
 
-        MemoryBuffer = &(SpMemory->MemoryBuffers[SpMemory->ProducerIndex]);
+        StatisticsBuffer = &(Statistics->Buffers[Statistics->ProducerIndex]);
 
         //
-        // Destroy what is currently in the memory buffer.
+        // Destroy what is currently in the statistics buffer.
         //
 
-        if (MemoryBuffer->Buffer != NULL) {
-            MmFreeNonPagedPool(MemoryBuffer->Buffer);
+        if (StatisticsBuffer->Buffer != NULL) {
+            MmFreeNonPagedPool(StatisticsBuffer->Buffer);
         }
 
         //
         // Reinitialize the buffer.
         //
 
-        MemoryBuffer->Buffer = Buffer;
-        MemoryBuffer->BufferSize = BufferSize;
-        MemoryBuffer->ConsumerIndex = 0;
+        StatisticsBuffer->Buffer = Buffer;
+        StatisticsBuffer->BufferSize = BufferSize;
+        StatisticsBuffer->ConsumerIndex = 0;
 
         //
-        // Now that this is the latest and greatest memory information, point
-        // the ready index at it. It doesn't matter that the ready index and
-        // the producer index will temporarily be the same. There is a
-        // guarantee that the producer will not produce again until it points
-        // at a new buffer. This makes it safe for the consumer to just grab
-        // the ready index.
+        // Now that this is the latest and greatest information, point the
+        // ready index at it. It doesn't matter that the ready index and the
+        // producer index will temporarily be the same. There is a guarantee
+        // that the producer will not produce again until it points at a new
+        // buffer. This makes it safe for the consumer to just grab the ready
+        // index.
         //
 
-        SpMemory->ReadyIndex = SpMemory->ProducerIndex;
+        Statistics->ReadyIndex = Statistics->ProducerIndex;
 
         //
         // Now search for the free buffer and make it the producer index. There
         // always has to be one free.
         //
 
-        for (Index = 0; Index < MEMORY_BUFFER_COUNT; Index += 1) {
-            if ((Index != SpMemory->ReadyIndex) &&
-                (Index != SpMemory->ConsumerIndex)) {
+        for (Index = 0; Index < STATISTICS_BUFFER_COUNT; Index += 1) {
+            if ((Index != Statistics->ReadyIndex) &&
+                (Index != Statistics->ConsumerIndex)) {
 
-                SpMemory->ProducerIndex = Index;
+                Statistics->ProducerIndex = Index;
                 break;
             }
         }
 
-        ASSERT(SpMemory->ReadyIndex != SpMemory->ProducerIndex);
+        ASSERT(Statistics->ReadyIndex != Statistics->ProducerIndex);
     }
 
-    SpMemory->ThreadAlive = FALSE;
+    Statistics->ThreadAlive = FALSE;
     return;
 }
 
+BOOL
+SppReadStatisticsProfiler (
+    PSTATISTICS_PROFILER Statistics,
+    PPROFILER_NOTIFICATION ProfilerNotification
+    )
+
+/*++
+
+Routine Description:
+
+    This routine fills a profiler notification with data from the most recent
+    snap of a periodic statistics profiler.
+
+Arguments:
+
+    Statistics - Supplies a pointer to the statistics profiler to read from.
+
+    ProfilerNotification - Supplies a pointer to the profiler notification to
+        fill in. On input, the data size holds the size of the data buffer.
+
+Return Value:
+
+    TRUE if there is more data to read from the current snap.
+
+    FALSE if the snap has been completely consumed.
+
+--*/
+
+{
+
+    ULONG DataSize;
+    ULONG RemainingLength;
+    PSTATISTICS_BUFFER StatisticsBuffer;
+
+    //
+    // If the consumer is not currently active, then get the next buffer to
+    // consume, which is indicated by the ready index.
+    //
+
+    if (Statistics->ConsumerActive == FALSE) {
+        Statistics->ConsumerIndex = Statistics->ReadyIndex;
+        Statistics->ConsumerActive = TRUE;
+    }
+
+    //
+    // Copy as much data as possible from the consumer buffer to the profiler
+    // notification data buffer.
+    //
+
+    StatisticsBuffer = &(Statistics->Buffers[Statistics->ConsumerIndex]);
+    RemainingLength = StatisticsBuffer->BufferSize -
+                      StatisticsBuffer->ConsumerIndex;
+
+    if (RemainingLength < ProfilerNotification->Header.DataSize) {
+        DataSize = RemainingLength;
+
+    } else {
+        DataSize = ProfilerNotification->Header.DataSize;
+    }
+
+    if (DataSize != 0) {
+        RtlCopyMemory(
+                ProfilerNotification->Data,
+                &(StatisticsBuffer->Buffer[StatisticsBuffer->ConsumerIndex]),
+                DataSize);
+    }
+
+    StatisticsBuffer->ConsumerIndex += DataSize;
+    ProfilerNotification->Header.Type = Statistics->DataType;
+    ProfilerNotification->Header.Processor = KeGetCurrentProcessorNumber();
+    ProfilerNotification->Header.DataSize = DataSize;
+
+    //
+    // Mark the consumer inactive if all the data was consumed.
+    //
+
+    if (StatisticsBuffer->ConsumerIndex == StatisticsBuffer->BufferSize) {
+        Statistics->ConsumerActive = FALSE;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
 KSTATUS
 SppInitializeThreadStatistics (
     VOID
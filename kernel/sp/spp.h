@@ -101,6 +101,120 @@ Return Value:
 
 --*/
 
+KSTATUS
+SppGetSetTraceState (
+    PVOID Data,
+    PUINTN DataSize,
+    BOOL Set
+    );
+
+/*++
+
+Routine Description:
+
+    This routine gets or sets the event tracing state.
+
+Arguments:
+
+    Data - Supplies a pointer to the data buffer where the data is either
+        returned for a get operation or given for a set operation.
+
+    DataSize - Supplies a pointer that on input contains the size of the
+        data buffer. On output, contains the required size of the data buffer.
+
+    Set - Supplies a boolean indicating if this is a get operation (FALSE) or
+        a set operation (TRUE).
+
+Return Value:
+
+    Status code.
+
+--*/
+
+KSTATUS
+SppReadTrace (
+    PVOID Data,
+    PUINTN DataSize,
+    BOOL Set
+    );
+
+/*++
+
+Routine Description:
+
+    This routine drains trace records from every processor's ring buffer.
+
+Arguments:
+
+    Data - Supplies a pointer to the buffer where the records are returned.
+
+    DataSize - Supplies a pointer that on input contains the size of the
+        data buffer. On output, contains the number of bytes of records
+        returned.
+
+    Set - Supplies a boolean indicating if this is a get operation (FALSE) or
+        a set operation (TRUE). Only get operations are supported.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+KSTATUS
+SppSetOffCpuStatistics (
+    BOOL Enable
+    );
+
+/*++
+
+Routine Description:
+
+    This routine enables or disables off-CPU statistics collection on blocked
+    threads. Enabling statistics discards anything collected previously.
+
+Arguments:
+
+    Enable - Supplies a boolean indicating whether off-CPU statistics should be
+        collected (TRUE) or not (FALSE).
+
+Return Value:
+
+    Status code.
+
+--*/
+
+KSTATUS
+SppGetOffCpuStatistics (
+    PVOID *Buffer,
+    PULONG BufferSize,
+    ULONG Tag
+    );
+
+/*++
+
+Routine Description:
+
+    This routine allocates a buffer and fills it with the off-CPU statistics
+    collected so far, in the format described by the system profiler protocol.
+
+Arguments:
+
+    Buffer - Supplies a pointer that receives a non-paged pool buffer full of
+        off-CPU statistics. The caller is responsible for freeing it.
+
+    BufferSize - Supplies a pointer that receives the size of the buffer, in
+        bytes.
+
+    Tag - Supplies an identifier to associate with the allocation, useful for
+        debugging and leak detection.
+
+Return Value:
+
+    Status code.
+
+--*/
+
 KSTATUS
 SppArchGetKernelStackData (
     PTRAP_FRAME TrapFrame,
@@ -132,3 +246,31 @@ Return Value:
 
 --*/
 
+KSTATUS
+SppArchGetCurrentKernelStackData (
+    PVOID *CallStack,
+    PULONG CallStackSize
+    );
+
+/*++
+
+Routine Description:
+
+    This routine retrieves the kernel call stack of the current thread,
+    starting with the return address in the routine that called this one.
+
+Arguments:
+
+    CallStack - Supplies a pointer that receives an array of return addresses
+        in the call stack.
+
+    CallStackSize - Supplies a pointer to the size of the given call stack
+        array. On return, it contains the size of the produced call stack, in
+        bytes.
+
+Return Value:
+
+    Status code.
+
+--*/
+
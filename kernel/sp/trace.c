@@ -0,0 +1,569 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    trace.c
+
+Abstract:
+
+    This module implements kernel event tracing. Static tracepoints write
+    timestamped records into per-processor ring buffers, which a reader
+    drains through the system information interface.
+
+Author:
+
+    agent 19-Oct-2026
+
+Environment:
+
+    Kernel
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <minoca/kernel/kernel.h>
+#include "spp.h"
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+#define SP_TRACE_ALLOCATION_TAG 0x72547053 // 'rTpS'
+
+//
+// Define the default and maximum number of records in each processor's ring
+// buffer. These must be powers of two.
+//
+
+#define SP_TRACE_DEFAULT_RECORDS 0x1000
+#define SP_TRACE_MAX_RECORDS 0x100000
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+/*++
+
+Structure Description:
+
+    This structure defines a slot in a trace ring buffer.
+
+Members:
+
+    Sequence - Stores one more than the sequence number of the record in the
+        slot, or zero while the slot is being written.
+
+    Record - Stores the trace record.
+
+--*/
+
+typedef struct _SP_TRACE_SLOT {
+    volatile ULONG Sequence;
+    SP_TRACE_RECORD Record;
+} SP_TRACE_SLOT, *PSP_TRACE_SLOT;
+
+/*++
+
+Structure Description:
+
+    This structure defines a processor's trace ring buffer. Only the owning
+    processor writes records, with interrupts disabled, so the writer needs no
+    lock. The reader detects records overwritten underneath it by checking
+    each slot's sequence number.
+
+Members:
+
+    Head - Stores the sequence number of the next record to be written.
+
+    Tail - Stores the sequence number of the next record to be read. This is
+        only touched by the reader.
+
+    Mask - Stores the number of slots in the ring minus one.
+
+    Slots - Stores the array of slots.
+
+--*/
+
+typedef struct _SP_TRACE_RING {
+    volatile ULONG Head;
+    ULONG Tail;
+    ULONG Mask;
+    SP_TRACE_SLOT Slots[ANYSIZE_ARRAY];
+} SP_TRACE_RING, *PSP_TRACE_RING;
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+KSTATUS
+SppAllocateTraceRings (
+    ULONG RecordsPerProcessor
+    );
+
+ULONG
+SppDrainTraceRing (
+    PSP_TRACE_RING Ring,
+    PSP_TRACE_RECORD Records,
+    ULONG RecordCount
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+KERNEL_API volatile ULONG SpTraceEnabledEvents;
+
+//
+// Store the array of per-processor ring buffers, which are allocated the
+// first time tracing is enabled and never freed, as tracepoints may be
+// running on other processors at any time.
+//
+
+PSP_TRACE_RING *SpTraceRings;
+ULONG SpTraceRingCount;
+ULONG SpTraceRecordsPerProcessor;
+
+//
+// Store the number of records lost to overruns. This is protected by the
+// profiling queued lock.
+//
+
+ULONGLONG SpTraceLostRecords;
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+KERNEL_API
+VOID
+SpTraceRecord (
+    SP_TRACE_EVENT Event,
+    ULONGLONG Argument1,
+    ULONGLONG Argument2
+    )
+
+/*++
+
+Routine Description:
+
+    This routine writes a trace event record into the current processor's ring
+    buffer. Callers should use the SpTrace macro, which skips this call when
+    the event is disabled. This routine can be called at any run level.
+
+Arguments:
+
+    Event - Supplies the event that fired.
+
+    Argument1 - Supplies the first event-specific argument.
+
+    Argument2 - Supplies the second event-specific argument.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    BOOL Enabled;
+    PPROCESSOR_BLOCK Processor;
+    PSP_TRACE_RECORD Record;
+    PSP_TRACE_RING Ring;
+    ULONG Sequence;
+    PSP_TRACE_SLOT Slot;
+    PKTHREAD Thread;
+
+    //
+    // Disabling interrupts pins this routine to the processor and keeps
+    // nested tracepoints from interleaving with this record.
+    //
+
+    Enabled = ArDisableInterrupts();
+    Processor = KeGetCurrentProcessorBlock();
+    if ((SpTraceRings == NULL) ||
+        (Processor->ProcessorNumber >= SpTraceRingCount)) {
+
+        goto TraceRecordEnd;
+    }
+
+    Ring = SpTraceRings[Processor->ProcessorNumber];
+    Sequence = Ring->Head;
+    Slot = &(Ring->Slots[Sequence & Ring->Mask]);
+    Slot->Sequence = 0;
+    RtlMemoryBarrier();
+    Record = &(Slot->Record);
+    Record->TimeCounter = HlQueryTimeCounter();
+    Record->Argument1 = Argument1;
+    Record->Argument2 = Argument2;
+    Record->ThreadId = 0;
+    Thread = Processor->RunningThread;
+    if (Thread != NULL) {
+        Record->ThreadId = Thread->ThreadId;
+    }
+
+    Record->Event = Event;
+    Record->Processor = Processor->ProcessorNumber;
+    RtlMemoryBarrier();
+    Slot->Sequence = Sequence + 1;
+    Ring->Head = Sequence + 1;
+
+TraceRecordEnd:
+    if (Enabled != FALSE) {
+        ArEnableInterrupts();
+    }
+
+    return;
+}
+
+KSTATUS
+SppGetSetTraceState (
+    PVOID Data,
+    PUINTN DataSize,
+    BOOL Set
+    )
+
+/*++
+
+Routine Description:
+
+    This routine gets or sets the event tracing state.
+
+Arguments:
+
+    Data - Supplies a pointer to the data buffer where the data is either
+        returned for a get operation or given for a set operation.
+
+    DataSize - Supplies a pointer that on input contains the size of the
+        data buffer. On output, contains the required size of the data buffer.
+
+    Set - Supplies a boolean indicating if this is a get operation (FALSE) or
+        a set operation (TRUE).
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    ULONG EnabledEvents;
+    PSP_TRACE_STATE_INFORMATION Information;
+    ULONG RecordCount;
+    KSTATUS Status;
+
+    Status = PsCheckPermission(PERMISSION_SYSTEM_ADMINISTRATOR);
+    if (!KSUCCESS(Status)) {
+        return Status;
+    }
+
+    if (*DataSize != sizeof(SP_TRACE_STATE_INFORMATION)) {
+        *DataSize = sizeof(SP_TRACE_STATE_INFORMATION);
+        return STATUS_DATA_LENGTH_MISMATCH;
+    }
+
+    Information = Data;
+    KeAcquireQueuedLock(SpProfilingQueuedLock);
+    if (Set != FALSE) {
+        EnabledEvents = Information->EnabledEvents & SP_TRACE_EVENT_MASK_ALL;
+        RecordCount = Information->RecordsPerProcessor;
+        if (SpTraceRings == NULL) {
+            if (EnabledEvents != 0) {
+                Status = SppAllocateTraceRings(RecordCount);
+                if (!KSUCCESS(Status)) {
+                    goto GetSetTraceStateEnd;
+                }
+            }
+
+        } else if ((RecordCount != 0) &&
+                   (RecordCount != SpTraceRecordsPerProcessor)) {
+
+            Status = STATUS_RESOURCE_IN_USE;
+            goto GetSetTraceStateEnd;
+        }
+
+        SpTraceEnabledEvents = EnabledEvents;
+    }
+
+    Information->EnabledEvents = SpTraceEnabledEvents;
+    Information->RecordsPerProcessor = SpTraceRecordsPerProcessor;
+    Information->ProcessorCount = SpTraceRingCount;
+    Information->LostRecords = SpTraceLostRecords;
+    Information->TimeCounterFrequency = HlQueryTimeCounterFrequency();
+    Status = STATUS_SUCCESS;
+
+GetSetTraceStateEnd:
+    KeReleaseQueuedLock(SpProfilingQueuedLock);
+    return Status;
+}
+
+KSTATUS
+SppReadTrace (
+    PVOID Data,
+    PUINTN DataSize,
+    BOOL Set
+    )
+
+/*++
+
+Routine Description:
+
+    This routine drains trace records from every processor's ring buffer.
+
+Arguments:
+
+    Data - Supplies a pointer to the buffer where the records are returned.
+
+    DataSize - Supplies a pointer that on input contains the size of the
+        data buffer. On output, contains the number of bytes of records
+        returned.
+
+    Set - Supplies a boolean indicating if this is a get operation (FALSE) or
+        a set operation (TRUE). Only get operations are supported.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    ULONG Count;
+    ULONG Index;
+    PSP_TRACE_RECORD Records;
+    ULONG RecordCount;
+    KSTATUS Status;
+
+    if (Set != FALSE) {
+        *DataSize = 0;
+        return STATUS_ACCESS_DENIED;
+    }
+
+    Status = PsCheckPermission(PERMISSION_SYSTEM_ADMINISTRATOR);
+    if (!KSUCCESS(Status)) {
+        *DataSize = 0;
+        return Status;
+    }
+
+    if (*DataSize < sizeof(SP_TRACE_RECORD)) {
+        *DataSize = sizeof(SP_TRACE_RECORD);
+        return STATUS_BUFFER_TOO_SMALL;
+    }
+
+    Count = 0;
+    Records = Data;
+    RecordCount = MAX_ULONG;
+    if ((*DataSize / sizeof(SP_TRACE_RECORD)) < MAX_ULONG) {
+        RecordCount = *DataSize / sizeof(SP_TRACE_RECORD);
+    }
+
+    KeAcquireQueuedLock(SpProfilingQueuedLock);
+    for (Index = 0; Index < SpTraceRingCount; Index += 1) {
+        Count += SppDrainTraceRing(SpTraceRings[Index],
+                                   Records + Count,
+                                   RecordCount - Count);
+
+        if (Count == RecordCount) {
+            break;
+        }
+    }
+
+    KeReleaseQueuedLock(SpProfilingQueuedLock);
+    *DataSize = Count * sizeof(SP_TRACE_RECORD);
+    return STATUS_SUCCESS;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+KSTATUS
+SppAllocateTraceRings (
+    ULONG RecordsPerProcessor
+    )
+
+/*++
+
+Routine Description:
+
+    This routine allocates a trace ring buffer for each processor. This
+    routine assumes the profiling queued lock is held.
+
+Arguments:
+
+    RecordsPerProcessor - Supplies the requested number of records in each
+        ring, or zero to use the default. This is rounded up to a power of
+        two.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    ULONG AllocationSize;
+    ULONG Index;
+    ULONG ProcessorCount;
+    ULONG RecordCount;
+    PSP_TRACE_RING Ring;
+    PSP_TRACE_RING *Rings;
+    KSTATUS Status;
+
+    ASSERT(KeGetRunLevel() == RunLevelLow);
+    ASSERT(KeIsQueuedLockHeld(SpProfilingQueuedLock) != FALSE);
+    ASSERT(SpTraceRings == NULL);
+
+    if (RecordsPerProcessor == 0) {
+        RecordsPerProcessor = SP_TRACE_DEFAULT_RECORDS;
+    }
+
+    if (RecordsPerProcessor > SP_TRACE_MAX_RECORDS) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    RecordCount = 1;
+    while (RecordCount < RecordsPerProcessor) {
+        RecordCount <<= 1;
+    }
+
+    ProcessorCount = KeGetActiveProcessorCount();
+    AllocationSize = ProcessorCount * sizeof(PSP_TRACE_RING);
+    Rings = MmAllocateNonPagedPool(AllocationSize, SP_TRACE_ALLOCATION_TAG);
+    if (Rings == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto AllocateTraceRingsEnd;
+    }
+
+    RtlZeroMemory(Rings, AllocationSize);
+    AllocationSize = sizeof(SP_TRACE_RING) +
+                     ((RecordCount - ANYSIZE_ARRAY) * sizeof(SP_TRACE_SLOT));
+
+    for (Index = 0; Index < ProcessorCount; Index += 1) {
+        Ring = MmAllocateNonPagedPool(AllocationSize, SP_TRACE_ALLOCATION_TAG);
+        if (Ring == NULL) {
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+            goto AllocateTraceRingsEnd;
+        }
+
+        RtlZeroMemory(Ring, AllocationSize);
+        Ring->Mask = RecordCount - 1;
+        Rings[Index] = Ring;
+    }
+
+    SpTraceRecordsPerProcessor = RecordCount;
+    SpTraceRingCount = ProcessorCount;
+    RtlMemoryBarrier();
+    SpTraceRings = Rings;
+    Status = STATUS_SUCCESS;
+
+AllocateTraceRingsEnd:
+    if (!KSUCCESS(Status)) {
+        if (Rings != NULL) {
+            for (Index = 0; Index < ProcessorCount; Index += 1) {
+                if (Rings[Index] != NULL) {
+                    MmFreeNonPagedPool(Rings[Index]);
+                }
+            }
+
+            MmFreeNonPagedPool(Rings);
+        }
+    }
+
+    return Status;
+}
+
+ULONG
+SppDrainTraceRing (
+    PSP_TRACE_RING Ring,
+    PSP_TRACE_RECORD Records,
+    ULONG RecordCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine copies records out of a processor's trace ring buffer,
+    skipping any the writer has lapped. This routine assumes the profiling
+    queued lock is held.
+
+Arguments:
+
+    Ring - Supplies a pointer to the ring to drain.
+
+    Records - Supplies a pointer where the records are returned.
+
+    RecordCount - Supplies the maximum number of records to return.
+
+Return Value:
+
+    Returns the number of records copied.
+
+--*/
+
+{
+
+    ULONG Count;
+    ULONG Head;
+    ULONG Sequence;
+    PSP_TRACE_SLOT Slot;
+    ULONG Tail;
+
+    Count = 0;
+    Head = Ring->Head;
+    RtlMemoryBarrier();
+    Tail = Ring->Tail;
+
+    //
+    // If the writer has lapped the reader, skip ahead to the oldest record
+    // still in the ring.
+    //
+
+    if (Head - Tail > Ring->Mask + 1) {
+        SpTraceLostRecords += Head - Tail - (Ring->Mask + 1);
+        Tail = Head - (Ring->Mask + 1);
+    }
+
+    while ((Tail != Head) && (Count < RecordCount)) {
+        Slot = &(Ring->Slots[Tail & Ring->Mask]);
+        Sequence = Slot->Sequence;
+        RtlMemoryBarrier();
+        RtlCopyMemory(&(Records[Count]),
+                      &(Slot->Record),
+                      sizeof(SP_TRACE_RECORD));
+
+        RtlMemoryBarrier();
+
+        //
+        // If the slot changed during the copy, the writer has overwritten it
+        // with a newer record.
+        //
+
+        if ((Sequence != Tail + 1) || (Slot->Sequence != Sequence)) {
+            SpTraceLostRecords += 1;
+
+        } else {
+            Count += 1;
+        }
+
+        Tail += 1;
+    }
+
+    Ring->Tail = Tail;
+    return Count;
+}
+
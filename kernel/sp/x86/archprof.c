@@ -51,6 +51,15 @@ Module Name:
 // ----------------------------------------------- Internal Function Prototypes
 //
 
+ULONG
+SppArchWalkFramePointers (
+    PKTHREAD Thread,
+    PULONG BasePointer,
+    PVOID *CallStack,
+    ULONG CallStackIndex,
+    ULONG CallStackLength
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -92,14 +101,12 @@ Return Value:
 
 {
 
-    PULONG BasePointer;
     ULONG CallStackIndex;
     ULONG CallStackLength;
     PULONG InstructionPointer;
     PULONG ReturnAddress;
     KSTATUS Status;
     PKTHREAD Thread;
-    ULONG TopOfStack;
 
     ASSERT(CallStack != NULL);
     ASSERT((CallStackSize != NULL) && (*CallStackSize != 0));
@@ -162,6 +169,117 @@ Return Value:
         CallStackIndex += 1;
     }
 
+    //
+    // Trace back through the stack starting with the frame that was
+    // interrupted.
+    //
+
+    CallStackIndex = SppArchWalkFramePointers(Thread,
+                                              (PULONG)TrapFrame->Ebp,
+                                              CallStack,
+                                              CallStackIndex,
+                                              CallStackLength);
+
+GetKernelStackDataEnd:
+    *CallStackSize = CallStackIndex * sizeof(ULONG);
+    return Status;
+}
+
+KSTATUS
+SppArchGetCurrentKernelStackData (
+    PVOID *CallStack,
+    PULONG CallStackSize
+    )
+
+/*++
+
+Routine Description:
+
+    This routine retrieves the kernel call stack of the current thread,
+    starting with the return address in the routine that called this one.
+
+Arguments:
+
+    CallStack - Supplies a pointer that receives an array of return addresses
+        in the call stack.
+
+    CallStackSize - Supplies a pointer to the size of the given call stack
+        array. On return, it contains the size of the produced call stack, in
+        bytes.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    ULONG CallStackIndex;
+    PKTHREAD Thread;
+
+    ASSERT(CallStack != NULL);
+    ASSERT((CallStackSize != NULL) && (*CallStackSize != 0));
+
+    Thread = KeGetCurrentThread();
+    if (Thread == NULL) {
+        *CallStackSize = 0;
+        return STATUS_NOT_READY;
+    }
+
+    CallStackIndex = SppArchWalkFramePointers(Thread,
+                                              __builtin_frame_address(0),
+                                              CallStack,
+                                              0,
+                                              *CallStackSize / sizeof(PVOID));
+
+    *CallStackSize = CallStackIndex * sizeof(PVOID);
+    return STATUS_SUCCESS;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+ULONG
+SppArchWalkFramePointers (
+    PKTHREAD Thread,
+    PULONG BasePointer,
+    PVOID *CallStack,
+    ULONG CallStackIndex,
+    ULONG CallStackLength
+    )
+
+/*++
+
+Routine Description:
+
+    This routine follows the chain of saved frame pointers up the given
+    thread's kernel stack, saving the return address from each frame.
+
+Arguments:
+
+    Thread - Supplies a pointer to the thread whose kernel stack is walked.
+
+    BasePointer - Supplies the frame pointer of the innermost frame to walk.
+
+    CallStack - Supplies a pointer to the array of return addresses to fill in.
+
+    CallStackIndex - Supplies the index of the first array element to fill in.
+
+    CallStackLength - Supplies the number of elements in the array.
+
+Return Value:
+
+    Returns the index just beyond the last array element filled in.
+
+--*/
+
+{
+
+    PULONG ReturnAddress;
+    ULONG TopOfStack;
+
     //
     // Trace back through the stack. The two values on the stack before the
     // base pointer are the next base pointer and the return address. Save the
@@ -170,7 +288,6 @@ Return Value:
     // pointer goes beyond the bounds of the kernel stack.
     //
 
-    BasePointer = (PULONG)TrapFrame->Ebp;
     TopOfStack = (UINTN)Thread->KernelStack + Thread->KernelStackSize;
     while (BasePointer != 0) {
 
@@ -215,8 +332,6 @@ Return Value:
         CallStackIndex += 1;
     }
 
-GetKernelStackDataEnd:
-    *CallStackSize = CallStackIndex * sizeof(ULONG);
-    return Status;
+    return CallStackIndex;
 }
 
@@ -13,7 +13,10 @@ Module Name:
 
 Abstract:
 
-    This module implements the AES encryption and decryption routines.
+    This module implements the AES encryption and decryption routines. Blocks
+    are processed with a constant-time bitsliced implementation that works on
+    several independent blocks at once, unless the processor supports the AES
+    instructions, in which case the work is handed to that backend.
 
 Author:
 
@@ -35,16 +38,6 @@ Module Name:
 // --------------------------------------------------------------------- Macros
 //
 
-//
-// This macro performs a simple byte swap on a 32 bit value.
-//
-
-#define AES_BYTE_SWAP32(_Value)               \
-    ((((ULONG)(_Value) & 0xFF000000) >> 24) | \
-     (((ULONG)(_Value) & 0x00FF0000) >> 8) |  \
-     (((ULONG)(_Value) & 0x0000FF00) << 8) |  \
-     (((ULONG)(_Value) & 0x000000FF) << 24))
-
 //
 // Define rotation methods that rotate a 32 bit value by either 1 byte, 2 bytes,
 // or 3 bytes.
@@ -79,10 +72,41 @@ Module Name:
      (_F8) ^= AES_ROTATE2(_F4),                             \
      (_F8) ^ AES_ROTATE1(_F9))
 
+//
+// This macro replicates a 16-bit value into each block lane of a 64-bit
+// bitsliced plane.
+//
+
+#define AES_BITSLICE_REPLICATE(_Value) \
+    ((ULONGLONG)(_Value) * 0x0001000100010001ULL)
+
+//
+// These macros rotate the rows of every lane of a bitsliced plane, so that
+// row N of the result holds row N + 1 (or N + 2) of the original.
+//
+
+#define AES_BITSLICE_ROTATE_ROWS1(_Plane)                       \
+    ((((_Plane) >> 4) & AES_BITSLICE_REPLICATE(0x0FFF)) |       \
+     (((_Plane) << 12) & AES_BITSLICE_REPLICATE(0xF000)))
+
+#define AES_BITSLICE_ROTATE_ROWS2(_Plane)                       \
+    ((((_Plane) >> 8) & AES_BITSLICE_REPLICATE(0x00FF)) |       \
+     (((_Plane) << 8) & AES_BITSLICE_REPLICATE(0xFF00)))
+
 //
 // ---------------------------------------------------------------- Definitions
 //
 
+//
+// Define the number of blocks the bitsliced implementation processes at once.
+// Each block occupies one 16-bit lane of a 64-bit plane, where bit
+// (Row * 4) + Column of the lane holds the byte at that row and column of
+// the AES state.
+//
+
+#define AES_BITSLICE_BLOCKS 4
+#define AES_BITSLICE_BUFFER_SIZE (AES_BITSLICE_BLOCKS * AES_BLOCK_SIZE)
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -92,99 +116,93 @@ Module Name:
 //
 
 VOID
-CypAesEncryptBlock (
+CypAesEncryptBlocks (
     PAES_CONTEXT Context,
-    PULONG Block
+    PUCHAR Blocks,
+    UINTN BlockCount
     );
 
 VOID
-CypAesDecryptBlock (
+CypAesDecryptBlocks (
     PAES_CONTEXT Context,
-    PULONG Block
+    PUCHAR Blocks,
+    UINTN BlockCount
     );
 
-UCHAR
-CypAesXtime (
-    UCHAR Value
+VOID
+CypAesIncrementCounter (
+    PUCHAR Counter,
+    BOOL Increment32
     );
 
-//
-// -------------------------------------------------------------------- Globals
-//
+ULONG
+CypAesSubstituteWord (
+    ULONG Value
+    );
 
-//
-// Define the S-Box and Inverse S-Box values.
-//
+VOID
+CypAesComputeBitslicedKeys (
+    PAES_CONTEXT Context
+    );
 
-static const UCHAR CyAesSbox[256] = {
-    0x63, 0x7C, 0x77, 0x7B, 0xF2, 0x6B, 0x6F, 0xC5,
-    0x30, 0x01, 0x67, 0x2B, 0xFE, 0xD7, 0xAB, 0x76,
-    0xCA, 0x82, 0xC9, 0x7D, 0xFA, 0x59, 0x47, 0xF0,
-    0xAD, 0xD4, 0xA2, 0xAF, 0x9C, 0xA4, 0x72, 0xC0,
-    0xB7, 0xFD, 0x93, 0x26, 0x36, 0x3F, 0xF7, 0xCC,
-    0x34, 0xA5, 0xE5, 0xF1, 0x71, 0xD8, 0x31, 0x15,
-    0x04, 0xC7, 0x23, 0xC3, 0x18, 0x96, 0x05, 0x9A,
-    0x07, 0x12, 0x80, 0xE2, 0xEB, 0x27, 0xB2, 0x75,
-    0x09, 0x83, 0x2C, 0x1A, 0x1B, 0x6E, 0x5A, 0xA0,
-    0x52, 0x3B, 0xD6, 0xB3, 0x29, 0xE3, 0x2F, 0x84,
-    0x53, 0xD1, 0x00, 0xED, 0x20, 0xFC, 0xB1, 0x5B,
-    0x6A, 0xCB, 0xBE, 0x39, 0x4A, 0x4C, 0x58, 0xCF,
-    0xD0, 0xEF, 0xAA, 0xFB, 0x43, 0x4D, 0x33, 0x85,
-    0x45, 0xF9, 0x02, 0x7F, 0x50, 0x3C, 0x9F, 0xA8,
-    0x51, 0xA3, 0x40, 0x8F, 0x92, 0x9D, 0x38, 0xF5,
-    0xBC, 0xB6, 0xDA, 0x21, 0x10, 0xFF, 0xF3, 0xD2,
-    0xCD, 0x0C, 0x13, 0xEC, 0x5F, 0x97, 0x44, 0x17,
-    0xC4, 0xA7, 0x7E, 0x3D, 0x64, 0x5D, 0x19, 0x73,
-    0x60, 0x81, 0x4F, 0xDC, 0x22, 0x2A, 0x90, 0x88,
-    0x46, 0xEE, 0xB8, 0x14, 0xDE, 0x5E, 0x0B, 0xDB,
-    0xE0, 0x32, 0x3A, 0x0A, 0x49, 0x06, 0x24, 0x5C,
-    0xC2, 0xD3, 0xAC, 0x62, 0x91, 0x95, 0xE4, 0x79,
-    0xE7, 0xC8, 0x37, 0x6D, 0x8D, 0xD5, 0x4E, 0xA9,
-    0x6C, 0x56, 0xF4, 0xEA, 0x65, 0x7A, 0xAE, 0x08,
-    0xBA, 0x78, 0x25, 0x2E, 0x1C, 0xA6, 0xB4, 0xC6,
-    0xE8, 0xDD, 0x74, 0x1F, 0x4B, 0xBD, 0x8B, 0x8A,
-    0x70, 0x3E, 0xB5, 0x66, 0x48, 0x03, 0xF6, 0x0E,
-    0x61, 0x35, 0x57, 0xB9, 0x86, 0xC1, 0x1D, 0x9E,
-    0xE1, 0xF8, 0x98, 0x11, 0x69, 0xD9, 0x8E, 0x94,
-    0x9B, 0x1E, 0x87, 0xE9, 0xCE, 0x55, 0x28, 0xDF,
-    0x8C, 0xA1, 0x89, 0x0D, 0xBF, 0xE6, 0x42, 0x68,
-    0x41, 0x99, 0x2D, 0x0F, 0xB0, 0x54, 0xBB, 0x16,
-};
+VOID
+CypAesBitsliceLoad (
+    PULONGLONG State,
+    PUCHAR Blocks,
+    UINTN BlockCount
+    );
 
-static const UCHAR CyAesInvertedSbox[256] = {
-    0x52, 0x09, 0x6A, 0xD5, 0x30, 0x36, 0xA5, 0x38,
-    0xBF, 0x40, 0xA3, 0x9E, 0x81, 0xF3, 0xD7, 0xFB,
-    0x7C, 0xE3, 0x39, 0x82, 0x9B, 0x2F, 0xFF, 0x87,
-    0x34, 0x8E, 0x43, 0x44, 0xC4, 0xDE, 0xE9, 0xCB,
-    0x54, 0x7B, 0x94, 0x32, 0xA6, 0xC2, 0x23, 0x3D,
-    0xEE, 0x4C, 0x95, 0x0B, 0x42, 0xFA, 0xC3, 0x4E,
-    0x08, 0x2E, 0xA1, 0x66, 0x28, 0xD9, 0x24, 0xB2,
-    0x76, 0x5B, 0xA2, 0x49, 0x6D, 0x8B, 0xD1, 0x25,
-    0x72, 0xF8, 0xF6, 0x64, 0x86, 0x68, 0x98, 0x16,
-    0xD4, 0xA4, 0x5C, 0xCC, 0x5D, 0x65, 0xB6, 0x92,
-    0x6C, 0x70, 0x48, 0x50, 0xFD, 0xED, 0xB9, 0xDA,
-    0x5E, 0x15, 0x46, 0x57, 0xA7, 0x8D, 0x9D, 0x84,
-    0x90, 0xD8, 0xAB, 0x00, 0x8C, 0xBC, 0xD3, 0x0A,
-    0xF7, 0xE4, 0x58, 0x05, 0xB8, 0xB3, 0x45, 0x06,
-    0xD0, 0x2C, 0x1E, 0x8F, 0xCA, 0x3F, 0x0F, 0x02,
-    0xC1, 0xAF, 0xBD, 0x03, 0x01, 0x13, 0x8A, 0x6B,
-    0x3A, 0x91, 0x11, 0x41, 0x4F, 0x67, 0xDC, 0xEA,
-    0x97, 0xF2, 0xCF, 0xCE, 0xF0, 0xB4, 0xE6, 0x73,
-    0x96, 0xAC, 0x74, 0x22, 0xE7, 0xAD, 0x35, 0x85,
-    0xE2, 0xF9, 0x37, 0xE8, 0x1C, 0x75, 0xDF, 0x6E,
-    0x47, 0xF1, 0x1A, 0x71, 0x1D, 0x29, 0xC5, 0x89,
-    0x6F, 0xB7, 0x62, 0x0E, 0xAA, 0x18, 0xBE, 0x1B,
-    0xFC, 0x56, 0x3E, 0x4B, 0xC6, 0xD2, 0x79, 0x20,
-    0x9A, 0xDB, 0xC0, 0xFE, 0x78, 0xCD, 0x5A, 0xF4,
-    0x1F, 0xDD, 0xA8, 0x33, 0x88, 0x07, 0xC7, 0x31,
-    0xB1, 0x12, 0x10, 0x59, 0x27, 0x80, 0xEC, 0x5F,
-    0x60, 0x51, 0x7F, 0xA9, 0x19, 0xB5, 0x4A, 0x0D,
-    0x2D, 0xE5, 0x7A, 0x9F, 0x93, 0xC9, 0x9C, 0xEF,
-    0xA0, 0xE0, 0x3B, 0x4D, 0xAE, 0x2A, 0xF5, 0xB0,
-    0xC8, 0xEB, 0xBB, 0x3C, 0x83, 0x53, 0x99, 0x61,
-    0x17, 0x2B, 0x04, 0x7E, 0xBA, 0x77, 0xD6, 0x26,
-    0xE1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0C, 0x7D
-};
+VOID
+CypAesBitsliceStore (
+    PULONGLONG State,
+    PUCHAR Blocks,
+    UINTN BlockCount
+    );
+
+VOID
+CypAesBitsliceAddRoundKey (
+    PULONGLONG State,
+    PUSHORT RoundKey
+    );
+
+VOID
+CypAesBitsliceSubBytes (
+    PULONGLONG State
+    );
+
+VOID
+CypAesBitsliceInverseSubBytes (
+    PULONGLONG State
+    );
+
+VOID
+CypAesBitsliceShiftRows (
+    PULONGLONG State
+    );
+
+VOID
+CypAesBitsliceInverseShiftRows (
+    PULONGLONG State
+    );
+
+VOID
+CypAesBitsliceMixColumns (
+    PULONGLONG State
+    );
+
+VOID
+CypAesBitsliceInverseMixColumns (
+    PULONGLONG State
+    );
+
+VOID
+CypAesBitsliceDouble (
+    PULONGLONG Value
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
 
 static const UCHAR CyAesRcon[30]= {
     0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
@@ -239,12 +257,12 @@ Return Value:
     ULONG KeyValue;
     PULONG LongPointer;
     INT Words;
-    ULONG WorkingKey;
 
     switch (Mode) {
     case AesModeCbc128:
     case AesModeEcb128:
     case AesModeCtr128:
+    case AesModeGcm128:
         Context->Rounds = 10;
         Context->KeySize = AES_CBC128_KEY_SIZE;
         break;
@@ -252,6 +270,7 @@ Return Value:
     case AesModeCbc256:
     case AesModeEcb256:
     case AesModeCtr256:
+    case AesModeGcm256:
         Context->Rounds = 14;
         Context->KeySize = AES_CBC256_KEY_SIZE;
         break;
@@ -276,7 +295,9 @@ Return Value:
     }
 
     //
-    // Create the round keys.
+    // Create the round keys. The S-box substitutions go through the bitsliced
+    // S-box so that the key schedule does not leak key bits through table
+    // lookup timing.
     //
 
     CurrentRcon = (PUCHAR)CyAesRcon;
@@ -284,33 +305,29 @@ Return Value:
     for (Index = Words; Index < ExpandedKeyRange; Index += 1) {
         KeyValue = LongPointer[Index - 1];
         if ((Index % Words) == 0) {
-            WorkingKey = ((ULONG)CyAesSbox[KeyValue & 0xFF] << 8) |
-                         ((ULONG)CyAesSbox[(KeyValue >> 8) & 0xFF] << 16) |
-                         ((ULONG)CyAesSbox[(KeyValue >> 16) & 0xFF] << 24) |
-                         ((ULONG)CyAesSbox[(KeyValue >> 24) & 0xFF]);
+            KeyValue = CypAesSubstituteWord(AES_ROTATE3(KeyValue)) ^
+                       (((ULONG)*CurrentRcon) << 24);
 
-            KeyValue = WorkingKey ^ (((ULONG)*CurrentRcon) << 24);
             CurrentRcon += 1;
         }
 
         if ((Words == 8) && ((Index % Words) == 4)) {
-            WorkingKey = ((ULONG)CyAesSbox[KeyValue & 0xFF]) |
-                         ((ULONG)CyAesSbox[(KeyValue >> 8) & 0xFF] << 8) |
-                         ((ULONG)CyAesSbox[(KeyValue >> 16) & 0xFF] << 16) |
-                         ((ULONG)CyAesSbox[(KeyValue >> 24) & 0xFF]) << 24;
-
-            KeyValue = WorkingKey;
+            KeyValue = CypAesSubstituteWord(KeyValue);
         }
 
         LongPointer[Index] = LongPointer[Index - Words] ^ KeyValue;
     }
 
+    CypAesComputeBitslicedKeys(Context);
+
     //
     // Just copy the initialization vector straight over, ignoring it for ECB
-    // modes.
+    // and GCM modes.
     //
 
-    if ((Mode != AesModeEcb128) && (Mode != AesModeEcb256)) {
+    if ((Mode != AesModeEcb128) && (Mode != AesModeEcb256) &&
+        (Mode != AesModeGcm128) && (Mode != AesModeGcm256)) {
+
         if (InitializationVector != NULL) {
             RtlCopyMemory(Context->InitializationVector,
                           InitializationVector,
@@ -372,6 +389,7 @@ Return Value:
         KeyLong += 1;
     }
 
+    CypAesComputeBitslicedKeys(Context);
     return;
 }
 
@@ -410,75 +428,51 @@ Return Value:
 
 {
 
-    ULONG BlockIn[AES_BLOCK_SIZE / sizeof(ULONG)];
-    ULONG BlockOut[AES_BLOCK_SIZE / sizeof(ULONG)];
-    ULONG InitializationVector[AES_INITIALIZATION_VECTOR_SIZE / sizeof(ULONG)];
-    PULONG InLong;
-    PULONG OutLong;
+    UCHAR Block[AES_BLOCK_SIZE];
+    UINTN ByteIndex;
     INT TextIndex;
-    INT WordIndex;
 
     ASSERT((Length % AES_BLOCK_SIZE) == 0);
 
-    RtlCopyMemory(InitializationVector,
-                  Context->InitializationVector,
-                  AES_INITIALIZATION_VECTOR_SIZE);
-
-    //
-    // Copy the initialization vector into the initial output block.
-    //
-
-    for (WordIndex = 0;
-         WordIndex < (AES_BLOCK_SIZE / sizeof(ULONG));
-         WordIndex += 1) {
+#ifdef CY_AES_NI
 
-        BlockOut[WordIndex] = AES_BYTE_SWAP32(InitializationVector[WordIndex]);
+    if (CypAesNiIsSupported() != FALSE) {
+        CypAesNiCbcEncrypt(Context, Plaintext, Ciphertext, Length);
+        return;
     }
 
+#endif
+
     //
-    // Loop over and encrypt each block.
+    // Each block depends on the previous ciphertext, so encryption proceeds
+    // one block at a time.
     //
 
+    RtlCopyMemory(Block,
+                  Context->InitializationVector,
+                  AES_INITIALIZATION_VECTOR_SIZE);
+
     for (TextIndex = Length - AES_BLOCK_SIZE;
          TextIndex >= 0;
          TextIndex -= AES_BLOCK_SIZE) {
 
-        InLong = (PULONG)Plaintext;
-        OutLong = (PULONG)Ciphertext;
-        for (WordIndex = 0;
-             WordIndex < (AES_BLOCK_SIZE / sizeof(ULONG));
-             WordIndex += 1) {
-
-            BlockIn[WordIndex] = AES_BYTE_SWAP32(InLong[WordIndex]) ^
-                                 BlockOut[WordIndex];
-        }
-
-        CypAesEncryptBlock(Context, BlockIn);
-        for (WordIndex = 0;
-             WordIndex < (AES_BLOCK_SIZE / sizeof(ULONG));
-             WordIndex += 1) {
-
-            BlockOut[WordIndex] = BlockIn[WordIndex];
-            OutLong[WordIndex] = AES_BYTE_SWAP32(BlockIn[WordIndex]);
+        for (ByteIndex = 0; ByteIndex < AES_BLOCK_SIZE; ByteIndex += 1) {
+            Block[ByteIndex] ^= Plaintext[ByteIndex];
         }
 
+        CypAesEncryptBlocks(Context, Block, 1);
+        RtlCopyMemory(Ciphertext, Block, AES_BLOCK_SIZE);
         Plaintext += AES_BLOCK_SIZE;
         Ciphertext += AES_BLOCK_SIZE;
     }
 
     //
-    // Copy the initialization vector back in to the context.
+    // Copy the last ciphertext block back in to the context as the next
+    // initialization vector.
     //
 
-    for (WordIndex = 0;
-         WordIndex < (AES_BLOCK_SIZE / sizeof(ULONG));
-         WordIndex += 1) {
-
-        InitializationVector[WordIndex] = AES_BYTE_SWAP32(BlockOut[WordIndex]);
-    }
-
     RtlCopyMemory(Context->InitializationVector,
-                  InitializationVector,
+                  Block,
                   AES_INITIALIZATION_VECTOR_SIZE);
 
     return;
@@ -519,78 +513,60 @@ Return Value:
 
 {
 
-    ULONG BlockIn[AES_BLOCK_SIZE / sizeof(ULONG)];
-    ULONG BlockOut[AES_BLOCK_SIZE / sizeof(ULONG)];
-    ULONG InitializationVector[AES_INITIALIZATION_VECTOR_SIZE / sizeof(ULONG)];
-    PULONG InLong;
-    PULONG OutLong;
-    INT TextIndex;
-    INT WordIndex;
-    ULONG WorkingBlock[AES_BLOCK_SIZE / sizeof(ULONG)];
-    ULONG XorValue[AES_BLOCK_SIZE / sizeof(ULONG)];
+    UCHAR Blocks[AES_BITSLICE_BUFFER_SIZE];
+    UINTN BlockCount;
+    UINTN ByteIndex;
+    UCHAR Chain[AES_BITSLICE_BUFFER_SIZE + AES_BLOCK_SIZE];
+    UINTN Size;
 
     ASSERT((Length % AES_BLOCK_SIZE) == 0);
 
-    RtlCopyMemory(InitializationVector,
-                  Context->InitializationVector,
-                  AES_INITIALIZATION_VECTOR_SIZE);
-
-    //
-    // Copy the initialization vector into the initial XOR values.
-    //
-
-    for (WordIndex = 0;
-         WordIndex < (AES_BLOCK_SIZE / sizeof(ULONG));
-         WordIndex += 1) {
+#ifdef CY_AES_NI
 
-        XorValue[WordIndex] = AES_BYTE_SWAP32(InitializationVector[WordIndex]);
+    if (CypAesNiIsSupported() != FALSE) {
+        CypAesNiCbcDecrypt(Context, Ciphertext, Plaintext, Length);
+        return;
     }
 
+#endif
+
     //
-    // Decrypt each block.
+    // Unlike encryption, every block can be decrypted independently, so
+    // decrypt several at once. The chain buffer holds the previous ciphertext
+    // block followed by the current batch of ciphertext, which must be saved
+    // since the caller may be decrypting in place.
     //
 
-    for (TextIndex = Length - AES_BLOCK_SIZE;
-         TextIndex >= 0;
-         TextIndex -= AES_BLOCK_SIZE) {
-
-        InLong = (PULONG)Ciphertext;
-        OutLong = (PULONG)Plaintext;
-        for (WordIndex = 0;
-             WordIndex < (AES_BLOCK_SIZE / sizeof(ULONG));
-             WordIndex += 1) {
+    RtlCopyMemory(Chain,
+                  Context->InitializationVector,
+                  AES_INITIALIZATION_VECTOR_SIZE);
 
-            BlockIn[WordIndex] = AES_BYTE_SWAP32(InLong[WordIndex]);
-            WorkingBlock[WordIndex] = BlockIn[WordIndex];
+    while (Length != 0) {
+        BlockCount = Length / AES_BLOCK_SIZE;
+        if (BlockCount > AES_BITSLICE_BLOCKS) {
+            BlockCount = AES_BITSLICE_BLOCKS;
         }
 
-        CypAesDecryptBlock(Context, WorkingBlock);
-        for (WordIndex = 0;
-             WordIndex < (AES_BLOCK_SIZE / sizeof(ULONG));
-             WordIndex += 1) {
-
-            BlockOut[WordIndex] = WorkingBlock[WordIndex] ^ XorValue[WordIndex];
-            XorValue[WordIndex] = BlockIn[WordIndex];
-            OutLong[WordIndex] = AES_BYTE_SWAP32(BlockOut[WordIndex]);
+        Size = BlockCount * AES_BLOCK_SIZE;
+        RtlCopyMemory(Chain + AES_BLOCK_SIZE, Ciphertext, Size);
+        RtlCopyMemory(Blocks, Ciphertext, Size);
+        CypAesDecryptBlocks(Context, Blocks, BlockCount);
+        for (ByteIndex = 0; ByteIndex < Size; ByteIndex += 1) {
+            Plaintext[ByteIndex] = Blocks[ByteIndex] ^ Chain[ByteIndex];
         }
 
-        Ciphertext += AES_BLOCK_SIZE;
-        Plaintext += AES_BLOCK_SIZE;
+        RtlCopyMemory(Chain, Chain + Size, AES_BLOCK_SIZE);
+        Ciphertext += Size;
+        Plaintext += Size;
+        Length -= Size;
     }
 
     //
-    // Copy the initialization vector back in to the context.
+    // Copy the last ciphertext block back in to the context.
     //
 
-    for (WordIndex = 0;
-         WordIndex < (AES_BLOCK_SIZE / sizeof(ULONG));
-         WordIndex += 1) {
-
-        InitializationVector[WordIndex] = AES_BYTE_SWAP32(XorValue[WordIndex]);
-    }
-
     RtlCopyMemory(Context->InitializationVector,
-                  InitializationVector,
+                  Chain,
                   AES_INITIALIZATION_VECTOR_SIZE);
 
     return;
@@ -631,41 +607,34 @@ Return Value:
 
 {
 
-    ULONG BlockIn[AES_BLOCK_SIZE / sizeof(ULONG)];
-    PULONG InLong;
-    PULONG OutLong;
-    INT TextIndex;
-    INT WordIndex;
+    UCHAR Blocks[AES_BITSLICE_BUFFER_SIZE];
+    UINTN BlockCount;
+    UINTN Size;
 
     ASSERT((Length % AES_BLOCK_SIZE) == 0);
 
-    //
-    // Loop over and encrypt each block.
-    //
-
-    for (TextIndex = Length - AES_BLOCK_SIZE;
-         TextIndex >= 0;
-         TextIndex -= AES_BLOCK_SIZE) {
+#ifdef CY_AES_NI
 
-        InLong = (PULONG)Plaintext;
-        OutLong = (PULONG)Ciphertext;
-        for (WordIndex = 0;
-             WordIndex < (AES_BLOCK_SIZE / sizeof(ULONG));
-             WordIndex += 1) {
-
-            BlockIn[WordIndex] = AES_BYTE_SWAP32(InLong[WordIndex]);
-        }
+    if (CypAesNiIsSupported() != FALSE) {
+        CypAesNiEcbEncrypt(Context, Plaintext, Ciphertext, Length);
+        return;
+    }
 
-        CypAesEncryptBlock(Context, BlockIn);
-        for (WordIndex = 0;
-             WordIndex < (AES_BLOCK_SIZE / sizeof(ULONG));
-             WordIndex += 1) {
+#endif
 
-            OutLong[WordIndex] = AES_BYTE_SWAP32(BlockIn[WordIndex]);
+    while (Length != 0) {
+        BlockCount = Length / AES_BLOCK_SIZE;
+        if (BlockCount > AES_BITSLICE_BLOCKS) {
+            BlockCount = AES_BITSLICE_BLOCKS;
         }
 
-        Plaintext += AES_BLOCK_SIZE;
-        Ciphertext += AES_BLOCK_SIZE;
+        Size = BlockCount * AES_BLOCK_SIZE;
+        RtlCopyMemory(Blocks, Plaintext, Size);
+        CypAesEncryptBlocks(Context, Blocks, BlockCount);
+        RtlCopyMemory(Ciphertext, Blocks, Size);
+        Plaintext += Size;
+        Ciphertext += Size;
+        Length -= Size;
     }
 
     return;
@@ -706,41 +675,34 @@ Return Value:
 
 {
 
-    ULONG BlockIn[AES_BLOCK_SIZE / sizeof(ULONG)];
-    PULONG InLong;
-    PULONG OutLong;
-    INT TextIndex;
-    INT WordIndex;
+    UCHAR Blocks[AES_BITSLICE_BUFFER_SIZE];
+    UINTN BlockCount;
+    UINTN Size;
 
     ASSERT((Length % AES_BLOCK_SIZE) == 0);
 
-    //
-    // Decrypt each block.
-    //
-
-    for (TextIndex = Length - AES_BLOCK_SIZE;
-         TextIndex >= 0;
-         TextIndex -= AES_BLOCK_SIZE) {
-
-        InLong = (PULONG)Ciphertext;
-        OutLong = (PULONG)Plaintext;
-        for (WordIndex = 0;
-             WordIndex < (AES_BLOCK_SIZE / sizeof(ULONG));
-             WordIndex += 1) {
+#ifdef CY_AES_NI
 
-            BlockIn[WordIndex] = AES_BYTE_SWAP32(InLong[WordIndex]);
-        }
+    if (CypAesNiIsSupported() != FALSE) {
+        CypAesNiEcbDecrypt(Context, Ciphertext, Plaintext, Length);
+        return;
+    }
 
-        CypAesDecryptBlock(Context, BlockIn);
-        for (WordIndex = 0;
-             WordIndex < (AES_BLOCK_SIZE / sizeof(ULONG));
-             WordIndex += 1) {
+#endif
 
-            OutLong[WordIndex] = AES_BYTE_SWAP32(BlockIn[WordIndex]);
+    while (Length != 0) {
+        BlockCount = Length / AES_BLOCK_SIZE;
+        if (BlockCount > AES_BITSLICE_BLOCKS) {
+            BlockCount = AES_BITSLICE_BLOCKS;
         }
 
-        Ciphertext += AES_BLOCK_SIZE;
-        Plaintext += AES_BLOCK_SIZE;
+        Size = BlockCount * AES_BLOCK_SIZE;
+        RtlCopyMemory(Blocks, Ciphertext, Size);
+        CypAesDecryptBlocks(Context, Blocks, BlockCount);
+        RtlCopyMemory(Plaintext, Blocks, Size);
+        Ciphertext += Size;
+        Plaintext += Size;
+        Length -= Size;
     }
 
     return;
@@ -781,78 +743,14 @@ Return Value:
 
 {
 
-    ULONG BlockIn[AES_BLOCK_SIZE / sizeof(ULONG)];
-    INT ByteIndex;
-    ULONG Counter[AES_INITIALIZATION_VECTOR_SIZE / sizeof(ULONG)];
-    PUCHAR CounterBytes;
-    PULONG InLong;
-    PULONG OutLong;
-    INT TextIndex;
-    INT WordIndex;
-
     ASSERT((Length % AES_BLOCK_SIZE) == 0);
 
-    RtlCopyMemory(Counter,
-                  Context->InitializationVector,
-                  AES_INITIALIZATION_VECTOR_SIZE);
-
-    //
-    // Encrypt the incrementing counter each iteration and XOR it with the next
-    // block of input.
-    //
-
-    for (TextIndex = Length - AES_BLOCK_SIZE;
-         TextIndex >= 0;
-         TextIndex -= AES_BLOCK_SIZE) {
-
-        //
-        // Copy the counter into the input block.
-        //
-
-        for (WordIndex = 0;
-             WordIndex < (AES_BLOCK_SIZE / sizeof(ULONG));
-             WordIndex += 1) {
-
-            BlockIn[WordIndex] = AES_BYTE_SWAP32(Counter[WordIndex]);
-        }
-
-        InLong = (PULONG)Plaintext;
-        OutLong = (PULONG)Ciphertext;
-        CypAesEncryptBlock(Context, BlockIn);
-        for (WordIndex = 0;
-             WordIndex < (AES_BLOCK_SIZE / sizeof(ULONG));
-             WordIndex += 1) {
-
-            OutLong[WordIndex] = AES_BYTE_SWAP32(BlockIn[WordIndex]) ^
-                                 InLong[WordIndex];
-        }
-
-        Plaintext += AES_BLOCK_SIZE;
-        Ciphertext += AES_BLOCK_SIZE;
-
-        //
-        // Increment the counter. Remember that this is big-endian.
-        //
-
-        CounterBytes = (PUCHAR)Counter;
-        for (ByteIndex = AES_BLOCK_SIZE - 1;
-             ByteIndex >= 0;
-             ByteIndex -= 1) {
-
-            CounterBytes[ByteIndex] += 1;
-            if (CounterBytes[ByteIndex] != 0) {
-                break;
-            }
-        }
-    }
-
-    //
-    // Copy the counter back in to the context.
-    //
-
-    RtlCopyMemory(Context->InitializationVector,
-                  Counter,
-                  AES_INITIALIZATION_VECTOR_SIZE);
+    CypAesCtrCrypt(Context,
+                   Context->InitializationVector,
+                   Plaintext,
+                   Ciphertext,
+                   Length,
+                   FALSE);
 
     return;
 }
@@ -903,254 +801,934 @@ Return Value:
     return;
 }
 
-//
-// --------------------------------------------------------- Internal Functions
-//
-
 VOID
-CypAesEncryptBlock (
+CypAesCtrCrypt (
     PAES_CONTEXT Context,
-    PULONG Block
+    PUCHAR Counter,
+    PUCHAR Input,
+    PUCHAR Output,
+    UINTN Length,
+    BOOL Increment32
     )
 
 /*++
 
 Routine Description:
 
-    This routine encrypts a single block of data using the AES cipher.
+    This routine runs AES in counter mode over a buffer. Since every counter
+    block is independent, several blocks are encrypted at once.
 
 Arguments:
 
     Context - Supplies a pointer to the AES context.
 
-    Block - Supplies a pointer to the block to encrypt.
+    Counter - Supplies a pointer to the big-endian counter block. On output,
+        this will contain the counter value following the last block used.
+
+    Input - Supplies a pointer to the input buffer.
+
+    Output - Supplies a pointer where the output will be returned. This may be
+        the same as the input buffer.
+
+    Length - Supplies the length of the input and output buffers, in bytes.
+        This must be a multiple of 16 bytes.
+
+    Increment32 - Supplies a boolean indicating whether only the low 32 bits
+        of the counter should be incremented (as GCM requires) or whether the
+        whole block is one 128-bit counter.
 
 Return Value:
 
-    None. The encrypted data will be returned inline.
+    None.
 
 --*/
 
 {
 
-    PULONG Key;
-    UCHAR OriginalVector0;
-    INT Round;
-    INT Row;
-    UCHAR SboxIndex;
-    UCHAR Vector[4];
-    ULONG WorkingBlock[4];
-    ULONG XorAll;
+    UINTN Block;
+    UINTN BlockCount;
+    UCHAR Blocks[AES_BITSLICE_BUFFER_SIZE];
+    UINTN ByteIndex;
+    UINTN Size;
 
-    Key = (PULONG)(Context->Keys);
+    ASSERT((Length % AES_BLOCK_SIZE) == 0);
 
-    //
-    // Perform pre-round key addition.
-    //
+#ifdef CY_AES_NI
 
-    for (Row = 0; Row < 4; Row += 1) {
-        Block[Row] ^= *Key;
-        Key += 1;
+    if (CypAesNiIsSupported() != FALSE) {
+        CypAesNiCtrCrypt(Context, Counter, Input, Output, Length, Increment32);
+        return;
     }
 
-    //
-    // Loop through and encrypt the block.
-    //
-
-    for (Round = 0; Round < Context->Rounds; Round += 1) {
-        for (Row = 0; Row < 4; Row += 1) {
-
-            //
-            // Perform the byte substitution and row shift operations together.
-            //
-
-            SboxIndex = (UCHAR)(Block[Row % 4] >> 24);
-            Vector[0] = CyAesSbox[SboxIndex];
-            SboxIndex = (UCHAR)(Block[(Row + 1) % 4] >> 16);
-            Vector[1] = CyAesSbox[SboxIndex];
-            SboxIndex = (UCHAR)(Block[(Row + 2) % 4] >> 8);
-            Vector[2] = CyAesSbox[SboxIndex];
-            SboxIndex = (UCHAR)(Block[(Row + 3) % 4]);
-            Vector[3] = CyAesSbox[SboxIndex];
-
-            //
-            // If this is not the last round, perform the mix columns operation.
-            //
-
-            if (Round != Context->Rounds - 1) {
-                XorAll = Vector[0] ^ Vector[1] ^ Vector[2] ^ Vector[3];
-                OriginalVector0 = Vector[0];
-                Vector[0] ^= XorAll ^ CypAesXtime(Vector[0] ^ Vector[1]);
-                Vector[1] ^= XorAll ^ CypAesXtime(Vector[1] ^ Vector[2]);
-                Vector[2] ^= XorAll ^ CypAesXtime(Vector[2] ^ Vector[3]);
-                Vector[3] ^= XorAll ^ CypAesXtime(Vector[3] ^ OriginalVector0);
-            }
+#endif
 
-            WorkingBlock[Row] = ((ULONG)Vector[0] << 24) |
-                                ((ULONG)Vector[1] << 16) |
-                                ((ULONG)Vector[2] << 8) |
-                                Vector[3];
+    while (Length != 0) {
+        BlockCount = Length / AES_BLOCK_SIZE;
+        if (BlockCount > AES_BITSLICE_BLOCKS) {
+            BlockCount = AES_BITSLICE_BLOCKS;
         }
 
-        //
-        // Perform key addition now that the mix column operation is complete.
-        //
+        for (Block = 0; Block < BlockCount; Block += 1) {
+            RtlCopyMemory(Blocks + (Block * AES_BLOCK_SIZE),
+                          Counter,
+                          AES_BLOCK_SIZE);
 
-        for (Row = 0; Row < 4; Row += 1) {
-            Block[Row] = WorkingBlock[Row] ^ *Key;
-            Key += 1;
+            CypAesIncrementCounter(Counter, Increment32);
         }
+
+        CypAesEncryptBlocks(Context, Blocks, BlockCount);
+        Size = BlockCount * AES_BLOCK_SIZE;
+        for (ByteIndex = 0; ByteIndex < Size; ByteIndex += 1) {
+            Output[ByteIndex] = Input[ByteIndex] ^ Blocks[ByteIndex];
+        }
+
+        Input += Size;
+        Output += Size;
+        Length -= Size;
     }
 
     return;
 }
 
+//
+// --------------------------------------------------------- Internal Functions
+//
+
 VOID
-CypAesDecryptBlock (
+CypAesEncryptBlocks (
     PAES_CONTEXT Context,
-    PULONG Block
+    PUCHAR Blocks,
+    UINTN BlockCount
     )
 
 /*++
 
 Routine Description:
 
-    This routine decrypts a single block of data using the AES cipher.
+    This routine encrypts up to four independent blocks of data using the
+    bitsliced AES cipher.
 
 Arguments:
 
     Context - Supplies a pointer to the AES context.
 
-    Block - Supplies a pointer to the block to decrypt.
+    Blocks - Supplies a pointer to the blocks to encrypt.
+
+    BlockCount - Supplies the number of blocks to encrypt.
 
 Return Value:
 
-    None. The decrypted data will be returned inline.
+    None. The encrypted data will be returned inline.
 
 --*/
 
 {
 
-    PULONG Key;
     INT Round;
-    INT Row;
-    UCHAR SboxIndex;
-    UCHAR Vector[4];
-    ULONG WorkingBlock[4];
-    UCHAR XorValue0;
-    UCHAR XorValue1;
-    UCHAR XorValue2;
-    UCHAR XorValue3;
-    UCHAR XorValue4;
-    UCHAR XorValue5;
-    UCHAR XorValue6;
-
-    Key = Context->Keys + ((Context->Rounds + 1) * 4);
+    ULONGLONG State[BITS_PER_BYTE];
 
-    //
-    // Perform pre-round key addition.
-    //
+    ASSERT(BlockCount <= AES_BITSLICE_BLOCKS);
 
-    for (Row = 4; Row > 0; Row -= 1) {
-        Key -= 1;
-        Block[Row - 1] ^= *Key;
+    CypAesBitsliceLoad(State, Blocks, BlockCount);
+    CypAesBitsliceAddRoundKey(State, Context->BitslicedKeys[0]);
+    for (Round = 1; Round < Context->Rounds; Round += 1) {
+        CypAesBitsliceSubBytes(State);
+        CypAesBitsliceShiftRows(State);
+        CypAesBitsliceMixColumns(State);
+        CypAesBitsliceAddRoundKey(State, Context->BitslicedKeys[Round]);
     }
 
+    CypAesBitsliceSubBytes(State);
+    CypAesBitsliceShiftRows(State);
+    CypAesBitsliceAddRoundKey(State, Context->BitslicedKeys[Round]);
+    CypAesBitsliceStore(State, Blocks, BlockCount);
+    return;
+}
+
+VOID
+CypAesDecryptBlocks (
+    PAES_CONTEXT Context,
+    PUCHAR Blocks,
+    UINTN BlockCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine decrypts up to four independent blocks of data using the
+    bitsliced AES cipher. The context's keys must have already been converted
+    for decryption.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context.
+
+    Blocks - Supplies a pointer to the blocks to decrypt.
+
+    BlockCount - Supplies the number of blocks to decrypt.
+
+Return Value:
+
+    None. The decrypted data will be returned inline.
+
+--*/
+
+{
+
+    INT Round;
+    ULONGLONG State[BITS_PER_BYTE];
+
+    ASSERT(BlockCount <= AES_BITSLICE_BLOCKS);
+
     //
-    // Loop through and decrypt the block.
+    // This is the equivalent inverse cipher, which uses the same operation
+    // ordering as encryption by way of the transformed round keys.
     //
 
-    for (Round = 0; Round < Context->Rounds; Round += 1) {
-        for (Row = 4; Row > 0; Row -= 1) {
-
-            //
-            // Perform the byte substitution and row shift operations together.
-            //
-
-            SboxIndex = (UCHAR)(Block[(Row + 3) % 4] >> 24);
-            Vector[0] = CyAesInvertedSbox[SboxIndex];
-            SboxIndex = (UCHAR)(Block[(Row + 2) % 4] >> 16);
-            Vector[1] = CyAesInvertedSbox[SboxIndex];
-            SboxIndex = (UCHAR)(Block[(Row + 1) % 4] >> 8);
-            Vector[2] = CyAesInvertedSbox[SboxIndex];
-            SboxIndex = (UCHAR)(Block[Row % 4]);
-            Vector[3] = CyAesInvertedSbox[SboxIndex];
-
-            //
-            // Perform the Mix Column operation if this is not the last round.
-            //
-
-            if (Round < (Context->Rounds - 1)) {
-                XorValue0 = CypAesXtime(Vector[0] ^ Vector[1]);
-                XorValue1 = CypAesXtime(Vector[1] ^ Vector[2]);
-                XorValue2 = CypAesXtime(Vector[2] ^ Vector[3]);
-                XorValue3 = CypAesXtime(Vector[3] ^ Vector[0]);
-                XorValue4 = CypAesXtime(XorValue0 ^ XorValue1);
-                XorValue5 = CypAesXtime(XorValue1 ^ XorValue2);
-                XorValue6 = CypAesXtime(XorValue4 ^ XorValue5);
-                XorValue0 ^= Vector[1] ^ Vector[2] ^ Vector[3] ^ XorValue4 ^
-                             XorValue6;
-
-                XorValue1 ^= Vector[0] ^ Vector[2] ^ Vector[3] ^ XorValue5 ^
-                             XorValue6;
-
-                XorValue2 ^= Vector[0] ^ Vector[1] ^ Vector[3] ^ XorValue4 ^
-                             XorValue6;
-
-                XorValue3 ^= Vector[0] ^ Vector[1] ^ Vector[2] ^ XorValue5 ^
-                             XorValue6;
-
-                WorkingBlock[Row - 1] = ((ULONG)XorValue0 << 24) |
-                                        ((ULONG)XorValue1 << 16) |
-                                        ((ULONG)XorValue2 << 8) |
-                                        XorValue3;
-
-            } else {
-                WorkingBlock[Row - 1] = ((ULONG)Vector[0] << 24) |
-                                        ((ULONG)Vector[1] << 16) |
-                                        ((ULONG)Vector[2] << 8) |
-                                        Vector[3];
-            }
-        }
+    CypAesBitsliceLoad(State, Blocks, BlockCount);
+    CypAesBitsliceAddRoundKey(State,
+                              Context->BitslicedKeys[Context->Rounds]);
 
-        for (Row = 4; Row > 0; Row -= 1) {
-            Key -= 1;
-            Block[Row - 1] = WorkingBlock[Row - 1] ^ *Key;
-        }
+    for (Round = Context->Rounds - 1; Round > 0; Round -= 1) {
+        CypAesBitsliceInverseSubBytes(State);
+        CypAesBitsliceInverseShiftRows(State);
+        CypAesBitsliceInverseMixColumns(State);
+        CypAesBitsliceAddRoundKey(State, Context->BitslicedKeys[Round]);
     }
 
+    CypAesBitsliceInverseSubBytes(State);
+    CypAesBitsliceInverseShiftRows(State);
+    CypAesBitsliceAddRoundKey(State, Context->BitslicedKeys[0]);
+    CypAesBitsliceStore(State, Blocks, BlockCount);
     return;
 }
 
-UCHAR
-CypAesXtime (
-    UCHAR Value
+VOID
+CypAesIncrementCounter (
+    PUCHAR Counter,
+    BOOL Increment32
     )
 
 /*++
 
 Routine Description:
 
-    This routine performs doubling of an 8 bit value in a Galois Field GF(2^8)
-    using the irreducible polynomial x^8 + x^4 + x^3 + x + 1. This basically
-    means multiply by 2 and exclusive OR with 0x1B if it rolls over.
+    This routine increments a big-endian counter block.
 
 Arguments:
 
-    Value - Supplies the value to multiply by 2 in the finite field.
+    Counter - Supplies a pointer to the counter block to increment.
+
+    Increment32 - Supplies a boolean indicating whether only the last 32 bits
+        of the block should be incremented, wrapping within those 32 bits.
 
 Return Value:
 
-    Returns the value multiplied by 2 in the finite field.
+    None.
 
 --*/
 
 {
 
-    if ((Value & 0x80) != 0) {
-        return (Value << 1) ^ 0x1B;
+    INT ByteIndex;
+    INT Last;
+
+    Last = 0;
+    if (Increment32 != FALSE) {
+        Last = AES_BLOCK_SIZE - sizeof(ULONG);
+    }
+
+    for (ByteIndex = AES_BLOCK_SIZE - 1; ByteIndex >= Last; ByteIndex -= 1) {
+        Counter[ByteIndex] += 1;
+        if (Counter[ByteIndex] != 0) {
+            break;
+        }
     }
 
-    return Value << 1;
+    return;
+}
+
+ULONG
+CypAesSubstituteWord (
+    ULONG Value
+    )
+
+/*++
+
+Routine Description:
+
+    This routine runs each byte of the given word through the AES S-box in
+    constant time.
+
+Arguments:
+
+    Value - Supplies the word to substitute.
+
+Return Value:
+
+    Returns the substituted word.
+
+--*/
+
+{
+
+    ULONG Bit;
+    ULONG Byte;
+    UCHAR Input;
+    ULONG Output;
+    ULONG Result;
+    ULONGLONG State[BITS_PER_BYTE];
+
+    RtlZeroMemory(State, sizeof(State));
+    for (Byte = 0; Byte < sizeof(ULONG); Byte += 1) {
+        Input = (UCHAR)(Value >> (Byte * BITS_PER_BYTE));
+        for (Bit = 0; Bit < BITS_PER_BYTE; Bit += 1) {
+            State[Bit] |= (ULONGLONG)((Input >> Bit) & 0x1) << Byte;
+        }
+    }
+
+    CypAesBitsliceSubBytes(State);
+    Result = 0;
+    for (Byte = 0; Byte < sizeof(ULONG); Byte += 1) {
+        Output = 0;
+        for (Bit = 0; Bit < BITS_PER_BYTE; Bit += 1) {
+            Output |= ((State[Bit] >> Byte) & 0x1) << Bit;
+        }
+
+        Result |= Output << (Byte * BITS_PER_BYTE);
+    }
+
+    return Result;
+}
+
+VOID
+CypAesComputeBitslicedKeys (
+    PAES_CONTEXT Context
+    )
+
+/*++
+
+Routine Description:
+
+    This routine converts the context's round keys into the bitsliced form
+    used by the block routines.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Bit;
+    UCHAR Byte;
+    ULONG Column;
+    PUSHORT Planes;
+    ULONG Position;
+    INT Round;
+    ULONG Row;
+    ULONG Word;
+
+    for (Round = 0; Round <= Context->Rounds; Round += 1) {
+        Planes = Context->BitslicedKeys[Round];
+        RtlZeroMemory(Planes, sizeof(Context->BitslicedKeys[Round]));
+        for (Column = 0; Column < 4; Column += 1) {
+            Word = Context->Keys[(Round * 4) + Column];
+            for (Row = 0; Row < 4; Row += 1) {
+                Byte = (UCHAR)(Word >> (24 - (Row * BITS_PER_BYTE)));
+                Position = (Row * 4) + Column;
+                for (Bit = 0; Bit < BITS_PER_BYTE; Bit += 1) {
+                    Planes[Bit] |= ((Byte >> Bit) & 0x1) << Position;
+                }
+            }
+        }
+    }
+
+    return;
+}
+
+VOID
+CypAesBitsliceLoad (
+    PULONGLONG State,
+    PUCHAR Blocks,
+    UINTN BlockCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine converts blocks of data into bitsliced form.
+
+Arguments:
+
+    State - Supplies a pointer where the eight bitsliced planes will be
+        returned.
+
+    Blocks - Supplies a pointer to the blocks to load.
+
+    BlockCount - Supplies the number of blocks to load. Unused lanes are
+        zeroed.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Bit;
+    UINTN Block;
+    UCHAR Byte;
+    ULONG ByteIndex;
+    ULONG Position;
+
+    RtlZeroMemory(State, sizeof(ULONGLONG) * BITS_PER_BYTE);
+    for (Block = 0; Block < BlockCount; Block += 1) {
+        for (ByteIndex = 0; ByteIndex < AES_BLOCK_SIZE; ByteIndex += 1) {
+            Byte = *Blocks;
+            Blocks += 1;
+            Position = (Block * AES_BLOCK_SIZE) + ((ByteIndex & 0x3) * 4) +
+                       (ByteIndex >> 2);
+
+            for (Bit = 0; Bit < BITS_PER_BYTE; Bit += 1) {
+                State[Bit] |= (ULONGLONG)((Byte >> Bit) & 0x1) << Position;
+            }
+        }
+    }
+
+    return;
+}
+
+VOID
+CypAesBitsliceStore (
+    PULONGLONG State,
+    PUCHAR Blocks,
+    UINTN BlockCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine converts bitsliced planes back into blocks of data.
+
+Arguments:
+
+    State - Supplies a pointer to the eight bitsliced planes.
+
+    Blocks - Supplies a pointer where the blocks will be returned.
+
+    BlockCount - Supplies the number of blocks to store.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Bit;
+    UINTN Block;
+    UCHAR Byte;
+    ULONG ByteIndex;
+    ULONG Position;
+
+    for (Block = 0; Block < BlockCount; Block += 1) {
+        for (ByteIndex = 0; ByteIndex < AES_BLOCK_SIZE; ByteIndex += 1) {
+            Position = (Block * AES_BLOCK_SIZE) + ((ByteIndex & 0x3) * 4) +
+                       (ByteIndex >> 2);
+
+            Byte = 0;
+            for (Bit = 0; Bit < BITS_PER_BYTE; Bit += 1) {
+                Byte |= ((State[Bit] >> Position) & 0x1) << Bit;
+            }
+
+            *Blocks = Byte;
+            Blocks += 1;
+        }
+    }
+
+    return;
+}
+
+VOID
+CypAesBitsliceAddRoundKey (
+    PULONGLONG State,
+    PUSHORT RoundKey
+    )
+
+/*++
+
+Routine Description:
+
+    This routine exclusive ORs a bitsliced round key into every lane of the
+    state.
+
+Arguments:
+
+    State - Supplies a pointer to the bitsliced state.
+
+    RoundKey - Supplies a pointer to the bitsliced round key.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Bit;
+
+    for (Bit = 0; Bit < BITS_PER_BYTE; Bit += 1) {
+        State[Bit] ^= AES_BITSLICE_REPLICATE(RoundKey[Bit]);
+    }
+
+    return;
+}
+
+VOID
+CypAesBitsliceSubBytes (
+    PULONGLONG State
+    )
+
+/*++
+
+Routine Description:
+
+    This routine runs every byte of the bitsliced state through the AES S-box.
+    It uses the Boyar-Peralta circuit, a straight line of logic operations
+    with no data dependent memory accesses or branches.
+
+Arguments:
+
+    State - Supplies a pointer to the bitsliced state.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Bit;
+    ULONGLONG T[68];
+    ULONGLONG X[BITS_PER_BYTE];
+    ULONGLONG Y[22];
+    ULONGLONG Z[18];
+
+    //
+    // The circuit numbers bits from most significant to least significant.
+    //
+
+    for (Bit = 0; Bit < BITS_PER_BYTE; Bit += 1) {
+        X[Bit] = State[(BITS_PER_BYTE - 1) - Bit];
+    }
+
+    //
+    // Perform the top linear transformation.
+    //
+
+    Y[14] = X[3] ^ X[5];
+    Y[13] = X[0] ^ X[6];
+    Y[9] = X[0] ^ X[3];
+    Y[8] = X[0] ^ X[5];
+    T[0] = X[1] ^ X[2];
+    Y[1] = T[0] ^ X[7];
+    Y[4] = Y[1] ^ X[3];
+    Y[12] = Y[13] ^ Y[14];
+    Y[2] = Y[1] ^ X[0];
+    Y[5] = Y[1] ^ X[6];
+    Y[3] = Y[5] ^ Y[8];
+    T[1] = X[4] ^ Y[12];
+    Y[15] = T[1] ^ X[5];
+    Y[20] = T[1] ^ X[1];
+    Y[6] = Y[15] ^ X[7];
+    Y[10] = Y[15] ^ T[0];
+    Y[11] = Y[20] ^ Y[9];
+    Y[7] = X[7] ^ Y[11];
+    Y[17] = Y[10] ^ Y[11];
+    Y[19] = Y[10] ^ Y[8];
+    Y[16] = T[0] ^ Y[11];
+    Y[21] = Y[13] ^ Y[16];
+    Y[18] = X[0] ^ Y[16];
+
+    //
+    // Perform the non-linear section, which is the inversion in GF(2^8).
+    //
+
+    T[2] = Y[12] & Y[15];
+    T[3] = Y[3] & Y[6];
+    T[4] = T[3] ^ T[2];
+    T[5] = Y[4] & X[7];
+    T[6] = T[5] ^ T[2];
+    T[7] = Y[13] & Y[16];
+    T[8] = Y[5] & Y[1];
+    T[9] = T[8] ^ T[7];
+    T[10] = Y[2] & Y[7];
+    T[11] = T[10] ^ T[7];
+    T[12] = Y[9] & Y[11];
+    T[13] = Y[14] & Y[17];
+    T[14] = T[13] ^ T[12];
+    T[15] = Y[8] & Y[10];
+    T[16] = T[15] ^ T[12];
+    T[17] = T[4] ^ T[14];
+    T[18] = T[6] ^ T[16];
+    T[19] = T[9] ^ T[14];
+    T[20] = T[11] ^ T[16];
+    T[21] = T[17] ^ Y[20];
+    T[22] = T[18] ^ Y[19];
+    T[23] = T[19] ^ Y[21];
+    T[24] = T[20] ^ Y[18];
+    T[25] = T[21] ^ T[22];
+    T[26] = T[21] & T[23];
+    T[27] = T[24] ^ T[26];
+    T[28] = T[25] & T[27];
+    T[29] = T[28] ^ T[22];
+    T[30] = T[23] ^ T[24];
+    T[31] = T[22] ^ T[26];
+    T[32] = T[31] & T[30];
+    T[33] = T[32] ^ T[24];
+    T[34] = T[23] ^ T[33];
+    T[35] = T[27] ^ T[33];
+    T[36] = T[24] & T[35];
+    T[37] = T[36] ^ T[34];
+    T[38] = T[27] ^ T[36];
+    T[39] = T[29] & T[38];
+    T[40] = T[25] ^ T[39];
+    T[41] = T[40] ^ T[37];
+    T[42] = T[29] ^ T[33];
+    T[43] = T[29] ^ T[40];
+    T[44] = T[33] ^ T[37];
+    T[45] = T[42] ^ T[41];
+    Z[0] = T[44] & Y[15];
+    Z[1] = T[37] & Y[6];
+    Z[2] = T[33] & X[7];
+    Z[3] = T[43] & Y[16];
+    Z[4] = T[40] & Y[1];
+    Z[5] = T[29] & Y[7];
+    Z[6] = T[42] & Y[11];
+    Z[7] = T[45] & Y[17];
+    Z[8] = T[41] & Y[10];
+    Z[9] = T[44] & Y[12];
+    Z[10] = T[37] & Y[3];
+    Z[11] = T[33] & Y[4];
+    Z[12] = T[43] & Y[13];
+    Z[13] = T[40] & Y[5];
+    Z[14] = T[29] & Y[2];
+    Z[15] = T[42] & Y[9];
+    Z[16] = T[45] & Y[14];
+    Z[17] = T[41] & Y[8];
+
+    //
+    // Perform the bottom linear transformation, which includes the affine
+    // transform.
+    //
+
+    T[46] = Z[15] ^ Z[16];
+    T[47] = Z[10] ^ Z[11];
+    T[48] = Z[5] ^ Z[13];
+    T[49] = Z[9] ^ Z[10];
+    T[50] = Z[2] ^ Z[12];
+    T[51] = Z[2] ^ Z[5];
+    T[52] = Z[7] ^ Z[8];
+    T[53] = Z[0] ^ Z[3];
+    T[54] = Z[6] ^ Z[7];
+    T[55] = Z[16] ^ Z[17];
+    T[56] = Z[12] ^ T[48];
+    T[57] = T[50] ^ T[53];
+    T[58] = Z[4] ^ T[46];
+    T[59] = Z[3] ^ T[54];
+    T[60] = T[46] ^ T[57];
+    T[61] = Z[14] ^ T[57];
+    T[62] = T[52] ^ T[58];
+    T[63] = T[49] ^ T[58];
+    T[64] = Z[4] ^ T[59];
+    T[65] = T[61] ^ T[62];
+    T[66] = Z[1] ^ T[63];
+    T[67] = T[64] ^ T[65];
+    State[7] = T[59] ^ T[63];
+    State[1] = T[56] ^ ~T[62];
+    State[0] = T[48] ^ ~T[60];
+    State[4] = T[53] ^ T[66];
+    State[3] = T[51] ^ T[66];
+    State[2] = T[47] ^ T[65];
+    State[6] = T[64] ^ ~State[4];
+    State[5] = T[55] ^ ~T[67];
+    return;
+}
+
+VOID
+CypAesBitsliceInverseSubBytes (
+    PULONGLONG State
+    )
+
+/*++
+
+Routine Description:
+
+    This routine runs every byte of the bitsliced state through the inverse
+    AES S-box. The S-box is an inversion followed by an affine transform, so
+    the inverse is computed by applying the inverse affine transform, the
+    forward S-box, and the inverse affine transform again.
+
+Arguments:
+
+    State - Supplies a pointer to the bitsliced state.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Bit;
+    ULONG Pass;
+    ULONGLONG Q[BITS_PER_BYTE];
+
+    for (Pass = 0; Pass < 2; Pass += 1) {
+
+        //
+        // Apply the inverse affine transform, which rotates and adds the
+        // constant 0x05.
+        //
+
+        for (Bit = 0; Bit < BITS_PER_BYTE; Bit += 1) {
+            Q[Bit] = State[Bit];
+        }
+
+        for (Bit = 0; Bit < BITS_PER_BYTE; Bit += 1) {
+            State[Bit] = Q[(Bit + 2) % BITS_PER_BYTE] ^
+                         Q[(Bit + 5) % BITS_PER_BYTE] ^
+                         Q[(Bit + 7) % BITS_PER_BYTE];
+        }
+
+        State[0] = ~State[0];
+        State[2] = ~State[2];
+        if (Pass == 0) {
+            CypAesBitsliceSubBytes(State);
+        }
+    }
+
+    return;
+}
+
+VOID
+CypAesBitsliceShiftRows (
+    PULONGLONG State
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs the shift rows step on the bitsliced state, rotating
+    row N left by N columns.
+
+Arguments:
+
+    State - Supplies a pointer to the bitsliced state.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Bit;
+    ULONGLONG Plane;
+
+    for (Bit = 0; Bit < BITS_PER_BYTE; Bit += 1) {
+        Plane = State[Bit];
+        State[Bit] = (Plane & AES_BITSLICE_REPLICATE(0x000F)) |
+                     ((Plane & AES_BITSLICE_REPLICATE(0x00E0)) >> 1) |
+                     ((Plane & AES_BITSLICE_REPLICATE(0x0010)) << 3) |
+                     ((Plane & AES_BITSLICE_REPLICATE(0x0C00)) >> 2) |
+                     ((Plane & AES_BITSLICE_REPLICATE(0x0300)) << 2) |
+                     ((Plane & AES_BITSLICE_REPLICATE(0x8000)) >> 3) |
+                     ((Plane & AES_BITSLICE_REPLICATE(0x7000)) << 1);
+    }
+
+    return;
+}
+
+VOID
+CypAesBitsliceInverseShiftRows (
+    PULONGLONG State
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs the inverse shift rows step on the bitsliced state,
+    rotating row N right by N columns.
+
+Arguments:
+
+    State - Supplies a pointer to the bitsliced state.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Bit;
+    ULONGLONG Plane;
+
+    for (Bit = 0; Bit < BITS_PER_BYTE; Bit += 1) {
+        Plane = State[Bit];
+        State[Bit] = (Plane & AES_BITSLICE_REPLICATE(0x000F)) |
+                     ((Plane & AES_BITSLICE_REPLICATE(0x0070)) << 1) |
+                     ((Plane & AES_BITSLICE_REPLICATE(0x0080)) >> 3) |
+                     ((Plane & AES_BITSLICE_REPLICATE(0x0C00)) >> 2) |
+                     ((Plane & AES_BITSLICE_REPLICATE(0x0300)) << 2) |
+                     ((Plane & AES_BITSLICE_REPLICATE(0x1000)) << 3) |
+                     ((Plane & AES_BITSLICE_REPLICATE(0xE000)) >> 1);
+    }
+
+    return;
+}
+
+VOID
+CypAesBitsliceMixColumns (
+    PULONGLONG State
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs the mix columns step on the bitsliced state. Each
+    output byte is 2 * A[N] + 3 * A[N + 1] + A[N + 2] + A[N + 3], computed as
+    2 * (A[N] + A[N + 1]) + A[N + 1] + (A[N + 2] + A[N + 3]).
+
+Arguments:
+
+    State - Supplies a pointer to the bitsliced state.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Bit;
+    ULONGLONG Rotated[BITS_PER_BYTE];
+    ULONGLONG Sum[BITS_PER_BYTE];
+    ULONGLONG Twice[BITS_PER_BYTE];
+
+    for (Bit = 0; Bit < BITS_PER_BYTE; Bit += 1) {
+        Rotated[Bit] = AES_BITSLICE_ROTATE_ROWS1(State[Bit]);
+        Sum[Bit] = State[Bit] ^ Rotated[Bit];
+        Twice[Bit] = Sum[Bit];
+    }
+
+    CypAesBitsliceDouble(Twice);
+    for (Bit = 0; Bit < BITS_PER_BYTE; Bit += 1) {
+        State[Bit] = Twice[Bit] ^ Rotated[Bit] ^
+                     AES_BITSLICE_ROTATE_ROWS2(Sum[Bit]);
+    }
+
+    return;
+}
+
+VOID
+CypAesBitsliceInverseMixColumns (
+    PULONGLONG State
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs the inverse mix columns step on the bitsliced state.
+    The inverse matrix factors into the forward matrix times one that
+    computes A[N] + 4 * (A[N] + A[N + 2]), which is cheap to evaluate.
+
+Arguments:
+
+    State - Supplies a pointer to the bitsliced state.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Bit;
+    ULONGLONG Quadruple[BITS_PER_BYTE];
+
+    for (Bit = 0; Bit < BITS_PER_BYTE; Bit += 1) {
+        Quadruple[Bit] = State[Bit] ^ AES_BITSLICE_ROTATE_ROWS2(State[Bit]);
+    }
+
+    CypAesBitsliceDouble(Quadruple);
+    CypAesBitsliceDouble(Quadruple);
+    for (Bit = 0; Bit < BITS_PER_BYTE; Bit += 1) {
+        State[Bit] ^= Quadruple[Bit];
+    }
+
+    CypAesBitsliceMixColumns(State);
+    return;
+}
+
+VOID
+CypAesBitsliceDouble (
+    PULONGLONG Value
+    )
+
+/*++
+
+Routine Description:
+
+    This routine multiplies every byte of a bitsliced value by 2 in GF(2^8)
+    using the irreducible polynomial x^8 + x^4 + x^3 + x + 1.
+
+Arguments:
+
+    Value - Supplies a pointer to the bitsliced value to double in place.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONGLONG High;
+
+    High = Value[7];
+    Value[7] = Value[6];
+    Value[6] = Value[5];
+    Value[5] = Value[4];
+    Value[4] = Value[3] ^ High;
+    Value[3] = Value[2] ^ High;
+    Value[2] = Value[1];
+    Value[1] = Value[0] ^ High;
+    Value[0] = High;
+    return;
 }
 
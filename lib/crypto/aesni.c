@@ -0,0 +1,1043 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    aesni.c
+
+Abstract:
+
+    This module implements the AES and GHASH backends that use the x86 AES-NI
+    and PCLMULQDQ instructions. Independent blocks are interleaved eight at a
+    time to hide the latency of the round instructions.
+
+Author:
+
+    agent 19-Oct-2026
+
+Environment:
+
+    Any
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include "cryptop.h"
+
+#ifdef CY_AES_NI
+
+#include <cpuid.h>
+#include <wmmintrin.h>
+#include <tmmintrin.h>
+
+//
+// --------------------------------------------------------------------- Macros
+//
+
+//
+// This macro marks a routine as using the AES, carry-less multiply, and byte
+// shuffle instructions, without requiring the whole library to be compiled
+// for processors that have them.
+//
+
+#define AES_NI_TARGET __attribute__((target("aes,pclmul,ssse3")))
+
+//
+// This macro loads an unaligned 16-byte block.
+//
+
+#define AES_NI_LOAD(_Pointer) _mm_loadu_si128((__m128i *)(_Pointer))
+
+//
+// This macro stores an unaligned 16-byte block.
+//
+
+#define AES_NI_STORE(_Pointer, _Value) \
+    _mm_storeu_si128((__m128i *)(_Pointer), (_Value))
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// Define the number of blocks processed in parallel.
+//
+
+#define AES_NI_PARALLEL_BLOCKS 8
+
+//
+// Define the number of blocks folded into GHASH per reduction.
+//
+
+#define AES_NI_GHASH_BLOCKS 4
+
+//
+// Define the processor feature bits cached after the first query.
+//
+
+#define AES_NI_FEATURE_DETECTED 0x00000001
+#define AES_NI_FEATURE_AES      0x00000002
+#define AES_NI_FEATURE_CLMUL    0x00000004
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+ULONG
+CypAesNiGetFeatures (
+    VOID
+    );
+
+AES_NI_TARGET
+VOID
+CypAesNiLoadKeys (
+    PAES_CONTEXT Context,
+    __m128i *RoundKeys,
+    BOOL Decrypt
+    );
+
+AES_NI_TARGET
+VOID
+CypAesNiEncryptParallel (
+    __m128i *RoundKeys,
+    INT Rounds,
+    __m128i *Blocks,
+    UINTN BlockCount
+    );
+
+AES_NI_TARGET
+VOID
+CypAesNiDecryptParallel (
+    __m128i *RoundKeys,
+    INT Rounds,
+    __m128i *Blocks,
+    UINTN BlockCount
+    );
+
+AES_NI_TARGET
+VOID
+CypAesNiClmulMultiply (
+    __m128i Value1,
+    __m128i Value2,
+    __m128i *Low,
+    __m128i *High
+    );
+
+AES_NI_TARGET
+__m128i
+CypAesNiClmulReduce (
+    __m128i Low,
+    __m128i High
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// Store the processor features, detected on first use.
+//
+
+volatile ULONG CyAesNiFeatures;
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+BOOL
+CypAesNiIsSupported (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines whether the processor supports the AES
+    instructions.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    TRUE if the AES-NI backend can be used.
+
+    FALSE if the portable implementation must be used.
+
+--*/
+
+{
+
+    if ((CypAesNiGetFeatures() & AES_NI_FEATURE_AES) != 0) {
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+BOOL
+CypAesNiIsClmulSupported (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines whether the processor supports the carry-less
+    multiply instruction used to accelerate GHASH.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    TRUE if the carry-less multiply GHASH routine can be used.
+
+    FALSE if the portable GHASH must be used.
+
+--*/
+
+{
+
+    if ((CypAesNiGetFeatures() & AES_NI_FEATURE_CLMUL) != 0) {
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+AES_NI_TARGET
+VOID
+CypAesNiEcbEncrypt (
+    PAES_CONTEXT Context,
+    PUCHAR Plaintext,
+    PUCHAR Ciphertext,
+    UINTN Length
+    )
+
+/*++
+
+Routine Description:
+
+    This routine encrypts blocks in codebook mode using the AES instructions,
+    eight blocks at a time.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context.
+
+    Plaintext - Supplies a pointer to the plaintext buffer.
+
+    Ciphertext - Supplies a pointer where the ciphertext will be returned.
+
+    Length - Supplies the length of the buffers in bytes. This must be a
+        multiple of 16 bytes.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UINTN Block;
+    UINTN BlockCount;
+    __m128i Blocks[AES_NI_PARALLEL_BLOCKS];
+    __m128i RoundKeys[AES_MAX_ROUNDS + 1];
+
+    CypAesNiLoadKeys(Context, RoundKeys, FALSE);
+    while (Length != 0) {
+        BlockCount = Length / AES_BLOCK_SIZE;
+        if (BlockCount > AES_NI_PARALLEL_BLOCKS) {
+            BlockCount = AES_NI_PARALLEL_BLOCKS;
+        }
+
+        for (Block = 0; Block < BlockCount; Block += 1) {
+            Blocks[Block] = AES_NI_LOAD(Plaintext + (Block * AES_BLOCK_SIZE));
+        }
+
+        CypAesNiEncryptParallel(RoundKeys, Context->Rounds, Blocks, BlockCount);
+        for (Block = 0; Block < BlockCount; Block += 1) {
+            AES_NI_STORE(Ciphertext + (Block * AES_BLOCK_SIZE), Blocks[Block]);
+        }
+
+        Plaintext += BlockCount * AES_BLOCK_SIZE;
+        Ciphertext += BlockCount * AES_BLOCK_SIZE;
+        Length -= BlockCount * AES_BLOCK_SIZE;
+    }
+
+    return;
+}
+
+AES_NI_TARGET
+VOID
+CypAesNiEcbDecrypt (
+    PAES_CONTEXT Context,
+    PUCHAR Ciphertext,
+    PUCHAR Plaintext,
+    UINTN Length
+    )
+
+/*++
+
+Routine Description:
+
+    This routine decrypts blocks in codebook mode using the AES instructions,
+    eight blocks at a time. The keys must have been converted for decryption.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context.
+
+    Ciphertext - Supplies a pointer to the ciphertext buffer.
+
+    Plaintext - Supplies a pointer where the plaintext will be returned.
+
+    Length - Supplies the length of the buffers in bytes. This must be a
+        multiple of 16 bytes.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UINTN Block;
+    UINTN BlockCount;
+    __m128i Blocks[AES_NI_PARALLEL_BLOCKS];
+    __m128i RoundKeys[AES_MAX_ROUNDS + 1];
+
+    CypAesNiLoadKeys(Context, RoundKeys, TRUE);
+    while (Length != 0) {
+        BlockCount = Length / AES_BLOCK_SIZE;
+        if (BlockCount > AES_NI_PARALLEL_BLOCKS) {
+            BlockCount = AES_NI_PARALLEL_BLOCKS;
+        }
+
+        for (Block = 0; Block < BlockCount; Block += 1) {
+            Blocks[Block] = AES_NI_LOAD(Ciphertext + (Block * AES_BLOCK_SIZE));
+        }
+
+        CypAesNiDecryptParallel(RoundKeys, Context->Rounds, Blocks, BlockCount);
+        for (Block = 0; Block < BlockCount; Block += 1) {
+            AES_NI_STORE(Plaintext + (Block * AES_BLOCK_SIZE), Blocks[Block]);
+        }
+
+        Ciphertext += BlockCount * AES_BLOCK_SIZE;
+        Plaintext += BlockCount * AES_BLOCK_SIZE;
+        Length -= BlockCount * AES_BLOCK_SIZE;
+    }
+
+    return;
+}
+
+AES_NI_TARGET
+VOID
+CypAesNiCbcEncrypt (
+    PAES_CONTEXT Context,
+    PUCHAR Plaintext,
+    PUCHAR Ciphertext,
+    UINTN Length
+    )
+
+/*++
+
+Routine Description:
+
+    This routine encrypts blocks in CBC mode using the AES instructions,
+    updating the initialization vector in the context.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context.
+
+    Plaintext - Supplies a pointer to the plaintext buffer.
+
+    Ciphertext - Supplies a pointer where the ciphertext will be returned.
+
+    Length - Supplies the length of the buffers in bytes. This must be a
+        multiple of 16 bytes.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    __m128i Block;
+    __m128i RoundKeys[AES_MAX_ROUNDS + 1];
+
+    //
+    // CBC encryption is inherently serial, so there is nothing to interleave.
+    //
+
+    CypAesNiLoadKeys(Context, RoundKeys, FALSE);
+    Block = AES_NI_LOAD(Context->InitializationVector);
+    while (Length != 0) {
+        Block = _mm_xor_si128(Block, AES_NI_LOAD(Plaintext));
+        CypAesNiEncryptParallel(RoundKeys, Context->Rounds, &Block, 1);
+        AES_NI_STORE(Ciphertext, Block);
+        Plaintext += AES_BLOCK_SIZE;
+        Ciphertext += AES_BLOCK_SIZE;
+        Length -= AES_BLOCK_SIZE;
+    }
+
+    AES_NI_STORE(Context->InitializationVector, Block);
+    return;
+}
+
+AES_NI_TARGET
+VOID
+CypAesNiCbcDecrypt (
+    PAES_CONTEXT Context,
+    PUCHAR Ciphertext,
+    PUCHAR Plaintext,
+    UINTN Length
+    )
+
+/*++
+
+Routine Description:
+
+    This routine decrypts blocks in CBC mode using the AES instructions, eight
+    blocks at a time. The keys must have been converted for decryption.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context.
+
+    Ciphertext - Supplies a pointer to the ciphertext buffer.
+
+    Plaintext - Supplies a pointer where the plaintext will be returned.
+
+    Length - Supplies the length of the buffers in bytes. This must be a
+        multiple of 16 bytes.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UINTN Block;
+    UINTN BlockCount;
+    __m128i Blocks[AES_NI_PARALLEL_BLOCKS];
+    __m128i Chain[AES_NI_PARALLEL_BLOCKS + 1];
+    __m128i RoundKeys[AES_MAX_ROUNDS + 1];
+
+    CypAesNiLoadKeys(Context, RoundKeys, TRUE);
+    Chain[0] = AES_NI_LOAD(Context->InitializationVector);
+    while (Length != 0) {
+        BlockCount = Length / AES_BLOCK_SIZE;
+        if (BlockCount > AES_NI_PARALLEL_BLOCKS) {
+            BlockCount = AES_NI_PARALLEL_BLOCKS;
+        }
+
+        //
+        // Load all the ciphertext before storing anything, since the caller
+        // may be decrypting in place.
+        //
+
+        for (Block = 0; Block < BlockCount; Block += 1) {
+            Blocks[Block] = AES_NI_LOAD(Ciphertext + (Block * AES_BLOCK_SIZE));
+            Chain[Block + 1] = Blocks[Block];
+        }
+
+        CypAesNiDecryptParallel(RoundKeys, Context->Rounds, Blocks, BlockCount);
+        for (Block = 0; Block < BlockCount; Block += 1) {
+            AES_NI_STORE(Plaintext + (Block * AES_BLOCK_SIZE),
+                         _mm_xor_si128(Blocks[Block], Chain[Block]));
+        }
+
+        Chain[0] = Chain[BlockCount];
+        Ciphertext += BlockCount * AES_BLOCK_SIZE;
+        Plaintext += BlockCount * AES_BLOCK_SIZE;
+        Length -= BlockCount * AES_BLOCK_SIZE;
+    }
+
+    AES_NI_STORE(Context->InitializationVector, Chain[0]);
+    return;
+}
+
+AES_NI_TARGET
+VOID
+CypAesNiCtrCrypt (
+    PAES_CONTEXT Context,
+    PUCHAR Counter,
+    PUCHAR Input,
+    PUCHAR Output,
+    UINTN Length,
+    BOOL Increment32
+    )
+
+/*++
+
+Routine Description:
+
+    This routine runs AES in counter mode using the AES instructions, eight
+    blocks at a time.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context.
+
+    Counter - Supplies a pointer to the big-endian counter block, which is
+        advanced past the blocks used.
+
+    Input - Supplies a pointer to the input buffer.
+
+    Output - Supplies a pointer where the output will be returned.
+
+    Length - Supplies the length of the buffers in bytes. This must be a
+        multiple of 16 bytes.
+
+    Increment32 - Supplies a boolean indicating whether only the low 32 bits
+        of the counter are incremented.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UINTN Block;
+    UINTN BlockCount;
+    __m128i Blocks[AES_NI_PARALLEL_BLOCKS];
+    ULONGLONG High;
+    ULONGLONG Low;
+    __m128i RoundKeys[AES_MAX_ROUNDS + 1];
+
+    CypAesNiLoadKeys(Context, RoundKeys, FALSE);
+
+    //
+    // Keep the counter as a pair of native integers, and build each counter
+    // block by byte swapping them back into big-endian order.
+    //
+
+    High = RtlByteSwapUlonglong(*((PULONGLONG)Counter));
+    Low = RtlByteSwapUlonglong(*((PULONGLONG)(Counter + sizeof(ULONGLONG))));
+    while (Length != 0) {
+        BlockCount = Length / AES_BLOCK_SIZE;
+        if (BlockCount > AES_NI_PARALLEL_BLOCKS) {
+            BlockCount = AES_NI_PARALLEL_BLOCKS;
+        }
+
+        for (Block = 0; Block < BlockCount; Block += 1) {
+            Blocks[Block] = _mm_set_epi64x(RtlByteSwapUlonglong(Low),
+                                           RtlByteSwapUlonglong(High));
+
+            if (Increment32 != FALSE) {
+                Low = (Low & 0xFFFFFFFF00000000ULL) |
+                      ((Low + 1) & 0x00000000FFFFFFFFULL);
+
+            } else {
+                Low += 1;
+                if (Low == 0) {
+                    High += 1;
+                }
+            }
+        }
+
+        CypAesNiEncryptParallel(RoundKeys, Context->Rounds, Blocks, BlockCount);
+        for (Block = 0; Block < BlockCount; Block += 1) {
+            AES_NI_STORE(Output + (Block * AES_BLOCK_SIZE),
+                         _mm_xor_si128(Blocks[Block],
+                                       AES_NI_LOAD(Input +
+                                                   (Block * AES_BLOCK_SIZE))));
+        }
+
+        Input += BlockCount * AES_BLOCK_SIZE;
+        Output += BlockCount * AES_BLOCK_SIZE;
+        Length -= BlockCount * AES_BLOCK_SIZE;
+    }
+
+    *((PULONGLONG)Counter) = RtlByteSwapUlonglong(High);
+    *((PULONGLONG)(Counter + sizeof(ULONGLONG))) = RtlByteSwapUlonglong(Low);
+    return;
+}
+
+AES_NI_TARGET
+VOID
+CypAesNiGhash (
+    PUCHAR HashKey,
+    PUCHAR State,
+    PUCHAR Data,
+    UINTN Length
+    )
+
+/*++
+
+Routine Description:
+
+    This routine folds blocks of data into a GHASH state using the carry-less
+    multiply instruction, four blocks per reduction.
+
+Arguments:
+
+    HashKey - Supplies a pointer to the 16-byte GHASH key.
+
+    State - Supplies a pointer to the 16-byte running GHASH value, which is
+        updated in place.
+
+    Data - Supplies a pointer to the data to hash.
+
+    Length - Supplies the length of the data in bytes. This must be a multiple
+        of 16 bytes.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UINTN Block;
+    __m128i Hash;
+    __m128i High;
+    __m128i Low;
+    __m128i Powers[AES_NI_GHASH_BLOCKS];
+    __m128i ProductHigh;
+    __m128i ProductLow;
+    __m128i Reverse;
+    __m128i Value;
+
+    //
+    // GHASH treats blocks as bit-reflected polynomials. Byte reversing them
+    // lets the multiply operate on them as ordinary little-endian values.
+    //
+
+    Reverse = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7,
+                           8, 9, 10, 11, 12, 13, 14, 15);
+
+    Hash = _mm_shuffle_epi8(AES_NI_LOAD(State), Reverse);
+    Powers[0] = _mm_shuffle_epi8(AES_NI_LOAD(HashKey), Reverse);
+
+    //
+    // Fold four blocks at a time as X0 * H^4 + X1 * H^3 + X2 * H^2 + X3 * H,
+    // which needs only a single reduction.
+    //
+
+    if (Length >= (AES_NI_GHASH_BLOCKS * AES_BLOCK_SIZE)) {
+        for (Block = 1; Block < AES_NI_GHASH_BLOCKS; Block += 1) {
+            CypAesNiClmulMultiply(Powers[Block - 1], Powers[0], &Low, &High);
+            Powers[Block] = CypAesNiClmulReduce(Low, High);
+        }
+
+        while (Length >= (AES_NI_GHASH_BLOCKS * AES_BLOCK_SIZE)) {
+            Low = _mm_setzero_si128();
+            High = _mm_setzero_si128();
+            for (Block = 0; Block < AES_NI_GHASH_BLOCKS; Block += 1) {
+                Value = _mm_shuffle_epi8(AES_NI_LOAD(Data), Reverse);
+                if (Block == 0) {
+                    Value = _mm_xor_si128(Value, Hash);
+                }
+
+                CypAesNiClmulMultiply(Value,
+                                      Powers[AES_NI_GHASH_BLOCKS - 1 - Block],
+                                      &ProductLow,
+                                      &ProductHigh);
+
+                Low = _mm_xor_si128(Low, ProductLow);
+                High = _mm_xor_si128(High, ProductHigh);
+                Data += AES_BLOCK_SIZE;
+            }
+
+            Hash = CypAesNiClmulReduce(Low, High);
+            Length -= AES_NI_GHASH_BLOCKS * AES_BLOCK_SIZE;
+        }
+    }
+
+    while (Length != 0) {
+        Value = _mm_shuffle_epi8(AES_NI_LOAD(Data), Reverse);
+        CypAesNiClmulMultiply(_mm_xor_si128(Value, Hash),
+                              Powers[0],
+                              &Low,
+                              &High);
+
+        Hash = CypAesNiClmulReduce(Low, High);
+        Data += AES_BLOCK_SIZE;
+        Length -= AES_BLOCK_SIZE;
+    }
+
+    AES_NI_STORE(State, _mm_shuffle_epi8(Hash, Reverse));
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+ULONG
+CypAesNiGetFeatures (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the processor features relevant to this backend,
+    querying the processor the first time through.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns a mask of AES_NI_FEATURE_* flags.
+
+--*/
+
+{
+
+    ULONG Eax;
+    ULONG Ebx;
+    ULONG Ecx;
+    ULONG Edx;
+    ULONG Features;
+
+    Features = CyAesNiFeatures;
+    if (Features != 0) {
+        return Features;
+    }
+
+    //
+    // The byte shuffle instruction is needed to convert between the context's
+    // word layout and byte order, so require it as well.
+    //
+
+    Features = AES_NI_FEATURE_DETECTED;
+    if (__get_cpuid(1, &Eax, &Ebx, &Ecx, &Edx) != 0) {
+        if (((Ecx & bit_AES) != 0) && ((Ecx & bit_SSSE3) != 0)) {
+            Features |= AES_NI_FEATURE_AES;
+            if ((Ecx & bit_PCLMUL) != 0) {
+                Features |= AES_NI_FEATURE_CLMUL;
+            }
+        }
+    }
+
+    //
+    // Racing threads compute the same answer, so a plain store is fine.
+    //
+
+    CyAesNiFeatures = Features;
+    return Features;
+}
+
+AES_NI_TARGET
+VOID
+CypAesNiLoadKeys (
+    PAES_CONTEXT Context,
+    __m128i *RoundKeys,
+    BOOL Decrypt
+    )
+
+/*++
+
+Routine Description:
+
+    This routine converts the context's round keys into the byte order the
+    AES instructions expect.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context.
+
+    RoundKeys - Supplies a pointer where the round keys will be returned, in
+        the order they are applied.
+
+    Decrypt - Supplies a boolean indicating whether to return the keys in
+        reverse order for decryption.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    __m128i Key;
+    INT Round;
+    __m128i Swap;
+
+    //
+    // The context stores each column as a native word with the first byte in
+    // the most significant position, so byte swap each word.
+    //
+
+    Swap = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11,
+                        4, 5, 6, 7, 0, 1, 2, 3);
+
+    for (Round = 0; Round <= Context->Rounds; Round += 1) {
+        Key = _mm_shuffle_epi8(AES_NI_LOAD(&(Context->Keys[Round * 4])), Swap);
+        if (Decrypt != FALSE) {
+            RoundKeys[Context->Rounds - Round] = Key;
+
+        } else {
+            RoundKeys[Round] = Key;
+        }
+    }
+
+    return;
+}
+
+AES_NI_TARGET
+VOID
+CypAesNiEncryptParallel (
+    __m128i *RoundKeys,
+    INT Rounds,
+    __m128i *Blocks,
+    UINTN BlockCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine encrypts several independent blocks, interleaving the rounds
+    so the processor can pipeline them.
+
+Arguments:
+
+    RoundKeys - Supplies a pointer to the round keys.
+
+    Rounds - Supplies the number of rounds.
+
+    Blocks - Supplies a pointer to the blocks, which are encrypted in place.
+
+    BlockCount - Supplies the number of blocks, up to eight.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UINTN Block;
+    INT Round;
+
+    for (Block = 0; Block < BlockCount; Block += 1) {
+        Blocks[Block] = _mm_xor_si128(Blocks[Block], RoundKeys[0]);
+    }
+
+    for (Round = 1; Round < Rounds; Round += 1) {
+        for (Block = 0; Block < BlockCount; Block += 1) {
+            Blocks[Block] = _mm_aesenc_si128(Blocks[Block], RoundKeys[Round]);
+        }
+    }
+
+    for (Block = 0; Block < BlockCount; Block += 1) {
+        Blocks[Block] = _mm_aesenclast_si128(Blocks[Block], RoundKeys[Rounds]);
+    }
+
+    return;
+}
+
+AES_NI_TARGET
+VOID
+CypAesNiDecryptParallel (
+    __m128i *RoundKeys,
+    INT Rounds,
+    __m128i *Blocks,
+    UINTN BlockCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine decrypts several independent blocks, interleaving the rounds
+    so the processor can pipeline them.
+
+Arguments:
+
+    RoundKeys - Supplies a pointer to the decryption round keys, in the order
+        they are applied.
+
+    Rounds - Supplies the number of rounds.
+
+    Blocks - Supplies a pointer to the blocks, which are decrypted in place.
+
+    BlockCount - Supplies the number of blocks, up to eight.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UINTN Block;
+    INT Round;
+
+    for (Block = 0; Block < BlockCount; Block += 1) {
+        Blocks[Block] = _mm_xor_si128(Blocks[Block], RoundKeys[0]);
+    }
+
+    for (Round = 1; Round < Rounds; Round += 1) {
+        for (Block = 0; Block < BlockCount; Block += 1) {
+            Blocks[Block] = _mm_aesdec_si128(Blocks[Block], RoundKeys[Round]);
+        }
+    }
+
+    for (Block = 0; Block < BlockCount; Block += 1) {
+        Blocks[Block] = _mm_aesdeclast_si128(Blocks[Block], RoundKeys[Rounds]);
+    }
+
+    return;
+}
+
+AES_NI_TARGET
+VOID
+CypAesNiClmulMultiply (
+    __m128i Value1,
+    __m128i Value2,
+    __m128i *Low,
+    __m128i *High
+    )
+
+/*++
+
+Routine Description:
+
+    This routine computes the unreduced 256-bit carry-less product of two
+    byte reversed GHASH values.
+
+Arguments:
+
+    Value1 - Supplies the first value.
+
+    Value2 - Supplies the second value.
+
+    Low - Supplies a pointer where the low 128 bits of the product will be
+        returned.
+
+    High - Supplies a pointer where the high 128 bits of the product will be
+        returned.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    __m128i Middle;
+
+    Middle = _mm_xor_si128(_mm_clmulepi64_si128(Value1, Value2, 0x10),
+                           _mm_clmulepi64_si128(Value1, Value2, 0x01));
+
+    *Low = _mm_xor_si128(_mm_clmulepi64_si128(Value1, Value2, 0x00),
+                         _mm_slli_si128(Middle, 8));
+
+    *High = _mm_xor_si128(_mm_clmulepi64_si128(Value1, Value2, 0x11),
+                          _mm_srli_si128(Middle, 8));
+
+    return;
+}
+
+AES_NI_TARGET
+__m128i
+CypAesNiClmulReduce (
+    __m128i Low,
+    __m128i High
+    )
+
+/*++
+
+Routine Description:
+
+    This routine reduces a 256-bit carry-less product modulo the GHASH
+    polynomial x^128 + x^7 + x^2 + x + 1. Since the operands are bit
+    reflected, the product is first shifted left by one bit.
+
+Arguments:
+
+    Low - Supplies the low 128 bits of the product.
+
+    High - Supplies the high 128 bits of the product.
+
+Return Value:
+
+    Returns the reduced 128-bit value.
+
+--*/
+
+{
+
+    __m128i Carry;
+    __m128i CarryHigh;
+    __m128i Fold;
+    __m128i Spill;
+
+    //
+    // Shift the 256-bit product left by one bit.
+    //
+
+    Carry = _mm_srli_epi32(Low, 31);
+    CarryHigh = _mm_srli_epi32(High, 31);
+    Low = _mm_slli_epi32(Low, 1);
+    High = _mm_slli_epi32(High, 1);
+    Spill = _mm_srli_si128(Carry, 12);
+    CarryHigh = _mm_slli_si128(CarryHigh, 4);
+    Carry = _mm_slli_si128(Carry, 4);
+    Low = _mm_or_si128(Low, Carry);
+    High = _mm_or_si128(High, CarryHigh);
+    High = _mm_or_si128(High, Spill);
+
+    //
+    // Perform the first phase of the reduction.
+    //
+
+    Fold = _mm_xor_si128(_mm_slli_epi32(Low, 31), _mm_slli_epi32(Low, 30));
+    Fold = _mm_xor_si128(Fold, _mm_slli_epi32(Low, 25));
+    Spill = _mm_srli_si128(Fold, 4);
+    Fold = _mm_slli_si128(Fold, 12);
+    Low = _mm_xor_si128(Low, Fold);
+
+    //
+    // Perform the second phase of the reduction.
+    //
+
+    Fold = _mm_xor_si128(_mm_srli_epi32(Low, 1), _mm_srli_epi32(Low, 2));
+    Fold = _mm_xor_si128(Fold, _mm_srli_epi32(Low, 7));
+    Fold = _mm_xor_si128(Fold, Spill);
+    Low = _mm_xor_si128(Low, Fold);
+    return _mm_xor_si128(High, Low);
+}
+
+#endif
+
@@ -36,12 +36,16 @@ function build() {
 
     sources = [
         "aes.c",
+        "aesni.c",
         "fortuna.c",
+        "gcm.c",
         "hmac.c",
         "md5.c",
         "sha1.c",
         "sha256.c",
-        "sha512.c"
+        "sha512.c",
+        "shaarm.c",
+        "shani.c"
     ];
 
     lib = {
@@ -47,6 +47,32 @@ Module Name:
 #define BIG_INTEGER_P_OFFSET 1
 #define BIG_INTEGER_Q_OFFSET 2
 
+//
+// Define whether the x86 AES, carry-less multiply, SHA, and AVX2 instruction
+// backends are compiled in. They need the compiler to be allowed to touch the
+// vector registers, which rules out the kernel flavor of the library since
+// the kernel does not save FPU state around its own code.
+//
+
+#if (defined(__i386__) || defined(__x86_64__)) && defined(__SSE2__)
+
+#define CY_AES_NI 1
+#define CY_SHA_NI 1
+
+#endif
+
+//
+// Define whether the ARMv8 SHA instructions are compiled in. There is no way
+// to query for them from user mode, so they are used only when the compiler
+// has been told the target processor has them.
+//
+
+#if defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_SHA2)
+
+#define CY_ARM_SHA 1
+
+#endif
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -55,10 +81,573 @@ Module Name:
 // -------------------------------------------------------------------- Globals
 //
 
+extern const ULONG CySha1KConstants[4];
+extern const ULONG CySha256KConstants[64];
+
 //
 // -------------------------------------------------------- Function Prototypes
 //
 
+//
+// AES functions
+//
+
+VOID
+CypAesCtrCrypt (
+    PAES_CONTEXT Context,
+    PUCHAR Counter,
+    PUCHAR Input,
+    PUCHAR Output,
+    UINTN Length,
+    BOOL Increment32
+    );
+
+/*++
+
+Routine Description:
+
+    This routine runs AES in counter mode over a buffer. Since every counter
+    block is independent, several blocks are encrypted at once.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context.
+
+    Counter - Supplies a pointer to the big-endian counter block. On output,
+        this will contain the counter value following the last block used.
+
+    Input - Supplies a pointer to the input buffer.
+
+    Output - Supplies a pointer where the output will be returned. This may be
+        the same as the input buffer.
+
+    Length - Supplies the length of the input and output buffers, in bytes.
+        This must be a multiple of 16 bytes.
+
+    Increment32 - Supplies a boolean indicating whether only the low 32 bits
+        of the counter should be incremented (as GCM requires) or whether the
+        whole block is one 128-bit counter.
+
+Return Value:
+
+    None.
+
+--*/
+
+#ifdef CY_AES_NI
+
+BOOL
+CypAesNiIsSupported (
+    VOID
+    );
+
+/*++
+
+Routine Description:
+
+    This routine determines whether the processor supports the AES
+    instructions.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    TRUE if the AES-NI backend can be used.
+
+    FALSE if the portable implementation must be used.
+
+--*/
+
+BOOL
+CypAesNiIsClmulSupported (
+    VOID
+    );
+
+/*++
+
+Routine Description:
+
+    This routine determines whether the processor supports the carry-less
+    multiply instruction used to accelerate GHASH.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    TRUE if the carry-less multiply GHASH routine can be used.
+
+    FALSE if the portable GHASH must be used.
+
+--*/
+
+VOID
+CypAesNiEcbEncrypt (
+    PAES_CONTEXT Context,
+    PUCHAR Plaintext,
+    PUCHAR Ciphertext,
+    UINTN Length
+    );
+
+/*++
+
+Routine Description:
+
+    This routine encrypts blocks in codebook mode using the AES instructions,
+    eight blocks at a time.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context.
+
+    Plaintext - Supplies a pointer to the plaintext buffer.
+
+    Ciphertext - Supplies a pointer where the ciphertext will be returned.
+
+    Length - Supplies the length of the buffers in bytes. This must be a
+        multiple of 16 bytes.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+CypAesNiEcbDecrypt (
+    PAES_CONTEXT Context,
+    PUCHAR Ciphertext,
+    PUCHAR Plaintext,
+    UINTN Length
+    );
+
+/*++
+
+Routine Description:
+
+    This routine decrypts blocks in codebook mode using the AES instructions,
+    eight blocks at a time. The keys must have been converted for decryption.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context.
+
+    Ciphertext - Supplies a pointer to the ciphertext buffer.
+
+    Plaintext - Supplies a pointer where the plaintext will be returned.
+
+    Length - Supplies the length of the buffers in bytes. This must be a
+        multiple of 16 bytes.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+CypAesNiCbcEncrypt (
+    PAES_CONTEXT Context,
+    PUCHAR Plaintext,
+    PUCHAR Ciphertext,
+    UINTN Length
+    );
+
+/*++
+
+Routine Description:
+
+    This routine encrypts blocks in CBC mode using the AES instructions,
+    updating the initialization vector in the context.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context.
+
+    Plaintext - Supplies a pointer to the plaintext buffer.
+
+    Ciphertext - Supplies a pointer where the ciphertext will be returned.
+
+    Length - Supplies the length of the buffers in bytes. This must be a
+        multiple of 16 bytes.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+CypAesNiCbcDecrypt (
+    PAES_CONTEXT Context,
+    PUCHAR Ciphertext,
+    PUCHAR Plaintext,
+    UINTN Length
+    );
+
+/*++
+
+Routine Description:
+
+    This routine decrypts blocks in CBC mode using the AES instructions, eight
+    blocks at a time. The keys must have been converted for decryption.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context.
+
+    Ciphertext - Supplies a pointer to the ciphertext buffer.
+
+    Plaintext - Supplies a pointer where the plaintext will be returned.
+
+    Length - Supplies the length of the buffers in bytes. This must be a
+        multiple of 16 bytes.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+CypAesNiCtrCrypt (
+    PAES_CONTEXT Context,
+    PUCHAR Counter,
+    PUCHAR Input,
+    PUCHAR Output,
+    UINTN Length,
+    BOOL Increment32
+    );
+
+/*++
+
+Routine Description:
+
+    This routine runs AES in counter mode using the AES instructions, eight
+    blocks at a time.
+
+Arguments:
+
+    Context - Supplies a pointer to the AES context.
+
+    Counter - Supplies a pointer to the big-endian counter block, which is
+        advanced past the blocks used.
+
+    Input - Supplies a pointer to the input buffer.
+
+    Output - Supplies a pointer where the output will be returned.
+
+    Length - Supplies the length of the buffers in bytes. This must be a
+        multiple of 16 bytes.
+
+    Increment32 - Supplies a boolean indicating whether only the low 32 bits
+        of the counter are incremented.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+CypAesNiGhash (
+    PUCHAR HashKey,
+    PUCHAR State,
+    PUCHAR Data,
+    UINTN Length
+    );
+
+/*++
+
+Routine Description:
+
+    This routine folds blocks of data into a GHASH state using the carry-less
+    multiply instruction, four blocks per reduction.
+
+Arguments:
+
+    HashKey - Supplies a pointer to the 16-byte GHASH key.
+
+    State - Supplies a pointer to the 16-byte running GHASH value, which is
+        updated in place.
+
+    Data - Supplies a pointer to the data to hash.
+
+    Length - Supplies the length of the data in bytes. This must be a multiple
+        of 16 bytes.
+
+Return Value:
+
+    None.
+
+--*/
+
+#endif
+
+//
+// SHA functions
+//
+
+VOID
+CypSha1ProcessBlocks (
+    PULONG State,
+    PUCHAR Data,
+    UINTN BlockCount
+    );
+
+/*++
+
+Routine Description:
+
+    This routine folds whole 64-byte message blocks into a SHA-1 digest,
+    using hardware support if the processor has it.
+
+Arguments:
+
+    State - Supplies a pointer to the five word intermediate hash.
+
+    Data - Supplies a pointer to the message blocks.
+
+    BlockCount - Supplies the number of 64-byte blocks to process.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+CypSha256ProcessBlocks (
+    PULONG State,
+    PUCHAR Data,
+    UINTN BlockCount
+    );
+
+/*++
+
+Routine Description:
+
+    This routine folds whole 64-byte message blocks into a SHA-256 digest,
+    using hardware support if the processor has it.
+
+Arguments:
+
+    State - Supplies a pointer to the eight word intermediate hash.
+
+    Data - Supplies a pointer to the message blocks.
+
+    BlockCount - Supplies the number of 64-byte blocks to process.
+
+Return Value:
+
+    None.
+
+--*/
+
+#ifdef CY_SHA_NI
+
+BOOL
+CypShaNiIsSupported (
+    VOID
+    );
+
+/*++
+
+Routine Description:
+
+    This routine determines whether the processor supports the SHA
+    extensions.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    TRUE if the SHA-NI routines can be used.
+
+    FALSE if the processor lacks the instructions.
+
+--*/
+
+BOOL
+CypShaNiIsAvx2Supported (
+    VOID
+    );
+
+/*++
+
+Routine Description:
+
+    This routine determines whether the processor and operating system
+    support the 256-bit AVX2 integer instructions.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    TRUE if the AVX2 multi-buffer routines can be used.
+
+    FALSE if the processor lacks the instructions or the operating system does
+    not preserve the wide registers.
+
+--*/
+
+VOID
+CypShaNiSha1ProcessBlocks (
+    PULONG State,
+    PUCHAR Data,
+    UINTN BlockCount
+    );
+
+/*++
+
+Routine Description:
+
+    This routine folds whole message blocks into a SHA-1 digest using the
+    SHA extensions.
+
+Arguments:
+
+    State - Supplies a pointer to the five word intermediate hash.
+
+    Data - Supplies a pointer to the message blocks.
+
+    BlockCount - Supplies the number of 64-byte blocks to process.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+CypShaNiSha256ProcessBlocks (
+    PULONG State,
+    PUCHAR Data,
+    UINTN BlockCount
+    );
+
+/*++
+
+Routine Description:
+
+    This routine folds whole message blocks into a SHA-256 digest using the
+    SHA extensions.
+
+Arguments:
+
+    State - Supplies a pointer to the eight word intermediate hash.
+
+    Data - Supplies a pointer to the message blocks.
+
+    BlockCount - Supplies the number of 64-byte blocks to process.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+CypShaNiSha256HashMultiple (
+    PVOID *Messages,
+    PUINTN Lengths,
+    UINTN Count,
+    PUCHAR Hashes
+    );
+
+/*++
+
+Routine Description:
+
+    This routine computes the SHA-256 hashes of several independent messages
+    at once, running eight of them in the lanes of the AVX2 registers.
+
+Arguments:
+
+    Messages - Supplies an array of pointers to the messages to hash.
+
+    Lengths - Supplies an array of message lengths in bytes.
+
+    Count - Supplies the number of messages.
+
+    Hashes - Supplies a pointer where the hashes will be returned, one after
+        another.
+
+Return Value:
+
+    None.
+
+--*/
+
+#endif
+
+#ifdef CY_ARM_SHA
+
+VOID
+CypArmSha1ProcessBlocks (
+    PULONG State,
+    PUCHAR Data,
+    UINTN BlockCount
+    );
+
+/*++
+
+Routine Description:
+
+    This routine folds whole message blocks into a SHA-1 digest using the
+    ARMv8 cryptography extensions.
+
+Arguments:
+
+    State - Supplies a pointer to the five word intermediate hash.
+
+    Data - Supplies a pointer to the message blocks.
+
+    BlockCount - Supplies the number of 64-byte blocks to process.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+CypArmSha256ProcessBlocks (
+    PULONG State,
+    PUCHAR Data,
+    UINTN BlockCount
+    );
+
+/*++
+
+Routine Description:
+
+    This routine folds whole message blocks into a SHA-256 digest using the
+    ARMv8 cryptography extensions.
+
+Arguments:
+
+    State - Supplies a pointer to the eight word intermediate hash.
+
+    Data - Supplies a pointer to the message blocks.
+
+    BlockCount - Supplies the number of 64-byte blocks to process.
+
+Return Value:
+
+    None.
+
+--*/
+
+#endif
+
 //
 // Big integer functions
 //
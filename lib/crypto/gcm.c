@@ -0,0 +1,908 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    gcm.c
+
+Abstract:
+
+    This module implements AES Galois/Counter Mode (GCM) authenticated
+    encryption, as described in NIST SP 800-38D.
+
+Author:
+
+    agent 19-Oct-2026
+
+Environment:
+
+    Any
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include "cryptop.h"
+
+//
+// --------------------------------------------------------------------- Macros
+//
+
+//
+// This macro reads a big-endian 64-bit value from a byte buffer.
+//
+
+#define GCM_READ64(_Bytes)                                                   \
+    (((ULONGLONG)(_Bytes)[0] << 56) | ((ULONGLONG)(_Bytes)[1] << 48) |       \
+     ((ULONGLONG)(_Bytes)[2] << 40) | ((ULONGLONG)(_Bytes)[3] << 32) |       \
+     ((ULONGLONG)(_Bytes)[4] << 24) | ((ULONGLONG)(_Bytes)[5] << 16) |       \
+     ((ULONGLONG)(_Bytes)[6] << 8) | (ULONGLONG)(_Bytes)[7])
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+VOID
+CypGcmStart (
+    PAES_GCM_CONTEXT Context,
+    PUCHAR InitializationVector,
+    UINTN InitializationVectorLength,
+    PUCHAR AdditionalData,
+    UINTN AdditionalDataLength,
+    PUCHAR PreCounter,
+    PUCHAR Hash
+    );
+
+VOID
+CypGcmCrypt (
+    PAES_GCM_CONTEXT Context,
+    PUCHAR Counter,
+    PUCHAR Input,
+    PUCHAR Output,
+    UINTN Length
+    );
+
+VOID
+CypGcmFinish (
+    PAES_GCM_CONTEXT Context,
+    PUCHAR PreCounter,
+    PUCHAR Hash,
+    UINTN AdditionalDataLength,
+    UINTN Length
+    );
+
+VOID
+CypGcmHash (
+    PAES_GCM_CONTEXT Context,
+    PUCHAR Hash,
+    PUCHAR Data,
+    UINTN Length
+    );
+
+VOID
+CypGcmHashBlocks (
+    PUCHAR HashKey,
+    PUCHAR Hash,
+    PUCHAR Data,
+    UINTN Length
+    );
+
+VOID
+CypGcmWrite64 (
+    PUCHAR Bytes,
+    ULONGLONG Value
+    );
+
+ULONGLONG
+CypGcmMultiply64 (
+    ULONGLONG Value1,
+    ULONGLONG Value2
+    );
+
+ULONGLONG
+CypGcmReverse64 (
+    ULONGLONG Value
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+CRYPTO_API
+VOID
+CyAesGcmInitialize (
+    PAES_GCM_CONTEXT Context,
+    AES_CIPHER_MODE Mode,
+    PUCHAR Key
+    )
+
+/*++
+
+Routine Description:
+
+    This routine initializes an AES Galois/Counter Mode context, expanding the
+    key and deriving the GHASH key.
+
+Arguments:
+
+    Context - Supplies a pointer to the GCM context.
+
+    Mode - Supplies the mode of AES to use. This must be either AesModeGcm128
+        or AesModeGcm256.
+
+    Key - Supplies the encryption/decryption key to use.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ASSERT((Mode == AesModeGcm128) || (Mode == AesModeGcm256));
+
+    CyAesInitialize(&(Context->AesContext), Mode, Key, NULL);
+    RtlZeroMemory(Context->HashKey, AES_BLOCK_SIZE);
+    CyAesEcbEncrypt(&(Context->AesContext),
+                    Context->HashKey,
+                    Context->HashKey,
+                    AES_BLOCK_SIZE);
+
+    return;
+}
+
+CRYPTO_API
+VOID
+CyAesGcmEncrypt (
+    PAES_GCM_CONTEXT Context,
+    PUCHAR InitializationVector,
+    UINTN InitializationVectorLength,
+    PUCHAR AdditionalData,
+    UINTN AdditionalDataLength,
+    PUCHAR Plaintext,
+    PUCHAR Ciphertext,
+    UINTN Length,
+    PUCHAR Tag,
+    UINTN TagLength
+    )
+
+/*++
+
+Routine Description:
+
+    This routine encrypts and authenticates a message using AES Galois/Counter
+    Mode.
+
+Arguments:
+
+    Context - Supplies a pointer to the GCM context.
+
+    InitializationVector - Supplies a pointer to the initialization vector,
+        which must never be reused with the same key.
+
+    InitializationVectorLength - Supplies the length of the initialization
+        vector in bytes. 12 bytes is the recommended (and fastest) size.
+
+    AdditionalData - Supplies an optional pointer to additional data that is
+        authenticated but not encrypted.
+
+    AdditionalDataLength - Supplies the length of the additional data in bytes.
+
+    Plaintext - Supplies a pointer to the plaintext buffer.
+
+    Ciphertext - Supplies a pointer where the ciphertext will be returned.
+        This may be the same as the plaintext buffer.
+
+    Length - Supplies the length of the plaintext and ciphertext buffers, in
+        bytes. This does not need to be a multiple of the block size.
+
+    Tag - Supplies a pointer where the authentication tag will be returned.
+
+    TagLength - Supplies the number of tag bytes to return, up to 16.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UCHAR Counter[AES_BLOCK_SIZE];
+    UCHAR Hash[AES_BLOCK_SIZE];
+    UCHAR PreCounter[AES_BLOCK_SIZE];
+
+    ASSERT(TagLength <= AES_GCM_TAG_SIZE);
+
+    CypGcmStart(Context,
+                InitializationVector,
+                InitializationVectorLength,
+                AdditionalData,
+                AdditionalDataLength,
+                PreCounter,
+                Hash);
+
+    RtlCopyMemory(Counter, PreCounter, AES_BLOCK_SIZE);
+    CypGcmCrypt(Context, Counter, Plaintext, Ciphertext, Length);
+    CypGcmHash(Context, Hash, Ciphertext, Length);
+    CypGcmFinish(Context, PreCounter, Hash, AdditionalDataLength, Length);
+    if (TagLength > AES_GCM_TAG_SIZE) {
+        TagLength = AES_GCM_TAG_SIZE;
+    }
+
+    RtlCopyMemory(Tag, Hash, TagLength);
+    return;
+}
+
+CRYPTO_API
+KSTATUS
+CyAesGcmDecrypt (
+    PAES_GCM_CONTEXT Context,
+    PUCHAR InitializationVector,
+    UINTN InitializationVectorLength,
+    PUCHAR AdditionalData,
+    UINTN AdditionalDataLength,
+    PUCHAR Ciphertext,
+    PUCHAR Plaintext,
+    UINTN Length,
+    PUCHAR Tag,
+    UINTN TagLength
+    )
+
+/*++
+
+Routine Description:
+
+    This routine verifies and decrypts a message using AES Galois/Counter Mode.
+
+Arguments:
+
+    Context - Supplies a pointer to the GCM context.
+
+    InitializationVector - Supplies a pointer to the initialization vector
+        used to encrypt the message.
+
+    InitializationVectorLength - Supplies the length of the initialization
+        vector in bytes.
+
+    AdditionalData - Supplies an optional pointer to the additional
+        authenticated data.
+
+    AdditionalDataLength - Supplies the length of the additional data in bytes.
+
+    Ciphertext - Supplies a pointer to the ciphertext buffer.
+
+    Plaintext - Supplies a pointer where the plaintext will be returned. This
+        may be the same as the ciphertext buffer.
+
+    Length - Supplies the length of the plaintext and ciphertext buffers, in
+        bytes.
+
+    Tag - Supplies a pointer to the authentication tag to verify.
+
+    TagLength - Supplies the length of the tag in bytes, up to 16.
+
+Return Value:
+
+    STATUS_SUCCESS if the tag is valid.
+
+    STATUS_CHECKSUM_MISMATCH if the message failed authentication. The
+    plaintext buffer is zeroed in this case.
+
+--*/
+
+{
+
+    UCHAR Counter[AES_BLOCK_SIZE];
+    UCHAR Difference;
+    UCHAR Hash[AES_BLOCK_SIZE];
+    UINTN Index;
+    UCHAR PreCounter[AES_BLOCK_SIZE];
+
+    if ((TagLength == 0) || (TagLength > AES_GCM_TAG_SIZE)) {
+        return STATUS_CHECKSUM_MISMATCH;
+    }
+
+    //
+    // Hash the ciphertext before decrypting, since decryption may happen in
+    // place.
+    //
+
+    CypGcmStart(Context,
+                InitializationVector,
+                InitializationVectorLength,
+                AdditionalData,
+                AdditionalDataLength,
+                PreCounter,
+                Hash);
+
+    CypGcmHash(Context, Hash, Ciphertext, Length);
+    CypGcmFinish(Context, PreCounter, Hash, AdditionalDataLength, Length);
+
+    //
+    // Compare the tags without exiting early, so that the comparison time
+    // does not reveal how much of a forged tag was correct.
+    //
+
+    Difference = 0;
+    for (Index = 0; Index < TagLength; Index += 1) {
+        Difference |= Hash[Index] ^ Tag[Index];
+    }
+
+    if (Difference != 0) {
+        RtlZeroMemory(Plaintext, Length);
+        return STATUS_CHECKSUM_MISMATCH;
+    }
+
+    RtlCopyMemory(Counter, PreCounter, AES_BLOCK_SIZE);
+    CypGcmCrypt(Context, Counter, Ciphertext, Plaintext, Length);
+    return STATUS_SUCCESS;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+VOID
+CypGcmStart (
+    PAES_GCM_CONTEXT Context,
+    PUCHAR InitializationVector,
+    UINTN InitializationVectorLength,
+    PUCHAR AdditionalData,
+    UINTN AdditionalDataLength,
+    PUCHAR PreCounter,
+    PUCHAR Hash
+    )
+
+/*++
+
+Routine Description:
+
+    This routine derives the pre-counter block from the initialization vector
+    and hashes the additional authenticated data.
+
+Arguments:
+
+    Context - Supplies a pointer to the GCM context.
+
+    InitializationVector - Supplies a pointer to the initialization vector.
+
+    InitializationVectorLength - Supplies the length of the initialization
+        vector in bytes.
+
+    AdditionalData - Supplies an optional pointer to the additional data.
+
+    AdditionalDataLength - Supplies the length of the additional data.
+
+    PreCounter - Supplies a pointer where the 16-byte pre-counter block (J0)
+        will be returned.
+
+    Hash - Supplies a pointer where the GHASH state will be returned.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UCHAR LengthBlock[AES_BLOCK_SIZE];
+
+    if (InitializationVectorLength == AES_GCM_INITIALIZATION_VECTOR_SIZE) {
+        RtlCopyMemory(PreCounter,
+                      InitializationVector,
+                      AES_GCM_INITIALIZATION_VECTOR_SIZE);
+
+        PreCounter[12] = 0;
+        PreCounter[13] = 0;
+        PreCounter[14] = 0;
+        PreCounter[15] = 1;
+
+    } else {
+        RtlZeroMemory(PreCounter, AES_BLOCK_SIZE);
+        CypGcmHash(Context,
+                   PreCounter,
+                   InitializationVector,
+                   InitializationVectorLength);
+
+        RtlZeroMemory(LengthBlock, AES_BLOCK_SIZE);
+        CypGcmWrite64(LengthBlock + sizeof(ULONGLONG),
+                      (ULONGLONG)InitializationVectorLength * BITS_PER_BYTE);
+
+        CypGcmHashBlocks(Context->HashKey,
+                         PreCounter,
+                         LengthBlock,
+                         AES_BLOCK_SIZE);
+    }
+
+    RtlZeroMemory(Hash, AES_BLOCK_SIZE);
+    if (AdditionalDataLength != 0) {
+        CypGcmHash(Context, Hash, AdditionalData, AdditionalDataLength);
+    }
+
+    return;
+}
+
+VOID
+CypGcmCrypt (
+    PAES_GCM_CONTEXT Context,
+    PUCHAR Counter,
+    PUCHAR Input,
+    PUCHAR Output,
+    UINTN Length
+    )
+
+/*++
+
+Routine Description:
+
+    This routine runs the GCM counter over a buffer of arbitrary length,
+    starting at the block after the given one.
+
+Arguments:
+
+    Context - Supplies a pointer to the GCM context.
+
+    Counter - Supplies a pointer to the counter block, initially holding the
+        pre-counter block. It is advanced as blocks are used.
+
+    Input - Supplies a pointer to the input buffer.
+
+    Output - Supplies a pointer to the output buffer.
+
+    Length - Supplies the length of the buffers in bytes.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UCHAR Block[AES_BLOCK_SIZE];
+    UINTN WholeLength;
+
+    //
+    // The first counter block is reserved for encrypting the tag.
+    //
+
+    Counter[15] += 1;
+    if (Counter[15] == 0) {
+        Counter[14] += 1;
+        if (Counter[14] == 0) {
+            Counter[13] += 1;
+            if (Counter[13] == 0) {
+                Counter[12] += 1;
+            }
+        }
+    }
+
+    WholeLength = Length & ~(AES_BLOCK_SIZE - 1);
+    if (WholeLength != 0) {
+        CypAesCtrCrypt(&(Context->AesContext),
+                       Counter,
+                       Input,
+                       Output,
+                       WholeLength,
+                       TRUE);
+    }
+
+    //
+    // Handle a trailing partial block by running a padded copy of it through
+    // the counter.
+    //
+
+    if (WholeLength != Length) {
+        RtlZeroMemory(Block, AES_BLOCK_SIZE);
+        RtlCopyMemory(Block, Input + WholeLength, Length - WholeLength);
+        CypAesCtrCrypt(&(Context->AesContext),
+                       Counter,
+                       Block,
+                       Block,
+                       AES_BLOCK_SIZE,
+                       TRUE);
+
+        RtlCopyMemory(Output + WholeLength, Block, Length - WholeLength);
+    }
+
+    return;
+}
+
+VOID
+CypGcmFinish (
+    PAES_GCM_CONTEXT Context,
+    PUCHAR PreCounter,
+    PUCHAR Hash,
+    UINTN AdditionalDataLength,
+    UINTN Length
+    )
+
+/*++
+
+Routine Description:
+
+    This routine hashes the length block and encrypts the result with the
+    pre-counter block to form the tag.
+
+Arguments:
+
+    Context - Supplies a pointer to the GCM context.
+
+    PreCounter - Supplies a pointer to the pre-counter block.
+
+    Hash - Supplies a pointer to the GHASH state. On output, contains the
+        full 16-byte tag.
+
+    AdditionalDataLength - Supplies the length of the additional data in bytes.
+
+    Length - Supplies the length of the ciphertext in bytes.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UCHAR Block[AES_BLOCK_SIZE];
+    UINTN Index;
+
+    CypGcmWrite64(Block, (ULONGLONG)AdditionalDataLength * BITS_PER_BYTE);
+    CypGcmWrite64(Block + sizeof(ULONGLONG),
+                  (ULONGLONG)Length * BITS_PER_BYTE);
+
+    CypGcmHashBlocks(Context->HashKey, Hash, Block, AES_BLOCK_SIZE);
+    CyAesEcbEncrypt(&(Context->AesContext),
+                    PreCounter,
+                    Block,
+                    AES_BLOCK_SIZE);
+
+    for (Index = 0; Index < AES_BLOCK_SIZE; Index += 1) {
+        Hash[Index] ^= Block[Index];
+    }
+
+    return;
+}
+
+VOID
+CypGcmHash (
+    PAES_GCM_CONTEXT Context,
+    PUCHAR Hash,
+    PUCHAR Data,
+    UINTN Length
+    )
+
+/*++
+
+Routine Description:
+
+    This routine folds a buffer of arbitrary length into the GHASH state,
+    padding the last block with zeros.
+
+Arguments:
+
+    Context - Supplies a pointer to the GCM context.
+
+    Hash - Supplies a pointer to the GHASH state.
+
+    Data - Supplies a pointer to the data to hash.
+
+    Length - Supplies the length of the data in bytes.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UCHAR Block[AES_BLOCK_SIZE];
+    UINTN WholeLength;
+
+    WholeLength = Length & ~(AES_BLOCK_SIZE - 1);
+    if (WholeLength != 0) {
+        CypGcmHashBlocks(Context->HashKey, Hash, Data, WholeLength);
+    }
+
+    if (WholeLength != Length) {
+        RtlZeroMemory(Block, AES_BLOCK_SIZE);
+        RtlCopyMemory(Block, Data + WholeLength, Length - WholeLength);
+        CypGcmHashBlocks(Context->HashKey, Hash, Block, AES_BLOCK_SIZE);
+    }
+
+    return;
+}
+
+VOID
+CypGcmHashBlocks (
+    PUCHAR HashKey,
+    PUCHAR Hash,
+    PUCHAR Data,
+    UINTN Length
+    )
+
+/*++
+
+Routine Description:
+
+    This routine folds whole blocks into the GHASH state, computing
+    Hash = (Hash + Block) * HashKey in GF(2^128) for each block. The portable
+    version uses integer multiplies with the bits spread apart so that carries
+    cannot disturb the result, avoiding any data dependent table lookups.
+
+Arguments:
+
+    HashKey - Supplies a pointer to the GHASH key.
+
+    Hash - Supplies a pointer to the GHASH state.
+
+    Data - Supplies a pointer to the data to hash.
+
+    Length - Supplies the length of the data in bytes. This must be a multiple
+        of 16 bytes.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONGLONG Key0;
+    ULONGLONG Key0Reversed;
+    ULONGLONG Key1;
+    ULONGLONG Key1Reversed;
+    ULONGLONG Key2;
+    ULONGLONG Key2Reversed;
+    ULONGLONG Value0;
+    ULONGLONG Value1;
+    ULONGLONG Value2;
+    ULONGLONG Value3;
+    ULONGLONG Y0;
+    ULONGLONG Y0Reversed;
+    ULONGLONG Y1;
+    ULONGLONG Y1Reversed;
+    ULONGLONG Y2;
+    ULONGLONG Y2Reversed;
+    ULONGLONG Z0;
+    ULONGLONG Z0High;
+    ULONGLONG Z1;
+    ULONGLONG Z1High;
+    ULONGLONG Z2;
+    ULONGLONG Z2High;
+
+    ASSERT((Length % AES_BLOCK_SIZE) == 0);
+
+#ifdef CY_AES_NI
+
+    if (CypAesNiIsClmulSupported() != FALSE) {
+        CypAesNiGhash(HashKey, Hash, Data, Length);
+        return;
+    }
+
+#endif
+
+    //
+    // The 1 suffix is the high (first) half of each block.
+    //
+
+    Key1 = GCM_READ64(HashKey);
+    Key0 = GCM_READ64(HashKey + sizeof(ULONGLONG));
+    Key0Reversed = CypGcmReverse64(Key0);
+    Key1Reversed = CypGcmReverse64(Key1);
+    Key2 = Key0 ^ Key1;
+    Key2Reversed = Key0Reversed ^ Key1Reversed;
+    Y1 = GCM_READ64(Hash);
+    Y0 = GCM_READ64(Hash + sizeof(ULONGLONG));
+    while (Length != 0) {
+        Y1 ^= GCM_READ64(Data);
+        Y0 ^= GCM_READ64(Data + sizeof(ULONGLONG));
+        Data += AES_BLOCK_SIZE;
+        Length -= AES_BLOCK_SIZE;
+
+        //
+        // Compute the 256-bit carry-less product using Karatsuba. The low
+        // halves of each 64x64 product come directly, and the high halves come
+        // from multiplying the bit reversed operands.
+        //
+
+        Y0Reversed = CypGcmReverse64(Y0);
+        Y1Reversed = CypGcmReverse64(Y1);
+        Y2 = Y0 ^ Y1;
+        Y2Reversed = Y0Reversed ^ Y1Reversed;
+        Z0 = CypGcmMultiply64(Y0, Key0);
+        Z1 = CypGcmMultiply64(Y1, Key1);
+        Z2 = CypGcmMultiply64(Y2, Key2);
+        Z0High = CypGcmMultiply64(Y0Reversed, Key0Reversed);
+        Z1High = CypGcmMultiply64(Y1Reversed, Key1Reversed);
+        Z2High = CypGcmMultiply64(Y2Reversed, Key2Reversed);
+        Z2 ^= Z0 ^ Z1;
+        Z2High ^= Z0High ^ Z1High;
+        Z0High = CypGcmReverse64(Z0High) >> 1;
+        Z1High = CypGcmReverse64(Z1High) >> 1;
+        Z2High = CypGcmReverse64(Z2High) >> 1;
+        Value0 = Z0;
+        Value1 = Z0High ^ Z2;
+        Value2 = Z1 ^ Z2High;
+        Value3 = Z1High;
+
+        //
+        // The operands are bit reflected, so shift the product left by one
+        // and then reduce modulo x^128 + x^7 + x^2 + x + 1.
+        //
+
+        Value3 = (Value3 << 1) | (Value2 >> 63);
+        Value2 = (Value2 << 1) | (Value1 >> 63);
+        Value1 = (Value1 << 1) | (Value0 >> 63);
+        Value0 = (Value0 << 1);
+        Value2 ^= Value0 ^ (Value0 >> 1) ^ (Value0 >> 2) ^ (Value0 >> 7);
+        Value1 ^= (Value0 << 63) ^ (Value0 << 62) ^ (Value0 << 57);
+        Value3 ^= Value1 ^ (Value1 >> 1) ^ (Value1 >> 2) ^ (Value1 >> 7);
+        Value2 ^= (Value1 << 63) ^ (Value1 << 62) ^ (Value1 << 57);
+        Y0 = Value2;
+        Y1 = Value3;
+    }
+
+    CypGcmWrite64(Hash, Y1);
+    CypGcmWrite64(Hash + sizeof(ULONGLONG), Y0);
+    return;
+}
+
+VOID
+CypGcmWrite64 (
+    PUCHAR Bytes,
+    ULONGLONG Value
+    )
+
+/*++
+
+Routine Description:
+
+    This routine writes a 64-bit value in big-endian byte order.
+
+Arguments:
+
+    Bytes - Supplies a pointer where the value will be written.
+
+    Value - Supplies the value to write.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    INT Index;
+
+    for (Index = sizeof(ULONGLONG) - 1; Index >= 0; Index -= 1) {
+        Bytes[Index] = (UCHAR)Value;
+        Value >>= BITS_PER_BYTE;
+    }
+
+    return;
+}
+
+ULONGLONG
+CypGcmMultiply64 (
+    ULONGLONG Value1,
+    ULONGLONG Value2
+    )
+
+/*++
+
+Routine Description:
+
+    This routine computes the low 64 bits of the carry-less product of two
+    64-bit values. Each operand is split into four parts holding every fourth
+    bit, leaving holes wide enough that the carries of an ordinary integer
+    multiply never reach a bit that is kept.
+
+Arguments:
+
+    Value1 - Supplies the first value.
+
+    Value2 - Supplies the second value.
+
+Return Value:
+
+    Returns the low 64 bits of the carry-less product.
+
+--*/
+
+{
+
+    ULONGLONG X0;
+    ULONGLONG X1;
+    ULONGLONG X2;
+    ULONGLONG X3;
+    ULONGLONG Y0;
+    ULONGLONG Y1;
+    ULONGLONG Y2;
+    ULONGLONG Y3;
+    ULONGLONG Z0;
+    ULONGLONG Z1;
+    ULONGLONG Z2;
+    ULONGLONG Z3;
+
+    X0 = Value1 & 0x1111111111111111ULL;
+    X1 = Value1 & 0x2222222222222222ULL;
+    X2 = Value1 & 0x4444444444444444ULL;
+    X3 = Value1 & 0x8888888888888888ULL;
+    Y0 = Value2 & 0x1111111111111111ULL;
+    Y1 = Value2 & 0x2222222222222222ULL;
+    Y2 = Value2 & 0x4444444444444444ULL;
+    Y3 = Value2 & 0x8888888888888888ULL;
+    Z0 = (X0 * Y0) ^ (X1 * Y3) ^ (X2 * Y2) ^ (X3 * Y1);
+    Z1 = (X0 * Y1) ^ (X1 * Y0) ^ (X2 * Y3) ^ (X3 * Y2);
+    Z2 = (X0 * Y2) ^ (X1 * Y1) ^ (X2 * Y0) ^ (X3 * Y3);
+    Z3 = (X0 * Y3) ^ (X1 * Y2) ^ (X2 * Y1) ^ (X3 * Y0);
+    Z0 &= 0x1111111111111111ULL;
+    Z1 &= 0x2222222222222222ULL;
+    Z2 &= 0x4444444444444444ULL;
+    Z3 &= 0x8888888888888888ULL;
+    return Z0 | Z1 | Z2 | Z3;
+}
+
+ULONGLONG
+CypGcmReverse64 (
+    ULONGLONG Value
+    )
+
+/*++
+
+Routine Description:
+
+    This routine reverses the order of the bits in a 64-bit value.
+
+Arguments:
+
+    Value - Supplies the value to reverse.
+
+Return Value:
+
+    Returns the bit reversed value.
+
+--*/
+
+{
+
+    Value = ((Value & 0x5555555555555555ULL) << 1) |
+            ((Value >> 1) & 0x5555555555555555ULL);
+
+    Value = ((Value & 0x3333333333333333ULL) << 2) |
+            ((Value >> 2) & 0x3333333333333333ULL);
+
+    Value = ((Value & 0x0F0F0F0F0F0F0F0FULL) << 4) |
+            ((Value >> 4) & 0x0F0F0F0F0F0F0F0FULL);
+
+    return RtlByteSwapUlonglong(Value);
+}
+
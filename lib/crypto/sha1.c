@@ -55,8 +55,9 @@ Module Name:
 //
 
 VOID
-CypSha1ProcessMessage (
-    PSHA1_CONTEXT Context
+CypSha1ProcessBlock (
+    PULONG State,
+    PUCHAR Data
     );
 
 VOID
@@ -144,16 +145,56 @@ Return Value:
 
 {
 
-    while (Length != 0) {
-        Context->MessageBlock[Context->BlockIndex] = *Message;
-        Context->BlockIndex += 1;
-        Context->Length += BITS_PER_BYTE;
+    UINTN BlockCount;
+    UINTN Size;
+
+    Context->Length += (ULONGLONG)Length * BITS_PER_BYTE;
+
+    //
+    // Top off a partially filled block first.
+    //
+
+    if (Context->BlockIndex != 0) {
+        Size = sizeof(Context->MessageBlock) - Context->BlockIndex;
+        if (Size > Length) {
+            Size = Length;
+        }
+
+        RtlCopyMemory(&(Context->MessageBlock[Context->BlockIndex]),
+                      Message,
+                      Size);
+
+        Context->BlockIndex += Size;
+        Message += Size;
+        Length -= Size;
         if (Context->BlockIndex == sizeof(Context->MessageBlock)) {
-            CypSha1ProcessMessage(Context);
+            CypSha1ProcessBlocks(Context->IntermediateHash,
+                                 Context->MessageBlock,
+                                 1);
+
+            Context->BlockIndex = 0;
         }
+    }
 
-        Message += 1;
-        Length -= 1;
+    //
+    // Hash whole blocks straight out of the caller's buffer.
+    //
+
+    BlockCount = Length / sizeof(Context->MessageBlock);
+    if (BlockCount != 0) {
+        CypSha1ProcessBlocks(Context->IntermediateHash, Message, BlockCount);
+        Size = BlockCount * sizeof(Context->MessageBlock);
+        Message += Size;
+        Length -= Size;
+    }
+
+    //
+    // Save whatever is left for next time.
+    //
+
+    if (Length != 0) {
+        RtlCopyMemory(Context->MessageBlock, Message, Length);
+        Context->BlockIndex = Length;
     }
 
     return;
@@ -205,26 +246,84 @@ Return Value:
     return;
 }
 
+VOID
+CypSha1ProcessBlocks (
+    PULONG State,
+    PUCHAR Data,
+    UINTN BlockCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine folds whole 64-byte message blocks into a SHA-1 digest,
+    using hardware support if the processor has it.
+
+Arguments:
+
+    State - Supplies a pointer to the five word intermediate hash.
+
+    Data - Supplies a pointer to the message blocks.
+
+    BlockCount - Supplies the number of 64-byte blocks to process.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+#ifdef CY_ARM_SHA
+
+    CypArmSha1ProcessBlocks(State, Data, BlockCount);
+
+#else
+
+#ifdef CY_SHA_NI
+
+    if (CypShaNiIsSupported() != FALSE) {
+        CypShaNiSha1ProcessBlocks(State, Data, BlockCount);
+        return;
+    }
+
+#endif
+
+    while (BlockCount != 0) {
+        CypSha1ProcessBlock(State, Data);
+        Data += SHA1_BLOCK_SIZE;
+        BlockCount -= 1;
+    }
+
+#endif
+
+    return;
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
 
 VOID
-CypSha1ProcessMessage (
-    PSHA1_CONTEXT Context
+CypSha1ProcessBlock (
+    PULONG State,
+    PUCHAR Data
     )
 
 /*++
 
 Routine Description:
 
-    This routine processes the 512 bits in the current message block and adds
-    them to the digest.
+    This routine processes a single 512-bit message block and adds it to the
+    digest.
 
 Arguments:
 
-    Context - Supplies a pointer to the initialized SHA-1 context with a full
-        message block.
+    State - Supplies a pointer to the five word intermediate hash.
+
+    Data - Supplies a pointer to the 64-byte message block.
 
 Return Value:
 
@@ -248,10 +347,10 @@ Return Value:
     //
 
     for (Index = 0; Index < 16; Index += 1) {
-        Block[Index] = ((ULONG)Context->MessageBlock[Index * 4] << 24) |
-                       ((ULONG)Context->MessageBlock[(Index * 4) + 1] << 16) |
-                       ((ULONG)Context->MessageBlock[(Index * 4) + 2] << 8) |
-                       (Context->MessageBlock[(Index * 4) + 3]);
+        Block[Index] = ((ULONG)Data[Index * 4] << 24) |
+                       ((ULONG)Data[(Index * 4) + 1] << 16) |
+                       ((ULONG)Data[(Index * 4) + 2] << 8) |
+                       (Data[(Index * 4) + 3]);
     }
 
     for (Index = 16; Index < 80; Index += 1) {
@@ -261,11 +360,11 @@ Return Value:
         Block[Index] = SHA1_ROTATE32(Value, 1);
     }
 
-    BlockA = Context->IntermediateHash[0];
-    BlockB = Context->IntermediateHash[1];
-    BlockC = Context->IntermediateHash[2];
-    BlockD = Context->IntermediateHash[3];
-    BlockE = Context->IntermediateHash[4];
+    BlockA = State[0];
+    BlockB = State[1];
+    BlockC = State[2];
+    BlockD = State[3];
+    BlockE = State[4];
     for (Index = 0; Index < 20; Index += 1) {
         Value = SHA1_ROTATE32(BlockA, 5) +
                 ((BlockB & BlockC) | ((~BlockB) & BlockD)) +
@@ -312,12 +411,11 @@ Return Value:
         BlockA = Value;
     }
 
-    Context->IntermediateHash[0] += BlockA;
-    Context->IntermediateHash[1] += BlockB;
-    Context->IntermediateHash[2] += BlockC;
-    Context->IntermediateHash[3] += BlockD;
-    Context->IntermediateHash[4] += BlockE;
-    Context->BlockIndex = 0;
+    State[0] += BlockA;
+    State[1] += BlockB;
+    State[2] += BlockC;
+    State[3] += BlockD;
+    State[4] += BlockE;
     return;
 }
 
@@ -361,7 +459,11 @@ Return Value:
             Context->BlockIndex += 1;
         }
 
-        CypSha1ProcessMessage(Context);
+        CypSha1ProcessBlocks(Context->IntermediateHash,
+                             Context->MessageBlock,
+                             1);
+
+        Context->BlockIndex = 0;
         while (Context->BlockIndex < 56) {
             Context->MessageBlock[Context->BlockIndex] = 0;
             Context->BlockIndex += 1;
@@ -388,7 +490,8 @@ Return Value:
     Context->MessageBlock[61] = (UCHAR)(Context->Length >> 16);
     Context->MessageBlock[62] = (UCHAR)(Context->Length >> 8);
     Context->MessageBlock[63] = (UCHAR)(Context->Length);
-    CypSha1ProcessMessage(Context);
+    CypSha1ProcessBlocks(Context->IntermediateHash, Context->MessageBlock, 1);
+    Context->BlockIndex = 0;
     return;
 }
 
@@ -81,8 +81,9 @@ Module Name:
 //
 
 VOID
-CypSha256ProcessMessage (
-    PSHA256_CONTEXT Context
+CypSha256ProcessBlock (
+    PULONG State,
+    PUCHAR Data
     );
 
 VOID
@@ -180,20 +181,59 @@ Return Value:
 
 {
 
+    UINTN BlockCount;
     PUCHAR Bytes;
+    UINTN Size;
 
     Bytes = Message;
-    while (Length != 0) {
-        Context->MessageBlock[Context->BlockIndex] = *Bytes;
-        Context->BlockIndex += 1;
+
+    //
+    // Top off a partially filled block first.
+    //
+
+    if (Context->BlockIndex != 0) {
+        Size = sizeof(Context->MessageBlock) - Context->BlockIndex;
+        if (Size > Length) {
+            Size = Length;
+        }
+
+        RtlCopyMemory(&(Context->MessageBlock[Context->BlockIndex]),
+                      Bytes,
+                      Size);
+
+        Context->BlockIndex += Size;
+        Bytes += Size;
+        Length -= Size;
         if (Context->BlockIndex == sizeof(Context->MessageBlock)) {
-            CypSha256ProcessMessage(Context);
+            CypSha256ProcessBlocks(Context->IntermediateHash,
+                                   Context->MessageBlock,
+                                   1);
+
             Context->Length += sizeof(Context->MessageBlock) * BITS_PER_BYTE;
             Context->BlockIndex = 0;
         }
+    }
 
-        Bytes += 1;
-        Length -= 1;
+    //
+    // Hash whole blocks straight out of the caller's buffer.
+    //
+
+    BlockCount = Length / sizeof(Context->MessageBlock);
+    if (BlockCount != 0) {
+        CypSha256ProcessBlocks(Context->IntermediateHash, Bytes, BlockCount);
+        Size = BlockCount * sizeof(Context->MessageBlock);
+        Context->Length += (ULONGLONG)Size * BITS_PER_BYTE;
+        Bytes += Size;
+        Length -= Size;
+    }
+
+    //
+    // Save whatever is left for next time.
+    //
+
+    if (Length != 0) {
+        RtlCopyMemory(Context->MessageBlock, Bytes, Length);
+        Context->BlockIndex = Length;
     }
 
     return;
@@ -250,26 +290,146 @@ Return Value:
     return;
 }
 
+CRYPTO_API
+VOID
+CySha256HashMultiple (
+    PVOID *Messages,
+    PUINTN Lengths,
+    UINTN Count,
+    PUCHAR Hashes
+    )
+
+/*++
+
+Routine Description:
+
+    This routine computes the SHA-256 hashes of several independent, complete
+    messages. On processors with wide vector units, several messages are
+    hashed at once, which is considerably faster than hashing them one at a
+    time when there is a large batch to verify.
+
+Arguments:
+
+    Messages - Supplies an array of pointers to the messages to hash.
+
+    Lengths - Supplies an array of the lengths of each message, in bytes.
+
+    Count - Supplies the number of messages.
+
+    Hashes - Supplies a pointer where the hashes will be returned. This buffer
+        must be Count * SHA256_HASH_SIZE bytes long, and receives the hash of
+        each message in order.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    SHA256_CONTEXT Context;
+    UINTN Index;
+
+#ifdef CY_SHA_NI
+
+    if ((Count > 1) &&
+        (CypShaNiIsAvx2Supported() != FALSE) &&
+        (CypShaNiIsSupported() == FALSE)) {
+
+        CypShaNiSha256HashMultiple(Messages, Lengths, Count, Hashes);
+        return;
+    }
+
+#endif
+
+    for (Index = 0; Index < Count; Index += 1) {
+        CySha256Initialize(&Context);
+        CySha256AddContent(&Context, Messages[Index], Lengths[Index]);
+        CySha256GetHash(&Context, Hashes + (Index * SHA256_HASH_SIZE));
+    }
+
+    return;
+}
+
+VOID
+CypSha256ProcessBlocks (
+    PULONG State,
+    PUCHAR Data,
+    UINTN BlockCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine folds whole 64-byte message blocks into a SHA-256 digest,
+    using hardware support if the processor has it.
+
+Arguments:
+
+    State - Supplies a pointer to the eight word intermediate hash.
+
+    Data - Supplies a pointer to the message blocks.
+
+    BlockCount - Supplies the number of 64-byte blocks to process.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+#ifdef CY_ARM_SHA
+
+    CypArmSha256ProcessBlocks(State, Data, BlockCount);
+
+#else
+
+#ifdef CY_SHA_NI
+
+    if (CypShaNiIsSupported() != FALSE) {
+        CypShaNiSha256ProcessBlocks(State, Data, BlockCount);
+        return;
+    }
+
+#endif
+
+    while (BlockCount != 0) {
+        CypSha256ProcessBlock(State, Data);
+        Data += SHA256_BLOCK_SIZE;
+        BlockCount -= 1;
+    }
+
+#endif
+
+    return;
+}
+
 //
 // --------------------------------------------------------- Internal Functions
 //
 
 VOID
-CypSha256ProcessMessage (
-    PSHA256_CONTEXT Context
+CypSha256ProcessBlock (
+    PULONG State,
+    PUCHAR Data
     )
 
 /*++
 
 Routine Description:
 
-    This routine processes the 512 bits in the current message block and adds
-    them to the digest.
+    This routine processes a single 512-bit message block and adds it to the
+    digest.
 
 Arguments:
 
-    Context - Supplies a pointer to the initialized SHA-256 context with a full
-        message block.
+    State - Supplies a pointer to the eight word intermediate hash.
+
+    Data - Supplies a pointer to the 64-byte message block.
 
 Return Value:
 
@@ -295,10 +455,10 @@ Return Value:
 
     ByteIndex = 0;
     for (BlockIndex = 0; BlockIndex < 16; BlockIndex += 1) {
-        Block[BlockIndex] = (Context->MessageBlock[ByteIndex] << 24) |
-                            (Context->MessageBlock[ByteIndex + 1] << 16) |
-                            (Context->MessageBlock[ByteIndex + 2] << 8) |
-                            Context->MessageBlock[ByteIndex + 3];
+        Block[BlockIndex] = (Data[ByteIndex] << 24) |
+                            (Data[ByteIndex + 1] << 16) |
+                            (Data[ByteIndex + 2] << 8) |
+                            Data[ByteIndex + 3];
 
         ByteIndex += 4;
     }
@@ -312,14 +472,14 @@ Return Value:
         BlockIndex += 1;
     }
 
-    BlockA = Context->IntermediateHash[0];
-    BlockB = Context->IntermediateHash[1];
-    BlockC = Context->IntermediateHash[2];
-    BlockD = Context->IntermediateHash[3];
-    BlockE = Context->IntermediateHash[4];
-    BlockF = Context->IntermediateHash[5];
-    BlockG = Context->IntermediateHash[6];
-    BlockH = Context->IntermediateHash[7];
+    BlockA = State[0];
+    BlockB = State[1];
+    BlockC = State[2];
+    BlockD = State[3];
+    BlockE = State[4];
+    BlockF = State[5];
+    BlockG = State[6];
+    BlockH = State[7];
     for (BlockIndex = 0; BlockIndex < 64; BlockIndex += 1) {
         Working1 = BlockH +
                    SHA256_EP1(BlockE) +
@@ -338,14 +498,14 @@ Return Value:
         BlockA = Working1 + Working2;
     }
 
-    Context->IntermediateHash[0] += BlockA;
-    Context->IntermediateHash[1] += BlockB;
-    Context->IntermediateHash[2] += BlockC;
-    Context->IntermediateHash[3] += BlockD;
-    Context->IntermediateHash[4] += BlockE;
-    Context->IntermediateHash[5] += BlockF;
-    Context->IntermediateHash[6] += BlockG;
-    Context->IntermediateHash[7] += BlockH;
+    State[0] += BlockA;
+    State[1] += BlockB;
+    State[2] += BlockC;
+    State[3] += BlockD;
+    State[4] += BlockE;
+    State[5] += BlockF;
+    State[6] += BlockG;
+    State[7] += BlockH;
     return;
 }
 
@@ -400,7 +560,10 @@ Return Value:
             Index += 1;
         }
 
-        CypSha256ProcessMessage(Context);
+        CypSha256ProcessBlocks(Context->IntermediateHash,
+                               Context->MessageBlock,
+                               1);
+
         RtlZeroMemory(Context->MessageBlock, 56);
     }
 
@@ -418,7 +581,7 @@ Return Value:
     Context->MessageBlock[61] = (UCHAR)(Context->Length >> 16);
     Context->MessageBlock[62] = (UCHAR)(Context->Length >> 8);
     Context->MessageBlock[63] = (UCHAR)(Context->Length);
-    CypSha256ProcessMessage(Context);
+    CypSha256ProcessBlocks(Context->IntermediateHash, Context->MessageBlock, 1);
     return;
 }
 
@@ -0,0 +1,286 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    shaarm.c
+
+Abstract:
+
+    This module implements the SHA-1 and SHA-256 backends that use the ARMv8
+    cryptography extensions. These are only built when the compiler is told
+    the target processor has them.
+
+Author:
+
+    agent 19-Oct-2026
+
+Environment:
+
+    Any
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include "cryptop.h"
+
+#ifdef CY_ARM_SHA
+
+#include <arm_neon.h>
+
+//
+// --------------------------------------------------------------------- Macros
+//
+
+//
+// This macro performs four rounds of SHA-256 using message words
+// 4 * _Group through 4 * _Group + 3, and advances the message schedule.
+//
+
+#define ARM_SHA256_ROUNDS(_Group)                                           \
+    Value = vaddq_u32(Message[(_Group) % 4],                                \
+                      vld1q_u32(&(CySha256KConstants[(_Group) * 4])));      \
+                                                                            \
+    if ((_Group) < 12) {                                                    \
+        Message[(_Group) % 4] =                                             \
+                        vsha256su0q_u32(Message[(_Group) % 4],              \
+                                        Message[((_Group) + 1) % 4]);       \
+    }                                                                       \
+                                                                            \
+    Save = State0;                                                          \
+    State0 = vsha256hq_u32(State0, State1, Value);                          \
+    State1 = vsha256h2q_u32(State1, Save, Value);                           \
+    if ((_Group) < 12) {                                                    \
+        Message[(_Group) % 4] =                                             \
+                        vsha256su1q_u32(Message[(_Group) % 4],              \
+                                        Message[((_Group) + 2) % 4],        \
+                                        Message[((_Group) + 3) % 4]);       \
+    }
+
+//
+// This macro performs four rounds of SHA-1 using message words 4 * _Group
+// through 4 * _Group + 3, and advances the message schedule. The round
+// function changes every five groups.
+//
+
+#define ARM_SHA1_ROUNDS(_Group)                                             \
+    Value = vaddq_u32(Message[(_Group) % 4],                                \
+                      vdupq_n_u32(CySha1KConstants[(_Group) / 5]));         \
+                                                                            \
+    ENext = vsha1h_u32(vgetq_lane_u32(Abcd, 0));                            \
+    if ((_Group) < 5) {                                                     \
+        Abcd = vsha1cq_u32(Abcd, E, Value);                                 \
+                                                                            \
+    } else if (((_Group) >= 10) && ((_Group) < 15)) {                       \
+        Abcd = vsha1mq_u32(Abcd, E, Value);                                 \
+                                                                            \
+    } else {                                                                \
+        Abcd = vsha1pq_u32(Abcd, E, Value);                                 \
+    }                                                                       \
+                                                                            \
+    E = ENext;                                                              \
+    if ((_Group) < 16) {                                                    \
+        Message[(_Group) % 4] =                                             \
+                        vsha1su0q_u32(Message[(_Group) % 4],                \
+                                      Message[((_Group) + 1) % 4],          \
+                                      Message[((_Group) + 2) % 4]);         \
+                                                                            \
+        Message[(_Group) % 4] =                                             \
+                        vsha1su1q_u32(Message[(_Group) % 4],                \
+                                      Message[((_Group) + 3) % 4]);         \
+    }
+
+//
+// This macro loads four big endian message words.
+//
+
+#define ARM_SHA_LOAD(_Pointer) \
+    vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(_Pointer)))
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+VOID
+CypArmSha1ProcessBlocks (
+    PULONG State,
+    PUCHAR Data,
+    UINTN BlockCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine folds whole message blocks into a SHA-1 digest using the
+    ARMv8 cryptography extensions.
+
+Arguments:
+
+    State - Supplies a pointer to the five word intermediate hash.
+
+    Data - Supplies a pointer to the message blocks.
+
+    BlockCount - Supplies the number of 64-byte blocks to process.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    uint32x4_t Abcd;
+    uint32x4_t AbcdSave;
+    uint32_t E;
+    uint32_t ENext;
+    uint32_t ESave;
+    uint32x4_t Message[4];
+    uint32x4_t Value;
+
+    Abcd = vld1q_u32(State);
+    E = State[4];
+    while (BlockCount != 0) {
+        AbcdSave = Abcd;
+        ESave = E;
+        Message[0] = ARM_SHA_LOAD(Data);
+        Message[1] = ARM_SHA_LOAD(Data + 16);
+        Message[2] = ARM_SHA_LOAD(Data + 32);
+        Message[3] = ARM_SHA_LOAD(Data + 48);
+        ARM_SHA1_ROUNDS(0);
+        ARM_SHA1_ROUNDS(1);
+        ARM_SHA1_ROUNDS(2);
+        ARM_SHA1_ROUNDS(3);
+        ARM_SHA1_ROUNDS(4);
+        ARM_SHA1_ROUNDS(5);
+        ARM_SHA1_ROUNDS(6);
+        ARM_SHA1_ROUNDS(7);
+        ARM_SHA1_ROUNDS(8);
+        ARM_SHA1_ROUNDS(9);
+        ARM_SHA1_ROUNDS(10);
+        ARM_SHA1_ROUNDS(11);
+        ARM_SHA1_ROUNDS(12);
+        ARM_SHA1_ROUNDS(13);
+        ARM_SHA1_ROUNDS(14);
+        ARM_SHA1_ROUNDS(15);
+        ARM_SHA1_ROUNDS(16);
+        ARM_SHA1_ROUNDS(17);
+        ARM_SHA1_ROUNDS(18);
+        ARM_SHA1_ROUNDS(19);
+        Abcd = vaddq_u32(Abcd, AbcdSave);
+        E += ESave;
+        Data += SHA1_BLOCK_SIZE;
+        BlockCount -= 1;
+    }
+
+    vst1q_u32(State, Abcd);
+    State[4] = E;
+    return;
+}
+
+VOID
+CypArmSha256ProcessBlocks (
+    PULONG State,
+    PUCHAR Data,
+    UINTN BlockCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine folds whole message blocks into a SHA-256 digest using the
+    ARMv8 cryptography extensions.
+
+Arguments:
+
+    State - Supplies a pointer to the eight word intermediate hash.
+
+    Data - Supplies a pointer to the message blocks.
+
+    BlockCount - Supplies the number of 64-byte blocks to process.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    uint32x4_t Message[4];
+    uint32x4_t Save;
+    uint32x4_t State0;
+    uint32x4_t State0Save;
+    uint32x4_t State1;
+    uint32x4_t State1Save;
+    uint32x4_t Value;
+
+    State0 = vld1q_u32(State);
+    State1 = vld1q_u32(State + 4);
+    while (BlockCount != 0) {
+        State0Save = State0;
+        State1Save = State1;
+        Message[0] = ARM_SHA_LOAD(Data);
+        Message[1] = ARM_SHA_LOAD(Data + 16);
+        Message[2] = ARM_SHA_LOAD(Data + 32);
+        Message[3] = ARM_SHA_LOAD(Data + 48);
+        ARM_SHA256_ROUNDS(0);
+        ARM_SHA256_ROUNDS(1);
+        ARM_SHA256_ROUNDS(2);
+        ARM_SHA256_ROUNDS(3);
+        ARM_SHA256_ROUNDS(4);
+        ARM_SHA256_ROUNDS(5);
+        ARM_SHA256_ROUNDS(6);
+        ARM_SHA256_ROUNDS(7);
+        ARM_SHA256_ROUNDS(8);
+        ARM_SHA256_ROUNDS(9);
+        ARM_SHA256_ROUNDS(10);
+        ARM_SHA256_ROUNDS(11);
+        ARM_SHA256_ROUNDS(12);
+        ARM_SHA256_ROUNDS(13);
+        ARM_SHA256_ROUNDS(14);
+        ARM_SHA256_ROUNDS(15);
+        State0 = vaddq_u32(State0, State0Save);
+        State1 = vaddq_u32(State1, State1Save);
+        Data += SHA256_BLOCK_SIZE;
+        BlockCount -= 1;
+    }
+
+    vst1q_u32(State, State0);
+    vst1q_u32(State + 4, State1);
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+#endif
+
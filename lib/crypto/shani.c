@@ -0,0 +1,1032 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    shani.c
+
+Abstract:
+
+    This module implements the SHA-1 and SHA-256 backends that use the x86 SHA
+    extensions, as well as a multi-buffer SHA-256 that hashes eight
+    independent messages at once in the lanes of the AVX2 registers.
+
+Author:
+
+    agent 19-Oct-2026
+
+Environment:
+
+    Any
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include "cryptop.h"
+
+#ifdef CY_SHA_NI
+
+#include <cpuid.h>
+#include <immintrin.h>
+
+//
+// --------------------------------------------------------------------- Macros
+//
+
+//
+// These macros mark a routine as using the SHA extensions or the AVX2
+// instructions, without requiring the whole library to be compiled for
+// processors that have them.
+//
+
+#define SHA_NI_TARGET __attribute__((target("sha,sse4.1,ssse3")))
+#define SHA_NI_AVX2_TARGET __attribute__((target("avx2")))
+
+//
+// These macros load and store an unaligned 16-byte block.
+//
+
+#define SHA_NI_LOAD(_Pointer) _mm_loadu_si128((__m128i *)(_Pointer))
+#define SHA_NI_STORE(_Pointer, _Value) \
+    _mm_storeu_si128((__m128i *)(_Pointer), (_Value))
+
+//
+// This macro performs four rounds of SHA-256 using message words
+// 4 * _Group through 4 * _Group + 3, and advances the message schedule. The
+// group number must be a constant so that the conditions fold away.
+//
+
+#define SHA_NI_SHA256_ROUNDS(_Group)                                        \
+    Value = _mm_add_epi32(                                                  \
+                Message[(_Group) % 4],                                      \
+                SHA_NI_LOAD(&(CySha256KConstants[(_Group) * 4])));          \
+                                                                            \
+    State1 = _mm_sha256rnds2_epu32(State1, State0, Value);                  \
+    if (((_Group) >= 3) && ((_Group) <= 14)) {                              \
+        Temp = _mm_alignr_epi8(Message[(_Group) % 4],                       \
+                               Message[((_Group) + 3) % 4],                 \
+                               4);                                          \
+                                                                            \
+        Message[((_Group) + 1) % 4] =                                       \
+                       _mm_add_epi32(Message[((_Group) + 1) % 4], Temp);    \
+                                                                            \
+        Message[((_Group) + 1) % 4] =                                       \
+                       _mm_sha256msg2_epu32(Message[((_Group) + 1) % 4],    \
+                                            Message[(_Group) % 4]);         \
+    }                                                                       \
+                                                                            \
+    Value = _mm_shuffle_epi32(Value, 0x0E);                                 \
+    State0 = _mm_sha256rnds2_epu32(State0, State1, Value);                  \
+    if (((_Group) >= 1) && ((_Group) <= 12)) {                              \
+        Message[((_Group) + 3) % 4] =                                       \
+                       _mm_sha256msg1_epu32(Message[((_Group) + 3) % 4],    \
+                                            Message[(_Group) % 4]);         \
+    }
+
+//
+// This macro performs four rounds of SHA-1 using message words 4 * _Group
+// through 4 * _Group + 3, and advances the message schedule. The round
+// function changes every five groups.
+//
+
+#define SHA_NI_SHA1_ROUNDS(_Group)                                          \
+    if ((_Group) == 0) {                                                    \
+        E[0] = _mm_add_epi32(E[0], Message[0]);                             \
+                                                                            \
+    } else {                                                                \
+        E[(_Group) % 2] = _mm_sha1nexte_epu32(E[(_Group) % 2],              \
+                                              Message[(_Group) % 4]);       \
+    }                                                                       \
+                                                                            \
+    E[((_Group) + 1) % 2] = Abcd;                                           \
+    if (((_Group) >= 3) && ((_Group) <= 18)) {                              \
+        Message[((_Group) + 1) % 4] =                                       \
+                         _mm_sha1msg2_epu32(Message[((_Group) + 1) % 4],    \
+                                            Message[(_Group) % 4]);         \
+    }                                                                       \
+                                                                            \
+    Abcd = _mm_sha1rnds4_epu32(Abcd, E[(_Group) % 2], (_Group) / 5);        \
+    if (((_Group) >= 1) && ((_Group) <= 16)) {                              \
+        Message[((_Group) + 3) % 4] =                                       \
+                         _mm_sha1msg1_epu32(Message[((_Group) + 3) % 4],    \
+                                            Message[(_Group) % 4]);         \
+    }                                                                       \
+                                                                            \
+    if (((_Group) >= 2) && ((_Group) <= 17)) {                              \
+        Message[((_Group) + 2) % 4] =                                       \
+                   _mm_xor_si128(Message[((_Group) + 2) % 4],               \
+                                 Message[(_Group) % 4]);                    \
+    }
+
+//
+// These macros implement the SHA-256 functions on eight lanes at once.
+//
+
+#define SHA_NI_AVX2_ROTATE_RIGHT(_Value, _Count)            \
+    _mm256_or_si256(_mm256_srli_epi32((_Value), (_Count)),  \
+                    _mm256_slli_epi32((_Value), 32 - (_Count)))
+
+#define SHA_NI_AVX2_CH(_ValueX, _ValueY, _ValueZ)           \
+    _mm256_xor_si256(_mm256_and_si256((_ValueX), (_ValueY)), \
+                     _mm256_andnot_si256((_ValueX), (_ValueZ)))
+
+#define SHA_NI_AVX2_MAJ(_ValueX, _ValueY, _ValueZ)                          \
+    _mm256_or_si256(_mm256_and_si256((_ValueX), (_ValueY)),                 \
+                    _mm256_and_si256(_mm256_or_si256((_ValueX), (_ValueY)), \
+                                     (_ValueZ)))
+
+#define SHA_NI_AVX2_EP0(_Value)                                     \
+    _mm256_xor_si256(                                               \
+        _mm256_xor_si256(SHA_NI_AVX2_ROTATE_RIGHT(_Value, 2),       \
+                         SHA_NI_AVX2_ROTATE_RIGHT(_Value, 13)),     \
+        SHA_NI_AVX2_ROTATE_RIGHT(_Value, 22))
+
+#define SHA_NI_AVX2_EP1(_Value)                                     \
+    _mm256_xor_si256(                                               \
+        _mm256_xor_si256(SHA_NI_AVX2_ROTATE_RIGHT(_Value, 6),       \
+                         SHA_NI_AVX2_ROTATE_RIGHT(_Value, 11)),     \
+        SHA_NI_AVX2_ROTATE_RIGHT(_Value, 25))
+
+#define SHA_NI_AVX2_SIG0(_Value)                                    \
+    _mm256_xor_si256(                                               \
+        _mm256_xor_si256(SHA_NI_AVX2_ROTATE_RIGHT(_Value, 7),       \
+                         SHA_NI_AVX2_ROTATE_RIGHT(_Value, 18)),     \
+        _mm256_srli_epi32((_Value), 3))
+
+#define SHA_NI_AVX2_SIG1(_Value)                                    \
+    _mm256_xor_si256(                                               \
+        _mm256_xor_si256(SHA_NI_AVX2_ROTATE_RIGHT(_Value, 17),      \
+                         SHA_NI_AVX2_ROTATE_RIGHT(_Value, 19)),     \
+        _mm256_srli_epi32((_Value), 10))
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// Define the number of messages hashed at once by the AVX2 routine.
+//
+
+#define SHA_NI_LANES 8
+
+//
+// Define the number of words in the SHA-256 state.
+//
+
+#define SHA_NI_SHA256_WORDS (SHA256_HASH_SIZE / sizeof(ULONG))
+
+//
+// Define the processor feature bits cached after the first query.
+//
+
+#define SHA_NI_FEATURE_DETECTED 0x00000001
+#define SHA_NI_FEATURE_SHA      0x00000002
+#define SHA_NI_FEATURE_AVX2     0x00000004
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+/*++
+
+Structure Description:
+
+    This structure stores the progress of one lane of the multi-buffer hash.
+
+Members:
+
+    Data - Stores a pointer to the next whole block of the message.
+
+    BlockCount - Stores the number of whole message blocks remaining.
+
+    Tail - Stores the final partial block of the message along with its
+        padding, which may spill into a second block.
+
+    TailIndex - Stores the index of the next tail block to process.
+
+    TailCount - Stores the number of tail blocks, either one or two.
+
+    MessageIndex - Stores the index of the message being hashed in this lane.
+
+    Active - Stores a boolean indicating whether this lane holds a message.
+
+--*/
+
+typedef struct _SHA_NI_LANE {
+    PUCHAR Data;
+    UINTN BlockCount;
+    UCHAR Tail[SHA256_BLOCK_SIZE * 2];
+    UINTN TailIndex;
+    UINTN TailCount;
+    UINTN MessageIndex;
+    BOOL Active;
+} SHA_NI_LANE, *PSHA_NI_LANE;
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+ULONG
+CypShaNiGetFeatures (
+    VOID
+    );
+
+VOID
+CypShaNiStartLane (
+    PSHA_NI_LANE Lane,
+    ULONG State[SHA_NI_SHA256_WORDS][SHA_NI_LANES],
+    UINTN LaneIndex,
+    PVOID *Messages,
+    PUINTN Lengths,
+    UINTN MessageIndex
+    );
+
+VOID
+CypShaNiFinishLane (
+    PSHA_NI_LANE Lane,
+    ULONG State[SHA_NI_SHA256_WORDS][SHA_NI_LANES],
+    UINTN LaneIndex,
+    BOOL Complete,
+    PUCHAR Hashes
+    );
+
+SHA_NI_AVX2_TARGET
+VOID
+CypShaNiAvx2Sha256Block (
+    ULONG State[SHA_NI_SHA256_WORDS][SHA_NI_LANES],
+    PUCHAR Blocks[SHA_NI_LANES]
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// Store the processor features, detected on first use.
+//
+
+volatile ULONG CyShaNiFeatures;
+
+//
+// Store a block handed to the idle lanes of the multi-buffer routine.
+//
+
+const UCHAR CyShaNiIdleBlock[SHA256_BLOCK_SIZE];
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+BOOL
+CypShaNiIsSupported (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines whether the processor supports the SHA
+    extensions.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    TRUE if the SHA-NI routines can be used.
+
+    FALSE if the processor lacks the instructions.
+
+--*/
+
+{
+
+    if ((CypShaNiGetFeatures() & SHA_NI_FEATURE_SHA) != 0) {
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+BOOL
+CypShaNiIsAvx2Supported (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine determines whether the processor and operating system
+    support the 256-bit AVX2 integer instructions.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    TRUE if the AVX2 multi-buffer routines can be used.
+
+    FALSE if the processor lacks the instructions or the operating system does
+    not preserve the wide registers.
+
+--*/
+
+{
+
+    if ((CypShaNiGetFeatures() & SHA_NI_FEATURE_AVX2) != 0) {
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+SHA_NI_TARGET
+VOID
+CypShaNiSha1ProcessBlocks (
+    PULONG State,
+    PUCHAR Data,
+    UINTN BlockCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine folds whole message blocks into a SHA-1 digest using the
+    SHA extensions.
+
+Arguments:
+
+    State - Supplies a pointer to the five word intermediate hash.
+
+    Data - Supplies a pointer to the message blocks.
+
+    BlockCount - Supplies the number of 64-byte blocks to process.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    __m128i Abcd;
+    __m128i AbcdSave;
+    __m128i E[2];
+    __m128i ESave;
+    __m128i Mask;
+    __m128i Message[4];
+
+    //
+    // The instructions want A in the high word and the message words
+    // byte-swapped and in reverse order.
+    //
+
+    Mask = _mm_set_epi64x(0x0001020304050607ULL, 0x08090A0B0C0D0E0FULL);
+    Abcd = _mm_shuffle_epi32(SHA_NI_LOAD(State), 0x1B);
+    E[0] = _mm_set_epi32(State[4], 0, 0, 0);
+    while (BlockCount != 0) {
+        AbcdSave = Abcd;
+        ESave = E[0];
+        Message[0] = _mm_shuffle_epi8(SHA_NI_LOAD(Data), Mask);
+        Message[1] = _mm_shuffle_epi8(SHA_NI_LOAD(Data + 16), Mask);
+        Message[2] = _mm_shuffle_epi8(SHA_NI_LOAD(Data + 32), Mask);
+        Message[3] = _mm_shuffle_epi8(SHA_NI_LOAD(Data + 48), Mask);
+        SHA_NI_SHA1_ROUNDS(0);
+        SHA_NI_SHA1_ROUNDS(1);
+        SHA_NI_SHA1_ROUNDS(2);
+        SHA_NI_SHA1_ROUNDS(3);
+        SHA_NI_SHA1_ROUNDS(4);
+        SHA_NI_SHA1_ROUNDS(5);
+        SHA_NI_SHA1_ROUNDS(6);
+        SHA_NI_SHA1_ROUNDS(7);
+        SHA_NI_SHA1_ROUNDS(8);
+        SHA_NI_SHA1_ROUNDS(9);
+        SHA_NI_SHA1_ROUNDS(10);
+        SHA_NI_SHA1_ROUNDS(11);
+        SHA_NI_SHA1_ROUNDS(12);
+        SHA_NI_SHA1_ROUNDS(13);
+        SHA_NI_SHA1_ROUNDS(14);
+        SHA_NI_SHA1_ROUNDS(15);
+        SHA_NI_SHA1_ROUNDS(16);
+        SHA_NI_SHA1_ROUNDS(17);
+        SHA_NI_SHA1_ROUNDS(18);
+        SHA_NI_SHA1_ROUNDS(19);
+        E[0] = _mm_sha1nexte_epu32(E[0], ESave);
+        Abcd = _mm_add_epi32(Abcd, AbcdSave);
+        Data += SHA1_BLOCK_SIZE;
+        BlockCount -= 1;
+    }
+
+    SHA_NI_STORE(State, _mm_shuffle_epi32(Abcd, 0x1B));
+    State[4] = _mm_extract_epi32(E[0], 3);
+    return;
+}
+
+SHA_NI_TARGET
+VOID
+CypShaNiSha256ProcessBlocks (
+    PULONG State,
+    PUCHAR Data,
+    UINTN BlockCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine folds whole message blocks into a SHA-256 digest using the
+    SHA extensions.
+
+Arguments:
+
+    State - Supplies a pointer to the eight word intermediate hash.
+
+    Data - Supplies a pointer to the message blocks.
+
+    BlockCount - Supplies the number of 64-byte blocks to process.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    __m128i Mask;
+    __m128i Message[4];
+    __m128i State0;
+    __m128i State0Save;
+    __m128i State1;
+    __m128i State1Save;
+    __m128i Temp;
+    __m128i Value;
+
+    //
+    // The round instructions want the state split into ABEF and CDGH
+    // halves rather than ABCD and EFGH.
+    //
+
+    Mask = _mm_set_epi64x(0x0C0D0E0F08090A0BULL, 0x0405060700010203ULL);
+    Temp = _mm_shuffle_epi32(SHA_NI_LOAD(State), 0xB1);
+    State1 = _mm_shuffle_epi32(SHA_NI_LOAD(State + 4), 0x1B);
+    State0 = _mm_alignr_epi8(Temp, State1, 8);
+    State1 = _mm_blend_epi16(State1, Temp, 0xF0);
+    while (BlockCount != 0) {
+        State0Save = State0;
+        State1Save = State1;
+        Message[0] = _mm_shuffle_epi8(SHA_NI_LOAD(Data), Mask);
+        Message[1] = _mm_shuffle_epi8(SHA_NI_LOAD(Data + 16), Mask);
+        Message[2] = _mm_shuffle_epi8(SHA_NI_LOAD(Data + 32), Mask);
+        Message[3] = _mm_shuffle_epi8(SHA_NI_LOAD(Data + 48), Mask);
+        SHA_NI_SHA256_ROUNDS(0);
+        SHA_NI_SHA256_ROUNDS(1);
+        SHA_NI_SHA256_ROUNDS(2);
+        SHA_NI_SHA256_ROUNDS(3);
+        SHA_NI_SHA256_ROUNDS(4);
+        SHA_NI_SHA256_ROUNDS(5);
+        SHA_NI_SHA256_ROUNDS(6);
+        SHA_NI_SHA256_ROUNDS(7);
+        SHA_NI_SHA256_ROUNDS(8);
+        SHA_NI_SHA256_ROUNDS(9);
+        SHA_NI_SHA256_ROUNDS(10);
+        SHA_NI_SHA256_ROUNDS(11);
+        SHA_NI_SHA256_ROUNDS(12);
+        SHA_NI_SHA256_ROUNDS(13);
+        SHA_NI_SHA256_ROUNDS(14);
+        SHA_NI_SHA256_ROUNDS(15);
+        State0 = _mm_add_epi32(State0, State0Save);
+        State1 = _mm_add_epi32(State1, State1Save);
+        Data += SHA256_BLOCK_SIZE;
+        BlockCount -= 1;
+    }
+
+    Temp = _mm_shuffle_epi32(State0, 0x1B);
+    State1 = _mm_shuffle_epi32(State1, 0xB1);
+    SHA_NI_STORE(State, _mm_blend_epi16(Temp, State1, 0xF0));
+    SHA_NI_STORE(State + 4, _mm_alignr_epi8(State1, Temp, 8));
+    return;
+}
+
+VOID
+CypShaNiSha256HashMultiple (
+    PVOID *Messages,
+    PUINTN Lengths,
+    UINTN Count,
+    PUCHAR Hashes
+    )
+
+/*++
+
+Routine Description:
+
+    This routine computes the SHA-256 hashes of several independent messages
+    at once, running eight of them in the lanes of the AVX2 registers.
+
+Arguments:
+
+    Messages - Supplies an array of pointers to the messages to hash.
+
+    Lengths - Supplies an array of message lengths in bytes.
+
+    Count - Supplies the number of messages.
+
+    Hashes - Supplies a pointer where the hashes will be returned, one after
+        another.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UINTN ActiveCount;
+    PUCHAR Blocks[SHA_NI_LANES];
+    PSHA_NI_LANE Lane;
+    UINTN LaneIndex;
+    SHA_NI_LANE Lanes[SHA_NI_LANES];
+    UINTN NextMessage;
+    ULONG State[SHA_NI_SHA256_WORDS][SHA_NI_LANES];
+
+    ActiveCount = 0;
+    NextMessage = 0;
+    for (LaneIndex = 0; LaneIndex < SHA_NI_LANES; LaneIndex += 1) {
+        Lane = &(Lanes[LaneIndex]);
+        Lane->Active = FALSE;
+        if (NextMessage < Count) {
+            CypShaNiStartLane(Lane,
+                              State,
+                              LaneIndex,
+                              Messages,
+                              Lengths,
+                              NextMessage);
+
+            NextMessage += 1;
+            ActiveCount += 1;
+        }
+    }
+
+    //
+    // Run all lanes a block at a time, refilling each lane with the next
+    // message as soon as it finishes. Once there is no more parallelism to
+    // be had, finish the stragglers one at a time.
+    //
+
+    while ((ActiveCount > 1) || (NextMessage < Count)) {
+        for (LaneIndex = 0; LaneIndex < SHA_NI_LANES; LaneIndex += 1) {
+            Lane = &(Lanes[LaneIndex]);
+            if (Lane->Active == FALSE) {
+                Blocks[LaneIndex] = (PUCHAR)CyShaNiIdleBlock;
+
+            } else if (Lane->BlockCount != 0) {
+                Blocks[LaneIndex] = Lane->Data;
+
+            } else {
+                Blocks[LaneIndex] = Lane->Tail +
+                                    (Lane->TailIndex * SHA256_BLOCK_SIZE);
+            }
+        }
+
+        CypShaNiAvx2Sha256Block(State, Blocks);
+        for (LaneIndex = 0; LaneIndex < SHA_NI_LANES; LaneIndex += 1) {
+            Lane = &(Lanes[LaneIndex]);
+            if (Lane->Active == FALSE) {
+                continue;
+            }
+
+            if (Lane->BlockCount != 0) {
+                Lane->Data += SHA256_BLOCK_SIZE;
+                Lane->BlockCount -= 1;
+                continue;
+            }
+
+            Lane->TailIndex += 1;
+            if (Lane->TailIndex != Lane->TailCount) {
+                continue;
+            }
+
+            CypShaNiFinishLane(Lane, State, LaneIndex, TRUE, Hashes);
+            ActiveCount -= 1;
+            if (NextMessage < Count) {
+                CypShaNiStartLane(Lane,
+                                  State,
+                                  LaneIndex,
+                                  Messages,
+                                  Lengths,
+                                  NextMessage);
+
+                NextMessage += 1;
+                ActiveCount += 1;
+            }
+        }
+    }
+
+    for (LaneIndex = 0; LaneIndex < SHA_NI_LANES; LaneIndex += 1) {
+        Lane = &(Lanes[LaneIndex]);
+        if (Lane->Active != FALSE) {
+            CypShaNiFinishLane(Lane, State, LaneIndex, FALSE, Hashes);
+        }
+    }
+
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+ULONG
+CypShaNiGetFeatures (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the processor features relevant to this backend,
+    querying the processor the first time through.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns a mask of SHA_NI_FEATURE_* flags.
+
+--*/
+
+{
+
+    ULONG Eax;
+    ULONG Ebx;
+    ULONG Ecx;
+    ULONG Edx;
+    ULONG Features;
+    ULONG LeafOneEcx;
+
+    Features = CyShaNiFeatures;
+    if (Features != 0) {
+        return Features;
+    }
+
+    Features = SHA_NI_FEATURE_DETECTED;
+    if (__get_cpuid(1, &Eax, &Ebx, &LeafOneEcx, &Edx) == 0) {
+        CyShaNiFeatures = Features;
+        return Features;
+    }
+
+    if (__get_cpuid_count(7, 0, &Eax, &Ebx, &Ecx, &Edx) != 0) {
+
+        //
+        // The byte shuffle and blend instructions are needed to get the
+        // state and message in and out of the layout the SHA instructions
+        // expect.
+        //
+
+        if (((Ebx & bit_SHA) != 0) &&
+            ((LeafOneEcx & bit_SSSE3) != 0) &&
+            ((LeafOneEcx & bit_SSE4_1) != 0)) {
+
+            Features |= SHA_NI_FEATURE_SHA;
+        }
+
+        //
+        // The wide registers are only usable if the operating system has
+        // turned on saving of the SSE and AVX state. Ask it via XCR0 rather
+        // than assume.
+        //
+
+        if (((Ebx & bit_AVX2) != 0) &&
+            ((LeafOneEcx & bit_OSXSAVE) != 0) &&
+            ((LeafOneEcx & bit_AVX) != 0)) {
+
+            __asm__ __volatile__ ("xgetbv"
+                                  : "=a" (Eax), "=d" (Edx)
+                                  : "c" (0));
+
+            if ((Eax & 0x6) == 0x6) {
+                Features |= SHA_NI_FEATURE_AVX2;
+            }
+        }
+    }
+
+    //
+    // Racing threads compute the same answer, so a plain store is fine.
+    //
+
+    CyShaNiFeatures = Features;
+    return Features;
+}
+
+VOID
+CypShaNiStartLane (
+    PSHA_NI_LANE Lane,
+    ULONG State[SHA_NI_SHA256_WORDS][SHA_NI_LANES],
+    UINTN LaneIndex,
+    PVOID *Messages,
+    PUINTN Lengths,
+    UINTN MessageIndex
+    )
+
+/*++
+
+Routine Description:
+
+    This routine loads a new message into a multi-buffer lane, building its
+    padding blocks up front.
+
+Arguments:
+
+    Lane - Supplies a pointer to the lane to start.
+
+    State - Supplies the interleaved state of all lanes.
+
+    LaneIndex - Supplies the index of the lane.
+
+    Messages - Supplies the array of message pointers.
+
+    Lengths - Supplies the array of message lengths.
+
+    MessageIndex - Supplies the index of the message to load.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONGLONG BitLength;
+    SHA256_CONTEXT Context;
+    UINTN Index;
+    UINTN Length;
+    UINTN Remainder;
+    UINTN TailSize;
+
+    Length = Lengths[MessageIndex];
+    Remainder = Length % SHA256_BLOCK_SIZE;
+    Lane->Data = Messages[MessageIndex];
+    Lane->BlockCount = Length / SHA256_BLOCK_SIZE;
+    Lane->TailIndex = 0;
+    Lane->TailCount = 1;
+    if (Remainder >= SHA256_BLOCK_SIZE - sizeof(ULONGLONG)) {
+        Lane->TailCount = 2;
+    }
+
+    TailSize = Lane->TailCount * SHA256_BLOCK_SIZE;
+    RtlZeroMemory(Lane->Tail, TailSize);
+    RtlCopyMemory(Lane->Tail,
+                  Lane->Data + (Lane->BlockCount * SHA256_BLOCK_SIZE),
+                  Remainder);
+
+    Lane->Tail[Remainder] = 0x80;
+    BitLength = (ULONGLONG)Length * BITS_PER_BYTE;
+    for (Index = 0; Index < sizeof(ULONGLONG); Index += 1) {
+        Lane->Tail[TailSize - 1 - Index] = (UCHAR)BitLength;
+        BitLength >>= BITS_PER_BYTE;
+    }
+
+    Lane->MessageIndex = MessageIndex;
+    Lane->Active = TRUE;
+    CySha256Initialize(&Context);
+    for (Index = 0; Index < SHA_NI_SHA256_WORDS; Index += 1) {
+        State[Index][LaneIndex] = Context.IntermediateHash[Index];
+    }
+
+    return;
+}
+
+VOID
+CypShaNiFinishLane (
+    PSHA_NI_LANE Lane,
+    ULONG State[SHA_NI_SHA256_WORDS][SHA_NI_LANES],
+    UINTN LaneIndex,
+    BOOL Complete,
+    PUCHAR Hashes
+    )
+
+/*++
+
+Routine Description:
+
+    This routine writes out the hash for the message in a multi-buffer lane,
+    hashing whatever blocks remain one at a time if the lane is not yet
+    done.
+
+Arguments:
+
+    Lane - Supplies a pointer to the lane to finish.
+
+    State - Supplies the interleaved state of all lanes.
+
+    LaneIndex - Supplies the index of the lane.
+
+    Complete - Supplies a boolean indicating whether all blocks of the lane's
+        message have already been processed.
+
+    Hashes - Supplies the array of hashes to write the result into.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PUCHAR Hash;
+    UINTN Index;
+    ULONG LaneState[SHA_NI_SHA256_WORDS];
+    ULONG Word;
+
+    for (Index = 0; Index < SHA_NI_SHA256_WORDS; Index += 1) {
+        LaneState[Index] = State[Index][LaneIndex];
+    }
+
+    if (Complete == FALSE) {
+        CypSha256ProcessBlocks(LaneState, Lane->Data, Lane->BlockCount);
+        CypSha256ProcessBlocks(
+                         LaneState,
+                         Lane->Tail + (Lane->TailIndex * SHA256_BLOCK_SIZE),
+                         Lane->TailCount - Lane->TailIndex);
+    }
+
+    Hash = Hashes + (Lane->MessageIndex * SHA256_HASH_SIZE);
+    for (Index = 0; Index < SHA_NI_SHA256_WORDS; Index += 1) {
+        Word = LaneState[Index];
+        Hash[0] = (UCHAR)(Word >> 24);
+        Hash[1] = (UCHAR)(Word >> 16);
+        Hash[2] = (UCHAR)(Word >> 8);
+        Hash[3] = (UCHAR)Word;
+        Hash += sizeof(ULONG);
+    }
+
+    Lane->Active = FALSE;
+    return;
+}
+
+SHA_NI_AVX2_TARGET
+VOID
+CypShaNiAvx2Sha256Block (
+    ULONG State[SHA_NI_SHA256_WORDS][SHA_NI_LANES],
+    PUCHAR Blocks[SHA_NI_LANES]
+    )
+
+/*++
+
+Routine Description:
+
+    This routine folds one message block into each of eight interleaved
+    SHA-256 states.
+
+Arguments:
+
+    State - Supplies the interleaved state, where each row holds one state
+        word for all eight lanes.
+
+    Blocks - Supplies a pointer to the 64-byte block for each lane.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    __m256i Ep;
+    UINTN Half;
+    UINTN Index;
+    UINTN Lane;
+    __m256i Mask;
+    __m256i Rows[SHA_NI_LANES];
+    __m256i Temp[SHA_NI_LANES];
+    __m256i Value1;
+    __m256i Value2;
+    __m256i Working[SHA_NI_SHA256_WORDS];
+    __m256i Words[16];
+
+    //
+    // Load each lane's block as a row, byte-swap it, and transpose it so
+    // that each vector holds the same message word from every lane.
+    //
+
+    Mask = _mm256_set_epi64x(0x0C0D0E0F08090A0BULL,
+                             0x0405060700010203ULL,
+                             0x0C0D0E0F08090A0BULL,
+                             0x0405060700010203ULL);
+
+    for (Half = 0; Half < 2; Half += 1) {
+        for (Lane = 0; Lane < SHA_NI_LANES; Lane += 1) {
+            Rows[Lane] = _mm256_loadu_si256(
+                                  (__m256i *)(Blocks[Lane] + (Half * 32)));
+
+            Rows[Lane] = _mm256_shuffle_epi8(Rows[Lane], Mask);
+        }
+
+        for (Lane = 0; Lane < SHA_NI_LANES; Lane += 2) {
+            Temp[Lane] = _mm256_unpacklo_epi32(Rows[Lane], Rows[Lane + 1]);
+            Temp[Lane + 1] = _mm256_unpackhi_epi32(Rows[Lane],
+                                                   Rows[Lane + 1]);
+        }
+
+        for (Lane = 0; Lane < SHA_NI_LANES; Lane += 4) {
+            Rows[Lane] = _mm256_unpacklo_epi64(Temp[Lane], Temp[Lane + 2]);
+            Rows[Lane + 1] = _mm256_unpackhi_epi64(Temp[Lane],
+                                                   Temp[Lane + 2]);
+
+            Rows[Lane + 2] = _mm256_unpacklo_epi64(Temp[Lane + 1],
+                                                   Temp[Lane + 3]);
+
+            Rows[Lane + 3] = _mm256_unpackhi_epi64(Temp[Lane + 1],
+                                                   Temp[Lane + 3]);
+        }
+
+        for (Index = 0; Index < 4; Index += 1) {
+            Words[(Half * 8) + Index] =
+                      _mm256_permute2x128_si256(Rows[Index],
+                                                Rows[Index + 4],
+                                                0x20);
+
+            Words[(Half * 8) + Index + 4] =
+                      _mm256_permute2x128_si256(Rows[Index],
+                                                Rows[Index + 4],
+                                                0x31);
+        }
+    }
+
+    for (Index = 0; Index < SHA_NI_SHA256_WORDS; Index += 1) {
+        Working[Index] = _mm256_loadu_si256((__m256i *)(State[Index]));
+    }
+
+    //
+    // Run the 64 rounds, computing the message schedule in a ring of the
+    // last sixteen words.
+    //
+
+    for (Index = 0; Index < 64; Index += 1) {
+        if (Index >= 16) {
+            Value1 = SHA_NI_AVX2_SIG1(Words[(Index - 2) % 16]);
+            Value2 = SHA_NI_AVX2_SIG0(Words[(Index - 15) % 16]);
+            Value1 = _mm256_add_epi32(Value1, Words[(Index - 7) % 16]);
+            Value2 = _mm256_add_epi32(Value2, Words[Index % 16]);
+            Words[Index % 16] = _mm256_add_epi32(Value1, Value2);
+        }
+
+        Value1 = _mm256_add_epi32(
+                        Words[Index % 16],
+                        _mm256_set1_epi32(CySha256KConstants[Index]));
+
+        Ep = SHA_NI_AVX2_EP1(Working[4]);
+        Value1 = _mm256_add_epi32(Value1, Working[7]);
+        Value1 = _mm256_add_epi32(Value1, Ep);
+        Value1 = _mm256_add_epi32(
+                        Value1,
+                        SHA_NI_AVX2_CH(Working[4], Working[5], Working[6]));
+
+        Ep = SHA_NI_AVX2_EP0(Working[0]);
+        Value2 = _mm256_add_epi32(
+                        Ep,
+                        SHA_NI_AVX2_MAJ(Working[0], Working[1], Working[2]));
+
+        Working[7] = Working[6];
+        Working[6] = Working[5];
+        Working[5] = Working[4];
+        Working[4] = _mm256_add_epi32(Working[3], Value1);
+        Working[3] = Working[2];
+        Working[2] = Working[1];
+        Working[1] = Working[0];
+        Working[0] = _mm256_add_epi32(Value1, Value2);
+    }
+
+    for (Index = 0; Index < SHA_NI_SHA256_WORDS; Index += 1) {
+        Value1 = _mm256_loadu_si256((__m256i *)(State[Index]));
+        Value1 = _mm256_add_epi32(Value1, Working[Index]);
+        _mm256_storeu_si256((__m256i *)(State[Index]), Value1);
+    }
+
+    return;
+}
+
+#endif
+
@@ -64,10 +64,44 @@ Module Name:
 
 #define BIG_INTEGER_LONG_COMPONENT_MAX 0xFFFFFFFFFFFFFFFFULL
 
+//
+// Define the number of bits in a machine word, and the number of components
+// that fit in one.
+//
+
+#define BIG_INTEGER_WORD_BITS (sizeof(BIG_INTEGER_WORD) * BITS_PER_BYTE)
+#define BIG_INTEGER_WORD_COMPONENTS \
+    (sizeof(BIG_INTEGER_WORD) / sizeof(BIG_INTEGER_COMPONENT))
+
+//
+// Define the operand size, in words, at which multiplies switch from the
+// schoolbook method to Karatsuba.
+//
+
+#define BIG_INTEGER_KARATSUBA_THRESHOLD 16
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
 
+//
+// Montgomery multiplication works on native machine words rather than
+// components, using a double word for products. Use 64-bit words where the
+// compiler provides a 128-bit type to hold their products.
+//
+
+#if defined(__SIZEOF_INT128__)
+
+typedef ULONGLONG BIG_INTEGER_WORD, *PBIG_INTEGER_WORD;
+typedef unsigned __int128 BIG_INTEGER_DOUBLE_WORD;
+
+#else
+
+typedef ULONG BIG_INTEGER_WORD, *PBIG_INTEGER_WORD;
+typedef ULONGLONG BIG_INTEGER_DOUBLE_WORD;
+
+#endif
+
 //
 // ----------------------------------------------- Internal Function Prototypes
 //
@@ -174,6 +208,99 @@ CypBiComputeExponentTable (
     PBIG_INTEGER Value
     );
 
+PBIG_INTEGER
+CypBiExponentiateMontgomery (
+    PBIG_INTEGER_CONTEXT Context,
+    PBIG_INTEGER Value,
+    PBIG_INTEGER Exponent
+    );
+
+PVOID
+CypBiReserveScratch (
+    PBIG_INTEGER_CONTEXT Context,
+    UINTN Size
+    );
+
+VOID
+CypBiLoadWords (
+    PBIG_INTEGER_WORD Words,
+    UINTN Size,
+    PBIG_INTEGER Value
+    );
+
+VOID
+CypBiStoreWords (
+    PBIG_INTEGER Value,
+    PBIG_INTEGER_WORD Words,
+    UINTN Size
+    );
+
+UINTN
+CypBiMontgomeryScratchSize (
+    UINTN Size
+    );
+
+VOID
+CypBiMontgomeryMultiply (
+    PBIG_INTEGER_WORD Result,
+    PBIG_INTEGER_WORD Left,
+    PBIG_INTEGER_WORD Right,
+    PBIG_INTEGER_WORD Modulus,
+    BIG_INTEGER_WORD Factor,
+    UINTN Size,
+    PBIG_INTEGER_WORD Scratch
+    );
+
+VOID
+CypBiMontgomeryReduce (
+    PBIG_INTEGER_WORD Result,
+    PBIG_INTEGER_WORD Product,
+    PBIG_INTEGER_WORD Modulus,
+    BIG_INTEGER_WORD Factor,
+    UINTN Size
+    );
+
+VOID
+CypBiMultiplyWords (
+    PBIG_INTEGER_WORD Result,
+    PBIG_INTEGER_WORD Left,
+    PBIG_INTEGER_WORD Right,
+    UINTN Size,
+    PBIG_INTEGER_WORD Scratch
+    );
+
+BIG_INTEGER_WORD
+CypBiAddWords (
+    PBIG_INTEGER_WORD Result,
+    PBIG_INTEGER_WORD Left,
+    PBIG_INTEGER_WORD Right,
+    UINTN Size
+    );
+
+BIG_INTEGER_WORD
+CypBiSubtractWords (
+    PBIG_INTEGER_WORD Result,
+    PBIG_INTEGER_WORD Left,
+    PBIG_INTEGER_WORD Right,
+    UINTN Size
+    );
+
+VOID
+CypBiNegateWords (
+    PBIG_INTEGER_WORD Value,
+    UINTN Size,
+    BIG_INTEGER_WORD Mask
+    );
+
+VOID
+CypBiSelectWords (
+    PBIG_INTEGER_WORD Result,
+    PBIG_INTEGER_WORD Table,
+    UINTN TableCount,
+    UINTN TableIndex,
+    UINTN Size
+    );
+
 PBIG_INTEGER
 CypBiClone (
     PBIG_INTEGER_CONTEXT Context,
@@ -302,6 +429,12 @@ Return Value:
     ASSERT(Context->ActiveCount == 0);
 
     CypBiClearCache(Context);
+    if (Context->Scratch != NULL) {
+        Context->FreeMemory(Context->Scratch);
+        Context->Scratch = NULL;
+        Context->ScratchSize = 0;
+    }
+
     return;
 }
 
@@ -441,6 +574,43 @@ Return Value:
 
     CypBiMakePermanent(Context->Mu[ModOffset]);
     RadixCopy = NULL;
+
+    //
+    // Odd moduli (which all RSA moduli and primes are) can use Montgomery
+    // multiplication, which needs R^2 mod N. R is the radix raised to the
+    // size of the modulus, rounded up to whole machine words.
+    //
+
+    if ((Value->Components[0] & 0x1) != 0) {
+        RadixCopy = CypBiClone(Context, Context->Radix);
+        if (RadixCopy == NULL) {
+            goto BiCalculateModuliEnd;
+        }
+
+        Size = ALIGN_RANGE_UP(Size, BIG_INTEGER_WORD_COMPONENTS);
+        ShiftedRadix = CypBiLeftShiftComponent(Context,
+                                               RadixCopy,
+                                               (Size * 2) - 1);
+
+        if (ShiftedRadix == NULL) {
+            goto BiCalculateModuliEnd;
+        }
+
+        ASSERT(Context->RSquared[ModOffset] == NULL);
+
+        Context->RSquared[ModOffset] = CypBiDivide(Context,
+                                                   ShiftedRadix,
+                                                   Context->Modulus[ModOffset],
+                                                   TRUE);
+
+        if (Context->RSquared[ModOffset] == NULL) {
+            goto BiCalculateModuliEnd;
+        }
+
+        CypBiMakePermanent(Context->RSquared[ModOffset]);
+        RadixCopy = NULL;
+    }
+
     Status = STATUS_SUCCESS;
 
 BiCalculateModuliEnd:
@@ -501,6 +671,13 @@ Return Value:
         *Pointer = NULL;
     }
 
+    Pointer = &(Context->RSquared[ModOffset]);
+    if (*Pointer != NULL) {
+        CypBiMakeNonPermanent(*Pointer);
+        CypBiReleaseReference(Context, *Pointer);
+        *Pointer = NULL;
+    }
+
     return;
 }
 
@@ -515,7 +692,9 @@ CypBiExponentiateModulo (
 
 Routine Description:
 
-    This routine performs exponentiation, modulo a value.
+    This routine performs exponentiation, modulo a value. Odd moduli use
+    constant-time Montgomery exponentiation, others fall back to a sliding
+    window with Barrett reduction.
 
 Arguments:
 
@@ -547,6 +726,10 @@ Return Value:
     KSTATUS Status;
     INTN WindowSize;
 
+    if (Context->RSquared[Context->ModOffset] != NULL) {
+        return CypBiExponentiateMontgomery(Context, Value, Exponent);
+    }
+
     WindowSize = 1;
     LeadingBit = CypBiFindLeadingBit(Exponent);
 
@@ -2510,6 +2693,891 @@ Return Value:
     return Status;
 }
 
+PBIG_INTEGER
+CypBiExponentiateMontgomery (
+    PBIG_INTEGER_CONTEXT Context,
+    PBIG_INTEGER Value,
+    PBIG_INTEGER Exponent
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs exponentiation modulo an odd value using Montgomery
+    multiplication on native machine words. The exponent is consumed in
+    fixed-size windows, and every window performs the same sequence of
+    squares, multiplies, and table reads regardless of the exponent bits, so
+    the running time does not depend on the (usually secret) exponent value
+    beyond its length.
+
+Arguments:
+
+    Context - Supplies a pointer to the big integer context.
+
+    Value - Supplies a pointer to the value to reduce. A reference on this
+        value will be released on success.
+
+    Exponent - Supplies the exponent to raise the value to. A reference on this
+        value will be released on success.
+
+Return Value:
+
+    Returns a pointer to the exponentiated value on success.
+
+    NULL on allocation failure.
+
+--*/
+
+{
+
+    PBIG_INTEGER_WORD Accumulator;
+    PBIG_INTEGER Base;
+    INTN BitIndex;
+    UINTN Digit;
+    PBIG_INTEGER_WORD Entry;
+    BIG_INTEGER_WORD Factor;
+    UINTN Index;
+    INTN LeadingBit;
+    UINTN ModOffset;
+    PBIG_INTEGER Modulus;
+    PBIG_INTEGER_WORD ModulusWords;
+    PBIG_INTEGER NewValue;
+    PBIG_INTEGER Result;
+    PBIG_INTEGER_WORD Scratch;
+    UINTN ScratchSize;
+    UINTN Size;
+    PBIG_INTEGER_WORD Table;
+    UINTN TableCount;
+    INTN WindowIndex;
+    INTN WindowSize;
+    PBIG_INTEGER_WORD Work;
+
+    ModOffset = Context->ModOffset;
+    Modulus = Context->Modulus[ModOffset];
+    Size = ALIGN_RANGE_UP(Modulus->Size, BIG_INTEGER_WORD_COMPONENTS) /
+           BIG_INTEGER_WORD_COMPONENTS;
+
+    Result = NULL;
+    LeadingBit = CypBiFindLeadingBit(Exponent);
+
+    ASSERT(LeadingBit > 0);
+
+    //
+    // Work out a reasonable window size, as the sliding window version does.
+    //
+
+    WindowSize = 1;
+    for (BitIndex = LeadingBit; BitIndex > 32; BitIndex /= 5) {
+        WindowSize += 1;
+    }
+
+    //
+    // Carve up the scratch space: the modulus, the table of powers, the
+    // accumulator, the selected table entry, and the working space for a
+    // multiply.
+    //
+
+    TableCount = 1 << WindowSize;
+    ScratchSize = ((TableCount + 3) * Size) +
+                  CypBiMontgomeryScratchSize(Size);
+
+    Scratch = CypBiReserveScratch(Context,
+                                  ScratchSize * sizeof(BIG_INTEGER_WORD));
+
+    if (Scratch == NULL) {
+        return NULL;
+    }
+
+    ModulusWords = Scratch;
+    Table = ModulusWords + Size;
+    Accumulator = Table + (TableCount * Size);
+    Entry = Accumulator + Size;
+    Work = Entry + Size;
+    CypBiLoadWords(ModulusWords, Size, Modulus);
+
+    //
+    // Compute -1/N modulo the word radix with Newton's method, where each
+    // iteration doubles the number of correct low bits. An odd number is its
+    // own inverse modulo 8, so start with 3 correct bits.
+    //
+
+    Factor = ModulusWords[0];
+    for (Index = 3; Index < BIG_INTEGER_WORD_BITS; Index *= 2) {
+        Factor *= 2 - (ModulusWords[0] * Factor);
+    }
+
+    Factor = 0 - Factor;
+
+    //
+    // Reduce the base if needed. Work on a copy since the same value may be
+    // used against several moduli.
+    //
+
+    Base = CypBiClone(Context, Value);
+    if (Base == NULL) {
+        goto BiExponentiateMontgomeryEnd;
+    }
+
+    if (CypBiCompare(Base, Modulus) >= 0) {
+        NewValue = CypBiResidue(Context, Base);
+        if (NewValue == NULL) {
+            CypBiReleaseReference(Context, Base);
+            goto BiExponentiateMontgomeryEnd;
+        }
+
+        ASSERT(NewValue == Base);
+    }
+
+    CypBiLoadWords(Entry, Size, Base);
+    CypBiReleaseReference(Context, Base);
+
+    //
+    // Table entry zero is one in Montgomery form (R mod N), which is R^2
+    // reduced once. Entry one is the base converted to Montgomery form, and
+    // each other entry is the previous one times the base.
+    //
+
+    CypBiLoadWords(Accumulator, Size, Context->RSquared[ModOffset]);
+    RtlZeroMemory(Work, ((Size * 2) + 1) * sizeof(BIG_INTEGER_WORD));
+    RtlCopyMemory(Work, Accumulator, Size * sizeof(BIG_INTEGER_WORD));
+    CypBiMontgomeryReduce(Table, Work, ModulusWords, Factor, Size);
+    CypBiMontgomeryMultiply(Table + Size,
+                            Entry,
+                            Accumulator,
+                            ModulusWords,
+                            Factor,
+                            Size,
+                            Work);
+
+    for (Index = 2; Index < TableCount; Index += 1) {
+        CypBiMontgomeryMultiply(Table + (Index * Size),
+                                Table + ((Index - 1) * Size),
+                                Table + Size,
+                                ModulusWords,
+                                Factor,
+                                Size,
+                                Work);
+    }
+
+    //
+    // Walk the exponent a window at a time from the top, squaring the
+    // accumulator once per bit and then multiplying in the table entry for
+    // the window. The first window just loads the accumulator.
+    //
+
+    WindowIndex = (LeadingBit / WindowSize) * WindowSize;
+    while (WindowIndex >= 0) {
+        Digit = 0;
+        for (BitIndex = WindowIndex + WindowSize - 1;
+             BitIndex >= WindowIndex;
+             BitIndex -= 1) {
+
+            Digit <<= 1;
+            if ((BitIndex <= LeadingBit) &&
+                (CypBiTestBit(Exponent, BitIndex) != FALSE)) {
+
+                Digit |= 1;
+            }
+        }
+
+        if (WindowIndex + WindowSize > LeadingBit) {
+            CypBiSelectWords(Accumulator, Table, TableCount, Digit, Size);
+
+        } else {
+            for (BitIndex = 0; BitIndex < WindowSize; BitIndex += 1) {
+                CypBiMontgomeryMultiply(Accumulator,
+                                        Accumulator,
+                                        Accumulator,
+                                        ModulusWords,
+                                        Factor,
+                                        Size,
+                                        Work);
+            }
+
+            CypBiSelectWords(Entry, Table, TableCount, Digit, Size);
+            CypBiMontgomeryMultiply(Accumulator,
+                                    Accumulator,
+                                    Entry,
+                                    ModulusWords,
+                                    Factor,
+                                    Size,
+                                    Work);
+        }
+
+        WindowIndex -= WindowSize;
+    }
+
+    //
+    // Convert out of Montgomery form by reducing once more.
+    //
+
+    RtlZeroMemory(Work, ((Size * 2) + 1) * sizeof(BIG_INTEGER_WORD));
+    RtlCopyMemory(Work, Accumulator, Size * sizeof(BIG_INTEGER_WORD));
+    CypBiMontgomeryReduce(Accumulator, Work, ModulusWords, Factor, Size);
+    Result = CypBiCreate(Context, Size * BIG_INTEGER_WORD_COMPONENTS);
+    if (Result == NULL) {
+        goto BiExponentiateMontgomeryEnd;
+    }
+
+    CypBiStoreWords(Result, Accumulator, Size);
+    CypBiReleaseReference(Context, Value);
+    CypBiReleaseReference(Context, Exponent);
+
+BiExponentiateMontgomeryEnd:
+
+    //
+    // Don't leave powers of secret values lying around.
+    //
+
+    RtlZeroMemory(Scratch, ScratchSize * sizeof(BIG_INTEGER_WORD));
+    return Result;
+}
+
+PVOID
+CypBiReserveScratch (
+    PBIG_INTEGER_CONTEXT Context,
+    UINTN Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine ensures the context's scratch space is at least the given
+    size.
+
+Arguments:
+
+    Context - Supplies a pointer to the big integer context.
+
+    Size - Supplies the required size of the scratch space in bytes.
+
+Return Value:
+
+    Returns a pointer to the scratch space on success.
+
+    NULL on allocation failure.
+
+--*/
+
+{
+
+    PVOID NewScratch;
+
+    if (Context->ScratchSize >= Size) {
+        return Context->Scratch;
+    }
+
+    //
+    // The old contents are not needed, so free rather than reallocate.
+    //
+
+    NewScratch = Context->AllocateMemory(Size);
+    if (NewScratch == NULL) {
+        return NULL;
+    }
+
+    if (Context->Scratch != NULL) {
+        Context->FreeMemory(Context->Scratch);
+    }
+
+    Context->Scratch = NewScratch;
+    Context->ScratchSize = Size;
+    return NewScratch;
+}
+
+VOID
+CypBiLoadWords (
+    PBIG_INTEGER_WORD Words,
+    UINTN Size,
+    PBIG_INTEGER Value
+    )
+
+/*++
+
+Routine Description:
+
+    This routine packs the components of a big integer into an array of
+    machine words, zero extending it to the given size.
+
+Arguments:
+
+    Words - Supplies a pointer where the words will be returned.
+
+    Size - Supplies the number of words to fill in.
+
+    Value - Supplies a pointer to the big integer to load. This must fit in
+        the given number of words.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    BIG_INTEGER_WORD Component;
+    UINTN Index;
+    UINTN Shift;
+
+    ASSERT(Value->Size <= Size * BIG_INTEGER_WORD_COMPONENTS);
+
+    RtlZeroMemory(Words, Size * sizeof(BIG_INTEGER_WORD));
+    for (Index = 0; Index < Value->Size; Index += 1) {
+        Shift = (Index % BIG_INTEGER_WORD_COMPONENTS) *
+                BIG_INTEGER_COMPONENT_BITS;
+
+        Component = Value->Components[Index];
+        Words[Index / BIG_INTEGER_WORD_COMPONENTS] |= Component << Shift;
+    }
+
+    return;
+}
+
+VOID
+CypBiStoreWords (
+    PBIG_INTEGER Value,
+    PBIG_INTEGER_WORD Words,
+    UINTN Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine unpacks an array of machine words into a big integer.
+
+Arguments:
+
+    Value - Supplies a pointer to the big integer, which must already have
+        room for the given number of words.
+
+    Words - Supplies a pointer to the words to store.
+
+    Size - Supplies the number of words to store.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UINTN Index;
+    UINTN Shift;
+    BIG_INTEGER_WORD Word;
+
+    ASSERT(Value->Size == Size * BIG_INTEGER_WORD_COMPONENTS);
+
+    for (Index = 0; Index < Value->Size; Index += 1) {
+        Shift = (Index % BIG_INTEGER_WORD_COMPONENTS) *
+                BIG_INTEGER_COMPONENT_BITS;
+
+        Word = Words[Index / BIG_INTEGER_WORD_COMPONENTS];
+        Value->Components[Index] = (BIG_INTEGER_COMPONENT)(Word >> Shift);
+    }
+
+    CypBiTrim(Value);
+    return;
+}
+
+UINTN
+CypBiMontgomeryScratchSize (
+    UINTN Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine returns the number of scratch words needed by a
+    Montgomery multiply of the given size.
+
+Arguments:
+
+    Size - Supplies the number of words in the modulus.
+
+Return Value:
+
+    Returns the number of words of scratch space to supply.
+
+--*/
+
+{
+
+    UINTN Total;
+
+    //
+    // The product takes twice the size plus a carry word, and each level
+    // of Karatsuba takes three times its size plus two on top of that.
+    //
+
+    Total = (Size * 2) + 1;
+    while ((Size >= BIG_INTEGER_KARATSUBA_THRESHOLD) && ((Size & 1) == 0)) {
+        Total += (Size * 3) + 2;
+        Size /= 2;
+    }
+
+    return Total;
+}
+
+VOID
+CypBiMontgomeryMultiply (
+    PBIG_INTEGER_WORD Result,
+    PBIG_INTEGER_WORD Left,
+    PBIG_INTEGER_WORD Right,
+    PBIG_INTEGER_WORD Modulus,
+    BIG_INTEGER_WORD Factor,
+    UINTN Size,
+    PBIG_INTEGER_WORD Scratch
+    )
+
+/*++
+
+Routine Description:
+
+    This routine computes Left * Right / R modulo the given modulus, where R
+    is the word radix raised to the given size.
+
+Arguments:
+
+    Result - Supplies a pointer where the result will be returned. This may
+        be the same as either of the operands.
+
+    Left - Supplies a pointer to the left operand, which must be less than the
+        modulus.
+
+    Right - Supplies a pointer to the right operand, which must be less than
+        the modulus.
+
+    Modulus - Supplies a pointer to the odd modulus.
+
+    Factor - Supplies the negative inverse of the lowest modulus word.
+
+    Size - Supplies the number of words in the operands and modulus.
+
+    Scratch - Supplies a pointer to scratch space, sized as indicated by
+        CypBiMontgomeryScratchSize.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    Scratch[Size * 2] = 0;
+    CypBiMultiplyWords(Scratch, Left, Right, Size, Scratch + (Size * 2) + 1);
+    CypBiMontgomeryReduce(Result, Scratch, Modulus, Factor, Size);
+    return;
+}
+
+VOID
+CypBiMontgomeryReduce (
+    PBIG_INTEGER_WORD Result,
+    PBIG_INTEGER_WORD Product,
+    PBIG_INTEGER_WORD Modulus,
+    BIG_INTEGER_WORD Factor,
+    UINTN Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine performs a Montgomery reduction, computing Product / R modulo
+    the given modulus. The final subtraction is done unconditionally and
+    selected with a mask so that timing does not depend on the values.
+
+Arguments:
+
+    Result - Supplies a pointer where the reduced value will be returned.
+
+    Product - Supplies a pointer to the value to reduce, which is twice the
+        size plus one words long and must be less than the modulus times
+        R. This buffer is clobbered.
+
+    Modulus - Supplies a pointer to the odd modulus.
+
+    Factor - Supplies the negative inverse of the lowest modulus word.
+
+    Size - Supplies the number of words in the modulus.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    BIG_INTEGER_WORD Borrow;
+    BIG_INTEGER_WORD Carry;
+    UINTN Index;
+    UINTN InnerIndex;
+    BIG_INTEGER_WORD Mask;
+    BIG_INTEGER_WORD Multiplier;
+    BIG_INTEGER_DOUBLE_WORD Sum;
+    BIG_INTEGER_WORD Top;
+
+    Top = 0;
+    for (Index = 0; Index < Size; Index += 1) {
+        Multiplier = Product[Index] * Factor;
+        Carry = 0;
+        for (InnerIndex = 0; InnerIndex < Size; InnerIndex += 1) {
+            Sum = (BIG_INTEGER_DOUBLE_WORD)Product[Index + InnerIndex] +
+                  ((BIG_INTEGER_DOUBLE_WORD)Multiplier *
+                   Modulus[InnerIndex]) + Carry;
+
+            Product[Index + InnerIndex] = (BIG_INTEGER_WORD)Sum;
+            Carry = Sum >> BIG_INTEGER_WORD_BITS;
+        }
+
+        Sum = (BIG_INTEGER_DOUBLE_WORD)Product[Index + Size] + Carry + Top;
+        Product[Index + Size] = (BIG_INTEGER_WORD)Sum;
+        Top = Sum >> BIG_INTEGER_WORD_BITS;
+    }
+
+    //
+    // The value is now in the upper half, plus a possible top bit. Take the
+    // subtracted version if the value was at least the modulus.
+    //
+
+    Borrow = CypBiSubtractWords(Result, Product + Size, Modulus, Size);
+    Mask = 0 - (Top | (Borrow ^ 1));
+    for (Index = 0; Index < Size; Index += 1) {
+        Result[Index] = (Result[Index] & Mask) |
+                        (Product[Index + Size] & ~Mask);
+    }
+
+    return;
+}
+
+VOID
+CypBiMultiplyWords (
+    PBIG_INTEGER_WORD Result,
+    PBIG_INTEGER_WORD Left,
+    PBIG_INTEGER_WORD Right,
+    UINTN Size,
+    PBIG_INTEGER_WORD Scratch
+    )
+
+/*++
+
+Routine Description:
+
+    This routine multiplies two equally sized word arrays. Large
+    operands are split in half and multiplied with Karatsuba's method, which
+    trades one of the four half-sized multiplies for a few additions.
+
+Arguments:
+
+    Result - Supplies a pointer where the product will be returned. This must
+        be twice the size, and may not overlap the operands.
+
+    Left - Supplies a pointer to the left operand.
+
+    Right - Supplies a pointer to the right operand.
+
+    Size - Supplies the number of words in each operand.
+
+    Scratch - Supplies a pointer to scratch space for the Karatsuba
+        intermediates.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    BIG_INTEGER_WORD Carry;
+    PBIG_INTEGER_WORD Difference;
+    UINTN Half;
+    UINTN Index;
+    BIG_INTEGER_WORD LeftSign;
+    BIG_INTEGER_WORD Mask;
+    PBIG_INTEGER_WORD Middle;
+    PBIG_INTEGER_WORD MiddleProduct;
+    UINTN RightIndex;
+    BIG_INTEGER_WORD RightSign;
+    BIG_INTEGER_DOUBLE_WORD Sum;
+
+    if ((Size < BIG_INTEGER_KARATSUBA_THRESHOLD) || ((Size & 1) != 0)) {
+        RtlZeroMemory(Result, Size * 2 * sizeof(BIG_INTEGER_WORD));
+        for (RightIndex = 0; RightIndex < Size; RightIndex += 1) {
+            Carry = 0;
+            for (Index = 0; Index < Size; Index += 1) {
+                Sum = (BIG_INTEGER_DOUBLE_WORD)Result[RightIndex + Index] +
+                      ((BIG_INTEGER_DOUBLE_WORD)Left[Index] *
+                       Right[RightIndex]) + Carry;
+
+                Result[RightIndex + Index] = (BIG_INTEGER_WORD)Sum;
+                Carry = Sum >> BIG_INTEGER_WORD_BITS;
+            }
+
+            Result[RightIndex + Size] = Carry;
+        }
+
+        return;
+    }
+
+    //
+    // With Left = L1:L0 and Right = R1:R0, the low and high halves of the
+    // result are L0*R0 and L1*R1. The middle term L0*R1 + L1*R0 is
+    // L0*R0 + L1*R1 + (L0 - L1)*(R1 - R0). The differences are kept as
+    // magnitudes with separate signs so everything stays unsigned.
+    //
+
+    Half = Size / 2;
+    Difference = Scratch;
+    MiddleProduct = Difference + Size;
+    Middle = MiddleProduct + Size + 1;
+    Scratch = Middle + Size + 1;
+    CypBiMultiplyWords(Result, Left, Right, Half, Scratch);
+    CypBiMultiplyWords(Result + Size, Left + Half, Right + Half, Half, Scratch);
+    LeftSign = CypBiSubtractWords(Difference, Left, Left + Half, Half);
+    CypBiNegateWords(Difference, Half, 0 - LeftSign);
+    RightSign = CypBiSubtractWords(Difference + Half,
+                                   Right + Half,
+                                   Right,
+                                   Half);
+
+    CypBiNegateWords(Difference + Half, Half, 0 - RightSign);
+    CypBiMultiplyWords(MiddleProduct,
+                       Difference,
+                       Difference + Half,
+                       Half,
+                       Scratch);
+
+    MiddleProduct[Size] = 0;
+    Mask = 0 - (LeftSign ^ RightSign);
+    CypBiNegateWords(MiddleProduct, Size + 1, Mask);
+    Middle[Size] = CypBiAddWords(Middle, Result, Result + Size, Size);
+    CypBiAddWords(Middle, Middle, MiddleProduct, Size + 1);
+
+    //
+    // Add the middle term in at the half way point, and carry all the way to
+    // the top.
+    //
+
+    Carry = CypBiAddWords(Result + Half, Result + Half, Middle, Size + 1);
+    for (Index = Half + Size + 1; Index < Size * 2; Index += 1) {
+        Sum = (BIG_INTEGER_DOUBLE_WORD)Result[Index] + Carry;
+        Result[Index] = (BIG_INTEGER_WORD)Sum;
+        Carry = Sum >> BIG_INTEGER_WORD_BITS;
+    }
+
+    ASSERT(Carry == 0);
+
+    return;
+}
+
+BIG_INTEGER_WORD
+CypBiAddWords (
+    PBIG_INTEGER_WORD Result,
+    PBIG_INTEGER_WORD Left,
+    PBIG_INTEGER_WORD Right,
+    UINTN Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine adds two equally sized word arrays.
+
+Arguments:
+
+    Result - Supplies a pointer where the sum will be returned. This may be
+        the same as either operand.
+
+    Left - Supplies a pointer to the left operand.
+
+    Right - Supplies a pointer to the right operand.
+
+    Size - Supplies the number of words in each array.
+
+Return Value:
+
+    Returns the carry out of the top word.
+
+--*/
+
+{
+
+    BIG_INTEGER_WORD Carry;
+    UINTN Index;
+    BIG_INTEGER_DOUBLE_WORD Sum;
+
+    Carry = 0;
+    for (Index = 0; Index < Size; Index += 1) {
+        Sum = (BIG_INTEGER_DOUBLE_WORD)Left[Index] + Right[Index] + Carry;
+        Result[Index] = (BIG_INTEGER_WORD)Sum;
+        Carry = Sum >> BIG_INTEGER_WORD_BITS;
+    }
+
+    return Carry;
+}
+
+BIG_INTEGER_WORD
+CypBiSubtractWords (
+    PBIG_INTEGER_WORD Result,
+    PBIG_INTEGER_WORD Left,
+    PBIG_INTEGER_WORD Right,
+    UINTN Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine subtracts two equally sized word arrays.
+
+Arguments:
+
+    Result - Supplies a pointer where the difference will be returned. This
+        may be the same as either operand.
+
+    Left - Supplies a pointer to the value to subtract from.
+
+    Right - Supplies a pointer to the value to subtract.
+
+    Size - Supplies the number of words in each array.
+
+Return Value:
+
+    Returns 1 if the subtraction borrowed out of the top word (meaning
+    the right value was larger), or 0 otherwise.
+
+--*/
+
+{
+
+    BIG_INTEGER_WORD Borrow;
+    BIG_INTEGER_DOUBLE_WORD Difference;
+    UINTN Index;
+
+    Borrow = 0;
+    for (Index = 0; Index < Size; Index += 1) {
+        Difference = (BIG_INTEGER_DOUBLE_WORD)Left[Index] - Right[Index] -
+                     Borrow;
+
+        Result[Index] = (BIG_INTEGER_WORD)Difference;
+        Borrow = (Difference >> BIG_INTEGER_WORD_BITS) & 0x1;
+    }
+
+    return Borrow;
+}
+
+VOID
+CypBiNegateWords (
+    PBIG_INTEGER_WORD Value,
+    UINTN Size,
+    BIG_INTEGER_WORD Mask
+    )
+
+/*++
+
+Routine Description:
+
+    This routine takes the two's complement of a word array if the mask
+    is all ones, or leaves it alone if the mask is zero.
+
+Arguments:
+
+    Value - Supplies a pointer to the value to conditionally negate.
+
+    Size - Supplies the number of words in the value.
+
+    Mask - Supplies either zero or all ones.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    BIG_INTEGER_WORD Carry;
+    UINTN Index;
+    BIG_INTEGER_DOUBLE_WORD Sum;
+
+    Carry = Mask & 0x1;
+    for (Index = 0; Index < Size; Index += 1) {
+        Sum = (BIG_INTEGER_DOUBLE_WORD)(Value[Index] ^ Mask) + Carry;
+        Value[Index] = (BIG_INTEGER_WORD)Sum;
+        Carry = Sum >> BIG_INTEGER_WORD_BITS;
+    }
+
+    return;
+}
+
+VOID
+CypBiSelectWords (
+    PBIG_INTEGER_WORD Result,
+    PBIG_INTEGER_WORD Table,
+    UINTN TableCount,
+    UINTN TableIndex,
+    UINTN Size
+    )
+
+/*++
+
+Routine Description:
+
+    This routine copies an entry out of a table of values. Every entry is
+    read so that the memory access pattern does not reveal the index.
+
+Arguments:
+
+    Result - Supplies a pointer where the selected entry will be copied.
+
+    Table - Supplies a pointer to the table of values, laid out contiguously.
+
+    TableCount - Supplies the number of entries in the table.
+
+    TableIndex - Supplies the index of the entry to select.
+
+    Size - Supplies the number of words in each entry.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    UINTN Index;
+    UINTN InnerIndex;
+    BIG_INTEGER_WORD Mask;
+
+    RtlZeroMemory(Result, Size * sizeof(BIG_INTEGER_WORD));
+    for (Index = 0; Index < TableCount; Index += 1) {
+
+        //
+        // The mask is all ones only when the difference is zero.
+        //
+
+        Mask = (BIG_INTEGER_WORD)(Index ^ TableIndex);
+        Mask = ((Mask | (0 - Mask)) >> (BIG_INTEGER_WORD_BITS - 1)) - 1;
+        for (InnerIndex = 0; InnerIndex < Size; InnerIndex += 1) {
+            Result[InnerIndex] |= Table[InnerIndex] & Mask;
+        }
+
+        Table += Size;
+    }
+
+    return;
+}
+
 PBIG_INTEGER
 CypBiClone (
     PBIG_INTEGER_CONTEXT Context,
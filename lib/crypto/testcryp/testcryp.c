@@ -47,6 +47,34 @@ Module Name:
 // ---------------------------------------------------------------- Definitions
 //
 
+//
+// Define how long each benchmark runs for.
+//
+
+#define TEST_CRYPTO_BENCHMARK_TIME CLOCKS_PER_SEC
+
+//
+// Define the size of the buffer hashed by the hash benchmark, and the size
+// of each message in the multi-buffer hash benchmark.
+//
+
+#define TEST_CRYPTO_HASH_BENCHMARK_SIZE (1024 * 1024)
+#define TEST_CRYPTO_HASH_MESSAGE_SIZE 1024
+
+//
+// Define the size of each piece fed to the hash functions when testing that
+// split input hashes the same as contiguous input.
+//
+
+#define TEST_CRYPTO_HASH_PIECE_SIZE 13
+
+//
+// Define the number of known answer sizes for the hash tests.
+//
+
+#define TEST_CRYPTO_HASH_SIZE_COUNT \
+    (sizeof(TestCrypHashDataSizes) / sizeof(TestCrypHashDataSizes[0]))
+
 //
 // ------------------------------------------------------ Data Type Definitions
 //
@@ -80,6 +108,31 @@ TestRsa (
     VOID
     );
 
+ULONG
+TestAes (
+    VOID
+    );
+
+ULONG
+TestShaMultiple (
+    VOID
+    );
+
+ULONG
+TestRsaBenchmark (
+    VOID
+    );
+
+VOID
+TestHashBenchmark (
+    VOID
+    );
+
+ULONGLONG
+TestReadCycleCounter (
+    VOID
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -371,6 +424,94 @@ PSTR TestCrypRsaPrivateKey =
 
 PSTR TestCrypRsaPrivateKeyPassword = "1234";
 
+UCHAR TestCrypAesKey[] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09,
+    0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10, 0x11, 0x12, 0x13,
+    0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D,
+    0x1E, 0x1F
+};
+
+UCHAR TestCrypAesInitializationVector[AES_BLOCK_SIZE] = {
+    0xF0, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9,
+    0xFA, 0xFB, 0xFC, 0xFD, 0xFE, 0xFF
+};
+
+UCHAR TestCrypAesCbc128Answer[] = {
+    0x62, 0x55, 0x08, 0x17, 0x7D, 0xAB, 0xEB, 0x19, 0xF4, 0xE1,
+    0x5D, 0x35, 0xAC, 0x1B, 0x8D, 0xCB, 0x4B, 0xBB, 0x2B, 0x96,
+    0xE6, 0xD1, 0xF7, 0x38, 0x61, 0x0A, 0x58, 0x36, 0x96, 0xE9,
+    0x4F, 0xFA, 0x2E, 0xB5, 0xE8, 0x1A, 0x43, 0x31, 0xDA, 0x61,
+    0x76, 0xAC, 0x51, 0xD1, 0xA6, 0x93, 0x43, 0x0E, 0x00, 0xE8,
+    0x50, 0xDB, 0x0A, 0x95, 0x9C, 0x93, 0xDA, 0x7B, 0xCE, 0xE6,
+    0x81, 0xEB, 0xCE, 0x92, 0x34, 0x78, 0x48, 0xEF, 0x2D, 0xA9,
+    0x45, 0xC9, 0x84, 0xFF, 0xE6, 0x0E, 0xEE, 0x90, 0xBF, 0x19,
+    0xC5, 0x7C, 0x56, 0x9D, 0x4F, 0x3E, 0xEB, 0x33, 0x2C, 0xC1,
+    0xA1, 0xA8, 0x64, 0x1B, 0xD7, 0x61, 0xC8, 0xDA, 0x9D, 0xF4,
+    0x3B, 0x9C, 0x5C, 0x8D, 0x52, 0x0C, 0x5E, 0x62, 0xBF, 0x4C,
+    0x33, 0xE5, 0xA2, 0xA8, 0x58, 0x5C, 0x53, 0x2E, 0xF0, 0x32,
+    0x48, 0xF2, 0xE5, 0xFA, 0xE6, 0x83, 0x16, 0x7F, 0x3D, 0xD7,
+    0xF4, 0xBE, 0x5E, 0x58, 0xDB, 0x63, 0xA4, 0xFE, 0x47, 0x77,
+    0xC3, 0xEC, 0xC6, 0xB5, 0x3E, 0x87, 0x35, 0xFB, 0xC6, 0x1F,
+    0x1A, 0x94, 0x00, 0xD6, 0xF1, 0x37, 0xE2, 0xE4, 0xA8, 0x2A
+};
+
+UCHAR TestCrypAesCtr256Answer[] = {
+    0xA2, 0x31, 0xFF, 0xBE, 0x17, 0xA3, 0xB6, 0xFC, 0x62, 0x50,
+    0xA7, 0x16, 0x03, 0x76, 0x26, 0x52, 0xAB, 0x3D, 0x18, 0x24,
+    0x94, 0x4C, 0x53, 0xA9, 0x07, 0xCD, 0x3E, 0x4D, 0x27, 0x19,
+    0xE9, 0xFE, 0xA9, 0x5D, 0x13, 0x68, 0x20, 0x2D, 0xC3, 0xAF,
+    0x40, 0xBC, 0x61, 0x52, 0xD6, 0x10, 0xB7, 0xC9, 0x28, 0x0A,
+    0xA0, 0x49, 0xB3, 0x96, 0x80, 0x4A, 0x7A, 0x71, 0xB7, 0x98,
+    0x91, 0x0D, 0x37, 0xD4, 0x86, 0x35, 0x49, 0xEA, 0x4D, 0x49,
+    0xCC, 0xD5, 0xC2, 0xB4, 0x5E, 0x9B, 0x24, 0xD2, 0x70, 0xD1,
+    0x69, 0xBD, 0x83, 0x08, 0xDF, 0x6E, 0xF4, 0x60, 0x1A, 0x93,
+    0x2D, 0xE7, 0xA1, 0x98, 0x19, 0xC7, 0xC5, 0xB9, 0xD3, 0x38,
+    0x78, 0x52, 0xBE, 0x73, 0x0A, 0x86, 0x84, 0x6E, 0x3B, 0x25,
+    0xC2, 0x6D, 0x99, 0x74, 0x23, 0xAB, 0xA2, 0xCC, 0x0A, 0x17,
+    0xE8, 0x94, 0x76, 0x68, 0x72, 0x19, 0x61, 0x62, 0x2B, 0x56,
+    0x6E, 0xB3, 0x20, 0xB5, 0x82, 0xA0, 0x30, 0x66, 0x4D, 0x5B,
+    0xA3, 0x7B, 0xFE, 0xBF, 0x94, 0x05, 0x12, 0xAB, 0xAC, 0x13,
+    0x4C, 0xCE, 0xB4, 0xD3, 0x70, 0x31, 0x10, 0xCC, 0x67, 0x8A
+};
+
+UCHAR TestCrypGcmKey[AES_GCM128_KEY_SIZE] = {
+    0xFE, 0xFF, 0xE9, 0x92, 0x86, 0x65, 0x73, 0x1C, 0x6D, 0x6A,
+    0x8F, 0x94, 0x67, 0x30, 0x83, 0x08
+};
+
+UCHAR TestCrypGcmInitializationVector[AES_GCM_INITIALIZATION_VECTOR_SIZE] = {
+    0xCA, 0xFE, 0xBA, 0xBE, 0xFA, 0xCE, 0xDB, 0xAD, 0xDE, 0xCA,
+    0xF8, 0x88
+};
+
+UCHAR TestCrypGcmAdditionalData[] = {
+    0xFE, 0xED, 0xFA, 0xCE, 0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xED,
+    0xFA, 0xCE, 0xDE, 0xAD, 0xBE, 0xEF, 0xAB, 0xAD, 0xDA, 0xD2
+};
+
+UCHAR TestCrypGcmPlaintext[] = {
+    0xD9, 0x31, 0x32, 0x25, 0xF8, 0x84, 0x06, 0xE5, 0xA5, 0x59,
+    0x09, 0xC5, 0xAF, 0xF5, 0x26, 0x9A, 0x86, 0xA7, 0xA9, 0x53,
+    0x15, 0x34, 0xF7, 0xDA, 0x2E, 0x4C, 0x30, 0x3D, 0x8A, 0x31,
+    0x8A, 0x72, 0x1C, 0x3C, 0x0C, 0x95, 0x95, 0x68, 0x09, 0x53,
+    0x2F, 0xCF, 0x0E, 0x24, 0x49, 0xA6, 0xB5, 0x25, 0xB1, 0x6A,
+    0xED, 0xF5, 0xAA, 0x0D, 0xE6, 0x57, 0xBA, 0x63, 0x7B, 0x39
+};
+
+UCHAR TestCrypGcmCiphertext[] = {
+    0x42, 0x83, 0x1E, 0xC2, 0x21, 0x77, 0x74, 0x24, 0x4B, 0x72,
+    0x21, 0xB7, 0x84, 0xD0, 0xD4, 0x9C, 0xE3, 0xAA, 0x21, 0x2F,
+    0x2C, 0x02, 0xA4, 0xE0, 0x35, 0xC1, 0x7E, 0x23, 0x29, 0xAC,
+    0xA1, 0x2E, 0x21, 0xD5, 0x14, 0xB2, 0x54, 0x66, 0x93, 0x1C,
+    0x7D, 0x8F, 0x6A, 0x5A, 0xAC, 0x84, 0xAA, 0x05, 0x1B, 0xA3,
+    0x0B, 0x39, 0x6A, 0x0A, 0xAC, 0x97, 0x3D, 0x58, 0xE0, 0x91
+};
+
+UCHAR TestCrypGcmTag[AES_GCM_TAG_SIZE] = {
+    0x5B, 0xC9, 0x4F, 0xBC, 0x32, 0x21, 0xA5, 0xDB, 0x94, 0xFA,
+    0xE9, 0x5A, 0xE7, 0x12, 0x1A, 0x47
+};
+
 //
 // ------------------------------------------------------------------ Functions
 //
@@ -386,7 +527,7 @@ main (
 Routine Description:
 
     This routine is the entry point for the crypto library test program. It
-    executes the tests.
+    executes the tests, and the benchmarks if -b is specified.
 
 Arguments:
 
@@ -404,8 +545,14 @@ Return Value:
 
 {
 
+    BOOL Benchmark;
     ULONG TestsFailed;
 
+    Benchmark = FALSE;
+    if ((ArgumentCount > 1) && (strcmp(Arguments[1], "-b") == 0)) {
+        Benchmark = TRUE;
+    }
+
     srand(time(NULL));
     TestsFailed = 0;
     TestsFailed += TestSha1();
@@ -413,6 +560,13 @@ Return Value:
     TestsFailed += TestSha512();
     TestsFailed += TestMd5();
     TestsFailed += TestRsa();
+    TestsFailed += TestAes();
+    TestsFailed += TestShaMultiple();
+    if (Benchmark != FALSE) {
+        TestsFailed += TestRsaBenchmark();
+        TestHashBenchmark();
+    }
+
     if (TestsFailed != 0) {
         printf("\n*** %d failures in Crypto test. ***\n", TestsFailed);
         return 1;
@@ -792,3 +946,599 @@ Return Value:
     return Failures;
 }
 
+ULONG
+TestAes (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine tests the AES cipher modes, including Galois/Counter Mode.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the number of test failures.
+
+--*/
+
+{
+
+    AES_CONTEXT Context;
+    ULONG Failures;
+    AES_GCM_CONTEXT GcmContext;
+    UCHAR InitializationVector[AES_BLOCK_SIZE];
+    UCHAR Output[sizeof(TestCrypAesCbc128Answer)];
+    UINTN Size;
+    KSTATUS Status;
+    UCHAR Tag[AES_GCM_TAG_SIZE];
+
+    Failures = 0;
+    Size = sizeof(TestCrypAesCbc128Answer);
+
+    //
+    // Test CBC against a known answer, then decrypt it in place.
+    //
+
+    CyAesInitialize(&Context,
+                    AesModeCbc128,
+                    TestCrypAesKey,
+                    TestCrypAesInitializationVector);
+
+    CyAesCbcEncrypt(&Context, (PUCHAR)TestCrypData, Output, Size);
+    if (RtlCompareMemory(Output, TestCrypAesCbc128Answer, Size) == FALSE) {
+        printf("AES CBC encrypt failed.\n");
+        Failures += 1;
+    }
+
+    CyAesInitialize(&Context,
+                    AesModeCbc128,
+                    TestCrypAesKey,
+                    TestCrypAesInitializationVector);
+
+    CyAesConvertKeyForDecryption(&Context);
+    CyAesCbcDecrypt(&Context, Output, Output, Size);
+    if (RtlCompareMemory(Output, TestCrypData, Size) == FALSE) {
+        printf("AES CBC decrypt failed.\n");
+        Failures += 1;
+    }
+
+    //
+    // Test CTR against a known answer and back.
+    //
+
+    CyAesInitialize(&Context,
+                    AesModeCtr256,
+                    TestCrypAesKey,
+                    TestCrypAesInitializationVector);
+
+    CyAesCtrEncrypt(&Context, (PUCHAR)TestCrypData, Output, Size);
+    if (RtlCompareMemory(Output, TestCrypAesCtr256Answer, Size) == FALSE) {
+        printf("AES CTR encrypt failed.\n");
+        Failures += 1;
+    }
+
+    CyAesInitialize(&Context,
+                    AesModeCtr256,
+                    TestCrypAesKey,
+                    TestCrypAesInitializationVector);
+
+    CyAesCtrDecrypt(&Context, Output, Output, Size);
+    if (RtlCompareMemory(Output, TestCrypData, Size) == FALSE) {
+        printf("AES CTR decrypt failed.\n");
+        Failures += 1;
+    }
+
+    //
+    // ECB has no known answer here, just make sure it goes round trip. Each
+    // block is the CBC answer with a zero IV, so check the first block too.
+    //
+
+    CyAesInitialize(&Context, AesModeEcb128, TestCrypAesKey, NULL);
+    RtlCopyMemory(Output, TestCrypData, Size);
+    RtlCopyMemory(InitializationVector,
+                  TestCrypAesInitializationVector,
+                  AES_BLOCK_SIZE);
+
+    for (Size = 0; Size < AES_BLOCK_SIZE; Size += 1) {
+        Output[Size] ^= InitializationVector[Size];
+    }
+
+    Size = sizeof(TestCrypAesCbc128Answer);
+    CyAesEcbEncrypt(&Context, Output, Output, Size);
+    if (RtlCompareMemory(Output, TestCrypAesCbc128Answer, AES_BLOCK_SIZE) ==
+        FALSE) {
+
+        printf("AES ECB encrypt failed.\n");
+        Failures += 1;
+    }
+
+    CyAesConvertKeyForDecryption(&Context);
+    CyAesEcbDecrypt(&Context, Output, Output, Size);
+    for (Size = 0; Size < AES_BLOCK_SIZE; Size += 1) {
+        Output[Size] ^= InitializationVector[Size];
+    }
+
+    Size = sizeof(TestCrypAesCbc128Answer);
+    if (RtlCompareMemory(Output, TestCrypData, Size) == FALSE) {
+        printf("AES ECB decrypt failed.\n");
+        Failures += 1;
+    }
+
+    //
+    // Test GCM with a message that ends in a partial block.
+    //
+
+    Size = sizeof(TestCrypGcmPlaintext);
+    CyAesGcmInitialize(&GcmContext, AesModeGcm128, TestCrypGcmKey);
+    CyAesGcmEncrypt(&GcmContext,
+                    TestCrypGcmInitializationVector,
+                    AES_GCM_INITIALIZATION_VECTOR_SIZE,
+                    TestCrypGcmAdditionalData,
+                    sizeof(TestCrypGcmAdditionalData),
+                    TestCrypGcmPlaintext,
+                    Output,
+                    Size,
+                    Tag,
+                    AES_GCM_TAG_SIZE);
+
+    if ((RtlCompareMemory(Output, TestCrypGcmCiphertext, Size) == FALSE) ||
+        (RtlCompareMemory(Tag, TestCrypGcmTag, AES_GCM_TAG_SIZE) == FALSE)) {
+
+        printf("AES GCM encrypt failed.\n");
+        Failures += 1;
+    }
+
+    Status = CyAesGcmDecrypt(&GcmContext,
+                             TestCrypGcmInitializationVector,
+                             AES_GCM_INITIALIZATION_VECTOR_SIZE,
+                             TestCrypGcmAdditionalData,
+                             sizeof(TestCrypGcmAdditionalData),
+                             Output,
+                             Output,
+                             Size,
+                             Tag,
+                             AES_GCM_TAG_SIZE);
+
+    if ((!KSUCCESS(Status)) ||
+        (RtlCompareMemory(Output, TestCrypGcmPlaintext, Size) == FALSE)) {
+
+        printf("AES GCM decrypt failed: %d.\n", Status);
+        Failures += 1;
+    }
+
+    //
+    // A tampered tag must be rejected.
+    //
+
+    Tag[AES_GCM_TAG_SIZE - 1] ^= 0x01;
+    Status = CyAesGcmDecrypt(&GcmContext,
+                             TestCrypGcmInitializationVector,
+                             AES_GCM_INITIALIZATION_VECTOR_SIZE,
+                             TestCrypGcmAdditionalData,
+                             sizeof(TestCrypGcmAdditionalData),
+                             TestCrypGcmCiphertext,
+                             Output,
+                             Size,
+                             Tag,
+                             AES_GCM_TAG_SIZE);
+
+    if (Status != STATUS_CHECKSUM_MISMATCH) {
+        printf("AES GCM accepted a bad tag.\n");
+        Failures += 1;
+    }
+
+    if (Failures != 0) {
+        printf("%d failures in AES test.\n", Failures);
+    }
+
+    return Failures;
+}
+
+ULONG
+TestShaMultiple (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine tests that hashing several messages at once produces the
+    same results as hashing them one at a time, and that messages fed in
+    small pieces hash the same as contiguous messages.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the number of failures.
+
+--*/
+
+{
+
+    UINTN Count;
+    ULONG Failures;
+    UCHAR Hashes[TEST_CRYPTO_HASH_SIZE_COUNT][SHA256_HASH_SIZE];
+    UINTN Index;
+    UINTN Lengths[TEST_CRYPTO_HASH_SIZE_COUNT];
+    PVOID Messages[TEST_CRYPTO_HASH_SIZE_COUNT];
+    UINTN Offset;
+    UINTN Piece;
+    SHA1_CONTEXT Sha1Context;
+    SHA256_CONTEXT Sha256Context;
+
+    Failures = 0;
+    Count = TEST_CRYPTO_HASH_SIZE_COUNT;
+    for (Index = 0; Index < Count; Index += 1) {
+        Messages[Index] = TestCrypData;
+        Lengths[Index] = TestCrypHashDataSizes[Index];
+    }
+
+    //
+    // There are more messages than lanes, so this also covers refilling the
+    // lanes as the shorter messages finish.
+    //
+
+    RtlZeroMemory(Hashes, sizeof(Hashes));
+    CySha256HashMultiple(Messages, Lengths, Count, (PUCHAR)Hashes);
+    for (Index = 0; Index < Count; Index += 1) {
+        if (memcmp(Hashes[Index],
+                   TestCrypSha256Answers[Index],
+                   SHA256_HASH_SIZE) != 0) {
+
+            printf("SHA256 multiple failed at size %lu.\n",
+                   (long)Lengths[Index]);
+
+            Failures += 1;
+        }
+    }
+
+    for (Index = 0; Index < Count; Index += 1) {
+        CySha1Initialize(&Sha1Context);
+        CySha256Initialize(&Sha256Context);
+        for (Offset = 0; Offset < Lengths[Index]; Offset += Piece) {
+            Piece = Lengths[Index] - Offset;
+            if (Piece > TEST_CRYPTO_HASH_PIECE_SIZE) {
+                Piece = TEST_CRYPTO_HASH_PIECE_SIZE;
+            }
+
+            CySha1AddContent(&Sha1Context,
+                             (PUCHAR)TestCrypData + Offset,
+                             Piece);
+
+            CySha256AddContent(&Sha256Context, TestCrypData + Offset, Piece);
+        }
+
+        CySha1GetHash(&Sha1Context, Hashes[0]);
+        if (memcmp(Hashes[0], TestCrypSha1Answers[Index], SHA1_HASH_SIZE) !=
+            0) {
+
+            printf("SHA1 in pieces failed at size %lu.\n",
+                   (long)Lengths[Index]);
+
+            Failures += 1;
+        }
+
+        CySha256GetHash(&Sha256Context, Hashes[0]);
+        if (memcmp(Hashes[0],
+                   TestCrypSha256Answers[Index],
+                   SHA256_HASH_SIZE) != 0) {
+
+            printf("SHA256 in pieces failed at size %lu.\n",
+                   (long)Lengths[Index]);
+
+            Failures += 1;
+        }
+    }
+
+    if (Failures != 0) {
+        printf("%d failures in SHA multiple test.\n", Failures);
+    }
+
+    return Failures;
+}
+
+ULONG
+TestRsaBenchmark (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine measures the rate of RSA private key operations, which is
+    what bounds the rate at which a server can complete TLS handshakes, as
+    well as the rate of public key operations.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the number of failures.
+
+--*/
+
+{
+
+    UCHAR CipherBuffer[512];
+    ULONG Count;
+    clock_t Elapsed;
+    ULONG Failures;
+    UCHAR PlainBuffer[512];
+    RSA_CONTEXT RsaContext;
+    INTN Size;
+    clock_t Start;
+    KSTATUS Status;
+
+    Failures = 0;
+    Size = 0;
+    RtlZeroMemory(&RsaContext, sizeof(RSA_CONTEXT));
+    RsaContext.BigIntegerContext.AllocateMemory = (PCY_ALLOCATE_MEMORY)malloc;
+    RsaContext.BigIntegerContext.ReallocateMemory =
+                                                (PCY_REALLOCATE_MEMORY)realloc;
+
+    RsaContext.BigIntegerContext.FreeMemory = (PCY_FREE_MEMORY)free;
+    Status = CyRsaInitializeContext(&RsaContext);
+    if (!KSUCCESS(Status)) {
+        Failures += 1;
+        return Failures;
+    }
+
+    Status = CyRsaAddPemFile(&RsaContext,
+                             TestCrypRsaPrivateKey,
+                             RtlStringLength(TestCrypRsaPrivateKey) + 1,
+                             TestCrypRsaPrivateKeyPassword);
+
+    if (!KSUCCESS(Status)) {
+        Failures += 1;
+        goto TestRsaBenchmarkEnd;
+    }
+
+    //
+    // Sign repeatedly for a while. Signing uses the private key, and costs
+    // the same as the server's half of an RSA key exchange.
+    //
+
+    Count = 0;
+    Start = clock();
+    do {
+        Size = CyRsaEncrypt(&RsaContext,
+                            TestCrypSha512Answers[0],
+                            SHA512_HASH_SIZE,
+                            CipherBuffer,
+                            TRUE);
+
+        if (Size <= 0) {
+            Failures += 1;
+            goto TestRsaBenchmarkEnd;
+        }
+
+        Count += 1;
+        Elapsed = clock() - Start;
+
+    } while (Elapsed < TEST_CRYPTO_BENCHMARK_TIME);
+
+    printf("RSA-%ld private: %u ops in %.2fs, %.1f handshakes/s\n",
+           (long)Size * BITS_PER_BYTE,
+           Count,
+           (double)Elapsed / CLOCKS_PER_SEC,
+           (double)Count * CLOCKS_PER_SEC / Elapsed);
+
+    Count = 0;
+    Start = clock();
+    do {
+        if (CyRsaDecrypt(&RsaContext, CipherBuffer, PlainBuffer, FALSE) !=
+            SHA512_HASH_SIZE) {
+
+            Failures += 1;
+            goto TestRsaBenchmarkEnd;
+        }
+
+        Count += 1;
+        Elapsed = clock() - Start;
+
+    } while (Elapsed < TEST_CRYPTO_BENCHMARK_TIME);
+
+    printf("RSA-%ld public: %u ops in %.2fs, %.1f ops/s\n",
+           (long)Size * BITS_PER_BYTE,
+           Count,
+           (double)Elapsed / CLOCKS_PER_SEC,
+           (double)Count * CLOCKS_PER_SEC / Elapsed);
+
+TestRsaBenchmarkEnd:
+    CyRsaDestroyContext(&RsaContext);
+    if (Failures != 0) {
+        printf("%d failures in RSA benchmark.\n", Failures);
+    }
+
+    return Failures;
+}
+
+VOID
+TestHashBenchmark (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine measures the throughput of the hash functions, in megabytes
+    per second and in processor cycles per byte where a cycle counter is
+    available.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PUCHAR Buffer;
+    ULONGLONG Bytes;
+    ULONGLONG Cycles;
+    clock_t Elapsed;
+    UCHAR Hashes[(TEST_CRYPTO_HASH_BENCHMARK_SIZE /
+                  TEST_CRYPTO_HASH_MESSAGE_SIZE) * SHA256_HASH_SIZE];
+
+    UINTN Index;
+    UINTN Lengths[TEST_CRYPTO_HASH_BENCHMARK_SIZE /
+                  TEST_CRYPTO_HASH_MESSAGE_SIZE];
+
+    MD5_CONTEXT Md5Context;
+    PVOID Messages[TEST_CRYPTO_HASH_BENCHMARK_SIZE /
+                   TEST_CRYPTO_HASH_MESSAGE_SIZE];
+
+    UINTN MessageCount;
+    PSTR Name;
+    SHA1_CONTEXT Sha1Context;
+    SHA256_CONTEXT Sha256Context;
+    SHA512_CONTEXT Sha512Context;
+    clock_t Start;
+    ULONGLONG StartCycles;
+    ULONG Test;
+
+    Buffer = malloc(TEST_CRYPTO_HASH_BENCHMARK_SIZE);
+    if (Buffer == NULL) {
+        return;
+    }
+
+    for (Index = 0; Index < TEST_CRYPTO_HASH_BENCHMARK_SIZE; Index += 1) {
+        Buffer[Index] = (UCHAR)rand();
+    }
+
+    MessageCount = TEST_CRYPTO_HASH_BENCHMARK_SIZE /
+                   TEST_CRYPTO_HASH_MESSAGE_SIZE;
+
+    for (Index = 0; Index < MessageCount; Index += 1) {
+        Messages[Index] = Buffer + (Index * TEST_CRYPTO_HASH_MESSAGE_SIZE);
+        Lengths[Index] = TEST_CRYPTO_HASH_MESSAGE_SIZE;
+    }
+
+    for (Test = 0; Test < 5; Test += 1) {
+        Bytes = 0;
+        Cycles = 0;
+        Start = clock();
+        do {
+            StartCycles = TestReadCycleCounter();
+            switch (Test) {
+            case 0:
+                Name = "SHA-1";
+                CySha1Initialize(&Sha1Context);
+                CySha1AddContent(&Sha1Context,
+                                 Buffer,
+                                 TEST_CRYPTO_HASH_BENCHMARK_SIZE);
+
+                CySha1GetHash(&Sha1Context, Hashes);
+                break;
+
+            case 1:
+                Name = "SHA-256";
+                CySha256Initialize(&Sha256Context);
+                CySha256AddContent(&Sha256Context,
+                                   Buffer,
+                                   TEST_CRYPTO_HASH_BENCHMARK_SIZE);
+
+                CySha256GetHash(&Sha256Context, Hashes);
+                break;
+
+            case 2:
+                Name = "SHA-512";
+                CySha512Initialize(&Sha512Context);
+                CySha512AddContent(&Sha512Context,
+                                   Buffer,
+                                   TEST_CRYPTO_HASH_BENCHMARK_SIZE);
+
+                CySha512GetHash(&Sha512Context, Hashes);
+                break;
+
+            case 3:
+                Name = "MD5";
+                CyMd5Initialize(&Md5Context);
+                CyMd5AddContent(&Md5Context,
+                                Buffer,
+                                TEST_CRYPTO_HASH_BENCHMARK_SIZE);
+
+                CyMd5GetHash(&Md5Context, Hashes);
+                break;
+
+            default:
+                Name = "SHA-256 multiple";
+                CySha256HashMultiple(Messages, Lengths, MessageCount, Hashes);
+                break;
+            }
+
+            Cycles += TestReadCycleCounter() - StartCycles;
+            Bytes += TEST_CRYPTO_HASH_BENCHMARK_SIZE;
+            Elapsed = clock() - Start;
+
+        } while (Elapsed < TEST_CRYPTO_BENCHMARK_TIME);
+
+        printf("%s: %.1f MB/s",
+               Name,
+               (double)Bytes * CLOCKS_PER_SEC / Elapsed / (1024 * 1024));
+
+        if (Cycles != 0) {
+            printf(", %.2f cycles/byte", (double)Cycles / Bytes);
+        }
+
+        printf("\n");
+    }
+
+    free(Buffer);
+    return;
+}
+
+ULONGLONG
+TestReadCycleCounter (
+    VOID
+    )
+
+/*++
+
+Routine Description:
+
+    This routine reads the processor's cycle counter.
+
+Arguments:
+
+    None.
+
+Return Value:
+
+    Returns the current cycle count, or 0 if the architecture has no cycle
+    counter readable from user mode.
+
+--*/
+
+{
+
+#if defined(__i386) || defined(__amd64)
+
+    return __builtin_ia32_rdtsc();
+
+#else
+
+    return 0;
+
+#endif
+
+}
+
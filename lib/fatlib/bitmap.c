@@ -0,0 +1,442 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    bitmap.c
+
+Abstract:
+
+    This module implements the in-memory bitmap of free clusters, which lets
+    cluster allocation find contiguous runs of free space without scanning
+    the File Allocation Table.
+
+Author:
+
+    agent 19-Oct-2026
+
+Environment:
+
+    Kernel, Boot, Build
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <minoca/lib/fat/fatlib.h>
+#include <minoca/lib/fat/fat.h>
+#include "fatlibp.h"
+
+//
+// --------------------------------------------------------------------- Macros
+//
+
+//
+// These macros get the word index and bit mask for a cluster in the bitmap.
+//
+
+#define FAT_BITMAP_WORD(_Cluster) ((_Cluster) / FAT_BITMAP_WORD_BITS)
+#define FAT_BITMAP_BIT(_Cluster) (1UL << ((_Cluster) % FAT_BITMAP_WORD_BITS))
+
+//
+// This macro evaluates to non-zero if the given cluster is free.
+//
+
+#define FAT_BITMAP_IS_FREE(_Volume, _Cluster)                   \
+    (((_Volume)->FreeBitmap[FAT_BITMAP_WORD(_Cluster)] &        \
+      FAT_BITMAP_BIT(_Cluster)) != 0)
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+#define FAT_BITMAP_WORD_BITS (sizeof(ULONG) * BITS_PER_BYTE)
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+ULONG
+FatpClusterBitmapFindFree (
+    PFAT_VOLUME Volume,
+    ULONG Cluster,
+    ULONG End
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+KSTATUS
+FatpCreateClusterBitmap (
+    PFAT_VOLUME Volume
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates the free cluster bitmap for a volume by scanning the
+    File Allocation Table, and computes the number of free clusters.
+
+Arguments:
+
+    Volume - Supplies a pointer to the FAT volume structure.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    ULONG AllocationSize;
+    ULONG Cluster;
+    ULONG FreeCount;
+    KSTATUS Status;
+    ULONG Value;
+
+    ASSERT(Volume->FreeBitmap == NULL);
+
+    AllocationSize = ALIGN_RANGE_UP(Volume->ClusterCount,
+                                    FAT_BITMAP_WORD_BITS) / BITS_PER_BYTE;
+
+    Volume->FreeBitmap = FatAllocateNonPagedMemory(Volume->Device.DeviceToken,
+                                                   AllocationSize);
+
+    if (Volume->FreeBitmap == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto CreateClusterBitmapEnd;
+    }
+
+    RtlZeroMemory(Volume->FreeBitmap, AllocationSize);
+    FreeCount = 0;
+    for (Cluster = FAT_CLUSTER_BEGIN;
+         Cluster < Volume->ClusterCount;
+         Cluster += 1) {
+
+        Status = FatpFatCacheReadClusterEntry(Volume, FALSE, Cluster, &Value);
+        if (!KSUCCESS(Status)) {
+            goto CreateClusterBitmapEnd;
+        }
+
+        if (Value == FAT_CLUSTER_FREE) {
+            Volume->FreeBitmap[FAT_BITMAP_WORD(Cluster)] |=
+                                                       FAT_BITMAP_BIT(Cluster);
+
+            FreeCount += 1;
+        }
+    }
+
+    Volume->FreeClusterCount = FreeCount;
+    Status = STATUS_SUCCESS;
+
+CreateClusterBitmapEnd:
+    if (!KSUCCESS(Status)) {
+        FatpDestroyClusterBitmap(Volume);
+    }
+
+    return Status;
+}
+
+VOID
+FatpDestroyClusterBitmap (
+    PFAT_VOLUME Volume
+    )
+
+/*++
+
+Routine Description:
+
+    This routine destroys the free cluster bitmap for a volume.
+
+Arguments:
+
+    Volume - Supplies a pointer to the FAT volume structure.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if (Volume->FreeBitmap != NULL) {
+        FatFreeNonPagedMemory(Volume->Device.DeviceToken, Volume->FreeBitmap);
+        Volume->FreeBitmap = NULL;
+    }
+
+    Volume->FreeClusterCount = 0;
+    return;
+}
+
+ULONG
+FatpClusterBitmapFindRun (
+    PFAT_VOLUME Volume,
+    ULONG Goal,
+    ULONG DesiredCount,
+    PULONG RunLength
+    )
+
+/*++
+
+Routine Description:
+
+    This routine finds a run of free clusters. It first tries to start the run
+    at the goal cluster, so a file can keep growing contiguously. Failing
+    that, it returns the first run at or after the volume's search start that
+    is at least the desired length, or the longest run on the volume if there
+    are none that long. This routine assumes the volume lock is held.
+
+Arguments:
+
+    Volume - Supplies a pointer to the FAT volume structure.
+
+    Goal - Supplies the preferred first cluster of the run, or 0 for no
+        preference.
+
+    DesiredCount - Supplies the number of clusters wanted.
+
+    RunLength - Supplies a pointer where the number of free clusters in the
+        run will be returned. This is never more than the desired count.
+
+Return Value:
+
+    Returns the first cluster of the run.
+
+    FAT_CLUSTER_FREE (0) if there are no free clusters on the volume.
+
+--*/
+
+{
+
+    ULONG BestLength;
+    ULONG BestStart;
+    ULONG Cluster;
+    ULONG ClusterCount;
+    ULONG End;
+    ULONG Length;
+    ULONG Pass;
+    ULONG SearchStart;
+
+    ASSERT(DesiredCount != 0);
+
+    *RunLength = 0;
+    ClusterCount = Volume->ClusterCount;
+    if (Volume->FreeClusterCount == 0) {
+        return FAT_CLUSTER_FREE;
+    }
+
+    if (DesiredCount > Volume->FreeClusterCount) {
+        DesiredCount = Volume->FreeClusterCount;
+    }
+
+    //
+    // Try to continue right where the goal leaves off.
+    //
+
+    if ((Goal >= FAT_CLUSTER_BEGIN) && (Goal < ClusterCount) &&
+        (FAT_BITMAP_IS_FREE(Volume, Goal))) {
+
+        Length = 1;
+        while ((Length < DesiredCount) && (Goal + Length < ClusterCount) &&
+               (FAT_BITMAP_IS_FREE(Volume, Goal + Length))) {
+
+            Length += 1;
+        }
+
+        *RunLength = Length;
+        return Goal;
+    }
+
+    //
+    // Search for the first run long enough, starting at the search start and
+    // wrapping around to the beginning.
+    //
+
+    SearchStart = Volume->ClusterSearchStart;
+    if ((SearchStart < FAT_CLUSTER_BEGIN) || (SearchStart >= ClusterCount)) {
+        SearchStart = FAT_CLUSTER_BEGIN;
+    }
+
+    BestLength = 0;
+    BestStart = FAT_CLUSTER_FREE;
+    for (Pass = 0; Pass < 2; Pass += 1) {
+        if (Pass == 0) {
+            Cluster = SearchStart;
+            End = ClusterCount;
+
+        } else {
+            Cluster = FAT_CLUSTER_BEGIN;
+            End = SearchStart;
+        }
+
+        while (Cluster < End) {
+            Cluster = FatpClusterBitmapFindFree(Volume, Cluster, End);
+            if (Cluster >= End) {
+                break;
+            }
+
+            Length = 1;
+            while ((Length < DesiredCount) && (Cluster + Length < End) &&
+                   (FAT_BITMAP_IS_FREE(Volume, Cluster + Length))) {
+
+                Length += 1;
+            }
+
+            if (Length == DesiredCount) {
+                *RunLength = Length;
+                return Cluster;
+            }
+
+            if (Length > BestLength) {
+                BestLength = Length;
+                BestStart = Cluster;
+            }
+
+            Cluster += Length;
+        }
+    }
+
+    *RunLength = BestLength;
+    return BestStart;
+}
+
+VOID
+FatpClusterBitmapMark (
+    PFAT_VOLUME Volume,
+    ULONG Cluster,
+    BOOL Free
+    )
+
+/*++
+
+Routine Description:
+
+    This routine marks a cluster as free or allocated in the volume's free
+    cluster bitmap, keeping the free cluster count in step. This routine
+    assumes the volume lock is held.
+
+Arguments:
+
+    Volume - Supplies a pointer to the FAT volume structure.
+
+    Cluster - Supplies the cluster to mark.
+
+    Free - Supplies a boolean indicating whether the cluster is now free
+        (TRUE) or allocated (FALSE).
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Bit;
+    ULONG Word;
+
+    ASSERT((Cluster >= FAT_CLUSTER_BEGIN) && (Cluster < Volume->ClusterCount));
+
+    Word = FAT_BITMAP_WORD(Cluster);
+    Bit = FAT_BITMAP_BIT(Cluster);
+    if (Free != FALSE) {
+        if ((Volume->FreeBitmap[Word] & Bit) == 0) {
+            Volume->FreeBitmap[Word] |= Bit;
+            Volume->FreeClusterCount += 1;
+        }
+
+    } else {
+        if ((Volume->FreeBitmap[Word] & Bit) != 0) {
+            Volume->FreeBitmap[Word] &= ~Bit;
+
+            ASSERT(Volume->FreeClusterCount != 0);
+
+            Volume->FreeClusterCount -= 1;
+        }
+    }
+
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+ULONG
+FatpClusterBitmapFindFree (
+    PFAT_VOLUME Volume,
+    ULONG Cluster,
+    ULONG End
+    )
+
+/*++
+
+Routine Description:
+
+    This routine finds the next free cluster in the bitmap, skipping whole
+    words of allocated clusters at a time.
+
+Arguments:
+
+    Volume - Supplies a pointer to the FAT volume structure.
+
+    Cluster - Supplies the cluster to start searching at, inclusive.
+
+    End - Supplies the cluster to stop searching at, exclusive.
+
+Return Value:
+
+    Returns the first free cluster found, or the end value if there is none.
+
+--*/
+
+{
+
+    ULONG Word;
+
+    while (Cluster < End) {
+        Word = Volume->FreeBitmap[FAT_BITMAP_WORD(Cluster)] >>
+               (Cluster % FAT_BITMAP_WORD_BITS);
+
+        if (Word == 0) {
+            Cluster = ALIGN_RANGE_DOWN(Cluster, FAT_BITMAP_WORD_BITS) +
+                      FAT_BITMAP_WORD_BITS;
+
+            continue;
+        }
+
+        while ((Word & 0x1) == 0) {
+            Word >>= 1;
+            Cluster += 1;
+        }
+
+        break;
+    }
+
+    if (Cluster > End) {
+        Cluster = End;
+    }
+
+    return Cluster;
+}
+
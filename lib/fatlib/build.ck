@@ -36,6 +36,9 @@ function build() {
     var sources;
 
     sources = [
+        "bitmap.c",
+        "dirindex.c",
+        "extent.c",
         "fat.c",
         "fatcache.c",
         "fatsup.c",
@@ -0,0 +1,1600 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    dirindex.c
+
+Abstract:
+
+    This module implements in-memory hashed indices of directory contents.
+    Each index maps file names to the offsets of their directory entries, and
+    tracks the runs of erased entries that can be reused, so that lookups and
+    creates in large directories don't have to scan the whole directory.
+
+Author:
+
+    agent 19-Oct-2026
+
+Environment:
+
+    Kernel, Boot, Build
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <minoca/lib/fat/fatlib.h>
+#include <minoca/lib/fat/fat.h>
+#include "fatlibp.h"
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// Define the maximum number of names indexed across all directories on a
+// volume. Directories beyond this budget are simply scanned.
+//
+
+#define FAT_DIRECTORY_INDEX_MAX_ENTRIES 0x10000
+
+//
+// Define the minimum number of hash buckets in an index. This must be a power
+// of two.
+//
+
+#define FAT_DIRECTORY_INDEX_MIN_BUCKETS 16
+
+//
+// Define the initial capacity of the free run array.
+//
+
+#define FAT_DIRECTORY_INDEX_INITIAL_RUNS 8
+
+//
+// Define the FNV-1a hash parameters used to hash file names.
+//
+
+#define FAT_DIRECTORY_HASH_SEED 0x811C9DC5
+#define FAT_DIRECTORY_HASH_PRIME 0x01000193
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+/*++
+
+Structure Description:
+
+    This structure stores a single name in a directory index.
+
+Members:
+
+    Next - Stores a pointer to the next entry in the same hash bucket.
+
+    Hash - Stores the hash of the case-folded name.
+
+    Offset - Stores the directory offset of the short entry for the file.
+
+    NameSize - Stores the size of the name in bytes, including the null
+        terminator.
+
+    Name - Stores the file name, as it would be returned from reading the
+        directory.
+
+--*/
+
+typedef struct _FAT_DIRECTORY_INDEX_ENTRY FAT_DIRECTORY_INDEX_ENTRY;
+typedef FAT_DIRECTORY_INDEX_ENTRY *PFAT_DIRECTORY_INDEX_ENTRY;
+struct _FAT_DIRECTORY_INDEX_ENTRY {
+    PFAT_DIRECTORY_INDEX_ENTRY Next;
+    ULONG Hash;
+    ULONG Offset;
+    ULONG NameSize;
+    CHAR Name[ANYSIZE_ARRAY];
+};
+
+/*++
+
+Structure Description:
+
+    This structure stores a run of consecutive erased directory entries.
+
+Members:
+
+    Offset - Stores the directory offset of the first erased entry.
+
+    Count - Stores the number of erased entries in the run.
+
+--*/
+
+typedef struct _FAT_DIRECTORY_FREE_RUN {
+    ULONG Offset;
+    ULONG Count;
+} FAT_DIRECTORY_FREE_RUN, *PFAT_DIRECTORY_FREE_RUN;
+
+/*++
+
+Structure Description:
+
+    This structure stores the index for a single directory.
+
+Members:
+
+    TreeNode - Stores the red-black tree information.
+
+    Cluster - Stores the starting cluster of the directory.
+
+    Buckets - Stores a pointer to the array of hash buckets.
+
+    BucketCount - Stores the number of hash buckets, always a power of two.
+
+    EntryCount - Stores the number of names in the index.
+
+    FreeRuns - Stores a pointer to the array of erased entry runs, sorted by
+        offset and never adjacent to one another.
+
+    FreeRunCount - Stores the number of valid elements in the free run array.
+
+    FreeRunCapacity - Stores the number of elements the free run array can
+        hold.
+
+    EndOffset - Stores the directory offset of the terminating entry, or of the
+        end of the directory file if there is none. New entries that don't fit
+        in an erased run are written here.
+
+--*/
+
+typedef struct _FAT_DIRECTORY_INDEX {
+    RED_BLACK_TREE_NODE TreeNode;
+    ULONG Cluster;
+    PFAT_DIRECTORY_INDEX_ENTRY *Buckets;
+    ULONG BucketCount;
+    ULONG EntryCount;
+    PFAT_DIRECTORY_FREE_RUN FreeRuns;
+    ULONG FreeRunCount;
+    ULONG FreeRunCapacity;
+    ULONG EndOffset;
+} FAT_DIRECTORY_INDEX, *PFAT_DIRECTORY_INDEX;
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+KSTATUS
+FatpBuildDirectoryIndex (
+    PFAT_VOLUME Volume,
+    PFAT_DIRECTORY_CONTEXT Directory,
+    PFAT_DIRECTORY_INDEX *NewIndex
+    );
+
+VOID
+FatpFreeDirectoryIndex (
+    PFAT_VOLUME Volume,
+    PFAT_DIRECTORY_INDEX Index
+    );
+
+PFAT_DIRECTORY_INDEX
+FatpFindDirectoryIndex (
+    PFAT_VOLUME Volume,
+    ULONG Cluster
+    );
+
+PFAT_DIRECTORY_INDEX_ENTRY
+FatpCreateDirectoryIndexEntry (
+    PFAT_VOLUME Volume,
+    PCSTR Name,
+    ULONG NameLength,
+    ULONG Offset
+    );
+
+PFAT_DIRECTORY_INDEX_ENTRY
+FatpDirectoryIndexFindName (
+    PFAT_DIRECTORY_INDEX Index,
+    PCSTR Name,
+    ULONG NameLength
+    );
+
+VOID
+FatpDirectoryIndexAddEntry (
+    PFAT_VOLUME Volume,
+    PFAT_DIRECTORY_INDEX Index,
+    PFAT_DIRECTORY_INDEX_ENTRY Entry
+    );
+
+KSTATUS
+FatpDirectoryIndexAddFreeRun (
+    PFAT_VOLUME Volume,
+    PFAT_DIRECTORY_INDEX Index,
+    ULONG Offset,
+    ULONG Count
+    );
+
+BOOL
+FatpDirectoryIndexClaimSlots (
+    PFAT_VOLUME Volume,
+    PFAT_DIRECTORY_INDEX Index,
+    ULONG Offset,
+    ULONG Count
+    );
+
+ULONG
+FatpHashDirectoryName (
+    PCSTR Name,
+    ULONG NameLength
+    );
+
+COMPARISON_RESULT
+FatpCompareDirectoryIndexNodes (
+    PRED_BLACK_TREE Tree,
+    PRED_BLACK_TREE_NODE FirstNode,
+    PRED_BLACK_TREE_NODE SecondNode
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+VOID
+FatpInitializeDirectoryIndexTree (
+    PFAT_VOLUME Volume
+    )
+
+/*++
+
+Routine Description:
+
+    This routine initializes the tree of directory indices for the given
+    volume.
+
+Arguments:
+
+    Volume - Supplies a pointer to the FAT volume structure.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    RtlRedBlackTreeInitialize(&(Volume->DirectoryIndexTree),
+                              0,
+                              FatpCompareDirectoryIndexNodes);
+
+    Volume->DirectoryIndexEntryCount = 0;
+    Volume->DirectoryModifyCount = 0;
+    return;
+}
+
+VOID
+FatpDestroyDirectoryIndexTree (
+    PFAT_VOLUME Volume
+    )
+
+/*++
+
+Routine Description:
+
+    This routine destroys all directory indices for the given volume.
+
+Arguments:
+
+    Volume - Supplies a pointer to the FAT volume structure.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PFAT_DIRECTORY_INDEX Index;
+    PRED_BLACK_TREE_NODE Node;
+
+    //
+    // The lock isn't acquired because the volume is being destroyed, so no one
+    // should be doing any accesses.
+    //
+
+    while (TRUE) {
+        Node = RtlRedBlackTreeGetLowestNode(&(Volume->DirectoryIndexTree));
+        if (Node == NULL) {
+            break;
+        }
+
+        Index = RED_BLACK_TREE_VALUE(Node, FAT_DIRECTORY_INDEX, TreeNode);
+        RtlRedBlackTreeRemove(&(Volume->DirectoryIndexTree), Node);
+        Volume->DirectoryIndexEntryCount -= Index->EntryCount;
+        FatpFreeDirectoryIndex(Volume, Index);
+    }
+
+    ASSERT(Volume->DirectoryIndexEntryCount == 0);
+
+    return;
+}
+
+VOID
+FatpDestroyDirectoryIndex (
+    PFAT_VOLUME Volume,
+    ULONG DirectoryCluster
+    )
+
+/*++
+
+Routine Description:
+
+    This routine throws away the index for the given directory, if there is
+    one. The next lookup in the directory will rebuild it.
+
+Arguments:
+
+    Volume - Supplies a pointer to the FAT volume structure.
+
+    DirectoryCluster - Supplies the starting cluster of the directory.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PFAT_DIRECTORY_INDEX Index;
+
+    FatAcquireLock(Volume->Lock);
+    Volume->DirectoryModifyCount += 1;
+    Index = FatpFindDirectoryIndex(Volume, DirectoryCluster);
+    if (Index != NULL) {
+        RtlRedBlackTreeRemove(&(Volume->DirectoryIndexTree),
+                              &(Index->TreeNode));
+
+        Volume->DirectoryIndexEntryCount -= Index->EntryCount;
+    }
+
+    FatReleaseLock(Volume->Lock);
+    if (Index != NULL) {
+        FatpFreeDirectoryIndex(Volume, Index);
+    }
+
+    return;
+}
+
+KSTATUS
+FatpDirectoryIndexLookup (
+    PFAT_VOLUME Volume,
+    PFAT_DIRECTORY_CONTEXT Directory,
+    PCSTR Name,
+    ULONG NameLength,
+    PULONGLONG EntryOffset
+    )
+
+/*++
+
+Routine Description:
+
+    This routine looks up a name in the index for a directory, building the
+    index if this is the first lookup in the directory. The caller is
+    expected to verify the entry at the returned offset.
+
+Arguments:
+
+    Volume - Supplies a pointer to the FAT volume structure.
+
+    Directory - Supplies a pointer to the directory context for the open
+        directory. Its position may be changed by this routine.
+
+    Name - Supplies the name of the file to find.
+
+    NameLength - Supplies the size of the name buffer in bytes, including the
+        null terminator.
+
+    EntryOffset - Supplies a pointer where the directory offset of the short
+        entry for the file will be returned on success.
+
+Return Value:
+
+    STATUS_SUCCESS if the name was found in the index.
+
+    STATUS_PATH_NOT_FOUND if the index says the name is not in the directory.
+
+    STATUS_NOT_SUPPORTED if there is no index for the directory and one could
+    not be built. The caller should scan the directory instead.
+
+--*/
+
+{
+
+    ULONG Cluster;
+    PFAT_DIRECTORY_INDEX_ENTRY Entry;
+    PFAT_DIRECTORY_INDEX Index;
+    ULONG ModifyCount;
+    PFAT_DIRECTORY_INDEX NewIndex;
+    KSTATUS Status;
+
+    Cluster = Directory->File->SeekTable[0];
+    NewIndex = NULL;
+    FatAcquireLock(Volume->Lock);
+    Index = FatpFindDirectoryIndex(Volume, Cluster);
+    if (Index == NULL) {
+
+        //
+        // Don't bother building an index that would blow the budget.
+        //
+
+        if (Volume->DirectoryIndexEntryCount >=
+            FAT_DIRECTORY_INDEX_MAX_ENTRIES) {
+
+            Status = STATUS_NOT_SUPPORTED;
+            goto DirectoryIndexLookupEnd;
+        }
+
+        ModifyCount = Volume->DirectoryModifyCount;
+        FatReleaseLock(Volume->Lock);
+        Status = FatpBuildDirectoryIndex(Volume, Directory, &NewIndex);
+        FatAcquireLock(Volume->Lock);
+        if (!KSUCCESS(Status)) {
+            Status = STATUS_NOT_SUPPORTED;
+            goto DirectoryIndexLookupEnd;
+        }
+
+        //
+        // If any directory was modified while the lock was dropped, the new
+        // index may already be stale. Throw it away and let the caller scan;
+        // the next lookup will try again.
+        //
+
+        Index = FatpFindDirectoryIndex(Volume, Cluster);
+        if ((Index != NULL) ||
+            (ModifyCount != Volume->DirectoryModifyCount) ||
+            (Volume->DirectoryIndexEntryCount + NewIndex->EntryCount >
+             FAT_DIRECTORY_INDEX_MAX_ENTRIES)) {
+
+            Status = STATUS_NOT_SUPPORTED;
+            goto DirectoryIndexLookupEnd;
+        }
+
+        RtlRedBlackTreeInsert(&(Volume->DirectoryIndexTree),
+                              &(NewIndex->TreeNode));
+
+        Volume->DirectoryIndexEntryCount += NewIndex->EntryCount;
+        Index = NewIndex;
+        NewIndex = NULL;
+    }
+
+    Entry = FatpDirectoryIndexFindName(Index, Name, NameLength);
+    if (Entry == NULL) {
+        Status = STATUS_PATH_NOT_FOUND;
+        goto DirectoryIndexLookupEnd;
+    }
+
+    *EntryOffset = Entry->Offset;
+    Status = STATUS_SUCCESS;
+
+DirectoryIndexLookupEnd:
+    FatReleaseLock(Volume->Lock);
+    if (NewIndex != NULL) {
+        FatpFreeDirectoryIndex(Volume, NewIndex);
+    }
+
+    return Status;
+}
+
+KSTATUS
+FatpDirectoryIndexFindFreeSlots (
+    PFAT_VOLUME Volume,
+    ULONG DirectoryCluster,
+    ULONG EntryCount,
+    PULONGLONG EntryOffset,
+    PBOOL AtEnd
+    )
+
+/*++
+
+Routine Description:
+
+    This routine uses the index for a directory to find a place to put a new
+    set of directory entries. Like a scan of the directory would, it picks the
+    first run of erased entries that is big enough, or the end of the
+    directory. The slots are not claimed until the entries are inserted.
+
+Arguments:
+
+    Volume - Supplies a pointer to the FAT volume structure.
+
+    DirectoryCluster - Supplies the starting cluster of the directory.
+
+    EntryCount - Supplies the number of consecutive entries needed.
+
+    EntryOffset - Supplies a pointer where the directory offset of the first
+        free slot will be returned.
+
+    AtEnd - Supplies a pointer where a boolean will be returned indicating
+        whether the slots are at the end of the directory, in which case a new
+        terminating entry needs to be written after them.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_NOT_SUPPORTED if the directory has no index.
+
+--*/
+
+{
+
+    PFAT_DIRECTORY_INDEX Index;
+    ULONG RunIndex;
+    KSTATUS Status;
+
+    FatAcquireLock(Volume->Lock);
+    Index = FatpFindDirectoryIndex(Volume, DirectoryCluster);
+    if (Index == NULL) {
+        Status = STATUS_NOT_SUPPORTED;
+        goto DirectoryIndexFindFreeSlotsEnd;
+    }
+
+    *AtEnd = TRUE;
+    *EntryOffset = Index->EndOffset;
+    for (RunIndex = 0; RunIndex < Index->FreeRunCount; RunIndex += 1) {
+        if (Index->FreeRuns[RunIndex].Count >= EntryCount) {
+            *AtEnd = FALSE;
+            *EntryOffset = Index->FreeRuns[RunIndex].Offset;
+            break;
+        }
+    }
+
+    Status = STATUS_SUCCESS;
+
+DirectoryIndexFindFreeSlotsEnd:
+    FatReleaseLock(Volume->Lock);
+    return Status;
+}
+
+VOID
+FatpDirectoryIndexInsert (
+    PFAT_VOLUME Volume,
+    ULONG DirectoryCluster,
+    PCSTR Name,
+    ULONG NameLength,
+    ULONGLONG EntryOffset,
+    ULONG EntryCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine records a newly written set of directory entries in the index
+    for the directory, if it has one. If the index cannot be kept accurate, it
+    is thrown away.
+
+Arguments:
+
+    Volume - Supplies a pointer to the FAT volume structure.
+
+    DirectoryCluster - Supplies the starting cluster of the directory.
+
+    Name - Supplies the name of the new file.
+
+    NameLength - Supplies the size of the name buffer in bytes, including the
+        null terminator.
+
+    EntryOffset - Supplies the directory offset of the first entry written,
+        which may be a long file name entry.
+
+    EntryCount - Supplies the number of entries written, including the short
+        entry at the end.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PFAT_DIRECTORY_INDEX_ENTRY Entry;
+    PFAT_DIRECTORY_INDEX Index;
+    ULONG ShortOffset;
+
+    ASSERT(EntryCount != 0);
+
+    ShortOffset = (ULONG)EntryOffset + EntryCount - 1;
+    Entry = FatpCreateDirectoryIndexEntry(Volume,
+                                          Name,
+                                          NameLength,
+                                          ShortOffset);
+
+    FatAcquireLock(Volume->Lock);
+    Volume->DirectoryModifyCount += 1;
+    Index = FatpFindDirectoryIndex(Volume, DirectoryCluster);
+    if (Index == NULL) {
+        goto DirectoryIndexInsertEnd;
+    }
+
+    //
+    // Take the slots out of the free space and add the name. If anything looks
+    // off, the index no longer describes the directory, so get rid of it.
+    //
+
+    if ((Entry == NULL) ||
+        (Volume->DirectoryIndexEntryCount >= FAT_DIRECTORY_INDEX_MAX_ENTRIES) ||
+        (FatpDirectoryIndexClaimSlots(Volume,
+                                      Index,
+                                      (ULONG)EntryOffset,
+                                      EntryCount) == FALSE)) {
+
+        RtlRedBlackTreeRemove(&(Volume->DirectoryIndexTree),
+                              &(Index->TreeNode));
+
+        Volume->DirectoryIndexEntryCount -= Index->EntryCount;
+        goto DirectoryIndexInsertEnd;
+    }
+
+    FatpDirectoryIndexAddEntry(Volume, Index, Entry);
+    Volume->DirectoryIndexEntryCount += 1;
+    Entry = NULL;
+    Index = NULL;
+
+DirectoryIndexInsertEnd:
+    FatReleaseLock(Volume->Lock);
+    if (Index != NULL) {
+        FatpFreeDirectoryIndex(Volume, Index);
+    }
+
+    if (Entry != NULL) {
+        FatFreePagedMemory(Volume->Device.DeviceToken, Entry);
+    }
+
+    return;
+}
+
+VOID
+FatpDirectoryIndexRemove (
+    PFAT_VOLUME Volume,
+    ULONG DirectoryCluster,
+    ULONGLONG EntryOffset,
+    ULONG EntryCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine removes an erased set of directory entries from the index for
+    the directory, if it has one, and records the erased entries as free. If
+    the index cannot be kept accurate, it is thrown away.
+
+Arguments:
+
+    Volume - Supplies a pointer to the FAT volume structure.
+
+    DirectoryCluster - Supplies the starting cluster of the directory.
+
+    EntryOffset - Supplies the directory offset of the erased short entry.
+
+    EntryCount - Supplies the number of entries erased, including the short
+        entry and any long file name entries directly before it.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Bucket;
+    PFAT_DIRECTORY_INDEX_ENTRY Entry;
+    PFAT_DIRECTORY_INDEX Index;
+    PFAT_DIRECTORY_INDEX_ENTRY *Previous;
+    KSTATUS Status;
+
+    ASSERT((EntryCount != 0) && (EntryOffset + 1 >= EntryCount));
+
+    Entry = NULL;
+    FatAcquireLock(Volume->Lock);
+    Volume->DirectoryModifyCount += 1;
+    Index = FatpFindDirectoryIndex(Volume, DirectoryCluster);
+    if (Index == NULL) {
+        goto DirectoryIndexRemoveEnd;
+    }
+
+    //
+    // The name isn't known here, so hunt through every bucket for the offset.
+    // This is a walk through memory, which is still far cheaper than the
+    // directory scans the index saves.
+    //
+
+    for (Bucket = 0; Bucket < Index->BucketCount; Bucket += 1) {
+        Previous = &(Index->Buckets[Bucket]);
+        while (*Previous != NULL) {
+            if ((*Previous)->Offset == EntryOffset) {
+                Entry = *Previous;
+                *Previous = Entry->Next;
+                break;
+            }
+
+            Previous = &((*Previous)->Next);
+        }
+
+        if (Entry != NULL) {
+            break;
+        }
+    }
+
+    Status = STATUS_NOT_FOUND;
+    if (Entry != NULL) {
+        Index->EntryCount -= 1;
+        Volume->DirectoryIndexEntryCount -= 1;
+        Status = FatpDirectoryIndexAddFreeRun(
+                                     Volume,
+                                     Index,
+                                     (ULONG)EntryOffset - (EntryCount - 1),
+                                     EntryCount);
+    }
+
+    if (!KSUCCESS(Status)) {
+        RtlRedBlackTreeRemove(&(Volume->DirectoryIndexTree),
+                              &(Index->TreeNode));
+
+        Volume->DirectoryIndexEntryCount -= Index->EntryCount;
+        goto DirectoryIndexRemoveEnd;
+    }
+
+    Index = NULL;
+
+DirectoryIndexRemoveEnd:
+    FatReleaseLock(Volume->Lock);
+    if (Index != NULL) {
+        FatpFreeDirectoryIndex(Volume, Index);
+    }
+
+    if (Entry != NULL) {
+        FatFreePagedMemory(Volume->Device.DeviceToken, Entry);
+    }
+
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+KSTATUS
+FatpBuildDirectoryIndex (
+    PFAT_VOLUME Volume,
+    PFAT_DIRECTORY_CONTEXT Directory,
+    PFAT_DIRECTORY_INDEX *NewIndex
+    )
+
+/*++
+
+Routine Description:
+
+    This routine builds an index for a directory by reading it from start to
+    finish. The volume lock must not be held.
+
+Arguments:
+
+    Volume - Supplies a pointer to the FAT volume structure.
+
+    Directory - Supplies a pointer to the directory context for the open
+        directory.
+
+    NewIndex - Supplies a pointer where a pointer to the new index will be
+        returned on success. It has not been inserted into the tree.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    ULONG AllocationSize;
+    FAT_DIRECTORY_ENTRY DirectoryEntry;
+    ULONG EntriesRead;
+    PFAT_DIRECTORY_INDEX_ENTRY Entry;
+    PFAT_DIRECTORY_INDEX Index;
+    PFAT_DIRECTORY_INDEX_ENTRY List;
+    PSTR Name;
+    ULONG NameBufferSize;
+    ULONG NameSize;
+    ULONGLONG Offset;
+    KSTATUS Status;
+
+    List = NULL;
+    Name = NULL;
+    Index = FatAllocatePagedMemory(Volume->Device.DeviceToken,
+                                   sizeof(FAT_DIRECTORY_INDEX));
+
+    if (Index == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto BuildDirectoryIndexEnd;
+    }
+
+    RtlZeroMemory(Index, sizeof(FAT_DIRECTORY_INDEX));
+    Index->Cluster = Directory->File->SeekTable[0];
+
+    //
+    // First walk the raw entries to find the erased runs and the end of the
+    // directory, the same way creating an entry would.
+    //
+
+    Offset = DIRECTORY_CONTENTS_OFFSET;
+    Status = FatpDirectorySeek(Directory, Offset);
+    if (!KSUCCESS(Status)) {
+        goto BuildDirectoryIndexEnd;
+    }
+
+    while (TRUE) {
+        Status = FatpReadDirectory(Directory, &DirectoryEntry, 1, &EntriesRead);
+        if (Status == STATUS_END_OF_FILE) {
+            break;
+
+        } else if (!KSUCCESS(Status)) {
+            goto BuildDirectoryIndexEnd;
+        }
+
+        if ((EntriesRead == 0) ||
+            (DirectoryEntry.DosName[0] == FAT_DIRECTORY_ENTRY_END)) {
+
+            break;
+        }
+
+        if (DirectoryEntry.DosName[0] == FAT_DIRECTORY_ENTRY_ERASED) {
+            Status = FatpDirectoryIndexAddFreeRun(Volume,
+                                                  Index,
+                                                  (ULONG)Offset,
+                                                  1);
+
+            if (!KSUCCESS(Status)) {
+                goto BuildDirectoryIndexEnd;
+            }
+        }
+
+        Offset += 1;
+    }
+
+    Index->EndOffset = (ULONG)Offset;
+
+    //
+    // Now walk the valid entries to collect their names.
+    //
+
+    NameBufferSize = FAT_MAX_LONG_FILE_LENGTH + 1;
+    Name = FatAllocatePagedMemory(Volume->Device.DeviceToken, NameBufferSize);
+    if (Name == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto BuildDirectoryIndexEnd;
+    }
+
+    Offset = DIRECTORY_CONTENTS_OFFSET;
+    Status = FatpDirectorySeek(Directory, Offset);
+    if (!KSUCCESS(Status)) {
+        goto BuildDirectoryIndexEnd;
+    }
+
+    while (TRUE) {
+        NameSize = NameBufferSize;
+        Status = FatpReadNextDirectoryEntry(Directory,
+                                            NULL,
+                                            Name,
+                                            &NameSize,
+                                            &DirectoryEntry,
+                                            &EntriesRead);
+
+        if (Status == STATUS_END_OF_FILE) {
+            break;
+
+        } else if (!KSUCCESS(Status)) {
+            goto BuildDirectoryIndexEnd;
+        }
+
+        Offset += EntriesRead;
+        if (Index->EntryCount >= FAT_DIRECTORY_INDEX_MAX_ENTRIES) {
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+            goto BuildDirectoryIndexEnd;
+        }
+
+        Entry = FatpCreateDirectoryIndexEntry(Volume,
+                                              Name,
+                                              NameSize,
+                                              (ULONG)Offset - 1);
+
+        if (Entry == NULL) {
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+            goto BuildDirectoryIndexEnd;
+        }
+
+        Entry->Next = List;
+        List = Entry;
+        Index->EntryCount += 1;
+    }
+
+    //
+    // Size the hash table for what was found and file the names away.
+    //
+
+    Index->BucketCount = FAT_DIRECTORY_INDEX_MIN_BUCKETS;
+    while (Index->BucketCount < Index->EntryCount) {
+        Index->BucketCount <<= 1;
+    }
+
+    AllocationSize = Index->BucketCount * sizeof(PFAT_DIRECTORY_INDEX_ENTRY);
+    Index->Buckets = FatAllocatePagedMemory(Volume->Device.DeviceToken,
+                                            AllocationSize);
+
+    if (Index->Buckets == NULL) {
+        Status = STATUS_INSUFFICIENT_RESOURCES;
+        goto BuildDirectoryIndexEnd;
+    }
+
+    RtlZeroMemory(Index->Buckets, AllocationSize);
+    Index->EntryCount = 0;
+    while (List != NULL) {
+        Entry = List;
+        List = Entry->Next;
+        FatpDirectoryIndexAddEntry(Volume, Index, Entry);
+    }
+
+    Status = STATUS_SUCCESS;
+
+BuildDirectoryIndexEnd:
+    while (List != NULL) {
+        Entry = List;
+        List = Entry->Next;
+        FatFreePagedMemory(Volume->Device.DeviceToken, Entry);
+    }
+
+    if (Name != NULL) {
+        FatFreePagedMemory(Volume->Device.DeviceToken, Name);
+    }
+
+    if (!KSUCCESS(Status)) {
+        if (Index != NULL) {
+            FatpFreeDirectoryIndex(Volume, Index);
+            Index = NULL;
+        }
+    }
+
+    *NewIndex = Index;
+    return Status;
+}
+
+VOID
+FatpFreeDirectoryIndex (
+    PFAT_VOLUME Volume,
+    PFAT_DIRECTORY_INDEX Index
+    )
+
+/*++
+
+Routine Description:
+
+    This routine frees a directory index that is not in the tree.
+
+Arguments:
+
+    Volume - Supplies a pointer to the FAT volume structure.
+
+    Index - Supplies a pointer to the index to free.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG Bucket;
+    PFAT_DIRECTORY_INDEX_ENTRY Entry;
+
+    if (Index->Buckets != NULL) {
+        for (Bucket = 0; Bucket < Index->BucketCount; Bucket += 1) {
+            while (Index->Buckets[Bucket] != NULL) {
+                Entry = Index->Buckets[Bucket];
+                Index->Buckets[Bucket] = Entry->Next;
+                FatFreePagedMemory(Volume->Device.DeviceToken, Entry);
+            }
+        }
+
+        FatFreePagedMemory(Volume->Device.DeviceToken, Index->Buckets);
+    }
+
+    if (Index->FreeRuns != NULL) {
+        FatFreePagedMemory(Volume->Device.DeviceToken, Index->FreeRuns);
+    }
+
+    FatFreePagedMemory(Volume->Device.DeviceToken, Index);
+    return;
+}
+
+PFAT_DIRECTORY_INDEX
+FatpFindDirectoryIndex (
+    PFAT_VOLUME Volume,
+    ULONG Cluster
+    )
+
+/*++
+
+Routine Description:
+
+    This routine finds the index for a directory. This routine assumes the
+    volume lock is held.
+
+Arguments:
+
+    Volume - Supplies a pointer to the FAT volume structure.
+
+    Cluster - Supplies the starting cluster of the directory.
+
+Return Value:
+
+    Returns a pointer to the directory's index on success.
+
+    NULL if the directory has no index.
+
+--*/
+
+{
+
+    PRED_BLACK_TREE_NODE FoundNode;
+    FAT_DIRECTORY_INDEX Search;
+
+    Search.Cluster = Cluster;
+    FoundNode = RtlRedBlackTreeSearch(&(Volume->DirectoryIndexTree),
+                                      &(Search.TreeNode));
+
+    if (FoundNode == NULL) {
+        return NULL;
+    }
+
+    return RED_BLACK_TREE_VALUE(FoundNode, FAT_DIRECTORY_INDEX, TreeNode);
+}
+
+PFAT_DIRECTORY_INDEX_ENTRY
+FatpCreateDirectoryIndexEntry (
+    PFAT_VOLUME Volume,
+    PCSTR Name,
+    ULONG NameLength,
+    ULONG Offset
+    )
+
+/*++
+
+Routine Description:
+
+    This routine allocates and initializes a directory index entry.
+
+Arguments:
+
+    Volume - Supplies a pointer to the FAT volume structure.
+
+    Name - Supplies the name of the file, which may not be null terminated.
+
+    NameLength - Supplies the size of the name buffer in bytes, including
+        space for a null terminator.
+
+    Offset - Supplies the directory offset of the short entry for the file.
+
+Return Value:
+
+    Returns a pointer to the new entry on success.
+
+    NULL on allocation failure.
+
+--*/
+
+{
+
+    ULONG AllocationSize;
+    PFAT_DIRECTORY_INDEX_ENTRY Entry;
+    ULONG Length;
+
+    ASSERT(NameLength != 0);
+
+    Length = 0;
+    while ((Length < NameLength - 1) && (Name[Length] != '\0')) {
+        Length += 1;
+    }
+
+    AllocationSize = FIELD_OFFSET(FAT_DIRECTORY_INDEX_ENTRY, Name) + Length + 1;
+    Entry = FatAllocatePagedMemory(Volume->Device.DeviceToken, AllocationSize);
+    if (Entry == NULL) {
+        return NULL;
+    }
+
+    Entry->Next = NULL;
+    Entry->Hash = FatpHashDirectoryName(Name, Length + 1);
+    Entry->Offset = Offset;
+    Entry->NameSize = Length + 1;
+    RtlCopyMemory(Entry->Name, Name, Length);
+    Entry->Name[Length] = '\0';
+    return Entry;
+}
+
+PFAT_DIRECTORY_INDEX_ENTRY
+FatpDirectoryIndexFindName (
+    PFAT_DIRECTORY_INDEX Index,
+    PCSTR Name,
+    ULONG NameLength
+    )
+
+/*++
+
+Routine Description:
+
+    This routine finds a name in a directory index. The hash is taken over the
+    case-folded name, but the comparison is exact, matching what a scan of the
+    directory would find. If the name appears more than once, the entry
+    earliest in the directory is returned. This routine assumes the volume
+    lock is held.
+
+Arguments:
+
+    Index - Supplies a pointer to the directory index.
+
+    Name - Supplies the name to find, which may not be null terminated.
+
+    NameLength - Supplies the size of the name buffer in bytes, including
+        space for a null terminator.
+
+Return Value:
+
+    Returns a pointer to the matching entry on success.
+
+    NULL if the name is not in the index.
+
+--*/
+
+{
+
+    PFAT_DIRECTORY_INDEX_ENTRY Entry;
+    PFAT_DIRECTORY_INDEX_ENTRY Found;
+    ULONG Hash;
+    ULONG Length;
+
+    ASSERT(NameLength != 0);
+
+    Length = 0;
+    while ((Length < NameLength - 1) && (Name[Length] != '\0')) {
+        Length += 1;
+    }
+
+    Found = NULL;
+    Hash = FatpHashDirectoryName(Name, Length + 1);
+    Entry = Index->Buckets[Hash & (Index->BucketCount - 1)];
+    while (Entry != NULL) {
+        if ((Entry->Hash == Hash) &&
+            (Entry->NameSize == Length + 1) &&
+            (RtlCompareMemory(Entry->Name, Name, Length) != FALSE)) {
+
+            if ((Found == NULL) || (Entry->Offset < Found->Offset)) {
+                Found = Entry;
+            }
+        }
+
+        Entry = Entry->Next;
+    }
+
+    return Found;
+}
+
+VOID
+FatpDirectoryIndexAddEntry (
+    PFAT_VOLUME Volume,
+    PFAT_DIRECTORY_INDEX Index,
+    PFAT_DIRECTORY_INDEX_ENTRY Entry
+    )
+
+/*++
+
+Routine Description:
+
+    This routine adds an entry to a directory index, growing the hash table if
+    it has gotten crowded. This routine does not adjust the volume's count of
+    indexed names.
+
+Arguments:
+
+    Volume - Supplies a pointer to the FAT volume structure.
+
+    Index - Supplies a pointer to the directory index.
+
+    Entry - Supplies a pointer to the entry to add.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    ULONG AllocationSize;
+    ULONG Bucket;
+    PFAT_DIRECTORY_INDEX_ENTRY *NewBuckets;
+    ULONG NewCount;
+    PFAT_DIRECTORY_INDEX_ENTRY Next;
+    PFAT_DIRECTORY_INDEX_ENTRY Rehash;
+
+    //
+    // Double the table when chains average more than two entries. If the
+    // allocation fails, the chains just get a little longer.
+    //
+
+    if (Index->EntryCount >= Index->BucketCount * 2) {
+        NewCount = Index->BucketCount * 2;
+        AllocationSize = NewCount * sizeof(PFAT_DIRECTORY_INDEX_ENTRY);
+        NewBuckets = FatAllocatePagedMemory(Volume->Device.DeviceToken,
+                                            AllocationSize);
+
+        if (NewBuckets != NULL) {
+            RtlZeroMemory(NewBuckets, AllocationSize);
+            for (Bucket = 0; Bucket < Index->BucketCount; Bucket += 1) {
+                Rehash = Index->Buckets[Bucket];
+                while (Rehash != NULL) {
+                    Next = Rehash->Next;
+                    Rehash->Next = NewBuckets[Rehash->Hash & (NewCount - 1)];
+                    NewBuckets[Rehash->Hash & (NewCount - 1)] = Rehash;
+                    Rehash = Next;
+                }
+            }
+
+            FatFreePagedMemory(Volume->Device.DeviceToken, Index->Buckets);
+            Index->Buckets = NewBuckets;
+            Index->BucketCount = NewCount;
+        }
+    }
+
+    Bucket = Entry->Hash & (Index->BucketCount - 1);
+    Entry->Next = Index->Buckets[Bucket];
+    Index->Buckets[Bucket] = Entry;
+    Index->EntryCount += 1;
+    return;
+}
+
+KSTATUS
+FatpDirectoryIndexAddFreeRun (
+    PFAT_VOLUME Volume,
+    PFAT_DIRECTORY_INDEX Index,
+    ULONG Offset,
+    ULONG Count
+    )
+
+/*++
+
+Routine Description:
+
+    This routine records a range of erased entries as free, merging it with
+    any free runs it touches.
+
+Arguments:
+
+    Volume - Supplies a pointer to the FAT volume structure.
+
+    Index - Supplies a pointer to the directory index.
+
+    Offset - Supplies the directory offset of the first erased entry.
+
+    Count - Supplies the number of erased entries.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    ULONG AllocationSize;
+    ULONG Capacity;
+    ULONG MoveIndex;
+    PFAT_DIRECTORY_FREE_RUN NewRuns;
+    PFAT_DIRECTORY_FREE_RUN Next;
+    PFAT_DIRECTORY_FREE_RUN Run;
+    ULONG RunIndex;
+
+    //
+    // Find the first run that doesn't end before this range starts.
+    //
+
+    RunIndex = 0;
+    while ((RunIndex < Index->FreeRunCount) &&
+           (Index->FreeRuns[RunIndex].Offset +
+            Index->FreeRuns[RunIndex].Count < Offset)) {
+
+        RunIndex += 1;
+    }
+
+    if (RunIndex < Index->FreeRunCount) {
+        Run = &(Index->FreeRuns[RunIndex]);
+
+        //
+        // Extend the run that ends right where this range starts, pulling in
+        // the next run too if the range fills the gap between them.
+        //
+
+        if (Run->Offset + Run->Count == Offset) {
+            Run->Count += Count;
+            Next = &(Index->FreeRuns[RunIndex + 1]);
+            if ((RunIndex + 1 < Index->FreeRunCount) &&
+                (Run->Offset + Run->Count == Next->Offset)) {
+
+                Run->Count += Next->Count;
+                for (MoveIndex = RunIndex + 1;
+                     MoveIndex + 1 < Index->FreeRunCount;
+                     MoveIndex += 1) {
+
+                    Index->FreeRuns[MoveIndex] =
+                                             Index->FreeRuns[MoveIndex + 1];
+                }
+
+                Index->FreeRunCount -= 1;
+            }
+
+            return STATUS_SUCCESS;
+        }
+
+        //
+        // Extend the run that starts right where this range ends.
+        //
+
+        if (Offset + Count == Run->Offset) {
+            Run->Offset = Offset;
+            Run->Count += Count;
+            return STATUS_SUCCESS;
+        }
+
+        //
+        // Overlapping an existing run means the index is confused.
+        //
+
+        if (Offset + Count > Run->Offset) {
+            return STATUS_VOLUME_CORRUPT;
+        }
+    }
+
+    //
+    // Insert a new run before the found one, growing the array if needed.
+    //
+
+    if (Index->FreeRunCount == Index->FreeRunCapacity) {
+        Capacity = Index->FreeRunCapacity * 2;
+        if (Capacity == 0) {
+            Capacity = FAT_DIRECTORY_INDEX_INITIAL_RUNS;
+        }
+
+        AllocationSize = Capacity * sizeof(FAT_DIRECTORY_FREE_RUN);
+        NewRuns = FatAllocatePagedMemory(Volume->Device.DeviceToken,
+                                         AllocationSize);
+
+        if (NewRuns == NULL) {
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+
+        if (Index->FreeRuns != NULL) {
+            RtlCopyMemory(NewRuns,
+                          Index->FreeRuns,
+                          Index->FreeRunCount *
+                          sizeof(FAT_DIRECTORY_FREE_RUN));
+
+            FatFreePagedMemory(Volume->Device.DeviceToken, Index->FreeRuns);
+        }
+
+        Index->FreeRuns = NewRuns;
+        Index->FreeRunCapacity = Capacity;
+    }
+
+    for (MoveIndex = Index->FreeRunCount;
+         MoveIndex > RunIndex;
+         MoveIndex -= 1) {
+
+        Index->FreeRuns[MoveIndex] = Index->FreeRuns[MoveIndex - 1];
+    }
+
+    Index->FreeRuns[RunIndex].Offset = Offset;
+    Index->FreeRuns[RunIndex].Count = Count;
+    Index->FreeRunCount += 1;
+    return STATUS_SUCCESS;
+}
+
+BOOL
+FatpDirectoryIndexClaimSlots (
+    PFAT_VOLUME Volume,
+    PFAT_DIRECTORY_INDEX Index,
+    ULONG Offset,
+    ULONG Count
+    )
+
+/*++
+
+Routine Description:
+
+    This routine marks a range of directory slots as used, either by taking
+    them out of a free run or by moving the end of the directory past them.
+
+Arguments:
+
+    Volume - Supplies a pointer to the FAT volume structure.
+
+    Index - Supplies a pointer to the directory index.
+
+    Offset - Supplies the directory offset of the first slot used.
+
+    Count - Supplies the number of slots used.
+
+Return Value:
+
+    TRUE if the slots were accounted for.
+
+    FALSE if the slots were neither free nor at the end of the directory,
+    meaning the index is out of date.
+
+--*/
+
+{
+
+    PFAT_DIRECTORY_FREE_RUN Run;
+    ULONG RunEnd;
+    ULONG RunIndex;
+
+    if (Offset == Index->EndOffset) {
+        Index->EndOffset += Count;
+        return TRUE;
+    }
+
+    for (RunIndex = 0; RunIndex < Index->FreeRunCount; RunIndex += 1) {
+        Run = &(Index->FreeRuns[RunIndex]);
+        RunEnd = Run->Offset + Run->Count;
+        if ((Offset < Run->Offset) || (Offset + Count > RunEnd)) {
+            continue;
+        }
+
+        //
+        // Carve the range off the front or back of the run, or split the run
+        // in two if the range is in the middle.
+        //
+
+        if (Offset == Run->Offset) {
+            Run->Offset += Count;
+            Run->Count -= Count;
+            if (Run->Count == 0) {
+                while (RunIndex + 1 < Index->FreeRunCount) {
+                    Index->FreeRuns[RunIndex] = Index->FreeRuns[RunIndex + 1];
+                    RunIndex += 1;
+                }
+
+                Index->FreeRunCount -= 1;
+            }
+
+        } else if (Offset + Count == RunEnd) {
+            Run->Count -= Count;
+
+        } else {
+            Run->Count = Offset - Run->Offset;
+            if (!KSUCCESS(FatpDirectoryIndexAddFreeRun(Volume,
+                                                       Index,
+                                                       Offset + Count,
+                                                       RunEnd -
+                                                       (Offset + Count)))) {
+
+                return FALSE;
+            }
+        }
+
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+ULONG
+FatpHashDirectoryName (
+    PCSTR Name,
+    ULONG NameLength
+    )
+
+/*++
+
+Routine Description:
+
+    This routine hashes a file name with its case folded, so that names
+    differing only in case land in the same bucket.
+
+Arguments:
+
+    Name - Supplies the name to hash.
+
+    NameLength - Supplies the size of the name in bytes, including the null
+        terminator.
+
+Return Value:
+
+    Returns the hash of the name.
+
+--*/
+
+{
+
+    ULONG Hash;
+    ULONG Index;
+
+    Hash = FAT_DIRECTORY_HASH_SEED;
+    for (Index = 0; Index + 1 < NameLength; Index += 1) {
+        Hash ^= (UCHAR)RtlConvertCharacterToLowerCase(Name[Index]);
+        Hash *= FAT_DIRECTORY_HASH_PRIME;
+    }
+
+    return Hash;
+}
+
+COMPARISON_RESULT
+FatpCompareDirectoryIndexNodes (
+    PRED_BLACK_TREE Tree,
+    PRED_BLACK_TREE_NODE FirstNode,
+    PRED_BLACK_TREE_NODE SecondNode
+    )
+
+/*++
+
+Routine Description:
+
+    This routine compares directory index nodes by their directory clusters.
+
+Arguments:
+
+    Tree - Supplies a pointer to the Red-Black tree that owns both nodes.
+
+    FirstNode - Supplies a pointer to the left side of the comparison.
+
+    SecondNode - Supplies a pointer to the second side of the comparison.
+
+Return Value:
+
+    Same if the two nodes have the same value.
+
+    Ascending if the first node is less than the second node.
+
+    Descending if the second node is less than the first node.
+
+--*/
+
+{
+
+    PFAT_DIRECTORY_INDEX First;
+    PFAT_DIRECTORY_INDEX Second;
+
+    First = RED_BLACK_TREE_VALUE(FirstNode, FAT_DIRECTORY_INDEX, TreeNode);
+    Second = RED_BLACK_TREE_VALUE(SecondNode, FAT_DIRECTORY_INDEX, TreeNode);
+    if (First->Cluster > Second->Cluster) {
+        return ComparisonResultDescending;
+    }
+
+    if (First->Cluster < Second->Cluster) {
+        return ComparisonResultAscending;
+    }
+
+    return ComparisonResultSame;
+}
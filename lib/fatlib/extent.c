@@ -0,0 +1,592 @@
+/*++
+
+Copyright (c) 2026 Minoca Corp.
+
+    This file is licensed under the terms of the GNU General Public License
+    version 3. Alternative licensing terms are available. Contact
+    info@minocacorp.com for details. See the LICENSE file at the root of this
+    project for complete licensing information.
+
+Module Name:
+
+    extent.c
+
+Abstract:
+
+    This module implements the per-file extent map, which caches a file's
+    cluster chain as runs of physically contiguous clusters so that seeks and
+    I/O do not have to walk the File Allocation Table.
+
+Author:
+
+    agent 19-Oct-2026
+
+Environment:
+
+    Kernel, Boot, Build
+
+--*/
+
+//
+// ------------------------------------------------------------------- Includes
+//
+
+#include <minoca/lib/fat/fatlib.h>
+#include <minoca/lib/fat/fat.h>
+#include "fatlibp.h"
+
+//
+// --------------------------------------------------------------------- Macros
+//
+
+//
+// This macro evaluates to non-zero if the given file keeps an extent map. The
+// page file cannot allocate while paging, and the FAT12/FAT16 root directory
+// has no cluster chain.
+//
+
+#define FAT_FILE_HAS_EXTENT_MAP(_File)                          \
+    ((((_File)->OpenFlags & OPEN_FLAG_PAGE_FILE) == 0) &&       \
+     ((_File)->IsRootDirectory == FALSE))
+
+//
+// ---------------------------------------------------------------- Definitions
+//
+
+//
+// Define the initial number of extents allocated for a file's map.
+//
+
+#define FAT_EXTENT_MAP_INITIAL_CAPACITY 8
+
+//
+// Define the maximum number of extents a file's map will grow to. Beyond this
+// the file is badly fragmented, and lookups past the mapped region fall back
+// to walking the cluster chain from the seek table.
+//
+
+#define FAT_EXTENT_MAP_MAX_CAPACITY 4096
+
+//
+// ------------------------------------------------------ Data Type Definitions
+//
+
+//
+// ----------------------------------------------- Internal Function Prototypes
+//
+
+KSTATUS
+FatpExtentMapExtend (
+    PFAT_FILE File,
+    ULONG IoFlags,
+    ULONG FileCluster,
+    PBOOL EndOfFile
+    );
+
+KSTATUS
+FatpExtentMapAppend (
+    PFAT_FILE File,
+    ULONG IoFlags,
+    ULONG FileCluster,
+    ULONG Cluster
+    );
+
+//
+// -------------------------------------------------------------------- Globals
+//
+
+//
+// ------------------------------------------------------------------ Functions
+//
+
+KSTATUS
+FatpInitializeExtentMap (
+    PFAT_FILE File
+    )
+
+/*++
+
+Routine Description:
+
+    This routine initializes the extent map for a newly opened file. The map
+    starts out empty and is populated lazily as the file is accessed.
+
+Arguments:
+
+    File - Supplies a pointer to the FAT file.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    KSTATUS Status;
+
+    File->Extents = NULL;
+    File->ExtentCount = 0;
+    File->ExtentCapacity = 0;
+    File->ExtentLock = NULL;
+    if (FAT_FILE_HAS_EXTENT_MAP(File) == FALSE) {
+        return STATUS_SUCCESS;
+    }
+
+    Status = FatCreateLock(&(File->ExtentLock));
+    return Status;
+}
+
+VOID
+FatpDestroyExtentMap (
+    PFAT_FILE File
+    )
+
+/*++
+
+Routine Description:
+
+    This routine tears down a file's extent map.
+
+Arguments:
+
+    File - Supplies a pointer to the FAT file.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if (File->Extents != NULL) {
+        FatFreePagedMemory(File->Volume->Device.DeviceToken, File->Extents);
+        File->Extents = NULL;
+    }
+
+    if (File->ExtentLock != NULL) {
+        FatDestroyLock(File->ExtentLock);
+        File->ExtentLock = NULL;
+    }
+
+    File->ExtentCount = 0;
+    File->ExtentCapacity = 0;
+    return;
+}
+
+KSTATUS
+FatpExtentMapLookup (
+    PFAT_FILE File,
+    ULONG IoFlags,
+    PULONG FileCluster,
+    PULONG Cluster,
+    PULONG RunLength
+    )
+
+/*++
+
+Routine Description:
+
+    This routine translates a cluster index within a file into the volume
+    cluster that backs it, extending the extent map from the end of the
+    mapped region if needed.
+
+Arguments:
+
+    File - Supplies a pointer to the FAT file.
+
+    IoFlags - Supplies flags regarding any necessary I/O operations. See
+        IO_FLAG_* definitions.
+
+    FileCluster - Supplies a pointer that on input contains the index of the
+        cluster within the file to look up. If the file's cluster chain ends
+        before this index, this returns the index of the last cluster in the
+        file.
+
+    Cluster - Supplies a pointer where the volume cluster number will be
+        returned.
+
+    RunLength - Supplies an optional pointer where the number of physically
+        contiguous clusters starting at the returned cluster will be returned.
+        This is always at least one, but may be shorter than the true run if
+        the map has not yet seen the rest of it.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_END_OF_FILE if the file has fewer clusters than requested. The last
+    cluster of the file is returned.
+
+    STATUS_NOT_SUPPORTED if the extent map cannot answer the request, either
+    because the file does not have one or because it has grown as large as it
+    is allowed to. The caller should walk the cluster chain itself.
+
+    STATUS_FILE_CORRUPT if the cluster chain is corrupt.
+
+    Other error codes on device I/O errors.
+
+--*/
+
+{
+
+    BOOL EndOfFile;
+    PFAT_EXTENT Extent;
+    ULONG High;
+    ULONG Low;
+    ULONG Middle;
+    ULONG Offset;
+    KSTATUS Status;
+    ULONG Target;
+
+    if (FAT_FILE_HAS_EXTENT_MAP(File) == FALSE) {
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    Target = *FileCluster;
+    FatAcquireLock(File->ExtentLock);
+
+    //
+    // Extend the map if the requested cluster is beyond what has been seen.
+    //
+
+    EndOfFile = FALSE;
+    Status = FatpExtentMapExtend(File, IoFlags, Target, &EndOfFile);
+    if (!KSUCCESS(Status)) {
+        goto ExtentMapLookupEnd;
+    }
+
+    //
+    // If the end of the chain came first, return the last cluster in the file.
+    //
+
+    if (EndOfFile != FALSE) {
+        Extent = &(File->Extents[File->ExtentCount - 1]);
+        *FileCluster = Extent->FileCluster + Extent->Length - 1;
+        *Cluster = Extent->Cluster + Extent->Length - 1;
+        if (RunLength != NULL) {
+            *RunLength = 1;
+        }
+
+        Status = STATUS_END_OF_FILE;
+        goto ExtentMapLookupEnd;
+    }
+
+    //
+    // Binary search for the extent containing the target.
+    //
+
+    Low = 0;
+    High = File->ExtentCount;
+    while (Low + 1 < High) {
+        Middle = Low + ((High - Low) / 2);
+        if (File->Extents[Middle].FileCluster <= Target) {
+            Low = Middle;
+
+        } else {
+            High = Middle;
+        }
+    }
+
+    Extent = &(File->Extents[Low]);
+
+    ASSERT((Target >= Extent->FileCluster) &&
+           (Target < Extent->FileCluster + Extent->Length));
+
+    Offset = Target - Extent->FileCluster;
+    *Cluster = Extent->Cluster + Offset;
+    if (RunLength != NULL) {
+        *RunLength = Extent->Length - Offset;
+    }
+
+    Status = STATUS_SUCCESS;
+
+ExtentMapLookupEnd:
+    FatReleaseLock(File->ExtentLock);
+    return Status;
+}
+
+VOID
+FatpExtentMapTruncate (
+    PFAT_FILE File,
+    ULONG ClusterCount
+    )
+
+/*++
+
+Routine Description:
+
+    This routine discards the portion of a file's extent map beyond the given
+    number of clusters. It should be called whenever clusters are removed
+    from the end of the file's chain.
+
+Arguments:
+
+    File - Supplies a pointer to the FAT file.
+
+    ClusterCount - Supplies the number of clusters that remain in the file.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    PFAT_EXTENT Extent;
+
+    if (FAT_FILE_HAS_EXTENT_MAP(File) == FALSE) {
+        return;
+    }
+
+    FatAcquireLock(File->ExtentLock);
+    while (File->ExtentCount != 0) {
+        Extent = &(File->Extents[File->ExtentCount - 1]);
+        if (Extent->FileCluster < ClusterCount) {
+            if (Extent->FileCluster + Extent->Length > ClusterCount) {
+                Extent->Length = ClusterCount - Extent->FileCluster;
+            }
+
+            break;
+        }
+
+        File->ExtentCount -= 1;
+    }
+
+    FatReleaseLock(File->ExtentLock);
+    return;
+}
+
+//
+// --------------------------------------------------------- Internal Functions
+//
+
+KSTATUS
+FatpExtentMapExtend (
+    PFAT_FILE File,
+    ULONG IoFlags,
+    ULONG FileCluster,
+    PBOOL EndOfFile
+    )
+
+/*++
+
+Routine Description:
+
+    This routine walks the cluster chain from the end of the mapped region
+    until the given file cluster is mapped or the chain ends. This routine
+    assumes the extent lock is held.
+
+Arguments:
+
+    File - Supplies a pointer to the FAT file.
+
+    IoFlags - Supplies flags regarding any necessary I/O operations. See
+        IO_FLAG_* definitions.
+
+    FileCluster - Supplies the index of the file cluster that needs to be
+        mapped.
+
+    EndOfFile - Supplies a pointer where a boolean will be returned indicating
+        if the cluster chain ended before the given cluster.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+{
+
+    ULONG ClusterBad;
+    ULONGLONG FileByteOffset;
+    PFAT_EXTENT Extent;
+    ULONG MappedCount;
+    ULONG NextCluster;
+    ULONG PreviousCluster;
+    KSTATUS Status;
+    ULONG TableIndex;
+    PFAT_VOLUME Volume;
+
+    Volume = File->Volume;
+    ClusterBad = Volume->ClusterBad;
+
+    //
+    // Seed the map with the first cluster, which is known from the file ID.
+    //
+
+    if (File->ExtentCount == 0) {
+        if ((File->SeekTable[0] < FAT_CLUSTER_BEGIN) ||
+            (File->SeekTable[0] >= Volume->ClusterCount)) {
+
+            Status = STATUS_NOT_SUPPORTED;
+            goto ExtentMapExtendEnd;
+        }
+
+        Status = FatpExtentMapAppend(File, IoFlags, 0, File->SeekTable[0]);
+        if (!KSUCCESS(Status)) {
+            goto ExtentMapExtendEnd;
+        }
+    }
+
+    Extent = &(File->Extents[File->ExtentCount - 1]);
+    MappedCount = Extent->FileCluster + Extent->Length;
+    while (FileCluster >= MappedCount) {
+        PreviousCluster = Extent->Cluster + Extent->Length - 1;
+        Status = FatpGetNextCluster(Volume,
+                                    IoFlags,
+                                    PreviousCluster,
+                                    &NextCluster);
+
+        if (!KSUCCESS(Status)) {
+            goto ExtentMapExtendEnd;
+        }
+
+        if ((NextCluster < FAT_CLUSTER_BEGIN) || (NextCluster >= ClusterBad)) {
+            *EndOfFile = TRUE;
+            break;
+        }
+
+        //
+        // A cluster beyond the volume or a chain longer than the volume means
+        // the chain is corrupt (or loops).
+        //
+
+        if ((NextCluster >= Volume->ClusterCount) ||
+            (MappedCount >= Volume->ClusterCount)) {
+
+            Status = STATUS_FILE_CORRUPT;
+            goto ExtentMapExtendEnd;
+        }
+
+        if (NextCluster == PreviousCluster + 1) {
+            Extent->Length += 1;
+
+        } else {
+            Status = FatpExtentMapAppend(File,
+                                         IoFlags,
+                                         MappedCount,
+                                         NextCluster);
+
+            if (!KSUCCESS(Status)) {
+                goto ExtentMapExtendEnd;
+            }
+
+            Extent = &(File->Extents[File->ExtentCount - 1]);
+        }
+
+        //
+        // Keep the seek table in step for any callers that still walk the
+        // chain themselves.
+        //
+
+        FileByteOffset = (ULONGLONG)MappedCount << Volume->ClusterShift;
+        if ((FileByteOffset & FAT_SEEK_OFFSET_MASK) == 0) {
+            TableIndex = FAT_SEEK_TABLE_INDEX(FileByteOffset);
+
+            ASSERT((File->SeekTable[TableIndex] == 0) ||
+                   (File->SeekTable[TableIndex] == NextCluster));
+
+            File->SeekTable[TableIndex] = NextCluster;
+        }
+
+        MappedCount += 1;
+    }
+
+    Status = STATUS_SUCCESS;
+
+ExtentMapExtendEnd:
+    return Status;
+}
+
+KSTATUS
+FatpExtentMapAppend (
+    PFAT_FILE File,
+    ULONG IoFlags,
+    ULONG FileCluster,
+    ULONG Cluster
+    )
+
+/*++
+
+Routine Description:
+
+    This routine adds a new single cluster extent to the end of a file's
+    extent map, growing the map if needed. This routine assumes the extent
+    lock is held.
+
+Arguments:
+
+    File - Supplies a pointer to the FAT file.
+
+    IoFlags - Supplies flags regarding any necessary I/O operations. See
+        IO_FLAG_* definitions.
+
+    FileCluster - Supplies the index of the cluster within the file.
+
+    Cluster - Supplies the volume cluster that backs it.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_NOT_SUPPORTED if the map cannot grow any further.
+
+    STATUS_INSUFFICIENT_RESOURCES on allocation failure.
+
+--*/
+
+{
+
+    ULONG Capacity;
+    PFAT_EXTENT Extent;
+    PFAT_EXTENT NewExtents;
+    KSTATUS Status;
+
+    if (File->ExtentCount == File->ExtentCapacity) {
+        if ((File->ExtentCapacity >= FAT_EXTENT_MAP_MAX_CAPACITY) ||
+            ((IoFlags & IO_FLAG_NO_ALLOCATE) != 0)) {
+
+            Status = STATUS_NOT_SUPPORTED;
+            goto ExtentMapAppendEnd;
+        }
+
+        Capacity = File->ExtentCapacity * 2;
+        if (Capacity == 0) {
+            Capacity = FAT_EXTENT_MAP_INITIAL_CAPACITY;
+        }
+
+        NewExtents = FatAllocatePagedMemory(File->Volume->Device.DeviceToken,
+                                            Capacity * sizeof(FAT_EXTENT));
+
+        if (NewExtents == NULL) {
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+            goto ExtentMapAppendEnd;
+        }
+
+        if (File->Extents != NULL) {
+            RtlCopyMemory(NewExtents,
+                          File->Extents,
+                          File->ExtentCount * sizeof(FAT_EXTENT));
+
+            FatFreePagedMemory(File->Volume->Device.DeviceToken,
+                               File->Extents);
+        }
+
+        File->Extents = NewExtents;
+        File->ExtentCapacity = Capacity;
+    }
+
+    Extent = &(File->Extents[File->ExtentCount]);
+    Extent->FileCluster = FileCluster;
+    Extent->Cluster = Cluster;
+    Extent->Length = 1;
+    File->ExtentCount += 1;
+    Status = STATUS_SUCCESS;
+
+ExtentMapAppendEnd:
+    return Status;
+}
+
@@ -939,6 +939,7 @@ Return Value:
                   sizeof(BLOCK_DEVICE_PARAMETERS));
 
     FatpInitializeFileMappingTree(FatVolume);
+    FatpInitializeDirectoryIndexTree(FatVolume);
     FatVolume->BlockShift =
                           RtlCountTrailingZeros32(FatVolume->Device.BlockSize);
 
@@ -1128,6 +1129,15 @@ Return Value:
         FatVolume->ClusterSearchStart = Information->LastClusterAllocated;
     }
 
+    //
+    // Build the bitmap of free clusters that allocation searches.
+    //
+
+    Status = FatpCreateClusterBitmap(FatVolume);
+    if (!KSUCCESS(Status)) {
+        goto MountEnd;
+    }
+
     Status = STATUS_SUCCESS;
 
 MountEnd:
@@ -1181,8 +1191,10 @@ Return Value:
     PFAT_VOLUME FatVolume;
 
     FatVolume = (PFAT_VOLUME)Volume;
+    FatpDestroyClusterBitmap(FatVolume);
     FatpDestroyFatCache(FatVolume);
     FatpDestroyFileMappingTree(FatVolume);
+    FatpDestroyDirectoryIndexTree(FatVolume);
     FatDestroyLock(FatVolume->Lock);
     FatFreeNonPagedMemory(FatVolume->Device.DeviceToken, FatVolume);
     return STATUS_SUCCESS;
@@ -1365,6 +1377,11 @@ Return Value:
         FatFile->IsRootDirectory = TRUE;
     }
 
+    Status = FatpInitializeExtentMap(FatFile);
+    if (!KSUCCESS(Status)) {
+        goto OpenFileIdEnd;
+    }
+
     *FileToken = FatFile;
     Status = STATUS_SUCCESS;
 
@@ -1428,6 +1445,7 @@ Return Value:
         FatDestroyLock(FatFile->ScratchIoBufferLock);
     }
 
+    FatpDestroyExtentMap(FatFile);
     if ((FatFile->OpenFlags & OPEN_FLAG_PAGE_FILE) != 0) {
         FatFreeNonPagedMemory(FatFile->Volume->Device.DeviceToken, FatFile);
 
@@ -2763,6 +2781,7 @@ Return Value:
     ULONGLONG DiskByteOffset;
     PFAT_FILE File;
     ULONGLONG FileByteOffset;
+    ULONG FileCluster;
     ULONG PreviousCluster;
     ULONG PreviousTableIndex;
     KSTATUS Status;
@@ -2911,42 +2930,71 @@ Return Value:
     }
 
     //
-    // Get the nearest seek table index, and march down until a seek table
-    // entry is filled in. The first one is guaranteed to be filled in.
+    // Look the destination up in the extent map. If the chain ends first, the
+    // map returns the last cluster, and the walk below takes the one step
+    // needed to discover the end and position the seek information there.
     //
 
-    ASSERT(File->SeekTable[0] != 0);
+    FileCluster = DestinationOffset >> Volume->ClusterShift;
+    Status = FatpExtentMapLookup(File,
+                                 IoFlags,
+                                 &FileCluster,
+                                 &CurrentCluster,
+                                 NULL);
 
-    TableIndex = FAT_SEEK_TABLE_INDEX(DestinationOffset);
-    while (File->SeekTable[TableIndex] == 0) {
-        TableIndex -= 1;
-    }
-
-    CurrentOffset = FAT_SEEK_TABLE_OFFSET(TableIndex);
-    CurrentCluster = File->SeekTable[TableIndex];
+    if ((KSUCCESS(Status)) || (Status == STATUS_END_OF_FILE)) {
+        CurrentOffset = (ULONGLONG)FileCluster << Volume->ClusterShift;
+        TableIndex = FAT_SEEK_TABLE_INDEX(CurrentOffset);
 
-    ASSERT((CurrentCluster >= FAT_CLUSTER_BEGIN) &&
-           (CurrentCluster < Volume->ClusterCount));
+    } else if (Status != STATUS_NOT_SUPPORTED) {
+        goto FatFileSeekEnd;
 
     //
-    // As an optimization, if the current offset is below the destination and
-    // closer than this offset, use it.
+    // Without the extent map, fall back to the seek table.
     //
 
-    if ((ALIGN_RANGE_DOWN(FileByteOffset, ClusterSize) <= DestinationOffset) &&
-        (FileByteOffset > CurrentOffset)) {
-
-        CurrentOffset = ALIGN_RANGE_DOWN(FileByteOffset, ClusterSize);
-        if (FatSeekInformation->ClusterByteOffset == ClusterSize) {
+    } else {
+        //
+        // Get the nearest seek table index, and march down until a seek table
+        // entry is filled in. The first one is guaranteed to be filled in.
+        //
 
-            ASSERT(CurrentOffset >= ClusterSize);
+        ASSERT(File->SeekTable[0] != 0);
 
-            CurrentOffset -= ClusterSize;
+        TableIndex = FAT_SEEK_TABLE_INDEX(DestinationOffset);
+        while (File->SeekTable[TableIndex] == 0) {
+            TableIndex -= 1;
         }
 
-        CurrentCluster = FatSeekInformation->CurrentCluster;
+        CurrentOffset = FAT_SEEK_TABLE_OFFSET(TableIndex);
+        CurrentCluster = File->SeekTable[TableIndex];
+
+        ASSERT((CurrentCluster >= FAT_CLUSTER_BEGIN) &&
+               (CurrentCluster < Volume->ClusterCount));
+
+        //
+        // As an optimization, if the current offset is below the destination
+        // and closer than this offset, use it.
+        //
+
+        if ((ALIGN_RANGE_DOWN(FileByteOffset, ClusterSize) <=
+             DestinationOffset) &&
+            (FileByteOffset > CurrentOffset)) {
+
+            CurrentOffset = ALIGN_RANGE_DOWN(FileByteOffset, ClusterSize);
+            if (FatSeekInformation->ClusterByteOffset == ClusterSize) {
+
+                ASSERT(CurrentOffset >= ClusterSize);
+
+                CurrentOffset -= ClusterSize;
+            }
+
+            CurrentCluster = FatSeekInformation->CurrentCluster;
+        }
     }
 
+    Status = STATUS_SUCCESS;
+
     //
     // Cruise the singly linked list of clusters.
     //
@@ -3319,7 +3367,8 @@ Return Value:
         Status = FatpPerformLongEntryMaintenance(&DirectoryContext,
                                                  EntryOffset,
                                                  Checksum,
-                                                 NewChecksum);
+                                                 NewChecksum,
+                                                 NULL);
 
         if (!KSUCCESS(Status)) {
             goto FatWriteFilePropertiesEnd;
@@ -3399,6 +3448,7 @@ Return Value:
     PFAT_VOLUME FatVolume;
     PFAT_FILE File;
     KSTATUS FlushStatus;
+    ULONG KeptClusterCount;
     ULONG NextCluster;
     ULONG StartingCluster;
     KSTATUS Status;
@@ -3411,6 +3461,7 @@ Return Value:
     FatVolume = (PFAT_VOLUME)Volume;
     File = (PFAT_FILE)FileToken;
     ClusterCount = FatVolume->ClusterCount;
+    KeptClusterCount = 0;
     StartingCluster = (ULONG)FileId;
     VolumeLockHeld = FALSE;
 
@@ -3425,6 +3476,7 @@ Return Value:
         // will remain in the file and make that the starting cluster.
         //
 
+        KeptClusterCount = 1;
         while (FileSize > FatVolume->ClusterSize) {
             Status = FatpGetNextCluster(FatVolume,
                                         0,
@@ -3448,6 +3500,7 @@ Return Value:
             }
 
             FileSize -= FatVolume->ClusterSize;
+            KeptClusterCount += 1;
         }
 
         //
@@ -3495,7 +3548,16 @@ Return Value:
     }
 
     //
-    // Clean out the seek table if a file was provided.
+    // If the whole file is going away, it may have been a directory. Drop any
+    // index for it before its first cluster can be handed out again.
+    //
+
+    if (Truncate == FALSE) {
+        FatpDestroyDirectoryIndex(FatVolume, StartingCluster);
+    }
+
+    //
+    // Clean out the seek table and extent map if a file was provided.
     //
 
     if (File != NULL) {
@@ -3506,6 +3568,8 @@ Return Value:
 
         RtlZeroMemory(&(File->SeekTable[TableIndex]),
                       (FAT_SEEK_TABLE_SIZE - TableIndex) * FAT32_CLUSTER_WIDTH);
+
+        FatpExtentMapTruncate(File, KeptClusterCount);
     }
 
     //
@@ -3752,11 +3816,13 @@ Return Value:
 
 {
 
+    ULONG AllocatedCount;
     ULONG Cluster;
     ULONG ClusterCount;
     ULONGLONG CurrentSize;
     BOOL Dirty;
     PFAT_VOLUME FatVolume;
+    ULONG NeededClusters;
     ULONG NextCluster;
     KSTATUS Status;
 
@@ -3775,8 +3841,23 @@ Return Value:
             return Status;
         }
 
+        //
+        // Allocate everything that's left in one go, so that the new
+        // clusters are contiguous. The loop then just follows the new chain.
+        //
+
         if (NextCluster >= ClusterCount) {
-            Status = FatpAllocateCluster(Volume, Cluster, &NextCluster, FALSE);
+            NeededClusters = ALIGN_RANGE_UP(FileSize - CurrentSize,
+                                            FatVolume->ClusterSize) >>
+                             FatVolume->ClusterShift;
+
+            Status = FatpAllocateClusterRun(Volume,
+                                            Cluster,
+                                            NeededClusters,
+                                            &NextCluster,
+                                            &AllocatedCount,
+                                            FALSE);
+
             if (!KSUCCESS(Status)) {
                 return Status;
             }
@@ -3860,6 +3941,7 @@ Return Value:
 
 {
 
+    ULONG AllocatedCount;
     ULONG BlockByteOffset;
     UINTN BlockCount;
     ULONG BlockShift;
@@ -3873,11 +3955,15 @@ Return Value:
     ULONG CurrentCluster;
     PFAT_FILE File;
     ULONGLONG FileByteOffset;
+    ULONG FileCluster;
     KSTATUS FlushStatus;
+    ULONG MappedCluster;
     UINTN MaxContiguousBytes;
+    ULONG NeededClusters;
     ULONG NewCluster;
     BOOL NewTerritory;
     ULONG NextCluster;
+    ULONG RunLength;
     PFAT_IO_BUFFER ScratchIoBuffer;
     BOOL ScratchLockHeld;
     KSTATUS Status;
@@ -4004,10 +4090,15 @@ Return Value:
             ASSERT((IoFlags & IO_FLAG_NO_ALLOCATE) == 0);
             ASSERT((File->OpenFlags & OPEN_FLAG_PAGE_FILE) == 0);
 
-            Status = FatpAllocateCluster(Volume,
-                                         FatSeekInformation->CurrentCluster,
-                                         &NewCluster,
-                                         FALSE);
+            NeededClusters = ALIGN_RANGE_UP(SizeInBytes, ClusterSize) >>
+                             ClusterShift;
+
+            Status = FatpAllocateClusterRun(Volume,
+                                            FatSeekInformation->CurrentCluster,
+                                            NeededClusters,
+                                            &NewCluster,
+                                            &AllocatedCount,
+                                            FALSE);
 
             if (!KSUCCESS(Status)) {
                 goto PerformFileIoEnd;
@@ -4074,6 +4165,42 @@ Return Value:
 
             CurrentCluster = FatSeekInformation->CurrentCluster;
             FileByteOffset = FatSeekInformation->FileByteOffset;
+
+            //
+            // Skip over the rest of the run the extent map already knows
+            // about, so the chain only needs to be consulted for the cluster
+            // after it.
+            //
+
+            if (MaxContiguousBytes < SizeInBytes) {
+                FileCluster = (FileByteOffset -
+                               FatSeekInformation->ClusterByteOffset) >>
+                              ClusterShift;
+
+                Status = FatpExtentMapLookup(File,
+                                             IoFlags,
+                                             &FileCluster,
+                                             &MappedCluster,
+                                             &RunLength);
+
+                if ((KSUCCESS(Status)) && (MappedCluster == CurrentCluster)) {
+                    NeededClusters = ALIGN_RANGE_UP(
+                                           SizeInBytes - MaxContiguousBytes,
+                                           ClusterSize) >> ClusterShift;
+
+                    RunLength -= 1;
+                    if (RunLength > NeededClusters) {
+                        RunLength = NeededClusters;
+                    }
+
+                    MaxContiguousBytes += (UINTN)RunLength << ClusterShift;
+                    CurrentCluster += RunLength;
+                    FileByteOffset += (ULONGLONG)RunLength << ClusterShift;
+                }
+
+                Status = STATUS_SUCCESS;
+            }
+
             while (MaxContiguousBytes < SizeInBytes) {
                 Status = FatpGetNextCluster(Volume,
                                             IoFlags,
@@ -4099,10 +4226,21 @@ Return Value:
                     ASSERT((IoFlags & IO_FLAG_NO_ALLOCATE) == 0);
                     ASSERT((File->OpenFlags & OPEN_FLAG_PAGE_FILE) == 0);
 
-                    Status = FatpAllocateCluster(Volume,
-                                                 CurrentCluster,
-                                                 &NewCluster,
-                                                 FALSE);
+                    //
+                    // Allocate a run sized to the rest of the I/O, so the
+                    // clusters for a large write land contiguously.
+                    //
+
+                    NeededClusters = ALIGN_RANGE_UP(
+                                           SizeInBytes - MaxContiguousBytes,
+                                           ClusterSize) >> ClusterShift;
+
+                    Status = FatpAllocateClusterRun(Volume,
+                                                    CurrentCluster,
+                                                    NeededClusters,
+                                                    &NewCluster,
+                                                    &AllocatedCount,
+                                                    FALSE);
 
                     if (!KSUCCESS(Status)) {
                         goto PerformFileIoEnd;
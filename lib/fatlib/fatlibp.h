@@ -265,6 +265,22 @@ Structure Description:
     FatCache - Stores the File Allocation Table cache. This is used for cluster
         allocation and next cluster lookup during seek, read, and write.
 
+    FreeBitmap - Stores a pointer to a bitmap with a bit set for each free
+        cluster on the volume. It is built at mount time and kept in step with
+        the FAT under the volume lock.
+
+    FreeClusterCount - Stores the number of free clusters on the volume.
+
+    DirectoryIndexTree - Stores the tree of hashed directory indices, keyed by
+        the starting cluster of each indexed directory.
+
+    DirectoryIndexEntryCount - Stores the total number of names held in all
+        directory indices on the volume.
+
+    DirectoryModifyCount - Stores a counter that is incremented every time a
+        directory entry is created or erased, used to detect directory changes
+        made while an index is being built.
+
 --*/
 
 typedef struct _FAT_VOLUME {
@@ -292,10 +308,39 @@ typedef struct _FAT_VOLUME {
     PVOID Lock;
     RED_BLACK_TREE FileMappingTree;
     FAT_CACHE FatCache;
+    PULONG FreeBitmap;
+    ULONG FreeClusterCount;
+    RED_BLACK_TREE DirectoryIndexTree;
+    ULONG DirectoryIndexEntryCount;
+    ULONG DirectoryModifyCount;
 } FAT_VOLUME, *PFAT_VOLUME;
 
 /*++
 
+Structure Description:
+
+    This structure defines a run of physically contiguous clusters within a
+    file.
+
+Members:
+
+    FileCluster - Stores the index of the first cluster of the run, counted in
+        clusters from the beginning of the file.
+
+    Cluster - Stores the volume cluster number where the run begins.
+
+    Length - Stores the number of clusters in the run.
+
+--*/
+
+typedef struct _FAT_EXTENT {
+    ULONG FileCluster;
+    ULONG Cluster;
+    ULONG Length;
+} FAT_EXTENT, *PFAT_EXTENT;
+
+/*++
+
 Structure Description:
 
     This structure defines file system state associated with an open file.
@@ -325,6 +370,17 @@ Structure Description:
         out the maximum theoretical file size of 4GB. The first value is file
         offset 0, and is always filled in.
 
+    ExtentLock - Stores a pointer to the lock synchronizing access to the
+        extent map.
+
+    Extents - Stores a pointer to the extent map, an array of runs of
+        contiguous clusters sorted by file cluster. The map always describes
+        an unbroken prefix of the file's cluster chain.
+
+    ExtentCount - Stores the number of valid extents in the map.
+
+    ExtentCapacity - Stores the number of extents the array can hold.
+
 --*/
 
 typedef struct _FAT_FILE {
@@ -334,6 +390,10 @@ typedef struct _FAT_FILE {
     PVOID ScratchIoBufferLock;
     PFAT_IO_BUFFER ScratchIoBuffer;
     ULONG SeekTable[FAT_SEEK_TABLE_SIZE];
+    PVOID ExtentLock;
+    PFAT_EXTENT Extents;
+    ULONG ExtentCount;
+    ULONG ExtentCapacity;
 } FAT_FILE, *PFAT_FILE;
 
 /*++
@@ -665,6 +725,60 @@ Return Value:
 
 --*/
 
+KSTATUS
+FatpAllocateClusterRun (
+    PFAT_VOLUME Volume,
+    ULONG PreviousCluster,
+    ULONG ClusterCount,
+    PULONG NewCluster,
+    PULONG AllocatedCount,
+    BOOL Flush
+    );
+
+/*++
+
+Routine Description:
+
+    This routine allocates a run of contiguous free clusters, chains them
+    together, and chains the run so that the specified previous cluster points
+    to it. The run starts just after the previous cluster if that space is
+    free, so that files grow contiguously. Fewer clusters than requested may
+    be allocated if the free space is fragmented; the caller can allocate
+    again to get the rest.
+
+Arguments:
+
+    Volume - Supplies a pointer to the FAT volume.
+
+    PreviousCluster - Supplies the cluster that should point to the newly
+        allocated run. Specify FAT32_CLUSTER_END if no previous cluster should
+        be updated.
+
+    ClusterCount - Supplies the desired number of clusters.
+
+    NewCluster - Supplies a pointer that will receive the first cluster of the
+        new run.
+
+    AllocatedCount - Supplies a pointer that will receive the number of
+        clusters allocated. This is at least one on success.
+
+    Flush - Supplies a boolean indicating if the FAT cache should be flushed.
+        Supply TRUE here unless multiple allocations are going to be made in
+        bulk, in which case the caller needs to explicitly flush the FAT
+        cache.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_INVALID_PARAMETER if an invalid cluster was supplied.
+
+    STATUS_VOLUME_FULL if no free clusters exist.
+
+    Other error codes on device I/O errors.
+
+--*/
+
 KSTATUS
 FatpFreeClusterChain (
     PFAT_VOLUME Volume,
@@ -843,7 +957,8 @@ FatpPerformLongEntryMaintenance (
     PFAT_DIRECTORY_CONTEXT Directory,
     ULONGLONG EntryOffset,
     UCHAR Checksum,
-    ULONG NewChecksum
+    ULONG NewChecksum,
+    PULONG EntryCount
     );
 
 /*++
@@ -867,6 +982,9 @@ Routine Description:
     NewChecksum - Supplies the new checksum to set in the long entries. If this
         is -1, then the directory entries will be marked erased.
 
+    EntryCount - Supplies an optional pointer that receives the number of long
+        entries that were modified.
+
 Return Value:
 
     Status code.
@@ -1326,6 +1444,236 @@ Return Value:
 
 --*/
 
+//
+// Directory index support functions.
+//
+
+VOID
+FatpInitializeDirectoryIndexTree (
+    PFAT_VOLUME Volume
+    );
+
+/*++
+
+Routine Description:
+
+    This routine initializes the tree of directory indices for the given
+    volume.
+
+Arguments:
+
+    Volume - Supplies a pointer to the FAT volume structure.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+FatpDestroyDirectoryIndexTree (
+    PFAT_VOLUME Volume
+    );
+
+/*++
+
+Routine Description:
+
+    This routine destroys all directory indices for the given volume.
+
+Arguments:
+
+    Volume - Supplies a pointer to the FAT volume structure.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+FatpDestroyDirectoryIndex (
+    PFAT_VOLUME Volume,
+    ULONG DirectoryCluster
+    );
+
+/*++
+
+Routine Description:
+
+    This routine throws away the index for the given directory, if there is
+    one. The next lookup in the directory will rebuild it.
+
+Arguments:
+
+    Volume - Supplies a pointer to the FAT volume structure.
+
+    DirectoryCluster - Supplies the starting cluster of the directory.
+
+Return Value:
+
+    None.
+
+--*/
+
+KSTATUS
+FatpDirectoryIndexLookup (
+    PFAT_VOLUME Volume,
+    PFAT_DIRECTORY_CONTEXT Directory,
+    PCSTR Name,
+    ULONG NameLength,
+    PULONGLONG EntryOffset
+    );
+
+/*++
+
+Routine Description:
+
+    This routine looks up a name in the index for a directory, building the
+    index if this is the first lookup in the directory. The caller is
+    expected to verify the entry at the returned offset.
+
+Arguments:
+
+    Volume - Supplies a pointer to the FAT volume structure.
+
+    Directory - Supplies a pointer to the directory context for the open
+        directory. Its position may be changed by this routine.
+
+    Name - Supplies the name of the file to find.
+
+    NameLength - Supplies the size of the name buffer in bytes, including the
+        null terminator.
+
+    EntryOffset - Supplies a pointer where the directory offset of the short
+        entry for the file will be returned on success.
+
+Return Value:
+
+    STATUS_SUCCESS if the name was found in the index.
+
+    STATUS_PATH_NOT_FOUND if the index says the name is not in the directory.
+
+    STATUS_NOT_SUPPORTED if there is no index for the directory and one could
+    not be built. The caller should scan the directory instead.
+
+--*/
+
+KSTATUS
+FatpDirectoryIndexFindFreeSlots (
+    PFAT_VOLUME Volume,
+    ULONG DirectoryCluster,
+    ULONG EntryCount,
+    PULONGLONG EntryOffset,
+    PBOOL AtEnd
+    );
+
+/*++
+
+Routine Description:
+
+    This routine uses the index for a directory to find a place to put a new
+    set of directory entries. Like a scan of the directory would, it picks the
+    first run of erased entries that is big enough, or the end of the
+    directory. The slots are not claimed until the entries are inserted.
+
+Arguments:
+
+    Volume - Supplies a pointer to the FAT volume structure.
+
+    DirectoryCluster - Supplies the starting cluster of the directory.
+
+    EntryCount - Supplies the number of consecutive entries needed.
+
+    EntryOffset - Supplies a pointer where the directory offset of the first
+        free slot will be returned.
+
+    AtEnd - Supplies a pointer where a boolean will be returned indicating
+        whether the slots are at the end of the directory, in which case a new
+        terminating entry needs to be written after them.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_NOT_SUPPORTED if the directory has no index.
+
+--*/
+
+VOID
+FatpDirectoryIndexInsert (
+    PFAT_VOLUME Volume,
+    ULONG DirectoryCluster,
+    PCSTR Name,
+    ULONG NameLength,
+    ULONGLONG EntryOffset,
+    ULONG EntryCount
+    );
+
+/*++
+
+Routine Description:
+
+    This routine records a newly written set of directory entries in the index
+    for the directory, if it has one. If the index cannot be kept accurate, it
+    is thrown away.
+
+Arguments:
+
+    Volume - Supplies a pointer to the FAT volume structure.
+
+    DirectoryCluster - Supplies the starting cluster of the directory.
+
+    Name - Supplies the name of the new file.
+
+    NameLength - Supplies the size of the name buffer in bytes, including the
+        null terminator.
+
+    EntryOffset - Supplies the directory offset of the first entry written,
+        which may be a long file name entry.
+
+    EntryCount - Supplies the number of entries written, including the short
+        entry at the end.
+
+Return Value:
+
+    None.
+
+--*/
+
+VOID
+FatpDirectoryIndexRemove (
+    PFAT_VOLUME Volume,
+    ULONG DirectoryCluster,
+    ULONGLONG EntryOffset,
+    ULONG EntryCount
+    );
+
+/*++
+
+Routine Description:
+
+    This routine removes an erased set of directory entries from the index for
+    the directory, if it has one, and records the erased entries as free. If
+    the index cannot be kept accurate, it is thrown away.
+
+Arguments:
+
+    Volume - Supplies a pointer to the FAT volume structure.
+
+    DirectoryCluster - Supplies the starting cluster of the directory.
+
+    EntryOffset - Supplies the directory offset of the erased short entry.
+
+    EntryCount - Supplies the number of entries erased, including the short
+        entry and any long file name entries directly before it.
+
+Return Value:
+
+    None.
+
+--*/
+
 //
 // File Allocation Table cache support functions.
 //
@@ -1525,3 +1873,246 @@ Return Value:
     Status code.
 
 --*/
+
+//
+// Extent map support functions.
+//
+
+KSTATUS
+FatpInitializeExtentMap (
+    PFAT_FILE File
+    );
+
+/*++
+
+Routine Description:
+
+    This routine initializes the extent map for a newly opened file. The map
+    starts out empty and is populated lazily as the file is accessed.
+
+Arguments:
+
+    File - Supplies a pointer to the FAT file.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+VOID
+FatpDestroyExtentMap (
+    PFAT_FILE File
+    );
+
+/*++
+
+Routine Description:
+
+    This routine tears down a file's extent map.
+
+Arguments:
+
+    File - Supplies a pointer to the FAT file.
+
+Return Value:
+
+    None.
+
+--*/
+
+KSTATUS
+FatpExtentMapLookup (
+    PFAT_FILE File,
+    ULONG IoFlags,
+    PULONG FileCluster,
+    PULONG Cluster,
+    PULONG RunLength
+    );
+
+/*++
+
+Routine Description:
+
+    This routine translates a cluster index within a file into the volume
+    cluster that backs it, extending the extent map from the end of the
+    mapped region if needed.
+
+Arguments:
+
+    File - Supplies a pointer to the FAT file.
+
+    IoFlags - Supplies flags regarding any necessary I/O operations. See
+        IO_FLAG_* definitions.
+
+    FileCluster - Supplies a pointer that on input contains the index of the
+        cluster within the file to look up. If the file's cluster chain ends
+        before this index, this returns the index of the last cluster in the
+        file.
+
+    Cluster - Supplies a pointer where the volume cluster number will be
+        returned.
+
+    RunLength - Supplies an optional pointer where the number of physically
+        contiguous clusters starting at the returned cluster will be returned.
+        This is always at least one, but may be shorter than the true run if
+        the map has not yet seen the rest of it.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_END_OF_FILE if the file has fewer clusters than requested. The last
+    cluster of the file is returned.
+
+    STATUS_NOT_SUPPORTED if the extent map cannot answer the request, either
+    because the file does not have one or because it has grown as large as it
+    is allowed to. The caller should walk the cluster chain itself.
+
+    STATUS_FILE_CORRUPT if the cluster chain is corrupt.
+
+    Other error codes on device I/O errors.
+
+--*/
+
+VOID
+FatpExtentMapTruncate (
+    PFAT_FILE File,
+    ULONG ClusterCount
+    );
+
+/*++
+
+Routine Description:
+
+    This routine discards the portion of a file's extent map beyond the given
+    number of clusters. It should be called whenever clusters are removed
+    from the end of the file's chain.
+
+Arguments:
+
+    File - Supplies a pointer to the FAT file.
+
+    ClusterCount - Supplies the number of clusters that remain in the file.
+
+Return Value:
+
+    None.
+
+--*/
+
+//
+// Free cluster bitmap support functions.
+//
+
+KSTATUS
+FatpCreateClusterBitmap (
+    PFAT_VOLUME Volume
+    );
+
+/*++
+
+Routine Description:
+
+    This routine creates the free cluster bitmap for a volume by scanning the
+    File Allocation Table, and computes the number of free clusters.
+
+Arguments:
+
+    Volume - Supplies a pointer to the FAT volume structure.
+
+Return Value:
+
+    Status code.
+
+--*/
+
+VOID
+FatpDestroyClusterBitmap (
+    PFAT_VOLUME Volume
+    );
+
+/*++
+
+Routine Description:
+
+    This routine destroys the free cluster bitmap for a volume.
+
+Arguments:
+
+    Volume - Supplies a pointer to the FAT volume structure.
+
+Return Value:
+
+    None.
+
+--*/
+
+ULONG
+FatpClusterBitmapFindRun (
+    PFAT_VOLUME Volume,
+    ULONG Goal,
+    ULONG DesiredCount,
+    PULONG RunLength
+    );
+
+/*++
+
+Routine Description:
+
+    This routine finds a run of free clusters. It first tries to start the run
+    at the goal cluster, so a file can keep growing contiguously. Failing
+    that, it returns the first run at or after the volume's search start that
+    is at least the desired length, or the longest run on the volume if there
+    are none that long. This routine assumes the volume lock is held.
+
+Arguments:
+
+    Volume - Supplies a pointer to the FAT volume structure.
+
+    Goal - Supplies the preferred first cluster of the run, or 0 for no
+        preference.
+
+    DesiredCount - Supplies the number of clusters wanted.
+
+    RunLength - Supplies a pointer where the number of free clusters in the
+        run will be returned. This is never more than the desired count.
+
+Return Value:
+
+    Returns the first cluster of the run.
+
+    FAT_CLUSTER_FREE (0) if there are no free clusters on the volume.
+
+--*/
+
+VOID
+FatpClusterBitmapMark (
+    PFAT_VOLUME Volume,
+    ULONG Cluster,
+    BOOL Free
+    );
+
+/*++
+
+Routine Description:
+
+    This routine marks a cluster as free or allocated in the volume's free
+    cluster bitmap, keeping the free cluster count in step. This routine
+    assumes the volume lock is held.
+
+Arguments:
+
+    Volume - Supplies a pointer to the FAT volume structure.
+
+    Cluster - Supplies the cluster to mark.
+
+    Free - Supplies a boolean indicating whether the cluster is now free
+        (TRUE) or allocated (FALSE).
+
+Return Value:
+
+    None.
+
+--*/
+
@@ -148,6 +148,7 @@ Return Value:
 
     ULONG Cluster;
     ULONG EntriesRead;
+    BOOL Found;
     BOOL IsDotEntry;
     ULONGLONG Offset;
     PSTR PotentialName;
@@ -155,6 +156,7 @@ Return Value:
     ULONG PotentialNameSize;
     KSTATUS Status;
 
+    Found = FALSE;
     Offset = DIRECTORY_CONTENTS_OFFSET;
     PotentialName = NULL;
     if (NameLength <= 1) {
@@ -162,91 +164,128 @@ Return Value:
     }
 
     //
-    // Seek to the beginning of the directory.
+    // Try the directory's name index first. If it has no entry, the file
+    // isn't there. If the entry it points at doesn't look right, throw the
+    // index away and fall back to scanning the directory.
     //
 
-    Status = FatpDirectorySeek(Directory, Offset);
-    if (!KSUCCESS(Status)) {
+    Status = FatpDirectoryIndexLookup(Volume,
+                                      Directory,
+                                      Name,
+                                      NameLength,
+                                      &Offset);
+
+    if (Status == STATUS_PATH_NOT_FOUND) {
         goto LookupDirectoryEntryEnd;
     }
 
-    //
-    // Allocate a buffer for the name.
-    //
+    if (KSUCCESS(Status)) {
+        Status = FatpDirectorySeek(Directory, Offset);
+        if (KSUCCESS(Status)) {
+            Status = FatpReadDirectory(Directory, Entry, 1, &EntriesRead);
+        }
 
-    PotentialNameBufferSize = FAT_MAX_LONG_FILE_LENGTH + 1;
-    PotentialName = FatAllocatePagedMemory(Volume->Device.DeviceToken,
-                                           PotentialNameBufferSize);
+        if ((KSUCCESS(Status)) &&
+            (EntriesRead == 1) &&
+            (Entry->FileAttributes != FAT_LONG_FILE_NAME_ATTRIBUTES) &&
+            (Entry->DosName[0] != FAT_DIRECTORY_ENTRY_ERASED) &&
+            (Entry->DosName[0] != FAT_DIRECTORY_ENTRY_END)) {
 
-    if (PotentialName == NULL) {
-        Status = STATUS_INSUFFICIENT_RESOURCES;
-        goto LookupDirectoryEntryEnd;
+            Found = TRUE;
+
+        } else {
+            FatpDestroyDirectoryIndex(Volume, Directory->File->SeekTable[0]);
+            Offset = DIRECTORY_CONTENTS_OFFSET;
+        }
     }
 
-    //
-    // Loop reading directory entries until a matching one is found or the end
-    // is reached.
-    //
+    if (Found == FALSE) {
 
-    while (TRUE) {
-        PotentialNameSize = PotentialNameBufferSize;
-        Status = FatpReadNextDirectoryEntry(Directory,
-                                            NULL,
-                                            PotentialName,
-                                            &PotentialNameSize,
-                                            Entry,
-                                            &EntriesRead);
+        //
+        // Seek to the beginning of the directory.
+        //
 
+        Status = FatpDirectorySeek(Directory, Offset);
         if (!KSUCCESS(Status)) {
-            if (Status == STATUS_END_OF_FILE) {
-                Status = STATUS_PATH_NOT_FOUND;
-            }
-
             goto LookupDirectoryEntryEnd;
         }
 
-        Offset += EntriesRead;
-        if (PotentialNameSize > NameLength) {
-            continue;
-        }
+        //
+        // Allocate a buffer for the name.
+        //
 
-        if (RtlAreStringsEqual(Name, PotentialName, NameLength - 1) != FALSE) {
+        PotentialNameBufferSize = FAT_MAX_LONG_FILE_LENGTH + 1;
+        PotentialName = FatAllocatePagedMemory(Volume->Device.DeviceToken,
+                                               PotentialNameBufferSize);
 
-            ASSERT(Offset != 0);
+        if (PotentialName == NULL) {
+            Status = STATUS_INSUFFICIENT_RESOURCES;
+            goto LookupDirectoryEntryEnd;
+        }
 
-            Offset -= 1;
+        //
+        // Loop reading directory entries until a matching one is found or the
+        // end is reached.
+        //
 
-            //
-            // Set the mapping between the file and the directory, except for
-            // the . and .. entries. Also, empty files may have a cluster ID of
-            // 0, don't save those either.
-            //
+        while (TRUE) {
+            PotentialNameSize = PotentialNameBufferSize;
+            Status = FatpReadNextDirectoryEntry(Directory,
+                                                NULL,
+                                                PotentialName,
+                                                &PotentialNameSize,
+                                                Entry,
+                                                &EntriesRead);
+
+            if (!KSUCCESS(Status)) {
+                if (Status == STATUS_END_OF_FILE) {
+                    Status = STATUS_PATH_NOT_FOUND;
+                }
 
-            IsDotEntry = FALSE;
-            if ((Name[0] == '.') &&
-                ((Name[1] == '\0') ||
-                 ((Name[1] == '.') && (Name[2] == '\0')))) {
+                goto LookupDirectoryEntryEnd;
+            }
 
-                IsDotEntry = TRUE;
+            Offset += EntriesRead;
+            if (PotentialNameSize > NameLength) {
+                continue;
             }
 
-            if (IsDotEntry == FALSE) {
-                Cluster = (Entry->ClusterHigh << 16) | Entry->ClusterLow;
-                if ((Cluster >= FAT_CLUSTER_BEGIN) &&
-                    (Cluster < Volume->ClusterBad)) {
+            if (RtlAreStringsEqual(Name,
+                                   PotentialName,
+                                   NameLength - 1) != FALSE) {
 
-                    Status = FatpSetFileMapping(Volume,
-                                                Cluster,
-                                                Directory->File->SeekTable[0],
-                                                Offset);
+                ASSERT(Offset != 0);
 
-                    if (!KSUCCESS(Status)) {
-                        goto LookupDirectoryEntryEnd;
-                    }
-                }
+                Offset -= 1;
+                break;
             }
+        }
+    }
 
-            break;
+    //
+    // Set the mapping between the file and the directory, except for the . and
+    // .. entries. Also, empty files may have a cluster ID of 0, don't save
+    // those either.
+    //
+
+    IsDotEntry = FALSE;
+    if ((Name[0] == '.') &&
+        ((Name[1] == '\0') || ((Name[1] == '.') && (Name[2] == '\0')))) {
+
+        IsDotEntry = TRUE;
+    }
+
+    if (IsDotEntry == FALSE) {
+        Cluster = (Entry->ClusterHigh << 16) | Entry->ClusterLow;
+        if ((Cluster >= FAT_CLUSTER_BEGIN) && (Cluster < Volume->ClusterBad)) {
+            Status = FatpSetFileMapping(Volume,
+                                        Cluster,
+                                        Directory->File->SeekTable[0],
+                                        Offset);
+
+            if (!KSUCCESS(Status)) {
+                goto LookupDirectoryEntryEnd;
+            }
         }
     }
 
@@ -537,6 +576,7 @@ Return Value:
     ULONGLONG EntryOffset;
     FAT_DIRECTORY_ENTRY ExistingEntry;
     ULONG FirstCluster;
+    KSTATUS IndexStatus;
     PFAT_DIRECTORY_ENTRY NewEntries;
     ULONGLONG Offset;
     ULONGLONG PotentialOffset;
@@ -612,113 +652,140 @@ Return Value:
     ASSERT(EntryCount != 0);
 
     //
-    // Reset to the beginning of the directory file.
+    // Ask the directory's index where the entries can go. The fixed-size root
+    // directory of FAT12 and FAT16 volumes is always scanned, since running
+    // off the end of it needs to fail rather than grow the directory.
     //
 
-    Offset = DIRECTORY_CONTENTS_OFFSET;
-    Status = FatpDirectorySeek(&DirectoryContext, Offset);
-    if (!KSUCCESS(Status)) {
-        goto CreateDirectoryEntryEnd;
+    IndexStatus = STATUS_NOT_SUPPORTED;
+    if (((PFAT_FILE)Directory)->IsRootDirectory == FALSE) {
+        IndexStatus = FatpDirectoryIndexFindFreeSlots(
+                                          Volume,
+                                          ((PFAT_FILE)Directory)->SeekTable[0],
+                                          EntryCount,
+                                          &EntryOffset,
+                                          &WriteEndEntry);
     }
 
-    //
-    // Look for either enough deleted entries or the ending entry.
-    //
-
-    EntryOffset = -1;
-    PotentialOffset = -1;
-    SpanCount = 0;
-    WriteEndEntry = FALSE;
-    while (TRUE) {
-        Status = FatpReadDirectory(&DirectoryContext,
-                                   &DirectoryEntry,
-                                   1,
-                                   &EntriesRead);
-
-        if (Status == STATUS_END_OF_FILE) {
-            WriteEndEntry = TRUE;
-            break;
+    if (KSUCCESS(IndexStatus)) {
+        Status = FatpDirectorySeek(&DirectoryContext, EntryOffset);
+        if ((!KSUCCESS(Status)) &&
+            ((Status != STATUS_END_OF_FILE) || (WriteEndEntry == FALSE))) {
 
-        } else if (!KSUCCESS(Status)) {
             goto CreateDirectoryEntryEnd;
         }
 
+    } else {
         //
-        // If this is the root directory and the end of it was reached, there's
-        // no space in the root directory.
+        // Reset to the beginning of the directory file.
         //
 
-        if (EntriesRead == 0) {
-            Status = STATUS_VOLUME_FULL;
+        Offset = DIRECTORY_CONTENTS_OFFSET;
+        Status = FatpDirectorySeek(&DirectoryContext, Offset);
+        if (!KSUCCESS(Status)) {
             goto CreateDirectoryEntryEnd;
         }
 
-        ASSERT(EntriesRead == 1);
-
         //
-        // If the end is found, use it.
+        // Look for either enough deleted entries or the ending entry.
         //
 
-        if (DirectoryEntry.DosName[0] == FAT_DIRECTORY_ENTRY_END) {
-            EntryOffset = Offset;
-            WriteEndEntry = TRUE;
-            break;
-        }
+        EntryOffset = -1;
+        PotentialOffset = -1;
+        SpanCount = 0;
+        WriteEndEntry = FALSE;
+        while (TRUE) {
+            Status = FatpReadDirectory(&DirectoryContext,
+                                       &DirectoryEntry,
+                                       1,
+                                       &EntriesRead);
 
-        //
-        // If an erased entry was found, that's also perfect.
-        //
+            if (Status == STATUS_END_OF_FILE) {
+                WriteEndEntry = TRUE;
+                break;
 
-        if (DirectoryEntry.DosName[0] == FAT_DIRECTORY_ENTRY_ERASED) {
-            if (PotentialOffset == -1) {
-                PotentialOffset = Offset;
-                SpanCount = 1;
+            } else if (!KSUCCESS(Status)) {
+                goto CreateDirectoryEntryEnd;
+            }
 
-            } else {
-                SpanCount += 1;
+            //
+            // If this is the root directory and the end of it was reached,
+            // there's no space in the root directory.
+            //
+
+            if (EntriesRead == 0) {
+                Status = STATUS_VOLUME_FULL;
+                goto CreateDirectoryEntryEnd;
             }
 
-            if (SpanCount >= EntryCount) {
-                EntryOffset = PotentialOffset;
+            ASSERT(EntriesRead == 1);
+
+            //
+            // If the end is found, use it.
+            //
+
+            if (DirectoryEntry.DosName[0] == FAT_DIRECTORY_ENTRY_END) {
+                EntryOffset = Offset;
+                WriteEndEntry = TRUE;
                 break;
             }
 
-        //
-        // This is a regular entry, so it breaks the span.
-        //
+            //
+            // If an erased entry was found, that's also perfect.
+            //
 
-        } else {
-            PotentialOffset = -1;
-            SpanCount = 0;
-        }
+            if (DirectoryEntry.DosName[0] == FAT_DIRECTORY_ENTRY_ERASED) {
+                if (PotentialOffset == -1) {
+                    PotentialOffset = Offset;
+                    SpanCount = 1;
 
-        Offset += 1;
-    }
+                } else {
+                    SpanCount += 1;
+                }
 
-    //
-    // Seek either to the desired entry or to the end. If no entry was found,
-    // the file pointer must already be at the end, so there's no need to seek.
-    //
+                if (SpanCount >= EntryCount) {
+                    EntryOffset = PotentialOffset;
+                    break;
+                }
 
-    if (EntryOffset != -1) {
-        Status = FatpDirectorySeek(&DirectoryContext, EntryOffset);
-        if (!KSUCCESS(Status)) {
+            //
+            // This is a regular entry, so it breaks the span.
+            //
 
-            ASSERT(Status != STATUS_END_OF_FILE);
+            } else {
+                PotentialOffset = -1;
+                SpanCount = 0;
+            }
 
-            goto CreateDirectoryEntryEnd;
+            Offset += 1;
         }
 
-    //
-    // If an entry offset is not set, then this better have reached the end of
-    // the file.
-    //
+        //
+        // Seek either to the desired entry or to the end. If no entry was
+        // found, the file pointer must already be at the end, so there's no
+        // need to seek.
+        //
 
-    } else {
+        if (EntryOffset != -1) {
+            Status = FatpDirectorySeek(&DirectoryContext, EntryOffset);
+            if (!KSUCCESS(Status)) {
+
+                ASSERT(Status != STATUS_END_OF_FILE);
+
+                goto CreateDirectoryEntryEnd;
+            }
+
+        //
+        // If an entry offset is not set, then this better have reached the end
+        // of the file.
+        //
 
-        ASSERT(Status == STATUS_END_OF_FILE);
+        } else {
+
+            ASSERT(Status == STATUS_END_OF_FILE);
 
-        EntryOffset = Offset;
+            EntryOffset = Offset;
+        }
     }
 
     //
@@ -786,6 +853,13 @@ Return Value:
         goto CreateDirectoryEntryEnd;
     }
 
+    FatpDirectoryIndexInsert(Volume,
+                             ((PFAT_FILE)Directory)->SeekTable[0],
+                             FileName,
+                             FileNameLength,
+                             EntryOffset,
+                             EntryCount);
+
     *DirectorySize = DirectoryContext.ClusterPosition.FileByteOffset;
     Status = STATUS_SUCCESS;
 
@@ -1319,152 +1393,148 @@ Return Value:
 
 {
 
-    ULONG AllocatedCluster;
-    ULONG BlockShift;
-    ULONG ClusterCount;
-    ULONG ClusterEnd;
-    ULONG CurrentCluster;
+    ULONG AllocatedCount;
+
+    return FatpAllocateClusterRun(Volume,
+                                  PreviousCluster,
+                                  1,
+                                  NewCluster,
+                                  &AllocatedCount,
+                                  Flush);
+}
+
+KSTATUS
+FatpAllocateClusterRun (
+    PFAT_VOLUME Volume,
+    ULONG PreviousCluster,
+    ULONG ClusterCount,
+    PULONG NewCluster,
+    PULONG AllocatedCount,
+    BOOL Flush
+    )
+
+/*++
+
+Routine Description:
+
+    This routine allocates a run of contiguous free clusters, chains them
+    together, and chains the run so that the specified previous cluster points
+    to it. The run starts just after the previous cluster if that space is
+    free, so that files grow contiguously. Fewer clusters than requested may
+    be allocated if the free space is fragmented; the caller can allocate
+    again to get the rest.
+
+Arguments:
+
+    Volume - Supplies a pointer to the FAT volume.
+
+    PreviousCluster - Supplies the cluster that should point to the newly
+        allocated run. Specify FAT32_CLUSTER_END if no previous cluster should
+        be updated.
+
+    ClusterCount - Supplies the desired number of clusters.
+
+    NewCluster - Supplies a pointer that will receive the first cluster of the
+        new run.
+
+    AllocatedCount - Supplies a pointer that will receive the number of
+        clusters allocated. This is at least one on success.
+
+    Flush - Supplies a boolean indicating if the FAT cache should be flushed.
+        Supply TRUE here unless multiple allocations are going to be made in
+        bulk, in which case the caller needs to explicitly flush the FAT
+        cache.
+
+Return Value:
+
+    STATUS_SUCCESS on success.
+
+    STATUS_INVALID_PARAMETER if an invalid cluster was supplied.
+
+    STATUS_VOLUME_FULL if no free clusters exist.
+
+    Other error codes on device I/O errors.
+
+--*/
+
+{
+
+    ULONG Cluster;
+    ULONG Goal;
+    ULONG Index;
     PFAT32_INFORMATION_SECTOR Information;
     ULONGLONG InformationBlock;
     PFAT_IO_BUFFER InformationIoBuffer;
     ULONG IoFlags;
-    ULONG SearchStart;
+    ULONG RunLength;
+    ULONG RunStart;
     KSTATUS Status;
     ULONG Value;
-    PVOID Window;
-    PUSHORT Window16;
-    PULONG Window32;
-    ULONG WindowOffset;
-    ULONG WindowSize;
-
-    AllocatedCluster = FAT_CLUSTER_FREE;
-    BlockShift = Volume->BlockShift;
-    ClusterCount = Volume->ClusterCount;
+
+    *AllocatedCount = 0;
     InformationIoBuffer = NULL;
     IoFlags = IO_FLAG_FS_DATA | IO_FLAG_FS_METADATA;
+    RunStart = FAT_CLUSTER_FREE;
 
+    ASSERT(ClusterCount != 0);
     ASSERT((PreviousCluster >= Volume->ClusterBad) ||
-           (PreviousCluster < ClusterCount));
+           (PreviousCluster < Volume->ClusterCount));
 
     if ((PreviousCluster < Volume->ClusterBad) &&
-        (PreviousCluster >= ClusterCount)) {
+        (PreviousCluster >= Volume->ClusterCount)) {
 
         return STATUS_INVALID_PARAMETER;
     }
 
-    FatAcquireLock(Volume->Lock);
-    if ((Volume->ClusterSearchStart < FAT_CLUSTER_BEGIN) ||
-        (Volume->ClusterSearchStart >= ClusterCount)) {
+    Goal = FAT_CLUSTER_FREE;
+    if ((PreviousCluster >= FAT_CLUSTER_BEGIN) &&
+        (PreviousCluster < Volume->ClusterCount)) {
 
-        Volume->ClusterSearchStart = FAT_CLUSTER_BEGIN;
+        Goal = PreviousCluster + 1;
     }
 
     //
-    // Search for a free block. Start just after the last allocated cluster.
+    // Find a run of free clusters in the bitmap. If nothing was found, sadly
+    // return.
     //
 
-    CurrentCluster = Volume->ClusterSearchStart;
-    ClusterEnd = ClusterCount;
-    SearchStart = CurrentCluster;
-    CurrentCluster += 1;
-    WindowSize = FAT_WINDOW_INDEX_TO_CLUSTER(Volume, 1);
-    WindowOffset = MAX_ULONG;
-    while (CurrentCluster != SearchStart) {
-
-        //
-        // If this is the end of the FAT, wrap around to the beginning.
-        //
-
-        if (CurrentCluster >= ClusterEnd) {
-            CurrentCluster = FAT_CLUSTER_BEGIN;
-            WindowOffset = MAX_ULONG;
-            ClusterEnd = SearchStart;
-        }
-
-        //
-        // Read the next window if needed.
-        //
-
-        if (WindowOffset >= WindowSize) {
-            Status = FatpFatCacheGetFatWindow(Volume,
-                                              TRUE,
-                                              CurrentCluster,
-                                              &Window,
-                                              &WindowOffset);
-
-            if (!KSUCCESS(Status)) {
-                goto AllocateClusterEnd;
-            }
-        }
-
-        //
-        // Scan the whole window.
-        //
-
-        if (Volume->Format == Fat12Format) {
-            while (CurrentCluster < ClusterEnd) {
-                Value = FAT12_READ_CLUSTER(Window, CurrentCluster);
-                if (Value == FAT_CLUSTER_FREE) {
-                    break;
-                }
-
-                CurrentCluster += 1;
-            }
-
-        } else if (Volume->Format == Fat16Format) {
-            Window16 = Window;
-            while ((WindowOffset < WindowSize) &&
-                   (CurrentCluster < ClusterEnd) &&
-                   (Window16[WindowOffset] != FAT_CLUSTER_FREE)) {
-
-                WindowOffset += 1;
-                CurrentCluster += 1;
-            }
+    FatAcquireLock(Volume->Lock);
+    RunStart = FatpClusterBitmapFindRun(Volume,
+                                        Goal,
+                                        ClusterCount,
+                                        &RunLength);
 
-        } else {
-            Window32 = Window;
-            while ((WindowOffset < WindowSize) &&
-                   (CurrentCluster < ClusterEnd) &&
-                   (Window32[WindowOffset] != FAT_CLUSTER_FREE)) {
+    if (RunStart == FAT_CLUSTER_FREE) {
+        Status = STATUS_VOLUME_FULL;
+        goto AllocateClusterRunEnd;
+    }
 
-                WindowOffset += 1;
-                CurrentCluster += 1;
-            }
-        }
+    //
+    // Chain the clusters of the run together, marking each as allocated once
+    // its FAT entry has been written in stone.
+    //
 
-        if ((WindowOffset >= WindowSize) || (CurrentCluster >= ClusterEnd)) {
-            continue;
+    for (Index = 0; Index < RunLength; Index += 1) {
+        Cluster = RunStart + Index;
+        Value = Cluster + 1;
+        if (Index == RunLength - 1) {
+            Value = Volume->ClusterEnd;
         }
 
-        Status = FatpFatCacheWriteClusterEntry(Volume,
-                                               CurrentCluster,
-                                               Volume->ClusterEnd,
-                                               NULL);
-
+        Status = FatpFatCacheWriteClusterEntry(Volume, Cluster, Value, NULL);
         if (!KSUCCESS(Status)) {
-            goto AllocateClusterEnd;
+            goto AllocateClusterRunEnd;
         }
 
-        //
-        // Mark a cluster as allocated now that it's been written in stone.
-        //
-
-        AllocatedCluster = CurrentCluster;
-        break;
+        FatpClusterBitmapMark(Volume, Cluster, FALSE);
+        *AllocatedCount += 1;
     }
 
-    //
-    // If nothing was found, sadly return.
-    //
-
-    if (AllocatedCluster == FAT_CLUSTER_FREE) {
-        Status = STATUS_VOLUME_FULL;
-        goto AllocateClusterEnd;
-    }
+    Volume->ClusterSearchStart = RunStart + RunLength - 1;
 
     //
-    // Update the FS information block saving the new free space and last block
-    // allocated.
+    // Update the FS information block with the new free space and last block
+    // allocated. The free count comes straight from the bitmap.
     //
 
     if ((FatMaintainFreeClusterCount != FALSE) &&
@@ -1475,10 +1545,10 @@ Return Value:
 
         if (InformationIoBuffer == NULL) {
             Status = STATUS_INSUFFICIENT_RESOURCES;
-            goto AllocateClusterEnd;
+            goto AllocateClusterRunEnd;
         }
 
-        InformationBlock = Volume->InformationByteOffset >> BlockShift;
+        InformationBlock = Volume->InformationByteOffset >> Volume->BlockShift;
         Status = FatReadDevice(Volume->Device.DeviceToken,
                                InformationBlock,
                                1,
@@ -1487,23 +1557,17 @@ Return Value:
                                InformationIoBuffer);
 
         if (!KSUCCESS(Status)) {
-            goto AllocateClusterEnd;
+            goto AllocateClusterRunEnd;
         }
 
         Information = FatMapIoBuffer(InformationIoBuffer);
         if (Information == NULL) {
             Status = STATUS_INSUFFICIENT_RESOURCES;
-            goto AllocateClusterEnd;
-        }
-
-        Information->LastClusterAllocated = AllocatedCluster;
-
-        ASSERT(Information->FreeClusters != 0);
-
-        if (Information->FreeClusters != 0) {
-            Information->FreeClusters -= 1;
+            goto AllocateClusterRunEnd;
         }
 
+        Information->LastClusterAllocated = Volume->ClusterSearchStart;
+        Information->FreeClusters = Volume->FreeClusterCount;
         Status = FatWriteDevice(Volume->Device.DeviceToken,
                                 InformationBlock,
                                 1,
@@ -1512,43 +1576,41 @@ Return Value:
                                 InformationIoBuffer);
 
         if (!KSUCCESS(Status)) {
-            goto AllocateClusterEnd;
+            goto AllocateClusterRunEnd;
         }
     }
 
-    Volume->ClusterSearchStart = AllocatedCluster;
-
     //
     // Lookup the previous block and update it.
     //
 
-    if ((PreviousCluster != 0) && (PreviousCluster < ClusterCount)) {
+    if (Goal != FAT_CLUSTER_FREE) {
         Status = FatpFatCacheWriteClusterEntry(Volume,
                                                PreviousCluster,
-                                               AllocatedCluster,
+                                               RunStart,
                                                NULL);
 
         if (!KSUCCESS(Status)) {
-            goto AllocateClusterEnd;
+            goto AllocateClusterRunEnd;
         }
     }
 
     if (Flush != FALSE) {
         Status = FatpFatCacheFlush(Volume, 0);
         if (!KSUCCESS(Status)) {
-            goto AllocateClusterEnd;
+            goto AllocateClusterRunEnd;
         }
     }
 
     Status = STATUS_SUCCESS;
 
-AllocateClusterEnd:
+AllocateClusterRunEnd:
     FatReleaseLock(Volume->Lock);
     if (InformationIoBuffer != NULL) {
         FatFreeIoBuffer(InformationIoBuffer);
     }
 
-    *NewCluster = AllocatedCluster;
+    *NewCluster = RunStart;
     return Status;
 }
 
@@ -1583,7 +1645,6 @@ Return Value:
 {
 
     ULONG Cluster;
-    ULONG ClusterCount;
     PFAT32_INFORMATION_SECTOR Information;
     ULONGLONG InformationBlock;
     PFAT_IO_BUFFER InformationIoBuffer;
@@ -1601,7 +1662,6 @@ Return Value:
         goto FreeClusterChainEnd;
     }
 
-    ClusterCount = 0;
     Cluster = FirstCluster;
     while (TRUE) {
         if ((Cluster < FAT_CLUSTER_BEGIN) || (Cluster >= TotalClusters)) {
@@ -1641,7 +1701,7 @@ Return Value:
             goto FreeClusterChainEnd;
         }
 
-        ClusterCount += 1;
+        FatpClusterBitmapMark(Volume, Cluster, TRUE);
         if (NextCluster >= TotalClusters) {
             break;
         }
@@ -1688,11 +1748,7 @@ Return Value:
         }
 
         Information->LastClusterAllocated = Cluster;
-
-        ASSERT(Information->FreeClusters + ClusterCount >
-               Information->FreeClusters);
-
-        Information->FreeClusters += ClusterCount;
+        Information->FreeClusters = Volume->FreeClusterCount;
         Status = FatWriteDevice(Volume->Device.DeviceToken,
                                 InformationBlock,
                                 1,
@@ -1940,9 +1996,11 @@ Return Value:
     ULONG EntriesRead;
     ULONG EntriesWritten;
     BOOL LocalEntryErased;
+    ULONG LongEntryCount;
     KSTATUS Status;
 
     LocalEntryErased = FALSE;
+    LongEntryCount = 0;
 
     //
     // Seek and read in the directory entry.
@@ -2005,7 +2063,8 @@ Return Value:
     Status = FatpPerformLongEntryMaintenance(Directory,
                                              EntryOffset,
                                              Checksum,
-                                             (ULONG)-1);
+                                             (ULONG)-1,
+                                             &LongEntryCount);
 
     if ((Directory->FatFlags & FAT_DIRECTORY_FLAG_DIRTY) == 0) {
         LocalEntryErased = TRUE;
@@ -2029,11 +2088,24 @@ Return Value:
 EraseDirectoryEntryEnd:
 
     //
-    // Unset the mapping if the directory entry was erased.
+    // Unset the mapping if the directory entry was erased, and let the
+    // directory index know. If the erase failed part way through, some long
+    // entries may still be around, so the index can't tell which slots are
+    // free. Toss it in that case.
     //
 
     if (LocalEntryErased != FALSE) {
         FatpUnsetFileMapping(Directory->File->Volume, Cluster);
+        if (KSUCCESS(Status)) {
+            FatpDirectoryIndexRemove(Directory->File->Volume,
+                                     Directory->File->SeekTable[0],
+                                     EntryOffset,
+                                     LongEntryCount + 1);
+
+        } else {
+            FatpDestroyDirectoryIndex(Directory->File->Volume,
+                                      Directory->File->SeekTable[0]);
+        }
     }
 
     *EntryErased = LocalEntryErased;
@@ -2299,7 +2371,8 @@ Return Value:
     Status = FatpPerformLongEntryMaintenance(DirectoryContext,
                                              EntryOffset,
                                              OriginalChecksum,
-                                             NewChecksum);
+                                             NewChecksum,
+                                             NULL);
 
     if (!KSUCCESS(Status)) {
         goto AllocateClusterForEmptyFileEnd;
@@ -2340,7 +2413,8 @@ FatpPerformLongEntryMaintenance (
     PFAT_DIRECTORY_CONTEXT Directory,
     ULONGLONG EntryOffset,
     UCHAR Checksum,
-    ULONG NewChecksum
+    ULONG NewChecksum,
+    PULONG EntryCount
     )
 
 /*++
@@ -2364,6 +2438,9 @@ Routine Description:
     NewChecksum - Supplies the new checksum to set in the long entries. If this
         is -1, then the directory entries will be marked erased.
 
+    EntryCount - Supplies an optional pointer that receives the number of long
+        entries that were modified.
+
 Return Value:
 
     Status code.
@@ -2376,6 +2453,7 @@ Return Value:
     ULONG EntriesRead;
     ULONG EntriesWritten;
     PFAT_LONG_DIRECTORY_ENTRY LongEntry;
+    ULONG ModifiedCount;
     UCHAR NextSequence;
     UCHAR Sequence;
     KSTATUS Status;
@@ -2387,6 +2465,7 @@ Return Value:
     // first entry erased.
     //
 
+    ModifiedCount = 0;
     NextSequence = 1;
     while (EntryOffset > DIRECTORY_CONTENTS_OFFSET) {
         EntryOffset -= 1;
@@ -2452,6 +2531,8 @@ Return Value:
 
             ASSERT(EntriesWritten == 1);
 
+            ModifiedCount += 1;
+
             //
             // Stop if that was the last one.
             //
@@ -2470,6 +2551,10 @@ Return Value:
     Status = STATUS_SUCCESS;
 
 PerformLongEntryMaintenanceEnd:
+    if (EntryCount != NULL) {
+        *EntryCount = ModifiedCount;
+    }
+
     return Status;
 }
 
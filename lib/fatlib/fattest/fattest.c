@@ -50,6 +50,34 @@ Module Name:
 #define BLOCK_ITERATIONS 10000
 #define BLOCK_SIZE 4096
 
+//
+// Define parameters for the fragmented file test. Chunks are written to each
+// file in turn so that the files' cluster chains interleave on disk.
+//
+
+#define FRAGMENT_FILE_COUNT 2
+#define FRAGMENT_CHUNK_SIZE (32 * 1024)
+#define FRAGMENT_CHUNK_COUNT 48
+#define FRAGMENT_FILE_SIZE (FRAGMENT_CHUNK_SIZE * FRAGMENT_CHUNK_COUNT)
+#define FRAGMENT_READ_SIZE (FRAGMENT_CHUNK_SIZE * 3)
+#define FRAGMENT_READ_ITERATIONS 5000
+
+//
+// Define parameters for the large directory test.
+//
+
+#define LARGE_DIRECTORY_NAME "bigdir"
+#define LARGE_DIRECTORY_FILE_COUNT 400
+#define LARGE_DIRECTORY_NAME_SIZE 32
+
+//
+// Define the states a file in the large directory test can be in.
+//
+
+#define LARGE_DIRECTORY_ORIGINAL 0
+#define LARGE_DIRECTORY_UNLINKED 1
+#define LARGE_DIRECTORY_RENAMED 2
+
 #define USAGE_STRING    \
     "Testfat.exe will test the FAT file system implementation.\n\n" \
     "Usage: Testfat.exe [-v]\n\n" \
@@ -85,6 +113,14 @@ Module Name:
         }                              \
     }
 
+//
+// This macro returns the value stored at the given byte offset of the given
+// fragmented test file.
+//
+
+#define FRAGMENT_VALUE(_FileIndex, _Offset) \
+    (((_FileIndex) << 28) | ((_Offset) / sizeof(ULONG)))
+
 //
 // ----------------------------------------------- Internal Function Prototypes
 //
@@ -97,6 +133,39 @@ FormatDisk (
     PVOID *VolumeToken
     );
 
+BOOL
+TestFragmentedFiles (
+    PVOID VolumeToken,
+    PFILE_PROPERTIES DirectoryProperties
+    );
+
+ULONG
+CountFileFragments (
+    PVOID VolumeToken,
+    FILE_ID FileId
+    );
+
+BOOL
+TestLargeDirectory (
+    PVOID VolumeToken,
+    PFILE_PROPERTIES DirectoryProperties
+    );
+
+BOOL
+VerifyLargeDirectory (
+    PVOID VolumeToken,
+    FILE_ID DirectoryId,
+    PULONG States,
+    PFILE_ID FileIds
+    );
+
+VOID
+GetLargeDirectoryName (
+    ULONG Index,
+    ULONG State,
+    PSTR Name
+    );
+
 //
 // -------------------------------------------------------------------- Globals
 //
@@ -475,6 +544,26 @@ Return Value:
     }
 
     FatCloseFile(FileToken);
+    VPRINT("\n");
+
+    //
+    // Interleave writes to a couple of files so their cluster chains are
+    // fragmented, and then read them back at random offsets.
+    //
+
+    if (TestFragmentedFiles(VolumeToken, &DirectoryProperties) == FALSE) {
+        goto MainEnd;
+    }
+
+    //
+    // Fill a directory with lots of files, and then look them up, delete,
+    // rename, and recreate them.
+    //
+
+    if (TestLargeDirectory(VolumeToken, &DirectoryProperties) == FALSE) {
+        goto MainEnd;
+    }
+
     Result = TRUE;
 
 MainEnd:
@@ -497,6 +586,806 @@ Return Value:
 // --------------------------------------------------------- Internal Functions
 //
 
+BOOL
+TestFragmentedFiles (
+    PVOID VolumeToken,
+    PFILE_PROPERTIES DirectoryProperties
+    )
+
+/*++
+
+Routine Description:
+
+    This routine tests seeking and reading within files whose cluster chains
+    are fragmented, seeking beyond the end of a truncated file, and appending
+    to a file when the free space is fragmented.
+
+Arguments:
+
+    VolumeToken - Supplies the token identifying the mounted volume.
+
+    DirectoryProperties - Supplies a pointer to the properties of the
+        directory to create the test files in.
+
+Return Value:
+
+    TRUE on success.
+
+    FALSE on failure.
+
+--*/
+
+{
+
+    PULONG Buffer;
+    UINTN BytesRead;
+    UINTN BytesWritten;
+    ULONG ChunkIndex;
+    ULONG FileIndex;
+    CHAR FileName[16];
+    PVOID FileToken[FRAGMENT_FILE_COUNT];
+    ULONG FragmentCount;
+    PFAT_IO_BUFFER IoBuffer;
+    ULONG Iteration;
+    ULONG Length;
+    ULONGLONG NewDirectorySize;
+    ULONG Offset;
+    FILE_PROPERTIES Properties[FRAGMENT_FILE_COUNT];
+    BOOL Result;
+    FAT_SEEK_INFORMATION Seek[FRAGMENT_FILE_COUNT];
+    KSTATUS Status;
+    ULONG WordIndex;
+
+    Result = FALSE;
+    RtlZeroMemory(FileToken, sizeof(FileToken));
+    RtlZeroMemory(Seek, sizeof(Seek));
+    IoBuffer = FatAllocateIoBuffer(NULL, FRAGMENT_READ_SIZE);
+    if (IoBuffer == NULL) {
+        printf("Error: Unable to allocate fragment buffer.\n");
+        goto TestFragmentedFilesEnd;
+    }
+
+    Buffer = FatMapIoBuffer(IoBuffer);
+    if (Buffer == NULL) {
+        printf("Error: Unable to map fragment buffer.\n");
+        goto TestFragmentedFilesEnd;
+    }
+
+    //
+    // Create and open the files.
+    //
+
+    VPRINT("Creating %d fragmented files\n", FRAGMENT_FILE_COUNT);
+    for (FileIndex = 0; FileIndex < FRAGMENT_FILE_COUNT; FileIndex += 1) {
+        snprintf(FileName, sizeof(FileName), "frag%d.dat", FileIndex);
+        RtlZeroMemory(&(Properties[FileIndex]), sizeof(FILE_PROPERTIES));
+        Properties[FileIndex].Type = IoObjectRegularFile;
+        Properties[FileIndex].Permissions = FILE_PERMISSION_USER_READ |
+                                            FILE_PERMISSION_USER_WRITE;
+
+        Properties[FileIndex].HardLinkCount = 1;
+        Status = FatCreate(VolumeToken,
+                           DirectoryProperties->FileId,
+                           FileName,
+                           strlen(FileName) + 1,
+                           &NewDirectorySize,
+                           &(Properties[FileIndex]));
+
+        if (!KSUCCESS(Status)) {
+            printf("Error: Unable to create file %s. Status %d.\n",
+                   FileName,
+                   Status);
+
+            goto TestFragmentedFilesEnd;
+        }
+
+        if (NewDirectorySize > DirectoryProperties->Size) {
+            DirectoryProperties->Size = NewDirectorySize;
+            FatWriteFileProperties(VolumeToken, DirectoryProperties, 0);
+        }
+
+        Status = FatOpenFileId(VolumeToken,
+                               Properties[FileIndex].FileId,
+                               IO_ACCESS_READ | IO_ACCESS_WRITE,
+                               OPEN_FLAG_CREATE,
+                               &(FileToken[FileIndex]));
+
+        if (!KSUCCESS(Status)) {
+            printf("Error: Unable to open %s. Status %d.\n", FileName, Status);
+            goto TestFragmentedFilesEnd;
+        }
+    }
+
+    //
+    // Append a chunk to each file in turn.
+    //
+
+    for (ChunkIndex = 0; ChunkIndex < FRAGMENT_CHUNK_COUNT; ChunkIndex += 1) {
+        for (FileIndex = 0; FileIndex < FRAGMENT_FILE_COUNT; FileIndex += 1) {
+            Offset = ChunkIndex * FRAGMENT_CHUNK_SIZE;
+            for (WordIndex = 0;
+                 WordIndex < (FRAGMENT_CHUNK_SIZE / sizeof(ULONG));
+                 WordIndex += 1) {
+
+                Buffer[WordIndex] =
+                    FRAGMENT_VALUE(FileIndex,
+                                   Offset + (WordIndex * sizeof(ULONG)));
+            }
+
+            Status = FatWriteFile(FileToken[FileIndex],
+                                  &(Seek[FileIndex]),
+                                  IoBuffer,
+                                  FRAGMENT_CHUNK_SIZE,
+                                  0,
+                                  NULL,
+                                  &BytesWritten);
+
+            if ((!KSUCCESS(Status)) ||
+                (BytesWritten != FRAGMENT_CHUNK_SIZE)) {
+
+                printf("Error: Wrote %lu bytes to fragmented file %d chunk "
+                       "%d. Status = %d.\n",
+                       BytesWritten,
+                       FileIndex,
+                       ChunkIndex,
+                       Status);
+
+                goto TestFragmentedFilesEnd;
+            }
+        }
+    }
+
+    //
+    // Read back random ranges, which will often span several fragments.
+    //
+
+    VPRINT("Doing %d fragmented reads\n", FRAGMENT_READ_ITERATIONS);
+    for (Iteration = 0; Iteration < FRAGMENT_READ_ITERATIONS; Iteration += 1) {
+        FileIndex = rand() % FRAGMENT_FILE_COUNT;
+        Offset = (rand() % (FRAGMENT_FILE_SIZE / sizeof(ULONG))) *
+                 sizeof(ULONG);
+
+        Length = ((rand() % (FRAGMENT_READ_SIZE / sizeof(ULONG))) + 1) *
+                 sizeof(ULONG);
+
+        if (Length > FRAGMENT_FILE_SIZE - Offset) {
+            Length = FRAGMENT_FILE_SIZE - Offset;
+        }
+
+        DPRINT("File %d, Offset %08x, Length %08x\n",
+               FileIndex,
+               Offset,
+               Length);
+
+        Status = FatFileSeek(FileToken[FileIndex],
+                             NULL,
+                             0,
+                             SeekCommandFromBeginning,
+                             Offset,
+                             &(Seek[FileIndex]));
+
+        if (!KSUCCESS(Status)) {
+            printf("Error: Could not seek fragmented file %d to offset "
+                   "0x%x. Status = %d.\n",
+                   FileIndex,
+                   Offset,
+                   Status);
+
+            goto TestFragmentedFilesEnd;
+        }
+
+        Status = FatReadFile(FileToken[FileIndex],
+                             &(Seek[FileIndex]),
+                             IoBuffer,
+                             Length,
+                             0,
+                             NULL,
+                             &BytesRead);
+
+        if ((!KSUCCESS(Status)) || (BytesRead != Length)) {
+            printf("Error: Reading 0x%x bytes at 0x%x from fragmented file "
+                   "%d read %lu bytes, status %d.\n",
+                   Length,
+                   Offset,
+                   FileIndex,
+                   BytesRead,
+                   Status);
+
+            goto TestFragmentedFilesEnd;
+        }
+
+        for (WordIndex = 0;
+             WordIndex < (Length / sizeof(ULONG));
+             WordIndex += 1) {
+
+            if (Buffer[WordIndex] !=
+                FRAGMENT_VALUE(FileIndex,
+                               Offset + (WordIndex * sizeof(ULONG)))) {
+
+                printf("Error: Fragmented file %d offset 0x%lx had %x "
+                       "instead of %lx\n",
+                       FileIndex,
+                       (long)(Offset + (WordIndex * sizeof(ULONG))),
+                       Buffer[WordIndex],
+                       (long)FRAGMENT_VALUE(FileIndex,
+                                            Offset +
+                                            (WordIndex * sizeof(ULONG))));
+
+                goto TestFragmentedFilesEnd;
+            }
+        }
+    }
+
+    //
+    // Truncate the first file in half, and make sure seeks past the new end
+    // fail while the data before it is intact.
+    //
+
+    VPRINT("Truncating fragmented file\n");
+    Status = FatTruncate(VolumeToken,
+                         FileToken[0],
+                         Properties[0].FileId,
+                         FRAGMENT_FILE_SIZE,
+                         FRAGMENT_FILE_SIZE / 2);
+
+    if (!KSUCCESS(Status)) {
+        printf("Error: Failed to truncate fragmented file. Status = %d.\n",
+               Status);
+
+        goto TestFragmentedFilesEnd;
+    }
+
+    Status = FatFileSeek(FileToken[0],
+                         NULL,
+                         0,
+                         SeekCommandFromBeginning,
+                         FRAGMENT_FILE_SIZE - FRAGMENT_CHUNK_SIZE,
+                         &(Seek[0]));
+
+    if (Status != STATUS_END_OF_FILE) {
+        printf("Error: Seek beyond truncated file returned %d.\n", Status);
+        goto TestFragmentedFilesEnd;
+    }
+
+    Offset = (FRAGMENT_FILE_SIZE / 2) - FRAGMENT_CHUNK_SIZE;
+    Status = FatFileSeek(FileToken[0],
+                         NULL,
+                         0,
+                         SeekCommandFromBeginning,
+                         Offset,
+                         &(Seek[0]));
+
+    if (!KSUCCESS(Status)) {
+        printf("Error: Seek within truncated file returned %d.\n", Status);
+        goto TestFragmentedFilesEnd;
+    }
+
+    Status = FatReadFile(FileToken[0],
+                         &(Seek[0]),
+                         IoBuffer,
+                         FRAGMENT_CHUNK_SIZE,
+                         0,
+                         NULL,
+                         &BytesRead);
+
+    if ((!KSUCCESS(Status)) || (BytesRead != FRAGMENT_CHUNK_SIZE) ||
+        (Buffer[0] != FRAGMENT_VALUE(0, Offset))) {
+
+        printf("Error: Read of truncated file failed. Status = %d.\n",
+               Status);
+
+        goto TestFragmentedFilesEnd;
+    }
+
+    //
+    // The truncation left holes in the free space. Append a large write to
+    // the second file, which should still land right after its last cluster
+    // rather than being scattered among the holes.
+    //
+
+    VPRINT("Appending to fragmented file\n");
+    FragmentCount = CountFileFragments(VolumeToken, Properties[1].FileId);
+    Status = FatFileSeek(FileToken[1],
+                         NULL,
+                         0,
+                         SeekCommandFromBeginning,
+                         FRAGMENT_FILE_SIZE,
+                         &(Seek[1]));
+
+    if (!KSUCCESS(Status)) {
+        printf("Error: Seek to end of fragmented file returned %d.\n",
+               Status);
+
+        goto TestFragmentedFilesEnd;
+    }
+
+    for (WordIndex = 0;
+         WordIndex < (FRAGMENT_READ_SIZE / sizeof(ULONG));
+         WordIndex += 1) {
+
+        Offset = FRAGMENT_FILE_SIZE + (WordIndex * sizeof(ULONG));
+        Buffer[WordIndex] = FRAGMENT_VALUE(1, Offset);
+    }
+
+    Status = FatWriteFile(FileToken[1],
+                          &(Seek[1]),
+                          IoBuffer,
+                          FRAGMENT_READ_SIZE,
+                          0,
+                          NULL,
+                          &BytesWritten);
+
+    if ((!KSUCCESS(Status)) || (BytesWritten != FRAGMENT_READ_SIZE)) {
+        printf("Error: Append to fragmented file wrote %lu bytes. "
+               "Status = %d.\n",
+               BytesWritten,
+               Status);
+
+        goto TestFragmentedFilesEnd;
+    }
+
+    if ((FragmentCount == 0) ||
+        (CountFileFragments(VolumeToken, Properties[1].FileId) !=
+         FragmentCount)) {
+
+        printf("Error: Appending to a file with %d fragments fragmented it "
+               "further.\n",
+               FragmentCount);
+
+        goto TestFragmentedFilesEnd;
+    }
+
+    Result = TRUE;
+
+TestFragmentedFilesEnd:
+    for (FileIndex = 0; FileIndex < FRAGMENT_FILE_COUNT; FileIndex += 1) {
+        if (FileToken[FileIndex] != NULL) {
+            FatCloseFile(FileToken[FileIndex]);
+        }
+    }
+
+    if (IoBuffer != NULL) {
+        FatFreeIoBuffer(IoBuffer);
+    }
+
+    return Result;
+}
+
+ULONG
+CountFileFragments (
+    PVOID VolumeToken,
+    FILE_ID FileId
+    )
+
+/*++
+
+Routine Description:
+
+    This routine counts the number of physically contiguous runs that make up
+    a file.
+
+Arguments:
+
+    VolumeToken - Supplies the token identifying the mounted volume.
+
+    FileId - Supplies the ID of the file.
+
+Return Value:
+
+    Returns the number of runs in the file, or 0 on failure.
+
+--*/
+
+{
+
+    PFILE_BLOCK_ENTRY BlockEntry;
+    PFILE_BLOCK_INFORMATION BlockInformation;
+    ULONG Count;
+    KSTATUS Status;
+
+    Status = FatGetFileBlockInformation(VolumeToken, FileId, &BlockInformation);
+    if (!KSUCCESS(Status)) {
+        printf("Error: Failed to get block information. Status = %d.\n",
+               Status);
+
+        return 0;
+    }
+
+    Count = 0;
+    while (LIST_EMPTY(&(BlockInformation->BlockList)) == FALSE) {
+        BlockEntry = LIST_VALUE(BlockInformation->BlockList.Next,
+                                FILE_BLOCK_ENTRY,
+                                ListEntry);
+
+        LIST_REMOVE(&(BlockEntry->ListEntry));
+        FatFreeNonPagedMemory(NULL, BlockEntry);
+        Count += 1;
+    }
+
+    FatFreeNonPagedMemory(NULL, BlockInformation);
+    return Count;
+}
+
+BOOL
+TestLargeDirectory (
+    PVOID VolumeToken,
+    PFILE_PROPERTIES DirectoryProperties
+    )
+
+/*++
+
+Routine Description:
+
+    This routine tests lookups in a directory with many entries while files
+    are created, unlinked, and renamed within it.
+
+Arguments:
+
+    VolumeToken - Supplies the token identifying the mounted volume.
+
+    DirectoryProperties - Supplies a pointer to the properties of the
+        directory to create the test directory in.
+
+Return Value:
+
+    TRUE on success.
+
+    FALSE on failure.
+
+--*/
+
+{
+
+    BOOL Created;
+    FILE_PROPERTIES Directory;
+    ULONGLONG DirectorySize;
+    BOOL Erased;
+    FILE_ID FileIds[LARGE_DIRECTORY_FILE_COUNT];
+    ULONG Index;
+    CHAR Name[LARGE_DIRECTORY_NAME_SIZE];
+    ULONGLONG NewDirectorySize;
+    FILE_PROPERTIES Properties;
+    BOOL Result;
+    ULONG States[LARGE_DIRECTORY_FILE_COUNT];
+    KSTATUS Status;
+    BOOL Unlinked;
+
+    Result = FALSE;
+
+    //
+    // Create the directory.
+    //
+
+    RtlZeroMemory(&Directory, sizeof(FILE_PROPERTIES));
+    Directory.Type = IoObjectRegularDirectory;
+    Directory.Permissions = FILE_PERMISSION_USER_ALL;
+    Directory.HardLinkCount = 1;
+    Status = FatCreate(VolumeToken,
+                       DirectoryProperties->FileId,
+                       LARGE_DIRECTORY_NAME,
+                       sizeof(LARGE_DIRECTORY_NAME),
+                       &NewDirectorySize,
+                       &Directory);
+
+    if (!KSUCCESS(Status)) {
+        printf("Error: Unable to create directory %s. Status %d.\n",
+               LARGE_DIRECTORY_NAME,
+               Status);
+
+        goto TestLargeDirectoryEnd;
+    }
+
+    if (NewDirectorySize > DirectoryProperties->Size) {
+        DirectoryProperties->Size = NewDirectorySize;
+        FatWriteFileProperties(VolumeToken, DirectoryProperties, 0);
+    }
+
+    //
+    // Fill it up.
+    //
+
+    VPRINT("Creating %d files in a directory\n", LARGE_DIRECTORY_FILE_COUNT);
+    DirectorySize = 0;
+    for (Index = 0; Index < LARGE_DIRECTORY_FILE_COUNT; Index += 1) {
+        States[Index] = LARGE_DIRECTORY_ORIGINAL;
+        GetLargeDirectoryName(Index, States[Index], Name);
+        RtlZeroMemory(&Properties, sizeof(FILE_PROPERTIES));
+        Properties.Type = IoObjectRegularFile;
+        Properties.Permissions = FILE_PERMISSION_USER_READ |
+                                 FILE_PERMISSION_USER_WRITE;
+
+        Properties.HardLinkCount = 1;
+        Status = FatCreate(VolumeToken,
+                           Directory.FileId,
+                           Name,
+                           strlen(Name) + 1,
+                           &NewDirectorySize,
+                           &Properties);
+
+        if (!KSUCCESS(Status)) {
+            printf("Error: Unable to create file %s. Status %d.\n",
+                   Name,
+                   Status);
+
+            goto TestLargeDirectoryEnd;
+        }
+
+        FileIds[Index] = Properties.FileId;
+        if (NewDirectorySize > DirectorySize) {
+            DirectorySize = NewDirectorySize;
+        }
+    }
+
+    if (VerifyLargeDirectory(VolumeToken,
+                             Directory.FileId,
+                             States,
+                             FileIds) == FALSE) {
+
+        goto TestLargeDirectoryEnd;
+    }
+
+    //
+    // A name that differs only in case is a different name.
+    //
+
+    GetLargeDirectoryName(0, LARGE_DIRECTORY_ORIGINAL, Name);
+    Name[0] = RtlConvertCharacterToLowerCase(Name[0]);
+    Status = FatLookup(VolumeToken,
+                       FALSE,
+                       Directory.FileId,
+                       Name,
+                       strlen(Name) + 1,
+                       &Properties);
+
+    if (Status != STATUS_PATH_NOT_FOUND) {
+        printf("Error: Looking up %s returned %d.\n", Name, Status);
+        goto TestLargeDirectoryEnd;
+    }
+
+    //
+    // Unlink every third file, and rename the ones after them.
+    //
+
+    VPRINT("Unlinking and renaming files in a directory\n");
+    for (Index = 0; Index < LARGE_DIRECTORY_FILE_COUNT; Index += 3) {
+        GetLargeDirectoryName(Index, States[Index], Name);
+        Status = FatUnlink(VolumeToken,
+                           Directory.FileId,
+                           Name,
+                           strlen(Name) + 1,
+                           FileIds[Index],
+                           &Unlinked);
+
+        if (!KSUCCESS(Status)) {
+            printf("Error: Unable to unlink %s. Status %d.\n", Name, Status);
+            goto TestLargeDirectoryEnd;
+        }
+
+        FatDeleteFileBlocks(VolumeToken, NULL, FileIds[Index], 0, FALSE);
+        States[Index] = LARGE_DIRECTORY_UNLINKED;
+        if (Index + 1 >= LARGE_DIRECTORY_FILE_COUNT) {
+            continue;
+        }
+
+        GetLargeDirectoryName(Index + 1, LARGE_DIRECTORY_RENAMED, Name);
+        Status = FatRename(VolumeToken,
+                           Directory.FileId,
+                           FileIds[Index + 1],
+                           &Erased,
+                           Directory.FileId,
+                           &Created,
+                           &NewDirectorySize,
+                           Name,
+                           strlen(Name) + 1);
+
+        if (!KSUCCESS(Status)) {
+            printf("Error: Unable to rename to %s. Status %d.\n",
+                   Name,
+                   Status);
+
+            goto TestLargeDirectoryEnd;
+        }
+
+        States[Index + 1] = LARGE_DIRECTORY_RENAMED;
+    }
+
+    if (VerifyLargeDirectory(VolumeToken,
+                             Directory.FileId,
+                             States,
+                             FileIds) == FALSE) {
+
+        goto TestLargeDirectoryEnd;
+    }
+
+    //
+    // Recreate the unlinked files. They should fit in the space that was
+    // freed up.
+    //
+
+    for (Index = 0; Index < LARGE_DIRECTORY_FILE_COUNT; Index += 3) {
+        States[Index] = LARGE_DIRECTORY_ORIGINAL;
+        GetLargeDirectoryName(Index, States[Index], Name);
+        RtlZeroMemory(&Properties, sizeof(FILE_PROPERTIES));
+        Properties.Type = IoObjectRegularFile;
+        Properties.Permissions = FILE_PERMISSION_USER_READ |
+                                 FILE_PERMISSION_USER_WRITE;
+
+        Properties.HardLinkCount = 1;
+        Status = FatCreate(VolumeToken,
+                           Directory.FileId,
+                           Name,
+                           strlen(Name) + 1,
+                           &NewDirectorySize,
+                           &Properties);
+
+        if (!KSUCCESS(Status)) {
+            printf("Error: Unable to recreate file %s. Status %d.\n",
+                   Name,
+                   Status);
+
+            goto TestLargeDirectoryEnd;
+        }
+
+        FileIds[Index] = Properties.FileId;
+        if (NewDirectorySize > DirectorySize) {
+            printf("Error: Recreating %s grew the directory from %lld to "
+                   "%lld bytes.\n",
+                   Name,
+                   DirectorySize,
+                   NewDirectorySize);
+
+            goto TestLargeDirectoryEnd;
+        }
+    }
+
+    if (VerifyLargeDirectory(VolumeToken,
+                             Directory.FileId,
+                             States,
+                             FileIds) == FALSE) {
+
+        goto TestLargeDirectoryEnd;
+    }
+
+    Result = TRUE;
+
+TestLargeDirectoryEnd:
+    return Result;
+}
+
+BOOL
+VerifyLargeDirectory (
+    PVOID VolumeToken,
+    FILE_ID DirectoryId,
+    PULONG States,
+    PFILE_ID FileIds
+    )
+
+/*++
+
+Routine Description:
+
+    This routine checks that every file in the large directory test can be
+    found under its current name and only under that name.
+
+Arguments:
+
+    VolumeToken - Supplies the token identifying the mounted volume.
+
+    DirectoryId - Supplies the file ID of the test directory.
+
+    States - Supplies the array of current file states.
+
+    FileIds - Supplies the array of current file IDs.
+
+Return Value:
+
+    TRUE if every lookup returned what it should have.
+
+    FALSE on failure.
+
+--*/
+
+{
+
+    ULONG Index;
+    CHAR Name[LARGE_DIRECTORY_NAME_SIZE];
+    FILE_PROPERTIES Properties;
+    ULONG State;
+    KSTATUS Status;
+
+    for (Index = 0; Index < LARGE_DIRECTORY_FILE_COUNT; Index += 1) {
+        for (State = LARGE_DIRECTORY_ORIGINAL;
+             State <= LARGE_DIRECTORY_RENAMED;
+             State += 1) {
+
+            if (State == LARGE_DIRECTORY_UNLINKED) {
+                continue;
+            }
+
+            GetLargeDirectoryName(Index, State, Name);
+            Status = FatLookup(VolumeToken,
+                               FALSE,
+                               DirectoryId,
+                               Name,
+                               strlen(Name) + 1,
+                               &Properties);
+
+            if (State == States[Index]) {
+                if (!KSUCCESS(Status)) {
+                    printf("Error: Failed to look up %s. Status %d.\n",
+                           Name,
+                           Status);
+
+                    return FALSE;
+                }
+
+                if (Properties.FileId != FileIds[Index]) {
+                    printf("Error: Looking up %s found file %lld instead of "
+                           "%lld.\n",
+                           Name,
+                           Properties.FileId,
+                           FileIds[Index]);
+
+                    return FALSE;
+                }
+
+            } else if (Status != STATUS_PATH_NOT_FOUND) {
+                printf("Error: Looking up missing file %s returned %d.\n",
+                       Name,
+                       Status);
+
+                return FALSE;
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+VOID
+GetLargeDirectoryName (
+    ULONG Index,
+    ULONG State,
+    PSTR Name
+    )
+
+/*++
+
+Routine Description:
+
+    This routine creates the name of a file in the large directory test.
+
+Arguments:
+
+    Index - Supplies the index of the file.
+
+    State - Supplies the state of the file, which determines whether it gets
+        its original or renamed name.
+
+    Name - Supplies a pointer where the name will be returned. This buffer
+        must be LARGE_DIRECTORY_NAME_SIZE bytes long.
+
+Return Value:
+
+    None.
+
+--*/
+
+{
+
+    if (State == LARGE_DIRECTORY_RENAMED) {
+        snprintf(Name, LARGE_DIRECTORY_NAME_SIZE, "Renamed %04d.txt", Index);
+
+    } else {
+        snprintf(Name,
+                 LARGE_DIRECTORY_NAME_SIZE,
+                 "Indexed file %04d.txt",
+                 Index);
+    }
+
+    return;
+}
+
 KSTATUS
 FormatDisk (
     FILE *File,